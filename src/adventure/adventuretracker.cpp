@@ -26,6 +26,11 @@ AdventureTracker::AdventureTracker(GameObserver &observer, QObject *const parent
 
 void AdventureTracker::slot_onUserText(const QString &line)
 {
+    // Nearly every line neither starts an event nor completes one in progress.
+    if (classifyLine(line) == LineTriggerEnum::NONE && !m_killParser.isPending()
+        && !m_achievementParser.isPending() && !m_hintParser.isPending())
+        return;
+
     // Try to order these by frequency to minimize unnecessary parsing
 
     if (m_killParser.parse(line)) {
@@ -104,7 +109,7 @@ void AdventureTracker::parseIfGoodbye([[maybe_unused]] const GmcpMessage &msg)
 
 void AdventureTracker::parseIfUpdatedCharName(const GmcpMessage &msg)
 {
-    std::optional<QJsonDocument> doc = msg.getJsonDocument();
+    const std::optional<QJsonDocument> &doc = msg.getJsonDocument();
     if (!doc || !doc->isObject())
         return;
     QJsonObject obj = doc->object();
@@ -141,7 +146,7 @@ void AdventureTracker::parseIfUpdatedVitals(const GmcpMessage &msg)
         return;
     }
 
-    std::optional<QJsonDocument> doc = msg.getJsonDocument();
+    const std::optional<QJsonDocument> &doc = msg.getJsonDocument();
     if (!doc || !doc->isObject())
         return;
     QJsonObject obj = doc->object();
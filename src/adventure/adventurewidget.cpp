@@ -43,6 +43,10 @@ AdventureWidget::AdventureWidget(AdventureTracker &at, QWidget *const parent)
     layout->setSpacing(0);
     layout->addWidget(m_textEdit);
 
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(FLUSH_DELAY_MS);
+    connect(&m_flushTimer, &QTimer::timeout, this, &AdventureWidget::flushPendingUpdates);
+
     addDefaultContent();
 
     m_clearContentAction = new QAction("Clear Content");
@@ -155,6 +159,7 @@ void AdventureWidget::slot_contextMenuRequested(const QPoint &pos)
 
 void AdventureWidget::slot_actionClearContent([[maybe_unused]] bool checked)
 {
+    m_pendingUpdates.clear();
     // REVISIT should use m_textCursor->document()->clear() instead?
     m_textCursor->movePosition(QTextCursor::Start);
     m_textCursor->movePosition(QTextCursor::Down, QTextCursor::KeepAnchor, QTextCursor::End);
@@ -167,10 +172,32 @@ void AdventureWidget::addDefaultContent()
     addAdventureUpdate(DEFAULT_MSG);
 }
 
+void AdventureWidget::showEvent(QShowEvent *const event)
+{
+    QWidget::showEvent(event);
+    flushPendingUpdates();
+}
+
 void AdventureWidget::addAdventureUpdate(const QString &msg)
 {
+    m_pendingUpdates.append(msg);
+    // The older ones would be trimmed right away anyway.
+    while (m_pendingUpdates.size() > MAX_LINES)
+        m_pendingUpdates.removeFirst();
+
+    if (isVisible() && !m_flushTimer.isActive())
+        m_flushTimer.start();
+}
+
+void AdventureWidget::flushPendingUpdates()
+{
+    m_flushTimer.stop();
+    if (m_pendingUpdates.isEmpty())
+        return;
+
     m_textCursor->movePosition(QTextCursor::End);
-    m_textCursor->insertText(msg);
+    m_textCursor->insertText(m_pendingUpdates.join(QString{}));
+    m_pendingUpdates.clear();
 
     // If more than MAX_LINES, preserve by deleting from the start
     auto lines_over = m_textEdit->document()->lineCount() - AdventureWidget::MAX_LINES;
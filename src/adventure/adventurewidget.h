@@ -41,13 +41,24 @@ private slots:
     void slot_contextMenuRequested(const QPoint &pos);
     void slot_actionClearContent(bool checked = false);
 
+protected:
+    void showEvent(QShowEvent *event) override;
+
 private:
     void addDefaultContent();
     void addAdventureUpdate(const QString &msg);
+    void flushPendingUpdates();
+
+    // A burst of kills (e.g. quake xp) becomes one insertion.
+    static constexpr const int FLUSH_DELAY_MS = 100;
 
     AdventureTracker &m_adventureTracker;
 
     QTextEdit *m_textEdit = nullptr;
     QTextCursor *m_textCursor = nullptr;
     QAction *m_clearContentAction = nullptr;
+
+    // Messages not yet in the text; they wait while the widget is hidden.
+    QStringList m_pendingUpdates;
+    QTimer m_flushTimer;
 };
@@ -7,12 +7,51 @@
 // required for warning -W non-virtual-dtor
 AbstractLineParser::~AbstractLineParser() {}
 
+LineTriggerEnum classifyLine(const QString &line)
+{
+    const auto startsWith = [&line](const char *const prefix, const LineTriggerEnum trigger) {
+        return line.startsWith(QLatin1String(prefix)) ? trigger : LineTriggerEnum::NONE;
+    };
+
+    if (line.isEmpty())
+        return LineTriggerEnum::NONE;
+    switch (line.at(0).unicode()) {
+    case '#':
+        return startsWith("# Hint:", LineTriggerEnum::HINT);
+    case 'W':
+        return startsWith("With the task complete, you feel more",
+                          LineTriggerEnum::ACCOMPLISHED_TASK);
+    case 'Y':
+        break;
+    default:
+        return LineTriggerEnum::NONE;
+    }
+
+    // Every other trigger starts with "You ", so the next letter tells them apart.
+    if (line.size() < 5 || !line.startsWith(QLatin1String("You ")))
+        return LineTriggerEnum::NONE;
+    switch (line.at(4).unicode()) {
+    case 'a':
+        if (line.size() > 5 && line.at(5) == QChar('c'))
+            return startsWith("You achieved something new!", LineTriggerEnum::ACHIEVEMENT);
+        return startsWith("You are dead! Sorry...", LineTriggerEnum::DIED);
+    case 'f':
+        return startsWith("You feel more experienced.", LineTriggerEnum::KILL);
+    case 'g':
+        return startsWith("You gain a level!", LineTriggerEnum::GAINED_LEVEL);
+    case 'r':
+        return startsWith("You receive your share of experience.", LineTriggerEnum::KILL);
+    default:
+        return LineTriggerEnum::NONE;
+    }
+}
+
 QString AbstractLineParser::getLastSuccessVal()
 {
     return m_lastSuccessVal;
 }
 
-bool AccomplishedTaskParser::parse(QString line)
+bool AccomplishedTaskParser::parse(const QString &line)
 {
     // REVISIT: there are at least three different versions of this
     //   accomplished
@@ -21,7 +60,7 @@ bool AccomplishedTaskParser::parse(QString line)
     return line.startsWith("With the task complete, you feel more");
 }
 
-bool AchievementParser::parse(QString line)
+bool AchievementParser::parse(const QString &line)
 {
     // An achievement event is:
     //   (1) A line matching exactly "You achieved something new!"
@@ -38,17 +77,17 @@ bool AchievementParser::parse(QString line)
     return false;
 }
 
-bool DiedParser::parse(QString line)
+bool DiedParser::parse(const QString &line)
 {
     return line.startsWith("You are dead! Sorry...");
 }
 
-bool GainedLevelParser::parse(QString line)
+bool GainedLevelParser::parse(const QString &line)
 {
     return line.startsWith("You gain a level!");
 }
 
-bool HintParser::parse(QString line)
+bool HintParser::parse(const QString &line)
 {
     // A hint event is:
     //   (1) A line matching exactly "# Hint:"
@@ -63,7 +102,7 @@ bool HintParser::parse(QString line)
     return false;
 }
 
-bool KillAndXPParser::parse(QString line)
+bool KillAndXPParser::parse(const QString &line)
 {
     // A kill and exp earned event as follows:
     // A line matching exactly either of:
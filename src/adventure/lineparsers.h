@@ -3,14 +3,34 @@
 // Copyright (C) 2023 The MMapper Authors
 // Author: Mike Repass <mike.repass@gmail.com> (Taryn)
 
+#include <cstdint>
 #include <QString>
 
+#include "../global/macros.h"
+
+// The event a line can start. Nearly every line starts none, and then the only
+// parsers that still need to see it are the ones waiting for a follow-up line.
+enum class NODISCARD LineTriggerEnum : uint8_t {
+    NONE,
+    ACCOMPLISHED_TASK,
+    ACHIEVEMENT,
+    DIED,
+    GAINED_LEVEL,
+    HINT,
+    KILL
+};
+
+// One check on the first character, and at most one prefix comparison.
+NODISCARD LineTriggerEnum classifyLine(const QString &line);
+
 class AbstractLineParser
 {
 public:
     virtual ~AbstractLineParser(); // required for warning -W non-virtual-dtor
-    virtual bool parse(QString line) = 0;
+    virtual bool parse(const QString &line) = 0;
     virtual QString getLastSuccessVal();
+    // Waiting for the line that completes an event.
+    NODISCARD bool isPending() const { return m_pending; }
 
 protected:
     bool m_pending = false;
@@ -20,37 +40,37 @@ class AbstractLineParser
 class AccomplishedTaskParser final : public AbstractLineParser
 {
 public:
-    bool parse(QString line) override;
+    bool parse(const QString &line) override;
 };
 
 class AchievementParser final : public AbstractLineParser
 {
 public:
-    bool parse(QString line) override;
+    bool parse(const QString &line) override;
 };
 
 class DiedParser final : public AbstractLineParser
 {
 public:
-    bool parse(QString line) override;
+    bool parse(const QString &line) override;
 };
 
 class GainedLevelParser final : public AbstractLineParser
 {
 public:
-    bool parse(QString line) override;
+    bool parse(const QString &line) override;
 };
 
 class HintParser final : public AbstractLineParser
 {
 public:
-    bool parse(QString line) override;
+    bool parse(const QString &line) override;
 };
 
 class KillAndXPParser final : public AbstractLineParser
 {
 public:
-    bool parse(QString line) override;
+    bool parse(const QString &line) override;
 
 private:
     int m_linesSinceShareExp = 0;
@@ -5,6 +5,7 @@
 #include "xpstatuswidget.h"
 
 #include "../configuration/configuration.h"
+#include "../global/utils.h"
 #include "adventuresession.h"
 #include "adventuretracker.h"
 
@@ -18,6 +19,12 @@ XPStatusWidget::XPStatusWidget(AdventureTracker &at, QStatusBar *const sb, QWidg
     setStyleSheet("QPushButton { border: none; outline: none; }");
     setMouseTracking(true);
 
+    m_updateTimer.setSingleShot(true);
+    m_updateTimer.setInterval(UPDATE_INTERVAL_MS);
+    connect(&m_updateTimer, &QTimer::timeout, this, &XPStatusWidget::updateContent);
+    if (m_statusBar != nullptr)
+        m_statusBar->installEventFilter(this);
+
     readConfig();
     updateContent();
 
@@ -37,21 +44,48 @@ void XPStatusWidget::readConfig()
     m_showPreference = getConfig().adventurePanel.getDisplayXPStatus();
 }
 
+void XPStatusWidget::scheduleUpdate()
+{
+    if (!m_updateTimer.isActive())
+        m_updateTimer.start();
+}
+
 void XPStatusWidget::updateContent()
 {
-    if (m_showPreference && m_session) {
-        auto xpSession = m_session->xp().gainedSession();
-        auto tpSession = m_session->tp().gainedSession();
-        auto xpf = AdventureSession::formatPoints(xpSession);
-        auto tpf = AdventureSession::formatPoints(tpSession);
-        auto msg = QString("%1 Session: %2 XP %3 TP").arg(m_session->name(), xpf, tpf);
-        setText(msg);
-        show();
-        repaint();
-    } else {
+    m_updateTimer.stop();
+    if (!m_showPreference || !m_session) {
+        m_pendingUpdate = false;
+        m_shownName.clear();
         setText("");
         hide();
+        return;
+    }
+
+    // Nobody would see it; the status bar's show event catches up.
+    if (m_statusBar != nullptr && !m_statusBar->isVisible()) {
+        m_pendingUpdate = true;
+        return;
     }
+    m_pendingUpdate = false;
+
+    const auto xpSession = m_session->xp().gainedSession();
+    const auto tpSession = m_session->tp().gainedSession();
+    if (!text().isEmpty() && m_shownName == m_session->name()
+        && utils::equals(m_shownXP, xpSession) && utils::equals(m_shownTP, tpSession)) {
+        show();
+        return;
+    }
+
+    m_shownName = m_session->name();
+    m_shownXP = xpSession;
+    m_shownTP = tpSession;
+    const auto xpf = AdventureSession::formatPoints(xpSession);
+    const auto tpf = AdventureSession::formatPoints(tpSession);
+    const auto msg = QString("%1 Session: %2 XP %3 TP").arg(m_shownName, xpf, tpf);
+    // Small changes often format the same.
+    if (msg != text())
+        setText(msg);
+    show();
 }
 
 void XPStatusWidget::slot_configChanged(const std::type_info &configGroup)
@@ -65,8 +99,13 @@ void XPStatusWidget::slot_configChanged(const std::type_info &configGroup)
 
 void XPStatusWidget::slot_updatedSession(const std::shared_ptr<AdventureSession> &session)
 {
+    // Showing or hiding the widget can't wait.
+    const bool hadSession = m_session != nullptr;
     m_session = session;
-    updateContent();
+    if (hadSession != (m_session != nullptr))
+        updateContent();
+    else
+        scheduleUpdate();
 }
 
 void XPStatusWidget::enterEvent(QEvent *event)
@@ -89,3 +128,10 @@ void XPStatusWidget::leaveEvent(QEvent *event)
 
     QWidget::leaveEvent(event);
 }
+
+bool XPStatusWidget::eventFilter(QObject *const obj, QEvent *const event)
+{
+    if (obj == m_statusBar && event->type() == QEvent::Show && m_pendingUpdate)
+        scheduleUpdate();
+    return QPushButton::eventFilter(obj, event);
+}
@@ -6,6 +6,7 @@
 #include <QLabel>
 #include <QPushButton>
 #include <QStatusBar>
+#include <QTimer>
 
 #include "adventure/adventuretracker.h"
 
@@ -24,14 +25,28 @@ public slots:
 protected:
     void enterEvent(QEvent *event) override;
     void leaveEvent(QEvent *event) override;
+    bool eventFilter(QObject *obj, QEvent *event) override;
 
 private:
     void readConfig();
+    void scheduleUpdate();
     void updateContent();
 
+    // Vitals can arrive several times a second; the text only needs to keep up
+    // with a person reading it.
+    static constexpr const int UPDATE_INTERVAL_MS = 500;
+
     bool m_showPreference = true;
+    // Set while an update waits for the status bar to be shown again.
+    bool m_pendingUpdate = false;
 
     QStatusBar *m_statusBar;
     AdventureTracker &m_tracker;
     std::shared_ptr<AdventureSession> m_session;
+    QTimer m_updateTimer;
+
+    // What the text was last built from.
+    QString m_shownName;
+    double m_shownXP = 0.0;
+    double m_shownTP = 0.0;
 };
@@ -160,9 +160,37 @@ void ClientWidget::slot_saveLog()
     document.close();
 }
 
+void ClientWidget::findInScrollback()
+{
+    bool ok = false;
+    const QString text = QInputDialog::getText(this,
+                                               tr("Find"),
+                                               tr("Find in scrollback:"),
+                                               QLineEdit::Normal,
+                                               ui->display->getFindText(),
+                                               &ok);
+    if (!ok)
+        return;
+    // Start again from the newest output.
+    ui->display->clearFind();
+    if (text.isEmpty())
+        return;
+    if (!ui->display->findText(text, true))
+        emit sig_relayMessage(QString("No matches for: %1").arg(text));
+}
+
 bool ClientWidget::eventFilter(QObject *const obj, QEvent *const event)
 {
-    if (event->type() == QEvent::KeyPress) {
+    if (event->type() == QEvent::ShortcutOverride) {
+        // Otherwise the main window's Find Rooms (Ctrl+F) takes the key first.
+        if (auto *const keyEvent = dynamic_cast<QKeyEvent *>(event)) {
+            if (keyEvent->matches(QKeySequence::Find) || keyEvent->matches(QKeySequence::FindNext)
+                || keyEvent->matches(QKeySequence::FindPrevious)) {
+                keyEvent->accept();
+                return true;
+            }
+        }
+    } else if (event->type() == QEvent::KeyPress) {
         if (auto *const keyEvent = dynamic_cast<QKeyEvent *>(event)) {
             if (keyEvent->matches(QKeySequence::Copy)) {
                 if (ui->display->canCopy())
@@ -179,6 +207,19 @@ bool ClientWidget::eventFilter(QObject *const obj, QEvent *const event)
                 ui->input->slot_paste();
                 keyEvent->accept();
                 return true;
+            } else if (keyEvent->matches(QKeySequence::Find)) {
+                findInScrollback();
+                keyEvent->accept();
+                return true;
+            } else if (keyEvent->matches(QKeySequence::FindNext)
+                       || keyEvent->matches(QKeySequence::FindPrevious)) {
+                // Next is newer, like scrolling down.
+                const bool older = keyEvent->matches(QKeySequence::FindPrevious);
+                const QString &text = ui->display->getFindText();
+                if (!text.isEmpty() && !ui->display->findText(text, older))
+                    emit sig_relayMessage(QString("No matches for: %1").arg(text));
+                keyEvent->accept();
+                return true;
             }
         }
     }
@@ -37,6 +37,10 @@ public slots:
     void slot_onShowMessage(const QString &);
     void slot_saveLog();
 
+private:
+    // Asks for text to find in the display; F3 and Shift+F3 then move between matches.
+    void findInScrollback();
+
 protected:
     bool eventFilter(QObject *obj, QEvent *event) override;
 
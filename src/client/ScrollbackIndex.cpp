@@ -0,0 +1,231 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "ScrollbackIndex.h"
+
+#include <algorithm>
+#include <cassert>
+
+static constexpr const int NGRAM = 3;
+
+NODISCARD static QString foldCase(const QString &s)
+{
+    QString result;
+    result.reserve(s.size());
+    for (const QChar c : s)
+        result.append(c.toCaseFolded());
+    return result;
+}
+
+// The distinct trigrams of already case-folded text, sorted.
+NODISCARD static std::vector<uint64_t> getTrigrams(const QString &folded)
+{
+    std::vector<uint64_t> result;
+    if (folded.size() < NGRAM)
+        return result;
+    result.reserve(static_cast<size_t>(folded.size() - NGRAM + 1));
+    for (int i = 0; i + NGRAM <= folded.size(); ++i) {
+        result.push_back((uint64_t{folded.at(i).unicode()} << 32u)
+                         | (uint64_t{folded.at(i + 1).unicode()} << 16u)
+                         | uint64_t{folded.at(i + 2).unicode()});
+    }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+void ScrollbackIndex::append(const QString &text)
+{
+    for (const QChar c : text) {
+        if (c == QChar('\n')) {
+            finishLine();
+        } else if (c == QChar('\r')) {
+            continue;
+        } else if (c == QChar('\b')) {
+            QString &line = m_lines.back();
+            if (!line.isEmpty())
+                line.chop(1);
+        } else {
+            m_lines.back().append(c);
+        }
+    }
+}
+
+void ScrollbackIndex::finishLine()
+{
+    const LineNumber line = getLastLine();
+    for (const uint64_t trigram : getTrigrams(foldCase(m_lines.back()))) {
+        m_postings[trigram].lines.push_back(line);
+        ++m_postingCount;
+    }
+    m_lines.back().squeeze();
+    m_lines.emplace_back();
+
+    while (m_maxLines != 0 && m_lines.size() > m_maxLines)
+        dropOldest();
+}
+
+void ScrollbackIndex::dropOldest()
+{
+    if (m_lines.size() <= 1)
+        return;
+
+    // The oldest line is the first live entry of each of its postings.
+    for (const uint64_t trigram : getTrigrams(foldCase(m_lines.front()))) {
+        const auto it = m_postings.find(trigram);
+        if (it == m_postings.end()) {
+            assert(false);
+            continue;
+        }
+        Postings &postings = it->second;
+        assert(postings.lines[postings.head] == m_firstLine);
+        ++postings.head;
+        --m_postingCount;
+        if (postings.head == postings.lines.size()) {
+            m_postings.erase(it);
+        } else if (postings.head * 2 > postings.lines.size()) {
+            const auto head = static_cast<std::ptrdiff_t>(postings.head);
+            postings.lines.erase(postings.lines.begin(), postings.lines.begin() + head);
+            postings.head = 0;
+        }
+    }
+    m_lines.pop_front();
+    ++m_firstLine;
+}
+
+void ScrollbackIndex::setMaxLines(const size_t maxLines)
+{
+    m_maxLines = maxLines;
+    while (m_maxLines != 0 && m_lines.size() > std::max<size_t>(m_maxLines, 1))
+        dropOldest();
+}
+
+void ScrollbackIndex::clear()
+{
+    m_firstLine = getLastLine() + 1;
+    m_lines = std::deque<QString>{QString{}};
+    m_postings.clear();
+    m_postingCount = 0;
+}
+
+const QString &ScrollbackIndex::getLine(const LineNumber line) const
+{
+    return m_lines.at(line - m_firstLine);
+}
+
+size_t ScrollbackIndex::getApproxBytes() const
+{
+    static constexpr const size_t NODE_OVERHEAD = 48;
+    size_t chars = 0;
+    for (const QString &line : m_lines)
+        chars += static_cast<size_t>(line.capacity());
+    return chars * sizeof(QChar) + m_lines.size() * sizeof(QString)
+           + m_postingCount * sizeof(LineNumber)
+           + m_postings.size() * (sizeof(Postings) + NODE_OVERHEAD);
+}
+
+std::vector<ScrollbackIndex::LineNumber> ScrollbackIndex::getCandidates(const QString &folded) const
+{
+    std::vector<LineNumber> result;
+    const LineNumber last = getLastLine();
+    const auto trigrams = getTrigrams(folded);
+    if (trigrams.empty()) {
+        result.reserve(m_lines.size());
+        for (LineNumber line = m_firstLine; line != last; ++line)
+            result.push_back(line);
+    } else {
+        // Every match has all of the trigrams, so the rarest one will do.
+        const Postings *rarest = nullptr;
+        for (const uint64_t trigram : trigrams) {
+            const auto it = m_postings.find(trigram);
+            if (it == m_postings.end()) {
+                rarest = nullptr;
+                break;
+            }
+            const Postings &postings = it->second;
+            if (rarest == nullptr
+                || postings.lines.size() - postings.head < rarest->lines.size() - rarest->head) {
+                rarest = &postings;
+            }
+        }
+        if (rarest != nullptr) {
+            const auto head = static_cast<std::ptrdiff_t>(rarest->head);
+            result.assign(rarest->lines.begin() + head, rarest->lines.end());
+        }
+    }
+    // The unfinished line isn't indexed yet.
+    result.push_back(last);
+    return result;
+}
+
+std::vector<ScrollbackIndex::Match> ScrollbackIndex::findAll(const QString &needle,
+                                                             const size_t limit) const
+{
+    std::vector<Match> result;
+    if (needle.isEmpty())
+        return result;
+
+    for (const LineNumber line : getCandidates(foldCase(needle))) {
+        const QString &text = getLine(line);
+        for (int col = text.indexOf(needle, 0, Qt::CaseInsensitive); col != -1;
+             col = text.indexOf(needle, col + 1, Qt::CaseInsensitive)) {
+            if (result.size() == limit)
+                return result;
+            result.push_back(Match{line, col});
+        }
+    }
+    return result;
+}
+
+std::optional<ScrollbackIndex::Match> ScrollbackIndex::findNext(const QString &needle,
+                                                                const std::optional<Match> &from,
+                                                                const bool backward) const
+{
+    if (needle.isEmpty())
+        return std::nullopt;
+
+    const std::vector<LineNumber> candidates = getCandidates(foldCase(needle));
+    const auto size = static_cast<std::ptrdiff_t>(candidates.size());
+    const auto first = [&](const std::ptrdiff_t i, const int start) -> std::optional<Match> {
+        const LineNumber line = candidates[static_cast<size_t>(i)];
+        const int col = getLine(line).indexOf(needle, start, Qt::CaseInsensitive);
+        return col == -1 ? std::nullopt : std::optional<Match>{Match{line, col}};
+    };
+    const auto lastBefore = [&](const std::ptrdiff_t i, const int end) -> std::optional<Match> {
+        const LineNumber line = candidates[static_cast<size_t>(i)];
+        // lastIndexOf(-1) searches from the end of the line.
+        const int col = getLine(line).lastIndexOf(needle, end, Qt::CaseInsensitive);
+        return col == -1 ? std::nullopt : std::optional<Match>{Match{line, col}};
+    };
+
+    // Where `from` is, or would be, among the candidates.
+    std::ptrdiff_t pos = backward ? size : 0;
+    bool onFromLine = false;
+    if (from) {
+        const auto it = std::lower_bound(candidates.begin(), candidates.end(), from->line);
+        pos = it - candidates.begin();
+        onFromLine = it != candidates.end() && *it == from->line;
+    }
+
+    if (!backward) {
+        if (onFromLine) {
+            if (auto match = first(pos, from->column + 1))
+                return match;
+            ++pos;
+        }
+        for (std::ptrdiff_t n = 0; n < size; ++n) {
+            if (auto match = first((pos + n) % size, 0))
+                return match;
+        }
+    } else {
+        if (onFromLine && from->column > 0) {
+            if (auto match = lastBefore(pos, from->column - 1))
+                return match;
+        }
+        for (std::ptrdiff_t n = 1; n <= size; ++n) {
+            if (auto match = lastBefore(((pos - n) % size + size) % size, -1))
+                return match;
+        }
+    }
+    return std::nullopt;
+}
@@ -0,0 +1,83 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include <QString>
+
+#include "../global/macros.h"
+
+/**
+ * The plain text of the client's scrollback, one entry per line, with an index
+ * of the (case-folded) trigrams each line contains so a search only has to
+ * look at the lines that can match.
+ *
+ * Lines are numbered from the start of the session; the oldest ones are
+ * dropped to stay within setMaxLines(), just like the display's document.
+ * The last line is the one still being written; it isn't indexed until it's
+ * finished, so it's always searched directly.
+ *
+ * Matches never span lines (neither does QTextDocument::find).
+ */
+class NODISCARD ScrollbackIndex final
+{
+public:
+    using LineNumber = uint32_t;
+
+    struct NODISCARD Match final
+    {
+        LineNumber line = 0;
+        int column = 0;
+    };
+
+private:
+    // Ascending line numbers; the ones before `head` belong to dropped lines.
+    struct NODISCARD Postings final
+    {
+        std::vector<LineNumber> lines;
+        size_t head = 0;
+    };
+
+    std::deque<QString> m_lines{QString{}};
+    LineNumber m_firstLine = 0;
+    size_t m_maxLines = 0;
+    std::unordered_map<uint64_t, Postings> m_postings;
+    size_t m_postingCount = 0;
+
+public:
+    // Text as inserted into the display; '\n' ends a line, and '\b' erases the
+    // character before it.
+    void append(const QString &text);
+    // Zero means unlimited; otherwise the total includes the unfinished line.
+    void setMaxLines(size_t maxLines);
+    void clear();
+
+public:
+    NODISCARD LineNumber getFirstLine() const { return m_firstLine; }
+    NODISCARD LineNumber getLastLine() const
+    {
+        return m_firstLine + static_cast<LineNumber>(m_lines.size() - 1);
+    }
+    NODISCARD const QString &getLine(LineNumber line) const;
+    NODISCARD size_t getApproxBytes() const;
+
+public:
+    // Case-insensitive; at most `limit` matches, oldest first.
+    NODISCARD std::vector<Match> findAll(const QString &needle, size_t limit) const;
+    // The first match after `from` (or before it, if backward), wrapping
+    // around; with no `from`, that's the oldest (or newest) match.
+    NODISCARD std::optional<Match> findNext(const QString &needle,
+                                            const std::optional<Match> &from,
+                                            bool backward) const;
+
+private:
+    void finishLine();
+    void dropOldest();
+    // Lines that may contain the needle, ascending (every line if it's too short to index).
+    NODISCARD std::vector<LineNumber> getCandidates(const QString &folded) const;
+};
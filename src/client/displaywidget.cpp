@@ -4,8 +4,8 @@
 
 #include "displaywidget.h"
 
+#include <algorithm>
 #include <QMessageLogContext>
-#include <QRegularExpression>
 #include <QScrollBar>
 #include <QString>
 #include <QTextCursor>
@@ -14,12 +14,23 @@
 
 #include "../configuration/configuration.h"
 #include "../global/AnsiColor.h"
+#include "../global/utils.h"
 
 static const constexpr int SCROLLBAR_BUFFER = 1;
 static const constexpr int TAB_WIDTH_SPACES = 8;
 
 DisplayWidget::DisplayWidget(QWidget *const parent)
     : QTextEdit(parent)
+    , m_memoryReport{[this](const memory_report::AddFn &add) {
+        // The text, plus a guess at each block's layout and bookkeeping.
+        static constexpr const size_t BLOCK_OVERHEAD = 128;
+        const QTextDocument &doc = deref(document());
+        const auto chars = static_cast<size_t>(std::max(doc.characterCount(), 0));
+        const auto blocks = static_cast<size_t>(std::max(doc.blockCount(), 0));
+        add("client: scrollback",
+            MemoryUsage{chars * sizeof(QChar) + blocks * BLOCK_OVERHEAD, blocks});
+        add("client: scrollback index", MemoryUsage{m_scrollback.getApproxBytes(), 1});
+    }}
 {
     const auto &settings = getConfig().integratedClient;
 
@@ -48,6 +59,7 @@ DisplayWidget::DisplayWidget(QWidget *const parent)
     m_format = m_cursor.charFormat();
     setDefaultFormat(m_format);
     m_cursor.setCharFormat(m_format);
+    resetFormatCache();
 
     // Add an extra character for the scrollbars
     QFontMetrics fm(m_serverOutputFont);
@@ -120,73 +132,204 @@ void DisplayWidget::setDefaultFormat(QTextCharFormat &format)
 
 void DisplayWidget::slot_displayText(const QString &str)
 {
-    // Split ansi from this text
-    QStringList textList, ansiList;
-    int textIndex = 0, ansiIndex = 0;
     // ANSI codes are formatted as the following:
     // escape + [ + n1 (+ n2) + m
-    static const QRegularExpression ansiRx(R"(\x1b\[((?:\d+;?)*)m)");
-    QRegularExpressionMatchIterator it = ansiRx.globalMatch(str);
-    while (it.hasNext()) {
-        QRegularExpressionMatch match = it.next();
-        ansiIndex = match.capturedStart(0);
-        textList << str.mid(textIndex, ansiIndex - textIndex);
-        ansiList << match.captured(1);
-        textIndex = match.capturedEnd(0);
-    }
-    if (textIndex < str.length()) {
-        textList << str.mid(textIndex);
-    }
+    static constexpr const int MAX_ANSI_CODE = 9999;
+    static constexpr const int MAX_ANSI_SEQUENCE = 64;
 
-    // Display text using a cursor
-    QStringListIterator textIterator(textList), ansiIterator(ansiList);
-    while (textIterator.hasNext()) {
-        QString textStr = textIterator.next();
-
-        if (textStr.length() != 0) {
-            // Backspaces occur on the next character being drawn
-            if (m_backspace) {
-                m_cursor.movePosition(QTextCursor::PreviousCharacter, QTextCursor::KeepAnchor, 1);
-                m_backspace = false;
+    // One layout pass for the whole call instead of one per text run.
+    m_cursor.beginEditBlock();
+    for (const QChar c : str) {
+        switch (m_ansiState) {
+        case AnsiStateEnum::TEXT:
+            if (c == QChar('\x1b')) {
+                flushTextRun();
+                m_ansiSequence = c;
+                m_ansiState = AnsiStateEnum::ESCAPE;
+            } else {
+                m_textRun.append(c);
             }
-            int backspaceIndex = textStr.indexOf('\10');
-            if (backspaceIndex == -1) {
-                // No backspace
-                m_cursor.insertText(textStr, m_format);
+            continue;
 
-            } else {
-                m_backspace = true;
-                m_cursor.insertText(textStr.mid(0, backspaceIndex), m_format);
-                m_cursor.insertText(textStr.mid(backspaceIndex + 1), m_format);
+        case AnsiStateEnum::ESCAPE:
+            m_ansiSequence.append(c);
+            if (c == QChar('[')) {
+                m_ansiCodes.clear();
+                m_ansiCode = 0;
+                m_ansiState = AnsiStateEnum::CSI;
+                continue;
             }
-        }
+            break;
 
-        // Change format according to ansi codes
-        if (ansiIterator.hasNext()) {
-            // split several semicoloned ansi codes into individual codes
-            QStringList subAnsi = ansiIterator.next().split(';');
-            QStringListIterator ansiCodeIterator(subAnsi);
-            while (ansiCodeIterator.hasNext()) {
-                int ansiCode = ansiCodeIterator.next().toInt();
-                updateFormat(m_format, ansiCode);
+        case AnsiStateEnum::CSI:
+            m_ansiSequence.append(c);
+            if (c.isDigit() && m_ansiSequence.size() < MAX_ANSI_SEQUENCE) {
+                m_ansiCode = std::min(m_ansiCode * 10 + c.digitValue(), MAX_ANSI_CODE);
+                continue;
+            } else if (c == QChar(';')) {
+                m_ansiCodes.push_back(m_ansiCode);
+                m_ansiCode = 0;
+                continue;
+            } else if (c == QChar('m')) {
+                // Change format according to ansi codes
+                m_ansiCodes.push_back(m_ansiCode);
+                applyAnsiCodes();
+                m_ansiSequence.clear();
+                m_ansiState = AnsiStateEnum::TEXT;
+                continue;
             }
+            break;
         }
+
+        // Not a sequence we understand, so it's displayed as it arrived.
+        m_textRun.append(m_ansiSequence);
+        m_ansiSequence.clear();
+        m_ansiState = AnsiStateEnum::TEXT;
     }
+    flushTextRun();
+    m_cursor.endEditBlock();
 
-    // Ensure we limit the scrollback history
+    // Ensure we limit the scrollback history; the document drops its oldest lines itself.
     const int lineLimit = getConfig().integratedClient.linesOfScrollback;
-    const int lineCount = document()->lineCount();
-    if (lineCount > lineLimit) {
-        const int trimLines = lineCount - lineLimit;
-        m_cursor.movePosition(QTextCursor::Start);
-        m_cursor.movePosition(QTextCursor::Down, QTextCursor::KeepAnchor, trimLines);
-        m_cursor.removeSelectedText();
+    if (document()->maximumBlockCount() != lineLimit) {
+        document()->setMaximumBlockCount(lineLimit);
+        m_scrollback.setMaxLines(static_cast<size_t>(std::max(lineLimit, 0)));
         m_cursor.movePosition(QTextCursor::End);
     }
 
     verticalScrollBar()->setSliderPosition(verticalScrollBar()->maximum());
 }
 
+void DisplayWidget::flushTextRun()
+{
+    if (m_textRun.isEmpty())
+        return;
+    insertText(m_textRun);
+    m_textRun.clear();
+}
+
+void DisplayWidget::insertText(const QString &textStr)
+{
+    m_scrollback.append(textStr);
+
+    // Backspaces occur on the next character being drawn
+    if (m_backspace) {
+        m_cursor.movePosition(QTextCursor::PreviousCharacter, QTextCursor::KeepAnchor, 1);
+        m_backspace = false;
+    }
+    int backspaceIndex = textStr.indexOf('\10');
+    if (backspaceIndex == -1) {
+        // No backspace
+        m_cursor.insertText(textStr, m_format);
+
+    } else {
+        m_backspace = true;
+        m_cursor.insertText(textStr.mid(0, backspaceIndex), m_format);
+        m_cursor.insertText(textStr.mid(backspaceIndex + 1), m_format);
+    }
+}
+
+std::optional<QTextCursor> DisplayWidget::getMatchCursor(const ScrollbackIndex::Match &match) const
+{
+    // The index and the document both end with the line being written.
+    const QTextDocument &doc = deref(document());
+    const auto fromEnd = static_cast<int>(m_scrollback.getLastLine() - match.line);
+    const QTextBlock block = doc.findBlockByNumber(doc.blockCount() - 1 - fromEnd);
+    const int length = m_findText.size();
+    if (!block.isValid()
+        || block.text().midRef(match.column, length).compare(m_findText, Qt::CaseInsensitive) != 0)
+        return std::nullopt;
+
+    QTextCursor cursor{block};
+    cursor.setPosition(block.position() + match.column);
+    cursor.setPosition(block.position() + match.column + length, QTextCursor::KeepAnchor);
+    return cursor;
+}
+
+bool DisplayWidget::findText(const QString &text, const bool backward)
+{
+    static constexpr const size_t MAX_HIGHLIGHTS = 1000;
+
+    if (text != m_findText) {
+        m_findText = text;
+        m_findMatch.reset();
+    }
+    if (m_findMatch && m_findMatch->line < m_scrollback.getFirstLine())
+        m_findMatch.reset();
+
+    QList<QTextEdit::ExtraSelection> selections;
+    QTextCharFormat highlight;
+    highlight.setBackground(QColor(Qt::yellow));
+    highlight.setForeground(QColor(Qt::black));
+    for (const auto &match : m_scrollback.findAll(text, MAX_HIGHLIGHTS)) {
+        if (auto cursor = getMatchCursor(match))
+            selections.append(QTextEdit::ExtraSelection{*cursor, highlight});
+    }
+    setExtraSelections(selections);
+
+    m_findMatch = m_scrollback.findNext(text, m_findMatch, backward);
+    if (!m_findMatch)
+        return false;
+    if (auto cursor = getMatchCursor(*m_findMatch)) {
+        setTextCursor(*cursor);
+        ensureCursorVisible();
+    }
+    return true;
+}
+
+void DisplayWidget::clearFind()
+{
+    m_findText.clear();
+    m_findMatch.reset();
+    setExtraSelections({});
+}
+
+void DisplayWidget::resetFormatCache()
+{
+    m_formatTransitions.clear();
+    m_formatStates.clear();
+    // State 0 stands for "any", for sequences that start with a reset.
+    m_formatStates.emplace_back();
+    m_formatStates.emplace_back(FormatState{m_format, m_ansi256Foreground, m_ansi256Background});
+    m_formatState = 1;
+}
+
+void DisplayWidget::applyAnsiCodes()
+{
+    // Plenty for the colour schemes MUME uses; past that, start over.
+    static constexpr const size_t MAX_FORMAT_STATES = 256;
+    static_assert(MAX_FORMAT_STATES <= UINT16_MAX);
+
+    // The codes are at most MAX_ANSI_CODE, so each fits in a QChar.
+    const bool resets = m_ansiCodes.front() == 0;
+    QString key;
+    key.reserve(static_cast<int>(m_ansiCodes.size()) + 1);
+    key.append(QChar(resets ? uint16_t{0} : m_formatState));
+    for (const int ansiCode : m_ansiCodes)
+        key.append(QChar(static_cast<ushort>(ansiCode)));
+
+    if (const auto it = m_formatTransitions.find(key); it != m_formatTransitions.end()) {
+        const FormatState &state = m_formatStates[it->second];
+        m_format = state.format;
+        m_ansi256Foreground = state.ansi256Foreground;
+        m_ansi256Background = state.ansi256Background;
+        m_formatState = it->second;
+        return;
+    }
+
+    for (const int ansiCode : m_ansiCodes) {
+        updateFormat(m_format, ansiCode);
+    }
+
+    if (m_formatStates.size() >= MAX_FORMAT_STATES) {
+        resetFormatCache();
+        return;
+    }
+    m_formatState = static_cast<uint16_t>(m_formatStates.size());
+    m_formatStates.emplace_back(FormatState{m_format, m_ansi256Foreground, m_ansi256Background});
+    m_formatTransitions.emplace(std::move(key), m_formatState);
+}
+
 void DisplayWidget::updateFormat(QTextCharFormat &format, int ansiCode)
 {
     if (m_ansi256Foreground) {
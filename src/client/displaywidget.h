@@ -3,6 +3,10 @@
 // Copyright (C) 2019 The MMapper Authors
 // Author: Nils Schimmelmann <nschimme@gmail.com> (Jahara)
 
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
 #include <QColor>
 #include <QFont>
 #include <QSize>
@@ -13,7 +17,9 @@
 #include <QtCore>
 #include <QtGui>
 
+#include "../global/MemoryReport.h"
 #include "../global/macros.h"
+#include "ScrollbackIndex.h"
 
 class QObject;
 class QResizeEvent;
@@ -35,6 +41,12 @@ class DisplayWidget final : public QTextEdit
     NODISCARD bool canCopy() const { return m_canCopy; }
     NODISCARD QSize sizeHint() const override;
 
+    // Selects the next (or previous) match in the scrollback and highlights
+    // the rest; returns false if there are none.
+    bool findText(const QString &text, bool backward);
+    void clearFind();
+    NODISCARD const QString &getFindText() const { return m_findText; }
+
 private:
     bool m_canCopy = false;
 
@@ -51,14 +63,50 @@ public slots:
     QColor m_foregroundColor;
     QColor m_backgroundColor;
     QFont m_serverOutputFont;
-    // TODO: Create state machine
     bool m_ansi256Foreground = false;
     bool m_ansi256Background = false;
     bool m_backspace = false;
 
+    // ANSI is parsed a character at a time, so an escape sequence split across two
+    // calls still applies; text runs between sequences are inserted whole.
+    enum class NODISCARD AnsiStateEnum { TEXT, ESCAPE, CSI };
+    AnsiStateEnum m_ansiState = AnsiStateEnum::TEXT;
+    // Raw sequence so far, shown as text if it turns out not to be SGR.
+    QString m_ansiSequence;
+    std::vector<int> m_ansiCodes;
+    int m_ansiCode = 0;
+    // The formats reached through SGR sequences so far, and where each
+    // sequence leads from each of them, so repeated colour codes are only
+    // interpreted once; see applyAnsiCodes().
+    struct NODISCARD FormatState final
+    {
+        QTextCharFormat format;
+        bool ansi256Foreground = false;
+        bool ansi256Background = false;
+    };
+    struct NODISCARD QStringHash final
+    {
+        NODISCARD size_t operator()(const QString &qs) const { return qHash(qs); }
+    };
+    std::vector<FormatState> m_formatStates;
+    std::unordered_map<QString, uint16_t, QStringHash> m_formatTransitions;
+    uint16_t m_formatState = 0;
+    QString m_textRun;
+    // What the document shows, as text, for searching.
+    ScrollbackIndex m_scrollback;
+    QString m_findText;
+    std::optional<ScrollbackIndex::Match> m_findMatch;
+    memory_report::Registration m_memoryReport;
+
+    void flushTextRun();
+    void insertText(const QString &text);
     void setDefaultFormat(QTextCharFormat &format);
+    // Must be called whenever the default format or the palette changes.
+    void resetFormatCache();
+    void applyAnsiCodes();
     void updateFormat(QTextCharFormat &format, int ansiCode);
     void updateFormatBoldColor(QTextCharFormat &format);
+    NODISCARD std::optional<QTextCursor> getMatchCursor(const ScrollbackIndex::Match &match) const;
 
 signals:
     void sig_showMessage(const QString &, int);
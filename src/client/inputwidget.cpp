@@ -4,6 +4,7 @@
 
 #include "inputwidget.h"
 
+#include <algorithm>
 #include <QLinkedList>
 #include <QMessageLogContext>
 #include <QRegularExpression>
@@ -52,6 +53,9 @@ void InputWidget::keyPressEvent(QKeyEvent *const event)
     if (currentKey != Qt::Key_Tab) {
         m_tabbing = false;
     }
+    if (currentKey != Qt::Key_R || currentModifiers != Qt::ControlModifier) {
+        m_searching = false;
+    }
 
     // REVISIT: if (useConsoleEscapeKeys) ...
     if (currentModifiers == Qt::ControlModifier) {
@@ -62,6 +66,10 @@ void InputWidget::keyPressEvent(QKeyEvent *const event)
         case Qt::Key_U: // ^U = delete line (clear the input)
             base::clear();
             return;
+        case Qt::Key_R: // ^R = search the input history backward
+            searchHistory();
+            event->accept();
+            return;
         case Qt::Key_W: // ^W = delete word
             // REVISIT: can this be translated to ctrl+shift+leftarrow + backspace?
             break;
@@ -216,8 +224,38 @@ void InputHistory::addInputLine(const QString &string)
         pop_back();
     }
 
-    // Reset the iterator
+    // Reset the iterators
     m_iterator = begin();
+    m_searchIterator = begin();
+}
+
+const QString *InputHistory::searchBackward(const QString &text)
+{
+    for (; m_searchIterator != end(); ++m_searchIterator) {
+        if (m_searchIterator->contains(text)) {
+            return &*m_searchIterator++;
+        }
+    }
+    return nullptr;
+}
+
+void TabHistory::addWord(const QString &word)
+{
+    if (const auto it = m_words.find(word); it != m_words.end()) {
+        m_byAge.erase(it->second);
+        it->second = ++m_clock;
+    } else {
+        m_words.emplace(word, ++m_clock);
+    }
+    m_byAge.emplace(m_clock, word);
+
+    // Trim dictionary
+    const auto limit = std::max(0, getConfig().integratedClient.tabCompletionDictionarySize);
+    while (m_words.size() > static_cast<size_t>(limit)) {
+        const auto oldest = m_byAge.begin();
+        m_words.erase(oldest->second);
+        m_byAge.erase(oldest);
+    }
 }
 
 void TabHistory::addInputLine(const QString &string)
@@ -226,18 +264,33 @@ void TabHistory::addInputLine(const QString &string)
     for (const QString &word : list) {
         if (word.length() > MIN_WORD_LENGTH) {
             // Adding this word to the dictionary
-            push_back(word);
-
-            // Trim dictionary
-            if (static_cast<int>(size())
-                > getConfig().integratedClient.tabCompletionDictionarySize) {
-                pop_front();
-            }
+            addWord(word);
         }
     }
 
     // Reset the iterator
-    m_iterator = begin();
+    m_matches.clear();
+    m_next = 0;
+}
+
+void TabHistory::beginCompletion(const QString &fragment)
+{
+    // The words starting with the fragment are adjacent in the index.
+    m_matches.clear();
+    m_next = 0;
+    std::vector<std::pair<uint64_t, const QString *>> found;
+    for (auto it = m_words.lower_bound(fragment);
+         it != m_words.end() && it->first.startsWith(fragment);
+         ++it) {
+        found.emplace_back(it->second, &it->first);
+    }
+    std::sort(found.begin(), found.end(), [](const auto &a, const auto &b) {
+        return a.first > b.first;
+    });
+    m_matches.reserve(found.size());
+    for (const auto &match : found) {
+        m_matches.emplace_back(*match.second);
+    }
 }
 
 void InputWidget::forwardHistory()
@@ -270,6 +323,25 @@ void InputWidget::backwardHistory()
         m_inputHistory.forward();
 }
 
+void InputWidget::searchHistory()
+{
+    if (!m_searching) {
+        m_searchText = toPlainText();
+        m_inputHistory.resetSearch();
+        m_searching = true;
+    }
+    if (m_searchText.isEmpty())
+        return;
+
+    if (const QString *const found = m_inputHistory.searchBackward(m_searchText)) {
+        clear();
+        insertPlainText(*found);
+        emit sig_showMessage("History search: " + m_searchText, 1000);
+    } else {
+        emit sig_showMessage("No older input contains: " + m_searchText, 1000);
+    }
+}
+
 void InputWidget::tabComplete()
 {
     if (m_tabHistory.empty())
@@ -279,7 +351,7 @@ void InputWidget::tabComplete()
     current.select(QTextCursor::WordUnderCursor);
     if (!m_tabbing) {
         m_tabFragment = current.selectedText();
-        m_tabHistory.reset();
+        m_tabHistory.beginCompletion(m_tabFragment);
         m_tabbing = true;
     }
 
@@ -290,23 +362,12 @@ void InputWidget::tabComplete()
         return;
     }
 
-    // Iterate through all previous words
-    while (!m_tabHistory.atEnd()) {
-        // TODO(nschimme): Utilize a trie and search?
-        const auto &word = m_tabHistory.value();
-        if (!word.startsWith(m_tabFragment)) {
-            // Try the next word
-            m_tabHistory.forward();
-            continue;
-        }
-
-        // Found a previous word to complete to
-        current.insertText(word);
-        if (current.movePosition(QTextCursor::StartOfWord, QTextCursor::KeepAnchor)) {
-            current.movePosition(QTextCursor::Right, QTextCursor::KeepAnchor, m_tabFragment.size());
-            setTextCursor(current);
-        }
-        m_tabHistory.forward();
-        break;
+    // Every match starts with the fragment
+    const auto &word = m_tabHistory.value();
+    current.insertText(word);
+    if (current.movePosition(QTextCursor::StartOfWord, QTextCursor::KeepAnchor)) {
+        current.movePosition(QTextCursor::Right, QTextCursor::KeepAnchor, m_tabFragment.size());
+        setTextCursor(current);
     }
+    m_tabHistory.forward();
 }
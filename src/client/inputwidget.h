@@ -3,8 +3,12 @@
 // Copyright (C) 2019 The MMapper Authors
 // Author: Nils Schimmelmann <nschimme@gmail.com> (Jahara)
 
+#include <cstddef>
+#include <cstdint>
 #include <iterator>
 #include <list>
+#include <map>
+#include <vector>
 #include <QEvent>
 #include <QObject>
 #include <QPlainTextEdit>
@@ -22,7 +26,10 @@ class QWidget;
 class NODISCARD InputHistory final : private std::list<QString>
 {
 public:
-    InputHistory() { m_iterator = begin(); }
+    InputHistory()
+        : m_iterator{begin()}
+        , m_searchIterator{begin()}
+    {}
 
 public:
     void addInputLine(const QString &);
@@ -38,33 +45,51 @@ class NODISCARD InputHistory final : private std::list<QString>
     NODISCARD bool atFront() const { return m_iterator == begin(); }
     NODISCARD bool atEnd() const { return m_iterator == end(); }
 
+public:
+    // Reverse incremental search: each call finds the next older line that
+    // contains the text, picking up after the previous match; nullptr once
+    // there are no more.
+    NODISCARD const QString *searchBackward(const QString &text);
+    void resetSearch() { m_searchIterator = begin(); }
+
 private:
     std::list<QString>::iterator m_iterator;
+    std::list<QString>::iterator m_searchIterator;
 };
 
-class NODISCARD TabHistory final : private std::list<QString>
+// Words typed before, for tab completion. They're indexed by their text, so
+// finding the ones that start with a fragment doesn't walk the whole
+// dictionary, and the most recently typed ones are offered first.
+class NODISCARD TabHistory final
 {
-    using base = std::list<QString>;
-
-public:
-    TabHistory() { m_iterator = begin(); }
+private:
+    // When each word was last typed.
+    std::map<QString, uint64_t> m_words;
+    // The other way around, so the oldest word can be dropped.
+    std::map<uint64_t, QString> m_byAge;
+    uint64_t m_clock = 0;
+    // The words that complete the current fragment, most recent first.
+    std::vector<QString> m_matches;
+    size_t m_next = 0;
 
 public:
     void addInputLine(const QString &);
+    // Starts completing fragment.
+    void beginCompletion(const QString &fragment);
 
 public:
-    void forward() { std::advance(m_iterator, 1); }
-    void reset() { m_iterator = begin(); }
+    void forward() { ++m_next; }
+    void reset() { m_next = 0; }
 
 public:
-    NODISCARD const QString &value() const { return *m_iterator; }
+    NODISCARD const QString &value() const { return m_matches.at(m_next); }
 
 public:
-    NODISCARD bool empty() { return base::empty(); }
-    NODISCARD bool atEnd() const { return m_iterator == end(); }
+    NODISCARD bool empty() const { return m_words.empty(); }
+    NODISCARD bool atEnd() const { return m_next >= m_matches.size(); }
 
 private:
-    std::list<QString>::iterator m_iterator;
+    void addWord(const QString &word);
 };
 
 class InputWidget final : public QPlainTextEdit
@@ -98,7 +123,10 @@ class InputWidget final : public QPlainTextEdit
 private:
     void forwardHistory();
     void backwardHistory();
+    void searchHistory();
     InputHistory m_inputHistory;
+    bool m_searching = false;
+    QString m_searchText;
 
 private:
     void sendUserInput(const QString &msg) { emit sig_sendUserInput(msg); }
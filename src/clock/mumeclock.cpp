@@ -5,6 +5,7 @@
 #include "mumeclock.h"
 
 #include <cassert>
+#include <vector>
 #include <QDebug>
 #include <QMetaEnum>
 #include <QObject>
@@ -42,6 +43,79 @@ const QMetaEnum MumeClock::s_westronWeekDayNames
 const QMetaEnum MumeClock::s_sindarinWeekDayNames
     = QMetaEnum::fromType<MumeClock::SindarinWeekDayNamesEnum>();
 
+namespace { // anonymous
+// The names are looked up on every clock update, so they're only built once.
+struct NODISCARD NameTables final
+{
+    std::vector<QString> westronMonths;
+    std::vector<QString> sindarinMonths;
+    std::vector<QString> westronWeekDays;
+    std::vector<QString> sindarinWeekDays;
+};
+
+NODISCARD std::vector<QString> getNames(const QMetaEnum &metaEnum)
+{
+    // skips the unknown value, which is -1
+    std::vector<QString> names;
+    for (int value = 0; metaEnum.valueToKey(value) != nullptr; ++value) {
+        names.emplace_back(QString::fromLatin1(metaEnum.valueToKey(value)));
+    }
+    return names;
+}
+
+NODISCARD const NameTables &getNameTables()
+{
+    static const NameTables tables{getNames(MumeClock::s_westronMonthNames),
+                                   getNames(MumeClock::s_sindarinMonthNames),
+                                   getNames(MumeClock::s_westronWeekDayNames),
+                                   getNames(MumeClock::s_sindarinWeekDayNames)};
+    return tables;
+}
+
+NODISCARD int indexOf(const std::vector<QString> &names, const QStringView name)
+{
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (name.compare(names[i]) == 0) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+NODISCARD const QString &nameAt(const std::vector<QString> &names, const int index)
+{
+    static const QString unknown;
+    return (index >= 0 && static_cast<size_t>(index) < names.size())
+               ? names[static_cast<size_t>(index)]
+               : unknown;
+}
+
+// Westron, or else Sindarin; -1 if neither.
+NODISCARD int toMonth(const QStringView name)
+{
+    const NameTables &tables = getNameTables();
+    const int month = indexOf(tables.westronMonths, name);
+    return month >= 0 ? month : indexOf(tables.sindarinMonths, name);
+}
+
+NODISCARD int toWeekDay(const QStringView name)
+{
+    const NameTables &tables = getNameTables();
+    const int weekDay = indexOf(tables.westronWeekDays, name);
+    return weekDay >= 0 ? weekDay : indexOf(tables.sindarinWeekDays, name);
+}
+
+// The regular expressions only capture digits here.
+NODISCARD int toNumber(const QStringView digits)
+{
+    int result = 0;
+    for (const QChar c : digits) {
+        result = result * 10 + (c.unicode() - '0');
+    }
+    return result;
+}
+} // namespace
+
 MumeClock::MumeClock(int64_t mumeEpoch, GameObserver &observer, QObject *const parent)
     : QObject(parent)
     , m_mumeStartEpoch(mumeEpoch)
@@ -59,7 +133,7 @@ MumeClock::MumeClock(GameObserver &observer)
 MumeMoment MumeClock::getMumeMoment() const
 {
     const int64_t t = QDateTime::currentDateTimeUtc().toSecsSinceEpoch();
-    return MumeMoment::sinceMumeEpoch(t - m_mumeStartEpoch);
+    return getCachedMoment(t - m_mumeStartEpoch);
 }
 
 MumeMoment MumeClock::getMumeMoment(const int64_t secsSinceUnixEpoch) const
@@ -69,7 +143,21 @@ MumeMoment MumeClock::getMumeMoment(const int64_t secsSinceUnixEpoch) const
         assert(secsSinceUnixEpoch == -1);
         return getMumeMoment();
     }
-    return MumeMoment::sinceMumeEpoch(secsSinceUnixEpoch - m_mumeStartEpoch);
+    return getCachedMoment(secsSinceUnixEpoch - m_mumeStartEpoch);
+}
+
+MumeMoment MumeClock::getCachedMoment(const int64_t secsSinceMumeStartEpoch) const
+{
+    if (secsSinceMumeStartEpoch == m_cachedSecs) {
+        return m_cachedMoment;
+    }
+    if (m_cachedSecs > 0 && secsSinceMumeStartEpoch == m_cachedSecs + 1) {
+        m_cachedMoment.addMinute();
+    } else {
+        m_cachedMoment = MumeMoment::sinceMumeEpoch(secsSinceMumeStartEpoch);
+    }
+    m_cachedSecs = secsSinceMumeStartEpoch;
+    return m_cachedMoment;
 }
 
 void MumeClock::parseMumeTime(const QString &mumeTime)
@@ -95,8 +183,8 @@ void MumeClock::parseMumeTime(const QString &mumeTime, const int64_t secsSinceEp
         auto match = rx.match(mumeTime);
         if (!match.hasMatch())
             return;
-        hour = match.captured(1).toInt();
-        if (match.captured(2).at(0) == 'p') {
+        hour = toNumber(match.capturedView(1));
+        if (match.capturedView(2).at(0) == 'p') {
             // pm
             if (hour != 12) {
                 // add 12 if not noon
@@ -106,16 +194,10 @@ void MumeClock::parseMumeTime(const QString &mumeTime, const int64_t secsSinceEp
             // midnight
             hour = 0;
         }
-        weekDay = s_westronWeekDayNames.keyToValue(match.captured(3).toLatin1().data());
-        if (weekDay == static_cast<int>(WestronWeekDayNamesEnum::UnknownWestronWeekDay)) {
-            weekDay = s_sindarinWeekDayNames.keysToValue(match.captured(3).toLatin1().data());
-        }
-        day = match.captured(4).toInt() - 1;
-        month = s_westronMonthNames.keyToValue(match.captured(5).toLatin1().data());
-        if (month == static_cast<int>(WestronMonthNamesEnum::UnknownWestronMonth)) {
-            month = s_sindarinMonthNames.keyToValue(match.captured(5).toLatin1().data());
-        }
-        year = match.captured(6).toInt();
+        weekDay = toWeekDay(match.capturedView(3));
+        day = toNumber(match.capturedView(4)) - 1;
+        month = toMonth(match.capturedView(5));
+        year = toNumber(match.capturedView(6));
         if (m_precision <= MumeClockPrecisionEnum::DAY) {
             m_precision = MumeClockPrecisionEnum::HOUR;
         }
@@ -127,16 +209,10 @@ void MumeClock::parseMumeTime(const QString &mumeTime, const int64_t secsSinceEp
         auto match = rx.match(mumeTime);
         if (!match.hasMatch())
             return;
-        weekDay = s_westronWeekDayNames.keyToValue(match.captured(1).toLatin1().data());
-        if (weekDay == static_cast<int>(WestronWeekDayNamesEnum::UnknownWestronWeekDay)) {
-            weekDay = s_sindarinWeekDayNames.keysToValue(match.captured(1).toLatin1().data());
-        }
-        day = match.captured(2).toInt() - 1;
-        month = s_westronMonthNames.keyToValue(match.captured(3).toLatin1().data());
-        if (month == static_cast<int>(WestronMonthNamesEnum::UnknownWestronMonth)) {
-            month = s_sindarinMonthNames.keyToValue(match.captured(3).toLatin1().data());
-        }
-        year = match.captured(4).toInt();
+        weekDay = toWeekDay(match.capturedView(1));
+        day = toNumber(match.capturedView(2)) - 1;
+        month = toMonth(match.capturedView(3));
+        year = toNumber(match.capturedView(4));
         if (m_precision <= MumeClockPrecisionEnum::UNSET) {
             m_precision = MumeClockPrecisionEnum::DAY;
         }
@@ -268,9 +344,9 @@ void MumeClock::parseClockTime(const QString &clockTime, const int64_t secsSince
     if (!match.hasMatch())
         return;
 
-    int hour = match.captured(1).toInt();
-    int minute = match.captured(2).toInt();
-    if (match.captured(3).at(0) == 'p') {
+    int hour = toNumber(match.capturedView(1));
+    int minute = toNumber(match.capturedView(2));
+    if (match.capturedView(3).at(0) == 'p') {
         // pm
         if (hour != 12) {
             // add 12 if not noon
@@ -346,7 +422,8 @@ QString MumeClock::toMumeTime(const MumeMoment &moment) const
         period = "am";
     }
 
-    QString weekDay = MumeClock::s_westronWeekDayNames.valueToKey(moment.weekDay());
+    const NameTables &tables = getNameTables();
+    const QString &weekDay = nameAt(tables.westronWeekDays, moment.weekDay());
     QString time;
     switch (m_precision) {
     case MumeClockPrecisionEnum::HOUR:
@@ -368,7 +445,7 @@ QString MumeClock::toMumeTime(const MumeMoment &moment) const
 
     const int day = moment.day + 1;
     // TODO: Detect what calendar the player is using
-    QString monthName = MumeClock::s_westronMonthNames.valueToKey(moment.month);
+    const QString &monthName = nameAt(tables.westronMonths, moment.month);
     return QString("%1, the %2%3 of %4, year %5 of the Third Age.")
         .arg(time)
         .arg(day)
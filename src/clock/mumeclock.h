@@ -148,10 +148,18 @@ public slots:
 
     void parseWeather(const MumeTimeEnum time, int64_t secsSinceEpoch);
 
+private:
+    NODISCARD MumeMoment getCachedMoment(int64_t secsSinceMumeStartEpoch) const;
+
 private:
     int64_t m_lastSyncEpoch = 0;
     int64_t m_mumeStartEpoch = 0;
     MumeClockPrecisionEnum m_precision = MumeClockPrecisionEnum::UNSET;
     int m_clockTolerance = 0;
     GameObserver &m_observer;
+
+    // The last moment asked for; the clock is usually polled once per MUME minute,
+    // so the next one is only a minute later.
+    mutable int64_t m_cachedSecs = -1;
+    mutable MumeMoment m_cachedMoment{MUME_START_YEAR, 0, 0, 0, 0};
 };
@@ -61,6 +61,11 @@ void MumeClockWidget::slot_updateLabel()
 
     const MumeMoment moment = m_clock->getMumeMoment();
     const MumeClockPrecisionEnum precision = m_clock->getPrecision();
+    // Nothing shown can change until the next MUME minute.
+    if (moment.toSeconds() == m_lastSeconds && precision == m_lastPrecision) {
+        return;
+    }
+    m_lastSeconds = moment.toSeconds();
 
     bool updateMoonText = false;
     const MumeMoonPhaseEnum phase = moment.moonPhase();
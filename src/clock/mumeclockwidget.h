@@ -33,6 +33,7 @@ public slots:
     MumeClock *m_clock = nullptr;
     std::unique_ptr<QTimer> m_timer;
 
+    int m_lastSeconds = -1;
     MumeTimeEnum m_lastTime = MumeTimeEnum::UNKNOWN;
     MumeSeasonEnum m_lastSeason = MumeSeasonEnum::UNKNOWN;
     MumeMoonPhaseEnum m_lastPhase = MumeMoonPhaseEnum::UNKNOWN;
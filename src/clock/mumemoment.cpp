@@ -72,6 +72,23 @@ MumeMoment MumeMoment::sinceMumeEpoch(const int64_t secsSinceMumeStartEpoch)
     return MumeMoment{year, month, day, hour, minute};
 }
 
+void MumeMoment::addMinute()
+{
+    if (++minute < MUME_MINUTES_PER_HOUR)
+        return;
+    minute = 0;
+    if (++hour < MUME_HOURS_PER_DAY)
+        return;
+    hour = 0;
+    if (++day < MUME_DAYS_PER_MONTH)
+        return;
+    day = 0;
+    if (++month < MUME_MONTHS_PER_YEAR)
+        return;
+    month = 0;
+    ++year;
+}
+
 int MumeMoment::dayOfYear() const
 {
     return month * MUME_DAYS_PER_MONTH + day;
@@ -73,6 +73,8 @@ class NODISCARD MumeMoment
 public:
     explicit MumeMoment(int year, int month, int day, int hour, int minute);
     NODISCARD static MumeMoment sinceMumeEpoch(int64_t secsSinceMumeStartEpoch);
+    // Same as sinceMumeEpoch(toSeconds() + 1), without the divisions.
+    void addMinute();
 
     NODISCARD int dayOfYear() const;
     NODISCARD int weekDay() const;
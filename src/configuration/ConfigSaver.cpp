@@ -0,0 +1,39 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "ConfigSaver.h"
+
+#include <utility>
+
+#include "configuration.h"
+
+// Changes made in a burst (e.g. dragging a slider) end up in the same write.
+static constexpr const int SAVE_INTERVAL_MS = 5000;
+
+ConfigSaver::ConfigSaver(QObject *const parent)
+    : QObject(parent)
+    , m_timer(this)
+{
+    connect(&m_timer, &QTimer::timeout, this, &ConfigSaver::slot_onTimeout);
+    m_timer.start(SAVE_INTERVAL_MS);
+}
+
+ConfigSaver::~ConfigSaver()
+{
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+void ConfigSaver::slot_onTimeout()
+{
+    // The previous write has had the whole interval to finish.
+    if (m_thread.joinable())
+        m_thread.join();
+
+    Configuration::GroupValues groups = getConfig().takeChangedGroups();
+    if (groups.empty())
+        return;
+
+    m_thread = std::thread(
+        [groups = std::move(groups)]() { Configuration::writeGroups(groups); });
+}
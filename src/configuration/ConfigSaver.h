@@ -0,0 +1,30 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <thread>
+#include <QObject>
+#include <QTimer>
+
+#include "../global/RuleOf5.h"
+#include "../global/macros.h"
+
+// Every few seconds, writes the settings groups that changed on a worker thread, so
+// changes made at runtime survive a crash without writing every group each time.
+// The full write at exit is unchanged.
+class ConfigSaver final : public QObject
+{
+    Q_OBJECT
+
+private:
+    QTimer m_timer;
+    std::thread m_thread;
+
+public:
+    explicit ConfigSaver(QObject *parent);
+    ~ConfigSaver() final;
+    DELETE_CTORS_AND_ASSIGN_OPS(ConfigSaver);
+
+private slots:
+    void slot_onTimeout();
+};
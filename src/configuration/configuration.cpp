@@ -6,6 +6,7 @@
 
 #include "configuration.h"
 
+#include <algorithm>
 #include <cassert>
 #include <mutex>
 #include <optional>
@@ -16,6 +17,7 @@
 #include <QSslSocket>
 #include <QString>
 #include <QStringList>
+#include <QTemporaryDir>
 
 #include "../global/utils.h"
 #include "../pandoragroup/mmapper2group.h"
@@ -203,8 +205,13 @@ ConstString KEY_AUTHORIZED_SECRETS = "Authorized secrets";
 ConstString KEY_AUTO_LOAD = "Auto load";
 ConstString KEY_AUTO_RESIZE_TERMINAL = "Auto resize terminal";
 ConstString KEY_AUTO_START_GROUP_MANAGER = "Auto start group manager";
+ConstString KEY_AUTOSAVE = "Autosave";
+ConstString KEY_AUTOSAVE_CHANGES = "Autosave changes";
+ConstString KEY_AUTOSAVE_MINUTES = "Autosave minutes";
 ConstString KEY_BACKGROUND_COLOR = "Background color";
+ConstString KEY_BACKGROUND_SAVE = "Background save";
 ConstString KEY_RSA_X509_CERTIFICATE = "RSA X509 certificate";
+ConstString KEY_CACHE_BUDGET = "Cache budget MiB";
 ConstString KEY_CHARACTER_ENCODING = "Character encoding";
 ConstString KEY_CHARACTER_NAME = "character name";
 ConstString KEY_CHECK_FOR_UPDATE = "Check for update";
@@ -212,8 +219,10 @@ ConstString KEY_CLEAR_INPUT_ON_ENTER = "Clear input on enter";
 ConstString KEY_COLOR = "color";
 ConstString KEY_COLUMNS = "Columns";
 ConstString KEY_COMMAND_PREFIX_CHAR = "Command prefix character";
+ConstString KEY_COMPACT_ROOM_IDS = "Compact room ids";
 ConstString KEY_CONNECTION_NORMAL_COLOR = "Connection normal color";
 ConstString KEY_CORRECT_POSITION_BONUS = "correct position bonus";
+ConstString KEY_DICTIONARY_COMPRESSION = "Dictionary compression";
 ConstString KEY_DISPLAY_XP_STATUS = "Display XP status bar widget";
 ConstString KEY_DISPLAY_CLOCK = "Display clock";
 ConstString KEY_DRAW_DOOR_NAMES = "Draw door names";
@@ -234,6 +243,7 @@ ConstString KEY_FOREGROUND_COLOR = "Foreground color";
 ConstString KEY_3D_CANVAS = "canvas.advanced.use3D";
 ConstString KEY_3D_AUTO_TILT = "canvas.advanced.autoTilt";
 ConstString KEY_3D_PERFSTATS = "canvas.advanced.printPerfStats";
+ConstString KEY_ADAPTIVE_QUALITY = "canvas.advanced.adaptiveQuality";
 ConstString KEY_3D_FOV = "canvas.advanced.fov";
 ConstString KEY_3D_VERTICAL_ANGLE = "canvas.advanced.verticalAngle";
 ConstString KEY_3D_HORIZONTAL_ANGLE = "canvas.advanced.horizontalAngle";
@@ -241,7 +251,9 @@ ConstString KEY_3D_LAYER_HEIGHT = "canvas.advanced.layerHeight";
 ConstString KEY_GROUP_TELL_ANSI_COLOR = "Group tell ansi color";
 ConstString KEY_GROUP_TELL_USE_256_ANSI_COLOR = "Use group tell 256 ansi color";
 ConstString KEY_HOST = "host";
+ConstString KEY_JOURNAL_SAVES = "Journal saves";
 ConstString KEY_LAST_MAP_LOAD_DIRECTORY = "Last map load directory";
+ConstString KEY_LAZY_DESCRIPTIONS = "Lazy descriptions";
 ConstString KEY_LINES_OF_INPUT_HISTORY = "Lines of input history";
 ConstString KEY_LINES_OF_SCROLLBACK = "Lines of scrollback";
 ConstString KEY_GROUP_LOCAL_PORT = "local port";
@@ -255,9 +267,13 @@ ConstString KEY_NO_LAUNCH_PANEL = "No launch panel";
 ConstString KEY_NO_ROOM_DESCRIPTION_PATTERNS = "No room description patterns";
 ConstString KEY_NO_SPLASH = "No splash screen";
 ConstString KEY_NUMBER_OF_ANTI_ALIASING_SAMPLES = "Number of anti-aliasing samples";
+ConstString KEY_OFFLINE_MOVE_INTERVAL = "Offline move interval";
+ConstString KEY_PARALLEL_EVALUATION_THRESHOLD = "parallel evaluation threshold";
 ConstString KEY_PROXY_THREADED = "Proxy Threaded";
 ConstString KEY_PROXY_CONNECTION_STATUS = "Proxy connection status";
 ConstString KEY_PROXY_LISTENS_ON_ANY_INTERFACE = "Proxy listens on any interface";
+ConstString KEY_PROXY_LOW_DELAY = "Proxy low delay";
+ConstString KEY_PROXY_MAX_SESSIONS = "Proxy max sessions";
 ConstString KEY_RELATIVE_PATH_ACCEPTANCE = "relative path acceptance";
 ConstString KEY_REMOTE_EDITING_AND_VIEWING = "Remote editing and viewing";
 ConstString KEY_RESOURCES_DIRECTORY = "canvas.resourcesDir";
@@ -274,8 +290,10 @@ ConstString KEY_ROWS = "Rows";
 ConstString KEY_RSA_PRIVATE_KEY = "RSA private key";
 ConstString KEY_RULES_WARNING = "rules warning";
 ConstString KEY_RUN_FIRST_TIME = "Run first time";
+ConstString KEY_SEARCH_AS_YOU_TYPE = "Search as you type";
 ConstString KEY_SECRET_METADATA = "Secret metadata";
 ConstString KEY_SERVER_NAME = "Server name";
+ConstString KEY_SHARE_MAP_CHANGES = "share map changes";
 ConstString KEY_SHARE_SELF = "share self";
 ConstString KEY_SHOW_HIDDEN_EXIT_FLAGS = "Show hidden exit flags";
 ConstString KEY_SHOW_NOTES = "Show notes";
@@ -283,6 +301,8 @@ ConstString KEY_SHOW_UPDATED_ROOMS = "Show updated rooms";
 ConstString KEY_STATE = "state";
 ConstString KEY_TAB_COMPLETION_DICTIONARY_SIZE = "Tab completion dictionary size";
 ConstString KEY_TLS_ENCRYPTION = "TLS encryption";
+ConstString KEY_UPDATE_INTERVAL = "update interval";
+ConstString KEY_USE_UDP_POSITIONS = "use UDP for positions";
 ConstString KEY_USE_INTERNAL_EDITOR = "Use internal editor";
 ConstString KEY_USE_SOFTWARE_OPENGL = "Use software OpenGL";
 ConstString KEY_USE_TRILINEAR_FILTERING = "Use trilinear filtering";
@@ -495,12 +515,71 @@ void Configuration::read()
            && colorSettings.TRANSPARENT.getColor().isTransparent());
     assert(colorSettings.BACKGROUND.isInitialized()
            && !colorSettings.BACKGROUND.getColor().isTransparent());
+
+    m_writtenValues = getGroupValues();
 }
 
 void Configuration::write() const
 {
     SETTINGS(conf);
     FOREACH_CONFIG_GROUP(write);
+    m_writtenValues = getGroupValues();
+}
+
+NODISCARD static QSettings::Format getMemoryFormat()
+{
+    // The values only live in the QSettings object; its file is never read or written.
+    static const QSettings::Format format = QSettings::registerFormat(
+        "mmapper-memory",
+        [](QIODevice &, QSettings::SettingsMap &) { return true; },
+        [](QIODevice &, const QSettings::SettingsMap &) { return true; });
+    return format;
+}
+
+Configuration::GroupValues Configuration::getGroupValues() const
+{
+    // QSettings may still create the (empty) file, so keep it out of the way.
+    static const QTemporaryDir dir;
+
+    QSettings conf(dir.filePath("values"), getMemoryFormat());
+    FOREACH_CONFIG_GROUP(write);
+
+    GroupValues result;
+    for (const QString &group : conf.childGroups()) {
+        QVariantMap &values = result[group];
+        conf.beginGroup(group);
+        for (const QString &key : conf.allKeys()) {
+            values.insert(key, conf.value(key));
+        }
+        conf.endGroup();
+    }
+    return result;
+}
+
+Configuration::GroupValues Configuration::takeChangedGroups() const
+{
+    GroupValues changed;
+    for (auto &[group, values] : getGroupValues()) {
+        QVariantMap &written = m_writtenValues[group];
+        if (values != written) {
+            written = values;
+            changed.emplace(group, std::move(values));
+        }
+    }
+    return changed;
+}
+
+void Configuration::writeGroups(const GroupValues &groups)
+{
+    SETTINGS(conf);
+    for (const auto &[group, values] : groups) {
+        conf.beginGroup(group);
+        for (auto it = values.begin(); it != values.end(); ++it) {
+            conf.setValue(it.key(), it.value());
+        }
+        conf.endGroup();
+    }
+    conf.sync();
 }
 
 void Configuration::reset()
@@ -560,6 +639,7 @@ void Configuration::GeneralSettings::read(QSettings &conf)
     characterEncoding = sanitizeCharacterEncoding(
         conf.value(KEY_CHARACTER_ENCODING, static_cast<uint32_t>(CharacterEncodingEnum::LATIN1))
             .toUInt());
+    cacheBudgetMiB = std::clamp(conf.value(KEY_CACHE_BUDGET, 0).toInt(), 0, 1 << 16);
 }
 
 void Configuration::ConnectionSettings::read(QSettings &conf)
@@ -576,6 +656,8 @@ void Configuration::ConnectionSettings::read(QSettings &conf)
     proxyThreaded = conf.value(KEY_PROXY_THREADED, false).toBool();
     proxyConnectionStatus = conf.value(KEY_PROXY_CONNECTION_STATUS, false).toBool();
     proxyListensOnAnyInterface = conf.value(KEY_PROXY_LISTENS_ON_ANY_INTERFACE, false).toBool();
+    proxyLowDelay = conf.value(KEY_PROXY_LOW_DELAY, true).toBool();
+    proxyMaxSessions = std::clamp(conf.value(KEY_PROXY_MAX_SESSIONS, 1).toInt(), 1, 4);
 }
 
 // closest well-known color is "Outer Space"
@@ -615,6 +697,7 @@ void Configuration::CanvasSettings::read(QSettings &conf)
     advanced.use3D.set(conf.value(KEY_3D_CANVAS, false).toBool());
     advanced.autoTilt.set(conf.value(KEY_3D_AUTO_TILT, true).toBool());
     advanced.printPerfStats.set(conf.value(KEY_3D_PERFSTATS, IS_DEBUG_BUILD).toBool());
+    advanced.adaptiveQuality.set(conf.value(KEY_ADAPTIVE_QUALITY, true).toBool());
     advanced.fov.set(conf.value(KEY_3D_FOV, 765).toInt());
     advanced.verticalAngle.set(conf.value(KEY_3D_VERTICAL_ANGLE, 450).toInt());
     advanced.horizontalAngle.set(conf.value(KEY_3D_HORIZONTAL_ANGLE, 0).toInt());
@@ -628,6 +711,14 @@ void Configuration::AutoLoadSettings::read(QSettings &conf)
     lastMapDirectory = conf.value(KEY_LAST_MAP_LOAD_DIRECTORY,
                                   getDefaultDirectory().append(DEFAULT_MMAPPER_SUBDIR))
                            .toString();
+    compactRoomIds = conf.value(KEY_COMPACT_ROOM_IDS, false).toBool();
+    backgroundSave = conf.value(KEY_BACKGROUND_SAVE, true).toBool();
+    journalSaves = conf.value(KEY_JOURNAL_SAVES, false).toBool();
+    autosave = conf.value(KEY_AUTOSAVE, false).toBool();
+    autosaveMinutes = std::max(1, conf.value(KEY_AUTOSAVE_MINUTES, 5).toInt());
+    autosaveChanges = std::max(1, conf.value(KEY_AUTOSAVE_CHANGES, 500).toInt());
+    lazyDescriptions = conf.value(KEY_LAZY_DESCRIPTIONS, false).toBool();
+    dictionaryCompression = conf.value(KEY_DICTIONARY_COMPRESSION, false).toBool();
 }
 
 void Configuration::AutoLogSettings::read(QSettings &conf)
@@ -660,6 +751,8 @@ void Configuration::ParserSettings::read(QSettings &conf)
     prefixChar = conf.value(KEY_COMMAND_PREFIX_CHAR, QChar::fromLatin1('_')).toChar().toLatin1();
     removeXmlTags = conf.value(KEY_REMOVE_XML_TAGS, true).toBool();
     noDescriptionPatternsList = conf.value(KEY_NO_ROOM_DESCRIPTION_PATTERNS).toStringList();
+    // MUME only attempts up to 4 commands per second (i.e. 250ms)
+    offlineMoveInterval = std::clamp(conf.value(KEY_OFFLINE_MOVE_INTERVAL, 250).toInt(), 0, 1000);
 
     auto &nodesc = noDescriptionPatternsList;
     if (nodesc.isEmpty()) {
@@ -692,6 +785,8 @@ void Configuration::PathMachineSettings::read(QSettings &conf)
     multipleConnectionsPenalty = conf.value(KEY_MULTIPLE_CONNECTIONS_PENALTY, 2.0).toDouble();
     maxPaths = utils::clampNonNegative(conf.value(KEY_MAXIMUM_NUMBER_OF_PATHS, 1000).toInt());
     matchingTolerance = utils::clampNonNegative(conf.value(KEY_ROOM_MATCHING_TOLERANCE, 8).toInt());
+    parallelEvaluationThreshold = utils::clampNonNegative(
+        conf.value(KEY_PARALLEL_EVALUATION_THRESHOLD, 0).toInt());
 }
 
 void Configuration::GroupManagerSettings::read(QSettings &conf)
@@ -719,6 +814,9 @@ void Configuration::GroupManagerSettings::read(QSettings &conf)
     useGroupTellAnsi256Color = conf.value(KEY_GROUP_TELL_USE_256_ANSI_COLOR, false).toBool();
     lockGroup = conf.value(KEY_LOCK_GROUP, false).toBool();
     autoStart = conf.value(KEY_AUTO_START_GROUP_MANAGER, false).toBool();
+    updateInterval = std::clamp(conf.value(KEY_UPDATE_INTERVAL, 100).toInt(), 0, 1000);
+    useUdpPositions = conf.value(KEY_USE_UDP_POSITIONS, false).toBool();
+    shareMapChanges = conf.value(KEY_SHARE_MAP_CHANGES, false).toBool();
 }
 
 void Configuration::MumeClockSettings::read(QSettings &conf)
@@ -765,6 +863,7 @@ void Configuration::RoomEditDialog::read(QSettings &conf)
 void Configuration::FindRoomsDialog::read(QSettings &conf)
 {
     geometry = conf.value(KEY_WINDOW_GEOMETRY).toByteArray();
+    searchAsYouType = conf.value(KEY_SEARCH_AS_YOU_TYPE, true).toBool();
 }
 
 void Configuration::GeneralSettings::write(QSettings &conf) const
@@ -781,6 +880,7 @@ void Configuration::GeneralSettings::write(QSettings &conf) const
     conf.setValue(KEY_NO_LAUNCH_PANEL, noClientPanel);
     conf.setValue(KEY_CHECK_FOR_UPDATE, checkForUpdate);
     conf.setValue(KEY_CHARACTER_ENCODING, static_cast<uint32_t>(characterEncoding));
+    conf.setValue(KEY_CACHE_BUDGET, cacheBudgetMiB);
 }
 
 void Configuration::ConnectionSettings::write(QSettings &conf) const
@@ -792,6 +892,8 @@ void Configuration::ConnectionSettings::write(QSettings &conf) const
     conf.setValue(KEY_PROXY_THREADED, proxyThreaded);
     conf.setValue(KEY_PROXY_CONNECTION_STATUS, proxyConnectionStatus);
     conf.setValue(KEY_PROXY_LISTENS_ON_ANY_INTERFACE, proxyListensOnAnyInterface);
+    conf.setValue(KEY_PROXY_LOW_DELAY, proxyLowDelay);
+    conf.setValue(KEY_PROXY_MAX_SESSIONS, proxyMaxSessions);
 }
 
 NODISCARD static auto getQColorName(const XNamedColor &color)
@@ -816,6 +918,7 @@ void Configuration::CanvasSettings::write(QSettings &conf) const
     conf.setValue(KEY_3D_CANVAS, advanced.use3D.get());
     conf.setValue(KEY_3D_AUTO_TILT, advanced.autoTilt.get());
     conf.setValue(KEY_3D_PERFSTATS, advanced.printPerfStats.get());
+    conf.setValue(KEY_ADAPTIVE_QUALITY, advanced.adaptiveQuality.get());
     conf.setValue(KEY_3D_FOV, advanced.fov.get());
     conf.setValue(KEY_3D_VERTICAL_ANGLE, advanced.verticalAngle.get());
     conf.setValue(KEY_3D_HORIZONTAL_ANGLE, advanced.horizontalAngle.get());
@@ -827,6 +930,14 @@ void Configuration::AutoLoadSettings::write(QSettings &conf) const
     conf.setValue(KEY_AUTO_LOAD, autoLoadMap);
     conf.setValue(KEY_FILE_NAME, fileName);
     conf.setValue(KEY_LAST_MAP_LOAD_DIRECTORY, lastMapDirectory);
+    conf.setValue(KEY_COMPACT_ROOM_IDS, compactRoomIds);
+    conf.setValue(KEY_BACKGROUND_SAVE, backgroundSave);
+    conf.setValue(KEY_JOURNAL_SAVES, journalSaves);
+    conf.setValue(KEY_AUTOSAVE, autosave);
+    conf.setValue(KEY_AUTOSAVE_MINUTES, autosaveMinutes);
+    conf.setValue(KEY_AUTOSAVE_CHANGES, autosaveChanges);
+    conf.setValue(KEY_LAZY_DESCRIPTIONS, lazyDescriptions);
+    conf.setValue(KEY_DICTIONARY_COMPRESSION, dictionaryCompression);
 }
 
 void Configuration::AutoLogSettings::write(QSettings &conf) const
@@ -847,6 +958,7 @@ void Configuration::ParserSettings::write(QSettings &conf) const
     conf.setValue(KEY_REMOVE_XML_TAGS, removeXmlTags);
     conf.setValue(KEY_COMMAND_PREFIX_CHAR, QChar::fromLatin1(prefixChar));
     conf.setValue(KEY_NO_ROOM_DESCRIPTION_PATTERNS, noDescriptionPatternsList);
+    conf.setValue(KEY_OFFLINE_MOVE_INTERVAL, offlineMoveInterval);
 }
 
 void Configuration::MumeNativeSettings::write(QSettings &conf) const
@@ -872,6 +984,8 @@ void Configuration::PathMachineSettings::write(QSettings &conf) const
     conf.setValue(KEY_MAXIMUM_NUMBER_OF_PATHS, utils::clampNonNegative(maxPaths));
     conf.setValue(KEY_ROOM_MATCHING_TOLERANCE, utils::clampNonNegative(matchingTolerance));
     conf.setValue(KEY_MULTIPLE_CONNECTIONS_PENALTY, multipleConnectionsPenalty);
+    conf.setValue(KEY_PARALLEL_EVALUATION_THRESHOLD,
+                  utils::clampNonNegative(parallelEvaluationThreshold));
 }
 
 void Configuration::GroupManagerSettings::write(QSettings &conf) const
@@ -895,6 +1009,9 @@ void Configuration::GroupManagerSettings::write(QSettings &conf) const
     conf.setValue(KEY_GROUP_TELL_USE_256_ANSI_COLOR, useGroupTellAnsi256Color);
     conf.setValue(KEY_LOCK_GROUP, lockGroup);
     conf.setValue(KEY_AUTO_START_GROUP_MANAGER, autoStart);
+    conf.setValue(KEY_UPDATE_INTERVAL, updateInterval);
+    conf.setValue(KEY_USE_UDP_POSITIONS, useUdpPositions);
+    conf.setValue(KEY_SHARE_MAP_CHANGES, shareMapChanges);
 }
 
 void Configuration::MumeClockSettings::write(QSettings &conf) const
@@ -941,6 +1058,7 @@ void Configuration::RoomEditDialog::write(QSettings &conf) const
 void Configuration::FindRoomsDialog::write(QSettings &conf) const
 {
     conf.setValue(KEY_WINDOW_GEOMETRY, geometry);
+    conf.setValue(KEY_SEARCH_AS_YOU_TYPE, searchAsYouType);
 }
 
 Configuration &setConfig()
@@ -999,7 +1117,7 @@ void Configuration::ColorSettings::resetToDefaults()
 
 Configuration::CanvasSettings::Advanced::Advanced()
 {
-    for (NamedConfig<bool> *const it : {&use3D, &autoTilt, &printPerfStats}) {
+    for (NamedConfig<bool> *const it : {&use3D, &autoTilt, &printPerfStats, &adaptiveQuality}) {
         const char *const name = it->getName().c_str();
         qInfo() << "Checking environment variable" << name;
         if (std::optional<bool> opt = utils::getEnvBool(name)) {
@@ -1023,6 +1141,7 @@ ConnectionSet Configuration::CanvasSettings::Advanced::registerChangeCallback(
     result += use3D.registerChangeCallback(callback);
     result += autoTilt.registerChangeCallback(callback);
     result += printPerfStats.registerChangeCallback(callback);
+    result += adaptiveQuality.registerChangeCallback(callback);
     result += fov.registerChangeCallback(callback);
     result += verticalAngle.registerChangeCallback(callback);
     result += horizontalAngle.registerChangeCallback(callback);
@@ -5,6 +5,7 @@
 // Author: Marek Krejza <krejza@gmail.com> (Caligor)
 // Author: Nils Schimmelmann <nschimme@gmail.com> (Jahara)
 
+#include <map>
 #include <string_view>
 #include <QByteArray>
 #include <QColor>
@@ -12,6 +13,7 @@
 #include <QObject>
 #include <QString>
 #include <QStringList>
+#include <QVariantMap>
 #include <QtCore>
 #include <QtGlobal>
 
@@ -97,6 +99,20 @@ class NODISCARD Configuration final
     void write() const;
     void reset();
 
+public:
+    // Every value a settings group writes, by group name.
+    using GroupValues = std::map<QString, QVariantMap>;
+    // The groups that changed since they were last read or written, which are then
+    // taken to be written.
+    NODISCARD GroupValues takeChangedGroups() const;
+    // Only touches its own QSettings, so it can run on any thread.
+    static void writeGroups(const GroupValues &groups);
+
+private:
+    NODISCARD GroupValues getGroupValues() const;
+    // What the settings hold, as far as this object knows.
+    mutable GroupValues m_writtenValues;
+
 public:
     struct NODISCARD GeneralSettings final
     {
@@ -112,6 +128,7 @@ class NODISCARD Configuration final
         bool noClientPanel = false;
         bool checkForUpdate = true;
         CharacterEncodingEnum characterEncoding = CharacterEncodingEnum::LATIN1;
+        int cacheBudgetMiB = 0; /// Total size of the rebuildable caches; 0 is unlimited
 
     private:
         SUBGROUP();
@@ -126,6 +143,8 @@ class NODISCARD Configuration final
         bool proxyThreaded = false;
         bool proxyConnectionStatus = false;
         bool proxyListensOnAnyInterface = false;
+        bool proxyLowDelay = true; /// TCP_NODELAY on both sockets
+        int proxyMaxSessions = 1; /// Clients that may be connected at once
 
     private:
         SUBGROUP();
@@ -138,6 +157,8 @@ class NODISCARD Configuration final
         bool removeXmlTags = false;
         char prefixChar = '_';
         QStringList noDescriptionPatternsList;
+        // Milliseconds between emulated offline moves; 0 walks a prespammed path at once.
+        int offlineMoveInterval = 250;
 
     private:
         SUBGROUP();
@@ -190,6 +211,12 @@ class NODISCARD Configuration final
         float doorNameScaleCutoff = 0.4f;
         float infomarkScaleCutoff = 0.25f;
         float extraDetailScaleCutoff = 0.15f;
+        // See MapLodEnum.
+        float reducedDetailScaleCutoff = 0.15f;
+        float colorTileScaleCutoff = 0.08f;
+        // Layers farther than this from the current one are only built and drawn
+        // as their color tiles; see FullDetailLayers.
+        int layerBudget = 10;
 
         MMapper::Array<int, 3> mapRadius{100, 100, 100};
         RestrictMapEnum useRestrictedMap = RestrictMapEnum::OnlyInMapMode;
@@ -199,6 +226,8 @@ class NODISCARD Configuration final
             NamedConfig<bool> use3D{"MMAPPER_3D", true};
             NamedConfig<bool> autoTilt{"MMAPPER_AUTO_TILT", true};
             NamedConfig<bool> printPerfStats{"MMAPPER_GL_PERFSTATS", IS_DEBUG_BUILD};
+            // See QualityGovernor.
+            NamedConfig<bool> adaptiveQuality{"MMAPPER_ADAPTIVE_QUALITY", true};
 
             // 5..90 degrees
             FixedPoint<1> fov{50, 900, 765};
@@ -266,6 +295,25 @@ class NODISCARD Configuration final
         bool autoLoadMap = false;
         QString fileName;
         QString lastMapDirectory;
+        // Renumber room ids densely whenever a map is loaded or saved.
+        bool compactRoomIds = false;
+        // Write full .mm2 saves on a worker thread while mapping goes on.
+        bool backgroundSave = true;
+        // Append what changed since the last save to a journal next to the
+        // .mm2, instead of saving the whole map every time.
+        bool journalSaves = false;
+        // Save the map by itself every autosaveMinutes, or after that many
+        // changes, through the journal or a background save (never a blocking
+        // one).
+        bool autosave = false;
+        int autosaveMinutes = 5;
+        int autosaveChanges = 500;
+        // Keep room descriptions and contents compressed after loading a
+        // .mm2 map, and only inflate them when they're looked at.
+        bool lazyDescriptions = false;
+        // Compress the rooms in .mm2 saves with a dictionary trained on the
+        // map's descriptions; older versions of MMapper can't read them.
+        bool dictionaryCompression = false;
 
     private:
         SUBGROUP();
@@ -294,6 +342,7 @@ class NODISCARD Configuration final
         double correctPositionBonus = 0.0;
         int maxPaths = 0;
         int matchingTolerance = 0;
+        int parallelEvaluationThreshold = 0;
 
     private:
         SUBGROUP();
@@ -319,6 +368,12 @@ class NODISCARD Configuration final
         bool useGroupTellAnsi256Color = false;
         bool lockGroup = false;
         bool autoStart = false;
+        // Minimum milliseconds between our character updates; moves and deaths go out at once.
+        int updateInterval = 100;
+        // Also send room changes over UDP when both sides speak protocol 104.
+        bool useUdpPositions = false;
+        // Send the rooms we map to the group, and apply the ones it sends.
+        bool shareMapChanges = false;
 
     private:
         SUBGROUP();
@@ -392,6 +447,7 @@ class NODISCARD Configuration final
     struct NODISCARD FindRoomsDialog final
     {
         QByteArray geometry;
+        bool searchAsYouType = true;
 
     private:
         SUBGROUP();
@@ -3,13 +3,17 @@
 
 #include "Characters.h"
 
+#include <array>
 #include <cmath>
+#include <cstdint>
 #include <glm/glm.hpp>
 #include <optional>
+#include <utility>
 #include <vector>
 #include <QtCore>
 
 #include "../configuration/configuration.h"
+#include "../expandoracommon/CoordinateKey.h"
 #include "../expandoracommon/room.h"
 #include "../global/roomid.h"
 #include "../mapdata/mapdata.h"
@@ -41,32 +45,159 @@ DistantObjectTransform DistantObjectTransform::construct(const glm::vec3 &pos,
     return DistantObjectTransform{hint, degrees};
 }
 
+void DistantObjectTransform::constructAll(const std::vector<glm::vec3> &positions,
+                                          const MapScreen &mapScreen,
+                                          const float marginPixels,
+                                          std::vector<DistantObjectTransform> &transforms,
+                                          MapScreen::Batch &batch)
+{
+    assert(marginPixels > 0.f);
+    transforms.clear();
+    if (positions.empty())
+        return;
+
+    mapScreen.getProxyLocations(positions, marginPixels, batch);
+    const auto &hints = batch.getProxies();
+    const glm::vec3 viewCenter = mapScreen.getCenter();
+    for (size_t i = 0; i < positions.size(); ++i) {
+        const auto delta = positions[i] - viewCenter;
+        const float degrees = glm::degrees(std::atan2(delta.y, delta.x));
+        transforms.emplace_back(hints[i], degrees);
+    }
+}
+
+CharacterBatch::CoordCounts::Slot &CharacterBatch::CoordCounts::find(const Coordinate &coord)
+{
+    // The slot count is a power of two, so the mask picks the slot.
+    const size_t mask = m_slots.size() - 1;
+    for (size_t i = CoordinateHash{}(coord) & mask;; i = (i + 1) & mask) {
+        Slot &slot = m_slots[i];
+        if (!slot.used || slot.coord == coord)
+            return slot;
+    }
+}
+
+void CharacterBatch::CoordCounts::grow()
+{
+    std::vector<Slot> old(m_slots.size() * 2);
+    std::swap(old, m_slots);
+    m_used = 0;
+    for (const Slot &slot : old) {
+        if (slot.used)
+            (*this)[slot.coord] = slot.count;
+    }
+}
+
+int &CharacterBatch::CoordCounts::operator[](const Coordinate &coord)
+{
+    Slot *slot = &find(coord);
+    if (!slot->used) {
+        // Stay at most half full, so the probes stay short.
+        if (2 * (m_used + 1) > m_slots.size()) {
+            grow();
+            slot = &find(coord);
+        }
+        slot->coord = coord;
+        slot->count = 0;
+        slot->used = true;
+        ++m_used;
+    }
+    return slot->count;
+}
+
+void CharacterBatch::CoordCounts::clear()
+{
+    if (m_used == 0)
+        return;
+    for (Slot &slot : m_slots) {
+        slot.used = false;
+    }
+    m_used = 0;
+}
+
+void CharacterBatch::CharFakeGL::clearAll()
+{
+    m_charTris.clear();
+    m_charBeaconQuads.clear();
+    m_charLines.clear();
+    m_pathPoints.clear();
+    m_pathLineVerts.clear();
+    m_charRoomQuads.clear();
+    m_screenSpaceArrows.clear();
+    m_coordCounts.clear();
+}
+
 bool CharacterBatch::isVisible(const Coordinate &c, float margin) const
 {
     return m_mapScreen.isRoomVisible(c, margin);
 }
 
 void CharacterBatch::drawCharacter(const Coordinate &c, const Color &color, bool fill)
+{
+    // The box's slot in the room is taken now, in drawing order.
+    m_pending.emplace_back(PendingCharacter{c, color, getOpenGL().claim(c), fill});
+}
+
+// REVISIT: The margin probably needs to be modified for high-dpi.
+static constexpr const float CHAR_MARGIN_PIXELS = MapScreen::DEFAULT_MARGIN_PIXELS;
+
+void CharacterBatch::placeCharacters()
+{
+    if (m_pending.empty())
+        return;
+
+    m_pendingRooms.clear();
+    for (const PendingCharacter &pending : m_pending) {
+        m_pendingRooms.emplace_back(pending.coord);
+    }
+    m_mapScreen.areRoomsVisible(m_pendingRooms,
+                                CHAR_MARGIN_PIXELS / 2.f,
+                                m_visible,
+                                m_screenBatch);
+
+    m_distantCenters.clear();
+    for (size_t i = 0; i < m_pending.size(); ++i) {
+        if (!m_visible[i])
+            m_distantCenters.emplace_back(m_pending[i].coord.to_vec3()
+                                          + glm::vec3{0.5f, 0.5f, 0.f});
+    }
+    DistantObjectTransform::constructAll(m_distantCenters,
+                                         m_mapScreen,
+                                         CHAR_MARGIN_PIXELS,
+                                         m_distant,
+                                         m_screenBatch);
+
+    size_t nextDistant = 0;
+    for (size_t i = 0; i < m_pending.size(); ++i) {
+        const bool visible = m_visible[i];
+        placeCharacter(m_pending[i], visible, visible ? nullptr : &m_distant[nextDistant++]);
+    }
+    m_pending.clear();
+}
+
+void CharacterBatch::placeCharacter(const PendingCharacter &pending,
+                                    const bool visible,
+                                    const DistantObjectTransform *const distant)
 {
     const Configuration::CanvasSettings &settings = getConfig().canvas;
 
-    const glm::vec3 roomCenter = c.to_vec3() + glm::vec3{0.5f, 0.5f, 0.f};
+    const Coordinate &c = pending.coord;
+    const Color &color = pending.color;
+    const bool fill = pending.fill;
     const int layerDifference = c.z - m_currentLayer;
 
     auto &gl = getOpenGL();
     gl.setColor(color);
 
-    // REVISIT: The margin probably needs to be modified for high-dpi.
-    const float marginPixels = MapScreen::DEFAULT_MARGIN_PIXELS;
-    const bool visible = isVisible(c, marginPixels / 2.f);
     const bool isFar = m_scale <= settings.charBeaconScaleCutoff;
     const bool wantBeacons = settings.drawCharBeacons && isFar;
     if (!visible) {
+        assert(distant != nullptr);
         static const bool useScreenSpacePlayerArrow = []() -> bool {
             auto opt = utils::getEnvBool("MMAPPER_SCREEN_SPACE_ARROW");
             return opt ? opt.value() : true;
         }();
-        const auto dot = DistantObjectTransform::construct(roomCenter, m_mapScreen, marginPixels);
+        const DistantObjectTransform &dot = *distant;
         // Player is distant
         if (useScreenSpacePlayerArrow) {
             gl.addScreenSpaceArrow(dot.offset, dot.rotationDegrees, color, fill);
@@ -83,6 +214,7 @@ void CharacterBatch::drawCharacter(const Coordinate &c, const Color &color, bool
 
     const bool differentLayer = layerDifference != 0;
     if (differentLayer) {
+        const glm::vec3 roomCenter = c.to_vec3() + glm::vec3{0.5f, 0.5f, 0.f};
         const glm::vec3 centerOnCurrentLayer{static_cast<glm::vec2>(roomCenter),
                                              static_cast<float>(m_currentLayer)};
         // Draw any arrow on the current layer pointing in either up or down
@@ -97,7 +229,7 @@ void CharacterBatch::drawCharacter(const Coordinate &c, const Color &color, bool
     }
 
     const bool beacon = visible && !differentLayer && wantBeacons;
-    gl.drawBox(c, fill, beacon, isFar);
+    gl.drawBox(c, pending.numAlreadyInRoom, fill, beacon, isFar);
 }
 
 void CharacterBatch::drawPreSpammedPath(const Coordinate &c1,
@@ -107,25 +239,15 @@ void CharacterBatch::drawPreSpammedPath(const Coordinate &c1,
     if (path.isEmpty())
         return;
 
-    const std::vector<glm::vec3> verts = [&c1, &path]() {
-        std::vector<glm::vec3> translated;
-        translated.reserve(static_cast<size_t>(path.size()) + 1);
-
-        const auto add = [&translated](const Coordinate &c) -> void {
-            static const glm::vec3 PATH_OFFSET{0.5f, 0.5f, 0.f};
-            translated.push_back(c.to_vec3() + PATH_OFFSET);
-        };
-
-        add(c1);
-        for (const Coordinate &c2 : path) {
-            add(c2);
-        }
-        return translated;
-    }();
-
+    static const glm::vec3 PATH_OFFSET{0.5f, 0.5f, 0.f};
     auto &gl = getOpenGL();
-    gl.drawPathLineStrip(color, verts);
-    gl.drawPathPoint(color, verts.back());
+    glm::vec3 prev = c1.to_vec3() + PATH_OFFSET;
+    for (const Coordinate &c2 : path) {
+        const glm::vec3 next = c2.to_vec3() + PATH_OFFSET;
+        gl.drawPathLine(color, prev, next);
+        prev = next;
+    }
+    gl.drawPathPoint(color, prev);
 }
 
 void CharacterBatch::CharFakeGL::drawQuadCommon(const glm::vec2 &in_a,
@@ -209,6 +331,7 @@ void CharacterBatch::CharFakeGL::drawQuadCommon(const glm::vec2 &in_a,
 }
 
 void CharacterBatch::CharFakeGL::drawBox(const Coordinate &coord,
+                                         const int numAlreadyInRoom,
                                          bool fill,
                                          bool beacon,
                                          const bool isFar)
@@ -216,9 +339,6 @@ void CharacterBatch::CharFakeGL::drawBox(const Coordinate &coord,
     const bool dontFillRotatedQuads = true;
     const bool shrinkRotatedQuads = false; // REVISIT: make this a user option?
 
-    // caution: multiple side effects in next statement.
-    const int numAlreadyInRoom = m_coordCounts[coord]++;
-
     glPushMatrix();
 
     glTranslatef(coord.to_vec3());
@@ -330,7 +450,6 @@ void CharacterBatch::CharFakeGL::reallyDrawCharacters(OpenGL &gl, const MapCanva
             v.vert *= dpr;
         }
         gl.renderFont3d(textures.char_arrows, m_screenSpaceArrows);
-        m_screenSpaceArrows.clear();
     }
 }
 
@@ -349,26 +468,35 @@ void CharacterBatch::CharFakeGL::addScreenSpaceArrow(const glm::vec3 &pos,
                                                      const Color &color,
                                                      const bool fill)
 {
-    std::array<glm::vec2, 4> texCoords{
+    static const std::array<glm::vec2, 4> texCoords{
         glm::vec2{0, 0},
         glm::vec2{1, 0},
         glm::vec2{1, 1},
         glm::vec2{0, 1},
     };
+    // The corners of the arrow before it's rotated, already scaled to pixels.
+    static const std::array<glm::vec2, 4> corners = []() {
+        const float scale = MapScreen::DEFAULT_MARGIN_PIXELS;
+        std::array<glm::vec2, 4> result{};
+        for (size_t i = 0; i < 4; ++i) {
+            result[i] = scale * (texCoords[i] * 2.f - 1.f);
+        }
+        return result;
+    }();
 
-    const float scale = MapScreen::DEFAULT_MARGIN_PIXELS;
+    // A 2D rotation is all it takes; there's no need for a full matrix.
     const float radians = glm::radians(degrees);
-    const glm::vec3 z{0, 0, 1};
-    const glm::mat4 rotation = glm::rotate(glm::mat4(1), radians, z);
+    const float cosine = std::cos(radians);
+    const float sine = std::sin(radians);
+    // solid   |filled
+    // --------+--------
+    // outline | n/a
+    const glm::vec2 fillOffset = fill ? glm::vec2(0.5f, 0.5f) : glm::vec2(0.f, 0.0f);
     for (size_t i = 0; i < 4; ++i) {
-        const glm::vec2 &tc = texCoords[i];
-        const auto tmp = rotation * glm::vec4(tc * 2.f - 1.f, 0, 1);
-        const glm::vec2 screenSpaceOffset = scale * glm::vec2(tmp) / tmp.w;
-        // solid   |filled
-        // --------+--------
-        // outline | n/a
-        const glm::vec2 tcOffset = tc * 0.5f
-                                   + (fill ? glm::vec2(0.5f, 0.5f) : glm::vec2(0.f, 0.0f));
+        const glm::vec2 &corner = corners[i];
+        const glm::vec2 screenSpaceOffset{cosine * corner.x - sine * corner.y,
+                                          sine * corner.x + cosine * corner.y};
+        const glm::vec2 tcOffset = texCoords[i] * 0.5f + fillOffset;
         m_screenSpaceArrows.emplace_back(pos, color, tcOffset, screenSpaceOffset);
     }
 }
@@ -379,7 +507,11 @@ void MapCanvas::paintCharacters()
         return;
     }
 
-    CharacterBatch characterBatch{m_mapScreen, m_currentLayer, getTotalScaleFactor()};
+    if (m_characterBatch == nullptr) {
+        m_characterBatch = std::make_unique<CharacterBatch>(m_mapScreen);
+    }
+    CharacterBatch &characterBatch = *m_characterBatch;
+    characterBatch.beginFrame(m_currentLayer, getTotalScaleFactor());
     const Coordinate &pos = m_data.getPosition();
 
     // draw the characters before the current position
@@ -387,13 +519,17 @@ void MapCanvas::paintCharacters()
     drawGroupCharacters(characterBatch);
     characterBatch.resetCount(pos);
 
-    // paint char current position
+    // paint the characters of the other sessions hollow, so they can't be mistaken for this one
     const Color color{getConfig().groupManager.color};
+    for (const auto &kv : m_sessionMarkers) {
+        characterBatch.drawCharacter(kv.second, color, false);
+    }
+
+    // paint char current position
     characterBatch.drawCharacter(pos, color);
 
     // paint prespam
-    const auto prespam = m_data.getPath(pos, m_prespammedPath.getQueue());
-    characterBatch.drawPreSpammedPath(pos, prespam, color);
+    characterBatch.drawPreSpammedPath(pos, m_prespammedPath.getPath(m_data, pos), color);
 
     characterBatch.reallyDraw(getOpenGL(), m_textures);
 }
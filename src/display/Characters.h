@@ -6,9 +6,7 @@
 #include <cstddef>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-#include <map>
 #include <memory>
-#include <stack>
 #include <vector>
 #include <QColor>
 
@@ -17,8 +15,8 @@
 #include "../global/utils.h"
 #include "../opengl/Font.h"
 #include "../opengl/OpenGLTypes.h"
+#include "MapCanvasData.h"
 
-class MapScreen;
 class OpenGL;
 struct MapCanvasTextures;
 
@@ -42,6 +40,12 @@ class NODISCARD DistantObjectTransform final
     static DistantObjectTransform construct(const glm::vec3 &pos,
                                             const MapScreen &mapScreen,
                                             float marginPixels);
+    // Same as construct() for each position, with the proxies found as one batch.
+    static void constructAll(const std::vector<glm::vec3> &positions,
+                             const MapScreen &mapScreen,
+                             float marginPixels,
+                             std::vector<DistantObjectTransform> &transforms,
+                             MapScreen::Batch &batch);
 };
 
 class NODISCARD CharacterBatch final
@@ -58,40 +62,59 @@ class NODISCARD CharacterBatch final
         glm::mat4 modelView = glm::mat4(1);
     };
 
-    class NODISCARD MatrixStack final : private std::stack<Matrices>
+    // A vector, so the storage is kept from one frame to the next.
+    class NODISCARD MatrixStack final : private std::vector<Matrices>
     {
     private:
-        using base = std::stack<Matrices>;
+        using base = std::vector<Matrices>;
 
     public:
-        MatrixStack() { base::push(Matrices()); }
+        MatrixStack()
+        {
+            base::reserve(8);
+            base::emplace_back();
+        }
         ~MatrixStack() { assert(base::size() == 1); }
-        void push() { base::push(top()); }
-        using base::pop;
-        using base::top;
+        void push() { base::emplace_back(top()); }
+        void pop()
+        {
+            assert(base::size() > 1);
+            base::pop_back();
+        }
+        NODISCARD Matrices &top() { return base::back(); }
     };
 
-    class NODISCARD CharFakeGL final
+    // How many boxes have been drawn in each room, with open addressing, so the
+    // slots are reused from one frame to the next.
+    class NODISCARD CoordCounts final
     {
     private:
-        struct NODISCARD CoordCompare final
+        static constexpr const size_t MIN_SLOTS = 64;
+
+        struct NODISCARD Slot final
         {
-            // REVISIT: just make this the global operator<(),
-            // so it can be picked up by std::less<Coordinate>.
-            bool operator()(const Coordinate &lhs, const Coordinate &rhs) const
-            {
-                if (lhs.x < rhs.x)
-                    return true;
-                if (rhs.x < lhs.x)
-                    return false;
-                if (lhs.y < rhs.y)
-                    return true;
-                if (rhs.y < lhs.y)
-                    return false;
-                return lhs.z < rhs.z;
-            }
+            Coordinate coord;
+            int count = 0;
+            bool used = false;
         };
 
+        std::vector<Slot> m_slots;
+        size_t m_used = 0;
+
+    public:
+        CoordCounts() { m_slots.resize(MIN_SLOTS); }
+
+    public:
+        NODISCARD int &operator[](const Coordinate &coord);
+        void clear();
+
+    private:
+        NODISCARD Slot &find(const Coordinate &coord);
+        void grow();
+    };
+
+    class NODISCARD CharFakeGL final
+    {
     private:
         Color m_color;
         MatrixStack m_stack;
@@ -102,13 +125,17 @@ class NODISCARD CharacterBatch final
         std::vector<ColorVert> m_pathLineVerts;
         std::vector<ColoredTexVert> m_charRoomQuads;
         std::vector<FontVert3d> m_screenSpaceArrows;
-        std::map<Coordinate, int, CoordCompare> m_coordCounts;
+        CoordCounts m_coordCounts;
 
     public:
         CharFakeGL() = default;
         ~CharFakeGL() = default;
         DELETE_CTORS_AND_ASSIGN_OPS(CharFakeGL);
 
+    public:
+        // Forgets everything that was drawn, but keeps the memory.
+        void clearAll();
+
     public:
         void reallyDraw(OpenGL &gl, const MapCanvasTextures &textures)
         {
@@ -124,6 +151,8 @@ class NODISCARD CharacterBatch final
         void setColor(const Color &color) { m_color = color; }
         void reserve(Coordinate c) { m_coordCounts[c]++; }
         void clear(Coordinate c) { m_coordCounts[c] = 0; }
+        // How many boxes were in the room before this one.
+        NODISCARD int claim(const Coordinate &c) { return m_coordCounts[c]++; }
 
     public:
         void glPushMatrix() { m_stack.push(); }
@@ -144,16 +173,18 @@ class NODISCARD CharacterBatch final
             m = glm::translate(m, v);
         }
         void drawArrow(bool fill, bool beacon);
-        void drawBox(const Coordinate &coord, bool fill, bool beacon, bool isFar);
+        void drawBox(const Coordinate &coord,
+                     int numAlreadyInRoom,
+                     bool fill,
+                     bool beacon,
+                     bool isFar);
         void addScreenSpaceArrow(const glm::vec3 &pos, float degrees, const Color &color, bool fill);
 
         // with blending, without depth; always size 4
-        void drawPathLineStrip(const Color &color, const std::vector<glm::vec3> &points)
+        void drawPathLine(const Color &color, const glm::vec3 &from, const glm::vec3 &to)
         {
-            for (size_t i = 1, size = points.size(); i < size; ++i) {
-                m_pathLineVerts.emplace_back(color, points[i - 1]);
-                m_pathLineVerts.emplace_back(color, points[i]);
-            }
+            m_pathLineVerts.emplace_back(color, from);
+            m_pathLineVerts.emplace_back(color, to);
         }
 
         // with blending, without depth; always size 8
@@ -188,18 +219,44 @@ class NODISCARD CharacterBatch final
                             QuadOptsEnum options);
     };
 
+    // Characters are placed when the frame is drawn, so that all of them are
+    // projected together.
+    struct NODISCARD PendingCharacter final
+    {
+        Coordinate coord;
+        Color color;
+        int numAlreadyInRoom = 0;
+        bool fill = true;
+    };
+
 private:
     const MapScreen &m_mapScreen;
-    const int m_currentLayer;
-    const float m_scale;
+    int m_currentLayer = 0;
+    float m_scale = 1.f;
     CharFakeGL m_fakeGL;
+    std::vector<PendingCharacter> m_pending;
+    std::vector<Coordinate> m_pendingRooms;
+    std::vector<bool> m_visible;
+    std::vector<glm::vec3> m_distantCenters;
+    std::vector<DistantObjectTransform> m_distant;
+    MapScreen::Batch m_screenBatch;
 
 public:
-    explicit CharacterBatch(const MapScreen &mapScreen, const int currentLayer, const float scale)
+    // MapCanvas keeps one, so that its buffers don't have to be allocated every frame.
+    explicit CharacterBatch(const MapScreen &mapScreen)
         : m_mapScreen(mapScreen)
-        , m_currentLayer(currentLayer)
-        , m_scale(scale)
     {}
+    ~CharacterBatch() = default;
+    DELETE_CTORS_AND_ASSIGN_OPS(CharacterBatch);
+
+public:
+    void beginFrame(const int currentLayer, const float scale)
+    {
+        m_currentLayer = currentLayer;
+        m_scale = scale;
+        m_fakeGL.clearAll();
+        m_pending.clear();
+    }
 
 protected:
     NODISCARD CharFakeGL &getOpenGL() { return m_fakeGL; }
@@ -221,6 +278,13 @@ class NODISCARD CharacterBatch final
 public:
     void reallyDraw(OpenGL &gl, const MapCanvasTextures &textures)
     {
+        placeCharacters();
         m_fakeGL.reallyDraw(gl, textures);
     }
+
+private:
+    void placeCharacters();
+    void placeCharacter(const PendingCharacter &pending,
+                        bool visible,
+                        const DistantObjectTransform *distant);
 };
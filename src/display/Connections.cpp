@@ -3,6 +3,7 @@
 
 #include "Connections.h"
 
+#include <array>
 #include <cassert>
 #include <cstdlib>
 #include <glm/glm.hpp>
@@ -18,6 +19,7 @@
 #include "../global/Flags.h"
 #include "../mapdata/DoorFlags.h"
 #include "../mapdata/ExitFieldVariant.h"
+#include "../mapdata/MapSnapshot.h"
 #include "../mapdata/mapdata.h"
 #include "../opengl/Font.h"
 #include "../opengl/FontFormatFlags.h"
@@ -116,9 +118,9 @@ NODISCARD static QString getPostfixedDoorName(const Room *const room, const Exit
     return room->exit(dir).getDoorName() + postFix;
 }
 
-UniqueMesh RoomNameBatch::getMesh(GLFont &font)
+ZoomedTextMeshes RoomNameBatch::getMesh(GLFont &font)
 {
-    return font.getFontMesh(m_names);
+    return ZoomedTextMeshes{font, m_names};
 }
 
 void ConnectionDrawer::drawRoomDoorName(const Room *const sourceRoom,
@@ -225,7 +227,8 @@ void ConnectionDrawer::drawRoomDoorName(const Room *const sourceRoom,
                                         FontFormatFlags{FontFormatFlagEnum::HALIGN_CENTER}});
 }
 
-void ConnectionDrawer::drawRoomConnectionsAndDoors(const Room *const room, const RoomIndex &rooms)
+void ConnectionDrawer::drawRoomConnectionsAndDoors(const Room *const room,
+                                                   const MapSnapshot &rooms)
 {
     // Ooops, this is wrong since we may reject a connection that would be visible
     // if we looked at the other side.
@@ -239,16 +242,14 @@ void ConnectionDrawer::drawRoomConnectionsAndDoors(const Room *const room, const
         // outgoing connections
         if (sourceWithinBounds) {
             for (const auto &outTargetId : sourceExit.outRange()) {
-                const SharedConstRoom &sharedTargetRoom = rooms[outTargetId];
-                if (!sharedTargetRoom) {
+                const Room *const targetRoom = rooms.getRoom(outTargetId);
+                if (targetRoom == nullptr) {
                     qWarning() << "Source room" << sourceId.asUint32() << "("
                                << room->getName().toQString() << ") has target room"
                                << outTargetId.asUint32() << "which does not exist!";
                     continue;
                 }
 
-                const Room *const targetRoom = sharedTargetRoom.get();
-
                 const bool targetOutsideBounds = !m_bounds.contains(targetRoom->getPosition());
 
                 // Two way means that the target room directly connects back to source room
@@ -287,16 +288,14 @@ void ConnectionDrawer::drawRoomConnectionsAndDoors(const Room *const room, const
 
         // incoming connections
         for (const auto &inTargetId : sourceExit.inRange()) {
-            const SharedConstRoom &sharedTargetRoom = rooms[inTargetId];
-            if (!sharedTargetRoom) {
+            const Room *const targetRoom = rooms.getRoom(inTargetId);
+            if (targetRoom == nullptr) {
                 qWarning() << "Source room" << sourceId.asUint32() << "("
                            << room->getName().toQString() << ") has target room"
                            << inTargetId.asUint32() << "which does not exist!";
                 continue;
             }
 
-            const Room *const targetRoom = sharedTargetRoom.get();
-
             // Only draw the connection if the target room is within the bounds
             if (!m_bounds.contains(targetRoom->getPosition()))
                 continue;
@@ -466,43 +465,54 @@ void ConnectionDrawer::drawLineStrip(const std::vector<glm::vec3> &points)
     getFakeGL().drawLineStrip(points);
 }
 
-void ConnectionDrawer::drawConnStartTri(const ExitDirEnum startDir, const float srcZ)
+using Tri = std::array<glm::vec2, VERTS_PER_TRI>;
+
+// Relative to the lower left corner of the room the arrow is drawn in.
+NODISCARD static Tri getConnectionArrow(const ConnectionArrowEnum arrow)
 {
-    auto &gl = getFakeGL();
+    switch (arrow) {
+    case ConnectionArrowEnum::TWO_WAY_NORTH:
+        return Tri{glm::vec2{0.82f, 0.9f}, glm::vec2{0.68f, 0.9f}, glm::vec2{0.75f, 0.7f}};
+    case ConnectionArrowEnum::TWO_WAY_SOUTH:
+        return Tri{glm::vec2{0.18f, 0.1f}, glm::vec2{0.32f, 0.1f}, glm::vec2{0.25f, 0.3f}};
+    case ConnectionArrowEnum::TWO_WAY_EAST:
+        return Tri{glm::vec2{0.9f, 0.68f}, glm::vec2{0.9f, 0.82f}, glm::vec2{0.7f, 0.75f}};
+    case ConnectionArrowEnum::TWO_WAY_WEST:
+        return Tri{glm::vec2{0.1f, 0.32f}, glm::vec2{0.1f, 0.18f}, glm::vec2{0.3f, 0.25f}};
+    case ConnectionArrowEnum::ONE_WAY_NORTH:
+        return Tri{glm::vec2{0.32f, 0.9f}, glm::vec2{0.18f, 0.9f}, glm::vec2{0.25f, 0.7f}};
+    case ConnectionArrowEnum::ONE_WAY_SOUTH:
+        return Tri{glm::vec2{0.68f, 0.1f}, glm::vec2{0.82f, 0.1f}, glm::vec2{0.75f, 0.3f}};
+    case ConnectionArrowEnum::ONE_WAY_EAST:
+        return Tri{glm::vec2{0.9f, 0.18f}, glm::vec2{0.9f, 0.32f}, glm::vec2{0.7f, 0.25f}};
+    case ConnectionArrowEnum::ONE_WAY_WEST:
+        return Tri{glm::vec2{0.1f, 0.82f}, glm::vec2{0.1f, 0.68f}, glm::vec2{0.3f, 0.75f}};
+    case ConnectionArrowEnum::UP_DOWN_UNKNOWN:
+        return Tri{glm::vec2{0.5f, 0.5f}, glm::vec2{0.55f, 0.3f}, glm::vec2{0.7f, 0.45f}};
+    }
 
-    switch (startDir) {
-    case ExitDirEnum::NORTH:
-        gl.drawTriangle(glm::vec3{0.82f, 0.9f, srcZ},
-                        glm::vec3{0.68f, 0.9f, srcZ},
-                        glm::vec3{0.75f, 0.7f, srcZ});
-        break;
-    case ExitDirEnum::SOUTH:
-        gl.drawTriangle(glm::vec3{0.18f, 0.1f, srcZ},
-                        glm::vec3{0.32f, 0.1f, srcZ},
-                        glm::vec3{0.25f, 0.3f, srcZ});
-        break;
-    case ExitDirEnum::EAST:
-        gl.drawTriangle(glm::vec3{0.9f, 0.68f, srcZ},
-                        glm::vec3{0.9f, 0.82f, srcZ},
-                        glm::vec3{0.7f, 0.75f, srcZ});
-        break;
-    case ExitDirEnum::WEST:
-        gl.drawTriangle(glm::vec3{0.1f, 0.32f, srcZ},
-                        glm::vec3{0.1f, 0.18f, srcZ},
-                        glm::vec3{0.3f, 0.25f, srcZ});
-        break;
+    assert(false);
+    return Tri{};
+}
 
-    case ExitDirEnum::UP:
-    case ExitDirEnum::DOWN:
-        // Do not draw triangles for 2-way up/down
-        break;
-    case ExitDirEnum::UNKNOWN:
-        drawConnEndTriUpDownUnknown(0, 0, srcZ);
-        break;
-    case ExitDirEnum::NONE:
-        assert(false);
-        break;
-    }
+// The corners of each ConnectionArrowEnum, in order.
+NODISCARD static const std::vector<glm::vec2> &getConnectionArrowShapes()
+{
+    static const std::vector<glm::vec2> shapes = []() {
+        std::vector<glm::vec2> result;
+        result.reserve(NUM_CONNECTION_ARROWS * VERTS_PER_TRI);
+        for (size_t i = 0; i < NUM_CONNECTION_ARROWS; ++i) {
+            const Tri tri = getConnectionArrow(static_cast<ConnectionArrowEnum>(i));
+            result.insert(result.end(), tri.begin(), tri.end());
+        }
+        return result;
+    }();
+    return shapes;
+}
+
+void ConnectionDrawer::drawConnStartTri(const ExitDirEnum startDir, const float srcZ)
+{
+    drawConnEndTri(startDir, 0, 0, srcZ);
 }
 
 void ConnectionDrawer::drawConnEndTri(const ExitDirEnum endDir,
@@ -511,27 +521,20 @@ void ConnectionDrawer::drawConnEndTri(const ExitDirEnum endDir,
                                       const float dstZ)
 {
     auto &gl = getFakeGL();
+    const glm::vec3 corner{dX, dY, dstZ};
 
     switch (endDir) {
     case ExitDirEnum::NORTH:
-        gl.drawTriangle(glm::vec3{dX + 0.82f, dY + 0.9f, dstZ},
-                        glm::vec3{dX + 0.68f, dY + 0.9f, dstZ},
-                        glm::vec3{dX + 0.75f, dY + 0.7f, dstZ});
+        gl.drawArrow(ConnectionArrowEnum::TWO_WAY_NORTH, corner);
         break;
     case ExitDirEnum::SOUTH:
-        gl.drawTriangle(glm::vec3{dX + 0.18f, dY + 0.1f, dstZ},
-                        glm::vec3{dX + 0.32f, dY + 0.1f, dstZ},
-                        glm::vec3{dX + 0.25f, dY + 0.3f, dstZ});
+        gl.drawArrow(ConnectionArrowEnum::TWO_WAY_SOUTH, corner);
         break;
     case ExitDirEnum::EAST:
-        gl.drawTriangle(glm::vec3{dX + 0.9f, dY + 0.68f, dstZ},
-                        glm::vec3{dX + 0.9f, dY + 0.82f, dstZ},
-                        glm::vec3{dX + 0.7f, dY + 0.75f, dstZ});
+        gl.drawArrow(ConnectionArrowEnum::TWO_WAY_EAST, corner);
         break;
     case ExitDirEnum::WEST:
-        gl.drawTriangle(glm::vec3{dX + 0.1f, dY + 0.32f, dstZ},
-                        glm::vec3{dX + 0.1f, dY + 0.18f, dstZ},
-                        glm::vec3{dX + 0.3f, dY + 0.25f, dstZ});
+        gl.drawArrow(ConnectionArrowEnum::TWO_WAY_WEST, corner);
         break;
 
     case ExitDirEnum::UP:
@@ -554,27 +557,20 @@ void ConnectionDrawer::drawConnEndTri1Way(const ExitDirEnum endDir,
                                           const float dstZ)
 {
     auto &gl = getFakeGL();
+    const glm::vec3 corner{dX, dY, dstZ};
 
     switch (endDir) {
     case ExitDirEnum::NORTH:
-        gl.drawTriangle(glm::vec3{dX + 0.32f, dY + 0.9f, dstZ},
-                        glm::vec3{dX + 0.18f, dY + 0.9f, dstZ},
-                        glm::vec3{dX + 0.25f, dY + 0.7f, dstZ});
+        gl.drawArrow(ConnectionArrowEnum::ONE_WAY_NORTH, corner);
         break;
     case ExitDirEnum::SOUTH:
-        gl.drawTriangle(glm::vec3{dX + 0.68f, dY + 0.1f, dstZ},
-                        glm::vec3{dX + 0.82f, dY + 0.1f, dstZ},
-                        glm::vec3{dX + 0.75f, dY + 0.3f, dstZ});
+        gl.drawArrow(ConnectionArrowEnum::ONE_WAY_SOUTH, corner);
         break;
     case ExitDirEnum::EAST:
-        gl.drawTriangle(glm::vec3{dX + 0.9f, dY + 0.18f, dstZ},
-                        glm::vec3{dX + 0.9f, dY + 0.32f, dstZ},
-                        glm::vec3{dX + 0.7f, dY + 0.25f, dstZ});
+        gl.drawArrow(ConnectionArrowEnum::ONE_WAY_EAST, corner);
         break;
     case ExitDirEnum::WEST:
-        gl.drawTriangle(glm::vec3{dX + 0.1f, dY + 0.82f, dstZ},
-                        glm::vec3{dX + 0.1f, dY + 0.68f, dstZ},
-                        glm::vec3{dX + 0.3f, dY + 0.75f, dstZ});
+        gl.drawArrow(ConnectionArrowEnum::ONE_WAY_WEST, corner);
         break;
 
     case ExitDirEnum::UP:
@@ -591,18 +587,16 @@ void ConnectionDrawer::drawConnEndTri1Way(const ExitDirEnum endDir,
 
 void ConnectionDrawer::drawConnEndTriUpDownUnknown(float dX, float dY, float dstZ)
 {
-    getFakeGL().drawTriangle(glm::vec3{dX + 0.5f, dY + 0.5f, dstZ},
-                             glm::vec3{dX + 0.55f, dY + 0.3f, dstZ},
-                             glm::vec3{dX + 0.7f, dY + 0.45f, dstZ});
+    getFakeGL().drawArrow(ConnectionArrowEnum::UP_DOWN_UNKNOWN, glm::vec3{dX, dY, dstZ});
 }
 
 ConnectionMeshes ConnectionDrawerBuffers::getMeshes(OpenGL &gl)
 {
     ConnectionMeshes result;
     result.normalLines = gl.createColoredLineBatch(normal.lineVerts);
-    result.normalTris = gl.createColoredTriBatch(normal.triVerts);
+    result.normalTris = gl.createPlainTriangleInstances(getConnectionArrowShapes(), normal.arrows);
     result.redLines = gl.createColoredLineBatch(red.lineVerts);
-    result.redTris = gl.createColoredTriBatch(red.triVerts);
+    result.redTris = gl.createPlainTriangleInstances(getConnectionArrowShapes(), red.arrows);
     return result;
 }
 
@@ -623,10 +617,16 @@ void ConnectionMeshes::render(const int thisLayer, const int focusedLayer)
     // the reason for having separate lines is so red will always be on top.
     // If you don't think that's important, you can combine the batches.
 
+    // The arrows have no color of their own, so it's folded into the uniform.
+    const auto modulate = [&color](const Color &arrowColor) {
+        return Color{color.getVec4() * arrowColor.getVec4()};
+    };
+
     normalLines.render(common_style);
-    normalTris.render(common_style);
+    normalTris.render(
+        common_style.withColor(modulate(getConfig().canvas.connectionNormalColor.getColor())));
     redLines.render(common_style);
-    redTris.render(common_style);
+    redTris.render(common_style.withColor(modulate(Colors::red)));
 }
 
 void MapCanvas::paintNearbyConnectionPoints()
@@ -754,21 +754,15 @@ NODISCARD static bool isLongLine(const glm::vec3 &a, const glm::vec3 &b)
     return glm::length(a - b) >= LONG_LINE_LEN;
 }
 
-void ConnectionDrawer::ConnectionFakeGL::drawTriangle(const glm::vec3 &a,
-                                                      const glm::vec3 &b,
-                                                      const glm::vec3 &c)
+void ConnectionDrawer::ConnectionFakeGL::drawArrow(const ConnectionArrowEnum arrow,
+                                                   const glm::vec3 &roomCorner)
 {
     if (m_measureOnly) {
-        m_expectedTriVerts[isNormal() ? 0 : 1] += 3;
+        ++m_expectedArrows[isNormal() ? 0 : 1];
         return;
     }
 
-    const auto &color = isNormal() ? getConfig().canvas.connectionNormalColor.getColor()
-                                   : Colors::red;
-    auto &verts = deref(m_currentBuffer).triVerts;
-    verts.emplace_back(color, a + m_offset);
-    verts.emplace_back(color, b + m_offset);
-    verts.emplace_back(color, c + m_offset);
+    deref(m_currentBuffer).arrows.emplace_back(roomCorner + m_offset, static_cast<float>(arrow));
 }
 
 void ConnectionDrawer::ConnectionFakeGL::drawLineStrip(const std::vector<glm::vec3> &points)
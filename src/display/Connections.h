@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
 #include <glm/glm.hpp>
 #include <unordered_map>
 #include <vector>
@@ -18,7 +19,9 @@
 #include "../mapdata/ExitDirection.h"
 #include "../opengl/Font.h"
 #include "../opengl/OpenGLTypes.h"
+#include "LabelDeclutter.h"
 
+class MapSnapshot;
 class OpenGL;
 class Room;
 
@@ -29,7 +32,7 @@ struct NODISCARD RoomNameBatch final
 
 public:
     RoomNameBatch() = default;
-    DELETE_CTORS_AND_ASSIGN_OPS(RoomNameBatch);
+    DEFAULT_MOVES_DELETE_COPIES(RoomNameBatch);
     ~RoomNameBatch() = default;
 
 public:
@@ -40,28 +43,43 @@ struct NODISCARD RoomNameBatch final
     NODISCARD size_t size() const { return m_names.size(); }
     void clear() { m_names.clear(); }
     NODISCARD bool empty() const { return m_names.empty(); }
+    NODISCARD const std::vector<GLText> &getNames() const { return m_names; }
 
 public:
-    NODISCARD UniqueMesh getMesh(GLFont &font);
+    NODISCARD ZoomedTextMeshes getMesh(GLFont &font);
 };
 
-using BatchedRoomNames = std::unordered_map<int, UniqueMesh>;
+// The arrow triangles at either end of a connection; see getConnectionArrowShapes().
+enum class NODISCARD ConnectionArrowEnum : uint8_t {
+    TWO_WAY_NORTH,
+    TWO_WAY_SOUTH,
+    TWO_WAY_EAST,
+    TWO_WAY_WEST,
+    ONE_WAY_NORTH,
+    ONE_WAY_SOUTH,
+    ONE_WAY_EAST,
+    ONE_WAY_WEST,
+    UP_DOWN_UNKNOWN
+};
+static constexpr const size_t NUM_CONNECTION_ARROWS = 9;
 
 struct NODISCARD ConnectionDrawerColorBuffer final
 {
     std::vector<ColorVert> lineVerts;
-    std::vector<ColorVert> triVerts;
+    // xyz is the corner of the room the arrow is drawn in, and w its ConnectionArrowEnum;
+    // the GPU turns each one into a triangle.
+    std::vector<glm::vec4> arrows;
 
     ConnectionDrawerColorBuffer() = default;
-    DELETE_CTORS_AND_ASSIGN_OPS(ConnectionDrawerColorBuffer);
+    DEFAULT_MOVES_DELETE_COPIES(ConnectionDrawerColorBuffer);
     ~ConnectionDrawerColorBuffer() = default;
 
     void clear()
     {
         lineVerts.clear();
-        triVerts.clear();
+        arrows.clear();
     }
-    NODISCARD bool empty() const { return lineVerts.empty() && triVerts.empty(); }
+    NODISCARD bool empty() const { return lineVerts.empty() && arrows.empty(); }
 };
 
 struct NODISCARD ConnectionMeshes final
@@ -84,7 +102,7 @@ struct NODISCARD ConnectionDrawerBuffers final
     ConnectionDrawerColorBuffer red;
 
     ConnectionDrawerBuffers() = default;
-    DELETE_CTORS_AND_ASSIGN_OPS(ConnectionDrawerBuffers);
+    DEFAULT_MOVES_DELETE_COPIES(ConnectionDrawerBuffers);
     ~ConnectionDrawerBuffers() = default;
 
     void clear()
@@ -108,7 +126,7 @@ struct NODISCARD ConnectionDrawer final
         glm::vec3 m_offset{0.f};
         bool m_measureOnly = true;
 
-        MMapper::Array<size_t, 2> m_expectedTriVerts;
+        MMapper::Array<size_t, 2> m_expectedArrows;
         MMapper::Array<size_t, 2> m_expectedLineVerts;
 
     public:
@@ -127,17 +145,17 @@ struct NODISCARD ConnectionDrawer final
 
             assert(m_buffers.empty());
             m_buffers.normal.lineVerts.reserve(m_expectedLineVerts[0]);
-            m_buffers.normal.triVerts.reserve(m_expectedTriVerts[0]);
+            m_buffers.normal.arrows.reserve(m_expectedArrows[0]);
             m_buffers.red.lineVerts.reserve(m_expectedLineVerts[1]);
-            m_buffers.red.triVerts.reserve(m_expectedTriVerts[1]);
+            m_buffers.red.arrows.reserve(m_expectedArrows[1]);
         }
 
         void verify()
         {
             assert(m_buffers.normal.lineVerts.size() == m_expectedLineVerts[0]);
-            assert(m_buffers.normal.triVerts.size() == m_expectedTriVerts[0]);
+            assert(m_buffers.normal.arrows.size() == m_expectedArrows[0]);
             assert(m_buffers.red.lineVerts.size() == m_expectedLineVerts[1]);
-            assert(m_buffers.red.triVerts.size() == m_expectedTriVerts[1]);
+            assert(m_buffers.red.arrows.size() == m_expectedArrows[1]);
         }
 
     public:
@@ -147,7 +165,7 @@ struct NODISCARD ConnectionDrawer final
         bool isNormal() const { return m_currentBuffer == &m_buffers.normal; }
 
     public:
-        void drawTriangle(const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c);
+        void drawArrow(ConnectionArrowEnum arrow, const glm::vec3 &roomCorner);
         void drawLineStrip(const std::vector<glm::vec3> &points);
     };
 
@@ -194,7 +212,7 @@ struct NODISCARD ConnectionDrawer final
 
     NODISCARD ConnectionFakeGL &getFakeGL() { return m_fake; }
 
-    void drawRoomConnectionsAndDoors(const Room *room, const RoomIndex &rooms);
+    void drawRoomConnectionsAndDoors(const Room *room, const MapSnapshot &rooms);
 
     void drawRoomDoorName(const Room *sourceRoom,
                           ExitDirEnum sourceDir,
@@ -235,6 +253,3 @@ struct NODISCARD ConnectionDrawer final
                                  float srcZ,
                                  float dstZ);
 };
-
-using BatchedConnections = std::unordered_map<int, ConnectionDrawerBuffers>;
-using BatchedConnectionMeshes = std::unordered_map<int, ConnectionMeshes>;
@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "FrameScheduler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <QScreen>
+#include <QWidget>
+#include <QWindow>
+
+FrameScheduler::FrameScheduler(QWidget &widget)
+    : m_widget{widget}
+{
+    m_timer.setSingleShot(true);
+    m_timer.setTimerType(Qt::PreciseTimer);
+    QObject::connect(&m_timer, &QTimer::timeout, &m_widget, [this]() { m_widget.update(); });
+}
+
+void FrameScheduler::requestFrame()
+{
+    if (m_timer.isActive()) {
+        // This request is coalesced with the one that's already waiting.
+        return;
+    }
+
+    const int interval = getFrameIntervalMs();
+    const qint64 elapsed = m_sinceLastFrame.isValid() ? m_sinceLastFrame.elapsed() : interval;
+    m_timer.start(static_cast<int>(std::max<qint64>(0, interval - elapsed)));
+}
+
+bool FrameScheduler::isIdle() const
+{
+    const QWidget *const window = m_widget.window();
+    if (!m_widget.isVisible() || window->isMinimized())
+        return true;
+
+    const QWindow *const handle = window->windowHandle();
+    return handle != nullptr && !handle->isExposed();
+}
+
+int FrameScheduler::getFrameIntervalMs() const
+{
+    if (isIdle())
+        return IDLE_INTERVAL_MS;
+
+    const QScreen *const screen = m_widget.screen();
+    const qreal refreshRate = (screen != nullptr) ? screen->refreshRate() : 60.0;
+    if (!std::isfinite(refreshRate) || refreshRate < 1.0)
+        return 1000 / 60;
+    return std::max(1, static_cast<int>(std::lround(1000.0 / refreshRate)));
+}
@@ -0,0 +1,43 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <QElapsedTimer>
+#include <QTimer>
+
+#include "../global/RuleOf5.h"
+#include "../global/macros.h"
+
+class QWidget;
+
+/**
+ * Turns any number of repaint requests into at most one QWidget::update()
+ * per refresh of the screen the widget is on, so things like a whole group
+ * sending prompt updates don't repaint the canvas more often than it can be
+ * seen. While the window is minimized or covered, it only repaints at
+ * IDLE_INTERVAL_MS.
+ */
+class NODISCARD FrameScheduler final
+{
+public:
+    static constexpr const int IDLE_INTERVAL_MS = 500;
+
+private:
+    QWidget &m_widget;
+    QTimer m_timer;
+    QElapsedTimer m_sinceLastFrame;
+
+public:
+    explicit FrameScheduler(QWidget &widget);
+    ~FrameScheduler() = default;
+    DELETE_CTORS_AND_ASSIGN_OPS(FrameScheduler);
+
+public:
+    void requestFrame();
+    // Call this from paintGL().
+    void onFramePainted() { m_sinceLastFrame.start(); }
+    NODISCARD int getFrameIntervalMs() const;
+
+private:
+    NODISCARD bool isIdle() const;
+};
@@ -56,7 +56,7 @@ InfoMarkSelection::InfoMarkSelection(this_is_private,
         return isCoordInSelection(pos2);
     };
 
-    for (const auto &marker : mapData.getMarkersList()) {
+    for (const auto &marker : mapData.getMarkerCandidates(m_sel1, m_sel2)) {
         if (isMarkerInSelection(marker)) {
             emplace_back(marker);
         }
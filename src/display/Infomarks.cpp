@@ -6,6 +6,7 @@
 #include <cassert>
 #include <glm/glm.hpp>
 #include <optional>
+#include <set>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -88,50 +89,34 @@ NODISCARD static FontFormatFlags getFontFormatFlags(const InfoMarkClassEnum info
     return {};
 }
 
-BatchedInfomarksMeshes MapCanvas::getInfoMarksMeshes()
+InfomarkSnapshot::InfomarkSnapshot(const InfoMark &mark)
 {
-    // REVISIT: Infomarks uses QLinkedList. Linked list iteration can be
-    // an order of magnitude slower than vector iteration.
-    //
-    // Consider converting the infomarks data structure to std::vector.
-
-    BatchedInfomarksMeshes result;
-    {
-        for (const auto &mark : m_data.getMarkersList()) {
-            const int layer = mark->getPosition1().z;
-            const auto it = result.find(layer);
-            if (it == result.end())
-                result[layer]; // side effect: this creates the entry
-        }
-    }
+#define COPY_FIELD(_Type, _Prop, _OptInit) _Prop = mark.get##_Prop();
+    X_FOREACH_INFOMARK_PROPERTY(COPY_FIELD)
+#undef COPY_FIELD
+}
 
-    if (result.size() >= 30)
-        qWarning() << "Infomarks span" << result.size()
-                   << "layers. Consider using a different algorithm if this function is too slow.";
-
-    // WARNING: This is O(layers) * O(markers), which is okay as long
-    // as the number of layers with infomarks is small.
-    //
-    // If the performance gets too bad, count # in each layer,
-    // allocate vectors, fill the vectors, and then only visit
-    // each one once per layer.
-    for (auto &it : result) {
-        const int layer = it.first;
-        InfomarksBatch batch{getOpenGL(), getGLFont()};
-        for (int i = 0; i < 2; ++i) {
-            for (const auto &m : m_data.getMarkersList()) {
-                drawInfoMark(batch, m.get(), layer);
-            }
-            if (i == 0)
-                batch.endMeasure();
-            else
-                batch.verify();
-        }
+bool InfomarkSnapshot::operator==(const InfomarkSnapshot &rhs) const
+{
+#define COMPARE_FIELD(_Type, _Prop, _OptInit) &&_Prop == rhs._Prop
+    return true X_FOREACH_INFOMARK_PROPERTY(COMPARE_FIELD);
+#undef COMPARE_FIELD
+}
 
-        it.second = batch.getMeshes();
+InfomarksMeshes MapCanvas::getInfoMarksMeshes(const int layer)
+{
+    InfomarksBatch batch{getOpenGL(), getGLFont()};
+    for (int i = 0; i < 2; ++i) {
+        for (const auto &m : m_data.getMarkersOnLayer(layer)) {
+            drawInfoMark(batch, m.get(), layer);
+        }
+        if (i == 0)
+            batch.endMeasure();
+        else
+            batch.verify();
     }
 
-    return result;
+    return batch.getMeshes();
 }
 
 void InfomarksBatch::drawPoint(const glm::vec3 &a)
@@ -213,7 +198,7 @@ InfomarksMeshes InfomarksBatch::getMeshes()
     result.points = gl.createPointBatch(m_points);
     result.lines = gl.createColoredLineBatch(m_lines);
     result.tris = gl.createColoredTriBatch(m_tris);
-    result.textMesh = m_font.getFontMesh(m_text);
+    result.textMeshes = ZoomedTextMeshes{m_font, m_text};
     result.isValid = true;
 
     return result;
@@ -236,7 +221,7 @@ void InfomarksBatch::renderImmediate(const GLRenderState &state)
         gl.renderPoints(m_points, state.withPointSize(INFOMARK_POINT_SIZE));
 }
 
-void InfomarksMeshes::render()
+void InfomarksMeshes::render(const float zoom)
 {
     if (!isValid)
         return;
@@ -247,7 +232,7 @@ void InfomarksMeshes::render()
     points.render(common_state.withPointSize(INFOMARK_POINT_SIZE));
     lines.render(common_state.withLineParams(LineParams{INFOMARK_ARROW_LINE_WIDTH}));
     tris.render(common_state);
-    textMesh.render(common_state);
+    textMeshes.render(common_state, zoom);
 }
 
 void MapCanvas::drawInfoMark(InfomarksBatch &batch,
@@ -263,8 +248,7 @@ void MapCanvas::drawInfoMark(InfomarksBatch &batch,
 
     const int layer = marker->getPosition1().z;
     if (layer != currentLayer) {
-        // REVISIT: consider storing infomarks by level
-        // so we don't have to test here.
+        // The selection isn't bucketed by layer.
         return;
     }
 
@@ -386,7 +370,7 @@ void MapCanvas::paintSelectedInfoMarks()
                 drawPoint(pos2, color);
             };
 
-            for (const auto &marker : m_data.getMarkersList()) {
+            for (const auto &marker : m_data.getMarkersOnLayer(m_currentLayer)) {
                 drawSelectionPoints(marker.get());
             }
         }
@@ -404,25 +388,62 @@ void MapCanvas::paintSelectedInfoMarks()
 
 void MapCanvas::paintBatchedInfomarks()
 {
-    const auto wantInfoMarks = (getTotalScaleFactor() >= getConfig().canvas.infomarkScaleCutoff);
+    const float zoom = getTotalScaleFactor();
+    const auto wantInfoMarks = (zoom >= getConfig().canvas.infomarkScaleCutoff);
     if (!wantInfoMarks || !m_batches.infomarksMeshes.has_value()) {
         return;
     }
 
-    BatchedInfomarksMeshes &map = m_batches.infomarksMeshes.value();
+    auto &map = m_batches.infomarksMeshes.value().layers;
     const auto it = map.find(static_cast<int>(m_currentLayer));
     if (it == map.end())
         return;
 
     InfomarksMeshes &infomarksMeshes = it->second;
-    infomarksMeshes.render();
+    infomarksMeshes.render(zoom);
 }
 
 void MapCanvas::updateInfomarkBatches()
 {
     std::optional<BatchedInfomarksMeshes> &opt_infomarks = m_batches.infomarksMeshes;
-    if (opt_infomarks.has_value())
+    if (opt_infomarks.has_value() && !m_infomarksChanged)
         return;
 
-    opt_infomarks.emplace(getInfoMarksMeshes());
+    m_infomarksChanged = false;
+    BatchedInfomarksMeshes &batched = opt_infomarks.has_value() ? opt_infomarks.value()
+                                                               : opt_infomarks.emplace();
+
+    std::set<int> occupiedLayers;
+    std::set<int> dirtyLayers;
+    std::unordered_map<const InfoMark *, InfomarkSnapshot> snapshots;
+    snapshots.reserve(batched.snapshots.size());
+    for (const auto &mark : m_data.getMarkersList()) {
+        InfomarkSnapshot snapshot{deref(mark)};
+        const int layer = snapshot.Position1.z;
+        occupiedLayers.insert(layer);
+        if (const auto it = batched.snapshots.find(mark.get()); it == batched.snapshots.end()) {
+            dirtyLayers.insert(layer);
+        } else {
+            if (it->second != snapshot) {
+                dirtyLayers.insert(it->second.Position1.z);
+                dirtyLayers.insert(layer);
+            }
+            batched.snapshots.erase(it);
+        }
+        snapshots.emplace(mark.get(), std::move(snapshot));
+    }
+
+    // What's left was removed.
+    for (const auto &kv : batched.snapshots) {
+        dirtyLayers.insert(kv.second.Position1.z);
+    }
+    batched.snapshots = std::move(snapshots);
+
+    for (const int layer : dirtyLayers) {
+        if (occupiedLayers.count(layer) == 0) {
+            batched.layers.erase(layer);
+        } else {
+            batched.layers[layer] = getInfoMarksMeshes(layer);
+        }
+    }
 }
@@ -11,9 +11,11 @@
 
 #include "../global/Color.h"
 #include "../global/utils.h"
+#include "../mapdata/infomark.h"
 #include "../opengl/Font.h"
 #include "../opengl/FontFormatFlags.h"
 #include "../opengl/OpenGLTypes.h"
+#include "LabelDeclutter.h"
 
 class OpenGL;
 
@@ -22,12 +24,33 @@ struct NODISCARD InfomarksMeshes final
     UniqueMesh points;
     UniqueMesh lines;
     UniqueMesh tris;
-    UniqueMesh textMesh;
+    ZoomedTextMeshes textMeshes;
     bool isValid = false;
-    void render();
+    void render(float zoom);
 };
 
-using BatchedInfomarksMeshes = std::unordered_map<int, InfomarksMeshes>;
+// What an infomark looked like when its layer's meshes were built.
+struct NODISCARD InfomarkSnapshot final
+{
+#define DECL_FIELD(_Type, _Prop, _OptInit) _Type _Prop _OptInit;
+    X_FOREACH_INFOMARK_PROPERTY(DECL_FIELD)
+#undef DECL_FIELD
+
+    explicit InfomarkSnapshot(const InfoMark &mark);
+    NODISCARD bool operator==(const InfomarkSnapshot &rhs) const;
+    NODISCARD bool operator!=(const InfomarkSnapshot &rhs) const { return !(*this == rhs); }
+};
+
+// The meshes of each layer that has infomarks.
+//
+// Infomarks don't say what changed, so each update compares every marker with
+// its snapshot, and then only rebuilds the layers that a marker was added to,
+// removed from, or changed on.
+struct NODISCARD BatchedInfomarksMeshes final
+{
+    std::unordered_map<int, InfomarksMeshes> layers;
+    std::unordered_map<const InfoMark *, InfomarkSnapshot> snapshots;
+};
 
 struct NODISCARD InfomarksBatch final
 {
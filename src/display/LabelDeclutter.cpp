@@ -0,0 +1,144 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "LabelDeclutter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_set>
+
+#include "../global/utils.h"
+#include "../opengl/FontFormatFlags.h"
+
+namespace { // anonymous
+
+constexpr const float FIRST_LEVEL_ZOOM = 1.f / 16.f;
+constexpr const int NUM_LEVELS = 7;
+
+struct NODISCARD CellRange final
+{
+    int x0 = 0;
+    int x1 = 0;
+    int y0 = 0;
+    int y1 = 0;
+};
+
+NODISCARD uint64_t getCellKey(const int x, const int y)
+{
+    return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32u)
+           | static_cast<uint64_t>(static_cast<uint32_t>(y));
+}
+
+NODISCARD CellRange getCells(const LabelFootprint &label,
+                             const float roomsPerPixel,
+                             const float cellRooms)
+{
+    const glm::vec2 size = label.sizePixels * roomsPerPixel;
+    const glm::vec2 lo{label.pos.x - size.x * label.anchor, label.pos.y - size.y * 0.5f};
+    const glm::vec2 hi = lo + size;
+    const auto cell = [cellRooms](const float v) -> int {
+        return static_cast<int>(std::floor(v / cellRooms));
+    };
+    return CellRange{cell(lo.x), cell(hi.x), cell(lo.y), cell(hi.y)};
+}
+
+} // namespace
+
+std::vector<float> getLabelMinZooms(const std::vector<LabelFootprint> &labels,
+                                    const float cellPixels)
+{
+    const float lastZoom = FIRST_LEVEL_ZOOM * std::exp2(static_cast<float>(NUM_LEVELS - 1));
+    std::vector<float> result(labels.size(), lastZoom);
+    std::vector<bool> placed(labels.size(), false);
+    size_t numPlaced = 0;
+
+    std::unordered_set<uint64_t> taken;
+    float zoom = FIRST_LEVEL_ZOOM;
+    for (int level = 0; level < NUM_LEVELS - 1 && numPlaced < labels.size(); ++level) {
+        const float roomsPerPixel = 1.f / (ROOM_PIXELS_AT_UNIT_ZOOM * zoom);
+        const float cellRooms = std::max(cellPixels, 1.f) * roomsPerPixel;
+        const auto isFree = [&taken](const CellRange &r) -> bool {
+            for (int y = r.y0; y <= r.y1; ++y) {
+                for (int x = r.x0; x <= r.x1; ++x) {
+                    if (taken.count(getCellKey(x, y)) != 0)
+                        return false;
+                }
+            }
+            return true;
+        };
+        const auto take = [&taken](const CellRange &r) {
+            for (int y = r.y0; y <= r.y1; ++y) {
+                for (int x = r.x0; x <= r.x1; ++x)
+                    taken.insert(getCellKey(x, y));
+            }
+        };
+
+        // The labels placed at lower levels can't overlap each other here.
+        taken.clear();
+        for (size_t i = 0; i < labels.size(); ++i) {
+            if (placed[i])
+                take(getCells(labels[i], roomsPerPixel, cellRooms));
+        }
+        for (size_t i = 0; i < labels.size(); ++i) {
+            if (placed[i])
+                continue;
+            const CellRange cells = getCells(labels[i], roomsPerPixel, cellRooms);
+            if (!isFree(cells))
+                continue;
+            take(cells);
+            placed[i] = true;
+            ++numPlaced;
+            // Below the first level, the canvas' own text cutoffs take over.
+            result[i] = (level == 0) ? 0.f : zoom;
+        }
+        zoom *= 2.f;
+    }
+    return result;
+}
+
+ZoomedTextMeshes::ZoomedTextMeshes(GLFont &font, const std::vector<GLText> &text)
+{
+    if (text.empty())
+        return;
+
+    std::vector<LabelFootprint> labels;
+    labels.reserve(text.size());
+    float cellPixels = 0.f;
+    for (const GLText &glText : text) {
+        LabelFootprint &label = labels.emplace_back();
+        label.pos = glm::vec2{glText.pos};
+        label.sizePixels = font.measureText(glText.text);
+        if (glText.fontFormatFlag.contains(FontFormatFlagEnum::HALIGN_CENTER))
+            label.anchor = 0.5f;
+        else if (glText.fontFormatFlag.contains(FontFormatFlagEnum::HALIGN_RIGHT))
+            label.anchor = 1.f;
+        cellPixels = std::max(cellPixels, label.sizePixels.y);
+    }
+
+    const std::vector<float> minZooms = getLabelMinZooms(labels, cellPixels);
+    std::vector<float> zooms = minZooms;
+    std::sort(zooms.begin(), zooms.end());
+    zooms.erase(std::unique(zooms.begin(), zooms.end()), zooms.end());
+
+    m_groups.reserve(zooms.size());
+    std::vector<GLText> groupText;
+    for (const float minZoom : zooms) {
+        groupText.clear();
+        for (size_t i = 0; i < text.size(); ++i) {
+            if (utils::equals(minZooms[i], minZoom))
+                groupText.push_back(text[i]);
+        }
+        m_groups.push_back(Group{minZoom, font.getFontMesh(groupText)});
+    }
+}
+
+void ZoomedTextMeshes::render(const GLRenderState &state, const float zoom)
+{
+    for (Group &group : m_groups) {
+        if (group.minZoom > zoom)
+            break;
+        group.mesh.render(state);
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "../global/RuleOf5.h"
+#include "../global/macros.h"
+#include "../opengl/Font.h"
+#include "../opengl/OpenGLTypes.h"
+
+// About how many logical pixels wide a room is at a zoom of 1; see MapCanvas::getViewProj().
+static constexpr const float ROOM_PIXELS_AT_UNIT_ZOOM = 44.f;
+
+// Where a label is, in rooms, and how big it is on screen, in logical pixels.
+// Text is drawn at a fixed pixel size, so it covers fewer rooms as the zoom grows.
+struct NODISCARD LabelFootprint final
+{
+    glm::vec2 pos{0.f};
+    glm::vec2 sizePixels{0.f};
+    // How far along the label's width its anchor is: 0 (left) to 1 (right).
+    float anchor = 0.f;
+};
+
+/**
+ * The lowest zoom at which each label is drawn.
+ *
+ * The zoom levels double, starting from well below any of the text cutoffs.
+ * At each level the labels are dropped, in order, onto a grid of cells a line
+ * of text high; one that overlaps a cell that's already taken waits for the
+ * next level, so later labels give way to earlier ones. The cells of a level
+ * nest inside those of the level before, so a label that's drawn at one zoom
+ * is drawn at every higher one. Whatever is left is drawn from the last level.
+ */
+NODISCARD std::vector<float> getLabelMinZooms(const std::vector<LabelFootprint> &labels,
+                                              float cellPixels);
+
+// Text meshes grouped by the lowest zoom they're drawn at, in ascending order,
+// so a frame skips each group that's still too far out with one comparison.
+struct NODISCARD ZoomedTextMeshes final
+{
+private:
+    struct NODISCARD Group final
+    {
+        float minZoom = 0.f;
+        UniqueMesh mesh;
+    };
+    std::vector<Group> m_groups;
+
+public:
+    ZoomedTextMeshes() = default;
+    explicit ZoomedTextMeshes(GLFont &font, const std::vector<GLText> &text);
+    DEFAULT_MOVES_DELETE_COPIES(ZoomedTextMeshes);
+    ~ZoomedTextMeshes() = default;
+
+public:
+    NODISCARD bool empty() const { return m_groups.empty(); }
+    void render(const GLRenderState &state, float zoom);
+};
@@ -0,0 +1,96 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "MapBatchBuilder.h"
+
+#include <stdexcept>
+#include <utility>
+
+#include "../global/utils.h"
+
+MapBatchBuilder::MapBatchBuilder(const MapCanvasTextures &textures, QObject *const parent)
+    : QObject(parent)
+    , m_textures{textures}
+{
+    m_thread = std::thread([this]() { run(); });
+}
+
+MapBatchBuilder::~MapBatchBuilder()
+{
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_stopping.store(true, std::memory_order_relaxed);
+    }
+    m_wakeUp.notify_one();
+    m_thread.join();
+}
+
+bool MapBatchBuilder::isBusy()
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    return m_busy;
+}
+
+void MapBatchBuilder::build(SharedMapSnapshot snapshot,
+                            const OptBounds &bounds,
+                            std::optional<MeshChunkIdSet> chunks,
+                            const FullDetailLayers &detailLayers)
+{
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        if (m_busy) {
+            throw std::runtime_error("already building");
+        }
+        m_busy = true;
+        m_pending.emplace(Request{std::move(snapshot), bounds, std::move(chunks), detailLayers});
+    }
+    m_wakeUp.notify_one();
+}
+
+std::chrono::nanoseconds MapBatchBuilder::getLastBuildTime()
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    return m_lastBuildTime;
+}
+
+std::optional<MapBatchesData> MapBatchBuilder::takeFinished()
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    if (!m_finished.has_value()) {
+        return std::nullopt;
+    }
+    m_busy = false;
+    return std::exchange(m_finished, std::nullopt);
+}
+
+void MapBatchBuilder::run()
+{
+    while (true) {
+        std::optional<Request> request;
+        {
+            std::unique_lock<std::mutex> lock{m_mutex};
+            m_wakeUp.wait(lock, [this]() {
+                return m_stopping.load(std::memory_order_relaxed) || m_pending.has_value();
+            });
+            if (m_stopping.load(std::memory_order_relaxed)) {
+                return;
+            }
+            request = std::exchange(m_pending, std::nullopt);
+        }
+
+        using Clock = std::chrono::steady_clock;
+        const auto start = Clock::now();
+        const Request &r = request.value();
+        MapBatchesData data = ::generateMapBatchesData(deref(r.snapshot),
+                                                       m_textures,
+                                                       r.bounds,
+                                                       r.chunks,
+                                                       r.detailLayers);
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            m_finished.emplace(std::move(data));
+            m_lastBuildTime = Clock::now() - start;
+        }
+        emit sig_finished();
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <QObject>
+#include <QtCore>
+
+#include "../expandoracommon/MeshChunk.h"
+#include "../expandoracommon/coordinate.h"
+#include "../global/RuleOf5.h"
+#include "../global/macros.h"
+#include "../mapdata/MapSnapshot.h"
+#include "MapCanvasRoomDrawer.h"
+
+struct MapCanvasTextures;
+
+/**
+ * Generates the vertices of the map batches from a snapshot on a worker
+ * thread, so that paintGL() only has to upload them.
+ *
+ * It works on one request at a time: build() may only be called when
+ * isBusy() is false, and the result stays here until takeFinished().
+ * sig_finished() is emitted from the worker thread.
+ */
+class MapBatchBuilder final : public QObject
+{
+    Q_OBJECT
+
+private:
+    struct NODISCARD Request final
+    {
+        SharedMapSnapshot snapshot;
+        OptBounds bounds;
+        std::optional<MeshChunkIdSet> chunks;
+        FullDetailLayers detailLayers;
+    };
+
+    const MapCanvasTextures &m_textures;
+    std::mutex m_mutex;
+    std::condition_variable m_wakeUp;
+    std::optional<Request> m_pending;
+    std::optional<MapBatchesData> m_finished;
+    // Set from build() until takeFinished().
+    bool m_busy = false;
+    // How long the worker spent on the last finished build.
+    std::chrono::nanoseconds m_lastBuildTime{};
+    std::atomic_bool m_stopping{false};
+    std::thread m_thread;
+
+public:
+    // The textures must outlive the builder.
+    explicit MapBatchBuilder(const MapCanvasTextures &textures, QObject *parent = nullptr);
+    ~MapBatchBuilder() final;
+    DELETE_CTORS_AND_ASSIGN_OPS(MapBatchBuilder);
+
+public:
+    NODISCARD bool isBusy();
+    // Builds every chunk of the snapshot, or only the given ones.
+    void build(SharedMapSnapshot snapshot,
+               const OptBounds &bounds,
+               std::optional<MeshChunkIdSet> chunks,
+               const FullDetailLayers &detailLayers);
+    NODISCARD std::optional<MapBatchesData> takeFinished();
+    NODISCARD std::chrono::nanoseconds getLastBuildTime();
+
+signals:
+    void sig_finished();
+
+private:
+    void run();
+};
@@ -16,5 +16,7 @@ NODISCARD extern bool isAutoTilt();
 extern void setAutoTilt(bool val);
 NODISCARD extern bool getShowPerfStats();
 extern void setShowPerfStats(bool);
+NODISCARD extern bool isAdaptiveQuality();
+extern void setAdaptiveQuality(bool);
 
 } // namespace MapCanvasConfig
@@ -4,6 +4,9 @@
 
 #include "MapCanvasData.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <optional>
 #include <QPointF>
 
@@ -47,6 +50,33 @@ std::optional<glm::vec3> MapCanvasViewport::project(const glm::vec3 &v) const
     return mouse_depth;
 }
 
+bool MapCanvasViewport::isBoxVisible(const glm::vec3 &min,
+                                     const glm::vec3 &max,
+                                     const float marginPixels) const
+{
+    // NDC spans 2 units across the viewport.
+    const float mx = 1.f + 2.f * marginPixels / static_cast<float>(std::max(1, width()));
+    const float my = 1.f + 2.f * marginPixels / static_cast<float>(std::max(1, height()));
+
+    // The box is hidden if every corner is outside the same clip plane.
+    uint32_t allOutside = 0x3Fu;
+    for (uint32_t i = 0; i < 8; ++i) {
+        const glm::vec3 corner{(i & 1u) ? max.x : min.x,
+                               (i & 2u) ? max.y : min.y,
+                               (i & 4u) ? max.z : min.z};
+        const glm::vec4 c = m_viewProj * glm::vec4{corner, 1.f};
+        uint32_t outside = 0;
+        outside |= (c.x < -mx * c.w) ? 0x01u : 0u;
+        outside |= (c.x > mx * c.w) ? 0x02u : 0u;
+        outside |= (c.y < -my * c.w) ? 0x04u : 0u;
+        outside |= (c.y > my * c.w) ? 0x08u : 0u;
+        outside |= (c.z < -c.w) ? 0x10u : 0u;
+        outside |= (c.z > c.w) ? 0x20u : 0u;
+        allOutside &= outside;
+    }
+    return allOutside == 0;
+}
+
 // input: 2d mouse coordinates clamped in viewport_offset + [0..viewport_size]
 // and a depth value in the range 0..1.
 //
@@ -210,6 +240,9 @@ MapScreen::VisiblityResultEnum MapScreen::testVisibility(const glm::vec3 &input_
         return VisiblityResultEnum::ON_MARGIN;
 }
 
+// 23 bits of mantissa.
+static constexpr const int MAX_PROXY_STEPS = 23;
+
 glm::vec3 MapScreen::getProxyLocation(const glm::vec3 &input_pos, const float marginPixels) const
 {
     const auto center = this->getCenter();
@@ -226,7 +259,7 @@ glm::vec3 MapScreen::getProxyLocation(const glm::vec3 &input_pos, const float ma
 
     float proxyFraction = 0.5f;
     float stepFraction = 0.25f;
-    constexpr int maxSteps = 23;
+    constexpr int maxSteps = MAX_PROXY_STEPS;
     glm::vec3 bestInside = center;
     float bestInsideFraction = 0.f;
     // clang-tidy is confused here. The loop induction variable is an integer.
@@ -258,3 +291,179 @@ glm::vec3 MapScreen::getProxyLocation(const glm::vec3 &input_pos, const float ma
     // Here's our best guess.
     return bestInside;
 }
+
+void MapScreen::Batch::clear()
+{
+    m_x.clear();
+    m_y.clear();
+    m_z.clear();
+}
+
+void MapScreen::Batch::add(const glm::vec3 &pos)
+{
+    m_x.push_back(pos.x);
+    m_y.push_back(pos.y);
+    m_z.push_back(pos.z);
+}
+
+void MapScreen::testVisibility(Batch &batch, const float marginPixels) const
+{
+    assert(marginPixels >= 1.f);
+
+    const size_t count = batch.m_x.size();
+    batch.m_results.resize(count);
+
+    const glm::mat4 &m = m_viewport.m_viewProj;
+    const glm::vec2 size{m_viewport.getViewport().size};
+    const glm::vec2 half_size = size * 0.5f;
+    const float floorMargin = std::floor(marginPixels);
+    const float ceilMargin = floorMargin + 1.f;
+    const float limit = 1.f + 1e-5f;
+
+    const float *const xs = batch.m_x.data();
+    const float *const ys = batch.m_y.data();
+    const float *const zs = batch.m_z.data();
+    VisiblityResultEnum *const results = batch.m_results.data();
+
+    // The same tests as MapCanvasViewport::project() and the single position version,
+    // written without early outs so the compiler can vectorize the loop.
+    for (size_t i = 0; i < count; ++i) {
+        const float x = xs[i];
+        const float y = ys[i];
+        const float z = zs[i];
+        const float cx = m[0][0] * x + m[1][0] * y + m[2][0] * z + m[3][0];
+        const float cy = m[0][1] * x + m[1][1] * y + m[2][1] * z + m[3][1];
+        const float cz = m[0][2] * x + m[1][2] * y + m[2][2] * z + m[3][2];
+        const float cw = m[0][3] * x + m[1][3] * y + m[2][3] * z + m[3][3];
+
+        const bool degenerate = std::abs(cw) < 1e-6f;
+        const float inv = degenerate ? 0.f : 1.f / cw;
+        const float nx = cx * inv;
+        const float ny = cy * inv;
+        const float nz = cz * inv;
+        const bool offScreen = degenerate || std::abs(nx) > limit || std::abs(ny) > limit
+                               || std::abs(nz) > limit;
+
+        const float sx = std::clamp(nx * 0.5f + 0.5f, 0.f, 1.f) * size.x;
+        const float sy = std::clamp(ny * 0.5f + 0.5f, 0.f, 1.f) * size.y;
+        const float dist = std::min(half_size.x - std::abs(sx - half_size.x),
+                                    half_size.y - std::abs(sy - half_size.y));
+
+        if (offScreen)
+            results[i] = VisiblityResultEnum::OFF_SCREEN;
+        else if (dist < floorMargin)
+            results[i] = VisiblityResultEnum::OUTSIDE_MARGIN;
+        else if (dist > ceilMargin)
+            results[i] = VisiblityResultEnum::INSIDE_MARGIN;
+        else
+            results[i] = VisiblityResultEnum::ON_MARGIN;
+    }
+}
+
+void MapScreen::areRoomsVisible(const std::vector<Coordinate> &rooms,
+                                const float marginPixels,
+                                std::vector<bool> &visible,
+                                Batch &batch) const
+{
+    batch.clear();
+    for (const Coordinate &c : rooms) {
+        const auto pos = c.to_vec3();
+        for (int i = 0; i < 4; ++i) {
+            const glm::vec3 offset{static_cast<float>(i & 1),
+                                   static_cast<float>((i >> 1) & 1),
+                                   0.f};
+            batch.add(pos + offset);
+        }
+    }
+    testVisibility(batch, marginPixels);
+
+    visible.resize(rooms.size());
+    for (size_t room = 0; room < rooms.size(); ++room) {
+        bool result = true;
+        for (size_t i = 0; i < 4; ++i) {
+            switch (batch.m_results[room * 4 + i]) {
+            case VisiblityResultEnum::INSIDE_MARGIN:
+            case VisiblityResultEnum::ON_MARGIN:
+                break;
+
+            case VisiblityResultEnum::OUTSIDE_MARGIN:
+            case VisiblityResultEnum::OFF_SCREEN:
+                result = false;
+                break;
+            }
+        }
+        visible[room] = result;
+    }
+}
+
+void MapScreen::getProxyLocations(const std::vector<glm::vec3> &positions,
+                                  const float marginPixels,
+                                  Batch &batch) const
+{
+    const size_t count = positions.size();
+    auto &proxies = batch.m_proxies;
+    proxies.resize(count);
+    if (count == 0)
+        return;
+
+    const auto center = this->getCenter();
+
+    batch.clear();
+    for (const glm::vec3 &pos : positions) {
+        batch.add(pos);
+    }
+    testVisibility(batch, marginPixels);
+
+    // Until an active position hits the margin, its proxy is the best one inside.
+    auto &active = batch.m_active;
+    auto &fractions = batch.m_fractions;
+    active.clear();
+    fractions.assign(count, 0.5f);
+    for (size_t i = 0; i < count; ++i) {
+        switch (batch.m_results[i]) {
+        case VisiblityResultEnum::INSIDE_MARGIN:
+        case VisiblityResultEnum::ON_MARGIN:
+            proxies[i] = positions[i];
+            break;
+        case VisiblityResultEnum::OUTSIDE_MARGIN:
+        case VisiblityResultEnum::OFF_SCREEN:
+            proxies[i] = center;
+            active.push_back(i);
+            break;
+        }
+    }
+
+    // The same bisection as getProxyLocation(), one step at a time for all of them.
+    float stepFraction = 0.25f;
+    for (int step = 0; step < MAX_PROXY_STEPS && !active.empty(); ++step, stepFraction *= 0.5f) {
+        batch.clear();
+        for (const size_t i : active) {
+            batch.add(glm::mix(center, positions[i], fractions[i]));
+        }
+        testVisibility(batch, marginPixels);
+
+        size_t kept = 0;
+        for (size_t j = 0; j < active.size(); ++j) {
+            const size_t i = active[j];
+            const glm::vec3 tmp_pos{batch.m_x[j], batch.m_y[j], batch.m_z[j]};
+            bool done = false;
+            switch (batch.m_results[j]) {
+            case VisiblityResultEnum::INSIDE_MARGIN:
+                proxies[i] = tmp_pos;
+                fractions[i] += stepFraction;
+                break;
+            case VisiblityResultEnum::ON_MARGIN:
+                proxies[i] = tmp_pos;
+                done = true;
+                break;
+            case VisiblityResultEnum::OUTSIDE_MARGIN:
+            case VisiblityResultEnum::OFF_SCREEN:
+                fractions[i] -= stepFraction;
+                break;
+            }
+            if (!done)
+                active[kept++] = i;
+        }
+        active.resize(kept);
+    }
+}
@@ -3,10 +3,13 @@
 // Copyright (C) 2019 The MMapper Authors
 // Author: Nils Schimmelmann <nschimme@gmail.com> (Jahara)
 
+#include <cstddef>
+#include <cstdint>
 #include <map>
 #include <memory>
 #include <optional>
 #include <unordered_map>
+#include <vector>
 #include <QOpenGLTexture>
 #include <QWidget>
 #include <QtGui/QMatrix4x4>
@@ -38,8 +41,19 @@ NODISCARD extern const MMapper::Array<RoomTintEnum, NUM_ROOM_TINTS> &getAllRoomT
 template<typename T>
 using RoomTintArray = EnumIndexedArray<T, RoomTintEnum, NUM_ROOM_TINTS>;
 
+// How much of each room is drawn, which depends on the zoom
+// (see CanvasSettings::reducedDetailScaleCutoff and colorTileScaleCutoff).
+enum class NODISCARD MapLodEnum {
+    // Only the terrain color, with one texel per room for each chunk.
+    COLOR_TILES,
+    // Terrain and tints, but no walls, doors, streams or overlays.
+    REDUCED,
+    FULL
+};
+
 struct NODISCARD LayerMeshes final
 {
+    UniqueMeshVector colorTile;
     UniqueMeshVector terrain;
     RoomTintArray<UniqueMesh> tints;
     UniqueMeshVector overlays;
@@ -56,12 +70,15 @@ struct NODISCARD LayerMeshes final
     DEFAULT_MOVES_DELETE_COPIES(LayerMeshes);
     ~LayerMeshes() = default;
 
-    void render(int thisLayer, int focusedLayer);
+    void render(int thisLayer, int focusedLayer, MapLodEnum lod);
     explicit operator bool() const { return isValid; }
-};
 
-// This must be ordered so we can iterate over the layers from lowest to highest.
-using BatchedMeshes = std::map<int, LayerMeshes>;
+private:
+    void renderLayerBoost(int thisLayer,
+                          int focusedLayer,
+                          bool disableTextures,
+                          DepthFunctionEnum depthFunction);
+};
 
 struct NODISCARD ScaleFactor final
 {
@@ -151,6 +168,11 @@ struct NODISCARD MapCanvasViewport
 
 public:
     NODISCARD std::optional<glm::vec3> project(const glm::vec3 &) const;
+    // False if the world-space box is entirely outside the view, after growing
+    // the view by the margin on each side. Boxes close to it may still count.
+    NODISCARD bool isBoxVisible(const glm::vec3 &min,
+                                const glm::vec3 &max,
+                                float marginPixels = 0.f) const;
     NODISCARD glm::vec3 unproject_raw(const glm::vec3 &) const;
     NODISCARD glm::vec3 unproject_clamped(const glm::vec2 &) const;
     NODISCARD std::optional<glm::vec3> unproject(const QInputEvent *event) const;
@@ -165,13 +187,37 @@ class NODISCARD MapScreen final
 
 private:
     const MapCanvasViewport &m_viewport;
-    enum class NODISCARD VisiblityResultEnum {
+    enum class NODISCARD VisiblityResultEnum : uint8_t {
         INSIDE_MARGIN,
         ON_MARGIN,
         OUTSIDE_MARGIN,
         OFF_SCREEN
     };
 
+public:
+    // Scratch space for the batched tests, with the positions as structure-of-arrays
+    // so the projection runs as one tight loop. Keep one around to reuse the buffers.
+    class NODISCARD Batch final
+    {
+    private:
+        friend MapScreen;
+        std::vector<float> m_x;
+        std::vector<float> m_y;
+        std::vector<float> m_z;
+        std::vector<VisiblityResultEnum> m_results;
+        std::vector<size_t> m_active;
+        std::vector<float> m_fractions;
+        std::vector<glm::vec3> m_proxies;
+
+    public:
+        // Filled by getProxyLocations().
+        NODISCARD const std::vector<glm::vec3> &getProxies() const { return m_proxies; }
+
+    private:
+        void clear();
+        void add(const glm::vec3 &pos);
+    };
+
 public:
     explicit MapScreen(const MapCanvasViewport &);
     ~MapScreen();
@@ -182,8 +228,20 @@ class NODISCARD MapScreen final
     NODISCARD bool isRoomVisible(const Coordinate &c, float margin) const;
     NODISCARD glm::vec3 getProxyLocation(const glm::vec3 &pos, float margin) const;
 
+    // Same as isRoomVisible() for each room.
+    void areRoomsVisible(const std::vector<Coordinate> &rooms,
+                         float margin,
+                         std::vector<bool> &visible,
+                         Batch &batch) const;
+    // Same as getProxyLocation() for each position; the searches run side by side.
+    void getProxyLocations(const std::vector<glm::vec3> &positions,
+                           float margin,
+                           Batch &batch) const;
+
 private:
     NODISCARD VisiblityResultEnum testVisibility(const glm::vec3 &input_pos, float margin) const;
+    // Fills batch.m_results for every position in the batch.
+    void testVisibility(Batch &batch, float margin) const;
 };
 
 struct NODISCARD MapCanvasInputState
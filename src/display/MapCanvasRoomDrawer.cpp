@@ -4,13 +4,16 @@
 
 #include "MapCanvasRoomDrawer.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstdlib>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <map>
 #include <optional>
 #include <set>
 #include <stdexcept>
+#include <utility>
 #include <vector>
 #include <QColor>
 #include <QMessageLogContext>
@@ -19,6 +22,7 @@
 
 #include "../configuration/NamedConfig.h"
 #include "../configuration/configuration.h"
+#include "../expandoracommon/RoomSpan.h"
 #include "../expandoracommon/coordinate.h"
 #include "../expandoracommon/exit.h"
 #include "../expandoracommon/room.h"
@@ -28,10 +32,12 @@
 #include "../global/EnumIndexedArray.h"
 #include "../global/Flags.h"
 #include "../global/RuleOf5.h"
+#include "../global/parallel.h"
 #include "../global/utils.h"
 #include "../mapdata/DoorFlags.h"
 #include "../mapdata/ExitFieldVariant.h"
 #include "../mapdata/ExitFlags.h"
+#include "../mapdata/MapSnapshot.h"
 #include "../mapdata/enums.h"
 #include "../mapdata/infomark.h"
 #include "../mapdata/mapdata.h"
@@ -113,31 +119,6 @@ NODISCARD static XNamedColor getVerticalNamedColor(const ExitFlags &flags)
     return getWallNamedColorCommon(flags, WallOrientationEnum::VERTICAL);
 }
 
-// All layers
-static void generateAllLayerMeshes(MapBatches &batches,
-                                   OpenGL &gl,
-                                   GLFont &font,
-                                   const LayerToRooms &layerToRooms,
-                                   const RoomIndex &roomIndex,
-                                   const MapCanvasTextures &textures,
-                                   const OptBounds &bounds);
-
-void MapCanvasRoomDrawer::generateBatches(const LayerToRooms &layerToRooms,
-                                          const RoomIndex &roomIndex,
-                                          const OptBounds &bounds)
-{
-    m_batches.reset();   // dtor, if necessary
-    m_batches.emplace(); // ctor
-
-    generateAllLayerMeshes(m_batches.value(),
-                           getOpenGL(),
-                           getFont(),
-                           layerToRooms,
-                           roomIndex,
-                           m_textures,
-                           bounds);
-}
-
 struct NODISCARD TerrainAndTrail
 {
     MMTexture *terrain = nullptr;
@@ -145,10 +126,10 @@ struct NODISCARD TerrainAndTrail
 };
 
 NODISCARD static TerrainAndTrail getRoomTerrainAndTrail(const MapCanvasTextures &textures,
-                                                        const Room *const room)
+                                                        const RoomRenderSignature &sig)
 {
-    const auto roomTerrainType = room->getTerrainType();
-    const RoadIndexMaskEnum roadIndex = getRoadIndex(*room);
+    const auto roomTerrainType = sig.terrain;
+    const auto roadIndex = static_cast<RoadIndexMaskEnum>(sig.roadMask);
 
     TerrainAndTrail result;
     result.terrain = (roomTerrainType == RoomTerrainEnum::ROAD)
@@ -219,24 +200,26 @@ struct NODISCARD IRoomVisitorCallbacks
 IRoomVisitorCallbacks::~IRoomVisitorCallbacks() = default;
 
 static void visitRoom(const Room *const room,
-                      const RoomIndex &roomIndex,
+                      const MapSnapshot &snapshot,
                       const MapCanvasTextures &textures,
                       IRoomVisitorCallbacks &callbacks)
 {
     if (!callbacks.acceptRoom(room))
         return;
 
-    // const auto &pos = room->getPosition();
-    const bool isDark = room->getLightType() == RoomLightEnum::DARK;
-    const bool hasNoSundeath = room->getSundeathType() == RoomSundeathEnum::NO_SUNDEATH;
-    const bool notRideable = room->getRidableType() == RoomRidableEnum::NOT_RIDABLE;
-    const auto terrainAndTrail = getRoomTerrainAndTrail(textures, room);
-    const RoomMobFlags mf = room->getMobFlags();
-    const RoomLoadFlags lf = room->getLoadFlags();
+    // Precomputed by the snapshot, so this doesn't have to look at the exits
+    // or the neighbouring rooms.
+    const RoomRenderSignature &sig = snapshot.getRenderSignature(room->getId());
+    const bool isDark = sig.isDark;
+    const bool hasNoSundeath = sig.hasNoSundeath;
+    const bool notRideable = sig.isNotRidable;
+    const auto terrainAndTrail = getRoomTerrainAndTrail(textures, sig);
+    const RoomMobFlags mf = sig.mobFlags;
+    const RoomLoadFlags lf = sig.loadFlags;
 
     // FIXME: This requires a map update.
     // TODO: make this a separate mesh.
-    const bool needsUpdate = getConfig().canvas.showUpdated && !room->isUpToDate();
+    const bool needsUpdate = getConfig().canvas.showUpdated && !sig.isUpToDate;
 
     callbacks.visitTerrainTexture(room, terrainAndTrail.terrain);
 
@@ -265,32 +248,14 @@ static void visitRoom(const Room *const room,
         callbacks.visitOverlayTexture(room, textures.update->getRaw());
     }
 
-    const auto drawInFlow = [room, &roomIndex, &callbacks](const Exit &exit,
-                                                           const ExitDirEnum &dir) -> void {
-        // For each incoming connections
-        for (const auto &targetId : exit.inRange()) {
-            const SharedConstRoom &targetRoom = roomIndex[targetId];
-            if (targetRoom == nullptr)
-                continue;
-            for (const ExitDirEnum targetDir : ALL_EXITS_NESWUD) {
-                const Exit &targetExit = targetRoom->exit(targetDir);
-                const ExitFlags &flags = targetExit.getExitFlags();
-                if (flags.isFlow() && targetExit.containsOut(room->getId())) {
-                    callbacks.visitStream(room, dir, StreamTypeEnum::InFlow);
-                    return;
-                }
-            }
-        }
-    };
-
     // drawExit()
 
     // FIXME: This requires a map update.
     // REVISIT: The logic of drawNotMappedExits seems a bit wonky.
     const auto drawNotMappedExits = getConfig().canvas.drawNotMappedExits;
     for (const ExitDirEnum dir : ALL_EXITS_NESW) {
-        const Exit &exit = room->exit(dir);
-        const ExitFlags &flags = exit.getExitFlags();
+        const RoomRenderSignature::ExitSignature &exit = sig.getExit(dir);
+        const ExitFlags &flags = exit.flags;
         const auto isExit = flags.isExit();
         const auto isDoor = flags.isDoor();
 
@@ -299,7 +264,7 @@ static void visitRoom(const Room *const room,
         // FIXME: This requires a map update.
         // TODO: make "not mapped" exits a separate mesh;
         // except what should we do for the "else" case?
-        if (isExit && drawNotMappedExits && exit.outIsEmpty()) { // zero outgoing connections
+        if (isExit && drawNotMappedExits && exit.outIsEmpty) { // zero outgoing connections
             callbacks.visitWall(room,
                                 dir,
                                 LOOKUP_COLOR(WALL_COLOR_NOT_MAPPED),
@@ -318,7 +283,7 @@ static void visitRoom(const Room *const room,
 
         // wall
         if (!isExit || isDoor) {
-            if (!isDoor && !exit.outIsEmpty()) {
+            if (!isDoor && !exit.outIsEmpty) {
                 callbacks.visitWall(room,
                                     dir,
                                     LOOKUP_COLOR(WALL_COLOR_BUG_WALL_DOOR),
@@ -341,21 +306,21 @@ static void visitRoom(const Room *const room,
                                 isClimb);
         }
 
-        if (!exit.inIsEmpty())
-            drawInFlow(exit, dir);
+        if (exit.hasInFlow)
+            callbacks.visitStream(room, dir, StreamTypeEnum::InFlow);
     }
 
     // drawVertical
     for (const ExitDirEnum dir : {ExitDirEnum::UP, ExitDirEnum::DOWN}) {
-        const Exit &exit = room->exit(dir);
-        const auto &flags = exit.getExitFlags();
+        const RoomRenderSignature::ExitSignature &exit = sig.getExit(dir);
+        const auto &flags = exit.flags;
         if (!flags.isExit())
             continue;
 
         const bool isClimb = flags.isClimb();
 
         // FIXME: This requires a map update.
-        if (drawNotMappedExits && exit.outIsEmpty()) { // zero outgoing connections
+        if (drawNotMappedExits && exit.outIsEmpty) { // zero outgoing connections
             callbacks.visitWall(room,
                                 dir,
                                 LOOKUP_COLOR(WALL_COLOR_NOT_MAPPED),
@@ -389,18 +354,18 @@ static void visitRoom(const Room *const room,
             callbacks.visitStream(room, dir, StreamTypeEnum::OutFlow);
         }
 
-        if (!exit.inIsEmpty())
-            drawInFlow(exit, dir);
+        if (exit.hasInFlow)
+            callbacks.visitStream(room, dir, StreamTypeEnum::InFlow);
     }
 }
 
-static void visitRooms(const RoomVector &rooms,
-                       const RoomIndex &roomIndex,
+static void visitRooms(const RoomSpan rooms,
+                       const MapSnapshot &snapshot,
                        const MapCanvasTextures &textures,
                        IRoomVisitorCallbacks &callbacks)
 {
     for (const auto &room : rooms) {
-        visitRoom(room, roomIndex, textures, callbacks);
+        visitRoom(room, snapshot, textures, callbacks);
     }
 }
 
@@ -528,56 +493,66 @@ static void foreach_texture(const T &textures, Callback &&callback)
     }
 }
 
-NODISCARD static UniqueMeshVector createSortedTexturedMeshes(OpenGL &gl,
-                                                             const RoomTexVector &textures)
+// The textures that have a layer in roomTiles are skipped, and added to tiles instead.
+NODISCARD static TexturedVertsVector<glm::vec3> createSortedTexturedVerts(
+    const RoomTexVector &textures,
+    const SharedMMTexture &roomTiles,
+    TexturedVerts<glm::vec4> &tiles)
 {
     if (textures.empty())
-        return UniqueMeshVector{};
+        return TexturedVertsVector<glm::vec3>{};
 
-    const size_t numUniqueTextures = [&textures]() -> size_t {
+    const auto isTile = [&roomTiles](const RoomTex &rtex) -> bool {
+        return roomTiles != nullptr && rtex.tex->getArrayLayer() >= 0;
+    };
+
+    const size_t numUniqueTextures = [&textures, &isTile]() -> size_t {
         size_t texCount = 0;
-        ::foreach_texture(textures,
-                          [&texCount](size_t /* beg */, size_t /*end*/) -> void { ++texCount; });
+        ::foreach_texture(textures, [&texCount, &textures, &isTile](size_t beg, size_t /*end*/) {
+            if (!isTile(textures[beg]))
+                ++texCount;
+        });
         return texCount;
     }();
 
-    std::vector<UniqueMesh> result_meshes;
-    result_meshes.reserve(numUniqueTextures);
-    const auto lambda = [&gl, &result_meshes, &textures](const size_t beg,
-                                                         const size_t end) -> void {
+    TexturedVertsVector<glm::vec3> result;
+    result.reserve(numUniqueTextures);
+    const auto lambda = [&result, &textures, &roomTiles, &tiles, &isTile](const size_t beg,
+                                                                       const size_t end) -> void {
         const RoomTex &rtex = textures[beg];
         const size_t count = end - beg;
 
-        std::vector<TexVert> verts;
-        verts.reserve(count * VERTS_PER_QUAD); /* quads */
+        if (isTile(rtex)) {
+            // The tiles batch is drawn first, so it can't come after the other batches.
+            assert(result.empty());
+            tiles.texture = roomTiles;
+            const auto layer = static_cast<float>(rtex.tex->getArrayLayer());
+            for (size_t i = beg; i < end; ++i) {
+                tiles.verts.emplace_back(textures[i].room->getPosition().to_vec3(), layer);
+            }
+            return;
+        }
+
+        TexturedVerts<glm::vec3> &batch = result.emplace_back();
+        batch.texture = rtex.tex->getShared();
+        std::vector<glm::vec3> &verts = batch.verts;
+        verts.reserve(count); /* quad instances */
 
-        // D-C
-        // | |  ccw winding
-        // A-B
         for (size_t i = beg; i < end; ++i) {
-            const auto &pos = textures[i].room->getPosition();
-            const auto v0 = pos.to_vec3();
-#define EMIT(x, y) verts.emplace_back(glm::vec2((x), (y)), v0 + glm::vec3((x), (y), 0))
-            EMIT(0, 0);
-            EMIT(1, 0);
-            EMIT(1, 1);
-            EMIT(0, 1);
-#undef EMIT
+            verts.emplace_back(textures[i].room->getPosition().to_vec3());
         }
-
-        result_meshes.emplace_back(gl.createTexturedQuadBatch(verts, rtex.tex->getShared()));
     };
 
     ::foreach_texture(textures, lambda);
-    assert(result_meshes.size() == numUniqueTextures);
-    return UniqueMeshVector{std::move(result_meshes)};
+    assert(result.size() == numUniqueTextures);
+    return result;
 }
 
-NODISCARD static UniqueMeshVector createSortedColoredTexturedMeshes(
-    OpenGL &gl, const ColoredRoomTexVector &textures)
+NODISCARD static TexturedVertsVector<ColorVert> createSortedColoredTexturedVerts(
+    const ColoredRoomTexVector &textures)
 {
     if (textures.empty())
-        return UniqueMeshVector{};
+        return TexturedVertsVector<ColorVert>{};
 
     const size_t numUniqueTextures = [&textures]() -> size_t {
         size_t texCount = 0;
@@ -586,42 +561,112 @@ NODISCARD static UniqueMeshVector createSortedColoredTexturedMeshes(
         return texCount;
     }();
 
-    std::vector<UniqueMesh> result_meshes;
-    result_meshes.reserve(numUniqueTextures);
+    TexturedVertsVector<ColorVert> result;
+    result.reserve(numUniqueTextures);
 
-    const auto lambda = [&gl, &result_meshes, &textures](const size_t beg,
-                                                         const size_t end) -> void {
+    const auto lambda = [&result, &textures](const size_t beg, const size_t end) -> void {
         const RoomTex &rtex = textures[beg];
         const size_t count = end - beg;
 
-        std::vector<ColoredTexVert> verts;
-        verts.reserve(count * VERTS_PER_QUAD); /* quads */
+        TexturedVerts<ColorVert> &batch = result.emplace_back();
+        batch.texture = rtex.tex->getShared();
+        std::vector<ColorVert> &verts = batch.verts;
+        verts.reserve(count); /* quad instances */
 
-        // D-C
-        // | |  ccw winding
-        // A-B
         for (size_t i = beg; i < end; ++i) {
             const ColoredRoomTex &thisVert = textures[i];
-            const auto &pos = thisVert.room->getPosition();
-            const auto v0 = pos.to_vec3();
-            const auto color = thisVert.color;
-
-#define EMIT(x, y) verts.emplace_back(color, glm::vec2((x), (y)), v0 + glm::vec3((x), (y), 0))
-            EMIT(0, 0);
-            EMIT(1, 0);
-            EMIT(1, 1);
-            EMIT(0, 1);
-#undef EMIT
+            verts.emplace_back(thisVert.color, thisVert.room->getPosition().to_vec3());
         }
-
-        result_meshes.emplace_back(gl.createColoredTexturedQuadBatch(verts, rtex.tex->getShared()));
     };
 
     ::foreach_texture(textures, lambda);
-    assert(result_meshes.size() == numUniqueTextures);
+    assert(result.size() == numUniqueTextures);
+    return result;
+}
+
+NODISCARD static UniqueMeshVector createTexturedMeshes(
+    OpenGL &gl,
+    const TexturedVerts<glm::vec4> &tiles,
+    const TexturedVertsVector<glm::vec3> &batches)
+{
+    std::vector<UniqueMesh> result_meshes;
+    result_meshes.reserve(batches.size() + 1);
+    if (!tiles.verts.empty()) {
+        result_meshes.emplace_back(gl.createArrayTexturedQuadInstances(tiles.verts, tiles.texture));
+    }
+    for (const TexturedVerts<glm::vec3> &batch : batches) {
+        result_meshes.emplace_back(gl.createTexturedQuadInstances(batch.verts, batch.texture));
+    }
+    return UniqueMeshVector{std::move(result_meshes)};
+}
+
+NODISCARD static UniqueMeshVector createColoredTexturedMeshes(
+    OpenGL &gl, const TexturedVertsVector<ColorVert> &batches)
+{
+    std::vector<UniqueMesh> result_meshes;
+    result_meshes.reserve(batches.size());
+    for (const TexturedVerts<ColorVert> &batch : batches) {
+        result_meshes.emplace_back(
+            gl.createColoredTexturedQuadInstances(batch.verts, batch.texture));
+    }
+    return UniqueMeshVector{std::move(result_meshes)};
+}
+
+NODISCARD static UniqueMeshVector createColorTileMeshes(OpenGL &gl, const ColorTileData &tile)
+{
+    static constexpr const int SIZE = MeshChunkId::SIZE;
+
+    std::vector<UniqueMesh> result_meshes;
+    if (!tile.texels.empty()) {
+        assert(tile.texels.size() == static_cast<size_t>(SIZE * SIZE));
+        const auto init = [&tile](QOpenGLTexture &tex) -> void {
+            tex.setWrapMode(QOpenGLTexture::WrapMode::ClampToEdge);
+            tex.setMinMagFilters(QOpenGLTexture::Filter::LinearMipMapLinear,
+                                 QOpenGLTexture::Filter::Nearest);
+            tex.create();
+            tex.setSize(SIZE, SIZE);
+            tex.setMipLevels(tex.maximumMipLevels());
+            tex.setFormat(QOpenGLTexture::TextureFormat::RGBA8_UNorm);
+            tex.allocateStorage(QOpenGLTexture::PixelFormat::RGBA,
+                                QOpenGLTexture::PixelType::UInt8);
+            tex.setData(QOpenGLTexture::PixelFormat::RGBA,
+                        QOpenGLTexture::PixelType::UInt8,
+                        tile.texels.data());
+            tex.generateMipMaps();
+        };
+        const auto texture = MMTexture::alloc(QOpenGLTexture::Target::Target2D, init, true);
+
+        const glm::vec3 origin = tile.origin.to_vec3();
+        const auto corner = [&origin](const float u, const float v) -> TexVert {
+            const auto size = static_cast<float>(SIZE);
+            return TexVert{glm::vec2{u, v}, origin + glm::vec3{u * size, v * size, 0.f}};
+        };
+        result_meshes.emplace_back(gl.createTexturedQuadBatch(
+            {corner(0.f, 0.f), corner(1.f, 0.f), corner(1.f, 1.f), corner(0.f, 1.f)}, texture));
+    }
     return UniqueMeshVector{std::move(result_meshes)};
 }
 
+LayerMeshes LayerMeshesData::getMeshes(OpenGL &gl) const
+{
+    LayerMeshes meshes;
+    meshes.colorTile = ::createColorTileMeshes(gl, colorTile);
+    meshes.terrain = ::createTexturedMeshes(gl, terrainTiles, terrain);
+    for (const RoomTintEnum tint : ALL_ROOM_TINTS) {
+        meshes.tints[tint] = gl.createPlainQuadInstances(tints[tint]);
+    }
+    meshes.overlays = ::createTexturedMeshes(gl, overlayTiles, overlays);
+    meshes.doors = ::createColoredTexturedMeshes(gl, doors);
+    meshes.walls = ::createColoredTexturedMeshes(gl, walls);
+    meshes.dottedWalls = ::createColoredTexturedMeshes(gl, dottedWalls);
+    meshes.upDownExits = ::createColoredTexturedMeshes(gl, upDownExits);
+    meshes.streamIns = ::createColoredTexturedMeshes(gl, streamIns);
+    meshes.streamOuts = ::createColoredTexturedMeshes(gl, streamOuts);
+    meshes.layerBoost = gl.createPlainQuadInstances(layerBoost);
+    meshes.isValid = true;
+    return meshes;
+}
+
 struct NODISCARD LayerBatchMeasurements final
 {
     size_t numTerrains = 0;
@@ -723,8 +768,67 @@ struct NODISCARD LayerBatchMeasurer final : public IRoomVisitorCallbacks
 
 LayerBatchMeasurer::~LayerBatchMeasurer() = default;
 
+// Only what a chunk outside the FullDetailLayers needs.
+struct NODISCARD ColorTileCollector final : public IRoomVisitorCallbacks
+{
+    const OptBounds &bounds;
+    std::vector<std::pair<Coordinate, Color>> roomColors;
+    std::vector<glm::vec3> roomLayerBoostQuads;
+
+    explicit ColorTileCollector(const OptBounds &bounds)
+        : bounds{bounds}
+    {}
+    ~ColorTileCollector() override;
+
+    DELETE_CTORS_AND_ASSIGN_OPS(ColorTileCollector);
+
+    NODISCARD bool virt_acceptRoom(const Room *const room) const override
+    {
+        return bounds.contains(room->getPosition());
+    }
+
+private:
+    void virt_visitTerrainTexture(const Room *const room, MMTexture *const terrain) final
+    {
+        if (terrain == nullptr)
+            return;
+        roomColors.emplace_back(room->getPosition(), terrain->getAverageColor());
+        roomLayerBoostQuads.emplace_back(room->getPosition().to_vec3());
+    }
+    void virt_visitOverlayTexture(const Room *, MMTexture *) final {}
+    void virt_visitNamedColorTint(const Room *, RoomTintEnum) final {}
+    void virt_visitWall(const Room *, ExitDirEnum, XNamedColor, WallTypeEnum, bool) final {}
+    void virt_visitStream(const Room *, ExitDirEnum, StreamTypeEnum) final {}
+};
+
+ColorTileCollector::~ColorTileCollector() = default;
+
+// One position per quad instance.
 using PlainQuadBatch = std::vector<glm::vec3>;
 
+NODISCARD static ColorTileData createColorTile(
+    const MeshChunkId &chunk, const std::vector<std::pair<Coordinate, Color>> &roomColors)
+{
+    static constexpr const int SIZE = MeshChunkId::SIZE;
+
+    ColorTileData result;
+    if (roomColors.empty())
+        return result;
+
+    result.origin = chunk.getMin();
+    result.texels.resize(static_cast<size_t>(SIZE * SIZE), 0u);
+    for (const auto &[pos, color] : roomColors) {
+        const int x = pos.x - result.origin.x;
+        const int y = pos.y - result.origin.y;
+        if (x < 0 || x >= SIZE || y < 0 || y >= SIZE) {
+            assert(false);
+            continue;
+        }
+        result.texels[static_cast<size_t>(y * SIZE + x)] = color.getUint32();
+    }
+    return result;
+}
+
 struct NODISCARD LayerBatchData final
 {
     RoomTexVector roomTerrains;
@@ -739,6 +843,7 @@ struct NODISCARD LayerBatchData final
     ColoredRoomTexVector streamOuts;
     RoomTintArray<PlainQuadBatch> roomTints;
     PlainQuadBatch roomLayerBoostQuads;
+    std::vector<std::pair<Coordinate, Color>> roomColors;
 
     explicit LayerBatchData(const LayerBatchMeasurements &measurements)
     {
@@ -751,9 +856,10 @@ struct NODISCARD LayerBatchData final
         streamIns.reserve(measurements.numStreamIns);
         streamOuts.reserve(measurements.numStreamOuts);
         for (const RoomTintEnum tint : ALL_ROOM_TINTS) {
-            roomTints[tint].reserve(measurements.numTints[tint] * VERTS_PER_QUAD);
+            roomTints[tint].reserve(measurements.numTints[tint]);
         }
-        roomLayerBoostQuads.reserve(VERTS_PER_QUAD * measurements.numTerrains);
+        roomLayerBoostQuads.reserve(measurements.numTerrains);
+        roomColors.reserve(measurements.numTerrains);
     }
 
     void verifyCounts(const LayerBatchMeasurements &measurements)
@@ -768,9 +874,10 @@ struct NODISCARD LayerBatchData final
             assert(streamIns.size() == measurements.numStreamIns);
             assert(streamOuts.size() == measurements.numStreamOuts);
             for (const RoomTintEnum tint : ALL_ROOM_TINTS) {
-                assert(roomTints[tint].size() == measurements.numTints[tint] * VERTS_PER_QUAD);
+                assert(roomTints[tint].size() == measurements.numTints[tint]);
             }
-            assert(roomLayerBoostQuads.size() == VERTS_PER_QUAD * measurements.numTerrains);
+            assert(roomLayerBoostQuads.size() == measurements.numTerrains);
+            assert(roomColors.size() == measurements.numTerrains);
         }
     }
 
@@ -794,23 +901,23 @@ struct NODISCARD LayerBatchData final
         streamOuts.sortByTexture();
     }
 
-    NODISCARD LayerMeshes getMeshes(OpenGL &gl)
+    NODISCARD LayerMeshesData getData(const MeshChunkId &chunk, const SharedMMTexture &roomTiles)
     {
-        LayerMeshes meshes;
-        meshes.terrain = ::createSortedTexturedMeshes(gl, roomTerrains);
-        for (const RoomTintEnum tint : ALL_ROOM_TINTS) {
-            meshes.tints[tint] = gl.createPlainQuadBatch(roomTints[tint]);
-        }
-        meshes.overlays = ::createSortedTexturedMeshes(gl, roomOverlays);
-        meshes.doors = ::createSortedColoredTexturedMeshes(gl, doors);
-        meshes.walls = ::createSortedColoredTexturedMeshes(gl, solidWallLines);
-        meshes.dottedWalls = ::createSortedColoredTexturedMeshes(gl, dottedWallLines);
-        meshes.upDownExits = ::createSortedColoredTexturedMeshes(gl, roomUpDownExits);
-        meshes.streamIns = ::createSortedColoredTexturedMeshes(gl, streamIns);
-        meshes.streamOuts = ::createSortedColoredTexturedMeshes(gl, streamOuts);
-        meshes.layerBoost = gl.createPlainQuadBatch(roomLayerBoostQuads);
-        meshes.isValid = true;
-        return meshes;
+        LayerMeshesData result;
+        result.terrain = ::createSortedTexturedVerts(roomTerrains, roomTiles, result.terrainTiles);
+        result.tints = std::move(roomTints);
+        result.overlays = ::createSortedTexturedVerts(roomOverlays,
+                                                      roomTiles,
+                                                      result.overlayTiles);
+        result.doors = ::createSortedColoredTexturedVerts(doors);
+        result.walls = ::createSortedColoredTexturedVerts(solidWallLines);
+        result.dottedWalls = ::createSortedColoredTexturedVerts(dottedWallLines);
+        result.upDownExits = ::createSortedColoredTexturedVerts(roomUpDownExits);
+        result.streamIns = ::createSortedColoredTexturedVerts(streamIns);
+        result.streamOuts = ::createSortedColoredTexturedVerts(streamOuts);
+        result.layerBoost = std::move(roomLayerBoostQuads);
+        result.colorTile = ::createColorTile(chunk, roomColors);
+        return result;
     }
 };
 
@@ -846,14 +953,8 @@ class NODISCARD LayerBatchBuilder final : public IRoomVisitorCallbacks
             return;
 
         data.roomTerrains.emplace_back(room, terrain);
-
-        const auto v0 = room->getPosition().to_vec3();
-#define EMIT(x, y) data.roomLayerBoostQuads.emplace_back(v0 + glm::vec3((x), (y), 0))
-        EMIT(0, 0);
-        EMIT(1, 0);
-        EMIT(1, 1);
-        EMIT(0, 1);
-#undef EMIT
+        data.roomLayerBoostQuads.emplace_back(room->getPosition().to_vec3());
+        data.roomColors.emplace_back(room->getPosition(), terrain->getAverageColor());
     }
 
     void virt_visitOverlayTexture(const Room *const room, MMTexture *const overlay) final
@@ -864,13 +965,7 @@ class NODISCARD LayerBatchBuilder final : public IRoomVisitorCallbacks
 
     void virt_visitNamedColorTint(const Room *const room, const RoomTintEnum tint) final
     {
-        const auto v0 = room->getPosition().to_vec3();
-#define EMIT(x, y) data.roomTints[tint].emplace_back(v0 + glm::vec3((x), (y), 0))
-        EMIT(0, 0);
-        EMIT(1, 0);
-        EMIT(1, 1);
-        EMIT(0, 1);
-#undef EMIT
+        data.roomTints[tint].emplace_back(room->getPosition().to_vec3());
     }
 
     void virt_visitWall(const Room *const room,
@@ -941,83 +1036,206 @@ class NODISCARD LayerBatchBuilder final : public IRoomVisitorCallbacks
 
 LayerBatchBuilder::~LayerBatchBuilder() = default;
 
-NODISCARD static LayerMeshes generateLayerMeshes(OpenGL &gl,
-                                                 const RoomVector &rooms,
-                                                 const RoomIndex &roomIndex,
-                                                 const MapCanvasTextures &textures,
-                                                 const OptBounds &bounds)
+NODISCARD static LayerMeshesData generateLayerMeshesData(const MeshChunkId &chunk,
+                                                         const RoomSpan rooms,
+                                                         const MapSnapshot &snapshot,
+                                                         const MapCanvasTextures &textures,
+                                                         const OptBounds &bounds)
 {
     const LayerBatchMeasurements measurements =
-        [&bounds, &rooms, &roomIndex, &textures]() -> LayerBatchMeasurements {
+        [&bounds, &rooms, &snapshot, &textures]() -> LayerBatchMeasurements {
         LayerBatchMeasurements result;
         LayerBatchMeasurer measurer{result, bounds};
-        visitRooms(rooms, roomIndex, textures, measurer);
+        visitRooms(rooms, snapshot, textures, measurer);
         return result;
     }();
 
     LayerBatchData data{measurements};
     LayerBatchBuilder builder{data, textures, bounds};
-    visitRooms(rooms, roomIndex, textures, builder);
+    visitRooms(rooms, snapshot, textures, builder);
 
     if constexpr (IS_DEBUG_BUILD) {
         data.verifyCounts(measurements);
     }
 
     data.sort();
-    return data.getMeshes(gl);
+    return data.getData(chunk, textures.room_tiles);
 }
 
-static void generateAllLayerMeshes(MapBatches &batches,
-                                   OpenGL &gl,
-                                   GLFont &font,
-                                   const LayerToRooms &layerToRooms,
-                                   const RoomIndex &roomIndex,
-                                   const MapCanvasTextures &textures,
-                                   const OptBounds &bounds)
+NODISCARD static ChunkMeshesData generateColorTileMeshesData(const MeshChunkId &chunk,
+                                                             const RoomSpan rooms,
+                                                             const MapSnapshot &snapshot,
+                                                             const MapCanvasTextures &textures,
+                                                             const OptBounds &bounds)
 {
-    auto &batchedMeshes = batches.batchedMeshes;
-    auto &connectionDrawerBuffers = batches.connectionDrawerBuffers;
-    auto &roomNameBatches = batches.roomNameBatches;
-    auto &connectionMeshes = batches.connectionMeshes;
-
-    for (const auto &layer : layerToRooms) {
-        const int thisLayer = layer.first;
-        auto &layerMeshes = batchedMeshes[thisLayer];
-        auto &layerRoomNames = roomNameBatches[thisLayer];
-        auto &layerConnections = connectionMeshes[thisLayer];
-        auto &rooms = layer.second;
-
-        layerMeshes = ::generateLayerMeshes(gl, rooms, roomIndex, textures, bounds);
-
-        {
-            auto &cdb = connectionDrawerBuffers[thisLayer];
-            cdb.clear();
-
-            const auto currentLayer = thisLayer;
-
-            RoomNameBatch rnb;
-            ConnectionDrawer cd{cdb, rnb, currentLayer, bounds};
-            {
-                // pass 1: measurements
-                for (const auto &room : rooms) {
-                    cd.drawRoomConnectionsAndDoors(room, roomIndex);
-                }
-                cd.endMeasurements();
+    ColorTileCollector collector{bounds};
+    visitRooms(rooms, snapshot, textures, collector);
+
+    ChunkMeshesData result;
+    result.fullDetail = false;
+    result.meshes.colorTile = ::createColorTile(chunk, collector.roomColors);
+    result.meshes.layerBoost = std::move(collector.roomLayerBoostQuads);
+    result.bounds.min = chunk.getMin().to_vec3();
+    result.bounds.max = chunk.getMax().to_vec3() + glm::vec3{1.f, 1.f, 0.f};
+    return result;
+}
 
-                // pass 2: add to buffers
-                for (const auto &room : rooms) {
-                    cd.drawRoomConnectionsAndDoors(room, roomIndex);
-                }
-                cd.verify();
-            }
+NODISCARD static ChunkMeshesData generateChunkMeshesData(const MeshChunkId &chunk,
+                                                         const RoomSpan rooms,
+                                                         const MapSnapshot &snapshot,
+                                                         const MapCanvasTextures &textures,
+                                                         const OptBounds &bounds,
+                                                         const FullDetailLayers &detailLayers)
+{
+    if (!detailLayers.contains(chunk.z))
+        return ::generateColorTileMeshesData(chunk, rooms, snapshot, textures, bounds);
+
+    ChunkMeshesData result;
+    result.meshes = ::generateLayerMeshesData(chunk, rooms, snapshot, textures, bounds);
 
-            layerRoomNames = rnb.getMesh(font);
-            layerConnections = cdb.getMeshes(gl);
+    const int layer = chunk.z;
+    ConnectionDrawer cd{result.connections, result.roomNames, layer, bounds};
+    {
+        // pass 1: measurements
+        for (const auto &room : rooms) {
+            cd.drawRoomConnectionsAndDoors(room, snapshot);
+        }
+        cd.endMeasurements();
+
+        // pass 2: add to buffers
+        for (const auto &room : rooms) {
+            cd.drawRoomConnectionsAndDoors(room, snapshot);
         }
+        cd.verify();
     }
+
+    // Rooms stay inside their chunk, but connections can reach any other room.
+    ChunkBounds &box = result.bounds;
+    box.min = chunk.getMin().to_vec3();
+    box.max = chunk.getMax().to_vec3() + glm::vec3{1.f, 1.f, 0.f};
+    const auto includeVerts = [&box](const std::vector<ColorVert> &verts) {
+        for (const ColorVert &v : verts) {
+            box.include(v.vert);
+        }
+    };
+    for (const ConnectionDrawerColorBuffer *const buffer :
+         {&result.connections.normal, &result.connections.red}) {
+        includeVerts(buffer->lineVerts);
+        // Each arrow stays inside the room it's drawn in.
+        for (const glm::vec4 &arrow : buffer->arrows) {
+            box.include(glm::vec3{arrow});
+            box.include(glm::vec3{arrow} + glm::vec3{1.f, 1.f, 0.f});
+        }
+    }
+    // Only the anchors; the text itself is measured in pixels.
+    for (const GLText &name : result.roomNames.getNames()) {
+        box.include(name.pos);
+    }
+    return result;
 }
 
-void LayerMeshes::render(const int thisLayer, const int focusedLayer)
+MapBatchesData generateMapBatchesData(const MapSnapshot &snapshot,
+                                      const MapCanvasTextures &textures,
+                                      const OptBounds &bounds,
+                                      const std::optional<MeshChunkIdSet> &onlyChunks,
+                                      const FullDetailLayers &detailLayers)
+{
+    // One flat list sorted by chunk, so each chunk's rooms are a contiguous span;
+    // the sort is stable, so they stay in the snapshot's order.
+    std::vector<std::pair<MeshChunkId, const Room *>> chunkRooms;
+    chunkRooms.reserve(snapshot.getRoomsCount());
+    MeshChunkIdSet visible;
+    snapshot.forEachRoom([&chunkRooms, &visible, &bounds, &onlyChunks](const Room &room) {
+        const Coordinate &pos = room.getPosition();
+        const MeshChunkId chunk = MeshChunkId::fromCoordinate(pos);
+        if (onlyChunks.has_value() && onlyChunks->count(chunk) == 0) {
+            return;
+        }
+        chunkRooms.emplace_back(chunk, &room);
+        if (bounds.contains(pos)) {
+            visible.insert(chunk);
+        }
+    });
+    std::stable_sort(chunkRooms.begin(), chunkRooms.end(), [](const auto &a, const auto &b) {
+        return a.first < b.first;
+    });
+
+    RoomVector rooms;
+    rooms.reserve(chunkRooms.size());
+    for (const auto &entry : chunkRooms) {
+        rooms.emplace_back(entry.second);
+    }
+
+    // A restricted map would otherwise have an empty chunk for every
+    // part of the map outside the bounds.
+    std::vector<std::pair<MeshChunkId, RoomSpan>> work;
+    for (size_t first = 0; first < chunkRooms.size();) {
+        const MeshChunkId &chunk = chunkRooms[first].first;
+        size_t last = first + 1;
+        while (last < chunkRooms.size() && chunkRooms[last].first == chunk) {
+            ++last;
+        }
+        if (visible.count(chunk) != 0) {
+            work.emplace_back(chunk, RoomSpan{rooms.data() + first, last - first});
+        }
+        first = last;
+    }
+
+    // Chunks don't share anything but the snapshot, so they can be built in parallel.
+    std::vector<ChunkMeshesData> chunkData(work.size());
+    parallelFor(
+        work.size(),
+        [&work, &chunkData, &snapshot, &textures, &bounds, &detailLayers](const size_t i) {
+            chunkData[i] = ::generateChunkMeshesData(work[i].first,
+                                                     work[i].second,
+                                                     snapshot,
+                                                     textures,
+                                                     bounds,
+                                                     detailLayers);
+        },
+        1);
+
+    MapBatchesData result;
+    result.bounds = bounds;
+    result.replaced = onlyChunks;
+    for (size_t i = 0; i < work.size(); ++i) {
+        result.chunks.emplace(work[i].first, std::move(chunkData[i]));
+    }
+    return result;
+}
+
+void MapCanvasRoomDrawer::uploadBatches(MapBatchesData &&data)
+{
+    if (data.replaced.has_value()) {
+        if (!m_batches.has_value()) {
+            throw std::runtime_error("there are no batches to update");
+        }
+        // Chunks that no longer have any rooms just disappear.
+        for (const MeshChunkId &chunk : data.replaced.value()) {
+            m_batches->chunks.erase(chunk);
+        }
+    } else {
+        m_batches.reset();   // dtor, if necessary
+        m_batches.emplace(); // ctor
+        m_batches->bounds = data.bounds;
+    }
+
+    MapBatches &batches = m_batches.value();
+    for (auto &[chunk, chunkData] : data.chunks) {
+        const size_t before = getOpenGL().getBufferMemoryUsage().bytes;
+        ChunkMeshes meshes;
+        meshes.bounds = chunkData.bounds;
+        meshes.fullDetail = chunkData.fullDetail;
+        meshes.meshes = chunkData.meshes.getMeshes(getOpenGL());
+        meshes.connectionMeshes = chunkData.connections.getMeshes(getOpenGL());
+        meshes.roomNames = chunkData.roomNames.getMesh(getFont());
+        const size_t after = getOpenGL().getBufferMemoryUsage().bytes;
+        meshes.vramBytes = (after > before) ? (after - before) : 0;
+        batches.chunks[chunk] = std::move(meshes);
+    }
+}
+
+void LayerMeshes::render(const int thisLayer, const int focusedLayer, const MapLodEnum lod)
 {
     bool disableTextures = false;
     if (thisLayer > focusedLayer) {
@@ -1054,11 +1272,20 @@ void LayerMeshes::render(const int thisLayer, const int focusedLayer)
             const auto layerWhite = Colors::white.withAlpha((thisLayer <= focusedLayer) ? 0.90f
                                                                                         : 0.20f);
             layerBoost.render(less_blended.withColor(layerWhite));
+        } else if (lod == MapLodEnum::COLOR_TILES) {
+            colorTile.render(less_blended.withColor(color));
         } else {
             terrain.render(less_blended.withColor(color));
         }
     }
 
+    // The tiers switch without a crossfade: the rest is either drawn or it isn't.
+    if (lod == MapLodEnum::COLOR_TILES) {
+        // The tile isn't made of the same triangles as the rooms, so its depth can differ a bit.
+        renderLayerBoost(thisLayer, focusedLayer, disableTextures, DepthFunctionEnum::LEQUAL);
+        return;
+    }
+
     // REVISIT: move trails to their own batch also colored by the tint?
     for (const RoomTintEnum tint : ALL_ROOM_TINTS) {
         static_assert(NUM_ROOM_TINTS == 2);
@@ -1079,6 +1306,11 @@ void LayerMeshes::render(const int thisLayer, const int focusedLayer)
         }
     }
 
+    if (lod == MapLodEnum::REDUCED) {
+        renderLayerBoost(thisLayer, focusedLayer, disableTextures, DepthFunctionEnum::EQUAL);
+        return;
+    }
+
     if (!disableTextures) {
         // streams go under everything else, including trails
         streamIns.render(lequal_blended.withColor(color));
@@ -1099,6 +1331,16 @@ void LayerMeshes::render(const int thisLayer, const int focusedLayer)
         dottedWalls.render(lequal_blended.withColor(color));
     }
 
+    renderLayerBoost(thisLayer, focusedLayer, disableTextures, DepthFunctionEnum::EQUAL);
+}
+
+void LayerMeshes::renderLayerBoost(const int thisLayer,
+                                   const int focusedLayer,
+                                   const bool disableTextures,
+                                   const DepthFunctionEnum depthFunction)
+{
+    const GLRenderState blended = GLRenderState().withDepthFunction(depthFunction).withBlend(
+        BlendModeEnum::TRANSPARENCY);
     if (thisLayer != focusedLayer) {
         // Darker when below, lighter when above
         const auto baseAlpha = (thisLayer < focusedLayer) ? 0.5f : 0.1f;
@@ -1108,6 +1350,6 @@ void LayerMeshes::render(const int thisLayer, const int focusedLayer)
                          1.f);
         const Color &baseColor = (thisLayer < focusedLayer || disableTextures) ? Colors::black
                                                                                : Colors::white;
-        layerBoost.render(equal_blended.withColor(baseColor.withAlpha(alpha)));
+        layerBoost.render(blended.withColor(baseColor.withAlpha(alpha)));
     }
 }
@@ -3,8 +3,11 @@
 // Copyright (C) 2019 The MMapper Authors
 // Author: Nils Schimmelmann <nschimme@gmail.com> (Jahara)
 
+#include <cstdint>
+#include <cstdlib>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <limits>
 #include <map>
 #include <optional>
 #include <unordered_map>
@@ -12,6 +15,7 @@
 #include <QColor>
 #include <QtCore>
 
+#include "../expandoracommon/MeshChunk.h"
 #include "../expandoracommon/coordinate.h"
 #include "../expandoracommon/room.h"
 #include "../global/Array.h"
@@ -31,15 +35,145 @@ class OpenGL;
 class QOpenGLTexture;
 class Room;
 
+class MapSnapshot;
+
 using RoomVector = std::vector<const Room *>;
-using LayerToRooms = std::map<int, RoomVector>;
+
+// The vertices (or instances) of one mesh of a UniqueMeshVector.
+template<typename VertexType_>
+struct NODISCARD TexturedVerts final
+{
+    SharedMMTexture texture;
+    std::vector<VertexType_> verts;
+};
+
+template<typename VertexType_>
+using TexturedVertsVector = std::vector<TexturedVerts<VertexType_>>;
+
+// The far-zoom stand-in for a chunk's terrain: one texel per room, row by row
+// from the chunk's origin, in the average color of the room's terrain texture.
+// There are no texels if the chunk has no rooms.
+struct NODISCARD ColorTileData final
+{
+    Coordinate origin;
+    std::vector<uint32_t> texels;
+};
+
+// Everything LayerMeshes is made from, without touching OpenGL.
+//
+// Every room-sized quad is stored as one instance: the position of the room
+// (plus a color for the ColorVert ones); see OpenGL::createXXXQuadInstances().
+//
+// When there's a MapCanvasTextures::room_tiles, the terrain and overlay quads
+// that have a layer in it go to the "tiles" batch (with the layer in w) instead
+// of a batch per texture, and they're drawn first.
+struct NODISCARD LayerMeshesData final
+{
+    TexturedVerts<glm::vec4> terrainTiles;
+    TexturedVertsVector<glm::vec3> terrain;
+    RoomTintArray<std::vector<glm::vec3>> tints;
+    TexturedVerts<glm::vec4> overlayTiles;
+    TexturedVertsVector<glm::vec3> overlays;
+    TexturedVertsVector<ColorVert> doors;
+    TexturedVertsVector<ColorVert> walls;
+    TexturedVertsVector<ColorVert> dottedWalls;
+    TexturedVertsVector<ColorVert> upDownExits;
+    TexturedVertsVector<ColorVert> streamIns;
+    TexturedVertsVector<ColorVert> streamOuts;
+    std::vector<glm::vec3> layerBoost;
+    ColorTileData colorTile;
+
+    NODISCARD LayerMeshes getMeshes(OpenGL &gl) const;
+};
+
+struct NODISCARD ChunkMeshesData final
+{
+    ChunkBounds bounds;
+    // False if it only has its LayerMeshesData::colorTile and layerBoost.
+    bool fullDetail = true;
+    LayerMeshesData meshes;
+    ConnectionDrawerBuffers connections;
+    RoomNameBatch roomNames;
+
+    ChunkMeshesData() = default;
+    DEFAULT_MOVES_DELETE_COPIES(ChunkMeshesData);
+    ~ChunkMeshesData() = default;
+};
+
+// The layers whose chunks get every mesh. The others only get the color tile
+// and the layer boost, which is all that's drawn of them anyway.
+struct NODISCARD FullDetailLayers final
+{
+    int focus = 0;
+    int budget = std::numeric_limits<int>::max();
+
+    NODISCARD bool contains(const int layer) const
+    {
+        return std::abs(static_cast<int64_t>(layer) - focus) <= budget;
+    }
+};
+
+// The CPU half of the map batches; it can be built on any thread.
+struct NODISCARD MapBatchesData final
+{
+    std::map<MeshChunkId, ChunkMeshesData> chunks;
+    // Only set for an update: every chunk it replaces, including the ones that are now empty.
+    std::optional<MeshChunkIdSet> replaced;
+    OptBounds bounds;
+
+    MapBatchesData() = default;
+    DEFAULT_MOVES_DELETE_COPIES(MapBatchesData);
+    ~MapBatchesData() = default;
+};
+
+// Builds the chunks that have rooms in the snapshot, or only the given
+// chunks. This doesn't use OpenGL, so it doesn't have to run on the GL thread.
+NODISCARD extern MapBatchesData generateMapBatchesData(
+    const MapSnapshot &snapshot,
+    const MapCanvasTextures &textures,
+    const OptBounds &bounds,
+    const std::optional<MeshChunkIdSet> &onlyChunks,
+    const FullDetailLayers &detailLayers);
+
+// A world-space box around everything a chunk draws.
+struct NODISCARD ChunkBounds final
+{
+    glm::vec3 min{0.f};
+    glm::vec3 max{0.f};
+
+    void include(const glm::vec3 &v)
+    {
+        min = glm::min(min, v);
+        max = glm::max(max, v);
+    }
+};
+
+// The meshes of the rooms in one MeshChunkId.
+struct NODISCARD ChunkMeshes final
+{
+    ChunkBounds bounds;
+    bool fullDetail = true;
+    // What uploading it added to the buffer memory.
+    size_t vramBytes = 0;
+    // See MapCanvas::evictStreamedChunks().
+    uint64_t lastDrawnFrame = 0;
+    LayerMeshes meshes;
+    ConnectionMeshes connectionMeshes;
+    ZoomedTextMeshes roomNames;
+
+    ChunkMeshes() = default;
+    DEFAULT_MOVES_DELETE_COPIES(ChunkMeshes);
+    ~ChunkMeshes() = default;
+};
+
+// This must be ordered so we can iterate over the layers from lowest to highest.
+using BatchedChunks = std::map<MeshChunkId, ChunkMeshes>;
 
 struct NODISCARD MapBatches final
 {
-    BatchedMeshes batchedMeshes;
-    BatchedConnections connectionDrawerBuffers;
-    BatchedConnectionMeshes connectionMeshes;
-    BatchedRoomNames roomNameBatches;
+    BatchedChunks chunks;
+    // What the meshes were generated for; chunks rebuilt later use the same.
+    OptBounds bounds;
     OptBounds redrawMargin;
 
     MapBatches() = default;
@@ -63,22 +197,18 @@ struct NODISCARD Batches final
     }
 };
 
+// Turns MapBatchesData into meshes; this must be done on the GL thread.
 class NODISCARD MapCanvasRoomDrawer final
 {
 private:
     OpenGL &m_opengl;
     GLFont &m_font;
-    const MapCanvasTextures &m_textures;
     std::optional<MapBatches> &m_batches;
 
 public:
-    explicit MapCanvasRoomDrawer(const MapCanvasTextures &textures,
-                                 OpenGL &opengl,
-                                 GLFont &font,
-                                 std::optional<MapBatches> &batches)
+    explicit MapCanvasRoomDrawer(OpenGL &opengl, GLFont &font, std::optional<MapBatches> &batches)
         : m_opengl{opengl}
         , m_font{font}
-        , m_textures{textures}
         , m_batches{batches}
     {}
 
@@ -86,9 +216,8 @@ class NODISCARD MapCanvasRoomDrawer final
     NODISCARD auto &getOpenGL() const { return m_opengl; }
 
 public:
-    void generateBatches(const LayerToRooms &layerToRooms,
-                         const RoomIndex &roomIndex,
-                         const OptBounds &bounds);
+    // Replaces the batches, or just the chunks of an update.
+    void uploadBatches(MapBatchesData &&data);
 
 public:
     NODISCARD inline GLFont &getFont() { return m_font; }
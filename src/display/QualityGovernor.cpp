@@ -0,0 +1,66 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "QualityGovernor.h"
+
+#include <utility>
+
+// Weight of the newest frame in the moving average.
+static constexpr const double SMOOTHING = 0.25;
+// Quality only goes back up early if frames take less than this share of the budget.
+static constexpr const double STEP_UP_SHARE = 0.5;
+
+QualityGovernor::QualityGovernor(std::function<void()> onRestored)
+    : m_onRestored{std::move(onRestored)}
+{
+    m_restoreTimer.setSingleShot(true);
+    m_restoreTimer.setInterval(RESTORE_MS);
+    QObject::connect(&m_restoreTimer, &QTimer::timeout, &m_restoreTimer, [this]() { restore(); });
+}
+
+void QualityGovernor::setEnabled(const bool enabled)
+{
+    if (m_enabled == enabled)
+        return;
+    m_enabled = enabled;
+    if (!enabled)
+        restore();
+}
+
+void QualityGovernor::onViewMoved()
+{
+    if (!m_enabled)
+        return;
+    m_moving = true;
+    m_restoreTimer.start();
+}
+
+void QualityGovernor::onFrameTime(const double ms, const double budgetMs)
+{
+    const double average = m_averageMs.has_value()
+                               ? m_averageMs.value() + (ms - m_averageMs.value()) * SMOOTHING
+                               : ms;
+    m_averageMs = average;
+    if (!m_moving || ++m_framesSinceStep < FRAMES_PER_STEP)
+        return;
+
+    if (average > budgetMs && m_quality != RenderQualityEnum::REDUCED_DETAIL) {
+        m_quality = static_cast<RenderQualityEnum>(static_cast<uint8_t>(m_quality) + 1u);
+        m_framesSinceStep = 0;
+    } else if (average < budgetMs * STEP_UP_SHARE && m_quality != RenderQualityEnum::FULL) {
+        m_quality = static_cast<RenderQualityEnum>(static_cast<uint8_t>(m_quality) - 1u);
+        m_framesSinceStep = 0;
+    }
+}
+
+void QualityGovernor::restore()
+{
+    m_restoreTimer.stop();
+    m_moving = false;
+    m_framesSinceStep = 0;
+    m_averageMs.reset();
+    if (m_quality == RenderQualityEnum::FULL)
+        return;
+    m_quality = RenderQualityEnum::FULL;
+    m_onRestored();
+}
@@ -0,0 +1,62 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <QTimer>
+
+#include "../global/RuleOf5.h"
+#include "../global/macros.h"
+
+// From best to cheapest.
+enum class NODISCARD RenderQualityEnum : uint8_t {
+    FULL,
+    // Multisampling and line smoothing are turned off.
+    NO_MULTISAMPLING,
+    // Also drawn with at most MapLodEnum::REDUCED, without connections or door names.
+    REDUCED_DETAIL
+};
+
+/**
+ * Lowers the rendering quality while the view keeps moving (scrolling,
+ * zooming, tilting) and frames take longer than the screen's refresh
+ * interval, and restores full quality once the view has been still for
+ * RESTORE_MS.
+ *
+ * Frame times come late from the GPU timer queries, so the quality only
+ * changes one step every FRAMES_PER_STEP frames.
+ */
+class NODISCARD QualityGovernor final
+{
+public:
+    static constexpr const int RESTORE_MS = 250;
+    static constexpr const int FRAMES_PER_STEP = 8;
+
+private:
+    std::function<void()> m_onRestored;
+    QTimer m_restoreTimer;
+    RenderQualityEnum m_quality = RenderQualityEnum::FULL;
+    std::optional<double> m_averageMs;
+    int m_framesSinceStep = 0;
+    bool m_moving = false;
+    bool m_enabled = true;
+
+public:
+    // Called when full quality comes back, so the still view is drawn again.
+    explicit QualityGovernor(std::function<void()> onRestored);
+    ~QualityGovernor() = default;
+    DELETE_CTORS_AND_ASSIGN_OPS(QualityGovernor);
+
+public:
+    void setEnabled(bool enabled);
+    NODISCARD bool isEnabled() const { return m_enabled; }
+    void onViewMoved();
+    // How long the most recently measured frame took.
+    void onFrameTime(double ms, double budgetMs);
+    NODISCARD RenderQualityEnum getQuality() const { return m_quality; }
+
+private:
+    void restore();
+};
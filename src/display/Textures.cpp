@@ -3,9 +3,12 @@
 
 #include "Textures.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <glm/glm.hpp>
 #include <optional>
 #include <stdexcept>
+#include <thread>
 #include <vector>
 #include <QMessageLogContext>
 #include <QtCore>
@@ -19,22 +22,35 @@
 #include "RoadIndex.h"
 #include "mapcanvas.h"
 
-MMTexture::MMTexture(this_is_private, const QString &name)
-    : m_qt_texture{QImage{name}.mirrored()}
+MMTexture::MMTexture(this_is_private, const QImage &image)
+    : m_qt_texture{image}
 {
     auto &tex = m_qt_texture;
     tex.setWrapMode(QOpenGLTexture::WrapMode::MirroredRepeat);
     tex.setMinMagFilters(QOpenGLTexture::Filter::LinearMipMapLinear, QOpenGLTexture::Filter::Linear);
 }
 
+size_t MMTexture::getEstimatedBytes() const
+{
+    const QOpenGLTexture &tex = m_qt_texture;
+    if (!tex.isCreated())
+        return 0;
+    const auto texels = static_cast<size_t>(std::max(tex.width(), 1))
+                        * static_cast<size_t>(std::max(tex.height(), 1))
+                        * static_cast<size_t>(std::max(tex.depth(), 1))
+                        * static_cast<size_t>(std::max(tex.layers(), 1));
+    const size_t bytes = texels * 4u;
+    return (tex.mipLevels() > 1) ? bytes + bytes / 3u : bytes;
+}
+
 void MapCanvasTextures::destroyAll()
 {
     for_each([](SharedMMTexture &tex) -> void { tex.reset(); });
 }
 
-NODISCARD static SharedMMTexture loadTexture(const QString &name)
+NODISCARD static SharedMMTexture loadTexture(const DecodedPixmaps &pixmaps, const QString &name)
 {
-    auto mmtex = MMTexture::alloc(name);
+    auto mmtex = MMTexture::alloc(pixmaps.value(name));
     auto *texture = mmtex->get();
     if (!texture->isCreated()) {
         qWarning() << "failed to create: " << name;
@@ -49,24 +65,188 @@ NODISCARD static SharedMMTexture loadTexture(const QString &name)
     return mmtex;
 }
 
-template<typename E>
-static void loadPixmapArray(texture_array<E> &textures)
+// Weighted by alpha, so transparent pixels don't darken it.
+NODISCARD static Color getAverageColor(const QImage &image)
+{
+    const QImage rgba = image.convertToFormat(QImage::Format::Format_RGBA8888);
+    uint64_t sums[4]{};
+    for (int y = 0; y < rgba.height(); ++y) {
+        const uchar *const line = rgba.constScanLine(y);
+        for (int x = 0; x < rgba.width(); ++x) {
+            const uchar *const pixel = line + 4 * x;
+            const uint64_t alpha = pixel[3];
+            for (int c = 0; c < 3; ++c) {
+                sums[c] += static_cast<uint64_t>(pixel[c]) * alpha;
+            }
+            sums[3] += alpha;
+        }
+    }
+    if (sums[3] == 0)
+        return Color{};
+
+    const auto numPixels = static_cast<uint64_t>(rgba.width())
+                           * static_cast<uint64_t>(rgba.height());
+    return Color{static_cast<int>(sums[0] / sums[3]),
+                 static_cast<int>(sums[1] / sums[3]),
+                 static_cast<int>(sums[2] / sums[3]),
+                 static_cast<int>(sums[3] / numPixels)};
+}
+
+struct NODISCARD RoomTile final
+{
+    MMTexture *texture = nullptr;
+    QString filename;
+};
+using RoomTiles = std::vector<RoomTile>;
+
+template<typename E, typename Callback>
+static void forEachPixmap(texture_array<E> &textures, Callback &&callback)
 {
     const auto N = textures.size();
     for (uint i = 0u; i < N; ++i) {
         const auto x = static_cast<E>(i);
-        textures[x] = loadTexture(getPixmapFilename(x));
+        callback(textures[x], getPixmapFilename(x), true);
     }
 }
 
-template<RoadTagEnum Tag>
-static void loadPixmapArray(road_texture_array<Tag> &textures)
+template<RoadTagEnum Tag, typename Callback>
+static void forEachPixmap(road_texture_array<Tag> &textures, Callback &&callback)
 {
     const auto N = textures.size();
     for (uint i = 0u; i < N; ++i) {
         const auto x = TaggedRoadIndex<Tag>{static_cast<RoadIndexMaskEnum>(i)};
-        textures[x] = loadTexture(getPixmapFilename(x));
+        callback(textures[x], getPixmapFilename(x), true);
+    }
+}
+
+// Calls callback(texture, filename, isRoomTile) for each texture that comes from a pixmap;
+// the room tiles are the ones that are also copied into MapCanvasTextures::room_tiles.
+template<typename Callback>
+static void forEachPixmap(MapCanvasTextures &textures, Callback &&callback)
+{
+    forEachPixmap(textures.terrain, callback);
+    forEachPixmap(textures.road, callback);
+    forEachPixmap(textures.trail, callback);
+    forEachPixmap(textures.mob, callback);
+    forEachPixmap(textures.load, callback);
+
+    const auto getFilename = [](const char *const format, const ExitDirEnum dir) -> QString {
+        return getPixmapFilenameRaw(QString::asprintf(format, lowercaseDirection(dir)));
+    };
+    for (const ExitDirEnum dir : ALL_EXITS_NESW) {
+        callback(textures.wall[dir], getFilename("wall-%s.png", dir), false);
+    }
+    for (const ExitDirEnum dir : ALL_EXITS_NESWUD) {
+        callback(textures.door[dir], getFilename("door-%s.png", dir), false);
+        callback(textures.stream_in[dir], getFilename("stream-in-%s.png", dir), false);
+        callback(textures.stream_out[dir], getFilename("stream-out-%s.png", dir), false);
+    }
+
+    const auto single = [&callback](SharedMMTexture &texture, const char *const name) {
+        callback(texture, getPixmapFilenameRaw(name), false);
+    };
+    single(textures.char_arrows, "char-arrows.png");
+    single(textures.char_room_sel, "char-room-sel.png");
+    single(textures.exit_climb_down, "exit-climb-down.png");
+    single(textures.exit_climb_up, "exit-climb-up.png");
+    single(textures.exit_down, "exit-down.png");
+    single(textures.exit_up, "exit-up.png");
+    single(textures.no_ride, "no-ride.png");
+    single(textures.room_sel, "room-sel.png");
+    single(textures.room_sel_distant, "room-sel-distant.png");
+    single(textures.room_sel_move_bad, "room-sel-move-bad.png");
+    single(textures.room_sel_move_good, "room-sel-move-good.png");
+    single(textures.update, "update0.png");
+}
+
+std::future<DecodedPixmaps> decodePixmapsAsync()
+{
+    // The filenames depend on the config, so they're found on this thread.
+    std::vector<QString> filenames;
+    {
+        MapCanvasTextures unused;
+        forEachPixmap(unused, [&filenames](SharedMMTexture &, const QString &filename, bool) {
+            filenames.emplace_back(filename);
+        });
+    }
+
+    return std::async(std::launch::async, [filenames = std::move(filenames)]() -> DecodedPixmaps {
+        // QImage is reentrant, so each worker decodes every Nth file into its own slots.
+        std::vector<QImage> images(filenames.size());
+        const auto numWorkers = std::clamp(std::thread::hardware_concurrency(), 1u, 8u);
+        std::vector<std::thread> workers;
+        workers.reserve(numWorkers);
+        for (size_t first = 0; first < numWorkers; ++first) {
+            workers.emplace_back([&filenames, &images, first, numWorkers]() {
+                for (size_t i = first; i < filenames.size(); i += numWorkers) {
+                    images[i] = QImage{filenames[i]}.mirrored();
+                }
+            });
+        }
+        for (std::thread &worker : workers) {
+            worker.join();
+        }
+
+        DecodedPixmaps result;
+        result.reserve(static_cast<int>(filenames.size()));
+        for (size_t i = 0; i < filenames.size(); ++i) {
+            result.insert(filenames[i], std::move(images[i]));
+        }
+        return result;
+    });
+}
+
+// Copies the tiles into the layers of one GL_TEXTURE_2D_ARRAY, and tells each
+// tile which layer it is. The trail pixmaps are smaller, so they're scaled up.
+NODISCARD static SharedMMTexture createRoomTilesArray(const DecodedPixmaps &pixmaps,
+                                                      const RoomTiles &tiles)
+{
+    static constexpr const int SIZE = 128;
+
+    std::vector<QImage> images;
+    images.reserve(tiles.size());
+    for (const RoomTile &tile : tiles) {
+        QImage image = pixmaps.value(tile.filename);
+        if (image.isNull()) {
+            qWarning() << "failed to load: " << tile.filename;
+            image = QImage{SIZE, SIZE, QImage::Format::Format_RGBA8888};
+            image.fill(Qt::transparent);
+        } else if (image.width() != SIZE || image.height() != SIZE) {
+            image = image.scaled(SIZE, SIZE, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        }
+        images.emplace_back(image.convertToFormat(QImage::Format::Format_RGBA8888));
     }
+
+    const auto init = [&images](QOpenGLTexture &tex) -> void {
+        tex.setWrapMode(QOpenGLTexture::WrapMode::MirroredRepeat);
+        tex.setMinMagFilters(QOpenGLTexture::Filter::LinearMipMapLinear,
+                             QOpenGLTexture::Filter::Linear);
+        tex.create();
+        tex.setSize(SIZE, SIZE);
+        tex.setLayers(static_cast<int>(images.size()));
+        tex.setMipLevels(tex.maximumMipLevels());
+        tex.setFormat(QOpenGLTexture::TextureFormat::RGBA8_UNorm);
+        tex.allocateStorage(QOpenGLTexture::PixelFormat::RGBA, QOpenGLTexture::PixelType::UInt8);
+        for (size_t layer = 0; layer < images.size(); ++layer) {
+            tex.setData(0,
+                        static_cast<int>(layer),
+                        QOpenGLTexture::PixelFormat::RGBA,
+                        QOpenGLTexture::PixelType::UInt8,
+                        images[layer].constBits());
+        }
+        tex.generateMipMaps();
+    };
+
+    auto result = MMTexture::alloc(
+        QOpenGLTexture::Target::Target2DArray,
+        [&init](QOpenGLTexture &tex) { return init(tex); },
+        false);
+
+    int layer = 0;
+    for (const RoomTile &tile : tiles) {
+        deref(tile.texture).setArrayLayer(layer++);
+    }
+    return result;
 }
 
 // Technically only the "minifying" filter can be trilinear.
@@ -204,36 +384,28 @@ void MapCanvas::initTextures()
 {
     MapCanvasTextures &textures = this->m_textures;
 
-    loadPixmapArray(textures.terrain);
-    loadPixmapArray(textures.road);
-    loadPixmapArray(textures.trail);
-    loadPixmapArray(textures.mob);
-    loadPixmapArray(textures.load);
+    // The decode started in the constructor; it's only redone if the context was recreated.
+    if (!m_decodedPixmaps.valid())
+        m_decodedPixmaps = decodePixmapsAsync();
+    const DecodedPixmaps pixmaps = m_decodedPixmaps.get();
+
+    RoomTiles tiles;
+    forEachPixmap(textures,
+                  [&pixmaps, &tiles](SharedMMTexture &texture,
+                                     const QString &filename,
+                                     const bool isRoomTile) {
+                      texture = loadTexture(pixmaps, filename);
+                      if (isRoomTile) {
+                          texture->setAverageColor(getAverageColor(pixmaps.value(filename)));
+                          tiles.emplace_back(RoomTile{texture->getRaw(), filename});
+                      }
+                  });
+    if (getOpenGL().canRenderTextureArrays()) {
+        textures.room_tiles = createRoomTilesArray(pixmaps, tiles);
+    }
     for (const ExitDirEnum dir : ALL_EXITS_NESW) {
         textures.dotted_wall[dir] = createDottedWall(dir);
-        textures.wall[dir] = loadTexture(
-            getPixmapFilenameRaw(QString::asprintf("wall-%s.png", lowercaseDirection(dir))));
-    }
-    for (const ExitDirEnum dir : ALL_EXITS_NESWUD) {
-        textures.door[dir] = loadTexture(
-            getPixmapFilenameRaw(QString::asprintf("door-%s.png", lowercaseDirection(dir))));
-        textures.stream_in[dir] = loadTexture(
-            getPixmapFilenameRaw(QString::asprintf("stream-in-%s.png", lowercaseDirection(dir))));
-        textures.stream_out[dir] = loadTexture(
-            getPixmapFilenameRaw(QString::asprintf("stream-out-%s.png", lowercaseDirection(dir))));
     }
-    textures.char_arrows = loadTexture(getPixmapFilenameRaw("char-arrows.png"));
-    textures.char_room_sel = loadTexture(getPixmapFilenameRaw("char-room-sel.png"));
-    textures.exit_climb_down = loadTexture(getPixmapFilenameRaw("exit-climb-down.png"));
-    textures.exit_climb_up = loadTexture(getPixmapFilenameRaw("exit-climb-up.png"));
-    textures.exit_down = loadTexture(getPixmapFilenameRaw("exit-down.png"));
-    textures.exit_up = loadTexture(getPixmapFilenameRaw("exit-up.png"));
-    textures.no_ride = loadTexture(getPixmapFilenameRaw("no-ride.png"));
-    textures.room_sel = loadTexture(getPixmapFilenameRaw("room-sel.png"));
-    textures.room_sel_distant = loadTexture(getPixmapFilenameRaw("room-sel-distant.png"));
-    textures.room_sel_move_bad = loadTexture(getPixmapFilenameRaw("room-sel-move-bad.png"));
-    textures.room_sel_move_good = loadTexture(getPixmapFilenameRaw("room-sel-move-good.png"));
-    textures.update = loadTexture(getPixmapFilenameRaw("update0.png"));
 
     {
         int priority = 0;
@@ -3,7 +3,10 @@
 // Copyright (C) 2019 The MMapper Authors
 
 #include <functional>
+#include <future>
 #include <memory>
+#include <QHash>
+#include <QImage>
 #include <QOpenGLTexture>
 #include <QString>
 #include <QtGui/qopengl.h>
@@ -27,12 +30,16 @@ class NODISCARD MMTexture final : public std::enable_shared_from_this<MMTexture>
     // REVISIT: can we store the actual QOpenGLTexture in this object?
     QOpenGLTexture m_qt_texture;
     int m_priority = -1;
+    // The copy of this texture in MapCanvasTextures::room_tiles, if any.
+    int m_arrayLayer = -1;
+    // What a room drawn with this texture looks like from far away.
+    Color m_averageColor;
     bool m_forbidUpdates = false;
 
 public:
-    NODISCARD static std::shared_ptr<MMTexture> alloc(const QString &name)
+    NODISCARD static std::shared_ptr<MMTexture> alloc(const QImage &image)
     {
-        return std::make_shared<MMTexture>(this_is_private{0}, name);
+        return std::make_shared<MMTexture>(this_is_private{0}, image);
     }
     NODISCARD static std::shared_ptr<MMTexture> alloc(
         const QOpenGLTexture::Target target,
@@ -44,7 +51,7 @@ class NODISCARD MMTexture final : public std::enable_shared_from_this<MMTexture>
 
 public:
     MMTexture() = delete;
-    MMTexture(this_is_private, const QString &name);
+    MMTexture(this_is_private, const QImage &image);
     MMTexture(this_is_private,
               const QOpenGLTexture::Target target,
               const std::function<void(QOpenGLTexture &)> &init,
@@ -67,12 +74,20 @@ class NODISCARD MMTexture final : public std::enable_shared_from_this<MMTexture>
     NODISCARD GLuint textureId() const { return get()->textureId(); }
     NODISCARD auto target() const { return get()->target(); }
     NODISCARD bool canBeUpdated() const { return !m_forbidUpdates; }
+    // Assumes 4 bytes per texel, plus a third for the mipmaps.
+    NODISCARD size_t getEstimatedBytes() const;
 
     NODISCARD SharedMMTexture getShared() { return shared_from_this(); }
     NODISCARD MMTexture *getRaw() { return this; }
 
     NODISCARD int getPriority() const { return m_priority; }
     void setPriority(const int priority) { m_priority = priority; }
+
+    NODISCARD int getArrayLayer() const { return m_arrayLayer; }
+    void setArrayLayer(const int layer) { m_arrayLayer = layer; }
+
+    NODISCARD const Color &getAverageColor() const { return m_averageColor; }
+    void setAverageColor(const Color &color) { m_averageColor = color; }
 };
 
 template<typename E>
@@ -114,6 +129,10 @@ struct NODISCARD MapCanvasTextures final
     SharedMMTexture room_sel_move_bad;
     SharedMMTexture room_sel_move_good;
     SharedMMTexture update;
+    // GL_TEXTURE_2D_ARRAY with a layer for each terrain, road, trail, mob and load
+    // texture, which lets each of those layer meshes be drawn in one call.
+    // Null unless OpenGL::canRenderTextureArrays().
+    SharedMMTexture room_tiles;
 
     template<typename Callback>
     void for_each(Callback &&callback)
@@ -140,7 +159,15 @@ struct NODISCARD MapCanvasTextures final
         callback(room_sel_move_bad);
         callback(room_sel_move_good);
         callback(update);
+        if (room_tiles != nullptr)
+            callback(room_tiles);
     }
 
     void destroyAll();
 };
+
+// The pixmaps of MapCanvasTextures by filename, already mirrored for OpenGL.
+using DecodedPixmaps = QHash<QString, QImage>;
+
+// Decodes the pixmaps on worker threads, so it can start before there's a GL context.
+NODISCARD extern std::future<DecodedPixmaps> decodePixmapsAsync();
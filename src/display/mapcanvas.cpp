@@ -34,6 +34,7 @@
 #include "../mapdata/infomark.h"
 #include "../mapdata/mapdata.h"
 #include "../mapdata/roomselection.h"
+#include "Characters.h"
 #include "InfoMarkSelection.h"
 #include "MapCanvasData.h"
 #include "MapCanvasRoomDrawer.h"
@@ -63,6 +64,7 @@ MapCanvas::MapCanvas(MapData &mapData,
     , m_glFont{m_opengl}
     , m_data{mapData}
     , m_groupManager{groupManager}
+    , m_memoryReport{[this](const memory_report::AddFn &add) { reportMemoryUsage(add); }}
 {
     NonOwningPointer &pmc = primaryMapCanvas();
     if (pmc == nullptr)
@@ -71,6 +73,35 @@ MapCanvas::MapCanvas(MapData &mapData,
     setCursor(Qt::OpenHandCursor);
     grabGesture(Qt::PinchGesture);
     setContextMenuPolicy(Qt::CustomContextMenu);
+
+    m_mouseMoveTimer.setSingleShot(true);
+    connect(&m_mouseMoveTimer, &QTimer::timeout, this, &MapCanvas::flushMouseMove);
+
+    m_decodedPixmaps = decodePixmapsAsync();
+    // The window isn't shown yet, so this is the ratio of the screen it will likely open on.
+    m_glFont.prefetch(static_cast<float>(devicePixelRatioF()));
+}
+
+void MapCanvas::reportMemoryUsage(const memory_report::AddFn &add)
+{
+    // The vertex data built for the map batches is freed once it's uploaded.
+    add("canvas: vertex buffers (GPU)", getOpenGL().getBufferMemoryUsage());
+
+    MemoryUsage textures;
+    m_textures.for_each([&textures](const SharedMMTexture &tex) {
+        if (tex == nullptr)
+            return;
+        ++textures.count;
+        textures.bytes += tex->getEstimatedBytes();
+    });
+    add("canvas: textures (GPU)", textures);
+
+    MemoryUsage font;
+    if (const SharedMMTexture &tex = getGLFont().getTexture()) {
+        font.count = 1;
+        font.bytes = tex->getEstimatedBytes();
+    }
+    add("canvas: font atlas (GPU)", font);
 }
 
 MapCanvas::~MapCanvas()
@@ -342,7 +373,7 @@ void MapCanvas::slot_createRoom()
         MAYBE_UNUSED const auto ignored = //
             m_data.createEmptyRoom(Coordinate{c.x, c.y, m_currentLayer});
     }
-    mapChanged();
+    roomsChanged();
 }
 
 // REVISIT: This function doesn't need to return a shared ptr. Consider refactoring InfoMarkSelection?
@@ -399,6 +430,7 @@ std::shared_ptr<InfoMarkSelection> MapCanvas::getInfoMarkSelection(const MouseSe
 
 void MapCanvas::mousePressEvent(QMouseEvent *const event)
 {
+    flushMouseMove();
     const bool hasLeftButton = (event->buttons() & Qt::LeftButton) != 0u;
     const bool hasRightButton = (event->buttons() & Qt::RightButton) != 0u;
     const bool hasCtrl = (event->modifiers() & Qt::CTRL) != 0u;
@@ -582,6 +614,27 @@ void MapCanvas::mousePressEvent(QMouseEvent *const event)
 }
 
 void MapCanvas::mouseMoveEvent(QMouseEvent *const event)
+{
+    // The mouse can report many moves per frame; picking after each one would
+    // unproject it and look up rooms (under the map lock) for nothing.
+    if (m_mouseMoveTimer.isActive()) {
+        m_pendingMouseMove = std::make_unique<QMouseEvent>(*event);
+        return;
+    }
+    handleMouseMove(event);
+    m_mouseMoveTimer.start(m_frameScheduler.getFrameIntervalMs());
+}
+
+void MapCanvas::flushMouseMove()
+{
+    m_mouseMoveTimer.stop();
+    if (const std::unique_ptr<QMouseEvent> event = std::exchange(m_pendingMouseMove, nullptr)) {
+        handleMouseMove(event.get());
+        m_mouseMoveTimer.start(m_frameScheduler.getFrameIntervalMs());
+    }
+}
+
+void MapCanvas::handleMouseMove(const QMouseEvent *const event)
 {
     const bool hasLeftButton = (event->buttons() & Qt::LeftButton) != 0u;
 
@@ -708,6 +761,7 @@ void MapCanvas::mouseMoveEvent(QMouseEvent *const event)
 
 void MapCanvas::mouseReleaseEvent(QMouseEvent *const event)
 {
+    flushMouseMove();
     emit sig_continuousScroll(0, 0);
     m_sel2 = getUnprojectedMouseSel(event);
 
@@ -776,9 +830,8 @@ void MapCanvas::mouseReleaseEvent(QMouseEvent *const event)
         }
         // Display a room info tooltip if there was no mouse movement
         if (hasSel1() && hasSel2() && getSel1().to_vec3() == getSel2().to_vec3()) {
-            RoomSelection tmpSel = RoomSelection(m_data, getSel1().getCoordinate());
-            if (!tmpSel.empty()) {
-                QString message = tmpSel.getFirstRoom()->toQString();
+            const QString message = m_data.getRoomTooltip(getSel1().getCoordinate());
+            if (!message.isEmpty()) {
                 QToolTip::showText(mapToGlobal(event->pos()), message, this, rect(), 5000);
             }
         }
@@ -804,11 +857,9 @@ void MapCanvas::mouseReleaseEvent(QMouseEvent *const event)
                 m_roomSelectionMove.reset();
                 if (!wrongPlace && (m_roomSelection != nullptr)) {
                     const Coordinate moverel{pos, 0};
-                    m_data.execute(std::make_unique<GroupMapAction>(std::make_unique<MoveRelative>(
-                                                                        moverel),
-                                                                    m_roomSelection),
+                    m_data.execute(std::make_unique<MoveRooms>(moverel, m_roomSelection),
                                    m_roomSelection);
-                    mapChanged();
+                    roomsChanged();
                 }
 
             } else {
@@ -984,6 +1035,18 @@ void MapCanvas::slot_dataLoaded()
     }
 }
 
+void MapCanvas::slot_moveSessionMarker(const int session, const Coordinate &c)
+{
+    m_sessionMarkers[session] = c;
+    m_frameScheduler.requestFrame();
+}
+
+void MapCanvas::slot_removeSessionMarker(const int session)
+{
+    if (m_sessionMarkers.erase(session) != 0)
+        m_frameScheduler.requestFrame();
+}
+
 void MapCanvas::slot_moveMarker(const Coordinate &c)
 {
     m_data.setPosition(c);
@@ -991,7 +1054,7 @@ void MapCanvas::slot_moveMarker(const Coordinate &c)
     {
         // REVISIT: is the makeCurrent necessary for calling update()?
         // MakeCurrentRaii makeCurrentRaii{*this};
-        update();
+        m_frameScheduler.requestFrame();
     }
 
     emit sig_onCenter(c.to_vec2() + glm::vec2{0.5f, 0.5f});
@@ -999,32 +1062,37 @@ void MapCanvas::slot_moveMarker(const Coordinate &c)
 
 void MapCanvas::infomarksChanged()
 {
-    m_batches.infomarksMeshes.reset();
-    update();
+    m_infomarksChanged = true;
+    m_frameScheduler.requestFrame();
 }
 
 void MapCanvas::layerChanged()
 {
-    update();
+    m_frameScheduler.requestFrame();
 }
 
 void MapCanvas::mapAndInfomarksChanged()
 {
-    m_batches.resetAll();
-    update();
+    m_batches.infomarksMeshes.reset();
+    m_mapBatchesStale = true;
+    m_frameScheduler.requestFrame();
 }
 
 void MapCanvas::mapChanged()
 {
-    // REVISIT: Ideally we'd want to only update the layers/chunks
-    // that actually changed.
-    m_batches.mapBatches.reset();
-    update();
+    // The old batches are drawn until the new ones are ready.
+    m_mapBatchesStale = true;
+    m_frameScheduler.requestFrame();
+}
+
+void MapCanvas::roomsChanged()
+{
+    m_frameScheduler.requestFrame();
 }
 
 void MapCanvas::slot_requestUpdate()
 {
-    update();
+    m_frameScheduler.requestFrame();
 }
 
 void MapCanvas::screenChanged()
@@ -1039,18 +1107,18 @@ void MapCanvas::screenChanged()
         auto &font = getGLFont();
         font.cleanup();
         font.init();
-        update();
+        m_frameScheduler.requestFrame();
     }
 }
 
 void MapCanvas::selectionChanged()
 {
-    update();
+    m_frameScheduler.requestFrame();
 }
 
 void MapCanvas::graphicsSettingsChanged()
 {
-    update();
+    m_frameScheduler.requestFrame();
 }
 
 void MapCanvas::userPressedEscape(bool /*pressed*/)
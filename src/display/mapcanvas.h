@@ -8,6 +8,7 @@
 #include <array>
 #include <cstddef>
 #include <cstdint>
+#include <future>
 #include <glm/glm.hpp>
 #include <map>
 #include <memory>
@@ -21,18 +22,22 @@
 #include <QOpenGLWidget>
 #include <QtCore>
 
+#include "../expandoracommon/coordinate.h"
+#include "../global/MemoryReport.h"
 #include "../mapdata/roomselection.h"
 #include "../opengl/Font.h"
 #include "../opengl/FontFormatFlags.h"
 #include "../opengl/OpenGL.h"
+#include "FrameScheduler.h"
 #include "Infomarks.h"
+#include "MapBatchBuilder.h"
 #include "MapCanvasData.h"
 #include "MapCanvasRoomDrawer.h"
+#include "QualityGovernor.h"
 #include "Textures.h"
 
 class CharacterBatch;
 class ConnectionSelection;
-class Coordinate;
 class InfoMark;
 class InfoMarkSelection;
 class MapData;
@@ -61,6 +66,31 @@ class MapCanvas final : public QOpenGLWidget, private MapCanvasViewport, private
     GLFont m_glFont;
     Batches m_batches;
     MapCanvasTextures m_textures;
+    // Consumed by initTextures().
+    std::future<DecodedPixmaps> m_decodedPixmaps;
+    std::unique_ptr<MapBatchBuilder> m_batchBuilder;
+    FrameScheduler m_frameScheduler{*this};
+    QualityGovernor m_qualityGovernor{[this]() { m_frameScheduler.requestFrame(); }};
+    // Mouse moves are handled at most once a frame; the latest one that
+    // arrived in between waits here.
+    QTimer m_mouseMoveTimer;
+    std::unique_ptr<QMouseEvent> m_pendingMouseMove;
+    // Kept so its buffers can be reused; see paintCharacters().
+    std::unique_ptr<CharacterBatch> m_characterBatch;
+    // Positions of the characters of the additional proxy sessions.
+    std::map<int, Coordinate> m_sessionMarkers;
+    // Changes that are in the map but not yet in the map batches.
+    MeshChunkIdSet m_dirtyMapChunks;
+    bool m_mapBatchesStale = false;
+    // The infomarks batches compare each marker against what they drew.
+    bool m_infomarksChanged = false;
+    OptBounds m_requestedRedrawMargin;
+    // The chunks a restricted map has asked the builder for, including the
+    // empty ones; unset while the whole map is built. See streamMapChunks().
+    std::optional<MeshChunkIdSet> m_streamedChunks;
+    std::optional<Coordinate> m_lastStreamCenter;
+    // Frames drawn by renderMapBatches(), to find the least recently drawn chunks.
+    uint64_t m_frameCount = 0;
     MapData &m_data;
 
     Mmapper2Group &m_groupManager;
@@ -69,8 +99,42 @@ class MapCanvas final : public QOpenGLWidget, private MapCanvasViewport, private
         std::optional<int> multisampling;
         std::optional<bool> trilinear;
     } graphicsOptionsStatus;
+    // Chunks of the map batches in the last frame.
+    struct NODISCARD ChunkStats final
+    {
+        size_t drawn = 0;
+        size_t culled = 0;
+    } m_chunkStats;
+    // The parts of actuallyPaintGL() that the perf stats time separately.
+    enum class NODISCARD PaintPhaseEnum : uint8_t { MAP, INFOMARKS, SELECTIONS, CHARACTERS };
+    static constexpr const size_t NUM_PAINT_PHASES = 4;
+    // CPU time of each phase in the last frame, when the perf stats are shown.
+    std::array<double, NUM_PAINT_PHASES> m_paintPhaseMs{};
+
+public:
+    // What paintGL() measured in the last frame; only filled in while the perf
+    // stats are shown. The benchmark in tests/BenchMapCanvas.cpp reads this.
+    struct NODISCARD FrameReport final
+    {
+        double totalMs = 0.0;
+        double updateBatchesMs = 0.0;
+        double paintMs = 0.0;
+        std::array<double, NUM_PAINT_PHASES> phaseMs{};
+        // From the timer queries, which lag a few frames behind.
+        std::vector<std::optional<double>> gpuPhaseMs;
+        GLFrameStats glStats;
+        size_t chunksDrawn = 0;
+        size_t chunksCulled = 0;
+        // Set when a map batch build finished and was uploaded in this frame.
+        std::optional<double> mapBatchBuildMs;
+    };
+    NODISCARD const FrameReport &getLastFrameReport() const { return m_lastFrameReport; }
+
+private:
+    FrameReport m_lastFrameReport;
 
     std::unique_ptr<QOpenGLDebugLogger> m_logger;
+    memory_report::Registration m_memoryReport;
 
 public:
     explicit MapCanvas(MapData &mapData,
@@ -86,6 +150,7 @@ class MapCanvas final : public QOpenGLWidget, private MapCanvasViewport, private
     NODISCARD inline auto &getOpenGL() { return m_opengl; }
     NODISCARD inline auto &getGLFont() { return m_glFont; }
     void cleanupOpenGL();
+    void reportMemoryUsage(const memory_report::AddFn &add);
 
 public:
     NODISCARD QSize minimumSizeHint() const override;
@@ -140,6 +205,8 @@ public slots:
 
     void slot_dataLoaded();
     void slot_moveMarker(const Coordinate &coord);
+    void slot_moveSessionMarker(int session, const Coordinate &coord);
+    void slot_removeSessionMarker(int session);
 
     void slot_onMessageLoggedDirect(const QOpenGLDebugMessage &message);
     void slot_infomarksChanged() { infomarksChanged(); }
@@ -177,12 +244,16 @@ public slots:
     bool event(QEvent *e) override;
 
 private:
+    void handleMouseMove(const QMouseEvent *event);
+    void flushMouseMove();
     void initLogger();
 
     void resizeGL() { resizeGL(width(), height()); }
     void initTextures();
     void updateTextures();
     void updateMultisampling();
+    // Tells the quality governor how long the frame took; cpuMs is this frame's paintGL().
+    void reportFrameTime(double cpuMs);
 
     NODISCARD
     std::shared_ptr<InfoMarkSelection> getInfoMarkSelection(const MouseSel &sel);
@@ -199,14 +270,25 @@ public slots:
     void setMvp(const glm::mat4 &viewProj);
     void setViewportAndMvp(int width, int height);
 
-    NODISCARD BatchedInfomarksMeshes getInfoMarksMeshes();
+    NODISCARD InfomarksMeshes getInfoMarksMeshes(int layer);
     void drawInfoMark(InfomarksBatch &batch,
                       InfoMark *marker,
                       int currentLayer,
                       const glm::vec2 &offset = {},
                       const std::optional<Color> &overrideColor = std::nullopt);
     void updateBatches();
+    NODISCARD FullDetailLayers getFullDetailLayers() const;
     void updateMapBatches();
+    NODISCARD static OptBounds getChunkAlignedBounds(const Coordinate &center,
+                                                     const Coordinate &radius);
+    NODISCARD MeshChunkIdSet getChunksAround(const Coordinate &center,
+                                             const Coordinate &radius) const;
+    // Builds just the chunks that came into range, instead of the whole box.
+    void streamMapChunks(const Coordinate &center,
+                         const Coordinate &radius,
+                         const FullDetailLayers &detailLayers);
+    // Drops out of range chunks, least recently drawn first, until they fit the budget.
+    void evictStreamedChunks(const MeshChunkIdSet &wanted);
     void updateInfomarkBatches();
 
     void actuallyPaintGL();
@@ -228,6 +310,8 @@ public slots:
     void infomarksChanged();
     void layerChanged();
     void mapChanged();
+    // The changed rooms have already flagged the chunks to rebuild.
+    void roomsChanged();
     void slot_requestUpdate();
     void screenChanged();
     void selectionChanged();
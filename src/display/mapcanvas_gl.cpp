@@ -36,7 +36,10 @@
 #include "../global/Array.h"
 #include "../global/ChangeMonitor.h"
 #include "../global/Debug.h"
+#include "../global/EventTrace.h"
+#include "../global/PerfCounters.h"
 #include "../global/RuleOf5.h"
+#include "../global/StartupProfiler.h"
 #include "../global/utils.h"
 #include "../mapdata/mapdata.h"
 #include "../opengl/Font.h"
@@ -44,6 +47,7 @@
 #include "../opengl/OpenGL.h"
 #include "../opengl/OpenGLTypes.h"
 #include "Connections.h"
+#include "LabelDeclutter.h"
 #include "MapCanvasConfig.h"
 #include "MapCanvasData.h"
 #include "MapCanvasRoomDrawer.h"
@@ -102,6 +106,16 @@ void setShowPerfStats(const bool show)
     setConfig().canvas.advanced.printPerfStats.set(show);
 }
 
+bool isAdaptiveQuality()
+{
+    return getConfig().canvas.advanced.adaptiveQuality.get();
+}
+
+void setAdaptiveQuality(const bool val)
+{
+    setConfig().canvas.advanced.adaptiveQuality.set(val);
+}
+
 } // namespace MapCanvasConfig
 
 class NODISCARD MakeCurrentRaii final
@@ -128,6 +142,8 @@ void MapCanvas::cleanupOpenGL()
 
     // note: m_batchedMeshes co-owns textures created by MapCanvasData,
     // and it also owns the lifetime of some OpenGL objects (e.g. VBOs).
+    // The builder has to go first, since it uses the textures.
+    m_batchBuilder.reset();
     m_batches.resetAll();
     m_textures.destroyAll();
     getGLFont().cleanup();
@@ -188,6 +204,7 @@ void MapCanvas::reportGLVersion()
                .arg(context()->isValid() ? "valid" : "invalid")
                .toUtf8());
     logMsg("Display:", QString("%1 DPI").arg(QPaintDevice::devicePixelRatioF()).toUtf8());
+    logMsg("Renderer backend:", QByteArray{gl.getBackendName()});
 }
 
 bool MapCanvas::isBlacklistedDriver()
@@ -236,6 +253,12 @@ void MapCanvas::initializeGL()
     updateMultisampling();
     initTextures();
     getGLFont().init();
+
+    m_batchBuilder = std::make_unique<MapBatchBuilder>(m_textures);
+    connect(m_batchBuilder.get(), &MapBatchBuilder::sig_finished, this, [this]() {
+        m_frameScheduler.requestFrame();
+    });
+    startup_profiler::mark(StartupPhaseEnum::OPENGL_READY);
 }
 
 /* Direct means it is always called from the emitter's thread */
@@ -342,7 +365,6 @@ glm::mat4 MapCanvas::getViewProj(const glm::vec2 &scrollPos,
     const auto layerHeight = advanced.layerHeight.getFloat();
 
     const auto pixelScale = [aspect, fovDegrees, width]() -> float {
-        constexpr float HARDCODED_LOGICAL_PIXELS = 44.f;
         const auto dummyProj = glm::perspective(glm::radians(fovDegrees), aspect, 1.f, 10.f);
 
         const auto centerRoomProj = glm::inverse(dummyProj) * glm::vec4(0.f, 0.f, 0.f, 1.f);
@@ -356,7 +378,7 @@ glm::mat4 MapCanvas::getViewProj(const glm::vec2 &scrollPos,
         // width is in logical pixels
         const float screenDist = ndcDist * static_cast<float>(width);
         const auto pixels = std::abs(centerRoom.z) * screenDist;
-        return pixels / HARDCODED_LOGICAL_PIXELS;
+        return pixels / ROOM_PIXELS_AT_UNIT_ZOOM;
     }();
 
     const float ZSCALE = layerHeight;
@@ -409,6 +431,8 @@ glm::mat4 MapCanvas::getViewProj(const glm::vec2 &scrollPos,
 void MapCanvas::setMvp(const glm::mat4 &viewProj)
 {
     auto &gl = getOpenGL();
+    if (viewProj != m_viewProj)
+        m_qualityGovernor.onViewMoved();
     m_viewProj = viewProj;
     gl.setProjectionMatrix(m_viewProj);
 }
@@ -440,7 +464,7 @@ void MapCanvas::resizeGL(int width, int height)
     setViewportAndMvp(width, height);
 
     // Render
-    update();
+    m_frameScheduler.requestFrame();
 }
 
 void MapCanvas::updateBatches()
@@ -449,59 +473,231 @@ void MapCanvas::updateBatches()
     updateInfomarkBatches();
 }
 
+FullDetailLayers MapCanvas::getFullDetailLayers() const
+{
+    return FullDetailLayers{m_currentLayer, std::max(0, getConfig().canvas.layerBudget)};
+}
+
 void MapCanvas::updateMapBatches()
 {
+    if (m_batchBuilder == nullptr) {
+        // initializeGL() failed
+        return;
+    }
+
+    MapBatchBuilder &builder = *m_batchBuilder;
+    std::optional<MapBatches> &opt_mapBatches = m_batches.mapBatches;
+    if (std::optional<MapBatchesData> finished = builder.takeFinished()) {
+        if (MapCanvasConfig::getShowPerfStats()) {
+            const auto buildTime = builder.getLastBuildTime();
+            m_lastFrameReport.mapBatchBuildMs = static_cast<double>(buildTime.count()) * 1e-6;
+        }
+        const bool isUpdate = finished->replaced.has_value();
+        if (isUpdate && !opt_mapBatches.has_value()) {
+            // The batches it was going to update have been thrown away.
+            m_mapBatchesStale = true;
+        } else {
+            MapCanvasRoomDrawer drawer{getOpenGL(), getGLFont(), opt_mapBatches};
+            drawer.uploadBatches(std::move(finished.value()));
+            if (!isUpdate) {
+                opt_mapBatches->redrawMargin = m_requestedRedrawMargin;
+                if (m_streamedChunks.has_value()) {
+                    // From now on, the streamed chunks decide what's in the batches.
+                    opt_mapBatches->bounds = OptBounds{};
+                }
+            }
+        }
+    }
+
     if (m_data.getNeedsMapUpdate()) {
-        m_batches.mapBatches.reset();
+        // Editing or mapping a room only rebuilds the chunks around it.
+        if (const MeshChunkIdSet *const dirtyChunks = m_data.getDirtyChunks()) {
+            m_dirtyMapChunks.insert(dirtyChunks->begin(), dirtyChunks->end());
+        } else {
+            m_mapBatchesStale = true;
+        }
         m_data.clearNeedsMapUpdate();
         assert(!m_data.getNeedsMapUpdate());
     }
 
+    const FullDetailLayers detailLayers = getFullDetailLayers();
+    if (opt_mapBatches.has_value()) {
+        // Chunks that came into range since they were built get the rest of their meshes.
+        for (const auto &[chunk, meshes] : opt_mapBatches->chunks) {
+            if (!meshes.fullDetail && detailLayers.contains(chunk.z)) {
+                m_dirtyMapChunks.insert(chunk);
+            }
+        }
+    }
+
+    if (builder.isBusy()) {
+        // The current batches keep being drawn until the new ones are ready;
+        // anything that changed in the meantime is built next.
+        return;
+    }
+
     const Coordinate &center = [this]() {
         const auto &screenCenter = m_mapScreen.getCenter();
         return Coordinate{static_cast<int>(screenCenter.x),
                           static_cast<int>(screenCenter.y),
                           m_currentLayer};
     }();
-    std::optional<MapBatches> &opt_mapBatches = m_batches.mapBatches;
-    if (opt_mapBatches && opt_mapBatches->redrawMargin.contains(center)) {
-        return;
-    }
-
     const auto radius = []() -> Coordinate {
         const auto &r = getConfig().canvas.mapRadius;
         return Coordinate{r[0], r[1], r[2]};
     }();
 
-    const OptBounds bounds = [&center, &radius]() -> OptBounds {
-        // TODO: allow unrestricted map if there hasn't been a map update or movement within N seconds.
-        // This could be done by using a timer to increment a counter on mapBatches,
-        // and then reset the counter if the player moves.
-        const bool restrict = []() -> bool {
-            const Configuration &config = getConfig();
-            switch (config.canvas.useRestrictedMap) {
-            case RestrictMapEnum::Never:
-                return false;
-            case RestrictMapEnum::Always:
-                return true;
-            case RestrictMapEnum::OnlyInMapMode:
-                return config.general.mapMode == MapModeEnum::MAP;
+    // TODO: allow unrestricted map if there hasn't been a map update or movement within N seconds.
+    // This could be done by using a timer to increment a counter on mapBatches,
+    // and then reset the counter if the player moves.
+    const bool restrict = []() -> bool {
+        const Configuration &config = getConfig();
+        switch (config.canvas.useRestrictedMap) {
+        case RestrictMapEnum::Never:
+            return false;
+        case RestrictMapEnum::Always:
+            return true;
+        case RestrictMapEnum::OnlyInMapMode:
+            return config.general.mapMode == MapModeEnum::MAP;
+        }
+        std::abort();
+    }();
+
+    if (!m_mapBatchesStale && opt_mapBatches) {
+        if (opt_mapBatches->redrawMargin.contains(center)) {
+            if (!m_dirtyMapChunks.empty()) {
+                builder.build(m_data.getSnapshot(),
+                              opt_mapBatches->bounds,
+                              std::exchange(m_dirtyMapChunks, {}),
+                              detailLayers);
             }
-            std::abort();
-        }();
+            return;
+        }
+        if (restrict && m_streamedChunks.has_value()) {
+            streamMapChunks(center, radius, detailLayers);
+            return;
+        }
+    }
 
-        return restrict                                          //
-                   ? OptBounds::fromCenterRadius(center, radius) //
-                   : OptBounds{};                                //
-    }();
+    // A restricted map is built in whole chunks, so that the builder can
+    // stream in more of them later without rebuilding these.
+    const OptBounds bounds = restrict ? getChunkAlignedBounds(center, radius) : OptBounds{};
+    m_requestedRedrawMargin = restrict ? OptBounds::fromCenterRadius(center, radius * 3 / 4)
+                                       : OptBounds{};
+    m_streamedChunks.reset();
+    m_lastStreamCenter.reset();
+    if (restrict) {
+        m_streamedChunks = getChunksAround(center, radius);
+        m_lastStreamCenter = center;
+    }
+    // The snapshot has every change so far, so the dirty chunks come along for free.
+    builder.build(m_data.getSnapshot(), bounds, std::nullopt, detailLayers);
+    m_mapBatchesStale = false;
+    m_dirtyMapChunks.clear();
+}
+
+OptBounds MapCanvas::getChunkAlignedBounds(const Coordinate &center, const Coordinate &radius)
+{
+    const Coordinate lo = MeshChunkId::fromCoordinate(center - radius).getMin();
+    const Coordinate hi = MeshChunkId::fromCoordinate(center + radius).getMax();
+    return OptBounds{Coordinate{lo.x, lo.y, center.z - radius.z},
+                     Coordinate{hi.x, hi.y, center.z + radius.z}};
+}
+
+MeshChunkIdSet MapCanvas::getChunksAround(const Coordinate &center, const Coordinate &radius) const
+{
+    // Layers without rooms don't have any chunks; rooms mapped on a new
+    // layer later come in as dirty chunks.
+    const MeshChunkId lo = MeshChunkId::fromCoordinate(center - radius);
+    const MeshChunkId hi = MeshChunkId::fromCoordinate(center + radius);
+    const int minZ = std::max(lo.z, m_data.getMin().z);
+    const int maxZ = std::min(hi.z, m_data.getMax().z);
+
+    MeshChunkIdSet result;
+    for (int z = minZ; z <= maxZ; ++z) {
+        for (int y = lo.y; y <= hi.y; ++y) {
+            for (int x = lo.x; x <= hi.x; ++x) {
+                result.emplace_hint(result.end(), MeshChunkId{x, y, z});
+            }
+        }
+    }
+    return result;
+}
+
+void MapCanvas::streamMapChunks(const Coordinate &center,
+                                const Coordinate &radius,
+                                const FullDetailLayers &detailLayers)
+{
+    MapBatches &batches = m_batches.mapBatches.value();
+    MeshChunkIdSet &streamed = m_streamedChunks.value();
+
+    // Half a radius ahead in the direction of travel, so the next step is
+    // usually already there.
+    MeshChunkIdSet wanted = getChunksAround(center, radius);
+    if (m_lastStreamCenter.has_value()) {
+        const Coordinate travel = center - m_lastStreamCenter.value();
+        const auto sign = [](const int v) { return (v > 0) - (v < 0); };
+        const Coordinate ahead{sign(travel.x) * radius.x / 2, sign(travel.y) * radius.y / 2, 0};
+        if (!ahead.isNull()) {
+            wanted.merge(getChunksAround(center + ahead, radius));
+        }
+    }
+    m_lastStreamCenter = center;
+
+    MeshChunkIdSet missing = std::exchange(m_dirtyMapChunks, {});
+    for (const MeshChunkId &chunk : wanted) {
+        if (streamed.insert(chunk).second) {
+            missing.insert(chunk);
+        }
+    }
+    evictStreamedChunks(wanted);
+
+    batches.redrawMargin = OptBounds::fromCenterRadius(center, radius * 3 / 4);
+    if (!missing.empty()) {
+        // Whole chunks, like the first build.
+        m_batchBuilder->build(m_data.getSnapshot(), OptBounds{}, std::move(missing), detailLayers);
+    }
+}
 
-    MapCanvasRoomDrawer drawer{m_textures, getOpenGL(), getGLFont(), opt_mapBatches};
+void MapCanvas::evictStreamedChunks(const MeshChunkIdSet &wanted)
+{
+    // The chunks behind the player are kept as long as they fit, in case they come back.
+    static constexpr const size_t STREAMED_CHUNKS_VRAM_BUDGET = size_t{256} << 20;
+
+    BatchedChunks &chunks = m_batches.mapBatches.value().chunks;
+    MeshChunkIdSet &streamed = m_streamedChunks.value();
+    size_t total = 0;
+    std::vector<std::pair<uint64_t, MeshChunkId>> candidates;
+    for (const auto &[chunk, meshes] : chunks) {
+        total += meshes.vramBytes;
+        if (wanted.count(chunk) == 0) {
+            candidates.emplace_back(meshes.lastDrawnFrame, chunk);
+        }
+    }
+    if (total <= STREAMED_CHUNKS_VRAM_BUDGET) {
+        return;
+    }
 
-    /// The following ends up calling MapCanvasRoomDrawer::generateBatches()
-    m_data.generateBatches(drawer, bounds);
+    // Least recently drawn first.
+    std::sort(candidates.begin(), candidates.end(), [](const auto &a, const auto &b) {
+        return a.first < b.first;
+    });
+    for (const auto &candidate : candidates) {
+        if (total <= STREAMED_CHUNKS_VRAM_BUDGET) {
+            break;
+        }
+        const auto it = chunks.find(candidate.second);
+        total -= it->second.vramBytes;
+        chunks.erase(it);
+    }
 
-    if (bounds.isRestricted()) {
-        m_batches.mapBatches->redrawMargin = OptBounds::fromCenterRadius(center, radius * 3 / 4);
+    // Forget the empty chunks that are out of range too, so they don't pile up.
+    for (auto it = streamed.begin(); it != streamed.end();) {
+        if (wanted.count(*it) == 0 && chunks.count(*it) == 0) {
+            it = streamed.erase(it);
+        } else {
+            ++it;
+        }
     }
 }
 
@@ -517,17 +713,45 @@ void MapCanvas::actuallyPaintGL()
         return;
     }
 
-    paintMap();
-    paintBatchedInfomarks();
-    paintSelections();
-    paintCharacters();
+    if (!MapCanvasConfig::getShowPerfStats()) {
+        // The quality governor only needs the whole frame.
+        const bool timeFrame = m_qualityGovernor.isEnabled() && gl.canTimeQueries();
+        if (timeFrame)
+            gl.beginTimerQuery(0);
+        paintMap();
+        paintBatchedInfomarks();
+        paintSelections();
+        paintCharacters();
+        if (timeFrame)
+            gl.endTimerQuery();
+        return;
+    }
+
+    using Clock = std::chrono::high_resolution_clock;
+    const bool wantTimerQueries = gl.canTimeQueries();
+    const auto timed = [this, &gl, wantTimerQueries](const PaintPhaseEnum phase, auto &&paint) {
+        const auto index = static_cast<size_t>(phase);
+        if (wantTimerQueries)
+            gl.beginTimerQuery(index);
+        const auto start = Clock::now();
+        paint();
+        const auto delta = Clock::now() - start;
+        if (wantTimerQueries)
+            gl.endTimerQuery();
+        m_paintPhaseMs[index]
+            = double(std::chrono::duration_cast<std::chrono::nanoseconds>(delta).count()) * 1e-6;
+    };
+
+    timed(PaintPhaseEnum::MAP, [this]() { paintMap(); });
+    timed(PaintPhaseEnum::INFOMARKS, [this]() { paintBatchedInfomarks(); });
+    timed(PaintPhaseEnum::SELECTIONS, [this]() { paintSelections(); });
+    timed(PaintPhaseEnum::CHARACTERS, [this]() { paintCharacters(); });
 }
 
 void MapCanvas::paintMap()
 {
     if (!m_batches.mapBatches.has_value()) {
-        // This should never happen.
-        getGLFont().renderTextCentered("Batch error");
+        // The first batches are still being built.
         return;
     }
 
@@ -545,24 +769,41 @@ void MapCanvas::paintSelections()
 void MapCanvas::paintGL()
 {
     static thread_local double longestBatchMs = 0.0;
+    m_frameScheduler.onFramePainted();
+    startup_profiler::mark(StartupPhaseEnum::FIRST_FRAME);
 
     const bool showPerfStats = MapCanvasConfig::getShowPerfStats();
+    m_qualityGovernor.setEnabled(MapCanvasConfig::isAdaptiveQuality());
 
     using Clock = std::chrono::high_resolution_clock;
+    const auto frameStart = Clock::now();
     std::optional<Clock::time_point> optStart;
     std::optional<Clock::time_point> optAfterTextures;
     std::optional<Clock::time_point> optAfterBatches;
-    if (showPerfStats)
+    if (showPerfStats) {
         optStart = Clock::now();
+        m_paintPhaseMs.fill(0.0);
+        m_lastFrameReport = FrameReport{};
+        getOpenGL().resetFrameStats();
+    }
 
     {
-        updateMultisampling();
-        updateTextures();
+        perf_counters::add(PerfCounterEnum::FRAMES);
+        perf_counters::ScopedTimer timer{PerfHistogramEnum::FRAME};
+        event_trace::Scope frameScope{"MapCanvas::paintGL"};
+        {
+            event_trace::Scope scope{"MapCanvas::updateTextures"};
+            updateMultisampling();
+            updateTextures();
+        }
         if (showPerfStats)
             optAfterTextures = Clock::now();
 
-        // Note: The real work happens here!
-        updateBatches();
+        {
+            // Note: The real work happens here!
+            event_trace::Scope scope{"MapCanvas::updateBatches"};
+            updateBatches();
+        }
 
         // For accurate timing of the update, we'd need to call glFinish(),
         // or at least set up an OpenGL query object. The update will send
@@ -570,17 +811,40 @@ void MapCanvas::paintGL()
         if (showPerfStats)
             optAfterBatches = Clock::now();
 
+        event_trace::Scope scope{"MapCanvas::actuallyPaintGL"};
         actuallyPaintGL();
     }
 
-    if (!showPerfStats)
+    const auto cpuMs = [&frameStart]() -> double {
+        const auto delta = Clock::now() - frameStart;
+        return double(std::chrono::duration_cast<std::chrono::nanoseconds>(delta).count()) * 1e-6;
+    };
+
+    if (!showPerfStats) {
+        if (m_qualityGovernor.isEnabled()) {
+            if (getOpenGL().canTimeQueries())
+                getOpenGL().endTimerQueryFrame();
+            reportFrameTime(cpuMs());
+        }
         return; /* don't wait to finish */
+    }
+
+    auto &gl = getOpenGL();
+    const GLFrameStats frameStats = gl.getFrameStats();
+    const bool hasTimerQueries = gl.canTimeQueries();
+    if (hasTimerQueries)
+        gl.endTimerQueryFrame();
 
     const auto &start = optStart.value();
     const auto &afterTextures = optAfterTextures.value();
     const auto &afterBatches = optAfterBatches.value();
     const auto afterPaint = Clock::now();
-    const bool calledFinish = [this]() -> bool {
+    if (m_qualityGovernor.isEnabled())
+        reportFrameTime(cpuMs());
+    // The timer queries measure the GPU without stalling it, so this is only a fallback.
+    const bool calledFinish = [this, hasTimerQueries]() -> bool {
+        if (hasTimerQueries)
+            return false;
         if (auto *const ctxt = QOpenGLWidget::context())
             if (auto *const func = ctxt->functions()) {
                 func->glFinish();
@@ -622,19 +886,67 @@ void MapCanvas::paintGL()
     const auto batchTime = ms(afterBatches - afterTextures);
 
     const auto total = ms(end - start);
-    print(QString::asprintf(
-        "%.1f (updateTextures) + %.1f (updateBatches) + %.1f (paintGL) + %.1f (glFinish%s) = %.1f ms",
-        texturesTime,
-        batchTime,
-        ms(afterPaint - afterBatches),
-        ms(end - afterPaint),
-        calledFinish ? "" : "*",
-        total));
-    if (!calledFinish)
-        print("* = unable to call glFinish()");
+    if (hasTimerQueries) {
+        print(QString::asprintf("%.1f (updateTextures) + %.1f (updateBatches) + %.1f (paintGL) "
+                                "= %.1f ms CPU",
+                                texturesTime,
+                                batchTime,
+                                ms(afterPaint - afterBatches),
+                                total));
+    } else {
+        print(QString::asprintf("%.1f (updateTextures) + %.1f (updateBatches) + %.1f (paintGL) "
+                                "+ %.1f (glFinish%s) = %.1f ms",
+                                texturesTime,
+                                batchTime,
+                                ms(afterPaint - afterBatches),
+                                ms(end - afterPaint),
+                                calledFinish ? "" : "*",
+                                total));
+        if (!calledFinish)
+            print("* = unable to call glFinish()");
+    }
+
+    {
+        static constexpr const std::array<const char *, NUM_PAINT_PHASES> PHASE_NAMES{
+            "map", "infomarks", "selections", "characters"};
+        const auto &gpuMs = gl.getTimerQueryResultsMs();
+        for (size_t i = 0; i < NUM_PAINT_PHASES; ++i) {
+            const std::optional<double> gpu = (i < gpuMs.size()) ? gpuMs[i] : std::nullopt;
+            if (gpu.has_value()) {
+                print(QString::asprintf("%s: %.2f ms CPU, %.2f ms GPU",
+                                        PHASE_NAMES[i],
+                                        m_paintPhaseMs[i],
+                                        gpu.value()));
+            } else {
+                print(QString::asprintf("%s: %.2f ms CPU, GPU %s",
+                                        PHASE_NAMES[i],
+                                        m_paintPhaseMs[i],
+                                        hasTimerQueries ? "pending" : "n/a"));
+            }
+        }
+    }
+    print(QString::asprintf("%zu draw calls, %zu vertices, %.1f KiB uploaded",
+                            frameStats.drawCalls,
+                            frameStats.vertices,
+                            static_cast<double>(frameStats.bytesUploaded) / 1024.0));
+
+    {
+        FrameReport &report = m_lastFrameReport;
+        report.totalMs = total;
+        report.updateBatchesMs = batchTime;
+        report.paintMs = ms(afterPaint - afterBatches);
+        report.phaseMs = m_paintPhaseMs;
+        report.gpuPhaseMs = gl.getTimerQueryResultsMs();
+        report.glStats = frameStats;
+        report.chunksDrawn = m_chunkStats.drawn;
+        report.chunksCulled = m_chunkStats.culled;
+    }
 
     longestBatchMs = std::max(batchTime, longestBatchMs);
     print(QString::asprintf("Worst updateBatches: %.1f ms", longestBatchMs));
+    print(QString::asprintf("Map chunks: %zu drawn, %zu culled",
+                            m_chunkStats.drawn,
+                            m_chunkStats.culled));
 
     const auto &advanced = getConfig().canvas.advanced;
     const float zoom = getTotalScaleFactor();
@@ -710,7 +1022,10 @@ void MapCanvas::paintSelectionArea()
 
 void MapCanvas::updateMultisampling()
 {
-    const int wantMultisampling = getConfig().canvas.antialiasingSamples;
+    const int wantMultisampling
+        = (m_qualityGovernor.getQuality() == RenderQualityEnum::FULL)
+              ? getConfig().canvas.antialiasingSamples
+              : 0;
     std::optional<int> &activeStatus = graphicsOptionsStatus.multisampling;
     if (activeStatus == wantMultisampling)
         return;
@@ -720,6 +1035,26 @@ void MapCanvas::updateMultisampling()
     activeStatus = wantMultisampling;
 }
 
+void MapCanvas::reportFrameTime(const double cpuMs)
+{
+    auto &gl = getOpenGL();
+    if (!gl.canTimeQueries()) {
+        m_qualityGovernor.onFrameTime(cpuMs, m_frameScheduler.getFrameIntervalMs());
+        return;
+    }
+
+    // The GPU time is from a few frames ago; nothing is reported until it's ready.
+    std::optional<double> gpuMs;
+    for (const std::optional<double> &phaseMs : gl.getTimerQueryResultsMs()) {
+        if (phaseMs.has_value())
+            gpuMs = gpuMs.value_or(0.0) + phaseMs.value();
+    }
+    if (gpuMs.has_value()) {
+        m_qualityGovernor.onFrameTime(std::max(cpuMs, gpuMs.value()),
+                                      m_frameScheduler.getFrameIntervalMs());
+    }
+}
+
 void MapCanvas::renderMapBatches()
 {
     std::optional<MapBatches> &mapBatches = m_batches.mapBatches;
@@ -732,44 +1067,58 @@ void MapCanvas::renderMapBatches()
     const Configuration::CanvasSettings &settings = getConfig().canvas;
 
     const float totalScaleFactor = getTotalScaleFactor();
-    const auto wantExtraDetail = totalScaleFactor >= settings.extraDetailScaleCutoff;
+    // See QualityGovernor.
+    const bool reduced = m_qualityGovernor.getQuality() == RenderQualityEnum::REDUCED_DETAIL;
+    const auto wantExtraDetail = !reduced && totalScaleFactor >= settings.extraDetailScaleCutoff;
     const auto wantDoorNames = settings.drawDoorNames
                                && (totalScaleFactor >= settings.doorNameScaleCutoff);
+    const MapLodEnum lod = [&settings, totalScaleFactor, reduced]() -> MapLodEnum {
+        if (totalScaleFactor < settings.colorTileScaleCutoff)
+            return MapLodEnum::COLOR_TILES;
+        if (reduced || totalScaleFactor < settings.reducedDetailScaleCutoff)
+            return MapLodEnum::REDUCED;
+        return MapLodEnum::FULL;
+    }();
 
     auto &gl = getOpenGL();
-    BatchedMeshes &batchedMeshes = batches.batchedMeshes;
-    const auto drawLayer =
-        [&batches, &batchedMeshes, wantExtraDetail, wantDoorNames](const int thisLayer,
-                                                                   const int currentLayer) {
-            const auto it_mesh = batchedMeshes.find(thisLayer);
-            if (it_mesh != batchedMeshes.end()) {
-                LayerMeshes &meshes = it_mesh->second;
-                meshes.render(thisLayer, currentLayer);
-            }
+    m_chunkStats = ChunkStats{};
+    ++m_frameCount;
+    std::vector<ChunkMeshes *> visible;
+    std::vector<ChunkMeshes *> visibleNames;
+    // Each pass covers every visible chunk of the layer before the next one
+    // starts, so connections and names are never drawn under a neighbouring chunk.
+    const FullDetailLayers detailLayers = getFullDetailLayers();
+    // Far layers are only drawn as their color tiles, even if they have the rest.
+    const auto drawLayer = [lod,
+                            totalScaleFactor,
+                            wantExtraDetail,
+                            wantDoorNames,
+                            &visible,
+                            &visibleNames](const int thisLayer,
+                                           const int currentLayer,
+                                           const bool isFar) {
+        for (ChunkMeshes *const chunk : visible) {
+            const bool colorTileOnly = isFar || !chunk->fullDetail;
+            chunk->meshes.render(thisLayer,
+                                 currentLayer,
+                                 colorTileOnly ? MapLodEnum::COLOR_TILES : lod);
+        }
 
-            if (wantExtraDetail) {
-                {
-                    BatchedConnectionMeshes &connectionMeshes = batches.connectionMeshes;
-                    const auto it_conn = connectionMeshes.find(thisLayer);
-                    if (it_conn != connectionMeshes.end()) {
-                        ConnectionMeshes &meshes = it_conn->second;
-                        meshes.render(thisLayer, currentLayer);
-                    }
-                }
+        if (wantExtraDetail && !isFar) {
+            for (ChunkMeshes *const chunk : visible) {
+                chunk->connectionMeshes.render(thisLayer, currentLayer);
+            }
 
-                // NOTE: This can display room names in lower layers, but the text
-                // isn't currently drawn with an appropriate Z-offset, so it doesn't
-                // stay aligned to its actual layer when you switch view layers.
-                if (wantDoorNames && thisLayer == currentLayer) {
-                    BatchedRoomNames &roomNameBatches = batches.roomNameBatches;
-                    const auto it_name = roomNameBatches.find(thisLayer);
-                    if (it_name != roomNameBatches.end()) {
-                        auto &roomNameBatch = it_name->second;
-                        roomNameBatch.render(GLRenderState());
-                    }
+            // NOTE: This can display room names in lower layers, but the text
+            // isn't currently drawn with an appropriate Z-offset, so it doesn't
+            // stay aligned to its actual layer when you switch view layers.
+            if (wantDoorNames && thisLayer == currentLayer) {
+                for (ChunkMeshes *const chunk : visibleNames) {
+                    chunk->roomNames.render(GLRenderState(), totalScaleFactor);
                 }
             }
-        };
+        }
+    };
 
     const auto fadeBackground = [&gl, &settings]() {
         auto bgColor = Color{settings.backgroundColor.getColor(), 0.5f};
@@ -780,12 +1129,35 @@ void MapCanvas::renderMapBatches()
         gl.renderPlainFullScreenQuad(blendedWithBackground);
     };
 
-    for (const auto &layer : batchedMeshes) {
-        const int thisLayer = layer.first;
+    // Names are measured in pixels, so their chunk's box is really a bit bigger.
+    static constexpr const float NAME_MARGIN_PIXELS = 256.f;
+    BatchedChunks &chunks = batches.chunks;
+    for (auto it = chunks.begin(); it != chunks.end();) {
+        const int thisLayer = it->first.z;
+        const auto end = chunks.lower_bound(MeshChunkId{std::numeric_limits<int>::min(),
+                                                        std::numeric_limits<int>::min(),
+                                                        thisLayer + 1});
+        visible.clear();
+        visibleNames.clear();
+        size_t numChunks = 0;
+        for (; it != end; ++it, ++numChunks) {
+            ChunkMeshes &chunk = it->second;
+            const ChunkBounds &box = chunk.bounds;
+            if (isBoxVisible(box.min, box.max)) {
+                visible.emplace_back(&chunk);
+                chunk.lastDrawnFrame = m_frameCount;
+            }
+            if (isBoxVisible(box.min, box.max, NAME_MARGIN_PIXELS)) {
+                visibleNames.emplace_back(&chunk);
+            }
+        }
+        m_chunkStats.drawn += visible.size();
+        m_chunkStats.culled += numChunks - visible.size();
+
         if (thisLayer == m_currentLayer) {
             gl.clearDepth();
             fadeBackground();
         }
-        drawLayer(thisLayer, m_currentLayer);
+        drawLayer(thisLayer, m_currentLayer, !detailLayers.contains(thisLayer));
     }
 }
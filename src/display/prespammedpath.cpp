@@ -5,6 +5,7 @@
 
 #include "prespammedpath.h"
 
+#include <algorithm>
 #include <utility>
 
 #include "../parser/CommandId.h"
@@ -36,5 +37,69 @@ PrespammedPath::~PrespammedPath() = default;
 void PrespammedPath::slot_setPath(CommandQueue queue)
 {
     m_queue = std::move(queue);
+    ++m_queueVersion;
     emit sig_update();
 }
+
+std::optional<size_t> PrespammedPath::findResumePoint(
+    const Coordinate &start, const std::vector<CommandEnum> &commands) const
+{
+    const Resolved &r = m_resolved;
+    for (size_t k = 0; k <= r.steps.size(); ++k) {
+        const Coordinate &from = (k == 0) ? r.start : r.steps[k - 1].pos;
+        if (from != start)
+            continue;
+        const size_t overlap = std::min(r.commands.size() - k, commands.size());
+        if (std::equal(commands.begin(),
+                       commands.begin() + static_cast<std::ptrdiff_t>(overlap),
+                       r.commands.begin() + static_cast<std::ptrdiff_t>(k))) {
+            return k;
+        }
+    }
+    return std::nullopt;
+}
+
+const QList<Coordinate> &PrespammedPath::getPath(MapData &mapData, const Coordinate &start)
+{
+    Resolved &r = m_resolved;
+    const uint64_t mapVersion = mapData.getModificationCount();
+    if (r.valid && r.queueVersion == m_queueVersion && r.mapVersion == mapVersion
+        && r.start == start) {
+        return r.path;
+    }
+
+    std::vector<CommandEnum> commands(m_queue.begin(), m_queue.end());
+    std::optional<size_t> resume;
+    if (r.valid && r.mapVersion == mapVersion)
+        resume = findResumePoint(start, commands);
+
+    // The old walk stopped before the end of the commands it had.
+    bool stopped = false;
+    if (resume.has_value()) {
+        const size_t k = resume.value();
+        const size_t overlap = std::min(r.commands.size() - k, commands.size());
+        r.steps.erase(r.steps.begin(), r.steps.begin() + static_cast<std::ptrdiff_t>(k));
+        stopped = r.steps.size() < overlap;
+        r.steps.resize(std::min(r.steps.size(), overlap));
+    } else {
+        r.steps.clear();
+    }
+
+    if (!stopped && r.steps.size() < commands.size()) {
+        const Coordinate from = r.steps.empty() ? start : r.steps.back().pos;
+        const auto more = mapData.getPathSteps(from, commands, r.steps.size());
+        r.steps.insert(r.steps.end(), more.begin(), more.end());
+    }
+
+    r.path.clear();
+    for (const MapData::PathStep &step : r.steps) {
+        if (step.moved)
+            r.path.append(step.pos);
+    }
+    r.commands = std::move(commands);
+    r.start = start;
+    r.queueVersion = m_queueVersion;
+    r.mapVersion = mapVersion;
+    r.valid = true;
+    return r.path;
+}
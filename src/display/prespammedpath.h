@@ -4,14 +4,20 @@
 // Author: Ulf Hermann <ulfonk_mennhar@gmx.de> (Alve)
 // Author: Marek Krejza <krejza@gmail.com> (Caligor)
 
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+#include <QList>
 #include <QObject>
 #include <QString>
 #include <QtCore>
 
+#include "../expandoracommon/coordinate.h"
+#include "../mapdata/mapdata.h"
 #include "../parser/CommandQueue.h"
 
 class MapCanvas;
-class MapData;
 
 class PrespammedPath final : public QObject
 {
@@ -19,6 +25,22 @@ class PrespammedPath final : public QObject
 
 private:
     CommandQueue m_queue;
+    // Bumped by every slot_setPath().
+    uint64_t m_queueVersion = 0;
+
+    // The path last resolved by getPath(). Steps are kept for the commands it
+    // followed, so a queue that has only lost commands from the front (as
+    // they're walked) or gained some at the back doesn't have to be walked again.
+    struct NODISCARD Resolved final
+    {
+        bool valid = false;
+        uint64_t queueVersion = 0;
+        uint64_t mapVersion = 0;
+        Coordinate start;
+        std::vector<CommandEnum> commands;
+        std::vector<MapData::PathStep> steps;
+        QList<Coordinate> path;
+    } m_resolved;
 
 public:
     explicit PrespammedPath(QObject *parent);
@@ -26,6 +48,15 @@ class PrespammedPath final : public QObject
 
 public:
     NODISCARD const CommandQueue &getQueue() const { return m_queue; }
+    // Same as mapData.getPath(start, getQueue()), but it's only looked up again
+    // when the queue, the start or the map has changed, and then only partly.
+    NODISCARD const QList<Coordinate> &getPath(MapData &mapData, const Coordinate &start);
+
+private:
+    // How many commands to drop from the front of the resolved path to get
+    // to the current queue from start, if that's possible.
+    NODISCARD std::optional<size_t> findResumePoint(const Coordinate &start,
+                                                    const std::vector<CommandEnum> &commands) const;
 
 signals:
     void sig_update();
@@ -0,0 +1,120 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <cstddef>
+#include <cstdint>
+
+#include "../global/macros.h"
+#include "coordinate.h"
+
+/**
+ * A Coordinate packed into 64 bits: z in the top 16 bits, then y and x in 24
+ * bits each, every field offset so it's unsigned. Comparing keys orders the
+ * coordinates by z, then y, then x, like the map's other spatial orderings.
+ *
+ * Only x and y in [-2^23, 2^23) and z in [-2^15, 2^15) survive the round trip
+ * (see fits()); anything else wraps, which is harmless for hashing.
+ */
+struct NODISCARD CoordinateKey final
+{
+public:
+    static constexpr const int XY_BITS = 24;
+    static constexpr const int Z_BITS = 16;
+
+private:
+    static constexpr const uint64_t XY_MASK = (uint64_t{1} << XY_BITS) - 1u;
+    static constexpr const uint64_t Z_MASK = (uint64_t{1} << Z_BITS) - 1u;
+    static constexpr const int XY_BIAS = 1 << (XY_BITS - 1);
+    static constexpr const int Z_BIAS = 1 << (Z_BITS - 1);
+
+public:
+    uint64_t value = 0;
+
+private:
+    NODISCARD static constexpr uint64_t field(const int v, const int bias, const uint64_t mask)
+    {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(v)) + static_cast<uint64_t>(bias))
+               & mask;
+    }
+    NODISCARD static constexpr int unfield(const uint64_t bits, const int bias)
+    {
+        return static_cast<int>(bits) - bias;
+    }
+    // Spreads the low 24 bits out to the even bits of the result.
+    NODISCARD static constexpr uint64_t spread(uint64_t v)
+    {
+        v &= XY_MASK;
+        v = (v | (v << 16u)) & 0x0000FFFF0000FFFFull;
+        v = (v | (v << 8u)) & 0x00FF00FF00FF00FFull;
+        v = (v | (v << 4u)) & 0x0F0F0F0F0F0F0F0Full;
+        v = (v | (v << 2u)) & 0x3333333333333333ull;
+        v = (v | (v << 1u)) & 0x5555555555555555ull;
+        return v;
+    }
+
+public:
+    constexpr CoordinateKey() = default;
+    constexpr explicit CoordinateKey(const int x, const int y, const int z)
+        : value{(field(z, Z_BIAS, Z_MASK) << (2 * XY_BITS))
+                | (field(y, XY_BIAS, XY_MASK) << XY_BITS) | field(x, XY_BIAS, XY_MASK)}
+    {}
+    explicit CoordinateKey(const Coordinate &c)
+        : CoordinateKey{c.x, c.y, c.z}
+    {}
+
+public:
+    NODISCARD static bool fits(const Coordinate &c)
+    {
+        return -XY_BIAS <= c.x && c.x < XY_BIAS && -XY_BIAS <= c.y && c.y < XY_BIAS
+               && -Z_BIAS <= c.z && c.z < Z_BIAS;
+    }
+    NODISCARD Coordinate toCoordinate() const
+    {
+        return Coordinate{unfield(value & XY_MASK, XY_BIAS),
+                          unfield((value >> XY_BITS) & XY_MASK, XY_BIAS),
+                          unfield(value >> (2 * XY_BITS), Z_BIAS)};
+    }
+    // Same z field, but x and y interleaved below it (Z-order), so the rooms
+    // of a neighbourhood get nearby keys instead of being a row apart.
+    NODISCARD constexpr uint64_t toMorton() const
+    {
+        const uint64_t xy = spread(value) | (spread(value >> XY_BITS) << 1u);
+        return (value & (Z_MASK << (2 * XY_BITS))) | xy;
+    }
+
+public:
+    NODISCARD constexpr bool operator==(const CoordinateKey &rhs) const
+    {
+        return value == rhs.value;
+    }
+    NODISCARD constexpr bool operator!=(const CoordinateKey &rhs) const
+    {
+        return value != rhs.value;
+    }
+    NODISCARD constexpr bool operator<(const CoordinateKey &rhs) const { return value < rhs.value; }
+};
+
+struct NODISCARD CoordinateKeyHash final
+{
+    // murmur3's 64-bit finalizer, so every bit of the key reaches the low bits.
+    NODISCARD size_t operator()(const CoordinateKey &key) const noexcept
+    {
+        uint64_t h = key.value;
+        h ^= h >> 33u;
+        h *= 0xFF51AFD7ED558CCDull;
+        h ^= h >> 33u;
+        h *= 0xC4CEB9FE1A85EC53ull;
+        h ^= h >> 33u;
+        return static_cast<size_t>(h);
+    }
+};
+
+// For hashed containers keyed by Coordinate.
+struct NODISCARD CoordinateHash final
+{
+    NODISCARD size_t operator()(const Coordinate &c) const noexcept
+    {
+        return CoordinateKeyHash{}(CoordinateKey{c});
+    }
+};
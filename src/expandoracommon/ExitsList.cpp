@@ -0,0 +1,79 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "ExitsList.h"
+
+#include <algorithm>
+
+#include "../global/bits.h"
+
+NODISCARD static const Exit &getEmptyExit()
+{
+    static const Exit empty;
+    return empty;
+}
+
+size_t ExitsList::slot(const ExitDirEnum dir) const
+{
+    const auto below = static_cast<uint8_t>(m_present & (bit(dir) - 1u));
+    return static_cast<size_t>(bits::bitCount(below));
+}
+
+const Exit &ExitsList::at(const ExitDirEnum dir) const
+{
+    if (!has(dir))
+        return getEmptyExit();
+    return m_exits[slot(dir)];
+}
+
+Exit &ExitsList::at(const ExitDirEnum dir)
+{
+    const size_t index = slot(dir);
+    if (!has(dir)) {
+        m_exits.emplace(m_exits.begin() + static_cast<std::ptrdiff_t>(index));
+        m_present = static_cast<uint8_t>(m_present | bit(dir));
+    }
+    return m_exits[index];
+}
+
+void ExitsList::set(const ExitDirEnum dir, const Exit &exit)
+{
+    if (!exit.isEmpty()) {
+        at(dir) = exit;
+        return;
+    }
+    if (has(dir)) {
+        m_exits.erase(m_exits.begin() + static_cast<std::ptrdiff_t>(slot(dir)));
+        m_present = static_cast<uint8_t>(m_present & ~bit(dir));
+    }
+}
+
+void ExitsList::compact()
+{
+    uint8_t present = 0;
+    size_t index = 0;
+    for (uint32_t i = 0; i < SIZE; ++i) {
+        const auto dir = static_cast<ExitDirEnum>(i);
+        if (!has(dir))
+            continue;
+        if (!m_exits[index++].isEmpty())
+            present = static_cast<uint8_t>(present | bit(dir));
+    }
+    m_exits.erase(std::remove_if(m_exits.begin(),
+                                 m_exits.end(),
+                                 [](const Exit &e) { return e.isEmpty(); }),
+                  m_exits.end());
+    m_present = present;
+    assert(static_cast<size_t>(bits::bitCount(m_present)) == m_exits.size());
+}
+
+bool ExitsList::operator==(const ExitsList &rhs) const
+{
+    // Stored exits can be empty, so the directions are compared one by one.
+    for (uint32_t i = 0; i < SIZE; ++i) {
+        const auto dir = static_cast<ExitDirEnum>(i);
+        if (at(dir) != rhs.at(dir))
+            return false;
+    }
+    return true;
+}
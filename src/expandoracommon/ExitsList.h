@@ -0,0 +1,120 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#include "../global/RuleOf5.h"
+#include "../global/macros.h"
+#include "../mapdata/ExitDirection.h"
+#include "exit.h"
+
+/**
+ * The exits of a room, indexed by direction.
+ *
+ * Most rooms only have a few exits, so only the directions that have
+ * anything are stored, packed in direction order behind a presence mask.
+ * The other directions read as an empty Exit.
+ *
+ * CAUTION: The non-const accessors add the exit if it's missing, which moves
+ * the other exits; don't hold on to a reference into the same list across one.
+ */
+class NODISCARD ExitsList final
+{
+public:
+    static constexpr const size_t SIZE = NUM_EXITS;
+
+private:
+    std::vector<Exit> m_exits;
+    uint8_t m_present = 0;
+
+public:
+    // Visits every direction, whether it's stored or not.
+    class NODISCARD ConstIterator final
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Exit;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Exit *;
+        using reference = const Exit &;
+
+    private:
+        const ExitsList *m_list = nullptr;
+        uint32_t m_dir = 0;
+
+    public:
+        explicit ConstIterator(const ExitsList &list, const uint32_t dir)
+            : m_list{&list}
+            , m_dir{dir}
+        {}
+
+    public:
+        NODISCARD const Exit &operator*() const
+        {
+            return m_list->at(static_cast<ExitDirEnum>(m_dir));
+        }
+        NODISCARD const Exit *operator->() const { return &operator*(); }
+        ConstIterator &operator++()
+        {
+            ++m_dir;
+            return *this;
+        }
+        NODISCARD bool operator==(const ConstIterator &rhs) const
+        {
+            assert(m_list == rhs.m_list);
+            return m_dir == rhs.m_dir;
+        }
+        NODISCARD bool operator!=(const ConstIterator &rhs) const { return !operator==(rhs); }
+    };
+
+public:
+    ExitsList() = default;
+    ~ExitsList() = default;
+    DEFAULT_CTORS_AND_ASSIGN_OPS(ExitsList);
+
+public:
+    NODISCARD static constexpr size_t size() { return SIZE; }
+    NODISCARD bool has(const ExitDirEnum dir) const { return (m_present & bit(dir)) != 0u; }
+    // How many directions are stored; some of them may have become empty.
+    NODISCARD size_t storedCount() const { return m_exits.size(); }
+
+public:
+    NODISCARD const Exit &at(ExitDirEnum dir) const;
+    NODISCARD Exit &at(ExitDirEnum dir);
+    NODISCARD const Exit &operator[](const ExitDirEnum dir) const { return at(dir); }
+    NODISCARD Exit &operator[](const ExitDirEnum dir) { return at(dir); }
+
+public:
+    // An empty exit isn't stored.
+    void set(ExitDirEnum dir, const Exit &exit);
+    // Stops storing the directions that have become empty.
+    void compact();
+
+public:
+    NODISCARD ConstIterator begin() const { return ConstIterator{*this, 0u}; }
+    NODISCARD ConstIterator end() const { return ConstIterator{*this, SIZE}; }
+    NODISCARD ConstIterator cbegin() const { return begin(); }
+    NODISCARD ConstIterator cend() const { return end(); }
+    // Only the stored exits; changing a direction that isn't stored is what
+    // the non-const accessors are for.
+    NODISCARD auto begin() { return m_exits.begin(); }
+    NODISCARD auto end() { return m_exits.end(); }
+
+public:
+    NODISCARD bool operator==(const ExitsList &rhs) const;
+    NODISCARD bool operator!=(const ExitsList &rhs) const { return !operator==(rhs); }
+
+private:
+    NODISCARD static uint8_t bit(const ExitDirEnum dir)
+    {
+        assert(static_cast<uint32_t>(dir) < SIZE);
+        return static_cast<uint8_t>(1u << static_cast<uint32_t>(dir));
+    }
+    // Where the direction is, or would be, in m_exits.
+    NODISCARD size_t slot(ExitDirEnum dir) const;
+};
@@ -0,0 +1,47 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <set>
+#include <tuple>
+
+#include "../global/macros.h"
+#include "coordinate.h"
+
+// The map canvas builds its meshes in square chunks of rooms on each layer,
+// so a changed room only has to rebuild the chunks it's drawn in.
+struct NODISCARD MeshChunkId final
+{
+    static constexpr const int SIZE = 32;
+
+    int x = 0;
+    int y = 0;
+    int z = 0;
+
+    NODISCARD static MeshChunkId fromCoordinate(const Coordinate &c)
+    {
+        // Rounds towards negative infinity, so chunks never straddle the origin.
+        const auto floorDiv = [](const int n) {
+            return (n >= 0) ? (n / SIZE) : ((n + 1) / SIZE - 1);
+        };
+        return MeshChunkId{floorDiv(c.x), floorDiv(c.y), c.z};
+    }
+    NODISCARD Coordinate getMin() const { return Coordinate{x * SIZE, y * SIZE, z}; }
+    NODISCARD Coordinate getMax() const
+    {
+        return Coordinate{x * SIZE + SIZE - 1, y * SIZE + SIZE - 1, z};
+    }
+
+    // Ordered by layer first, so a layer's chunks are next to each other.
+    NODISCARD bool operator<(const MeshChunkId &rhs) const
+    {
+        return std::tie(z, y, x) < std::tie(rhs.z, rhs.y, rhs.x);
+    }
+    NODISCARD bool operator==(const MeshChunkId &rhs) const
+    {
+        return x == rhs.x && y == rhs.y && z == rhs.z;
+    }
+    NODISCARD bool operator!=(const MeshChunkId &rhs) const { return !(*this == rhs); }
+};
+
+using MeshChunkIdSet = std::set<MeshChunkId>;
@@ -5,6 +5,7 @@
 
 #include <cstddef>
 #include <memory>
+#include <utility>
 
 #include "../global/NullPointerException.h"
 #include "../global/RuleOf5.h"
@@ -36,6 +37,13 @@ class MmQtHandle final
     {
         requireValid(); /* throws invalid argument */
     }
+    explicit MmQtHandle(shared_type &&event)
+        /* throws invalid argument */
+        noexcept(false)
+        : m_shared{std::move(event)}
+    {
+        requireValid(); /* throws invalid argument */
+    }
 
 public:
     MmQtHandle() = default; /* required by QT */
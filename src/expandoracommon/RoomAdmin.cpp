@@ -5,4 +5,18 @@
 
 #include "RoomAdmin.h"
 
+#include "../global/utils.h"
+
 RoomAdmin::~RoomAdmin() = default;
+
+void RoomAdmin::applyLockChanges(const std::vector<RoomLockChange> &changes)
+{
+    for (const RoomLockChange &change : changes) {
+        RoomRecipient &recipient = deref(change.recipient);
+        if (change.keep) {
+            keepRoom(recipient, change.id);
+        } else {
+            releaseRoom(recipient, change.id);
+        }
+    }
+}
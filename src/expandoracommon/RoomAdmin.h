@@ -4,13 +4,23 @@
 // Author: Ulf Hermann <ulfonk_mennhar@gmx.de> (Alve)
 // Author: Marek Krejza <krejza@gmail.com> (Caligor)
 
+#include <functional>
 #include <memory>
+#include <vector>
 
 #include "room.h"
 
 class RoomRecipient;
 class MapAction;
 
+struct NODISCARD RoomLockChange final
+{
+    RoomRecipient *recipient = nullptr;
+    RoomId id = INVALID_ROOMID;
+    // keepRoom() if set, or else releaseRoom().
+    bool keep = false;
+};
+
 // TODO: Collapse RoomModificationTracker, RoomAdmin, MapFrontend, and MapData into a single class,
 // and eliminate dependency on QObject.
 class RoomAdmin : public RoomModificationTracker
@@ -26,5 +36,12 @@ class RoomAdmin : public RoomModificationTracker
     // Like that the room can't be deleted via releaseRoom anymore.
     virtual void keepRoom(RoomRecipient &, RoomId) = 0;
 
+    // Same as calling keepRoom() or releaseRoom() for each change, in order.
+    virtual void applyLockChanges(const std::vector<RoomLockChange> &changes);
+
     virtual void scheduleAction(const std::shared_ptr<MapAction> &action) = 0;
+
+    // Runs the callback while nothing can change the map, e.g. to read rooms
+    // from other threads; the callback must not lock or release rooms.
+    virtual void readLocked(const std::function<void()> &callback) { callback(); }
 };
@@ -0,0 +1,48 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "RoomFingerprint.h"
+
+#include <cctype>
+
+static constexpr const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+static constexpr const uint64_t FNV_PRIME = 1099511628211ull;
+
+NODISCARD static bool isSpace(const char c)
+{
+    // Same as StringView, which splits the words for Room::compareStrings().
+    return std::isspace(static_cast<uint8_t>(c) & 0xff);
+}
+
+uint64_t RoomFingerprint::hashWords(const std::string_view text)
+{
+    // FNV-1a over the words, each followed by a single space.
+    uint64_t hash = FNV_OFFSET_BASIS;
+    const auto add = [&hash](const char c) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= FNV_PRIME;
+    };
+
+    bool inWord = false;
+    for (const char c : text) {
+        if (isSpace(c)) {
+            if (inWord)
+                add(' ');
+            inWord = false;
+        } else {
+            add(c);
+            inWord = true;
+        }
+    }
+    if (inWord)
+        add(' ');
+    return hash;
+}
+
+RoomFingerprint RoomFingerprint::compute(const RoomName &name, const RoomDesc &desc)
+{
+    RoomFingerprint result;
+    result.name = hashWords(name.getStdString());
+    result.desc = hashWords(desc.getStdString());
+    return result;
+}
@@ -0,0 +1,21 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <cstdint>
+#include <string_view>
+
+#include "../global/macros.h"
+#include "../mapdata/mmapper2room.h"
+
+// Hashes of a room's name and description with the whitespace collapsed, so text
+// that only differs in its spacing is recognised without comparing it word by word.
+// Identical text doesn't need this; interned strings already compare by pointer.
+struct NODISCARD RoomFingerprint final
+{
+    uint64_t name = 0;
+    uint64_t desc = 0;
+
+    NODISCARD static uint64_t hashWords(std::string_view text);
+    NODISCARD static RoomFingerprint compute(const RoomName &name, const RoomDesc &desc);
+};
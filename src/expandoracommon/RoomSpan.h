@@ -0,0 +1,42 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+#include "../global/macros.h"
+
+class Room;
+
+// A contiguous run of room pointers that somebody else owns (std::span is C++20).
+class NODISCARD RoomSpan final
+{
+private:
+    const Room *const *m_data = nullptr;
+    size_t m_size = 0;
+
+public:
+    RoomSpan() = default;
+    explicit RoomSpan(const Room *const *const data, const size_t size)
+        : m_data{data}
+        , m_size{size}
+    {
+        assert(data != nullptr || size == 0);
+    }
+    explicit RoomSpan(const std::vector<const Room *> &rooms)
+        : RoomSpan{rooms.data(), rooms.size()}
+    {}
+
+public:
+    NODISCARD const Room *const *begin() const { return m_data; }
+    NODISCARD const Room *const *end() const { return m_data + m_size; }
+    NODISCARD size_t size() const { return m_size; }
+    NODISCARD bool empty() const { return m_size == 0; }
+    NODISCARD const Room *operator[](const size_t i) const
+    {
+        assert(i < m_size);
+        return m_data[i];
+    }
+};
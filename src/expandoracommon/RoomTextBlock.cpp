@@ -0,0 +1,153 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "RoomTextBlock.h"
+
+#include <cassert>
+#include <list>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <QDataStream>
+
+#include "RoomFingerprint.h"
+
+// Inflated blocks kept around; with blocks of 64 rooms, that's a few thousand
+// rooms of text.
+static constexpr const size_t CACHE_BLOCKS = 64;
+
+namespace { // anonymous
+
+class NODISCARD InflatedCache final
+{
+private:
+    struct NODISCARD Entry final
+    {
+        const RoomTextBlock *key = nullptr;
+        // A block that's gone could have its address reused by a new one.
+        std::weak_ptr<const RoomTextBlock> owner;
+        RoomTextBlock::SharedTexts texts;
+    };
+    using List = std::list<Entry>;
+
+    std::mutex m_mutex;
+    // Most recently used first.
+    List m_entries;
+    std::unordered_map<const RoomTextBlock *, List::iterator> m_index;
+
+public:
+    NODISCARD RoomTextBlock::SharedTexts find(const std::shared_ptr<const RoomTextBlock> &block)
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        const auto it = m_index.find(block.get());
+        if (it == m_index.end())
+            return nullptr;
+
+        const List::iterator entry = it->second;
+        if (entry->owner.owner_before(block) || block.owner_before(entry->owner)) {
+            m_entries.erase(entry);
+            m_index.erase(it);
+            return nullptr;
+        }
+        m_entries.splice(m_entries.begin(), m_entries, entry);
+        return entry->texts;
+    }
+
+    void insert(const std::shared_ptr<const RoomTextBlock> &block,
+                RoomTextBlock::SharedTexts texts)
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        if (const auto it = m_index.find(block.get()); it != m_index.end()) {
+            m_entries.erase(it->second);
+            m_index.erase(it);
+        }
+        m_entries.push_front(Entry{block.get(), block, std::move(texts)});
+        m_index.emplace(block.get(), m_entries.begin());
+        while (m_entries.size() > CACHE_BLOCKS) {
+            m_index.erase(m_entries.back().key);
+            m_entries.pop_back();
+        }
+    }
+};
+
+NODISCARD InflatedCache &getCache()
+{
+    static InflatedCache cache;
+    return cache;
+}
+
+} // namespace
+
+RoomTextBlock::RoomTextBlock(this_is_private,
+                             QByteArray compressed,
+                             std::shared_ptr<const DeflateDictionary> dictionary,
+                             std::vector<uint64_t> descriptionHashes)
+    : m_compressed{std::move(compressed)}
+    , m_dictionary{std::move(dictionary)}
+    , m_descriptionHashes{std::move(descriptionHashes)}
+    , m_count{static_cast<uint32_t>(m_descriptionHashes.size())}
+{}
+
+RoomTextBlock::~RoomTextBlock() = default;
+
+std::shared_ptr<const RoomTextBlock> RoomTextBlock::compress(
+    const std::vector<Text> &texts, std::shared_ptr<const DeflateDictionary> dictionary)
+{
+    QByteArray data;
+    std::vector<uint64_t> descriptionHashes;
+    descriptionHashes.reserve(texts.size());
+    {
+        QDataStream stream{&data, QIODevice::WriteOnly};
+        for (const Text &text : texts) {
+            for (const std::string *const s :
+                 {&text.description.getStdString(), &text.contents.getStdString()}) {
+                stream.writeBytes(s->data(), static_cast<uint>(s->size()));
+            }
+            descriptionHashes.emplace_back(
+                RoomFingerprint::hashWords(text.description.getStdString()));
+        }
+    }
+    QByteArray compressed = (dictionary != nullptr) ? dictionary->compress(data) : qCompress(data);
+    return std::make_shared<const RoomTextBlock>(this_is_private{0},
+                                                 std::move(compressed),
+                                                 std::move(dictionary),
+                                                 std::move(descriptionHashes));
+}
+
+RoomTextBlock::SharedTexts RoomTextBlock::inflate() const
+{
+    const std::shared_ptr<const RoomTextBlock> self = shared_from_this();
+    InflatedCache &cache = getCache();
+    if (SharedTexts found = cache.find(self))
+        return found;
+
+    const QByteArray data = (m_dictionary != nullptr) ? m_dictionary->uncompress(m_compressed)
+                                                      : qUncompress(m_compressed);
+    QDataStream stream{data};
+    auto texts = std::make_shared<std::vector<Text>>(m_count);
+    const auto read = [&stream]() -> std::string {
+        char *bytes = nullptr;
+        uint len = 0;
+        stream.readBytes(bytes, len);
+        std::string result = (bytes != nullptr) ? std::string(bytes, len) : std::string();
+        delete[] bytes;
+        return result;
+    };
+    for (Text &text : *texts) {
+        // Interned like any other room text, so Room::compare() can match
+        // by pointer.
+        text.description = RoomDesc{read()}.interned();
+        text.contents = RoomContents{read()}.interned();
+    }
+    if (stream.status() != QDataStream::Ok) {
+        // The block was written by compress(), so this is a bug (or out of memory).
+        assert(false);
+        throw std::runtime_error("corrupt room text block");
+    }
+
+    SharedTexts result = std::move(texts);
+    cache.insert(self, result);
+    return result;
+}
@@ -0,0 +1,74 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <QByteArray>
+
+#include "../global/DeflateDictionary.h"
+#include "../global/RuleOf5.h"
+#include "../global/macros.h"
+#include "../mapdata/mmapper2room.h"
+
+/**
+ * The descriptions and contents of a few rooms, compressed together.
+ *
+ * Rooms loaded with lazy descriptions keep a reference to their block and
+ * their index in it, and the text is inflated when it's asked for. The most
+ * recently inflated blocks are kept in a small cache shared by every block,
+ * so rooms that are looked at together (neighbours, or rooms saved in id
+ * order) only inflate their block once. Safe to use from multiple threads.
+ *
+ * Blocks compressed with a dictionary trained on the map are much smaller, so
+ * they can hold fewer rooms for the same size.
+ *
+ * Each description's RoomFingerprint hash is kept uncompressed, so a room can
+ * have its fingerprint without inflating its block.
+ */
+class NODISCARD RoomTextBlock final : public std::enable_shared_from_this<RoomTextBlock>
+{
+public:
+    struct NODISCARD Text final
+    {
+        RoomDesc description;
+        RoomContents contents;
+    };
+    using SharedTexts = std::shared_ptr<const std::vector<Text>>;
+
+private:
+    struct NODISCARD this_is_private final
+    {
+        explicit this_is_private(int) {}
+    };
+
+private:
+    QByteArray m_compressed;
+    std::shared_ptr<const DeflateDictionary> m_dictionary;
+    std::vector<uint64_t> m_descriptionHashes;
+    uint32_t m_count = 0;
+
+public:
+    explicit RoomTextBlock(this_is_private,
+                           QByteArray compressed,
+                           std::shared_ptr<const DeflateDictionary> dictionary,
+                           std::vector<uint64_t> descriptionHashes);
+    ~RoomTextBlock();
+    DELETE_CTORS_AND_ASSIGN_OPS(RoomTextBlock);
+
+public:
+    NODISCARD static std::shared_ptr<const RoomTextBlock> compress(
+        const std::vector<Text> &texts, std::shared_ptr<const DeflateDictionary> dictionary = {});
+
+public:
+    NODISCARD uint32_t size() const { return m_count; }
+    NODISCARD size_t getCompressedSize() const { return static_cast<size_t>(m_compressed.size()); }
+    // RoomFingerprint::hashWords() of the description.
+    NODISCARD uint64_t getDescriptionHash(const uint32_t index) const
+    {
+        return m_descriptionHashes.at(index);
+    }
+    NODISCARD SharedTexts inflate() const;
+};
@@ -4,13 +4,28 @@
 
 #include "exit.h"
 
+#include <type_traits>
+#include <utility>
+
 #include "../global/Flags.h"
 #include "../mapdata/DoorFlags.h"
 #include "../mapdata/ExitFieldVariant.h"
 #include "../mapdata/ExitFlags.h"
 
+// Door names repeat a lot (e.g. "door", "gate"), so they share buffers through the
+// global StringPool.
+template<typename T>
+NODISCARD static T internField(T &&value)
+{
+    if constexpr (std::is_same_v<T, DoorName>) {
+        return value.interned();
+    } else {
+        return std::forward<T>(value);
+    }
+}
+
 #define DEFINE_SETTERS(_Type, _Prop, _OptInit) \
-    void Exit::set##_Type(_Type value) { m_fields._Prop = std::move(value); }
+    void Exit::set##_Type(_Type value) { m_fields._Prop = internField(std::move(value)); }
 XFOREACH_EXIT_PROPERTY(DEFINE_SETTERS)
 #undef DEFINE_SETTERS
 
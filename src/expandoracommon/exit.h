@@ -5,9 +5,9 @@
 // Author: Marek Krejza <krejza@gmail.com> (Caligor)
 
 #include <cassert>
-#include <set>
 #include <stdexcept>
 
+#include "../global/TinyRoomIdSet.h"
 #include "../global/range.h"
 #include "../global/roomid.h"
 #include "../mapdata/DoorFlags.h"
@@ -34,11 +34,11 @@ class Exit final
     ExitFields m_fields;
 
 private:
-    RoomIdSet incoming;
-    RoomIdSet outgoing;
+    TinyRoomIdSet incoming;
+    TinyRoomIdSet outgoing;
 
 public:
-    // This has to exist as long as ExitsList uses EnumIndexedArray<Exit>.
+    // The empty exit, which is what ExitsList has for the directions it doesn't store.
     Exit() = default;
     ~Exit() = default;
 
@@ -51,14 +51,22 @@ class Exit final
     }
 
 public:
-    const RoomIdSet &getIncoming() const { return incoming; }
-    const RoomIdSet &getOutgoing() const { return outgoing; }
+    // No flags, no door name and no connections.
+    NODISCARD bool isEmpty() const
+    {
+        return m_fields.exitFlags.isEmpty() && m_fields.doorFlags.isEmpty()
+               && m_fields.doorName.isEmpty() && incoming.empty() && outgoing.empty();
+    }
+
+public:
+    const TinyRoomIdSet &getIncoming() const { return incoming; }
+    const TinyRoomIdSet &getOutgoing() const { return outgoing; }
 
 public:
     auto inSize() const { return incoming.size(); }
     bool inIsEmpty() const { return inSize() == 0; }
     auto inRange() const { return make_range(inBegin(), inEnd()); }
-    RoomIdSet inClone() const { return incoming; }
+    TinyRoomIdSet inClone() const { return incoming; }
 
 public:
     auto outSize() const { return outgoing.size(); }
@@ -67,28 +75,28 @@ class Exit final
     RoomId outFirst() const
     {
         assert(!outIsEmpty());
-        return *outgoing.begin();
+        return outgoing.first();
     }
     auto outRange() const { return make_range(outBegin(), outEnd()); }
-    RoomIdSet outClone() const { return outgoing; }
+    TinyRoomIdSet outClone() const { return outgoing; }
 
 public:
     auto getRange(bool out) const { return out ? outRange() : inRange(); }
 
 private:
-    std::set<RoomId>::const_iterator inBegin() const { return incoming.begin(); }
-    std::set<RoomId>::const_iterator outBegin() const { return outgoing.begin(); }
+    TinyRoomIdSet::const_iterator inBegin() const { return incoming.begin(); }
+    TinyRoomIdSet::const_iterator outBegin() const { return outgoing.begin(); }
 
-    std::set<RoomId>::const_iterator inEnd() const { return incoming.end(); }
-    std::set<RoomId>::const_iterator outEnd() const { return outgoing.end(); }
+    TinyRoomIdSet::const_iterator inEnd() const { return incoming.end(); }
+    TinyRoomIdSet::const_iterator outEnd() const { return outgoing.end(); }
 
 public:
     void addIn(RoomId from) { incoming.insert(from); }
     void addOut(RoomId to) { outgoing.insert(to); }
     void removeIn(RoomId from) { incoming.erase(from); }
     void removeOut(RoomId to) { outgoing.erase(to); }
-    bool containsIn(RoomId from) const { return incoming.find(from) != incoming.end(); }
-    bool containsOut(RoomId to) const { return outgoing.find(to) != outgoing.end(); }
+    bool containsIn(RoomId from) const { return incoming.contains(from); }
+    bool containsOut(RoomId to) const { return outgoing.contains(to); }
 
 public:
 #define DECL_GETTERS_AND_SETTERS(_Type, _Prop, _OptInit) \
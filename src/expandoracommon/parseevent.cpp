@@ -9,8 +9,12 @@
 #include <cassert>
 #include <cstdint>
 #include <memory>
+#include <utility>
 
+#include "../global/SlabAllocator.h"
+#include "../global/StringPool.h"
 #include "../global/TextUtils.h"
+#include "../global/hash.h"
 #include "../global/utils.h"
 #include "../mapdata/ExitDirection.h"
 #include "../parser/CommandId.h"
@@ -22,9 +26,11 @@
 ParseEvent::ArrayOfProperties::ArrayOfProperties() = default;
 ParseEvent::ArrayOfProperties::~ArrayOfProperties() = default;
 
-void ParseEvent::ArrayOfProperties::setProperty(const size_t pos, std::string s)
+void ParseEvent::ArrayOfProperties::setProperty(const size_t pos,
+                                               std::shared_ptr<const std::string> s,
+                                               const uint32_t hash)
 {
-    ArrayOfProperties::at(pos) = Property{std::move(s)};
+    ArrayOfProperties::at(pos) = Property{std::move(s), hash};
 }
 
 NODISCARD static std::string getTerrainBytes(const RoomTerrainEnum &terrain)
@@ -38,7 +44,9 @@ NODISCARD static std::string getTerrainBytes(const RoomTerrainEnum &terrain)
 
 void ParseEvent::setProperty(const RoomTerrainEnum &terrain)
 {
-    m_properties.setProperty(2, getTerrainBytes(terrain));
+    // Pooled, since there are only a handful of them.
+    const std::string bytes = getTerrainBytes(terrain);
+    m_properties.setProperty(2, StringPool::getGlobal().intern(bytes), stable_hash32(bytes));
 }
 
 ParseEvent::~ParseEvent() = default;
@@ -105,20 +113,28 @@ SharedParseEvent ParseEvent::createEvent(const CommandEnum c,
                                          const RoomTerrainEnum &terrain,
                                          const ExitsFlagsType &exitsFlags,
                                          const PromptFlagsType &promptFlags,
-                                         const ConnectedRoomFlagsType &connectedRoomFlags)
+                                         const ConnectedRoomFlagsType &connectedRoomFlags,
+                                         std::shared_ptr<SlabArena> arena)
 {
-    auto result = std::make_shared<ParseEvent>(c);
+    auto result = [c, &arena]() {
+        if (arena != nullptr)
+            return std::allocate_shared<ParseEvent>(SlabAllocator<ParseEvent>{std::move(arena)}, c);
+        return std::make_shared<ParseEvent>(c);
+    }();
     ParseEvent *const event = result.get();
 
-    // the moved strings are used by const ref here before they're moved.
-    event->setProperty(moved_roomName);
-    event->setProperty(moved_roomDesc);
-    event->setProperty(terrain);
-
     // After this block, the moved values are gone.
-    event->m_roomName = std::exchange(moved_roomName, {});
-    event->m_roomDesc = std::exchange(moved_roomDesc, {});
-    event->m_roomContents = std::exchange(moved_roomContents, {});
+    // Interning lets Room::compare() match identical text by pointer.
+    event->m_roomName = std::exchange(moved_roomName, {}).interned();
+    event->m_roomDesc = std::exchange(moved_roomDesc, {}).interned();
+    event->m_roomContents = std::exchange(moved_roomContents, {}).interned();
+    // Hashed once here, rather than for every room the event is compared against.
+    event->m_fingerprint = RoomFingerprint::compute(event->m_roomName, event->m_roomDesc);
+
+    // The properties share the interned text.
+    event->setProperty(event->m_roomName);
+    event->setProperty(event->m_roomDesc);
+    event->setProperty(terrain);
     event->m_terrain = terrain;
     event->m_exitsFlags = exitsFlags;
     event->m_promptFlags = promptFlags;
@@ -21,9 +21,11 @@
 #include "../parser/ExitsFlags.h"
 #include "../parser/PromptFlags.h"
 #include "MmQtHandle.h"
+#include "RoomFingerprint.h"
 #include "property.h"
 
 class ParseEvent;
+class SlabArena;
 using SharedParseEvent = std::shared_ptr<ParseEvent>;
 using SigParseEvent = MmQtHandle<ParseEvent>;
 
@@ -50,7 +52,7 @@ class NODISCARD ParseEvent final
         using std::array<Property, NUM_PROPS>::operator[];
 
     public:
-        void setProperty(size_t pos, std::string string);
+        void setProperty(size_t pos, std::shared_ptr<const std::string> string, uint32_t hash);
     };
 
 private:
@@ -58,6 +60,7 @@ class NODISCARD ParseEvent final
     RoomName m_roomName;
     RoomDesc m_roomDesc;
     RoomContents m_roomContents;
+    RoomFingerprint m_fingerprint;
     ExitsFlagsType m_exitsFlags;
     PromptFlagsType m_promptFlags;
     ConnectedRoomFlagsType m_connectedRoomFlags;
@@ -89,8 +92,14 @@ class NODISCARD ParseEvent final
     virtual ~ParseEvent();
 
 private:
-    void setProperty(const RoomName &name) { m_properties.setProperty(0, name.getStdString()); }
-    void setProperty(const RoomDesc &desc) { m_properties.setProperty(1, desc.getStdString()); }
+    void setProperty(const RoomName &name)
+    {
+        m_properties.setProperty(0, name.getSharedString(), name.getHash());
+    }
+    void setProperty(const RoomDesc &desc)
+    {
+        m_properties.setProperty(1, desc.getSharedString(), desc.getHash());
+    }
     void setProperty(const RoomTerrainEnum &terrain);
     void countSkipped();
 
@@ -98,6 +107,7 @@ class NODISCARD ParseEvent final
     NODISCARD const RoomName &getRoomName() const { return m_roomName; }
     NODISCARD const RoomDesc &getRoomDesc() const { return m_roomDesc; }
     NODISCARD const RoomContents &getRoomContents() const { return m_roomContents; }
+    NODISCARD const RoomFingerprint &getFingerprint() const { return m_fingerprint; }
     NODISCARD ExitsFlagsType getExitsFlags() const { return m_exitsFlags; }
     NODISCARD PromptFlagsType getPromptFlags() const { return m_promptFlags; }
     NODISCARD ConnectedRoomFlagsType getConnectedRoomFlags() const { return m_connectedRoomFlags; }
@@ -107,6 +117,8 @@ class NODISCARD ParseEvent final
     const Property &operator[](const size_t pos) const { return m_properties.at(pos); }
 
 public:
+    // With an arena, the event and its control block come from one of its
+    // recycled blocks instead of the heap.
     static SharedParseEvent createEvent(CommandEnum c,
                                         RoomName roomName,
                                         RoomDesc roomDesc,
@@ -114,7 +126,8 @@ class NODISCARD ParseEvent final
                                         const RoomTerrainEnum &terrain,
                                         const ExitsFlagsType &exitsFlags,
                                         const PromptFlagsType &promptFlags,
-                                        const ConnectedRoomFlagsType &connectedRoomFlags);
+                                        const ConnectedRoomFlagsType &connectedRoomFlags,
+                                        std::shared_ptr<SlabArena> arena = nullptr);
 
     static SharedParseEvent createDummyEvent();
 };
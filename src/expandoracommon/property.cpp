@@ -5,10 +5,32 @@
 
 #include "property.h"
 
+#include <cassert>
 #include <stdexcept>
+#include <utility>
+
+#include "../global/hash.h"
 
 Property::Property(std::string s)
+    : Property{std::make_shared<const std::string>(std::move(s))}
+{}
+
+Property::Property(std::shared_ptr<const std::string> s)
     : m_data{std::move(s)}
+    , m_hash{(m_data == nullptr) ? 0u : stable_hash32(*m_data)}
 {}
 
+Property::Property(std::shared_ptr<const std::string> s, const uint32_t hash)
+    : m_data{std::move(s)}
+    , m_hash{hash}
+{
+    assert(m_hash == ((m_data == nullptr) ? 0u : stable_hash32(*m_data)));
+}
+
 Property::~Property() = default;
+
+const std::string &Property::getStdString() const
+{
+    static const std::string empty;
+    return (m_data == nullptr) ? empty : *m_data;
+}
@@ -4,25 +4,34 @@
 // Author: Ulf Hermann <ulfonk_mennhar@gmx.de> (Alve)
 // Author: Marek Krejza <krejza@gmail.com> (Caligor)
 
+#include <cstdint>
+#include <memory>
 #include <optional>
 #include <string>
 
 #include "../global/RuleOf5.h"
 #include "../global/macros.h"
 
+// Shares the text of the event it came from, so copying a property (or an event) is cheap.
 class NODISCARD Property final
 {
 private:
-    std::string m_data;
+    std::shared_ptr<const std::string> m_data;
+    // stable_hash32() of the text.
+    uint32_t m_hash = 0;
 
 public:
-    bool isSkipped() const noexcept { return m_data.empty(); }
-    const std::string &getStdString() const { return m_data; }
-    size_t size() const { return m_data.size(); }
+    bool isSkipped() const noexcept { return m_data == nullptr || m_data->empty(); }
+    const std::string &getStdString() const;
+    size_t size() const { return isSkipped() ? 0 : m_data->size(); }
+    NODISCARD uint32_t getHash() const { return m_hash; }
 
 public:
     Property() = default;
     explicit Property(std::string s);
+    explicit Property(std::shared_ptr<const std::string> s);
+    // The hash must be stable_hash32() of the text, e.g. from TaggedString::getHash().
+    explicit Property(std::shared_ptr<const std::string> s, uint32_t hash);
     ~Property();
     DEFAULT_CTORS_AND_ASSIGN_OPS(Property);
 };
@@ -5,13 +5,19 @@
 
 #include "room.h"
 
+#include <algorithm>
 #include <memory>
 #include <sstream>
+#include <type_traits>
 #include <vector>
 
+#include "../global/SlabAllocator.h"
+#include "../global/TextScan.h"
 #include "../global/StringView.h"
+#include "../global/bits.h"
 #include "../global/random.h"
 #include "../mapdata/ExitFieldVariant.h"
+#include "RoomTextBlock.h"
 #include "parseevent.h"
 
 static constexpr const auto default_updateFlags = RoomUpdateFlags{}; /* none */
@@ -52,10 +58,28 @@ void RoomModificationTracker::notifyModified(Room &room, RoomUpdateFlags updateF
 {
     m_isModified = true;
     if (updateFlags.contains(RoomUpdateEnum::Mesh))
-        m_needsMapUpdate = true;
+        markMeshDirty(room.getPosition());
     virt_onNotifyModified(room, updateFlags);
 }
 
+void RoomModificationTracker::markMeshDirty(const Coordinate &c)
+{
+    m_needsMapUpdate = true;
+    if (m_allChunksDirty)
+        return;
+
+    m_dirtyChunks.insert(MeshChunkId::fromCoordinate(c));
+    if (m_dirtyChunks.size() > MAX_DIRTY_CHUNKS)
+        markAllMeshesDirty();
+}
+
+void RoomModificationTracker::markAllMeshesDirty()
+{
+    m_needsMapUpdate = true;
+    m_allChunksDirty = true;
+    m_dirtyChunks.clear();
+}
+
 ExitDirConstRef::ExitDirConstRef(const ExitDirEnum dir, const Exit &exit)
     : dir{dir}
     , exit{exit}
@@ -66,6 +90,8 @@ Room::Room(this_is_private, RoomModificationTracker &tracker, const RoomStatusEn
     , m_status{status}
 {
     assert(status == RoomStatusEnum::Temporary || status == RoomStatusEnum::Permanent);
+    updateFingerprint();
+    updateExitSignature();
 }
 
 Room::~Room()
@@ -119,10 +145,37 @@ inline bool maybeModify(T &ours, T &&value)
     return true;
 }
 
+// Room text repeats a lot across the map (e.g. "A Dark Forest"),
+// so string fields share buffers through the global StringPool.
+template<typename T>
+NODISCARD static T internField(T &&value)
+{
+    if constexpr (std::is_same_v<T, RoomName> || std::is_same_v<T, RoomDesc>
+                  || std::is_same_v<T, RoomContents> || std::is_same_v<T, RoomNote>) {
+        return value.interned();
+    } else {
+        return std::forward<T>(value);
+    }
+}
+
+template<typename T>
+static constexpr const bool isLazyText = std::is_same_v<T, RoomDesc>
+                                         || std::is_same_v<T, RoomContents>;
+
+template<typename T>
+static constexpr const bool isFingerprinted = std::is_same_v<T, RoomName>
+                                              || std::is_same_v<T, RoomDesc>;
+
 #define DEFINE_SETTERS(_Type, _Prop, _OptInit) \
     void Room::set##_Prop(_Type value) \
     { \
-        if (maybeModify<_Type>((m_fields._Prop), std::move(value))) { \
+        if constexpr (isLazyText<_Type>) { \
+            materializeText(); \
+        } \
+        if (maybeModify<_Type>((m_fields._Prop), internField<_Type>(std::move(value)))) { \
+            if constexpr (isFingerprinted<_Type>) { \
+                updateFingerprint(); \
+            } \
             setModified(_Type##_updateFlags); \
         } \
     }
@@ -130,6 +183,86 @@ inline bool maybeModify(T &ours, T &&value)
 XFOREACH_ROOM_PROPERTY(DEFINE_SETTERS)
 #undef DEFINE_SETTERS
 
+RoomDesc Room::readField(const RoomDesc &field) const
+{
+    if (m_textBlock == nullptr)
+        return field;
+    return m_textBlock->inflate()->at(m_textIndex).description;
+}
+
+RoomContents Room::readField(const RoomContents &field) const
+{
+    if (m_textBlock == nullptr)
+        return field;
+    return m_textBlock->inflate()->at(m_textIndex).contents;
+}
+
+void Room::materializeText()
+{
+    if (m_textBlock == nullptr)
+        return;
+
+    const RoomTextBlock::SharedTexts texts = m_textBlock->inflate();
+    const RoomTextBlock::Text &text = texts->at(m_textIndex);
+    m_fields.Description = text.description;
+    m_fields.Contents = text.contents;
+    m_textBlock.reset();
+}
+
+void Room::setLazyText(std::shared_ptr<const RoomTextBlock> block, const uint32_t index)
+{
+    assert(block != nullptr && index < block->size());
+    m_textBlock = std::move(block);
+    m_textIndex = index;
+    m_fields.Description = RoomDesc{};
+    m_fields.Contents = RoomContents{};
+    updateFingerprint();
+}
+
+void Room::updateFingerprint()
+{
+    if (m_textBlock == nullptr) {
+        m_fingerprint = RoomFingerprint::compute(getName(), m_fields.Description);
+        return;
+    }
+    // Lazy text has its hash stored alongside it, so this doesn't inflate the block.
+    m_fingerprint.name = RoomFingerprint::hashWords(getName().getStdString());
+    m_fingerprint.desc = m_textBlock->getDescriptionHash(m_textIndex);
+}
+
+void Room::updateExitSignature()
+{
+    ExitSignature signature;
+    for (const ExitDirEnum dir : ALL_EXITS_NESWUD) {
+        const Exit &e = exit(dir);
+        const ExitFlags exitFlags = e.getExitFlags();
+        signature.flags.set(dir, exitFlags);
+        if (exitFlags) {
+            signature.hasExitFlags = true;
+        }
+        if (exitFlags.isNoMatch() || e.isHiddenExit()) {
+            signature.forgivingDirs |= static_cast<uint8_t>(1u << static_cast<int>(dir));
+        }
+    }
+    m_exitSignature = signature;
+}
+
+// Counts the directions whose exit or door flags differ, skipping the forgiving ones.
+NODISCARD static int countExitOrDoorDifferences(const uint32_t diff, const uint8_t forgivingDirs)
+{
+    static constexpr const uint32_t EXIT_BIT = ExitFlags{ExitFlagEnum::EXIT}.asUint32();
+    static constexpr const uint32_t DOOR_BIT = ExitFlags{ExitFlagEnum::DOOR}.asUint32();
+    static_assert(DOOR_BIT == EXIT_BIT << 1);
+
+    uint32_t perDir = 0;
+    for (int i = 0; i < ExitsFlagsType::NUM_DIRS; ++i) {
+        if ((forgivingDirs & (1u << i)) == 0) {
+            perDir |= EXIT_BIT << (i * ExitsFlagsType::SHIFT);
+        }
+    }
+    return bits::bitCount((diff | (diff >> 1)) & perDir);
+}
+
 #define DEFINE_SETTERS(_Type, _Prop, _OptInit) \
     void Room::set##_Type(ExitDirEnum dir, _Type value) \
     { \
@@ -170,7 +303,7 @@ void Room::setExitsList(const ExitsList &newExits)
     RoomUpdateFlags flags;
 
     for (const ExitDirEnum dir : ALL_EXITS7) {
-        Exit &ex = m_exits[dir];
+        const Exit &ex = getExitsList()[dir];
         const Exit &newValue = newExits[dir];
         if (ex == newValue)
             continue;
@@ -178,9 +311,11 @@ void Room::setExitsList(const ExitsList &newExits)
         const auto diff = getDifferences(ex, newValue);
         assert(!diff.empty());
         flags |= diff;
-        ex = newValue;
-        assert(ex == newValue);
+        m_exits.set(dir, newValue);
+        assert(getExitsList()[dir] == newValue);
     }
+    // Some of the exits may have been emptied through mutableExit().
+    m_exits.compact();
 
     if (!flags.empty())
         setModified(flags);
@@ -188,38 +323,35 @@ void Room::setExitsList(const ExitsList &newExits)
 
 void Room::addInExit(const ExitDirEnum dir, const RoomId id)
 {
-    Exit &ex = exit(dir);
-    if (ex.containsIn(id))
+    if (exit(dir).containsIn(id))
         return;
-    ex.addIn(id);
+    mutableExit(dir).addIn(id);
     setModified(incomingUpdateFlags);
 }
 
 void Room::addOutExit(const ExitDirEnum dir, const RoomId id)
 {
-    Exit &ex = exit(dir);
-    if (ex.containsOut(id))
+    if (exit(dir).containsOut(id))
         return;
-    ex.addOut(id);
+    mutableExit(dir).addOut(id);
     setModified(outgoingUpdateFlags);
 }
 
 void Room::removeInExit(const ExitDirEnum dir, const RoomId id)
 {
-    Exit &ex = exit(dir);
-    if (!ex.containsIn(id))
+    if (!exit(dir).containsIn(id))
         return;
-    ex.removeIn(id);
+    // The exit isn't dropped even if it's empty now, so it stays where it is in memory.
+    mutableExit(dir).removeIn(id);
     setModified(incomingUpdateFlags);
 }
 
 void Room::removeOutExit(const ExitDirEnum dir, const RoomId id)
 {
-    Exit &ex = exit(dir);
-    if (!ex.containsOut(id))
+    if (!exit(dir).containsOut(id))
         return;
     // REVISIT: check if it was actually there?
-    ex.removeOut(id);
+    mutableExit(dir).removeOut(id);
     setModified(outgoingUpdateFlags);
 }
 
@@ -237,6 +369,8 @@ void Room::setPosition(const Coordinate &c)
     if (c == m_position)
         return;
 
+    // The chunk the room is leaving has to drop it.
+    m_tracker.markMeshDirty(m_position);
     m_position = c;
     setModified(mesh_updateFlags | RoomUpdateEnum::Coord);
 }
@@ -256,6 +390,7 @@ void Room::setAboutToDie()
 {
     // REVISIT: m_id = INVALID_ROOMID; ?
     m_status = RoomStatusEnum::Zombie;
+    m_tracker.markMeshDirty(m_position);
 }
 
 void Room::setUpToDate()
@@ -278,17 +413,34 @@ void Room::setOutDated()
 
 void Room::setModified(const RoomUpdateFlags updateFlags)
 {
+    if (updateFlags.contains(RoomUpdateEnum::ExitFlags)
+        || updateFlags.contains(RoomUpdateEnum::DoorFlags)) {
+        updateExitSignature();
+    }
     m_tracker.notifyModified(*this, updateFlags);
 }
 
+std::shared_ptr<Room> Room::allocate(RoomModificationTracker &tracker, const RoomStatusEnum status)
+{
+    if (std::shared_ptr<SlabArena> arena = tracker.getRoomArena()) {
+        // The room and its control block share one slab block, and the
+        // allocator keeps the arena alive for as long as the room exists.
+        return std::allocate_shared<Room>(SlabAllocator<Room>{std::move(arena)},
+                                          this_is_private{0},
+                                          tracker,
+                                          status);
+    }
+    return std::make_shared<Room>(this_is_private{0}, tracker, status);
+}
+
 std::shared_ptr<Room> Room::createPermanentRoom(RoomModificationTracker &tracker)
 {
-    return std::make_shared<Room>(this_is_private{0}, tracker, RoomStatusEnum::Permanent);
+    return allocate(tracker, RoomStatusEnum::Permanent);
 }
 
 SharedRoom Room::createTemporaryRoom(RoomModificationTracker &tracker, const ParseEvent &ev)
 {
-    auto room = std::make_shared<Room>(this_is_private{0}, tracker, RoomStatusEnum::Temporary);
+    auto room = allocate(tracker, RoomStatusEnum::Temporary);
     Room::update(*room, ev);
     return room;
 }
@@ -305,21 +457,36 @@ SharedParseEvent Room::getEvent(const Room *const room)
 
     return ParseEvent::createEvent(CommandEnum::UNKNOWN,
                                    room->getName(),
-                                   room->getDescription(),
-                                   room->getContents(),
+                                   room->readDescription(),
+                                   room->readContents(),
                                    room->getTerrainType(),
                                    exitFlags,
                                    PromptFlagsType{},
-                                   ConnectedRoomFlagsType{});
+                                   ConnectedRoomFlagsType{},
+                                   room->m_tracker.getRoomArena());
 }
 
-NODISCARD static int wordDifference(StringView a, StringView b)
+NODISCARD static int wordDifference(const StringView a, const StringView b)
 {
-    size_t diff = 0;
-    while (!a.isEmpty() && !b.isEmpty())
-        if (a.takeFirstLetter() != b.takeFirstLetter())
-            ++diff;
-    return static_cast<int>(diff + a.size() + b.size());
+    const size_t common = std::min(a.size(), b.size());
+    const size_t diff = text_scan::countMismatches(a.getStdStringView().data(),
+                                                   b.getStdStringView().data(),
+                                                   common);
+    return static_cast<int>(diff + (a.size() - common) + (b.size() - common));
+}
+
+ComparisonResultEnum Room::compareText(const std::string &room,
+                                       const std::string &event,
+                                       const bool sameWords,
+                                       const int prevTolerance,
+                                       const bool updated)
+{
+    // Text that has the same words can only differ in its whitespace.
+    if (sameWords) {
+        return (event.size() == room.size()) ? ComparisonResultEnum::EQUAL
+                                             : ComparisonResultEnum::TOLERANCE;
+    }
+    return compareStrings(room, event, prevTolerance, updated);
 }
 
 ComparisonResultEnum Room::compareStrings(const std::string &room,
@@ -367,7 +534,9 @@ ComparisonResultEnum Room::compare(const Room *const room,
                                    const int tolerance)
 {
     const auto &name = room->getName();
-    const auto &desc = room->getDescription();
+    // Only lazy text is copied out of its block; the rest is compared in place.
+    const RoomDesc lazyDesc = room->hasLazyText() ? room->readDescription() : RoomDesc{};
+    const RoomDesc &desc = room->hasLazyText() ? lazyDesc : room->getDescription();
     const RoomTerrainEnum terrainType = room->getTerrainType();
     bool updated = room->isUpToDate();
 
@@ -384,7 +553,18 @@ ComparisonResultEnum Room::compare(const Room *const room,
         return ComparisonResultEnum::DIFFERENT;
     }
 
-    switch (compareStrings(name.getStdString(), event.getRoomName().getStdString(), tolerance)) {
+    // Identical text always compares EQUAL; interned strings make this a pointer check.
+    // Otherwise the fingerprints catch text that only differs in its whitespace.
+    const RoomFingerprint &fingerprint = room->getFingerprint();
+    const RoomFingerprint &eventFingerprint = event.getFingerprint();
+    const auto nameResult = (name == event.getRoomName())
+                                ? ComparisonResultEnum::EQUAL
+                                : compareText(name.getStdString(),
+                                              event.getRoomName().getStdString(),
+                                              fingerprint.name == eventFingerprint.name,
+                                              tolerance,
+                                              true);
+    switch (nameResult) {
     case ComparisonResultEnum::TOLERANCE:
         updated = false;
         break;
@@ -394,8 +574,14 @@ ComparisonResultEnum Room::compare(const Room *const room,
         break;
     }
 
-    switch (
-        compareStrings(desc.getStdString(), event.getRoomDesc().getStdString(), tolerance, updated)) {
+    const auto descResult = (desc == event.getRoomDesc())
+                                ? ComparisonResultEnum::EQUAL
+                                : compareText(desc.getStdString(),
+                                              event.getRoomDesc().getStdString(),
+                                              fingerprint.desc == eventFingerprint.desc,
+                                              tolerance,
+                                              updated);
+    switch (descResult) {
     case ComparisonResultEnum::TOLERANCE:
         updated = false;
         break;
@@ -451,6 +637,28 @@ ComparisonResultEnum Room::compareWeakProps(const Room *const room, const ParseE
 
     const ExitsFlagsType eventExitsFlags = event.getExitsFlags();
     if (eventExitsFlags.isValid()) {
+        static constexpr const uint32_t ALL_DIRS_MASK = (1u << (ExitsFlagsType::SHIFT
+                                                                * ExitsFlagsType::NUM_DIRS))
+                                                        - 1u;
+        const ExitSignature &signature = room->getExitSignature();
+        const uint32_t diff = (static_cast<uint32_t>(eventExitsFlags)
+                               ^ static_cast<uint32_t>(signature.flags))
+                              & ALL_DIRS_MASK;
+        if (diff == 0u) {
+            // Nothing below would differ, but an exit still makes them valid.
+            if (signature.hasExitFlags) {
+                exitsValid = true;
+            }
+            return (tolerance || !exitsValid) ? ComparisonResultEnum::TOLERANCE
+                                              : ComparisonResultEnum::EQUAL;
+        }
+        // Each such difference is either forgiven with tolerance or rejected outright,
+        // and tolerance is only given once.
+        if (room->isUpToDate()
+            && countExitOrDoorDifferences(diff, signature.forgivingDirs) >= 2) {
+            return ComparisonResultEnum::DIFFERENT;
+        }
+
         bool previousDifference = false;
         for (const ExitDirEnum dir : ALL_EXITS_NESWUD) {
             const Exit &roomExit = room->exit(dir);
@@ -641,11 +849,11 @@ void Room::update(Room *const target, const Room *const source)
     if (!name.isEmpty()) {
         target->setName(name);
     }
-    const auto &desc = source->getDescription();
+    const auto desc = source->readDescription();
     if (!desc.isEmpty()) {
         target->setDescription(desc);
     }
-    const auto &contents = source->getContents();
+    const auto contents = source->readContents();
     if (!contents.isEmpty()) {
         target->setContents(contents);
     }
@@ -679,7 +887,7 @@ void Room::update(Room *const target, const Room *const source)
         // Replace data if target room is not up to date
         for (const ExitDirEnum dir : ALL_EXITS_NESWUD) {
             const Exit &sourceExit = source->exit(dir);
-            Exit &targetExit = target->exit(dir);
+            Exit &targetExit = target->mutableExit(dir);
             ExitFlags sourceExitFlags = sourceExit.getExitFlags();
             if (targetExit.isDoor()) {
                 if (!sourceExitFlags.isDoor()) {
@@ -696,7 +904,7 @@ void Room::update(Room *const target, const Room *const source)
         // Combine data if target room is up to date
         for (const ExitDirEnum dir : ALL_EXITS_NESWUD) {
             const Exit &soureExit = source->exit(dir);
-            Exit &targetExit = target->exit(dir);
+            Exit &targetExit = target->mutableExit(dir);
             const ExitFlags sourceExitFlags = soureExit.getExitFlags();
             const ExitFlags targetExitFlags = targetExit.getExitFlags();
             if (targetExitFlags != sourceExitFlags) {
@@ -710,6 +918,9 @@ void Room::update(Room *const target, const Room *const source)
             targetExit.setDoorFlags(doorFlags);
         }
     }
+    // The exits were changed in place.
+    target->m_exits.compact();
+    target->updateExitSignature();
     if (source->isUpToDate()) {
         target->setUpToDate();
     }
@@ -719,7 +930,7 @@ std::string Room::toStdString() const
 {
     std::stringstream ss;
     ss << getName().getStdString() << "\n"
-       << getDescription().getStdString() << getContents().getStdString();
+       << readDescription().getStdString() << readContents().getStdString();
 
     ss << "Exits:";
     for (const ExitDirEnum j : ALL_EXITS7) {
@@ -772,12 +983,12 @@ const Coordinate &Room::exitDir(ExitDirEnum dir)
     return exitDirs[dir];
 }
 
-std::shared_ptr<Room> Room::clone(RoomModificationTracker &tracker) const
+std::shared_ptr<Room> Room::cloneExact(RoomModificationTracker &tracker) const
 {
     if (m_status == RoomStatusEnum::Zombie)
         throw std::runtime_error("Attempt to clone a zombie");
 
-    const auto copy = std::make_shared<Room>(this_is_private{0}, tracker, RoomStatusEnum::Temporary);
+    const auto copy = allocate(tracker, m_status);
 #define COPY(x) \
     do { \
         copy->x = this->x; \
@@ -788,7 +999,17 @@ std::shared_ptr<Room> Room::clone(RoomModificationTracker &tracker) const
     COPY(m_id);
     COPY(m_status);
     COPY(m_borked);
+    COPY(m_textBlock);
+    COPY(m_textIndex);
+    COPY(m_fingerprint);
+    COPY(m_exitSignature);
 #undef COPY
+    return copy;
+}
+
+std::shared_ptr<Room> Room::clone(RoomModificationTracker &tracker) const
+{
+    const auto copy = cloneExact(tracker);
     switch (copy->m_status) {
     case RoomStatusEnum::Permanent:
         copy->m_status = RoomStatusEnum::Temporary;
@@ -7,6 +7,7 @@
 #include <cassert>
 #include <memory>
 #include <optional>
+#include <type_traits>
 #include <QDebug>
 #include <QVariant>
 
@@ -17,11 +18,17 @@
 #include "../global/roomid.h"
 #include "../mapdata/mmapper2exit.h"
 #include "../mapdata/mmapper2room.h"
+#include "../parser/ExitsFlags.h"
+#include "ExitsList.h"
+#include "MeshChunk.h"
+#include "RoomFingerprint.h"
 #include "coordinate.h"
 #include "exit.h"
 
 class ExitFieldVariant;
 class ParseEvent;
+class RoomTextBlock;
+class SlabArena;
 
 #define X_FOREACH_FlagModifyModeEnum(X) \
     X(SET) \
@@ -32,8 +39,6 @@ enum class NODISCARD FlagModifyModeEnum { X_FOREACH_FlagModifyModeEnum(DECL) };
 #undef DECL
 enum class NODISCARD ComparisonResultEnum { DIFFERENT = 0, EQUAL, TOLERANCE };
 
-using ExitsList = EnumIndexedArray<Exit, ExitDirEnum, NUM_EXITS>;
-
 struct NODISCARD ExitDirConstRef final
 {
     const ExitDirEnum dir;
@@ -81,8 +86,13 @@ struct NODISCARD RoomUpdateFlags final : enums::Flags<RoomUpdateFlags, RoomUpdat
 class NODISCARD RoomModificationTracker
 {
 private:
+    // Beyond this many chunks, it's simpler to rebuild everything.
+    static constexpr const size_t MAX_DIRTY_CHUNKS = 64;
+
     bool m_isModified = false;
     bool m_needsMapUpdate = false;
+    bool m_allChunksDirty = false;
+    MeshChunkIdSet m_dirtyChunks;
 
 public:
     virtual ~RoomModificationTracker();
@@ -97,7 +107,27 @@ class NODISCARD RoomModificationTracker
 
 public:
     NODISCARD bool getNeedsMapUpdate() const { return m_needsMapUpdate; }
-    void clearNeedsMapUpdate() { m_needsMapUpdate = false; }
+    // The chunks whose meshes are out of date, or nullptr if they all are.
+    NODISCARD const MeshChunkIdSet *getDirtyChunks() const
+    {
+        return m_allChunksDirty ? nullptr : &m_dirtyChunks;
+    }
+    void clearNeedsMapUpdate()
+    {
+        m_needsMapUpdate = false;
+        m_allChunksDirty = false;
+        m_dirtyChunks.clear();
+    }
+    // Flags the meshes of the chunk containing the coordinate.
+    void markMeshDirty(const Coordinate &c);
+    void markAllMeshesDirty();
+
+public:
+    // Rooms created for this tracker are allocated from this arena, if it has one.
+    NODISCARD std::shared_ptr<SlabArena> getRoomArena() const { return virt_getRoomArena(); }
+
+private:
+    NODISCARD virtual std::shared_ptr<SlabArena> virt_getRoomArena() const { return nullptr; }
 };
 
 // NOTE: Names are capitalized for use with getRoomName() and setRoomName(),
@@ -129,6 +159,15 @@ class NODISCARD Room final : public std::enable_shared_from_this<Room>
         explicit this_is_private(int) {}
     };
 
+    // The exit flags compareWeakProps() compares, packed like the event's, and the
+    // directions where it may forgive a missing exit or door.
+    struct NODISCARD ExitSignature final
+    {
+        ExitsFlagsType flags;
+        uint8_t forgivingDirs = 0;
+        bool hasExitFlags = false;
+    };
+
     struct NODISCARD RoomFields final
     {
 #define DECL_FIELD(_Type, _Prop, _OptInit) _Type _Prop{_OptInit};
@@ -137,7 +176,7 @@ class NODISCARD Room final : public std::enable_shared_from_this<Room>
     };
 
 private:
-    /* WARNING: If you make any changes to the data members of Room, you'll have to modify clone() */
+    /* WARNING: If you make any changes to the data members of Room, you'll have to modify cloneExact() */
     RoomModificationTracker &m_tracker;
     Coordinate m_position;
     RoomFields m_fields;
@@ -145,9 +184,43 @@ class NODISCARD Room final : public std::enable_shared_from_this<Room>
     RoomId m_id = INVALID_ROOMID;
     RoomStatusEnum m_status = RoomStatusEnum::Zombie;
     bool m_borked = true;
+    // Description and contents still compressed in a shared block (see setLazyText()).
+    std::shared_ptr<const RoomTextBlock> m_textBlock;
+    uint32_t m_textIndex = 0;
+    // Kept up to date as the name or description change, so comparisons made
+    // from several threads at once only read it.
+    RoomFingerprint m_fingerprint;
+    // Rebuilt whenever the exit or door flags change, for the same reason.
+    ExitSignature m_exitSignature;
+
+private:
+    // Adds the exit if the direction doesn't have one (see ExitsList).
+    NODISCARD Exit &mutableExit(ExitDirEnum dir) { return m_exits[dir]; }
 
 private:
-    NODISCARD Exit &exit(ExitDirEnum dir) { return m_exits[dir]; }
+    template<typename T>
+    NODISCARD const T &getField(const T &field) const
+    {
+        if constexpr (std::is_same_v<T, RoomDesc> || std::is_same_v<T, RoomContents>) {
+            // Lazy text isn't in m_fields; see readDescription().
+            assert(!hasLazyText());
+        }
+        return field;
+    }
+    template<typename T>
+    NODISCARD const T &readField(const T &field) const
+    {
+        return field;
+    }
+    // These return by value, since the text may come from the block.
+    NODISCARD RoomDesc readField(const RoomDesc &field) const;
+    NODISCARD RoomContents readField(const RoomContents &field) const;
+    // Moves lazy text into m_fields before it's modified.
+    void materializeText();
+    void updateFingerprint();
+    NODISCARD const RoomFingerprint &getFingerprint() const { return m_fingerprint; }
+    void updateExitSignature();
+    NODISCARD const ExitSignature &getExitSignature() const { return m_exitSignature; }
 
 public:
     NODISCARD const Exit &exit(ExitDirEnum dir) const { return m_exits[dir]; }
@@ -207,11 +280,30 @@ class NODISCARD Room final : public std::enable_shared_from_this<Room>
 
 public:
 #define DECL_GETTERS_AND_SETTERS(_Type, _Prop, _OptInit) \
-    NODISCARD inline const _Type &get##_Prop() const { return m_fields._Prop; } \
+    NODISCARD inline const _Type &get##_Prop() const { return getField(m_fields._Prop); } \
+    NODISCARD inline decltype(auto) read##_Prop() const { return readField(m_fields._Prop); } \
     void set##_Prop(_Type value);
     XFOREACH_ROOM_PROPERTY(DECL_GETTERS_AND_SETTERS)
 #undef DECL_GETTERS_AND_SETTERS
 
+    // The description and contents are read from the block on demand, until
+    // either one is set. Used when loading a map.
+    //
+    // Lazy text isn't in the room's own fields, so getDescription() and
+    // getContents() can't be used while hasLazyText(). readDescription() and
+    // readContents() work either way, but return a copy, and lazy text takes
+    // the shared cache's lock (and may inflate its block). For the other
+    // fields, read##_Prop() is the same as get##_Prop().
+    void setLazyText(std::shared_ptr<const RoomTextBlock> block, uint32_t index);
+    NODISCARD bool hasLazyText() const { return m_textBlock != nullptr; }
+    // Whether both rooms still read the same lazy text, in which case their
+    // descriptions and contents match without having to read them.
+    NODISCARD bool sharesLazyText(const Room &other) const
+    {
+        return m_textBlock != nullptr && m_textBlock == other.m_textBlock
+               && m_textIndex == other.m_textIndex;
+    }
+
 public:
     Room() = delete;
     explicit Room(this_is_private, RoomModificationTracker &tracker, RoomStatusEnum status);
@@ -245,6 +337,15 @@ class NODISCARD Room final : public std::enable_shared_from_this<Room>
     NODISCARD static const Coordinate &exitDir(ExitDirEnum dir);
 
 private:
+    NODISCARD static std::shared_ptr<Room> allocate(RoomModificationTracker &tracker,
+                                                    RoomStatusEnum status);
+
+private:
+    NODISCARD static ComparisonResultEnum compareText(const std::string &room,
+                                                      const std::string &event,
+                                                      bool sameWords,
+                                                      int prevTolerance,
+                                                      bool updated);
     NODISCARD static ComparisonResultEnum compareStrings(const std::string &room,
                                                          const std::string &event,
                                                          int prevTolerance,
@@ -252,4 +353,6 @@ class NODISCARD Room final : public std::enable_shared_from_this<Room>
 
 public:
     NODISCARD std::shared_ptr<Room> clone(RoomModificationTracker &tracker) const;
+    // Unlike clone(), this keeps the room's status.
+    NODISCARD std::shared_ptr<Room> cloneExact(RoomModificationTracker &tracker) const;
 };
@@ -0,0 +1,157 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "CacheRegistry.h"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace { // anonymous
+
+struct NODISCARD Cache final
+{
+    std::string name;
+    cache_registry::CacheCostEnum cost = cache_registry::CacheCostEnum::LOW;
+    cache_registry::SizeFn size;
+    cache_registry::EvictFn evict;
+};
+
+struct NODISCARD Registry final
+{
+    std::mutex mutex;
+    std::map<uint64_t, Cache> caches;
+    uint64_t nextId = 1;
+    size_t budget = 0;
+};
+
+NODISCARD Registry &getRegistry()
+{
+    static Registry registry;
+    return registry;
+}
+
+NODISCARD double getCostWeight(const cache_registry::CacheCostEnum cost)
+{
+    switch (cost) {
+    case cache_registry::CacheCostEnum::LOW:
+        return 1.0;
+    case cache_registry::CacheCostEnum::MEDIUM:
+        return 4.0;
+    case cache_registry::CacheCostEnum::HIGH:
+        return 16.0;
+    }
+    return 1.0;
+}
+
+struct NODISCARD Candidate final
+{
+    Cache *cache = nullptr;
+    size_t bytes = 0;
+    // Bytes freed per unit of refill cost; the highest goes first.
+    double benefit = 0.0;
+};
+
+// Evicts the best candidates until at least `excess` bytes are gone.
+NODISCARD size_t evictLocked(Registry &registry, const size_t excess)
+{
+    std::vector<Candidate> candidates;
+    candidates.reserve(registry.caches.size());
+    for (auto &[id, cache] : registry.caches) {
+        const size_t bytes = cache.size();
+        if (bytes != 0) {
+            const double benefit = static_cast<double>(bytes) / getCostWeight(cache.cost);
+            candidates.emplace_back(Candidate{&cache, bytes, benefit});
+        }
+    }
+    std::stable_sort(candidates.begin(),
+                     candidates.end(),
+                     [](const Candidate &a, const Candidate &b) { return a.benefit > b.benefit; });
+
+    size_t freed = 0;
+    for (const Candidate &candidate : candidates) {
+        if (freed >= excess)
+            break;
+        Cache &cache = *candidate.cache;
+        cache.evict(excess - freed);
+        const size_t after = cache.size();
+        freed += candidate.bytes - std::min(after, candidate.bytes);
+    }
+    return freed;
+}
+
+NODISCARD size_t getTotalBytesLocked(Registry &registry)
+{
+    size_t total = 0;
+    for (const auto &[id, cache] : registry.caches) {
+        total += cache.size();
+    }
+    return total;
+}
+
+} // namespace
+
+cache_registry::Registration::Registration(const char *const name,
+                                           const CacheCostEnum cost,
+                                           SizeFn size,
+                                           EvictFn evict)
+{
+    Registry &registry = getRegistry();
+    std::lock_guard<std::mutex> lock{registry.mutex};
+    m_id = registry.nextId++;
+    registry.caches.emplace(m_id, Cache{name, cost, std::move(size), std::move(evict)});
+}
+
+cache_registry::Registration::~Registration()
+{
+    if (m_id == 0)
+        return;
+    Registry &registry = getRegistry();
+    std::lock_guard<std::mutex> lock{registry.mutex};
+    registry.caches.erase(m_id);
+}
+
+void cache_registry::setBudget(const size_t bytes)
+{
+    Registry &registry = getRegistry();
+    std::lock_guard<std::mutex> lock{registry.mutex};
+    registry.budget = bytes;
+}
+
+size_t cache_registry::getBudget()
+{
+    Registry &registry = getRegistry();
+    std::lock_guard<std::mutex> lock{registry.mutex};
+    return registry.budget;
+}
+
+size_t cache_registry::getTotalBytes()
+{
+    Registry &registry = getRegistry();
+    std::lock_guard<std::mutex> lock{registry.mutex};
+    return getTotalBytesLocked(registry);
+}
+
+size_t cache_registry::enforceBudget()
+{
+    Registry &registry = getRegistry();
+    std::lock_guard<std::mutex> lock{registry.mutex};
+    if (registry.budget == 0)
+        return 0;
+
+    const size_t total = getTotalBytesLocked(registry);
+    if (total <= registry.budget)
+        return 0;
+
+    return evictLocked(registry, total - registry.budget);
+}
+
+size_t cache_registry::evictAll()
+{
+    Registry &registry = getRegistry();
+    std::lock_guard<std::mutex> lock{registry.mutex};
+    return evictLocked(registry, getTotalBytesLocked(registry));
+}
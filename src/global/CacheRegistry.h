@@ -0,0 +1,55 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include "RuleOf5.h"
+#include "macros.h"
+
+/**
+ * Caches whose contents can be rebuilt on demand, so they can be dropped to
+ * keep their total size under one budget (general.cacheBudgetMiB).
+ *
+ * Each cache keeps a Registration for as long as it exists, telling the
+ * registry roughly how big it is and how to shrink it. When the caches are
+ * over budget, the ones that are cheapest to refill per byte are evicted
+ * first.
+ *
+ * The callbacks are called on the thread that enforces the budget (the main
+ * thread), with the registry locked; they mustn't register or unregister,
+ * and caches used from other threads have to lock themselves.
+ */
+namespace cache_registry {
+
+// Roughly how much work it takes to refill a cache after it's been evicted.
+enum class NODISCARD CacheCostEnum : uint8_t { LOW, MEDIUM, HIGH };
+
+using SizeFn = std::function<size_t()>;
+// Should free at least the given number of bytes, or everything it holds.
+using EvictFn = std::function<void(size_t bytes)>;
+
+class NODISCARD Registration final
+{
+private:
+    uint64_t m_id = 0;
+
+public:
+    Registration() = default;
+    explicit Registration(const char *name, CacheCostEnum cost, SizeFn size, EvictFn evict);
+    ~Registration();
+    DELETE_CTORS_AND_ASSIGN_OPS(Registration);
+};
+
+// Zero means unlimited.
+void setBudget(size_t bytes);
+NODISCARD size_t getBudget();
+NODISCARD size_t getTotalBytes();
+
+// Evicts caches until they fit in the budget; returns about how many bytes were freed.
+size_t enforceBudget();
+// Evicts every cache, e.g. when the system is running low on memory.
+size_t evictAll();
+} // namespace cache_registry
@@ -4,6 +4,7 @@
 
 #include "Signal.h"
 
+#include <utility>
 #include <vector>
 
 class NODISCARD ChangeMonitor final : private ::Signal<>
@@ -11,7 +12,7 @@ class NODISCARD ChangeMonitor final : private ::Signal<>
 public:
     using Base = ::Signal<>;
     using Function = Base::Function;
-    using CallbackLifetime = Signal::SharedConnection;
+    using CallbackLifetime = Base::Lifetime;
 
 public:
     NODISCARD CallbackLifetime registerChangeCallback(Base::Function callback)
@@ -38,7 +39,7 @@ struct NODISCARD ConnectionSet final
 public:
     ConnectionSet &operator+=(ChangeMonitor::CallbackLifetime lifetime)
     {
-        m_lifetimes.emplace_back(lifetime);
+        m_lifetimes.emplace_back(std::move(lifetime));
         return *this;
     }
 };
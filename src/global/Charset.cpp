@@ -3,9 +3,23 @@
 
 #include "Charset.h"
 
+#include <cstdint>
+#include <ostream>
+
 #include "../parser/parserutils.h"
+#include "TextScan.h"
 #include "TextUtils.h"
 
+NODISCARD static bool isAsciiByte(const char c)
+{
+    return static_cast<uint8_t>(c) < 0x80u;
+}
+
+size_t getAsciiPrefixLength(const std::string_view sv)
+{
+    return text_scan::asciiPrefixLength(sv);
+}
+
 void latin1ToUtf8(std::ostream &os, const char c)
 {
     const auto uc = static_cast<uint8_t>(c);
@@ -32,10 +46,28 @@ void latin1ToUtf8(std::ostream &os, const char c)
     os.write(buf, 2);
 }
 
-void latin1ToUtf8(std::ostream &os, const std::string_view sv)
+void latin1ToUtf8(std::ostream &os, std::string_view sv)
 {
-    for (char c : sv) {
-        latin1ToUtf8(os, c);
+    // ASCII passes through in runs; the rest is encoded into a small buffer
+    // so each run costs one write.
+    char buf[256];
+    while (!sv.empty()) {
+        const size_t ascii = getAsciiPrefixLength(sv);
+        if (ascii != 0) {
+            os.write(sv.data(), static_cast<std::streamsize>(ascii));
+            sv.remove_prefix(ascii);
+        }
+
+        size_t len = 0;
+        while (!sv.empty() && !isAsciiByte(sv.front()) && len + 2 <= sizeof(buf)) {
+            const auto uc = static_cast<uint8_t>(sv.front());
+            buf[len++] = static_cast<char>(0xc0u | (uc >> 6u));
+            buf[len++] = static_cast<char>(0x80u | (uc & 0x3fu));
+            sv.remove_prefix(1);
+        }
+        if (len != 0) {
+            os.write(buf, static_cast<std::streamsize>(len));
+        }
     }
 }
 
@@ -57,3 +89,42 @@ void convertFromLatin1(std::ostream &os,
 
     std::abort();
 }
+
+std::string utf8ToLatin1(std::string_view sv)
+{
+    std::string result;
+    result.reserve(sv.size());
+    while (!sv.empty()) {
+        const size_t ascii = getAsciiPrefixLength(sv);
+        result.append(sv.data(), ascii);
+        sv.remove_prefix(ascii);
+        if (sv.empty())
+            break;
+
+        const auto lead = static_cast<uint8_t>(sv[0]);
+        const size_t len = (lead >= 0xc2u && lead <= 0xdfu)   ? 2
+                           : (lead >= 0xe0u && lead <= 0xefu) ? 3
+                           : (lead >= 0xf0u && lead <= 0xf4u) ? 4
+                                                              : 0;
+        const auto isContinuation = [&sv](const size_t i) {
+            return (static_cast<uint8_t>(sv[i]) & 0xc0u) == 0x80u;
+        };
+        bool valid = len != 0 && len <= sv.size();
+        for (size_t i = 1; valid && i < len; ++i) {
+            valid = isContinuation(i);
+        }
+        if (!valid) {
+            result += '?';
+            sv.remove_prefix(1);
+            continue;
+        }
+
+        // Only two-byte sequences can be in range, and then only U+0080 .. U+00FF.
+        const uint32_t codepoint = (len == 2) ? (((lead & 0x1fu) << 6u)
+                                                 | (static_cast<uint8_t>(sv[1]) & 0x3fu))
+                                              : 0x800u;
+        result += (codepoint < 0x100u) ? static_cast<char>(codepoint) : '?';
+        sv.remove_prefix(len);
+    }
+    return result;
+}
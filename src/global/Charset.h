@@ -2,11 +2,21 @@
 // SPDX-License-Identifier: GPL-2.0-or-later
 // Copyright (C) 2021 The MMapper Authors
 
+#include <cstddef>
 #include <iosfwd>
 #include <string>
+#include <string_view>
 
 #include "../configuration/configuration.h" // TODO: move CharacterEncodingEnum somewhere
 
+// Returns the number of bytes before the first one that isn't 7-bit ASCII;
+// most of what MUME sends is ASCII, so this checks 8 bytes at a time.
+NODISCARD size_t getAsciiPrefixLength(const std::string_view sv);
+NODISCARD inline bool isPureAscii(const std::string_view sv)
+{
+    return getAsciiPrefixLength(sv) == sv.size();
+}
+
 void latin1ToUtf8(std::ostream &os, char c);
 void latin1ToUtf8(std::ostream &os, const std::string_view sv);
 // Converts input string_view sv from latin1 to the specified encoding
@@ -14,3 +24,6 @@ void latin1ToUtf8(std::ostream &os, const std::string_view sv);
 void convertFromLatin1(std::ostream &os,
                        const CharacterEncodingEnum encoding,
                        const std::string_view sv);
+// Converts UTF-8 to Latin-1; code points above U+00FF and invalid
+// sequences become '?'.
+NODISCARD std::string utf8ToLatin1(std::string_view sv);
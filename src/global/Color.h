@@ -55,6 +55,13 @@ struct NODISCARD Color final
     explicit Color(const QColor &rgb, float alpha);
 
     NODISCARD static Color fromRGB(uint32_t rgb);
+    // The inverse of getRGBA().
+    NODISCARD static Color fromRGBA(const uint32_t rgba)
+    {
+        Color c;
+        c.m_color = rgba;
+        return c;
+    }
 
 public:
     NODISCARD QColor getQColor() const;
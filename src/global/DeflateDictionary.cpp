@@ -0,0 +1,180 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "DeflateDictionary.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#ifndef MMAPPER_NO_ZLIB
+#include <zlib.h>
+#endif
+
+// Shorter lines aren't worth a dictionary slot.
+static constexpr const size_t MIN_LINE_LENGTH = 8;
+// The size prefix, as written by qCompress().
+static constexpr const int SIZE_PREFIX = 4;
+
+DeflateDictionary::DeflateDictionary(QByteArray bytes)
+    : m_bytes{std::move(bytes)}
+{
+    if (static_cast<size_t>(m_bytes.size()) > MAX_SIZE) {
+        throw std::invalid_argument("dictionary is too large");
+    }
+}
+
+DeflateDictionary::~DeflateDictionary() = default;
+
+std::shared_ptr<const DeflateDictionary> DeflateDictionary::train(
+    MAYBE_UNUSED const std::vector<std::string_view> &samples)
+{
+#ifdef MMAPPER_NO_ZLIB
+    return nullptr;
+#else
+    std::unordered_map<std::string_view, uint32_t> counts;
+    for (const std::string_view sample : samples) {
+        for (size_t begin = 0; begin < sample.size();) {
+            const size_t newline = sample.find('\n', begin);
+            // Lines keep their newline, so consecutive lines still match.
+            const size_t end = (newline == std::string_view::npos) ? sample.size() : newline + 1;
+            const std::string_view line = sample.substr(begin, end - begin);
+            if (line.size() >= MIN_LINE_LENGTH) {
+                ++counts[line];
+            }
+            begin = end;
+        }
+    }
+
+    // Bytes saved by having the line in the dictionary, roughly.
+    std::vector<std::pair<uint64_t, std::string_view>> scored;
+    for (const auto &[line, count] : counts) {
+        if (count > 1) {
+            scored.emplace_back(static_cast<uint64_t>(count - 1) * line.size(), line);
+        }
+    }
+    std::sort(scored.begin(), scored.end(), [](const auto &a, const auto &b) {
+        return (a.first != b.first) ? (a.first > b.first) : (a.second < b.second);
+    });
+
+    std::vector<std::string_view> chosen;
+    size_t total = 0;
+    for (const auto &entry : scored) {
+        const std::string_view line = entry.second;
+        if (total + line.size() <= MAX_SIZE) {
+            chosen.emplace_back(line);
+            total += line.size();
+        }
+    }
+    if (chosen.empty()) {
+        return nullptr;
+    }
+
+    // zlib finds matches near the end of the dictionary more cheaply.
+    QByteArray bytes;
+    bytes.reserve(static_cast<int>(total));
+    for (auto it = chosen.rbegin(); it != chosen.rend(); ++it) {
+        bytes.append(it->data(), static_cast<int>(it->size()));
+    }
+    return std::make_shared<const DeflateDictionary>(std::move(bytes));
+#endif
+}
+
+#ifndef MMAPPER_NO_ZLIB
+NODISCARD static Bytef *asBytes(const char *const s)
+{
+    // next_in is only const with ZLIB_CONST; zlib never writes through it.
+    return const_cast<Bytef *>(reinterpret_cast<const Bytef *>(s));
+}
+
+NODISCARD static Bytef *asBytes(char *const s)
+{
+    return reinterpret_cast<Bytef *>(s);
+}
+#endif
+
+QByteArray DeflateDictionary::compress(MAYBE_UNUSED const QByteArray &data) const
+{
+#ifdef MMAPPER_NO_ZLIB
+    throw std::runtime_error("zlib is unavailable");
+#else
+    z_stream strm{};
+    if (deflateInit(&strm, Z_DEFAULT_COMPRESSION) != Z_OK) {
+        throw std::runtime_error("Unable to initialize zlib");
+    }
+    if (deflateSetDictionary(&strm, asBytes(m_bytes.constData()), static_cast<uInt>(m_bytes.size()))
+        != Z_OK) {
+        deflateEnd(&strm);
+        throw std::runtime_error("Unable to set the zlib dictionary");
+    }
+
+    const auto size = static_cast<uint32_t>(data.size());
+    QByteArray result;
+    result.resize(SIZE_PREFIX + static_cast<int>(deflateBound(&strm, size)));
+    for (int i = 0; i < SIZE_PREFIX; ++i) {
+        result[i] = static_cast<char>((size >> (8 * (SIZE_PREFIX - 1 - i))) & 0xFFu);
+    }
+
+    strm.next_in = asBytes(data.constData());
+    strm.avail_in = size;
+    strm.next_out = asBytes(result.data() + SIZE_PREFIX);
+    strm.avail_out = static_cast<uInt>(result.size() - SIZE_PREFIX);
+    const int ret = deflate(&strm, Z_FINISH);
+    const auto written = static_cast<int>(strm.total_out);
+    deflateEnd(&strm);
+    if (ret != Z_STREAM_END) {
+        throw std::runtime_error("zlib error: " + std::to_string(ret));
+    }
+    result.resize(SIZE_PREFIX + written);
+    return result;
+#endif
+}
+
+QByteArray DeflateDictionary::uncompress(MAYBE_UNUSED const QByteArray &data) const
+{
+#ifdef MMAPPER_NO_ZLIB
+    throw std::runtime_error("zlib is unavailable");
+#else
+    if (data.size() < SIZE_PREFIX) {
+        throw std::runtime_error("compressed data is truncated");
+    }
+    uint32_t size = 0;
+    for (int i = 0; i < SIZE_PREFIX; ++i) {
+        size = (size << 8u) | static_cast<uint8_t>(data[i]);
+    }
+    // deflate can't do better than about 1032:1, so anything larger is corrupt.
+    if (size / 1032u > static_cast<uint32_t>(data.size())) {
+        throw std::runtime_error("compressed data has an impossible size");
+    }
+
+    z_stream strm{};
+    if (inflateInit(&strm) != Z_OK) {
+        throw std::runtime_error("Unable to initialize zlib");
+    }
+    QByteArray result;
+    result.resize(static_cast<int>(size));
+    strm.next_in = asBytes(data.constData() + SIZE_PREFIX);
+    strm.avail_in = static_cast<uInt>(data.size() - SIZE_PREFIX);
+    strm.next_out = asBytes(result.data());
+    strm.avail_out = size;
+
+    int ret = inflate(&strm, Z_FINISH);
+    if (ret == Z_NEED_DICT) {
+        ret = inflateSetDictionary(&strm,
+                                   asBytes(m_bytes.constData()),
+                                   static_cast<uInt>(m_bytes.size()));
+        if (ret == Z_OK) {
+            ret = inflate(&strm, Z_FINISH);
+        }
+    }
+    const uLong total = strm.total_out;
+    inflateEnd(&strm);
+    if (ret != Z_STREAM_END || total != size) {
+        throw std::runtime_error("zlib error: " + std::to_string(ret));
+    }
+    return result;
+#endif
+}
@@ -0,0 +1,46 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+#include <QByteArray>
+
+#include "RuleOf5.h"
+#include "macros.h"
+
+// A zlib preset dictionary: text that every compressed buffer can refer back
+// to, so short buffers full of the same phrases (e.g. room descriptions)
+// compress about as well as one large buffer, while each can still be
+// uncompressed on its own. Safe to share between threads.
+//
+// Without zlib, train() never returns a dictionary.
+class NODISCARD DeflateDictionary final
+{
+public:
+    // zlib only looks back this far.
+    static constexpr const size_t MAX_SIZE = 32 * 1024;
+
+private:
+    QByteArray m_bytes;
+
+public:
+    explicit DeflateDictionary(QByteArray bytes);
+    ~DeflateDictionary();
+    DELETE_CTORS_AND_ASSIGN_OPS(DeflateDictionary);
+
+public:
+    // Picks the lines that repeat most across the samples; returns nullptr if
+    // nothing repeats (or zlib is unavailable).
+    NODISCARD static std::shared_ptr<const DeflateDictionary> train(
+        const std::vector<std::string_view> &samples);
+
+public:
+    NODISCARD const QByteArray &getBytes() const { return m_bytes; }
+    // Like qCompress(), the result starts with the uncompressed size.
+    NODISCARD QByteArray compress(const QByteArray &data) const;
+    // Throws std::runtime_error if the data is corrupt or uses another dictionary.
+    NODISCARD QByteArray uncompress(const QByteArray &data) const;
+};
@@ -0,0 +1,163 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "EventLoopWatchdog.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <QDebug>
+#include <QObject>
+#include <QString>
+#include <QThread>
+#include <QTimer>
+
+#include "EventTrace.h"
+#include "utils.h"
+
+namespace { // anonymous
+
+static constexpr const int BEAT_MS = 100;
+static constexpr const int CHECK_MS = 50;
+static constexpr const int DEFAULT_STALL_MS = 500;
+static constexpr const int64_t NANOS_PER_MS = 1000000;
+
+struct NODISCARD Watched final
+{
+    const char *const name;
+    // Belongs to the watched thread, so it's only read while that is registered.
+    const event_trace::ActiveScope &activeScope;
+    // Negative until the event loop first runs the heartbeat.
+    std::atomic<int64_t> lastBeat{-1};
+    // Set by the watchdog when it reports a stall; the heartbeat reports its end.
+    std::atomic<bool> stalled{false};
+    std::atomic<const char *> stalledIn{nullptr};
+
+    explicit Watched(const char *const n, const event_trace::ActiveScope &scope)
+        : name{n}
+        , activeScope{scope}
+    {}
+};
+
+struct NODISCARD Watchdog final
+{
+    const int64_t thresholdNanos
+        = std::max(2 * BEAT_MS, utils::getEnvInt("MMAPPER_STALL_MS").value_or(DEFAULT_STALL_MS))
+          * NANOS_PER_MS;
+
+    std::mutex mutex;
+    std::condition_variable stopped;
+    std::vector<std::shared_ptr<Watched>> watched;
+    std::thread thread;
+    bool stopping = false;
+};
+
+NODISCARD Watchdog &getWatchdog()
+{
+    // Leaked, so threads that finish during static destruction can still unregister.
+    static Watchdog *const watchdog = new Watchdog;
+    return *watchdog;
+}
+
+NODISCARD QString describeScope(const char *const scope)
+{
+    return (scope == nullptr) ? QString("outside any traced scope")
+                              : QString("in %1").arg(QString::fromLatin1(scope));
+}
+
+void run(Watchdog &watchdog)
+{
+    std::unique_lock<std::mutex> lock{watchdog.mutex};
+    while (!watchdog.stopped.wait_for(lock, std::chrono::milliseconds{CHECK_MS}, [&watchdog]() {
+        return watchdog.stopping;
+    })) {
+        const int64_t now = event_trace::getNanos();
+        for (const auto &watched : watchdog.watched) {
+            const int64_t lastBeat = watched->lastBeat.load(std::memory_order_relaxed);
+            if (lastBeat < 0 || now - lastBeat < watchdog.thresholdNanos
+                || watched->stalled.load(std::memory_order_relaxed)) {
+                continue;
+            }
+            const char *const scope = watched->activeScope.load(std::memory_order_relaxed);
+            watched->stalledIn.store(scope, std::memory_order_relaxed);
+            watched->stalled.store(true, std::memory_order_release);
+            qWarning().noquote() << QString("[EventLoopWatchdog] The %1 event loop has not "
+                                            "responded for %2 ms, %3.")
+                                        .arg(QString::fromLatin1(watched->name))
+                                        .arg((now - lastBeat) / NANOS_PER_MS)
+                                        .arg(describeScope(scope));
+        }
+    }
+}
+
+void beat(Watched &watched)
+{
+    const int64_t now = event_trace::getNanos();
+    const int64_t lastBeat = watched.lastBeat.exchange(now, std::memory_order_relaxed);
+    if (!watched.stalled.exchange(false, std::memory_order_acquire))
+        return;
+
+    qWarning().noquote()
+        << QString("[EventLoopWatchdog] The %1 event loop was stalled for %2 ms, %3.")
+               .arg(QString::fromLatin1(watched.name))
+               .arg((now - lastBeat) / NANOS_PER_MS)
+               .arg(describeScope(watched.stalledIn.load(std::memory_order_relaxed)));
+    if (event_trace::isEnabled())
+        event_trace::record("EventLoopWatchdog::stall", lastBeat);
+}
+
+} // namespace
+
+void event_loop_watchdog::start()
+{
+    Watchdog &watchdog = getWatchdog();
+    std::lock_guard<std::mutex> lock{watchdog.mutex};
+    if (watchdog.thread.joinable())
+        return;
+    watchdog.stopping = false;
+    watchdog.thread = std::thread{[&watchdog]() { run(watchdog); }};
+}
+
+void event_loop_watchdog::stop()
+{
+    Watchdog &watchdog = getWatchdog();
+    {
+        std::lock_guard<std::mutex> lock{watchdog.mutex};
+        if (!watchdog.thread.joinable())
+            return;
+        watchdog.stopping = true;
+    }
+    watchdog.stopped.notify_all();
+    watchdog.thread.join();
+}
+
+void event_loop_watchdog::watchCurrentThread(const char *const name)
+{
+    Watchdog &watchdog = getWatchdog();
+    auto watched = std::make_shared<Watched>(name, event_trace::getActiveScope());
+    {
+        std::lock_guard<std::mutex> lock{watchdog.mutex};
+        watchdog.watched.emplace_back(watched);
+    }
+
+    QThread *const thread = QThread::currentThread();
+    auto *const timer = new QTimer;
+    timer->setObjectName("EventLoopWatchdog");
+    timer->setInterval(BEAT_MS);
+    QObject::connect(timer, &QTimer::timeout, timer, [watched]() { beat(*watched); });
+    // Without a context object, this runs on the finishing thread, while its
+    // active scope still exists.
+    QObject::connect(thread, &QThread::finished, [&watchdog, watched]() {
+        std::lock_guard<std::mutex> lock{watchdog.mutex};
+        auto &all = watchdog.watched;
+        all.erase(std::remove(all.begin(), all.end(), watched), all.end());
+    });
+    QObject::connect(thread, &QThread::finished, timer, &QObject::deleteLater);
+    timer->start();
+}
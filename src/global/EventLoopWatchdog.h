@@ -0,0 +1,26 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "macros.h"
+
+/**
+ * Always-on detection of event loops that stop responding.
+ *
+ * Each watched thread runs a heartbeat timer; a separate thread notices when
+ * a heartbeat is overdue, and logs the stall along with the innermost
+ * event_trace::Scope the stalled thread is in. Once the loop responds again,
+ * the length of the stall is logged too (and traced, if tracing is enabled).
+ *
+ * Stalls are reported after MMAPPER_STALL_MS milliseconds (500 by default).
+ */
+namespace event_loop_watchdog {
+// Starts the watchdog's own thread; the event loops must be watched separately.
+void start();
+// Joins the watchdog's thread; call before the watched threads go away.
+void stop();
+
+// Watches the event loop of the calling thread until it finishes;
+// the name must be a string literal.
+void watchCurrentThread(const char *name);
+} // namespace event_loop_watchdog
@@ -0,0 +1,248 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "EventTrace.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "utils.h"
+
+namespace { // anonymous
+
+using Clock = std::chrono::steady_clock;
+
+// Scopes kept per thread; a thread that records more keeps the most recent ones.
+static constexpr const uint64_t CAPACITY = 1u << 14;
+// Buffers of threads that exited are kept until there are more than this.
+static constexpr const size_t MAX_RETIRED = 8;
+
+// The fields are only atomic so they can be copied while the owner overwrites them.
+struct NODISCARD Event final
+{
+    std::atomic<const char *> name{nullptr};
+    std::atomic<int64_t> begin{0};
+    std::atomic<int64_t> end{0};
+};
+
+struct NODISCARD Buffer final
+{
+    const uint32_t tid;
+    std::array<Event, CAPACITY> events{};
+    // Total ever recorded; only written by the owner.
+    std::atomic<uint64_t> next{0};
+    std::atomic<bool> retired{false};
+
+    explicit Buffer(const uint32_t t)
+        : tid{t}
+    {}
+};
+
+struct NODISCARD Tracer final
+{
+    std::atomic<bool> enabled{utils::getEnvBool("MMAPPER_EVENT_TRACE").value_or(false)};
+    // Scopes that began before this are ignored.
+    std::atomic<int64_t> resetNanos{0};
+
+    std::mutex mutex;
+    std::vector<std::shared_ptr<Buffer>> buffers;
+    uint32_t nextTid = 1;
+};
+
+NODISCARD Tracer &getTracer()
+{
+    // Leaked, so threads that exit during static destruction can still retire their buffer.
+    static Tracer *const tracer = new Tracer;
+    return *tracer;
+}
+
+// Requires the lock.
+void trimRetired(Tracer &tracer)
+{
+    auto &buffers = tracer.buffers;
+    const auto retired = std::count_if(buffers.begin(), buffers.end(), [](const auto &b) {
+        return b->retired.load(std::memory_order_relaxed);
+    });
+    auto excess = static_cast<size_t>(retired) > MAX_RETIRED
+                      ? static_cast<size_t>(retired) - MAX_RETIRED
+                      : size_t{0};
+    // The oldest come first.
+    buffers.erase(std::remove_if(buffers.begin(),
+                                 buffers.end(),
+                                 [&excess](const auto &b) {
+                                     if (excess == 0 || !b->retired.load(std::memory_order_relaxed))
+                                         return false;
+                                     --excess;
+                                     return true;
+                                 }),
+                  buffers.end());
+}
+
+struct NODISCARD BufferOwner final
+{
+    std::shared_ptr<Buffer> buffer;
+
+    BufferOwner()
+    {
+        Tracer &tracer = getTracer();
+        std::lock_guard<std::mutex> lock{tracer.mutex};
+        buffer = std::make_shared<Buffer>(tracer.nextTid++);
+        tracer.buffers.emplace_back(buffer);
+    }
+
+    ~BufferOwner()
+    {
+        Tracer &tracer = getTracer();
+        std::lock_guard<std::mutex> lock{tracer.mutex};
+        buffer->retired.store(true, std::memory_order_relaxed);
+        trimRetired(tracer);
+    }
+
+    DELETE_CTORS_AND_ASSIGN_OPS(BufferOwner);
+};
+
+NODISCARD Buffer &getBuffer()
+{
+    // Only created once the thread records something.
+    static thread_local BufferOwner owner;
+    return *owner.buffer;
+}
+
+struct NODISCARD Copied final
+{
+    const char *name = nullptr;
+    int64_t begin = 0;
+    int64_t end = 0;
+};
+
+NODISCARD std::vector<Copied> copyEvents(const Buffer &buffer, const int64_t since)
+{
+    const uint64_t end = buffer.next.load(std::memory_order_acquire);
+    const uint64_t begin = end > CAPACITY ? end - CAPACITY : 0;
+    std::vector<std::pair<uint64_t, Copied>> copied;
+    copied.reserve(static_cast<size_t>(end - begin));
+    for (uint64_t i = begin; i < end; ++i) {
+        const Event &e = buffer.events[i % CAPACITY];
+        copied.emplace_back(i,
+                            Copied{e.name.load(std::memory_order_relaxed),
+                                   e.begin.load(std::memory_order_relaxed),
+                                   e.end.load(std::memory_order_relaxed)});
+    }
+
+    // The owner may have overwritten the oldest ones while they were copied,
+    // and may be in the middle of overwriting the next one.
+    const uint64_t after = buffer.next.load(std::memory_order_acquire);
+    const uint64_t firstIntact = after + 1 > CAPACITY ? after + 1 - CAPACITY : 0;
+    std::vector<Copied> result;
+    result.reserve(copied.size());
+    for (const auto &[index, event] : copied) {
+        if (index >= firstIntact && event.name != nullptr && event.begin >= since)
+            result.emplace_back(event);
+    }
+    return result;
+}
+
+void writeString(std::ostream &os, const char *s)
+{
+    os << '"';
+    for (; *s != '\0'; ++s) {
+        const char c = *s;
+        if (c == '"' || c == '\\')
+            os << '\\';
+        os << c;
+    }
+    os << '"';
+}
+
+NODISCARD double toMicros(const int64_t nanos)
+{
+    return static_cast<double>(nanos) / 1000.0;
+}
+
+} // namespace
+
+bool event_trace::isEnabled()
+{
+    return getTracer().enabled.load(std::memory_order_relaxed);
+}
+
+void event_trace::setEnabled(const bool enabled)
+{
+    getTracer().enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void event_trace::reset()
+{
+    Tracer &tracer = getTracer();
+    tracer.resetNanos.store(getNanos(), std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock{tracer.mutex};
+    auto &buffers = tracer.buffers;
+    buffers.erase(std::remove_if(buffers.begin(),
+                                 buffers.end(),
+                                 [](const auto &b) {
+                                     return b->retired.load(std::memory_order_relaxed);
+                                 }),
+                  buffers.end());
+}
+
+int64_t event_trace::getNanos()
+{
+    static const Clock::time_point epoch = Clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - epoch).count();
+}
+
+event_trace::ActiveScope &event_trace::getActiveScope()
+{
+    static thread_local ActiveScope active{nullptr};
+    return active;
+}
+
+void event_trace::record(const char *const name, const int64_t beginNanos)
+{
+    Buffer &buffer = getBuffer();
+    const uint64_t i = buffer.next.load(std::memory_order_relaxed);
+    Event &e = buffer.events[i % CAPACITY];
+    e.name.store(name, std::memory_order_relaxed);
+    e.begin.store(beginNanos, std::memory_order_relaxed);
+    e.end.store(getNanos(), std::memory_order_relaxed);
+    buffer.next.store(i + 1, std::memory_order_release);
+}
+
+bool event_trace::writeJson(const std::string &fileName)
+{
+    std::vector<std::shared_ptr<Buffer>> buffers;
+    {
+        Tracer &tracer = getTracer();
+        std::lock_guard<std::mutex> lock{tracer.mutex};
+        buffers = tracer.buffers;
+    }
+    const int64_t since = getTracer().resetNanos.load(std::memory_order_relaxed);
+
+    std::ofstream os{fileName, std::ios::out | std::ios::trunc};
+    if (!os.is_open())
+        return false;
+
+    os << std::fixed << std::setprecision(3);
+    os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (const auto &buffer : buffers) {
+        for (const Copied &e : copyEvents(*buffer, since)) {
+            os << (first ? "\n" : ",\n") << "{\"name\":";
+            writeString(os, e.name);
+            os << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->tid << ",\"ts\":"
+               << toMicros(e.begin) << ",\"dur\":" << toMicros(e.end - e.begin) << "}";
+            first = false;
+        }
+    }
+    os << "\n]}\n";
+    os.close();
+    return !os.fail();
+}
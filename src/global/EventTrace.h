@@ -0,0 +1,63 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "RuleOf5.h"
+#include "macros.h"
+
+/**
+ * Optional tracing of scopes across the pipeline, written out in the Chrome
+ * trace format (load it in chrome://tracing or ui.perfetto.dev).
+ *
+ * Each thread records into its own ring of the most recent scopes, so
+ * recording never takes a lock; writeJson() copies the rings while they're
+ * still being written to, and drops anything that was overwritten meanwhile.
+ *
+ * Tracing is off unless enabled with setEnabled() or by setting
+ * MMAPPER_EVENT_TRACE=1. Either way, each thread's innermost Scope is
+ * tracked (see ActiveScope), so that stalls can be attributed to it; when
+ * tracing is off, that's all a Scope costs besides one atomic load.
+ */
+namespace event_trace {
+NODISCARD bool isEnabled();
+void setEnabled(bool enabled);
+
+// Forgets everything recorded so far.
+void reset();
+NODISCARD bool writeJson(const std::string &fileName);
+
+NODISCARD int64_t getNanos();
+// The name must be a string literal, since only the pointer is kept.
+void record(const char *name, int64_t beginNanos);
+
+// The name of the calling thread's innermost Scope, or nullptr; other threads
+// may read it for as long as this thread runs.
+using ActiveScope = std::atomic<const char *>;
+NODISCARD ActiveScope &getActiveScope();
+
+class NODISCARD Scope final
+{
+private:
+    const char *const m_name;
+    const char *const m_outer;
+    const int64_t m_begin;
+
+public:
+    explicit Scope(const char *const name)
+        : m_name{name}
+        , m_outer{getActiveScope().exchange(name, std::memory_order_relaxed)}
+        , m_begin{isEnabled() ? getNanos() : -1}
+    {}
+    ~Scope()
+    {
+        getActiveScope().store(m_outer, std::memory_order_relaxed);
+        if (m_begin >= 0)
+            record(m_name, m_begin);
+    }
+    DELETE_CTORS_AND_ASSIGN_OPS(Scope);
+};
+} // namespace event_trace
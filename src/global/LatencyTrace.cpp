@@ -0,0 +1,195 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "LatencyTrace.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <mutex>
+#include <sstream>
+#include <vector>
+#include <QDebug>
+
+#include "utils.h"
+
+namespace { // anonymous
+
+using Clock = std::chrono::steady_clock;
+
+// Per stage, so the percentiles describe the recent past.
+static constexpr const size_t MAX_SAMPLES = 4096;
+// A summary is logged after this many traced reads.
+static constexpr const uint64_t LOG_INTERVAL = 1000;
+
+NODISCARD const char *getStageName(const LatencyStageEnum stage)
+{
+#define X_CASE(UPPER_CASE, friendly) \
+    case LatencyStageEnum::UPPER_CASE: \
+        return friendly;
+    switch (stage) {
+        X_FOREACH_LATENCY_STAGE(X_CASE)
+    }
+#undef X_CASE
+    return "unknown";
+}
+
+struct NODISCARD Samples final
+{
+    // Microseconds; a ring buffer once it's full.
+    std::vector<uint32_t> values;
+    size_t next = 0;
+    uint64_t total = 0;
+
+    void add(const uint32_t usec)
+    {
+        ++total;
+        if (values.size() < MAX_SAMPLES) {
+            values.emplace_back(usec);
+            return;
+        }
+        values[next] = usec;
+        next = (next + 1) % MAX_SAMPLES;
+    }
+};
+
+struct NODISCARD Tracer final
+{
+    std::atomic<bool> enabled{utils::getEnvBool("MMAPPER_LATENCY_TRACE").value_or(false)};
+
+    std::mutex mutex;
+    Clock::time_point chunkStart;
+    bool inChunk = false;
+    // Stages that already saw the current chunk.
+    uint32_t marked = 0;
+    uint64_t chunks = 0;
+    std::array<Samples, NUM_LATENCY_STAGES> samples{};
+};
+
+NODISCARD Tracer &getTracer()
+{
+    static Tracer tracer;
+    return tracer;
+}
+
+NODISCARD uint32_t microsSince(const Clock::time_point start)
+{
+    const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now()
+                                                                              - start);
+    return static_cast<uint32_t>(std::clamp<int64_t>(elapsed.count(), 0, INT32_MAX));
+}
+
+// Requires the lock.
+void record(Tracer &tracer, const LatencyStageEnum stage)
+{
+    const auto bit = 1u << static_cast<uint32_t>(stage);
+    if (!tracer.inChunk || (tracer.marked & bit) != 0)
+        return;
+    tracer.marked |= bit;
+    tracer.samples[static_cast<size_t>(stage)].add(microsSince(tracer.chunkStart));
+}
+
+NODISCARD uint32_t percentile(std::vector<uint32_t> &values, const double p)
+{
+    assert(!values.empty());
+    const auto n = static_cast<size_t>(p * static_cast<double>(values.size() - 1u) + 0.5);
+    std::nth_element(values.begin(), values.begin() + static_cast<ptrdiff_t>(n), values.end());
+    return values[n];
+}
+
+} // namespace
+
+bool latency_trace::isEnabled()
+{
+    return getTracer().enabled.load(std::memory_order_relaxed);
+}
+
+void latency_trace::setEnabled(const bool enabled)
+{
+    Tracer &tracer = getTracer();
+    std::lock_guard<std::mutex> lock{tracer.mutex};
+    tracer.enabled.store(enabled, std::memory_order_relaxed);
+    tracer.inChunk = false;
+}
+
+void latency_trace::beginChunk()
+{
+    if (!isEnabled())
+        return;
+    Tracer &tracer = getTracer();
+    std::lock_guard<std::mutex> lock{tracer.mutex};
+    tracer.chunkStart = Clock::now();
+    tracer.inChunk = true;
+    tracer.marked = 0;
+}
+
+void latency_trace::mark(const LatencyStageEnum stage)
+{
+    if (!isEnabled())
+        return;
+    Tracer &tracer = getTracer();
+    std::lock_guard<std::mutex> lock{tracer.mutex};
+    record(tracer, stage);
+}
+
+void latency_trace::endChunk()
+{
+    if (!isEnabled())
+        return;
+    bool wantLog = false;
+    {
+        Tracer &tracer = getTracer();
+        std::lock_guard<std::mutex> lock{tracer.mutex};
+        record(tracer, LatencyStageEnum::DONE);
+        wantLog = tracer.inChunk && (++tracer.chunks % LOG_INTERVAL) == 0;
+        // Anything that happens after this isn't caused by this read.
+        tracer.inChunk = false;
+    }
+    if (wantLog) {
+        qDebug().noquote() << QString::fromStdString(getReport());
+    }
+}
+
+std::string latency_trace::getReport()
+{
+    std::array<Samples, NUM_LATENCY_STAGES> samples;
+    uint64_t chunks = 0;
+    bool enabled = false;
+    {
+        Tracer &tracer = getTracer();
+        std::lock_guard<std::mutex> lock{tracer.mutex};
+        samples = tracer.samples;
+        chunks = tracer.chunks;
+        enabled = tracer.enabled.load(std::memory_order_relaxed);
+    }
+
+    std::ostringstream os;
+    os << "Latency from MUD socket (" << (enabled ? "enabled" : "disabled") << ", " << chunks
+       << " reads):\n";
+    for (size_t i = 0; i < NUM_LATENCY_STAGES; ++i) {
+        const auto stage = static_cast<LatencyStageEnum>(i);
+        Samples &s = samples[i];
+        os << "  " << getStageName(stage) << ": ";
+        if (s.values.empty()) {
+            os << "no samples\n";
+            continue;
+        }
+        const auto p50 = percentile(s.values, 0.50);
+        const auto p95 = percentile(s.values, 0.95);
+        const auto p99 = percentile(s.values, 0.99);
+        os << "p50 " << p50 << " us, p95 " << p95 << " us, p99 " << p99 << " us (" << s.total
+           << " samples)\n";
+    }
+    return os.str();
+}
+
+void latency_trace::reset()
+{
+    Tracer &tracer = getTracer();
+    std::lock_guard<std::mutex> lock{tracer.mutex};
+    tracer.samples = {};
+    tracer.chunks = 0;
+    tracer.inChunk = false;
+}
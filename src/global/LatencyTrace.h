@@ -0,0 +1,52 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "macros.h"
+
+// X(UPPER_CASE, "friendly name")
+#define X_FOREACH_LATENCY_STAGE(X) \
+    X(TELNET, "telnet") \
+    X(FILTER, "line filter") \
+    X(XML_PARSER, "xml parser") \
+    X(PATH_MACHINE, "path machine") \
+    X(USER_SEND, "sent to user") \
+    X(DONE, "done")
+
+#define X_DECL_LATENCY_STAGE(UPPER_CASE, friendly) UPPER_CASE,
+enum class NODISCARD LatencyStageEnum : uint8_t { X_FOREACH_LATENCY_STAGE(X_DECL_LATENCY_STAGE) };
+#undef X_DECL_LATENCY_STAGE
+
+#define X_COUNT_LATENCY_STAGE(UPPER_CASE, friendly) +1
+static constexpr const size_t NUM_LATENCY_STAGES = (
+    X_FOREACH_LATENCY_STAGE(X_COUNT_LATENCY_STAGE));
+#undef X_COUNT_LATENCY_STAGE
+static_assert(NUM_LATENCY_STAGES == 6);
+
+/**
+ * Optional tracing of how long it takes a read from the MUD socket to reach
+ * each stage of the proxy, and finally the user's socket.
+ *
+ * The socket calls beginChunk() before it passes a read on, and endChunk()
+ * once every stage is done with it; in between, each stage calls mark() when
+ * the read first reaches it. Marks outside of a chunk are ignored.
+ *
+ * Tracing is off unless enabled with setEnabled() or by setting
+ * MMAPPER_LATENCY_TRACE=1; when it's off, mark() is a single atomic load.
+ */
+namespace latency_trace {
+NODISCARD bool isEnabled();
+void setEnabled(bool enabled);
+
+void beginChunk();
+void mark(LatencyStageEnum stage);
+void endChunk();
+
+// Percentiles of the recent samples of each stage.
+NODISCARD std::string getReport();
+void reset();
+} // namespace latency_trace
@@ -0,0 +1,107 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "MemoryReport.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include "StringPool.h"
+
+namespace { // anonymous
+
+struct NODISCARD Registry final
+{
+    std::mutex mutex;
+    std::map<uint64_t, memory_report::Provider> providers;
+    uint64_t nextId = 1;
+};
+
+NODISCARD Registry &getRegistry()
+{
+    static Registry registry;
+    return registry;
+}
+
+struct NODISCARD Line final
+{
+    std::string name;
+    MemoryUsage usage;
+};
+
+void formatBytes(std::ostream &os, const size_t bytes)
+{
+    static constexpr const char *const units[] = {"B", "KiB", "MiB", "GiB"};
+    auto value = static_cast<double>(bytes);
+    size_t unit = 0;
+    while (value >= 1024.0 && unit + 1 < std::size(units)) {
+        value /= 1024.0;
+        ++unit;
+    }
+    os << std::fixed << std::setprecision(unit == 0 ? 0 : 1) << std::setw(8) << value << " "
+       << std::left << std::setw(3) << units[unit] << std::right;
+}
+
+} // namespace
+
+memory_report::Registration::Registration(Provider provider)
+{
+    Registry &registry = getRegistry();
+    std::lock_guard<std::mutex> lock{registry.mutex};
+    m_id = registry.nextId++;
+    registry.providers.emplace(m_id, std::move(provider));
+}
+
+memory_report::Registration::~Registration()
+{
+    if (m_id == 0)
+        return;
+    Registry &registry = getRegistry();
+    std::lock_guard<std::mutex> lock{registry.mutex};
+    registry.providers.erase(m_id);
+}
+
+std::string memory_report::getReport()
+{
+    std::vector<Line> lines;
+    const AddFn add = [&lines](const char *const name, const MemoryUsage &usage) {
+        lines.emplace_back(Line{name, usage});
+    };
+
+    add("strings: interned", StringPool::getGlobal().getMemoryUsage());
+    {
+        Registry &registry = getRegistry();
+        std::lock_guard<std::mutex> lock{registry.mutex};
+        for (const auto &[id, provider] : registry.providers)
+            provider(add);
+    }
+
+    std::stable_sort(lines.begin(), lines.end(), [](const Line &a, const Line &b) {
+        return a.usage.bytes > b.usage.bytes;
+    });
+
+    size_t total = 0;
+    size_t width = 0;
+    for (const Line &line : lines) {
+        total += line.usage.bytes;
+        width = std::max(width, line.name.size());
+    }
+
+    std::ostringstream os;
+    os << "Approximate memory use:\n";
+    for (const Line &line : lines) {
+        os << "  " << std::left << std::setw(static_cast<int>(width)) << line.name << std::right
+           << " ";
+        formatBytes(os, line.usage.bytes);
+        os << " (" << line.usage.count << ")\n";
+    }
+    os << "  " << std::left << std::setw(static_cast<int>(width)) << "total" << std::right << " ";
+    formatBytes(os, total);
+    os << "\n";
+    return os.str();
+}
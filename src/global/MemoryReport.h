@@ -0,0 +1,48 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "RuleOf5.h"
+#include "macros.h"
+
+struct NODISCARD MemoryUsage final
+{
+    size_t bytes = 0;
+    size_t count = 0;
+};
+
+/**
+ * Approximate memory use per subsystem, shown by the "mem" command and in
+ * the About dialog.
+ *
+ * Subsystems keep a Registration for as long as they exist; its provider
+ * adds one line per thing it owns. The numbers are estimates from sizes and
+ * capacities, not allocator statistics, so they only point at the biggest
+ * consumers.
+ *
+ * Providers are called on the thread that asks for the report (the main
+ * thread), with the registry locked; they mustn't register or unregister.
+ */
+namespace memory_report {
+using AddFn = std::function<void(const char *name, const MemoryUsage &usage)>;
+using Provider = std::function<void(const AddFn &add)>;
+
+class NODISCARD Registration final
+{
+private:
+    uint64_t m_id = 0;
+
+public:
+    Registration() = default;
+    explicit Registration(Provider provider);
+    ~Registration();
+    DELETE_CTORS_AND_ASSIGN_OPS(Registration);
+};
+
+NODISCARD std::string getReport();
+} // namespace memory_report
@@ -3,24 +3,28 @@
 
 #include "NamedColors.h"
 
+#include <algorithm>
 #include <cassert>
-#include <map>
-#include <optional>
+#include <deque>
+#include <stdexcept>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 using Index = size_t;
-using Map = std::map<std::string, Index>;
+// The keys point into GlobalData::names, so lookups don't have to allocate a std::string.
+using Map = std::unordered_map<std::string_view, Index>;
 
 using ColorVector = std::vector<Color>;
-using ReverseLookup = std::vector<std::optional<Map::iterator>>;
+// A deque, so the names stay put as more are added.
+using NameDeque = std::deque<std::string>;
 
 struct NODISCARD GlobalData final
 {
 private:
     ColorVector colors;
+    NameDeque names;
     Map map;
-    ReverseLookup reverseLookup;
 
 public:
     NODISCARD Color &getColor(const Index index)
@@ -35,9 +39,7 @@ struct NODISCARD GlobalData final
         if (index == XNamedColor::UNINITIALIZED) {
             throw std::invalid_argument("index");
         }
-        if (auto opt = reverseLookup.at(index - 1))
-            return opt.value()->first;
-        return {};
+        return names.at(index - 1);
     }
 
 private:
@@ -51,11 +53,8 @@ struct NODISCARD GlobalData final
     // NOTE: This allocates memory.
     NODISCARD std::vector<std::string> getAllNames() const
     {
-        std::vector<std::string> result;
-        result.reserve(map.size());
-        for (const auto &kv : map) {
-            result.emplace_back(kv.first);
-        }
+        std::vector<std::string> result{names.begin(), names.end()};
+        std::sort(result.begin(), result.end());
         return result;
     }
 };
@@ -66,31 +65,29 @@ Index GlobalData::verifyIndex(const Index index) const
         throw std::invalid_argument("index");
     }
 
-    const auto &rev = reverseLookup.at(index - 1);
-    assert(rev.has_value() && rev.value()->second == index);
+    assert(map.at(names.at(index - 1)) == index);
     return index;
 }
 
 Index GlobalData::allocNewIndex(std::string_view name)
 {
-    assert(colors.size() == reverseLookup.size());
+    assert(colors.size() == names.size());
     const Index index = colors.size() + 1;
     colors.emplace_back();
+    const std::string &stored = names.emplace_back(name);
 
-    const auto emplace_result = map.emplace(name, index);
+    const auto emplace_result = map.emplace(stored, index);
     if (!emplace_result.second) {
         assert(false);
-        reverseLookup.emplace_back();
         return XNamedColor::UNINITIALIZED;
     }
 
-    reverseLookup.emplace_back(emplace_result.first);
     return verifyIndex(index);
 }
 
 Index GlobalData::lookupOrCreateIndex(std::string_view name)
 {
-    const auto it = map.find(std::string(name));
+    const auto it = map.find(name);
     if (it != map.end()) {
         return verifyIndex(it->second);
     }
@@ -120,14 +117,19 @@ std::string XNamedColor::getName() const
     return getGlobalData().getName(getIndex());
 }
 
-Color XNamedColor::getColor() const
+Color XNamedColor::lookupColor() const
 {
     if (!isInitialized()) {
         assert(false);
         return {};
     }
 
-    return getGlobalData().getColor(getIndex());
+    // The generation is read first, so a color that changes meanwhile is looked up again.
+    const uint32_t generation = g_generation.load(std::memory_order_acquire);
+    const Color color = getGlobalData().getColor(getIndex());
+    m_cache.store((static_cast<uint64_t>(generation) << 32u) | color.getRGBA(),
+                  std::memory_order_relaxed);
+    return color;
 }
 
 void XNamedColor::setColor(const Color new_color)
@@ -137,7 +139,14 @@ void XNamedColor::setColor(const Color new_color)
         return;
     }
 
-    getGlobalData().getColor(getIndex()) = new_color;
+    Color &color = getGlobalData().getColor(getIndex());
+    if (color == new_color)
+        return;
+    color = new_color;
+    // Zero is never current, so it's skipped when the counter wraps.
+    if (g_generation.fetch_add(1u, std::memory_order_release) + 1u == 0u) {
+        g_generation.fetch_add(1u, std::memory_order_release);
+    }
 }
 
 std::vector<std::string> XNamedColor::getAllNames()
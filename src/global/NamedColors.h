@@ -2,6 +2,9 @@
 // SPDX-License-Identifier: GPL-2.0-or-later
 // Copyright (C) 2019 The MMapper Authors
 
+#include <atomic>
+#include <cstdint>
+#include <string>
 #include <string_view>
 #include <vector>
 
@@ -15,8 +18,15 @@ class NODISCARD XNamedColor final
 public:
     static constexpr size_t UNINITIALIZED = 0;
 
+private:
+    // Bumped whenever any named color changes, which invalidates every cached color.
+    static inline std::atomic<uint32_t> g_generation{1};
+
 private:
     const size_t m_index = UNINITIALIZED;
+    // The generation in the upper half and the color in the lower half;
+    // generation 0 is never current.
+    mutable std::atomic<uint64_t> m_cache{0};
 
 public:
     XNamedColor() = default;
@@ -31,7 +41,13 @@ class NODISCARD XNamedColor final
     ~XNamedColor();
 
 public:
-    DEFAULT_CTORS(XNamedColor);
+    XNamedColor(const XNamedColor &other)
+        : m_index{other.m_index}
+        , m_cache{other.m_cache.load(std::memory_order_relaxed)}
+    {}
+    XNamedColor(XNamedColor &&other)
+        : XNamedColor(static_cast<const XNamedColor &>(other))
+    {}
     DELETE_ASSIGN_OPS(XNamedColor);
 
 public:
@@ -40,9 +56,20 @@ class NODISCARD XNamedColor final
 
 public:
     NODISCARD std::string getName() const;
-    NODISCARD Color getColor() const;
+    // Usually just a load of the cached color.
+    NODISCARD Color getColor() const
+    {
+        const uint64_t cache = m_cache.load(std::memory_order_relaxed);
+        if (static_cast<uint32_t>(cache >> 32u) == g_generation.load(std::memory_order_acquire)) {
+            return Color::fromRGBA(static_cast<uint32_t>(cache));
+        }
+        return lookupColor();
+    }
     void setColor(Color c);
 
+private:
+    NODISCARD Color lookupColor() const;
+
 public:
     NODISCARD explicit operator Color() const { return getColor(); }
     XNamedColor &operator=(Color c)
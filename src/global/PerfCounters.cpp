@@ -0,0 +1,279 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "PerfCounters.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+namespace { // anonymous
+
+// Values at or above 2^MAX_EXPONENT microseconds (over an hour) share the last bucket.
+static constexpr const uint32_t SUB_BITS = 3;
+static constexpr const uint32_t SUB_BUCKETS = 1u << SUB_BITS;
+static constexpr const uint32_t MAX_EXPONENT = 32;
+static constexpr const size_t NUM_BUCKETS = SUB_BUCKETS * (MAX_EXPONENT - SUB_BITS + 1);
+
+NODISCARD size_t getBucket(const uint64_t value)
+{
+    if (value < SUB_BUCKETS)
+        return static_cast<size_t>(value);
+    if (value >> MAX_EXPONENT != 0)
+        return NUM_BUCKETS - 1;
+    uint32_t exponent = SUB_BITS;
+    while (value >> (exponent + 1) != 0)
+        ++exponent;
+    const auto sub = static_cast<size_t>((value >> (exponent - SUB_BITS)) & (SUB_BUCKETS - 1));
+    return SUB_BUCKETS * (exponent - SUB_BITS + 1) + sub;
+}
+
+// The largest value that lands in the bucket.
+NODISCARD uint64_t getBucketLimit(const size_t bucket)
+{
+    if (bucket < SUB_BUCKETS)
+        return bucket;
+    const auto exponent = static_cast<uint32_t>(bucket / SUB_BUCKETS - 1 + SUB_BITS);
+    const uint64_t sub = bucket % SUB_BUCKETS;
+    const uint64_t width = uint64_t{1} << (exponent - SUB_BITS);
+    return ((SUB_BUCKETS + sub) << (exponent - SUB_BITS)) + width - 1;
+}
+
+template<typename Enum>
+NODISCARD size_t toIndex(const Enum e)
+{
+    return static_cast<size_t>(e);
+}
+
+struct NODISCARD Histogram final
+{
+    std::array<uint64_t, NUM_BUCKETS> buckets{};
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+};
+
+struct NODISCARD Totals final
+{
+    std::array<uint64_t, NUM_PERF_COUNTERS> counters{};
+    std::array<Histogram, NUM_PERF_HISTOGRAMS> histograms{};
+};
+
+// Only written by its own thread; the relaxed atomics only make it safe to read
+// (and reset) from the others.
+struct NODISCARD Shard final
+{
+    struct NODISCARD AtomicHistogram final
+    {
+        std::array<std::atomic<uint64_t>, NUM_BUCKETS> buckets{};
+        std::atomic<uint64_t> sum{0};
+        std::atomic<uint64_t> max{0};
+    };
+
+    std::array<std::atomic<uint64_t>, NUM_PERF_COUNTERS> counters{};
+    std::array<AtomicHistogram, NUM_PERF_HISTOGRAMS> histograms{};
+
+    void addTo(Totals &totals) const
+    {
+        for (size_t i = 0; i < NUM_PERF_COUNTERS; ++i)
+            totals.counters[i] += counters[i].load(std::memory_order_relaxed);
+        for (size_t i = 0; i < NUM_PERF_HISTOGRAMS; ++i) {
+            const AtomicHistogram &from = histograms[i];
+            Histogram &to = totals.histograms[i];
+            for (size_t b = 0; b < NUM_BUCKETS; ++b) {
+                const uint64_t n = from.buckets[b].load(std::memory_order_relaxed);
+                to.buckets[b] += n;
+                to.count += n;
+            }
+            to.sum += from.sum.load(std::memory_order_relaxed);
+            to.max = std::max(to.max, from.max.load(std::memory_order_relaxed));
+        }
+    }
+
+    void clear()
+    {
+        for (auto &c : counters)
+            c.store(0, std::memory_order_relaxed);
+        for (AtomicHistogram &h : histograms) {
+            for (auto &b : h.buckets)
+                b.store(0, std::memory_order_relaxed);
+            h.sum.store(0, std::memory_order_relaxed);
+            h.max.store(0, std::memory_order_relaxed);
+        }
+    }
+};
+
+struct NODISCARD Registry final
+{
+    std::mutex mutex;
+    std::vector<Shard *> shards;
+    // What the threads that already exited had counted.
+    Totals retired;
+    std::array<std::atomic<int64_t>, NUM_PERF_GAUGES> gauges{};
+};
+
+NODISCARD Registry &getRegistry()
+{
+    // Leaked, so threads that exit during static destruction can still retire their shard.
+    static Registry *const registry = new Registry;
+    return *registry;
+}
+
+struct NODISCARD ShardOwner final
+{
+    Shard shard;
+
+    ShardOwner()
+    {
+        Registry &registry = getRegistry();
+        std::lock_guard<std::mutex> lock{registry.mutex};
+        registry.shards.emplace_back(&shard);
+    }
+
+    ~ShardOwner()
+    {
+        Registry &registry = getRegistry();
+        std::lock_guard<std::mutex> lock{registry.mutex};
+        shard.addTo(registry.retired);
+        auto &shards = registry.shards;
+        shards.erase(std::remove(shards.begin(), shards.end(), &shard), shards.end());
+    }
+
+    DELETE_CTORS_AND_ASSIGN_OPS(ShardOwner);
+};
+
+NODISCARD Shard &getShard()
+{
+    static thread_local ShardOwner owner;
+    return owner.shard;
+}
+
+NODISCARD const char *getName(const PerfCounterEnum counter)
+{
+#define X_CASE(UPPER_CASE, friendly) \
+    case PerfCounterEnum::UPPER_CASE: \
+        return friendly;
+    switch (counter) {
+        X_FOREACH_PERF_COUNTER(X_CASE)
+    }
+#undef X_CASE
+    return "unknown";
+}
+
+NODISCARD const char *getName(const PerfGaugeEnum gauge)
+{
+#define X_CASE(UPPER_CASE, friendly) \
+    case PerfGaugeEnum::UPPER_CASE: \
+        return friendly;
+    switch (gauge) {
+        X_FOREACH_PERF_GAUGE(X_CASE)
+    }
+#undef X_CASE
+    return "unknown";
+}
+
+NODISCARD const char *getName(const PerfHistogramEnum histogram)
+{
+#define X_CASE(UPPER_CASE, friendly) \
+    case PerfHistogramEnum::UPPER_CASE: \
+        return friendly;
+    switch (histogram) {
+        X_FOREACH_PERF_HISTOGRAM(X_CASE)
+    }
+#undef X_CASE
+    return "unknown";
+}
+
+NODISCARD uint64_t percentile(const Histogram &h, const double p)
+{
+    const auto rank = static_cast<uint64_t>(p * static_cast<double>(h.count - 1u) + 0.5);
+    uint64_t seen = 0;
+    for (size_t b = 0; b < NUM_BUCKETS; ++b) {
+        seen += h.buckets[b];
+        if (seen > rank)
+            return std::min(getBucketLimit(b), h.max);
+    }
+    return h.max;
+}
+
+} // namespace
+
+void perf_counters::add(const PerfCounterEnum counter, const uint64_t n)
+{
+    auto &c = getShard().counters[toIndex(counter)];
+    c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+void perf_counters::set(const PerfGaugeEnum gauge, const int64_t value)
+{
+    getRegistry().gauges[toIndex(gauge)].store(value, std::memory_order_relaxed);
+}
+
+void perf_counters::record(const PerfHistogramEnum histogram, const uint64_t usec)
+{
+    auto &h = getShard().histograms[toIndex(histogram)];
+    auto &b = h.buckets[getBucket(usec)];
+    b.store(b.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    h.sum.store(h.sum.load(std::memory_order_relaxed) + usec, std::memory_order_relaxed);
+    if (usec > h.max.load(std::memory_order_relaxed))
+        h.max.store(usec, std::memory_order_relaxed);
+}
+
+std::string perf_counters::getReport()
+{
+    Totals totals;
+    std::array<int64_t, NUM_PERF_GAUGES> gauges{};
+    {
+        Registry &registry = getRegistry();
+        std::lock_guard<std::mutex> lock{registry.mutex};
+        totals = registry.retired;
+        for (const Shard *const shard : registry.shards)
+            shard->addTo(totals);
+        for (size_t i = 0; i < NUM_PERF_GAUGES; ++i)
+            gauges[i] = registry.gauges[i].load(std::memory_order_relaxed);
+    }
+
+    std::ostringstream os;
+    os << "Performance counters:\n";
+    for (size_t i = 0; i < NUM_PERF_COUNTERS; ++i)
+        os << "  " << getName(static_cast<PerfCounterEnum>(i)) << ": " << totals.counters[i]
+           << "\n";
+    for (size_t i = 0; i < NUM_PERF_GAUGES; ++i)
+        os << "  " << getName(static_cast<PerfGaugeEnum>(i)) << ": " << gauges[i] << "\n";
+    for (size_t i = 0; i < NUM_PERF_HISTOGRAMS; ++i) {
+        const Histogram &h = totals.histograms[i];
+        os << "  " << getName(static_cast<PerfHistogramEnum>(i)) << ": ";
+        if (h.count == 0) {
+            os << "no samples\n";
+            continue;
+        }
+        os << "p50 " << percentile(h, 0.50) << " us, p95 " << percentile(h, 0.95)
+           << " us, p99 " << percentile(h, 0.99) << " us, max " << h.max << " us, mean "
+           << h.sum / h.count << " us (" << h.count << " samples)\n";
+    }
+    return os.str();
+}
+
+void perf_counters::reset()
+{
+    Registry &registry = getRegistry();
+    std::lock_guard<std::mutex> lock{registry.mutex};
+    registry.retired = Totals{};
+    for (Shard *const shard : registry.shards)
+        shard->clear();
+}
+
+void perf_counters::record(const PerfHistogramEnum histogram,
+                           const std::chrono::steady_clock::duration elapsed)
+{
+    const auto usec = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    record(histogram, static_cast<uint64_t>(std::max<int64_t>(usec, 0)));
+}
+
+perf_counters::ScopedTimer::~ScopedTimer()
+{
+    record(m_histogram, std::chrono::steady_clock::now() - m_start);
+}
@@ -0,0 +1,80 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "RuleOf5.h"
+#include "macros.h"
+
+// X(UPPER_CASE, "friendly name")
+#define X_FOREACH_PERF_COUNTER(X) \
+    X(MUD_BYTES, "proxy: bytes from MUD") \
+    X(USER_BYTES, "proxy: bytes to user") \
+    X(PARSE_EVENTS, "parser: room events") \
+    X(MAP_SAVES, "storage: map saves") \
+    X(GROUP_MESSAGES, "group: messages received") \
+    X(FRAMES, "canvas: frames painted")
+
+// X(UPPER_CASE, "friendly name")
+#define X_FOREACH_PERF_GAUGE(X) X(LIVE_PATHS, "pathmachine: live paths")
+
+// X(UPPER_CASE, "friendly name"); the values are in microseconds.
+#define X_FOREACH_PERF_HISTOGRAM(X) \
+    X(PATH_EVALUATION, "pathmachine: event") \
+    X(MAP_SAVE, "storage: map save") \
+    X(FRAME, "canvas: paintGL")
+
+#define X_DECL_PERF_ENUM(UPPER_CASE, friendly) UPPER_CASE,
+enum class NODISCARD PerfCounterEnum : uint8_t { X_FOREACH_PERF_COUNTER(X_DECL_PERF_ENUM) };
+enum class NODISCARD PerfGaugeEnum : uint8_t { X_FOREACH_PERF_GAUGE(X_DECL_PERF_ENUM) };
+enum class NODISCARD PerfHistogramEnum : uint8_t { X_FOREACH_PERF_HISTOGRAM(X_DECL_PERF_ENUM) };
+#undef X_DECL_PERF_ENUM
+
+#define X_COUNT_PERF_ENUM(UPPER_CASE, friendly) +1
+static constexpr const size_t NUM_PERF_COUNTERS = (X_FOREACH_PERF_COUNTER(X_COUNT_PERF_ENUM));
+static constexpr const size_t NUM_PERF_GAUGES = (X_FOREACH_PERF_GAUGE(X_COUNT_PERF_ENUM));
+static constexpr const size_t NUM_PERF_HISTOGRAMS = (X_FOREACH_PERF_HISTOGRAM(X_COUNT_PERF_ENUM));
+#undef X_COUNT_PERF_ENUM
+static_assert(NUM_PERF_COUNTERS == 6);
+static_assert(NUM_PERF_GAUGES == 1);
+static_assert(NUM_PERF_HISTOGRAMS == 3);
+
+/**
+ * Process-wide performance counters, shown by the "perf" command.
+ *
+ * Counters and histograms are kept in a shard per thread, so the hot paths
+ * only do a relaxed add on memory no other thread writes; the shards are
+ * summed when a report is taken, and folded into a total when their thread
+ * exits. Gauges are a single value, so they're shared.
+ *
+ * Histograms are log-linear: exact below 8, and then 8 buckets per power of
+ * two, so a percentile is within 12.5% of the recorded value.
+ */
+namespace perf_counters {
+void add(PerfCounterEnum counter, uint64_t n = 1);
+void set(PerfGaugeEnum gauge, int64_t value);
+void record(PerfHistogramEnum histogram, uint64_t usec);
+void record(PerfHistogramEnum histogram, std::chrono::steady_clock::duration elapsed);
+
+NODISCARD std::string getReport();
+void reset();
+
+// Records the time from construction to destruction.
+class NODISCARD ScopedTimer final
+{
+private:
+    const std::chrono::steady_clock::time_point m_start = std::chrono::steady_clock::now();
+    const PerfHistogramEnum m_histogram;
+
+public:
+    explicit ScopedTimer(const PerfHistogramEnum histogram)
+        : m_histogram{histogram}
+    {}
+    ~ScopedTimer();
+    DELETE_CTORS_AND_ASSIGN_OPS(ScopedTimer);
+};
+} // namespace perf_counters
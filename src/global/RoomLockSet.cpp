@@ -0,0 +1,108 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "RoomLockSet.h"
+
+#include <algorithm>
+#include <utility>
+
+RoomLockSet::RoomLockSet(const RoomLockSet &other)
+    : m_inline{}
+{
+    *this = other;
+}
+
+RoomLockSet::RoomLockSet(RoomLockSet &&other) noexcept
+    : m_inline{}
+{
+    *this = std::move(other);
+}
+
+RoomLockSet &RoomLockSet::operator=(const RoomLockSet &other)
+{
+    if (this == &other)
+        return *this;
+
+    clear();
+    if (other.m_size > INLINE_CAPACITY) {
+        m_heap = new RoomRecipient *[other.m_size];
+        m_capacity = other.m_size;
+    }
+    std::copy(other.begin(), other.end(), data());
+    m_size = other.m_size;
+    return *this;
+}
+
+RoomLockSet &RoomLockSet::operator=(RoomLockSet &&other) noexcept
+{
+    if (this == &other)
+        return *this;
+
+    clear();
+    if (other.isInline()) {
+        std::copy(other.begin(), other.end(), m_inline);
+    } else {
+        m_heap = std::exchange(other.m_heap, nullptr);
+        m_capacity = std::exchange(other.m_capacity, INLINE_CAPACITY);
+    }
+    m_size = std::exchange(other.m_size, 0u);
+    return *this;
+}
+
+void RoomLockSet::freeHeap() noexcept
+{
+    if (!isInline()) {
+        delete[] m_heap;
+        m_heap = nullptr;
+        m_capacity = INLINE_CAPACITY;
+    }
+}
+
+void RoomLockSet::clear() noexcept
+{
+    freeHeap();
+    m_size = 0;
+}
+
+void RoomLockSet::grow()
+{
+    const uint32_t newCapacity = m_capacity * 2u;
+    auto *const buffer = new RoomRecipient *[newCapacity];
+    std::copy(begin(), end(), buffer);
+    freeHeap();
+    m_heap = buffer;
+    m_capacity = newCapacity;
+}
+
+bool RoomLockSet::contains(const RoomRecipient *const recipient) const
+{
+    return std::find(begin(), end(), recipient) != end();
+}
+
+bool RoomLockSet::insert(RoomRecipient *const recipient)
+{
+    if (contains(recipient))
+        return false;
+
+    if (m_size == m_capacity)
+        grow();
+
+    data()[m_size++] = recipient;
+    return true;
+}
+
+size_t RoomLockSet::erase(const RoomRecipient *const recipient)
+{
+    RoomRecipient **const base = data();
+    RoomRecipient **const last = base + m_size;
+    RoomRecipient **const it = std::find(base, last, recipient);
+    if (it == last)
+        return 0;
+
+    // order doesn't matter, so the last one fills the gap
+    *it = *(last - 1);
+    --m_size;
+    if (m_size == 0)
+        freeHeap();
+    return 1;
+}
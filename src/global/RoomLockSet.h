@@ -0,0 +1,66 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+#include "macros.h"
+
+class RoomRecipient;
+
+/**
+ * The recipients holding a lock on one room.
+ *
+ * A room is rarely held by more than the path machine and a selection at once,
+ * so up to INLINE_CAPACITY lockers are stored directly in the object, and
+ * locking or releasing a room doesn't allocate. Larger sets spill to a heap
+ * buffer. The lockers are unordered.
+ */
+class NODISCARD RoomLockSet final
+{
+public:
+    using value_type = RoomRecipient *;
+    using const_iterator = RoomRecipient *const *;
+    static constexpr const uint32_t INLINE_CAPACITY = 2;
+
+private:
+    uint32_t m_size = 0;
+    uint32_t m_capacity = INLINE_CAPACITY;
+    union {
+        RoomRecipient *m_inline[INLINE_CAPACITY];
+        RoomRecipient **m_heap;
+    };
+
+public:
+    RoomLockSet() noexcept
+        : m_inline{}
+    {}
+    ~RoomLockSet() { freeHeap(); }
+    RoomLockSet(const RoomLockSet &other);
+    RoomLockSet(RoomLockSet &&other) noexcept;
+    RoomLockSet &operator=(const RoomLockSet &other);
+    RoomLockSet &operator=(RoomLockSet &&other) noexcept;
+
+private:
+    NODISCARD bool isInline() const { return m_capacity <= INLINE_CAPACITY; }
+    NODISCARD RoomRecipient **data() { return isInline() ? m_inline : m_heap; }
+    NODISCARD RoomRecipient *const *data() const { return isInline() ? m_inline : m_heap; }
+    void freeHeap() noexcept;
+    void grow();
+
+public:
+    NODISCARD const_iterator begin() const { return data(); }
+    NODISCARD const_iterator end() const { return data() + m_size; }
+    NODISCARD size_t size() const { return m_size; }
+    NODISCARD bool empty() const { return m_size == 0; }
+    NODISCARD bool contains(const RoomRecipient *recipient) const;
+
+public:
+    // returns true if the recipient wasn't already holding the lock
+    bool insert(RoomRecipient *recipient);
+    // returns the number of elements removed (0 or 1)
+    size_t erase(const RoomRecipient *recipient);
+    void clear() noexcept;
+};
@@ -4,9 +4,9 @@
 
 #include <cassert>
 #include <functional>
-#include <list>
 #include <memory>
 #include <type_traits>
+#include <utility>
 #include <QDebug>
 
 #include "RuleOf5.h"
@@ -16,28 +16,28 @@ template<typename... Args>
 struct NODISCARD Signal;
 
 template<typename... Args>
-struct NODISCARD Connection : public std::enable_shared_from_this<Connection<Args...>>
+class NODISCARD ConnectionLifetime;
+
+// One callback, linked into its signal's list. It belongs to its lifetime
+// token, so it may outlive the signal, in which case it's just disconnected.
+template<typename... Args>
+struct NODISCARD Connection final
 {
 public:
     using Function = std::function<void(Args...)>;
     using Signal = ::Signal<Args...>;
 
 private:
-    struct NODISCARD this_is_private final
-    {
-        explicit this_is_private(int) {}
-    };
-
-private:
+    friend Signal;
+    friend ConnectionLifetime<Args...>;
     Signal *m_signal = nullptr;
+    Connection *m_prev = nullptr;
+    Connection *m_next = nullptr;
     Function m_function;
-
-private:
-    friend Signal;
-    NODISCARD static std::shared_ptr<Connection> alloc(Signal &signal, Function function)
-    {
-        return std::make_shared<Connection>(this_is_private{0}, signal, std::move(function));
-    }
+    // How many invocations are running this callback right now.
+    int m_invoking = 0;
+    // The lifetime token went away while the callback was running.
+    bool m_orphaned = false;
 
 public:
     NODISCARD static constexpr bool inline hasValidArgTypes()
@@ -47,54 +47,119 @@ struct NODISCARD Connection : public std::enable_shared_from_this<Connection<Arg
         return noReferences && allCopyConstructible;
     }
 
-public:
-    explicit Connection(this_is_private, Signal &signal, Function function)
-        : m_signal{&signal}
-        , m_function(std::move(function))
+private:
+    explicit Connection(Function function)
+        : m_function(std::move(function))
     {
         static_assert(hasValidArgTypes());
     }
 
-    ~Connection()
-    {
-        // CAUTION: destructor must not use shared_from_this().
-        disconnect();
-    }
-
+public:
+    ~Connection() { disconnect(); }
     DELETE_CTORS_AND_ASSIGN_OPS(Connection);
 
     void disconnect()
     {
+        // NOTE: The function is kept, since it may be the one that's running.
         if (auto sig = std::exchange(m_signal, nullptr)) {
-            m_function = nullptr;
-            sig->disconnect(*this);
+            sig->unlink(*this);
         }
     }
 
 private:
-    void invoke(Args... args) const
+    // Deleted now, or by the last invocation that's still running it.
+    void release()
+    {
+        disconnect();
+        if (m_invoking > 0) {
+            m_orphaned = true;
+        } else {
+            delete this;
+        }
+    }
+
+public:
+    NODISCARD bool isValid() const { return m_signal != nullptr; }
+    explicit operator bool() const { return isValid(); }
+};
+
+// Keeps a callback connected; it's disconnected when this goes away.
+// Move-only, so there's no reference count to maintain.
+template<typename... Args>
+class NODISCARD ConnectionLifetime final
+{
+private:
+    using Connection = ::Connection<Args...>;
+    Connection *m_connection = nullptr;
+
+private:
+    friend Signal<Args...>;
+    explicit ConnectionLifetime(Connection *const connection)
+        : m_connection{connection}
+    {}
+
+public:
+    ConnectionLifetime() = default;
+    ~ConnectionLifetime() { reset(); }
+    ConnectionLifetime(ConnectionLifetime &&other) noexcept
+        : m_connection{std::exchange(other.m_connection, nullptr)}
+    {}
+    ConnectionLifetime &operator=(ConnectionLifetime &&other) noexcept
     {
-        if (isValid())
-            m_function(args...);
+        if (this != &other) {
+            reset();
+            m_connection = std::exchange(other.m_connection, nullptr);
+        }
+        return *this;
     }
+    DELETE_COPY_CTOR(ConnectionLifetime);
+    DELETE_COPY_ASSIGN_OP(ConnectionLifetime);
 
 public:
-    NODISCARD bool isValid() const { return m_signal != nullptr && m_function != nullptr; }
+    void reset()
+    {
+        if (Connection *const connection = std::exchange(m_connection, nullptr)) {
+            connection->release();
+        }
+    }
+    void disconnect()
+    {
+        if (m_connection != nullptr) {
+            m_connection->disconnect();
+        }
+    }
+    NODISCARD bool isValid() const { return m_connection != nullptr && m_connection->isValid(); }
     explicit operator bool() const { return isValid(); }
 };
 
 // NOTE: This is not related to SignalBlocker, which is for QObject.
+//
+// The connections form an intrusive list, so invoking doesn't allocate or touch
+// any reference counts. Callbacks may connect or disconnect anything, including
+// themselves, while the signal is being invoked; the ones connected meanwhile
+// wait for the next invocation. Not thread-safe.
 template<typename... Args>
 struct NODISCARD Signal
 {
 public:
     using Connection = ::Connection<Args...>;
     using Function = typename Connection::Function;
-    using SharedConnection = std::shared_ptr<Connection>;
-    using WeakConnection = std::weak_ptr<Connection>;
+    using Lifetime = ConnectionLifetime<Args...>;
+
+private:
+    // A running invoke(), so that unlinking can step around the connection it's on.
+    struct NODISCARD Iteration final
+    {
+        Connection *next = nullptr;
+        Connection *last = nullptr;
+        Iteration *outer = nullptr;
+    };
 
 private:
-    std::list<WeakConnection> m_connections;
+    friend Connection;
+    Connection *m_head = nullptr;
+    Connection *m_tail = nullptr;
+    Iteration *m_iterations = nullptr;
     int m_disableCount = 0;
 
 public:
@@ -105,10 +170,8 @@ struct NODISCARD Signal
 
     void disconnectAll()
     {
-        for (const WeakConnection &weakConnection : std::exchange(m_connections, {})) {
-            if (const SharedConnection sharedConnection = weakConnection.lock()) {
-                sharedConnection->disconnect();
-            }
+        while (m_head != nullptr) {
+            m_head->disconnect();
         }
     }
 
@@ -124,76 +187,87 @@ struct NODISCARD Signal
         }
     }
 
+    void unlink(Connection &connection)
+    {
+        for (Iteration *it = m_iterations; it != nullptr; it = it->outer) {
+            if (it->next == &connection)
+                it->next = connection.m_next;
+            if (it->last == &connection)
+                it->last = connection.m_prev;
+        }
+        if (connection.m_prev != nullptr) {
+            connection.m_prev->m_next = connection.m_next;
+        } else {
+            m_head = connection.m_next;
+        }
+        if (connection.m_next != nullptr) {
+            connection.m_next->m_prev = connection.m_prev;
+        } else {
+            m_tail = connection.m_prev;
+        }
+        connection.m_prev = nullptr;
+        connection.m_next = nullptr;
+    }
+
 public:
     void invoke(Args... args)
     {
         assert(m_disableCount >= 0);
-        if (m_disableCount > 0)
+        if (m_disableCount > 0 || m_head == nullptr)
             return;
 
-        m_connections.remove_if(
-            [tuple = std::tuple<Args...>(args...)](const WeakConnection &weakConnection) {
-                if (const SharedConnection sharedConnection = weakConnection.lock()) {
-                    try {
-                        const Connection &connection = *sharedConnection;
-                        std::apply(
-                            [&connection](Args... tupleArgs) {
-                                ///
-                                connection.invoke(tupleArgs...);
-                            },
-                            tuple);
-                        return false;
-                    } catch (...) {
-                        reportException();
-                        qInfo() << "Automatically removing connection that threw an exception";
-                        return true;
-                    }
-                } else {
-                    return true;
-                }
-            });
+        Iteration it{m_head, m_tail, m_iterations};
+        m_iterations = &it;
+        while (it.last != nullptr && it.next != nullptr) {
+            Connection *const current = std::exchange(it.next, it.next->m_next);
+            const bool wasLast = (current == it.last);
+            ++current->m_invoking;
+            try {
+                current->m_function(args...);
+            } catch (...) {
+                reportException();
+                qInfo() << "Automatically removing connection that threw an exception";
+                current->disconnect();
+            }
+            // The last one may have been disconnected, leaving this one at the end.
+            const bool done = wasLast || it.last == current;
+            if (--current->m_invoking == 0 && current->m_orphaned) {
+                delete current;
+            }
+            if (done)
+                break;
+        }
+        m_iterations = it.outer;
     }
 
     void operator()(Args &&...args) { invoke(std::forward<Args>(args)...); }
 
 public:
-    NODISCARD SharedConnection connect(Function function)
+    NODISCARD Lifetime connect(Function function)
     {
-        SharedConnection connection = Connection::alloc(*this, std::move(function));
-        m_connections.emplace_back(connection);
-        return connection;
+        auto *const connection = new Connection(std::move(function));
+        connection->m_signal = this;
+        connection->m_prev = m_tail;
+        if (m_tail != nullptr) {
+            m_tail->m_next = connection;
+        } else {
+            m_head = connection;
+        }
+        m_tail = connection;
+        return Lifetime{connection};
     }
 
     template<typename T>
     using MemberFunctionPtr = void (T::*)(Args...);
 
     template<typename T>
-    NODISCARD SharedConnection connectMember(T &obj, MemberFunctionPtr<T> pfn)
+    NODISCARD Lifetime connectMember(T &obj, MemberFunctionPtr<T> pfn)
     {
         if (pfn == nullptr)
             throw NullPointerException();
         return connect([&obj, pfn](Args... args) { (obj.*pfn)(args...); });
     }
 
-    void disconnect(const SharedConnection &connection)
-    {
-        if (connection)
-            disconnect(*connection);
-    }
-
-    void disconnect(const Connection &toRemove)
-    {
-        if (m_connections.empty())
-            return;
-
-        m_connections.remove_if([&toRemove](WeakConnection &weakConnection) {
-            if (auto shared = weakConnection.lock()) {
-                return shared.get() == &toRemove;
-            }
-            return true;
-        });
-    }
-
 public:
     struct NODISCARD ReEnabler final
     {
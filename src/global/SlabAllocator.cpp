@@ -0,0 +1,111 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "SlabAllocator.h"
+
+#include <cassert>
+
+SlabArena::Pool::Pool(const size_t blockSize, const size_t blocksPerSlab)
+    : m_blockSize{blockSize}
+    , m_blocksPerSlab{blocksPerSlab}
+{
+    assert(blockSize >= sizeof(FreeNode));
+    assert(blockSize % alignof(std::max_align_t) == 0);
+    assert(blocksPerSlab != 0);
+}
+
+SlabArena::Pool::~Pool()
+{
+    // Blocks still in use at this point would dangle.
+    assert(m_inUse == 0);
+}
+
+void SlabArena::Pool::addSlab()
+{
+    // operator new[] returns storage aligned for any fundamental type.
+    auto slab = std::make_unique<std::byte[]>(m_blockSize * m_blocksPerSlab);
+    std::byte *const base = slab.get();
+
+    // Thread the new blocks onto the free list in address order.
+    for (size_t i = m_blocksPerSlab; i-- > 0;) {
+        auto *const node = new (base + i * m_blockSize) FreeNode{};
+        node->next = m_freeList;
+        m_freeList = node;
+    }
+    m_slabs.emplace_back(std::move(slab));
+}
+
+void *SlabArena::Pool::allocate()
+{
+    if (m_freeList == nullptr)
+        addSlab();
+
+    FreeNode *const node = m_freeList;
+    m_freeList = node->next;
+    ++m_inUse;
+    return node;
+}
+
+void SlabArena::Pool::deallocate(void *const ptr) noexcept
+{
+    assert(ptr != nullptr);
+    assert(m_inUse != 0);
+    auto *const node = new (ptr) FreeNode{};
+    node->next = m_freeList;
+    m_freeList = node;
+    --m_inUse;
+}
+
+SlabArena::SlabArena(const size_t blocksPerSlab)
+    : m_blocksPerSlab{blocksPerSlab}
+{}
+
+SlabArena::~SlabArena() = default;
+
+size_t SlabArena::roundUp(const size_t bytes)
+{
+    static constexpr const size_t ALIGN = alignof(std::max_align_t);
+    return (bytes + ALIGN - 1) / ALIGN * ALIGN;
+}
+
+SlabArena::Pool &SlabArena::getPool(const size_t bytes)
+{
+    const size_t blockSize = roundUp(bytes);
+    for (const auto &pool : m_pools) {
+        if (pool->getBlockSize() == blockSize)
+            return *pool;
+    }
+    return *m_pools.emplace_back(std::make_unique<Pool>(blockSize, m_blocksPerSlab));
+}
+
+void *SlabArena::allocate(const size_t bytes)
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    return getPool(bytes).allocate();
+}
+
+void SlabArena::deallocate(void *const ptr, const size_t bytes) noexcept
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    getPool(bytes).deallocate(ptr);
+}
+
+size_t SlabArena::getBlocksInUse() const
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    size_t total = 0;
+    for (const auto &pool : m_pools) {
+        total += pool->getInUse();
+    }
+    return total;
+}
+
+size_t SlabArena::getBytesReserved() const
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    size_t total = 0;
+    for (const auto &pool : m_pools) {
+        total += pool->getCapacity() * pool->getBlockSize();
+    }
+    return total;
+}
@@ -0,0 +1,137 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include "RuleOf5.h"
+#include "macros.h"
+
+/**
+ * Hands out fixed-size blocks carved from large slabs, recycling freed
+ * blocks through an intrusive free list. Slabs are only released when
+ * the arena is destroyed.
+ */
+class NODISCARD SlabArena final
+{
+private:
+    class NODISCARD Pool final
+    {
+    private:
+        struct NODISCARD FreeNode final
+        {
+            FreeNode *next = nullptr;
+        };
+
+        const size_t m_blockSize;
+        const size_t m_blocksPerSlab;
+        std::vector<std::unique_ptr<std::byte[]>> m_slabs;
+        FreeNode *m_freeList = nullptr;
+        size_t m_inUse = 0;
+
+    public:
+        explicit Pool(size_t blockSize, size_t blocksPerSlab);
+        ~Pool();
+        DELETE_CTORS_AND_ASSIGN_OPS(Pool);
+
+    public:
+        NODISCARD size_t getBlockSize() const { return m_blockSize; }
+        NODISCARD size_t getInUse() const { return m_inUse; }
+        NODISCARD size_t getCapacity() const { return m_slabs.size() * m_blocksPerSlab; }
+
+    public:
+        NODISCARD void *allocate();
+        void deallocate(void *ptr) noexcept;
+
+    private:
+        void addSlab();
+    };
+
+private:
+    static constexpr const size_t DEFAULT_BLOCKS_PER_SLAB = 1024;
+
+    mutable std::mutex m_mutex;
+    std::vector<std::unique_ptr<Pool>> m_pools;
+    const size_t m_blocksPerSlab;
+
+public:
+    explicit SlabArena(size_t blocksPerSlab = DEFAULT_BLOCKS_PER_SLAB);
+    ~SlabArena();
+    DELETE_CTORS_AND_ASSIGN_OPS(SlabArena);
+
+private:
+    NODISCARD static size_t roundUp(size_t bytes);
+    NODISCARD Pool &getPool(size_t bytes);
+
+public:
+    NODISCARD static bool canAllocate(const size_t bytes, const size_t alignment)
+    {
+        return bytes != 0 && alignment <= alignof(std::max_align_t);
+    }
+
+    NODISCARD void *allocate(size_t bytes);
+    void deallocate(void *ptr, size_t bytes) noexcept;
+
+public:
+    NODISCARD size_t getBlocksInUse() const;
+    NODISCARD size_t getBytesReserved() const;
+};
+
+/**
+ * Allocator suitable for std::allocate_shared(). Single objects come from the
+ * shared SlabArena; anything else falls back to the global heap. Each
+ * allocator keeps the arena alive, so objects may outlive their creator.
+ */
+template<typename T>
+class NODISCARD SlabAllocator final
+{
+public:
+    using value_type = T;
+
+private:
+    template<typename U>
+    friend class SlabAllocator;
+    std::shared_ptr<SlabArena> m_arena;
+
+public:
+    explicit SlabAllocator(std::shared_ptr<SlabArena> arena) noexcept
+        : m_arena{std::move(arena)}
+    {}
+    template<typename U>
+    SlabAllocator(const SlabAllocator<U> &other) noexcept
+        : m_arena{other.m_arena}
+    {}
+
+public:
+    NODISCARD T *allocate(const size_t n)
+    {
+        if (n == 1 && m_arena != nullptr && SlabArena::canAllocate(sizeof(T), alignof(T)))
+            return static_cast<T *>(m_arena->allocate(sizeof(T)));
+        return std::allocator<T>{}.allocate(n);
+    }
+
+    void deallocate(T *const ptr, const size_t n) noexcept
+    {
+        if (n == 1 && m_arena != nullptr && SlabArena::canAllocate(sizeof(T), alignof(T))) {
+            m_arena->deallocate(ptr, sizeof(T));
+            return;
+        }
+        std::allocator<T>{}.deallocate(ptr, n);
+    }
+
+public:
+    template<typename U>
+    NODISCARD bool operator==(const SlabAllocator<U> &rhs) const noexcept
+    {
+        return m_arena == rhs.m_arena;
+    }
+    template<typename U>
+    NODISCARD bool operator!=(const SlabAllocator<U> &rhs) const noexcept
+    {
+        return !operator==(rhs);
+    }
+};
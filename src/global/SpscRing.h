@@ -0,0 +1,53 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+#include "RuleOf5.h"
+#include "macros.h"
+
+// A bounded queue between exactly one producer thread and one consumer thread.
+// Neither side ever locks; each only writes its own index.
+template<typename T, size_t N>
+class NODISCARD SpscRing final
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "N must be a power of two");
+
+private:
+    std::array<T, N> m_slots{};
+    // Next slot to read; written by the consumer.
+    alignas(64) std::atomic<size_t> m_head{0};
+    // Next slot to write; written by the producer.
+    alignas(64) std::atomic<size_t> m_tail{0};
+
+public:
+    SpscRing() = default;
+    DELETE_CTORS_AND_ASSIGN_OPS(SpscRing);
+
+public:
+    // Producer only. The value is left alone if the ring is full.
+    NODISCARD bool tryPush(T &&value)
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == N)
+            return false;
+        m_slots[tail % N] = std::move(value);
+        m_tail.store(tail + 1u, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only.
+    NODISCARD bool tryPop(T &out)
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+            return false;
+        out = std::move(m_slots[head % N]);
+        m_head.store(head + 1u, std::memory_order_release);
+        return true;
+    }
+};
@@ -0,0 +1,80 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "StartupProfiler.h"
+
+#include <bitset>
+#include <chrono>
+#include <optional>
+#include <QDebug>
+
+namespace { // anonymous
+
+using Clock = std::chrono::steady_clock;
+
+NODISCARD const char *getPhaseName(const StartupPhaseEnum phase)
+{
+#define X_CASE(UPPER_CASE, friendly) \
+    case StartupPhaseEnum::UPPER_CASE: \
+        return friendly;
+    switch (phase) {
+        X_FOREACH_STARTUP_PHASE(X_CASE)
+    }
+#undef X_CASE
+    return "unknown";
+}
+
+struct NODISCARD Profiler final
+{
+    std::optional<Clock::time_point> start;
+    Clock::time_point previous;
+    std::bitset<NUM_STARTUP_PHASES> reached;
+};
+
+NODISCARD Profiler &getProfiler()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+NODISCARD double toMs(const Clock::duration duration)
+{
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+} // namespace
+
+namespace startup_profiler {
+
+void enable()
+{
+    Profiler &profiler = getProfiler();
+    if (profiler.start) {
+        return;
+    }
+    profiler.start = profiler.previous = Clock::now();
+}
+
+bool isEnabled()
+{
+    return getProfiler().start.has_value();
+}
+
+void mark(const StartupPhaseEnum phase)
+{
+    Profiler &profiler = getProfiler();
+    const auto index = static_cast<size_t>(phase);
+    if (!profiler.start || profiler.reached.test(index)) {
+        return;
+    }
+    profiler.reached.set(index);
+
+    const Clock::time_point now = Clock::now();
+    qInfo().noquote() << QString("[startup] %1 ms (+%2 ms) %3")
+                             .arg(toMs(now - profiler.start.value()), 0, 'f', 1)
+                             .arg(toMs(now - profiler.previous), 0, 'f', 1)
+                             .arg(getPhaseName(phase));
+    profiler.previous = now;
+}
+
+} // namespace startup_profiler
@@ -0,0 +1,41 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <cstddef>
+#include <cstdint>
+
+#include "macros.h"
+
+// X(UPPER_CASE, "friendly name"), in the order they're usually reached.
+#define X_FOREACH_STARTUP_PHASE(X) \
+    X(MAIN, "main") \
+    X(APPLICATION, "application created") \
+    X(SURFACE_FORMAT, "OpenGL format chosen") \
+    X(MAIN_WINDOW, "main window created") \
+    X(MAP_LOADED, "map loaded") \
+    X(WINDOW_SHOWN, "main window shown") \
+    X(OPENGL_READY, "OpenGL initialized") \
+    X(FIRST_FRAME, "first frame")
+
+#define X_DECL_STARTUP_PHASE(UPPER_CASE, friendly) UPPER_CASE,
+enum class NODISCARD StartupPhaseEnum : uint8_t { X_FOREACH_STARTUP_PHASE(X_DECL_STARTUP_PHASE) };
+#undef X_DECL_STARTUP_PHASE
+
+#define X_COUNT_STARTUP_PHASE(UPPER_CASE, friendly) +1
+static constexpr const size_t NUM_STARTUP_PHASES = (
+    X_FOREACH_STARTUP_PHASE(X_COUNT_STARTUP_PHASE));
+#undef X_COUNT_STARTUP_PHASE
+static_assert(NUM_STARTUP_PHASES == 8);
+
+/**
+ * Optional startup timeline, enabled by starting MMapper with --profile-startup.
+ *
+ * Each phase is logged the first time it's reached, with the time since
+ * enable() and since the previous phase. Only call this from the main thread.
+ */
+namespace startup_profiler {
+void enable();
+NODISCARD bool isEnabled();
+void mark(StartupPhaseEnum phase);
+} // namespace startup_profiler
@@ -0,0 +1,94 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "StringPool.h"
+
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+struct NODISCARD StringPool::State final
+{
+    mutable std::mutex mutex;
+    // Keys view the pooled string itself.
+    std::unordered_map<std::string_view, std::weak_ptr<const std::string>> map;
+};
+
+struct NODISCARD StringPool::Deleter final
+{
+    std::weak_ptr<State> weakState;
+
+    void operator()(const std::string *const str) const
+    {
+        if (auto state = weakState.lock()) {
+            std::lock_guard<std::mutex> lock{state->mutex};
+            auto &map = state->map;
+            // The key may have been replaced by a newer copy of the same text.
+            const auto it = map.find(std::string_view{*str});
+            if (it != map.end() && it->first.data() == str->data()) {
+                map.erase(it);
+            }
+        }
+        delete str;
+    }
+};
+
+StringPool::StringPool()
+    : m_state{std::make_shared<State>()}
+{}
+
+StringPool::~StringPool() = default;
+
+StringPool &StringPool::getGlobal()
+{
+    static StringPool pool;
+    return pool;
+}
+
+StringPool::SharedString StringPool::intern(const std::string_view sv)
+{
+    if (sv.empty())
+        return nullptr;
+
+    // NOTE: Never drop the last reference to a pooled string while holding the
+    // lock, since its deleter takes the same lock.
+    std::lock_guard<std::mutex> lock{m_state->mutex};
+    auto &map = m_state->map;
+    if (const auto it = map.find(sv); it != map.end()) {
+        if (SharedString existing = it->second.lock())
+            return existing;
+        // expired, but its deleter hasn't run yet; the key views dying memory.
+        map.erase(it);
+    }
+
+    SharedString result{new std::string(sv), Deleter{m_state}};
+    map.emplace(std::string_view{*result}, result);
+    return result;
+}
+
+size_t StringPool::size() const
+{
+    std::lock_guard<std::mutex> lock{m_state->mutex};
+    return m_state->map.size();
+}
+
+MemoryUsage StringPool::getMemoryUsage() const
+{
+    // The node, the shared_ptr control block, and the string itself.
+    using Node = std::pair<const std::string_view, std::weak_ptr<const std::string>>;
+    static constexpr const size_t PER_ENTRY = sizeof(Node) + 2 * sizeof(void *)
+                                              + 4 * sizeof(void *) + sizeof(std::string);
+    static const size_t INLINE_CAPACITY = std::string{}.capacity();
+
+    std::lock_guard<std::mutex> lock{m_state->mutex};
+    const auto &map = m_state->map;
+    MemoryUsage result;
+    result.count = map.size();
+    result.bytes = map.bucket_count() * sizeof(void *) + map.size() * PER_ENTRY;
+    for (const auto &kv : map) {
+        // Only the key is safe to read; the string may be on its way out.
+        if (kv.first.size() > INLINE_CAPACITY)
+            result.bytes += kv.first.size() + 1;
+    }
+    return result;
+}
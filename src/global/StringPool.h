@@ -0,0 +1,43 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "MemoryReport.h"
+#include "RuleOf5.h"
+#include "macros.h"
+
+/**
+ * Interns strings so that identical contents share one immutable buffer.
+ *
+ * Entries are weak; a string leaves the pool when its last user lets go.
+ * Safe to use from multiple threads.
+ */
+class NODISCARD StringPool final
+{
+public:
+    using SharedString = std::shared_ptr<const std::string>;
+
+private:
+    struct State;
+    struct Deleter;
+    std::shared_ptr<State> m_state;
+
+public:
+    StringPool();
+    ~StringPool();
+    DELETE_CTORS_AND_ASSIGN_OPS(StringPool);
+
+public:
+    NODISCARD static StringPool &getGlobal();
+
+public:
+    // The empty string is never pooled; it returns nullptr.
+    NODISCARD SharedString intern(std::string_view sv);
+    NODISCARD size_t size() const;
+    // Estimated from the string capacities and the hash table's size.
+    NODISCARD MemoryUsage getMemoryUsage() const;
+};
@@ -11,6 +11,7 @@
 #include <vector>
 #include <QString>
 
+#include "TextScan.h"
 #include "TextUtils.h"
 
 NODISCARD static bool is_space(char c)
@@ -55,9 +56,7 @@ void StringView::eatLast()
 
 StringView &StringView::trimLeft() noexcept
 {
-    for (; !isEmpty(); eatFirst())
-        if (!is_space(firstChar()))
-            break;
+    m_sv.remove_prefix(text_scan::findNonSpace(m_sv));
     return *this;
 }
 
@@ -107,12 +106,9 @@ StringView StringView::takeFirstWordNoPostTrim() noexcept(false)
 
     assert(!is_space(lastChar()));
 
-    size_t len = 0;
+    const size_t len = text_scan::findSpace(m_sv);
     const auto before = m_sv;
-    for (; !isEmpty(); eatFirst(), ++len)
-        if (is_space(firstChar()))
-            break;
-
+    m_sv.remove_prefix(len);
     return StringView{before.substr(0, len)};
 }
 
@@ -125,11 +121,7 @@ StringView StringView::takeFirstWord() noexcept(false)
 
 int StringView::countNonSpaceChars() const noexcept
 {
-    int result = 0;
-    for (char c : m_sv)
-        if (!is_space(c))
-            ++result;
-    return result;
+    return static_cast<int>(text_scan::countNonSpace(m_sv));
 }
 
 /* NOTE: This must be flagged noexcept(false) because it calls takeFirstWord() */
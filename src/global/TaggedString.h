@@ -3,44 +3,114 @@
 // Copyright (C) 2019 The MMapper Authors
 
 #include <cassert>
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <QByteArray>
 #include <QString>
 
 #include "RuleOf5.h"
+#include "StringPool.h"
 #include "TextUtils.h"
+#include "hash.h"
 
 // Latin1
+//
+// The text lives in an immutable shared buffer, so copies are cheap. Strings
+// that repeat across many rooms can be routed through the global StringPool
+// with interned(); two interned strings are equal iff they share a buffer.
+//
+// The hash is computed once, when the text is set, so comparisons of unequal
+// strings usually stop there, and hash tables don't have to read the text.
 template<typename T>
 class NODISCARD TaggedString
 {
 private:
-    std::string m_str;
+    std::shared_ptr<const std::string> m_str;
+    // Fits in the padding after the shared_ptr, together with m_interned.
+    uint32_t m_hash = 0;
+    bool m_interned = false;
+
+private:
+    NODISCARD static std::shared_ptr<const std::string> makeShared(std::string s)
+    {
+        if (s.empty())
+            return nullptr;
+        return std::make_shared<const std::string>(std::move(s));
+    }
+    void updateHash() { m_hash = (m_str == nullptr) ? 0 : stable_hash32(*m_str); }
+    NODISCARD static const std::string &getEmptyString()
+    {
+        static const std::string empty;
+        return empty;
+    }
 
 public:
     TaggedString() = default;
     explicit TaggedString(std::nullptr_t) = delete;
     explicit TaggedString(const char *const s)
-        : m_str((s == nullptr) ? "" : s)
+        : m_str(makeShared((s == nullptr) ? "" : s))
     {
         assert(s != nullptr);
+        updateHash();
     }
     template<size_t N>
     explicit TaggedString(const char (&s)[N])
-        : m_str(s, N)
+        : m_str(makeShared(std::string(s, N)))
     {
         assert(s != nullptr);
+        updateHash();
     }
     explicit TaggedString(std::string s)
-        : m_str(std::move(s))
-    {}
+        : m_str(makeShared(std::move(s)))
+    {
+        updateHash();
+    }
     explicit TaggedString(const QString &s)
-        : m_str(::toStdStringLatin1(s))
-    {}
+        : m_str(makeShared(::toStdStringLatin1(s)))
+    {
+        updateHash();
+    }
     DEFAULT_RULE_OF_5(TaggedString);
 
 public:
-    bool operator==(const TaggedString &rhs) const { return m_str == rhs.m_str; }
+    NODISCARD TaggedString interned() const
+    {
+        if (m_interned || m_str == nullptr)
+            return *this;
+
+        TaggedString result;
+        result.m_str = StringPool::getGlobal().intern(*m_str);
+        result.m_hash = m_hash;
+        result.m_interned = true;
+        return result;
+    }
+    // Same as TaggedString{std::string{sv}}.interned(), without the temporary copy.
+    NODISCARD static TaggedString internedFrom(const std::string_view sv)
+    {
+        TaggedString result;
+        result.m_str = StringPool::getGlobal().intern(sv);
+        result.m_interned = result.m_str != nullptr;
+        result.updateHash();
+        return result;
+    }
+    NODISCARD bool isInterned() const { return m_interned; }
+
+public:
+    // stable_hash32() of the text.
+    NODISCARD uint32_t getHash() const { return m_hash; }
+
+public:
+    bool operator==(const TaggedString &rhs) const
+    {
+        if (m_str == rhs.m_str)
+            return true;
+        if (m_hash != rhs.m_hash || (m_interned && rhs.m_interned))
+            return false;
+        return getStdString() == rhs.getStdString();
+    }
     bool operator!=(const TaggedString &rhs) const { return !(rhs == *this); }
 
 public:
@@ -56,12 +126,17 @@ class NODISCARD TaggedString
     }
 
 public:
-    NODISCARD const std::string &getStdString() const { return m_str; }
-    NODISCARD QByteArray toQByteArray() const { return ::toQByteArrayLatin1(m_str); }
-    NODISCARD QString toQString() const { return ::toQStringLatin1(m_str); }
+    NODISCARD const std::string &getStdString() const
+    {
+        return (m_str == nullptr) ? getEmptyString() : *m_str;
+    }
+    // Null when empty.
+    NODISCARD const std::shared_ptr<const std::string> &getSharedString() const { return m_str; }
+    NODISCARD QByteArray toQByteArray() const { return ::toQByteArrayLatin1(getStdString()); }
+    NODISCARD QString toQString() const { return ::toQStringLatin1(getStdString()); }
 
 public:
-    NODISCARD bool empty() const { return m_str.empty(); }
+    NODISCARD bool empty() const { return m_str == nullptr; }
     NODISCARD bool isEmpty() const { return empty(); }
 };
 
@@ -110,5 +185,21 @@ class NODISCARD TaggedStringUtf8 : private TaggedString<T>
 
 public:
     using base::empty;
+    using base::getHash;
     using base::isEmpty;
 };
+
+template<typename T>
+struct std::hash<TaggedString<T>>
+{
+    NODISCARD size_t operator()(const TaggedString<T> &s) const noexcept { return s.getHash(); }
+};
+
+template<typename T>
+struct std::hash<TaggedStringUtf8<T>>
+{
+    NODISCARD size_t operator()(const TaggedStringUtf8<T> &s) const noexcept
+    {
+        return s.getHash();
+    }
+};
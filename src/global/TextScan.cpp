@@ -0,0 +1,284 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "TextScan.h"
+
+#include <cctype>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEXT_SCAN_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define TEXT_SCAN_NEON
+#include <arm_neon.h>
+#endif
+
+#include "TextUtils.h"
+#include "bits.h"
+
+namespace text_scan {
+namespace { // anonymous
+
+NODISCARD bool isSpaceByte(const char c)
+{
+    return std::isspace(static_cast<uint8_t>(c) & 0xff);
+}
+
+NODISCARD bool isAsciiByte(const char c)
+{
+    return static_cast<uint8_t>(c) < 0x80u;
+}
+
+#if defined(TEXT_SCAN_SSE2) || defined(TEXT_SCAN_NEON)
+#define TEXT_SCAN_VECTOR
+
+static constexpr const size_t CHUNK = 16;
+static constexpr const uint32_t ALL_BYTES = (1u << CHUNK) - 1u;
+
+#ifdef TEXT_SCAN_SSE2
+using Vec = __m128i;
+
+NODISCARD Vec load(const char *const p)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+}
+void store(char *const p, const Vec v)
+{
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(p), v);
+}
+NODISCARD Vec splat(const char c)
+{
+    return _mm_set1_epi8(c);
+}
+NODISCARD Vec equal(const Vec a, const Vec b)
+{
+    return _mm_cmpeq_epi8(a, b);
+}
+// Only valid for ASCII, since SSE2 only compares signed bytes.
+NODISCARD Vec inAsciiRange(const Vec v, const char lo, const char hi)
+{
+    return _mm_and_si128(_mm_cmpgt_epi8(v, splat(static_cast<char>(lo - 1))),
+                         _mm_cmplt_epi8(v, splat(static_cast<char>(hi + 1))));
+}
+NODISCARD Vec bitOr(const Vec a, const Vec b)
+{
+    return _mm_or_si128(a, b);
+}
+NODISCARD Vec bitAnd(const Vec a, const Vec b)
+{
+    return _mm_and_si128(a, b);
+}
+NODISCARD Vec add(const Vec a, const Vec b)
+{
+    return _mm_add_epi8(a, b);
+}
+// One bit per byte, from the top bit of each; the first byte is bit 0.
+NODISCARD uint32_t toMask(const Vec v)
+{
+    return static_cast<uint32_t>(_mm_movemask_epi8(v));
+}
+NODISCARD uint32_t highBitMask(const Vec v)
+{
+    return toMask(v);
+}
+#else
+using Vec = uint8x16_t;
+
+NODISCARD Vec load(const char *const p)
+{
+    return vld1q_u8(reinterpret_cast<const uint8_t *>(p));
+}
+void store(char *const p, const Vec v)
+{
+    vst1q_u8(reinterpret_cast<uint8_t *>(p), v);
+}
+NODISCARD Vec splat(const char c)
+{
+    return vdupq_n_u8(static_cast<uint8_t>(c));
+}
+NODISCARD Vec equal(const Vec a, const Vec b)
+{
+    return vceqq_u8(a, b);
+}
+NODISCARD Vec inAsciiRange(const Vec v, const char lo, const char hi)
+{
+    return vandq_u8(vcgeq_u8(v, splat(lo)), vcleq_u8(v, splat(hi)));
+}
+NODISCARD Vec bitOr(const Vec a, const Vec b)
+{
+    return vorrq_u8(a, b);
+}
+NODISCARD Vec bitAnd(const Vec a, const Vec b)
+{
+    return vandq_u8(a, b);
+}
+NODISCARD Vec add(const Vec a, const Vec b)
+{
+    return vaddq_u8(a, b);
+}
+// One bit per byte of a comparison result; the first byte is bit 0.
+// NEON has no movemask, so each half is weighted and summed pairwise.
+NODISCARD uint32_t toMask(const Vec v)
+{
+    static const uint8_t weights[CHUNK] = {1, 2, 4, 8, 16, 32, 64, 128,
+                                           1, 2, 4, 8, 16, 32, 64, 128};
+    const Vec weighted = vandq_u8(v, vld1q_u8(weights));
+    uint8x8_t sums = vpadd_u8(vget_low_u8(weighted), vget_high_u8(weighted));
+    sums = vpadd_u8(sums, sums);
+    sums = vpadd_u8(sums, sums);
+    return vget_lane_u16(vreinterpret_u16_u8(sums), 0);
+}
+NODISCARD uint32_t highBitMask(const Vec v)
+{
+    return toMask(vcgeq_u8(v, vdupq_n_u8(0x80)));
+}
+#endif
+
+// The ASCII bytes std::isspace() accepts: ' ' and '\t' to '\r'.
+NODISCARD uint32_t asciiSpaceMask(const Vec v)
+{
+    return toMask(bitOr(equal(v, splat(' ')), inAsciiRange(v, '\t', '\r')));
+}
+
+NODISCARD size_t lowestBit(const uint32_t mask)
+{
+    return static_cast<size_t>(bits::leastSignificantBit(mask));
+}
+
+NODISCARD size_t countBits(const uint32_t mask)
+{
+    return static_cast<size_t>(bits::bitCount(mask));
+}
+#endif
+
+template<typename Predicate>
+NODISCARD size_t findScalar(const char *const data,
+                            size_t i,
+                            const size_t end,
+                            Predicate &&predicate)
+{
+    for (; i < end; ++i) {
+        if (predicate(data[i]))
+            break;
+    }
+    return i;
+}
+
+template<bool WANT_SPACE>
+NODISCARD size_t find(const std::string_view sv)
+{
+    const auto predicate = [](const char c) -> bool { return isSpaceByte(c) == WANT_SPACE; };
+    const char *const data = sv.data();
+    const size_t size = sv.size();
+    size_t i = 0;
+#ifdef TEXT_SCAN_VECTOR
+    for (; i + CHUNK <= size; i += CHUNK) {
+        const Vec v = load(data + i);
+        if (highBitMask(v) != 0) {
+            // The locale decides about the bytes above 0x7f.
+            const size_t found = findScalar(data, i, i + CHUNK, predicate);
+            if (found != i + CHUNK)
+                return found;
+            continue;
+        }
+        const uint32_t spaces = asciiSpaceMask(v);
+        const uint32_t wanted = WANT_SPACE ? spaces : (~spaces & ALL_BYTES);
+        if (wanted != 0)
+            return i + lowestBit(wanted);
+    }
+#endif
+    return findScalar(data, i, size, predicate);
+}
+
+} // namespace
+
+size_t asciiPrefixLength(const std::string_view sv)
+{
+    const char *const data = sv.data();
+    const size_t size = sv.size();
+    size_t i = 0;
+#ifdef TEXT_SCAN_VECTOR
+    for (; i + CHUNK <= size; i += CHUNK) {
+        const uint32_t high = highBitMask(load(data + i));
+        if (high != 0)
+            return i + lowestBit(high);
+    }
+#endif
+    return findScalar(data, i, size, [](const char c) -> bool { return !isAsciiByte(c); });
+}
+
+size_t findSpace(const std::string_view sv)
+{
+    return find<true>(sv);
+}
+
+size_t findNonSpace(const std::string_view sv)
+{
+    return find<false>(sv);
+}
+
+size_t countNonSpace(const std::string_view sv)
+{
+    const char *const data = sv.data();
+    const size_t size = sv.size();
+    size_t result = 0;
+    size_t i = 0;
+#ifdef TEXT_SCAN_VECTOR
+    for (; i + CHUNK <= size; i += CHUNK) {
+        const Vec v = load(data + i);
+        if (highBitMask(v) != 0) {
+            for (size_t j = i; j < i + CHUNK; ++j) {
+                if (!isSpaceByte(data[j]))
+                    ++result;
+            }
+            continue;
+        }
+        result += CHUNK - countBits(asciiSpaceMask(v));
+    }
+#endif
+    for (; i < size; ++i) {
+        if (!isSpaceByte(data[i]))
+            ++result;
+    }
+    return result;
+}
+
+size_t countMismatches(const char *const a, const char *const b, const size_t len)
+{
+    size_t result = 0;
+    size_t i = 0;
+#ifdef TEXT_SCAN_VECTOR
+    for (; i + CHUNK <= len; i += CHUNK) {
+        result += CHUNK - countBits(toMask(equal(load(a + i), load(b + i))));
+    }
+#endif
+    for (; i < len; ++i) {
+        if (a[i] != b[i])
+            ++result;
+    }
+    return result;
+}
+
+void toLowerLatin1InPlace(char *const data, const size_t len)
+{
+    size_t i = 0;
+#ifdef TEXT_SCAN_VECTOR
+    for (; i + CHUNK <= len; i += CHUNK) {
+        const Vec v = load(data + i);
+        if (highBitMask(v) != 0) {
+            for (size_t j = i; j < i + CHUNK; ++j) {
+                data[j] = ::toLowerLatin1(data[j]);
+            }
+            continue;
+        }
+        const Vec upper = inAsciiRange(v, 'A', 'Z');
+        store(data + i, add(v, bitAnd(upper, splat('a' - 'A'))));
+    }
+#endif
+    for (; i < len; ++i) {
+        data[i] = ::toLowerLatin1(data[i]);
+    }
+}
+
+} // namespace text_scan
@@ -0,0 +1,31 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <cstddef>
+#include <string_view>
+
+#include "macros.h"
+
+// Byte scans used by room matching and the parsers, 16 bytes at a time with SSE2 or
+// NEON where the compiler targets them, and one byte at a time otherwise.
+//
+// "Space" is std::isspace(), like StringView; ASCII runs are classified in vector
+// registers, and bytes above 0x7f are still asked of the locale.
+namespace text_scan {
+
+// Returns the number of bytes before the first one that isn't 7-bit ASCII.
+NODISCARD extern size_t asciiPrefixLength(std::string_view sv);
+
+// These return sv.size() if there's no such byte.
+NODISCARD extern size_t findSpace(std::string_view sv);
+NODISCARD extern size_t findNonSpace(std::string_view sv);
+
+NODISCARD extern size_t countNonSpace(std::string_view sv);
+// Counts the positions where the first len bytes of a and b differ.
+NODISCARD extern size_t countMismatches(const char *a, const char *b, size_t len);
+
+// Same as toLowerLatin1(char) on each byte.
+extern void toLowerLatin1InPlace(char *data, size_t len);
+
+} // namespace text_scan
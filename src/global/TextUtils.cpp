@@ -16,6 +16,7 @@
 #include <QRegularExpression>
 #include <QString>
 
+#include "TextScan.h"
 #include "utils.h"
 
 // allows ">" or "|" as the quote character
@@ -968,11 +969,9 @@ char toLowerLatin1(const char c)
 
 std::string toLowerLatin1(const std::string_view str)
 {
-    std::ostringstream oss;
-    for (char c : str) {
-        oss << toLowerLatin1(c);
-    }
-    return oss.str();
+    std::string result{str};
+    text_scan::toLowerLatin1InPlace(result.data(), result.size());
+    return result;
 }
 
 char toUpperLatin1(const char c)
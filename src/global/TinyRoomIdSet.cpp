@@ -0,0 +1,128 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "TinyRoomIdSet.h"
+
+#include <algorithm>
+#include <utility>
+
+TinyRoomIdSet::TinyRoomIdSet(const TinyRoomIdSet &other)
+    : m_inline{}
+{
+    *this = other;
+}
+
+TinyRoomIdSet::TinyRoomIdSet(TinyRoomIdSet &&other) noexcept
+    : m_inline{}
+{
+    *this = std::move(other);
+}
+
+TinyRoomIdSet &TinyRoomIdSet::operator=(const TinyRoomIdSet &other)
+{
+    if (this == &other)
+        return *this;
+
+    clear();
+    if (other.m_size > INLINE_CAPACITY) {
+        m_heap = new RoomId[other.m_size];
+        m_capacity = other.m_size;
+    }
+    std::copy(other.begin(), other.end(), data());
+    m_size = other.m_size;
+    return *this;
+}
+
+TinyRoomIdSet &TinyRoomIdSet::operator=(TinyRoomIdSet &&other) noexcept
+{
+    if (this == &other)
+        return *this;
+
+    clear();
+    if (other.isInline()) {
+        std::copy(other.begin(), other.end(), m_inline);
+    } else {
+        m_heap = std::exchange(other.m_heap, nullptr);
+        m_capacity = std::exchange(other.m_capacity, INLINE_CAPACITY);
+    }
+    m_size = std::exchange(other.m_size, 0u);
+    return *this;
+}
+
+void TinyRoomIdSet::freeHeap() noexcept
+{
+    if (!isInline()) {
+        delete[] m_heap;
+        m_heap = nullptr;
+        m_capacity = INLINE_CAPACITY;
+    }
+}
+
+void TinyRoomIdSet::clear() noexcept
+{
+    freeHeap();
+    m_size = 0;
+}
+
+void TinyRoomIdSet::grow()
+{
+    const uint32_t newCapacity = m_capacity * 2u;
+    auto *const buffer = new RoomId[newCapacity];
+    std::copy(begin(), end(), buffer);
+    freeHeap();
+    m_heap = buffer;
+    m_capacity = newCapacity;
+}
+
+const RoomId *TinyRoomIdSet::lowerBound(const RoomId id) const
+{
+    const RoomId *const first = begin();
+    const RoomId *const last = end();
+    // linear scan beats binary search for the tiny sizes we expect
+    if (m_size <= 8u) {
+        return std::find_if(first, last, [id](RoomId x) { return !(x < id); });
+    }
+    return std::lower_bound(first, last, id);
+}
+
+TinyRoomIdSet::const_iterator TinyRoomIdSet::find(const RoomId id) const
+{
+    const RoomId *const it = lowerBound(id);
+    return (it != end() && *it == id) ? it : end();
+}
+
+bool TinyRoomIdSet::insert(const RoomId id)
+{
+    const auto pos = static_cast<size_t>(lowerBound(id) - begin());
+    if (pos < m_size && data()[pos] == id)
+        return false;
+
+    if (m_size == m_capacity)
+        grow();
+
+    RoomId *const base = data();
+    std::copy_backward(base + pos, base + m_size, base + m_size + 1);
+    base[pos] = id;
+    ++m_size;
+    return true;
+}
+
+size_t TinyRoomIdSet::erase(const RoomId id)
+{
+    const RoomId *const it = find(id);
+    if (it == end())
+        return 0;
+
+    RoomId *const base = data();
+    const auto pos = static_cast<size_t>(it - base);
+    std::copy(base + pos + 1, base + m_size, base + pos);
+    --m_size;
+    if (m_size == 0)
+        freeHeap();
+    return 1;
+}
+
+bool TinyRoomIdSet::operator==(const TinyRoomIdSet &rhs) const
+{
+    return m_size == rhs.m_size && std::equal(begin(), end(), rhs.begin());
+}
@@ -0,0 +1,84 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+#include "macros.h"
+#include "roomid.h"
+
+/**
+ * Sorted set of RoomIds with inline storage for the common case.
+ *
+ * Nearly every exit has zero or one connection, so up to INLINE_CAPACITY ids
+ * are stored directly in the object; larger sets spill to a heap buffer.
+ * Iteration is over a contiguous sorted array, in the same ascending order
+ * as std::set<RoomId>.
+ */
+class NODISCARD TinyRoomIdSet final
+{
+public:
+    using value_type = RoomId;
+    using const_iterator = const RoomId *;
+    static constexpr const uint32_t INLINE_CAPACITY = 2;
+
+private:
+    uint32_t m_size = 0;
+    uint32_t m_capacity = INLINE_CAPACITY;
+    union {
+        RoomId m_inline[INLINE_CAPACITY];
+        RoomId *m_heap;
+    };
+
+public:
+    TinyRoomIdSet() noexcept
+        : m_inline{}
+    {}
+    ~TinyRoomIdSet() { freeHeap(); }
+    TinyRoomIdSet(const TinyRoomIdSet &other);
+    TinyRoomIdSet(TinyRoomIdSet &&other) noexcept;
+    TinyRoomIdSet &operator=(const TinyRoomIdSet &other);
+    TinyRoomIdSet &operator=(TinyRoomIdSet &&other) noexcept;
+
+private:
+    NODISCARD bool isInline() const { return m_capacity <= INLINE_CAPACITY; }
+    NODISCARD RoomId *data() { return isInline() ? m_inline : m_heap; }
+    NODISCARD const RoomId *data() const { return isInline() ? m_inline : m_heap; }
+    NODISCARD const RoomId *lowerBound(RoomId id) const;
+    void freeHeap() noexcept;
+    void grow();
+
+public:
+    NODISCARD const_iterator begin() const { return data(); }
+    NODISCARD const_iterator end() const { return data() + m_size; }
+    NODISCARD size_t size() const { return m_size; }
+    NODISCARD bool empty() const { return m_size == 0; }
+    NODISCARD size_t getHeapBytes() const
+    {
+        return isInline() ? 0u : static_cast<size_t>(m_capacity) * sizeof(RoomId);
+    }
+
+    NODISCARD RoomId first() const
+    {
+        assert(!empty());
+        return *begin();
+    }
+
+public:
+    NODISCARD const_iterator find(RoomId id) const;
+    NODISCARD bool contains(RoomId id) const { return find(id) != end(); }
+    NODISCARD size_t count(RoomId id) const { return contains(id) ? 1u : 0u; }
+
+public:
+    // returns true if the id was inserted
+    bool insert(RoomId id);
+    // returns the number of elements removed (0 or 1)
+    size_t erase(RoomId id);
+    void clear() noexcept;
+
+public:
+    NODISCARD bool operator==(const TinyRoomIdSet &rhs) const;
+    NODISCARD bool operator!=(const TinyRoomIdSet &rhs) const { return !operator==(rhs); }
+};
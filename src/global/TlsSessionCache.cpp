@@ -0,0 +1,105 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "TlsSessionCache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <QByteArray>
+#include <QSslConfiguration>
+#include <QSslSocket>
+
+namespace { // anonymous
+
+using Clock = std::chrono::steady_clock;
+
+// Used when the server doesn't say how long its tickets last; it's also the
+// longest we keep any ticket.
+static constexpr const std::chrono::seconds DEFAULT_LIFETIME{2 * 60 * 60};
+static constexpr const size_t MAX_SESSIONS = 32;
+
+struct NODISCARD Session final
+{
+    QByteArray ticket;
+    Clock::time_point expires;
+};
+
+NODISCARD std::map<QString, Session> &getSessions()
+{
+    static std::map<QString, Session> sessions;
+    return sessions;
+}
+
+void dropExpired(std::map<QString, Session> &sessions, const Clock::time_point now)
+{
+    for (auto it = sessions.begin(); it != sessions.end();) {
+        if (it->second.expires <= now)
+            it = sessions.erase(it);
+        else
+            ++it;
+    }
+}
+
+} // namespace
+
+namespace tls_session_cache {
+
+QString makePeer(const QString &host, const quint16 port)
+{
+    return QString("%1:%2").arg(host.trimmed().toLower()).arg(port);
+}
+
+void prepare(QSslSocket &socket, const QString &peer)
+{
+    auto &sessions = getSessions();
+    dropExpired(sessions, Clock::now());
+
+    auto config = socket.sslConfiguration();
+    // Otherwise Qt doesn't hand the negotiated session back to us.
+    config.setSslOption(QSsl::SslOptionDisableSessionPersistence, false);
+    const auto it = sessions.find(peer);
+    config.setSessionTicket(it == sessions.end() ? QByteArray{} : it->second.ticket);
+    socket.setSslConfiguration(config);
+}
+
+void remember(const QSslSocket &socket, const QString &peer)
+{
+    const auto config = socket.sslConfiguration();
+    const QByteArray ticket = config.sessionTicket();
+    if (ticket.isEmpty())
+        return;
+
+    const int hint = config.sessionTicketLifeTimeHint();
+    const auto lifetime = hint > 0 ? std::chrono::seconds{hint} : DEFAULT_LIFETIME;
+    const auto now = Clock::now();
+
+    auto &sessions = getSessions();
+    dropExpired(sessions, now);
+    if (sessions.size() >= MAX_SESSIONS && sessions.find(peer) == sessions.end()) {
+        const auto soonest = std::min_element(sessions.begin(),
+                                              sessions.end(),
+                                              [](const auto &a, const auto &b) {
+                                                  return a.second.expires < b.second.expires;
+                                              });
+        sessions.erase(soonest);
+    }
+    sessions[peer] = Session{ticket, now + std::min(lifetime, DEFAULT_LIFETIME)};
+}
+
+void forget(const QString &peer)
+{
+    getSessions().erase(peer);
+}
+
+void clear()
+{
+    getSessions().clear();
+}
+
+size_t size()
+{
+    return getSessions().size();
+}
+
+} // namespace tls_session_cache
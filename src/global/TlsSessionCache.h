@@ -0,0 +1,34 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <cstddef>
+#include <QString>
+
+#include "macros.h"
+
+class QSslSocket;
+
+/**
+ * The TLS sessions last negotiated with each peer ("host:port"), so that
+ * reconnecting after a dropped link can resume the session in one round trip
+ * instead of doing a full handshake.
+ *
+ * Sessions are kept in memory until their ticket's lifetime runs out; they're
+ * never written to disk, since a ticket is as good as the session's keys.
+ * Only call these from the thread that owns the sockets.
+ */
+namespace tls_session_cache {
+
+NODISCARD QString makePeer(const QString &host, quint16 port);
+
+// Offers the peer's last session, if any, on the socket's next client handshake.
+void prepare(QSslSocket &socket, const QString &peer);
+// Remembers the session the socket negotiated; call once it's encrypted.
+void remember(const QSslSocket &socket, const QString &peer);
+// Drops the peer's session, e.g. after a failed handshake.
+void forget(const QString &peer);
+void clear();
+
+NODISCARD size_t size();
+} // namespace tls_session_cache
@@ -4,11 +4,16 @@
 
 #include "entities.h"
 
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <cctype>
 #include <cstdint>
+#include <cstring>
 #include <limits>
 #include <optional>
 #include <stdexcept>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 #include <QByteArray>
@@ -340,6 +345,65 @@ enum class NODISCARD XmlEntityEnum : uint16_t { INVALID = 0, X_FOREACH_ENTITY(X,
 #undef X
 #undef SEP_COMMA
 
+namespace { // anonymous
+struct NODISCARD NamedEntity final
+{
+    std::string_view name;
+    XmlEntityEnum id = XmlEntityEnum::INVALID;
+};
+
+#define X(name, value) \
+    NamedEntity { #name, XmlEntityEnum::XID_##name }
+#define SEP_COMMA() ,
+static constexpr const std::array g_namedEntities{X_FOREACH_ENTITY(X, SEP_COMMA)};
+#undef X
+#undef SEP_COMMA
+static_assert(g_namedEntities.size() == 258);
+
+// FNV-1a
+NODISCARD constexpr uint32_t hashEntityName(const std::string_view name)
+{
+    uint32_t hash = 2166136261u;
+    for (const char c : name) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Open addressing, built at compile time; each slot holds an index into g_namedEntities plus 1.
+static constexpr const size_t NUM_ENTITY_SLOTS = 1024;
+static_assert((NUM_ENTITY_SLOTS & (NUM_ENTITY_SLOTS - 1)) == 0);
+static constexpr const size_t ENTITY_SLOT_MASK = NUM_ENTITY_SLOTS - 1;
+static constexpr const auto g_entitySlots = []() {
+    std::array<uint16_t, NUM_ENTITY_SLOTS> slots{};
+    for (size_t i = 0; i < g_namedEntities.size(); ++i) {
+        size_t slot = hashEntityName(g_namedEntities[i].name) & ENTITY_SLOT_MASK;
+        while (slots[slot] != 0)
+            slot = (slot + 1) & ENTITY_SLOT_MASK;
+        slots[slot] = static_cast<uint16_t>(i + 1);
+    }
+    return slots;
+}();
+
+// e.g. "amp" for "&amp;"
+NODISCARD constexpr XmlEntityEnum lookupEntityByName(const std::string_view name)
+{
+    for (size_t slot = hashEntityName(name) & ENTITY_SLOT_MASK;;
+         slot = (slot + 1) & ENTITY_SLOT_MASK) {
+        const size_t index = g_entitySlots[slot];
+        if (index == 0)
+            return XmlEntityEnum::INVALID;
+        const NamedEntity &entity = g_namedEntities[index - 1];
+        if (entity.name == name)
+            return entity.id;
+    }
+}
+static_assert(lookupEntityByName("amp") == XmlEntityEnum::XID_amp);
+static_assert(lookupEntityByName("diams") == XmlEntityEnum::XID_diams);
+static_assert(lookupEntityByName("bogus") == XmlEntityEnum::INVALID);
+} // namespace
+
 struct NODISCARD XmlEntity final
 {
     QByteArray short_name;
@@ -678,8 +742,6 @@ NODISCARD static OptQChar tryParseHex(const QChar *const beg, const QChar *const
 // "&foo;", "&1114111;", "&1114112;", "&x10FFFF;", "&x110000;", etc
 void entities::foreachEntity(const QStringView input, EntityCallback &callback)
 {
-    const auto &tab = getEntityTable();
-
     const QChar *const beg = input.begin();
     const QChar *const end = input.end();
 
@@ -732,9 +794,15 @@ void entities::foreachEntity(const QStringView input, EntityCallback &callback)
             if (it < end && *it == ';') {
                 ++it;
                 const auto ampLen = static_cast<int>(it - amp);
-                const auto full = input.mid(ampStart, ampLen).toString();
-                assert(full.size() == ampLen);
-                const XmlEntityEnum id = tab.lookup_entity_id_by_full_name(full);
+                // Every known name is short and ASCII.
+                char name[16];
+                const auto nameLen = static_cast<size_t>(ampLen - 2);
+                XmlEntityEnum id = XmlEntityEnum::INVALID;
+                if (nameLen <= sizeof(name)) {
+                    for (size_t i = 0; i < nameLen; ++i)
+                        name[i] = amp[i + 1].toLatin1();
+                    id = lookupEntityByName(std::string_view{name, nameLen});
+                }
                 if (id != XmlEntityEnum::INVALID) {
                     const auto bits = static_cast<uint16_t>(id);
                     const QChar qc(bits);
@@ -757,6 +825,9 @@ void entities::foreachEntity(const QStringView input, EntityCallback &callback)
 
 auto entities::decode(const EncodedLatin1 &input) -> DecodedUnicode
 {
+    if (!input.contains('&'))
+        return DecodedUnicode{QString::fromLatin1(input)};
+
     static constexpr const char unprintable = '?';
     struct NODISCARD MyEntityCallback final : public EntityCallback
     {
@@ -809,6 +880,78 @@ auto entities::decode(const EncodedLatin1 &input) -> DecodedUnicode
     return std::move(callback.out);
 }
 
+void entities::decodeLatin1InPlace(QByteArray &latin1)
+{
+    const auto findAmp = [](const char *const from, const char *const to) {
+        return static_cast<const char *>(std::memchr(from, '&', static_cast<size_t>(to - from)));
+    };
+    const char *first = findAmp(latin1.constBegin(), latin1.constEnd());
+    if (first == nullptr)
+        return;
+
+    // the decoded text is never longer, so it's written over the input as it is read
+    const auto firstOffset = first - latin1.constBegin();
+    char *const beg = latin1.data();
+    char *const end = beg + latin1.size();
+    char *out = beg + firstOffset;
+    const char *in = out;
+    while (in != end) {
+        const char *const amp = findAmp(in, end);
+        const char *const runEnd = (amp == nullptr) ? end : amp;
+        if (out != in)
+            std::memmove(out, in, static_cast<size_t>(runEnd - in));
+        out += runEnd - in;
+        in = runEnd;
+        if (amp == nullptr)
+            break;
+
+        // longest useful entity is "&#x000FF;"
+        const auto avail = static_cast<size_t>(end - amp);
+        const std::string_view rest{amp + 1, std::min<size_t>(avail - 1, 16)};
+        const size_t semi = rest.find(';');
+        std::optional<uint32_t> decoded;
+        if (semi != std::string_view::npos && semi != 0) {
+            const std::string_view body = rest.substr(0, semi);
+            if (body[0] != '#') {
+                decoded = static_cast<uint32_t>(lookupEntityByName(body));
+            } else {
+                const bool hex = body.size() > 1 && (body[1] == 'x' || body[1] == 'X');
+                const std::string_view digits = body.substr(hex ? 2 : 1);
+                uint32_t value = 0;
+                bool ok = !digits.empty();
+                const auto digitValue = [hex](const char c) -> int {
+                    const auto uc = static_cast<unsigned char>(c);
+                    if (isdigit(uc))
+                        return c - '0';
+                    if (hex && isxdigit(uc))
+                        return tolower(uc) - 'a' + 10;
+                    return -1;
+                };
+                for (const char c : digits) {
+                    const int digit = digitValue(c);
+                    if (digit < 0 || value > 0xFFFFu) {
+                        ok = false;
+                        break;
+                    }
+                    value = value * (hex ? 16u : 10u) + static_cast<uint32_t>(digit);
+                }
+                if (ok)
+                    decoded = value;
+            }
+        }
+
+        if (decoded.has_value() && decoded.value() != 0 && decoded.value() < 256) {
+            *out++ = static_cast<char>(decoded.value());
+            in = amp + semi + 2;
+        } else {
+            // not representable in Latin-1 (or not an entity); keep it as is
+            *out++ = '&';
+            in = amp + 1;
+        }
+    }
+    latin1.truncate(static_cast<int>(out - beg));
+}
+
 // self test
 namespace entities {
 static void testEncode(const char *_in, const char *_expect)
@@ -828,7 +971,22 @@ static void testDecode(const char *_in, const char *_expect)
         throw std::runtime_error("test failed");
 }
 
+static void testDecodeInPlace(const char *_in, const char *_expect)
+{
+    QByteArray ba{_in};
+    decodeLatin1InPlace(ba);
+    if (ba != QByteArray{_expect})
+        throw std::runtime_error("test failed");
+}
+
 static const bool self_test = []() -> bool {
+    //
+    testDecodeInPlace("", "");
+    testDecodeInPlace("plain", "plain");
+    testDecodeInPlace("&lt;&amp;lt;&gt;", "<&lt;>");
+    testDecodeInPlace("a &amp b &bogus; &#65;&#x42;", "a &amp b &bogus; AB");
+    testDecodeInPlace("&trade; &nbsp;&", "&trade; \xa0&");
+
     //
     testDecode("", "");
     testDecode("&amp;", "&");
@@ -56,6 +56,9 @@ enum class NODISCARD EncodingEnum { Translit, Lossless };
 NODISCARD extern EncodedLatin1 encode(const DecodedUnicode &name,
                                       EncodingEnum encodingType = EncodingEnum::Translit);
 NODISCARD extern DecodedUnicode decode(const EncodedLatin1 &input);
+/// Decodes the entities that have Latin-1 values (e.g. "&lt;" or "&#233;") in place,
+/// and leaves all others alone; costs a single memchr when there are none.
+extern void decodeLatin1InPlace(QByteArray &latin1);
 
 struct NODISCARD EntityCallback
 {
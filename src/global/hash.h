@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: GPL-2.0-or-later
 // Copyright (C) 2019 The MMapper Authors
 
+#include <cstdint>
 #include <cstring>
 #include <string_view>
 #include <type_traits>
@@ -17,3 +18,35 @@ NODISCARD static auto numeric_hash(const T val) noexcept
     std::memcpy(buf, &val, size);
     return std::hash<std::string_view>()({buf, size});
 }
+
+// Unlike std::hash, gives the same result from one run to the next, so it can
+// be saved to notice when data has changed. It reads 8 bytes at a time;
+// it is not meant to stand up to anyone trying to cause collisions.
+NODISCARD inline uint64_t stable_hash64(const std::string_view data) noexcept
+{
+    static constexpr const uint64_t MULTIPLIER = 0x9E3779B97F4A7C15ull;
+    uint64_t h = 0xCBF29CE484222325ull ^ data.size();
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= data.size(); i += sizeof(uint64_t)) {
+        uint64_t word = 0;
+        std::memcpy(&word, data.data() + i, sizeof(word));
+        h = (h ^ word) * MULTIPLIER;
+        h ^= h >> 32;
+    }
+    for (; i < data.size(); ++i) {
+        h = (h ^ static_cast<uint8_t>(data[i])) * MULTIPLIER;
+    }
+    h ^= h >> 29;
+    h *= 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 32;
+    return h;
+}
+
+// Folded stable_hash64(); the empty string hashes to 0.
+NODISCARD inline uint32_t stable_hash32(const std::string_view data) noexcept
+{
+    if (data.empty())
+        return 0;
+    const uint64_t h = stable_hash64(data);
+    return static_cast<uint32_t>(h ^ (h >> 32));
+}
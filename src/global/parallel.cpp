@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "parallel.h"
+
+#include <deque>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "RuleOf5.h"
+
+namespace { // anonymous
+
+class NODISCARD WorkerPool final
+{
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<std::function<void()>> m_tasks;
+    bool m_stopping = false;
+    // Last, so the threads start after everything they use.
+    std::vector<std::thread> m_threads;
+
+public:
+    WorkerPool()
+    {
+        const size_t cores = std::max(1u, std::thread::hardware_concurrency());
+        m_threads.reserve(cores - 1);
+        for (size_t i = 1; i < cores; ++i) {
+            m_threads.emplace_back([this]() { run(); });
+        }
+    }
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> guard{m_mutex};
+            m_stopping = true;
+        }
+        m_cv.notify_all();
+        for (std::thread &t : m_threads) {
+            t.join();
+        }
+    }
+    DELETE_CTORS_AND_ASSIGN_OPS(WorkerPool);
+
+public:
+    NODISCARD size_t size() const { return m_threads.size(); }
+    void post(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> guard{m_mutex};
+            m_tasks.emplace_back(std::move(task));
+        }
+        m_cv.notify_one();
+    }
+
+private:
+    void run()
+    {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock{m_mutex};
+                m_cv.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+                if (m_tasks.empty())
+                    return;
+                task = std::move(m_tasks.front());
+                m_tasks.pop_front();
+            }
+            task();
+        }
+    }
+};
+
+NODISCARD WorkerPool &getPool()
+{
+    static WorkerPool pool;
+    return pool;
+}
+
+} // namespace
+
+size_t worker_pool::getNumWorkers()
+{
+    return getPool().size();
+}
+
+void worker_pool::post(std::function<void()> task)
+{
+    getPool().post(std::move(task));
+}
@@ -0,0 +1,83 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include "macros.h"
+
+// A fixed set of worker threads (one less than there are cores), started on
+// first use, so parallelFor() doesn't have to spawn threads on every call.
+namespace worker_pool {
+NODISCARD size_t getNumWorkers();
+// Runs the task on one of the workers, in the order the tasks were posted.
+void post(std::function<void()> task);
+} // namespace worker_pool
+
+namespace parallel_detail {
+struct NODISCARD Job final
+{
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::atomic<size_t> nextBatch{0};
+    int running = 0;
+    // Helpers that only start after this is set have nothing left to do.
+    bool closed = false;
+};
+} // namespace parallel_detail
+
+// Calls callback(i) for every i in [0, n), spread across the available cores
+// in batches of consecutive indices. The callback must be safe to call from
+// several threads at once; it runs on the calling thread if n is small.
+//
+// The calling thread takes batches too, and only waits for the helpers that
+// have already started, so nested calls can't run out of workers.
+template<typename Callback>
+void parallelFor(const size_t n, Callback &&callback, const size_t batch = 32)
+{
+    const size_t numThreads = std::min(worker_pool::getNumWorkers() + 1, (n + batch - 1) / batch);
+    if (numThreads <= 1) {
+        for (size_t i = 0; i < n; ++i) {
+            callback(i);
+        }
+        return;
+    }
+
+    const auto job = std::make_shared<parallel_detail::Job>();
+    const auto worker = [n, batch, &job, &callback]() {
+        for (size_t begin; (begin = job->nextBatch.fetch_add(batch)) < n;) {
+            const size_t end = std::min(n, begin + batch);
+            for (size_t i = begin; i < end; ++i) {
+                callback(i);
+            }
+        }
+    };
+
+    for (size_t i = 1; i < numThreads; ++i) {
+        worker_pool::post([job, &worker]() {
+            {
+                std::lock_guard<std::mutex> guard{job->mutex};
+                if (job->closed)
+                    return;
+                ++job->running;
+            }
+            worker();
+            {
+                std::lock_guard<std::mutex> guard{job->mutex};
+                --job->running;
+            }
+            job->cv.notify_all();
+        });
+    }
+    worker();
+
+    std::unique_lock<std::mutex> lock{job->mutex};
+    job->closed = true;
+    job->cv.wait(lock, [&job]() { return job->running == 0; });
+}
@@ -71,8 +71,8 @@ class NODISCARD roomid_vector : private std::vector<T>
 class Room;
 using RoomIndex = roomid_vector<std::shared_ptr<Room>>;
 
-class RoomRecipient;
-using RoomLocks = roomid_vector<std::set<RoomRecipient *>>;
+class RoomLockSet; // see RoomLockSet.h
+using RoomLocks = roomid_vector<RoomLockSet>;
 
 class RoomCollection;
 using SharedRoomCollection = std::shared_ptr<RoomCollection>;
@@ -29,7 +29,14 @@ struct NODISCARD UnquoteException final : public std::runtime_error
 };
 UnquoteException::~UnquoteException() = default;
 
-enum class NODISCARD TokenEnum { BeginString, EndString };
+// Events of the tokenizer, besides the decoded chars.
+struct NODISCARD BeginString final
+{
+    // Where the token starts in the input.
+    size_t offset = 0;
+};
+struct NODISCARD EndString final
+{};
 
 NODISCARD static std::optional<uint32_t> try_decode_oct(char c) noexcept
 {
@@ -51,8 +58,102 @@ NODISCARD static std::optional<uint32_t> try_decode_hex(char c) noexcept
         return std::nullopt;
 }
 
-NODISCARD static std::vector<std::string> unquote_unsafe(const std::string_view input,
-                                                         const bool allowUnbalancedQuotes)
+void UnquotedTokens::push_back(const std::string_view token)
+{
+    if (m_size < INLINE_TOKENS) {
+        m_inline[m_size++] = token;
+        return;
+    }
+    if (m_spilled.empty()) {
+        m_spilled.reserve(INLINE_TOKENS * 2);
+        m_spilled.assign(m_inline.begin(), m_inline.end());
+    }
+    m_spilled.emplace_back(token);
+    ++m_size;
+}
+
+void UnquotedTokens::clear()
+{
+    m_spilled.clear();
+    m_size = 0;
+    m_decoded.clear();
+}
+
+VectorOfStrings UnquotedTokens::toVectorOfStrings() const
+{
+    VectorOfStrings result;
+    result.reserve(m_size);
+    for (const std::string_view token : *this) {
+        result.emplace_back(token);
+    }
+    return result;
+}
+
+// Keeps a token as a view into the input for as long as the decoded chars match
+// the input's, and only copies it into the decode buffer once they differ.
+struct NODISCARD UnquoteBuilder final
+{
+    UnquotedTokens &tokens;
+    const std::string_view input;
+    const bool allowEmbeddedNull;
+    size_t begin = 0;
+    size_t length = 0;
+    // Where the token starts in tokens.m_decoded, once it had to be copied.
+    std::optional<size_t> decodedBegin;
+
+    explicit UnquoteBuilder(UnquotedTokens &tokens,
+                            const std::string_view input,
+                            const bool allowEmbeddedNull)
+        : tokens{tokens}
+        , input{input}
+        , allowEmbeddedNull{allowEmbeddedNull}
+    {}
+
+    void operator()(const BeginString x)
+    {
+        begin = x.offset;
+        length = 0;
+        decodedBegin.reset();
+    }
+
+    void operator()(const char c)
+    {
+        std::string &decoded = tokens.m_decoded;
+        if (!decodedBegin.has_value()) {
+            const size_t pos = begin + length;
+            if (pos < input.size() && input[pos] == c) {
+                ++length;
+                return;
+            }
+            // Decoding never makes the text longer, so this is never reallocated,
+            // and it only allocates if a token needs decoding.
+            if (decoded.capacity() < input.size())
+                decoded.reserve(input.size());
+            decodedBegin = decoded.size();
+            decoded.append(input.substr(begin, length));
+        }
+        assert(decoded.size() < decoded.capacity());
+        decoded.push_back(c);
+        ++length;
+    }
+
+    void operator()(EndString)
+    {
+        std::string_view token = decodedBegin.has_value()
+                                     ? std::string_view{tokens.m_decoded}.substr(
+                                         decodedBegin.value())
+                                     : input.substr(begin, length);
+        if (!allowEmbeddedNull) {
+            token = token.substr(0, token.find('\0')); // terminate every token at '\0'
+        }
+        tokens.push_back(token);
+    }
+};
+
+static void unquote_unsafe(const std::string_view input,
+                           const bool allowUnbalancedQuotes,
+                           const bool allowEmbeddedNull,
+                           UnquotedTokens &tokens)
 {
     const auto foreach_char = [allowUnbalancedQuotes, &input](auto &&visit) -> void {
         const auto visit_oct = [&visit](auto &it, const auto end) -> void {
@@ -120,7 +221,7 @@ NODISCARD static std::vector<std::string> unquote_unsafe(const std::string_view
                 if (std::isspace(c))
                     continue;
 
-                visit(TokenEnum::BeginString);
+                visit(BeginString{static_cast<size_t>(it - input.begin()) - 1});
                 if (c == '"') {
                     mode = ModeEnum::DoubleQuote;
                 } else {
@@ -133,7 +234,7 @@ NODISCARD static std::vector<std::string> unquote_unsafe(const std::string_view
                     mode = ModeEnum::DoubleQuote;
                 } else if (std::isspace(c)) {
                     mode = ModeEnum::Space;
-                    visit(TokenEnum::EndString);
+                    visit(EndString{});
                 } else {
                     visit(c);
                 }
@@ -217,105 +318,67 @@ NODISCARD static std::vector<std::string> unquote_unsafe(const std::string_view
 
         if (mode == ModeEnum::DoubleQuote) {
             if (allowUnbalancedQuotes) {
-                visit(TokenEnum::EndString);
+                visit(EndString{});
             } else {
                 throw UnquoteException(ReasonEnum::UNBALANCED_QUOTES);
             }
         } else if (mode == ModeEnum::Other) {
-            visit(TokenEnum::EndString);
+            visit(EndString{});
         }
     };
 
-    std::optional<size_t> current_length;
-    std::vector<std::string> result;
-    foreach_char([&current_length, &result](auto &&x) -> void {
-        using T = std::decay_t<decltype(x)>;
-        if constexpr (std::is_same_v<T, char>) {
-            ++current_length.value();
-        } else if constexpr (std::is_same_v<T, TokenEnum>) {
-            switch (x) {
-            case TokenEnum::BeginString:
-                assert(!current_length.has_value());
-                current_length.emplace(0);
-                result.emplace_back(std::string{});
-                break;
-            case TokenEnum::EndString:
-                result.back().resize(current_length.value());
-                current_length.reset();
-                break;
-            }
-        } else {
-            throw std::runtime_error("internal error");
-        }
-    });
-
-    std::optional<size_t> current_pos;
-    std::optional<size_t> stringNumber;
-
-    foreach_char([&result, &stringNumber, &current_pos](auto &&x) {
-        using T = std::decay_t<decltype(x)>;
-        if constexpr (std::is_same_v<T, char>) {
-            const size_t pos = current_pos.value()++;
-            std::string &s = result[stringNumber.value()];
-            assert(pos < s.length());
-            s[pos] = static_cast<char>(x);
-        } else if constexpr (std::is_same_v<T, TokenEnum>) {
-            switch (x) {
-            case TokenEnum::BeginString:
-                assert(!current_pos.has_value());
-                current_pos.emplace(0);
-                if (!stringNumber.has_value()) {
-                    stringNumber = 0;
-                }
-                break;
-            case TokenEnum::EndString:
-                assert(result[stringNumber.value()].size() == current_pos.value());
-                current_pos.reset();
-                ++stringNumber.value();
-                break;
-            }
-        } else {
-            throw std::runtime_error("internal error");
-        }
-    });
+    UnquoteBuilder builder{tokens, input, allowEmbeddedNull};
+    foreach_char(builder);
+}
 
-    assert(stringNumber.value_or(0) == result.size());
-    return result;
+NODISCARD static VectorOfStrings unquote_unsafe(const std::string_view input,
+                                                const bool allowUnbalancedQuotes)
+{
+    UnquotedTokens tokens;
+    unquote_unsafe(input, allowUnbalancedQuotes, true, tokens);
+    return tokens.toVectorOfStrings();
 }
 
-NODISCARD UnquoteResult unquote(const std::string_view input,
-                                const bool allowUnbalancedQuotes,
-                                const bool allowEmbeddedNull)
+std::optional<UnquoteFailureReason> unquoteInto(const std::string_view input,
+                                                const bool allowUnbalancedQuotes,
+                                                const bool allowEmbeddedNull,
+                                                UnquotedTokens &tokens)
 {
     try {
-        auto result = unquote_unsafe(input, allowUnbalancedQuotes);
-        if (!allowEmbeddedNull) {
-            for (std::string &s : result) {
-                s = s.c_str(); // terminate every string at '\0'
-            }
-        }
-        return UnquoteResult{std::move(result)};
+        unquote_unsafe(input, allowUnbalancedQuotes, allowEmbeddedNull, tokens);
+        return std::nullopt;
     } catch (const UnquoteException &ex) {
         switch (ex.reason) {
         case ReasonEnum::INVALID_ESCAPE:
-            return UnquoteResult{UnquoteFailureReason{"unquote: invalid escape"}};
+            return UnquoteFailureReason{"unquote: invalid escape"};
         case ReasonEnum::INVALID_OCTAL:
-            return UnquoteResult{UnquoteFailureReason{
-                R"(unquote: invalid octal (only \o000 .. \o377 are allowed))"}};
+            return UnquoteFailureReason{
+                R"(unquote: invalid octal (only \o000 .. \o377 are allowed))"};
 
         case ReasonEnum::INVALID_HEX:
             // Syntax allows possible future support for emojis or whatever,
             // but we currently only support LATIN1 characters.
-            return UnquoteResult{UnquoteFailureReason{
-                R"(unquote: invalid hex (only \x##, \u####, or \U######## are allowed))"}};
+            return UnquoteFailureReason{
+                R"(unquote: invalid hex (only \x##, \u####, or \U######## are allowed))"};
         case ReasonEnum::UNBALANCED_QUOTES:
-            return UnquoteResult{UnquoteFailureReason{"unquote: unbalanced quotes"}};
+            return UnquoteFailureReason{"unquote: unbalanced quotes"};
         }
     } catch (const std::exception &ex) {
-        return UnquoteResult{UnquoteFailureReason{std::string("exception: ") + ex.what()}};
+        return UnquoteFailureReason{std::string("exception: ") + ex.what()};
     } catch (...) {
     }
-    return UnquoteResult{UnquoteFailureReason{"unknown error"}};
+    return UnquoteFailureReason{"unknown error"};
+}
+
+NODISCARD UnquoteResult unquote(const std::string_view input,
+                                const bool allowUnbalancedQuotes,
+                                const bool allowEmbeddedNull)
+{
+    UnquotedTokens tokens;
+    if (auto failure = unquoteInto(input, allowUnbalancedQuotes, allowEmbeddedNull, tokens)) {
+        return UnquoteResult{std::move(failure.value())};
+    }
+    return UnquoteResult{tokens.toVectorOfStrings()};
 }
 
 namespace test {
@@ -434,6 +497,18 @@ void test_unquote() noexcept /* will crash the program if it throws */
         assert(result && result.getVectorOfStrings() == expect);
     }
 
+    {
+        const std::string_view input = R"(plain "quo ted" 1 2 3 4 5 6 7 8)";
+        UnquotedTokens tokens;
+        const auto failure = unquoteInto(input, false, false, tokens);
+        assert(!failure.has_value());
+        assert(tokens.size() == 10);
+        // plain tokens are views into the input
+        assert(tokens[0].data() == input.data());
+        assert(tokens[1] == "quo ted");
+        assert(tokens[9] == "8");
+    }
+
     std::cout << __FUNCTION__ << ": All tests passed.\n" << std::flush;
 }
 
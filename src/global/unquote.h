@@ -2,11 +2,15 @@
 // SPDX-License-Identifier: GPL-2.0-or-later
 // Copyright (C) 2019 The MMapper Authors
 
+#include <array>
+#include <cstddef>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <variant>
 #include <vector>
 
+#include "RuleOf5.h"
 #include "macros.h"
 
 struct NODISCARD UnquoteFailureReason final : public std::string
@@ -40,6 +44,62 @@ struct NODISCARD UnquoteResult final
     }
 };
 
+/**
+ * Tokens of an unquoted line, as views: tokens that need no decoding point into
+ * the input itself, and the others into one buffer reserved up front, so
+ * unquoting a line usually allocates nothing. Tokens are stored inline until
+ * there are more than INLINE_TOKENS.
+ *
+ * The input must outlive the tokens. Not copyable or movable, since the views
+ * may point into the object.
+ */
+class NODISCARD UnquotedTokens final
+{
+public:
+    using value_type = std::string_view;
+    using const_iterator = const std::string_view *;
+    static constexpr const size_t INLINE_TOKENS = 8;
+
+private:
+    std::array<std::string_view, INLINE_TOKENS> m_inline{};
+    std::vector<std::string_view> m_spilled;
+    size_t m_size = 0;
+    std::string m_decoded;
+
+public:
+    UnquotedTokens() = default;
+    ~UnquotedTokens() = default;
+    DELETE_CTORS_AND_ASSIGN_OPS(UnquotedTokens);
+
+public:
+    NODISCARD bool empty() const { return m_size == 0; }
+    NODISCARD size_t size() const { return m_size; }
+    NODISCARD const std::string_view *data() const
+    {
+        return m_spilled.empty() ? m_inline.data() : m_spilled.data();
+    }
+    NODISCARD const_iterator begin() const { return data(); }
+    NODISCARD const_iterator end() const { return data() + m_size; }
+    NODISCARD std::string_view operator[](const size_t i) const { return data()[i]; }
+
+    // The view must outlive the tokens.
+    void push_back(std::string_view token);
+    void clear();
+
+    NODISCARD VectorOfStrings toVectorOfStrings() const;
+
+private:
+    // Decodes into the tokens (see unquote.cpp).
+    friend struct UnquoteBuilder;
+};
+
+// Appends the tokens of input; the tokens may only hold one decoded input at a
+// time, so call clear() before unquoting another.
+NODISCARD extern std::optional<UnquoteFailureReason> unquoteInto(std::string_view input,
+                                                                 bool allowUnbalancedQuotes,
+                                                                 bool allowEmbeddedNull,
+                                                                 UnquotedTokens &tokens);
+
 NODISCARD extern UnquoteResult unquote(const std::string_view input,
                                        bool allowUnbalancedQuotes,
                                        bool allowEmbeddedNull);
@@ -0,0 +1,252 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "HeadlessMapper.h"
+
+#include <exception>
+#include <memory>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include "../clock/mumeclock.h"
+#include "../display/prespammedpath.h"
+#include "../expandoracommon/parseevent.h"
+#include "../global/roomid.h"
+#include "../logger/autologger.h"
+#include "../mapdata/ExitDirection.h"
+#include "../mapdata/ShortestPathService.h"
+#include "../mapdata/mapdata.h"
+#include "../mapdata/roomselection.h"
+#include "../mapstorage/PandoraMapStorage.h"
+#include "../mapstorage/XmlMapStorage.h"
+#include "../mapstorage/abstractmapstorage.h"
+#include "../mapstorage/mapstorage.h"
+#include "../observer/gameobserver.h"
+#include "../parser/CommandQueue.h"
+#include "../parser/DoorAction.h"
+#include "../pathmachine/mmapper2pathmachine.h"
+#include "../proxy/connectionlistener.h"
+#include "../proxy/telnetfilter.h"
+
+HeadlessMapper::HeadlessMapper(QObject *const parent)
+    : QObject(parent)
+{
+    setObjectName("HeadlessMapper");
+
+    qRegisterMetaType<RoomId>("RoomId");
+    qRegisterMetaType<TelnetData>("TelnetData");
+    qRegisterMetaType<CommandQueue>("CommandQueue");
+    qRegisterMetaType<DoorActionEnum>("DoorActionEnum");
+    qRegisterMetaType<ExitDirEnum>("ExitDirEnum");
+    qRegisterMetaType<GroupManagerStateEnum>("GroupManagerStateEnum");
+    qRegisterMetaType<SigParseEvent>("SigParseEvent");
+    qRegisterMetaType<SigRoomSelection>("SigRoomSelection");
+    qRegisterMetaType<ShortestPathResult>("ShortestPathResult");
+
+    // The editor of a remote editing session is a widget.
+    setConfig().mumeClientProtocol.remoteEditing = false;
+
+    m_mapData = new MapData(this);
+    m_mapData->setObjectName("MapData");
+    m_prespammedPath = new PrespammedPath(this);
+    m_groupManager = new Mmapper2Group(this);
+    m_groupManager->setObjectName("GroupManager");
+    m_pathMachine = new Mmapper2PathMachine(m_mapData, this);
+    m_pathMachine->setObjectName("Mmapper2PathMachine");
+    m_gameObserver = new GameObserver(this);
+    m_mumeClock = new MumeClock(getConfig().mumeClock.startEpoch, *m_gameObserver, this);
+
+    m_logger = new AutoLogger(this);
+    connect(m_gameObserver, &GameObserver::sig_connected, m_logger, &AutoLogger::slot_onConnected);
+    connect(m_gameObserver,
+            &GameObserver::sig_toggledEchoMode,
+            m_logger,
+            &AutoLogger::slot_shouldLog);
+    connect(m_gameObserver,
+            &GameObserver::sig_sentToMudString,
+            m_logger,
+            &AutoLogger::slot_writeToLog);
+    connect(m_gameObserver,
+            &GameObserver::sig_sentToUserString,
+            m_logger,
+            &AutoLogger::slot_writeToLog);
+
+    m_listener = new ConnectionListener(*m_mapData,
+                                        *m_pathMachine,
+                                        *m_prespammedPath,
+                                        *m_groupManager,
+                                        *m_mumeClock,
+                                        *m_gameObserver,
+                                        this);
+
+    wireConnections();
+    slot_setMode(getConfig().general.mapMode);
+}
+
+HeadlessMapper::~HeadlessMapper() = default;
+
+void HeadlessMapper::wireConnections()
+{
+    // The same wiring as MainWindow::wireConnections(), minus the canvas and widgets.
+    connect(m_pathMachine, &Mmapper2PathMachine::sig_log, this, &HeadlessMapper::slot_log);
+    connect(m_pathMachine,
+            QOverload<RoomRecipient &, const Coordinate &>::of(
+                &Mmapper2PathMachine::sig_lookingForRooms),
+            m_mapData,
+            QOverload<RoomRecipient &, const Coordinate &>::of(&MapData::lookingForRooms));
+    connect(m_pathMachine,
+            QOverload<RoomRecipient &, const Coordinate &, int>::of(
+                &Mmapper2PathMachine::sig_lookingForRooms),
+            m_mapData,
+            QOverload<RoomRecipient &, const Coordinate &, int>::of(&MapData::lookingForRooms));
+    connect(m_pathMachine,
+            QOverload<RoomRecipient &, const SigParseEvent &>::of(
+                &Mmapper2PathMachine::sig_lookingForRooms),
+            m_mapData,
+            QOverload<RoomRecipient &, const SigParseEvent &>::of(&MapData::lookingForRooms));
+    connect(m_pathMachine,
+            QOverload<RoomRecipient &, RoomId>::of(&Mmapper2PathMachine::sig_lookingForRooms),
+            m_mapData,
+            QOverload<RoomRecipient &, RoomId>::of(&MapData::lookingForRooms));
+    connect(m_mapData,
+            &MapFrontend::sig_clearingMap,
+            m_pathMachine,
+            &PathMachine::slot_releaseAllPaths);
+    connect(m_mapData, &MapData::sig_log, this, &HeadlessMapper::slot_log);
+
+    connect(m_groupManager, &Mmapper2Group::sig_log, this, &HeadlessMapper::slot_log);
+    connect(m_groupManager,
+            &Mmapper2Group::sig_messageBox,
+            this,
+            &HeadlessMapper::slot_log,
+            Qt::QueuedConnection);
+    connect(m_pathMachine,
+            &PathMachine::sig_setCharPosition,
+            m_groupManager,
+            &Mmapper2Group::slot_setCharacterRoomId,
+            Qt::QueuedConnection);
+    connect(this,
+            &HeadlessMapper::sig_setGroupMode,
+            m_groupManager,
+            &Mmapper2Group::slot_setMode,
+            Qt::QueuedConnection);
+    connect(this,
+            &HeadlessMapper::sig_startGroupNetwork,
+            m_groupManager,
+            &Mmapper2Group::slot_startNetwork,
+            Qt::QueuedConnection);
+
+    connect(m_mumeClock, &MumeClock::sig_log, this, &HeadlessMapper::slot_log);
+    connect(m_listener, &ConnectionListener::sig_log, this, &HeadlessMapper::slot_log);
+    connect(m_listener, &ConnectionListener::sig_setMode, this, &HeadlessMapper::slot_setMode);
+}
+
+void HeadlessMapper::slot_log(const QString &module, const QString &message)
+{
+    qInfo().noquote() << QString("[%1] %2").arg(module, message);
+}
+
+void HeadlessMapper::slot_setMode(const MapModeEnum mode)
+{
+    // Unique connections, since the mode can be set again while already in it.
+    if (mode == MapModeEnum::MAP) {
+        slot_log("HeadlessMapper",
+                 "Map mode selected - new rooms are created, but the map is never saved.");
+        connect(m_pathMachine,
+                &Mmapper2PathMachine::sig_createRoom,
+                m_mapData,
+                &MapData::slot_createRoom,
+                Qt::UniqueConnection);
+        connect(m_pathMachine,
+                &Mmapper2PathMachine::sig_scheduleAction,
+                m_mapData,
+                &MapData::slot_scheduleAction,
+                Qt::UniqueConnection);
+    } else {
+        disconnect(m_pathMachine,
+                   &Mmapper2PathMachine::sig_createRoom,
+                   m_mapData,
+                   &MapData::slot_createRoom);
+        disconnect(m_pathMachine,
+                   &Mmapper2PathMachine::sig_scheduleAction,
+                   m_mapData,
+                   &MapData::slot_scheduleAction);
+    }
+    setConfig().general.mapMode = mode;
+}
+
+bool HeadlessMapper::loadAutoloadMap()
+{
+    const auto &settings = getConfig().autoLoad;
+    if (!settings.autoLoadMap) {
+        slot_log("HeadlessMapper", "Autoloading a map is disabled.");
+        return false;
+    }
+    if (!settings.fileName.isEmpty()) {
+        const QString fileName = QFileInfo{settings.fileName}.isAbsolute()
+                                     ? settings.fileName
+                                     : QDir{settings.lastMapDirectory}.absoluteFilePath(
+                                         settings.fileName);
+        if (QFile{fileName}.exists())
+            return loadFile(fileName);
+    }
+    if (!NO_MAP_RESOURCE)
+        return loadFile(":/arda.mm2");
+    slot_log("HeadlessMapper", "Unable to autoload a map.");
+    return false;
+}
+
+bool HeadlessMapper::loadFile(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QFile::ReadOnly)) {
+        slot_log("HeadlessMapper",
+                 QString("Cannot read file %1: %2.").arg(fileName, file.errorString()));
+        return false;
+    }
+
+    // Parented to this rather than a widget, so load errors are only logged.
+    const auto storage = [this, &fileName, &file]() -> std::unique_ptr<AbstractMapStorage> {
+        const QString fileNameLower = fileName.toLower();
+        if (fileNameLower.endsWith(".xml"))
+            return std::make_unique<PandoraMapStorage>(*m_mapData, fileName, &file, this);
+        if (fileNameLower.endsWith(".mm2xml"))
+            return std::make_unique<XmlMapStorage>(*m_mapData, fileName, &file, this);
+        return std::make_unique<MapStorage>(*m_mapData, fileName, &file, this);
+    }();
+    connect(storage.get(), &AbstractMapStorage::sig_log, this, &HeadlessMapper::slot_log);
+    connect(storage.get(), &AbstractMapStorage::sig_onDataLoaded, this, [this]() {
+        m_mapData->updateLandmarks();
+    });
+
+    if (!storage->canLoad() || !storage->loadData()) {
+        slot_log("HeadlessMapper", QString("Failed to load file %1.").arg(fileName));
+        return false;
+    }
+    slot_log("HeadlessMapper", QString("Loaded %1.").arg(fileName));
+    return true;
+}
+
+bool HeadlessMapper::startServices()
+{
+    try {
+        m_listener->listen();
+        slot_log("ConnectionListener",
+                 QString("Server bound on localhost to port: %1.")
+                     .arg(getConfig().connection.localPort));
+    } catch (const std::exception &e) {
+        slot_log("ConnectionListener",
+                 QString("Unable to start the server: %1.").arg(QString::fromLatin1(e.what())));
+        return false;
+    }
+
+    m_groupManager->start();
+    const auto &groupConfig = getConfig().groupManager;
+    if (groupConfig.state != GroupManagerStateEnum::Off) {
+        emit sig_setGroupMode(groupConfig.state);
+        if (groupConfig.autoStart)
+            emit sig_startGroupNetwork();
+    }
+    return true;
+}
@@ -0,0 +1,65 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <QObject>
+#include <QString>
+#include <QtCore>
+
+#include "../configuration/configuration.h"
+#include "../global/macros.h"
+#include "../pandoragroup/mmapper2group.h"
+
+class AutoLogger;
+class ConnectionListener;
+class GameObserver;
+class MapData;
+class Mmapper2PathMachine;
+class MumeClock;
+class PrespammedPath;
+
+/**
+ * Runs the proxy, the path machine and the group manager without any window:
+ * what MainWindow sets up minus the widgets, the canvas and its GL context.
+ *
+ * Everything comes from the configuration (see --config in main.cpp): the
+ * map is the autoload map, and the mode and group settings are the saved
+ * ones. Remote editing is disabled since its editor is a widget, and map
+ * changes made in map mode are never saved. Log messages go to the console.
+ */
+class HeadlessMapper final : public QObject
+{
+    Q_OBJECT
+
+private:
+    MapData *m_mapData = nullptr;
+    Mmapper2PathMachine *m_pathMachine = nullptr;
+    PrespammedPath *m_prespammedPath = nullptr;
+    Mmapper2Group *m_groupManager = nullptr;
+    GameObserver *m_gameObserver = nullptr;
+    MumeClock *m_mumeClock = nullptr;
+    AutoLogger *m_logger = nullptr;
+    ConnectionListener *m_listener = nullptr;
+
+public:
+    explicit HeadlessMapper(QObject *parent = nullptr);
+    ~HeadlessMapper() final;
+
+public:
+    // Loads the autoload map; returns false if there was none to load.
+    NODISCARD bool loadAutoloadMap();
+    NODISCARD bool loadFile(const QString &fileName);
+    // Binds the proxy's port and starts the group manager.
+    NODISCARD bool startServices();
+
+signals:
+    void sig_setGroupMode(GroupManagerStateEnum);
+    void sig_startGroupNetwork();
+
+public slots:
+    void slot_log(const QString &module, const QString &message);
+    void slot_setMode(MapModeEnum mode);
+
+private:
+    void wireConnections();
+};
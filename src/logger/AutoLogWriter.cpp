@@ -0,0 +1,244 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "AutoLogWriter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+#include <vector>
+#include <QDate>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include "../global/TextUtils.h"
+
+// Lines wait at most this long before they're written, so bursts are batched.
+static constexpr const auto MAX_WRITE_DELAY = std::chrono::milliseconds(100);
+
+AutoLogWriter::AutoLogWriter(std::string runId)
+    : m_runId{std::move(runId)}
+{
+    m_thread = std::thread([this]() { run(); });
+}
+
+AutoLogWriter::~AutoLogWriter()
+{
+    // Everything written so far still goes to the file.
+    while (!m_overflow.empty()) {
+        if (m_ring.tryPush(std::move(m_overflow.front())))
+            m_overflow.pop_front();
+        else
+            std::this_thread::yield();
+        m_wakeup.notify_one();
+    }
+    m_stop.store(true, std::memory_order_release);
+    m_wakeup.notify_one();
+    m_thread.join();
+}
+
+void AutoLogWriter::open(const QString &directory)
+{
+    push(Entry{Entry::KindEnum::OPEN, ::toStdStringUtf8(directory)});
+}
+
+void AutoLogWriter::write(std::string line)
+{
+    push(Entry{Entry::KindEnum::LINE, std::move(line)});
+}
+
+void AutoLogWriter::cleanup(const QString &directory, const Retention &retention)
+{
+    Entry entry;
+    entry.kind = Entry::KindEnum::CLEANUP;
+    entry.text = ::toStdStringUtf8(directory);
+    entry.retention = retention;
+    push(std::move(entry));
+}
+
+void AutoLogWriter::deleteLogs(const QStringList &files)
+{
+    Entry entry;
+    entry.kind = Entry::KindEnum::REMOVE;
+    entry.files = files;
+    push(std::move(entry));
+}
+
+void AutoLogWriter::push(Entry entry)
+{
+    while (!m_overflow.empty() && m_ring.tryPush(std::move(m_overflow.front())))
+        m_overflow.pop_front();
+    if (!m_overflow.empty() || !m_ring.tryPush(std::move(entry)))
+        m_overflow.emplace_back(std::move(entry));
+    m_wakeup.notify_one();
+}
+
+void AutoLogWriter::run()
+{
+    Entry entry;
+    while (true) {
+        // Anything pushed before the stop request is still written.
+        const bool stopping = m_stop.load(std::memory_order_acquire);
+        while (m_ring.tryPop(entry)) {
+            process(entry);
+        }
+        flushBatch();
+        if (stopping)
+            break;
+
+        std::unique_lock<std::mutex> lock{m_mutex};
+        m_wakeup.wait_for(lock, MAX_WRITE_DELAY);
+    }
+    m_logFile.close();
+}
+
+void AutoLogWriter::process(Entry &entry)
+{
+    switch (entry.kind) {
+    case Entry::KindEnum::OPEN:
+        flushBatch();
+        m_directory = std::move(entry.text);
+        if (!createFile())
+            emit sig_writeFailed("Unable to create log file.");
+        break;
+
+    case Entry::KindEnum::CLEANUP:
+        flushBatch();
+        findOldLogs(::toQStringUtf8(entry.text), entry.retention);
+        break;
+
+    case Entry::KindEnum::REMOVE:
+        removeLogs(entry.files);
+        break;
+
+    case Entry::KindEnum::LINE:
+        if (!m_logFile.is_open())
+            break;
+        if (m_curBytes > m_rotateBytes.load(std::memory_order_relaxed)) {
+            flushBatch();
+            if (!createFile()) {
+                emit sig_writeFailed("Unable to create log file.");
+                break;
+            }
+        }
+        m_batch += entry.text;
+        m_curBytes += static_cast<int>(entry.text.length());
+        break;
+    }
+}
+
+void AutoLogWriter::flushBatch()
+{
+    if (m_batch.empty())
+        return;
+    if (m_logFile.is_open()) {
+        m_logFile.write(m_batch.data(), static_cast<std::streamsize>(m_batch.size()));
+        m_logFile.flush();
+    }
+    m_batch.clear();
+}
+
+bool AutoLogWriter::createFile()
+{
+    if (m_logFile.is_open())
+        m_logFile.close();
+
+    const QString path = ::toQStringUtf8(m_directory);
+    QDir dir;
+    if (dir.mkpath(path))
+        dir.setPath(path);
+    else
+        return false;
+
+    QString fileName = QString("MMapper_Log_%1_%2_%3.txt")
+                           .arg(QDate::currentDate().toString("yyyy_MM_dd"))
+                           .arg(QString::number(m_curFile))
+                           .arg(::toQStringUtf8(m_runId));
+    m_logFile.open(::toStdStringUtf8(dir.absoluteFilePath(fileName)),
+                   std::fstream::out | std::fstream::binary | std::fstream::app);
+    if (!m_logFile.is_open()) // Could not create file.
+        return false;
+
+    m_curBytes = 0;
+    m_curFile++;
+
+    return true;
+}
+
+void AutoLogWriter::findOldLogs(const QString &directory, const Retention &retention)
+{
+    if (retention.cleanupStrategy == AutoLoggerEnum::KeepForever)
+        return;
+
+    if (directory != m_indexDirectory) {
+        m_index.clear();
+        m_indexDirectory = directory;
+    }
+
+    // Only the names are listed; a file is only stat'ed the first time it's seen,
+    // or while it's from today and may still be growing.
+    const QDir dir(directory);
+    const QString today = QDate::currentDate().toString("yyyy_MM_dd");
+    std::map<QString, IndexedLog> index;
+    for (const QString &name : dir.entryList(QStringList("MMapper_Log_*.txt"), QDir::Files)) {
+        const auto it = m_index.find(name);
+        if (it != m_index.end() && !name.contains(today)) {
+            index.emplace(name, it->second);
+            continue;
+        }
+        const QFileInfo fileInfo(dir, name);
+        index.emplace(name, IndexedLog{fileInfo.birthTime(), fileInfo.size()});
+    }
+    m_index = std::move(index);
+
+    // Sort files so we can delete the oldest
+    std::vector<std::pair<QString, IndexedLog>> logs(m_index.begin(), m_index.end());
+    std::sort(logs.begin(), logs.end(), [](const auto &a, const auto &b) {
+        return a.second.birthTime < b.second.birthTime;
+    });
+
+    qint64 totalFileSize = 0, deleteFileSize = 0;
+    QStringList filesToDelete;
+    const QDate &todayDate = QDate::currentDate();
+    for (const auto &[name, log] : logs) {
+        totalFileSize += log.size;
+        bool deleteFile = false;
+        switch (retention.cleanupStrategy) {
+        case AutoLoggerEnum::DeleteDays:
+            if (log.birthTime.date().daysTo(todayDate) >= retention.deleteWhenLogsReachDays)
+                deleteFile = true;
+            break;
+        case AutoLoggerEnum::DeleteSize:
+            if (totalFileSize >= retention.deleteWhenLogsReachBytes)
+                deleteFile = true;
+            break;
+        case AutoLoggerEnum::KeepForever:
+            break;
+        default:
+            abort();
+        }
+        if (deleteFile) {
+            deleteFileSize += log.size;
+            filesToDelete.append(dir.absoluteFilePath(name));
+        }
+    }
+
+    if (filesToDelete.empty())
+        return;
+
+    if (retention.askDelete)
+        emit sig_oldLogsFound(filesToDelete, deleteFileSize);
+    else
+        removeLogs(filesToDelete);
+}
+
+void AutoLogWriter::removeLogs(const QStringList &files)
+{
+    for (const QString &filepath : files) {
+        QFile::remove(filepath);
+        m_index.erase(QFileInfo(filepath).fileName());
+        qDebug() << "Deleted log " + filepath + ".";
+    }
+}
@@ -0,0 +1,111 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <QDateTime>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+#include "../configuration/configuration.h"
+#include "../global/RuleOf5.h"
+#include "../global/SpscRing.h"
+#include "../global/macros.h"
+
+// Writes the auto log on its own thread, so a slow disk never holds up the display.
+// Lines are handed over through a lock-free ring and written in batches; the file
+// is created and rotated on the writer thread too.
+//
+// Old logs are cleaned up on the same thread, between writes, from an index of the
+// log directory that only stats the files it hasn't seen before.
+//
+// Signals are emitted from the writer thread.
+class AutoLogWriter final : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct NODISCARD Retention final
+    {
+        AutoLoggerEnum cleanupStrategy = AutoLoggerEnum::KeepForever;
+        int deleteWhenLogsReachDays = 0;
+        int deleteWhenLogsReachBytes = 0;
+        bool askDelete = false;
+    };
+
+private:
+    struct NODISCARD Entry final
+    {
+        enum class NODISCARD KindEnum : uint8_t { LINE, OPEN, CLEANUP, REMOVE };
+        KindEnum kind = KindEnum::LINE;
+        // The line, or the log directory.
+        std::string text;
+        Retention retention;
+        QStringList files;
+    };
+
+    struct NODISCARD IndexedLog final
+    {
+        QDateTime birthTime;
+        qint64 size = 0;
+    };
+
+    const std::string m_runId;
+
+    SpscRing<Entry, 1024> m_ring;
+    // Entries that didn't fit in the ring yet; only touched by the producer.
+    std::deque<Entry> m_overflow;
+    std::atomic<int> m_rotateBytes{0};
+    std::atomic<bool> m_stop{false};
+    std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+
+    // Only touched by the writer thread.
+    std::fstream m_logFile;
+    std::string m_directory;
+    std::string m_batch;
+    int m_curBytes = 0;
+    int m_curFile = 0;
+    QString m_indexDirectory;
+    std::map<QString, IndexedLog> m_index;
+
+    std::thread m_thread;
+
+public:
+    explicit AutoLogWriter(std::string runId);
+    ~AutoLogWriter() final;
+    DELETE_CTORS_AND_ASSIGN_OPS(AutoLogWriter);
+
+public:
+    // Starts a new file in the directory; lines written before the first open are dropped.
+    void open(const QString &directory);
+    void write(std::string line);
+    void setRotateBytes(int bytes) { m_rotateBytes.store(bytes, std::memory_order_relaxed); }
+
+    // Finds the logs the retention settings no longer keep. They are deleted at once,
+    // unless the user should be asked first; then sig_oldLogsFound() is emitted.
+    void cleanup(const QString &directory, const Retention &retention);
+    void deleteLogs(const QStringList &files);
+
+signals:
+    void sig_writeFailed(const QString &message);
+    void sig_oldLogsFound(const QStringList &files, qint64 bytes);
+
+private:
+    void push(Entry entry);
+    void run();
+    void process(Entry &entry);
+    void flushBatch();
+    NODISCARD bool createFile();
+    void findOldLogs(const QString &directory, const Retention &retention);
+    void removeLogs(const QStringList &files);
+};
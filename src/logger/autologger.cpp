@@ -8,11 +8,9 @@
 #include "../global/TextUtils.h"
 #include "../global/random.h"
 
-#include <algorithm>
 #include <cstdint>
 #include <sstream>
 #include <QDebug>
-#include <QFileInfo>
 #include <QMessageBox>
 #include <QStringList>
 
@@ -27,42 +25,43 @@ NODISCARD static std::string generateRunId()
 
 AutoLogger::AutoLogger(QObject *const parent)
     : QObject(parent)
-    , m_runId{generateRunId()}
-{}
-
-AutoLogger::~AutoLogger()
+    , m_writer{generateRunId()}
 {
-    m_logFile.flush();
-    m_logFile.close();
+    // The writer emits from its own thread.
+    connect(&m_writer,
+            &AutoLogWriter::sig_writeFailed,
+            this,
+            &AutoLogger::slot_onWriteFailed,
+            Qt::QueuedConnection);
+    connect(&m_writer,
+            &AutoLogWriter::sig_oldLogsFound,
+            this,
+            &AutoLogger::slot_onOldLogsFound,
+            Qt::QueuedConnection);
 }
 
-bool AutoLogger::createFile()
-{
-    if (m_logFile.is_open())
-        m_logFile.close();
-
-    const auto &settings = getConfig().autoLog;
-
-    const auto &path = settings.autoLogDirectory;
-    QDir dir;
-    if (dir.mkpath(path))
-        dir.setPath(path);
-    else
-        return false;
+AutoLogger::~AutoLogger() = default;
 
-    QString fileName = QString("MMapper_Log_%1_%2_%3.txt")
-                           .arg(QDate::currentDate().toString("yyyy_MM_dd"))
-                           .arg(QString::number(m_curFile))
-                           .arg(::toQStringUtf8(m_runId));
-    m_logFile.open(::toStdStringUtf8(dir.absoluteFilePath(fileName)),
-                   std::fstream::out | std::fstream::binary | std::fstream::app);
-    if (!m_logFile.is_open()) // Could not create file.
-        return false;
-
-    m_curBytes = 0;
-    m_curFile++;
+void AutoLogger::openFile()
+{
+    m_writer.open(getConfig().autoLog.autoLogDirectory);
+    m_fileOpened = true;
+}
 
-    return true;
+void AutoLogger::slot_onWriteFailed(const QString &message)
+{
+    m_fileOpened = false;
+    if (!getConfig().autoLog.autoLog)
+        return;
+    setConfig().autoLog.autoLog = false;
+    auto *const widget = qobject_cast<QWidget *>(parent()); // MainWindow, unless headless
+    if (widget == nullptr) {
+        qWarning().noquote() << message << "Logging has been disabled.";
+        return;
+    }
+    QMessageBox::warning(widget,
+                         "MMapper AutoLogger",
+                         QString("%1\n\nLogging has been disabled.").arg(message));
 }
 
 bool AutoLogger::writeLine(const QString &str)
@@ -70,111 +69,42 @@ bool AutoLogger::writeLine(const QString &str)
     if (!m_shouldLog || !getConfig().autoLog.autoLog)
         return false;
 
-    bool created = true;
-    if (!m_logFile.is_open()) {
-        created = createFile();
-
-    } else if (m_curBytes > getConfig().autoLog.rotateWhenLogsReachBytes) {
-        m_logFile.close();
-        created = createFile();
-    }
-    if (!created) {
-        setConfig().autoLog.autoLog = false;
-        QMessageBox::warning(checked_dynamic_downcast<QWidget *>(parent()), // MainWindow
-                             "MMapper AutoLogger",
-                             "Unable to create log file.\n\nLogging has been disabled.");
-        return false;
-    }
+    if (!m_fileOpened)
+        openFile();
 
     // ANSI marks removed upstream by GameObserver
-    const auto &line = ::toStdStringUtf8(str);
-
-    m_logFile << line;
-    m_logFile.flush();
-    m_curBytes += static_cast<int>(line.length());
-
+    m_writer.setRotateBytes(getConfig().autoLog.rotateWhenLogsReachBytes);
+    m_writer.write(::toStdStringUtf8(str));
     return true;
 }
 
-void AutoLogger::deleteOldLogs()
+void AutoLogger::slot_onOldLogsFound(const QStringList &files, const qint64 bytes)
 {
-    auto &conf = getConfig().autoLog;
-
-    if (conf.cleanupStrategy == AutoLoggerEnum::KeepForever)
-        return;
-
-    auto fileInfoList = QDir(conf.autoLogDirectory)
-                            .entryInfoList(QStringList("MMapper_Log_*.txt"), QDir::Files);
-    if (fileInfoList.empty())
-        return;
-
-    // Sort files so we can delete the oldest
-    std::sort(fileInfoList.begin(), fileInfoList.end(), [](const auto &a, const auto &b) {
-        return a.birthTime() < b.birthTime();
-    });
-
-    qint64 totalFileSize = 0, deleteFileSize = 0;
-    QList<QFileInfo> filesToDelete;
-    const QDate &today = QDate::currentDate();
-    for (const auto &fileInfo : fileInfoList) {
-        totalFileSize += fileInfo.size();
-        bool deleteFile = false;
-        switch (conf.cleanupStrategy) {
-        case AutoLoggerEnum::DeleteDays:
-            if (fileInfo.birthTime().date().daysTo(today) >= conf.deleteWhenLogsReachDays)
-                deleteFile = true;
-            break;
-        case AutoLoggerEnum::DeleteSize:
-            if (totalFileSize >= conf.deleteWhenLogsReachBytes)
-                deleteFile = true;
-            break;
-        case AutoLoggerEnum::KeepForever:
-            break;
-        default:
-            abort();
-        }
-        if (deleteFile) {
-            deleteFileSize += fileInfo.size();
-            filesToDelete.append(fileInfo);
-        }
+    QString unit = "KB";
+    QStringList list = {"MB", "GB", "TB"};
+    QStringListIterator it(list);
+    auto num = static_cast<double>(bytes / 1024);
+    while (num > 1024.0 && it.hasNext()) {
+        unit = it.next();
+        num /= 1024.0;
     }
-
-    if (filesToDelete.empty())
+    if (!showDeleteDialog(QString("There are %1 %2 of old logs.\n\nDo you want to delete them?")
+                              .arg(QString::number(num, 'f', 1))
+                              .arg(unit)))
         return;
 
-    if (conf.askDelete) {
-        QString unit = "KB";
-        QStringList list = {"MB", "GB", "TB"};
-        QStringListIterator it(list);
-        auto num = static_cast<double>(deleteFileSize / 1024);
-        while (num > 1024.0 && it.hasNext()) {
-            unit = it.next();
-            num /= 1024.0;
-        }
-        if (!showDeleteDialog(QString("There are %1 %2 of old logs.\n\nDo you want to delete them?")
-                                  .arg(QString::number(num, 'f', 1))
-                                  .arg(unit)))
-            return;
-    }
-
-    QFileInfoList fileList(filesToDelete);
-    deleteLogs(fileList);
-}
-
-void AutoLogger::deleteLogs(const QFileInfoList &files)
-{
-    for (const auto &fileInfo : files) {
-        QString filepath = fileInfo.absoluteFilePath();
-        QDir deletefile;
-        deletefile.setPath(filepath);
-        deletefile.remove(filepath);
-        qDebug() << "Deleted log " + filepath + ".";
-    }
+    m_writer.deleteLogs(files);
 }
 
 bool AutoLogger::showDeleteDialog(QString message)
 {
-    QMessageBox msgBox(checked_dynamic_downcast<QWidget *>(parent())); // MainWindow
+    auto *const widget = qobject_cast<QWidget *>(parent()); // MainWindow, unless headless
+    if (widget == nullptr) {
+        // Nobody to ask, so old logs are kept.
+        qInfo().noquote() << message.left(message.indexOf('\n'));
+        return false;
+    }
+    QMessageBox msgBox(widget);
     msgBox.setText(message);
     msgBox.setWindowTitle("MMapper AutoLogger");
     msgBox.setStandardButtons(QMessageBox::No | QMessageBox::Yes);
@@ -196,11 +126,17 @@ void AutoLogger::slot_shouldLog(bool echo)
 
 void AutoLogger::slot_onConnected()
 {
-    if (getConfig().autoLog.cleanupStrategy != AutoLoggerEnum::KeepForever)
-        deleteOldLogs();
-
-    if (getConfig().autoLog.autoLog) {
-        if (!createFile())
-            qWarning() << "Unable to create log file for autologger.";
+    const auto &conf = getConfig().autoLog;
+    if (conf.cleanupStrategy != AutoLoggerEnum::KeepForever) {
+        AutoLogWriter::Retention retention;
+        retention.cleanupStrategy = conf.cleanupStrategy;
+        retention.deleteWhenLogsReachDays = conf.deleteWhenLogsReachDays;
+        retention.deleteWhenLogsReachBytes = conf.deleteWhenLogsReachBytes;
+        retention.askDelete = conf.askDelete;
+        m_writer.cleanup(conf.autoLogDirectory, retention);
     }
+
+    // Each connection starts a new file.
+    if (getConfig().autoLog.autoLog)
+        openFile();
 }
@@ -3,12 +3,12 @@
 // Copyright (C) 2019 The MMapper Authors
 // Author: Mattias 'Mew_' Viklund <devmew@exedump.com> (Mirnir)
 
-#include <fstream>
-#include <string>
-#include <QFileInfoList>
 #include <QObject>
+#include <QString>
+#include <QStringList>
 
 #include "../global/macros.h"
+#include "AutoLogWriter.h"
 
 class AutoLogger final : public QObject
 {
@@ -22,17 +22,17 @@ public slots:
     void slot_shouldLog(bool echo);
     void slot_onConnected();
 
+private slots:
+    void slot_onWriteFailed(const QString &message);
+    void slot_onOldLogsFound(const QStringList &files, qint64 bytes);
+
 private:
     NODISCARD bool writeLine(const QString &str);
-    void deleteOldLogs();
-    void deleteLogs(const QFileInfoList &files);
     NODISCARD bool showDeleteDialog(QString message);
-    NODISCARD bool createFile();
+    void openFile();
 
 private:
-    const std::string m_runId;
-    std::fstream m_logFile;
-    int m_curBytes = 0;
-    int m_curFile = 0;
+    AutoLogWriter m_writer;
+    bool m_fileOpened = false;
     bool m_shouldLog = true;
 };
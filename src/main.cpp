@@ -4,21 +4,28 @@
 // Author: Marek Krejza <krejza@gmail.com> (Caligor)
 // Author: Nils Schimmelmann <nschimme@gmail.com> (Jahara)
 
+#include <cstring>
 #include <memory>
 #include <optional>
 #include <set>
 #include <thread>
+#include <QHostAddress>
 #include <QPixmap>
+#include <QTcpSocket>
 #include <QtCore>
 #include <QtWidgets>
 
 #include "configuration/configuration.h"
 #include "display/Filenames.h"
 #include "global/Debug.h"
+#include "global/EventLoopWatchdog.h"
+#include "global/StartupProfiler.h"
 #include "global/Version.h"
 #include "global/WinSock.h"
 #include "global/utils.h"
+#include "headless/HeadlessMapper.h"
 #include "mainwindow/mainwindow.h"
+#include "proxy/SessionReplay.h"
 
 #ifdef WITH_DRMINGW
 #include <exchndl.h>
@@ -140,6 +147,20 @@ static void tryAutoLoad(MainWindow &mw)
     }
 }
 
+// The map canvas uses the GL 3.3 core backend on these contexts.
+NODISCARD static bool canCreateCoreProfile(QSurfaceFormat fmt)
+{
+    fmt.setVersion(3, 3);
+    fmt.setProfile(QSurfaceFormat::CoreProfile);
+    QOpenGLContext context;
+    context.setFormat(fmt);
+    if (!context.create())
+        return false;
+    const QSurfaceFormat actual = context.format();
+    return actual.version() >= qMakePair(3, 3)
+           && actual.profile() == QSurfaceFormat::CoreProfile;
+}
+
 static void setSurfaceFormat()
 {
     const auto &config = getConfig().canvas;
@@ -160,11 +181,118 @@ static void setSurfaceFormat()
     fmt.setOptions(options);
     fmt.setSamples(config.antialiasingSamples);
     fmt.setDepthBufferSize(24);
+    if (!config.softwareOpenGL && canCreateCoreProfile(fmt)) {
+        fmt.setVersion(3, 3);
+        fmt.setProfile(QSurfaceFormat::CoreProfile);
+    }
     QSurfaceFormat::setDefaultFormat(fmt);
 }
 
+NODISCARD static bool hasArgument(const int argc, char **const argv, const char *const arg)
+{
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], arg) == 0)
+            return true;
+    }
+    return false;
+}
+
+static void tryEnableStartupProfiler(const int argc, char **const argv)
+{
+    if (hasArgument(argc, argv, "--profile-startup"))
+        startup_profiler::enable();
+}
+
+NODISCARD static const char *getArgumentValue(const int argc,
+                                              char **const argv,
+                                              const char *const arg)
+{
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::strcmp(argv[i], arg) == 0)
+            return argv[i + 1];
+    }
+    return nullptr;
+}
+
+// "--config <file>" reads (and writes) the settings from an INI file instead;
+// this must run before the configuration is first used.
+static void trySetConfigFile(const int argc, char **const argv)
+{
+    if (const char *const fileName = getArgumentValue(argc, argv, "--config"))
+        qputenv("MMAPPER_PROFILE_PATH", fileName);
+}
+
+// "--record <file>" records what MUME sends; "--replay <file> [--speed 10x]"
+// plays such a recording back instead of connecting to MUME.
+static void trySetReplayOptions(const int argc, char **const argv, const bool headless)
+{
+    session_replay::Options options;
+    if (const char *const fileName = getArgumentValue(argc, argv, "--record"))
+        options.recordFile = QString::fromLocal8Bit(fileName);
+    if (const char *const fileName = getArgumentValue(argc, argv, "--replay"))
+        options.replayFile = QString::fromLocal8Bit(fileName);
+    if (const char *const speed = getArgumentValue(argc, argv, "--speed")) {
+        QString str = QString::fromLatin1(speed);
+        if (str.endsWith('x'))
+            str.chop(1);
+        bool ok = false;
+        const double value = str.toDouble(&ok);
+        if (ok && value >= 0.0)
+            options.speed = value;
+        else
+            qWarning() << "[main] Ignoring invalid replay speed" << speed;
+    }
+    options.quitWhenDone = headless && !options.replayFile.isEmpty();
+    session_replay::setOptions(options);
+}
+
+// "--headless" runs the proxy, path machine and group manager without any window.
+NODISCARD static int runHeadless(int argc, char **argv)
+{
+    // Nothing is drawn, so no display is needed either.
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication app(argc, argv);
+    tryInitDrMingw();
+    auto tryLoadingWinSock = std::make_unique<WinSock>();
+
+    event_loop_watchdog::start();
+    event_loop_watchdog::watchCurrentThread("main");
+
+    HeadlessMapper mapper;
+    MAYBE_UNUSED const bool loaded = mapper.loadAutoloadMap();
+    if (!mapper.startServices()) {
+        event_loop_watchdog::stop();
+        return 1;
+    }
+
+    // A replay needs a session, so it gets a client that ignores what it's sent.
+    QTcpSocket replayClient;
+    if (session_replay::isReplaying()) {
+        QObject::connect(&replayClient, &QIODevice::readyRead, &replayClient, [&replayClient]() {
+            MAYBE_UNUSED const auto ignored = replayClient.readAll();
+        });
+        replayClient.connectToHost(QHostAddress::LocalHost, getConfig().connection.localPort);
+    }
+    const int ret = QApplication::exec();
+    event_loop_watchdog::stop();
+    // The settings are the operator's; nothing changed here is written back.
+    return ret;
+}
+
 int main(int argc, char **argv)
 {
+    trySetConfigFile(argc, argv);
+    const bool headless = hasArgument(argc, argv, "--headless");
+    trySetReplayOptions(argc, argv, headless);
+    if (headless) {
+        setEnteredMain();
+        return runHeadless(argc, argv);
+    }
+
+    tryEnableStartupProfiler(argc, argv);
+    startup_profiler::mark(StartupPhaseEnum::MAIN);
     useHighDpi();
     setHighDpiScaleFactorRoundingPolicy();
     setEnteredMain();
@@ -176,21 +304,29 @@ int main(int argc, char **argv)
     }
 
     QApplication app(argc, argv);
+    startup_profiler::mark(StartupPhaseEnum::APPLICATION);
+    event_loop_watchdog::start();
+    event_loop_watchdog::watchCurrentThread("GUI");
     tryInitDrMingw();
     auto tryLoadingWinSock = std::make_unique<WinSock>();
     setSurfaceFormat();
+    startup_profiler::mark(StartupPhaseEnum::SURFACE_FORMAT);
 
     const auto &config = getConfig();
     std::unique_ptr<ISplash> splash = !config.general.noSplash
                                           ? static_upcast<ISplash>(std::make_unique<Splash>())
                                           : static_upcast<ISplash>(std::make_unique<FakeSplash>());
     auto mw = std::make_unique<MainWindow>();
+    startup_profiler::mark(StartupPhaseEnum::MAIN_WINDOW);
     tryAutoLoad(*mw);
+    startup_profiler::mark(StartupPhaseEnum::MAP_LOADED);
     mw->show();
+    startup_profiler::mark(StartupPhaseEnum::WINDOW_SHOWN);
     splash->finish(mw.get());
     splash.reset();
     const int ret = QApplication::exec();
     mw.reset();
+    event_loop_watchdog::stop();
     config.write();
     return ret;
 }
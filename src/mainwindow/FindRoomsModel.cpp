@@ -0,0 +1,223 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "FindRoomsModel.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "../expandoracommon/room.h"
+
+static constexpr const int FIND_ROOMS_COLUMN_COUNT = 2;
+static_assert(FIND_ROOMS_COLUMN_COUNT
+                  == static_cast<int>(FindRoomsModel::ColumnTypeEnum::NAME) + 1,
+              "# of columns");
+
+// Rows handed to the view at a time.
+static constexpr const int FETCH_ROWS = 256;
+
+FindRoomsModel::FindRoomsModel(QObject *const parent)
+    : QAbstractTableModel{parent}
+{}
+
+FindRoomsModel::~FindRoomsModel() = default;
+
+void FindRoomsModel::reset(SharedMapSnapshot snapshot)
+{
+    beginResetModel();
+    m_snapshot = std::move(snapshot);
+    m_ids.clear();
+    m_shown = 0;
+    m_wanted = FETCH_ROWS;
+    endResetModel();
+}
+
+void FindRoomsModel::addRooms(const RoomSearchPage &page)
+{
+    if (page.empty()) {
+        return;
+    }
+
+    const auto lessThan = [this](const RoomId a, const RoomId b) { return this->lessThan(a, b); };
+    const size_t oldSize = m_ids.size();
+    m_ids.insert(m_ids.end(), page.begin(), page.end());
+    if (m_sortColumn != ColumnTypeEnum::ID || m_sortOrder != Qt::AscendingOrder) {
+        const auto middle = m_ids.begin() + static_cast<std::ptrdiff_t>(oldSize);
+        std::sort(middle, m_ids.end(), lessThan);
+        if (oldSize != 0 && lessThan(m_ids[oldSize], m_ids[oldSize - 1])) {
+            // Some of the new rooms go between rows the view already has.
+            reorder([this, middle, &lessThan]() {
+                std::inplace_merge(m_ids.begin(), middle, m_ids.end(), lessThan);
+            });
+        }
+    }
+    showWantedRows();
+}
+
+std::vector<RoomId> FindRoomsModel::getRoomIds() const
+{
+    std::vector<RoomId> result = m_ids;
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+RoomId FindRoomsModel::getRoomId(const QModelIndex &index) const
+{
+    if (!index.isValid() || index.row() >= m_shown) {
+        return INVALID_ROOMID;
+    }
+    return m_ids[static_cast<size_t>(index.row())];
+}
+
+int FindRoomsModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_shown;
+}
+
+int FindRoomsModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : FIND_ROOMS_COLUMN_COUNT;
+}
+
+QVariant FindRoomsModel::data(const QModelIndex &index, const int role) const
+{
+    const RoomId id = getRoomId(index);
+    const Room *const room = getRoom(id);
+    if (room == nullptr) {
+        return QVariant();
+    }
+
+    switch (role) {
+    case Qt::DisplayRole:
+        switch (static_cast<ColumnTypeEnum>(index.column())) {
+        case ColumnTypeEnum::ID:
+            return QString::number(id.asUint32());
+        case ColumnTypeEnum::NAME:
+            return room->getName().toQString();
+        }
+        break;
+
+    case Qt::ToolTipRole:
+        // FIXME: This code is almost identical to the code in MapCanvas::mouseReleaseEvent. Refactor!
+        return QString("Selected Room ID: %1\n%2").arg(id.asUint32()).arg(room->toQString());
+
+    default:
+        break;
+    }
+    return QVariant();
+}
+
+QVariant FindRoomsModel::headerData(const int section,
+                                    const Qt::Orientation orientation,
+                                    const int role) const
+{
+    if (orientation == Qt::Orientation::Horizontal && role == Qt::DisplayRole) {
+        switch (static_cast<ColumnTypeEnum>(section)) {
+        case ColumnTypeEnum::ID:
+            return tr("Room ID");
+        case ColumnTypeEnum::NAME:
+            return tr("Room Name");
+        }
+    }
+    return QVariant();
+}
+
+bool FindRoomsModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && m_shown < getRoomsCount();
+}
+
+void FindRoomsModel::fetchMore(const QModelIndex &parent)
+{
+    if (parent.isValid()) {
+        return;
+    }
+    m_wanted = std::max(m_wanted, m_shown) + FETCH_ROWS;
+    showWantedRows();
+}
+
+void FindRoomsModel::sort(const int column, const Qt::SortOrder order)
+{
+    const auto sortColumn = static_cast<ColumnTypeEnum>(column);
+    if (sortColumn != ColumnTypeEnum::ID && sortColumn != ColumnTypeEnum::NAME) {
+        return;
+    }
+    m_sortColumn = sortColumn;
+    m_sortOrder = order;
+    reorder([this]() {
+        std::sort(m_ids.begin(), m_ids.end(), [this](const RoomId a, const RoomId b) {
+            return lessThan(a, b);
+        });
+    });
+}
+
+const Room *FindRoomsModel::getRoom(const RoomId id) const
+{
+    return (m_snapshot != nullptr) ? m_snapshot->getRoom(id) : nullptr;
+}
+
+bool FindRoomsModel::lessThan(RoomId a, RoomId b) const
+{
+    if (m_sortOrder == Qt::DescendingOrder) {
+        std::swap(a, b);
+    }
+    if (m_sortColumn == ColumnTypeEnum::NAME) {
+        static const std::string empty;
+        const Room *const ra = getRoom(a);
+        const Room *const rb = getRoom(b);
+        const std::string &na = (ra != nullptr) ? ra->getName().getStdString() : empty;
+        const std::string &nb = (rb != nullptr) ? rb->getName().getStdString() : empty;
+        if (na != nb) {
+            return na < nb;
+        }
+    }
+    return a < b;
+}
+
+template<typename Callback>
+void FindRoomsModel::reorder(Callback &&callback)
+{
+    emit layoutAboutToBeChanged();
+    const QModelIndexList before = persistentIndexList();
+    std::vector<uint32_t> ids;
+    ids.reserve(static_cast<size_t>(before.size()));
+    std::unordered_map<uint32_t, int> newRows;
+    for (const QModelIndex &index : before) {
+        ids.emplace_back(getRoomId(index).asUint32());
+        newRows.emplace(ids.back(), -1);
+    }
+
+    callback();
+
+    for (int row = 0; row < m_shown; ++row) {
+        const auto it = newRows.find(m_ids[static_cast<size_t>(row)].asUint32());
+        if (it != newRows.end()) {
+            it->second = row;
+        }
+    }
+    QModelIndexList after;
+    after.reserve(before.size());
+    for (int i = 0; i < before.size(); ++i) {
+        const int row = newRows.at(ids[static_cast<size_t>(i)]);
+        // Rooms pushed past the rows the view has are dropped from it.
+        after.append((row >= 0) ? createIndex(row, before[i].column()) : QModelIndex());
+    }
+    changePersistentIndexList(before, after);
+    emit layoutChanged();
+}
+
+void FindRoomsModel::showWantedRows()
+{
+    const int target = std::min(m_wanted, getRoomsCount());
+    if (m_shown >= target) {
+        return;
+    }
+    beginInsertRows(QModelIndex(), m_shown, target - 1);
+    m_shown = target;
+    endInsertRows();
+}
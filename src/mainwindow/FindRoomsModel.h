@@ -0,0 +1,74 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <cstdint>
+#include <vector>
+#include <QAbstractTableModel>
+#include <QString>
+#include <QtCore>
+
+#include "../global/macros.h"
+#include "../global/roomid.h"
+#include "../mapdata/MapSnapshot.h"
+#include "../mapdata/RoomSearchService.h"
+
+class Room;
+
+/**
+ * The results of a FindRoomsDlg search: room ids, shown with the name and
+ * description they had in the snapshot that was searched.
+ *
+ * Results are added a page at a time while the search runs, but rows are
+ * only handed to the view as it scrolls down to them (fetchMore()), and the
+ * text of a row is only looked up when the view asks for it.
+ */
+class FindRoomsModel final : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum class NODISCARD ColumnTypeEnum : uint8_t { ID = 0, NAME };
+
+private:
+    SharedMapSnapshot m_snapshot;
+    // Every result, in display order; the view only sees the first m_shown.
+    std::vector<RoomId> m_ids;
+    int m_shown = 0;
+    // Rows the view has asked for so far.
+    int m_wanted = 0;
+    ColumnTypeEnum m_sortColumn = ColumnTypeEnum::ID;
+    Qt::SortOrder m_sortOrder = Qt::AscendingOrder;
+
+public:
+    explicit FindRoomsModel(QObject *parent);
+    ~FindRoomsModel() final;
+
+public:
+    // Drops every result; new ones will be from the given snapshot.
+    void reset(SharedMapSnapshot snapshot);
+    void addRooms(const RoomSearchPage &page);
+
+    NODISCARD const SharedMapSnapshot &getSnapshot() const { return m_snapshot; }
+    NODISCARD int getRoomsCount() const { return static_cast<int>(m_ids.size()); }
+    // Every result, including the ones not shown yet, in id order.
+    NODISCARD std::vector<RoomId> getRoomIds() const;
+    NODISCARD RoomId getRoomId(const QModelIndex &index) const;
+
+public:
+    NODISCARD int rowCount(const QModelIndex &parent) const override;
+    NODISCARD int columnCount(const QModelIndex &parent) const override;
+    NODISCARD QVariant data(const QModelIndex &index, int role) const override;
+    NODISCARD QVariant headerData(int section, Qt::Orientation orientation, int role) const override;
+    NODISCARD bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+    void sort(int column, Qt::SortOrder order) override;
+
+private:
+    NODISCARD const Room *getRoom(RoomId id) const;
+    NODISCARD bool lessThan(RoomId a, RoomId b) const;
+    // Reorders m_ids while keeping the view's selection on the same rooms.
+    template<typename Callback>
+    void reorder(Callback &&callback);
+    void showWantedRows();
+};
@@ -9,6 +9,8 @@
 #include <QtGui>
 #include <QtWidgets>
 
+#include "../global/MemoryReport.h"
+#include "../global/TextUtils.h"
 #include "../global/Version.h"
 
 NODISCARD static QString getBuildInformation()
@@ -131,6 +133,12 @@ AboutDialog::AboutDialog(QWidget *parent)
         + loadLicenseResource(":/LICENSE.OPENSSL") + "</pre>");
     setFixedFont(licenseView);
 
+    /* Memory tab */
+    auto *const memoryView = new QTextBrowser(tabWidget);
+    memoryView->setPlainText(::toQStringLatin1(memory_report::getReport()));
+    setFixedFont(memoryView);
+    tabWidget->addTab(memoryView, tr("Memory"));
+
     adjustSize();
 }
 
@@ -6,6 +6,8 @@
 #include "findroomsdlg.h"
 
 #include <cstdint>
+#include <initializer_list>
+#include <utility>
 #include <QString>
 #include <QtGui>
 #include <QtWidgets>
@@ -14,12 +16,17 @@
 #include "../expandoracommon/coordinate.h"
 #include "../expandoracommon/exit.h"
 #include "../expandoracommon/room.h"
+#include "../global/TextUtils.h"
 #include "../global/roomid.h"
 #include "../mapdata/ExitDirection.h"
 #include "../mapdata/mapdata.h"
 #include "../mapdata/roomfilter.h"
 #include "../mapdata/roomselection.h"
 #include "../parser/parserutils.h"
+#include "FindRoomsModel.h"
+
+// How long typing has to pause before searching as you type.
+static constexpr const int TYPING_DELAY_MS = 150;
 
 FindRoomsDlg::FindRoomsDlg(MapData &md, QWidget *const parent)
     : QDialog(parent)
@@ -27,33 +34,60 @@ FindRoomsDlg::FindRoomsDlg(MapData &md, QWidget *const parent)
 {
     setupUi(this);
 
+    m_model = new FindRoomsModel(this);
+    resultTable->setModel(m_model);
     adjustResultTable();
 
     m_showSelectedRoom = new QShortcut(QKeySequence(tr("Space", "Select result item")), resultTable);
     m_showSelectedRoom->setContext(Qt::WidgetShortcut);
 
+    m_typingTimer.setSingleShot(true);
+    m_typingTimer.setInterval(TYPING_DELAY_MS);
+
     selectButton->setEnabled(false);
     editButton->setEnabled(false);
 
+    RoomSearchService &search = m_mapData.getRoomSearchService();
+    connect(&search, &RoomSearchService::sig_roomsFound, this, &FindRoomsDlg::slot_onRoomsFound);
+    connect(&search,
+            &RoomSearchService::sig_searchFinished,
+            this,
+            &FindRoomsDlg::slot_onSearchFinished);
+
     connect(lineEdit, &QLineEdit::textChanged, this, &FindRoomsDlg::slot_enableFindButton);
+    connect(lineEdit, &QLineEdit::textChanged, this, &FindRoomsDlg::slot_scheduleSearch);
+    // Any change to the options restarts a search as you type.
+    const std::initializer_list<QAbstractButton *> options{nameRadioButton,
+                                                           descRadioButton,
+                                                           contentsRadioButton,
+                                                           exitsRadioButton,
+                                                           notesRadioButton,
+                                                           flagsRadioButton,
+                                                           allRadioButton,
+                                                           caseCheckBox,
+                                                           regexCheckBox,
+                                                           searchAsYouTypeCheckBox};
+    for (QAbstractButton *const button : options) {
+        connect(button, &QAbstractButton::toggled, this, &FindRoomsDlg::slot_scheduleSearch);
+    }
+    connect(&m_typingTimer, &QTimer::timeout, this, &FindRoomsDlg::slot_findClicked);
     connect(findButton, &QAbstractButton::clicked, this, &FindRoomsDlg::slot_findClicked);
     connect(closeButton, &QAbstractButton::clicked, this, &QWidget::close);
-    connect(resultTable,
-            &QTreeWidget::itemDoubleClicked,
-            this,
-            &FindRoomsDlg::slot_itemDoubleClicked);
+    connect(resultTable, &QTreeView::doubleClicked, this, &FindRoomsDlg::slot_itemDoubleClicked);
     connect(m_showSelectedRoom, &QShortcut::activated, this, &FindRoomsDlg::slot_showSelectedRoom);
-    connect(resultTable, &QTreeWidget::itemSelectionChanged, this, [this]() {
-        const bool enabled = !resultTable->selectedItems().isEmpty();
+    const auto updateButtons = [this]() {
+        const bool enabled = resultTable->selectionModel()->hasSelection();
         selectButton->setEnabled(enabled);
         editButton->setEnabled(enabled);
-    });
+    };
+    connect(resultTable->selectionModel(),
+            &QItemSelectionModel::selectionChanged,
+            this,
+            updateButtons);
+    // Resetting the model drops the selection without signalling it.
+    connect(m_model, &QAbstractItemModel::modelReset, this, updateButtons);
     connect(selectButton, &QAbstractButton::clicked, this, [this]() {
-        const auto tmpSel = RoomSelection::createSelection(m_mapData);
-        for (const auto &selectedItem : resultTable->selectedItems()) {
-            const auto id = RoomId{selectedItem->text(0).toUInt()};
-            tmpSel->getRoom(id);
-        }
+        const auto tmpSel = createSelectionFromSelectedRows();
         if (!tmpSel->empty()) {
             glm::vec2 sum{0.f, 0.f};
             // FIXME: This is actually an anti-feature if the rooms are far apart,
@@ -69,11 +103,7 @@ FindRoomsDlg::FindRoomsDlg(MapData &md, QWidget *const parent)
         emit sig_newRoomSelection(SigRoomSelection{tmpSel});
     });
     connect(editButton, &QAbstractButton::clicked, this, [this]() {
-        const auto tmpSel = RoomSelection::createSelection(m_mapData);
-        for (const auto &selectedItem : resultTable->selectedItems()) {
-            const auto id = RoomId{selectedItem->text(0).toUInt()};
-            tmpSel->getRoom(id);
-        }
+        const auto tmpSel = createSelectionFromSelectedRows();
         emit sig_newRoomSelection(SigRoomSelection{tmpSel});
         emit sig_editSelection();
     });
@@ -88,29 +118,33 @@ FindRoomsDlg::FindRoomsDlg(MapData &md, QWidget *const parent)
 FindRoomsDlg::~FindRoomsDlg()
 {
     delete m_showSelectedRoom;
-    resultTable->clear();
 }
 
 void FindRoomsDlg::readSettings()
 {
-    restoreGeometry(getConfig().findRoomsDialog.geometry);
+    const auto &settings = getConfig().findRoomsDialog;
+    restoreGeometry(settings.geometry);
+    searchAsYouTypeCheckBox->setChecked(settings.searchAsYouType);
 }
 
 void FindRoomsDlg::writeSettings()
 {
-    setConfig().findRoomsDialog.geometry = saveGeometry();
+    auto &settings = setConfig().findRoomsDialog;
+    settings.geometry = saveGeometry();
+    settings.searchAsYouType = searchAsYouTypeCheckBox->isChecked();
 }
 
-void FindRoomsDlg::slot_findClicked()
+Qt::CaseSensitivity FindRoomsDlg::getCaseSensitivity() const
+{
+    return caseCheckBox->isChecked() ? Qt::CaseSensitive : Qt::CaseInsensitive;
+}
+
+RoomFilter FindRoomsDlg::getFilter() const
 {
-    const Qt::CaseSensitivity cs = caseCheckBox->isChecked() ? Qt::CaseSensitive
-                                                             : Qt::CaseInsensitive;
     const bool regex = regexCheckBox->isChecked();
     std::string text = lineEdit->text().toLatin1().toStdString();
     // remove latin1
     text = ParserUtils::latin1ToAsciiInPlace(text);
-    resultTable->clear();
-    roomsFoundLabel->clear();
 
     auto kind = PatternKindsEnum::ALL;
     if (nameRadioButton->isChecked()) {
@@ -127,68 +161,164 @@ void FindRoomsDlg::slot_findClicked()
         kind = PatternKindsEnum::FLAGS;
     }
 
+    return RoomFilter(text, getCaseSensitivity(), regex, kind);
+}
+
+bool FindRoomsDlg::canRefine(const Search &search) const
+{
+    // Text that contains the literal of a finished search can only be found
+    // in rooms that search found.
+    if (!m_finished.has_value() || search.kind != m_finished->kind || search.cs != m_finished->cs) {
+        return false;
+    }
+    if (search.cs == Qt::CaseSensitive) {
+        return search.literal.find(m_finished->literal) != std::string::npos;
+    }
+    return toLowerLatin1(search.literal).find(toLowerLatin1(m_finished->literal))
+           != std::string::npos;
+}
+
+void FindRoomsDlg::slot_scheduleSearch()
+{
+    if (!searchAsYouTypeCheckBox->isChecked()) {
+        m_typingTimer.stop();
+        return;
+    }
+    if (lineEdit->text().isEmpty()) {
+        m_typingTimer.stop();
+        clearResults();
+        return;
+    }
+    m_typingTimer.start();
+}
+
+void FindRoomsDlg::slot_findClicked()
+{
+    m_typingTimer.stop();
+    if (lineEdit->text().isEmpty()) {
+        clearResults();
+        return;
+    }
+
     try {
-        auto tmpSel = RoomSelection(m_mapData);
-        tmpSel.genericSearch(RoomFilter(text, cs, regex, kind));
-
-        for (const auto &[rid, room] : tmpSel) {
-            QString id;
-            id.setNum(rid.asUint32());
-            QString roomName = room->getName().toQString();
-            QString toolTip = slot_constructToolTip(room);
-
-            item = new QTreeWidgetItem(resultTable);
-            item->setText(0, id);
-            item->setText(1, roomName);
-            item->setToolTip(0, toolTip);
-            item->setToolTip(1, toolTip);
+        const RoomFilter filter = getFilter();
+        std::optional<Search> search;
+        SharedMapSnapshot previous;
+        std::vector<RoomId> within;
+        if (const std::optional<std::string> &literal = filter.getLiteral()) {
+            search.emplace();
+            search->kind = filter.patternKind();
+            search->cs = getCaseSensitivity();
+            search->literal = literal.value();
+            if (canRefine(search.value())) {
+                previous = m_finished->snapshot;
+                within = m_finished->rooms;
+            }
+        }
+
+        auto [request, snapshot] = m_mapData.requestSearch(filter, previous, within);
+        m_request = request;
+        if (search.has_value()) {
+            search->snapshot = snapshot;
         }
+        m_running = std::move(search);
+        m_model->reset(std::move(snapshot));
     } catch (const std::exception &ex) {
         qWarning() << "Exception: " << ex.what();
         QMessageBox::critical(this,
                               "Internal Error",
                               QString::asprintf("An exception occurred: %s\n", ex.what()));
     }
-    roomsFoundLabel->setText(tr("%1 room%2 found")
-                                 .arg(resultTable->topLevelItemCount())
-                                 .arg((resultTable->topLevelItemCount() == 1) ? "" : "s"));
+    updateRoomsFoundLabel();
+}
+
+void FindRoomsDlg::slot_onRoomsFound(const quint64 request, const RoomSearchPage &page)
+{
+    if (request != m_request) {
+        return;
+    }
+    m_model->addRooms(page);
+    updateRoomsFoundLabel();
+}
+
+void FindRoomsDlg::slot_onSearchFinished(const quint64 request, int /*numFound*/)
+{
+    if (request != m_request) {
+        return;
+    }
+    m_request = 0;
+    if (m_running.has_value()) {
+        m_running->rooms = m_model->getRoomIds();
+        m_finished = std::exchange(m_running, std::nullopt);
+    }
+    updateRoomsFoundLabel();
+}
+
+void FindRoomsDlg::updateRoomsFoundLabel()
+{
+    const int count = m_model->getRoomsCount();
+    if (m_request != 0) {
+        roomsFoundLabel->setText(tr("Searching... %1 room%2 found so far")
+                                     .arg(count)
+                                     .arg((count == 1) ? "" : "s"));
+        return;
+    }
+    roomsFoundLabel->setText(tr("%1 room%2 found").arg(count).arg((count == 1) ? "" : "s"));
+}
+
+void FindRoomsDlg::clearResults()
+{
+    if (m_request != 0) {
+        m_mapData.getRoomSearchService().cancel();
+        m_request = 0;
+    }
+    m_running.reset();
+    m_model->reset(nullptr);
+    roomsFoundLabel->clear();
 }
 
-// FIXME: This code is almost identical to the code in MapCanvas::mouseReleaseEvent. Refactor!
-QString FindRoomsDlg::slot_constructToolTip(const Room *const r)
+SharedRoomSelection FindRoomsDlg::createSelectionFromSelectedRows()
 {
-    return QString("Selected Room ID: %1\n%2").arg(r->getId().asUint32()).arg(r->toQString());
+    const auto tmpSel = RoomSelection::createSelection(m_mapData);
+    for (const QModelIndex &index : resultTable->selectionModel()->selectedRows()) {
+        const RoomId id = m_model->getRoomId(index);
+        if (id != INVALID_ROOMID) {
+            tmpSel->getRoom(id);
+        }
+    }
+    return tmpSel;
 }
 
 void FindRoomsDlg::slot_showSelectedRoom()
 {
-    slot_itemDoubleClicked(resultTable->currentItem());
+    slot_itemDoubleClicked(resultTable->currentIndex());
 }
 
-void FindRoomsDlg::slot_itemDoubleClicked(QTreeWidgetItem *const inputItem)
+void FindRoomsDlg::slot_itemDoubleClicked(const QModelIndex &index)
 {
-    if (inputItem == nullptr) {
+    const RoomId id = m_model->getRoomId(index);
+    if (id == INVALID_ROOMID) {
         return;
     }
 
     auto tmpSel = RoomSelection(m_mapData);
-    const auto id = RoomId{inputItem->text(0).toUInt()};
     if (const Room *const r = tmpSel.getRoom(id)) {
         if (r->getId() == id) {
             const Coordinate &c = r->getPosition();
             const auto worldPos = c.to_vec2() + glm::vec2{0.5f, 0.5f};
             emit sig_center(worldPos); // connects to MapWindow
         }
-        emit sig_log("FindRooms", inputItem->toolTip(0));
+        emit sig_log("FindRooms", index.data(Qt::ToolTipRole).toString());
     }
 }
 
 void FindRoomsDlg::adjustResultTable()
 {
-    resultTable->setColumnCount(2);
-    resultTable->setHeaderLabels(QStringList() << tr("Room ID") << tr("Room Name"));
     resultTable->header()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    resultTable->header()->setSortIndicator(static_cast<int>(FindRoomsModel::ColumnTypeEnum::ID),
+                                            Qt::AscendingOrder);
     resultTable->setRootIsDecorated(false);
+    resultTable->setUniformRowHeights(true);
     resultTable->setAlternatingRowColors(true);
     resultTable->setSelectionBehavior(QAbstractItemView::SelectionBehavior::SelectRows);
     resultTable->setSelectionMode(QAbstractItemView::SelectionMode::ExtendedSelection);
@@ -202,8 +332,9 @@ void FindRoomsDlg::slot_enableFindButton(const QString &text)
 void FindRoomsDlg::closeEvent(QCloseEvent *event)
 {
     writeSettings();
-    resultTable->clear();
-    roomsFoundLabel->clear();
+    m_typingTimer.stop();
+    clearResults();
+    m_finished.reset();
     lineEdit->setFocus();
     selectButton->setEnabled(false);
     editButton->setEnabled(false);
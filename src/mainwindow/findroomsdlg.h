@@ -4,24 +4,31 @@
 // Author: Kalev Lember <kalev@smartlink.ee> (Kalev)
 // Author: Nils Schimmelmann <nschimme@gmail.com> (Jahara)
 
+#include <optional>
+#include <string>
+#include <vector>
 #include <QDialog>
 #include <QString>
+#include <QTimer>
 #include <QtCore>
 #include <QtGlobal>
-#include <QtWidgets/QTreeWidgetItem>
 
+#include "../global/roomid.h"
+#include "../mapdata/MapSnapshot.h"
+#include "../mapdata/RoomSearchService.h"
+#include "../mapdata/roomfilter.h"
 #include "../mapdata/roomselection.h"
 #include "../parser/abstractparser.h"
 #include "ui_findroomsdlg.h" // auto-generated
 
+class FindRoomsModel;
 class MapCanvas;
 class MapData;
 class QCloseEvent;
+class QModelIndex;
 class QObject;
 class QShortcut;
-class QTreeWidgetItem;
 class QWidget;
-class Room;
 
 class FindRoomsDlg final : public QDialog, private Ui::FindRoomsDlg
 {
@@ -51,17 +58,41 @@ public slots:
     void writeSettings();
 
 private:
+    // A search for literal text; once it has run to the end, searches for
+    // longer text can narrow down its rooms instead of checking every room.
+    struct NODISCARD Search final
+    {
+        PatternKindsEnum kind = PatternKindsEnum::NONE;
+        Qt::CaseSensitivity cs = Qt::CaseInsensitive;
+        std::string literal;
+        SharedMapSnapshot snapshot;
+        std::vector<RoomId> rooms;
+    };
+
     MapData &m_mapData;
-    QTreeWidgetItem *item = nullptr;
+    FindRoomsModel *m_model = nullptr;
     QShortcut *m_showSelectedRoom = nullptr;
+    // Delays searching as you type until typing pauses.
+    QTimer m_typingTimer;
+    RoomSearchService::RequestId m_request = 0;
+    std::optional<Search> m_running;
+    std::optional<Search> m_finished;
 
     void adjustResultTable();
+    NODISCARD Qt::CaseSensitivity getCaseSensitivity() const;
+    NODISCARD RoomFilter getFilter() const;
+    NODISCARD bool canRefine(const Search &search) const;
+    void updateRoomsFoundLabel();
+    void clearResults();
+    NODISCARD SharedRoomSelection createSelectionFromSelectedRows();
 
 private slots:
-    QString slot_constructToolTip(const Room *);
     void slot_on_lineEdit_textChanged();
     void slot_findClicked();
     void slot_enableFindButton(const QString &text);
-    void slot_itemDoubleClicked(QTreeWidgetItem *inputItem);
+    void slot_scheduleSearch();
+    void slot_onRoomsFound(quint64 request, const RoomSearchPage &page);
+    void slot_onSearchFinished(quint64 request, int numFound);
+    void slot_itemDoubleClicked(const QModelIndex &index);
     void slot_showSelectedRoom();
 };
@@ -6,9 +6,12 @@
 
 #include "mainwindow.h"
 
+#include <algorithm>
+#include <cstddef>
 #include <memory>
 #include <mutex>
 #include <stdexcept>
+#include <utility>
 #include <vector>
 #include <QActionGroup>
 #include <QCloseEvent>
@@ -29,6 +32,7 @@
 #include "../client/ClientWidget.h"
 #include "../clock/mumeclock.h"
 #include "../clock/mumeclockwidget.h"
+#include "../configuration/ConfigSaver.h"
 #include "../configuration/configobserver.h"
 #include "../configuration/configuration.h"
 #include "../display/InfoMarkSelection.h"
@@ -40,6 +44,8 @@
 #include "../expandoracommon/coordinate.h"
 #include "../expandoracommon/parseevent.h"
 #include "../expandoracommon/room.h"
+#include "../global/CacheRegistry.h"
+#include "../global/EventTrace.h"
 #include "../global/NullPointerException.h"
 #include "../global/SignalBlocker.h"
 #include "../global/Version.h"
@@ -51,6 +57,11 @@
 #include "../mapdata/roomselection.h"
 #include "../mapfrontend/mapaction.h"
 #include "../mapfrontend/mapfrontend.h"
+#include "../mapstorage/BackgroundMapSaver.h"
+#include "../mapstorage/LoadedRoom.h"
+#include "../mapstorage/MapDeltaApplier.h"
+#include "../mapstorage/MapJournal.h"
+#include "../mapstorage/MapReloader.h"
 #include "../mapstorage/MmpMapStorage.h"
 #include "../mapstorage/PandoraMapStorage.h"
 #include "../mapstorage/XmlMapStorage.h"
@@ -93,6 +104,22 @@ class NODISCARD CanvasDisabler final
     DELETE_CTORS_AND_ASSIGN_OPS(CanvasDisabler);
 };
 
+// How often the autosave timer checks whether an autosave is due.
+static constexpr const int AUTOSAVE_CHECK_MS = 60 * 1000;
+static constexpr const int MAP_DELTA_MS = 1000;
+// The map has to be left alone for a whole interval before it's checked.
+static constexpr const int VALIDATION_IDLE_MS = 30 * 1000;
+// Rooms per map delta, so one large edit doesn't become one huge message.
+static constexpr const size_t MAX_DELTA_ROOMS = 512;
+// GUI thread time an autosave may take without being reported.
+static constexpr const qint64 AUTOSAVE_BUDGET_MS = 50;
+// Autosaves keep the GUI thread busy for at most 1/20 of the time.
+static constexpr const qint64 AUTOSAVE_BACKOFF_FACTOR = 20;
+// Long enough for the map to be drawn and the first commands to be handled.
+static constexpr const int DIALOG_WARM_UP_DELAY_MS = 3000;
+// How often the caches are trimmed to general.cacheBudgetMiB.
+static constexpr const int CACHE_BUDGET_MS = 10 * 1000;
+
 static void addApplicationFont()
 {
     const auto id = QFontDatabase::addApplicationFont(":/fonts/DejaVuSansMono.ttf");
@@ -191,6 +218,9 @@ MainWindow::MainWindow()
     qRegisterMetaType<GroupManagerStateEnum>("GroupManagerStateEnum");
     qRegisterMetaType<SigParseEvent>("SigParseEvent");
     qRegisterMetaType<SigRoomSelection>("SigRoomSelection");
+    qRegisterMetaType<ShortestPathResult>("ShortestPathResult");
+    qRegisterMetaType<RoomSearchPage>("RoomSearchPage");
+    qRegisterMetaType<MapValidationReport>("MapValidationReport");
 
     m_mapData = new MapData(this);
     auto &mapData = *m_mapData;
@@ -267,9 +297,87 @@ MainWindow::MainWindow()
     m_dockDialogRoom->setWidget(m_roomWidget);
     m_dockDialogRoom->hide();
 
-    // Find Room Dialog
-    m_findRoomsDlg = new FindRoomsDlg(*m_mapData, this);
-    m_findRoomsDlg->setObjectName("FindRoomsDlg");
+    m_backgroundSaver = new BackgroundMapSaver(this);
+    m_backgroundSaver->setObjectName("BackgroundMapSaver");
+    // The saver's signals come from its worker thread.
+    connect(&m_backgroundSaver->getProgressCounter(),
+            &ProgressCounter::sig_onPercentageChanged,
+            this,
+            &MainWindow::slot_backgroundSavePercentageChanged,
+            Qt::QueuedConnection);
+    connect(m_backgroundSaver,
+            &BackgroundMapSaver::sig_log,
+            this,
+            &MainWindow::slot_log,
+            Qt::QueuedConnection);
+    connect(m_backgroundSaver,
+            &BackgroundMapSaver::sig_finished,
+            this,
+            &MainWindow::slot_backgroundSaveFinished,
+            Qt::QueuedConnection);
+
+    m_mapReloader = new MapReloader(*m_mapData, this);
+    m_mapReloader->setObjectName("MapReloader");
+    // The reloader's signals come from its worker thread too.
+    connect(m_mapReloader,
+            &MapReloader::sig_log,
+            this,
+            &MainWindow::slot_log,
+            Qt::QueuedConnection);
+    connect(m_mapReloader,
+            &MapReloader::sig_finished,
+            this,
+            &MainWindow::slot_mapReloadFinished,
+            Qt::QueuedConnection);
+
+    m_autosaveTimer = new QTimer(this);
+    m_autosaveTimer->setObjectName("AutosaveTimer");
+    m_autosaveTimer->setInterval(AUTOSAVE_CHECK_MS);
+    connect(m_autosaveTimer, &QTimer::timeout, this, [this]() {
+        const auto &autoLoad = getConfig().autoLoad;
+        if (m_sinceAutosave.hasExpired(static_cast<qint64>(autoLoad.autosaveMinutes) * 60 * 1000)) {
+            slot_autosave();
+        }
+    });
+    m_autosaveTimer->start();
+    m_sinceAutosave.start();
+
+    m_mapDeltaTimer = new QTimer(this);
+    m_mapDeltaTimer->setObjectName("MapDeltaTimer");
+    m_mapDeltaTimer->setInterval(MAP_DELTA_MS);
+    connect(m_mapDeltaTimer, &QTimer::timeout, this, &MainWindow::slot_shareMapDelta);
+    m_mapDeltaTimer->start();
+
+    connect(&m_mapData->getMapValidator(),
+            &MapValidator::sig_validated,
+            this,
+            &MainWindow::slot_onMapValidated,
+            Qt::QueuedConnection);
+    m_validationTimer = new QTimer(this);
+    m_validationTimer->setObjectName("ValidationTimer");
+    m_validationTimer->setInterval(VALIDATION_IDLE_MS);
+    connect(m_validationTimer, &QTimer::timeout, this, [this]() {
+        const uint64_t count = m_mapData->getModificationCount();
+        if (std::exchange(m_idleModificationCount, count) != count
+            || count == m_validatedModificationCount || m_manualValidation != 0) {
+            return;
+        }
+        m_validatedModificationCount = count;
+        m_idleValidation = m_mapData->requestValidation(false);
+    });
+    m_validationTimer->start();
+
+    m_cacheBudgetTimer = new QTimer(this);
+    m_cacheBudgetTimer->setObjectName("CacheBudgetTimer");
+    m_cacheBudgetTimer->setInterval(CACHE_BUDGET_MS);
+    connect(m_cacheBudgetTimer, &QTimer::timeout, this, []() {
+        const auto mib = static_cast<size_t>(std::max(0, getConfig().general.cacheBudgetMiB));
+        cache_registry::setBudget(mib * 1024 * 1024);
+        if (const size_t freed = cache_registry::enforceBudget(); freed != 0) {
+            qInfo() << "Evicted" << freed << "bytes of caches to stay within budget";
+        }
+    });
+    m_cacheBudgetTimer->start();
 
     // View -> Side Panels -> Adventure Panel (Trophy XP, Achievements, Hints, etc)
     m_dockDialogAdventure = new QDockWidget(tr("Adventure Panel *BETA*"), this);
@@ -298,6 +406,7 @@ MainWindow::MainWindow()
     setCorner(Qt::BottomRightCorner, Qt::BottomDockWidgetArea);
 
     m_logger = new AutoLogger(this);
+    m_configSaver = new ConfigSaver(this);
     // TODO move this connect() wiring into AutoLogger::ctor
     connect(m_gameObserver, &GameObserver::sig_connected, m_logger, &AutoLogger::slot_onConnected);
     connect(m_gameObserver,
@@ -318,7 +427,6 @@ MainWindow::MainWindow()
                                         deref(m_prespammedPath),
                                         deref(m_groupManager),
                                         deref(m_mumeClock),
-                                        deref(getCanvas()),
                                         deref(m_gameObserver),
                                         this);
 
@@ -456,6 +564,11 @@ void MainWindow::wireConnections()
                 &Mmapper2PathMachine::sig_lookingForRooms),
             m_mapData,
             QOverload<RoomRecipient &, const Coordinate &>::of(&MapData::lookingForRooms));
+    connect(m_pathMachine,
+            QOverload<RoomRecipient &, const Coordinate &, int>::of(
+                &Mmapper2PathMachine::sig_lookingForRooms),
+            m_mapData,
+            QOverload<RoomRecipient &, const Coordinate &, int>::of(&MapData::lookingForRooms));
     connect(m_pathMachine,
             QOverload<RoomRecipient &, const SigParseEvent &>::of(
                 &Mmapper2PathMachine::sig_lookingForRooms),
@@ -494,7 +607,14 @@ void MainWindow::wireConnections()
     connect(m_mapData, &MapData::sig_onDataChanged, this, [this]() {
         setWindowModified(true);
         saveAct->setEnabled(true);
+        updateUndoActions();
     });
+    // Queued, so that an autosave never runs in the middle of a map action.
+    connect(m_mapData,
+            &MapData::sig_onDataChanged,
+            this,
+            &MainWindow::slot_onMapDataChanged,
+            Qt::QueuedConnection);
 
     connect(zoomInAct, &QAction::triggered, canvas, &MapCanvas::slot_zoomIn);
     connect(zoomOutAct, &QAction::triggered, canvas, &MapCanvas::slot_zoomOut);
@@ -533,12 +653,39 @@ void MainWindow::wireConnections()
             this,
             &MainWindow::slot_groupNetworkStatus,
             Qt::QueuedConnection);
+    connect(m_groupManager,
+            &Mmapper2Group::sig_mapDeltaArrived,
+            this,
+            &MainWindow::slot_applyMapDelta,
+            Qt::QueuedConnection);
 
     connect(m_mapData, &MapFrontend::sig_clearingMap, m_groupWidget, &GroupWidget::slot_mapUnloaded);
 
     connect(m_mumeClock, &MumeClock::sig_log, this, &MainWindow::slot_log);
 
     connect(m_listener, &ConnectionListener::sig_log, this, &MainWindow::slot_log);
+    connect(m_listener, &ConnectionListener::sig_mapChanged, canvas, &MapCanvas::mapChanged);
+    connect(m_listener,
+            &ConnectionListener::sig_graphicsSettingsChanged,
+            canvas,
+            &MapCanvas::graphicsSettingsChanged);
+    connect(m_listener,
+            &ConnectionListener::sig_newRoomSelection,
+            canvas,
+            &MapCanvas::slot_setRoomSelection);
+    connect(m_listener,
+            &ConnectionListener::sig_infomarksChanged,
+            canvas,
+            &MapCanvas::infomarksChanged);
+    connect(m_listener,
+            &ConnectionListener::sig_moveSessionMarker,
+            canvas,
+            &MapCanvas::slot_moveSessionMarker);
+    connect(m_listener,
+            &ConnectionListener::sig_removeSessionMarker,
+            canvas,
+            &MapCanvas::slot_removeSessionMarker);
+    connect(m_listener, &ConnectionListener::sig_setMode, this, &MainWindow::slot_setMode);
     connect(m_dockDialogClient,
             &QDockWidget::visibilityChanged,
             m_clientWidget,
@@ -550,11 +697,19 @@ void MainWindow::wireConnections()
     connect(m_clientWidget, &ClientWidget::sig_relayMessage, this, [this](const QString &message) {
         statusBar()->showMessage(message, 2000);
     });
+}
 
-    // Find Room Dialog Connections
+FindRoomsDlg &MainWindow::getFindRoomsDlg()
+{
+    if (m_findRoomsDlg != nullptr) {
+        return *m_findRoomsDlg;
+    }
+
+    m_findRoomsDlg = new FindRoomsDlg(*m_mapData, this);
+    m_findRoomsDlg->setObjectName("FindRoomsDlg");
     connect(m_findRoomsDlg,
             &FindRoomsDlg::sig_newRoomSelection,
-            canvas,
+            getCanvas(),
             &MapCanvas::slot_setRoomSelection);
     connect(m_findRoomsDlg,
             &FindRoomsDlg::sig_center,
@@ -565,6 +720,19 @@ void MainWindow::wireConnections()
             &FindRoomsDlg::sig_editSelection,
             this,
             &MainWindow::slot_onEditRoomSelection);
+    return *m_findRoomsDlg;
+}
+
+void MainWindow::scheduleDialogWarmUp()
+{
+    if (m_findRoomsDlg != nullptr) {
+        return;
+    }
+    // After the map is shown and the user can get going; it's still ready long before
+    // anyone looks for a room.
+    QTimer::singleShot(DIALOG_WARM_UP_DELAY_MS, this, [this]() {
+        MAYBE_UNUSED auto &ignored = getFindRoomsDlg();
+    });
 }
 
 void MainWindow::slot_log(const QString &module, const QString &message)
@@ -598,6 +766,12 @@ void MainWindow::createActions()
     reloadAct->setStatusTip(tr("Reload the current map"));
     connect(reloadAct, &QAction::triggered, this, &MainWindow::slot_reload);
 
+    reloadChangesAct = new QAction(tr("Reload and &Apply Changes"), this);
+    reloadChangesAct->setShortcut(tr("Ctrl+Shift+R"));
+    reloadChangesAct->setStatusTip(
+        tr("Apply what changed in the current map's file, without reloading the whole map"));
+    connect(reloadChangesAct, &QAction::triggered, this, &MainWindow::slot_reloadChanges);
+
     saveAct = new QAction(QIcon::fromTheme("document-save", QIcon(":/icons/save.png")),
                           tr("&Save"),
                           this);
@@ -622,6 +796,14 @@ void MainWindow::createActions()
     exportWebMapAct->setStatusTip(tr("Save a copy of the map for webclients"));
     connect(exportWebMapAct, &QAction::triggered, this, &MainWindow::slot_exportWebMap);
 
+    exportWebTilesMapAct = new QAction(tr("Export Web Map with &Tiles As..."), this);
+    exportWebTilesMapAct->setStatusTip(
+        tr("Save a copy of the map for webclients, with the map pre-rendered as images"));
+    connect(exportWebTilesMapAct,
+            &QAction::triggered,
+            this,
+            &MainWindow::slot_exportWebTilesMap);
+
     exportMmpMapAct = new QAction(tr("Export &MMP Map As..."), this);
     exportMmpMapAct->setStatusTip(tr("Save a copy of the map in the MMP format"));
     connect(exportMmpMapAct, &QAction::triggered, this, &MainWindow::slot_exportMmpMap);
@@ -899,11 +1081,27 @@ void MainWindow::createActions()
             this,
             &MainWindow::slot_onConnectToNeighboursRoomSelection);
 
+    undoAct = new QAction(tr("&Undo"), this);
+    undoAct->setStatusTip(tr("Undo the last map edit"));
+    undoAct->setShortcut(QKeySequence::Undo);
+    undoAct->setEnabled(false);
+    connect(undoAct, &QAction::triggered, this, &MainWindow::slot_onUndo);
+
+    redoAct = new QAction(tr("&Redo"), this);
+    redoAct->setStatusTip(tr("Redo the last map edit that was undone"));
+    redoAct->setShortcut(QKeySequence::Redo);
+    redoAct->setEnabled(false);
+    connect(redoAct, &QAction::triggered, this, &MainWindow::slot_onRedo);
+
     findRoomsAct = new QAction(QIcon(":/icons/roomfind.png"), tr("&Find Rooms"), this);
     findRoomsAct->setStatusTip(tr("Find matching rooms"));
     findRoomsAct->setShortcut(tr("Ctrl+F"));
     connect(findRoomsAct, &QAction::triggered, this, &MainWindow::slot_onFindRoom);
 
+    checkMapAct = new QAction(tr("&Check Map Integrity"), this);
+    checkMapAct->setStatusTip(tr("Check the exits and positions of every room"));
+    connect(checkMapAct, &QAction::triggered, this, &MainWindow::slot_onCheckMap);
+
     clientAct = new QAction(QIcon(":/icons/online.png"), tr("&Launch mud client"), this);
     clientAct->setStatusTip(tr("Launch the integrated mud client"));
     connect(clientAct, &QAction::triggered, this, &MainWindow::slot_onLaunchClient);
@@ -1144,10 +1342,12 @@ void MainWindow::disableActions(bool value)
     openAct->setDisabled(value);
     mergeAct->setDisabled(value);
     reloadAct->setDisabled(value);
+    reloadChangesAct->setDisabled(value);
     saveAsAct->setDisabled(value);
     exportBaseMapAct->setDisabled(value);
     exportMm2xmlMapAct->setDisabled(value);
     exportWebMapAct->setDisabled(value);
+    exportWebTilesMapAct->setDisabled(value);
     exportMmpMapAct->setDisabled(value);
     exitAct->setDisabled(value);
     aboutAct->setDisabled(value);
@@ -1191,6 +1391,7 @@ void MainWindow::setupMenuBar()
     fileMenu->addAction(newAct);
     fileMenu->addAction(openAct);
     fileMenu->addAction(reloadAct);
+    fileMenu->addAction(reloadChangesAct);
     fileMenu->addAction(saveAct);
     fileMenu->addAction(saveAsAct);
     fileMenu->addSeparator();
@@ -1198,12 +1399,16 @@ void MainWindow::setupMenuBar()
     exportMenu->addAction(exportBaseMapAct);
     exportMenu->addAction(exportMm2xmlMapAct);
     exportMenu->addAction(exportWebMapAct);
+    exportMenu->addAction(exportWebTilesMapAct);
     exportMenu->addAction(exportMmpMapAct);
     fileMenu->addAction(mergeAct);
     fileMenu->addSeparator();
     fileMenu->addAction(exitAct);
 
     editMenu = menuBar()->addMenu(tr("&Edit"));
+    editMenu->addAction(undoAct);
+    editMenu->addAction(redoAct);
+    editMenu->addSeparator();
     modeMenu = editMenu->addMenu(QIcon(":/icons/online.png"), tr("&Mode"));
     modeMenu->addAction(mapperMode.playModeAct);
     modeMenu->addAction(mapperMode.mapModeAct);
@@ -1240,6 +1445,7 @@ void MainWindow::setupMenuBar()
 
     editMenu->addSeparator();
     editMenu->addAction(findRoomsAct);
+    editMenu->addAction(checkMapAct);
     editMenu->addAction(preferencesAct);
 
     viewMenu = menuBar()->addMenu(tr("&View"));
@@ -1510,14 +1716,14 @@ void MainWindow::setupStatusBar()
 
 void MainWindow::slot_onPreferences()
 {
+    // Only built when it's first opened; it's not warmed up, since most sessions never open it.
     if (m_configDialog == nullptr) {
         m_configDialog = std::make_unique<ConfigDialog>(m_groupManager, this);
+        connect(m_configDialog.get(),
+                &ConfigDialog::sig_graphicsSettingsChanged,
+                m_mapWindow,
+                &MapWindow::slot_graphicsSettingsChanged);
     }
-
-    connect(m_configDialog.get(),
-            &ConfigDialog::sig_graphicsSettingsChanged,
-            m_mapWindow,
-            &MapWindow::slot_graphicsSettingsChanged);
     m_configDialog->show();
 }
 
@@ -1623,6 +1829,9 @@ void MainWindow::slot_newFile()
 
 void MainWindow::forceNewFile()
 {
+    // The save would otherwise finish on behalf of the wrong map.
+    waitForBackgroundSave();
+
     MapStorage mapStorage(*m_mapData, "", this);
     auto *storage = static_cast<AbstractMapStorage *>(&mapStorage);
     connect(storage, &AbstractMapStorage::sig_onNewData, getCanvas(), &MapCanvas::slot_dataLoaded);
@@ -1638,6 +1847,7 @@ void MainWindow::forceNewFile()
     storage->newData();
     setCurrentFile("");
     mapChanged();
+    updateUndoActions();
 }
 
 void MainWindow::slot_merge()
@@ -1678,6 +1888,7 @@ void MainWindow::slot_merge()
     connect(storage, &AbstractMapStorage::sig_onDataLoaded, this, [this]() {
         setWindowModified(false);
         saveAct->setEnabled(false);
+        m_mapData->updateLandmarks();
     });
     connect(&storage->getProgressCounter(),
             &ProgressCounter::sig_onPercentageChanged,
@@ -1688,6 +1899,7 @@ void MainWindow::slot_merge()
     const bool merged = [this, &storage]() -> bool {
         ActionDisabler actionDisabler{*this};
         CanvasHider canvasHider{*this};
+        event_trace::Scope scope{"MapStorage::merge"};
         return storage->canLoad() && storage->mergeData();
     }();
 
@@ -1695,6 +1907,7 @@ void MainWindow::slot_merge()
         showWarning(tr("Failed to merge file %1.").arg(fileName));
     } else {
         mapChanged();
+        updateUndoActions();
         statusBar()->showMessage(tr("File merged"), 2000);
     }
 
@@ -1731,6 +1944,49 @@ void MainWindow::slot_reload()
     }
 }
 
+void MainWindow::slot_reloadChanges()
+{
+    const QString fileName = m_mapData->getFileName();
+    if (fileName.isEmpty() || fileName.startsWith(":") || m_mapReloader->isRunning())
+        return;
+    // Whatever isn't in the file is undone.
+    if (!maybeSave())
+        return;
+    m_mapReloader->start(fileName);
+    statusBar()->showMessage(tr("Reloading map..."));
+}
+
+void MainWindow::slot_mapReloadFinished()
+{
+    std::optional<MapDiff> diff = m_mapReloader->wait();
+    if (!diff.has_value())
+        return;
+    if (!diff->ok) {
+        statusBar()->clearMessage();
+        showWarning(tr("Cannot reload file %1:\n%2.").arg(diff->fileName).arg(diff->error));
+        return;
+    }
+    if (diff->fileName != m_mapData->getFileName()) {
+        statusBar()->clearMessage();
+        return;
+    }
+    if (diff->modificationCount != m_mapData->getModificationCount()) {
+        // Compared against a map that has changed since; compare again.
+        m_mapReloader->start(diff->fileName);
+        return;
+    }
+
+    const bool marksChanged = diff->marks.has_value();
+    m_mapReloader->apply(std::move(diff.value()));
+    setWindowModified(false);
+    saveAct->setEnabled(false);
+    MapCanvas *const canvas = getCanvas();
+    canvas->roomsChanged();
+    if (marksChanged)
+        canvas->infomarksChanged();
+    statusBar()->showMessage(tr("Map reloaded"), 2000);
+}
+
 bool MainWindow::slot_save()
 {
     if (m_mapData->getFileName().isEmpty() || m_mapData->isFileReadOnly()) {
@@ -1855,6 +2111,16 @@ bool MainWindow::slot_exportMm2xmlMap()
 }
 
 bool MainWindow::slot_exportWebMap()
+{
+    return exportWebMap(SaveFormatEnum::WEB);
+}
+
+bool MainWindow::slot_exportWebTilesMap()
+{
+    return exportWebMap(SaveFormatEnum::WEB_TILES);
+}
+
+bool MainWindow::exportWebMap(const SaveFormatEnum format)
 {
     const auto makeSaveDialog = [this]() {
         // FIXME: code duplication
@@ -1874,7 +2140,7 @@ bool MainWindow::slot_exportWebMap()
         return false;
     }
 
-    return saveFile(fileNames[0], SaveModeEnum::BASEMAP, SaveFormatEnum::WEB);
+    return saveFile(fileNames[0], SaveModeEnum::BASEMAP, format);
 }
 
 bool MainWindow::slot_exportMmpMap()
@@ -1912,6 +2178,8 @@ void MainWindow::slot_about()
 
 bool MainWindow::maybeSave()
 {
+    // A save that is still running may be all that's needed.
+    waitForBackgroundSave();
     if (!m_mapData->dataChanged())
         return true;
 
@@ -1924,7 +2192,7 @@ bool MainWindow::maybeSave()
                                          QMessageBox::Cancel | QMessageBox::Escape);
 
     if (ret == QMessageBox::Yes) {
-        return slot_save();
+        return slot_save() && waitForBackgroundSave();
     }
 
     // REVISIT: is it a bug if this returns true? (Shouldn't this always be false?)
@@ -1999,6 +2267,7 @@ void MainWindow::loadFile(const QString &fileName)
     connect(storage.get(), &AbstractMapStorage::sig_onDataLoaded, this, [this]() {
         setWindowModified(false);
         saveAct->setEnabled(false);
+        m_mapData->updateLandmarks();
     });
     connect(&storage->getProgressCounter(),
             &ProgressCounter::sig_onPercentageChanged,
@@ -2009,6 +2278,7 @@ void MainWindow::loadFile(const QString &fileName)
     const bool loaded = [this, &storage]() -> bool {
         ActionDisabler actionDisabler{*this};
         CanvasHider canvasHider{*this};
+        event_trace::Scope scope{"MapStorage::load"};
         return storage->canLoad() && storage->loadData();
     }();
 
@@ -2017,9 +2287,18 @@ void MainWindow::loadFile(const QString &fileName)
         return;
     }
 
+    {
+        // The first map batches need the snapshot with every room's render
+        // signature; building it now, in parallel, keeps it out of the first frame.
+        event_trace::Scope scope{"MapData::getSnapshot"};
+        static_cast<void>(m_mapData->getSnapshot());
+    }
+
     mapChanged();
+    updateUndoActions();
     setCurrentFile(m_mapData->getFileName());
     statusBar()->showMessage(tr("File loaded"), 2000);
+    scheduleDialogWarmUp();
 }
 
 void MainWindow::slot_percentageChanged(const quint32 p)
@@ -2041,11 +2320,28 @@ bool MainWindow::saveFile(const QString &fileName,
                           const SaveModeEnum mode,
                           const SaveFormatEnum format)
 {
+    // One save at a time.
+    waitForBackgroundSave();
+    if (mode == SaveModeEnum::FULL && format == SaveFormatEnum::MM2) {
+        if (getConfig().autoLoad.journalSaves && fileName == m_mapData->getFileName()
+            && saveJournal(fileName)) {
+            return true;
+        }
+        if (getConfig().autoLoad.backgroundSave) {
+            return startBackgroundSave(fileName);
+        }
+    }
+    if (mode == SaveModeEnum::FULL && format == SaveFormatEnum::MMP
+        && getConfig().autoLoad.backgroundSave) {
+        return startBackgroundExport(fileName);
+    }
+
     CanvasDisabler canvasDisabler{deref(getCanvas())};
 
     FileSaver saver;
     // REVISIT: You can still test a directory for writing...
-    if (format != SaveFormatEnum::WEB) { // Web uses a whole directory
+    // Web uses a whole directory
+    if (format != SaveFormatEnum::WEB && format != SaveFormatEnum::WEB_TILES) {
         try {
             saver.open(fileName);
         } catch (const std::exception &e) {
@@ -2064,6 +2360,8 @@ bool MainWindow::saveFile(const QString &fileName,
             return std::make_unique<MmpMapStorage>(*m_mapData, fileName, &saver.file(), this);
         case SaveFormatEnum::WEB:
             return std::make_unique<JsonMapStorage>(*m_mapData, fileName, this);
+        case SaveFormatEnum::WEB_TILES:
+            return std::make_unique<JsonMapStorage>(*m_mapData, fileName, this, true);
         }
         assert(false);
         return {};
@@ -2093,6 +2391,9 @@ bool MainWindow::saveFile(const QString &fileName,
     try {
         saver.close();
     } catch (const std::exception &e) {
+        if (mode == SaveModeEnum::FULL && format == SaveFormatEnum::MM2) {
+            m_mapData->markNeedsFullSave();
+        }
         showWarning(tr("Cannot write file %1:\n%2.").arg(fileName).arg(e.what()));
         return false;
     }
@@ -2102,6 +2403,8 @@ bool MainWindow::saveFile(const QString &fileName,
         // REVISIT: Shouldn't this return false?
     } else {
         if (mode == SaveModeEnum::FULL && format == SaveFormatEnum::MM2) {
+            // The map now has everything the journal had.
+            MapJournal::remove(fileName);
             m_mapData->setFileName(fileName, !QFileInfo(fileName).isWritable());
             setCurrentFile(fileName);
         }
@@ -2113,9 +2416,255 @@ bool MainWindow::saveFile(const QString &fileName,
     return true;
 }
 
+bool MainWindow::saveJournal(const QString &fileName)
+{
+    MapStorage storage(*m_mapData, fileName, this);
+    connect(&storage, &AbstractMapStorage::sig_log, this, &MainWindow::slot_log);
+    if (!storage.canSaveJournal() || !storage.saveJournal()) {
+        return false;
+    }
+
+    setWindowModified(false);
+    saveAct->setEnabled(false);
+    statusBar()->showMessage(tr("File saved"), 2000);
+    return true;
+}
+
+bool MainWindow::startBackgroundSave(const QString &fileName)
+{
+    auto saver = std::make_unique<FileSaver>();
+    try {
+        saver->open(fileName);
+    } catch (const std::exception &e) {
+        showWarning(tr("Cannot write file %1:\n%2.").arg(fileName).arg(e.what()));
+        return false;
+    }
+
+    MapStorage storage(*m_mapData, fileName, this);
+    connect(&storage, &AbstractMapStorage::sig_log, this, &MainWindow::slot_log);
+    MapSaveData data = storage.prepareSave();
+    // Taken after prepareSave(), which may renumber the rooms.
+    m_backgroundSaveModificationCount = m_mapData->getModificationCount();
+
+    m_backgroundSaver->start(std::move(saver), fileName, std::move(data));
+    statusBar()->showMessage(tr("Saving map..."));
+    return true;
+}
+
+bool MainWindow::startBackgroundExport(const QString &fileName)
+{
+    auto saver = std::make_unique<FileSaver>();
+    try {
+        saver->open(fileName);
+    } catch (const std::exception &e) {
+        showWarning(tr("Cannot write file %1:\n%2.").arg(fileName).arg(e.what()));
+        return false;
+    }
+
+    m_backgroundSaver->startExport(std::move(saver),
+                                   fileName,
+                                   [rooms = m_mapData->getSnapshot()](
+                                       QIODevice &device,
+                                       ProgressCounter &progressCounter,
+                                       const std::function<void(const QString &)> &log) {
+                                       return MmpMapStorage::writeData(device,
+                                                                       rooms,
+                                                                       progressCounter,
+                                                                       log);
+                                   });
+    statusBar()->showMessage(tr("Exporting map..."));
+    return true;
+}
+
+bool MainWindow::waitForBackgroundSave()
+{
+    if (std::optional<BackgroundMapSaver::Result> result = m_backgroundSaver->wait()) {
+        if (result->isExport) {
+            return finishBackgroundExport(result->ok, result->fileName, result->error);
+        }
+        return finishBackgroundSave(result->ok, result->fileName, result->error);
+    }
+    return true;
+}
+
+bool MainWindow::finishBackgroundExport(const bool ok,
+                                        const QString &fileName,
+                                        const QString &error)
+{
+    if (!ok) {
+        statusBar()->clearMessage();
+        showWarning(tr("Cannot write file %1:\n%2.").arg(fileName).arg(error));
+        return false;
+    }
+    statusBar()->showMessage(tr("Map exported"), 2000);
+    return true;
+}
+
+bool MainWindow::finishBackgroundSave(const bool ok, const QString &fileName, const QString &error)
+{
+    if (!ok) {
+        m_mapData->markNeedsFullSave();
+        statusBar()->clearMessage();
+        showWarning(tr("Cannot write file %1:\n%2.").arg(fileName).arg(error));
+        return false;
+    }
+
+    // The map now has everything the journal had.
+    MapJournal::remove(fileName);
+    m_mapData->setFileName(fileName, !QFileInfo(fileName).isWritable());
+    setCurrentFile(fileName);
+    // Anything changed while saving still needs to be saved.
+    if (m_mapData->getModificationCount() == m_backgroundSaveModificationCount) {
+        m_mapData->unsetDataChanged();
+        setWindowModified(false);
+        saveAct->setEnabled(false);
+    }
+    statusBar()->showMessage(tr("File saved"), 2000);
+    return true;
+}
+
+void MainWindow::slot_backgroundSavePercentageChanged(const quint32 p)
+{
+    if (m_backgroundSaver->isRunning()) {
+        statusBar()->showMessage(tr("Writing map... %1%").arg(p));
+    }
+}
+
+void MainWindow::slot_backgroundSaveFinished()
+{
+    // Does nothing if the result was already collected by waitForBackgroundSave().
+    waitForBackgroundSave();
+}
+
+void MainWindow::slot_onMapDataChanged()
+{
+    const auto &autoLoad = getConfig().autoLoad;
+    // Since the last save or autosave, whichever came later.
+    const uint64_t changes = std::min(m_mapData->getModificationsSinceSave(),
+                                      m_mapData->getModificationCount()
+                                          - m_autosaveModificationCount);
+    if (autoLoad.autosave && changes >= static_cast<uint64_t>(autoLoad.autosaveChanges)) {
+        slot_autosave();
+    }
+}
+
+void MainWindow::slot_autosave()
+{
+    const auto &autoLoad = getConfig().autoLoad;
+    const QString fileName = m_mapData->getFileName();
+    if (!autoLoad.autosave || !m_mapData->dataChanged() || m_backgroundSaver->isRunning()
+        || fileName.isEmpty() || m_mapData->isFileReadOnly()
+        || !m_sinceAutosave.hasExpired(m_autosaveBackoffMs)) {
+        return;
+    }
+
+    // Either way, the GUI thread only copies what changed; a journal record
+    // for those rooms, or a snapshot for the background saver.
+    QElapsedTimer timer;
+    timer.start();
+    const bool saved = (autoLoad.journalSaves && saveJournal(fileName))
+                       || startBackgroundSave(fileName);
+    const qint64 spent = timer.elapsed();
+    m_sinceAutosave.restart();
+    m_autosaveModificationCount = m_mapData->getModificationCount();
+    m_autosaveBackoffMs = spent * AUTOSAVE_BACKOFF_FACTOR;
+    if (spent > AUTOSAVE_BUDGET_MS) {
+        slot_log("MainWindow",
+                 QString("Autosave took %1 ms; the next one waits at least %2 s.")
+                     .arg(spent)
+                     .arg(m_autosaveBackoffMs / 1000));
+    }
+    if (!saved) {
+        // Don't retry on every change.
+        m_autosaveBackoffMs = std::max<qint64>(m_autosaveBackoffMs, AUTOSAVE_CHECK_MS);
+    }
+}
+
+void MainWindow::slot_onUndo()
+{
+    if (!m_mapData->undo())
+        statusBar()->showMessage(tr("Unable to undo the last map edit"), 2000);
+    updateUndoActions();
+}
+
+void MainWindow::slot_onRedo()
+{
+    if (!m_mapData->redo())
+        statusBar()->showMessage(tr("Unable to redo the map edit"), 2000);
+    updateUndoActions();
+}
+
 void MainWindow::slot_onFindRoom()
 {
-    m_findRoomsDlg->show();
+    getFindRoomsDlg().show();
+}
+
+void MainWindow::slot_onCheckMap()
+{
+    m_manualValidation = m_mapData->requestValidation(true);
+    m_validatedModificationCount = m_mapData->getModificationCount();
+    checkMapAct->setEnabled(false);
+    statusBar()->showMessage(tr("Checking the map..."));
+}
+
+NODISCARD static QString describeProblems(const MapValidationReport &report)
+{
+    QStringList lines;
+#define X_DESCRIBE(UPPER_CASE, friendly) \
+    if (const size_t n = report.count(MapProblemEnum::UPPER_CASE)) { \
+        lines << QString("%1 %2").arg(n).arg(friendly); \
+    }
+    X_FOREACH_MAP_PROBLEM(X_DESCRIBE)
+#undef X_DESCRIBE
+    return lines.join("\n");
+}
+
+void MainWindow::slot_onMapValidated(const quint64 request, const MapValidationReport &report)
+{
+    const size_t problems = report.problems.size();
+    if (request == m_idleValidation) {
+        m_idleValidation = 0;
+        // Only news is logged, not the same problems every time the map settles.
+        if (problems != std::exchange(m_idleProblemsLogged, problems) && problems != 0) {
+            slot_log("MapValidator",
+                     QString("%1 problems found:\n%2").arg(problems).arg(describeProblems(report)));
+        }
+        return;
+    }
+    if (request != m_manualValidation)
+        return;
+
+    m_manualValidation = 0;
+    m_idleProblemsLogged = problems;
+    checkMapAct->setEnabled(true);
+    statusBar()->showMessage(tr("Checked %1 rooms.").arg(report.roomsChecked), 2000);
+    if (problems == 0) {
+        QMessageBox::information(this, tr("Check Map Integrity"), tr("No problems were found."));
+        return;
+    }
+
+    MapTransaction fixes = MapValidator::getFixes(report);
+    const QString found = tr("Found:\n%1").arg(describeProblems(report));
+    if (fixes.empty()) {
+        QMessageBox::warning(this, tr("Check Map Integrity"), found);
+        return;
+    }
+    QMessageBox dlg(QMessageBox::Question,
+                    tr("Check Map Integrity"),
+                    tr("%1\n\nRepair the exits?").arg(found),
+                    QMessageBox::StandardButtons{QMessageBox::Yes | QMessageBox::No},
+                    this);
+    if (dlg.exec() != QMessageBox::Yes)
+        return;
+    if (m_mapData->getSnapshot() != report.snapshot) {
+        // The problems might have been fixed, or moved, in the meantime.
+        QMessageBox::warning(this,
+                             tr("Check Map Integrity"),
+                             tr("The map changed during the check; please check it again."));
+        return;
+    }
+    m_mapData->execute(std::move(fixes));
+    slot_log("MapValidator", QString("Repaired the exits:\n%1").arg(describeProblems(report)));
 }
 
 void MainWindow::slot_onLaunchClient()
@@ -2138,6 +2687,46 @@ void MainWindow::slot_groupNetworkStatus(const bool status)
     }
 }
 
+void MainWindow::slot_shareMapDelta()
+{
+    const bool share = getConfig().groupManager.shareMapChanges
+                       && m_groupManager->getMode() != GroupManagerStateEnum::Off;
+    m_mapData->setShareChanges(share);
+    if (!share)
+        return;
+
+    const std::vector<RoomId> rooms = m_mapData->takeUnsharedRooms();
+    if (rooms.empty())
+        return;
+
+    const SharedMapSnapshot snapshot = m_mapData->getSnapshot();
+    for (size_t begin = 0; begin < rooms.size(); begin += MAX_DELTA_ROOMS) {
+        const size_t end = std::min(rooms.size(), begin + MAX_DELTA_ROOMS);
+        const std::vector<RoomId> chunk(rooms.begin() + static_cast<std::ptrdiff_t>(begin),
+                                        rooms.begin() + static_cast<std::ptrdiff_t>(end));
+        const QByteArray delta = MapStorage::saveDelta(deref(snapshot),
+                                                       chunk,
+                                                       m_mapData->getPosition());
+        m_groupManager->sendMapDelta(delta);
+    }
+}
+
+void MainWindow::slot_applyMapDelta(const QString &from, const QByteArray &delta)
+{
+    const auto log = [this](const QString &msg) { slot_log("GroupManager", msg); };
+    std::vector<LoadedRoom> rooms = MapStorage::loadDelta(delta, log);
+    if (rooms.empty())
+        return;
+
+    const DeltaSummary summary = MapDeltaApplier{deref(m_mapData)}.apply(std::move(rooms));
+    log(QString("Map changes from %1: %2 new rooms, %3 exits added to %4 rooms, %5 conflicts.")
+            .arg(from)
+            .arg(summary.newRooms)
+            .arg(summary.addedExits)
+            .arg(summary.updatedRooms)
+            .arg(summary.conflicts));
+}
+
 void MainWindow::slot_onModeGroupOff()
 {
     groupModeMenu->setIcon(QIcon(":/icons/groupoff.png"));
@@ -2256,7 +2845,7 @@ void MainWindow::slot_onEditInfoMarkSelection()
 void MainWindow::slot_onCreateRoom()
 {
     getCanvas()->slot_createRoom();
-    mapChanged();
+    roomsChanged();
 }
 
 void MainWindow::slot_onEditRoomSelection()
@@ -2293,7 +2882,7 @@ void MainWindow::slot_onDeleteRoomSelection()
 
     execSelectionGroupMapAction(std::make_unique<Remove>());
     getCanvas()->slot_clearRoomSelection();
-    mapChanged();
+    roomsChanged();
 }
 
 void MainWindow::slot_onDeleteConnectionSelection()
@@ -2319,7 +2908,7 @@ void MainWindow::slot_onDeleteConnectionSelection()
     getCanvas()->slot_clearConnectionSelection();
     m_mapData->execute(std::make_unique<RemoveTwoWayExit>(id1, id2, dir1, dir2), tmpSel);
 
-    mapChanged();
+    roomsChanged();
 }
 
 void MainWindow::slot_onMoveUpRoomSelection()
@@ -2327,9 +2916,10 @@ void MainWindow::slot_onMoveUpRoomSelection()
     if (m_roomSelection == nullptr)
         return;
 
-    execSelectionGroupMapAction(std::make_unique<MoveRelative>(Coordinate(0, 0, 1)));
+    deref(m_mapData).execute(std::make_unique<MoveRooms>(Coordinate(0, 0, 1), m_roomSelection),
+                             m_roomSelection);
     slot_onLayerUp();
-    mapChanged();
+    roomsChanged();
 }
 
 void MainWindow::slot_onMoveDownRoomSelection()
@@ -2337,9 +2927,10 @@ void MainWindow::slot_onMoveDownRoomSelection()
     if (m_roomSelection == nullptr)
         return;
 
-    execSelectionGroupMapAction(std::make_unique<MoveRelative>(Coordinate(0, 0, -1)));
+    deref(m_mapData).execute(std::make_unique<MoveRooms>(Coordinate(0, 0, -1), m_roomSelection),
+                             m_roomSelection);
     slot_onLayerDown();
-    mapChanged();
+    roomsChanged();
 }
 
 void MainWindow::slot_onMergeUpRoomSelection()
@@ -2348,7 +2939,7 @@ void MainWindow::slot_onMergeUpRoomSelection()
         return;
 
     execSelectionGroupMapAction(std::make_unique<MergeRelative>(Coordinate(0, 0, 1)));
-    mapChanged();
+    roomsChanged();
     slot_onLayerUp();
     slot_onModeRoomSelect();
 }
@@ -2359,7 +2950,7 @@ void MainWindow::slot_onMergeDownRoomSelection()
         return;
 
     execSelectionGroupMapAction(std::make_unique<MergeRelative>(Coordinate(0, 0, -1)));
-    mapChanged();
+    roomsChanged();
     slot_onLayerDown();
     slot_onModeRoomSelect();
 }
@@ -2370,7 +2961,7 @@ void MainWindow::slot_onConnectToNeighboursRoomSelection()
         return;
 
     execSelectionGroupMapAction(std::make_unique<ConnectToNeighbours>());
-    mapChanged();
+    roomsChanged();
 }
 
 void MainWindow::slot_onCheckForUpdate()
@@ -2440,6 +3031,18 @@ void MainWindow::mapChanged() const
         canvas->mapChanged();
 }
 
+void MainWindow::roomsChanged() const
+{
+    if (MapCanvas *const canvas = getCanvas())
+        canvas->roomsChanged();
+}
+
+void MainWindow::updateUndoActions()
+{
+    undoAct->setEnabled(m_mapData->canUndo());
+    redoAct->setEnabled(m_mapData->canRedo());
+}
+
 void MainWindow::setCanvasMouseMode(const CanvasMouseModeEnum mode)
 {
     if (MapCanvas *const canvas = getCanvas())
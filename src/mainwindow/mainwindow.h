@@ -5,10 +5,13 @@
 // Author: Marek Krejza <krejza@gmail.com> (Caligor)
 // Author: Nils Schimmelmann <nschimme@gmail.com> (Jahara)
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <optional>
 #include <QActionGroup>
 #include <QDockWidget>
+#include <QElapsedTimer>
 #include <QFileDialog>
 #include <QMainWindow>
 #include <QProgressDialog>
@@ -20,6 +23,7 @@
 
 #include "../configuration/configuration.h"
 #include "../display/CanvasMouseModeEnum.h"
+#include "../mapdata/MapValidator.h"
 #include "../mapdata/roomselection.h"
 #include "../pandoragroup/mmapper2group.h"
 
@@ -27,8 +31,10 @@ class AutoLogger;
 class AbstractAction;
 class AdventureTracker;
 class AdventureWidget;
+class BackgroundMapSaver;
 class ClientWidget;
 class ConfigDialog;
+class ConfigSaver;
 class ConnectionListener;
 class ConnectionSelection;
 class FindRoomsDlg;
@@ -37,6 +43,7 @@ class GroupWidget;
 class InfoMarkSelection;
 class MapCanvas;
 class MapData;
+class MapReloader;
 class MapWindow;
 class Mmapper2Group;
 class Mmapper2PathMachine;
@@ -52,6 +59,7 @@ class QPoint;
 class QProgressDialog;
 class QShowEvent;
 class QTextBrowser;
+class QTimer;
 class QToolBar;
 class QWidget;
 class RoomManager;
@@ -68,7 +76,7 @@ class MainWindow final : public QMainWindow
     ~MainWindow() final;
 
     enum class NODISCARD SaveModeEnum { FULL, BASEMAP };
-    enum class NODISCARD SaveFormatEnum { MM2, MM2XML, WEB, MMP };
+    enum class NODISCARD SaveFormatEnum { MM2, MM2XML, WEB, WEB_TILES, MMP };
     bool saveFile(const QString &fileName, SaveModeEnum mode, SaveFormatEnum format);
     void loadFile(const QString &fileName);
     void setCurrentFile(const QString &fileName);
@@ -82,16 +90,23 @@ public slots:
     void slot_newFile();
     void slot_open();
     void slot_reload();
+    void slot_reloadChanges();
     void slot_merge();
     bool slot_save();
     bool slot_saveAs();
     bool slot_exportBaseMap();
     bool slot_exportMm2xmlMap();
     bool slot_exportWebMap();
+    bool slot_exportWebTilesMap();
     bool slot_exportMmpMap();
     void slot_about();
 
     void slot_percentageChanged(quint32);
+    void slot_backgroundSavePercentageChanged(quint32);
+    void slot_backgroundSaveFinished();
+    void slot_mapReloadFinished();
+    void slot_autosave();
+    void slot_onMapDataChanged();
 
     void slot_log(const QString &, const QString &);
 
@@ -118,7 +133,11 @@ public slots:
     void slot_onMergeUpRoomSelection();
     void slot_onMergeDownRoomSelection();
     void slot_onConnectToNeighboursRoomSelection();
+    void slot_onUndo();
+    void slot_onRedo();
     void slot_onFindRoom();
+    void slot_onCheckMap();
+    void slot_onMapValidated(quint64 request, const MapValidationReport &report);
     void slot_onLaunchClient();
     void slot_onPreferences();
     void slot_onPlayMode();
@@ -139,6 +158,8 @@ public slots:
     void slot_onModeGroupClient();
     void slot_onModeGroupServer();
     void slot_groupNetworkStatus(bool toggle);
+    void slot_shareMapDelta();
+    void slot_applyMapDelta(const QString &from, const QByteArray &delta);
 
     void slot_onCheckForUpdate();
     void slot_voteForMUME();
@@ -159,6 +180,17 @@ public slots:
     void startServices();
     void forceNewFile();
     void showWarning(const QString &s);
+    // Appends the changes to the journal of the map, if it can.
+    NODISCARD bool saveJournal(const QString &fileName);
+    // Asks for the directory of a WEB or WEB_TILES export.
+    bool exportWebMap(SaveFormatEnum format);
+    NODISCARD bool startBackgroundSave(const QString &fileName);
+    // Returns false if a background save was running and failed.
+    bool waitForBackgroundSave();
+    bool finishBackgroundSave(bool ok, const QString &fileName, const QString &error);
+    // Exports for other mappers, like MMP, from a snapshot of the map.
+    NODISCARD bool startBackgroundExport(const QString &fileName);
+    bool finishBackgroundExport(bool ok, const QString &fileName, const QString &error);
 
 private:
     MapWindow *m_mapWindow = nullptr;
@@ -172,6 +204,7 @@ public slots:
 
     GameObserver *m_gameObserver = nullptr;
     AutoLogger *m_logger = nullptr;
+    ConfigSaver *m_configSaver = nullptr;
     ConnectionListener *m_listener = nullptr;
     Mmapper2PathMachine *m_pathMachine = nullptr;
     MapData *m_mapData = nullptr;
@@ -197,6 +230,29 @@ public slots:
     std::shared_ptr<InfoMarkSelection> m_infoMarkSelection;
 
     std::unique_ptr<QProgressDialog> m_progressDlg;
+    BackgroundMapSaver *m_backgroundSaver = nullptr;
+    MapReloader *m_mapReloader = nullptr;
+    // MapData::getModificationCount() when the background save started.
+    uint64_t m_backgroundSaveModificationCount = 0;
+    QTimer *m_autosaveTimer = nullptr;
+    QElapsedTimer m_sinceAutosave;
+    // MapData::getModificationCount() when the last autosave started.
+    uint64_t m_autosaveModificationCount = 0;
+    // How long the next autosave waits, so that they only ever take a small
+    // share of the GUI thread.
+    qint64 m_autosaveBackoffMs = 0;
+    // Sends the rooms changed since it last fired to the group.
+    QTimer *m_mapDeltaTimer = nullptr;
+    // Checks the map in the background once it's been left alone for a while.
+    QTimer *m_validationTimer = nullptr;
+    uint64_t m_idleModificationCount = 0;
+    uint64_t m_validatedModificationCount = 0;
+    // The requests of slot_onCheckMap() and of the timer; 0 if none.
+    quint64 m_manualValidation = 0;
+    quint64 m_idleValidation = 0;
+    // Keeps the registered caches within general.cacheBudgetMiB.
+    QTimer *m_cacheBudgetTimer = nullptr;
+    size_t m_idleProblemsLogged = 0;
 
     QToolBar *fileToolBar = nullptr;
     QToolBar *mouseModeToolBar = nullptr;
@@ -225,11 +281,13 @@ public slots:
     QAction *openAct = nullptr;
     QAction *mergeAct = nullptr;
     QAction *reloadAct = nullptr;
+    QAction *reloadChangesAct = nullptr;
     QAction *saveAct = nullptr;
     QAction *saveAsAct = nullptr;
     QAction *exportBaseMapAct = nullptr;
     QAction *exportMm2xmlMapAct = nullptr;
     QAction *exportWebMapAct = nullptr;
+    QAction *exportWebTilesMapAct = nullptr;
     QAction *exportMmpMapAct = nullptr;
     QAction *exitAct = nullptr;
     QAction *voteAct = nullptr;
@@ -312,7 +370,10 @@ public slots:
     QAction *mergeDownRoomSelectionAct = nullptr;
     QAction *connectToNeighboursRoomSelectionAct = nullptr;
 
+    QAction *undoAct = nullptr;
+    QAction *redoAct = nullptr;
     QAction *findRoomsAct = nullptr;
+    QAction *checkMapAct = nullptr;
 
     QAction *clientAct = nullptr;
     QAction *saveLogAct = nullptr;
@@ -324,6 +385,9 @@ public slots:
     std::unique_ptr<ConfigDialog> m_configDialog;
 
     void wireConnections();
+    // Built on first use, or soon after a map is loaded.
+    NODISCARD FindRoomsDlg &getFindRoomsDlg();
+    void scheduleDialogWarmUp();
 
     void createActions();
     void setupMenuBar();
@@ -393,6 +457,8 @@ public slots:
     void endProgressDialog();
     NODISCARD MapCanvas *getCanvas() const;
     void mapChanged() const;
+    void roomsChanged() const;
+    void updateUndoActions();
     void setCanvasMouseMode(CanvasMouseModeEnum mode);
     void execSelectionGroupMapAction(std::unique_ptr<AbstractAction> action);
 };
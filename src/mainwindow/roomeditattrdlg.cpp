@@ -9,6 +9,8 @@
 #include <cstddef>
 #include <map>
 #include <memory>
+#include <optional>
+#include <utility>
 #include <QMessageLogContext>
 #include <QString>
 #include <QVariant>
@@ -292,6 +294,7 @@ RoomEditAttrDlg::RoomEditAttrDlg(QWidget *parent)
 
 RoomEditAttrDlg::~RoomEditAttrDlg()
 {
+    flushPendingEdits();
     writeSettings();
 
     for (auto &x : mobListItems)
@@ -511,6 +514,8 @@ ExitDirEnum RoomEditAttrDlg::getSelectedExit()
 
 void RoomEditAttrDlg::roomListCurrentIndexChanged(int /*unused*/)
 {
+    // The pending edits are for the previously selected room(s).
+    flushPendingEdits();
     updateDialog(getSelectedRoom());
 }
 
@@ -518,6 +523,7 @@ void RoomEditAttrDlg::setRoomSelection(const SharedRoomSelection &rs,
                                        MapData *const md,
                                        MapCanvas *const mc)
 {
+    flushPendingEdits();
     m_roomSelection = rs;
     m_mapData = md;
     m_mapCanvas = mc;
@@ -565,6 +571,9 @@ void setFlags(T &array, const QFlags<Qt::ItemFlag> &flags)
 
 void RoomEditAttrDlg::updateDialog(const Room *r)
 {
+    // Otherwise the dialog would show the rooms as they were before the edits.
+    flushPendingEdits();
+
     struct NODISCARD DisconnectReconnectAntiPattern final
     {
         RoomEditAttrDlg &self;
@@ -651,7 +660,7 @@ void RoomEditAttrDlg::updateDialog(const Room *r)
         roomDescriptionTextEdit->clear();
         roomDescriptionTextEdit->setFontItalic(false);
         {
-            QString str = r->getDescription().toQString();
+            QString str = r->readDescription().toQString();
             // note: older rooms may not have a trailing newline
             // REVISIT: what if they have \r\n?
             if (str.endsWith("\n"))
@@ -659,7 +668,7 @@ void RoomEditAttrDlg::updateDialog(const Room *r)
             roomDescriptionTextEdit->append(str);
         }
         roomDescriptionTextEdit->setFontItalic(true);
-        roomDescriptionTextEdit->append(r->getContents().toQString());
+        roomDescriptionTextEdit->append(r->readContents().toQString());
 
         roomNoteTextEdit->clear();
         roomNoteTextEdit->append(r->getNote().toQString());
@@ -807,17 +816,42 @@ void RoomEditAttrDlg::exitButtonToggled(bool /*unused*/)
 void RoomEditAttrDlg::updateCommon(std::unique_ptr<AbstractAction> moved_action,
                                    bool onlyExecuteAction)
 {
-    if (const Room *const r = getSelectedRoom()) {
-        m_mapData->execute(std::make_unique<SingleRoomAction>(std::exchange(moved_action, {}),
-                                                              r->getId()),
-                           m_roomSelection);
-    } else {
-        m_mapData->execute(std::make_unique<GroupMapAction>(std::exchange(moved_action, {}),
-                                                            m_roomSelection),
-                           m_roomSelection);
+    if (m_pendingActions.empty()) {
+        QTimer::singleShot(0, this, &RoomEditAttrDlg::flushPendingEdits);
+    }
+    m_pendingActions.emplace_back(std::move(moved_action));
+    m_pendingRefresh = m_pendingRefresh || !onlyExecuteAction;
+}
+
+void RoomEditAttrDlg::flushPendingEdits()
+{
+    if (m_pendingActions.empty())
+        return;
+
+    auto actions = std::exchange(m_pendingActions, {});
+    const bool refresh = std::exchange(m_pendingRefresh, false);
+
+    if (m_mapData != nullptr && m_roomSelection != nullptr) {
+        const Room *const r = getSelectedRoom();
+        const std::optional<RoomId> selectedId = (r != nullptr) ? std::optional{r->getId()}
+                                                                : std::nullopt;
+        // One lock of the map and one round of notifications for all of them.
+        m_mapData->executeBatch([this, &actions, &selectedId]() {
+            for (auto &action : actions) {
+                if (selectedId.has_value()) {
+                    m_mapData->execute(std::make_unique<SingleRoomAction>(std::move(action),
+                                                                          selectedId.value()),
+                                       m_roomSelection);
+                } else {
+                    m_mapData->execute(std::make_unique<GroupMapAction>(std::move(action),
+                                                                        m_roomSelection),
+                                       m_roomSelection);
+                }
+            }
+        });
     }
 
-    if (!onlyExecuteAction) {
+    if (refresh) {
         updateDialog(getSelectedRoom());
         emit sig_requestUpdate();
     }
@@ -1024,6 +1058,7 @@ void RoomEditAttrDlg::exitFlagsListItemChanged(QListWidgetItem *const item)
     switch (item->checkState()) {
     case Qt::Unchecked:
         if (flags.isExit()) {
+            flushPendingEdits();
             // Remove connections when the exit is removed
             const auto &from = getSelectedRoom()->getId();
             const auto &e = getSelectedRoom()->exit(dir);
@@ -1046,6 +1081,7 @@ void RoomEditAttrDlg::exitFlagsListItemChanged(QListWidgetItem *const item)
 
 void RoomEditAttrDlg::doorNameLineEditTextChanged()
 {
+    flushPendingEdits();
     const Room *const r = getSelectedRoom();
 
     m_mapData->execute(std::make_unique<SingleRoomAction>(
@@ -1072,6 +1108,7 @@ void RoomEditAttrDlg::doorFlagsListItemChanged(QListWidgetItem *const item)
     const auto dir = getSelectedExit();
 
     const auto modifyExit = [this, flags, dir](const FlagModifyModeEnum mode) {
+        flushPendingEdits();
         m_mapData->execute(
             std::make_unique<SingleRoomAction>(std::make_unique<ModifyExitFlags>(flags, dir, mode),
                                                deref(getSelectedRoom()).getId()),
@@ -1134,5 +1171,6 @@ void RoomEditAttrDlg::roomNoteChanged()
 // all tabs
 void RoomEditAttrDlg::closeClicked()
 {
+    flushPendingEdits();
     accept();
 }
@@ -132,8 +132,16 @@ public slots:
     ExitDirEnum getSelectedExit();
     void updateDialog(const Room *r);
 
+private:
+    // Edits made while handling the same batch of UI events, e.g. checking many flags at
+    // once, are applied to the selection together by flushPendingEdits().
+    std::vector<std::unique_ptr<AbstractAction>> m_pendingActions;
+    bool m_pendingRefresh = false;
+
 private:
     void updateCommon(std::unique_ptr<AbstractAction> moved_action, bool onlyExecuteAction = false);
+    // Applies the pending edits to every selected room as one batch, then refreshes once.
+    void flushPendingEdits();
     void updateRoomAlign(RoomAlignEnum value);
     void updateRoomPortable(RoomPortableEnum value);
     void updateRoomRideable(RoomRidableEnum value);
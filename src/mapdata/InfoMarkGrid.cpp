@@ -0,0 +1,162 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "InfoMarkGrid.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "../global/utils.h"
+#include "infomark.h"
+
+// 8 rooms on a side.
+static constexpr const int CELL_SIZE = 8 * INFOMARK_SCALE;
+
+int InfoMarkGrid::getCell(const int n)
+{
+    // Rounds toward negative infinity, so -1 and 0 don't share a cell.
+    return (n >= 0) ? (n / CELL_SIZE) : -((-n - 1) / CELL_SIZE) - 1;
+}
+
+InfoMarkGrid::CellKey InfoMarkGrid::getCellKey(const Coordinate &c)
+{
+    return CellKey{getCell(c.x), getCell(c.y), c.z};
+}
+
+void InfoMarkGrid::addToCell(const CellKey &key, const InfoMark *const mark)
+{
+    m_cells[key].emplace_back(mark);
+}
+
+void InfoMarkGrid::removeFromCell(const CellKey &key, const InfoMark *const mark)
+{
+    const auto it = m_cells.find(key);
+    if (it == m_cells.end()) {
+        assert(false);
+        return;
+    }
+    auto &marks = it->second;
+    const auto found = std::find(marks.begin(), marks.end(), mark);
+    if (found == marks.end()) {
+        assert(false);
+        return;
+    }
+    *found = marks.back();
+    marks.pop_back();
+    if (marks.empty()) {
+        m_cells.erase(it);
+    }
+}
+
+void InfoMarkGrid::insert(const std::shared_ptr<InfoMark> &mark)
+{
+    if (mark == nullptr || m_entries.find(mark.get()) != m_entries.end())
+        return;
+
+    Entry entry;
+    entry.mark = mark;
+    entry.sequence = m_nextSequence++;
+    entry.cell1 = getCellKey(mark->getPosition1());
+    entry.cell2 = getCellKey(mark->getPosition2());
+    addToCell(entry.cell1, mark.get());
+    if (entry.cell2 != entry.cell1) {
+        addToCell(entry.cell2, mark.get());
+    }
+    m_entries.emplace(mark.get(), std::move(entry));
+}
+
+void InfoMarkGrid::remove(const InfoMark &mark)
+{
+    const auto it = m_entries.find(&mark);
+    if (it == m_entries.end())
+        return;
+
+    const Entry &entry = it->second;
+    removeFromCell(entry.cell1, &mark);
+    if (entry.cell2 != entry.cell1) {
+        removeFromCell(entry.cell2, &mark);
+    }
+    m_entries.erase(it);
+}
+
+void InfoMarkGrid::update(const InfoMark &mark)
+{
+    const auto it = m_entries.find(&mark);
+    if (it == m_entries.end())
+        return;
+
+    Entry &entry = it->second;
+    const CellKey cell1 = getCellKey(mark.getPosition1());
+    const CellKey cell2 = getCellKey(mark.getPosition2());
+    if (cell1 == entry.cell1 && cell2 == entry.cell2)
+        return;
+
+    removeFromCell(entry.cell1, &mark);
+    if (entry.cell2 != entry.cell1) {
+        removeFromCell(entry.cell2, &mark);
+    }
+    entry.cell1 = cell1;
+    entry.cell2 = cell2;
+    addToCell(cell1, &mark);
+    if (cell2 != cell1) {
+        addToCell(cell2, &mark);
+    }
+}
+
+void InfoMarkGrid::clear()
+{
+    m_entries.clear();
+    m_cells.clear();
+    m_nextSequence = 0;
+}
+
+std::vector<std::shared_ptr<InfoMark>> InfoMarkGrid::getCandidates(const Coordinate &c1,
+                                                                   const Coordinate &c2) const
+{
+    const int z = c1.z;
+    const int cx1 = getCell(std::min(c1.x, c2.x));
+    const int cy1 = getCell(std::min(c1.y, c2.y));
+    const int cx2 = getCell(std::max(c1.x, c2.x));
+    const int cy2 = getCell(std::max(c1.y, c2.y));
+
+    std::vector<const Entry *> found;
+    const auto addCell = [this, &found](const CellKey &key) {
+        const auto it = m_cells.find(key);
+        if (it == m_cells.end())
+            return;
+        for (const InfoMark *const mark : it->second) {
+            found.emplace_back(&m_entries.at(mark));
+        }
+    };
+
+    // A huge box is cheaper to answer by visiting the occupied cells.
+    const auto width = static_cast<int64_t>(cx2) - static_cast<int64_t>(cx1) + 1;
+    const auto height = static_cast<int64_t>(cy2) - static_cast<int64_t>(cy1) + 1;
+    if (width * height > static_cast<int64_t>(m_cells.size())) {
+        for (const auto &kv : m_cells) {
+            const CellKey &key = kv.first;
+            if (key.z == z && isClamped(key.x, cx1, cx2) && isClamped(key.y, cy1, cy2)) {
+                addCell(key);
+            }
+        }
+    } else {
+        for (int cy = cy1; cy <= cy2; ++cy) {
+            for (int cx = cx1; cx <= cx2; ++cx) {
+                addCell(CellKey{cx, cy, z});
+            }
+        }
+    }
+
+    // Marks with both endpoints in the box were found twice.
+    std::sort(found.begin(), found.end(), [](const Entry *const a, const Entry *const b) {
+        return a->sequence < b->sequence;
+    });
+    found.erase(std::unique(found.begin(), found.end()), found.end());
+
+    std::vector<std::shared_ptr<InfoMark>> result;
+    result.reserve(found.size());
+    for (const Entry *const entry : found) {
+        result.emplace_back(entry->mark);
+    }
+    return result;
+}
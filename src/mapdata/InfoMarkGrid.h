@@ -0,0 +1,86 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "../expandoracommon/CoordinateKey.h"
+#include "../expandoracommon/coordinate.h"
+#include "../global/RuleOf5.h"
+#include "../global/macros.h"
+
+class InfoMark;
+
+/**
+ * Uniform grid over the infomark endpoints, one per layer, so that picking
+ * the marks in a box only has to look at the cells the box overlaps.
+ *
+ * Both Position1 and Position2 are indexed regardless of the mark type, so
+ * the candidates may include marks that a caller's exact test rejects, but
+ * never miss one that it accepts.
+ */
+class NODISCARD InfoMarkGrid final
+{
+private:
+    struct NODISCARD CellKey final
+    {
+        int x = 0;
+        int y = 0;
+        int z = 0;
+
+        NODISCARD bool operator==(const CellKey &rhs) const
+        {
+            return x == rhs.x && y == rhs.y && z == rhs.z;
+        }
+        NODISCARD bool operator!=(const CellKey &rhs) const { return !(*this == rhs); }
+    };
+
+    struct NODISCARD CellKeyHash final
+    {
+        NODISCARD size_t operator()(const CellKey &key) const
+        {
+            return CoordinateKeyHash{}(CoordinateKey{key.x, key.y, key.z});
+        }
+    };
+
+    struct NODISCARD Entry final
+    {
+        std::shared_ptr<InfoMark> mark;
+        // Order of insertion, so results come back in map order.
+        uint64_t sequence = 0;
+        CellKey cell1;
+        CellKey cell2;
+    };
+
+    std::unordered_map<const InfoMark *, Entry> m_entries;
+    std::unordered_map<CellKey, std::vector<const InfoMark *>, CellKeyHash> m_cells;
+    uint64_t m_nextSequence = 0;
+
+public:
+    InfoMarkGrid() = default;
+    ~InfoMarkGrid() = default;
+    DELETE_CTORS_AND_ASSIGN_OPS(InfoMarkGrid);
+
+public:
+    void insert(const std::shared_ptr<InfoMark> &mark);
+    void remove(const InfoMark &mark);
+    // Call after the mark's Position1 or Position2 changed; does nothing
+    // for marks that were never inserted.
+    void update(const InfoMark &mark);
+    void clear();
+
+    // Marks with an endpoint that may be inside the box on layer c1.z;
+    // the arguments are pre-scaled by INFOMARK_SCALE.
+    NODISCARD std::vector<std::shared_ptr<InfoMark>> getCandidates(const Coordinate &c1,
+                                                                   const Coordinate &c2) const;
+
+private:
+    NODISCARD static int getCell(int n);
+    NODISCARD static CellKey getCellKey(const Coordinate &c);
+    void addToCell(const CellKey &key, const InfoMark *mark);
+    void removeFromCell(const CellKey &key, const InfoMark *mark);
+};
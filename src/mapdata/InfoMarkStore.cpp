@@ -0,0 +1,111 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "InfoMarkStore.h"
+
+#include <cassert>
+#include <utility>
+
+#include "infomark.h"
+
+const InfoMarkStore::MarkerList &InfoMarkStore::getLayer(const int layer) const
+{
+    static const MarkerList empty;
+    const auto it = m_layers.find(layer);
+    return (it == m_layers.end()) ? empty : it->second;
+}
+
+void InfoMarkStore::reserve(const size_t count)
+{
+    m_marks.reserve(count);
+    m_slots.reserve(count);
+}
+
+void InfoMarkStore::addToLayer(Slot &slot, const std::shared_ptr<InfoMark> &mark)
+{
+    MarkerList &bucket = m_layers[slot.layer];
+    slot.layerIndex = bucket.size();
+    bucket.emplace_back(mark);
+}
+
+void InfoMarkStore::removeFromLayer(const Slot &slot)
+{
+    const auto it = m_layers.find(slot.layer);
+    if (it == m_layers.end()) {
+        assert(false);
+        return;
+    }
+    MarkerList &bucket = it->second;
+    assert(slot.layerIndex < bucket.size());
+    if (slot.layerIndex + 1 != bucket.size()) {
+        std::shared_ptr<InfoMark> &last = bucket.back();
+        m_slots.at(last.get()).layerIndex = slot.layerIndex;
+        bucket[slot.layerIndex] = std::move(last);
+    }
+    bucket.pop_back();
+    if (bucket.empty()) {
+        m_layers.erase(it);
+    }
+}
+
+bool InfoMarkStore::insert(const std::shared_ptr<InfoMark> &mark)
+{
+    if (mark == nullptr || contains(*mark))
+        return false;
+
+    Slot slot;
+    slot.index = m_marks.size();
+    slot.layer = mark->getPosition1().z;
+    addToLayer(slot, mark);
+    m_marks.emplace_back(mark);
+    m_slots.emplace(mark.get(), slot);
+    m_grid.insert(mark);
+    return true;
+}
+
+bool InfoMarkStore::remove(const InfoMark &mark)
+{
+    const auto it = m_slots.find(&mark);
+    if (it == m_slots.end())
+        return false;
+
+    const Slot slot = it->second;
+    m_grid.remove(mark);
+    removeFromLayer(slot);
+    m_slots.erase(it);
+
+    if (slot.index + 1 != m_marks.size()) {
+        std::shared_ptr<InfoMark> &last = m_marks.back();
+        m_slots.at(last.get()).index = slot.index;
+        m_marks[slot.index] = std::move(last);
+    }
+    m_marks.pop_back();
+    return true;
+}
+
+void InfoMarkStore::update(const InfoMark &mark)
+{
+    const auto it = m_slots.find(&mark);
+    if (it == m_slots.end())
+        return;
+
+    m_grid.update(mark);
+
+    Slot &slot = it->second;
+    const int layer = mark.getPosition1().z;
+    if (layer == slot.layer)
+        return;
+
+    const std::shared_ptr<InfoMark> shared = m_marks[slot.index];
+    removeFromLayer(slot);
+    slot.layer = layer;
+    addToLayer(slot, shared);
+}
+
+void InfoMarkStore::clear()
+{
+    m_marks.clear();
+    m_layers.clear();
+    m_slots.clear();
+    m_grid.clear();
+}
@@ -0,0 +1,74 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "../expandoracommon/coordinate.h"
+#include "../global/RuleOf5.h"
+#include "../global/macros.h"
+#include "InfoMarkGrid.h"
+
+class InfoMark;
+
+/**
+ * Owns the map's infomarks: a dense list, the same marks bucketed by layer
+ * (the z of Position1), and an InfoMarkGrid for picking them by position.
+ *
+ * Each mark remembers its slot in the list and in its layer, so inserting
+ * and removing are O(1); removal swaps the last mark into the hole, so the
+ * order of the list is only stable while nothing is removed.
+ */
+class NODISCARD InfoMarkStore final
+{
+private:
+    using MarkerList = std::vector<std::shared_ptr<InfoMark>>;
+
+    struct NODISCARD Slot final
+    {
+        size_t index = 0;
+        int layer = 0;
+        size_t layerIndex = 0;
+    };
+
+    MarkerList m_marks;
+    std::map<int, MarkerList> m_layers;
+    std::unordered_map<const InfoMark *, Slot> m_slots;
+    InfoMarkGrid m_grid;
+
+public:
+    InfoMarkStore() = default;
+    ~InfoMarkStore() = default;
+    DELETE_CTORS_AND_ASSIGN_OPS(InfoMarkStore);
+
+public:
+    NODISCARD const MarkerList &getList() const { return m_marks; }
+    // Marks whose Position1 is on the layer.
+    NODISCARD const MarkerList &getLayer(int layer) const;
+    NODISCARD const InfoMarkGrid &getGrid() const { return m_grid; }
+    NODISCARD size_t size() const { return m_marks.size(); }
+    NODISCARD bool empty() const { return m_marks.empty(); }
+    NODISCARD bool contains(const InfoMark &mark) const
+    {
+        return m_slots.find(&mark) != m_slots.end();
+    }
+
+public:
+    void reserve(size_t count);
+    // Returns false if the mark is null or already stored.
+    bool insert(const std::shared_ptr<InfoMark> &mark);
+    // Returns false if the mark wasn't stored.
+    bool remove(const InfoMark &mark);
+    // Call after the mark's Position1 or Position2 changed; does nothing
+    // for marks that aren't stored.
+    void update(const InfoMark &mark);
+    void clear();
+
+private:
+    void addToLayer(Slot &slot, const std::shared_ptr<InfoMark> &mark);
+    void removeFromLayer(const Slot &slot);
+};
@@ -0,0 +1,194 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "Landmarks.h"
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+
+static constexpr const double INF = std::numeric_limits<double>::infinity();
+
+NODISCARD static Landmarks::Graph reverseGraph(const Landmarks::Graph &graph)
+{
+    const size_t n = graph.size();
+    Landmarks::Graph result;
+    result.offsets.assign(n + 1, 0);
+    for (const Landmarks::Edge &e : graph.edges) {
+        ++result.offsets[e.to + 1];
+    }
+    for (size_t i = 0; i < n; ++i) {
+        result.offsets[i + 1] += result.offsets[i];
+    }
+
+    result.edges.resize(graph.edges.size());
+    std::vector<uint32_t> next{result.offsets.begin(), result.offsets.end() - 1};
+    for (uint32_t from = 0; from < n; ++from) {
+        for (uint32_t i = graph.offsets[from]; i < graph.offsets[from + 1]; ++i) {
+            const Landmarks::Edge &e = graph.edges[i];
+            result.edges[next[e.to]++] = Landmarks::Edge{from, e.length};
+        }
+    }
+    return result;
+}
+
+// Fills dist[0..n) with the distances from source; returns false if cancelled.
+NODISCARD static bool dijkstra(const Landmarks::Graph &graph,
+                               const uint32_t source,
+                               double *const dist,
+                               const std::atomic_bool &cancel)
+{
+    using Entry = std::pair<double, uint32_t>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+
+    std::fill(dist, dist + graph.size(), INF);
+    dist[source] = 0.0;
+    queue.emplace(0.0, source);
+    for (size_t popped = 0; !queue.empty(); ++popped) {
+        if (popped % 1024 == 0 && cancel.load(std::memory_order_relaxed))
+            return false;
+
+        const auto [d, room] = queue.top();
+        queue.pop();
+        if (d > dist[room])
+            continue;
+
+        for (uint32_t i = graph.offsets[room]; i < graph.offsets[room + 1]; ++i) {
+            const Landmarks::Edge &e = graph.edges[i];
+            const double candidate = d + e.length;
+            if (candidate < dist[e.to]) {
+                dist[e.to] = candidate;
+                queue.emplace(candidate, e.to);
+            }
+        }
+    }
+    return true;
+}
+
+Landmarks::Landmarks(this_is_private, const size_t numRooms)
+    : m_numRooms{numRooms}
+{}
+
+std::shared_ptr<const Landmarks> Landmarks::compute(const Graph &graph,
+                                                    const size_t numLandmarks,
+                                                    const std::atomic_bool &cancel)
+{
+    const size_t n = graph.size();
+    auto result = std::make_shared<Landmarks>(this_is_private{0}, n);
+
+    // Rooms without exits make poor landmarks; start from the first one that has some.
+    std::optional<uint32_t> next;
+    for (uint32_t i = 0; i < n && !next.has_value(); ++i) {
+        if (graph.offsets[i] != graph.offsets[i + 1])
+            next = i;
+    }
+    if (!next.has_value())
+        return result;
+
+    const Graph reverse = reverseGraph(graph);
+    // Distance from the nearest landmark so far; each new landmark is the
+    // reachable room farthest from all the others.
+    std::vector<double> nearest(n, INF);
+    while (next.has_value() && result->m_landmarks.size() < numLandmarks) {
+        const uint32_t landmark = next.value();
+        const size_t base = result->m_landmarks.size() * n;
+        result->m_landmarks.emplace_back(RoomId{landmark});
+        result->m_from.resize(base + n);
+        result->m_to.resize(base + n);
+        if (!dijkstra(graph, landmark, &result->m_from[base], cancel)
+            || !dijkstra(reverse, landmark, &result->m_to[base], cancel)) {
+            return nullptr;
+        }
+
+        next.reset();
+        double farthest = 0.0;
+        for (uint32_t i = 0; i < n; ++i) {
+            nearest[i] = std::min(nearest[i], result->m_from[base + i]);
+            if (nearest[i] != INF && nearest[i] > farthest) {
+                farthest = nearest[i];
+                next = i;
+            }
+        }
+    }
+    return result;
+}
+
+double Landmarks::getLowerBound(const RoomId from, const RoomId to) const
+{
+    const size_t a = from.asUint32();
+    const size_t b = to.asUint32();
+    if (a >= m_numRooms || b >= m_numRooms)
+        return 0.0;
+
+    double best = 0.0;
+    for (size_t i = 0, base = 0; i < m_landmarks.size(); ++i, base += m_numRooms) {
+        // Unreachable pairs say nothing useful (and INF - INF is NaN).
+        if (m_from[base + a] != INF && m_from[base + b] != INF)
+            best = std::max(best, m_from[base + b] - m_from[base + a]);
+        if (m_to[base + a] != INF && m_to[base + b] != INF)
+            best = std::max(best, m_to[base + a] - m_to[base + b]);
+    }
+    return best;
+}
+
+LandmarkCache::~LandmarkCache()
+{
+    std::lock_guard<std::mutex> threadLock{m_threadMutex};
+    stopThread();
+}
+
+std::shared_ptr<const Landmarks> LandmarkCache::get() const
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    return m_current;
+}
+
+bool LandmarkCache::needsRebuild() const
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    return m_current == nullptr && m_building != m_generation;
+}
+
+void LandmarkCache::invalidate()
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    ++m_generation;
+    m_current.reset();
+    if (m_building.has_value()) {
+        // Whatever it finds is already out of date.
+        m_cancel.store(true, std::memory_order_relaxed);
+    }
+}
+
+void LandmarkCache::rebuild(Landmarks::Graph graph)
+{
+    std::lock_guard<std::mutex> threadLock{m_threadMutex};
+    stopThread();
+
+    std::lock_guard<std::mutex> lock{m_mutex};
+    const uint64_t generation = m_generation;
+    m_building = generation;
+    m_cancel.store(false, std::memory_order_relaxed);
+    m_thread = std::thread([this, generation, graph = std::move(graph)]() {
+        auto landmarks = Landmarks::compute(graph, Landmarks::DEFAULT_NUM_LANDMARKS, m_cancel);
+
+        std::lock_guard<std::mutex> publishLock{m_mutex};
+        if (landmarks != nullptr && generation == m_generation) {
+            m_current = std::move(landmarks);
+        }
+        if (m_building == generation) {
+            m_building.reset();
+        }
+    });
+}
+
+void LandmarkCache::stopThread()
+{
+    if (!m_thread.joinable())
+        return;
+    m_cancel.store(true, std::memory_order_relaxed);
+    m_thread.join();
+}
@@ -0,0 +1,112 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "../global/RuleOf5.h"
+#include "../global/macros.h"
+#include "../global/roomid.h"
+
+/**
+ * Shortest distances from and to a handful of landmark rooms, which give A*
+ * a lower bound via the triangle inequality (ALT):
+ *
+ *   d(a, b) >= d(L, b) - d(L, a)  and  d(a, b) >= d(a, L) - d(b, L).
+ *
+ * Unlike a coordinate bound, this one follows the roads and the rivers, so
+ * long routes only touch the rooms near the path.
+ */
+class NODISCARD Landmarks final
+{
+public:
+    struct NODISCARD Edge final
+    {
+        uint32_t to = 0;
+        double length = 0.0;
+    };
+
+    // The edges leaving room i are edges[offsets[i]] .. edges[offsets[i + 1]],
+    // with rooms indexed by RoomId.
+    struct NODISCARD Graph final
+    {
+        std::vector<uint32_t> offsets{0};
+        std::vector<Edge> edges;
+
+        NODISCARD size_t size() const { return offsets.size() - 1; }
+    };
+
+public:
+    static constexpr const size_t DEFAULT_NUM_LANDMARKS = 16;
+
+private:
+    struct NODISCARD this_is_private final
+    {
+        explicit this_is_private(int) {}
+    };
+
+    size_t m_numRooms = 0;
+    std::vector<RoomId> m_landmarks;
+    // [landmark * m_numRooms + room]; infinite if unreachable.
+    std::vector<double> m_from;
+    std::vector<double> m_to;
+
+public:
+    // Returns nullptr if `cancel` was set before it finished.
+    NODISCARD static std::shared_ptr<const Landmarks> compute(const Graph &graph,
+                                                              size_t numLandmarks,
+                                                              const std::atomic_bool &cancel);
+
+public:
+    explicit Landmarks(this_is_private, size_t numRooms);
+    DELETE_CTORS_AND_ASSIGN_OPS(Landmarks);
+
+public:
+    NODISCARD size_t getNumLandmarks() const { return m_landmarks.size(); }
+    // Never more than the true distance on the graph the landmarks were built for.
+    NODISCARD double getLowerBound(RoomId from, RoomId to) const;
+};
+
+/**
+ * Owns the current Landmarks and the thread that rebuilds them.
+ *
+ * The map invalidates them whenever the room graph may have changed; the
+ * next rebuild() then computes fresh ones in the background. Until that is
+ * done get() returns nullptr, and searches fall back to plain A*.
+ */
+class NODISCARD LandmarkCache final
+{
+private:
+    // Serializes rebuild(), which joins and replaces m_thread.
+    std::mutex m_threadMutex;
+    mutable std::mutex m_mutex;
+    std::shared_ptr<const Landmarks> m_current;
+    // Bumped by invalidate(); a build only publishes if it is still current.
+    uint64_t m_generation = 0;
+    std::optional<uint64_t> m_building;
+    std::thread m_thread;
+    std::atomic_bool m_cancel{false};
+
+public:
+    LandmarkCache() = default;
+    ~LandmarkCache();
+    DELETE_CTORS_AND_ASSIGN_OPS(LandmarkCache);
+
+public:
+    NODISCARD std::shared_ptr<const Landmarks> get() const;
+    // True unless the landmarks are current or already being built.
+    NODISCARD bool needsRebuild() const;
+    void invalidate();
+    // Starts building landmarks for `graph` on another thread.
+    void rebuild(Landmarks::Graph graph);
+
+private:
+    void stopThread();
+};
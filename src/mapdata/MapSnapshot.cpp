@@ -0,0 +1,165 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "MapSnapshot.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "../expandoracommon/exit.h"
+
+NODISCARD static RoomModificationTracker &getSnapshotTracker()
+{
+    // Snapshot rooms are never modified, so nothing is ever reported here.
+    // Leaked on purpose: a snapshot may outlive any other object.
+    static auto *const tracker = new RoomModificationTracker{};
+    return *tracker;
+}
+
+NODISCARD static constexpr size_t chunkOf(const RoomId id)
+{
+    return id.asUint32() >> MapSnapshot::CHUNK_BITS;
+}
+
+NODISCARD static constexpr size_t slotOf(const RoomId id)
+{
+    return id.asUint32() & (MapSnapshot::CHUNK_SIZE - 1u);
+}
+
+MapSnapshot::MapSnapshot(this_is_private) {}
+
+MapSnapshot::~MapSnapshot() = default;
+
+SharedMapSnapshot MapSnapshot::derive(const SharedMapSnapshot &previous,
+                                      const RoomIndex &rooms,
+                                      std::vector<RoomId> changed,
+                                      const Coordinate &min,
+                                      const Coordinate &max)
+{
+    auto result = std::make_shared<MapSnapshot>(this_is_private{0});
+    const uint32_t numIds = static_cast<uint32_t>(rooms.size());
+
+    if (previous != nullptr) {
+        result->m_chunks = previous->m_chunks;
+        result->m_roomCount = previous->m_roomCount;
+        result->m_generation = previous->m_generation + 1u;
+        std::sort(changed.begin(), changed.end());
+        changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+    } else {
+        result->m_generation = 1u;
+        changed.clear();
+        for (uint32_t i = 0; i < numIds; ++i) {
+            if (rooms[RoomId{i}] != nullptr)
+                changed.emplace_back(i);
+        }
+    }
+    result->m_min = min;
+    result->m_max = max;
+
+    auto &chunks = result->m_chunks;
+    const size_t numChunks = (static_cast<size_t>(numIds) + CHUNK_SIZE - 1u) >> CHUNK_BITS;
+    if (chunks.size() < numChunks)
+        chunks.resize(numChunks);
+
+    // Ids are sorted, so each touched chunk is copied exactly once.
+    for (auto it = changed.begin(); it != changed.end();) {
+        const size_t chunkIndex = chunkOf(*it);
+        if (chunkIndex >= chunks.size()) {
+            // Can't be in the snapshot, and isn't in the map.
+            ++it;
+            continue;
+        }
+
+        SharedChunk &slot = chunks[chunkIndex];
+        auto chunk = (slot != nullptr) ? std::make_shared<Chunk>(*slot) : std::make_shared<Chunk>();
+        for (; it != changed.end() && chunkOf(*it) == chunkIndex; ++it) {
+            const RoomId id = *it;
+            SharedConstRoom &entry = (*chunk)[slotOf(id)];
+            if (entry != nullptr) {
+                assert(result->m_roomCount != 0);
+                --result->m_roomCount;
+            }
+
+            const SharedRoom &live = (id.asUint32() < numIds) ? rooms[id] : nullptr;
+            if (live != nullptr) {
+                entry = live->cloneExact(getSnapshotTracker());
+                ++result->m_roomCount;
+            } else {
+                entry.reset();
+            }
+        }
+
+        const bool empty = std::all_of(chunk->begin(), chunk->end(), [](const SharedConstRoom &r) {
+            return r == nullptr;
+        });
+        if (empty)
+            slot.reset();
+        else
+            slot = std::move(chunk);
+    }
+
+    if (previous == nullptr) {
+        result->m_graph = RoomGraph::derive(nullptr, rooms, {});
+        result->m_signatures = RoomRenderSignatures::derive(nullptr, rooms, {});
+    } else {
+        // Edge costs depend on both rooms, so rooms with exits into a changed
+        // room (before or after the change) need their edges recomputed too.
+        std::vector<RoomId> affected = changed;
+        const auto addIncoming = [&affected](const Room &room) {
+            for (const Exit &e : room.getExitsList()) {
+                for (const RoomId from : e.inRange())
+                    affected.emplace_back(from);
+            }
+        };
+        for (const RoomId id : changed) {
+            if (id.asUint32() < numIds && rooms[id] != nullptr)
+                addIncoming(*rooms[id]);
+            if (const Room *const old = previous->getRoom(id))
+                addIncoming(*old);
+        }
+        std::sort(affected.begin(), affected.end());
+        affected.erase(std::unique(affected.begin(), affected.end()), affected.end());
+        result->m_graph = RoomGraph::derive(previous->m_graph, rooms, affected);
+
+        // In-flows are drawn on the room flowed into, so rooms that a changed
+        // room has exits to (before or after the change) need new signatures.
+        std::vector<RoomId> outgoing = changed;
+        const auto addOutgoing = [&outgoing](const Room &room) {
+            for (const Exit &e : room.getExitsList()) {
+                for (const RoomId to : e.outRange())
+                    outgoing.emplace_back(to);
+            }
+        };
+        for (const RoomId id : changed) {
+            if (id.asUint32() < numIds && rooms[id] != nullptr)
+                addOutgoing(*rooms[id]);
+            if (const Room *const old = previous->getRoom(id))
+                addOutgoing(*old);
+        }
+        std::sort(outgoing.begin(), outgoing.end());
+        outgoing.erase(std::unique(outgoing.begin(), outgoing.end()), outgoing.end());
+        result->m_signatures = RoomRenderSignatures::derive(previous->m_signatures,
+                                                            rooms,
+                                                            outgoing);
+    }
+
+    return result;
+}
+
+const Room *MapSnapshot::getRoom(const RoomId id) const
+{
+    const size_t chunkIndex = chunkOf(id);
+    if (id == INVALID_ROOMID || chunkIndex >= m_chunks.size())
+        return nullptr;
+    const SharedChunk &chunk = m_chunks[chunkIndex];
+    return (chunk != nullptr) ? (*chunk)[slotOf(id)].get() : nullptr;
+}
+
+SharedConstRoom MapSnapshot::getSharedRoom(const RoomId id) const
+{
+    const size_t chunkIndex = chunkOf(id);
+    if (id == INVALID_ROOMID || chunkIndex >= m_chunks.size())
+        return nullptr;
+    const SharedChunk &chunk = m_chunks[chunkIndex];
+    return (chunk != nullptr) ? (*chunk)[slotOf(id)] : nullptr;
+}
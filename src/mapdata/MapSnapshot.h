@@ -0,0 +1,107 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "../expandoracommon/coordinate.h"
+#include "../expandoracommon/room.h"
+#include "../global/RuleOf5.h"
+#include "../global/macros.h"
+#include "../global/roomid.h"
+#include "RoomGraph.h"
+#include "RoomRenderSignatures.h"
+
+class MapSnapshot;
+using SharedMapSnapshot = std::shared_ptr<const MapSnapshot>;
+
+/**
+ * Immutable read-only view of every room in the map at one point in time.
+ *
+ * Rooms are stored in fixed-size chunks of ids. Chunks (and the rooms in
+ * them) are shared with the snapshot they were derived from, so a new
+ * snapshot only copies the chunks and rooms that changed since then.
+ *
+ * A snapshot never changes after it has been created, so it can be read
+ * from any thread without holding the map lock.
+ */
+class NODISCARD MapSnapshot final
+{
+public:
+    static constexpr const uint32_t CHUNK_BITS = 8;
+    static constexpr const uint32_t CHUNK_SIZE = 1u << CHUNK_BITS;
+    using Chunk = std::array<SharedConstRoom, CHUNK_SIZE>;
+    using SharedChunk = std::shared_ptr<const Chunk>;
+
+private:
+    struct NODISCARD this_is_private final
+    {
+        explicit this_is_private(int) {}
+    };
+
+private:
+    std::vector<SharedChunk> m_chunks;
+    SharedRoomGraph m_graph;
+    SharedRoomRenderSignatures m_signatures;
+    uint64_t m_generation = 0;
+    size_t m_roomCount = 0;
+    Coordinate m_min;
+    Coordinate m_max;
+
+public:
+    explicit MapSnapshot(this_is_private);
+    ~MapSnapshot();
+    DELETE_CTORS_AND_ASSIGN_OPS(MapSnapshot);
+
+public:
+    // Builds a snapshot of `rooms` that shares everything except `changed`
+    // with `previous`. Pass a null `previous` to copy every room.
+    NODISCARD static SharedMapSnapshot derive(const SharedMapSnapshot &previous,
+                                              const RoomIndex &rooms,
+                                              std::vector<RoomId> changed,
+                                              const Coordinate &min,
+                                              const Coordinate &max);
+
+public:
+    NODISCARD const Room *getRoom(RoomId id) const;
+    NODISCARD SharedConstRoom getSharedRoom(RoomId id) const;
+
+    // Calls callback(const Room &) for each room, in id order.
+    template<typename Callback>
+    void forEachRoom(Callback &&callback) const
+    {
+        for (const SharedChunk &chunk : m_chunks) {
+            if (chunk == nullptr)
+                continue;
+            for (const SharedConstRoom &room : *chunk) {
+                if (room != nullptr)
+                    callback(*room);
+            }
+        }
+    }
+
+public:
+    // Routing edges for exactly these rooms.
+    NODISCARD const RoomGraph &getGraph() const { return *m_graph; }
+    NODISCARD const RoomRenderSignature &getRenderSignature(const RoomId id) const
+    {
+        return m_signatures->getSignature(id);
+    }
+
+public:
+    // Incremented every time a snapshot is derived from the live map.
+    NODISCARD uint64_t getGeneration() const { return m_generation; }
+    NODISCARD size_t getRoomsCount() const { return m_roomCount; }
+    // Every room id in the snapshot is below this.
+    NODISCARD size_t getIdLimit() const { return m_chunks.size() * CHUNK_SIZE; }
+    NODISCARD const Coordinate &getMin() const { return m_min; }
+
+public:
+    // A chunk is the same object in two snapshots iff none of its rooms changed.
+    NODISCARD size_t getChunkCount() const { return m_chunks.size(); }
+    NODISCARD const SharedChunk &getChunk(const size_t index) const { return m_chunks.at(index); }
+    NODISCARD const Coordinate &getMax() const { return m_max; }
+};
@@ -0,0 +1,44 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "../expandoracommon/room.h"
+#include "../global/macros.h"
+#include "../global/roomid.h"
+
+class MapAction;
+
+// Every room touched by a transaction, with the union of its update flags.
+using RoomUpdateMap = std::map<RoomId, RoomUpdateFlags>;
+
+/**
+ * A batch of actions for MapData::execute(MapTransaction).
+ *
+ * The whole batch runs under one lock acquisition, and the resulting room
+ * notifications are reported once at the end instead of once per change.
+ */
+class NODISCARD MapTransaction final
+{
+private:
+    std::vector<std::shared_ptr<MapAction>> m_actions;
+
+public:
+    MapTransaction() = default;
+
+public:
+    void add(std::shared_ptr<MapAction> action) { m_actions.emplace_back(std::move(action)); }
+    void reserve(const size_t n) { m_actions.reserve(n); }
+
+public:
+    NODISCARD bool empty() const { return m_actions.empty(); }
+    NODISCARD size_t size() const { return m_actions.size(); }
+    NODISCARD std::vector<std::shared_ptr<MapAction>> takeActions()
+    {
+        return std::exchange(m_actions, {});
+    }
+};
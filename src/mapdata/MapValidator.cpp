@@ -0,0 +1,256 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "MapValidator.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+
+#include "../expandoracommon/CoordinateKey.h"
+#include "../expandoracommon/exit.h"
+#include "../expandoracommon/room.h"
+#include "../global/parallel.h"
+#include "../global/utils.h"
+#include "customaction.h"
+
+// Rooms checked between cancellation checks.
+static constexpr const size_t PAGE_ROOMS = 4096;
+static constexpr const size_t CHECK_BATCH = 256;
+
+const char *getFriendlyName(const MapProblemEnum problem)
+{
+#define X_CASE(UPPER_CASE, friendly) \
+    case MapProblemEnum::UPPER_CASE: \
+        return friendly;
+    switch (problem) {
+        X_FOREACH_MAP_PROBLEM(X_CASE)
+    }
+#undef X_CASE
+    return "unknown problems";
+}
+
+size_t MapValidationReport::count(const MapProblemEnum type) const
+{
+    return static_cast<size_t>(
+        std::count_if(problems.begin(), problems.end(), [type](const MapProblem &p) {
+            return p.type == type;
+        }));
+}
+
+namespace { // anonymous
+
+void checkRoom(const MapSnapshot &snapshot, const Room &room, std::vector<MapProblem> &out)
+{
+    const RoomId id = room.getId();
+    for (const ExitDirEnum dir : ALL_EXITS7) {
+        const Exit &e = room.exit(dir);
+        const ExitDirEnum back = opposite(dir);
+        for (const RoomId to : e.outRange()) {
+            const Room *const target = snapshot.getRoom(to);
+            if (target == nullptr) {
+                out.emplace_back(MapProblem{MapProblemEnum::DANGLING_EXIT, id, dir, to});
+            } else if (!target->exit(back).containsIn(id)) {
+                out.emplace_back(MapProblem{MapProblemEnum::ONE_SIDED_EXIT, id, dir, to});
+            }
+        }
+        for (const RoomId from : e.inRange()) {
+            const Room *const source = snapshot.getRoom(from);
+            if (source == nullptr) {
+                out.emplace_back(MapProblem{MapProblemEnum::DANGLING_ENTRANCE, id, dir, from});
+            } else if (!source->exit(back).containsOut(id)) {
+                out.emplace_back(MapProblem{MapProblemEnum::ONE_SIDED_ENTRANCE, id, dir, from});
+            }
+        }
+    }
+}
+
+// Adds the room and the rooms it's connected to.
+void addWithNeighbours(const Room &room, std::vector<RoomId> &ids)
+{
+    ids.emplace_back(room.getId());
+    for (const Exit &e : room.getExitsList()) {
+        for (const RoomId to : e.outRange()) {
+            ids.emplace_back(to);
+        }
+        for (const RoomId from : e.inRange()) {
+            ids.emplace_back(from);
+        }
+    }
+}
+
+void addChunk(const MapSnapshot::SharedChunk &chunk, std::vector<RoomId> &ids)
+{
+    if (chunk == nullptr)
+        return;
+    for (const SharedConstRoom &room : *chunk) {
+        if (room != nullptr)
+            addWithNeighbours(*room, ids);
+    }
+}
+
+} // namespace
+
+MapValidator::MapValidator(QObject *const parent)
+    : QObject(parent)
+{
+    m_thread = std::thread([this]() { run(); });
+}
+
+MapValidator::~MapValidator()
+{
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_stopping.store(true, std::memory_order_relaxed);
+    }
+    m_wakeUp.notify_one();
+    m_thread.join();
+}
+
+MapValidator::RequestId MapValidator::validate(SharedMapSnapshot snapshot, const bool full)
+{
+    RequestId id = 0;
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        id = m_latest.fetch_add(1, std::memory_order_relaxed) + 1;
+        m_pending = Request{id, std::move(snapshot), full};
+    }
+    m_wakeUp.notify_one();
+    return id;
+}
+
+void MapValidator::run()
+{
+    while (true) {
+        std::optional<Request> request;
+        {
+            std::unique_lock<std::mutex> lock{m_mutex};
+            m_wakeUp.wait(lock, [this]() {
+                return m_stopping.load(std::memory_order_relaxed) || m_pending.has_value();
+            });
+            if (m_stopping.load(std::memory_order_relaxed)) {
+                return;
+            }
+            request = std::exchange(m_pending, std::nullopt);
+        }
+        process(request.value());
+    }
+}
+
+void MapValidator::process(const Request &request)
+{
+    const RequestId id = request.id;
+    const auto isCancelled = [this, id]() {
+        return m_stopping.load(std::memory_order_relaxed)
+               || m_latest.load(std::memory_order_relaxed) != id;
+    };
+
+    const MapSnapshot &snapshot = deref(request.snapshot);
+    const MapSnapshot *const previous = request.full ? nullptr : m_lastChecked.get();
+    const size_t numChunks = snapshot.getChunkCount();
+    const size_t prevChunks = (previous != nullptr) ? previous->getChunkCount() : 0;
+
+    // The rooms of changed chunks, before and after, and everything they
+    // connect to; a change can only break the invariants of those.
+    std::vector<RoomId> candidates;
+    for (size_t c = 0; c < std::max(numChunks, prevChunks); ++c) {
+        const MapSnapshot::SharedChunk *const chunk = (c < numChunks) ? &snapshot.getChunk(c)
+                                                                       : nullptr;
+        const MapSnapshot::SharedChunk *const prevChunk = (c < prevChunks)
+                                                              ? &previous->getChunk(c)
+                                                              : nullptr;
+        if (previous != nullptr && chunk != nullptr && prevChunk != nullptr
+            && *chunk == *prevChunk) {
+            continue;
+        }
+        if (chunk != nullptr)
+            addChunk(*chunk, candidates);
+        if (prevChunk != nullptr)
+            addChunk(*prevChunk, candidates);
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    std::vector<std::vector<MapProblem>> found(candidates.size());
+    for (size_t begin = 0; begin < candidates.size(); begin += PAGE_ROOMS) {
+        if (isCancelled()) {
+            return;
+        }
+        const size_t end = std::min(candidates.size(), begin + PAGE_ROOMS);
+        parallelFor(
+            end - begin,
+            [begin, &candidates, &snapshot, &found](const size_t i) {
+                if (const Room *const room = snapshot.getRoom(candidates[begin + i])) {
+                    checkRoom(snapshot, *room, found[begin + i]);
+                }
+            },
+            CHECK_BATCH);
+    }
+
+    // Positions are cheap enough to index for every room each time.
+    std::vector<MapProblem> overlaps;
+    {
+        std::unordered_map<Coordinate, RoomId, CoordinateHash> positions;
+        positions.reserve(snapshot.getRoomsCount());
+        snapshot.forEachRoom([&positions, &overlaps](const Room &room) {
+            const auto [it, inserted] = positions.emplace(room.getPosition(), room.getId());
+            if (!inserted) {
+                overlaps.emplace_back(MapProblem{MapProblemEnum::OVERLAPPING_ROOMS,
+                                                 room.getId(),
+                                                 ExitDirEnum::UNKNOWN,
+                                                 it->second});
+            }
+        });
+    }
+    if (isCancelled()) {
+        return;
+    }
+
+    if (request.full || previous == nullptr) {
+        m_known.clear();
+    }
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        if (found[i].empty()) {
+            m_known.erase(candidates[i]);
+        } else {
+            m_known[candidates[i]] = std::move(found[i]);
+        }
+    }
+    m_lastChecked = request.snapshot;
+
+    MapValidationReport report;
+    for (const auto &[room, problems] : m_known) {
+        report.problems.insert(report.problems.end(), problems.begin(), problems.end());
+    }
+    report.problems.insert(report.problems.end(), overlaps.begin(), overlaps.end());
+    report.snapshot = request.snapshot;
+    report.roomsChecked = candidates.size();
+    report.full = request.full;
+    emit sig_validated(id, report);
+}
+
+MapTransaction MapValidator::getFixes(const MapValidationReport &report)
+{
+    MapTransaction transaction;
+    for (const MapProblem &p : report.problems) {
+        switch (p.type) {
+        case MapProblemEnum::ONE_SIDED_EXIT:
+            // The exit is what the mapper drew, so the entrance is added.
+            transaction.add(std::make_shared<AddOneWayExit>(p.room, p.other, p.dir));
+            break;
+        case MapProblemEnum::DANGLING_EXIT:
+            transaction.add(std::make_shared<RemoveOneWayExit>(p.room, p.other, p.dir));
+            break;
+        case MapProblemEnum::ONE_SIDED_ENTRANCE:
+        case MapProblemEnum::DANGLING_ENTRANCE:
+            // The other room has no such exit, so only the entrance is removed.
+            transaction.add(std::make_shared<RemoveOneWayExit>(p.other, p.room, opposite(p.dir)));
+            break;
+        case MapProblemEnum::OVERLAPPING_ROOMS:
+            break;
+        }
+    }
+    return transaction;
+}
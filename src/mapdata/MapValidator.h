@@ -0,0 +1,116 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+#include <QObject>
+#include <QtCore>
+#include <QtGlobal>
+
+#include "../global/RuleOf5.h"
+#include "../global/macros.h"
+#include "../global/roomid.h"
+#include "ExitDirection.h"
+#include "MapSnapshot.h"
+#include "MapTransaction.h"
+
+#define X_FOREACH_MAP_PROBLEM(X) \
+    X(ONE_SIDED_EXIT, "exits without the matching entrance") \
+    X(ONE_SIDED_ENTRANCE, "entrances without the matching exit") \
+    X(DANGLING_EXIT, "exits to rooms that don't exist") \
+    X(DANGLING_ENTRANCE, "entrances from rooms that don't exist") \
+    X(OVERLAPPING_ROOMS, "rooms at the same position as another")
+
+#define X_DECL_MAP_PROBLEM(UPPER_CASE, friendly) UPPER_CASE,
+enum class NODISCARD MapProblemEnum { X_FOREACH_MAP_PROBLEM(X_DECL_MAP_PROBLEM) };
+#undef X_DECL_MAP_PROBLEM
+
+NODISCARD extern const char *getFriendlyName(MapProblemEnum problem);
+
+struct NODISCARD MapProblem final
+{
+    MapProblemEnum type = MapProblemEnum::ONE_SIDED_EXIT;
+    RoomId room = INVALID_ROOMID;
+    // The direction of the room's exit or entrance; UNKNOWN for overlaps.
+    ExitDirEnum dir = ExitDirEnum::UNKNOWN;
+    // The room at the other end, or the one at the same position.
+    RoomId other = INVALID_ROOMID;
+};
+
+struct NODISCARD MapValidationReport final
+{
+    // What the rooms of the snapshot are known to violate, by room.
+    std::vector<MapProblem> problems;
+    SharedMapSnapshot snapshot;
+    size_t roomsChecked = 0;
+    bool full = false;
+
+    NODISCARD size_t count(MapProblemEnum type) const;
+};
+Q_DECLARE_METATYPE(MapValidationReport)
+
+/**
+ * Checks the invariants of the map on a worker thread, against a snapshot:
+ * every exit has the matching entrance in the room it leads to (and the
+ * other way around), every exit leads to a room that exists, and no two
+ * rooms share a position.
+ *
+ * Checks are incremental: only the snapshot chunks that changed since the
+ * last check (see MapSnapshot::getChunk()), and the rooms connected to them,
+ * are checked again; what the rest of the map was found to violate is kept.
+ * Rooms are checked a page at a time, so a newer request cancels the one
+ * that's running within a page, like RoomSearchService.
+ */
+class MapValidator final : public QObject
+{
+    Q_OBJECT
+
+public:
+    using RequestId = quint64;
+
+private:
+    struct NODISCARD Request final
+    {
+        RequestId id = 0;
+        SharedMapSnapshot snapshot;
+        bool full = false;
+    };
+
+    std::mutex m_mutex;
+    std::condition_variable m_wakeUp;
+    std::optional<Request> m_pending;
+    std::atomic<RequestId> m_latest{0};
+    std::atomic_bool m_stopping{false};
+    // Only used by the worker.
+    SharedMapSnapshot m_lastChecked;
+    std::map<RoomId, std::vector<MapProblem>> m_known;
+    std::thread m_thread;
+
+public:
+    explicit MapValidator(QObject *parent = nullptr);
+    ~MapValidator() final;
+    DELETE_CTORS_AND_ASSIGN_OPS(MapValidator);
+
+public:
+    // A full check forgets what earlier checks found, and checks every room.
+    NODISCARD RequestId validate(SharedMapSnapshot snapshot, bool full);
+
+public:
+    // The actions that repair the exits; overlapping rooms are left alone.
+    NODISCARD static MapTransaction getFixes(const MapValidationReport &report);
+
+signals:
+    // Not emitted for requests that were cancelled.
+    void sig_validated(quint64 request, const MapValidationReport &report);
+
+private:
+    void run();
+    void process(const Request &request);
+};
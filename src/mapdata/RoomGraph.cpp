@@ -0,0 +1,187 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "RoomGraph.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "../expandoracommon/exit.h"
+#include "../global/enums.h"
+#include "../global/parallel.h"
+#include "ExitFlags.h"
+#include "mmapper2room.h"
+
+// Movement costs per terrain type.
+// Same order as the RoomTerrainEnum enum.
+// Values taken from https://github.com/nstockton/tintin-mume/blob/master/mapperproxy/mapper/constants.py
+
+NODISCARD static double terrain_cost(const RoomTerrainEnum type)
+{
+    switch (type) {
+    case RoomTerrainEnum::UNDEFINED:
+        return 1.0; // undefined
+    case RoomTerrainEnum::INDOORS:
+        return 0.75; // indoors
+    case RoomTerrainEnum::CITY:
+        return 0.75; // city
+    case RoomTerrainEnum::FIELD:
+        return 1.5; // field
+    case RoomTerrainEnum::FOREST:
+        return 2.15; // forest
+    case RoomTerrainEnum::HILLS:
+        return 2.45; // hills
+    case RoomTerrainEnum::MOUNTAINS:
+        return 2.8; // mountains
+    case RoomTerrainEnum::SHALLOW:
+        return 2.45; // shallow
+    case RoomTerrainEnum::WATER:
+        return 50.0; // water
+    case RoomTerrainEnum::RAPIDS:
+        return 60.0; // rapids
+    case RoomTerrainEnum::UNDERWATER:
+        return 100.0; // underwater
+    case RoomTerrainEnum::ROAD:
+        return 0.85; // road
+    case RoomTerrainEnum::BRUSH:
+        return 1.5; // brush
+    case RoomTerrainEnum::TUNNEL:
+        return 0.75; // tunnel
+    case RoomTerrainEnum::CAVERN:
+        return 0.75; // cavern
+    case RoomTerrainEnum::DEATHTRAP:
+        return 1000.0; // deathtrap
+    }
+
+    return 1.0;
+}
+
+NODISCARD static double getLength(const Exit &e, const Room *curr, const Room *nextr)
+{
+    double cost = terrain_cost(nextr->getTerrainType());
+    auto flags = e.getExitFlags();
+    if (flags.isRandom() || flags.isDamage() || flags.isFall()) {
+        cost += 30;
+    }
+    if (flags.isDoor()) {
+        cost += 1;
+    }
+    if (flags.isClimb()) {
+        cost += 2;
+    }
+    if (nextr->getRidableType() == RoomRidableEnum::NOT_RIDABLE) {
+        cost += 3;
+        // One non-ridable room means walking two rooms, plus dismount/mount.
+        if (curr->getRidableType() != RoomRidableEnum::NOT_RIDABLE) {
+            cost += 4;
+        }
+    }
+    if (flags.isRoad()) { // Not sure if this is appropriate.
+        cost -= 0.1;
+    }
+    return cost;
+}
+
+NODISCARD static constexpr size_t chunkOf(const RoomId id)
+{
+    return id.asUint32() >> RoomGraph::CHUNK_BITS;
+}
+
+NODISCARD static constexpr size_t slotOf(const RoomId id)
+{
+    return id.asUint32() & (RoomGraph::CHUNK_SIZE - 1u);
+}
+
+NODISCARD static RoomGraph::Edges computeEdges(const RoomIndex &rooms, const Room &room)
+{
+    RoomGraph::Edges result;
+    const ExitsList &exits = room.getExitsList();
+    for (const ExitDirEnum dir : ALL_EXITS7) {
+        const Exit &e = exits[dir];
+        if (!e.outIsUnique()) {
+            // 0: Not mapped
+            // 2+: Random, so no clear directions; skip it.
+            continue;
+        }
+        if (!e.isExit()) {
+            continue;
+        }
+        const RoomId to = e.outFirst();
+        if (to.asUint32() >= rooms.size() || rooms[to] == nullptr) {
+            continue;
+        }
+        result.add(RoomGraph::Edge{to.asUint32(),
+                                   static_cast<float>(getLength(e, &room, rooms[to].get())),
+                                   dir});
+    }
+    return result;
+}
+
+RoomGraph::RoomGraph(this_is_private) {}
+
+RoomGraph::~RoomGraph() = default;
+
+SharedRoomGraph RoomGraph::derive(const SharedRoomGraph &previous,
+                                  const RoomIndex &rooms,
+                                  const std::vector<RoomId> &changed)
+{
+    auto result = std::make_shared<RoomGraph>(this_is_private{0});
+    const uint32_t numIds = static_cast<uint32_t>(rooms.size());
+    const size_t numChunks = (static_cast<size_t>(numIds) + CHUNK_SIZE - 1u) >> CHUNK_BITS;
+
+    auto &chunks = result->m_chunks;
+    if (previous == nullptr) {
+        // Every chunk only reads the rooms, so a freshly loaded map is done on every core.
+        chunks.resize(numChunks);
+        parallelFor(
+            numChunks,
+            [&chunks, &rooms, numIds](const size_t chunkIndex) {
+                auto chunk = std::make_shared<Chunk>();
+                bool empty = true;
+                for (uint32_t slot = 0; slot < CHUNK_SIZE; ++slot) {
+                    const uint32_t id = static_cast<uint32_t>(chunkIndex << CHUNK_BITS) + slot;
+                    if (id < numIds && rooms[RoomId{id}] != nullptr) {
+                        (*chunk)[slot] = computeEdges(rooms, *rooms[RoomId{id}]);
+                        empty = false;
+                    }
+                }
+                if (!empty)
+                    chunks[chunkIndex] = std::move(chunk);
+            },
+            4);
+        return result;
+    }
+
+    chunks = previous->m_chunks;
+    if (chunks.size() < numChunks)
+        chunks.resize(numChunks);
+
+    assert(std::is_sorted(changed.begin(), changed.end()));
+    for (auto it = changed.begin(); it != changed.end();) {
+        const size_t chunkIndex = chunkOf(*it);
+        if (chunkIndex >= chunks.size()) {
+            ++it;
+            continue;
+        }
+
+        SharedChunk &slot = chunks[chunkIndex];
+        auto chunk = (slot != nullptr) ? std::make_shared<Chunk>(*slot) : std::make_shared<Chunk>();
+        for (; it != changed.end() && chunkOf(*it) == chunkIndex; ++it) {
+            const RoomId id = *it;
+            const SharedRoom &room = (id.asUint32() < numIds) ? rooms[id] : nullptr;
+            (*chunk)[slotOf(id)] = (room != nullptr) ? computeEdges(rooms, *room) : Edges{};
+        }
+        slot = std::move(chunk);
+    }
+    return result;
+}
+
+const RoomGraph::Edges &RoomGraph::getEdges(const RoomId id) const
+{
+    static const Edges noEdges;
+    const size_t chunkIndex = chunkOf(id);
+    if (id == INVALID_ROOMID || chunkIndex >= m_chunks.size())
+        return noEdges;
+    const SharedChunk &chunk = m_chunks[chunkIndex];
+    return (chunk != nullptr) ? (*chunk)[slotOf(id)] : noEdges;
+}
@@ -0,0 +1,93 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "../expandoracommon/room.h"
+#include "../global/RuleOf5.h"
+#include "../global/macros.h"
+#include "../global/roomid.h"
+#include "ExitDirection.h"
+
+class RoomGraph;
+using SharedRoomGraph = std::shared_ptr<const RoomGraph>;
+
+/**
+ * The exits a path may take out of each room, with the cost of taking them
+ * computed up front, so that searches never look at Room or Exit objects.
+ * Unmapped and random exits, and exits to missing rooms, are left out.
+ *
+ * Like MapSnapshot, a graph is immutable and stored in chunks of ids that are
+ * shared with the graph it was derived from; deriving only recomputes the
+ * rooms it is told about.
+ */
+class NODISCARD RoomGraph final
+{
+public:
+    struct NODISCARD Edge final
+    {
+        uint32_t to = 0;
+        float length = 0.f;
+        ExitDirEnum dir = ExitDirEnum::NONE;
+    };
+
+    class NODISCARD Edges final
+    {
+    private:
+        std::array<Edge, NUM_EXITS> m_edges{};
+        uint8_t m_size = 0;
+
+    public:
+        void add(const Edge &edge)
+        {
+            assert(m_size < NUM_EXITS);
+            m_edges[m_size++] = edge;
+        }
+        NODISCARD const Edge *begin() const { return m_edges.data(); }
+        NODISCARD const Edge *end() const { return m_edges.data() + m_size; }
+        NODISCARD size_t size() const { return m_size; }
+    };
+
+    static constexpr const uint32_t CHUNK_BITS = 8;
+    static constexpr const uint32_t CHUNK_SIZE = 1u << CHUNK_BITS;
+    using Chunk = std::array<Edges, CHUNK_SIZE>;
+    using SharedChunk = std::shared_ptr<const Chunk>;
+
+    // The cheapest edge: 0.75 terrain, minus 0.1 for a road exit (as a float).
+    static constexpr const double MIN_LENGTH = static_cast<double>(0.65f);
+
+private:
+    struct NODISCARD this_is_private final
+    {
+        explicit this_is_private(int) {}
+    };
+
+private:
+    std::vector<SharedChunk> m_chunks;
+
+public:
+    explicit RoomGraph(this_is_private);
+    ~RoomGraph();
+    DELETE_CTORS_AND_ASSIGN_OPS(RoomGraph);
+
+public:
+    // Recomputes the edges of the sorted `changed` rooms, sharing the rest
+    // with `previous`. An edge's cost depends on both of its rooms, so that
+    // includes the rooms with exits into any room that changed. Pass a null
+    // `previous` to compute every room.
+    NODISCARD static SharedRoomGraph derive(const SharedRoomGraph &previous,
+                                            const RoomIndex &rooms,
+                                            const std::vector<RoomId> &changed);
+
+public:
+    // Empty for rooms that don't exist.
+    NODISCARD const Edges &getEdges(RoomId id) const;
+    // Every room id with edges is below this.
+    NODISCARD size_t getIdLimit() const { return m_chunks.size() * CHUNK_SIZE; }
+};
@@ -0,0 +1,131 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "RoomRenderSignatures.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "../expandoracommon/exit.h"
+#include "../global/parallel.h"
+
+NODISCARD static constexpr size_t chunkOf(const RoomId id)
+{
+    return id.asUint32() >> RoomRenderSignatures::CHUNK_BITS;
+}
+
+NODISCARD static constexpr size_t slotOf(const RoomId id)
+{
+    return id.asUint32() & (RoomRenderSignatures::CHUNK_SIZE - 1u);
+}
+
+NODISCARD static bool hasInFlow(const RoomIndex &rooms, const Room &room, const Exit &exit)
+{
+    for (const RoomId fromId : exit.inRange()) {
+        if (fromId.asUint32() >= rooms.size())
+            continue;
+        const Room *const from = rooms[fromId].get();
+        if (from == nullptr)
+            continue;
+        for (const ExitDirEnum fromDir : ALL_EXITS_NESWUD) {
+            const Exit &fromExit = from->exit(fromDir);
+            if (fromExit.getExitFlags().isFlow() && fromExit.containsOut(room.getId()))
+                return true;
+        }
+    }
+    return false;
+}
+
+NODISCARD static RoomRenderSignature computeSignature(const RoomIndex &rooms, const Room &room)
+{
+    RoomRenderSignature result;
+    result.mobFlags = room.getMobFlags();
+    result.loadFlags = room.getLoadFlags();
+    result.terrain = room.getTerrainType();
+    result.isDark = room.getLightType() == RoomLightEnum::DARK;
+    result.hasNoSundeath = room.getSundeathType() == RoomSundeathEnum::NO_SUNDEATH;
+    result.isNotRidable = room.getRidableType() == RoomRidableEnum::NOT_RIDABLE;
+    result.isUpToDate = room.isUpToDate();
+
+    for (const ExitDirEnum dir : ALL_EXITS_NESWUD) {
+        const Exit &exit = room.exit(dir);
+        RoomRenderSignature::ExitSignature &sig = result.exits[static_cast<size_t>(dir)];
+        sig.flags = exit.getExitFlags();
+        sig.outIsEmpty = exit.outIsEmpty();
+        sig.hasInFlow = !exit.inIsEmpty() && hasInFlow(rooms, room, exit);
+        if (isNESW(dir) && exit.exitIsRoad()) {
+            result.roadMask = static_cast<uint8_t>(result.roadMask | (1u << static_cast<int>(dir)));
+        }
+    }
+    return result;
+}
+
+RoomRenderSignatures::RoomRenderSignatures(this_is_private) {}
+
+RoomRenderSignatures::~RoomRenderSignatures() = default;
+
+SharedRoomRenderSignatures RoomRenderSignatures::derive(const SharedRoomRenderSignatures &previous,
+                                                        const RoomIndex &rooms,
+                                                        const std::vector<RoomId> &changed)
+{
+    auto result = std::make_shared<RoomRenderSignatures>(this_is_private{0});
+    const uint32_t numIds = static_cast<uint32_t>(rooms.size());
+    const size_t numChunks = (static_cast<size_t>(numIds) + CHUNK_SIZE - 1u) >> CHUNK_BITS;
+
+    auto &chunks = result->m_chunks;
+    if (previous == nullptr) {
+        // Every chunk only reads the rooms, so a freshly loaded map is done on every core.
+        chunks.resize(numChunks);
+        parallelFor(
+            numChunks,
+            [&chunks, &rooms, numIds](const size_t chunkIndex) {
+                auto chunk = std::make_shared<Chunk>();
+                bool empty = true;
+                for (uint32_t slot = 0; slot < CHUNK_SIZE; ++slot) {
+                    const uint32_t id = static_cast<uint32_t>(chunkIndex << CHUNK_BITS) + slot;
+                    if (id < numIds && rooms[RoomId{id}] != nullptr) {
+                        (*chunk)[slot] = computeSignature(rooms, *rooms[RoomId{id}]);
+                        empty = false;
+                    }
+                }
+                if (!empty)
+                    chunks[chunkIndex] = std::move(chunk);
+            },
+            4);
+        return result;
+    }
+
+    chunks = previous->m_chunks;
+    if (chunks.size() < numChunks)
+        chunks.resize(numChunks);
+
+    assert(std::is_sorted(changed.begin(), changed.end()));
+    for (auto it = changed.begin(); it != changed.end();) {
+        const size_t chunkIndex = chunkOf(*it);
+        if (chunkIndex >= chunks.size()) {
+            ++it;
+            continue;
+        }
+
+        SharedChunk &slot = chunks[chunkIndex];
+        auto chunk = (slot != nullptr) ? std::make_shared<Chunk>(*slot) : std::make_shared<Chunk>();
+        for (; it != changed.end() && chunkOf(*it) == chunkIndex; ++it) {
+            const RoomId id = *it;
+            const SharedRoom &room = (id.asUint32() < numIds) ? rooms[id] : nullptr;
+            (*chunk)[slotOf(id)] = (room != nullptr) ? computeSignature(rooms, *room)
+                                                     : RoomRenderSignature{};
+        }
+        slot = std::move(chunk);
+    }
+    return result;
+}
+
+const RoomRenderSignature &RoomRenderSignatures::getSignature(const RoomId id) const
+{
+    static const RoomRenderSignature noSignature;
+    const size_t chunkIndex = chunkOf(id);
+    if (id == INVALID_ROOMID || chunkIndex >= m_chunks.size())
+        return noSignature;
+    const SharedChunk &chunk = m_chunks[chunkIndex];
+    return (chunk != nullptr) ? (*chunk)[slotOf(id)] : noSignature;
+}
@@ -0,0 +1,93 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "../expandoracommon/room.h"
+#include "../global/RuleOf5.h"
+#include "../global/macros.h"
+#include "../global/roomid.h"
+#include "ExitDirection.h"
+#include "ExitFlags.h"
+#include "mmapper2room.h"
+
+/**
+ * Everything the map canvas needs to know to draw a room's tile and walls,
+ * so that building a mesh doesn't walk the room's exits or its neighbours.
+ * Anything that depends on the config (colors, textures, drawNotMappedExits)
+ * is still decided when the mesh is built.
+ */
+struct NODISCARD RoomRenderSignature final
+{
+    struct NODISCARD ExitSignature final
+    {
+        ExitFlags flags;
+        bool outIsEmpty = true;
+        // Some room flows into this one through this exit.
+        bool hasInFlow = false;
+    };
+
+    RoomMobFlags mobFlags;
+    RoomLoadFlags loadFlags;
+    std::array<ExitSignature, NUM_EXITS_NESWUD> exits{};
+    RoomTerrainEnum terrain = RoomTerrainEnum::UNDEFINED;
+    // Bit (1 << dir) is set for each NESW exit flagged as a road.
+    uint8_t roadMask = 0;
+    bool isDark = false;
+    bool hasNoSundeath = false;
+    bool isNotRidable = false;
+    bool isUpToDate = true;
+
+    NODISCARD const ExitSignature &getExit(const ExitDirEnum dir) const
+    {
+        return exits.at(static_cast<size_t>(dir));
+    }
+};
+
+class RoomRenderSignatures;
+using SharedRoomRenderSignatures = std::shared_ptr<const RoomRenderSignatures>;
+
+/**
+ * A RoomRenderSignature for every room, immutable and stored in chunks that
+ * are shared with the signatures they were derived from, like RoomGraph.
+ */
+class NODISCARD RoomRenderSignatures final
+{
+public:
+    static constexpr const uint32_t CHUNK_BITS = 8;
+    static constexpr const uint32_t CHUNK_SIZE = 1u << CHUNK_BITS;
+    using Chunk = std::array<RoomRenderSignature, CHUNK_SIZE>;
+    using SharedChunk = std::shared_ptr<const Chunk>;
+
+private:
+    struct NODISCARD this_is_private final
+    {
+        explicit this_is_private(int) {}
+    };
+
+private:
+    std::vector<SharedChunk> m_chunks;
+
+public:
+    explicit RoomRenderSignatures(this_is_private);
+    ~RoomRenderSignatures();
+    DELETE_CTORS_AND_ASSIGN_OPS(RoomRenderSignatures);
+
+public:
+    // Recomputes the signatures of the sorted `changed` rooms, sharing the
+    // rest with `previous`. A room's in-flows depend on its neighbours, so
+    // that includes the rooms that any changed room has exits to. Pass a
+    // null `previous` to compute every room.
+    NODISCARD static SharedRoomRenderSignatures derive(const SharedRoomRenderSignatures &previous,
+                                                       const RoomIndex &rooms,
+                                                       const std::vector<RoomId> &changed);
+
+public:
+    // Default-constructed for rooms that don't exist.
+    NODISCARD const RoomRenderSignature &getSignature(RoomId id) const;
+};
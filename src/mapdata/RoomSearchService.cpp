@@ -0,0 +1,134 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "RoomSearchService.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "../expandoracommon/room.h"
+#include "../global/parallel.h"
+#include "../global/utils.h"
+
+// Rooms checked between pages; small enough that the first page shows up
+// right away, large enough to keep every core busy.
+static constexpr const size_t PAGE_ROOMS = 4096;
+// Rooms per parallelFor() task; matching one room is cheap.
+static constexpr const size_t SEARCH_BATCH = 256;
+
+RoomSearchService::RoomSearchService(QObject *const parent)
+    : QObject(parent)
+{
+    m_thread = std::thread([this]() { run(); });
+}
+
+RoomSearchService::~RoomSearchService()
+{
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_stopping.store(true, std::memory_order_relaxed);
+    }
+    m_wakeUp.notify_one();
+    m_thread.join();
+}
+
+RoomSearchService::RequestId RoomSearchService::search(
+    SharedMapSnapshot snapshot,
+    const RoomFilter &filter,
+    std::optional<std::vector<RoomId>> candidates)
+{
+    RequestId id = 0;
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        id = m_latest.fetch_add(1, std::memory_order_relaxed) + 1;
+        // RoomFilter can't be assigned, only constructed.
+        m_pending.reset();
+        m_pending.emplace();
+        Request &request = m_pending.value();
+        request.id = id;
+        request.snapshot = std::move(snapshot);
+        request.filter.emplace(filter);
+        request.candidates = std::move(candidates);
+    }
+    m_wakeUp.notify_one();
+    return id;
+}
+
+void RoomSearchService::cancel()
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_pending.reset();
+    m_latest.fetch_add(1, std::memory_order_relaxed);
+}
+
+void RoomSearchService::run()
+{
+    while (true) {
+        std::optional<Request> request;
+        {
+            std::unique_lock<std::mutex> lock{m_mutex};
+            m_wakeUp.wait(lock, [this]() {
+                return m_stopping.load(std::memory_order_relaxed) || m_pending.has_value();
+            });
+            if (m_stopping.load(std::memory_order_relaxed)) {
+                return;
+            }
+            request = std::exchange(m_pending, std::nullopt);
+        }
+        process(request.value());
+    }
+}
+
+void RoomSearchService::process(const Request &request)
+{
+    const RequestId id = request.id;
+    const auto isCancelled = [this, id]() {
+        return m_stopping.load(std::memory_order_relaxed)
+               || m_latest.load(std::memory_order_relaxed) != id;
+    };
+
+    const MapSnapshot &snapshot = deref(request.snapshot);
+    const RoomFilter &filter = request.filter.value();
+    const std::vector<RoomId> *const candidates = request.candidates.has_value()
+                                                      ? &request.candidates.value()
+                                                      : nullptr;
+    const size_t numIds = (candidates != nullptr) ? candidates->size() : snapshot.getIdLimit();
+    const auto getId = [candidates](const size_t i) {
+        return (candidates != nullptr) ? (*candidates)[i] : RoomId{static_cast<uint32_t>(i)};
+    };
+
+    int numFound = 0;
+    std::vector<uint8_t> matched;
+    for (size_t begin = 0; begin < numIds; begin += PAGE_ROOMS) {
+        if (isCancelled()) {
+            return;
+        }
+
+        const size_t end = std::min(numIds, begin + PAGE_ROOMS);
+        matched.assign(end - begin, 0);
+        parallelFor(
+            end - begin,
+            [begin, &getId, &snapshot, &filter, &matched](const size_t i) {
+                const Room *const r = snapshot.getRoom(getId(begin + i));
+                matched[i] = (r != nullptr && filter.filter(r)) ? 1 : 0;
+            },
+            SEARCH_BATCH);
+
+        RoomSearchPage page;
+        for (size_t i = begin; i < end; ++i) {
+            if (matched[i - begin] != 0)
+                page.emplace_back(getId(i));
+        }
+        if (!page.empty()) {
+            numFound += static_cast<int>(page.size());
+            emit sig_roomsFound(id, page);
+        }
+    }
+
+    if (isCancelled()) {
+        return;
+    }
+    emit sig_searchFinished(id, numFound);
+}
@@ -0,0 +1,81 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+#include <QObject>
+#include <QtCore>
+#include <QtGlobal>
+
+#include "../global/RuleOf5.h"
+#include "../global/macros.h"
+#include "../global/roomid.h"
+#include "MapSnapshot.h"
+#include "roomfilter.h"
+
+// Matching room ids, in increasing order.
+using RoomSearchPage = std::vector<RoomId>;
+Q_DECLARE_METATYPE(RoomSearchPage)
+
+/**
+ * Filters the rooms of a snapshot on a worker thread, and hands out the
+ * matches a page at a time while the search is still running, so that views
+ * can show the first results long before the last room has been checked.
+ *
+ * Like ShortestPathService, only the most recent request matters: posting a
+ * new one cancels the one that is waiting or running. Signals are emitted
+ * from the worker thread and carry the id returned by the request.
+ */
+class RoomSearchService final : public QObject
+{
+    Q_OBJECT
+
+public:
+    using RequestId = quint64;
+
+private:
+    struct NODISCARD Request final
+    {
+        RequestId id = 0;
+        SharedMapSnapshot snapshot;
+        std::optional<RoomFilter> filter;
+        // Sorted; if set, only these rooms are checked.
+        std::optional<std::vector<RoomId>> candidates;
+    };
+
+    std::mutex m_mutex;
+    std::condition_variable m_wakeUp;
+    std::optional<Request> m_pending;
+    // The id of the newest request; anything older is cancelled.
+    std::atomic<RequestId> m_latest{0};
+    std::atomic_bool m_stopping{false};
+    std::thread m_thread;
+
+public:
+    explicit RoomSearchService(QObject *parent = nullptr);
+    ~RoomSearchService() final;
+    DELETE_CTORS_AND_ASSIGN_OPS(RoomSearchService);
+
+public:
+    // Finds the rooms of the snapshot accepted by the filter, in id order.
+    // The candidates must be sorted and must include every room that could
+    // match; pass nullopt to check every room.
+    NODISCARD RequestId search(SharedMapSnapshot snapshot,
+                               const RoomFilter &filter,
+                               std::optional<std::vector<RoomId>> candidates);
+    void cancel();
+
+signals:
+    void sig_roomsFound(quint64 request, const RoomSearchPage &page);
+    // Not emitted for requests that were cancelled.
+    void sig_searchFinished(quint64 request, int numFound);
+
+private:
+    void run();
+    void process(const Request &request);
+};
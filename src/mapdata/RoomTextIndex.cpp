@@ -0,0 +1,191 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "RoomTextIndex.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <numeric>
+#include <utility>
+
+NODISCARD static std::optional<size_t> getField(const PatternKindsEnum kind)
+{
+    switch (kind) {
+    case PatternKindsEnum::NAME:
+        return 0;
+    case PatternKindsEnum::DESC:
+        return 1;
+    case PatternKindsEnum::CONTENTS:
+        return 2;
+    case PatternKindsEnum::NOTE:
+        return 3;
+    case PatternKindsEnum::NONE:
+    case PatternKindsEnum::EXITS:
+    case PatternKindsEnum::FLAGS:
+    case PatternKindsEnum::ALL:
+        break;
+    }
+    return std::nullopt;
+}
+
+NODISCARD static std::string getFieldText(const Room &room, const size_t field)
+{
+    switch (field) {
+    case 0:
+        return room.getName().getStdString();
+    case 1:
+        return room.readDescription().getStdString();
+    case 2:
+        return room.readContents().getStdString();
+    case 3:
+        return room.getNote().getStdString();
+    default:
+        break;
+    }
+    assert(false);
+    return std::string{};
+}
+
+NODISCARD static bool isWordChar(const char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+}
+
+// Distinct runs of ASCII letters and digits, in lowercase.
+NODISCARD static std::vector<std::string> getWords(const std::string_view text)
+{
+    std::vector<std::string> words;
+    std::string word;
+    for (size_t i = 0; i <= text.size(); ++i) {
+        if (i < text.size() && isWordChar(text[i])) {
+            word += static_cast<char>(std::tolower(static_cast<unsigned char>(text[i])));
+        } else if (!word.empty()) {
+            words.emplace_back(std::exchange(word, {}));
+        }
+    }
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+    return words;
+}
+
+void RoomTextIndex::markChanged(const RoomId id)
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    if (!m_built)
+        return;
+
+    m_changed.emplace_back(id);
+    if (m_changed.size() > std::max<size_t>(m_wordCounts.size(), 256)) {
+        // Cheaper to start over than to keep track of every change.
+        m_built = false;
+        m_changed.clear();
+    }
+}
+
+void RoomTextIndex::clear()
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    for (Field &field : m_fields) {
+        field.postings.clear();
+    }
+    m_wordCounts.clear();
+    m_changed.clear();
+    m_numPostings = 0;
+    m_numWords = 0;
+    m_built = false;
+}
+
+std::optional<std::vector<RoomId>> RoomTextIndex::getCandidates(const RoomIndex &rooms,
+                                                                const RoomFilter &filter)
+{
+    const std::optional<size_t> field = getField(filter.patternKind());
+    const std::optional<std::string> &literal = filter.getLiteral();
+    if (!field.has_value() || !literal.has_value())
+        return std::nullopt;
+
+    // Every word of the literal is part of a word in any room that has it;
+    // the longest one narrows it down the most.
+    std::string longest;
+    for (std::string &word : getWords(literal.value())) {
+        if (word.size() > longest.size())
+            longest = std::move(word);
+    }
+    if (longest.empty())
+        return std::nullopt;
+
+    std::lock_guard<std::mutex> lock{m_mutex};
+    update(rooms);
+
+    std::vector<RoomId> result;
+    for (const auto &[word, ids] : m_fields[field.value()].postings) {
+        if (word.find(longest) != std::string::npos)
+            result.insert(result.end(), ids.begin(), ids.end());
+    }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+void RoomTextIndex::update(const RoomIndex &rooms)
+{
+    if (!m_built) {
+        rebuild(rooms);
+        return;
+    }
+
+    std::sort(m_changed.begin(), m_changed.end());
+    m_changed.erase(std::unique(m_changed.begin(), m_changed.end()), m_changed.end());
+    for (const RoomId id : m_changed) {
+        index(id, (id.asUint32() < rooms.size()) ? rooms[id].get() : nullptr);
+    }
+    m_changed.clear();
+
+    if (m_numPostings > 2 * m_numWords + 1024) {
+        // Mostly stale entries by now.
+        rebuild(rooms);
+    }
+}
+
+void RoomTextIndex::rebuild(const RoomIndex &rooms)
+{
+    for (Field &field : m_fields) {
+        field.postings.clear();
+    }
+    m_wordCounts.assign(rooms.size(), Counts{});
+    m_changed.clear();
+    m_numPostings = 0;
+    m_numWords = 0;
+    for (const SharedRoom &room : rooms) {
+        if (room != nullptr)
+            index(room->getId(), room.get());
+    }
+    m_built = true;
+}
+
+void RoomTextIndex::index(const RoomId id, const Room *const room)
+{
+    const size_t n = id.asUint32();
+    if (m_wordCounts.size() <= n)
+        m_wordCounts.resize(n + 1);
+
+    Counts &counts = m_wordCounts[n];
+    m_numWords -= std::accumulate(counts.begin(), counts.end(), size_t{0});
+    counts = Counts{};
+    if (room == nullptr)
+        return;
+
+    for (size_t i = 0; i < NUM_FIELDS; ++i) {
+        const std::vector<std::string> words = getWords(getFieldText(*room, i));
+        auto &postings = m_fields[i].postings;
+        for (const std::string &word : words) {
+            std::vector<RoomId> &ids = postings[word];
+            // A room that is reindexed may already be on the list.
+            if (ids.empty() || ids.back() != id)
+                ids.emplace_back(id);
+        }
+        counts[i] = static_cast<uint32_t>(words.size());
+        m_numPostings += words.size();
+        m_numWords += words.size();
+    }
+}
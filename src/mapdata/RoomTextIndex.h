@@ -0,0 +1,74 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../expandoracommon/room.h"
+#include "../global/RuleOf5.h"
+#include "../global/macros.h"
+#include "../global/roomid.h"
+#include "roomfilter.h"
+
+/**
+ * Word index over the room names, descriptions, contents and notes, so that
+ * searching for literal text only has to check the rooms that contain a
+ * word with that text in it.
+ *
+ * Rooms are reported with markChanged() and reindexed lazily by the next
+ * search. Posting lists are only ever appended to; a room that loses a word
+ * stays on that word's list until the next full rebuild, so candidates may
+ * include rooms that no longer match, but never miss one that does.
+ */
+class NODISCARD RoomTextIndex final
+{
+private:
+    static constexpr const size_t NUM_FIELDS = 4;
+    using Counts = std::array<uint32_t, NUM_FIELDS>;
+
+    struct NODISCARD Field final
+    {
+        // Lowercase ASCII words.
+        std::map<std::string, std::vector<RoomId>, std::less<>> postings;
+    };
+
+    mutable std::mutex m_mutex;
+    std::array<Field, NUM_FIELDS> m_fields;
+    // Distinct words per room and field, as of the last time it was indexed.
+    std::vector<Counts> m_wordCounts;
+    std::vector<RoomId> m_changed;
+    size_t m_numPostings = 0;
+    size_t m_numWords = 0;
+    // If false, the next search rebuilds everything.
+    bool m_built = false;
+
+public:
+    RoomTextIndex() = default;
+    ~RoomTextIndex() = default;
+    DELETE_CTORS_AND_ASSIGN_OPS(RoomTextIndex);
+
+public:
+    // The room's name, description, contents or note changed, or the room
+    // was added or removed.
+    void markChanged(RoomId id);
+    void clear();
+
+    // Sorted ids of the rooms that might be accepted by the filter, or
+    // nullopt if the index can't tell and every room has to be checked.
+    NODISCARD std::optional<std::vector<RoomId>> getCandidates(const RoomIndex &rooms,
+                                                               const RoomFilter &filter);
+
+private:
+    void update(const RoomIndex &rooms);
+    void rebuild(const RoomIndex &rooms);
+    void index(RoomId id, const Room *room);
+};
@@ -0,0 +1,93 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "ShortestPathCache.h"
+
+#include <algorithm>
+#include <utility>
+
+ShortestPathCache::ShortestPathCache()
+    : m_registration{"shortest paths",
+                     cache_registry::CacheCostEnum::HIGH,
+                     [this]() { return getApproxBytes(); },
+                     [this](size_t) { clear(); }}
+{}
+
+ShortestPathCache::~ShortestPathCache() = default;
+
+std::optional<ShortestPathCache::Results> ShortestPathCache::lookup(const Key &key)
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    const auto it = m_entries.find(key);
+    if (it == m_entries.end())
+        return std::nullopt;
+    it->second.lastUsed = ++m_clock;
+    return it->second.results;
+}
+
+uint64_t ShortestPathCache::getEpoch() const
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    return m_epoch;
+}
+
+void ShortestPathCache::insert(const Key &key,
+                               const uint64_t epoch,
+                               Results results,
+                               std::vector<bool> reached)
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    if (epoch != m_epoch)
+        return;
+
+    if (m_entries.size() >= MAX_ENTRIES && m_entries.find(key) == m_entries.end()) {
+        const auto oldest = std::min_element(m_entries.begin(),
+                                             m_entries.end(),
+                                             [](const auto &a, const auto &b) {
+                                                 return a.second.lastUsed < b.second.lastUsed;
+                                             });
+        m_entries.erase(oldest);
+    }
+
+    Entry &entry = m_entries[key];
+    entry.results = std::move(results);
+    entry.reached = std::move(reached);
+    entry.lastUsed = ++m_clock;
+}
+
+void ShortestPathCache::invalidate(const RoomId room)
+{
+    const size_t index = room.asUint32();
+    std::lock_guard<std::mutex> lock{m_mutex};
+    ++m_epoch;
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        const std::vector<bool> &reached = it->second.reached;
+        if (index < reached.size() && reached[index]) {
+            it = m_entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void ShortestPathCache::clear()
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    ++m_epoch;
+    m_entries.clear();
+}
+
+size_t ShortestPathCache::getApproxBytes() const
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    size_t bytes = 0;
+    for (const auto &kv : m_entries) {
+        const Entry &entry = kv.second;
+        bytes += sizeof(kv) + kv.first.filter.capacity() + entry.reached.capacity() / 8;
+        for (const ShortestPathResult &result : entry.results) {
+            const auto chars = static_cast<size_t>(result.name.capacity() + result.dirs.capacity());
+            bytes += sizeof(result) + chars * sizeof(QChar);
+        }
+    }
+    return bytes;
+}
@@ -0,0 +1,104 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <QMetaType>
+#include <QString>
+
+#include "../expandoracommon/room.h"
+#include "../global/CacheRegistry.h"
+#include "../global/RuleOf5.h"
+#include "../global/macros.h"
+#include "../global/roomid.h"
+
+struct NODISCARD ShortestPathResult final
+{
+    RoomId room = INVALID_ROOMID;
+    QString name;
+    double dist = 0.0;
+    // One character per step, e.g. "nneu".
+    QString dirs;
+};
+Q_DECLARE_METATYPE(ShortestPathResult)
+
+/**
+ * Results of recent ShortestPathService searches, so that asking for
+ * directions from the same room again is just a lookup.
+ *
+ * Every entry remembers which rooms its search reached. The map reports each
+ * room change that a search or its filter could depend on, and only the
+ * entries that reached that room are dropped. The cache_registry may also
+ * clear it to keep the caches under budget.
+ */
+class NODISCARD ShortestPathCache final
+{
+public:
+    struct NODISCARD Key final
+    {
+        RoomId origin = INVALID_ROOMID;
+        // INVALID_ROOMID for filter searches.
+        RoomId target = INVALID_ROOMID;
+        // RoomFilter::getKey(), or empty for targeted searches.
+        std::string filter;
+        int maxHits = -1;
+
+        NODISCARD bool operator<(const Key &rhs) const
+        {
+            return std::tie(origin, target, filter, maxHits)
+                   < std::tie(rhs.origin, rhs.target, rhs.filter, rhs.maxHits);
+        }
+    };
+    using Results = std::vector<ShortestPathResult>;
+
+    static constexpr const size_t MAX_ENTRIES = 32;
+
+    // The room changes that can change a search's results.
+    NODISCARD static constexpr RoomUpdateFlags getRelevantUpdates()
+    {
+        return RoomUpdateFlags{RoomUpdateEnum::Mesh} | RoomUpdateEnum::ConnectionsIn
+               | RoomUpdateEnum::ConnectionsOut | RoomUpdateEnum::Terrain
+               | RoomUpdateEnum::ExitFlags | RoomUpdateEnum::DoorFlags
+               | RoomUpdateEnum::LoadFlags | RoomUpdateEnum::MobFlags | RoomUpdateEnum::Name
+               | RoomUpdateEnum::Desc | RoomUpdateEnum::Contents | RoomUpdateEnum::Note;
+    }
+
+private:
+    struct NODISCARD Entry final
+    {
+        Results results;
+        // Indexed by RoomId.
+        std::vector<bool> reached;
+        uint64_t lastUsed = 0;
+    };
+
+    mutable std::mutex m_mutex;
+    std::map<Key, Entry> m_entries;
+    // Bumped by every invalidation; see insert().
+    uint64_t m_epoch = 0;
+    uint64_t m_clock = 0;
+    // Last, so it's unregistered before anything it looks at goes away.
+    cache_registry::Registration m_registration;
+
+public:
+    ShortestPathCache();
+    ~ShortestPathCache();
+    DELETE_CTORS_AND_ASSIGN_OPS(ShortestPathCache);
+
+public:
+    NODISCARD std::optional<Results> lookup(const Key &key);
+    NODISCARD uint64_t getEpoch() const;
+    // Take the epoch before the snapshot the search runs on; the results are
+    // dropped if anything was invalidated since then.
+    void insert(const Key &key, uint64_t epoch, Results results, std::vector<bool> reached);
+    void invalidate(RoomId room);
+    void clear();
+    NODISCARD size_t getApproxBytes() const;
+};
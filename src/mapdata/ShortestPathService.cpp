@@ -0,0 +1,218 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "ShortestPathService.h"
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "../expandoracommon/room.h"
+#include "../global/utils.h"
+#include "Landmarks.h"
+#include "mmapper2exit.h"
+#include "shortestpath.h"
+
+namespace { // anonymous
+
+class NODISCARD ResultEmitter final : public ShortestPathRecipient
+{
+private:
+    std::function<void(const ShortestPathResult &)> m_emit;
+    ShortestPathCache::Results m_results;
+
+public:
+    explicit ResultEmitter(std::function<void(const ShortestPathResult &)> emit)
+        : m_emit{std::move(emit)}
+    {}
+    ~ResultEmitter() final;
+
+public:
+    NODISCARD const ShortestPathCache::Results &getResults() const { return m_results; }
+    NODISCARD ShortestPathCache::Results takeResults() { return std::exchange(m_results, {}); }
+
+private:
+    void virt_receiveShortestPath(RoomAdmin * /*admin*/,
+                                  const std::vector<SPNode> &spnodes,
+                                  const int endpoint) final
+    {
+        const SPNode *spnode = &spnodes[static_cast<size_t>(endpoint)];
+        ShortestPathResult result;
+        result.room = spnode->r->getId();
+        result.name = spnode->r->getName().toQString();
+        result.dist = spnode->dist;
+        while (spnode->parent >= 0) {
+            result.dirs.append(Mmapper2Exit::charForDir(spnode->lastdir));
+            spnode = &spnodes[static_cast<size_t>(spnode->parent)];
+        }
+        std::reverse(result.dirs.begin(), result.dirs.end());
+        m_emit(result);
+        m_results.emplace_back(std::move(result));
+    }
+};
+
+ResultEmitter::~ResultEmitter() = default;
+
+} // namespace
+
+ShortestPathService::ShortestPathService(ShortestPathCache &cache, QObject *const parent)
+    : QObject(parent)
+    , m_cache{cache}
+{
+    m_thread = std::thread([this]() { run(); });
+}
+
+ShortestPathService::~ShortestPathService()
+{
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_stopping.store(true, std::memory_order_relaxed);
+    }
+    m_wakeUp.notify_one();
+    m_thread.join();
+}
+
+ShortestPathService::RequestId ShortestPathService::findPaths(SharedMapSnapshot snapshot,
+                                                              const uint64_t cacheEpoch,
+                                                              const RoomId origin,
+                                                              const RoomFilter &filter,
+                                                              const int maxHits)
+{
+    Request request;
+    request.snapshot = std::move(snapshot);
+    request.cacheEpoch = cacheEpoch;
+    request.origin = origin;
+    request.filter.emplace(filter);
+    request.maxHits = maxHits;
+    return post(std::move(request));
+}
+
+ShortestPathService::RequestId ShortestPathService::findPathTo(
+    SharedMapSnapshot snapshot,
+    const uint64_t cacheEpoch,
+    const RoomId origin,
+    const RoomId target,
+    std::shared_ptr<const Landmarks> landmarks)
+{
+    Request request;
+    request.snapshot = std::move(snapshot);
+    request.cacheEpoch = cacheEpoch;
+    request.origin = origin;
+    request.target = target;
+    request.landmarks = std::move(landmarks);
+    return post(std::move(request));
+}
+
+void ShortestPathService::cancel()
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_pending.reset();
+    m_latest.fetch_add(1, std::memory_order_relaxed);
+}
+
+ShortestPathService::RequestId ShortestPathService::post(Request &&request)
+{
+    RequestId id = 0;
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        id = m_latest.fetch_add(1, std::memory_order_relaxed) + 1;
+        request.id = id;
+        // RoomFilter can't be assigned, only constructed.
+        m_pending.reset();
+        m_pending.emplace(std::move(request));
+    }
+    m_wakeUp.notify_one();
+    return id;
+}
+
+void ShortestPathService::run()
+{
+    while (true) {
+        std::optional<Request> request;
+        {
+            std::unique_lock<std::mutex> lock{m_mutex};
+            m_wakeUp.wait(lock, [this]() {
+                return m_stopping.load(std::memory_order_relaxed) || m_pending.has_value();
+            });
+            if (m_stopping.load(std::memory_order_relaxed)) {
+                return;
+            }
+            request = std::exchange(m_pending, std::nullopt);
+        }
+        process(request.value());
+    }
+}
+
+ShortestPathCache::Key ShortestPathService::getCacheKey(const Request &request)
+{
+    ShortestPathCache::Key key;
+    key.origin = request.origin;
+    key.maxHits = request.maxHits;
+    if (request.filter.has_value()) {
+        key.filter = request.filter->getKey();
+    } else {
+        key.target = request.target;
+    }
+    return key;
+}
+
+void ShortestPathService::process(const Request &request)
+{
+    const RequestId id = request.id;
+    const ShortestPathCache::Key key = getCacheKey(request);
+    if (std::optional<ShortestPathCache::Results> cached = m_cache.lookup(key)) {
+        for (const ShortestPathResult &result : cached.value()) {
+            emit sig_pathFound(id, result);
+        }
+        emit sig_searchFinished(id, static_cast<int>(cached->size()));
+        return;
+    }
+
+    const auto isCancelled = [this, id]() {
+        return m_stopping.load(std::memory_order_relaxed)
+               || m_latest.load(std::memory_order_relaxed) != id;
+    };
+
+    ResultEmitter emitter{
+        [this, id](const ShortestPathResult &result) { emit sig_pathFound(id, result); }};
+    const MapSnapshot &snapshot = deref(request.snapshot);
+    const Room *const origin = snapshot.getRoom(request.origin);
+    if (origin == nullptr) {
+        emit sig_searchFinished(id, 0);
+        return;
+    }
+    if (request.filter.has_value()) {
+        shortestPathSearch(snapshot,
+                           m_workspace,
+                           origin,
+                           emitter,
+                           request.filter.value(),
+                           request.maxHits,
+                           isCancelled);
+    } else if (const Room *const target = snapshot.getRoom(request.target)) {
+        shortestPathSearch(snapshot,
+                           m_workspace,
+                           origin,
+                           target,
+                           request.landmarks.get(),
+                           emitter,
+                           isCancelled);
+    } else {
+        emit sig_searchFinished(id, 0);
+        return;
+    }
+
+    if (isCancelled()) {
+        return;
+    }
+    const int numFound = static_cast<int>(emitter.getResults().size());
+    // Changing any room the search reached could change its results.
+    const size_t idLimit = snapshot.getIdLimit();
+    std::vector<bool> reached(idLimit, false);
+    for (size_t i = 0; i < idLimit; ++i) {
+        reached[i] = m_workspace.isReached(RoomId{static_cast<uint32_t>(i)});
+    }
+    m_cache.insert(key, request.cacheEpoch, emitter.takeResults(), std::move(reached));
+    emit sig_searchFinished(id, numFound);
+}
@@ -0,0 +1,102 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <QObject>
+#include <QtGlobal>
+
+#include "../global/RuleOf5.h"
+#include "../global/macros.h"
+#include "../global/roomid.h"
+#include "MapSnapshot.h"
+#include "ShortestPathCache.h"
+#include "ShortestPathWorkspace.h"
+#include "roomfilter.h"
+
+class Landmarks;
+
+/**
+ * Runs shortest path searches on a worker thread, over a snapshot of the map,
+ * so that long searches never hold mapLock or stall the GUI thread.
+ *
+ * Only the most recent request matters: posting a new one cancels the one
+ * that is waiting or running. Results are emitted from the worker thread, so
+ * receivers in other threads get them through queued connections; each
+ * signal carries the id returned by the request, and anything from older
+ * requests should be ignored.
+ *
+ * Finished searches are remembered in the map's ShortestPathCache, and
+ * repeated requests are answered from it.
+ */
+class ShortestPathService final : public QObject
+{
+    Q_OBJECT
+
+public:
+    using RequestId = quint64;
+
+private:
+    struct NODISCARD Request final
+    {
+        RequestId id = 0;
+        SharedMapSnapshot snapshot;
+        RoomId origin = INVALID_ROOMID;
+        // Either a filter or a target.
+        std::optional<RoomFilter> filter;
+        int maxHits = -1;
+        RoomId target = INVALID_ROOMID;
+        std::shared_ptr<const Landmarks> landmarks;
+        uint64_t cacheEpoch = 0;
+    };
+
+    ShortestPathCache &m_cache;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wakeUp;
+    std::optional<Request> m_pending;
+    // The id of the newest request; anything older is cancelled.
+    std::atomic<RequestId> m_latest{0};
+    std::atomic_bool m_stopping{false};
+    // Only used by the worker thread.
+    ShortestPathWorkspace m_workspace;
+    std::thread m_thread;
+
+public:
+    explicit ShortestPathService(ShortestPathCache &cache, QObject *parent = nullptr);
+    ~ShortestPathService() final;
+    DELETE_CTORS_AND_ASSIGN_OPS(ShortestPathService);
+
+public:
+    // Finds up to maxHits rooms accepted by the filter, nearest first.
+    // The cache epoch must be taken before the snapshot.
+    NODISCARD RequestId findPaths(SharedMapSnapshot snapshot,
+                                  uint64_t cacheEpoch,
+                                  RoomId origin,
+                                  const RoomFilter &filter,
+                                  int maxHits);
+    // The landmarks may be null, but must not be older than the snapshot.
+    NODISCARD RequestId findPathTo(SharedMapSnapshot snapshot,
+                                   uint64_t cacheEpoch,
+                                   RoomId origin,
+                                   RoomId target,
+                                   std::shared_ptr<const Landmarks> landmarks);
+    void cancel();
+
+signals:
+    void sig_pathFound(quint64 request, const ShortestPathResult &result);
+    // Not emitted for requests that were cancelled.
+    void sig_searchFinished(quint64 request, int numFound);
+
+private:
+    NODISCARD RequestId post(Request &&request);
+    void run();
+    void process(const Request &request);
+    NODISCARD static ShortestPathCache::Key getCacheKey(const Request &request);
+};
@@ -0,0 +1,100 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "ShortestPathWorkspace.h"
+
+#include <algorithm>
+
+void ShortestPathWorkspace::begin(const size_t numRooms)
+{
+    if (m_states.size() < numRooms) {
+        m_states.resize(numRooms);
+        m_nodes.resize(numRooms);
+    }
+    m_heap.clear();
+
+    if (++m_generation == 0) {
+        // Stamps from 4 billion searches ago would look current again.
+        for (State &state : m_states) {
+            state = State{};
+        }
+        m_generation = 1;
+    }
+}
+
+bool ShortestPathWorkspace::relax(const RoomId room, const SPNode &node, const double priority)
+{
+    const uint32_t index = room.asUint32();
+    State &state = m_states[index];
+    if (state.generation == m_generation) {
+        if (state.heapPos == NOT_IN_HEAP || m_nodes[index].dist <= node.dist) {
+            return false;
+        }
+        m_nodes[index] = node;
+        state.priority = priority;
+        siftUp(state.heapPos);
+        return true;
+    }
+
+    state.generation = m_generation;
+    state.priority = priority;
+    m_nodes[index] = node;
+    m_heap.emplace_back(index);
+    state.heapPos = static_cast<uint32_t>(m_heap.size() - 1);
+    siftUp(state.heapPos);
+    return true;
+}
+
+RoomId ShortestPathWorkspace::pop()
+{
+    assert(!m_heap.empty());
+    const uint32_t top = m_heap.front();
+    const uint32_t last = m_heap.back();
+    m_heap.pop_back();
+    if (!m_heap.empty()) {
+        place(0, last);
+        siftDown(0);
+    }
+    m_states[top].heapPos = NOT_IN_HEAP;
+    return RoomId{top};
+}
+
+void ShortestPathWorkspace::siftUp(size_t pos)
+{
+    const uint32_t room = m_heap[pos];
+    const double priority = m_states[room].priority;
+    while (pos > 0) {
+        const size_t parent = (pos - 1) / ARITY;
+        if (priorityAt(parent) <= priority) {
+            break;
+        }
+        place(pos, m_heap[parent]);
+        pos = parent;
+    }
+    place(pos, room);
+}
+
+void ShortestPathWorkspace::siftDown(size_t pos)
+{
+    const size_t size = m_heap.size();
+    const uint32_t room = m_heap[pos];
+    const double priority = m_states[room].priority;
+    while (true) {
+        const size_t first = pos * ARITY + 1;
+        if (first >= size) {
+            break;
+        }
+        size_t best = first;
+        for (size_t child = first + 1; child < std::min(first + ARITY, size); ++child) {
+            if (priorityAt(child) < priorityAt(best)) {
+                best = child;
+            }
+        }
+        if (priority <= priorityAt(best)) {
+            break;
+        }
+        place(pos, m_heap[best]);
+        pos = best;
+    }
+    place(pos, room);
+}
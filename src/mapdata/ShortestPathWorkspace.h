@@ -0,0 +1,85 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <cassert>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../global/RuleOf5.h"
+#include "../global/macros.h"
+#include "../global/roomid.h"
+#include "shortestpath.h"
+
+/**
+ * Scratch state for one shortest path search, kept between searches so that
+ * a search on a map it has seen before doesn't allocate.
+ *
+ * Nodes are indexed by RoomId, and SPNode::parent is the parent's RoomId (or
+ * -1 for the origin), so the recipient walks the tree in place. Rooms count
+ * as reached only if they were stamped with the current generation, which
+ * makes starting a search O(1). The open set is a 4-ary heap with
+ * decrease-key, so each room is in it at most once.
+ */
+class NODISCARD ShortestPathWorkspace final
+{
+private:
+    static constexpr const uint32_t NOT_IN_HEAP = UINT32_MAX;
+    static constexpr const size_t ARITY = 4;
+
+    struct NODISCARD State final
+    {
+        uint32_t generation = 0;
+        uint32_t heapPos = NOT_IN_HEAP;
+        double priority = 0.0;
+    };
+
+    std::vector<SPNode> m_nodes;
+    std::vector<State> m_states;
+    std::vector<uint32_t> m_heap;
+    uint32_t m_generation = 0;
+
+public:
+    ShortestPathWorkspace() = default;
+    ~ShortestPathWorkspace() = default;
+    DELETE_CTORS_AND_ASSIGN_OPS(ShortestPathWorkspace);
+
+public:
+    // Forgets the previous search; room ids must be below numRooms.
+    void begin(size_t numRooms);
+
+    NODISCARD bool isReached(const RoomId room) const
+    {
+        return m_states[room.asUint32()].generation == m_generation;
+    }
+    NODISCARD bool isSettled(const RoomId room) const
+    {
+        return isReached(room) && m_states[room.asUint32()].heapPos == NOT_IN_HEAP;
+    }
+    NODISCARD const std::vector<SPNode> &getNodes() const { return m_nodes; }
+    NODISCARD const SPNode &getNode(const RoomId room) const
+    {
+        assert(isReached(room));
+        return m_nodes[room.asUint32()];
+    }
+
+    // Records `node` as the way to reach `room` unless it is settled or
+    // already reached at no greater distance; returns true if it was recorded.
+    bool relax(RoomId room, const SPNode &node, double priority);
+
+    NODISCARD bool empty() const { return m_heap.empty(); }
+    // Settles and returns the open room with the lowest priority.
+    NODISCARD RoomId pop();
+
+private:
+    void siftUp(size_t pos);
+    void siftDown(size_t pos);
+    void place(size_t pos, uint32_t room)
+    {
+        m_heap[pos] = room;
+        m_states[room].heapPos = static_cast<uint32_t>(pos);
+    }
+    NODISCARD double priorityAt(const size_t pos) const { return m_states[m_heap[pos]].priority; }
+};
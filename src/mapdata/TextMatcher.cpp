@@ -0,0 +1,204 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "TextMatcher.h"
+
+#include <algorithm>
+#include <functional>
+#include <regex>
+#include <utility>
+
+NODISCARD static constexpr char foldCase(const char c)
+{
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+NODISCARD static bool equalsFolded(const std::string_view a, const std::string_view b)
+{
+    return a.size() == b.size()
+           && std::equal(a.begin(), a.end(), b.begin(), [](const char x, const char y) {
+                  return foldCase(x) == foldCase(y);
+              });
+}
+
+namespace { // anonymous
+
+struct NODISCARD FoldedHash final
+{
+    NODISCARD size_t operator()(const char c) const { return std::hash<char>{}(foldCase(c)); }
+};
+
+struct NODISCARD FoldedEqual final
+{
+    NODISCARD bool operator()(const char a, const char b) const
+    {
+        return foldCase(a) == foldCase(b);
+    }
+};
+
+class NODISCARD EmptyMatcher final : public TextMatcher
+{
+private:
+    NODISCARD bool virt_matches(const std::string_view text) const final { return text.empty(); }
+};
+
+// memchr/memcmp based, which the C library vectorizes.
+class NODISCARD SubstringMatcher final : public TextMatcher
+{
+private:
+    const std::string m_needle;
+
+public:
+    explicit SubstringMatcher(std::string needle)
+        : m_needle{std::move(needle)}
+    {}
+
+private:
+    NODISCARD bool virt_matches(const std::string_view text) const final
+    {
+        return text.find(m_needle) != std::string_view::npos;
+    }
+};
+
+class NODISCARD FoldedSubstringMatcher final : public TextMatcher
+{
+private:
+    const std::string m_needle;
+    const std::boyer_moore_horspool_searcher<std::string::const_iterator, FoldedHash, FoldedEqual>
+        m_searcher;
+
+public:
+    explicit FoldedSubstringMatcher(std::string needle)
+        : m_needle{std::move(needle)}
+        , m_searcher{m_needle.begin(), m_needle.end()}
+    {}
+
+private:
+    NODISCARD bool virt_matches(const std::string_view text) const final
+    {
+        return m_searcher(text.begin(), text.end()).first != text.end();
+    }
+};
+
+class NODISCARD EqualsMatcher final : public TextMatcher
+{
+private:
+    const std::string m_pattern;
+    const bool m_caseSensitive;
+
+public:
+    explicit EqualsMatcher(std::string pattern, const bool caseSensitive)
+        : m_pattern{std::move(pattern)}
+        , m_caseSensitive{caseSensitive}
+    {}
+
+private:
+    NODISCARD bool virt_matches(const std::string_view text) const final
+    {
+        return m_caseSensitive ? text == m_pattern : equalsFolded(text, m_pattern);
+    }
+};
+
+// `*` matches any run of characters and `?` any one character.
+class NODISCARD GlobMatcher final : public TextMatcher
+{
+private:
+    const std::string m_pattern;
+    const bool m_caseSensitive;
+
+public:
+    explicit GlobMatcher(std::string pattern, const bool caseSensitive)
+        : m_pattern{std::move(pattern)}
+        , m_caseSensitive{caseSensitive}
+    {}
+
+private:
+    NODISCARD bool virt_matches(const std::string_view text) const final
+    {
+        const std::string_view pattern = m_pattern;
+        const auto same = [this](const char a, const char b) {
+            return m_caseSensitive ? a == b : foldCase(a) == foldCase(b);
+        };
+
+        // Greedy, backing up to the last `*` on a mismatch.
+        size_t p = 0;
+        size_t t = 0;
+        size_t star = std::string_view::npos;
+        size_t resume = 0;
+        while (t < text.size()) {
+            if (p < pattern.size() && (pattern[p] == '?' || same(pattern[p], text[t]))) {
+                ++p;
+                ++t;
+            } else if (p < pattern.size() && pattern[p] == '*') {
+                star = p++;
+                resume = t;
+            } else if (star != std::string_view::npos) {
+                p = star + 1;
+                t = ++resume;
+            } else {
+                return false;
+            }
+        }
+        while (p < pattern.size() && pattern[p] == '*') {
+            ++p;
+        }
+        return p == pattern.size();
+    }
+};
+
+class NODISCARD RegexMatcher final : public TextMatcher
+{
+private:
+    const std::regex m_regex;
+
+public:
+    explicit RegexMatcher(const std::string &pattern, const Qt::CaseSensitivity cs)
+        : m_regex{pattern, getOptions(cs)}
+    {}
+
+private:
+    NODISCARD static std::regex::flag_type getOptions(const Qt::CaseSensitivity cs)
+    {
+        // TODO: Switch from std::regex::extended to std::regex::multiline once GCC supports it
+        auto options = std::regex::nosubs | std::regex::optimize | std::regex::extended;
+        if (cs == Qt::CaseInsensitive)
+            options |= std::regex_constants::icase;
+        return options;
+    }
+
+    NODISCARD bool virt_matches(const std::string_view text) const final
+    {
+        return std::regex_match(text.begin(), text.end(), m_regex);
+    }
+};
+
+} // namespace
+
+TextMatcher::~TextMatcher() = default;
+
+bool TextMatcher::isGlob(const std::string_view pattern)
+{
+    return pattern.find_first_of("*?") != std::string_view::npos;
+}
+
+std::shared_ptr<const TextMatcher> TextMatcher::create(std::string pattern,
+                                                       const Qt::CaseSensitivity cs,
+                                                       const bool regex)
+{
+    const bool caseSensitive = (cs == Qt::CaseSensitive);
+    if (pattern.empty())
+        return std::make_shared<EmptyMatcher>();
+
+    if (regex) {
+        // POSIX extended regex syntax; anything else stands for itself.
+        if (pattern.find_first_of(R"(.[]{}()*+?|^$\)") != std::string::npos)
+            return std::make_shared<RegexMatcher>(pattern, cs);
+        return std::make_shared<EqualsMatcher>(std::move(pattern), caseSensitive);
+    }
+
+    if (isGlob(pattern))
+        return std::make_shared<GlobMatcher>("*" + pattern + "*", caseSensitive);
+    if (caseSensitive)
+        return std::make_shared<SubstringMatcher>(std::move(pattern));
+    return std::make_shared<FoldedSubstringMatcher>(std::move(pattern));
+}
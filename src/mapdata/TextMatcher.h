@@ -0,0 +1,42 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <QtCore>
+
+#include "../global/RuleOf5.h"
+#include "../global/macros.h"
+
+/**
+ * Tests text against a search pattern.
+ *
+ * std::regex is slow, so create() only uses it for patterns that really are
+ * regular expressions. Plain text is a substring search, and text with * or ?
+ * wildcards is a glob; both contain-match like before, and only fold ASCII
+ * case, which is all the patterns (converted to ASCII) can contain anyway.
+ */
+class NODISCARD TextMatcher
+{
+public:
+    // An empty pattern only matches empty text. Otherwise a regex must match
+    // the whole text, while plain text and globs may match any part of it.
+    NODISCARD static std::shared_ptr<const TextMatcher> create(std::string pattern,
+                                                               Qt::CaseSensitivity cs,
+                                                               bool regex);
+    // True if create() treats this non-regex pattern as a glob.
+    NODISCARD static bool isGlob(std::string_view pattern);
+
+public:
+    TextMatcher() = default;
+    virtual ~TextMatcher();
+    DELETE_CTORS_AND_ASSIGN_OPS(TextMatcher);
+
+private:
+    NODISCARD virtual bool virt_matches(std::string_view text) const = 0;
+
+public:
+    NODISCARD bool matches(const std::string_view text) const { return virt_matches(text); }
+};
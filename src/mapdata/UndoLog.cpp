@@ -0,0 +1,182 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "UndoLog.h"
+
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+
+#include "MapSnapshot.h"
+
+template<typename T>
+static constexpr const bool isLazyText = std::is_same_v<T, RoomDesc>
+                                         || std::is_same_v<T, RoomContents>;
+
+// The ids in `a` that aren't in `b`.
+NODISCARD static TinyRoomIdSet getMissing(const TinyRoomIdSet &a, const TinyRoomIdSet &b)
+{
+    TinyRoomIdSet result;
+    for (const RoomId id : a) {
+        if (!b.contains(id))
+            result.insert(id);
+    }
+    return result;
+}
+
+NODISCARD static UndoStep::SavedExit saveExit(const ExitDirEnum dir,
+                                              const Exit &was,
+                                              const Exit &is)
+{
+    UndoStep::SavedExit saved;
+    saved.dir = dir;
+#define X_COPY(_Type, _Prop, _OptInit) saved.fields.set##_Type(was.get##_Type());
+    XFOREACH_EXIT_PROPERTY(X_COPY)
+#undef X_COPY
+    saved.addedIn = getMissing(is.getIncoming(), was.getIncoming());
+    saved.removedIn = getMissing(was.getIncoming(), is.getIncoming());
+    saved.addedOut = getMissing(is.getOutgoing(), was.getOutgoing());
+    saved.removedOut = getMissing(was.getOutgoing(), is.getOutgoing());
+    return saved;
+}
+
+void UndoStep::SavedExit::restore(Exit &exit) const
+{
+#define X_COPY(_Type, _Prop, _OptInit) exit.set##_Type(fields.get##_Type());
+    XFOREACH_EXIT_PROPERTY(X_COPY)
+#undef X_COPY
+    for (const RoomId id : addedIn)
+        exit.removeIn(id);
+    for (const RoomId id : removedIn)
+        exit.addIn(id);
+    for (const RoomId id : addedOut)
+        exit.removeOut(id);
+    for (const RoomId id : removedOut)
+        exit.addOut(id);
+}
+
+UndoStep UndoStep::capture(const MapSnapshot &before,
+                           const RoomIndex &now,
+                           std::vector<RoomId> touched)
+{
+    std::sort(touched.begin(), touched.end());
+    touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+
+    UndoStep step;
+    for (const RoomId id : touched) {
+        const SharedConstRoom was = before.getSharedRoom(id);
+        const Room *const is = (id.asUint32() < now.size()) ? now[id].get() : nullptr;
+        if (was == nullptr && is == nullptr)
+            continue;
+
+        RoomDelta delta;
+        delta.id = id;
+        if (was == nullptr) {
+            delta.kind = RoomDeltaKindEnum::CREATED;
+            step.m_rooms.emplace_back(delta);
+            continue;
+        }
+        if (is == nullptr) {
+            delta.kind = RoomDeltaKindEnum::REMOVED;
+            delta.firstField = static_cast<uint32_t>(step.m_removed.size());
+            step.m_removed.emplace_back(was);
+            step.m_rooms.emplace_back(delta);
+            continue;
+        }
+
+        if (was->getPosition() != is->getPosition()) {
+            delta.moved = true;
+            delta.position = was->getPosition();
+        }
+        if (was->isUpToDate() != is->isUpToDate())
+            delta.upToDate = was->isUpToDate();
+
+        delta.firstField = static_cast<uint32_t>(step.m_fields.size());
+        const bool sameText = was->sharesLazyText(*is);
+#define X_DIFF(_Type, _Prop, _OptInit) \
+    if (!(isLazyText<_Type> && sameText) && !(was->read##_Prop() == is->read##_Prop())) { \
+        step.m_fields.emplace_back(std::in_place_type<_Type>, was->read##_Prop()); \
+    }
+        XFOREACH_ROOM_PROPERTY(X_DIFF)
+#undef X_DIFF
+        delta.fieldCount = static_cast<uint8_t>(step.m_fields.size() - delta.firstField);
+
+        delta.firstExit = static_cast<uint32_t>(step.m_exits.size());
+        for (const ExitDirEnum dir : ALL_EXITS7) {
+            const Exit &e = was->exit(dir);
+            const Exit &now = is->exit(dir);
+            if (!(e == now))
+                step.m_exits.emplace_back(saveExit(dir, e, now));
+        }
+        delta.exitCount = static_cast<uint8_t>(step.m_exits.size() - delta.firstExit);
+
+        if (delta.moved || delta.upToDate.has_value() || delta.fieldCount != 0
+            || delta.exitCount != 0) {
+            step.m_rooms.emplace_back(delta);
+        }
+    }
+    return step;
+}
+
+size_t UndoStep::getApproxBytes() const
+{
+    // Strings and id sets may add a little to the fields and exits.
+    return sizeof(UndoStep) + m_rooms.capacity() * sizeof(RoomDelta)
+           + m_fields.capacity() * sizeof(FieldValue) + m_exits.capacity() * sizeof(SavedExit)
+           + m_removed.capacity() * sizeof(SharedConstRoom);
+}
+
+void UndoLog::push(UndoStep step)
+{
+    for (const UndoStep &redo : m_redo)
+        m_bytes -= redo.getApproxBytes();
+    m_redo.clear();
+    pushUndo(std::move(step));
+}
+
+void UndoLog::pushUndo(UndoStep step)
+{
+    m_bytes += step.getApproxBytes();
+    m_undo.emplace_back(std::move(step));
+    trim();
+}
+
+void UndoLog::pushRedo(UndoStep step)
+{
+    m_bytes += step.getApproxBytes();
+    m_redo.emplace_back(std::move(step));
+    trim();
+}
+
+std::optional<UndoStep> UndoLog::take(std::deque<UndoStep> &steps)
+{
+    if (steps.empty())
+        return std::nullopt;
+    UndoStep step = std::move(steps.back());
+    steps.pop_back();
+    m_bytes -= step.getApproxBytes();
+    return step;
+}
+
+void UndoLog::clear()
+{
+    m_undo.clear();
+    m_redo.clear();
+    m_bytes = 0;
+}
+
+void UndoLog::setMaxBytes(const size_t bytes)
+{
+    m_maxBytes = bytes;
+    trim();
+}
+
+void UndoLog::trim()
+{
+    // The newest step is always kept, however big it is.
+    while (m_bytes > m_maxBytes && m_undo.size() + m_redo.size() > 1) {
+        std::deque<UndoStep> &steps = (m_undo.size() > 1 || m_redo.empty()) ? m_undo : m_redo;
+        m_bytes -= steps.front().getApproxBytes();
+        steps.pop_front();
+    }
+}
@@ -0,0 +1,153 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <variant>
+#include <vector>
+
+#include "../expandoracommon/coordinate.h"
+#include "../expandoracommon/exit.h"
+#include "../expandoracommon/room.h"
+#include "../global/TinyRoomIdSet.h"
+#include "../global/macros.h"
+#include "../global/roomid.h"
+#include "ExitDirection.h"
+
+class MapSnapshot;
+
+/**
+ * The inverse of one map edit: for each room the edit touched, just the
+ * fields, exit flags, connections and position that it changed.
+ *
+ * Applying a step (see MapData::undo()) puts those back; capturing what that
+ * changes gives the step that redoes the edit. Only a removed room is kept
+ * whole, and it's shared with the snapshot it was found in.
+ */
+class NODISCARD UndoStep final
+{
+public:
+#define X_DECL_TYPE(_Type, _Prop, _OptInit) , _Type
+    using FieldValue = std::variant<std::monostate XFOREACH_ROOM_PROPERTY(X_DECL_TYPE)>;
+#undef X_DECL_TYPE
+
+    enum class NODISCARD RoomDeltaKindEnum : uint8_t {
+        // The room exists before and after, but changed.
+        CHANGED,
+        // The edit created the room, so undoing it removes the room.
+        CREATED,
+        // The edit removed the room, so undoing it puts the room back.
+        REMOVED
+    };
+
+    struct NODISCARD SavedExit final
+    {
+        ExitDirEnum dir = ExitDirEnum::UNKNOWN;
+        // The old door name and flags; its connections are left empty.
+        Exit fields;
+        // Only the connections the edit made or broke are put back, so the ones
+        // made since then (e.g. by the path machine, which isn't recorded) stay.
+        TinyRoomIdSet addedIn;
+        TinyRoomIdSet removedIn;
+        TinyRoomIdSet addedOut;
+        TinyRoomIdSet removedOut;
+
+        // Undoes the edit on the exit as it is now.
+        void restore(Exit &exit) const;
+    };
+
+    struct NODISCARD RoomDelta final
+    {
+        RoomId id = INVALID_ROOMID;
+        // The old position, if `moved`.
+        Coordinate position;
+        // Where the room's old fields and exits start in the step's pools; a
+        // removed room's index in the removed rooms.
+        uint32_t firstField = 0;
+        uint32_t firstExit = 0;
+        uint8_t fieldCount = 0;
+        uint8_t exitCount = 0;
+        RoomDeltaKindEnum kind = RoomDeltaKindEnum::CHANGED;
+        bool moved = false;
+        std::optional<bool> upToDate;
+    };
+
+private:
+    std::vector<RoomDelta> m_rooms;
+    std::vector<FieldValue> m_fields;
+    std::vector<SavedExit> m_exits;
+    std::vector<SharedConstRoom> m_removed;
+
+public:
+    // The step that undoes whatever happened to the `touched` rooms since
+    // `before` was taken; `now` is the live map.
+    NODISCARD static UndoStep capture(const MapSnapshot &before,
+                                      const RoomIndex &now,
+                                      std::vector<RoomId> touched);
+
+public:
+    NODISCARD bool empty() const { return m_rooms.empty(); }
+    // Sorted by id.
+    NODISCARD const std::vector<RoomDelta> &getRooms() const { return m_rooms; }
+    NODISCARD const SharedConstRoom &getRemovedRoom(const RoomDelta &delta) const
+    {
+        return m_removed.at(delta.firstField);
+    }
+    template<typename Callback>
+    void forEachField(const RoomDelta &delta, Callback &&callback) const
+    {
+        for (uint32_t i = 0; i < delta.fieldCount; ++i)
+            callback(m_fields.at(delta.firstField + i));
+    }
+    template<typename Callback>
+    void forEachExit(const RoomDelta &delta, Callback &&callback) const
+    {
+        for (uint32_t i = 0; i < delta.exitCount; ++i)
+            callback(m_exits.at(delta.firstExit + i));
+    }
+
+public:
+    // Not counting the removed rooms, which are shared with a snapshot until
+    // the ones after it have changed them.
+    NODISCARD size_t getApproxBytes() const;
+};
+
+/**
+ * The undo and redo stacks for map edits, capped at a total size: when the
+ * steps grow past it, the oldest undo steps are dropped first.
+ */
+class NODISCARD UndoLog final
+{
+public:
+    static constexpr const size_t DEFAULT_MAX_BYTES = size_t{16} << 20;
+
+private:
+    std::deque<UndoStep> m_undo;
+    std::deque<UndoStep> m_redo;
+    size_t m_bytes = 0;
+    size_t m_maxBytes = DEFAULT_MAX_BYTES;
+
+public:
+    // A new edit; the steps that could redo older ones no longer apply.
+    void push(UndoStep step);
+    void pushUndo(UndoStep step);
+    void pushRedo(UndoStep step);
+    NODISCARD std::optional<UndoStep> takeUndo() { return take(m_undo); }
+    NODISCARD std::optional<UndoStep> takeRedo() { return take(m_redo); }
+    void clear();
+
+public:
+    NODISCARD bool canUndo() const { return !m_undo.empty(); }
+    NODISCARD bool canRedo() const { return !m_redo.empty(); }
+    NODISCARD size_t getUndoCount() const { return m_undo.size(); }
+    NODISCARD size_t getRedoCount() const { return m_redo.size(); }
+    NODISCARD size_t getApproxBytes() const { return m_bytes; }
+    void setMaxBytes(size_t bytes);
+
+private:
+    NODISCARD std::optional<UndoStep> take(std::deque<UndoStep> &steps);
+    void trim();
+};
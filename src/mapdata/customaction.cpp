@@ -9,6 +9,7 @@
 #include <set>
 #include <stdexcept>
 #include <utility>
+#include <vector>
 
 #include "../expandoracommon/exit.h"
 #include "../expandoracommon/room.h"
@@ -111,6 +112,28 @@ void GroupMapAction::exec()
     }
 }
 
+MoveRooms::MoveRooms(const Coordinate &in_move, const SharedRoomSelection &selection)
+    : move(in_move)
+{
+    selectedRooms.reserve(selection->size());
+    for (const auto &[rid, room] : *selection) {
+        affectedRooms.insert(rid);
+        selectedRooms.push_back(rid);
+    }
+}
+
+void MoveRooms::exec()
+{
+    std::vector<Room *> rooms;
+    rooms.reserve(selectedRooms.size());
+    for (const RoomId id : selectedRooms) {
+        if (Room *const room = roomIndex(id)) {
+            rooms.push_back(room);
+        }
+    }
+    map().moveRooms(rooms, move);
+}
+
 MoveRelative::MoveRelative(const Coordinate &in_move)
     : move(in_move)
 {}
@@ -185,7 +208,7 @@ void MergeRelative::exec(const RoomId id)
             newHome->addRoom(target);
         }
         const ExitsList &exits = source->getExitsList();
-        for (const ExitDirEnum dir : enums::makeCountingIterator<ExitDirEnum>(exits)) {
+        for (const ExitDirEnum dir : ALL_EXITS7) {
             const Exit &e = exits[dir];
             for (const auto &oeid : e.inRange()) {
                 if (Room *const oe = roomIndex(oeid)) {
@@ -6,6 +6,7 @@
 
 #include <list>
 #include <memory>
+#include <vector>
 
 #include "../expandoracommon/coordinate.h"
 #include "../global/roomid.h"
@@ -80,6 +81,24 @@ class NODISCARD GroupMapAction final : public MapAction
     std::unique_ptr<AbstractAction> executor;
 };
 
+// Moves every selected room by the same offset, all at once; see Map::moveRooms().
+// Unlike a GroupMapAction with MoveRelative, a room that has to make way never
+// takes the spot of one that hasn't been placed yet.
+class NODISCARD MoveRooms final : public MapAction, public FrontendAccessor
+{
+public:
+    explicit MoveRooms(const Coordinate &move, const SharedRoomSelection &selection);
+
+    void schedule(MapFrontend *in) override { setFrontend(in); }
+
+protected:
+    void exec() override;
+
+private:
+    std::vector<RoomId> selectedRooms;
+    Coordinate move;
+};
+
 class NODISCARD MoveRelative final : public AbstractAction
 {
 public:
@@ -8,10 +8,16 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <functional>
+#include <iterator>
 #include <list>
 #include <map>
 #include <memory>
+#include <optional>
 #include <set>
+#include <utility>
+#include <vector>
 #include <QList>
 #include <QString>
 
@@ -19,8 +25,11 @@
 #include "../expandoracommon/coordinate.h"
 #include "../expandoracommon/exit.h"
 #include "../expandoracommon/room.h"
+#include "../global/SlabAllocator.h"
+#include "../global/parallel.h"
 #include "../global/roomid.h"
 #include "../global/utils.h"
+#include "../mapfrontend/MapLock.h"
 #include "../mapfrontend/map.h"
 #include "../mapfrontend/mapaction.h"
 #include "../mapfrontend/mapfrontend.h"
@@ -28,7 +37,6 @@
 #include "ExitDirection.h"
 #include "ExitFieldVariant.h"
 #include "customaction.h"
-#include "drawstream.h"
 #include "infomark.h"
 #include "mmapper2room.h"
 #include "roomfilter.h"
@@ -36,13 +44,47 @@
 
 MapData::MapData(QObject *const parent)
     : MapFrontend(parent)
+    , m_spService{m_spCache}
+    , m_memoryReport{[this](const memory_report::AddFn &add) { reportMemoryUsage(add); }}
 {}
 
+void MapData::reportMemoryUsage(const memory_report::AddFn &add)
+{
+    SharedMapLocker locker{mapLock};
+
+    // Exits are part of the room; only their id sets can spill onto the heap.
+    MemoryUsage rooms;
+    MemoryUsage exits;
+    for (const SharedRoom &room : roomIndex) {
+        if (room == nullptr)
+            continue;
+        ++rooms.count;
+        for (const Exit &e : room->getExitsList()) {
+            exits.count += e.outSize();
+            exits.bytes += e.getIncoming().getHeapBytes() + e.getOutgoing().getHeapBytes();
+        }
+    }
+    rooms.bytes = deref(m_roomArena).getBytesReserved() + roomIndex.size() * sizeof(SharedRoom);
+    add("map: rooms", rooms);
+    add("map: exits", exits);
+    add("map: parse tree", parseTree.getMemoryUsage());
+
+    MemoryUsage marks;
+    marks.count = m_markers.size();
+    for (const SharedInfoMark &mark : m_markers.getList()) {
+        const InfoMarkText &text = mark->getText();
+        marks.bytes += sizeof(InfoMark) + (text.isInterned() ? 0u : text.getStdString().size());
+    }
+    add("map: infomarks", marks);
+    add("map: undo log",
+        MemoryUsage{m_undoLog.getApproxBytes(),
+                    m_undoLog.getUndoCount() + m_undoLog.getRedoCount()});
+}
+
 const DoorName &MapData::getDoorName(const Coordinate &pos, const ExitDirEnum dir)
 {
     // REVISIT: Could this function could be made const if we make mapLock mutable?
-    // Alternately, WTF are we accessing this from multiple threads?
-    QMutexLocker locker(&mapLock);
+    SharedMapLocker locker{mapLock};
     if (const Room *const room = map.get(pos)) {
         if (dir < ExitDirEnum::UNKNOWN) {
             return room->exit(dir).getDoorName();
@@ -56,7 +98,7 @@ const DoorName &MapData::getDoorName(const Coordinate &pos, const ExitDirEnum di
 ExitDirFlags MapData::getExitDirections(const Coordinate &pos)
 {
     ExitDirFlags result;
-    QMutexLocker locker(&mapLock);
+    SharedMapLocker locker{mapLock};
     if (const Room *const room = map.get(pos)) {
         for (const ExitDirEnum dir : ALL_EXITS7) {
             if (room->exit(dir).isExit())
@@ -70,7 +112,7 @@ bool MapData::getExitFlag(const Coordinate &pos, const ExitDirEnum dir, ExitFiel
 {
     assert(var.getType() != ExitFieldEnum::DOOR_NAME);
 
-    QMutexLocker locker(&mapLock);
+    SharedMapLocker locker{mapLock};
     if (const Room *const room = map.get(pos)) {
         if (dir < ExitDirEnum::NONE) {
             switch (var.getType()) {
@@ -97,20 +139,49 @@ bool MapData::getExitFlag(const Coordinate &pos, const ExitDirEnum dir, ExitFiel
 
 const Room *MapData::getRoom(const Coordinate &pos)
 {
-    QMutexLocker locker(&mapLock);
+    SharedMapLocker locker{mapLock};
     return map.get(pos);
 }
 
-QList<Coordinate> MapData::getPath(const Coordinate &start, const CommandQueue &dirs)
+QString MapData::getRoomTooltip(const Coordinate &pos)
 {
-    QMutexLocker locker(&mapLock);
-    QList<Coordinate> ret;
+    // Enough for the rooms around the mouse; past that, start over.
+    static constexpr const size_t MAX_TOOLTIPS = 256;
+
+    SharedMapLocker locker{mapLock};
+    const Room *const room = map.get(pos);
+    if (room == nullptr)
+        return QString{};
+
+    const RoomId id = room->getId();
+    {
+        std::lock_guard<std::mutex> lock{m_tooltipMutex};
+        if (const auto it = m_tooltips.find(id); it != m_tooltips.end())
+            return it->second;
+    }
+    QString tooltip = room->toQString();
+    std::lock_guard<std::mutex> lock{m_tooltipMutex};
+    if (m_tooltips.size() >= MAX_TOOLTIPS)
+        m_tooltips.clear();
+    m_tooltips.emplace(id, tooltip);
+    return tooltip;
+}
 
+template<typename Iterator, typename Callback>
+void MapData::walkPath(const Coordinate &start,
+                       Iterator it,
+                       const Iterator end,
+                       Callback &&callback)
+{
     // NOTE: room is used and then reassigned inside the loop.
     if (const Room *room = map.get(start)) {
-        for (const CommandEnum cmd : dirs) {
-            if (cmd == CommandEnum::LOOK)
+        for (; it != end; ++it) {
+            const CommandEnum cmd = *it;
+            if (cmd == CommandEnum::LOOK) {
+                if (!callback(nullptr))
+                    break;
                 continue;
+            }
 
             if (!isDirectionNESWUD(cmd)) {
                 break;
@@ -119,6 +190,8 @@ QList<Coordinate> MapData::getPath(const Coordinate &start, const CommandQueue &
             const Exit &e = room->exit(getDirection(cmd));
             if (!e.isExit()) {
                 // REVISIT: why does this continue but all of the others break?
+                if (!callback(nullptr))
+                    break;
                 continue;
             }
 
@@ -131,19 +204,70 @@ QList<Coordinate> MapData::getPath(const Coordinate &start, const CommandQueue &
             // WARNING: room is reassigned here!
             room = tmp.get();
 
-            if (room == nullptr) {
+            if (room == nullptr || !callback(room)) {
                 break;
             }
-            ret.append(room->getPosition());
         }
     }
+}
+
+QList<Coordinate> MapData::getPath(const Coordinate &start, const CommandQueue &dirs)
+{
+    SharedMapLocker locker{mapLock};
+    QList<Coordinate> ret;
+    walkPath(start, dirs.begin(), dirs.end(), [&ret](const Room *const room) {
+        if (room != nullptr)
+            ret.append(room->getPosition());
+        return true;
+    });
+    return ret;
+}
+
+std::vector<RoomId> MapData::prefetchPath(const Coordinate &start,
+                                          const CommandQueue &dirs,
+                                          const size_t maxSteps)
+{
+    SharedMapLocker locker{mapLock};
+    std::vector<RoomId> ret;
+    if (maxSteps == 0)
+        return ret;
+
+    ret.reserve(std::min(maxSteps, static_cast<size_t>(dirs.size())));
+    walkPath(start, dirs.begin(), dirs.end(), [&ret, maxSteps](const Room *const room) {
+        if (room == nullptr)
+            return true;
+        static_cast<void>(room->getFingerprint());
+        ret.emplace_back(room->getId());
+        return ret.size() < maxSteps;
+    });
+    return ret;
+}
+
+std::vector<MapData::PathStep> MapData::getPathSteps(const Coordinate &start,
+                                                     const std::vector<CommandEnum> &dirs,
+                                                     const size_t first)
+{
+    SharedMapLocker locker{mapLock};
+    std::vector<PathStep> ret;
+    if (first >= dirs.size())
+        return ret;
+
+    ret.reserve(dirs.size() - first);
+    Coordinate pos = start;
+    const auto from = dirs.begin() + static_cast<std::ptrdiff_t>(first);
+    walkPath(start, from, dirs.end(), [&ret, &pos](const Room *const room) {
+        if (room != nullptr)
+            pos = room->getPosition();
+        ret.emplace_back(PathStep{pos, room != nullptr});
+        return true;
+    });
     return ret;
 }
 
 // the room will be inserted in the given selection. the selection must have been created by mapdata
 const Room *MapData::getRoom(const Coordinate &pos, RoomSelection &selection)
 {
-    QMutexLocker locker(&mapLock);
+    SharedMapLocker locker{mapLock};
     if (Room *const room = map.get(pos)) {
         auto id = room->getId();
         lockRoom(&selection, id);
@@ -155,7 +279,7 @@ const Room *MapData::getRoom(const Coordinate &pos, RoomSelection &selection)
 
 const Room *MapData::getRoom(const RoomId id, RoomSelection &selection)
 {
-    QMutexLocker locker(&mapLock);
+    SharedMapLocker locker{mapLock};
     if (const SharedRoom &room = roomIndex[id]) {
         const RoomId roomId = room->getId();
         assert(id == roomId);
@@ -168,113 +292,504 @@ const Room *MapData::getRoom(const RoomId id, RoomSelection &selection)
     return nullptr;
 }
 
-void MapData::generateBatches(MapCanvasRoomDrawer &screen, const OptBounds &bounds)
+bool MapData::execute(std::unique_ptr<MapAction> action, const SharedRoomSelection &selection)
 {
-    QMutexLocker locker(&mapLock);
-    const LayerToRooms layerToRooms = [this]() -> LayerToRooms {
-        LayerToRooms ltr;
-        DrawStream drawer(ltr);
-        map.getRooms(drawer);
-        return ltr;
-    }();
-    screen.generateBatches(layerToRooms, roomIndex, bounds);
+    bool executable = false;
+    recordUndo([this, &action, &selection, &executable]() {
+        ExclusiveMapLocker locker{mapLock};
+        action->schedule(this);
+        std::list<RoomId> selectedIds;
+
+        for (auto i = selection->begin(); i != selection->end(); i++) {
+            const Room *room = i->second;
+            const auto id = room->getId();
+            locks[id].erase(selection.get());
+            selectedIds.push_back(id);
+        }
+        selection->clear();
+
+        MapAction *const pAction = action.get();
+        executable = isExecutable(pAction);
+        if (executable) {
+            // One notification for everything the action changed, however many rooms that is.
+            batchNotifications([this, pAction]() { executeAction(pAction); });
+        } else {
+            qWarning() << "Unable to execute action" << pAction;
+        }
+
+        for (auto id : selectedIds) {
+            if (const SharedRoom &room = roomIndex[id]) {
+                locks[id].insert(selection.get());
+                selection->emplace(id, room.get());
+            }
+        }
+    });
+    return executable;
 }
 
-bool MapData::execute(std::unique_ptr<MapAction> action, const SharedRoomSelection &selection)
+template<typename Callback>
+void MapData::batchNotifications(Callback &&callback)
+{
+    ExclusiveMapLocker locker{mapLock};
+    const bool outermost = !m_pendingUpdates.has_value();
+    if (outermost)
+        m_pendingUpdates.emplace();
+
+    try {
+        callback();
+    } catch (...) {
+        if (outermost)
+            m_pendingUpdates.reset();
+        throw;
+    }
+
+    if (!outermost)
+        return;
+
+    const RoomUpdateMap updates = std::exchange(m_pendingUpdates, std::nullopt).value();
+    if (!updates.empty()) {
+        setDataChanged();
+        emit sig_onRoomsModified(updates);
+    }
+}
+
+void MapData::execute(MapTransaction transaction)
+{
+    if (transaction.empty())
+        return;
+
+    recordUndo([this, &transaction]() {
+        batchNotifications([this, &transaction]() {
+            for (const auto &action : transaction.takeActions()) {
+                scheduleAction(action);
+            }
+        });
+    });
+}
+
+void MapData::executeBatch(const std::function<void()> &callback)
+{
+    recordUndo([this, &callback]() { batchNotifications(callback); });
+}
+
+bool MapData::compactRoomIds()
 {
-    QMutexLocker locker(&mapLock);
-    action->schedule(this);
-    std::list<RoomId> selectedIds;
+    bool compacted = false;
+    batchNotifications([this, &compacted]() { compacted = compactIds(); });
+    if (compacted) {
+        // The file still has the old ids.
+        markNeedsFullSave();
+        m_undoLog.clear();
+        std::lock_guard<std::mutex> lock{m_tooltipMutex};
+        m_tooltips.clear();
+    }
+    return compacted;
+}
 
-    for (auto i = selection->begin(); i != selection->end(); i++) {
-        const Room *room = i->second;
-        const auto id = room->getId();
-        locks[id].erase(selection.get());
-        selectedIds.push_back(id);
+template<typename Callback>
+std::optional<UndoStep> MapData::captureUndoStep(Callback &&callback)
+{
+    // Nested edits are part of the outermost one.
+    if (m_undoTouched.has_value() || m_applyingSharedChanges || signalsBlocked()) {
+        callback();
+        return std::nullopt;
     }
-    selection->clear();
 
-    MapAction *const pAction = action.get();
-    const bool executable = isExecutable(pAction);
-    if (executable) {
-        executeAction(pAction);
-    } else {
-        qWarning() << "Unable to execute action" << pAction;
+    // Usually cheap: the snapshot is only brought up to date.
+    const SharedMapSnapshot before = getSnapshot();
+    m_undoTouched.emplace();
+    try {
+        callback();
+    } catch (...) {
+        m_undoTouched.reset();
+        throw;
     }
+    std::vector<RoomId> touched = std::exchange(m_undoTouched, std::nullopt).value();
+
+    SharedMapLocker locker{mapLock};
+    return UndoStep::capture(deref(before), roomIndex, std::move(touched));
+}
 
-    for (auto id : selectedIds) {
-        if (const SharedRoom &room = roomIndex[id]) {
-            locks[id].insert(selection.get());
-            selection->emplace(id, room.get());
+template<typename Callback>
+void MapData::recordUndo(Callback &&callback)
+{
+    std::optional<UndoStep> step = captureUndoStep(std::forward<Callback>(callback));
+    if (step.has_value() && !step->empty())
+        m_undoLog.push(std::move(step.value()));
+}
+
+bool MapData::applyUndoStep(const bool undo)
+{
+    std::optional<UndoStep> step = undo ? m_undoLog.takeUndo() : m_undoLog.takeRedo();
+    if (!step.has_value())
+        return false;
+
+    bool restored = false;
+    std::optional<UndoStep> inverse = captureUndoStep(
+        [this, &step, &restored]() { restored = restoreRooms(step.value()); });
+    if (!restored) {
+        if (undo)
+            m_undoLog.pushUndo(std::move(step.value()));
+        else
+            m_undoLog.pushRedo(std::move(step.value()));
+        return false;
+    }
+
+    if (inverse.has_value() && !inverse->empty()) {
+        if (undo)
+            m_undoLog.pushRedo(std::move(inverse.value()));
+        else
+            m_undoLog.pushUndo(std::move(inverse.value()));
+    }
+    return true;
+}
+
+bool MapData::restoreRooms(const UndoStep &step)
+{
+    using KindEnum = UndoStep::RoomDeltaKindEnum;
+    ExclusiveMapLocker locker{mapLock};
+
+    const auto getRoom = [this](const RoomId id) -> Room * {
+        return (id.asUint32() < roomIndex.size()) ? roomIndex[id].get() : nullptr;
+    };
+
+    // Rooms the step removes mustn't be held by anything, just like Remove.
+    for (const UndoStep::RoomDelta &delta : step.getRooms()) {
+        if (delta.kind == KindEnum::CREATED && getRoom(delta.id) != nullptr
+            && !locks[delta.id].empty()) {
+            log(QString("Unable to undo while room %1 is in use").arg(delta.id.asUint32()));
+            return false;
         }
     }
-    return executable;
+
+    batchNotifications([this, &step, &getRoom]() {
+        for (const UndoStep::RoomDelta &delta : step.getRooms()) {
+            if (delta.kind == KindEnum::REMOVED && getRoom(delta.id) == nullptr)
+                restoreRoom(deref(step.getRemovedRoom(delta)).cloneExact(*this));
+        }
+
+        // Every moving room is lifted before any lands, like Map::moveRooms().
+        std::vector<std::pair<Room *, Coordinate>> moved;
+        for (const UndoStep::RoomDelta &delta : step.getRooms()) {
+            Room *const room = getRoom(delta.id);
+            if (delta.kind != KindEnum::CHANGED || room == nullptr)
+                continue;
+
+            step.forEachField(delta, [room](const UndoStep::FieldValue &value) {
+                std::visit(
+                    [room](const auto &field) {
+                        using T = std::decay_t<decltype(field)>;
+#define X_SET(_Type, _Prop, _OptInit) \
+    if constexpr (std::is_same_v<T, _Type>) { \
+        room->set##_Prop(field); \
+    }
+                        XFOREACH_ROOM_PROPERTY(X_SET)
+#undef X_SET
+                    },
+                    value);
+            });
+            if (delta.exitCount != 0) {
+                ExitsList exits = room->getExitsList();
+                step.forEachExit(delta, [&exits](const UndoStep::SavedExit &saved) {
+                    Exit exit = exits[saved.dir];
+                    saved.restore(exit);
+                    exits.set(saved.dir, exit);
+                });
+                room->setExitsList(exits);
+            }
+            if (delta.upToDate.has_value()) {
+                if (delta.upToDate.value())
+                    room->setUpToDate();
+                else
+                    room->setOutDated();
+            }
+            if (delta.fieldCount != 0 || delta.exitCount != 0)
+                rehomeRoom(*room);
+            if (delta.moved) {
+                if (map.get(room->getPosition()) == room)
+                    map.remove(room->getPosition());
+                moved.emplace_back(room, delta.position);
+            }
+        }
+        for (const auto &[room, position] : moved)
+            map.setNearest(position, *room);
+
+        for (const UndoStep::RoomDelta &delta : step.getRooms()) {
+            if (delta.kind == KindEnum::CREATED && getRoom(delta.id) != nullptr) {
+                SingleRoomAction remove{std::make_unique<Remove>(), delta.id};
+                remove.schedule(this);
+                executeAction(&remove);
+            }
+        }
+    });
+    updateBounds();
+    return true;
+}
+
+void MapData::rehomeRoom(Room &room)
+{
+    const RoomId id = room.getId();
+    SharedRoomCollection newHome = parseTree.insertRoom(deref(Room::getEvent(&room)));
+    SharedRoomCollection &home = roomHomes[id];
+    if (home == newHome)
+        return;
+    if (home != nullptr)
+        home->removeRoom(&room);
+    home = newHome;
+    if (newHome != nullptr)
+        newHome->addRoom(&room);
+    invalidateRoomLookups();
 }
 
 void MapData::virt_clear()
 {
+    {
+        std::lock_guard<std::mutex> lock{m_snapshotMutex};
+        m_snapshot.reset();
+        m_snapshotChanges.clear();
+    }
+    m_landmarks.invalidate();
+    m_spCache.clear();
+    m_textIndex.clear();
+    {
+        std::lock_guard<std::mutex> lock{m_tooltipMutex};
+        m_tooltips.clear();
+    }
     m_markers.clear();
+    m_unsharedRooms.clear();
+    m_undoLog.clear();
+    markNeedsFullSave();
     log("cleared MapData");
 }
 
+void MapData::markUnsaved(const RoomId id)
+{
+    if (m_undoTouched.has_value()) {
+        m_undoTouched->emplace_back(id);
+    }
+    // Signals are blocked while loading or merging a map, which isn't shared.
+    if (m_shareChanges && !m_applyingSharedChanges && !signalsBlocked()) {
+        m_unsharedRooms.emplace_back(id);
+    }
+    if (!m_canSaveChanges)
+        return;
+
+    m_unsavedRooms.emplace_back(id);
+    if (m_unsavedRooms.size() > std::max<size_t>(roomIndex.size(), 1024)) {
+        // About as much as a full save would write anyway.
+        markNeedsFullSave();
+    }
+}
+
+void MapData::markConnectedMeshesDirty(const Room &room)
+{
+    if (getDirtyChunks() == nullptr)
+        return;
+
+    const auto markDirty = [this](const RoomId id) {
+        if (id.asUint32() < roomIndex.size()) {
+            if (const SharedRoom &other = roomIndex[id]) {
+                markMeshDirty(other->getPosition());
+            }
+        }
+    };
+    for (const Exit &e : room.getExitsList()) {
+        for (const RoomId id : e.inRange()) {
+            markDirty(id);
+        }
+        for (const RoomId id : e.outRange()) {
+            markDirty(id);
+        }
+    }
+}
+
+std::optional<MapData::UnsavedChanges> MapData::getUnsavedChanges() const
+{
+    if (!m_canSaveChanges)
+        return std::nullopt;
+
+    UnsavedChanges result;
+    result.rooms = m_unsavedRooms;
+    std::sort(result.rooms.begin(), result.rooms.end());
+    result.rooms.erase(std::unique(result.rooms.begin(), result.rooms.end()), result.rooms.end());
+    result.marks = m_unsavedMarks;
+    return result;
+}
+
+void MapData::markSaved()
+{
+    m_unsavedRooms.clear();
+    m_unsavedMarks = false;
+    m_canSaveChanges = true;
+}
+
+void MapData::markNeedsFullSave()
+{
+    m_unsavedRooms.clear();
+    m_unsavedMarks = false;
+    m_canSaveChanges = false;
+}
+
+void MapData::setShareChanges(const bool share)
+{
+    m_shareChanges = share;
+    if (!share) {
+        m_unsharedRooms.clear();
+    }
+}
+
+std::vector<RoomId> MapData::takeUnsharedRooms()
+{
+    std::vector<RoomId> rooms = std::exchange(m_unsharedRooms, {});
+    std::sort(rooms.begin(), rooms.end());
+    rooms.erase(std::unique(rooms.begin(), rooms.end()), rooms.end());
+    return rooms;
+}
+
+void MapData::markSnapshotChanged(const RoomId id)
+{
+    std::lock_guard<std::mutex> lock{m_snapshotMutex};
+    // Without a snapshot, the next one copies everything anyway.
+    if (m_snapshot == nullptr)
+        return;
+
+    m_snapshotChanges.emplace_back(id);
+    if (m_snapshotChanges.size() > std::max<size_t>(roomIndex.size(), MapSnapshot::CHUNK_SIZE)) {
+        // Nobody has asked for a snapshot in a long time; a full copy is cheaper
+        // than tracking every change until somebody does.
+        m_snapshot.reset();
+        m_snapshotChanges.clear();
+    }
+}
+
+SharedMapSnapshot MapData::getSnapshot()
+{
+    SharedMapLocker locker{mapLock};
+    std::lock_guard<std::mutex> lock{m_snapshotMutex};
+    if (m_snapshot != nullptr && m_snapshotChanges.empty() && m_snapshot->getMin() == getMin()
+        && m_snapshot->getMax() == getMax()) {
+        return m_snapshot;
+    }
+
+    m_snapshot = MapSnapshot::derive(m_snapshot,
+                                     roomIndex,
+                                     std::exchange(m_snapshotChanges, {}),
+                                     getMin(),
+                                     getMax());
+    return m_snapshot;
+}
+
 void MapData::removeDoorNames()
 {
-    QMutexLocker locker(&mapLock);
+    ExclusiveMapLocker locker{mapLock};
 
     const auto noName = DoorName{};
+    MapTransaction transaction;
     for (auto &room : roomIndex) {
         if (room != nullptr) {
             for (const ExitDirEnum dir : ALL_EXITS_NESWUD) {
-                scheduleAction(std::make_unique<SingleRoomAction>(
+                transaction.add(std::make_unique<SingleRoomAction>(
                     std::make_unique<ModifyExitFlags>(noName, dir, FlagModifyModeEnum::UNSET),
                     room->getId()));
             }
         }
     }
+    execute(std::move(transaction));
 }
 
+// Rooms per task for genericSearch(); matching one room is cheap.
+static constexpr const size_t SEARCH_BATCH = 256;
+
 void MapData::genericSearch(RoomRecipient *recipient, const RoomFilter &f)
 {
-    QMutexLocker locker(&mapLock);
-    for (const SharedRoom &room : roomIndex) {
-        if (room == nullptr)
-            continue;
-        Room *const r = room.get();
-        if (!f.filter(r))
+    SharedMapLocker locker{mapLock};
+    if (const std::optional<std::vector<RoomId>> candidates = m_textIndex.getCandidates(roomIndex,
+                                                                                       f)) {
+        for (const RoomId id : candidates.value()) {
+            const SharedRoom &room = (id.asUint32() < roomIndex.size()) ? roomIndex[id] : nullptr;
+            if (room == nullptr || !f.filter(room.get()))
+                continue;
+            lockRoom(recipient, id);
+            recipient->receiveRoom(this, room.get());
+        }
+        return;
+    }
+
+    // Filter a snapshot on every core, then hand out the live rooms in id order.
+    const SharedMapSnapshot snapshot = getSnapshot();
+    const size_t numIds = roomIndex.size();
+    std::vector<uint8_t> matched(numIds, 0);
+    parallelFor(
+        numIds,
+        [&snapshot, &f, &matched](const size_t i) {
+            const Room *const r = snapshot->getRoom(RoomId{static_cast<uint32_t>(i)});
+            matched[i] = (r != nullptr && f.filter(r)) ? 1 : 0;
+        },
+        SEARCH_BATCH);
+    for (uint32_t i = 0; i < numIds; ++i) {
+        const SharedRoom &room = roomIndex[RoomId{i}];
+        if (matched[i] == 0 || room == nullptr)
             continue;
-        locks[room->getId()].insert(recipient);
-        recipient->receiveRoom(this, r);
+        lockRoom(recipient, room->getId());
+        recipient->receiveRoom(this, room.get());
     }
 }
 
+std::pair<RoomSearchService::RequestId, SharedMapSnapshot> MapData::requestSearch(
+    const RoomFilter &f, const SharedMapSnapshot &previous, const std::vector<RoomId> &within)
+{
+    // The snapshot and the index have to agree on the rooms.
+    SharedMapLocker locker{mapLock};
+    SharedMapSnapshot snapshot = getSnapshot();
+    std::optional<std::vector<RoomId>> candidates;
+    if (previous != nullptr && previous == snapshot) {
+        candidates = within;
+    }
+    if (std::optional<std::vector<RoomId>> indexed = m_textIndex.getCandidates(roomIndex, f)) {
+        if (candidates.has_value()) {
+            std::vector<RoomId> both;
+            std::set_intersection(candidates->begin(),
+                                  candidates->end(),
+                                  indexed->begin(),
+                                  indexed->end(),
+                                  std::back_inserter(both));
+            candidates = std::move(both);
+        } else {
+            candidates = std::move(indexed);
+        }
+    }
+    const RoomSearchService::RequestId id = m_searchService.search(snapshot, f, std::move(candidates));
+    return std::make_pair(id, std::move(snapshot));
+}
+
 MapData::~MapData() = default;
 
 void MapData::removeMarker(const std::shared_ptr<InfoMark> &im)
 {
-    if (im != nullptr) {
-        auto it = std::find_if(m_markers.begin(), m_markers.end(), [&im](const auto &target) {
-            return target == im;
-        });
-        if (it != m_markers.end()) {
-            m_markers.erase(it);
-            setDataChanged();
-        }
+    if (im != nullptr && m_markers.remove(*im)) {
+        m_unsavedMarks = true;
+        setDataChanged();
     }
 }
 
 void MapData::removeMarkers(const MarkerList &toRemove)
 {
-    // If toRemove is short, this is probably "good enough." However, it may become
-    // very painful if both toRemove.size() and m_markers.size() are in the thousands.
+    bool removed = false;
     for (const auto &im : toRemove) {
-        removeMarker(im);
+        if (im != nullptr && m_markers.remove(*im)) {
+            removed = true;
+        }
+    }
+    if (removed) {
+        m_unsavedMarks = true;
+        setDataChanged();
     }
 }
 
 void MapData::addMarker(const std::shared_ptr<InfoMark> &im)
 {
-    if (im != nullptr) {
-        m_markers.emplace_back(im);
+    if (m_markers.insert(im)) {
+        m_unsavedMarks = true;
         setDataChanged();
     }
 }
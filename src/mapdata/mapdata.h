@@ -5,8 +5,14 @@
 // Author: Marek Krejza <krejza@gmail.com> (Caligor)
 // Author: Nils Schimmelmann <nschimme@gmail.com> (Jahara)
 
+#include <cstdint>
+#include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 #include <QList>
 #include <QString>
@@ -14,10 +20,22 @@
 #include <QtGlobal>
 
 #include "../expandoracommon/coordinate.h"
+#include "../global/MemoryReport.h"
 #include "../global/roomid.h"
 #include "../mapfrontend/mapfrontend.h"
 #include "../parser/CommandQueue.h"
 #include "ExitDirection.h"
+#include "InfoMarkStore.h"
+#include "Landmarks.h"
+#include "MapSnapshot.h"
+#include "MapTransaction.h"
+#include "MapValidator.h"
+#include "RoomSearchService.h"
+#include "RoomTextIndex.h"
+#include "ShortestPathCache.h"
+#include "ShortestPathService.h"
+#include "ShortestPathWorkspace.h"
+#include "UndoLog.h"
 #include "roomfilter.h"
 #include "roomselection.h"
 #include "shortestpath.h"
@@ -26,7 +44,6 @@ class AbstractAction;
 class ExitFieldVariant;
 class InfoMark;
 class MapAction;
-class MapCanvasRoomDrawer;
 class QObject;
 class Room;
 class RoomFieldVariant;
@@ -43,13 +60,60 @@ class MapData final : public MapFrontend
     friend class RoomSelection;
 
 protected:
-    MarkerList m_markers;
+    InfoMarkStore m_markers;
     // changed data?
     bool m_dataChanged = false;
+    uint64_t m_modificationCount = 0;
+    // m_modificationCount when the map was last loaded or saved.
+    uint64_t m_savedModificationCount = 0;
     bool m_fileReadOnly = false;
     QString m_fileName;
     Coordinate m_position;
 
+private:
+    // Guards the snapshot state below.
+    std::mutex m_snapshotMutex;
+    SharedMapSnapshot m_snapshot;
+    // Ids changed since m_snapshot was taken; may contain duplicates.
+    std::vector<RoomId> m_snapshotChanges;
+    // Routing landmarks for the targeted shortestPathSearch().
+    LandmarkCache m_landmarks;
+    // Reused by shortestPathSearch(); see withShortestPathWorkspace().
+    std::mutex m_spWorkspaceMutex;
+    ShortestPathWorkspace m_spWorkspace;
+    // Speeds up genericSearch() and requestSearch() for literal text.
+    RoomTextIndex m_textIndex;
+    // Runs the requestSearch() searches.
+    RoomSearchService m_searchService;
+    // Runs requestValidation().
+    MapValidator m_validator;
+    // Results of the requestShortestPath*() searches, and the service that runs them.
+    ShortestPathCache m_spCache;
+    ShortestPathService m_spService;
+
+    // Rooms changed since the map was last loaded or saved in full, for
+    // journal saves; may contain duplicates.
+    std::vector<RoomId> m_unsavedRooms;
+    bool m_unsavedMarks = false;
+    // Whether the two above are all that changed since then.
+    bool m_canSaveChanges = false;
+    // Rooms changed since they were last shared with the group; may contain
+    // duplicates. Only collected while sharing, and not for shared changes.
+    std::vector<RoomId> m_unsharedRooms;
+    bool m_shareChanges = false;
+    bool m_applyingSharedChanges = false;
+    // Inverse deltas of the recent edits (see recordUndo()).
+    UndoLog m_undoLog;
+    // Rooms touched by the edit being recorded; collected by markUnsaved(),
+    // just like the journal's. May contain duplicates.
+    std::optional<std::vector<RoomId>> m_undoTouched;
+    // Room::toQString() of the rooms getRoomTooltip() was asked about, until
+    // they change.
+    std::mutex m_tooltipMutex;
+    std::unordered_map<RoomId, QString> m_tooltips;
+
+    memory_report::Registration m_memoryReport;
+
 protected:
     // the room will be inserted in the given selection. the selection must have been created by mapdata
     NODISCARD const Room *getRoom(const Coordinate &pos, RoomSelection &in);
@@ -59,13 +123,54 @@ class MapData final : public MapFrontend
     explicit MapData(QObject *parent);
     ~MapData() override;
 
-    void generateBatches(MapCanvasRoomDrawer &screen, const OptBounds &bounds);
-
     /* REVISIT: some callers ignore this */
     bool execute(std::unique_ptr<MapAction> action, const SharedRoomSelection &unlock);
+    // Schedules every action while holding the lock once; emits sig_onDataChanged
+    // and sig_onRoomsModified once for the whole batch.
+    void execute(MapTransaction transaction);
+    // Runs everything the callback does to the map as one batch: the map stays
+    // locked, and the room notifications are reported once at the end.
+    void executeBatch(const std::function<void()> &callback);
+    // See MapFrontend::compactIds(); notifications are batched like a transaction.
+    // The undo log refers to rooms by id, so it's cleared.
+    NODISCARD bool compactRoomIds();
+
+public:
+    // The edits made through execute() and executeBatch() can be undone, unless
+    // they came from the group or happened while loading.
+    NODISCARD bool canUndo() const { return m_undoLog.canUndo(); }
+    NODISCARD bool canRedo() const { return m_undoLog.canRedo(); }
+    // Return false if there's nothing to undo (redo), or if it would remove a
+    // room that something still holds.
+    bool undo() { return applyUndoStep(true); }
+    bool redo() { return applyUndoStep(false); }
+    void clearUndo() { m_undoLog.clear(); }
 
+private:
+    // Runs the callback and returns the step that undoes what it did to the
+    // rooms, or nullopt if it's not recorded (see canUndo()).
+    template<typename Callback>
+    NODISCARD std::optional<UndoStep> captureUndoStep(Callback &&callback);
+    template<typename Callback>
+    void recordUndo(Callback &&callback);
+    NODISCARD bool applyUndoStep(bool undo);
+    // Puts back what the step saved; false if it can't be done right now.
+    NODISCARD bool restoreRooms(const UndoStep &step);
+    // Moves the room to the parse tree node that matches it now.
+    void rehomeRoom(Room &room);
+
+public:
     NODISCARD const Coordinate &getPosition() const { return m_position; }
-    NODISCARD const MarkerList &getMarkersList() const { return m_markers; }
+    NODISCARD const MarkerList &getMarkersList() const { return m_markers.getList(); }
+    NODISCARD const MarkerList &getMarkersOnLayer(const int layer) const
+    {
+        return m_markers.getLayer(layer);
+    }
+    // See InfoMarkGrid::getCandidates().
+    NODISCARD MarkerList getMarkerCandidates(const Coordinate &c1, const Coordinate &c2) const
+    {
+        return m_markers.getGrid().getCandidates(c1, c2);
+    }
     NODISCARD uint getRoomsCount() const
     {
         return (greatestUsedId == INVALID_ROOMID) ? 0u : (greatestUsedId.asUint32() + 1u);
@@ -74,6 +179,8 @@ class MapData final : public MapFrontend
     void addMarker(const std::shared_ptr<InfoMark> &im);
     void removeMarker(const std::shared_ptr<InfoMark> &im);
     void removeMarkers(const MarkerList &toRemove);
+    // Call before adding many marks, e.g. when loading a map.
+    void reserveMarkers(const size_t count) { m_markers.reserve(count); }
 
     NODISCARD bool isEmpty() const
     {
@@ -81,19 +188,108 @@ class MapData final : public MapFrontend
     }
     NODISCARD bool dataChanged() const { return m_dataChanged; }
     NODISCARD QList<Coordinate> getPath(const Coordinate &start, const CommandQueue &dirs);
+    // Follows up to maxSteps of dirs like getPath(), computing each room's fingerprint
+    // so comparing it later is cheap; returns the rooms in order.
+    NODISCARD std::vector<RoomId> prefetchPath(const Coordinate &start,
+                                               const CommandQueue &dirs,
+                                               size_t maxSteps);
+
+    // Where following one command like getPath() leaves you.
+    struct NODISCARD PathStep final
+    {
+        Coordinate pos;
+        // False for the commands that are skipped, e.g. look.
+        bool moved = false;
+    };
+    // One step for each of dirs[first..] until the path stops, so that a cached
+    // path can be extended without walking it again from the start.
+    NODISCARD std::vector<PathStep> getPathSteps(const Coordinate &start,
+                                                 const std::vector<CommandEnum> &dirs,
+                                                 size_t first);
+
+private:
+    // Calls callback(room) for each command followed from start, with the room
+    // it leads to, or nullptr if it's skipped without moving; the walk stops
+    // when the callback returns false. The caller must hold mapLock.
+    template<typename Iterator, typename Callback>
+    void walkPath(const Coordinate &start, Iterator it, Iterator end, Callback &&callback);
 
 private:
     void virt_clear() final;
+    void virt_onRoomIndexChanged(RoomId id) final
+    {
+        markSnapshotChanged(id);
+        markUnsaved(id);
+        m_landmarks.invalidate();
+        m_spCache.invalidate(id);
+        m_textIndex.markChanged(id);
+        invalidateTooltip(id);
+    }
+    void markSnapshotChanged(RoomId id);
+    void invalidateTooltip(RoomId id)
+    {
+        std::lock_guard<std::mutex> lock{m_tooltipMutex};
+        m_tooltips.erase(id);
+    }
+    void markUnsaved(RoomId id);
+    // Connections are drawn by the rooms at either end, so their chunks have
+    // to be rebuilt along with the room's.
+    void markConnectedMeshesDirty(const Room &room);
+    void reportMemoryUsage(const memory_report::AddFn &add);
+
+public:
+    // Returns an immutable view of the rooms that is safe to read from any
+    // thread without holding mapLock. Cheap if nothing changed since the last
+    // call; otherwise only the rooms that did change are copied.
+    NODISCARD SharedMapSnapshot getSnapshot();
 
 public:
     // search for matches
     void genericSearch(RoomRecipient *recipient, const RoomFilter &f);
+    // Like genericSearch(), but over a snapshot on the RoomSearchService
+    // thread. If `previous` is still the current snapshot, only the sorted
+    // `within` rooms are checked, so a search can narrow down an earlier one.
+    // Returns the request id used by the service's signals, and the snapshot
+    // that is searched.
+    NODISCARD std::pair<RoomSearchService::RequestId, SharedMapSnapshot> requestSearch(
+        const RoomFilter &f, const SharedMapSnapshot &previous, const std::vector<RoomId> &within);
+    NODISCARD RoomSearchService &getRoomSearchService() { return m_searchService; }
+
+    // Checks the current snapshot on the MapValidator thread; returns the
+    // request id used by its signal.
+    NODISCARD MapValidator::RequestId requestValidation(const bool full)
+    {
+        return m_validator.validate(getSnapshot(), full);
+    }
+    NODISCARD MapValidator &getMapValidator() { return m_validator; }
 
     void shortestPathSearch(const Room *origin,
                             ShortestPathRecipient *recipient,
                             const RoomFilter &f,
                             int max_hits = -1,
                             double max_dist = 0);
+    // Faster than the above when there is exactly one destination (A*),
+    // and faster still once the landmarks are ready.
+    void shortestPathSearch(const Room *origin,
+                            const Room *target,
+                            ShortestPathRecipient *recipient);
+    // Starts computing the routing landmarks in the background, unless they
+    // are up to date or already being computed.
+    void updateLandmarks();
+
+    // Like shortestPathSearch(), but over a snapshot on the ShortestPathService
+    // thread; returns the request id used by the service's signals.
+    NODISCARD ShortestPathService::RequestId requestShortestPaths(RoomId origin,
+                                                                  const RoomFilter &f,
+                                                                  int max_hits);
+    NODISCARD ShortestPathService::RequestId requestShortestPath(RoomId origin, RoomId target);
+    NODISCARD ShortestPathService &getShortestPathService() { return m_spService; }
+
+private:
+    template<typename Callback>
+    void withShortestPathWorkspace(Callback &&callback);
+
+public:
 
     // Used in Console Commands
     void removeDoorNames();
@@ -114,20 +310,59 @@ class MapData final : public MapFrontend
 
 public:
     NODISCARD const Room *getRoom(const Coordinate &pos);
+    // The text of the canvas's tooltip for the room at pos; empty if there's none.
+    NODISCARD QString getRoomTooltip(const Coordinate &pos);
 
 private:
     // REVISIT: This might be the equivalent of blocking Qt signals.
     bool m_ignoreModifications = false;
+    // Collects room notifications while a MapTransaction is executing.
+    std::optional<RoomUpdateMap> m_pendingUpdates;
+    template<typename Callback>
+    void batchNotifications(Callback &&callback);
     void virt_onNotifyModified(Room &room, const RoomUpdateFlags updateFlags) override
     {
         RoomModificationTracker::virt_onNotifyModified(room, updateFlags);
-        if (!m_ignoreModifications) {
-            setDataChanged();
+        if (room.getId() != INVALID_ROOMID) {
+            markSnapshotChanged(room.getId());
+            markUnsaved(room.getId());
+            invalidateTooltip(room.getId());
+        }
+        if (updateFlags.contains(RoomUpdateEnum::NodeLookupKey)) {
+            invalidateRoomLookups();
+        }
+        // Exits, doors, terrain and ridability all flag the mesh.
+        if (updateFlags.contains(RoomUpdateEnum::Mesh)
+            || updateFlags.contains(RoomUpdateEnum::ConnectionsIn)) {
+            m_landmarks.invalidate();
+        }
+        if (updateFlags.contains(RoomUpdateEnum::Mesh)) {
+            markConnectedMeshesDirty(room);
+        }
+        if (updateFlags.containsAny(ShortestPathCache::getRelevantUpdates())) {
+            m_spCache.invalidate(room.getId());
+        }
+        if (updateFlags.containsAny(RoomUpdateFlags{RoomUpdateEnum::Name} | RoomUpdateEnum::Desc
+                                    | RoomUpdateEnum::Contents | RoomUpdateEnum::Note)) {
+            m_textIndex.markChanged(room.getId());
+        }
+        if (m_ignoreModifications) {
+            return;
         }
+        if (m_pendingUpdates) {
+            (*m_pendingUpdates)[room.getId()] |= updateFlags;
+            return;
+        }
+        setDataChanged();
     }
     void virt_onNotifyModified(InfoMark &mark, const InfoMarkUpdateFlags updateFlags) override
     {
         InfoMarkModificationTracker::virt_onNotifyModified(mark, updateFlags);
+        if (updateFlags.contains(InfoMarkUpdateEnum::CoordinatePosition1)
+            || updateFlags.contains(InfoMarkUpdateEnum::CoordinatePosition2)) {
+            m_markers.update(mark);
+        }
+        m_unsavedMarks = true;
         if (!m_ignoreModifications) {
             setDataChanged();
         }
@@ -136,18 +371,60 @@ class MapData final : public MapFrontend
     void log(const QString &msg) { emit sig_log("MapData", msg); }
 
 public:
-    void unsetDataChanged() { m_dataChanged = false; }
+    void unsetDataChanged()
+    {
+        m_dataChanged = false;
+        m_savedModificationCount = m_modificationCount;
+    }
     void setDataChanged()
     {
         m_dataChanged = true;
+        ++m_modificationCount;
         emit sig_onDataChanged();
     }
+    // Incremented by every setDataChanged(), so a save that took a while can
+    // tell whether the map changed since it started.
+    NODISCARD uint64_t getModificationCount() const { return m_modificationCount; }
+    NODISCARD uint64_t getModificationsSinceSave() const
+    {
+        return m_modificationCount - m_savedModificationCount;
+    }
     void setPosition(const Coordinate &pos) { m_position = pos; }
 
+public:
+    // What a journal save has to write to bring the file up to date.
+    struct NODISCARD UnsavedChanges final
+    {
+        // Sorted; includes rooms that were removed.
+        std::vector<RoomId> rooms;
+        bool marks = false;
+    };
+    // nullopt if only a full save can bring the file up to date.
+    NODISCARD std::optional<UnsavedChanges> getUnsavedChanges() const;
+    // The file now has every change made so far.
+    void markSaved();
+    // Only a full save will bring the file up to date.
+    void markNeedsFullSave();
+
+public:
+    // Starts or stops collecting the rooms to share with the group.
+    void setShareChanges(bool share);
+    // Sorted; includes rooms that were removed.
+    NODISCARD std::vector<RoomId> takeUnsharedRooms();
+    // Changes made by the callback came from the group, so they aren't shared back.
+    template<typename Callback>
+    void applySharedChanges(Callback &&callback)
+    {
+        const bool wasApplying = std::exchange(m_applyingSharedChanges, true);
+        callback();
+        m_applyingSharedChanges = wasApplying;
+    }
+
 public:
 signals:
     void sig_log(const QString &, const QString &);
     void sig_onDataChanged();
+    void sig_onRoomsModified(const RoomUpdateMap &updates);
 
 public slots:
     void slot_scheduleAction(std::shared_ptr<MapAction> action)
@@ -5,7 +5,7 @@
 #include "roomfilter.h"
 
 #include <optional>
-#include <regex>
+#include <string>
 
 #include "../expandoracommon/exit.h"
 #include "../expandoracommon/room.h"
@@ -19,41 +19,17 @@
 #include "enums.h"
 #include "mmapper2room.h"
 
-NODISCARD static std::regex createRegex(const std::string &input,
-                                        const Qt::CaseSensitivity cs,
-                                        const bool regex)
-{
-    // TODO: Switch from std::regex::extended to std::regex::multiline once GCC supports it
-    auto options = std::regex::nosubs | std::regex::optimize | std::regex::extended;
-    if (cs == Qt::CaseInsensitive)
-        options |= std::regex_constants::icase;
-    const std::string pattern = [&input, &options, &regex]() -> std::string {
-        if (input.empty())
-            return R"(^$)";
-
-        if (regex)
-            return input;
-
-        const auto escape_pattern = [&options]() {
-            // Prevent user input from being interpreted as a POSIX extended regex
-            if (options & std::regex::extended)
-                return R"([.[{}()*+?|^$])";
-            // ECMAScript escape pattern (unused)
-            return R"([-[\]{}()*+?.,\^$|#\s])";
-        };
-        static const std::regex escape(escape_pattern(), std::regex::optimize);
-        const std::string sanitized = std::regex_replace(input, escape, R"(\$&)");
-        return ".*" + sanitized + ".*";
-    }();
-    return std::regex(pattern, options);
-}
-
 RoomFilter::RoomFilter(const std::string_view sv,
                        const Qt::CaseSensitivity cs,
                        const bool regex,
                        const PatternKindsEnum kind)
-    : m_regex(createRegex(ParserUtils::latin1ToAscii(sv), cs, regex))
+    : m_matcher(TextMatcher::create(ParserUtils::latin1ToAscii(sv), cs, regex))
     , m_kind(kind)
+    , m_key(std::to_string(static_cast<int>(kind)) + (cs == Qt::CaseSensitive ? "c" : "i")
+            + (regex ? "r:" : "p:") + std::string{sv})
+    , m_literal((regex || TextMatcher::isGlob(sv))
+                    ? std::nullopt
+                    : std::optional<std::string>{ParserUtils::latin1ToAscii(sv)})
 {}
 
 const char *const RoomFilter::parse_help
@@ -112,10 +88,10 @@ bool RoomFilter::filter(const Room *const pr) const
             break;
 
         case PatternKindsEnum::DESC:
-            return matches(r.getDescription());
+            return matches(r.readDescription());
 
         case PatternKindsEnum::CONTENTS:
-            return matches(r.getContents());
+            return matches(r.readContents());
 
         case PatternKindsEnum::NAME:
             return matches(r.getName());
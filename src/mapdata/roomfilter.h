@@ -4,8 +4,8 @@
 // Author: 'Elval' <ethorondil@gmail.com> (Elval)
 
 #include <cassert>
+#include <memory>
 #include <optional>
-#include <regex>
 #include <string>
 #include <string_view>
 #include <type_traits>
@@ -13,6 +13,7 @@
 #include <QtCore>
 
 #include "../expandoracommon/room.h"
+#include "TextMatcher.h"
 
 class Room;
 
@@ -36,12 +37,13 @@ class NODISCARD RoomFilter final
 public:
     NODISCARD bool filter(const Room *r) const;
     NODISCARD PatternKindsEnum patternKind() const { return m_kind; }
+    // Equal for filters that match the same rooms the same way.
+    NODISCARD const std::string &getKey() const { return m_key; }
+    // The text to look for, unless the pattern is a regex or a glob.
+    NODISCARD const std::optional<std::string> &getLiteral() const { return m_literal; }
 
 private:
-    NODISCARD bool matches(const std::string_view s) const
-    {
-        return std::regex_match(s.begin(), s.end(), m_regex);
-    }
+    NODISCARD bool matches(const std::string_view s) const { return m_matcher->matches(s); }
 
 private:
     template<typename T>
@@ -77,6 +79,8 @@ class NODISCARD RoomFilter final
     }
 
 private:
-    const std::regex m_regex;
+    const std::shared_ptr<const TextMatcher> m_matcher;
     const PatternKindsEnum m_kind;
+    const std::string m_key;
+    const std::optional<std::string> m_literal;
 };
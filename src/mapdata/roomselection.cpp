@@ -5,6 +5,7 @@
 
 #include "roomselection.h"
 
+#include <algorithm>
 #include <cassert>
 #include <memory>
 
@@ -36,24 +37,71 @@ NODISCARD static Coordinate max(const Coordinate &a, const Coordinate &b)
     return toCoordinate(glm::max(a.to_ivec3(), b.to_ivec3()));
 }
 
+NODISCARD static bool lessId(const RoomSelection::value_type &a,
+                             const RoomSelection::value_type &b)
+{
+    return a.first < b.first;
+}
+
 RoomSelection::RoomSelection(MapData &admin, const Coordinate &a, const Coordinate &b)
     : RoomSelection(admin)
 {
+    // A box can hold thousands of rooms, which arrive in map order;
+    // sorting them once beats inserting each in place.
+    m_appending = true;
     m_mapData.lookingForRooms(*this, min(a, b), max(a, b));
+    m_appending = false;
+    std::sort(m_rooms.begin(), m_rooms.end(), lessId);
+    m_rooms.erase(std::unique(m_rooms.begin(),
+                              m_rooms.end(),
+                              [](const value_type &x, const value_type &y) {
+                                  return x.first == y.first;
+                              }),
+                  m_rooms.end());
 }
 
 void RoomSelection::virt_receiveRoom(RoomAdmin *const admin, const Room *const aRoom)
 {
     assert(admin == &m_mapData);
-    emplace(aRoom->getId(), aRoom);
+    if (m_appending) {
+        m_rooms.emplace_back(aRoom->getId(), aRoom);
+    } else {
+        emplace(aRoom->getId(), aRoom);
+    }
 }
 
 RoomSelection::~RoomSelection()
 {
     // Remove the lock within the map
-    for (auto i = cbegin(); i != cend(); i++) {
-        m_mapData.releaseRoom(*this, i->first);
+    std::vector<RoomId> ids;
+    ids.reserve(m_rooms.size());
+    for (const auto &entry : m_rooms) {
+        ids.emplace_back(entry.first);
     }
+    m_mapData.releaseRooms(*this, ids);
+}
+
+bool RoomSelection::emplace(const RoomId id, const Room *const room)
+{
+    // Rooms usually come in increasing id order.
+    if (m_rooms.empty() || m_rooms.back().first < id) {
+        m_rooms.emplace_back(id, room);
+        return true;
+    }
+    const value_type entry{id, room};
+    const auto it = std::lower_bound(m_rooms.begin(), m_rooms.end(), entry, lessId);
+    if (it != m_rooms.end() && it->first == id) {
+        return false;
+    }
+    m_rooms.insert(it, entry);
+    return true;
+}
+
+RoomSelection::const_iterator RoomSelection::find(const RoomId targetId) const
+{
+    const value_type entry{targetId, nullptr};
+    const auto it = std::lower_bound(m_rooms.begin(), m_rooms.end(), entry, lessId);
+    return (it != m_rooms.end() && it->first == targetId) ? it : m_rooms.end();
 }
 
 const Room *RoomSelection::getFirstRoom() const noexcept(false)
@@ -86,7 +134,10 @@ const Room *RoomSelection::getRoom(const Coordinate &coord)
 void RoomSelection::unselect(const RoomId targetId)
 {
     m_mapData.releaseRoom(*this, targetId);
-    erase(find(targetId));
+    const auto it = find(targetId);
+    if (it != end()) {
+        erase(it);
+    }
 }
 
 bool RoomSelection::isMovable(const Coordinate &offset) const
@@ -5,7 +5,8 @@
 // Author: Marek Krejza <krejza@gmail.com> (Caligor)
 
 #include <memory>
-#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "../expandoracommon/MmQtHandle.h"
 #include "../expandoracommon/RoomRecipient.h"
@@ -23,14 +24,22 @@ class Room;
 class RoomAdmin;
 class Coordinate;
 class MapData;
-class NODISCARD RoomSelection final : public std::unordered_map<RoomId, const Room *>,
-                                      public RoomRecipient
+// The selected rooms are kept in a vector sorted by id, so iterating is in id
+// order and lookups are a binary search.
+class NODISCARD RoomSelection final : public RoomRecipient
 {
+public:
+    using value_type = std::pair<RoomId, const Room *>;
+    using const_iterator = std::vector<value_type>::const_iterator;
+
 public:
     void virt_receiveRoom(RoomAdmin *admin, const Room *aRoom) final;
 
 private:
     MapData &m_mapData;
+    std::vector<value_type> m_rooms;
+    // Set while a box query appends rooms in map order; they're sorted once it's done.
+    bool m_appending = false;
 
 public:
     explicit RoomSelection(MapData &mapData);
@@ -42,8 +51,22 @@ class NODISCARD RoomSelection final : public std::unordered_map<RoomId, const Ro
     NODISCARD const Room *getFirstRoom() const noexcept(false);
     NODISCARD RoomId getFirstRoomId() const noexcept(false);
 
+public:
+    NODISCARD const_iterator begin() const { return m_rooms.cbegin(); }
+    NODISCARD const_iterator end() const { return m_rooms.cend(); }
+    NODISCARD const_iterator cbegin() const { return m_rooms.cbegin(); }
+    NODISCARD const_iterator cend() const { return m_rooms.cend(); }
+    NODISCARD size_t size() const { return m_rooms.size(); }
+    NODISCARD bool empty() const { return m_rooms.empty(); }
+
 public:
     NODISCARD bool contains(RoomId targetId) const;
+    NODISCARD const_iterator find(RoomId targetId) const;
+    // These only change the list, not the locks held in the map.
+    // Returns false if the room was already selected.
+    bool emplace(RoomId id, const Room *room);
+    void erase(const_iterator it) { m_rooms.erase(it); }
+    void clear() { m_rooms.clear(); }
 
 public:
     /* REVISIT: some callers ignore this */
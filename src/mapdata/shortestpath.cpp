@@ -4,151 +4,407 @@
 
 #include "shortestpath.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <type_traits>
 #include <utility>
-#include <QBasicMutex>
-#include <QSet>
-#include <QVector>
-#include <queue>
+#include <vector>
 
-#include "../expandoracommon/exit.h"
+#include "../expandoracommon/coordinate.h"
 #include "../expandoracommon/room.h"
-#include "../global/enums.h"
 #include "../global/roomid.h"
+#include "../global/utils.h"
+#include "../mapfrontend/MapLock.h"
 #include "ExitDirection.h"
-#include "ExitFlags.h"
+#include "Landmarks.h"
+#include "MapSnapshot.h"
+#include "RoomGraph.h"
+#include "ShortestPathService.h"
+#include "ShortestPathWorkspace.h"
 #include "mapdata.h"
-#include "mmapper2room.h"
 #include "roomfilter.h"
 
-// Movement costs per terrain type.
-// Same order as the RoomTerrainEnum enum.
-// Values taken from https://github.com/nstockton/tintin-mume/blob/master/mapperproxy/mapper/constants.py
-
 ShortestPathRecipient::~ShortestPathRecipient() = default;
 
-NODISCARD static double terrain_cost(const RoomTerrainEnum type)
-{
-    switch (type) {
-    case RoomTerrainEnum::UNDEFINED:
-        return 1.0; // undefined
-    case RoomTerrainEnum::INDOORS:
-        return 0.75; // indoors
-    case RoomTerrainEnum::CITY:
-        return 0.75; // city
-    case RoomTerrainEnum::FIELD:
-        return 1.5; // field
-    case RoomTerrainEnum::FOREST:
-        return 2.15; // forest
-    case RoomTerrainEnum::HILLS:
-        return 2.45; // hills
-    case RoomTerrainEnum::MOUNTAINS:
-        return 2.8; // mountains
-    case RoomTerrainEnum::SHALLOW:
-        return 2.45; // shallow
-    case RoomTerrainEnum::WATER:
-        return 50.0; // water
-    case RoomTerrainEnum::RAPIDS:
-        return 60.0; // rapids
-    case RoomTerrainEnum::UNDERWATER:
-        return 100.0; // underwater
-    case RoomTerrainEnum::ROAD:
-        return 0.85; // road
-    case RoomTerrainEnum::BRUSH:
-        return 1.5; // brush
-    case RoomTerrainEnum::TUNNEL:
-        return 0.75; // tunnel
-    case RoomTerrainEnum::CAVERN:
-        return 0.75; // cavern
-    case RoomTerrainEnum::DEATHTRAP:
-        return 1000.0; // deathtrap
-    }
-
-    return 1.0;
+NODISCARD static int getManhattanDistance(const Coordinate &a, const Coordinate &b)
+{
+    return std::abs(a.x - b.x) + std::abs(a.y - b.y) + std::abs(a.z - b.z);
 }
 
-NODISCARD static double getLength(const Exit &e, const Room *curr, const Room *nextr)
+namespace { // anonymous
+
+// The rooms a search runs over: the live map (under mapLock) or a snapshot,
+// and the graph for those rooms.
+class NODISCARD LiveRooms final
 {
-    double cost = terrain_cost(nextr->getTerrainType());
-    auto flags = e.getExitFlags();
-    if (flags.isRandom() || flags.isDamage() || flags.isFall()) {
-        cost += 30;
-    }
-    if (flags.isDoor()) {
-        cost += 1;
-    }
-    if (flags.isClimb()) {
-        cost += 2;
-    }
-    if (nextr->getRidableType() == RoomRidableEnum::NOT_RIDABLE) {
-        cost += 3;
-        // One non-ridable room means walking two rooms, plus dismount/mount.
-        if (curr->getRidableType() != RoomRidableEnum::NOT_RIDABLE) {
-            cost += 4;
+private:
+    const RoomIndex &m_roomIndex;
+    const RoomGraph &m_graph;
+
+public:
+    explicit LiveRooms(const RoomIndex &roomIndex, const RoomGraph &graph)
+        : m_roomIndex{roomIndex}
+        , m_graph{graph}
+    {}
+
+public:
+    NODISCARD size_t getIdLimit() const { return m_roomIndex.size(); }
+    NODISCARD const RoomGraph &getGraph() const { return m_graph; }
+    NODISCARD const Room *get(const RoomId id) const { return m_roomIndex[id].get(); }
+    template<typename Callback>
+    void forEach(Callback &&callback) const
+    {
+        for (const SharedRoom &room : m_roomIndex) {
+            if (room != nullptr) {
+                callback(*room);
+            }
         }
     }
-    if (flags.isRoad()) { // Not sure if this is appropriate.
-        cost -= 0.1;
+};
+
+class NODISCARD SnapshotRooms final
+{
+private:
+    const MapSnapshot &m_snapshot;
+
+public:
+    explicit SnapshotRooms(const MapSnapshot &snapshot)
+        : m_snapshot{snapshot}
+    {}
+
+public:
+    NODISCARD size_t getIdLimit() const { return m_snapshot.getIdLimit(); }
+    NODISCARD const RoomGraph &getGraph() const { return m_snapshot.getGraph(); }
+    NODISCARD const Room *get(const RoomId id) const { return m_snapshot.getRoom(id); }
+    template<typename Callback>
+    void forEach(Callback &&callback) const
+    {
+        m_snapshot.forEachRoom(std::forward<Callback>(callback));
     }
-    return cost;
-}
+};
 
-void MapData::shortestPathSearch(const Room *origin,
-                                 ShortestPathRecipient *recipient,
-                                 const RoomFilter &f,
-                                 int max_hits,
-                                 double max_dist)
+/*
+ * Best-first search from origin. Rooms are expanded in order of their
+ * distance plus estimate(room), which must never overestimate the remaining
+ * distance (and must not shrink by more than one step's length per step);
+ * with a zero estimate this is plain Dijkstra. onVisit(spnodes, index) is
+ * called once per room, in order, and the search stops when it returns false.
+ */
+template<typename Rooms, typename Estimate, typename Callback>
+void searchShortestPaths(ShortestPathWorkspace &workspace,
+                         const Rooms &rooms,
+                         const Room *const origin,
+                         Estimate &&estimate,
+                         Callback &&onVisit)
 {
-    QMutexLocker locker(&mapLock);
-    QVector<SPNode> sp_nodes;
-    QSet<RoomId> visited;
-    std::priority_queue<std::pair<double, int>> future_paths;
-    sp_nodes.push_back(SPNode(origin, -1, 0, ExitDirEnum::UNKNOWN));
-    future_paths.push(std::make_pair(0, 0));
-    while (!future_paths.empty()) {
-        int spindex = future_paths.top().second;
-        future_paths.pop();
-        const Room *thisr = sp_nodes[spindex].r;
-        auto thisdist = sp_nodes[spindex].dist;
-        auto room_id = thisr->getId();
-        if (visited.contains(room_id)) {
-            continue;
-        }
-        visited.insert(room_id);
-        if (f.filter(thisr)) {
-            recipient->receiveShortestPath(this, sp_nodes, spindex);
-            if (--max_hits == 0) {
-                return;
-            }
-        }
-        if ((max_dist != 0.0) && thisdist > max_dist) {
+    workspace.begin(rooms.getIdLimit());
+    workspace.relax(origin->getId(),
+                    SPNode(origin, -1, 0, ExitDirEnum::UNKNOWN),
+                    estimate(origin));
+    while (!workspace.empty()) {
+        const RoomId room_id = workspace.pop();
+        const SPNode &thisnode = workspace.getNode(room_id);
+        const Room *const thisr = thisnode.r;
+        const double thisdist = thisnode.dist;
+        if (!onVisit(workspace.getNodes(), static_cast<int>(room_id.asUint32()))) {
             return;
         }
-        ExitsList exits = thisr->getExitsList();
-        for (const ExitDirEnum dir : enums::makeCountingIterator<ExitDirEnum>(exits)) {
-            const Exit &e = exits[dir];
-            if (!e.outIsUnique()) {
-                // 0: Not mapped
-                // 2+: Random, so no clear directions; skip it.
-                continue;
-            }
-            if (!e.isExit()) {
+        for (const RoomGraph::Edge &edge : rooms.getGraph().getEdges(room_id)) {
+            const RoomId next_id{edge.to};
+            if (workspace.isSettled(next_id)) {
                 continue;
             }
-            const SharedConstRoom &nextr = roomIndex[e.outFirst()];
-            if (!nextr) {
+            const Room *const nextr = rooms.get(next_id);
+            if (nextr == nullptr) {
                 qWarning() << "Source room" << thisr->getId().asUint32() << "("
                            << thisr->getName().toQString() << ") has target room"
-                           << e.outFirst().asUint32() << "which does not exist!";
+                           << edge.to << "which does not exist!";
                 continue;
             }
-            if (visited.contains(nextr->getId())) {
-                continue;
+            const double dist = thisdist + static_cast<double>(edge.length);
+            workspace.relax(next_id,
+                            SPNode(nextr, static_cast<int>(room_id.asUint32()), dist, edge.dir),
+                            dist + estimate(nextr));
+        }
+    }
+}
+
+/*
+ * Lower bound on the distance left to `goal`, for the A* search.
+ *
+ * A step between adjacent squares costs at least RoomGraph::MIN_LENGTH, but
+ * some exits join rooms that are far apart on the map. Those are treated as
+ * teleports: a route either avoids them, or walks to one of their entrances
+ * and then from one of their exits to the goal. The bound stays consistent
+ * either way, so the first time the goal is reached is via a shortest path.
+ */
+class NODISCARD DistanceBound final
+{
+private:
+    // Past this, only the cheaper half of the bound is used.
+    static constexpr const size_t MAX_ENTRANCES = 128;
+
+    Coordinate m_goal;
+    std::vector<Coordinate> m_entrances;
+    std::optional<int> m_exitToGoal;
+
+public:
+    template<typename Rooms>
+    explicit DistanceBound(const Rooms &rooms, const Coordinate &goal)
+        : m_goal{goal}
+    {
+        const RoomGraph &graph = rooms.getGraph();
+        rooms.forEach([this, &rooms, &graph, &goal](const Room &room) {
+            const Coordinate &from = room.getPosition();
+            for (const RoomGraph::Edge &edge : graph.getEdges(room.getId())) {
+                const Room *const to = rooms.get(RoomId{edge.to});
+                if (to == nullptr || getManhattanDistance(from, to->getPosition()) <= 1) {
+                    continue;
+                }
+                m_entrances.emplace_back(from);
+                const int toGoal = getManhattanDistance(to->getPosition(), goal);
+                m_exitToGoal = std::min(m_exitToGoal.value_or(toGoal), toGoal);
+            }
+        });
+        if (m_entrances.size() > MAX_ENTRANCES) {
+            m_entrances.clear();
+        }
+    }
+
+public:
+    NODISCARD double operator()(const Room *const room) const
+    {
+        const Coordinate &pos = room->getPosition();
+        int steps = getManhattanDistance(pos, m_goal);
+        if (m_exitToGoal.has_value()) {
+            // With too many entrances to check, assume one is right here.
+            int toEntrance = m_entrances.empty() ? 0 : steps;
+            for (const Coordinate &entrance : m_entrances) {
+                toEntrance = std::min(toEntrance, getManhattanDistance(pos, entrance));
+            }
+            steps = std::min(steps, toEntrance + m_exitToGoal.value());
+        }
+        return RoomGraph::MIN_LENGTH * static_cast<double>(steps);
+    }
+};
+
+// Reports up to max_hits rooms accepted by the filter, nearest first.
+template<typename Rooms, typename IsCancelled>
+void findFilteredPaths(ShortestPathWorkspace &workspace,
+                       const Rooms &rooms,
+                       RoomAdmin *const admin,
+                       const Room *const origin,
+                       ShortestPathRecipient &recipient,
+                       const RoomFilter &f,
+                       int max_hits,
+                       const double max_dist,
+                       IsCancelled &&isCancelled)
+{
+    searchShortestPaths(
+        workspace,
+        rooms,
+        origin,
+        [](const Room *) { return 0.0; },
+        [&](const std::vector<SPNode> &sp_nodes, const int spindex) {
+            if (isCancelled()) {
+                return false;
             }
-            const double length = getLength(e, thisr, nextr.get());
-            sp_nodes.push_back(SPNode(nextr.get(), spindex, thisdist + length, dir));
-            future_paths.push(std::make_pair(-(thisdist + length), sp_nodes.size() - 1));
+            const SPNode &node = sp_nodes[static_cast<size_t>(spindex)];
+            if (f.filter(node.r)) {
+                recipient.receiveShortestPath(admin, sp_nodes, spindex);
+                if (--max_hits == 0) {
+                    return false;
+                }
+            }
+            return (max_dist == 0.0) || node.dist <= max_dist;
+        });
+}
+
+template<typename Rooms, typename IsCancelled>
+void findPathTo(ShortestPathWorkspace &workspace,
+                const Rooms &rooms,
+                RoomAdmin *const admin,
+                const Room *const origin,
+                const Room *const target,
+                const Landmarks *const landmarks,
+                ShortestPathRecipient &recipient,
+                IsCancelled &&isCancelled)
+{
+    const RoomId targetId = target->getId();
+    const DistanceBound bound{rooms, target->getPosition()};
+    const auto estimate = [&bound, landmarks, targetId](const Room *const room) {
+        // Both bounds are consistent, so their maximum is as well.
+        const double byPosition = bound(room);
+        return (landmarks == nullptr)
+                   ? byPosition
+                   : std::max(byPosition, landmarks->getLowerBound(room->getId(), targetId));
+    };
+    searchShortestPaths(workspace,
+                        rooms,
+                        origin,
+                        estimate,
+                        [&](const std::vector<SPNode> &sp_nodes, const int spindex) {
+                            if (isCancelled()) {
+                                return false;
+                            }
+                            if (sp_nodes[static_cast<size_t>(spindex)].r != target) {
+                                return true;
+                            }
+                            recipient.receiveShortestPath(admin, sp_nodes, spindex);
+                            return false;
+                        });
+}
+
+} // namespace
+
+// Each search reuses the map's workspace, unless another one (on another
+// thread, or from inside a recipient) is using it.
+template<typename Callback>
+void MapData::withShortestPathWorkspace(Callback &&callback)
+{
+    std::unique_lock<std::mutex> lock{m_spWorkspaceMutex, std::try_to_lock};
+    if (lock.owns_lock()) {
+        callback(m_spWorkspace);
+    } else {
+        ShortestPathWorkspace workspace;
+        callback(workspace);
+    }
+}
+
+void MapData::shortestPathSearch(const Room *origin,
+                                 ShortestPathRecipient *recipient,
+                                 const RoomFilter &f,
+                                 int max_hits,
+                                 double max_dist)
+{
+    SharedMapLocker locker{mapLock};
+    const SharedMapSnapshot snapshot = getSnapshot();
+    withShortestPathWorkspace([&](ShortestPathWorkspace &workspace) {
+        findFilteredPaths(workspace,
+                          LiveRooms{roomIndex, snapshot->getGraph()},
+                          this,
+                          origin,
+                          deref(recipient),
+                          f,
+                          max_hits,
+                          max_dist,
+                          []() { return false; });
+    });
+}
+
+// The same edges searchShortestPaths() follows, for the landmarks.
+NODISCARD static Landmarks::Graph buildLandmarksGraph(const RoomGraph &roomGraph,
+                                                      const size_t numRooms)
+{
+    Landmarks::Graph graph;
+    graph.offsets.reserve(numRooms + 1);
+    for (uint32_t i = 0; i < numRooms; ++i) {
+        for (const RoomGraph::Edge &edge : roomGraph.getEdges(RoomId{i})) {
+            graph.edges.emplace_back(Landmarks::Edge{edge.to, static_cast<double>(edge.length)});
         }
+        graph.offsets.emplace_back(static_cast<uint32_t>(graph.edges.size()));
     }
+    return graph;
+}
+
+void MapData::updateLandmarks()
+{
+    if (!m_landmarks.needsRebuild()) {
+        return;
+    }
+    SharedMapLocker locker{mapLock};
+    m_landmarks.rebuild(buildLandmarksGraph(getSnapshot()->getGraph(), roomIndex.size()));
+}
+
+void MapData::shortestPathSearch(const Room *const origin,
+                                 const Room *const target,
+                                 ShortestPathRecipient *const recipient)
+{
+    SharedMapLocker locker{mapLock};
+    const SharedMapSnapshot snapshot = getSnapshot();
+    const std::shared_ptr<const Landmarks> landmarks = m_landmarks.get();
+    if (landmarks == nullptr && m_landmarks.needsRebuild()) {
+        // Ready for next time; this search makes do without.
+        m_landmarks.rebuild(buildLandmarksGraph(snapshot->getGraph(), roomIndex.size()));
+    }
+
+    withShortestPathWorkspace([&](ShortestPathWorkspace &workspace) {
+        findPathTo(workspace,
+                   LiveRooms{roomIndex, snapshot->getGraph()},
+                   this,
+                   origin,
+                   target,
+                   landmarks.get(),
+                   deref(recipient),
+                   []() { return false; });
+    });
+}
+
+ShortestPathService::RequestId MapData::requestShortestPaths(const RoomId origin,
+                                                            const RoomFilter &f,
+                                                            const int max_hits)
+{
+    const uint64_t epoch = m_spCache.getEpoch();
+    return m_spService.findPaths(getSnapshot(), epoch, origin, f, max_hits);
+}
+
+ShortestPathService::RequestId MapData::requestShortestPath(const RoomId origin,
+                                                           const RoomId target)
+{
+    const uint64_t epoch = m_spCache.getEpoch();
+    std::shared_ptr<const Landmarks> landmarks = m_landmarks.get();
+    if (landmarks == nullptr) {
+        updateLandmarks();
+    }
+    SharedMapSnapshot snapshot = getSnapshot();
+    if (m_landmarks.get() != landmarks) {
+        // The map changed before the snapshot was taken.
+        landmarks.reset();
+    }
+    return m_spService.findPathTo(std::move(snapshot),
+                                  epoch,
+                                  origin,
+                                  target,
+                                  std::move(landmarks));
+}
+
+void shortestPathSearch(const MapSnapshot &snapshot,
+                        ShortestPathWorkspace &workspace,
+                        const Room *const origin,
+                        ShortestPathRecipient &recipient,
+                        const RoomFilter &f,
+                        const int max_hits,
+                        const std::function<bool()> &isCancelled)
+{
+    findFilteredPaths(workspace,
+                      SnapshotRooms{snapshot},
+                      nullptr,
+                      origin,
+                      recipient,
+                      f,
+                      max_hits,
+                      0.0,
+                      isCancelled);
+}
+
+void shortestPathSearch(const MapSnapshot &snapshot,
+                        ShortestPathWorkspace &workspace,
+                        const Room *const origin,
+                        const Room *const target,
+                        const Landmarks *const landmarks,
+                        ShortestPathRecipient &recipient,
+                        const std::function<bool()> &isCancelled)
+{
+    findPathTo(workspace,
+               SnapshotRooms{snapshot},
+               nullptr,
+               origin,
+               target,
+               landmarks,
+               recipient,
+               isCancelled);
 }
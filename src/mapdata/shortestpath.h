@@ -3,16 +3,20 @@
 // Copyright (C) 2019 The MMapper Authors
 // Author: 'Elval' <ethorondil@gmail.com> (Elval)
 
-#include <QSet>
-#include <QVector>
+#include <functional>
+#include <vector>
 
 #include "../expandoracommon/RoomAdmin.h"
 #include "../parser/abstractparser.h"
 #include "ExitDirection.h"
 #include "mmapper2exit.h"
 
+class Landmarks;
+class MapSnapshot;
 class Room;
 class RoomAdmin;
+class RoomFilter;
+class ShortestPathWorkspace;
 
 class NODISCARD SPNode final
 {
@@ -38,12 +42,36 @@ class NODISCARD ShortestPathRecipient
     virtual ~ShortestPathRecipient();
 
 private:
-    virtual void virt_receiveShortestPath(RoomAdmin *admin, QVector<SPNode> spnodes, int endpoint)
+    // spnodes is only valid during the call; follow parent from endpoint to walk the path.
+    virtual void virt_receiveShortestPath(RoomAdmin *admin,
+                                          const std::vector<SPNode> &spnodes,
+                                          int endpoint)
         = 0;
 
 public:
-    void receiveShortestPath(RoomAdmin *const admin, QVector<SPNode> spnodes, const int endpoint)
+    void receiveShortestPath(RoomAdmin *const admin,
+                             const std::vector<SPNode> &spnodes,
+                             const int endpoint)
     {
-        virt_receiveShortestPath(admin, std::move(spnodes), endpoint);
+        virt_receiveShortestPath(admin, spnodes, endpoint);
     }
 };
+
+// Like MapData::shortestPathSearch(), but over a snapshot, so they can run on
+// any thread without mapLock. The recipient gets a null RoomAdmin, and the
+// search stops early once isCancelled() returns true.
+void shortestPathSearch(const MapSnapshot &snapshot,
+                        ShortestPathWorkspace &workspace,
+                        const Room *origin,
+                        ShortestPathRecipient &recipient,
+                        const RoomFilter &f,
+                        int max_hits,
+                        const std::function<bool()> &isCancelled);
+// The landmarks may be null, but must not be older than the snapshot.
+void shortestPathSearch(const MapSnapshot &snapshot,
+                        ShortestPathWorkspace &workspace,
+                        const Room *origin,
+                        const Room *target,
+                        const Landmarks *landmarks,
+                        ShortestPathRecipient &recipient,
+                        const std::function<bool()> &isCancelled);
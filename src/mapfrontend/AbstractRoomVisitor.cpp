@@ -7,3 +7,10 @@
 
 AbstractRoomVisitor::AbstractRoomVisitor() = default;
 AbstractRoomVisitor::~AbstractRoomVisitor() = default;
+
+void AbstractRoomVisitor::visitBatch(const RoomSpan rooms)
+{
+    for (const Room *const room : rooms) {
+        visit(room);
+    }
+}
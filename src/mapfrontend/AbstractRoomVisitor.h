@@ -4,6 +4,11 @@
 // Author: Ulf Hermann <ulfonk_mennhar@gmx.de> (Alve)
 // Author: Marek Krejza <krejza@gmail.com> (Caligor)
 
+#include <array>
+#include <cassert>
+#include <cstddef>
+
+#include "../expandoracommon/RoomSpan.h"
 #include "../global/RuleOf5.h"
 
 class Room;
@@ -16,7 +21,45 @@ class AbstractRoomVisitor
 
 public:
     virtual void visit(const Room *) = 0;
+    // The map's traversals hand over their rooms in runs, so a visitor that
+    // overrides this pays one virtual call per run. By default each room is visited.
+    virtual void visitBatch(RoomSpan rooms);
 
 public:
     DELETE_CTORS_AND_ASSIGN_OPS(AbstractRoomVisitor);
 };
+
+// Collects the rooms of one traversal and passes them on with visitBatch().
+// Call flush() when the traversal is done.
+class NODISCARD RoomVisitorBatcher final
+{
+private:
+    static constexpr const size_t CAPACITY = 256;
+
+    AbstractRoomVisitor &m_visitor;
+    std::array<const Room *, CAPACITY> m_rooms{};
+    size_t m_size = 0;
+
+public:
+    explicit RoomVisitorBatcher(AbstractRoomVisitor &visitor)
+        : m_visitor{visitor}
+    {}
+    ~RoomVisitorBatcher() { assert(m_size == 0); }
+    DELETE_CTORS_AND_ASSIGN_OPS(RoomVisitorBatcher);
+
+public:
+    void add(const Room *const room)
+    {
+        m_rooms[m_size++] = room;
+        if (m_size == CAPACITY)
+            flush();
+    }
+    void flush()
+    {
+        if (m_size == 0)
+            return;
+        const size_t size = m_size;
+        m_size = 0;
+        m_visitor.visitBatch(RoomSpan{m_rooms.data(), size});
+    }
+};
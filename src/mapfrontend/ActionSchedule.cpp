@@ -0,0 +1,108 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "ActionSchedule.h"
+
+#include <utility>
+
+#include "mapaction.h"
+
+void ActionSchedule::clear()
+{
+    assert(!m_draining);
+    m_nodes.clear();
+    m_actions.clear();
+    m_rooms = roomid_vector<RoomList>{};
+    m_freeNodes = NONE;
+    m_freeActions = NONE;
+    m_numPending = 0;
+}
+
+uint32_t ActionSchedule::allocAction(std::shared_ptr<MapAction> action)
+{
+    uint32_t slot = m_freeActions;
+    if (slot != NONE) {
+        m_freeActions = m_actions[slot].nextFree;
+    } else {
+        slot = static_cast<uint32_t>(m_actions.size());
+        m_actions.emplace_back();
+    }
+
+    ActionSlot &ref = m_actions[slot];
+    ref.action = std::move(action);
+    ref.firstNode = NONE;
+    ref.nextFree = NONE;
+    ++m_numPending;
+    return slot;
+}
+
+void ActionSchedule::freeAction(const uint32_t slot)
+{
+    ActionSlot &ref = m_actions[slot];
+    assert(ref.action != nullptr);
+
+    uint32_t node = ref.firstNode;
+    while (node != NONE) {
+        const uint32_t next = m_nodes[node].nextOfAction;
+        unlink(node);
+        node = next;
+    }
+
+    ref.action.reset();
+    ref.firstNode = NONE;
+    ref.nextFree = m_freeActions;
+    m_freeActions = slot;
+    assert(m_numPending != 0);
+    --m_numPending;
+}
+
+void ActionSchedule::link(const uint32_t slot, const RoomId room)
+{
+    if (m_rooms.size() <= room.asUint32())
+        m_rooms.resize(room.asUint32() * 2u + 1u);
+
+    uint32_t node = m_freeNodes;
+    if (node != NONE) {
+        m_freeNodes = m_nodes[node].nextOfAction;
+    } else {
+        node = static_cast<uint32_t>(m_nodes.size());
+        m_nodes.emplace_back();
+    }
+
+    RoomList &list = m_rooms[room];
+    ActionSlot &owner = m_actions[slot];
+
+    Node &ref = m_nodes[node];
+    ref.action = slot;
+    ref.room = room;
+    ref.prev = list.tail;
+    ref.next = NONE;
+    ref.nextOfAction = owner.firstNode;
+    owner.firstNode = node;
+
+    if (list.tail != NONE)
+        m_nodes[list.tail].next = node;
+    else
+        list.head = node;
+    list.tail = node;
+}
+
+void ActionSchedule::unlink(const uint32_t node)
+{
+    Node &ref = m_nodes[node];
+    RoomList &list = m_rooms[ref.room];
+
+    if (ref.prev != NONE)
+        m_nodes[ref.prev].next = ref.next;
+    else
+        list.head = ref.next;
+
+    if (ref.next != NONE)
+        m_nodes[ref.next].prev = ref.prev;
+    else
+        list.tail = ref.prev;
+
+    ref = Node{};
+    ref.nextOfAction = m_freeNodes;
+    m_freeNodes = node;
+}
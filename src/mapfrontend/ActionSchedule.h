@@ -0,0 +1,117 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <cassert>
+#include <climits>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "../global/RuleOf5.h"
+#include "../global/macros.h"
+#include "../global/roomid.h"
+
+class MapAction;
+
+/**
+ * Actions waiting for locked rooms to be released.
+ *
+ * Each pending action owns one node per affected room. Nodes sit in an
+ * intrusive FIFO list per room, and they are also chained per action, so
+ * that an action leaves every room's list once it runs. Nodes, action slots
+ * and per-room list heads are all kept in flat vectors with free lists.
+ * Once those have grown to the working-set size, scheduling and draining
+ * don't allocate.
+ */
+class NODISCARD ActionSchedule final
+{
+private:
+    static constexpr const uint32_t NONE = UINT32_MAX;
+
+    struct NODISCARD Node final
+    {
+        uint32_t action = NONE;
+        RoomId room = INVALID_ROOMID;
+        uint32_t prev = NONE;
+        uint32_t next = NONE;
+        // Next node of the same action; doubles as the free-list link.
+        uint32_t nextOfAction = NONE;
+    };
+
+    struct NODISCARD ActionSlot final
+    {
+        std::shared_ptr<MapAction> action;
+        uint32_t firstNode = NONE;
+        uint32_t nextFree = NONE;
+    };
+
+    struct NODISCARD RoomList final
+    {
+        uint32_t head = NONE;
+        uint32_t tail = NONE;
+    };
+
+    std::vector<Node> m_nodes;
+    std::vector<ActionSlot> m_actions;
+    roomid_vector<RoomList> m_rooms;
+    uint32_t m_freeNodes = NONE;
+    uint32_t m_freeActions = NONE;
+    size_t m_numPending = 0;
+    bool m_draining = false;
+
+public:
+    ActionSchedule() = default;
+    ~ActionSchedule() = default;
+    DELETE_CTORS_AND_ASSIGN_OPS(ActionSchedule);
+
+public:
+    // Queues the action behind every room in `rooms`.
+    template<typename Rooms>
+    void schedule(std::shared_ptr<MapAction> action, const Rooms &rooms)
+    {
+        const uint32_t slot = allocAction(std::move(action));
+        for (const RoomId room : rooms) {
+            link(slot, room);
+        }
+    }
+
+    // Offers each action waiting on `room` to `tryExecute(MapAction &)`, oldest
+    // first; the ones it accepts (by returning true) are dropped from the
+    // schedule. `tryExecute` may schedule new actions, but it must not drain.
+    template<typename Callback>
+    void drain(const RoomId room, Callback &&tryExecute)
+    {
+        if (room.asUint32() >= m_rooms.size())
+            return;
+
+        assert(!m_draining);
+        m_draining = true;
+        uint32_t node = m_rooms[room].head;
+        while (node != NONE) {
+            const uint32_t next = m_nodes[node].next;
+            const uint32_t slot = m_nodes[node].action;
+            // Keep the action alive (and addressable) even if the vectors grow.
+            const std::shared_ptr<MapAction> action = m_actions[slot].action;
+            if (tryExecute(*action))
+                freeAction(slot);
+            node = next;
+        }
+        m_draining = false;
+    }
+
+public:
+    NODISCARD bool empty() const { return m_numPending == 0; }
+    NODISCARD size_t size() const { return m_numPending; }
+    NODISCARD bool hasPending(RoomId room) const
+    {
+        return room.asUint32() < m_rooms.size() && m_rooms[room].head != NONE;
+    }
+    void clear();
+
+private:
+    NODISCARD uint32_t allocAction(std::shared_ptr<MapAction> action);
+    void freeAction(uint32_t slot);
+    void link(uint32_t slot, RoomId room);
+    void unlink(uint32_t node);
+};
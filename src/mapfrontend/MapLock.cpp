@@ -0,0 +1,166 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "MapLock.h"
+
+#include <cassert>
+#include <QDebug>
+
+NODISCARD static double toMilliseconds(const MapLock::Clock::duration d)
+{
+    return std::chrono::duration<double, std::milli>(d).count();
+}
+
+void MapLock::HoldStats::record(const Clock::duration held, const Clock::duration waited)
+{
+    ++count;
+    totalHeld += held;
+    totalWait += waited;
+    maxHeld = std::max(maxHeld, held);
+    maxWait = std::max(maxWait, waited);
+}
+
+MapLock::MapLock() = default;
+
+MapLock::~MapLock()
+{
+    assert(m_writerDepth == 0);
+    assert(m_readers.empty());
+    assert(m_parkedReaders.empty());
+}
+
+void MapLock::lock()
+{
+    const auto self = std::this_thread::get_id();
+    std::unique_lock<std::mutex> guard{m_mutex};
+
+    if (m_writerDepth != 0 && m_writer == self) {
+        ++m_writerDepth;
+        return;
+    }
+
+    bool upgrading = false;
+    if (const auto it = m_readers.find(self); it != m_readers.end()) {
+        if (m_upgradePending) {
+            // Waiting with the shared hold would deadlock against the pending
+            // upgrade, which waits for it; unlock() gives it back.
+            m_parkedReaders.emplace(self, it->second);
+            m_readers.erase(it);
+            guard.unlock();
+            m_cv.notify_all();
+            guard.lock();
+        } else {
+            upgrading = true;
+            m_upgradePending = true;
+        }
+    }
+
+    const auto before = Clock::now();
+    const size_t allowedReaders = upgrading ? 1u : 0u;
+    ++m_waitingWriters;
+    m_cv.wait(guard, [this, allowedReaders]() {
+        return m_writerDepth == 0 && m_readers.size() == allowedReaders;
+    });
+    --m_waitingWriters;
+    if (upgrading)
+        m_upgradePending = false;
+
+    m_writer = self;
+    m_writerDepth = 1;
+    m_writerAcquired = Clock::now();
+    m_writerWaited = m_writerAcquired - before;
+}
+
+void MapLock::unlock()
+{
+    std::unique_lock<std::mutex> guard{m_mutex};
+    assert(m_writerDepth > 0 && m_writer == std::this_thread::get_id());
+    if (--m_writerDepth != 0)
+        return;
+
+    m_writer = std::thread::id{};
+    if (const auto it = m_parkedReaders.find(std::this_thread::get_id());
+        it != m_parkedReaders.end()) {
+        m_readers.emplace(it->first, it->second);
+        m_parkedReaders.erase(it);
+    }
+    const auto held = Clock::now() - m_writerAcquired;
+    m_stats.exclusive.record(held, m_writerWaited);
+    const bool slow = held >= m_slowHoldThreshold;
+    guard.unlock();
+    m_cv.notify_all();
+
+    if (slow)
+        qWarning() << "Map was locked exclusively for" << toMilliseconds(held) << "ms";
+}
+
+void MapLock::lock_shared()
+{
+    const auto self = std::this_thread::get_id();
+    std::unique_lock<std::mutex> guard{m_mutex};
+
+    if (const auto it = m_readers.find(self); it != m_readers.end()) {
+        ++it->second.depth;
+        return;
+    }
+
+    const auto before = Clock::now();
+    if (m_writerDepth == 0 || m_writer != self) {
+        m_cv.wait(guard, [this]() { return m_writerDepth == 0 && m_waitingWriters == 0; });
+    }
+
+    ReaderState &state = m_readers[self];
+    state.depth = 1;
+    state.acquired = Clock::now();
+    state.waited = state.acquired - before;
+}
+
+void MapLock::unlock_shared()
+{
+    std::unique_lock<std::mutex> guard{m_mutex};
+    const auto it = m_readers.find(std::this_thread::get_id());
+    assert(it != m_readers.end());
+    if (it == m_readers.end() || --it->second.depth != 0)
+        return;
+
+    const auto held = Clock::now() - it->second.acquired;
+    m_stats.shared.record(held, it->second.waited);
+    m_readers.erase(it);
+    const bool slow = held >= m_slowHoldThreshold;
+    guard.unlock();
+    m_cv.notify_all();
+
+    if (slow)
+        qWarning() << "Map was locked for reading for" << toMilliseconds(held) << "ms";
+}
+
+bool MapLock::isLockedExclusivelyByCurrentThread() const
+{
+    std::lock_guard<std::mutex> guard{m_mutex};
+    return m_writerDepth != 0 && m_writer == std::this_thread::get_id();
+}
+
+bool MapLock::isLockedByCurrentThread() const
+{
+    const auto self = std::this_thread::get_id();
+    std::lock_guard<std::mutex> guard{m_mutex};
+    return (m_writerDepth != 0 && m_writer == self) || m_readers.find(self) != m_readers.end();
+}
+
+MapLock::Stats MapLock::getStats() const
+{
+    std::lock_guard<std::mutex> guard{m_mutex};
+    return m_stats;
+}
+
+void MapLock::resetStats()
+{
+    std::lock_guard<std::mutex> guard{m_mutex};
+    m_stats = Stats{};
+}
+
+void MapLock::setSlowHoldThreshold(const Clock::duration threshold)
+{
+    std::lock_guard<std::mutex> guard{m_mutex};
+    m_slowHoldThreshold = threshold;
+}
@@ -0,0 +1,101 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+
+#include "../global/RuleOf5.h"
+#include "../global/macros.h"
+
+/**
+ * Recursive shared/exclusive lock guarding the map.
+ *
+ * - Both modes may be re-entered by the thread that holds them.
+ * - The exclusive owner may also take shared locks.
+ * - A shared holder may take the exclusive lock once every other reader
+ *   has left ("upgrade"). Only one upgrade can wait for that at a time; any
+ *   other thread that tries meanwhile gives up its shared hold until it has
+ *   the exclusive lock, so the map may change under it while it waits, and
+ *   gets the shared hold back when it unlocks.
+ *
+ * Waiting writers block new readers, so writers can't be starved.
+ *
+ * Works with std::unique_lock and std::shared_lock.
+ */
+class NODISCARD MapLock final
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct NODISCARD HoldStats final
+    {
+        uint64_t count = 0;
+        Clock::duration totalHeld{};
+        Clock::duration maxHeld{};
+        Clock::duration totalWait{};
+        Clock::duration maxWait{};
+
+        void record(Clock::duration held, Clock::duration waited);
+    };
+
+    struct NODISCARD Stats final
+    {
+        HoldStats exclusive;
+        HoldStats shared;
+    };
+
+private:
+    struct NODISCARD ReaderState final
+    {
+        int depth = 0;
+        Clock::time_point acquired;
+        Clock::duration waited{};
+    };
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+
+    std::thread::id m_writer;
+    int m_writerDepth = 0;
+    int m_waitingWriters = 0;
+    bool m_upgradePending = false;
+    Clock::time_point m_writerAcquired;
+    Clock::duration m_writerWaited{};
+
+    std::unordered_map<std::thread::id, ReaderState> m_readers;
+    // Shared holds given up by upgrades that had to wait behind another one.
+    std::unordered_map<std::thread::id, ReaderState> m_parkedReaders;
+
+    Stats m_stats;
+    Clock::duration m_slowHoldThreshold = std::chrono::milliseconds(100);
+
+public:
+    MapLock();
+    ~MapLock();
+    DELETE_CTORS_AND_ASSIGN_OPS(MapLock);
+
+public:
+    void lock();
+    void unlock();
+    void lock_shared();
+    void unlock_shared();
+
+public:
+    NODISCARD bool isLockedExclusivelyByCurrentThread() const;
+    NODISCARD bool isLockedByCurrentThread() const;
+
+public:
+    NODISCARD Stats getStats() const;
+    void resetStats();
+    // Holds longer than this are reported with qWarning().
+    void setSlowHoldThreshold(Clock::duration threshold);
+};
+
+using ExclusiveMapLocker = std::unique_lock<MapLock>;
+using SharedMapLocker = std::shared_lock<MapLock>;
@@ -5,14 +5,14 @@
 #include "ParseTree.h"
 
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <cctype>
-#include <cstdio>
 #include <iostream>
 #include <memory>
 #include <mutex>
-#include <sstream>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -109,15 +109,66 @@ NODISCARD static MaskFlagsEnum reduceMask(const MaskFlagsEnum mask)
     throw std::invalid_argument("mask");
 }
 
-NODISCARD static auto makeKey(const ParseEvent &event, const MaskFlagsEnum maskFlags)
+/// 128-bit key hashed over the cached hashes and lengths of the masked ParseEvent properties.
+struct NODISCARD ParseKey final
 {
-    char buf[64];
+    uint64_t lo = 0;
+    uint64_t hi = 0;
 
-    const auto mask = static_cast<uint32_t>(maskFlags);
-    std::string key;
+    NODISCARD bool operator==(const ParseKey &rhs) const { return lo == rhs.lo && hi == rhs.hi; }
+    NODISCARD bool operator!=(const ParseKey &rhs) const { return !operator==(rhs); }
+};
 
-    std::snprintf(buf, sizeof(buf), "^K%u", mask);
-    key += buf;
+struct NODISCARD ParseKeyHash final
+{
+    NODISCARD size_t operator()(const ParseKey &key) const noexcept
+    {
+        return static_cast<size_t>(key.lo ^ (key.hi * 0x9E3779B97F4A7C15ull));
+    }
+};
+
+/// Two independent 64-bit lanes fed a word at a time; no allocation.
+class NODISCARD ParseKeyHasher final
+{
+private:
+    uint64_t m_a = 0x243F6A8885A308D3ull;
+    uint64_t m_b = 0x13198A2E03707344ull;
+
+private:
+    NODISCARD static uint64_t rotl(const uint64_t x, const int r)
+    {
+        return (x << r) | (x >> (64 - r));
+    }
+    NODISCARD static uint64_t fmix(uint64_t h)
+    {
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDull;
+        h ^= h >> 33;
+        h *= 0xC4CEB9FE1A85EC53ull;
+        h ^= h >> 33;
+        return h;
+    }
+
+public:
+    void add(const uint64_t word)
+    {
+        m_a = rotl(m_a ^ word, 29) * 0x9E3779B97F4A7C15ull;
+        m_b = rotl(m_b + word, 31) * 0xC2B2AE3D27D4EB4Full;
+    }
+
+    NODISCARD ParseKey finish() const
+    {
+        const uint64_t a = fmix(m_a);
+        const uint64_t b = fmix(m_b ^ a);
+        return ParseKey{a, b};
+    }
+};
+
+NODISCARD static ParseKey makeKey(const ParseEvent &event, const MaskFlagsEnum maskFlags)
+{
+    const auto mask = static_cast<uint32_t>(maskFlags);
+    ParseKeyHasher hasher;
+    hasher.add(static_cast<uint64_t>(mask));
 
     for (size_t i = 0; i < ParseEvent::NUM_PROPS; ++i) {
         if (((mask >> i) & 1u) != 1u)
@@ -127,22 +178,76 @@ NODISCARD static auto makeKey(const ParseEvent &event, const MaskFlagsEnum maskF
         if (prop.isSkipped())
             continue;
 
-        std::snprintf(buf, sizeof(buf), ";P%zu:%zu:", i, prop.size());
-        key += buf;
-        key += prop.getStdString();
+        // The text was hashed once when the event was made; collisions are ruled out by KeyData.
+        hasher.add(static_cast<uint64_t>(i));
+        hasher.add((static_cast<uint64_t>(prop.size()) << 32) | prop.getHash());
+    }
+
+    return hasher.finish();
+}
+
+/// Copy of the properties a primary key was built from; used to rule out
+/// hash collisions without rebuilding a string key on every lookup.
+struct NODISCARD KeyData final
+{
+    std::array<std::string, ParseEvent::NUM_PROPS> props;
+    std::array<uint32_t, ParseEvent::NUM_PROPS> hashes{};
+
+    explicit KeyData(const ParseEvent &event)
+    {
+        for (size_t i = 0; i < ParseEvent::NUM_PROPS; ++i) {
+            props[i] = event[i].getStdString();
+            hashes[i] = event[i].getHash();
+        }
+    }
+
+    NODISCARD bool matches(const ParseEvent &event, const MaskFlagsEnum maskFlags) const
+    {
+        const auto mask = static_cast<uint32_t>(maskFlags);
+        for (size_t i = 0; i < ParseEvent::NUM_PROPS; ++i) {
+            if (((mask >> i) & 1u) != 1u)
+                continue;
+            // skipped properties are empty, so they only match other skipped properties
+            if (event[i].getHash() != hashes[i] || event[i].getStdString() != props[i])
+                return false;
+        }
+        return true;
     }
+};
 
-    return key;
+template<typename Map, typename Pred>
+NODISCARD static auto findVerified(Map &map, const ParseKey &key, Pred &&pred)
+{
+    const auto range = map.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (pred(it->second))
+            return it;
+    }
+    return map.end();
 }
 
 class NODISCARD ParseTree::ParseHashMap final
 {
 private:
-    using Key = std::string;
     using PV = SharedRoomCollection;
-    using Primary = std::unordered_map<Key, PV>;
     using SV = std::unordered_set<PV>;
-    using Secondary = std::unordered_map<Key, SV>;
+
+    struct NODISCARD PrimaryEntry final
+    {
+        KeyData data;
+        PV home;
+    };
+    struct NODISCARD SecondaryEntry final
+    {
+        // Every home in the bucket shares the masked properties, so any of
+        // their primary entries can verify the key. Primary entries are
+        // never erased, and multimap nodes don't move, so this stays valid.
+        const KeyData *representative = nullptr;
+        SV homes;
+    };
+
+    using Primary = std::unordered_multimap<ParseKey, PrimaryEntry, ParseKeyHash>;
+    using Secondary = std::unordered_multimap<ParseKey, SecondaryEntry, ParseKeyHash>;
     Primary m_primary;
     EnumIndexedArray<Secondary, MaskFlagsEnum> m_secondary;
 
@@ -158,37 +263,82 @@ class NODISCARD ParseTree::ParseHashMap final
             return nullptr;
 
         const auto pk = makeKey(event, MaskFlagsEnum::NAME_DESC_TERRAIN);
-        auto &result = m_primary[pk];
-        if (result == nullptr)
-            result = std::make_shared<RoomCollection>();
+        auto primary = findVerified(m_primary, pk, [&event](const PrimaryEntry &entry) {
+            return entry.data.matches(event, MaskFlagsEnum::NAME_DESC_TERRAIN);
+        });
+        if (primary == m_primary.end()) {
+            primary = m_primary.emplace(pk,
+                                        PrimaryEntry{KeyData{event},
+                                                     std::make_shared<RoomCollection>()});
+        }
+        const PrimaryEntry &entry = primary->second;
+        const PV &result = entry.home;
 
         for (auto subMask = mask; subMask != MaskFlagsEnum::NONE; subMask = reduceMask(subMask)) {
             const auto key = makeKey(event, subMask);
             Secondary &reference = m_secondary[subMask];
-            SV &bucket = reference[key];
-            bucket.emplace(result);
+            auto it = findVerified(reference, key, [&event, subMask](const SecondaryEntry &se) {
+                return deref(se.representative).matches(event, subMask);
+            });
+            if (it == reference.end()) {
+                it = reference.emplace(key, SecondaryEntry{&entry.data, SV{}});
+            }
+            it->second.homes.emplace(result);
         }
 
         return result;
     }
 
-    void getRooms(AbstractRoomVisitor &stream, const ParseEvent &event)
+    void getRooms(AbstractRoomVisitor &stream, const ParseEvent &event) const
     {
         const MaskFlagsEnum mask = getKeyMask(event);
 
         if (!isMatchedByTree(mask))
             return;
 
-        const auto &key = makeKey(event, mask);
+        const auto key = makeKey(event, mask);
 
-        Secondary &thislevel = m_secondary[mask];
-        SV &homes = thislevel[key];
-        for (const PV &home : homes) {
+        const Secondary &thislevel = m_secondary[mask];
+        const auto it = findVerified(thislevel, key, [&event, mask](const SecondaryEntry &se) {
+            return deref(se.representative).matches(event, mask);
+        });
+        if (it == thislevel.end())
+            return;
+
+        for (const PV &home : it->second.homes) {
             if (home != nullptr) {
                 home->forEach(stream);
             }
         }
     }
+
+    NODISCARD MemoryUsage getMemoryUsage() const
+    {
+        // Each hash node also has a next pointer and a cached hash.
+        static constexpr const size_t NODE_OVERHEAD = 2 * sizeof(void *);
+        static const size_t INLINE_CAPACITY = std::string{}.capacity();
+
+        MemoryUsage result;
+        result.count = m_primary.size();
+        result.bytes = m_primary.bucket_count() * sizeof(void *)
+                       + m_primary.size() * (sizeof(Primary::value_type) + NODE_OVERHEAD);
+        for (const auto &kv : m_primary) {
+            for (const std::string &prop : kv.second.data.props) {
+                if (prop.capacity() > INLINE_CAPACITY)
+                    result.bytes += prop.capacity() + 1;
+            }
+        }
+        for (const Secondary &secondary : m_secondary) {
+            result.bytes += secondary.bucket_count() * sizeof(void *)
+                            + secondary.size() * (sizeof(Secondary::value_type) + NODE_OVERHEAD);
+            for (const auto &kv : secondary) {
+                const SV &homes = kv.second.homes;
+                result.bytes += homes.bucket_count() * sizeof(void *)
+                                + homes.size() * (sizeof(PV) + NODE_OVERHEAD);
+            }
+        }
+        return result;
+    }
 };
 
 ParseTree::ParseHashMap::~ParseHashMap() = default;
@@ -203,7 +353,22 @@ SharedRoomCollection ParseTree::insertRoom(const ParseEvent &event)
     return m_pimpl->insertRoom(event);
 }
 
-void ParseTree::getRooms(AbstractRoomVisitor &stream, const ParseEvent &event)
+void ParseTree::getRooms(AbstractRoomVisitor &stream, const ParseEvent &event) const
 {
     m_pimpl->getRooms(stream, event);
 }
+
+MemoryUsage ParseTree::getMemoryUsage() const
+{
+    return m_pimpl->getMemoryUsage();
+}
+
+std::optional<ParseTree::Fingerprint> ParseTree::getFingerprint(const ParseEvent &event)
+{
+    const MaskFlagsEnum mask = getKeyMask(event);
+    if (!isMatchedByTree(mask))
+        return std::nullopt;
+
+    const ParseKey key = makeKey(event, mask);
+    return Fingerprint{key.lo, key.hi};
+}
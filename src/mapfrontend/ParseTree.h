@@ -6,9 +6,11 @@
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <optional>
 #include <vector>
 
 #include "../expandoracommon/parseevent.h"
+#include "../global/MemoryReport.h"
 #include "../global/RuleOf5.h"
 #include "../global/roomid.h"
 #include "AbstractRoomVisitor.h"
@@ -18,11 +20,28 @@ class ParseEvent;
 
 /// ParseTree is an 8-way hashmap combining key data from
 /// ParseEvent's name, description, and terrain.
+///
+/// getRooms() only reads, so any number of threads may call it at once, as
+/// long as nothing inserts meanwhile (MapFrontend holds mapLock shared for
+/// lookups and exclusively for inserts).
 class ParseTree final
 {
 public:
     class ParseHashMap;
 
+    // Identifies the set of room homes getRooms() would visit for an event.
+    struct NODISCARD Fingerprint final
+    {
+        uint64_t lo = 0;
+        uint64_t hi = 0;
+
+        NODISCARD bool operator==(const Fingerprint &rhs) const
+        {
+            return lo == rhs.lo && hi == rhs.hi;
+        }
+        NODISCARD bool operator!=(const Fingerprint &rhs) const { return !operator==(rhs); }
+    };
+
 private:
     std::unique_ptr<ParseHashMap> m_pimpl;
 
@@ -33,5 +52,11 @@ class ParseTree final
 
 public:
     NODISCARD SharedRoomCollection insertRoom(const ParseEvent &event);
-    void getRooms(AbstractRoomVisitor &stream, const ParseEvent &event);
+    void getRooms(AbstractRoomVisitor &stream, const ParseEvent &event) const;
+    // The count is the number of room homes.
+    NODISCARD MemoryUsage getMemoryUsage() const;
+
+public:
+    // Returns nothing if getRooms() would never visit any room for `event`.
+    NODISCARD static std::optional<Fingerprint> getFingerprint(const ParseEvent &event);
 };
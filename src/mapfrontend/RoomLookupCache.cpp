@@ -0,0 +1,114 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "RoomLookupCache.h"
+
+#include <cassert>
+#include <utility>
+
+RoomLookupCache::RoomLookupCache(const size_t capacity)
+    : m_capacity{capacity}
+    , m_registration{"room lookups",
+                     cache_registry::CacheCostEnum::MEDIUM,
+                     [this]() { return getApproxBytes(); },
+                     [this](size_t) { clear(); }}
+{
+    assert(m_capacity != 0);
+}
+
+RoomLookupCache::~RoomLookupCache() = default;
+
+bool RoomLookupCache::Entry::matches(const ParseEvent &event) const
+{
+    for (size_t i = 0; i < ParseEvent::NUM_PROPS; ++i) {
+        const Property &prop = event[i];
+        if (prop.getHash() != props[i].getHash()
+            || prop.getStdString() != props[i].getStdString()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+NODISCARD static RoomLookupCache::Props getProps(const ParseEvent &event)
+{
+    RoomLookupCache::Props props;
+    for (size_t i = 0; i < ParseEvent::NUM_PROPS; ++i) {
+        props[i] = event[i];
+    }
+    return props;
+}
+
+std::optional<std::vector<RoomId>> RoomLookupCache::find(const Fingerprint &key,
+                                                         const ParseEvent &event)
+{
+    std::lock_guard<std::mutex> guard{m_mutex};
+    const auto it = m_index.find(key);
+    // A collision counts as a miss; insert() then replaces the entry.
+    if (it == m_index.end() || !it->second->matches(event)) {
+        ++m_misses;
+        return std::nullopt;
+    }
+
+    ++m_hits;
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    return it->second->ids;
+}
+
+void RoomLookupCache::insert(const Fingerprint &key,
+                             const ParseEvent &event,
+                             std::vector<RoomId> ids)
+{
+    std::lock_guard<std::mutex> guard{m_mutex};
+    if (const auto it = m_index.find(key); it != m_index.end()) {
+        it->second->props = getProps(event);
+        it->second->ids = std::move(ids);
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        return;
+    }
+
+    if (m_entries.size() >= m_capacity) {
+        m_index.erase(m_entries.back().key);
+        m_entries.pop_back();
+    }
+    m_entries.push_front(Entry{key, getProps(event), std::move(ids)});
+    m_index.emplace(key, m_entries.begin());
+}
+
+void RoomLookupCache::clear()
+{
+    std::lock_guard<std::mutex> guard{m_mutex};
+    m_index.clear();
+    m_entries.clear();
+}
+
+size_t RoomLookupCache::size() const
+{
+    std::lock_guard<std::mutex> guard{m_mutex};
+    return m_entries.size();
+}
+
+size_t RoomLookupCache::getApproxBytes() const
+{
+    // A list node and an index node per entry, plus the ids.
+    static constexpr const size_t PER_ENTRY = sizeof(Entry) + sizeof(Fingerprint)
+                                              + 4 * sizeof(void *);
+    std::lock_guard<std::mutex> guard{m_mutex};
+    size_t bytes = m_entries.size() * PER_ENTRY;
+    for (const Entry &entry : m_entries) {
+        bytes += entry.ids.capacity() * sizeof(RoomId);
+    }
+    return bytes;
+}
+
+uint64_t RoomLookupCache::getHits() const
+{
+    std::lock_guard<std::mutex> guard{m_mutex};
+    return m_hits;
+}
+
+uint64_t RoomLookupCache::getMisses() const
+{
+    std::lock_guard<std::mutex> guard{m_mutex};
+    return m_misses;
+}
@@ -0,0 +1,90 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "../expandoracommon/parseevent.h"
+#include "../expandoracommon/property.h"
+#include "../global/CacheRegistry.h"
+#include "../global/RuleOf5.h"
+#include "../global/macros.h"
+#include "../global/roomid.h"
+#include "ParseTree.h"
+
+/**
+ * Least-recently-used cache of ParseTree lookups: maps an event's
+ * ParseTree::Fingerprint to the ids of the rooms the tree returned for it.
+ *
+ * The cached ids are the tree's raw result, before any comparison against
+ * the event, so the cache only has to be dropped when a room enters or
+ * leaves the tree or changes its lookup key (RoomUpdateEnum::NodeLookupKey).
+ *
+ * Each entry keeps the (shared) text it was found for, and a hit has to match
+ * it, since different events can have the same fingerprint.
+ *
+ * Safe to use from several threads. Registered with the cache_registry, which
+ * clears it when the caches are over budget.
+ */
+class NODISCARD RoomLookupCache final
+{
+public:
+    static constexpr const size_t DEFAULT_CAPACITY = 256;
+    using Fingerprint = ParseTree::Fingerprint;
+    using Props = std::array<Property, ParseEvent::NUM_PROPS>;
+
+private:
+    struct NODISCARD FingerprintHash final
+    {
+        NODISCARD size_t operator()(const Fingerprint &key) const noexcept
+        {
+            return static_cast<size_t>(key.lo ^ (key.hi * 0x9E3779B97F4A7C15ull));
+        }
+    };
+
+    struct NODISCARD Entry final
+    {
+        Fingerprint key;
+        Props props;
+        std::vector<RoomId> ids;
+
+        NODISCARD bool matches(const ParseEvent &event) const;
+    };
+
+    using Entries = std::list<Entry>;
+
+    mutable std::mutex m_mutex;
+    // Most recently used first.
+    Entries m_entries;
+    std::unordered_map<Fingerprint, Entries::iterator, FingerprintHash> m_index;
+    const size_t m_capacity;
+    uint64_t m_hits = 0;
+    uint64_t m_misses = 0;
+    // Last, so it's unregistered before anything it looks at goes away.
+    cache_registry::Registration m_registration;
+
+public:
+    explicit RoomLookupCache(size_t capacity = DEFAULT_CAPACITY);
+    ~RoomLookupCache();
+    DELETE_CTORS_AND_ASSIGN_OPS(RoomLookupCache);
+
+public:
+    // The event must be the one the fingerprint was made from.
+    NODISCARD std::optional<std::vector<RoomId>> find(const Fingerprint &key,
+                                                      const ParseEvent &event);
+    void insert(const Fingerprint &key, const ParseEvent &event, std::vector<RoomId> ids);
+    void clear();
+
+public:
+    NODISCARD size_t size() const;
+    NODISCARD size_t getApproxBytes() const;
+    NODISCARD uint64_t getHits() const;
+    NODISCARD uint64_t getMisses() const;
+};
@@ -5,10 +5,18 @@
 
 #include "map.h"
 
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdlib>
+#include <cstdint>
 #include <map>
 #include <memory>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
+#include "../expandoracommon/CoordinateKey.h"
 #include "../expandoracommon/coordinate.h"
 #include "../expandoracommon/room.h"
 #include "../global/utils.h"
@@ -27,114 +35,278 @@ struct NODISCARD CoordinateMinMax final
     }
 
     NODISCARD bool isValid() { return glm::all(glm::lessThanEqual(min.to_vec3(), max.to_vec3())); }
+};
 
-    NODISCARD CoordinateMinMax expandCopy(const Coordinate &radius) const
+/**
+ * Counts how many rooms occupy each value along one axis, so the extent along
+ * that axis survives removals without rescanning every room.
+ *
+ * Only distinct values are stored, so updates cost O(log k) where k is the
+ * number of distinct values (at most a few thousand in practice), and an
+ * outlying coordinate can't blow up memory the way a dense array would.
+ */
+class NODISCARD AxisHistogram final
+{
+private:
+    std::map<int, uint32_t> m_counts;
+
+public:
+    void insert(const int v) { ++m_counts[v]; }
+    void remove(const int v)
     {
-        auto copy = *this;
-        copy.min -= radius;
-        copy.max += radius;
-        assert(copy.isValid());
-        return copy;
+        const auto it = m_counts.find(v);
+        assert(it != m_counts.end() && it->second != 0);
+        if (it != m_counts.end() && --it->second == 0)
+            m_counts.erase(it);
     }
+    void clear() { m_counts.clear(); }
+
+    NODISCARD bool empty() const { return m_counts.empty(); }
+    NODISCARD int getMin() const { return m_counts.begin()->first; }
+    NODISCARD int getMax() const { return m_counts.rbegin()->first; }
 };
 
-class Map::MapOrderedTree final
+/**
+ * Rooms are stored in fixed-size square tiles (one layer deep) that live in a
+ * flat hash keyed by the tile's coordinate. Point lookups cost a single hash
+ * probe plus an array index, and box queries walk each tile's contiguous rows.
+ *
+ * Visitation order matches the original z/y/x ordered tree.
+ */
+class Map::MapChunkedGrid final
 {
 private:
-    // REVISIT: consider using something more efficient
-    std::map<int, std::map<int, std::map<int, Room *>>> map{};
+    static constexpr const int CHUNK_BITS = 4;
+    static constexpr const int CHUNK_SIZE = 1 << CHUNK_BITS;
+    static constexpr const int CHUNK_AREA = CHUNK_SIZE * CHUNK_SIZE;
+
+    struct NODISCARD ChunkKey final
+    {
+        int x = 0;
+        int y = 0;
+        int z = 0;
+
+        NODISCARD bool operator==(const ChunkKey &rhs) const
+        {
+            return x == rhs.x && y == rhs.y && z == rhs.z;
+        }
+        NODISCARD bool operator<(const ChunkKey &rhs) const
+        {
+            // same ordering as the original z/y/x tree
+            if (z != rhs.z)
+                return z < rhs.z;
+            if (y != rhs.y)
+                return y < rhs.y;
+            return x < rhs.x;
+        }
+    };
+
+    struct NODISCARD ChunkKeyHash final
+    {
+        NODISCARD size_t operator()(const ChunkKey &key) const noexcept
+        {
+            return CoordinateKeyHash{}(CoordinateKey{key.x, key.y, key.z});
+        }
+    };
+
+    struct NODISCARD Chunk final
+    {
+        std::array<Room *, CHUNK_AREA> rooms{};
+        int count = 0;
+
+        NODISCARD Room *at(const int localX, const int localY) const
+        {
+            return rooms[static_cast<size_t>(localY * CHUNK_SIZE + localX)];
+        }
+        NODISCARD Room *&at(const int localX, const int localY)
+        {
+            return rooms[static_cast<size_t>(localY * CHUNK_SIZE + localX)];
+        }
+    };
+
+    std::unordered_map<ChunkKey, std::unique_ptr<Chunk>, ChunkKeyHash> m_chunks;
+    AxisHistogram m_xs;
+    AxisHistogram m_ys;
+    AxisHistogram m_zs;
+
+private:
+    NODISCARD static int chunkOf(const int v)
+    {
+        // floor division; don't rely on arithmetic right shift of negatives
+        return (v >= 0) ? (v / CHUNK_SIZE) : (-((-(v + 1)) / CHUNK_SIZE) - 1);
+    }
+    NODISCARD static int localOf(const int v) { return v - chunkOf(v) * CHUNK_SIZE; }
+    NODISCARD static ChunkKey keyOf(const Coordinate &c)
+    {
+        return ChunkKey{chunkOf(c.x), chunkOf(c.y), c.z};
+    }
+
+    NODISCARD const Chunk *findChunk(const ChunkKey &key) const
+    {
+        const auto it = m_chunks.find(key);
+        return (it == m_chunks.end()) ? nullptr : it->second.get();
+    }
 
 public:
-    MapOrderedTree() = default;
-    ~MapOrderedTree();
+    MapChunkedGrid() = default;
+    ~MapChunkedGrid();
+
+    void clear()
+    {
+        m_chunks.clear();
+        m_xs.clear();
+        m_ys.clear();
+        m_zs.clear();
+    }
 
-    void clear() { map.clear(); }
+    NODISCARD std::optional<Bounds> getBounds() const
+    {
+        if (m_xs.empty())
+            return std::nullopt;
+        return Bounds{Coordinate{m_xs.getMin(), m_ys.getMin(), m_zs.getMin()},
+                      Coordinate{m_xs.getMax(), m_ys.getMax(), m_zs.getMax()}};
+    }
 
     void getRooms(AbstractRoomVisitor &stream) const
     {
-        for (const auto &z : map) {
-            for (const auto &y : z.second) {
-                for (const auto &x : y.second) {
-                    stream.visit(x.second);
+        using Entry = std::pair<ChunkKey, const Chunk *>;
+        std::vector<Entry> sorted;
+        sorted.reserve(m_chunks.size());
+        for (const auto &kv : m_chunks) {
+            sorted.emplace_back(kv.first, kv.second.get());
+        }
+        std::sort(sorted.begin(), sorted.end(), [](const Entry &a, const Entry &b) {
+            return a.first < b.first;
+        });
+
+        // Walk each horizontal band of chunks (same z and chunk row) row by row,
+        // so the visitation order stays z, then y, then x.
+        RoomVisitorBatcher batcher{stream};
+        const size_t size = sorted.size();
+        for (size_t first = 0; first < size;) {
+            const ChunkKey &bandKey = sorted[first].first;
+            size_t last = first + 1;
+            while (last < size && sorted[last].first.z == bandKey.z
+                   && sorted[last].first.y == bandKey.y) {
+                ++last;
+            }
+            for (int localY = 0; localY < CHUNK_SIZE; ++localY) {
+                for (size_t i = first; i < last; ++i) {
+                    const Chunk &chunk = *sorted[i].second;
+                    for (int localX = 0; localX < CHUNK_SIZE; ++localX) {
+                        if (const Room *const room = chunk.at(localX, localY)) {
+                            batcher.add(room);
+                        }
+                    }
                 }
             }
+            first = last;
         }
+        batcher.flush();
     }
 
     void getRooms(AbstractRoomVisitor &stream, const Coordinate &min, const Coordinate &max) const
     {
-        const auto range = CoordinateMinMax(min, max).expandCopy(Coordinate{1, 1, 1});
-
-        const auto zUpper = map.lower_bound(range.max.z);
-        for (auto z = map.upper_bound(range.min.z); z != zUpper; ++z) {
-            const auto &ymap = (*z).second;
-            const auto yUpper = ymap.lower_bound(range.max.y);
-            for (auto y = ymap.upper_bound(range.min.y); y != yUpper; ++y) {
-                const auto &xmap = (*y).second;
-                const auto xUpper = xmap.lower_bound(range.max.x);
-                for (auto x = xmap.upper_bound(range.min.x); x != xUpper; ++x) {
-                    stream.visit(x->second);
+        // NOTE: both bounds are inclusive.
+        const auto range = CoordinateMinMax(min, max);
+        if (m_chunks.empty())
+            return;
+
+        const int cxLo = chunkOf(range.min.x);
+        const int cxHi = chunkOf(range.max.x);
+        RoomVisitorBatcher batcher{stream};
+        for (int z = range.min.z; z <= range.max.z; ++z) {
+            for (int y = range.min.y; y <= range.max.y; ++y) {
+                const int cy = chunkOf(y);
+                const int localY = localOf(y);
+                for (int cx = cxLo; cx <= cxHi; ++cx) {
+                    const Chunk *const chunk = findChunk(ChunkKey{cx, cy, z});
+                    if (chunk == nullptr)
+                        continue;
+                    const int base = cx * CHUNK_SIZE;
+                    const int xLo = std::max(range.min.x, base) - base;
+                    const int xHi = std::min(range.max.x, base + CHUNK_SIZE - 1) - base;
+                    for (int localX = xLo; localX <= xHi; ++localX) {
+                        if (const Room *const room = chunk->at(localX, localY)) {
+                            batcher.add(room);
+                        }
+                    }
                 }
             }
         }
+        batcher.flush();
     }
 
     /**
      * doesn't modify c
      */
-    bool defined(const Coordinate &c) const
-    {
-        const auto &z = map.find(c.z);
-        if (z != map.end()) {
-            auto &ySeg = (*z).second;
-            const auto &y = ySeg.find(c.y);
-            if (y != ySeg.end()) {
-                const auto &xSeg = (*y).second;
-                if (xSeg.find(c.x) != xSeg.end()) {
-                    return true;
-                }
-            }
-        }
-        return false;
-    }
+    NODISCARD bool defined(const Coordinate &c) const { return get(c) != nullptr; }
 
-    Room *get(const Coordinate &c) const
-    { // map<K,V>::operator[] is not const!
-        //    if (!defined(c)) {
-        //        return nullptr;
-        //    }
-        //    return m_map[c.z][c.y][c.x];
-
-        const auto &zmap = map;
-        const auto &z = zmap.find(c.z);
-        if (z == zmap.end())
-            return nullptr;
-
-        const auto &ymap = z->second;
-        const auto &y = ymap.find(c.y);
-        if (y == ymap.end())
-            return nullptr;
-
-        const auto &xmap = y->second;
-        const auto &x = xmap.find(c.x);
-        if (x == xmap.end())
-            return nullptr;
-
-        return x->second;
+    NODISCARD Room *get(const Coordinate &c) const
+    {
+        if (const Chunk *const chunk = findChunk(keyOf(c)))
+            return chunk->at(localOf(c.x), localOf(c.y));
+        return nullptr;
     }
 
-    void remove(const Coordinate &c) { map[c.z][c.y].erase(c.x); }
+    void remove(const Coordinate &c)
+    {
+        const auto it = m_chunks.find(keyOf(c));
+        if (it == m_chunks.end())
+            return;
+
+        Chunk &chunk = deref(it->second);
+        Room *&ref = chunk.at(localOf(c.x), localOf(c.y));
+        if (ref == nullptr)
+            return;
+
+        ref = nullptr;
+        untrack(c);
+        if (--chunk.count == 0)
+            m_chunks.erase(it);
+    }
 
     /**
      * doesn't modify c
      */
-    void set(const Coordinate &c, Room *room) { map[c.z][c.y][c.x] = room; }
+    void set(const Coordinate &c, Room *const room)
+    {
+        if (room == nullptr) {
+            remove(c);
+            return;
+        }
+
+        auto &ptr = m_chunks[keyOf(c)];
+        if (ptr == nullptr)
+            ptr = std::make_unique<Chunk>();
+
+        Room *&ref = ptr->at(localOf(c.x), localOf(c.y));
+        if (ref == nullptr) {
+            ++ptr->count;
+            track(c);
+        }
+        ref = room;
+    }
+
+private:
+    void track(const Coordinate &c)
+    {
+        m_xs.insert(c.x);
+        m_ys.insert(c.y);
+        m_zs.insert(c.z);
+    }
+    void untrack(const Coordinate &c)
+    {
+        m_xs.remove(c.x);
+        m_ys.remove(c.y);
+        m_zs.remove(c.z);
+    }
 };
 
-Map::MapOrderedTree::~MapOrderedTree() = default;
+Map::MapChunkedGrid::~MapChunkedGrid() = default;
 
 Map::Map()
-    : m_pimpl{std::make_unique<MapOrderedTree>()}
+    : m_pimpl{std::make_unique<MapChunkedGrid>()}
 {}
 
 Map::~Map() = default;
@@ -164,6 +336,37 @@ void Map::getRooms(AbstractRoomVisitor &stream, const Coordinate &min, const Coo
     return m_pimpl->getRooms(stream, min, max);
 }
 
+void Map::getRoomsNear(AbstractRoomVisitor &stream,
+                       const Coordinate &center,
+                       const int radius) const
+{
+    RoomVisitorBatcher batcher{stream};
+    const auto visitAt = [this, &batcher, &center](const int dx, const int dy, const int dz) {
+        if (const Room *const room = m_pimpl->get(center + Coordinate{dx, dy, dz})) {
+            batcher.add(room);
+        }
+    };
+
+    for (int dist = 0; dist <= radius; ++dist) {
+        for (int dz = -dist; dz <= dist; ++dz) {
+            const int restZ = dist - std::abs(dz);
+            for (int dy = -restZ; dy <= restZ; ++dy) {
+                const int dx = restZ - std::abs(dy);
+                visitAt(-dx, dy, dz);
+                if (dx != 0) {
+                    visitAt(dx, dy, dz);
+                }
+            }
+        }
+    }
+    batcher.flush();
+}
+
+std::optional<Bounds> Map::getBounds() const
+{
+    return m_pimpl->getBounds();
+}
+
 void Map::setNearest(const Coordinate &in_c, Room &room)
 {
     const Coordinate c = getNearestFree(in_c);
@@ -171,6 +374,30 @@ void Map::setNearest(const Coordinate &in_c, Room &room)
     room.setPosition(c);
 }
 
+void Map::moveRooms(const std::vector<Room *> &rooms, const Coordinate &offset)
+{
+    // Once they're all lifted, the moving rooms can't land on each other,
+    // so only rooms that stay put can be in the way.
+    for (Room *const room : rooms) {
+        m_pimpl->remove(room->getPosition());
+    }
+
+    std::vector<Room *> displaced;
+    for (Room *const room : rooms) {
+        const Coordinate c = room->getPosition() + offset;
+        if (m_pimpl->defined(c)) {
+            displaced.emplace_back(room);
+            continue;
+        }
+        m_pimpl->set(c, room);
+        room->setPosition(c);
+    }
+
+    for (Room *const room : displaced) {
+        setNearest(room->getPosition() + offset, *room);
+    }
+}
+
 Coordinate Map::getNearestFree(const Coordinate &p)
 {
     if (!m_pimpl->defined(p)) {
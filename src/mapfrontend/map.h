@@ -9,6 +9,8 @@
 #include "../global/RuleOf5.h"
 
 #include <memory>
+#include <optional>
+#include <vector>
 
 class AbstractRoomVisitor;
 class Room;
@@ -21,10 +23,10 @@ class Room;
 class Map final
 {
 public:
-    class MapOrderedTree;
+    class MapChunkedGrid;
 
 private:
-    std::unique_ptr<MapOrderedTree> m_pimpl;
+    std::unique_ptr<MapChunkedGrid> m_pimpl;
 
 public:
     Map();
@@ -33,11 +35,19 @@ class Map final
 
 public:
     void setNearest(const Coordinate &c, Room &room);
+    // Moves all the rooms by the offset. A room whose destination is taken by a
+    // room that isn't moving goes to the nearest free spot, once the others are placed.
+    void moveRooms(const std::vector<Room *> &rooms, const Coordinate &offset);
     Room *get(const Coordinate &c) const;
     void remove(const Coordinate &c);
     void clear();
     void getRooms(AbstractRoomVisitor &stream) const;
     void getRooms(AbstractRoomVisitor &stream, const Coordinate &min, const Coordinate &max) const;
+    // Every room at most `radius` steps (Manhattan distance) from `center`,
+    // nearest first; rooms at the same distance come in z, y, x order.
+    void getRoomsNear(AbstractRoomVisitor &stream, const Coordinate &center, int radius) const;
+    // Smallest box containing every room, or nothing if the map is empty.
+    NODISCARD std::optional<Bounds> getBounds() const;
 
 private:
     Coordinate getNearestFree(const Coordinate &c);
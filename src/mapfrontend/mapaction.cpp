@@ -159,6 +159,7 @@ void Remove::exec(const RoomId id)
     if (room == nullptr) {
         return;
     }
+    notifyRoomIndexChanged(id);
 
     map().remove(room->getPosition());
     if (SharedRoomCollection home = roomHomes(id)) {
@@ -167,7 +168,7 @@ void Remove::exec(const RoomId id)
     // don't return previously used ids for now
     // unusedIds().push(id);
     const ExitsList &exits = room->getExitsList();
-    for (const ExitDirEnum dir : enums::makeCountingIterator<ExitDirEnum>(exits)) {
+    for (const ExitDirEnum dir : ALL_EXITS7) {
         const Exit &e = exits[dir];
         for (const auto &idx : e.inRange()) {
             if (const SharedRoom &other = rooms[idx]) {
@@ -208,8 +209,15 @@ Room *FrontendAccessor::roomIndex(const RoomId id) const
     return m_frontend->roomIndex[id].get();
 }
 
+void FrontendAccessor::notifyRoomIndexChanged(const RoomId id)
+{
+    m_frontend->notifyRoomIndexChanged(id);
+}
+
 RoomHomes &FrontendAccessor::roomHomes()
 {
+    // Callers move rooms between homes, which changes what lookups by event return.
+    m_frontend->invalidateRoomLookups();
     return m_frontend->roomHomes;
 }
 const SharedRoomCollection &FrontendAccessor::roomHomes(const RoomId id) const
@@ -41,6 +41,7 @@ class NODISCARD FrontendAccessor
 
     NODISCARD RoomIndex &roomIndex();
     NODISCARD Room *roomIndex(RoomId) const;
+    void notifyRoomIndexChanged(RoomId);
 
     NODISCARD RoomHomes &roomHomes();
     NODISCARD const SharedRoomCollection &roomHomes(RoomId) const;
@@ -8,16 +8,23 @@
 
 #include <cassert>
 #include <memory>
+#include <optional>
 #include <set>
 #include <utility>
-#include <QMutex>
+#include <vector>
 
 #include "../expandoracommon/RoomRecipient.h"
 #include "../expandoracommon/coordinate.h"
 #include "../expandoracommon/parseevent.h"
 #include "../expandoracommon/room.h"
+#include "../global/EventTrace.h"
+#include "../global/SlabAllocator.h"
 #include "../global/roomid.h"
+#include "AbstractRoomVisitor.h"
+#include "ActionSchedule.h"
+#include "MapLock.h"
 #include "ParseTree.h"
+#include "RoomLookupCache.h"
 #include "map.h"
 #include "mapaction.h"
 #include "roomcollection.h"
@@ -25,11 +32,12 @@
 
 MapFrontend::MapFrontend(QObject *const parent)
     : QObject(parent)
+    , m_roomArena{std::make_shared<SlabArena>()}
 {}
 
 MapFrontend::~MapFrontend()
 {
-    QMutexLocker locker(&mapLock);
+    ExclusiveMapLocker locker{mapLock};
     emit sig_clearingMap();
 }
 
@@ -52,32 +60,21 @@ void MapFrontend::checkSize()
 
 void MapFrontend::scheduleAction(const std::shared_ptr<MapAction> &action)
 {
-    QMutexLocker locker(&mapLock);
+    ExclusiveMapLocker locker{mapLock};
     action->schedule(this);
 
-    bool executable = true;
-    for (auto roomId : action->getAffectedRooms()) {
-        actionSchedule[roomId].insert(action);
-        if (!locks[roomId].empty()) {
-            executable = false;
-        }
-    }
-    if (executable) {
+    if (isExecutable(action.get())) {
         executeAction(action.get());
-        removeAction(action);
+    } else {
+        actionSchedule.schedule(action, action->getAffectedRooms());
     }
 }
 
 void MapFrontend::executeAction(MapAction *const action)
 {
+    event_trace::Scope scope{"MapFrontend::executeAction"};
     action->exec();
-}
-
-void MapFrontend::removeAction(const std::shared_ptr<MapAction> &action)
-{
-    for (auto roomId : action->getAffectedRooms()) {
-        actionSchedule[roomId].erase(action);
-    }
+    updateBounds();
 }
 
 bool MapFrontend::isExecutable(MapAction *const action)
@@ -92,30 +89,26 @@ bool MapFrontend::isExecutable(MapAction *const action)
 
 void MapFrontend::executeActions(const RoomId roomId)
 {
-    std::set<std::shared_ptr<MapAction>> executedActions;
-    for (const auto &action : actionSchedule[roomId]) {
-        if (isExecutable(action.get())) {
-            executeAction(action.get());
-            executedActions.insert(action);
-        }
-    }
-    for (const auto &action : executedActions) {
-        removeAction(action);
-    }
+    actionSchedule.drain(roomId, [this](MapAction &action) -> bool {
+        if (!isExecutable(&action))
+            return false;
+        executeAction(&action);
+        return true;
+    });
 }
 
 void MapFrontend::lookingForRooms(RoomRecipient &recipient, const Coordinate &pos)
 {
-    QMutexLocker locker(&mapLock);
+    ExclusiveMapLocker locker{mapLock};
     if (Room *const r = map.get(pos)) {
-        locks[r->getId()].insert(&recipient);
+        lockRoom(&recipient, r->getId());
         recipient.receiveRoom(this, r);
     }
 }
 
 void MapFrontend::clear()
 {
-    QMutexLocker locker(&mapLock);
+    ExclusiveMapLocker locker{mapLock};
     emit sig_clearingMap();
 
     for (size_t i = 0, size = roomIndex.size(); i < size; ++i) {
@@ -140,6 +133,7 @@ void MapFrontend::clear()
     }
     greatestUsedId = INVALID_ROOMID;
     m_bounds.reset();
+    invalidateRoomLookups();
     checkSize(); // called for side effect of sending signal
 
     // REVISIT: should this occur inside of the lock?
@@ -148,10 +142,10 @@ void MapFrontend::clear()
 
 void MapFrontend::lookingForRooms(RoomRecipient &recipient, const RoomId id)
 {
-    QMutexLocker locker(&mapLock);
+    ExclusiveMapLocker locker{mapLock};
     if (greatestUsedId >= id) {
         if (const SharedRoom &r = roomIndex[id]) {
-            locks[id].insert(&recipient);
+            lockRoom(&recipient, id);
             recipient.receiveRoom(this, r.get());
         }
     }
@@ -185,24 +179,108 @@ RoomId MapFrontend::assignId(const SharedRoom &room, const SharedRoomCollection
     }
     roomIndex[id] = room;
     roomHomes[id] = roomHome;
+    notifyRoomIndexChanged(id);
     return id;
 }
 
+bool MapFrontend::compactIds()
+{
+    ExclusiveMapLocker locker{mapLock};
+    for (const auto &recipients : locks) {
+        if (!recipients.empty())
+            return false;
+    }
+    if (!actionSchedule.empty())
+        return false;
+
+    const uint32_t oldSize = static_cast<uint32_t>(roomIndex.size());
+    roomid_vector<RoomId> remap(oldSize, INVALID_ROOMID);
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < oldSize; ++i) {
+        if (roomIndex[RoomId{i}] != nullptr)
+            remap[RoomId{i}] = RoomId{count++};
+    }
+
+    const auto translate = [&remap, oldSize](const RoomId id) {
+        return (id.asUint32() < oldSize) ? remap[id] : INVALID_ROOMID;
+    };
+
+    RoomIndex newIndex(count, nullptr);
+    RoomHomes newHomes(count, nullptr);
+    for (uint32_t i = 0; i < oldSize; ++i) {
+        const RoomId oldId{i};
+        const RoomId newId = remap[oldId];
+        if (newId == INVALID_ROOMID)
+            continue;
+
+        const SharedRoom &room = roomIndex[oldId];
+        ExitsList exits = room->getExitsList();
+        for (Exit &e : exits) {
+            const TinyRoomIdSet in = e.inClone();
+            const TinyRoomIdSet out = e.outClone();
+            for (const RoomId id : in)
+                e.removeIn(id);
+            for (const RoomId id : out)
+                e.removeOut(id);
+            // References to rooms that no longer exist are dropped.
+            for (const RoomId id : in) {
+                if (const RoomId to = translate(id); to != INVALID_ROOMID)
+                    e.addIn(to);
+            }
+            for (const RoomId id : out) {
+                if (const RoomId to = translate(id); to != INVALID_ROOMID)
+                    e.addOut(to);
+            }
+        }
+        room->setExitsList(exits);
+        room->setId(newId);
+
+        newIndex[newId] = room;
+        newHomes[newId] = roomHomes[oldId];
+        if (newId != oldId)
+            notifyRoomIndexChanged(oldId);
+    }
+
+    roomIndex = std::move(newIndex);
+    roomHomes = std::move(newHomes);
+    locks = RoomLocks(count);
+    actionSchedule.clear();
+    while (!unusedIds.empty()) {
+        unusedIds.pop();
+    }
+    greatestUsedId = (count == 0) ? INVALID_ROOMID : RoomId{count - 1u};
+    return true;
+}
+
 void MapFrontend::lookingForRooms(RoomRecipient &recipient,
                                   const Coordinate &input_min,
                                   const Coordinate &input_max)
 {
-    QMutexLocker locker(&mapLock);
+    ExclusiveMapLocker locker{mapLock};
     RoomLocker ret(recipient, *this);
     map.getRooms(ret, input_min, input_max);
 }
 
+void MapFrontend::lookingForRooms(RoomRecipient &recipient,
+                                  const Coordinate &center,
+                                  const int radius)
+{
+    ExclusiveMapLocker locker{mapLock};
+    RoomLocker ret(recipient, *this);
+    map.getRoomsNear(ret, center, radius);
+}
+
 void MapFrontend::insertPredefinedRoom(const SharedRoom &sharedRoom)
+{
+    assert(signalsBlocked());
+    restoreRoom(sharedRoom);
+}
+
+void MapFrontend::restoreRoom(const SharedRoom &sharedRoom)
 {
     Room &room = deref(sharedRoom);
 
-    QMutexLocker locker(&mapLock);
-    assert(signalsBlocked());
+    ExclusiveMapLocker locker{mapLock};
     const auto id = room.getId();
     const Coordinate &c = room.getPosition();
     auto event = Room::getEvent(&room);
@@ -211,7 +289,7 @@ void MapFrontend::insertPredefinedRoom(const SharedRoom &sharedRoom)
 
     auto roomHome = parseTree.insertRoom(*event);
     map.setNearest(c, room);
-    checkSize(room.getPosition());
+    updateBounds();
     unusedIds.push(id);
     MAYBE_UNUSED const auto ignored = assignId(sharedRoom, roomHome);
     if (roomHome != nullptr) {
@@ -221,45 +299,26 @@ void MapFrontend::insertPredefinedRoom(const SharedRoom &sharedRoom)
 
 RoomId MapFrontend::createEmptyRoom(const Coordinate &c)
 {
-    QMutexLocker locker(&mapLock);
+    ExclusiveMapLocker locker{mapLock};
     SharedRoom room = Room::createPermanentRoom(*this);
     map.setNearest(c, *room);
-    checkSize(room->getPosition());
+    updateBounds();
     return assignId(room, nullptr);
 }
 
-void MapFrontend::checkSize(const Coordinate &c)
+void MapFrontend::updateBounds()
 {
-    if (!m_bounds) {
-        m_bounds.emplace();
-        m_bounds->min = m_bounds->max = c;
-        emit sig_mapSizeChanged(c, c);
+    const std::optional<Bounds> bounds = map.getBounds();
+    const auto same = [](const Bounds &a, const Bounds &b) {
+        return a.min == b.min && a.max == b.max;
+    };
+    if (bounds.has_value() == m_bounds.has_value()
+        && (!bounds || same(bounds.value(), m_bounds.value()))) {
         return;
     }
 
-#define MINMAX(xyz) \
-    do { \
-        auto &lo = min.xyz; \
-        auto &hi = max.xyz; \
-        lo = std::min(lo, c.xyz); \
-        hi = std::max(hi, c.xyz); \
-    } while (false)
-
-    auto &min = m_bounds->min;
-    auto &max = m_bounds->max;
-
-    const Coordinate oldMin{min};
-    const Coordinate oldMax{max};
-
-    MINMAX(x);
-    MINMAX(y);
-    MINMAX(z);
-
-    if (min != oldMin || max != oldMax) {
-        emit sig_mapSizeChanged(min, max);
-    }
-
-#undef MINMAX
+    m_bounds = bounds;
+    emit sig_mapSizeChanged(getMin(), getMax());
 }
 
 void MapFrontend::slot_createRoom(const SigParseEvent &sigParseEvent,
@@ -267,20 +326,77 @@ void MapFrontend::slot_createRoom(const SigParseEvent &sigParseEvent,
 {
     const ParseEvent &event = sigParseEvent.deref();
 
-    QMutexLocker locker(&mapLock);
-    checkSize(expectedPosition); // still hackish but somewhat better
+    ExclusiveMapLocker locker{mapLock};
     if (SharedRoomCollection roomHome = parseTree.insertRoom(event)) {
         SharedRoom room = Room::createTemporaryRoom(*this, event);
         roomHome->addRoom(room);
         map.setNearest(expectedPosition, *room);
         MAYBE_UNUSED const auto ignored = assignId(room, roomHome);
+        updateBounds();
+    }
+}
+
+std::vector<RoomId> MapFrontend::findRoomIds(const ParseTree::Fingerprint &fingerprint,
+                                             const ParseEvent &event)
+{
+    if (std::optional<std::vector<RoomId>> ids = m_lookupCache.find(fingerprint, event)) {
+        return std::move(ids.value());
     }
+
+    class NODISCARD IdCollector final : public AbstractRoomVisitor
+    {
+    public:
+        std::vector<RoomId> ids;
+        void visit(const Room *const room) final { ids.emplace_back(room->getId()); }
+        void visitBatch(const RoomSpan rooms) final
+        {
+            for (const Room *const room : rooms) {
+                visit(room);
+            }
+        }
+    } collector;
+    parseTree.getRooms(collector, event);
+    m_lookupCache.insert(fingerprint, event, collector.ids);
+    return std::move(collector.ids);
 }
 
 void MapFrontend::lookingForRooms(RoomRecipient &recipient, const SigParseEvent &sigParseEvent)
 {
     const ParseEvent &event = sigParseEvent.deref();
-    QMutexLocker locker(&mapLock);
+    const std::optional<ParseTree::Fingerprint> fingerprint = ParseTree::getFingerprint(event);
+
+    // The rooms are looked up and handed out with the lock shared, so several
+    // lookups (the path machine, its prefetches, other sessions) can run at
+    // once: the cache and the room locks have mutexes of their own.
+    const auto deliver = [this, &recipient, &event, &fingerprint]() {
+        std::vector<SharedRoom> rooms;
+        for (const RoomId id : findRoomIds(fingerprint.value(), event)) {
+            if (const SharedRoom &room = roomIndex[id]) {
+                rooms.emplace_back(room);
+            }
+        }
+        // Releasing a room takes the lock exclusively, which can let others
+        // change the map first, so each room must still be the one found.
+        RoomLocker ret(recipient, *this, &event);
+        for (const SharedRoom &room : rooms) {
+            const RoomId id = room->getId();
+            if (id.asUint32() < roomIndex.size() && roomIndex[id] == room) {
+                ret.visit(room.get());
+            }
+        }
+    };
+
+    {
+        SharedMapLocker locker{mapLock};
+        if (greatestUsedId != INVALID_ROOMID) {
+            if (fingerprint)
+                deliver();
+            return;
+        }
+    }
+
+    // Only the very first room of a map needs the exclusive lock.
+    ExclusiveMapLocker locker{mapLock};
     if (greatestUsedId == INVALID_ROOMID) {
         Coordinate c(0, 0, 0);
         slot_createRoom(sigParseEvent, c);
@@ -288,21 +404,32 @@ void MapFrontend::lookingForRooms(RoomRecipient &recipient, const SigParseEvent
             roomIndex[DEFAULT_ROOMID]->setPermanent();
         }
     }
-
-    RoomLocker ret(recipient, *this, &event);
-    parseTree.getRooms(ret, event);
+    if (fingerprint)
+        deliver();
 }
 
 void MapFrontend::lockRoom(RoomRecipient *const recipient, const RoomId id)
 {
+    // Shared holders of mapLock may race each other here; exclusive holders can't race anyone.
+    std::lock_guard<std::mutex> guard{m_locksMutex};
     locks[id].insert(recipient);
 }
 
+void MapFrontend::lockRooms(RoomRecipient *const recipient,
+                            const RoomId *const ids,
+                            const size_t count)
+{
+    std::lock_guard<std::mutex> guard{m_locksMutex};
+    for (size_t i = 0; i < count; ++i) {
+        locks[ids[i]].insert(recipient);
+    }
+}
+
 // removes the lock on a room
 // after the last lock is removed, the room is deleted
 void MapFrontend::releaseRoom(RoomRecipient &sender, const RoomId id)
 {
-    QMutexLocker lock(&mapLock);
+    ExclusiveMapLocker lock{mapLock};
     auto &room_locks_ref = locks[id];
     room_locks_ref.erase(&sender);
     if (room_locks_ref.empty()) {
@@ -318,13 +445,33 @@ void MapFrontend::releaseRoom(RoomRecipient &sender, const RoomId id)
     }
 }
 
+void MapFrontend::releaseRooms(RoomRecipient &sender, const std::vector<RoomId> &ids)
+{
+    ExclusiveMapLocker lock{mapLock};
+    for (const RoomId id : ids) {
+        releaseRoom(sender, id);
+    }
+}
+
+void MapFrontend::readLocked(const std::function<void()> &callback)
+{
+    SharedMapLocker lock{mapLock};
+    callback();
+}
+
+void MapFrontend::applyLockChanges(const std::vector<RoomLockChange> &changes)
+{
+    ExclusiveMapLocker lock{mapLock};
+    RoomAdmin::applyLockChanges(changes);
+}
+
 // REVISIT: This is sent too often. Hunt down and kill the unnecessary cases (probably most of them).
 //
 // makes a lock on a room permanent and anonymous.
 // Like that the room can't be deleted via releaseRoom anymore.
 void MapFrontend::keepRoom(RoomRecipient &sender, const RoomId id)
 {
-    QMutexLocker lock(&mapLock);
+    ExclusiveMapLocker lock{mapLock};
     auto &lock_ref = locks[id];
     lock_ref.erase(&sender);
     scheduleAction(std::make_shared<SingleRoomAction>(std::make_unique<MakePermanent>(), id));
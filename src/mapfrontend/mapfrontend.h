@@ -5,21 +5,28 @@
 // Author: Marek Krejza <krejza@gmail.com> (Caligor)
 // Author: Nils Schimmelmann <nschimme@gmail.com> (Jahara)
 
+#include <cstdint>
+#include <functional>
 #include <map>
 #include <memory>
 #include <optional>
 #include <set>
+#include <mutex>
 #include <stack>
-#include <QMutex>
+#include <vector>
 #include <QString>
 #include <QtCore>
 
 #include "../expandoracommon/RoomAdmin.h"
 #include "../expandoracommon/coordinate.h"
 #include "../expandoracommon/parseevent.h"
+#include "../global/RoomLockSet.h"
 #include "../global/roomid.h"
 #include "../mapdata/infomark.h"
+#include "ActionSchedule.h"
+#include "MapLock.h"
 #include "ParseTree.h"
+#include "RoomLookupCache.h"
 #include "map.h"
 
 class MapAction;
@@ -28,6 +35,7 @@ class QObject;
 class Room;
 class RoomCollection;
 class RoomRecipient;
+class SlabArena;
 
 /**
  * The MapFrontend organizes rooms and their relations to each other.
@@ -42,27 +50,53 @@ class MapFrontend : public QObject, public RoomAdmin, public InfoMarkModificatio
     Map map;
     RoomIndex roomIndex;
     std::stack<RoomId> unusedIds;
-    std::map<RoomId, std::set<std::shared_ptr<MapAction>>> actionSchedule;
+    ActionSchedule actionSchedule;
     RoomHomes roomHomes;
     RoomLocks locks;
+    // Backing store for every room created by this frontend (see Room::allocate).
+    std::shared_ptr<SlabArena> m_roomArena;
 
     RoomId greatestUsedId = INVALID_ROOMID;
-    QRecursiveMutex mapLock;
-
-    struct Bounds final
-    {
-        Coordinate min;
-        Coordinate max;
-    };
+    // Read-only queries take this shared; anything that can modify the map
+    // (including handing rooms to recipients that may release them) takes it
+    // exclusively.
+    MapLock mapLock;
+    // Guards `locks` for callers that only hold mapLock shared.
+    std::mutex m_locksMutex;
+
+    // Last bounds reported through sig_mapSizeChanged; see updateBounds().
     std::optional<Bounds> m_bounds;
+    // Results of parseTree lookups by event; see lookingForRooms(RoomRecipient&, SigParseEvent).
+    RoomLookupCache m_lookupCache;
 
     void executeActions(RoomId roomId);
     void executeAction(MapAction *action);
     bool isExecutable(MapAction *action);
-    void removeAction(const std::shared_ptr<MapAction> &action);
 
     RoomId assignId(const SharedRoom &room, const SharedRoomCollection &roomHome);
-    void checkSize(const Coordinate &);
+    // Emits sig_mapSizeChanged if the box around all rooms has grown or shrunk.
+    void updateBounds();
+    // Renumbers rooms densely (keeping their relative order) and rewrites every
+    // exit to match. Refuses, returning false, while any room is locked, since
+    // selections and pending actions refer to rooms by id.
+    NODISCARD bool compactIds();
+    // Called whenever a room enters or leaves roomIndex.
+    void notifyRoomIndexChanged(RoomId id)
+    {
+        invalidateRoomLookups();
+        virt_onRoomIndexChanged(id);
+    }
+    // Must be called whenever a room may have moved to a different room home.
+    void invalidateRoomLookups()
+    {
+        m_lookupCache.clear();
+    }
+    // Puts a room back under the id it already has, which must be free.
+    void restoreRoom(const SharedRoom &room);
+    // The ids of the rooms parseTree has for the event, through the cache; it
+    // only reads the map, so mapLock may be held shared.
+    NODISCARD std::vector<RoomId> findRoomIds(const ParseTree::Fingerprint &fingerprint,
+                                              const ParseEvent &event);
 
 public:
     explicit MapFrontend(QObject *parent);
@@ -70,6 +104,8 @@ class MapFrontend : public QObject, public RoomAdmin, public InfoMarkModificatio
 
 private:
     virtual void virt_clear() = 0;
+    virtual void virt_onRoomIndexChanged(RoomId /*id*/) {}
+    NODISCARD std::shared_ptr<SlabArena> virt_getRoomArena() const final { return m_roomArena; }
 
 public:
     void clear();
@@ -80,20 +116,30 @@ class MapFrontend : public QObject, public RoomAdmin, public InfoMarkModificatio
     // removes the lock on a room
     // after the last lock is removed, the room is deleted
     void releaseRoom(RoomRecipient &, RoomId) final;
+    // Same as releasing each room, but takes mapLock once.
+    void releaseRooms(RoomRecipient &, const std::vector<RoomId> &ids);
 
     // makes a lock on a room permanent and anonymous.
     // Like that the room can't be deleted via releaseRoom anymore.
     void keepRoom(RoomRecipient &, RoomId) final;
+    // Takes mapLock once for all of the changes.
+    void applyLockChanges(const std::vector<RoomLockChange> &changes) final;
 
+    // Safe to call while holding mapLock either shared or exclusively.
     void lockRoom(RoomRecipient *, RoomId);
+    // Same as locking each room, but takes the locks' mutex once.
+    void lockRooms(RoomRecipient *, const RoomId *ids, size_t count);
     RoomId createEmptyRoom(const Coordinate &);
     void insertPredefinedRoom(const SharedRoom &);
     RoomId getMaxId() { return greatestUsedId; }
     Coordinate getMin() const { return m_bounds ? m_bounds->min : Coordinate{}; }
     Coordinate getMax() const { return m_bounds ? m_bounds->max : Coordinate{}; }
+    NODISCARD MapLock::Stats getLockStats() const { return mapLock.getStats(); }
+    void resetLockStats() { mapLock.resetStats(); }
 
 public:
     void scheduleAction(const std::shared_ptr<MapAction> &action) final;
+    void readLocked(const std::function<void()> &callback) final;
 
 public slots:
     // looking for rooms leads to a bunch of foundRoom() signals
@@ -103,6 +149,7 @@ public slots:
     void lookingForRooms(RoomRecipient &,
                          const Coordinate &,
                          const Coordinate &); // by bounding box
+    void lookingForRooms(RoomRecipient &, const Coordinate &, int); // by distance, nearest first
 
     // createRoom creates a room without a lock
     // it will get deleted if no one looks for it for a certain time
@@ -18,7 +18,7 @@
 #define DEBUG_ONLY(x) static_cast<void>(42)
 #endif
 
-#define DEBUG_LOCK() DEBUG_ONLY(assert(!m_inUse); MAYBE_UNUSED const RAIIBool useLock{m_inUse})
+#define DEBUG_LOCK() DEBUG_ONLY(assert(m_visitors.load() == 0))
 
 void RoomCollection::addRoom(Room *const room)
 {
@@ -50,8 +50,11 @@ void RoomCollection::clear()
 
 void RoomCollection::forEach(AbstractRoomVisitor &stream) const
 {
-    DEBUG_LOCK();
+    DEBUG_ONLY(++m_visitors;
+               MAYBE_UNUSED const RAIICallback leave{[this]() { --m_visitors; }});
+    RoomVisitorBatcher batcher{stream};
     for (const std::shared_ptr<Room> &room : m_rooms) {
-        stream.visit(room.get());
+        batcher.add(room.get());
     }
+    batcher.flush();
 }
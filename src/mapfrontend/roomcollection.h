@@ -4,6 +4,7 @@
 // Author: Ulf Hermann <ulfonk_mennhar@gmx.de> (Alve)
 // Author: Marek Krejza <krejza@gmail.com> (Caligor)
 
+#include <atomic>
 #include <cassert>
 #include <memory>
 #include <set>
@@ -19,7 +20,9 @@ class RoomCollection final
 private:
     using RoomSet = std::set<std::shared_ptr<Room>>;
     RoomSet m_rooms;
-    mutable bool m_inUse = false;
+    // Visits in progress; several readers may visit at once, but nothing may
+    // change the collection meanwhile (only checked in debug builds).
+    mutable std::atomic<int> m_visitors{0};
 
 public:
     void addRoom(Room *room);
@@ -34,6 +37,6 @@ class RoomCollection final
 
 public:
     /* NOTE: It's not safe for the stream to modify this
-     * collection during this function call. */
+     * collection during this function call. Concurrent calls are fine. */
     void forEach(AbstractRoomVisitor &stream) const;
 };
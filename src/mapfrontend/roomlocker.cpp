@@ -5,6 +5,9 @@
 
 #include "roomlocker.h"
 
+#include <algorithm>
+#include <array>
+
 #include "../expandoracommon/RoomRecipient.h"
 #include "../expandoracommon/room.h"
 #include "mapfrontend.h"
@@ -19,13 +22,41 @@ RoomLocker::RoomLocker(RoomRecipient &forward,
 
 RoomLocker::~RoomLocker() = default;
 
+NODISCARD static bool isWanted(const Room *const room, const ParseEvent *const comparator)
+{
+    return comparator == nullptr
+           || Room::compareWeakProps(room, *comparator) != ComparisonResultEnum::DIFFERENT;
+}
+
 void RoomLocker::visit(const Room *room)
 {
-    if (comparator == nullptr) {
-        data.lockRoom(&recipient, room->getId());
-        recipient.receiveRoom(&data, room);
-    } else if (Room::compareWeakProps(room, *comparator) != ComparisonResultEnum::DIFFERENT) {
+    if (isWanted(room, comparator)) {
         data.lockRoom(&recipient, room->getId());
         recipient.receiveRoom(&data, room);
     }
 }
+
+void RoomLocker::visitBatch(const RoomSpan rooms)
+{
+    // Everything in the run is locked before the recipient sees any of it: releasing
+    // one room can run the actions queued for it, which mustn't remove the others.
+    std::array<bool, 256> wanted{};
+    std::array<RoomId, 256> ids{};
+    for (size_t first = 0; first < rooms.size(); first += wanted.size()) {
+        const size_t last = std::min(rooms.size(), first + wanted.size());
+        size_t numIds = 0;
+        for (size_t i = first; i < last; ++i) {
+            const Room *const room = rooms[i];
+            wanted[i - first] = isWanted(room, comparator);
+            if (wanted[i - first]) {
+                ids[numIds++] = room->getId();
+            }
+        }
+        data.lockRooms(&recipient, ids.data(), numIds);
+        for (size_t i = first; i < last; ++i) {
+            if (wanted[i - first]) {
+                recipient.receiveRoom(&data, rooms[i]);
+            }
+        }
+    }
+}
@@ -18,6 +18,7 @@ class RoomLocker final : public AbstractRoomVisitor
                         MapFrontend &frontend,
                         const ParseEvent *compare = nullptr);
     void visit(const Room *room) override;
+    void visitBatch(RoomSpan rooms) override;
     ~RoomLocker() override;
 
 private:
@@ -0,0 +1,99 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "BackgroundMapSaver.h"
+
+#include <cassert>
+#include <exception>
+#include <utility>
+
+#include "../global/EventTrace.h"
+#include "../global/PerfCounters.h"
+#include "../global/utils.h"
+
+BackgroundMapSaver::BackgroundMapSaver(QObject *const parent)
+    : QObject(parent)
+{}
+
+BackgroundMapSaver::~BackgroundMapSaver()
+{
+    MAYBE_UNUSED const auto ignored = wait();
+}
+
+void BackgroundMapSaver::start(std::unique_ptr<FileSaver> saver,
+                               QString fileName,
+                               MapSaveData data)
+{
+    run(std::move(saver),
+        std::move(fileName),
+        false,
+        "MapStorage::save",
+        [data = std::move(data)](QIODevice &device,
+                                 ProgressCounter &progressCounter,
+                                 const std::function<void(const QString &)> &log) {
+            perf_counters::ScopedTimer timer{PerfHistogramEnum::MAP_SAVE};
+            perf_counters::add(PerfCounterEnum::MAP_SAVES);
+            return MapStorage::writeData(device, data, progressCounter, log);
+        });
+}
+
+void BackgroundMapSaver::startExport(std::unique_ptr<FileSaver> saver,
+                                     QString fileName,
+                                     Writer writer)
+{
+    run(std::move(saver), std::move(fileName), true, "MapStorage::export", std::move(writer));
+}
+
+void BackgroundMapSaver::run(std::unique_ptr<FileSaver> saver,
+                             QString fileName,
+                             const bool isExport,
+                             const char *const traceName,
+                             Writer writer)
+{
+    assert(!isRunning());
+    m_thread = std::thread([this,
+                            saver = std::move(saver),
+                            fileName = std::move(fileName),
+                            isExport,
+                            traceName,
+                            writer = std::move(writer)]() {
+        event_trace::Scope scope{traceName};
+        Result result;
+        result.fileName = fileName;
+        result.isExport = isExport;
+        const auto log = [this](const QString &msg) { emit sig_log("MapStorage", msg); };
+        try {
+            log("Writing data to file in the background ...");
+            result.ok = writer(deref(saver).file(), m_progressCounter, log);
+            if (result.ok) {
+                saver->close();
+                log("Writing data finished.");
+            } else {
+                result.error = saver->file().errorString();
+                log("Writing data failed.");
+            }
+        } catch (const std::exception &ex) {
+            result.ok = false;
+            result.error = QString::fromUtf8(ex.what());
+        }
+        if (!result.ok) {
+            // Leave the previous file alone.
+            saver->discard();
+        }
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            m_result = std::move(result);
+        }
+        emit sig_finished();
+    });
+}
+
+std::optional<BackgroundMapSaver::Result> BackgroundMapSaver::wait()
+{
+    if (!isRunning()) {
+        return std::nullopt;
+    }
+    m_thread.join();
+    std::lock_guard<std::mutex> lock{m_mutex};
+    return std::exchange(m_result, std::nullopt);
+}
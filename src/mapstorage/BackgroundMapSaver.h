@@ -0,0 +1,83 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <QObject>
+#include <QString>
+#include <QtCore>
+
+#include "../global/RuleOf5.h"
+#include "../global/macros.h"
+#include "filesaver.h"
+#include "mapstorage.h"
+#include "progresscounter.h"
+
+/**
+ * Writes a full .mm2 map on a worker thread, from the MapSaveData taken by
+ * MapStorage::prepareSave(), so that mapping goes on while the file is
+ * written. Exports for other mappers run the same way, from a snapshot. The
+ * file is only committed (renamed into place by FileSaver) once all of it has
+ * been written.
+ *
+ * Progress is reported through getProgressCounter(), whose signals are
+ * emitted from the worker thread; connect to them with queued connections.
+ * Only one save runs at a time.
+ */
+class BackgroundMapSaver final : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct NODISCARD Result final
+    {
+        QString fileName;
+        bool ok = false;
+        QString error;
+        // Exports don't change which file the map is saved to.
+        bool isExport = false;
+    };
+    using Writer = std::function<bool(QIODevice &device,
+                                      ProgressCounter &progressCounter,
+                                      const std::function<void(const QString &)> &log)>;
+
+private:
+    ProgressCounter m_progressCounter;
+    std::thread m_thread;
+    // Set by the worker thread when it's done.
+    std::mutex m_mutex;
+    std::optional<Result> m_result;
+
+public:
+    explicit BackgroundMapSaver(QObject *parent);
+    ~BackgroundMapSaver() final;
+    DELETE_CTORS_AND_ASSIGN_OPS(BackgroundMapSaver);
+
+public:
+    NODISCARD ProgressCounter &getProgressCounter() { return m_progressCounter; }
+    NODISCARD bool isRunning() const { return m_thread.joinable(); }
+
+    // Takes an open FileSaver; the previous save must have been waited for.
+    void start(std::unique_ptr<FileSaver> saver, QString fileName, MapSaveData data);
+    // Same, for an export; the writer must only read data it owns.
+    void startExport(std::unique_ptr<FileSaver> saver, QString fileName, Writer writer);
+    // Blocks until the running save is done and returns its result, or
+    // nullopt if there was nothing to wait for.
+    NODISCARD std::optional<Result> wait();
+
+private:
+    void run(std::unique_ptr<FileSaver> saver,
+             QString fileName,
+             bool isExport,
+             const char *traceName,
+             Writer writer);
+
+signals:
+    void sig_log(const QString &, const QString &);
+    // Emitted from the worker thread; call wait() to collect the result.
+    void sig_finished();
+};
@@ -0,0 +1,168 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "BufferedXmlWriter.h"
+
+#include <cassert>
+#include <cstdint>
+#include <string>
+#include <QIODevice>
+
+// The buffer is handed to the device once it's this big.
+static constexpr const size_t FLUSH_SIZE = 1u << 16;
+static constexpr const size_t INDENT = 4;
+
+BufferedXmlWriter::BufferedXmlWriter(QIODevice &device)
+    : m_device{device}
+{
+    m_buffer.reserve(FLUSH_SIZE + FLUSH_SIZE / 4);
+}
+
+BufferedXmlWriter::~BufferedXmlWriter() = default;
+
+std::string BufferedXmlWriter::escape(const std::string_view latin1)
+{
+    std::string result;
+    result.reserve(latin1.size());
+    for (const char c : latin1) {
+        const auto u = static_cast<uint8_t>(c);
+        switch (c) {
+        case '&':
+            result += "&amp;";
+            break;
+        case '<':
+            result += "&lt;";
+            break;
+        case '>':
+            result += "&gt;";
+            break;
+        case '"':
+            result += "&quot;";
+            break;
+        case '\t':
+            result += "&#9;";
+            break;
+        case '\n':
+            result += "&#10;";
+            break;
+        case '\r':
+            result += "&#13;";
+            break;
+        default:
+            if (u < 0x20u) {
+                // Not allowed in XML 1.0.
+            } else if (u < 0x80u) {
+                result += c;
+            } else {
+                result += static_cast<char>(0xC0u | (u >> 6u));
+                result += static_cast<char>(0x80u | (u & 0x3Fu));
+            }
+            break;
+        }
+    }
+    return result;
+}
+
+void BufferedXmlWriter::writeStartDocument()
+{
+    m_buffer += "<?xml version=\"1.0\" encoding=\"UTF-8\"?>";
+}
+
+void BufferedXmlWriter::closeStartTag()
+{
+    if (m_inStartTag) {
+        m_buffer += '>';
+        m_inStartTag = false;
+    }
+}
+
+void BufferedXmlWriter::newLine()
+{
+    m_buffer += '\n';
+    m_buffer.append(m_open.size() * INDENT, ' ');
+}
+
+void BufferedXmlWriter::writeStartElement(const char *const name)
+{
+    closeStartTag();
+    if (!m_open.empty()) {
+        m_open.back().hasChildren = true;
+    }
+    newLine();
+    m_buffer += '<';
+    m_buffer += name;
+    m_open.emplace_back(OpenElement{name, false});
+    m_inStartTag = true;
+}
+
+void BufferedXmlWriter::writeEndElement()
+{
+    assert(!m_open.empty());
+    if (m_open.empty())
+        return;
+
+    const OpenElement element = m_open.back();
+    m_open.pop_back();
+    if (m_inStartTag) {
+        m_buffer += "/>";
+        m_inStartTag = false;
+    } else {
+        if (element.hasChildren) {
+            newLine();
+        }
+        m_buffer += "</";
+        m_buffer += element.name;
+        m_buffer += '>';
+    }
+    flushIfFull();
+}
+
+void BufferedXmlWriter::writeEscapedAttribute(const char *const name,
+                                              const std::string_view escaped)
+{
+    assert(m_inStartTag);
+    m_buffer += ' ';
+    m_buffer += name;
+    m_buffer += "=\"";
+    m_buffer += escaped;
+    m_buffer += '"';
+}
+
+void BufferedXmlWriter::writeAttribute(const char *const name, const std::string_view latin1)
+{
+    writeEscapedAttribute(name, escape(latin1));
+}
+
+void BufferedXmlWriter::writeAttribute(const char *const name, const int64_t value)
+{
+    writeEscapedAttribute(name, std::to_string(value));
+}
+
+void BufferedXmlWriter::flushIfFull()
+{
+    if (m_buffer.size() >= FLUSH_SIZE) {
+        flush();
+    }
+}
+
+void BufferedXmlWriter::flush()
+{
+    if (m_buffer.empty())
+        return;
+    const auto size = static_cast<qint64>(m_buffer.size());
+    if (!m_failed && m_device.write(m_buffer.data(), size) != size) {
+        m_failed = true;
+    }
+    m_bytesWritten += m_buffer.size();
+    m_buffer.clear();
+}
+
+bool BufferedXmlWriter::finish()
+{
+    while (!m_open.empty()) {
+        writeEndElement();
+    }
+    m_buffer += '\n';
+    flush();
+    return !m_failed;
+}
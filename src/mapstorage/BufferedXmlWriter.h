@@ -0,0 +1,68 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../global/RuleOf5.h"
+#include "../global/macros.h"
+
+class QIODevice;
+
+/**
+ * Writes indented XML like QXmlStreamWriter with auto-formatting, but into a
+ * byte buffer that is only handed to the device in large chunks, and with
+ * attribute values that callers can escape once and reuse.
+ *
+ * Text is Latin1 (as in TaggedString) and is written as UTF-8. Only
+ * elements and attributes are supported, which is all the exports need.
+ */
+class NODISCARD BufferedXmlWriter final
+{
+private:
+    struct NODISCARD OpenElement final
+    {
+        const char *name = nullptr;
+        bool hasChildren = false;
+    };
+
+    QIODevice &m_device;
+    std::string m_buffer;
+    std::vector<OpenElement> m_open;
+    bool m_inStartTag = false;
+    bool m_failed = false;
+    uint64_t m_bytesWritten = 0;
+
+public:
+    explicit BufferedXmlWriter(QIODevice &device);
+    ~BufferedXmlWriter();
+    DELETE_CTORS_AND_ASSIGN_OPS(BufferedXmlWriter);
+
+public:
+    // Escapes a Latin1 string for writeEscapedAttribute().
+    NODISCARD static std::string escape(std::string_view latin1);
+
+public:
+    void writeStartDocument();
+    // The name must outlive the element; string literals are expected.
+    void writeStartElement(const char *name);
+    void writeEndElement();
+    void writeAttribute(const char *name, std::string_view latin1);
+    void writeAttribute(const char *name, int64_t value);
+    void writeEscapedAttribute(const char *name, std::string_view escaped);
+
+    // Closes any open elements and writes out the rest of the buffer;
+    // returns false if any write to the device failed.
+    NODISCARD bool finish();
+    NODISCARD uint64_t getBytesWritten() const { return m_bytesWritten + m_buffer.size(); }
+
+private:
+    void closeStartTag();
+    void newLine();
+    void flushIfFull();
+    void flush();
+};
@@ -0,0 +1,24 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "LoadedRoom.h"
+
+#include <utility>
+
+SharedRoom createRoom(RoomModificationTracker &tracker, LoadedRoom &&loaded)
+{
+    const SharedRoom room = Room::createPermanentRoom(tracker);
+#define SET_FIELD(_Type, _Prop, _OptInit) room->set##_Prop(std::move(loaded._Prop));
+    XFOREACH_ROOM_PROPERTY(SET_FIELD)
+#undef SET_FIELD
+    if (loaded.textBlock != nullptr) {
+        room->setLazyText(std::move(loaded.textBlock), loaded.textIndex);
+    }
+    room->setId(loaded.id);
+    if (loaded.upToDate) {
+        room->setUpToDate();
+    }
+    room->setPosition(loaded.position);
+    room->setExitsList(loaded.exits);
+    return room;
+}
@@ -0,0 +1,32 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <cstdint>
+#include <memory>
+
+#include "../expandoracommon/RoomTextBlock.h"
+#include "../expandoracommon/coordinate.h"
+#include "../expandoracommon/room.h"
+#include "../global/macros.h"
+#include "../global/roomid.h"
+
+// A room as it was read from a file, before it becomes a Room. Filling one in
+// doesn't touch the map, so loaders can do it on any thread, and every field
+// is then set when the Room is created.
+struct NODISCARD LoadedRoom final
+{
+#define DECL_FIELD(_Type, _Prop, _OptInit) _Type _Prop{_OptInit};
+    XFOREACH_ROOM_PROPERTY(DECL_FIELD)
+#undef DECL_FIELD
+    ExitsList exits;
+    Coordinate position;
+    RoomId id = INVALID_ROOMID;
+    bool upToDate = false;
+    // If set, Description and Contents are left empty and read from here instead.
+    std::shared_ptr<const RoomTextBlock> textBlock;
+    uint32_t textIndex = 0;
+};
+
+// Must be called on the thread that owns the tracker.
+NODISCARD extern SharedRoom createRoom(RoomModificationTracker &tracker, LoadedRoom &&loaded);
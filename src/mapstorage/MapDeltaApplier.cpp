@@ -0,0 +1,135 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "MapDeltaApplier.h"
+
+#include <memory>
+#include <unordered_set>
+#include <utility>
+
+#include "../expandoracommon/exit.h"
+#include "../expandoracommon/room.h"
+#include "../global/roomid.h"
+#include "../global/utils.h"
+#include "../mapdata/ExitDirection.h"
+#include "../mapdata/MapTransaction.h"
+#include "../mapdata/customaction.h"
+#include "../mapdata/mapdata.h"
+#include "mapstorage.h"
+
+MapDeltaApplier::MapDeltaApplier(MapData &mapData)
+    : m_mapData{mapData}
+{}
+
+MapDeltaApplier::~MapDeltaApplier() = default;
+
+DeltaSummary MapDeltaApplier::apply(std::vector<LoadedRoom> rooms)
+{
+    DeltaSummary summary;
+    const SharedMapSnapshot snapshot = m_mapData.getSnapshot();
+
+    // The rooms that are accepted, with where they are and the exits they should have.
+    struct NODISCARD Accepted final
+    {
+        RoomId id;
+        Coordinate position;
+        ExitsList exits;
+    };
+    std::vector<Accepted> accepted;
+    std::vector<LoadedRoom> newRooms;
+    std::unordered_set<RoomId> newIds;
+    // Ids that are known to mean the same room on both maps.
+    std::unordered_set<RoomId> verifiedIds;
+    // Ids of rooms in the delta that mean a different room here.
+    std::unordered_set<RoomId> conflictingIds;
+    for (LoadedRoom &room : rooms) {
+        if (const Room *const existing = snapshot->getRoom(room.id)) {
+            if (existing->getPosition() != room.position || existing->getName() != room.Name) {
+                ++summary.conflicts;
+                conflictingIds.emplace(room.id);
+                continue;
+            }
+            accepted.push_back(Accepted{room.id, room.position, room.exits});
+            verifiedIds.emplace(room.id);
+            continue;
+        }
+        if (m_mapData.getRoom(room.position) != nullptr || !newIds.emplace(room.id).second) {
+            ++summary.conflicts;
+            conflictingIds.emplace(room.id);
+            continue;
+        }
+        accepted.push_back(Accepted{room.id, room.position, room.exits});
+        verifiedIds.emplace(room.id);
+        // Connections are only made by the transaction, once both ends exist.
+        for (const ExitDirEnum dir : ALL_EXITS7) {
+            Exit &e = room.exits[dir];
+            for (const RoomId to : e.outClone()) {
+                e.removeOut(to);
+            }
+            for (const RoomId from : e.inClone()) {
+                e.removeIn(from);
+            }
+        }
+        newRooms.emplace_back(std::move(room));
+    }
+
+    // A target that wasn't in the delta is only the same room here if it's where
+    // the exit leads; otherwise its id may belong to an unrelated room.
+    enum class NODISCARD TargetEnum { MISSING, CONFLICT, OK };
+    const auto checkTarget = [&verifiedIds, &conflictingIds, &snapshot](const Coordinate &from,
+                                                                        const ExitDirEnum dir,
+                                                                        const RoomId to) {
+        if (verifiedIds.count(to) != 0)
+            return TargetEnum::OK;
+        if (conflictingIds.count(to) != 0)
+            return TargetEnum::CONFLICT;
+        const Room *const target = snapshot->getRoom(to);
+        if (target == nullptr)
+            return TargetEnum::MISSING;
+        if (dir == ExitDirEnum::UNKNOWN || target->getPosition() != from + Room::exitDir(dir))
+            return TargetEnum::CONFLICT;
+        return TargetEnum::OK;
+    };
+
+    MapTransaction transaction;
+    for (const Accepted &room : accepted) {
+        const RoomId id = room.id;
+        const Room *const existing = snapshot->getRoom(id);
+        bool changed = false;
+        for (const ExitDirEnum dir : ALL_EXITS7) {
+            for (const RoomId to : room.exits[dir].outRange()) {
+                if (existing != nullptr && existing->exit(dir).containsOut(to))
+                    continue;
+                const TargetEnum target = checkTarget(room.position, dir, to);
+                if (target == TargetEnum::CONFLICT)
+                    ++summary.conflicts;
+                if (target != TargetEnum::OK)
+                    continue;
+                transaction.add(std::make_shared<AddOneWayExit>(id, to, dir));
+                ++summary.addedExits;
+                changed = true;
+            }
+        }
+        if (existing != nullptr && changed) {
+            ++summary.updatedRooms;
+        }
+    }
+    summary.newRooms = newRooms.size();
+
+    m_mapData.applySharedChanges([this, &newRooms, &transaction]() {
+        if (!newRooms.empty()) {
+            {
+                MapFrontendBlocker blocker{m_mapData};
+                for (LoadedRoom &room : newRooms) {
+                    const Coordinate position = room.position;
+                    m_mapData.insertPredefinedRoom(createRoom(m_mapData, std::move(room)));
+                    m_mapData.markMeshDirty(position);
+                }
+            }
+            m_mapData.checkSize();
+            m_mapData.setDataChanged();
+        }
+        m_mapData.execute(std::move(transaction));
+    });
+    return summary;
+}
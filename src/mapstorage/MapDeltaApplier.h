@@ -0,0 +1,52 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <cstddef>
+#include <vector>
+
+#include "../global/RuleOf5.h"
+#include "../global/macros.h"
+#include "LoadedRoom.h"
+
+class MapData;
+
+struct NODISCARD DeltaSummary final
+{
+    size_t newRooms = 0;
+    // Rooms that were already in the map and gained exits.
+    size_t updatedRooms = 0;
+    size_t addedExits = 0;
+    // Rooms whose id or position belongs to a different room here, and exits
+    // to rooms that can't be shown to be the same here.
+    size_t conflicts = 0;
+};
+
+/**
+ * Applies the rooms another member of the group shared (see
+ * MapStorage::saveDelta()) to the map.
+ *
+ * Ids are only trusted as far as the map agrees with them: a room is new if
+ * neither its id nor its position is used yet, and it's the same room if
+ * the one with its id has the same name and position. Anything else is a
+ * conflict, and the room is skipped. An exit's target has to be one of the
+ * accepted rooms, or the room here with its id has to be where the exit
+ * leads; an exit to anything else is a conflict too. Rooms never lose
+ * anything; the exits the map doesn't have yet are added, as one
+ * MapTransaction, and the changes aren't shared back.
+ *
+ * Must be used on the thread that owns the map.
+ */
+class NODISCARD MapDeltaApplier final
+{
+private:
+    MapData &m_mapData;
+
+public:
+    explicit MapDeltaApplier(MapData &mapData);
+    ~MapDeltaApplier();
+    DELETE_CTORS_AND_ASSIGN_OPS(MapDeltaApplier);
+
+public:
+    NODISCARD DeltaSummary apply(std::vector<LoadedRoom> rooms);
+};
@@ -0,0 +1,163 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "MapJournal.h"
+
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+
+#include "../global/TextUtils.h"
+#include "../global/io.h"
+
+static constexpr const quint32 JOURNAL_MAGIC = 0xFFB2AF4Au;
+static constexpr const quint32 JOURNAL_VERSION = 1;
+static const char *const JOURNAL_SUFFIX = ".journal";
+
+namespace { // anonymous
+
+// Identifies the map file a journal was started for.
+struct NODISCARD Stamp final
+{
+    qint64 size = 0;
+    qint64 modified = 0;
+
+    NODISCARD bool operator==(const Stamp &other) const
+    {
+        return size == other.size && modified == other.modified;
+    }
+};
+
+struct NODISCARD Contents final
+{
+    std::vector<QByteArray> records;
+    // Where the last complete record ends.
+    qint64 end = 0;
+};
+
+} // namespace
+
+NODISCARD static std::optional<Stamp> getStamp(const QString &mapFileName)
+{
+    const QFileInfo info{mapFileName};
+    if (!info.exists()) {
+        return std::nullopt;
+    }
+    return Stamp{info.size(), info.lastModified().toMSecsSinceEpoch()};
+}
+
+// The records of a journal opened for reading, or nullopt if it isn't one
+// for the map as it is on disk now.
+NODISCARD static std::optional<Contents> scan(QFile &file, const QString &mapFileName)
+{
+    const std::optional<Stamp> stamp = getStamp(mapFileName);
+    if (!stamp.has_value()) {
+        return std::nullopt;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_4_8);
+    quint32 magic = 0;
+    quint32 version = 0;
+    Stamp journalStamp;
+    stream >> magic >> version >> journalStamp.size >> journalStamp.modified;
+    if (stream.status() != QDataStream::Ok || magic != JOURNAL_MAGIC
+        || version != JOURNAL_VERSION || !(journalStamp == stamp.value())) {
+        return std::nullopt;
+    }
+
+    Contents result;
+    result.end = file.pos();
+    while (true) {
+        quint32 size = 0;
+        quint16 checksum = 0;
+        stream >> size >> checksum;
+        if (stream.status() != QDataStream::Ok || size > file.size() - file.pos()) {
+            break;
+        }
+        QByteArray record(static_cast<int>(size), Qt::Uninitialized);
+        if (stream.readRawData(record.data(), record.size()) != record.size()
+            || qChecksum(record.constData(), size) != checksum) {
+            break;
+        }
+        result.records.emplace_back(std::move(record));
+        result.end = file.pos();
+    }
+    return result;
+}
+
+namespace MapJournal {
+
+QString getFileName(const QString &mapFileName)
+{
+    return mapFileName + JOURNAL_SUFFIX;
+}
+
+qint64 getSize(const QString &mapFileName)
+{
+    QFile file{getFileName(mapFileName)};
+    if (!file.open(QFile::ReadOnly)) {
+        return 0;
+    }
+    const std::optional<Contents> contents = scan(file, mapFileName);
+    return contents.has_value() ? contents->end : 0;
+}
+
+void append(const QString &mapFileName, const QByteArray &record) noexcept(false)
+{
+    const std::optional<Stamp> stamp = getStamp(mapFileName);
+    if (!stamp.has_value()) {
+        throw std::runtime_error("the map has not been saved yet");
+    }
+
+    QFile file{getFileName(mapFileName)};
+    std::optional<Contents> contents;
+    if (file.open(QFile::ReadOnly)) {
+        contents = scan(file, mapFileName);
+        file.close();
+    }
+    if (!file.open(contents.has_value() ? QFile::ReadWrite : (QFile::WriteOnly | QFile::Truncate))) {
+        throw std::runtime_error(::toStdStringUtf8(file.errorString()));
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_4_8);
+    if (contents.has_value()) {
+        // Drops whatever is left of a record that was cut short.
+        if (!file.resize(contents->end) || !file.seek(contents->end)) {
+            throw std::runtime_error(::toStdStringUtf8(file.errorString()));
+        }
+    } else {
+        stream << JOURNAL_MAGIC << JOURNAL_VERSION << stamp->size << stamp->modified;
+    }
+
+    const auto size = static_cast<quint32>(record.size());
+    stream << size << qChecksum(record.constData(), size);
+    if (stream.writeRawData(record.constData(), record.size()) != record.size()
+        || stream.status() != QDataStream::Ok || !file.flush()) {
+        throw std::runtime_error(::toStdStringUtf8(file.errorString()));
+    }
+    MAYBE_UNUSED const auto ignored = ::io::fsync(file);
+    file.close();
+}
+
+std::vector<QByteArray> read(const QString &mapFileName)
+{
+    QFile file{getFileName(mapFileName)};
+    if (!file.open(QFile::ReadOnly)) {
+        return {};
+    }
+    std::optional<Contents> contents = scan(file, mapFileName);
+    return contents.has_value() ? std::move(contents->records) : std::vector<QByteArray>{};
+}
+
+void remove(const QString &mapFileName)
+{
+    QFile::remove(getFileName(mapFileName));
+}
+
+} // namespace MapJournal
@@ -0,0 +1,35 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <vector>
+#include <QByteArray>
+#include <QString>
+#include <QtGlobal>
+
+#include "../global/macros.h"
+
+// An append-only side file next to a .mm2 map, holding the changes that were
+// saved since the map was last written in full. Each record is opaque here;
+// MapStorage decides what goes in it.
+//
+// The journal remembers the size and modification time of the map it was
+// started for, so a journal left behind by an interrupted full save is
+// recognised as stale and ignored.
+namespace MapJournal {
+NODISCARD extern QString getFileName(const QString &mapFileName);
+// Bytes in the journal of the map, or 0 if it has none that applies.
+NODISCARD extern qint64 getSize(const QString &mapFileName);
+
+// Appends a record and flushes it to disk, starting a new journal if the map
+// doesn't have one that applies to it as it is on disk now.
+/*! \exception std::runtime_error if the journal can't be written.
+ */
+extern void append(const QString &mapFileName, const QByteArray &record) noexcept(false);
+
+// Every complete record of the journal of the map, oldest first; a record
+// that was cut short (e.g. by a crash) ends the journal.
+NODISCARD extern std::vector<QByteArray> read(const QString &mapFileName);
+
+extern void remove(const QString &mapFileName);
+} // namespace MapJournal
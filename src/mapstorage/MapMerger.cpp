@@ -0,0 +1,238 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "MapMerger.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+
+#include "../expandoracommon/RoomFingerprint.h"
+#include "../expandoracommon/RoomTextBlock.h"
+#include "../expandoracommon/exit.h"
+#include "../expandoracommon/room.h"
+#include "../global/parallel.h"
+#include "../global/roomid.h"
+#include "../global/utils.h"
+#include "../mapdata/ExitDirection.h"
+#include "../mapdata/MapTransaction.h"
+#include "../mapdata/customaction.h"
+#include "../mapdata/mapdata.h"
+
+namespace { // anonymous
+
+struct NODISCARD MergeKey final
+{
+    RoomFingerprint fingerprint;
+    // An exit bit and a door bit for each of NESWUD.
+    uint32_t exits = 0;
+    // Rooms without a name are never matched.
+    bool valid = false;
+
+    NODISCARD bool operator==(const MergeKey &rhs) const
+    {
+        return fingerprint.name == rhs.fingerprint.name && fingerprint.desc == rhs.fingerprint.desc
+               && exits == rhs.exits;
+    }
+};
+
+struct NODISCARD MergeKeyHash final
+{
+    NODISCARD size_t operator()(const MergeKey &key) const
+    {
+        const uint64_t h = key.fingerprint.name ^ (key.fingerprint.desc * 0x9E3779B97F4A7C15ull)
+                           ^ (static_cast<uint64_t>(key.exits) << 48u);
+        return static_cast<size_t>(h ^ (h >> 32u));
+    }
+};
+
+// INVALID_ROOMID if the key belongs to more than one room.
+using KeyIndex = std::unordered_map<MergeKey, RoomId, MergeKeyHash>;
+
+NODISCARD uint32_t getExitBits(const ExitsList &exits)
+{
+    uint32_t bits = 0;
+    for (const ExitDirEnum dir : ALL_EXITS_NESWUD) {
+        const Exit &e = exits[dir];
+        const auto i = static_cast<uint32_t>(dir);
+        if (e.isExit())
+            bits |= 1u << i;
+        if (e.isDoor())
+            bits |= 1u << (i + 8u);
+    }
+    return bits;
+}
+
+NODISCARD MergeKey getKey(const RoomName &name, const RoomDesc &desc, const ExitsList &exits)
+{
+    MergeKey key;
+    key.valid = !name.isEmpty();
+    if (key.valid) {
+        key.fingerprint = RoomFingerprint::compute(name, desc);
+        key.exits = getExitBits(exits);
+    }
+    return key;
+}
+
+NODISCARD RoomDesc getDescription(const LoadedRoom &room)
+{
+    if (room.textBlock == nullptr)
+        return room.Description;
+    const RoomTextBlock::SharedTexts texts = room.textBlock->inflate();
+    return deref(texts).at(room.textIndex).description;
+}
+
+void addKey(KeyIndex &index, const MergeKey &key, const RoomId id)
+{
+    if (!key.valid)
+        return;
+    const auto [it, inserted] = index.emplace(key, id);
+    if (!inserted)
+        it->second = INVALID_ROOMID;
+}
+
+using Offset = std::tuple<int, int, int>;
+
+NODISCARD Offset toOffset(const Coordinate &c)
+{
+    return Offset{c.x, c.y, c.z};
+}
+
+} // namespace
+
+MapMerger::MapMerger(MapData &mapData)
+    : m_mapData{mapData}
+{}
+
+MapMerger::~MapMerger() = default;
+
+MergeSummary MapMerger::apply()
+{
+    MergeSummary summary;
+    const SharedMapSnapshot snapshot = m_mapData.getSnapshot();
+
+    // Both maps are read without touching anything, so the keys are
+    // computed in parallel; lazy descriptions are inflated here.
+    std::vector<const Room *> oldRooms;
+    deref(snapshot).forEachRoom([&oldRooms](const Room &room) { oldRooms.emplace_back(&room); });
+    std::vector<MergeKey> oldKeys(oldRooms.size());
+    parallelFor(oldRooms.size(), [&oldRooms, &oldKeys](const size_t i) {
+        const Room &room = deref(oldRooms[i]);
+        oldKeys[i] = getKey(room.getName(), room.readDescription(), room.getExitsList());
+    });
+    std::vector<MergeKey> newKeys(m_rooms.size());
+    parallelFor(m_rooms.size(), [this, &newKeys](const size_t i) {
+        const LoadedRoom &room = m_rooms[i];
+        newKeys[i] = getKey(room.Name, getDescription(room), room.exits);
+    });
+
+    KeyIndex oldIndex;
+    oldIndex.reserve(oldRooms.size());
+    for (size_t i = 0; i < oldRooms.size(); ++i) {
+        addKey(oldIndex, oldKeys[i], oldRooms[i]->getId());
+    }
+    KeyIndex newIndex;
+    newIndex.reserve(m_rooms.size());
+    for (size_t i = 0; i < m_rooms.size(); ++i) {
+        addKey(newIndex, newKeys[i], m_rooms[i].id);
+    }
+
+    // Candidate matches, and the offset most of them agree on.
+    std::vector<RoomId> candidates(m_rooms.size(), INVALID_ROOMID);
+    std::map<Offset, size_t> votes;
+    for (size_t i = 0; i < m_rooms.size(); ++i) {
+        const MergeKey &key = newKeys[i];
+        if (!key.valid)
+            continue;
+        const auto oldIt = oldIndex.find(key);
+        if (oldIt == oldIndex.end())
+            continue;
+        if (oldIt->second == INVALID_ROOMID || newIndex.at(key) == INVALID_ROOMID) {
+            ++summary.ambiguousRooms;
+            continue;
+        }
+        candidates[i] = oldIt->second;
+        const Room &oldRoom = deref(snapshot->getRoom(oldIt->second));
+        ++votes[toOffset(oldRoom.getPosition() - m_rooms[i].position)];
+    }
+
+    std::optional<Offset> offset;
+    size_t bestVotes = 0;
+    for (const auto &[candidate, count] : votes) {
+        if (count > bestVotes) {
+            offset = candidate;
+            bestVotes = count;
+        }
+    }
+    if (offset.has_value()) {
+        const auto [x, y, z] = offset.value();
+        summary.offset = Coordinate{x, y, z};
+    }
+
+    std::unordered_map<RoomId, RoomId> matched;
+    for (size_t i = 0; i < m_rooms.size(); ++i) {
+        const RoomId oldId = candidates[i];
+        if (oldId == INVALID_ROOMID)
+            continue;
+        const Room &oldRoom = deref(snapshot->getRoom(oldId));
+        if (oldRoom.getPosition() - m_rooms[i].position == summary.offset) {
+            matched.emplace(m_rooms[i].id, oldId);
+        }
+    }
+    summary.matchedRooms = matched.size();
+
+    const auto remap = [&matched](const RoomId id) -> RoomId {
+        const auto it = matched.find(id);
+        return (it == matched.end()) ? id : it->second;
+    };
+
+    MapTransaction transaction;
+    for (LoadedRoom &room : m_rooms) {
+        if (const auto it = matched.find(room.id); it != matched.end()) {
+            // Only the exits the old room doesn't have yet.
+            const Room &oldRoom = deref(snapshot->getRoom(it->second));
+            for (const ExitDirEnum dir : ALL_EXITS7) {
+                for (const RoomId to : room.exits[dir].outRange()) {
+                    const RoomId target = remap(to);
+                    if (!oldRoom.exit(dir).containsOut(target)) {
+                        transaction.add(std::make_shared<AddOneWayExit>(it->second, target, dir));
+                        ++summary.addedExits;
+                    }
+                }
+            }
+            continue;
+        }
+
+        // The new room's outgoing exits are inserted with it, but the old
+        // rooms they lead to still need the matching incoming exits.
+        for (const ExitDirEnum dir : ALL_EXITS7) {
+            const Exit original = room.exits[dir];
+            Exit &e = room.exits[dir];
+            for (const RoomId to : original.outRange()) {
+                if (const RoomId target = remap(to); target != to) {
+                    e.removeOut(to);
+                    e.addOut(target);
+                    transaction.add(std::make_shared<AddOneWayExit>(room.id, target, dir));
+                    ++summary.addedExits;
+                }
+            }
+            for (const RoomId from : original.inRange()) {
+                if (const RoomId source = remap(from); source != from) {
+                    e.removeIn(from);
+                    e.addIn(source);
+                }
+            }
+        }
+        room.position += summary.offset;
+        m_mapData.insertPredefinedRoom(createRoom(m_mapData, std::move(room)));
+        ++summary.newRooms;
+    }
+    m_rooms = {};
+
+    m_mapData.execute(std::move(transaction));
+    return summary;
+}
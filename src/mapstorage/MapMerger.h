@@ -0,0 +1,59 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "../expandoracommon/coordinate.h"
+#include "../global/RuleOf5.h"
+#include "../global/macros.h"
+#include "LoadedRoom.h"
+
+class MapData;
+
+struct NODISCARD MergeSummary final
+{
+    // Rooms of the merged map that were already in the map, and weren't added.
+    size_t matchedRooms = 0;
+    size_t newRooms = 0;
+    // Rooms that looked like more than one room, so they were added as new.
+    size_t ambiguousRooms = 0;
+    // Exits added to or from rooms that were already in the map.
+    size_t addedExits = 0;
+    // Added to the positions of the new rooms, so they line up with the
+    // rooms they were matched with; zero if nothing matched.
+    Coordinate offset;
+};
+
+/**
+ * Merges the rooms of another map into the map, without duplicating the
+ * rooms that both of them have.
+ *
+ * Rooms are matched by their name, description (see RoomFingerprint) and
+ * which exits and doors they have, but only when that's unique in both
+ * maps; matches that don't agree with the offset most of them share are
+ * treated as new rooms. The new rooms are then inserted with their exits
+ * pointed at the rooms they matched, and the exits they add to the old
+ * rooms are applied as one MapTransaction.
+ *
+ * Must be used on the thread that owns the map, with its signals blocked.
+ */
+class NODISCARD MapMerger final
+{
+private:
+    MapData &m_mapData;
+    std::vector<LoadedRoom> m_rooms;
+
+public:
+    explicit MapMerger(MapData &mapData);
+    ~MapMerger();
+    DELETE_CTORS_AND_ASSIGN_OPS(MapMerger);
+
+public:
+    // The room's id and position must already be offset for the map (see
+    // MapStorage::readRoom()).
+    void add(LoadedRoom &&room) { m_rooms.emplace_back(std::move(room)); }
+    NODISCARD MergeSummary apply();
+};
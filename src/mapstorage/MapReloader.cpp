@@ -0,0 +1,386 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "MapReloader.h"
+
+#include <cassert>
+#include <exception>
+#include <memory>
+#include <utility>
+#include <QFile>
+
+#include "../expandoracommon/exit.h"
+#include "../expandoracommon/room.h"
+#include "../global/EventTrace.h"
+#include "../global/parallel.h"
+#include "../global/utils.h"
+#include "../mapdata/ExitDirection.h"
+#include "../mapdata/MapTransaction.h"
+#include "../mapdata/customaction.h"
+#include "../mapdata/mapdata.h"
+#include "../mapfrontend/map.h"
+#include "../mapfrontend/mapaction.h"
+#include "PandoraMapStorage.h"
+#include "XmlMapStorage.h"
+#include "abstractmapstorage.h"
+#include "mapstorage.h"
+
+namespace { // anonymous
+
+enum class NODISCARD RoomDiffEnum : uint8_t { SAME, CHANGED, NEW };
+
+NODISCARD bool hasSameContents(const Room &a, const Room &b)
+{
+    if (a.getPosition() != b.getPosition() || a.isUpToDate() != b.isUpToDate())
+        return false;
+#define COMPARE_FIELD(_Type, _Prop, _OptInit) \
+    if (!(a.read##_Prop() == b.read##_Prop())) \
+        return false;
+    XFOREACH_ROOM_PROPERTY(COMPARE_FIELD)
+#undef COMPARE_FIELD
+    // The incoming exits follow from the other rooms' outgoing ones.
+    for (const ExitDirEnum dir : ALL_EXITS7) {
+        const Exit &x = a.exit(dir);
+        const Exit &y = b.exit(dir);
+        if (x.getOutgoing() != y.getOutgoing())
+            return false;
+#define COMPARE_FIELD(_Type, _Prop, _OptInit) \
+    if (!(x.get##_Type() == y.get##_Type())) \
+        return false;
+        XFOREACH_EXIT_PROPERTY(COMPARE_FIELD)
+#undef COMPARE_FIELD
+    }
+    return true;
+}
+
+NODISCARD LoadedRoom toLoadedRoom(const Room &room)
+{
+    LoadedRoom loaded;
+#define COPY_FIELD(_Type, _Prop, _OptInit) loaded._Prop = room.read##_Prop();
+    XFOREACH_ROOM_PROPERTY(COPY_FIELD)
+#undef COPY_FIELD
+    loaded.exits = room.getExitsList();
+    loaded.position = room.getPosition();
+    loaded.id = room.getId();
+    loaded.upToDate = room.isUpToDate();
+    return loaded;
+}
+
+NODISCARD LoadedMark toLoadedMark(const InfoMark &mark)
+{
+    LoadedMark loaded;
+#define COPY_FIELD(_Type, _Prop, _OptInit) loaded._Prop = mark.get##_Prop();
+    X_FOREACH_INFOMARK_PROPERTY(COPY_FIELD)
+#undef COPY_FIELD
+    return loaded;
+}
+
+NODISCARD bool hasSameMarks(const std::vector<LoadedMark> &a, const std::vector<LoadedMark> &b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+#define COMPARE_FIELD(_Type, _Prop, _OptInit) \
+    if (!(a[i]._Prop == b[i]._Prop)) \
+        return false;
+        X_FOREACH_INFOMARK_PROPERTY(COMPARE_FIELD)
+#undef COMPARE_FIELD
+    }
+    return true;
+}
+
+// Takes a room that's about to move off the map's grid, so the room that
+// moves into its old place isn't pushed aside.
+class NODISCARD LiftRoom final : public AbstractAction
+{
+public:
+    void exec(const RoomId id) override
+    {
+        if (Room *const room = roomIndex(id)) {
+            if (map().get(room->getPosition()) == room)
+                map().remove(room->getPosition());
+        }
+    }
+};
+
+// Gives a room the contents it has in the file; its connections are changed
+// by separate exit actions.
+class NODISCARD ReplaceRoom final : public AbstractAction
+{
+private:
+    LoadedRoom m_loaded;
+
+public:
+    explicit ReplaceRoom(LoadedRoom &&loaded)
+        : m_loaded{std::move(loaded)}
+    {}
+
+public:
+    void exec(const RoomId id) override
+    {
+        Room *const room = roomIndex(id);
+        if (room == nullptr)
+            return;
+
+        // Only what differs, so the notifications only flag what changed.
+#define SET_FIELD(_Type, _Prop, _OptInit) \
+    if (!(room->read##_Prop() == m_loaded._Prop)) \
+        room->set##_Prop(m_loaded._Prop);
+        XFOREACH_ROOM_PROPERTY(SET_FIELD)
+#undef SET_FIELD
+        for (const ExitDirEnum dir : ALL_EXITS7) {
+            const Exit &e = m_loaded.exits[dir];
+#define SET_FIELD(_Type, _Prop, _OptInit) \
+    if (!(room->get##_Type(dir) == e.get##_Type())) \
+        room->set##_Type(dir, e.get##_Type());
+            XFOREACH_EXIT_PROPERTY(SET_FIELD)
+#undef SET_FIELD
+        }
+        if (m_loaded.upToDate != room->isUpToDate()) {
+            if (m_loaded.upToDate)
+                room->setUpToDate();
+            else
+                room->setOutDated();
+        }
+
+        const Coordinate &position = room->getPosition();
+        if (position != m_loaded.position || map().get(position) != room) {
+            if (map().get(position) == room)
+                map().remove(position);
+            map().setNearest(m_loaded.position, *room);
+        }
+    }
+};
+
+} // namespace
+
+MapReloader::MapReloader(MapData &mapData, QObject *const parent)
+    : QObject(parent)
+    , m_mapData{mapData}
+{}
+
+MapReloader::~MapReloader()
+{
+    MAYBE_UNUSED const auto ignored = wait();
+}
+
+void MapReloader::start(QString fileName)
+{
+    assert(!isRunning());
+    SharedMapSnapshot live = m_mapData.getSnapshot();
+    std::vector<LoadedMark> liveMarks;
+    liveMarks.reserve(m_mapData.getMarkersList().size());
+    for (const SharedInfoMark &mark : m_mapData.getMarkersList()) {
+        liveMarks.emplace_back(toLoadedMark(deref(mark)));
+    }
+    const uint64_t modificationCount = m_mapData.getModificationCount();
+
+    m_thread = std::thread([this,
+                            fileName = std::move(fileName),
+                            live = std::move(live),
+                            liveMarks = std::move(liveMarks),
+                            modificationCount]() {
+        event_trace::Scope scope{"MapReloader::load"};
+        const auto log = [this](const QString &msg) { emit sig_log("MapReloader", msg); };
+        MapDiff diff;
+        try {
+            diff = load(fileName, live, liveMarks, log);
+        } catch (const std::exception &ex) {
+            diff = MapDiff{};
+            diff.fileName = fileName;
+            diff.error = QString::fromUtf8(ex.what());
+        }
+        diff.modificationCount = modificationCount;
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            m_result = std::move(diff);
+        }
+        emit sig_finished();
+    });
+}
+
+std::optional<MapDiff> MapReloader::wait()
+{
+    if (!isRunning()) {
+        return std::nullopt;
+    }
+    m_thread.join();
+    std::lock_guard<std::mutex> lock{m_mutex};
+    return std::exchange(m_result, std::nullopt);
+}
+
+MapDiff MapReloader::load(const QString &fileName,
+                          const SharedMapSnapshot &live,
+                          const std::vector<LoadedMark> &liveMarks,
+                          const std::function<void(const QString &)> &log)
+{
+    MapDiff diff;
+    diff.fileName = fileName;
+
+    QFile file{fileName};
+    if (!file.open(QFile::ReadOnly)) {
+        diff.error = file.errorString();
+        return diff;
+    }
+
+    // Loaded the same way as MainWindow::loadFile(), into a map of its own.
+    MapData scratch{nullptr};
+    const auto storage = [&scratch, &fileName, &file]() -> std::unique_ptr<AbstractMapStorage> {
+        const QString fileNameLower = fileName.toLower();
+        if (fileNameLower.endsWith(".xml"))
+            return std::make_unique<PandoraMapStorage>(scratch, fileName, &file, nullptr);
+        if (fileNameLower.endsWith(".mm2xml"))
+            return std::make_unique<XmlMapStorage>(scratch, fileName, &file, nullptr);
+        return std::make_unique<MapStorage>(scratch, fileName, &file, nullptr);
+    }();
+    QObject::connect(storage.get(),
+                     &AbstractMapStorage::sig_log,
+                     [&log](const QString &, const QString &msg) { log(msg); });
+    if (!storage->canLoad() || !storage->loadData()) {
+        diff.error = "The file could not be loaded";
+        return diff;
+    }
+
+    // Its rooms live in the scratch map's arena, so it must go first.
+    const SharedMapSnapshot loaded = scratch.getSnapshot();
+    std::vector<const Room *> rooms;
+    rooms.reserve(deref(loaded).getRoomsCount());
+    loaded->forEachRoom([&rooms](const Room &room) { rooms.emplace_back(&room); });
+
+    // Comparing inflates the descriptions of both maps, so it runs in parallel.
+    std::vector<RoomDiffEnum> kinds(rooms.size(), RoomDiffEnum::SAME);
+    parallelFor(rooms.size(), [&rooms, &kinds, &live](const size_t i) {
+        const Room &room = deref(rooms[i]);
+        const Room *const old = live->getRoom(room.getId());
+        if (old == nullptr)
+            kinds[i] = RoomDiffEnum::NEW;
+        else if (!hasSameContents(*old, room))
+            kinds[i] = RoomDiffEnum::CHANGED;
+    });
+    for (size_t i = 0; i < rooms.size(); ++i) {
+        switch (kinds[i]) {
+        case RoomDiffEnum::SAME:
+            ++diff.unchangedRooms;
+            break;
+        case RoomDiffEnum::CHANGED:
+            diff.changedRooms.emplace_back(toLoadedRoom(deref(rooms[i])));
+            break;
+        case RoomDiffEnum::NEW:
+            diff.newRooms.emplace_back(toLoadedRoom(deref(rooms[i])));
+            break;
+        }
+    }
+    live->forEachRoom([&diff, &loaded](const Room &room) {
+        if (loaded->getRoom(room.getId()) == nullptr)
+            diff.removedRooms.emplace_back(room.getId());
+    });
+
+    std::vector<LoadedMark> marks;
+    marks.reserve(scratch.getMarkersList().size());
+    for (const SharedInfoMark &mark : scratch.getMarkersList()) {
+        marks.emplace_back(toLoadedMark(deref(mark)));
+    }
+    if (!hasSameMarks(marks, liveMarks)) {
+        diff.marks = std::move(marks);
+    }
+
+    log(QString("%1 rooms changed, %2 are new, %3 were removed, and %4 are the same.")
+            .arg(diff.changedRooms.size())
+            .arg(diff.newRooms.size())
+            .arg(diff.removedRooms.size())
+            .arg(diff.unchangedRooms));
+    diff.ok = true;
+    return diff;
+}
+
+void MapReloader::apply(MapDiff diff)
+{
+    assert(diff.ok && diff.modificationCount == m_mapData.getModificationCount());
+    const SharedMapSnapshot snapshot = m_mapData.getSnapshot();
+
+    // `before` makes way for the new rooms, and `after` connects them.
+    MapTransaction before;
+    MapTransaction after;
+    // Where rooms were taken away from, since those chunks aren't flagged otherwise.
+    std::vector<Coordinate> vacated;
+
+    for (const LoadedRoom &room : diff.changedRooms) {
+        const Room &old = deref(snapshot->getRoom(room.id));
+        for (const ExitDirEnum dir : ALL_EXITS7) {
+            for (const RoomId to : old.exit(dir).outRange()) {
+                if (!room.exits[dir].containsOut(to))
+                    before.add(std::make_shared<RemoveOneWayExit>(room.id, to, dir));
+            }
+            for (const RoomId to : room.exits[dir].outRange()) {
+                if (!old.exit(dir).containsOut(to))
+                    after.add(std::make_shared<AddOneWayExit>(room.id, to, dir));
+            }
+        }
+        if (old.getPosition() != room.position) {
+            vacated.emplace_back(old.getPosition());
+            before.add(std::make_shared<SingleRoomAction>(std::make_unique<LiftRoom>(), room.id));
+        }
+    }
+    for (LoadedRoom &room : diff.changedRooms) {
+        const RoomId id = room.id;
+        before.add(
+            std::make_shared<SingleRoomAction>(std::make_unique<ReplaceRoom>(std::move(room)), id));
+    }
+    for (const RoomId id : diff.removedRooms) {
+        vacated.emplace_back(deref(snapshot->getRoom(id)).getPosition());
+        before.add(std::make_shared<SingleRoomAction>(std::make_unique<Remove>(), id));
+    }
+
+    std::vector<SharedRoom> newRooms;
+    newRooms.reserve(diff.newRooms.size());
+    for (LoadedRoom &room : diff.newRooms) {
+        // Connections are only made by the transaction, once both ends exist.
+        for (const ExitDirEnum dir : ALL_EXITS7) {
+            Exit &e = room.exits[dir];
+            for (const RoomId to : e.outClone()) {
+                after.add(std::make_shared<AddOneWayExit>(room.id, to, dir));
+                e.removeOut(to);
+            }
+            for (const RoomId from : e.inClone()) {
+                e.removeIn(from);
+            }
+        }
+        newRooms.emplace_back(createRoom(m_mapData, std::move(room)));
+    }
+
+    m_mapData.executeBatch([this, &before, &after, &newRooms]() {
+        m_mapData.execute(std::move(before));
+        if (!newRooms.empty()) {
+            MapFrontendBlocker blocker{m_mapData};
+            for (const SharedRoom &room : newRooms) {
+                m_mapData.insertPredefinedRoom(room);
+                m_mapData.markMeshDirty(room->getPosition());
+            }
+        }
+        m_mapData.execute(std::move(after));
+    });
+    for (const Coordinate &c : vacated) {
+        m_mapData.markMeshDirty(c);
+    }
+    if (!newRooms.empty()) {
+        m_mapData.checkSize();
+        m_mapData.setDataChanged();
+    }
+
+    if (diff.marks.has_value()) {
+        const MarkerList old = m_mapData.getMarkersList();
+        m_mapData.removeMarkers(old);
+        m_mapData.reserveMarkers(diff.marks->size());
+        for (const LoadedMark &loaded : diff.marks.value()) {
+            auto mark = InfoMark::alloc(m_mapData);
+#define SET_FIELD(_Type, _Prop, _OptInit) mark->set##_Prop(loaded._Prop);
+            X_FOREACH_INFOMARK_PROPERTY(SET_FIELD)
+#undef SET_FIELD
+            m_mapData.addMarker(std::move(mark));
+        }
+    }
+
+    // The map is what the file has again.
+    m_mapData.markSaved();
+    m_mapData.unsetDataChanged();
+}
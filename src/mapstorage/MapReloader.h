@@ -0,0 +1,106 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+#include <QObject>
+#include <QString>
+#include <QtCore>
+
+#include "../global/RuleOf5.h"
+#include "../global/macros.h"
+#include "../global/roomid.h"
+#include "../mapdata/MapSnapshot.h"
+#include "../mapdata/infomark.h"
+#include "LoadedRoom.h"
+
+class MapData;
+
+// An infomark as it was read from the file.
+struct NODISCARD LoadedMark final
+{
+#define DECL_FIELD(_Type, _Prop, _OptInit) _Type _Prop _OptInit;
+    X_FOREACH_INFOMARK_PROPERTY(DECL_FIELD)
+#undef DECL_FIELD
+};
+
+// What has to change for the map to match the file again.
+struct NODISCARD MapDiff final
+{
+    QString fileName;
+    bool ok = false;
+    QString error;
+    // MapData::getModificationCount() of the map the file was compared with.
+    uint64_t modificationCount = 0;
+
+    // Rooms with an id the map already has, but different contents.
+    std::vector<LoadedRoom> changedRooms;
+    std::vector<LoadedRoom> newRooms;
+    std::vector<RoomId> removedRooms;
+    size_t unchangedRooms = 0;
+    // Every infomark of the file, if any of them differ from the map's.
+    std::optional<std::vector<LoadedMark>> marks;
+
+    NODISCARD bool empty() const
+    {
+        return changedRooms.empty() && newRooms.empty() && removedRooms.empty()
+               && !marks.has_value();
+    }
+};
+
+/**
+ * Reloads the map's file without starting over: the file is loaded into a
+ * scratch map on a worker thread and compared with a snapshot of the map by
+ * room id and contents, and apply() then changes only the rooms that differ,
+ * as one batch. The position, the selections and the meshes of untouched
+ * areas are kept.
+ *
+ * sig_finished is emitted from the worker thread; call wait() to collect the
+ * diff. Only one reload runs at a time.
+ */
+class NODISCARD MapReloader final : public QObject
+{
+    Q_OBJECT
+
+private:
+    MapData &m_mapData;
+    std::thread m_thread;
+    // Set by the worker thread when it's done.
+    std::mutex m_mutex;
+    std::optional<MapDiff> m_result;
+
+public:
+    explicit MapReloader(MapData &mapData, QObject *parent);
+    ~MapReloader() final;
+    DELETE_CTORS_AND_ASSIGN_OPS(MapReloader);
+
+public:
+    NODISCARD bool isRunning() const { return m_thread.joinable(); }
+
+    // The previous reload must have been waited for.
+    void start(QString fileName);
+    // Blocks until the running reload is done and returns its diff, or
+    // nullopt if there was nothing to wait for.
+    NODISCARD std::optional<MapDiff> wait();
+
+    // Must be called on the thread that owns the map, and only if the map
+    // hasn't been modified since the diff was started (see modificationCount).
+    void apply(MapDiff diff);
+
+private:
+    NODISCARD static MapDiff load(const QString &fileName,
+                                  const SharedMapSnapshot &live,
+                                  const std::vector<LoadedMark> &liveMarks,
+                                  const std::function<void(const QString &)> &log);
+
+signals:
+    void sig_log(const QString &, const QString &);
+    // Emitted from the worker thread.
+    void sig_finished();
+};
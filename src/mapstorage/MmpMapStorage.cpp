@@ -4,11 +4,15 @@
 
 #include "MmpMapStorage.h"
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
 #include <stdexcept>
+#include <string>
+#include <unordered_map>
 #include <QString>
-#include <QXmlStreamWriter>
 
 #include "../expandoracommon/coordinate.h"
 #include "../expandoracommon/exit.h"
@@ -21,6 +25,7 @@
 #include "../mapdata/enums.h"
 #include "../mapdata/mapdata.h"
 #include "../mapdata/mmapper2room.h"
+#include "BufferedXmlWriter.h"
 #include "abstractmapstorage.h"
 #include "basemapsavefilter.h"
 #include "progresscounter.h"
@@ -108,9 +113,120 @@ NODISCARD static QString getTerrainTypeColor(const RoomTerrainEnum x)
 #undef CASE2
 }
 
-NODISCARD static QString toMmpRoomId(const RoomId &roomId)
+NODISCARD static int64_t toMmpRoomId(const RoomId &roomId)
 {
-    return QString("%1").arg(roomId.asUint32() + 1);
+    return static_cast<int64_t>(roomId.asUint32()) + 1;
+}
+
+namespace { // anonymous
+
+// Room names repeat a lot, and interned ones share their string, so each
+// one is only escaped once.
+class NODISCARD EscapedNames final
+{
+private:
+    std::unordered_map<const std::string *, std::string> m_cache;
+
+public:
+    NODISCARD std::string_view get(const RoomName &name)
+    {
+        const std::string &str = name.getStdString();
+        if (!name.isInterned()) {
+            m_scratch = BufferedXmlWriter::escape(str);
+            return m_scratch;
+        }
+        auto it = m_cache.find(&str);
+        if (it == m_cache.end()) {
+            it = m_cache.emplace(&str, BufferedXmlWriter::escape(str)).first;
+        }
+        return it->second;
+    }
+
+private:
+    std::string m_scratch;
+};
+
+} // namespace
+
+template<typename ForEachRoom>
+bool MmpMapStorage::writeMap(QIODevice &device,
+                             const size_t roomsCount,
+                             ForEachRoom &&forEachRoom,
+                             ProgressCounter &progressCounter,
+                             const std::function<void(const QString &)> &log)
+{
+    const auto startTime = std::chrono::steady_clock::now();
+    progressCounter.increaseTotalStepsBy(roomsCount + 3);
+
+    BufferedXmlWriter writer{device};
+    writer.writeStartDocument();
+
+    // save map
+    writer.writeStartElement("map");
+
+    // save areas
+    writer.writeStartElement("areas");
+    writer.writeStartElement("area");
+    writer.writeEscapedAttribute("id", "1");
+    writer.writeEscapedAttribute("name", "Arda");
+    writer.writeEndElement(); // end area
+    writer.writeEndElement(); // end areas
+    progressCounter.step();
+
+    // save rooms
+    size_t written = 0;
+    EscapedNames names;
+    writer.writeStartElement("rooms");
+    forEachRoom([&writer, &names, &written, &progressCounter](const Room &room) {
+        saveRoom(room, writer, names.get(room.getName()));
+        ++written;
+        progressCounter.step();
+    });
+    writer.writeEndElement(); // end rooms
+
+    // save environments
+    writer.writeStartElement("environments");
+    for (auto terrainType : ALL_TERRAIN_TYPES) {
+        writer.writeStartElement("environment");
+        writer.writeAttribute("id", static_cast<int64_t>(terrainType));
+        writer.writeAttribute("name", getTerrainTypeName(terrainType).toStdString());
+        writer.writeEscapedAttribute("color", getTerrainTypeColor(terrainType).toStdString());
+        writer.writeEndElement(); // end environment
+    }
+    writer.writeEndElement(); // end environments
+    progressCounter.step();
+
+    writer.writeEndElement(); // end map
+    const bool ok = writer.finish();
+    progressCounter.step();
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                             std::chrono::steady_clock::now() - startTime)
+                             .count();
+    const double seconds = std::max(static_cast<double>(elapsed), 1.0) / 1000.0;
+    const double kib = static_cast<double>(writer.getBytesWritten()) / 1024.0;
+    log(QString("Wrote %1 rooms (%2 KiB) in %3 ms: %4 rooms/s, %5 KiB/s")
+            .arg(written)
+            .arg(kib, 0, 'f', 0)
+            .arg(elapsed)
+            .arg(static_cast<double>(written) / seconds, 0, 'f', 0)
+            .arg(kib / seconds, 0, 'f', 0));
+    return ok;
+}
+
+bool MmpMapStorage::writeData(QIODevice &device,
+                              const SharedMapSnapshot &rooms,
+                              ProgressCounter &progressCounter,
+                              const std::function<void(const QString &)> &log)
+{
+    const MapSnapshot &snapshot = deref(rooms);
+    progressCounter.reset();
+    return writeMap(
+        device,
+        snapshot.getRoomsCount(),
+        [&snapshot](const auto &saveOne) { snapshot.forEachRoom(saveOne); },
+        progressCounter,
+        log);
 }
 
 bool MmpMapStorage::saveData(bool baseMapOnly)
@@ -127,11 +243,8 @@ bool MmpMapStorage::saveData(bool baseMapOnly)
         m_mapData.lookingForRooms(saver, RoomId{i});
     }
 
-    uint roomsCount = saver.getRoomsCount();
-
     auto &progressCounter = getProgressCounter();
     progressCounter.reset();
-    progressCounter.increaseTotalStepsBy(roomsCount + 3);
 
     BaseMapSaveFilter filter;
     if (baseMapOnly) {
@@ -140,46 +253,21 @@ bool MmpMapStorage::saveData(bool baseMapOnly)
         filter.prepare(progressCounter);
     }
 
-    QXmlStreamWriter stream(m_file);
-    stream.setAutoFormatting(true);
-    stream.writeStartDocument();
-
-    // save map
-    stream.writeStartElement("map");
-
-    // save areas
-    stream.writeStartElement("areas");
-    stream.writeStartElement("area");
-    stream.writeAttribute("id", "1");
-    stream.writeAttribute("name", "Arda");
-    stream.writeEndElement(); // end area
-    stream.writeEndElement(); // end areas
-    progressCounter.step();
-
-    // save rooms
-    stream.writeStartElement("rooms");
-    auto saveOne = [&stream](const Room &room) { saveRoom(room, stream); };
-
-    for (const auto &pRoom : roomList) {
-        filter.visitRoom(deref(pRoom), baseMapOnly, saveOne);
-        progressCounter.step();
-    }
-    stream.writeEndElement(); // end rooms
-
-    // save environments
-    stream.writeStartElement("environments");
-    for (auto terrainType : ALL_TERRAIN_TYPES) {
-        stream.writeStartElement("environment");
-        stream.writeAttribute("id", QString("%1").arg(static_cast<int>(terrainType)));
-        stream.writeAttribute("name", getTerrainTypeName(terrainType));
-        stream.writeAttribute("color", getTerrainTypeColor(terrainType));
-        stream.writeEndElement(); // end environment
+    const auto logMessage = [this](const QString &msg) { log(msg); };
+    const bool ok = writeMap(
+        deref(m_file),
+        roomList.size(),
+        [&roomList, &filter, baseMapOnly](const auto &saveOne) {
+            for (const auto &pRoom : roomList) {
+                filter.visitRoom(deref(pRoom), baseMapOnly, saveOne);
+            }
+        },
+        progressCounter,
+        logMessage);
+    if (!ok) {
+        log("Writing data failed.");
+        return false;
     }
-    stream.writeEndElement(); // end environments
-    progressCounter.step();
-
-    stream.writeEndElement(); // end map
-    progressCounter.step();
 
     log("Writing data finished.");
 
@@ -189,38 +277,40 @@ bool MmpMapStorage::saveData(bool baseMapOnly)
     return true;
 }
 
-void MmpMapStorage::saveRoom(const Room &room, QXmlStreamWriter &stream)
+void MmpMapStorage::saveRoom(const Room &room,
+                             BufferedXmlWriter &writer,
+                             const std::string_view escapedName)
 {
-    stream.writeStartElement("room");
-    stream.writeAttribute("id", toMmpRoomId(room.getId()));
-    stream.writeAttribute("area", "1");
-    stream.writeAttribute("title", room.getName().toQString());
-    stream.writeAttribute("environment", QString("%1").arg(static_cast<int>(room.getTerrainType())));
+    writer.writeStartElement("room");
+    writer.writeAttribute("id", toMmpRoomId(room.getId()));
+    writer.writeEscapedAttribute("area", "1");
+    writer.writeEscapedAttribute("title", escapedName);
+    writer.writeAttribute("environment", static_cast<int64_t>(room.getTerrainType()));
     if (room.getLoadFlags().contains(RoomLoadFlagEnum::ATTENTION))
-        stream.writeAttribute("important", "1");
+        writer.writeEscapedAttribute("important", "1");
 
-    stream.writeStartElement("coord");
+    writer.writeStartElement("coord");
     const Coordinate &pos = room.getPosition();
-    stream.writeAttribute("x", QString("%1").arg(pos.x));
-    stream.writeAttribute("y", QString("%1").arg(pos.y));
-    stream.writeAttribute("z", QString("%1").arg(pos.z));
-    stream.writeEndElement(); // end coord
+    writer.writeAttribute("x", pos.x);
+    writer.writeAttribute("y", pos.y);
+    writer.writeAttribute("z", pos.z);
+    writer.writeEndElement(); // end coord
 
     for (const ExitDirEnum dir : ALL_EXITS_NESWUD) {
         const Exit &e = room.exit(dir);
         if (e.isExit() && !e.outIsEmpty()) {
-            stream.writeStartElement("exit");
-            stream.writeAttribute("direction", lowercaseDirection(dir));
+            writer.writeStartElement("exit");
+            writer.writeEscapedAttribute("direction", lowercaseDirection(dir));
             // REVISIT: Can MMP handle multiple exits in the same direction?
-            stream.writeAttribute("target", toMmpRoomId(e.outFirst()));
+            writer.writeAttribute("target", toMmpRoomId(e.outFirst()));
             if (e.isHiddenExit())
-                stream.writeAttribute("hidden", "1");
+                writer.writeEscapedAttribute("hidden", "1");
             if (e.isDoor()) {
-                stream.writeAttribute("door", "2");
+                writer.writeEscapedAttribute("door", "2");
             }
-            stream.writeEndElement(); // end exit
+            writer.writeEndElement(); // end exit
         }
     }
 
-    stream.writeEndElement(); // end room
+    writer.writeEndElement(); // end room
 }
@@ -3,15 +3,21 @@
 // Copyright (C) 2019 The MMapper Authors
 // Author: Nils Schimmelmann <nschimme@gmail.com> (Jahara)
 
+#include <cstddef>
+#include <functional>
+#include <string_view>
 #include <QString>
 #include <QtCore>
 
 #include "../global/macros.h"
+#include "../mapdata/MapSnapshot.h"
 #include "abstractmapstorage.h"
 
+class BufferedXmlWriter;
 class MapData;
+class ProgressCounter;
+class QIODevice;
 class QObject;
-class QXmlStreamWriter;
 
 /*! \brief MMP export for other clients
  *
@@ -29,6 +35,14 @@ class MmpMapStorage final : public AbstractMapStorage
 public:
     MmpMapStorage() = delete;
 
+public:
+    // Writes the whole map; safe to call from any thread, since it only
+    // reads the snapshot.
+    NODISCARD static bool writeData(QIODevice &device,
+                                    const SharedMapSnapshot &rooms,
+                                    ProgressCounter &progressCounter,
+                                    const std::function<void(const QString &)> &log);
+
 private:
     NODISCARD bool canLoad() const override { return false; }
     NODISCARD bool canSave() const override { return true; }
@@ -39,6 +53,13 @@ class MmpMapStorage final : public AbstractMapStorage
     NODISCARD bool mergeData() override;
 
 private:
-    static void saveRoom(const Room &room, QXmlStreamWriter &stream);
+    // Calls forEachRoom(saveOne), and writes each room it passes to saveOne.
+    template<typename ForEachRoom>
+    NODISCARD static bool writeMap(QIODevice &device,
+                                   size_t roomsCount,
+                                   ForEachRoom &&forEachRoom,
+                                   ProgressCounter &progressCounter,
+                                   const std::function<void(const QString &)> &log);
+    static void saveRoom(const Room &room, BufferedXmlWriter &writer, std::string_view escapedName);
     void log(const QString &msg) { emit sig_log("MmpMapStorage", msg); }
 };
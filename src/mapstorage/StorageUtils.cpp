@@ -27,7 +27,7 @@ inline Bytef *as_far_byte_array(char *const s)
     return reinterpret_cast<Bytef *>(s);
 }
 
-QByteArray inflate(QByteArray &data)
+QByteArray inflate(QByteArray &data, const size_t maxSize)
 {
     const auto get_zlib_error_str = [](const int ret, const z_stream &strm) {
         std::ostringstream oss;
@@ -67,6 +67,10 @@ QByteArray inflate(QByteArray &data)
             break;
         }
         int length = CHUNK - static_cast<int>(strm.avail_out);
+        if (static_cast<size_t>(result.size()) + static_cast<size_t>(length) > maxSize) {
+            (void) inflateEnd(&strm);
+            throw std::runtime_error("inflated data is too large");
+        }
         result.append(out, length);
 
     } while (strm.avail_out == 0);
@@ -80,7 +84,7 @@ QByteArray inflate(QByteArray &data)
     return result;
 }
 #else
-QByteArray inflate(QByteArray & /*data*/)
+QByteArray inflate(QByteArray & /*data*/, size_t /*maxSize*/)
 {
     abort();
 }
@@ -3,10 +3,14 @@
 // Copyright (C) 2019 The MMapper Authors
 // Author: Nils Schimmelmann <nschimme@gmail.com> (Jahara)
 
+#include <cstddef>
+#include <limits>
+
 #include "../global/macros.h"
 
 class QByteArray;
 
 namespace StorageUtils {
-NODISCARD QByteArray inflate(QByteArray &);
+// Throws std::runtime_error if the result would be larger than maxSize.
+NODISCARD QByteArray inflate(QByteArray &, size_t maxSize = std::numeric_limits<size_t>::max());
 } // namespace StorageUtils
@@ -0,0 +1,414 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "WebTileExporter.h"
+
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <QColor>
+#include <QFile>
+#include <QImage>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPainter>
+#include <QString>
+
+#include "../expandoracommon/exit.h"
+#include "../expandoracommon/room.h"
+#include "../global/hash.h"
+#include "../global/parallel.h"
+#include "../global/utils.h"
+#include "../mapdata/ExitDirection.h"
+#include "progresscounter.h"
+
+namespace web_tiles {
+namespace { // anonymous
+
+// Part of every tile's hash, so drawing them differently redraws them all.
+static constexpr const uint64_t RENDER_VERSION = 1;
+static constexpr const int MANIFEST_VERSION = 1;
+static constexpr const auto MANIFEST_FILENAME = "tile-hashes.json";
+static constexpr const auto METADATA_FILENAME = "tiles.json";
+
+struct NODISCARD TileKey final
+{
+    int z = 0;
+    int level = 0;
+    int x = 0;
+    int y = 0;
+
+    NODISCARD bool operator<(const TileKey &rhs) const
+    {
+        return std::tie(z, level, x, y) < std::tie(rhs.z, rhs.level, rhs.x, rhs.y);
+    }
+};
+
+struct NODISCARD Tile final
+{
+    uint64_t hash = 0;
+    // Only set on level 0.
+    std::vector<const TileRoom *> rooms;
+    bool dirty = false;
+};
+
+using Tiles = std::map<TileKey, Tile>;
+
+NODISCARD int floorDiv(const int n, const int d)
+{
+    return (n >= 0) ? (n / d) : -((-n - 1) / d) - 1;
+}
+
+NODISCARD std::string getKeyString(const TileKey &key)
+{
+    return std::to_string(key.z) + "/" + std::to_string(key.level) + "/" + std::to_string(key.x)
+           + "," + std::to_string(key.y);
+}
+
+NODISCARD QString getTilePath(const QDir &dir, const TileKey &key)
+{
+    return dir.filePath(::toQStringUtf8(getKeyString(key) + ".png"));
+}
+
+NODISCARD uint64_t hashBytes(const std::vector<int32_t> &words)
+{
+    return stable_hash64(std::string_view{reinterpret_cast<const char *>(words.data()),
+                                          words.size() * sizeof(int32_t)});
+}
+
+NODISCARD uint64_t getBaseHash(std::vector<const TileRoom *> &rooms)
+{
+    // The order the rooms came in doesn't change the tile.
+    std::sort(rooms.begin(), rooms.end(), [](const TileRoom *a, const TileRoom *b) {
+        return std::tie(a->position.x, a->position.y) < std::tie(b->position.x, b->position.y);
+    });
+    std::vector<int32_t> words;
+    words.reserve(rooms.size() * 3 + 1);
+    words.emplace_back(static_cast<int32_t>(RENDER_VERSION));
+    for (const TileRoom *const room : rooms) {
+        words.emplace_back(room->position.x);
+        words.emplace_back(room->position.y);
+        words.emplace_back(static_cast<int32_t>(room->terrain) | (room->exits << 8)
+                           | (room->doors << 16));
+    }
+    return hashBytes(words);
+}
+
+NODISCARD QColor getTerrainColor(const RoomTerrainEnum terrain)
+{
+#define CASE2(UPPER, Color) \
+    do { \
+    case RoomTerrainEnum::UPPER: \
+        return QColor{Color}; \
+    } while (false)
+    switch (terrain) {
+        CASE2(UNDEFINED, "#808080");
+        CASE2(INDOORS, "#b08d57");
+        CASE2(CITY, "#c0c0c0");
+        CASE2(FIELD, "#9acd32");
+        CASE2(FOREST, "#228b22");
+        CASE2(HILLS, "#a0a050");
+        CASE2(MOUNTAINS, "#8b7765");
+        CASE2(SHALLOW, "#87cefa");
+        CASE2(WATER, "#1e90ff");
+        CASE2(RAPIDS, "#4169e1");
+        CASE2(UNDERWATER, "#000080");
+        CASE2(ROAD, "#d2b48c");
+        CASE2(BRUSH, "#6b8e23");
+        CASE2(TUNNEL, "#696969");
+        CASE2(CAVERN, "#505050");
+        CASE2(DEATHTRAP, "#b22222");
+    }
+    return QColor{"#808080"};
+#undef CASE2
+}
+
+NODISCARD bool hasDir(const uint8_t bits, const ExitDirEnum dir)
+{
+    return (bits & (1u << static_cast<uint32_t>(dir))) != 0;
+}
+
+NODISCARD QImage newImage()
+{
+    QImage image{TILE_PIXELS, TILE_PIXELS, QImage::Format_ARGB32_Premultiplied};
+    image.fill(Qt::transparent);
+    return image;
+}
+
+void saveImage(const QImage &image, const QString &path)
+{
+    if (!image.save(path, "PNG")) {
+        throw std::runtime_error(::toStdStringUtf8(QString("error writing tile %1").arg(path)));
+    }
+}
+
+void drawBaseTile(const QDir &dir, const TileKey &key, const Tile &tile)
+{
+    QImage image = newImage();
+    {
+        QPainter painter{&image};
+        const QColor wall{Qt::black};
+        const QColor door{"#8b4513"};
+        const QColor stairs{Qt::white};
+        for (const TileRoom *const room : tile.rooms) {
+            const int left = (room->position.x - key.x * ZONE_WIDTH) * ROOM_PIXELS;
+            const int top = (-room->position.y - key.y * ZONE_WIDTH) * ROOM_PIXELS;
+            const int right = left + ROOM_PIXELS - 1;
+            const int bottom = top + ROOM_PIXELS - 1;
+            painter.fillRect(left, top, ROOM_PIXELS, ROOM_PIXELS, getTerrainColor(room->terrain));
+
+            // A wall where there's no exit, and a door where there's one.
+            const auto side = [&painter, room, &wall, &door](const ExitDirEnum dir,
+                                                             const int x1,
+                                                             const int y1,
+                                                             const int x2,
+                                                             const int y2) {
+                if (hasDir(room->doors, dir)) {
+                    painter.setPen(door);
+                } else if (!hasDir(room->exits, dir)) {
+                    painter.setPen(wall);
+                } else {
+                    return;
+                }
+                painter.drawLine(x1, y1, x2, y2);
+            };
+            side(ExitDirEnum::NORTH, left, top, right, top);
+            side(ExitDirEnum::SOUTH, left, bottom, right, bottom);
+            side(ExitDirEnum::WEST, left, top, left, bottom);
+            side(ExitDirEnum::EAST, right, top, right, bottom);
+
+            const int mark = ROOM_PIXELS / 4;
+            if (hasDir(room->exits, ExitDirEnum::UP)) {
+                painter.fillRect(right - mark - 1, top + 2, mark, mark, stairs);
+            }
+            if (hasDir(room->exits, ExitDirEnum::DOWN)) {
+                painter.fillRect(left + 2, bottom - mark - 1, mark, mark, stairs);
+            }
+        }
+    }
+    saveImage(image, getTilePath(dir, key));
+}
+
+void drawParentTile(const QDir &dir, const TileKey &key, const Tiles &tiles)
+{
+    static constexpr const int HALF = TILE_PIXELS / 2;
+    QImage image = newImage();
+    {
+        QPainter painter{&image};
+        painter.setRenderHint(QPainter::SmoothPixmapTransform);
+        for (int dy = 0; dy < 2; ++dy) {
+            for (int dx = 0; dx < 2; ++dx) {
+                const TileKey child{key.z, key.level - 1, key.x * 2 + dx, key.y * 2 + dy};
+                if (tiles.find(child) == tiles.end())
+                    continue;
+                const QImage childImage{getTilePath(dir, child)};
+                if (childImage.isNull()) {
+                    throw std::runtime_error(
+                        ::toStdStringUtf8(QString("error reading tile %1")
+                                              .arg(getTilePath(dir, child))));
+                }
+                painter.drawImage(QRect{dx * HALF, dy * HALF, HALF, HALF}, childImage);
+            }
+        }
+    }
+    saveImage(image, getTilePath(dir, key));
+}
+
+NODISCARD std::unordered_map<std::string, uint64_t> readManifest(const QString &filePath)
+{
+    std::unordered_map<std::string, uint64_t> result;
+    QFile file{filePath};
+    if (!file.open(QIODevice::ReadOnly)) {
+        return result;
+    }
+    const QJsonObject json = QJsonDocument::fromJson(file.readAll()).object();
+    if (json.value("version").toInt() != MANIFEST_VERSION) {
+        return result;
+    }
+    const QJsonObject tiles = json.value("tiles").toObject();
+    for (auto it = tiles.constBegin(); it != tiles.constEnd(); ++it) {
+        // Stale tiles are deleted, so only take names this code could have written.
+        const std::string key = ::toStdStringUtf8(it.key());
+        if (key.empty() || key.find_first_not_of("-,/0123456789") != std::string::npos) {
+            continue;
+        }
+        bool ok = false;
+        const uint64_t hash = it.value().toString().toULongLong(&ok, 16);
+        if (ok) {
+            result.emplace(key, hash);
+        }
+    }
+    return result;
+}
+
+void writeJsonFile(const QString &filePath, const QJsonObject &json)
+{
+    QFile file{filePath};
+    const QByteArray data = QJsonDocument{json}.toJson();
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.flush()) {
+        throw std::runtime_error(::toStdStringUtf8(
+            QString("error writing %1: %2").arg(filePath).arg(file.errorString())));
+    }
+}
+
+} // namespace
+
+TileRoom TileRoom::fromRoom(const Room &room)
+{
+    TileRoom result;
+    result.position = room.getPosition();
+    result.terrain = room.getTerrainType();
+    for (const ExitDirEnum dir : ALL_EXITS_NESWUD) {
+        const Exit &e = room.exit(dir);
+        const auto bit = static_cast<uint8_t>(1u << static_cast<uint32_t>(dir));
+        if (e.isExit())
+            result.exits |= bit;
+        if (e.isDoor())
+            result.doors |= bit;
+    }
+    return result;
+}
+
+size_t writeTiles(const QDir &dir,
+                  const std::vector<TileRoom> &rooms,
+                  ProgressCounter &progressCounter)
+{
+    Tiles tiles;
+    for (const TileRoom &room : rooms) {
+        const TileKey key{room.position.z,
+                          0,
+                          floorDiv(room.position.x, ZONE_WIDTH),
+                          floorDiv(-room.position.y, ZONE_WIDTH)};
+        tiles[key].rooms.emplace_back(&room);
+    }
+    for (auto &kv : tiles) {
+        kv.second.hash = getBaseHash(kv.second.rooms);
+    }
+
+    // Each level halves the previous one, until a layer fits in one tile.
+    std::map<int, int> levels;
+    {
+        std::map<int, size_t> counts;
+        for (const auto &kv : tiles) {
+            ++counts[kv.first.z];
+        }
+        for (const auto &kv : counts) {
+            levels[kv.first] = 1;
+        }
+        for (int level = 1; level < MAX_LEVELS; ++level) {
+            Tiles parents;
+            for (const auto &kv : tiles) {
+                const TileKey &key = kv.first;
+                if (key.level != level - 1 || counts[key.z] <= 1)
+                    continue;
+                const TileKey parent{key.z, level, floorDiv(key.x, 2), floorDiv(key.y, 2)};
+                const auto quadrant = static_cast<uint64_t>((key.x - parent.x * 2)
+                                                            + (key.y - parent.y * 2) * 2);
+                Tile &tile = parents[parent];
+                tile.hash = (tile.hash ^ (kv.second.hash + quadrant)) * 0x9E3779B97F4A7C15ull;
+                tile.hash ^= tile.hash >> 29;
+            }
+            if (parents.empty())
+                break;
+            counts.clear();
+            for (const auto &kv : parents) {
+                ++counts[kv.first.z];
+                levels[kv.first.z] = level + 1;
+            }
+            tiles.merge(parents);
+        }
+    }
+
+    const QString manifestPath = dir.filePath(MANIFEST_FILENAME);
+    std::unordered_map<std::string, uint64_t> previous = readManifest(manifestPath);
+    std::map<int, std::vector<std::pair<const TileKey *, const Tile *>>> dirtyByLevel;
+    QJsonObject manifestTiles;
+    for (auto &kv : tiles) {
+        const std::string keyString = getKeyString(kv.first);
+        const auto it = previous.find(keyString);
+        Tile &tile = kv.second;
+        tile.dirty = it == previous.end() || it->second != tile.hash
+                     || !QFile::exists(getTilePath(dir, kv.first));
+        if (it != previous.end()) {
+            previous.erase(it);
+        }
+        if (tile.dirty) {
+            dirtyByLevel[kv.first.level].emplace_back(&kv.first, &tile);
+        }
+        manifestTiles.insert(::toQStringUtf8(keyString), QString::number(tile.hash, 16));
+    }
+
+    size_t dirtyCount = 0;
+    for (const auto &kv : dirtyByLevel) {
+        dirtyCount += kv.second.size();
+    }
+    progressCounter.increaseTotalStepsBy(static_cast<quint32>(dirtyCount));
+
+    for (const auto &kv : levels) {
+        for (int level = 0; level < kv.second; ++level) {
+            const QString path = QString("%1/%2").arg(kv.first).arg(level);
+            if (!dir.mkpath(path)) {
+                throw std::runtime_error(
+                    ::toStdStringUtf8(QString("error creating dir %1").arg(path)));
+            }
+        }
+    }
+
+    // A level only reads the level below it, which is finished by then.
+    for (const auto &kv : dirtyByLevel) {
+        const auto &dirty = kv.second;
+        std::vector<std::string> errors(dirty.size());
+        parallelFor(
+            dirty.size(),
+            [&dir, &tiles, &dirty, &errors, &progressCounter](const size_t i) {
+                try {
+                    const TileKey &key = deref(dirty[i].first);
+                    if (key.level == 0) {
+                        drawBaseTile(dir, key, deref(dirty[i].second));
+                    } else {
+                        drawParentTile(dir, key, tiles);
+                    }
+                } catch (const std::exception &ex) {
+                    errors[i] = ex.what();
+                }
+                progressCounter.step();
+            },
+            1);
+        for (const std::string &error : errors) {
+            if (!error.empty()) {
+                throw std::runtime_error(error);
+            }
+        }
+    }
+
+    // These tiles don't have any rooms left.
+    for (const auto &kv : previous) {
+        QFile::remove(dir.filePath(::toQStringUtf8(kv.first + ".png")));
+    }
+
+    QJsonObject manifest;
+    manifest["version"] = MANIFEST_VERSION;
+    manifest["tiles"] = manifestTiles;
+    writeJsonFile(manifestPath, manifest);
+
+    QJsonObject layers;
+    for (const auto &kv : levels) {
+        layers.insert(QString::number(kv.first), kv.second);
+    }
+    QJsonObject metadata;
+    metadata["version"] = MANIFEST_VERSION;
+    metadata["zoneWidth"] = ZONE_WIDTH;
+    metadata["roomPixels"] = ROOM_PIXELS;
+    metadata["tilePixels"] = TILE_PIXELS;
+    metadata["levels"] = layers;
+    writeJsonFile(dir.filePath(METADATA_FILENAME), metadata);
+
+    return dirtyCount;
+}
+
+} // namespace web_tiles
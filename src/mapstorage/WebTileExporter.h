@@ -0,0 +1,56 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <QDir>
+
+#include "../expandoracommon/coordinate.h"
+#include "../global/macros.h"
+#include "../mapdata/mmapper2room.h"
+
+class ProgressCounter;
+class Room;
+
+/**
+ * Renders the web map as a pyramid of PNG tiles, so web viewers on slow
+ * devices can show the whole map without drawing every room themselves.
+ *
+ * This writes, under the given directory:
+ * - <z>/0/<x>,<y>.png: one tile per zone (see ZONE_WIDTH) of layer z, the
+ *   x and y in zones, with y growing southward like the zone files.
+ * - <z>/<n>/<x>,<y>.png: the 2x2 tiles of level n-1 below it, downscaled.
+ * - tiles.json: the tile and room sizes, and the levels of each layer.
+ * - tile-hashes.json: what each tile was drawn from, so that exporting to
+ *   the same directory again only redraws the tiles that changed.
+ *
+ * Tiles are drawn with QPainter on QImages, one level at a time, in
+ * parallel across the cores.
+ */
+namespace web_tiles {
+
+static constexpr const int ZONE_WIDTH = 20;
+static constexpr const int ROOM_PIXELS = 12;
+static constexpr const int TILE_PIXELS = ZONE_WIDTH * ROOM_PIXELS;
+static constexpr const int MAX_LEVELS = 6;
+
+// What a tile shows of a room.
+struct NODISCARD TileRoom final
+{
+    Coordinate position;
+    RoomTerrainEnum terrain = RoomTerrainEnum::UNDEFINED;
+    // One bit per direction of NESWUD.
+    uint8_t exits = 0;
+    uint8_t doors = 0;
+
+    NODISCARD static TileRoom fromRoom(const Room &room);
+};
+
+// Returns the number of tiles that had to be (re)drawn; throws on errors.
+NODISCARD size_t writeTiles(const QDir &dir,
+                            const std::vector<TileRoom> &rooms,
+                            ProgressCounter &progressCounter);
+
+} // namespace web_tiles
@@ -5,11 +5,17 @@
 
 #include "XmlMapStorage.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
 #include <stdexcept>
+#include <string_view>
 #include <type_traits>
+#include <utility>
+#include <QByteArray>
 #include <QHash>
+#include <QIODevice>
 #include <QMessageBox>
 #include <QString>
 #include <QStringView>
@@ -20,6 +26,7 @@
 #include "../expandoracommon/exit.h"
 #include "../expandoracommon/room.h"
 #include "../global/TextUtils.h"
+#include "../global/parallel.h"
 #include "../global/roomid.h"
 #include "../global/string_view_utils.h"
 #include "../global/utils.h"
@@ -30,6 +37,7 @@
 #include "../mapdata/enums.h"
 #include "../mapdata/mapdata.h"
 #include "../mapdata/mmapper2room.h"
+#include "LoadedRoom.h"
 #include "abstractmapstorage.h"
 #include "basemapsavefilter.h"
 #include "progresscounter.h"
@@ -193,6 +201,101 @@ uint XmlMapStorage::Converter::stringToEnum(Type type, const QStringView str, bo
 
 const XmlMapStorage::Converter XmlMapStorage::conv;
 
+// ---------------------------- element and attribute names --------------------
+// Loading looks names up by a hash computed at compile time, rather than
+// comparing against every name it knows in turn.
+#define X_FOREACH_XML_ELEMENT(X) \
+    X(ALIGN, "align") \
+    X(CONTENTS, "contents") \
+    X(COORD, "coord") \
+    X(DESCRIPTION, "description") \
+    X(DOORFLAG, "doorflag") \
+    X(EXIT, "exit") \
+    X(EXITFLAG, "exitflag") \
+    X(LIGHT, "light") \
+    X(LOADFLAG, "loadflag") \
+    X(MAP, "map") \
+    X(MARKER, "marker") \
+    X(MOBFLAG, "mobflag") \
+    X(NOTE, "note") \
+    X(PORTABLE, "portable") \
+    X(POS1, "pos1") \
+    X(POS2, "pos2") \
+    X(POSITION, "position") \
+    X(RIDABLE, "ridable") \
+    X(ROOM, "room") \
+    X(SUNDEATH, "sundeath") \
+    X(TERRAIN, "terrain") \
+    X(TEXT, "text") \
+    X(TO, "to")
+
+#define X_FOREACH_XML_ATTRIBUTE(X) \
+    X(DIR, "dir") \
+    X(DOORNAME, "doorname") \
+    X(ID, "id") \
+    X(NAME, "name") \
+    X(UPTODATE, "uptodate") \
+    X(COORD_X, "x") \
+    X(COORD_Y, "y") \
+    X(COORD_Z, "z")
+
+enum class NODISCARD XmlElementEnum : uint8_t {
+    UNKNOWN,
+#define DECL(_Enum, _Name) _Enum,
+    X_FOREACH_XML_ELEMENT(DECL)
+#undef DECL
+};
+
+enum class NODISCARD XmlAttributeEnum : uint8_t {
+    UNKNOWN,
+#define DECL(_Enum, _Name) _Enum,
+    X_FOREACH_XML_ATTRIBUTE(DECL)
+#undef DECL
+};
+
+// FNV-1a
+NODISCARD static constexpr uint32_t hashName(const std::u16string_view name)
+{
+    uint32_t hash = 2166136261u;
+    for (const char16_t c : name) {
+        hash = (hash ^ c) * 16777619u;
+    }
+    return hash;
+}
+
+// A name that isn't known can still have the hash of one that is.
+#define CASE_NAME(_Type, _Enum, _Name) \
+    case hashName(u"" _Name): \
+        return (name == u"" _Name) ? _Type::_Enum : _Type::UNKNOWN;
+
+NODISCARD static XmlElementEnum getXmlElement(const QStringView qname)
+{
+    const std::u16string_view name = as_u16string_view(qname);
+    switch (hashName(name)) {
+#define CASE(_Enum, _Name) CASE_NAME(XmlElementEnum, _Enum, _Name)
+        X_FOREACH_XML_ELEMENT(CASE)
+#undef CASE
+    default:
+        break;
+    }
+    return XmlElementEnum::UNKNOWN;
+}
+
+NODISCARD static XmlAttributeEnum getXmlAttribute(const QStringView qname)
+{
+    const std::u16string_view name = as_u16string_view(qname);
+    switch (hashName(name)) {
+#define CASE(_Enum, _Name) CASE_NAME(XmlAttributeEnum, _Enum, _Name)
+        X_FOREACH_XML_ATTRIBUTE(CASE)
+#undef CASE
+    default:
+        break;
+    }
+    return XmlAttributeEnum::UNKNOWN;
+}
+
+#undef CASE_NAME
+
 // ---------------------------- XmlMapStorage ----------------------------------
 XmlMapStorage::XmlMapStorage(MapData &mapdata,
                              const QString &filename,
@@ -200,6 +303,7 @@ XmlMapStorage::XmlMapStorage(MapData &mapdata,
                              QObject *const parent)
     : AbstractMapStorage(mapdata, filename, file, parent)
     , m_loadedRooms()
+    , m_loadedRoomIndex()
     , m_loadProgressDivisor(1) // avoid division by zero
     , m_loadProgress(0)
 {}
@@ -239,9 +343,9 @@ bool XmlMapStorage::loadData()
         log(msg);
         qWarning().noquote() << msg;
 
-        QMessageBox::critical(checked_dynamic_downcast<QWidget *>(parent()),
-                              tr("XmlMapStorage Error"),
-                              msg);
+        if (auto *const widget = qobject_cast<QWidget *>(parent())) {
+            QMessageBox::critical(widget, tr("XmlMapStorage Error"), msg);
+        }
 
         m_mapData.clear();
         return false;
@@ -258,7 +362,7 @@ void XmlMapStorage::loadWorld(QXmlStreamReader &stream)
     m_mapData.setDataChanged();
 
     while (stream.readNextStartElement() && !stream.hasError()) {
-        if (as_u16string_view(stream.name()) == "map") {
+        if (getXmlElement(stream.name()) == XmlElementEnum::MAP) {
             loadMap(stream);
             break; // expecting only one <map>
         }
@@ -271,6 +375,7 @@ void XmlMapStorage::loadWorld(QXmlStreamReader &stream)
 void XmlMapStorage::loadMap(QXmlStreamReader &stream)
 {
     m_loadedRooms.clear();
+    m_loadedRoomIndex.clear();
     {
         const QXmlStreamAttributes attrs = stream.attributes();
         const QString type = attrs.value("type").toString();
@@ -289,17 +394,21 @@ void XmlMapStorage::loadMap(QXmlStreamReader &stream)
     }
 
     while (stream.readNextStartElement() && !stream.hasError()) {
-        const std::u16string_view name = as_u16string_view(stream.name());
-        if (name == "room") {
+        switch (getXmlElement(stream.name())) {
+        case XmlElementEnum::ROOM:
             loadRoom(stream);
-        } else if (name == "marker") {
+            break;
+        case XmlElementEnum::MARKER:
             loadMarker(stream);
-        } else if (name == "position") {
+            break;
+        case XmlElementEnum::POSITION:
             m_mapData.setPosition(loadCoordinate(stream));
-        } else {
+            break;
+        default:
             qWarning().noquote().nospace()
                 << "At line " << stream.lineNumber() << ": ignoring unexpected XML element <"
                 << stream.name() << "> inside <map>";
+            break;
         }
         skipXmlElement(stream);
         loadNotifyProgress(stream);
@@ -311,88 +420,106 @@ void XmlMapStorage::loadMap(QXmlStreamReader &stream)
 // load current <room> element
 void XmlMapStorage::loadRoom(QXmlStreamReader &stream)
 {
-    const SharedRoom sharedroom = Room::createPermanentRoom(m_mapData);
-    Room &room = deref(sharedroom);
-
-    const QXmlStreamAttributes attrs = stream.attributes();
-    const QStringView idstr = attrs.value("id");
-    const RoomId roomId = loadRoomId(stream, idstr);
-    if (m_loadedRooms.count(roomId) != 0) {
-        throwErrorFmt(stream, "duplicate room id \"%1\"", idstr.toString());
+    LoadedRoom room;
+    QStringView idstr;
+    room.upToDate = true;
+    for (const QXmlStreamAttribute &attr : stream.attributes()) {
+        switch (getXmlAttribute(attr.name())) {
+        case XmlAttributeEnum::ID:
+            idstr = attr.value();
+            break;
+        case XmlAttributeEnum::NAME:
+            room.Name = RoomName{attr.value().toString()};
+            break;
+        case XmlAttributeEnum::UPTODATE:
+            room.upToDate = (attr.value() != QLatin1String("false"));
+            break;
+        default:
+            break;
+        }
     }
-    room.setId(roomId);
-    if (attrs.value("uptodate") == "false") {
-        room.setOutDated();
-    } else {
-        room.setUpToDate();
+    room.id = loadRoomId(stream, idstr);
+    if (!m_loadedRoomIndex.emplace(room.id, m_loadedRooms.size()).second) {
+        throwErrorFmt(stream, "duplicate room id \"%1\"", idstr.toString());
     }
-    room.setName(RoomName{attrs.value("name").toString()});
 
-    ExitsList exitList;
-    RoomLoadFlags loadFlags;
-    RoomMobFlags mobFlags;
     RoomElementEnum found = RoomElementEnum::NONE;
 
     while (stream.readNextStartElement() && !stream.hasError()) {
-        const std::u16string_view name = as_u16string_view(stream.name());
-        if (name == "align") {
+        switch (getXmlElement(stream.name())) {
+        case XmlElementEnum::ALIGN:
             throwIfDuplicate(stream, found, RoomElementEnum::ALIGN);
-            room.setAlignType(loadEnum<RoomAlignEnum>(stream));
-        } else if (name == "contents") {
+            room.AlignType = loadEnum<RoomAlignEnum>(stream);
+            break;
+        case XmlElementEnum::CONTENTS:
             throwIfDuplicate(stream, found, RoomElementEnum::CONTENTS);
-            room.setContents(RoomContents{loadString(stream)});
-        } else if (name == "coord") {
+            room.Contents = RoomContents{loadString(stream)};
+            break;
+        case XmlElementEnum::COORD:
             throwIfDuplicate(stream, found, RoomElementEnum::POSITION);
-            room.setPosition(loadCoordinate(stream));
-        } else if (name == "description") {
+            room.position = loadCoordinate(stream);
+            break;
+        case XmlElementEnum::DESCRIPTION:
             throwIfDuplicate(stream, found, RoomElementEnum::DESCRIPTION);
-            room.setDescription(RoomDesc{loadString(stream)});
-        } else if (name == "exit") {
-            loadExit(stream, exitList);
-        } else if (name == "light") {
+            room.Description = RoomDesc{loadString(stream)};
+            break;
+        case XmlElementEnum::EXIT:
+            loadExit(stream, room.exits);
+            break;
+        case XmlElementEnum::LIGHT:
             throwIfDuplicate(stream, found, RoomElementEnum::LIGHT);
-            room.setLightType(loadEnum<RoomLightEnum>(stream));
-        } else if (name == "loadflag") {
-            loadFlags |= loadEnum<RoomLoadFlagEnum>(stream);
-        } else if (name == "mobflag") {
-            mobFlags |= loadEnum<RoomMobFlagEnum>(stream);
-        } else if (name == "note") {
+            room.LightType = loadEnum<RoomLightEnum>(stream);
+            break;
+        case XmlElementEnum::LOADFLAG:
+            room.LoadFlags |= loadEnum<RoomLoadFlagEnum>(stream);
+            break;
+        case XmlElementEnum::MOBFLAG:
+            room.MobFlags |= loadEnum<RoomMobFlagEnum>(stream);
+            break;
+        case XmlElementEnum::NOTE:
             throwIfDuplicate(stream, found, RoomElementEnum::NOTE);
-            room.setNote(RoomNote{loadString(stream)});
-        } else if (name == "portable") {
+            room.Note = RoomNote{loadString(stream)};
+            break;
+        case XmlElementEnum::PORTABLE:
             throwIfDuplicate(stream, found, RoomElementEnum::PORTABLE);
-            room.setPortableType(loadEnum<RoomPortableEnum>(stream));
-        } else if (name == "ridable") {
+            room.PortableType = loadEnum<RoomPortableEnum>(stream);
+            break;
+        case XmlElementEnum::RIDABLE:
             throwIfDuplicate(stream, found, RoomElementEnum::RIDABLE);
-            room.setRidableType(loadEnum<RoomRidableEnum>(stream));
-        } else if (name == "sundeath") {
+            room.RidableType = loadEnum<RoomRidableEnum>(stream);
+            break;
+        case XmlElementEnum::SUNDEATH:
             throwIfDuplicate(stream, found, RoomElementEnum::SUNDEATH);
-            room.setSundeathType(loadEnum<RoomSundeathEnum>(stream));
-        } else if (name == "terrain") {
+            room.SundeathType = loadEnum<RoomSundeathEnum>(stream);
+            break;
+        case XmlElementEnum::TERRAIN:
             throwIfDuplicate(stream, found, RoomElementEnum::TERRAIN);
-            room.setTerrainType(loadEnum<RoomTerrainEnum>(stream));
-        } else {
+            room.TerrainType = loadEnum<RoomTerrainEnum>(stream);
+            break;
+        default:
             qWarning().noquote().nospace()
                 << "At line " << stream.lineNumber() << ": ignoring unexpected XML element <"
                 << stream.name() << "> inside <room id=\"" << idstr << "\">";
+            break;
         }
         skipXmlElement(stream);
     }
-    room.setExitsList(exitList);
-    room.setLoadFlags(loadFlags);
-    room.setMobFlags(mobFlags);
 
-    m_loadedRooms.emplace(std::move(roomId), std::move(sharedroom));
+    m_loadedRooms.emplace_back(std::move(room));
 }
 
 // convert string to RoomId
 RoomId XmlMapStorage::loadRoomId(QXmlStreamReader &stream, const QStringView idstr)
 {
-    bool fail = false;
+    // only plain decimal numbers without leading zeros, so that every room ID
+    // is written back exactly as it was read
+    const bool canonical = !idstr.isEmpty() && (idstr.size() == 1 || idstr.front() != '0')
+                           && std::all_of(idstr.begin(), idstr.end(), [](const QChar c) {
+                                  return c >= '0' && c <= '9';
+                              });
+    bool fail = !canonical;
     const RoomId id{conv.toInteger<uint32_t>(idstr, fail)};
-    // convert number back to string, and compare the two:
-    // if they differ, room ID is invalid.
-    if (fail || idstr != roomIdToString(id)) {
+    if (fail) {
         throwErrorFmt(stream, "invalid room id \"%1\"", idstr.toString());
     }
     return id;
@@ -401,17 +528,34 @@ RoomId XmlMapStorage::loadRoomId(QXmlStreamReader &stream, const QStringView ids
 // load current <coord> element
 Coordinate XmlMapStorage::loadCoordinate(QXmlStreamReader &stream)
 {
-    const QXmlStreamAttributes attrs = stream.attributes();
+    QStringView xstr;
+    QStringView ystr;
+    QStringView zstr;
+    for (const QXmlStreamAttribute &attr : stream.attributes()) {
+        switch (getXmlAttribute(attr.name())) {
+        case XmlAttributeEnum::COORD_X:
+            xstr = attr.value();
+            break;
+        case XmlAttributeEnum::COORD_Y:
+            ystr = attr.value();
+            break;
+        case XmlAttributeEnum::COORD_Z:
+            zstr = attr.value();
+            break;
+        default:
+            break;
+        }
+    }
     bool fail = false;
-    const int x = conv.toInteger<int>(attrs.value("x"), fail);
-    const int y = conv.toInteger<int>(attrs.value("y"), fail);
-    const int z = conv.toInteger<int>(attrs.value("z"), fail);
+    const int x = conv.toInteger<int>(xstr, fail);
+    const int y = conv.toInteger<int>(ystr, fail);
+    const int z = conv.toInteger<int>(zstr, fail);
     if (fail) {
         throwErrorFmt(stream,
                       "invalid coordinate values x=\"%1\" y=\"%2\" z=\"%3\"",
-                      attrs.value("x").toString(),
-                      attrs.value("y").toString(),
-                      attrs.value("z").toString());
+                      xstr.toString(),
+                      ystr.toString(),
+                      zstr.toString());
     }
     return Coordinate(x, y, z);
 }
@@ -457,24 +601,42 @@ static ExitDirEnum directionForLowercase(const std::u16string_view lowcase)
 void XmlMapStorage::loadExit(QXmlStreamReader &stream, ExitsList &exitList)
 {
     const QXmlStreamAttributes attrs = stream.attributes();
-    const ExitDirEnum dir = directionForLowercase(as_u16string_view(attrs.value("dir")));
+    QStringView dirstr;
+    QStringView doorname;
+    for (const QXmlStreamAttribute &attr : attrs) {
+        switch (getXmlAttribute(attr.name())) {
+        case XmlAttributeEnum::DIR:
+            dirstr = attr.value();
+            break;
+        case XmlAttributeEnum::DOORNAME:
+            doorname = attr.value();
+            break;
+        default:
+            break;
+        }
+    }
+    const ExitDirEnum dir = directionForLowercase(as_u16string_view(dirstr));
     DoorFlags doorFlags;
     ExitFlags exitFlags;
     Exit &exit = exitList[dir];
-    exit.setDoorName(DoorName{attrs.value("doorname").toString()});
+    exit.setDoorName(DoorName{doorname.toString()});
 
     while (stream.readNextStartElement() && !stream.hasError()) {
-        const std::u16string_view name = as_u16string_view(stream.name());
-        if (name == "to") {
+        switch (getXmlElement(stream.name())) {
+        case XmlElementEnum::TO:
             exit.addOut(loadRoomId(stream, loadStringView(stream)));
-        } else if (name == "doorflag") {
+            break;
+        case XmlElementEnum::DOORFLAG:
             doorFlags |= loadEnum<DoorFlagEnum>(stream);
-        } else if (name == "exitflag") {
+            break;
+        case XmlElementEnum::EXITFLAG:
             exitFlags |= loadEnum<ExitFlagEnum>(stream);
-        } else {
+            break;
+        default:
             qWarning().noquote().nospace()
                 << "At line " << stream.lineNumber() << ": ignoring unexpected XML element <"
                 << stream.name() << "> inside <exit>";
+            break;
         }
         skipXmlElement(stream);
     }
@@ -487,8 +649,9 @@ void XmlMapStorage::loadExit(QXmlStreamReader &stream, ExitsList &exitList)
 // and add matching exits "from"
 void XmlMapStorage::connectRoomsExitFrom(QXmlStreamReader &stream)
 {
-    for (auto &elem : m_loadedRooms) {
-        const Room &room = deref(elem.second);
+    // The rooms are still plain data, so nothing is notified until they are
+    // added to the map.
+    for (const LoadedRoom &room : m_loadedRooms) {
         for (const ExitDirEnum dir : ALL_EXITS7) {
             connectRoomExitFrom(stream, room, dir);
         }
@@ -496,35 +659,35 @@ void XmlMapStorage::connectRoomsExitFrom(QXmlStreamReader &stream)
 }
 
 void XmlMapStorage::connectRoomExitFrom(QXmlStreamReader &stream,
-                                        const Room &fromRoom,
+                                        const LoadedRoom &fromRoom,
                                         const ExitDirEnum dir)
 {
-    const Exit &fromE = fromRoom.exit(dir);
+    const Exit &fromE = fromRoom.exits[dir];
     if (fromE.outIsEmpty()) {
         return;
     }
-    const RoomId fromId = fromRoom.getId();
+    const RoomId fromId = fromRoom.id;
     for (const RoomId toId : fromE.outRange()) {
-        const auto iter = m_loadedRooms.find(toId);
-        if (iter == m_loadedRooms.end()) {
+        const auto iter = m_loadedRoomIndex.find(toId);
+        if (iter == m_loadedRoomIndex.end()) {
             throwErrorFmt(stream,
                           "room %1 has exit %2 to non-existing room %3",
                           roomIdToString(fromId),
                           lowercaseDirection(dir),
                           roomIdToString(toId));
         }
-        Room &toRoom = deref(iter->second);
-        toRoom.addInExit(opposite(dir), fromId);
+        m_loadedRooms[iter->second].exits[opposite(dir)].addIn(fromId);
     }
 }
 
 // add all loaded rooms to m_mapData
 void XmlMapStorage::moveRoomsToMapData()
 {
-    for (const auto &elem : m_loadedRooms) {
-        m_mapData.insertPredefinedRoom(elem.second);
+    for (LoadedRoom &room : m_loadedRooms) {
+        m_mapData.insertPredefinedRoom(createRoom(m_mapData, std::move(room)));
     }
     m_loadedRooms.clear();
+    m_loadedRoomIndex.clear();
 }
 
 void XmlMapStorage::loadMarker(QXmlStreamReader &stream)
@@ -677,9 +840,7 @@ void XmlMapStorage::throwIfDuplicate(QXmlStreamReader &stream,
 bool XmlMapStorage::saveData(bool baseMapOnly)
 {
     log("Writing data to file ...");
-    QXmlStreamWriter stream(m_file);
-    saveWorld(stream, baseMapOnly);
-    stream.writeEndDocument();
+    saveWorld(deref(m_file), baseMapOnly);
     log("Writing data finished.");
 
     m_mapData.unsetDataChanged();
@@ -687,7 +848,24 @@ bool XmlMapStorage::saveData(bool baseMapOnly)
     return true;
 }
 
-void XmlMapStorage::saveWorld(QXmlStreamWriter &stream, bool baseMapOnly)
+// Rooms per part; each part also writes the prolog and a primer room.
+static constexpr const size_t ROOMS_PER_PART = 512;
+
+template<typename Write>
+QByteArray XmlMapStorage::writeXmlPart(const Room *const primer, Write &&write)
+{
+    QByteArray buffer;
+    QXmlStreamWriter stream{&buffer};
+    saveProlog(stream);
+    if (primer != nullptr) {
+        saveRoom(stream, *primer);
+    }
+    const int offset = buffer.size();
+    write(stream);
+    return buffer.mid(offset);
+}
+
+void XmlMapStorage::saveWorld(QIODevice &device, bool baseMapOnly)
 {
     // Collect the room and marker lists. The room list can't be acquired
     // directly apparently and we have to go through a RoomSaver which receives
@@ -709,24 +887,47 @@ void XmlMapStorage::saveWorld(QXmlStreamWriter &stream, bool baseMapOnly)
     progressCounter.increaseTotalStepsBy(saver.getRoomsCount()
                                          + static_cast<uint32_t>(markerList.size()));
 
+    // The map's start tag is still open, so it ends with its last attribute.
+    QByteArray prolog;
+    {
+        QXmlStreamWriter stream{&prolog};
+        saveProlog(stream);
+    }
+
+    const std::vector<QByteArray> rooms = saveRooms(baseMapOnly, roomList);
+    const bool anyRooms = std::any_of(rooms.begin(), rooms.end(), [](const QByteArray &part) {
+        return !part.isEmpty();
+    });
+
+    const QByteArray epilog = writeXmlPart(anyRooms ? roomList.front().get() : nullptr,
+                                           [this, &markerList](QXmlStreamWriter &stream) {
+                                               saveMarkers(stream, markerList);
+                                               // write selected room x,y,z
+                                               saveCoordinate(stream,
+                                                              "position",
+                                                              m_mapData.getPosition());
+                                               stream.writeEndElement(); // end map
+                                               stream.writeEndDocument();
+                                           });
+
+    device.write(prolog);
+    for (const QByteArray &part : rooms) {
+        device.write(part);
+    }
+    device.write(epilog);
+}
+
+void XmlMapStorage::saveProlog(QXmlStreamWriter &stream)
+{
     stream.setAutoFormatting(true);
     stream.writeStartDocument();
 
     stream.writeStartElement("map");
     saveXmlAttribute(stream, "type", "mmapper2xml");
     saveXmlAttribute(stream, "version", "1.0.0");
-
-    saveRooms(stream, baseMapOnly, roomList);
-    saveMarkers(stream, markerList);
-    // write selected room x,y,z
-    saveCoordinate(stream, "position", m_mapData.getPosition());
-
-    stream.writeEndElement(); // end map
 }
 
-void XmlMapStorage::saveRooms(QXmlStreamWriter &stream,
-                              bool baseMapOnly,
-                              const ConstRoomList &roomList)
+std::vector<QByteArray> XmlMapStorage::saveRooms(bool baseMapOnly, const ConstRoomList &roomList)
 {
     ProgressCounter &progressCounter = getProgressCounter();
     BaseMapSaveFilter filter;
@@ -735,11 +936,39 @@ void XmlMapStorage::saveRooms(QXmlStreamWriter &stream,
         progressCounter.increaseTotalStepsBy(filter.prepareCount());
         filter.prepare(progressCounter);
     }
-    auto saveOne = [&stream](const Room &room) { saveRoom(stream, room); };
-    for (const auto &pRoom : roomList) {
-        filter.visitRoom(deref(pRoom), baseMapOnly, saveOne);
-        progressCounter.step();
+
+    // Every part but the first assumes a room was written before it.
+    const auto savePart = [&filter, baseMapOnly, &progressCounter, &roomList](const size_t part,
+                                                                          const bool primed) {
+        const size_t begin = part * ROOMS_PER_PART;
+        const size_t end = std::min(roomList.size(), begin + ROOMS_PER_PART);
+        const Room *const primer = primed ? roomList[begin - 1].get() : nullptr;
+        return writeXmlPart(primer, [&](QXmlStreamWriter &stream) {
+            auto saveOne = [&stream](const Room &room) { saveRoom(stream, room); };
+            for (size_t i = begin; i < end; ++i) {
+                filter.visitRoom(deref(roomList[i]), baseMapOnly, saveOne);
+                progressCounter.step();
+            }
+        });
+    };
+
+    std::vector<QByteArray> parts((roomList.size() + ROOMS_PER_PART - 1) / ROOMS_PER_PART);
+    parallelFor(
+        parts.size(),
+        [&parts, &savePart](const size_t i) { parts[i] = savePart(i, i != 0); },
+        1);
+
+    // ... which isn't true before the first room that was actually written.
+    const auto first = std::find_if(parts.begin(), parts.end(), [](const QByteArray &part) {
+        return !part.isEmpty();
+    });
+    if (first != parts.end() && first != parts.begin()) {
+        const auto i = static_cast<size_t>(first - parts.begin());
+        progressCounter.increaseTotalStepsBy(
+            static_cast<uint32_t>(std::min(ROOMS_PER_PART, roomList.size() - i * ROOMS_PER_PART)));
+        *first = savePart(i, false);
     }
+    return parts;
 }
 
 void XmlMapStorage::saveRoom(QXmlStreamWriter &stream, const Room &room)
@@ -764,8 +993,8 @@ void XmlMapStorage::saveRoom(QXmlStreamWriter &stream, const Room &room)
     for (const ExitDirEnum dir : ALL_EXITS7) {
         saveExit(stream, room.exit(dir), dir);
     }
-    saveXmlElement(stream, "description", room.getDescription().toQString());
-    saveXmlElement(stream, "contents", room.getContents().toQString());
+    saveXmlElement(stream, "description", room.readDescription().toQString());
+    saveXmlElement(stream, "contents", room.readContents().toQString());
     saveXmlElement(stream, "note", room.getNote().toQString());
 
     stream.writeEndElement(); // end room
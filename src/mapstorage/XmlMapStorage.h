@@ -6,14 +6,17 @@
 
 #include <string_view>
 #include <unordered_map>
+#include <vector>
 #include <QString>
 #include <QtCore>
 
 #include "../global/macros.h"
 #include "../mapdata/mapdata.h"
+#include "LoadedRoom.h"
 #include "abstractmapstorage.h"
 #include "mapstorage.h" // MapFrontendBlocker
 
+class QIODevice;
 class QObject;
 class QXmlStreamWriter;
 
@@ -48,7 +51,9 @@ class XmlMapStorage final : public AbstractMapStorage
     void loadNotifyProgress(QXmlStreamReader &stream);
 
     void connectRoomsExitFrom(QXmlStreamReader &stream);
-    void connectRoomExitFrom(QXmlStreamReader &stream, const Room &fromRoom, const ExitDirEnum dir);
+    void connectRoomExitFrom(QXmlStreamReader &stream,
+                             const LoadedRoom &fromRoom,
+                             const ExitDirEnum dir);
     void moveRoomsToMapData();
 
     enum class RoomElementEnum : uint32_t {
@@ -88,14 +93,24 @@ class XmlMapStorage final : public AbstractMapStorage
                                  RoomElementEnum &set,
                                  RoomElementEnum curr);
 
-    std::unordered_map<RoomId, SharedRoom> m_loadedRooms;
+    // rooms are kept as plain data until every exit has been linked
+    std::vector<LoadedRoom> m_loadedRooms;
+    std::unordered_map<RoomId, size_t> m_loadedRoomIndex;
     uint64_t m_loadProgressDivisor;
     uint32_t m_loadProgress;
     static constexpr const uint32_t LOAD_PROGRESS_MAX = 100;
 
     // ---------------- save map -------------------
-    void saveWorld(QXmlStreamWriter &stream, bool baseMapOnly);
-    void saveRooms(QXmlStreamWriter &stream, bool baseMapOnly, const ConstRoomList &roomList);
+    // The file is written in parts, each by its own writer: everything up to
+    // the rooms, the rooms in chunks (in parallel), and the rest. Every writer
+    // starts with the prolog, and a room if one comes before its part, so its
+    // part comes out exactly as a single writer would have written it.
+    void saveWorld(QIODevice &device, bool baseMapOnly);
+    NODISCARD std::vector<QByteArray> saveRooms(bool baseMapOnly, const ConstRoomList &roomList);
+    static void saveProlog(QXmlStreamWriter &stream);
+    // Returns just what `write` adds after the prolog and the `primer` room.
+    template<typename Write>
+    NODISCARD static QByteArray writeXmlPart(const Room *primer, Write &&write);
     static void saveRoom(QXmlStreamWriter &stream, const Room &room);
     static void saveRoomLoadFlags(QXmlStreamWriter &stream, const RoomLoadFlags fl);
     static void saveRoomMobFlags(QXmlStreamWriter &stream, const RoomMobFlags fl);
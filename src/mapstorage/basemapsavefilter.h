@@ -18,6 +18,8 @@ class ProgressCounter;
 
 /*! \brief Filters
  *
+ * Once prepare() has run, filter() and visitRoom() only read the prepared
+ * state, so they can be called for different rooms from several threads.
  */
 class NODISCARD BaseMapSaveFilter final : public RoomRecipient
 {
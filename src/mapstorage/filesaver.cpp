@@ -65,3 +65,14 @@ void FileSaver::close() noexcept(false)
     remove_tmp_suffix(m_filename);
     m_file.close();
 }
+
+void FileSaver::discard()
+{
+    if (!m_file.isOpen()) {
+        return;
+    }
+    m_file.close();
+    if (USE_TMP_SUFFIX) {
+        m_file.remove();
+    }
+}
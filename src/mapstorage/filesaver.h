@@ -38,4 +38,9 @@ class FileSaver final
     /*! \exception std::runtime_error if the file can't be safely closed.
      */
     void close() noexcept(false);
+
+    /*! Closes the file without replacing the original (where the temporary
+     * file is supported), and removes what was written.
+     */
+    void discard();
 };
@@ -8,13 +8,20 @@
 
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
 #include <stdexcept>
+#include <string>
+#include <string_view>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 #include <QString>
 
 #include "../expandoracommon/coordinate.h"
 #include "../expandoracommon/exit.h"
 #include "../expandoracommon/room.h"
+#include "../global/hash.h"
+#include "../global/parallel.h"
 #include "../global/roomid.h"
 #include "../global/utils.h"
 #include "../mapdata/DoorFlags.h"
@@ -23,6 +30,7 @@
 #include "../mapdata/mapdata.h"
 #include "../mapdata/mmapper2room.h"
 #include "../parser/parserutils.h"
+#include "WebTileExporter.h"
 #include "abstractmapstorage.h"
 #include "basemapsavefilter.h"
 #include "progresscounter.h"
@@ -35,6 +43,8 @@ namespace {
 static constexpr const int c_roomIndexFileNameSize = 2;
 // Split the world into 20x20 zones
 static constexpr const int ZONE_WIDTH = 20;
+// MMapper's own record of the zones it wrote; the JS code never reads it.
+static constexpr const auto ZONE_MANIFEST_FILENAME = "zone-hashes.json";
 
 /* Performs MD5 hashing on ASCII-transliterated, whitespace-normalized name+descs.
  * MD5 is for convenience (easily available in all languages), the rest makes
@@ -86,7 +96,7 @@ class NODISCARD RoomHashIndex final
     void addRoom(const Room &room)
     {
         m_hasher.add(room.getName().toQString() + "\n");
-        m_hasher.add(room.getDescription().toQString());
+        m_hasher.add(room.readDescription().toQString());
         m_index.insert(m_hasher.result().toHex(), room.getPosition());
         m_hasher.reset();
     }
@@ -137,10 +147,8 @@ class NODISCARD ZoneIndex final
     NODISCARD const Index &index() const { return m_index; }
 };
 
-template<typename JsonT>
-static void writeJson(const QString &filePath, JsonT &json, const QString &what)
+static void writeFile(const QString &filePath, const QByteArray &data, const QString &what)
 {
-    static_assert(std::is_same_v<JsonT, QJsonObject> || std::is_same_v<JsonT, QJsonArray>);
     QFile file(filePath);
     if (!file.open(QIODevice::WriteOnly)) {
         QString msg(
@@ -148,17 +156,83 @@ static void writeJson(const QString &filePath, JsonT &json, const QString &what)
         throw std::runtime_error(::toStdStringUtf8(msg));
     }
 
-    QJsonDocument doc(json);
-    QTextStream stream(&file);
-    stream << doc.toJson();
-    stream.flush();
-    if (!file.flush() || stream.status() != QTextStream::Ok) {
+    if (file.write(data) != data.size() || !file.flush()) {
         QString msg(
             QString("error writing %1 to %2: %3").arg(what).arg(filePath).arg(file.errorString()));
         throw std::runtime_error(::toStdStringUtf8(msg));
     }
 }
 
+// QJsonDocument::toJson() is already UTF-8.
+template<typename JsonT>
+static void writeJson(const QString &filePath, JsonT &json, const QString &what)
+{
+    static_assert(std::is_same_v<JsonT, QJsonObject> || std::is_same_v<JsonT, QJsonArray>);
+    writeFile(filePath, QJsonDocument(json).toJson(), what);
+}
+
+NODISCARD static QString getZoneFileName(const std::string &zone)
+{
+    return ::toQStringUtf8(zone + ".json");
+}
+
+// The hash of every zone file written by the previous export, so the next
+// export only has to rewrite the zones that changed, and can remove the
+// ones that no longer have any rooms.
+class NODISCARD ZoneManifest final
+{
+public:
+    using Hashes = std::unordered_map<std::string, uint64_t>;
+
+private:
+    static constexpr const int VERSION = 1;
+    Hashes m_hashes;
+
+public:
+    // A missing or unreadable manifest only means every zone is rewritten.
+    void read(const QString &filePath)
+    {
+        m_hashes.clear();
+        QFile file(filePath);
+        if (!file.open(QIODevice::ReadOnly)) {
+            return;
+        }
+        const QJsonObject json = QJsonDocument::fromJson(file.readAll()).object();
+        if (json.value("version").toInt() != VERSION) {
+            return;
+        }
+        const QJsonObject zones = json.value("zones").toObject();
+        for (auto it = zones.constBegin(); it != zones.constEnd(); ++it) {
+            // Stale zone files are deleted, so only take names this code could
+            // have written.
+            const std::string zone = ::toStdStringUtf8(it.key());
+            if (zone.empty() || zone.find_first_not_of("-,0123456789") != std::string::npos) {
+                continue;
+            }
+            bool ok = false;
+            const uint64_t hash = it.value().toString().toULongLong(&ok, 16);
+            if (ok) {
+                m_hashes.emplace(zone, hash);
+            }
+        }
+    }
+
+    void write(const QString &filePath) const
+    {
+        QJsonObject zones;
+        for (const auto &kv : m_hashes) {
+            zones.insert(::toQStringUtf8(kv.first), QString::number(kv.second, 16));
+        }
+        QJsonObject json;
+        json["version"] = VERSION;
+        json["zones"] = zones;
+        writeJson(filePath, json, "zone manifest");
+    }
+
+    NODISCARD Hashes takeHashes() { return std::exchange(m_hashes, {}); }
+    void set(const std::string &zone, const uint64_t hash) { m_hashes[zone] = hash; }
+};
+
 class NODISCARD RoomIndexStore final
 {
     const QDir m_dir;
@@ -261,10 +335,12 @@ class JsonWorld final
                   bool baseMapOnly);
     void writeMetadata(const QFileInfo &path, const MapData &mapData) const;
     void writeRoomIndex(const QDir &dir) const;
-    void writeZones(const QDir &dir,
-                    BaseMapSaveFilter &filter,
-                    ProgressCounter &progressCounter,
-                    bool baseMapOnly) const;
+    // Returns the number of zone files that had to be (re)written.
+    NODISCARD size_t writeZones(const QDir &dir,
+                                ZoneManifest &manifest,
+                                BaseMapSaveFilter &filter,
+                                ProgressCounter &progressCounter,
+                                bool baseMapOnly) const;
 };
 
 JsonWorld::JsonWorld() = default;
@@ -376,7 +452,7 @@ void JsonWorld::addRoom(QJsonArray &jRooms, const Room &room) const
     uint jsonId = m_jRoomIds[room.getId()];
     jr["id"] = QString::number(jsonId);
     jr["name"] = room.getName().toQString();
-    jr["desc"] = room.getDescription().toQString();
+    jr["desc"] = room.readDescription().toQString();
     jr["sector"] = static_cast<quint8>(room.getTerrainType());
     jr["light"] = static_cast<quint8>(room.getLightType());
     jr["portable"] = static_cast<quint8>(room.getPortableType());
@@ -418,31 +494,90 @@ void JsonWorld::addExits(const Room &room, QJsonObject &jr) const
     jr["exits"] = jExits;
 }
 
-void JsonWorld::writeZones(const QDir &dir,
-                           BaseMapSaveFilter &filter,
-                           ProgressCounter &progressCounter,
-                           bool baseMapOnly) const
+size_t JsonWorld::writeZones(const QDir &dir,
+                             ZoneManifest &manifest,
+                             BaseMapSaveFilter &filter,
+                             ProgressCounter &progressCounter,
+                             bool baseMapOnly) const
 {
-    const ZoneIndex::Index &index = m_zoneIndex.index();
+    struct NODISCARD Zone final
+    {
+        const std::string *key = nullptr;
+        const ConstRoomList *rooms = nullptr;
+        QByteArray json;
+        uint64_t hash = 0;
+    };
 
+    const ZoneIndex::Index &index = m_zoneIndex.index();
+    std::vector<Zone> zones;
+    zones.reserve(index.size());
     for (const auto &kv : index) {
-        const ConstRoomList &rooms = kv.second;
-        QJsonArray jRooms;
-        auto saveOne = [this, &jRooms](const Room &room) { addRoom(jRooms, room); };
-        for (const auto &pRoom : rooms) {
-            filter.visitRoom(deref(pRoom), baseMapOnly, saveOne);
-            progressCounter.step();
+        Zone zone;
+        zone.key = &kv.first;
+        zone.rooms = &kv.second;
+        zones.emplace_back(std::move(zone));
+    }
+
+    // Zones only share the rooms and the filter, which are just read, so
+    // they are all serialised (and hashed) at once.
+    std::vector<std::string> errors(zones.size());
+    parallelFor(
+        zones.size(),
+        [this, baseMapOnly, &filter, &zones, &errors](const size_t i) {
+            try {
+                Zone &zone = zones[i];
+                QJsonArray jRooms;
+                auto saveOne = [this, &jRooms](const Room &room) { addRoom(jRooms, room); };
+                for (const auto &pRoom : deref(zone.rooms)) {
+                    filter.visitRoom(deref(pRoom), baseMapOnly, saveOne);
+                }
+                zone.json = QJsonDocument(jRooms).toJson();
+                zone.hash = stable_hash64(
+                    std::string_view{zone.json.constData(), static_cast<size_t>(zone.json.size())});
+            } catch (const std::exception &ex) {
+                errors[i] = ex.what();
+            }
+        },
+        1);
+    for (const std::string &error : errors) {
+        if (!error.empty()) {
+            throw std::runtime_error(error);
+        }
+    }
+
+    ZoneManifest::Hashes previous = manifest.takeHashes();
+    size_t written = 0;
+    for (Zone &zone : zones) {
+        const std::string &key = deref(zone.key);
+        const QString filePath = dir.filePath(getZoneFileName(key));
+        const auto it = previous.find(key);
+        if (it == previous.end() || it->second != zone.hash || !QFile::exists(filePath)) {
+            writeFile(filePath, zone.json, "zone");
+            ++written;
         }
+        if (it != previous.end()) {
+            previous.erase(it);
+        }
+        manifest.set(key, zone.hash);
+        zone.json.clear();
+        progressCounter.step(static_cast<quint32>(deref(zone.rooms).size()));
+    }
 
-        QString filePath = dir.filePath(::toQStringUtf8(kv.first + ".json"));
-        writeJson(filePath, jRooms, "zone");
+    // These zones don't have any rooms left.
+    for (const auto &kv : previous) {
+        QFile::remove(dir.filePath(getZoneFileName(kv.first)));
     }
+    return written;
 }
 
 } // namespace
 
-JsonMapStorage::JsonMapStorage(MapData &mapdata, const QString &filename, QObject *parent)
+JsonMapStorage::JsonMapStorage(MapData &mapdata,
+                               const QString &filename,
+                               QObject *parent,
+                               const bool withTiles)
     : AbstractMapStorage(mapdata, filename, parent)
+    , m_withTiles{withTiles}
 {}
 
 JsonMapStorage::~JsonMapStorage() = default;
@@ -514,7 +649,36 @@ bool JsonMapStorage::saveData(bool baseMapOnly)
 
         world.writeMetadata(QFileInfo(destDir, "arda.json"), m_mapData);
         world.writeRoomIndex(roomIndexDir);
-        world.writeZones(zoneDir, filter, progressCounter, baseMapOnly);
+
+        const QString manifestPath = destDir.filePath(ZONE_MANIFEST_FILENAME);
+        ZoneManifest manifest;
+        manifest.read(manifestPath);
+        const size_t written = world.writeZones(zoneDir,
+                                                manifest,
+                                                filter,
+                                                progressCounter,
+                                                baseMapOnly);
+        manifest.write(manifestPath);
+        log(QString("Wrote %1 changed zones.").arg(written));
+
+        if (m_withTiles) {
+            std::vector<web_tiles::TileRoom> tileRooms;
+            tileRooms.reserve(roomList.size());
+            for (const SharedConstRoom &pRoom : roomList) {
+                const Room &room = deref(pRoom);
+                if (!room.isTemporary()) {
+                    filter.visitRoom(room, baseMapOnly, [&tileRooms](const Room &visited) {
+                        tileRooms.emplace_back(web_tiles::TileRoom::fromRoom(visited));
+                    });
+                }
+            }
+            const QDir tileDir(QFileInfo(destDir, "tiles").filePath());
+            if (!dir.mkpath(tileDir.path())) {
+                throw std::runtime_error("error creating dir v1/tiles");
+            }
+            const size_t tiles = web_tiles::writeTiles(tileDir, tileRooms, progressCounter);
+            log(QString("Drew %1 changed tiles.").arg(tiles));
+        }
     } catch (const std::exception &e) {
         log(e.what());
         return false;
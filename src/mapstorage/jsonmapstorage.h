@@ -20,13 +20,16 @@ class QObject;
  * - v1/arda.json (global metadata like map size).
  * - v1/roomindex/ss.json (room sums -> zone coords).
  * - v1/zone/xx-yy.json (full info on the NxN rooms zone at coords xx,yy).
+ * - v1/zone-hashes.json (hashes of the zone files, so that exporting to the
+ *   same directory again only rewrites the zones that changed).
+ * - v1/tiles/ (optionally, the map pre-rendered as tiles; see WebTileExporter.h).
  */
 class JsonMapStorage final : public AbstractMapStorage
 {
     Q_OBJECT
 
 public:
-    explicit JsonMapStorage(MapData &, const QString &, QObject *parent);
+    explicit JsonMapStorage(MapData &, const QString &, QObject *parent, bool withTiles = false);
     ~JsonMapStorage() final;
 
 public:
@@ -41,5 +44,8 @@ class JsonMapStorage final : public AbstractMapStorage
     NODISCARD bool saveData(bool baseMapOnly) override;
     NODISCARD bool mergeData() override;
     void log(const QString &msg) { emit sig_log("JsonMapStorage", msg); }
+
+private:
+    const bool m_withTiles;
     // void saveMark(InfoMark * mark, QJsonObject &jRoom, const JsonRoomIdsCache &jRoomIds);
 };
@@ -6,23 +6,33 @@
 
 #include "mapstorage.h"
 
+#include <algorithm>
 #include <climits>
 #include <cstdint>
+#include <functional>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <stdexcept>
+#include <string>
+#include <string_view>
 #include <type_traits>
 #include <utility>
+#include <vector>
 #include <QMessageLogContext>
 #include <QObject>
 #include <QtCore>
 #include <QtWidgets>
 
 #include "../configuration/configuration.h"
+#include "../expandoracommon/RoomTextBlock.h"
 #include "../expandoracommon/exit.h"
 #include "../expandoracommon/room.h"
+#include "../global/DeflateDictionary.h"
 #include "../global/Flags.h"
 #include "../global/io.h"
+#include "../global/parallel.h"
 #include "../global/roomid.h"
 #include "../global/utils.h"
 #include "../mapdata/DoorFlags.h"
@@ -32,6 +42,9 @@
 #include "../mapdata/mapdata.h"
 #include "../mapdata/mmapper2room.h"
 #include "../parser/patterns.h"
+#include "LoadedRoom.h"
+#include "MapJournal.h"
+#include "MapMerger.h"
 #include "StorageUtils.h"
 #include "abstractmapstorage.h"
 #include "basemapsavefilter.h"
@@ -46,7 +59,15 @@ static constexpr const int MMAPPER_2_4_0_SCHEMA = 33; // 16bit ExitsFlags, 32bit
 static constexpr const int MMAPPER_2_4_3_SCHEMA = 34; // qCompress, SunDeath flag
 static constexpr const int MMAPPER_2_5_1_SCHEMA = 35; // discard all previous NoMatch flags
 static constexpr const int MMAPPER_19_10_0_SCHEMA = 36; // switches to new coordinate system
-static constexpr const int CURRENT_SCHEMA = MMAPPER_19_10_0_SCHEMA;
+static constexpr const int MMAPPER_23_05_0_SCHEMA = 37; // rooms in independently compressed blocks
+static constexpr const int MMAPPER_24_02_0_SCHEMA = 38; // room blocks share a zlib dictionary
+static constexpr const int CURRENT_SCHEMA = MMAPPER_24_02_0_SCHEMA;
+
+// Rooms per block in MMAPPER_23_05_0_SCHEMA maps; enough blocks to keep every
+// core busy while loading the full map, with each one still compressing well.
+static constexpr const uint32_t ROOMS_PER_BLOCK = 1024;
+// Journals smaller than this are never compacted into a full save.
+static constexpr const qint64 JOURNAL_COMPACTION_SIZE = 256 * 1024;
 
 static_assert(021 == 17, "MMapper 2.0.0 Schema");
 static_assert(030 == 24, "MMapper 2.0.2 Schema");
@@ -124,6 +145,8 @@ MapStorage::MapStorage(MapData &mapdata, const QString &filename, QObject *paren
     : AbstractMapStorage(mapdata, filename, parent)
 {}
 
+MapStorage::~MapStorage() = default;
+
 void MapStorage::newData()
 {
     m_mapData.unsetDataChanged();
@@ -168,6 +191,15 @@ class NODISCARD LoadRoomHelper final
     }
 
 public:
+    template<typename T>
+    NODISCARD T read()
+    {
+        T result;
+        stream >> result;
+        check_status();
+        return result;
+    }
+
     NODISCARD auto read_u8()
     {
         uint8_t result;
@@ -254,44 +286,63 @@ NODISCARD static RoomTerrainEnum serialize(const uint32_t value)
     return static_cast<RoomTerrainEnum>(value);
 }
 
-SharedRoom MapStorage::loadRoom(QDataStream &stream, const uint32_t version)
+// The fixed-size room properties, in the order the file has them after the note,
+// with what they're written as, the schema that introduced that encoding, and what
+// older schemas have instead (void if nothing, in which case they're zero).
+#define XFOREACH_ROOM_FIXED_FIELD(X) \
+    X(TerrainType, uint8_t, MMAPPER_2_0_0_SCHEMA, void) \
+    X(LightType, uint8_t, MMAPPER_2_0_0_SCHEMA, void) \
+    X(AlignType, uint8_t, MMAPPER_2_0_0_SCHEMA, void) \
+    X(PortableType, uint8_t, MMAPPER_2_0_0_SCHEMA, void) \
+    X(RidableType, uint8_t, MMAPPER_2_0_2_SCHEMA, void) \
+    X(SundeathType, uint8_t, MMAPPER_2_4_0_SCHEMA, void) \
+    X(MobFlags, uint32_t, MMAPPER_2_4_0_SCHEMA, uint16_t) \
+    X(LoadFlags, uint32_t, MMAPPER_2_4_0_SCHEMA, uint16_t)
+
+#define X_COUNT(...) +1
+// The rest are the name, description, contents and note.
+static_assert(0 XFOREACH_ROOM_PROPERTY(X_COUNT) == 4 + (0 XFOREACH_ROOM_FIXED_FIELD(X_COUNT)),
+              "a room property is missing from the file layout");
+#undef X_COUNT
+
+#define X_SIZE(_Prop, _Wire, _Since, _Legacy) +sizeof(_Wire)
+// The fixed fields in the current schema, followed by the up-to-date flag and the position.
+static constexpr const size_t FIXED_ROOM_FIELDS_SIZE = 0 XFOREACH_ROOM_FIXED_FIELD(X_SIZE)
+    + sizeof(uint8_t) + 3 * sizeof(int32_t);
+#undef X_SIZE
+
+template<typename T, typename Wire>
+NODISCARD static T fromWire(const Wire value)
 {
-    // TODO: change schema to just store size and latin1 bytes for strings.
-    LoadRoomHelper helper{stream};
-    const SharedRoom room = Room::createPermanentRoom(m_mapData);
-    room->setName(RoomName{helper.read_string()});
-    room->setDescription(RoomDesc{helper.read_string()});
-    room->setContents(RoomContents{helper.read_string()});
-    room->setId(RoomId{helper.read_u32() + baseId});
-    room->setNote(RoomNote{helper.read_string()});
-    room->setTerrainType(serialize(helper.read_u8()));
-    room->setLightType(serialize<RoomLightEnum>(helper.read_u8()));
-    room->setAlignType(serialize<RoomAlignEnum>(helper.read_u8()));
-    room->setPortableType(serialize<RoomPortableEnum>(helper.read_u8()));
-    room->setRidableType(serialize<RoomRidableEnum>(
-        (version >= MMAPPER_2_0_2_SCHEMA) ? helper.read_u8() : uint8_t{0}));
-    room->setSundeathType(serialize<RoomSundeathEnum>(
-        (version >= MMAPPER_2_4_0_SCHEMA) ? helper.read_u8() : uint8_t{0}));
-    room->setMobFlags(serialize<RoomMobFlags>(
-        (version >= MMAPPER_2_4_0_SCHEMA) ? helper.read_u32() : helper.read_u16()));
-    room->setLoadFlags(serialize<RoomLoadFlags>(
-        (version >= MMAPPER_2_4_0_SCHEMA) ? helper.read_u32() : helper.read_u16()));
-    if (helper.read_u8() /*roomUpdated*/ != 0u) {
-        room->setUpToDate();
-    }
-
-    room->setPosition(transformRoomOnLoad(version, helper.readCoord3d() + basePosition));
-    loadExits(*room, stream, version);
-    return room;
+    if constexpr (std::is_same_v<T, RoomTerrainEnum>) {
+        return serialize(static_cast<uint32_t>(value));
+    } else {
+        return serialize<T>(value);
+    }
 }
 
-void MapStorage::loadExits(Room &room, QDataStream &stream, const uint32_t version)
+template<typename T, typename Wire, uint32_t Since, typename Legacy>
+NODISCARD static T readField(LoadRoomHelper &helper, const uint32_t version)
+{
+    if (version >= Since) {
+        return fromWire<T>(helper.read<Wire>());
+    }
+    if constexpr (std::is_void_v<Legacy>) {
+        return fromWire<T>(Wire{0});
+    } else {
+        return fromWire<T>(helper.read<Legacy>());
+    }
+}
+
+NODISCARD static ExitsList readExits(QDataStream &stream,
+                                     const uint32_t version,
+                                     const uint32_t baseId)
 {
     LoadRoomHelper helper{stream};
 
     ExitsList eList;
     for (const ExitDirEnum i : ALL_EXITS7) {
-        Exit &e = eList[i];
+        Exit e;
 
         // Read the exit flags
         if (version >= MMAPPER_2_4_0_SCHEMA) {
@@ -324,9 +375,445 @@ void MapStorage::loadExits(Room &room, QDataStream &stream, const uint32_t versi
              connection = helper.read_u32()) {
             e.addOut(RoomId{connection + baseId});
         }
+        eList.set(i, e);
+    }
+
+    return eList;
+}
+
+NODISCARD static LoadedRoom readRoom(QDataStream &stream,
+                                     const uint32_t version,
+                                     const uint32_t baseId,
+                                     const Coordinate &basePosition)
+{
+    // TODO: change schema to just store size and latin1 bytes for strings.
+    LoadRoomHelper helper{stream};
+    LoadedRoom room;
+    room.Name = RoomName{helper.read_string()};
+    room.Description = RoomDesc{helper.read_string()};
+    room.Contents = RoomContents{helper.read_string()};
+    room.id = RoomId{helper.read_u32() + baseId};
+    room.Note = RoomNote{helper.read_string()};
+#define X_READ(_Prop, _Wire, _Since, _Legacy) \
+    room._Prop = readField<decltype(room._Prop), _Wire, _Since, _Legacy>(helper, version);
+    XFOREACH_ROOM_FIXED_FIELD(X_READ)
+#undef X_READ
+    room.upToDate = (helper.read_u8() /*roomUpdated*/ != 0u);
+
+    room.position = transformRoomOnLoad(version, helper.readCoord3d() + basePosition);
+    room.exits = readExits(stream, version, baseId);
+    return room;
+}
+
+namespace { // anonymous
+
+// Decodes rooms written after MMAPPER_2_5_1_SCHEMA straight from an inflated
+// room block, reading the same bytes as readRoom() without going through
+// QDataStream for every field.
+class NODISCARD RoomBlockReader final
+{
+private:
+    const char *m_pos = nullptr;
+    const char *m_end = nullptr;
+
+public:
+    explicit RoomBlockReader(const QByteArray &data)
+        : m_pos{data.constData()}
+        , m_end{data.constData() + data.size()}
+    {}
+
+public:
+    NODISCARD bool atEnd() const { return m_pos == m_end; }
+    NODISCARD LoadedRoom readRoom(uint32_t baseId, const Coordinate &basePosition);
+
+private:
+    NODISCARD const char *take(const size_t bytes)
+    {
+        if (static_cast<size_t>(m_end - m_pos) < bytes) {
+            throw io::IOException("read past end of file");
+        }
+        return std::exchange(m_pos, m_pos + bytes);
+    }
+
+    template<typename T>
+    NODISCARD T read()
+    {
+        return qFromBigEndian<T>(take(sizeof(T)));
+    }
+
+    // Same format as QDataStream: the length in bytes, then UTF-16.
+    NODISCARD QString readString()
+    {
+        const auto bytes = read<uint32_t>();
+        if (bytes == UINT32_MAX) {
+            return QString{};
+        }
+        if (bytes % 2u != 0u) {
+            throw io::IOException("read corrupt data");
+        }
+        const char *const data = take(bytes);
+        const auto length = static_cast<int>(bytes / 2u);
+        QString result(length, Qt::Uninitialized);
+        qFromBigEndian<uint16_t>(data, length, result.data());
+        return result;
+    }
+
+    void readConnections(Exit &e, const uint32_t baseId, const bool in)
+    {
+        for (auto connection = read<uint32_t>(); connection != UINT_MAX;
+             connection = read<uint32_t>()) {
+            if (in) {
+                e.addIn(RoomId{connection + baseId});
+            } else {
+                e.addOut(RoomId{connection + baseId});
+            }
+        }
+    }
+};
+
+LoadedRoom RoomBlockReader::readRoom(const uint32_t baseId, const Coordinate &basePosition)
+{
+    LoadedRoom room;
+    room.Name = RoomName{readString()};
+    room.Description = RoomDesc{readString()};
+    room.Contents = RoomContents{readString()};
+    room.id = RoomId{read<uint32_t>() + baseId};
+    room.Note = RoomNote{readString()};
+
+    // Everything up to the exits has a fixed size, so it's checked once.
+    const char *pos = take(FIXED_ROOM_FIELDS_SIZE);
+#define X_DECODE(_Prop, _Wire, _Since, _Legacy) \
+    room._Prop = fromWire<decltype(room._Prop)>(qFromBigEndian<_Wire>(pos)); \
+    pos += sizeof(_Wire);
+    XFOREACH_ROOM_FIXED_FIELD(X_DECODE)
+#undef X_DECODE
+    room.upToDate = (*pos != 0);
+    pos += sizeof(uint8_t);
+    const auto x = qFromBigEndian<int32_t>(pos);
+    const auto y = qFromBigEndian<int32_t>(pos + sizeof(int32_t));
+    const auto z = qFromBigEndian<int32_t>(pos + 2 * sizeof(int32_t));
+    room.position = Coordinate{x, y, z} + basePosition;
+
+    for (const ExitDirEnum dir : ALL_EXITS7) {
+        Exit e;
+        const char *const flags = take(2 * sizeof(uint16_t));
+        e.setExitFlags(serialize<ExitFlags>(qFromBigEndian<uint16_t>(flags)));
+        e.setDoorFlags(serialize<DoorFlags>(qFromBigEndian<uint16_t>(flags + sizeof(uint16_t))));
+        e.setDoorName(static_cast<DoorName>(readString()));
+        readConnections(e, baseId, true);
+        readConnections(e, baseId, false);
+        room.exits.set(dir, e);
+    }
+    return room;
+}
+
+} // namespace
+
+// The rest of the device; files are memory-mapped rather than copied, in
+// which case the bytes are only valid until the file is closed.
+NODISCARD static QByteArray readRemaining(QIODevice &device)
+{
+    if (auto *const file = qobject_cast<QFile *>(&device)) {
+        const qint64 pos = file->pos();
+        const qint64 size = file->size() - pos;
+        if (size > 0 && size <= INT_MAX) {
+            if (const uchar *const mapped = file->map(pos, size)) {
+                return QByteArray::fromRawData(reinterpret_cast<const char *>(mapped),
+                                               static_cast<int>(size));
+            }
+        }
+    }
+    return device.readAll();
+}
+
+namespace { // anonymous
+
+// What the journal of a map changes, with later records overriding earlier ones.
+struct NODISCARD JournalChanges final
+{
+    // Rooms that are nullopt were removed.
+    std::map<RoomId, std::optional<LoadedRoom>> rooms;
+    // The serialised infomarks that replace the ones in the map, and how many there are.
+    std::optional<std::pair<uint32_t, QByteArray>> marks;
+    std::optional<Coordinate> position;
+    size_t records = 0;
+};
+
+} // namespace
+
+// Deltas come from other members of the group, so they may not inflate past this.
+static constexpr const size_t MAX_DELTA_SIZE = 16 * 1024 * 1024;
+
+// Like qUncompress(), but never allocates more than maxSize bytes.
+NODISCARD static QByteArray uncompressAtMost(const QByteArray &record, const size_t maxSize)
+{
+    static constexpr const int SIZE_PREFIX = 4;
+    if (record.size() < SIZE_PREFIX) {
+        throw io::IOException("truncated journal record");
+    }
+    const auto size = qFromBigEndian<quint32>(record.constData());
+    if (size > maxSize) {
+        throw io::IOException("journal record is too large");
+    }
+    if constexpr (NO_ZLIB) {
+        // qUncompress() grows past the stated size if it has to, but deflate
+        // can't do better than about 1032:1.
+        if (static_cast<size_t>(record.size()) > maxSize / 1032) {
+            throw io::IOException("journal record is too large");
+        }
+        return qUncompress(record);
+    } else {
+        QByteArray stream = record.mid(SIZE_PREFIX);
+        QByteArray data = StorageUtils::inflate(stream, maxSize);
+        if (static_cast<quint32>(data.size()) != size) {
+            throw io::IOException("corrupt journal record");
+        }
+        return data;
     }
+}
 
-    room.setExitsList(eList);
+// Journal records are written by MapStorage::formJournalRecord() in the current schema.
+// With a maxSize, a record that would inflate past it is treated as corrupt.
+NODISCARD static JournalChanges readJournal(const std::vector<QByteArray> &records,
+                                            const std::function<void(const QString &)> &log,
+                                            const std::optional<size_t> maxSize = std::nullopt)
+{
+    JournalChanges result;
+    for (const QByteArray &record : records) {
+        try {
+            const QByteArray data = maxSize.has_value() ? uncompressAtMost(record, *maxSize)
+                                                        : qUncompress(record);
+            if (data.isEmpty()) {
+                throw io::IOException("corrupt journal record");
+            }
+            QDataStream stream(data);
+            stream.setVersion(QDataStream::Qt_4_8);
+            LoadRoomHelper helper{stream};
+
+            JournalChanges changes;
+            changes.position = helper.readCoord3d();
+            for (uint32_t i = 0, removed = helper.read_u32(); i < removed; ++i) {
+                changes.rooms[RoomId{helper.read_u32()}] = std::nullopt;
+            }
+            for (uint32_t i = 0, changed = helper.read_u32(); i < changed; ++i) {
+                LoadedRoom room = readRoom(stream, CURRENT_SCHEMA, 0u, Coordinate{});
+                const RoomId id = room.id;
+                changes.rooms[id] = std::move(room);
+            }
+            if (helper.read_u8() != 0u) {
+                const uint32_t marksCount = helper.read_u32();
+                QByteArray marks;
+                stream >> marks;
+                helper.check_status();
+                changes.marks.emplace(marksCount, std::move(marks));
+            }
+
+            for (auto &[id, room] : changes.rooms) {
+                result.rooms[id] = std::move(room);
+            }
+            if (changes.marks.has_value()) {
+                result.marks = std::move(changes.marks);
+            }
+            result.position = changes.position;
+            ++result.records;
+        } catch (const std::exception &ex) {
+            log(QString("Ignoring the rest of the journal: %1").arg(ex.what()));
+            break;
+        }
+    }
+    return result;
+}
+
+// Rooms whose text is compressed together; large enough to compress well,
+// small enough that inflating one room's text is cheap. A dictionary does
+// most of the work that a large block would.
+static constexpr const size_t ROOMS_PER_TEXT_BLOCK = 64;
+static constexpr const size_t ROOMS_PER_DICTIONARY_TEXT_BLOCK = 8;
+// Descriptions a dictionary is trained on; every room's is used in smaller maps.
+static constexpr const size_t DICTIONARY_SAMPLES = 16384;
+
+NODISCARD static size_t getSampleStride(const size_t roomsCount)
+{
+    return std::max<size_t>(1, roomsCount / DICTIONARY_SAMPLES);
+}
+
+NODISCARD static std::shared_ptr<const DeflateDictionary> trainDictionary(
+    const std::vector<RoomDesc> &samples)
+{
+    std::vector<std::string_view> views;
+    views.reserve(samples.size());
+    for (const RoomDesc &desc : samples) {
+        views.emplace_back(desc.getStdString());
+    }
+    return DeflateDictionary::train(views);
+}
+
+static void compressRoomTexts(std::vector<LoadedRoom> &rooms,
+                              const std::shared_ptr<const DeflateDictionary> &dictionary)
+{
+    const size_t perBlock = (dictionary != nullptr) ? ROOMS_PER_DICTIONARY_TEXT_BLOCK
+                                                    : ROOMS_PER_TEXT_BLOCK;
+    std::vector<RoomTextBlock::Text> texts;
+    for (size_t begin = 0; begin < rooms.size(); begin += perBlock) {
+        const size_t end = std::min(rooms.size(), begin + perBlock);
+        texts.clear();
+        for (size_t i = begin; i < end; ++i) {
+            LoadedRoom &room = rooms[i];
+            texts.emplace_back(RoomTextBlock::Text{std::exchange(room.Description, RoomDesc{}),
+                                                   std::exchange(room.Contents, RoomContents{})});
+        }
+        const auto block = RoomTextBlock::compress(texts, dictionary);
+        for (size_t i = begin; i < end; ++i) {
+            rooms[i].textBlock = block;
+            rooms[i].textIndex = static_cast<uint32_t>(i - begin);
+        }
+    }
+}
+
+QByteArray MapStorage::loadRoomBlocks(QDataStream &stream,
+                                      const uint32_t version,
+                                      const uint32_t roomsCount,
+                                      const std::function<bool(RoomId)> &isReplaced)
+{
+    LoadRoomHelper helper{stream};
+    const uint32_t blockCount = helper.read_u32();
+    std::vector<RoomBlock> blocks;
+    std::vector<uint32_t> blockSizes;
+    uint64_t totalRooms = 0;
+    for (uint32_t i = 0; i < blockCount; ++i) {
+        RoomBlock &block = blocks.emplace_back();
+        block.roomsCount = helper.read_u32();
+        blockSizes.emplace_back(helper.read_u32());
+        totalRooms += block.roomsCount;
+    }
+    if (totalRooms != roomsCount) {
+        throw io::IOException("room blocks don't add up to the number of rooms");
+    }
+    const uint32_t marksSize = helper.read_u32();
+    const bool hasDictionary = (version >= MMAPPER_24_02_0_SCHEMA);
+    const uint32_t dictionarySize = hasDictionary ? helper.read_u32() : 0u;
+
+    // The blocks are handed to qUncompress() straight from the file.
+    const QByteArray rest = readRemaining(deref(stream.device()));
+    int blockOffset = 0;
+    const auto readBlock = [&rest, &blockOffset](const uint32_t size) -> QByteArray {
+        if (static_cast<qint64>(size) > rest.size() - blockOffset) {
+            throw io::IOException("read past end of file");
+        }
+        const int begin = std::exchange(blockOffset, blockOffset + static_cast<int>(size));
+        return QByteArray::fromRawData(rest.constData() + begin, static_cast<int>(size));
+    };
+    std::shared_ptr<const DeflateDictionary> dictionary;
+    if (hasDictionary) {
+        if (NO_ZLIB) {
+            throw io::IOException("this map needs MMapper to be compiled with zlib");
+        }
+        dictionary = std::make_shared<const DeflateDictionary>(
+            qUncompress(readBlock(dictionarySize)));
+    }
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        blocks[i].data = readBlock(blockSizes[i]);
+    }
+    const QByteArray marks = qUncompress(readBlock(marksSize));
+
+    // Decoding doesn't touch the map, so every block is inflated and decoded
+    // at once.
+    std::vector<std::vector<LoadedRoom>> decoded(blocks.size());
+    std::vector<std::string> errors(blocks.size());
+    const uint32_t firstId = baseId;
+    const Coordinate offset = basePosition;
+    const bool lazyText = getConfig().autoLoad.lazyDescriptions;
+    // Decoding and linking each count for about half of the rooms' steps.
+    auto &progressCounter = getProgressCounter();
+    const uint32_t decodeWeight = roomsCount / 2;
+    {
+        ProgressCounter decodeProgress{progressCounter, decodeWeight};
+        decodeProgress.increaseTotalStepsBy(static_cast<quint32>(blocks.size()));
+        parallelFor(
+            blocks.size(),
+            [version, firstId, &dictionary, &offset, &blocks, &decoded, &errors, &decodeProgress](
+                const size_t i) {
+                try {
+                    RoomBlock &block = blocks[i];
+                    const QByteArray data = (dictionary != nullptr)
+                                                ? dictionary->uncompress(block.data)
+                                                : qUncompress(block.data);
+                    block.data.clear();
+                    if (data.isEmpty()) {
+                        throw io::IOException("corrupt room block");
+                    }
+                    std::vector<LoadedRoom> &rooms = decoded[i];
+                    rooms.reserve(block.roomsCount);
+                    bool atEnd = false;
+                    if (version > MMAPPER_2_5_1_SCHEMA) {
+                        RoomBlockReader reader{data};
+                        for (uint32_t j = 0; j < block.roomsCount; ++j) {
+                            rooms.emplace_back(reader.readRoom(firstId, offset));
+                        }
+                        atEnd = reader.atEnd();
+                    } else {
+                        QDataStream blockStream(data);
+                        blockStream.setVersion(QDataStream::Qt_4_8);
+                        for (uint32_t j = 0; j < block.roomsCount; ++j) {
+                            rooms.emplace_back(readRoom(blockStream, version, firstId, offset));
+                        }
+                        atEnd = blockStream.atEnd();
+                    }
+                    if (!atEnd) {
+                        throw io::IOException("room block is longer than its rooms");
+                    }
+                } catch (const std::exception &ex) {
+                    errors[i] = ex.what();
+                }
+                decodeProgress.step();
+            },
+            1);
+    }
+    for (const std::string &error : errors) {
+        if (!error.empty()) {
+            throw io::IOException(error);
+        }
+    }
+    log(QString("Uncompressed %1 room blocks in parallel").arg(blocks.size()));
+
+    if (lazyText) {
+        // The file's dictionary was trained on these descriptions already.
+        if (dictionary == nullptr && !NO_ZLIB) {
+            const size_t stride = getSampleStride(roomsCount);
+            std::vector<RoomDesc> samples;
+            size_t index = 0;
+            for (const std::vector<LoadedRoom> &rooms : decoded) {
+                for (const LoadedRoom &loaded : rooms) {
+                    if (index++ % stride == 0) {
+                        samples.emplace_back(loaded.Description);
+                    }
+                }
+            }
+            dictionary = trainDictionary(samples);
+        }
+        parallelFor(
+            decoded.size(),
+            [&decoded, &dictionary](const size_t i) { compressRoomTexts(decoded[i], dictionary); },
+            1);
+    }
+
+    // Rooms (and the exits that link them) can only be added on this thread.
+    ProgressCounter linkProgress{progressCounter, roomsCount - decodeWeight};
+    linkProgress.increaseTotalStepsBy(roomsCount);
+    for (std::vector<LoadedRoom> &rooms : decoded) {
+        for (LoadedRoom &loaded : rooms) {
+            if (!isReplaced(loaded.id)) {
+                addLoadedRoom(std::move(loaded));
+            }
+            linkProgress.step();
+        }
+        rooms = {};
+    }
+
+    if (marksSize != 0 && marks.isEmpty()) {
+        throw io::IOException("corrupt infomark block");
+    }
+    return marks;
 }
 
 bool MapStorage::loadData()
@@ -334,7 +821,7 @@ bool MapStorage::loadData()
     // clear previous map
     m_mapData.clear();
     try {
-        return mergeData();
+        return loadFile(true);
     } catch (const std::exception &ex) {
         const auto msg = QString::asprintf("Exception: %s", ex.what());
         log(msg);
@@ -345,11 +832,28 @@ bool MapStorage::loadData()
 }
 
 bool MapStorage::mergeData()
+{
+    return loadFile(false);
+}
+
+void MapStorage::addLoadedRoom(LoadedRoom &&room)
+{
+    if (m_merger != nullptr) {
+        m_merger->add(std::move(room));
+    } else {
+        m_mapData.insertPredefinedRoom(createRoom(m_mapData, std::move(room)));
+    }
+}
+
+bool MapStorage::loadFile(const bool replayJournal)
 {
     const auto critical = [this](const QString &msg) -> void {
-        QMessageBox::critical(checked_dynamic_downcast<QWidget *>(parent()),
-                              tr("MapStorage Error"),
-                              msg);
+        // Headless loads have no window to show it in.
+        if (auto *const widget = qobject_cast<QWidget *>(parent())) {
+            QMessageBox::critical(widget, tr("MapStorage Error"), msg);
+        } else {
+            log(msg);
+        }
     };
 
     {
@@ -370,6 +874,8 @@ bool MapStorage::mergeData()
         }
 
         log("Loading data ...");
+        // Rooms the map already has aren't added again.
+        m_merger = replayJournal ? nullptr : std::make_unique<MapMerger>(m_mapData);
 
         auto &progressCounter = getProgressCounter();
         progressCounter.reset();
@@ -395,6 +901,8 @@ bool MapStorage::mergeData()
             case MMAPPER_2_4_3_SCHEMA:
             case MMAPPER_2_5_1_SCHEMA:
             case MMAPPER_19_10_0_SCHEMA:
+            case MMAPPER_23_05_0_SCHEMA:
+            case MMAPPER_24_02_0_SCHEMA:
                 return true;
             default:
                 break;
@@ -422,11 +930,14 @@ bool MapStorage::mergeData()
          * so don't be tempted to move this inside the scope. */
         // Then shouldn't buffer be declared before stream, so it will outlive the stream?
         QBuffer buffer;
-        const bool qCompressed = (version >= MMAPPER_2_4_3_SCHEMA);
+        const bool blockCompressed = (version >= MMAPPER_23_05_0_SCHEMA);
+        const bool qCompressed = (version >= MMAPPER_2_4_3_SCHEMA && !blockCompressed);
         const bool zlibCompressed = (version >= MMAPPER_2_0_4_SCHEMA
                                      && version <= MMAPPER_2_4_0_SCHEMA);
-        if (qCompressed || (!NO_ZLIB && zlibCompressed)) {
-            QByteArray compressedData(stream.device()->readAll());
+        if (blockCompressed) {
+            log("Map was compressed in blocks");
+        } else if (qCompressed || (!NO_ZLIB && zlibCompressed)) {
+            QByteArray compressedData = readRemaining(deref(stream.device()));
             QByteArray uncompressedData = qCompressed ? qUncompress(compressedData)
                                                       : StorageUtils::inflate(compressedData);
             buffer.setData(uncompressedData);
@@ -444,34 +955,95 @@ bool MapStorage::mergeData()
         }
         log(QString("Schema version: %1").arg(version));
 
+        const auto logMessage = [this](const QString &msg) { log(msg); };
+        JournalChanges journal = replayJournal
+                                     ? readJournal(MapJournal::read(m_fileName), logMessage)
+                                     : JournalChanges{};
+        if (journal.records != 0) {
+            log(QString("Replaying %1 journal records").arg(journal.records));
+        }
+        const auto isReplaced = [&journal](const RoomId id) {
+            return journal.rooms.find(id) != journal.rooms.end();
+        };
+
         const uint32_t roomsCount = helper.read_u32();
-        const uint32_t marksCount = helper.read_u32();
+        uint32_t marksCount = helper.read_u32();
         progressCounter.increaseTotalStepsBy(roomsCount + marksCount);
 
-        m_mapData.setPosition(transformRoomOnLoad(version, helper.readCoord3d() + basePosition));
+        const Coordinate position = transformRoomOnLoad(version,
+                                                        helper.readCoord3d() + basePosition);
+        m_mapData.setPosition(journal.position.value_or(position));
 
         log(QString("Number of rooms: %1").arg(roomsCount));
 
-        for (uint32_t i = 0; i < roomsCount; ++i) {
-            SharedRoom room = loadRoom(stream, version);
+        if (blockCompressed) {
+            // The infomarks follow the rooms in their own compressed block.
+            buffer.setData(loadRoomBlocks(stream, version, roomsCount, isReplaced));
+            buffer.open(QIODevice::ReadOnly);
+            stream.setDevice(&buffer);
+        } else {
+            for (uint32_t i = 0; i < roomsCount; ++i) {
+                LoadedRoom room = readRoom(stream, version, baseId, basePosition);
 
-            progressCounter.step();
-            m_mapData.insertPredefinedRoom(room);
+                progressCounter.step();
+                if (!isReplaced(room.id)) {
+                    addLoadedRoom(std::move(room));
+                }
+            }
+        }
+
+        if (m_merger != nullptr) {
+            const MergeSummary summary = std::exchange(m_merger, nullptr)->apply();
+            log(QString("Merged %1 new rooms; %2 rooms were already in the map, "
+                        "%3 were ambiguous; added %4 exits")
+                    .arg(summary.newRooms)
+                    .arg(summary.matchedRooms)
+                    .arg(summary.ambiguousRooms)
+                    .arg(summary.addedExits));
+            // The infomarks line up with the rooms they were drawn next to.
+            basePosition += summary.offset;
+        }
+
+        for (auto &[id, room] : journal.rooms) {
+            if (room.has_value()) {
+                m_mapData.insertPredefinedRoom(createRoom(m_mapData, std::move(room.value())));
+            }
+        }
+
+        QBuffer journalMarks;
+        uint32_t marksVersion = version;
+        if (journal.marks.has_value()) {
+            marksCount = journal.marks->first;
+            marksVersion = CURRENT_SCHEMA;
+            journalMarks.setData(journal.marks->second);
+            journalMarks.open(QIODevice::ReadOnly);
+            stream.setDevice(&journalMarks);
         }
 
         log(QString("Number of info items: %1").arg(marksCount));
 
-        // TODO: reserve the markerList with marksCount
+        m_mapData.reserveMarkers(m_mapData.getMarkersList().size() + marksCount);
 
         // create all pointers to items
         for (uint32_t index = 0; index < marksCount; ++index) {
             auto mark = InfoMark::alloc(m_mapData);
-            loadMark(deref(mark), stream, version);
+            loadMark(deref(mark), stream, marksVersion);
             m_mapData.addMarker(std::move(mark));
 
             progressCounter.step();
         }
 
+        if (replayJournal) {
+            m_mapData.markSaved();
+        } else {
+            // The merged rooms are only in memory.
+            m_mapData.markNeedsFullSave();
+        }
+
+        if (getConfig().autoLoad.compactRoomIds) {
+            compactRoomIds();
+        }
+
         log("Finished loading.");
 
         // REVISIT: Closing is probably not necessary, since you don't do it in the failure cases.
@@ -554,21 +1126,29 @@ void MapStorage::loadMark(InfoMark &mark, QDataStream &stream, uint32_t version)
         mark.setText(InfoMarkText{"New Marker"});
 }
 
+void MapStorage::compactRoomIds()
+{
+    const auto before = m_mapData.getRoomsCount();
+    if (!m_mapData.compactRoomIds()) {
+        log("Room ids were not compacted because some rooms are in use.");
+        return;
+    }
+    const auto after = m_mapData.getRoomsCount();
+    if (after != before) {
+        log(QString("Compacted room ids from %1 to %2.").arg(before).arg(after));
+    }
+}
+
 void MapStorage::saveRoom(const Room &room, QDataStream &stream)
 {
     stream << room.getName().toQString();
-    stream << room.getDescription().toQString();
-    stream << room.getContents().toQString();
+    stream << room.readDescription().toQString();
+    stream << room.readContents().toQString();
     stream << static_cast<quint32>(room.getId());
     stream << room.getNote().toQString();
-    stream << static_cast<quint8>(room.getTerrainType());
-    stream << static_cast<quint8>(room.getLightType());
-    stream << static_cast<quint8>(room.getAlignType());
-    stream << static_cast<quint8>(room.getPortableType());
-    stream << static_cast<quint8>(room.getRidableType());
-    stream << static_cast<quint8>(room.getSundeathType());
-    stream << static_cast<quint32>(room.getMobFlags());
-    stream << static_cast<quint32>(room.getLoadFlags());
+#define X_WRITE(_Prop, _Wire, _Since, _Legacy) stream << static_cast<_Wire>(room.get##_Prop());
+    XFOREACH_ROOM_FIXED_FIELD(X_WRITE)
+#undef X_WRITE
     stream << static_cast<quint8>(room.isUpToDate());
     writeCoordinate(stream, room.getPosition());
     saveExits(room, stream);
@@ -595,12 +1175,307 @@ void MapStorage::saveExits(const Room &room, QDataStream &stream)
     }
 }
 
+MapSaveData MapStorage::prepareSave()
+{
+    if (getConfig().autoLoad.compactRoomIds) {
+        compactRoomIds();
+    }
+
+    MapSaveData data;
+    data.rooms = m_mapData.getSnapshot();
+    data.position = m_mapData.getPosition();
+    data.marksCount = static_cast<uint32_t>(m_mapData.getMarkersList().size());
+    data.marks = saveMarks();
+    data.useDictionary = getConfig().autoLoad.dictionaryCompression && !NO_ZLIB;
+    // Whatever changes from here on goes in the next save.
+    m_mapData.markSaved();
+    return data;
+}
+
+QByteArray MapStorage::saveMarks() const
+{
+    QByteArray result;
+    QDataStream stream(&result, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_4_8);
+    for (const auto &mark : m_mapData.getMarkersList()) {
+        saveMark(deref(mark), stream);
+    }
+    return result;
+}
+
+bool MapStorage::canSaveJournal() const
+{
+    const QFileInfo info{m_fileName};
+    if (!info.exists() || !m_mapData.getUnsavedChanges().has_value()) {
+        return false;
+    }
+    // Compacts the journal into a full save once it gets large next to the map.
+    return MapJournal::getSize(m_fileName) < std::max(JOURNAL_COMPACTION_SIZE, info.size() / 4);
+}
+
+bool MapStorage::saveJournal()
+{
+    const std::optional<MapData::UnsavedChanges> changes = m_mapData.getUnsavedChanges();
+    if (!changes.has_value()) {
+        return false;
+    }
+
+    const SharedMapSnapshot snapshot = m_mapData.getSnapshot();
+    std::vector<RoomId> removed;
+    std::vector<const Room *> rooms;
+    for (const RoomId id : changes->rooms) {
+        if (const Room *const room = snapshot->getRoom(id)) {
+            rooms.emplace_back(room);
+        } else {
+            removed.emplace_back(id);
+        }
+    }
+
+    std::optional<std::pair<uint32_t, QByteArray>> marks;
+    if (changes->marks) {
+        marks.emplace(static_cast<uint32_t>(m_mapData.getMarkersList().size()), saveMarks());
+    }
+    const QByteArray record = formJournalRecord(m_mapData.getPosition(), removed, rooms, marks);
+
+    try {
+        MapJournal::append(m_fileName, record);
+    } catch (const std::exception &ex) {
+        log(QString("Writing the journal failed: %1").arg(ex.what()));
+        return false;
+    }
+    log(QString("Saved %1 changed and %2 removed rooms to the journal.")
+            .arg(rooms.size())
+            .arg(removed.size()));
+
+    m_mapData.markSaved();
+    m_mapData.unsetDataChanged();
+    emit sig_onDataSaved();
+    return true;
+}
+
+QByteArray MapStorage::formJournalRecord(
+    const Coordinate &position,
+    const std::vector<RoomId> &removed,
+    const std::vector<const Room *> &rooms,
+    const std::optional<std::pair<uint32_t, QByteArray>> &marks)
+{
+    QByteArray record;
+    {
+        QDataStream stream(&record, QIODevice::WriteOnly);
+        stream.setVersion(QDataStream::Qt_4_8);
+        writeCoordinate(stream, position);
+        stream << static_cast<quint32>(removed.size());
+        for (const RoomId id : removed) {
+            stream << static_cast<quint32>(id);
+        }
+        stream << static_cast<quint32>(rooms.size());
+        for (const Room *const room : rooms) {
+            saveRoom(*room, stream);
+        }
+        stream << static_cast<quint8>(marks.has_value());
+        if (marks.has_value()) {
+            stream << static_cast<quint32>(marks->first);
+            stream << marks->second;
+        }
+    }
+    return qCompress(record);
+}
+
+QByteArray MapStorage::saveDelta(const MapSnapshot &snapshot,
+                                 const std::vector<RoomId> &ids,
+                                 const Coordinate &position)
+{
+    std::vector<const Room *> rooms;
+    rooms.reserve(ids.size());
+    for (const RoomId id : ids) {
+        if (const Room *const room = snapshot.getRoom(id)) {
+            rooms.emplace_back(room);
+        }
+    }
+    return formJournalRecord(position, {}, rooms, std::nullopt);
+}
+
+std::vector<LoadedRoom> MapStorage::loadDelta(const QByteArray &delta,
+                                              const std::function<void(const QString &)> &log)
+{
+    JournalChanges changes = readJournal({delta}, log, MAX_DELTA_SIZE);
+    std::vector<LoadedRoom> rooms;
+    rooms.reserve(changes.rooms.size());
+    for (auto &[id, room] : changes.rooms) {
+        if (room.has_value()) {
+            rooms.emplace_back(std::move(room.value()));
+        }
+    }
+    return rooms;
+}
+
+template<typename ForEachRoom>
+std::vector<MapStorage::RoomBlock> MapStorage::saveRoomBlocks(ForEachRoom &&forEachRoom)
+{
+    std::vector<RoomBlock> blocks;
+    RoomBlock block;
+    std::unique_ptr<QDataStream> stream;
+    const auto finishBlock = [&blocks, &block, &stream]() {
+        stream.reset();
+        blocks.emplace_back(std::exchange(block, RoomBlock{}));
+    };
+
+    forEachRoom([&block, &stream, &finishBlock](const Room &room) {
+        if (stream == nullptr) {
+            stream = std::make_unique<QDataStream>(&block.data, QIODevice::WriteOnly);
+            stream->setVersion(QDataStream::Qt_4_8);
+        }
+        saveRoom(room, *stream);
+        if (++block.roomsCount == ROOMS_PER_BLOCK) {
+            finishBlock();
+        }
+    });
+    if (stream != nullptr) {
+        finishBlock();
+    }
+    return blocks;
+}
+
+bool MapStorage::writeData(QIODevice &device,
+                           const MapSaveData &data,
+                           ProgressCounter &progressCounter,
+                           const std::function<void(const QString &)> &log)
+{
+    const MapSnapshot &rooms = deref(data.rooms);
+
+    progressCounter.reset();
+    // Rooms, then compression.
+    progressCounter.increaseTotalStepsBy(static_cast<uint32_t>(rooms.getRoomsCount()) + 1);
+
+    const bool useDictionary = data.useDictionary;
+    const size_t stride = getSampleStride(rooms.getRoomsCount());
+    std::vector<RoomDesc> samples;
+    std::vector<RoomBlock> blocks = saveRoomBlocks(
+        [&rooms, &progressCounter, useDictionary, stride, &samples](auto &&saveOne) {
+            size_t index = 0;
+            rooms.forEachRoom(
+                [&saveOne, &progressCounter, useDictionary, stride, &samples, &index](
+                    const Room &room) {
+                    saveOne(room);
+                    if (useDictionary && index++ % stride == 0) {
+                        samples.emplace_back(room.readDescription());
+                    }
+                    progressCounter.step();
+                });
+        });
+
+    return writeMap(device,
+                    std::move(blocks),
+                    useDictionary ? trainDictionary(samples) : nullptr,
+                    data.marks,
+                    data.marksCount,
+                    data.position,
+                    progressCounter,
+                    log);
+}
+
+bool MapStorage::writeMap(QIODevice &device,
+                          std::vector<RoomBlock> blocks,
+                          const std::shared_ptr<const DeflateDictionary> &dictionary,
+                          const QByteArray &marks,
+                          const uint32_t marksCount,
+                          const Coordinate &position,
+                          ProgressCounter &progressCounter,
+                          const std::function<void(const QString &)> &log)
+{
+    uint32_t roomsCount = 0;
+    qint64 uncompressedSize = marks.size();
+    for (const RoomBlock &block : blocks) {
+        roomsCount += block.roomsCount;
+        uncompressedSize += block.data.size();
+    }
+
+    // Each block is compressed on its own, so they can all be compressed
+    // (and later uncompressed) at once.
+    parallelFor(
+        blocks.size(),
+        [&blocks, &dictionary](const size_t i) {
+            QByteArray &data = blocks[i].data;
+            data = (dictionary != nullptr) ? dictionary->compress(data) : qCompress(data);
+        },
+        1);
+    const QByteArray compressedMarks = qCompress(marks);
+    const QByteArray compressedDictionary = (dictionary != nullptr)
+                                                ? qCompress(dictionary->getBytes())
+                                                : QByteArray();
+    progressCounter.step();
+
+    qint64 compressedSize = compressedMarks.size() + compressedDictionary.size();
+    for (const RoomBlock &block : blocks) {
+        compressedSize += block.data.size();
+    }
+    const double compressionRatio = (compressedSize == 0)
+                                        ? 1.0
+                                        : (static_cast<double>(uncompressedSize)
+                                           / static_cast<double>(compressedSize));
+    log(QString("Map compressed (compression ratio of %1:1)")
+            .arg(QString::number(compressionRatio, 'f', 1)));
+
+    QDataStream fileStream(&device);
+    fileStream.setVersion(QDataStream::Qt_4_8);
+
+    // Write a header with a "magic number" and a version
+    fileStream << static_cast<quint32>(0xFFB2AF01);
+    // Older versions can still read maps saved without a dictionary.
+    fileStream << static_cast<qint32>((dictionary != nullptr) ? MMAPPER_24_02_0_SCHEMA
+                                                              : MMAPPER_23_05_0_SCHEMA);
+
+    // write counters
+    fileStream << static_cast<quint32>(roomsCount);
+    fileStream << static_cast<quint32>(marksCount);
+
+    // write selected room x,y,z
+    writeCoordinate(fileStream, position);
+
+    // write the block index: rooms and compressed bytes in each block
+    fileStream << static_cast<quint32>(blocks.size());
+    for (const RoomBlock &block : blocks) {
+        fileStream << static_cast<quint32>(block.roomsCount);
+        fileStream << static_cast<quint32>(block.data.size());
+    }
+    fileStream << static_cast<quint32>(compressedMarks.size());
+    if (dictionary != nullptr) {
+        fileStream << static_cast<quint32>(compressedDictionary.size());
+    }
+
+    bool ok = true;
+    const auto writeRaw = [&fileStream, &ok](const QByteArray &bytes) {
+        ok = ok && fileStream.writeRawData(bytes.data(), bytes.size()) == bytes.size();
+    };
+    writeRaw(compressedDictionary);
+    for (const RoomBlock &block : blocks) {
+        writeRaw(block.data);
+    }
+    writeRaw(compressedMarks);
+    return ok && fileStream.status() == QDataStream::Ok;
+}
+
 bool MapStorage::saveData(bool baseMapOnly)
 {
     log("Writing data to file ...");
 
-    QDataStream fileStream(m_file);
-    fileStream.setVersion(QDataStream::Qt_4_8);
+    const auto logMessage = [this](const QString &msg) { log(msg); };
+    if (!baseMapOnly) {
+        if (!writeData(deref(m_file), prepareSave(), getProgressCounter(), logMessage)) {
+            log("Writing data failed.");
+            m_mapData.markNeedsFullSave();
+            return false;
+        }
+        log("Writing data finished.");
+
+        m_mapData.unsetDataChanged();
+        emit sig_onDataSaved();
+        return true;
+    }
+
+    if (getConfig().autoLoad.compactRoomIds) {
+        compactRoomIds();
+    }
 
     // Collect the room and marker lists. The room list can't be acquired
     // directly apparently and we have to go through a RoomSaver which receives
@@ -614,7 +1489,7 @@ bool MapStorage::saveData(bool baseMapOnly)
         m_mapData.lookingForRooms(saver, RoomId{i});
     }
 
-    auto roomsCount = saver.getRoomsCount();
+    const auto roomsCount = saver.getRoomsCount();
     const auto marksCount = static_cast<uint32_t>(markerList.size());
 
     auto &progressCounter = getProgressCounter();
@@ -622,59 +1497,56 @@ bool MapStorage::saveData(bool baseMapOnly)
     progressCounter.increaseTotalStepsBy(roomsCount + marksCount);
 
     BaseMapSaveFilter filter;
-    if (baseMapOnly) {
-        filter.setMapData(&m_mapData);
-        progressCounter.increaseTotalStepsBy(filter.prepareCount());
-        filter.prepare(progressCounter);
-        roomsCount = filter.acceptedRoomsCount();
-    }
+    filter.setMapData(&m_mapData);
+    progressCounter.increaseTotalStepsBy(filter.prepareCount());
+    filter.prepare(progressCounter);
 
     // Compression step
     progressCounter.increaseTotalStepsBy(1);
 
-    // Write a header with a "magic number" and a version
-    fileStream << static_cast<quint32>(0xFFB2AF01);
-    fileStream << static_cast<qint32>(CURRENT_SCHEMA);
-
-    // Serialize the data
-    QBuffer buffer;
-    buffer.open(QIODevice::WriteOnly);
-    QDataStream stream(&buffer);
-    stream.setVersion(QDataStream::Qt_4_8);
-
-    // write counters
-    stream << static_cast<quint32>(roomsCount);
-    stream << static_cast<quint32>(marksCount);
-
-    // write selected room x,y,z
-    writeCoordinate(stream, m_mapData.getPosition());
-
     // save rooms
-    auto saveOne = [this, &stream](const Room &room) { saveRoom(room, stream); };
-    for (const std::shared_ptr<const Room> &pRoom : roomList) {
-        filter.visitRoom(deref(pRoom), baseMapOnly, saveOne);
-        progressCounter.step();
-    }
+    const bool useDictionary = getConfig().autoLoad.dictionaryCompression && !NO_ZLIB;
+    const size_t stride = getSampleStride(roomList.size());
+    std::vector<RoomDesc> samples;
+    std::vector<RoomBlock> blocks = saveRoomBlocks(
+        [&roomList, &filter, baseMapOnly, &progressCounter, useDictionary, stride, &samples](
+            auto &&saveOne) {
+            size_t index = 0;
+            const auto visit = [&saveOne, useDictionary, stride, &samples, &index](
+                                   const Room &room) {
+                saveOne(room);
+                if (useDictionary && index++ % stride == 0) {
+                    samples.emplace_back(room.readDescription());
+                }
+            };
+            for (const std::shared_ptr<const Room> &pRoom : roomList) {
+                filter.visitRoom(deref(pRoom), baseMapOnly, visit);
+                progressCounter.step();
+            }
+        });
 
     // save items
-    for (const auto &mark : markerList) {
-        saveMark(deref(mark), stream);
-        progressCounter.step();
+    QByteArray marks;
+    {
+        QDataStream stream(&marks, QIODevice::WriteOnly);
+        stream.setVersion(QDataStream::Qt_4_8);
+        for (const auto &mark : markerList) {
+            saveMark(deref(mark), stream);
+            progressCounter.step();
+        }
     }
 
-    buffer.close();
-
-    QByteArray uncompressedData(buffer.data());
-    QByteArray compressedData = qCompress(uncompressedData);
-    progressCounter.step();
-    double compressionRatio = (compressedData.isEmpty())
-                                  ? 1.0
-                                  : (static_cast<double>(uncompressedData.size())
-                                     / static_cast<double>(compressedData.size()));
-    log(QString("Map compressed (compression ratio of %1:1)")
-            .arg(QString::number(compressionRatio, 'f', 1)));
-
-    fileStream.writeRawData(compressedData.data(), compressedData.size());
+    if (!writeMap(deref(m_file),
+                  std::move(blocks),
+                  useDictionary ? trainDictionary(samples) : nullptr,
+                  marks,
+                  marksCount,
+                  m_mapData.getPosition(),
+                  progressCounter,
+                  logMessage)) {
+        log("Writing data failed.");
+        return false;
+    }
     log("Writing data finished.");
 
     m_mapData.unsetDataChanged();
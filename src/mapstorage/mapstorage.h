@@ -6,51 +6,142 @@
 // Author: Nils Schimmelmann <nschimme@gmail.com> (Jahara)
 
 #include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
 #include <QArgument>
+#include <QByteArray>
 #include <QObject>
 #include <QString>
 #include <QtGlobal>
 
 #include "../expandoracommon/coordinate.h"
 #include "../global/RuleOf5.h"
+#include "../mapdata/MapSnapshot.h"
 #include "../mapdata/mapdata.h"
 #include "../mapfrontend/mapfrontend.h"
 #include "abstractmapstorage.h"
 
+class DeflateDictionary;
 class InfoMark;
+class MapMerger;
+class ProgressCounter;
 class QDataStream;
 class QFile;
+class QIODevice;
 class QObject;
 class Room;
+struct LoadedRoom;
+
+// Everything a full save writes, copied from the live map up front so that
+// MapStorage::writeData() never has to touch it.
+struct NODISCARD MapSaveData final
+{
+    SharedMapSnapshot rooms;
+    // The infomarks, already serialised.
+    QByteArray marks;
+    uint32_t marksCount = 0;
+    Coordinate position;
+    // Compress the room blocks with a dictionary trained on the map.
+    bool useDictionary = false;
+};
 
 class MapStorage final : public AbstractMapStorage
 {
     Q_OBJECT
 
+private:
+    // Consecutive rooms that are compressed together.
+    struct NODISCARD RoomBlock final
+    {
+        uint32_t roomsCount = 0;
+        QByteArray data;
+    };
+
 public:
     explicit MapStorage(MapData &, const QString &, QFile *, QObject *parent);
     explicit MapStorage(MapData &, const QString &, QObject *parent);
+    ~MapStorage() override;
     bool mergeData() override;
 
 public:
     NODISCARD bool canLoad() const override { return true; }
     NODISCARD bool canSave() const override { return true; }
 
+public:
+    // Compacts the room ids (if configured) and copies what a full save
+    // writes; must be called on the thread that owns the map.
+    NODISCARD MapSaveData prepareSave();
+    // Writes a full map; safe to call from any thread, since it only reads
+    // the snapshot.
+    NODISCARD static bool writeData(QIODevice &device,
+                                    const MapSaveData &data,
+                                    ProgressCounter &progressCounter,
+                                    const std::function<void(const QString &)> &log);
+
+public:
+    // Whether the changes since the file was last loaded or saved can be
+    // appended to its journal, instead of saving the whole map again.
+    NODISCARD bool canSaveJournal() const;
+    NODISCARD bool saveJournal();
+
+public:
+    // The rooms as a journal record without removed rooms or infomarks, to
+    // share them with the group; rooms the snapshot doesn't have are skipped.
+    NODISCARD static QByteArray saveDelta(const MapSnapshot &snapshot,
+                                          const std::vector<RoomId> &ids,
+                                          const Coordinate &position);
+    // The rooms of a record written by saveDelta(); empty if it's corrupt.
+    NODISCARD static std::vector<LoadedRoom> loadDelta(
+        const QByteArray &delta, const std::function<void(const QString &)> &log);
+
 private:
     void newData() override;
     NODISCARD bool loadData() override;
     NODISCARD bool saveData(bool baseMapOnly) override;
 
-    SharedRoom loadRoom(QDataStream &stream, uint32_t version);
-    void loadExits(Room &room, QDataStream &stream, uint32_t version);
+    // A fresh load also applies the journal of the file.
+    NODISCARD bool loadFile(bool replayJournal);
+    // Adds the rooms of a block-compressed map, except the ones the journal
+    // replaces, and returns its infomarks uncompressed.
+    NODISCARD QByteArray loadRoomBlocks(QDataStream &stream,
+                                        uint32_t version,
+                                        uint32_t roomsCount,
+                                        const std::function<bool(RoomId)> &isReplaced);
+    // Inserts the room, or keeps it for m_merger when merging.
+    void addLoadedRoom(LoadedRoom &&room);
     void loadMark(InfoMark &mark, QDataStream &stream, uint32_t version);
-    void saveMark(const InfoMark &mark, QDataStream &stream);
-    void saveRoom(const Room &room, QDataStream &stream);
-    void saveExits(const Room &room, QDataStream &stream);
+    static void saveMark(const InfoMark &mark, QDataStream &stream);
+    NODISCARD QByteArray saveMarks() const;
+    static void saveRoom(const Room &room, QDataStream &stream);
+    static void saveExits(const Room &room, QDataStream &stream);
+    // A compressed record in the format read by readJournal().
+    NODISCARD static QByteArray formJournalRecord(
+        const Coordinate &position,
+        const std::vector<RoomId> &removed,
+        const std::vector<const Room *> &rooms,
+        const std::optional<std::pair<uint32_t, QByteArray>> &marks);
+    // Calls forEachRoom(saveOne), and serialises each room it passes to saveOne.
+    template<typename ForEachRoom>
+    NODISCARD static std::vector<RoomBlock> saveRoomBlocks(ForEachRoom &&forEachRoom);
+    // The dictionary is optional.
+    NODISCARD static bool writeMap(QIODevice &device,
+                                   std::vector<RoomBlock> blocks,
+                                   const std::shared_ptr<const DeflateDictionary> &dictionary,
+                                   const QByteArray &marks,
+                                   uint32_t marksCount,
+                                   const Coordinate &position,
+                                   ProgressCounter &progressCounter,
+                                   const std::function<void(const QString &)> &log);
+    void compactRoomIds();
     void log(const QString &msg) { emit sig_log("MapStorage", msg); }
 
     uint32_t baseId = 0u;
     Coordinate basePosition;
+    // Only while merging a map.
+    std::unique_ptr<MapMerger> m_merger;
 };
 
 class MapFrontendBlocker final
@@ -4,31 +4,95 @@
 
 #include "progresscounter.h"
 
+#include <algorithm>
+#include <chrono>
 #include <QObject>
 
-ProgressCounter::~ProgressCounter() = default;
+// About 30 Hz; anything faster only costs the receiver time.
+static constexpr const int64_t MIN_EMIT_INTERVAL_NS = 33'000'000;
+
+NODISCARD static int64_t getNowNs()
+{
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+ProgressCounter::~ProgressCounter()
+{
+    if (m_parent == nullptr) {
+        return;
+    }
+    // Whatever wasn't counted is done by now.
+    const uint64_t forwarded = m_forwarded.exchange(m_weight, std::memory_order_relaxed);
+    if (forwarded < m_weight) {
+        m_parent->step(static_cast<quint32>(m_weight - forwarded));
+    }
+}
 
 ProgressCounter::ProgressCounter(QObject *parent)
     : QObject(parent)
 {}
 
+ProgressCounter::ProgressCounter(ProgressCounter &parent, const quint32 weight)
+    : m_parent{&parent}
+    , m_weight{weight}
+{}
+
 void ProgressCounter::increaseTotalStepsBy(quint32 steps)
 {
-    m_totalSteps += steps;
-    step(0u);
+    const uint64_t totalSteps = m_totalSteps.fetch_add(steps, std::memory_order_relaxed) + steps;
+    update(m_steps.load(std::memory_order_relaxed), totalSteps);
 }
 
 void ProgressCounter::step(const quint32 steps)
 {
-    m_steps += steps;
-    const quint32 percentage = (m_totalSteps == 0u) ? 0u : (100u * m_steps / m_totalSteps);
-    if (percentage != m_percentage) {
-        m_percentage = percentage;
-        emit sig_onPercentageChanged(percentage);
+    const uint64_t done = m_steps.fetch_add(steps, std::memory_order_relaxed) + steps;
+    update(done, m_totalSteps.load(std::memory_order_relaxed));
+}
+
+void ProgressCounter::update(const uint64_t steps, const uint64_t totalSteps)
+{
+    if (m_parent != nullptr) {
+        const uint64_t target = (totalSteps == 0u)
+                                    ? 0u
+                                    : std::min(m_weight, m_weight * steps / totalSteps);
+        uint64_t forwarded = m_forwarded.load(std::memory_order_relaxed);
+        while (forwarded < target) {
+            if (m_forwarded.compare_exchange_weak(forwarded, target, std::memory_order_relaxed)) {
+                m_parent->step(static_cast<quint32>(target - forwarded));
+                break;
+            }
+        }
+        return;
     }
+
+    const auto percentage = static_cast<quint32>(
+        (totalSteps == 0u) ? 0u : std::min<uint64_t>(100u, 100u * steps / totalSteps));
+    if (percentage == m_percentage.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    // Only one thread gets to emit at a time, and 100% is never dropped.
+    const int64_t now = getNowNs();
+    int64_t lastEmit = m_lastEmit.load(std::memory_order_relaxed);
+    while (true) {
+        if (percentage != 100u && lastEmit != 0 && now - lastEmit < MIN_EMIT_INTERVAL_NS) {
+            return;
+        }
+        if (m_lastEmit.compare_exchange_weak(lastEmit, now, std::memory_order_relaxed)) {
+            break;
+        }
+    }
+
+    m_percentage.store(percentage, std::memory_order_relaxed);
+    emit sig_onPercentageChanged(percentage);
 }
 
 void ProgressCounter::reset()
 {
-    m_totalSteps = m_steps = m_percentage = 0u;
+    m_totalSteps.store(0u, std::memory_order_relaxed);
+    m_steps.store(0u, std::memory_order_relaxed);
+    m_forwarded.store(0u, std::memory_order_relaxed);
+    m_percentage.store(0u, std::memory_order_relaxed);
+    m_lastEmit.store(0, std::memory_order_relaxed);
 }
@@ -3,19 +3,45 @@
 // Copyright (C) 2019 The MMapper Authors
 // Author: Thomas Equeter <waba@waba.be> (Waba)
 
+#include <atomic>
+#include <cstdint>
 #include <QObject>
 #include <QtGlobal>
 
+#include "../global/macros.h"
+
+/*! \brief Counts the steps of a load or save, and reports them as a percentage.
+ *
+ * step() may be called from several threads at once; it never locks, and
+ * sig_onPercentageChanged is only emitted when the percentage changes, and
+ * then at most about 30 times a second (except for reaching 100%). The signal
+ * is emitted from whichever thread took the step, so receivers on another
+ * thread get it queued.
+ *
+ * A counter made with a parent is a sub-task: it counts its own steps, and
+ * adds its share of `weight` steps to the parent as it goes (the rest when it
+ * is destroyed). The weight has to be part of the parent's total already.
+ * Sub-tasks never emit anything themselves, and can be nested.
+ */
 class ProgressCounter final : public QObject
 {
     Q_OBJECT
 
 private:
-    quint32 m_totalSteps = 0u, m_steps = 0u, m_percentage = 0u;
+    ProgressCounter *const m_parent = nullptr;
+    const uint64_t m_weight = 0u;
+    std::atomic<uint64_t> m_totalSteps{0u};
+    std::atomic<uint64_t> m_steps{0u};
+    // Steps of m_weight already added to m_parent.
+    std::atomic<uint64_t> m_forwarded{0u};
+    std::atomic<quint32> m_percentage{0u};
+    // steady_clock, in nanoseconds.
+    std::atomic<int64_t> m_lastEmit{0};
 
 public:
     ProgressCounter() = default;
     explicit ProgressCounter(QObject *parent);
+    explicit ProgressCounter(ProgressCounter &parent, quint32 weight);
     ~ProgressCounter() final;
 
 public:
@@ -23,6 +49,9 @@ class ProgressCounter final : public QObject
     void increaseTotalStepsBy(quint32 steps);
     void reset();
 
+private:
+    void update(uint64_t steps, uint64_t totalSteps);
+
 signals:
     void sig_onPercentageChanged(quint32);
 };
@@ -4,6 +4,9 @@
 
 #include "mpifilter.h"
 
+#include <algorithm>
+#include <string>
+#include <utility>
 #include <QByteArray>
 #include <QMessageLogContext>
 #include <QObject>
@@ -12,6 +15,8 @@
 #include "../configuration/configuration.h"
 #include "../proxy/telnetfilter.h"
 
+static constexpr const int MAX_RESERVED_PAYLOAD = 16 * 1024 * 1024;
+
 NODISCARD static bool endsInLinefeed(const TelnetDataEnum type)
 {
     switch (type) {
@@ -29,22 +34,20 @@ NODISCARD static bool endsInLinefeed(const TelnetDataEnum type)
 void MpiFilter::slot_analyzeNewMudInput(const TelnetData &data)
 {
     if (m_receivingMpi) {
-        if (data.line.length() <= m_remaining) {
-            m_buffer.append(data.line);
-            m_remaining -= data.line.length();
-        } else {
-            const QByteArray temp = data.line.left(m_remaining);
-            m_buffer.append(temp);
-            m_remaining -= temp.length();
+        const int used = std::min(data.line.length(), m_remaining);
+        m_buffer.append(data.line.constData(), used);
+        m_remaining -= used;
 
+        if (used < data.line.length()) {
             TelnetData remainingData;
             remainingData.type = data.type;
-            remainingData.line = data.line.right(m_remaining);
+            remainingData.line = data.line.mid(used);
             emit sig_parseNewMudInput(remainingData);
         }
         if (m_remaining == 0) {
             m_receivingMpi = false;
-            parseMessage(m_command, m_buffer);
+            // Don't hold on to a large payload once it has been handed off.
+            parseMessage(m_command, std::exchange(m_buffer, QByteArray{}));
         }
 
     } else {
@@ -53,10 +56,15 @@ void MpiFilter::slot_analyzeNewMudInput(const TelnetData &data)
             if (!m_receivingMpi && data.line.length() >= 6 && data.line.startsWith("~$#E")) {
                 m_buffer.clear();
                 m_command = data.line.at(4);
-                m_remaining = data.line.mid(5).simplified().toInt();
-                if (getConfig().mumeClientProtocol.remoteEditing
+                m_remaining = QByteArray::fromRawData(data.line.constData() + 5,
+                                                      data.line.length() - 5)
+                                  .trimmed()
+                                  .toInt();
+                if (getConfig().mumeClientProtocol.remoteEditing && m_remaining > 0
                     && (m_command == 'V' || m_command == 'E')) {
                     m_receivingMpi = true;
+                    // The length is declared up front; a bogus one shouldn't reserve gigabytes.
+                    m_buffer.reserve(std::min(m_remaining, MAX_RESERVED_PAYLOAD));
                 }
             }
         }
@@ -95,18 +103,19 @@ void MpiFilter::parseEditMessage(const QByteArray &buffer)
         qWarning() << "Unable to detect remote editing session end";
         return;
     }
-    const RemoteSession sessionId = RemoteSession(buffer.mid(1, sessionEnd - 1).toStdString());
+    const RemoteSession sessionId = RemoteSession(
+        std::string(buffer.constData() + 1, static_cast<size_t>(sessionEnd - 1)));
     int descriptionEnd = buffer.indexOf('\n', sessionEnd + 1);
     if (descriptionEnd == -1) {
         qWarning() << "Unable to detect remote editing description end";
         return;
     }
-    QByteArray description = buffer.mid(sessionEnd + 1, (descriptionEnd - sessionEnd - 1));
-    QByteArray payload = buffer.mid(descriptionEnd + 1);
 
     // MPI is always Latin1
-    QString title = QString::fromLatin1(description);
-    QString body = QString::fromLatin1(payload);
+    const QString title = QString::fromLatin1(buffer.constData() + sessionEnd + 1,
+                                              descriptionEnd - sessionEnd - 1);
+    const QString body = QString::fromLatin1(buffer.constData() + descriptionEnd + 1,
+                                             buffer.length() - descriptionEnd - 1);
 
     qDebug() << "Edit" << sessionId.toQString() << title << "body.length=" << body.length();
     emit sig_editMessage(sessionId, title, body);
@@ -119,12 +128,10 @@ void MpiFilter::parseViewMessage(const QByteArray &buffer)
         qWarning() << "Unable to detect remote viewing description end";
         return;
     }
-    QByteArray description = buffer.mid(0, descriptionEnd);
-    QByteArray payload = buffer.mid(descriptionEnd + 1);
-
     // MPI is always Latin1
-    QString title = QString::fromLatin1(description);
-    QString body = QString::fromLatin1(payload);
+    const QString title = QString::fromLatin1(buffer.constData(), descriptionEnd);
+    const QString body = QString::fromLatin1(buffer.constData() + descriptionEnd + 1,
+                                             buffer.length() - descriptionEnd - 1);
 
     qDebug() << "Message" << title << "body.length=" << body.length();
     emit sig_viewMessage(title, body);
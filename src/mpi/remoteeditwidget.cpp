@@ -20,6 +20,7 @@
 #include <QSize>
 #include <QStatusBar>
 #include <QString>
+#include <QTextBlock>
 #include <QTextDocument>
 #include <QtGui>
 #include <QtWidgets>
@@ -34,6 +35,7 @@ static constexpr const bool USE_TOOLTIPS = false;
 static constexpr const char S_TWO_SPACES[3]{C_SPACE, C_SPACE, C_NUL};
 // REVISIT: Figure out how to tweak logic to accept actual maximum length of 80
 static constexpr const int MAX_LENGTH = 79;
+static constexpr const int STATUS_BAR_INTERVAL_MS = 100;
 
 NODISCARD static int measureTabAndAnsiAware(const QString &s)
 {
@@ -59,6 +61,48 @@ NODISCARD static int measureTabAndAnsiAware(const QString &s)
 
 class QWidget;
 
+// What's wrong with a line, as far as the status bar is concerned.
+struct NODISCARD LineIssues final
+{
+    bool hasTabs = false;
+    bool hasTrailingSpace = false;
+    bool isLong = false;
+};
+
+NODISCARD static LineIssues findLineIssues(const QString &line, const int width)
+{
+    LineIssues issues;
+    issues.hasTabs = line.indexOf('\t') >= 0;
+    issues.hasTrailingSpace = findTrailingWhitespace(line) >= 0;
+    issues.isLong = width > 80;
+    return issues;
+}
+
+// Kept on each block by the highlighter, which only sees the blocks that changed.
+class NODISCARD LineIssuesData final : public QTextBlockUserData
+{
+public:
+    const LineIssues issues;
+
+public:
+    explicit LineIssuesData(const LineIssues &issues)
+        : issues{issues}
+    {}
+    ~LineIssuesData() final;
+};
+
+LineIssuesData::~LineIssuesData() = default;
+
+NODISCARD static LineIssues getLineIssues(const QTextBlock &block)
+{
+    if (const auto *const data = dynamic_cast<const LineIssuesData *>(block.userData())) {
+        return data->issues;
+    }
+    // not highlighted yet
+    const QString line = block.text();
+    return findLineIssues(line, measureTabAndAnsiAware(line));
+}
+
 /// Groups everything in the scope as a single undo action.
 class NODISCARD RaiiGroupUndoActions final
 {
@@ -82,12 +126,14 @@ class LineHighlighter final : public QSyntaxHighlighter
 
     void highlightBlock(const QString &line) override
     {
+        const int width = measureTabAndAnsiAware(line);
         highlightTabs(line);
-        highlightOverflow(line);
+        highlightOverflow(line, width);
         highlightTrailingSpace(line);
         highlightAnsi(line);
         highlightEntities(line);
         highlightEncodingErrors(line);
+        setCurrentBlockUserData(new LineIssuesData{findLineIssues(line, width)});
     }
 
     static QTextCharFormat getBackgroundFormat(const Qt::GlobalColor color)
@@ -114,9 +160,9 @@ class LineHighlighter final : public QSyntaxHighlighter
         });
     }
 
-    void highlightOverflow(const QString &line)
+    void highlightOverflow(const QString &line, const int width)
     {
-        const int breakPos = (measureTabAndAnsiAware(line) <= maxLength) ? -1 : maxLength;
+        const int breakPos = (width <= maxLength) ? -1 : maxLength;
         if (breakPos < 0) {
             return;
         }
@@ -934,15 +980,19 @@ void RemoteEditWidget::addStatusBar(const Editor *const pTextEdit)
     QStatusBar *const status = statusBar();
     status->showMessage(tr("Ready"));
 
-    connect(pTextEdit,
-            &QPlainTextEdit::cursorPositionChanged,
-            this,
-            &RemoteEditWidget::slot_updateStatusBar);
-    connect(pTextEdit,
-            &QPlainTextEdit::selectionChanged,
-            this,
-            &RemoteEditWidget::slot_updateStatusBar);
-    connect(pTextEdit, &QPlainTextEdit::textChanged, this, &RemoteEditWidget::slot_updateStatusBar);
+    // Every key typed sends several of these, and the report covers the whole document,
+    // so it's updated at most once per interval.
+    m_statusBarTimer.setSingleShot(true);
+    m_statusBarTimer.setInterval(STATUS_BAR_INTERVAL_MS);
+    connect(&m_statusBarTimer, &QTimer::timeout, this, &RemoteEditWidget::slot_updateStatusBar);
+    const auto schedule = [this]() {
+        if (!m_statusBarTimer.isActive()) {
+            m_statusBarTimer.start();
+        }
+    };
+    connect(pTextEdit, &QPlainTextEdit::cursorPositionChanged, this, schedule);
+    connect(pTextEdit, &QPlainTextEdit::selectionChanged, this, schedule);
+    connect(pTextEdit, &QPlainTextEdit::textChanged, this, schedule);
 }
 
 struct NODISCARD CursorColumnInfo final
@@ -1006,25 +1056,21 @@ NODISCARD static CursorAnsiInfo getCursorAnsi(QTextCursor cursor)
 NODISCARD static bool linesHaveTabs(const QTextCursor &cur)
 {
     return exists_partly_selected_block(cur, [](const QTextCursor &it) -> bool {
-        return lineHasTabs(it);
+        return getLineIssues(it.block()).hasTabs;
     });
 }
 
 NODISCARD static bool linesHaveTrailingSpace(const QTextCursor &cur)
 {
     return exists_partly_selected_block(cur, [](const QTextCursor &it) -> bool {
-        const auto &block = it.block();
-        const auto &line = block.text();
-        return findTrailingWhitespace(line) >= 0;
+        return getLineIssues(it.block()).hasTrailingSpace;
     });
 }
 
 NODISCARD static bool hasLongLines(const QTextCursor &cur)
 {
-    return exists_partly_selected_block(cur, [](const QTextCursor &line) -> bool {
-        const auto &block = line.block();
-        const auto &s = block.text();
-        return measureTabAndAnsiAware(s) > 80;
+    return exists_partly_selected_block(cur, [](const QTextCursor &it) -> bool {
+        return getLineIssues(it.block()).isLong;
     });
 }
 
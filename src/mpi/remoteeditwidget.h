@@ -9,6 +9,7 @@
 #include <QScopedPointer>
 #include <QSize>
 #include <QString>
+#include <QTimer>
 #include <QtCore>
 #include <QtWidgets/QMenuBar>
 #include <QtWidgets/QVBoxLayout>
@@ -179,4 +180,5 @@ protected slots:
 
     bool m_submitted = false;
     QScopedPointer<Editor> m_textEdit;
+    QTimer m_statusBarTimer;
 };
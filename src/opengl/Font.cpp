@@ -3,6 +3,7 @@
 
 #include "Font.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cctype>
 #include <cstdlib>
@@ -10,7 +11,10 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <memory>
 #include <optional>
+#include <string>
+#include <string_view>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 #include <QLatin1String>
@@ -22,8 +26,10 @@
 #include "../display/Filenames.h"
 #include "../display/MapCanvasData.h"
 #include "../display/Textures.h"
+#include "../global/CacheRegistry.h"
 #include "../global/Debug.h"
 #include "../global/hash.h"
+#include "../global/parallel.h"
 #include "../global/utils.h"
 #include "FontFormatFlags.h"
 #include "OpenGL.h"
@@ -463,6 +469,51 @@ QString FontMetrics::init(const QString &fontFilename)
     return imageFilename;
 }
 
+// One vertex of a laid out string, relative to GLText::pos; it takes the
+// GLText's color, or its background color.
+struct NODISCARD LayoutVert final
+{
+    glm::vec2 tc{0.f};
+    glm::vec2 vert{0.f};
+    bool isBackground = false;
+};
+using Layout = std::vector<LayoutVert>;
+
+// Everything in a GLText that changes its layout.
+struct NODISCARD LayoutKey final
+{
+    std::string text;
+    FontFormatFlags fontFormatFlag;
+    int rotationAngle = 0;
+    bool hasBackground = false;
+
+    explicit LayoutKey(const GLText &glText)
+        : text{glText.text}
+        , fontFormatFlag{glText.fontFormatFlag}
+        , rotationAngle{glText.rotationAngle}
+        , hasBackground{glText.bgcolor.has_value()}
+    {}
+
+    NODISCARD bool operator==(const LayoutKey &rhs) const
+    {
+        return text == rhs.text && fontFormatFlag == rhs.fontFormatFlag
+               && rotationAngle == rhs.rotationAngle && hasBackground == rhs.hasBackground;
+    }
+};
+
+template<>
+struct std::hash<LayoutKey>
+{
+    std::size_t operator()(const LayoutKey &key) const noexcept
+    {
+        const uint64_t opts = static_cast<uint64_t>(key.fontFormatFlag.asUint32())
+                              | (static_cast<uint64_t>(static_cast<uint32_t>(key.rotationAngle))
+                                 << 8u)
+                              | (static_cast<uint64_t>(key.hasBackground) << 40u);
+        return std::hash<std::string_view>()(key.text) ^ numeric_hash(opts);
+    }
+};
+
 class NODISCARD FontBatchBuilder final
 {
 private:
@@ -470,9 +521,7 @@ class NODISCARD FontBatchBuilder final
     struct NODISCARD Opts final
     {
         std::string_view msg;
-        glm::vec3 pos{0.f};
-        Color fgColor;
-        std::optional<Color> optBgColor;
+        bool wantBackground = false;
         bool wantItalics = false;
         bool wantUnderline = false;
         bool wantAlignCenter = false;
@@ -486,9 +535,7 @@ class NODISCARD FontBatchBuilder final
 
         explicit Opts(const GLText &text)
             : msg{text.text}
-            , pos{text.pos}
-            , fgColor{text.color}
-            , optBgColor{text.bgcolor}
+            , wantBackground{text.bgcolor.has_value()}
             , wantItalics{text.fontFormatFlag.contains(FontFormatFlagEnum::ITALICS)}
             , wantUnderline{text.fontFormatFlag.contains(FontFormatFlagEnum::UNDERLINE)}
             , wantAlignCenter{text.fontFormatFlag.contains(FontFormatFlagEnum::HALIGN_CENTER)}
@@ -517,7 +564,7 @@ class NODISCARD FontBatchBuilder final
 private:
     const FontMetrics &fm;
     const glm::ivec2 iTexSize;
-    std::vector<FontVert3d> &verts3d;
+    Layout &verts;
     Opts opts;
     Bounds bounds;
     int xlinepos = 0;
@@ -531,10 +578,10 @@ class NODISCARD FontBatchBuilder final
     }
 
 public:
-    explicit FontBatchBuilder(const FontMetrics &fm, std::vector<FontVert3d> &output)
+    explicit FontBatchBuilder(const FontMetrics &fm, Layout &output)
         : fm{fm}
         , iTexSize{fm.common.scaleW, fm.common.scaleH}
-        , verts3d{output}
+        , verts{output}
     {}
 
     NODISCARD glm::vec2 getTexCoord(const glm::ivec2 &iTexCoord) const
@@ -577,7 +624,7 @@ class NODISCARD FontBatchBuilder final
 
             const glm::vec2 tc = getTexCoord(iTexCoord00 + pixelOffset);
             const glm::vec2 vert = transformVert(relativeVertPos);
-            verts3d.emplace_back(opts.pos, opts.fgColor, tc, vert);
+            verts.emplace_back(LayoutVert{tc, vert, false});
         };
 
         const auto &x = iglyphSize.x;
@@ -627,14 +674,15 @@ class NODISCARD FontBatchBuilder final
 
         // measurement, background color, and underline.
         {
-            const auto add = [this](const Color &c, const glm::ivec2 &ivert, const glm::ivec2 &itc) {
-                const glm::vec2 tc = getTexCoord(itc);
-                const glm::vec2 vert = transformVert(ivert);
-                verts3d.emplace_back(opts.pos, c, tc, vert);
-            };
-
-            const auto quad = [&add](const Color &c, const Rect &vert, const Rect &tc) {
-#define ADD(a, b) add(c, glm::ivec2{vert.a.x, vert.b.y}, glm::ivec2{tc.a.x, tc.b.y})
+            const auto add =
+                [this](const bool isBackground, const glm::ivec2 &ivert, const glm::ivec2 &itc) {
+                    const glm::vec2 tc = getTexCoord(itc);
+                    const glm::vec2 vert = transformVert(ivert);
+                    verts.emplace_back(LayoutVert{tc, vert, isBackground});
+                };
+
+            const auto quad = [&add](const bool isBackground, const Rect &vert, const Rect &tc) {
+#define ADD(a, b) add(isBackground, glm::ivec2{vert.a.x, vert.b.y}, glm::ivec2{tc.a.x, tc.b.y})
                 // note: lo and hi refer to members of vert and tc.
                 ADD(lo, lo);
                 ADD(hi, lo);
@@ -658,9 +706,9 @@ class NODISCARD FontBatchBuilder final
                 bounds.maxVertPos.x -= xlinepos;
             }
 
-            if (opts.optBgColor) {
+            if (opts.wantBackground) {
                 if (const FontMetrics::Glyph *const background = fm.getBackground()) {
-                    quad(opts.optBgColor.value(),
+                    quad(true,
                          Rect{lo - margin, hi + margin},
                          background->getRect());
                 }
@@ -670,7 +718,7 @@ class NODISCARD FontBatchBuilder final
                 if (const FontMetrics::Glyph *const underline = fm.getUnderline()) {
                     const auto usize = underline->getSize();
                     const auto offset = underline->getOffset() + glm::ivec2{wordOffset, 0};
-                    quad(opts.fgColor,
+                    quad(false,
                          Rect{offset, offset + glm::ivec2{xlinepos, usize.y}},
                          underline->getRect());
                 }
@@ -683,6 +731,105 @@ class NODISCARD FontBatchBuilder final
     }
 };
 
+// Laid out strings, so the strings that are drawn again every time a chunk of
+// the map is rebuilt don't have to go through the glyph and kerning lookups again.
+// It's forgotten when it gets too big, since most of it is probably stale by then,
+// or when the cache_registry needs the memory back; both happen on the main thread.
+class NODISCARD FontLayoutCache final
+{
+private:
+    static constexpr const size_t MAX_ENTRIES = 1u << 14;
+    std::unordered_map<LayoutKey, Layout> m_layouts;
+    cache_registry::Registration m_registration{"font layouts",
+                                                cache_registry::CacheCostEnum::LOW,
+                                                [this]() { return getApproxBytes(); },
+                                                [this](size_t) { m_layouts.clear(); }};
+
+public:
+    FontLayoutCache() = default;
+    ~FontLayoutCache() = default;
+    DELETE_CTORS_AND_ASSIGN_OPS(FontLayoutCache);
+
+public:
+    NODISCARD size_t getApproxBytes() const
+    {
+        size_t bytes = 0;
+        for (const auto &kv : m_layouts) {
+            bytes += sizeof(kv) + 2 * sizeof(void *) + kv.first.text.capacity()
+                     + kv.second.capacity() * sizeof(LayoutVert);
+        }
+        return bytes;
+    }
+
+    // The result is only valid until the next call.
+    NODISCARD const Layout &getLayout(const FontMetrics &fm, const GLText &text)
+    {
+        LayoutKey key{text};
+        if (const auto it = m_layouts.find(key); it != m_layouts.end()) {
+            return it->second;
+        }
+
+        if (m_layouts.size() >= MAX_ENTRIES) {
+            m_layouts.clear();
+        }
+
+        Layout layout;
+        FontBatchBuilder{fm, layout}.addString(text);
+        return m_layouts.emplace(std::move(key), std::move(layout)).first->second;
+    }
+
+    // Same as calling getLayout() for each string, except that the strings
+    // that aren't cached yet are laid out in parallel. The results are only
+    // valid until the next call.
+    NODISCARD std::vector<const Layout *> getLayouts(const FontMetrics &fm,
+                                                     const GLText *const text,
+                                                     const size_t count)
+    {
+        const auto findMissing = [this, text, count]() -> std::vector<const GLText *> {
+            std::vector<const GLText *> missing;
+            std::unordered_set<LayoutKey> seen;
+            for (size_t i = 0; i < count; ++i) {
+                LayoutKey key{text[i]};
+                if (m_layouts.find(key) == m_layouts.end() && seen.insert(std::move(key)).second) {
+                    missing.emplace_back(&text[i]);
+                }
+            }
+            return missing;
+        };
+
+        std::vector<const GLText *> missing = findMissing();
+        if (m_layouts.size() + missing.size() > MAX_ENTRIES) {
+            // Forget everything before laying out this batch, not half-way through it.
+            m_layouts.clear();
+            missing = findMissing();
+        }
+
+        // Only reads the font metrics, so it's safe to share them.
+        std::vector<Layout> layouts(missing.size());
+        parallelFor(
+            missing.size(),
+            [&fm, &missing, &layouts](const size_t i) {
+                FontBatchBuilder{fm, layouts[i]}.addString(*missing[i]);
+            },
+            64);
+
+        for (size_t i = 0; i < missing.size(); ++i) {
+            m_layouts.emplace(LayoutKey{*missing[i]}, std::move(layouts[i]));
+        }
+
+        std::vector<const Layout *> result;
+        result.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            result.emplace_back(&m_layouts.at(LayoutKey{text[i]}));
+        }
+        return result;
+    }
+};
+
+// Below this many strings, threads cost more than they save.
+static constexpr const size_t PARALLEL_LAYOUT_THRESHOLD = 512;
+static constexpr const size_t PARALLEL_LAYOUT_SLICE = 256;
+
 GLFont::GLFont(OpenGL &gl)
     : m_gl(gl)
 {}
@@ -721,26 +868,58 @@ NODISCARD static QString getFontFilename(const float devicePixelRatio)
     return fontFilename;
 }
 
-void GLFont::init()
+struct NODISCARD PrefetchedFont final
 {
-    assert(m_gl.isRendererInitialized());
-    m_fontMetrics = std::make_unique<FontMetrics>();
-    const auto fontFilename = getFontFilename(m_gl.getDevicePixelRatio());
-    const QString imageFilename = m_fontMetrics->init(fontFilename);
+    QString fontFilename;
+    std::unique_ptr<FontMetrics> metrics;
+    // Already has the synthetic glyphs, and is mirrored for OpenGL.
+    QImage image;
+};
 
-    auto &fm = *m_fontMetrics;
+// Doesn't touch OpenGL, so it can run on any thread.
+NODISCARD static std::unique_ptr<PrefetchedFont> readFont(const QString &fontFilename)
+{
+    auto font = std::make_unique<PrefetchedFont>();
+    font->fontFilename = fontFilename;
+    font->metrics = std::make_unique<FontMetrics>();
+    const QString imageFilename = font->metrics->init(fontFilename);
 
     if (!QFile{imageFilename}.exists()) {
         qWarning() << "invalid font filename" << imageFilename;
     }
 
+    QImage img{imageFilename};
+    font->metrics->tryAddSyntheticGlyphs(img);
+    font->image = img.mirrored();
+    return font;
+}
+
+void GLFont::prefetch(const float devicePixelRatio)
+{
+    m_prefetched = std::async(std::launch::async,
+                              [fontFilename = getFontFilename(devicePixelRatio)]() {
+                                  return readFont(fontFilename);
+                              });
+}
+
+void GLFont::init()
+{
+    assert(m_gl.isRendererInitialized());
+    const auto fontFilename = getFontFilename(m_gl.getDevicePixelRatio());
+    std::unique_ptr<PrefetchedFont> font;
+    if (m_prefetched.valid()) {
+        font = m_prefetched.get();
+    }
+    if (font == nullptr || font->fontFilename != fontFilename) {
+        font = readFont(fontFilename);
+    }
+
+    m_fontMetrics = std::move(font->metrics);
+    m_layoutCache = std::make_unique<FontLayoutCache>();
+
     m_texture = MMTexture::alloc(
         QOpenGLTexture::Target::Target2D,
-        [&fm, &imageFilename](QOpenGLTexture &tex) -> void {
-            QImage img{imageFilename};
-            fm.tryAddSyntheticGlyphs(img);
-            img = img.mirrored();
-
+        [&img = font->image](QOpenGLTexture &tex) -> void {
             tex.setMinMagFilters(QOpenGLTexture::Filter::Linear, QOpenGLTexture::Filter::Linear);
             tex.setAutoMipMapGenerationEnabled(false);
             tex.setMipLevels(0);
@@ -752,6 +931,7 @@ void GLFont::init()
 void GLFont::cleanup()
 {
     m_fontMetrics.reset();
+    m_layoutCache.reset();
     m_texture.reset();
 }
 
@@ -768,6 +948,18 @@ std::optional<int> GLFont::getGlyphAdvance(const char c) const
     return std::nullopt;
 }
 
+glm::vec2 GLFont::measureText(const std::string &text) const
+{
+    const FontMetrics &fm = getFontMetrics();
+    int width = 0;
+    for (const char c : text) {
+        if (const FontMetrics::Glyph *const g = fm.lookupGlyph(c))
+            width += g->xadvance;
+    }
+    const float ratio = std::max(m_gl.getDevicePixelRatio(), 1.f);
+    return glm::vec2{static_cast<float>(width), static_cast<float>(fm.common.lineHeight)} / ratio;
+}
+
 glm::ivec2 GLFont::getScreenCenter() const
 {
     return m_gl.getPhysicalViewport().offset + m_gl.getPhysicalViewport().size / 2;
@@ -791,11 +983,50 @@ std::vector<FontVert3d> GLFont::getFontBatchRawData(const GLText *const text, co
         return 4 * static_cast<size_t>(numGlyphs);
     }();
 
-    result.reserve(expectedVerts);
+    FontLayoutCache &cache = deref(m_layoutCache);
+    const auto appendVerts = [](std::vector<FontVert3d> &output,
+                                const GLText &glText,
+                                const Layout &layout) {
+        for (const LayoutVert &v : layout) {
+            const Color &color = v.isBackground ? glText.bgcolor.value() : glText.color;
+            output.emplace_back(glText.pos, color, v.tc, v.vert);
+        }
+    };
 
-    FontBatchBuilder fontBatchBuilder{fm, result};
-    for (const GLText *it = text; it != end; ++it) {
-        fontBatchBuilder.addString(*it);
+    if (count < PARALLEL_LAYOUT_THRESHOLD) {
+        result.reserve(expectedVerts);
+        for (const GLText *it = text; it != end; ++it) {
+            appendVerts(result, *it, cache.getLayout(fm, *it));
+        }
+        assert(result.size() == expectedVerts);
+        return result;
+    }
+
+    // Lots of door names or infomark labels: lay out and convert slices of
+    // the strings on separate threads, then concatenate the slices in order.
+    const std::vector<const Layout *> layouts = cache.getLayouts(fm, text, count);
+    const size_t numSlices = (count + PARALLEL_LAYOUT_SLICE - 1) / PARALLEL_LAYOUT_SLICE;
+    std::vector<std::vector<FontVert3d>> slices(numSlices);
+    parallelFor(
+        numSlices,
+        [text, count, &layouts, &slices, &appendVerts](const size_t slice) {
+            const size_t first = slice * PARALLEL_LAYOUT_SLICE;
+            const size_t last = std::min(count, first + PARALLEL_LAYOUT_SLICE);
+            std::vector<FontVert3d> &output = slices[slice];
+            size_t numVerts = 0;
+            for (size_t i = first; i < last; ++i) {
+                numVerts += layouts[i]->size();
+            }
+            output.reserve(numVerts);
+            for (size_t i = first; i < last; ++i) {
+                appendVerts(output, text[i], *layouts[i]);
+            }
+        },
+        1);
+
+    result.reserve(expectedVerts);
+    for (const std::vector<FontVert3d> &slice : slices) {
+        result.insert(result.end(), slice.begin(), slice.end());
     }
     assert(result.size() == expectedVerts);
     return result;
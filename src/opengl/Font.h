@@ -3,6 +3,7 @@
 // Copyright (C) 2019 The MMapper Authors
 
 #include <cstddef>
+#include <future>
 #include <glm/glm.hpp>
 #include <memory>
 #include <optional>
@@ -43,6 +44,8 @@ struct NODISCARD GLText final
 };
 
 struct FontMetrics;
+struct PrefetchedFont;
+class FontLayoutCache;
 
 class NODISCARD GLFont final
 {
@@ -50,6 +53,9 @@ class NODISCARD GLFont final
     OpenGL &m_gl;
     SharedMMTexture m_texture;
     std::unique_ptr<FontMetrics> m_fontMetrics;
+    std::unique_ptr<FontLayoutCache> m_layoutCache;
+    // Consumed by init().
+    std::future<std::unique_ptr<PrefetchedFont>> m_prefetched;
 
 public:
     explicit GLFont(OpenGL &gl);
@@ -60,12 +66,19 @@ class NODISCARD GLFont final
     const FontMetrics &getFontMetrics() const { return deref(m_fontMetrics); }
 
 public:
+    // Reads the font (and decodes its atlas) for this pixel ratio on a worker thread;
+    // init() uses it if the renderer's ratio picks the same font.
+    void prefetch(float devicePixelRatio);
     void init();
     void cleanup();
 
 public:
     NODISCARD int getFontHeight() const;
+    // Null until init().
+    NODISCARD const SharedMMTexture &getTexture() const { return m_texture; }
     NODISCARD std::optional<int> getGlyphAdvance(char c) const;
+    // In logical pixels, without laying the text out; rotation is ignored.
+    NODISCARD glm::vec2 measureText(const std::string &text) const;
 
 private:
     NODISCARD glm::ivec2 getScreenCenter() const;
@@ -5,6 +5,7 @@
 #include "OpenGL.h"
 
 #include <cassert>
+#include <cstdlib>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -14,6 +15,7 @@
 #include "OpenGLTypes.h"
 #include "legacy/Legacy.h"
 #include "legacy/ShaderUtils.h"
+#include "legacy/TimerQueries.h"
 
 #ifdef WIN32
 extern "C" {
@@ -54,6 +56,65 @@ bool OpenGL::tryEnableMultisampling(const int requestedSamples)
     return getFunctions().tryEnableMultisampling(requestedSamples);
 }
 
+bool OpenGL::canRenderTextureArrays() const
+{
+    return getFunctions().canRenderTextureArrays();
+}
+
+const char *OpenGL::getBackendName() const
+{
+    switch (getFunctions().getBackend()) {
+    case Legacy::BackendEnum::GL20:
+        return "GL 2.0";
+    case Legacy::BackendEnum::GL33_CORE:
+        return "GL 3.3 core";
+    }
+    std::abort();
+}
+
+bool OpenGL::canTimeQueries() const
+{
+    return getFunctions().canTimeQueries();
+}
+
+void OpenGL::beginTimerQuery(const size_t phase)
+{
+    auto &gl = getFunctions();
+    gl.getTimerQueries().begin(gl, phase);
+}
+
+void OpenGL::endTimerQuery()
+{
+    auto &gl = getFunctions();
+    gl.getTimerQueries().end(gl);
+}
+
+void OpenGL::endTimerQueryFrame()
+{
+    auto &gl = getFunctions();
+    gl.getTimerQueries().endFrame(gl);
+}
+
+const std::vector<std::optional<double>> &OpenGL::getTimerQueryResultsMs() const
+{
+    return deref(m_opengl).getTimerQueries().getResultsMs();
+}
+
+const GLFrameStats &OpenGL::getFrameStats() const
+{
+    return getFunctions().getFrameStats();
+}
+
+void OpenGL::resetFrameStats()
+{
+    getFunctions().resetFrameStats();
+}
+
+MemoryUsage OpenGL::getBufferMemoryUsage() const
+{
+    return getFunctions().getBufferMemoryUsage();
+}
+
 UniqueMesh OpenGL::createPointBatch(const std::vector<ColorVert> &batch)
 {
     return getFunctions().createPointBatch(batch);
@@ -101,6 +162,35 @@ UniqueMesh OpenGL::createColoredTexturedQuadBatch(const std::vector<ColoredTexVe
     return getFunctions().createColoredTexturedBatch(DrawModeEnum::QUADS, batch, texture);
 }
 
+UniqueMesh OpenGL::createPlainQuadInstances(const std::vector<glm::vec3> &positions)
+{
+    return getFunctions().createPlainQuadInstances(positions);
+}
+
+UniqueMesh OpenGL::createTexturedQuadInstances(const std::vector<glm::vec3> &positions,
+                                               const SharedMMTexture &texture)
+{
+    return getFunctions().createTexturedQuadInstances(positions, texture);
+}
+
+UniqueMesh OpenGL::createColoredTexturedQuadInstances(const std::vector<ColorVert> &instances,
+                                                      const SharedMMTexture &texture)
+{
+    return getFunctions().createColoredTexturedQuadInstances(instances, texture);
+}
+
+UniqueMesh OpenGL::createArrayTexturedQuadInstances(const std::vector<glm::vec4> &instances,
+                                                    const SharedMMTexture &texture)
+{
+    return getFunctions().createArrayTexturedQuadInstances(instances, texture);
+}
+
+UniqueMesh OpenGL::createPlainTriangleInstances(const std::vector<glm::vec2> &shapes,
+                                                const std::vector<glm::vec4> &instances)
+{
+    return getFunctions().createPlainTriangleInstances(shapes, instances);
+}
+
 UniqueMesh OpenGL::createFontMesh(const SharedMMTexture &texture,
                                   const DrawModeEnum mode,
                                   const std::vector<FontVert3d> &batch)
@@ -187,7 +277,9 @@ void OpenGL::renderFont3d(const SharedMMTexture &texture, const std::vector<Font
 
 void OpenGL::initializeOpenGLFunctions()
 {
-    getFunctions().initializeOpenGLFunctions();
+    auto &functions = getFunctions();
+    functions.initializeOpenGLFunctions();
+    functions.initializeBackend();
 }
 
 const char *OpenGL::glGetString(GLenum name)
@@ -3,11 +3,14 @@
 // Copyright (C) 2019 The MMapper Authors
 // Author: Nils Schimmelmann <nschimme@gmail.com> (Jahara)
 
+#include <cstddef>
 #include <glm/glm.hpp>
 #include <memory>
+#include <optional>
 #include <vector>
 #include <qopengl.h>
 
+#include "../global/MemoryReport.h"
 #include "../global/utils.h"
 #include "OpenGLTypes.h"
 
@@ -48,6 +51,24 @@ class OpenGL final
 
 public:
     NODISCARD bool tryEnableMultisampling(int samples);
+    // Only valid after initializeOpenGLFunctions().
+    NODISCARD bool canRenderTextureArrays() const;
+    NODISCARD const char *getBackendName() const;
+
+public:
+    // GPU time of the phases of a frame; see Legacy::TimerQueries.
+    NODISCARD bool canTimeQueries() const;
+    void beginTimerQuery(size_t phase);
+    void endTimerQuery();
+    void endTimerQueryFrame();
+    // From a few frames ago.
+    NODISCARD const std::vector<std::optional<double>> &getTimerQueryResultsMs() const;
+
+public:
+    NODISCARD const GLFrameStats &getFrameStats() const;
+    void resetFrameStats();
+    // Bytes and count of the vertex buffers currently allocated.
+    NODISCARD MemoryUsage getBufferMemoryUsage() const;
 
 public:
     NODISCARD UniqueMesh createPointBatch(const std::vector<ColorVert> &verts);
@@ -73,6 +94,22 @@ class OpenGL final
     NODISCARD UniqueMesh createColoredTexturedQuadBatch(const std::vector<ColoredTexVert> &verts,
                                                         const SharedMMTexture &texture);
 
+public:
+    // A unit quad (from pos to pos+(1,1,0), with texture coordinates 0..1) per instance,
+    // so each room quad only costs one position (and color) instead of four verts.
+    NODISCARD UniqueMesh createPlainQuadInstances(const std::vector<glm::vec3> &positions);
+    NODISCARD UniqueMesh createTexturedQuadInstances(const std::vector<glm::vec3> &positions,
+                                                     const SharedMMTexture &texture);
+    NODISCARD UniqueMesh createColoredTexturedQuadInstances(const std::vector<ColorVert> &instances,
+                                                            const SharedMMTexture &texture);
+    // Requires canRenderTextureArrays(); w is the layer of the array texture.
+    NODISCARD UniqueMesh createArrayTexturedQuadInstances(const std::vector<glm::vec4> &instances,
+                                                          const SharedMMTexture &texture);
+    // The triangle shapes[w] (VERTS_PER_TRI offsets each) at the xyz of each instance.
+    NODISCARD UniqueMesh createPlainTriangleInstances(const std::vector<glm::vec2> &shapes,
+                                                      const std::vector<glm::vec4> &instances);
+
+public:
     NODISCARD UniqueMesh createFontMesh(const SharedMMTexture &texture,
                                         DrawModeEnum mode,
                                         const std::vector<FontVert3d> &batch);
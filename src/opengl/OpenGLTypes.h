@@ -326,6 +326,14 @@ struct NODISCARD UniqueMeshVector final
     }
 };
 
+// What the GL calls since the last OpenGL::resetFrameStats() did.
+struct NODISCARD GLFrameStats final
+{
+    size_t drawCalls = 0;
+    size_t vertices = 0;
+    size_t bytesUploaded = 0;
+};
+
 struct NODISCARD Viewport
 {
     glm::ivec2 offset;
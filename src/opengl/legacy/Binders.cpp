@@ -154,6 +154,9 @@ RenderStateBinder::RenderStateBinder(Functions &functions, const GLRenderState &
     , lineParamsBinder{functions, renderState.lineParams}
     , pointSizeBinder{functions, renderState.uniforms.pointSize}
     , texturesBinder{renderState.uniforms.textures}
-{}
+{
+    // Qt's own painting may have bound a different one.
+    functions.bindVertexArray();
+}
 
 } // namespace Legacy
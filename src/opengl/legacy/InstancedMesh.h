@@ -0,0 +1,319 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+#include "../../global/utils.h"
+#include "../OpenGLTypes.h"
+#include "AbstractShaderProgram.h"
+#include "Binders.h"
+#include "Legacy.h"
+#include "VBO.h"
+
+namespace Legacy {
+
+// Draws a unit quad for each instance. The instances only hold the position
+// of the quad's lower left corner (and a color, for ColorVert), and the
+// "instanced/" vertex shaders add the corner offset from a shared VBO.
+// For glm::vec4, w is the layer of the array texture.
+//
+// Requires Functions::canRenderInstanced().
+template<typename _InstanceType, typename _ProgramType>
+class NODISCARD InstancedQuadMesh final : public IRenderable
+{
+public:
+    using ProgramType = _ProgramType;
+    static_assert(std::is_base_of_v<AbstractShaderProgram, ProgramType>);
+    static_assert(std::is_same_v<_InstanceType, glm::vec3>
+                  || std::is_same_v<_InstanceType, glm::vec4>
+                  || std::is_same_v<_InstanceType, ColorVert>);
+
+private:
+    static constexpr bool HAS_COLOR = std::is_same_v<_InstanceType, ColorVert>;
+
+private:
+    const SharedFunctions m_shared_functions;
+    Functions &m_functions;
+    const std::shared_ptr<_ProgramType> m_shared_program;
+    _ProgramType &m_program;
+    const SharedVbo m_corners;
+    VBO m_vbo;
+    GLsizei m_numInstances = 0;
+
+public:
+    explicit InstancedQuadMesh(const SharedFunctions &sharedFunctions,
+                               const std::shared_ptr<_ProgramType> &sharedProgram,
+                               SharedVbo corners,
+                               const std::vector<_InstanceType> &instances)
+        : m_shared_functions{sharedFunctions}
+        , m_functions{deref(m_shared_functions)}
+        , m_shared_program{sharedProgram}
+        , m_program{deref(m_shared_program)}
+        , m_corners{std::move(corners)}
+    {
+        assert(m_corners != nullptr && *m_corners);
+        if (instances.empty())
+            return;
+
+        m_vbo.emplace(m_shared_functions);
+        if (LOG_VBO_STATIC_UPLOADS) {
+            qInfo() << "Uploading static buffer with" << instances.size()
+                    << "instances of size" << sizeof(_InstanceType) << "(total"
+                    << (instances.size() * sizeof(_InstanceType)) << "bytes) to VBO"
+                    << m_vbo.get() << __FUNCTION__;
+        }
+        m_numInstances = m_functions.setRawVbo(m_vbo.get(), instances);
+    }
+
+    ~InstancedQuadMesh() override { reset(); }
+    DELETE_CTORS_AND_ASSIGN_OPS(InstancedQuadMesh);
+
+private:
+    struct NODISCARD Attribs final
+    {
+        GLuint cornerPos = INVALID_ATTRIB_LOCATION;
+        GLuint colorPos = INVALID_ATTRIB_LOCATION;
+        GLuint vertPos = INVALID_ATTRIB_LOCATION;
+
+        NODISCARD static Attribs getLocations(AbstractShaderProgram &shader)
+        {
+            Attribs result;
+            result.cornerPos = shader.getAttribLocation("aCorner");
+            if constexpr (HAS_COLOR) {
+                result.colorPos = shader.getAttribLocation("aInstanceColor");
+            }
+            result.vertPos = shader.getAttribLocation("aInstanceVert");
+            return result;
+        }
+    };
+
+    NODISCARD Attribs bindAttribs()
+    {
+        Functions &gl = m_functions;
+        const auto attribs = Attribs::getLocations(m_program);
+
+        gl.glBindBuffer(GL_ARRAY_BUFFER, m_corners->get());
+        gl.enableAttrib(attribs.cornerPos, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+
+        gl.glBindBuffer(GL_ARRAY_BUFFER, m_vbo.get());
+        if constexpr (HAS_COLOR) {
+            const auto size = static_cast<GLsizei>(sizeof(ColorVert));
+            static_assert(sizeof(std::declval<ColorVert>().color) == 4 * sizeof(uint8_t));
+            static_assert(sizeof(std::declval<ColorVert>().vert) == 3 * sizeof(GLfloat));
+            gl.enableAttrib(attribs.colorPos,
+                            4,
+                            GL_UNSIGNED_BYTE,
+                            GL_TRUE,
+                            size,
+                            reinterpret_cast<void *>(offsetof(ColorVert, color)));
+            gl.enableAttrib(attribs.vertPos,
+                            3,
+                            GL_FLOAT,
+                            GL_FALSE,
+                            size,
+                            reinterpret_cast<void *>(offsetof(ColorVert, vert)));
+            gl.glVertexAttribDivisor(attribs.colorPos, 1);
+        } else {
+            constexpr auto numFloats = static_cast<GLint>(_InstanceType::length());
+            static_assert(sizeof(_InstanceType)
+                          == static_cast<size_t>(numFloats) * sizeof(GLfloat));
+            gl.enableAttrib(attribs.vertPos, numFloats, GL_FLOAT, GL_FALSE, 0, nullptr);
+        }
+        gl.glVertexAttribDivisor(attribs.vertPos, 1);
+        return attribs;
+    }
+
+    void unbindAttribs(const Attribs &attribs)
+    {
+        Functions &gl = m_functions;
+        // The divisor is global state, so it has to be reset for the other meshes.
+        if constexpr (HAS_COLOR) {
+            gl.glVertexAttribDivisor(attribs.colorPos, 0);
+            gl.glDisableVertexAttribArray(attribs.colorPos);
+        }
+        gl.glVertexAttribDivisor(attribs.vertPos, 0);
+        gl.glDisableVertexAttribArray(attribs.vertPos);
+        gl.glDisableVertexAttribArray(attribs.cornerPos);
+        gl.glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+private:
+    void virt_clear() final { m_numInstances = 0; }
+
+    void virt_reset() final
+    {
+        m_numInstances = 0;
+        m_vbo.reset();
+        assert(isEmpty() && !m_vbo);
+    }
+
+    NODISCARD bool virt_isEmpty() const final { return !m_vbo || m_numInstances == 0; }
+
+private:
+    void virt_render(const GLRenderState &renderState) final
+    {
+        if (isEmpty())
+            return;
+
+        m_functions.checkError();
+
+        const glm::mat4 mvp = m_functions.getProjectionMatrix();
+        auto programUnbinder = m_program.bind();
+        m_program.setUniforms(mvp, renderState.uniforms);
+        RenderStateBinder renderStateBinder(m_functions, renderState);
+        const Attribs attribs = bindAttribs();
+
+        m_functions.checkError();
+
+        m_functions.glDrawArraysInstanced(GL_TRIANGLE_FAN,
+                                          0,
+                                          static_cast<GLsizei>(VERTS_PER_QUAD),
+                                          m_numInstances);
+        unbindAttribs(attribs);
+
+        m_functions.checkError();
+    }
+};
+
+// Draws one of a small table of triangles at each instance. The table holds
+// VERTS_PER_TRI corner offsets per shape, and w of each instance is the index
+// of its shape; the instances are grouped by shape when they're uploaded, so
+// each shape becomes one instanced draw of the same "instanced/" shaders.
+//
+// Requires Functions::canRenderInstanced().
+template<typename _ProgramType>
+class NODISCARD InstancedTriangleMesh final : public IRenderable
+{
+public:
+    using ProgramType = _ProgramType;
+    static_assert(std::is_base_of_v<AbstractShaderProgram, ProgramType>);
+
+private:
+    // The instances of one shape, as a range of the (grouped) instance VBO.
+    struct NODISCARD Run final
+    {
+        GLint firstCorner = 0;
+        GLsizei firstInstance = 0;
+        GLsizei numInstances = 0;
+    };
+
+private:
+    const SharedFunctions m_shared_functions;
+    Functions &m_functions;
+    const std::shared_ptr<_ProgramType> m_shared_program;
+    _ProgramType &m_program;
+    VBO m_corners;
+    VBO m_vbo;
+    std::vector<Run> m_runs;
+
+public:
+    explicit InstancedTriangleMesh(const SharedFunctions &sharedFunctions,
+                                   const std::shared_ptr<_ProgramType> &sharedProgram,
+                                   const std::vector<glm::vec2> &shapes,
+                                   const std::vector<glm::vec4> &instances)
+        : m_shared_functions{sharedFunctions}
+        , m_functions{deref(m_shared_functions)}
+        , m_shared_program{sharedProgram}
+        , m_program{deref(m_shared_program)}
+    {
+        assert(shapes.size() % VERTS_PER_TRI == 0);
+        if (instances.empty())
+            return;
+
+        // counting sort by shape
+        const size_t numShapes = shapes.size() / VERTS_PER_TRI;
+        std::vector<size_t> offsets(numShapes + 1u, 0u);
+        for (const glm::vec4 &instance : instances) {
+            const auto shape = static_cast<size_t>(instance.w);
+            assert(shape < numShapes);
+            ++offsets[shape + 1u];
+        }
+        for (size_t i = 0; i < numShapes; ++i) {
+            const size_t count = offsets[i + 1u];
+            offsets[i + 1u] += offsets[i];
+            if (count != 0) {
+                m_runs.emplace_back(Run{static_cast<GLint>(i * VERTS_PER_TRI),
+                                        static_cast<GLsizei>(offsets[i]),
+                                        static_cast<GLsizei>(count)});
+            }
+        }
+        std::vector<glm::vec3> grouped(instances.size());
+        for (const glm::vec4 &instance : instances) {
+            grouped[offsets[static_cast<size_t>(instance.w)]++] = glm::vec3{instance};
+        }
+
+        m_corners.emplace(m_shared_functions);
+        MAYBE_UNUSED const auto numCorners = m_functions.setRawVbo(m_corners.get(), shapes);
+        m_vbo.emplace(m_shared_functions);
+        if (LOG_VBO_STATIC_UPLOADS) {
+            qInfo() << "Uploading static buffer with" << grouped.size() << "instances of"
+                    << m_runs.size() << "shapes to VBO" << m_vbo.get() << __FUNCTION__;
+        }
+        MAYBE_UNUSED const auto numInstances = m_functions.setRawVbo(m_vbo.get(), grouped);
+    }
+
+    ~InstancedTriangleMesh() override { reset(); }
+    DELETE_CTORS_AND_ASSIGN_OPS(InstancedTriangleMesh);
+
+private:
+    void virt_clear() final { m_runs.clear(); }
+
+    void virt_reset() final
+    {
+        m_runs.clear();
+        m_vbo.reset();
+        m_corners.reset();
+        assert(isEmpty() && !m_vbo);
+    }
+
+    NODISCARD bool virt_isEmpty() const final { return !m_vbo || m_runs.empty(); }
+
+private:
+    void virt_render(const GLRenderState &renderState) final
+    {
+        if (isEmpty())
+            return;
+
+        Functions &gl = m_functions;
+        gl.checkError();
+
+        const glm::mat4 mvp = gl.getProjectionMatrix();
+        auto programUnbinder = m_program.bind();
+        m_program.setUniforms(mvp, renderState.uniforms);
+        RenderStateBinder renderStateBinder(gl, renderState);
+
+        const GLuint cornerPos = m_program.getAttribLocation("aCorner");
+        const GLuint vertPos = m_program.getAttribLocation("aInstanceVert");
+        gl.glBindBuffer(GL_ARRAY_BUFFER, m_corners.get());
+        gl.enableAttrib(cornerPos, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+
+        // There's no base instance before GL 4.2, so each run moves the pointer instead.
+        gl.glBindBuffer(GL_ARRAY_BUFFER, m_vbo.get());
+        for (const Run &run : m_runs) {
+            const size_t offset = static_cast<size_t>(run.firstInstance) * sizeof(glm::vec3);
+            gl.enableAttrib(vertPos, 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<void *>(offset));
+            gl.glVertexAttribDivisor(vertPos, 1);
+            gl.glDrawArraysInstanced(GL_TRIANGLES,
+                                     run.firstCorner,
+                                     static_cast<GLsizei>(VERTS_PER_TRI),
+                                     run.numInstances);
+        }
+
+        // The divisor is global state, so it has to be reset for the other meshes.
+        gl.glVertexAttribDivisor(vertPos, 0);
+        gl.glDisableVertexAttribArray(vertPos);
+        gl.glDisableVertexAttribArray(cornerPos);
+        gl.glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        gl.checkError();
+    }
+};
+
+} // namespace Legacy
@@ -3,6 +3,7 @@
 
 #include "Legacy.h"
 
+#include <array>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
@@ -24,10 +25,12 @@
 #include "AbstractShaderProgram.h"
 #include "Binders.h"
 #include "FontMesh3d.h"
+#include "InstancedMesh.h"
 #include "Meshes.h"
 #include "ShaderUtils.h"
 #include "Shaders.h"
 #include "SimpleMesh.h"
+#include "TimerQueries.h"
 #include "VBO.h"
 
 namespace Legacy {
@@ -104,6 +107,133 @@ UniqueMesh Functions::createColoredTexturedBatch(const DrawModeEnum mode,
     return createTexturedMesh<ColoredTexturedMesh>(shared_from_this(), mode, batch, prog, texture);
 }
 
+// Shared by every InstancedQuadMesh; it's released by Functions::cleanup().
+NODISCARD static SharedVbo getUnitQuadCorners(const SharedFunctions &sharedFunctions)
+{
+    static WeakVbo weak;
+    if (auto shared = weak.lock()) {
+        return shared;
+    }
+
+    auto shared = sharedFunctions->getStaticVbos().alloc();
+    if (shared == nullptr)
+        throw std::runtime_error("OpenGL error: failed to alloc VBO");
+    weak = shared;
+
+    // D-C
+    // | |  ccw winding (drawn as a triangle fan)
+    // A-B
+    const std::vector<glm::vec2> corners{{0, 0}, {1, 0}, {1, 1}, {0, 1}};
+    VBO &vbo = *shared;
+    vbo.emplace(sharedFunctions);
+    MAYBE_UNUSED const auto ignored = sharedFunctions->setRawVbo(vbo.get(), corners);
+    return shared;
+}
+
+template<typename _InstanceType, typename _ProgType>
+NODISCARD static auto createInstancedMesh(const SharedFunctions &functions,
+                                          const std::vector<_InstanceType> &instances,
+                                          const std::shared_ptr<_ProgType> &prog)
+{
+    using Mesh = InstancedQuadMesh<_InstanceType, _ProgType>;
+    return std::make_unique<Mesh>(functions, prog, getUnitQuadCorners(functions), instances);
+}
+
+// The fallback for the createXXXQuadInstances() functions: each instance becomes 4 verts.
+template<typename _VertexType, typename _InstanceType, typename _Callback>
+NODISCARD static std::vector<_VertexType> expandQuadInstances(
+    const std::vector<_InstanceType> &instances, _Callback &&callback)
+{
+    // D-C
+    // | |  ccw winding
+    // A-B
+    static const std::array<glm::vec2, VERTS_PER_QUAD> corners{
+        glm::vec2{0, 0}, glm::vec2{1, 0}, glm::vec2{1, 1}, glm::vec2{0, 1}};
+
+    std::vector<_VertexType> quads;
+    quads.reserve(instances.size() * VERTS_PER_QUAD);
+    for (const _InstanceType &instance : instances) {
+        for (const glm::vec2 &corner : corners) {
+            quads.emplace_back(callback(instance, corner));
+        }
+    }
+    return quads;
+}
+
+UniqueMesh Functions::createPlainQuadInstances(const std::vector<glm::vec3> &positions)
+{
+    if (!canRenderInstanced()) {
+        const auto toVert = [](const glm::vec3 &pos, const glm::vec2 &corner) -> glm::vec3 {
+            return pos + glm::vec3{corner, 0};
+        };
+        return createPlainBatch(DrawModeEnum::QUADS,
+                                expandQuadInstances<glm::vec3>(positions, toVert));
+    }
+    const auto &prog = getShaderPrograms().getInstancedPlainUColorShader();
+    return UniqueMesh{createInstancedMesh(shared_from_this(), positions, prog)};
+}
+
+UniqueMesh Functions::createTexturedQuadInstances(const std::vector<glm::vec3> &positions,
+                                                  const SharedMMTexture &texture)
+{
+    if (!canRenderInstanced()) {
+        const auto toVert = [](const glm::vec3 &pos, const glm::vec2 &corner) -> TexVert {
+            return TexVert{corner, pos + glm::vec3{corner, 0}};
+        };
+        return createTexturedBatch(DrawModeEnum::QUADS,
+                                   expandQuadInstances<TexVert>(positions, toVert),
+                                   texture);
+    }
+    const auto &prog = getShaderPrograms().getInstancedTexturedUColorShader();
+    return UniqueMesh{std::make_unique<TexturedRenderable>(
+        texture, createInstancedMesh(shared_from_this(), positions, prog))};
+}
+
+UniqueMesh Functions::createColoredTexturedQuadInstances(const std::vector<ColorVert> &instances,
+                                                         const SharedMMTexture &texture)
+{
+    if (!canRenderInstanced()) {
+        const auto toVert = [](const ColorVert &inst, const glm::vec2 &corner) -> ColoredTexVert {
+            return ColoredTexVert{inst.color, corner, inst.vert + glm::vec3{corner, 0}};
+        };
+        return createColoredTexturedBatch(DrawModeEnum::QUADS,
+                                          expandQuadInstances<ColoredTexVert>(instances, toVert),
+                                          texture);
+    }
+    const auto &prog = getShaderPrograms().getInstancedTexturedAColorShader();
+    return UniqueMesh{std::make_unique<TexturedRenderable>(
+        texture, createInstancedMesh(shared_from_this(), instances, prog))};
+}
+
+UniqueMesh Functions::createArrayTexturedQuadInstances(const std::vector<glm::vec4> &instances,
+                                                       const SharedMMTexture &texture)
+{
+    assert(canRenderTextureArrays());
+    const auto &prog = getShaderPrograms().getInstancedArrayTexturedUColorShader();
+    return UniqueMesh{std::make_unique<TexturedRenderable>(
+        texture, createInstancedMesh(shared_from_this(), instances, prog))};
+}
+
+UniqueMesh Functions::createPlainTriangleInstances(const std::vector<glm::vec2> &shapes,
+                                                   const std::vector<glm::vec4> &instances)
+{
+    assert(shapes.size() % VERTS_PER_TRI == 0);
+    if (!canRenderInstanced()) {
+        std::vector<glm::vec3> tris;
+        tris.reserve(instances.size() * VERTS_PER_TRI);
+        for (const glm::vec4 &instance : instances) {
+            const size_t first = static_cast<size_t>(instance.w) * VERTS_PER_TRI;
+            for (size_t i = 0; i < VERTS_PER_TRI; ++i) {
+                tris.emplace_back(glm::vec3{instance} + glm::vec3{shapes.at(first + i), 0});
+            }
+        }
+        return createPlainBatch(DrawModeEnum::TRIANGLES, tris);
+    }
+    const auto &prog = getShaderPrograms().getInstancedPlainUColorShader();
+    using Mesh = InstancedTriangleMesh<UColorPlainShader>;
+    return UniqueMesh{std::make_unique<Mesh>(shared_from_this(), prog, shapes, instances)};
+}
+
 template<typename _VertexType, template<typename> typename _Mesh, typename _ShaderType>
 static void renderImmediate(const SharedFunctions &sharedFunctions,
                             const DrawModeEnum mode,
@@ -114,40 +244,35 @@ static void renderImmediate(const SharedFunctions &sharedFunctions,
     if (verts.empty())
         return;
 
-    static WeakVbo weak;
-    auto shared = weak.lock();
-    if (shared == nullptr) {
-        weak = shared = sharedFunctions->getStaticVbos().alloc();
-        if (shared == nullptr)
-            throw std::runtime_error("OpenGL error: failed to alloc VBO");
-    }
-
-    VBO &vbo = *shared;
-    if (!vbo) {
-        vbo.emplace(sharedFunctions);
-    }
-
     using Mesh = _Mesh<_VertexType>;
     static_assert(std::is_same_v<typename Mesh::ProgramType, _ShaderType>);
 
-    const auto before = vbo.get();
-    {
-        Mesh mesh{sharedFunctions, sharedShader};
+    StreamingVbo &stream = sharedFunctions->getStreamingVbo();
+    const auto draw = [&](const DrawModeEnum drawMode, const std::vector<_VertexType> &batch) {
+        const GLint first = stream.append(sharedFunctions, batch);
+        VBO &vbo = stream.getVbo();
+        const auto before = vbo.get();
         {
-            // temporarily loan our VBO to the mesh.
+            Mesh mesh{sharedFunctions, sharedShader};
+            // temporarily loan the streaming VBO to the mesh.
             mesh.unsafe_swapVboId(vbo);
             assert(!vbo);
             {
-                mesh.setDynamic(mode, verts);
+                mesh.unsafe_setStreamed(drawMode, first, static_cast<GLsizei>(batch.size()));
                 mesh.render(renderState);
             }
             mesh.unsafe_swapVboId(vbo);
             assert(vbo);
         }
+        const auto after = vbo.get();
+        assert(before == after);
+    };
+
+    if (mode == DrawModeEnum::QUADS && !sharedFunctions->canRenderQuads()) {
+        draw(DrawModeEnum::TRIANGLES, convertQuadsToTris(verts));
+    } else {
+        draw(mode, verts);
     }
-    const auto after = vbo.get();
-    assert(before == after);
-    sharedFunctions->clearVbo(vbo.get());
 }
 
 void Functions::renderPlain(const DrawModeEnum mode,
@@ -231,8 +356,19 @@ UniqueMesh Functions::createFontMesh(const SharedMMTexture &texture,
 Functions::Functions(this_is_private)
     : m_shaderPrograms{std::make_unique<ShaderPrograms>(*this)}
     , m_staticVbos{std::make_unique<StaticVbos>()}
+    , m_streamingVbo{std::make_unique<StreamingVbo>()}
+    , m_timerQueries{std::make_unique<TimerQueries>()}
 {}
 
+void Functions::setBufferBytes(const GLuint vbo, const size_t bytes)
+{
+    size_t &entry = m_bufferBytes[vbo];
+    m_totalBufferBytes = m_totalBufferBytes - entry + bytes;
+    entry = bytes;
+    if (bytes == 0)
+        m_bufferBytes.erase(vbo);
+}
+
 Functions::~Functions()
 {
     cleanup();
@@ -261,6 +397,13 @@ void Functions::cleanup()
 
     getShaderPrograms().resetAll();
     getStaticVbos().resetAll();
+    getStreamingVbo().reset();
+    getTimerQueries().reset(*this);
+
+    if (m_vao != 0) {
+        Base::glDeleteVertexArrays(1, &m_vao);
+        m_vao = 0;
+    }
 }
 
 ShaderPrograms &Functions::getShaderPrograms()
@@ -271,6 +414,14 @@ StaticVbos &Functions::getStaticVbos()
 {
     return deref(m_staticVbos);
 }
+StreamingVbo &Functions::getStreamingVbo()
+{
+    return deref(m_streamingVbo);
+}
+TimerQueries &Functions::getTimerQueries()
+{
+    return deref(m_timerQueries);
+}
 
 std::shared_ptr<Functions> Functions::alloc()
 {
@@ -3,15 +3,18 @@
 // Copyright (C) 2019 The MMapper Authors
 
 #include <cmath>
+#include <cstdint>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <memory>
 #include <optional>
 #include <stdexcept>
 #include <type_traits>
+#include <unordered_map>
 #include <vector>
-#include <QOpenGLFunctions>
+#include <QOpenGLExtraFunctions>
 
+#include "../../global/MemoryReport.h"
 #include "../../global/RuleOf5.h"
 #include "../../global/utils.h"
 #include "../OpenGLTypes.h"
@@ -21,6 +24,8 @@ class OpenGL;
 namespace Legacy {
 
 class StaticVbos;
+class StreamingVbo;
+class TimerQueries;
 struct ShaderPrograms;
 struct PointSizeBinder;
 
@@ -71,19 +76,44 @@ class Functions;
 using SharedFunctions = std::shared_ptr<Functions>;
 using WeakFunctions = std::weak_ptr<Functions>;
 
+/// GL20 uses the GLSL 1.10 shaders in resources/shaders/legacy, and
+/// GL33_CORE uses the GLSL 3.30 ones in resources/shaders/modern.
+enum class NODISCARD BackendEnum : uint8_t { GL20, GL33_CORE };
+
 /// \c Legacy::Functions implements both GL 2.0 and ES 2.0 (based on a subset of
 /// GL 2.0); this is accomplished by using separate implementation files for the
 /// differences between GL 2.0 and ES 2.0.
-class NODISCARD Functions final : private QOpenGLFunctions,
+///
+/// On a GL 3.3 core profile context, it switches to \c BackendEnum::GL33_CORE:
+/// the same meshes, but with the modern shaders, a vertex array object, and
+/// triangles instead of quads.
+///
+/// The GL 3.x entry points of \c QOpenGLExtraFunctions are only used when
+/// \c canRenderInstanced() says the context provides them.
+class NODISCARD Functions final : private QOpenGLExtraFunctions,
                                   public std::enable_shared_from_this<Functions>
 {
 private:
-    using Base = QOpenGLFunctions;
+    using Base = QOpenGLExtraFunctions;
     glm::mat4 m_viewProj = glm::mat4(1);
     Viewport m_viewport;
     float m_devicePixelRatio = 1.f;
+    BackendEnum m_backend = BackendEnum::GL20;
+    bool m_canRenderInstanced = false;
+    bool m_canRenderTextureArrays = false;
+    // Forward-compatible contexts reject line widths other than 1.
+    bool m_canDrawWideLines = true;
+    bool m_canTimeQueries = false;
+    bool m_canCacheProgramBinaries = false;
+    GLuint m_vao = 0;
+    GLFrameStats m_frameStats;
+    // What glBufferData() last allocated for each buffer, for the memory report.
+    std::unordered_map<GLuint, size_t> m_bufferBytes;
+    size_t m_totalBufferBytes = 0;
     std::unique_ptr<ShaderPrograms> m_shaderPrograms;
     std::unique_ptr<StaticVbos> m_staticVbos;
+    std::unique_ptr<StreamingVbo> m_streamingVbo;
+    std::unique_ptr<TimerQueries> m_timerQueries;
 
 private:
     struct NODISCARD this_is_private final
@@ -115,6 +145,19 @@ class NODISCARD Functions final : private QOpenGLFunctions,
 public:
     using Base::initializeOpenGLFunctions;
 
+    /// platform-specific (ES vs GL)
+    /// Picks the backend for the current context; call it after initializeOpenGLFunctions().
+    void initializeBackend();
+
+    NODISCARD BackendEnum getBackend() const { return m_backend; }
+
+    /// Core profiles can't draw without a vertex array object.
+    void bindVertexArray()
+    {
+        if (m_vao != 0)
+            Base::glBindVertexArray(m_vao);
+    }
+
 public:
     using Base::glAttachShader;
     using Base::glBindBuffer;
@@ -127,27 +170,34 @@ class NODISCARD Functions final : private QOpenGLFunctions,
     using Base::glCreateProgram;
     using Base::glCreateShader;
     using Base::glCullFace;
+    using Base::glBeginQuery;
     using Base::glDeleteBuffers;
     using Base::glDeleteProgram;
+    using Base::glDeleteQueries;
     using Base::glDeleteShader;
     using Base::glDepthFunc;
     using Base::glDetachShader;
     using Base::glDisable;
     using Base::glDisableVertexAttribArray;
-    using Base::glDrawArrays;
     using Base::glEnable;
     using Base::glEnableVertexAttribArray;
+    using Base::glEndQuery;
     using Base::glGenBuffers;
+    using Base::glGenQueries;
     using Base::glGetAttribLocation;
     using Base::glGetIntegerv;
+    using Base::glGetProgramBinary;
     using Base::glGetProgramInfoLog;
     using Base::glGetProgramiv;
+    using Base::glGetQueryObjectuiv;
     using Base::glGetShaderInfoLog;
     using Base::glGetShaderiv;
     using Base::glGetString;
     using Base::glGetUniformLocation;
     using Base::glHint;
     using Base::glLinkProgram;
+    using Base::glProgramBinary;
+    using Base::glProgramParameteri;
     using Base::glShaderSource;
     using Base::glUniform1fv;
     using Base::glUniform1iv;
@@ -155,11 +205,51 @@ class NODISCARD Functions final : private QOpenGLFunctions,
     using Base::glUniform4iv;
     using Base::glUniformMatrix4fv;
     using Base::glUseProgram;
+    using Base::glVertexAttribDivisor;
     using Base::glVertexAttribPointer;
 
+public:
+    // These count what they do in getFrameStats().
+    void glBufferSubData(const GLenum target,
+                         const GLintptr offset,
+                         const GLsizeiptr size,
+                         const void *const data)
+    {
+        m_frameStats.bytesUploaded += static_cast<size_t>(size);
+        Base::glBufferSubData(target, offset, size, data);
+    }
+    void glDrawArrays(const GLenum mode, const GLint first, const GLsizei count)
+    {
+        ++m_frameStats.drawCalls;
+        m_frameStats.vertices += static_cast<size_t>(count);
+        Base::glDrawArrays(mode, first, count);
+    }
+    void glDrawArraysInstanced(const GLenum mode,
+                               const GLint first,
+                               const GLsizei count,
+                               const GLsizei instanceCount)
+    {
+        ++m_frameStats.drawCalls;
+        m_frameStats.vertices += static_cast<size_t>(count) * static_cast<size_t>(instanceCount);
+        Base::glDrawArraysInstanced(mode, first, count, instanceCount);
+    }
+
+    NODISCARD const GLFrameStats &getFrameStats() const { return m_frameStats; }
+    void resetFrameStats() { m_frameStats = GLFrameStats{}; }
+
+    // Call with the size of every glBufferData(), and with 0 when the buffer is deleted.
+    void setBufferBytes(GLuint vbo, size_t bytes);
+    NODISCARD MemoryUsage getBufferMemoryUsage() const
+    {
+        return MemoryUsage{m_totalBufferBytes, m_bufferBytes.size()};
+    }
+
 public:
     // OpenGL man page says "Only width 1 is guaranteed to be supported."
-    void glLineWidth(const GLfloat lineWidth) { Base::glLineWidth(scalef(lineWidth)); }
+    void glLineWidth(const GLfloat lineWidth)
+    {
+        Base::glLineWidth(m_canDrawWideLines ? scalef(lineWidth) : 1.f);
+    }
 
 public:
     void glViewport(const GLint x, const GLint y, const GLsizei width, const GLsizei height)
@@ -204,6 +294,10 @@ class NODISCARD Functions final : private QOpenGLFunctions,
 
     NODISCARD StaticVbos &getStaticVbos();
 
+    NODISCARD StreamingVbo &getStreamingVbo();
+
+    NODISCARD TimerQueries &getTimerQueries();
+
 private:
     friend PointSizeBinder;
     /// platform-specific (ES vs GL)
@@ -216,7 +310,13 @@ class NODISCARD Functions final : private QOpenGLFunctions,
 
 public:
     /// platform-specific (ES vs GL)
-    NODISCARD static const char *getShaderVersion();
+    NODISCARD const char *getShaderVersion() const;
+
+    /// The directory of the shaders, under ":/shaders/".
+    NODISCARD const char *getShaderRoot() const
+    {
+        return (m_backend == BackendEnum::GL33_CORE) ? "modern" : "legacy";
+    }
 
 private:
     template<typename _VertexType>
@@ -230,16 +330,30 @@ class NODISCARD Functions final : private QOpenGLFunctions,
         Base::glBindBuffer(GL_ARRAY_BUFFER, vbo);
         Base::glBufferData(GL_ARRAY_BUFFER, numBytes, batch.data(), Legacy::toGLenum(usage));
         Base::glBindBuffer(GL_ARRAY_BUFFER, 0);
+        m_frameStats.bytesUploaded += static_cast<size_t>(numBytes);
+        setBufferBytes(vbo, static_cast<size_t>(numBytes));
         return numVerts;
     }
 
 public:
     /// platform-specific (ES vs GL)
-    NODISCARD static bool canRenderQuads();
+    NODISCARD bool canRenderQuads() const;
 
     /// platform-specific (ES vs GL)
     NODISCARD static std::optional<GLenum> toGLenum(DrawModeEnum mode);
 
+    /// True if the context has glDrawArraysInstanced() and glVertexAttribDivisor().
+    NODISCARD bool canRenderInstanced() const { return m_canRenderInstanced; }
+
+    /// True if instancing works and the shaders can sample GL_TEXTURE_2D_ARRAY.
+    NODISCARD bool canRenderTextureArrays() const { return m_canRenderTextureArrays; }
+
+    /// True if the context has GL_TIME_ELAPSED queries; see TimerQueries.
+    NODISCARD bool canTimeQueries() const { return m_canTimeQueries; }
+
+    /// True if linked programs can be saved with glGetProgramBinary(); see ShaderUtils.
+    NODISCARD bool canCacheProgramBinaries() const { return m_canCacheProgramBinaries; }
+
 public:
     void enableAttrib(const GLuint index,
                       const GLint size,
@@ -266,11 +380,21 @@ class NODISCARD Functions final : private QOpenGLFunctions,
         return std::pair(mode, setVbo_internal(vbo, batch, usage));
     }
 
+    // Uploads the batch as-is, e.g. for per-instance attributes.
+    template<typename T>
+    NODISCARD GLsizei setRawVbo(const GLuint vbo,
+                                const std::vector<T> &batch,
+                                const BufferUsageEnum usage = BufferUsageEnum::STATIC_DRAW)
+    {
+        return setVbo_internal(vbo, batch, usage);
+    }
+
     void clearVbo(const GLuint vbo, const BufferUsageEnum usage = BufferUsageEnum::DYNAMIC_DRAW)
     {
         Base::glBindBuffer(GL_ARRAY_BUFFER, vbo);
         Base::glBufferData(GL_ARRAY_BUFFER, 0, nullptr, Legacy::toGLenum(usage));
         Base::glBindBuffer(GL_ARRAY_BUFFER, 0);
+        setBufferBytes(vbo, 0);
     }
 
 public:
@@ -286,6 +410,21 @@ class NODISCARD Functions final : private QOpenGLFunctions,
                                                     const std::vector<ColoredTexVert> &batch,
                                                     const SharedMMTexture &texture);
 
+public:
+    // One unit quad per position; these fall back to quad batches without instancing.
+    NODISCARD UniqueMesh createPlainQuadInstances(const std::vector<glm::vec3> &positions);
+    NODISCARD UniqueMesh createTexturedQuadInstances(const std::vector<glm::vec3> &positions,
+                                                     const SharedMMTexture &texture);
+    NODISCARD UniqueMesh createColoredTexturedQuadInstances(
+        const std::vector<ColorVert> &instances, const SharedMMTexture &texture);
+    // Requires canRenderTextureArrays(); w is the layer of the array texture.
+    NODISCARD UniqueMesh createArrayTexturedQuadInstances(const std::vector<glm::vec4> &instances,
+                                                          const SharedMMTexture &texture);
+    // Triangle shapes[w] (VERTS_PER_TRI offsets each) at the xyz of each instance;
+    // this falls back to a triangle batch without instancing.
+    NODISCARD UniqueMesh createPlainTriangleInstances(const std::vector<glm::vec2> &shapes,
+                                                      const std::vector<glm::vec4> &instances);
+
 public:
     NODISCARD UniqueMesh createFontMesh(const SharedMMTexture &texture,
                                         DrawModeEnum mode,
@@ -5,13 +5,21 @@
 
 #include <cassert>
 #include <cstdio>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
 #include <string_view>
 #include <vector>
+#include <QByteArray>
+#include <QCryptographicHash>
 #include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
 #include <QMessageBox>
+#include <QSaveFile>
+#include <QStandardPaths>
 
 #include "../../global/Debug.h"
 #include "../../global/TextUtils.h"
@@ -24,6 +32,12 @@ static const bool VERBOSE_SHADER_DEBUG = []() -> bool {
     }
     return false;
 }();
+static const bool DISABLE_PROGRAM_BINARY_CACHE = []() -> bool {
+    if (auto opt = utils::getEnvBool("MMAPPER_DISABLE_SHADER_CACHE")) {
+        return opt.value();
+    }
+    return false;
+}();
 static constexpr const auto npos = std::string_view::npos;
 
 template<typename Callback>
@@ -199,7 +213,7 @@ NODISCARD static GLuint compileShader(Functions &gl, const GLenum type, const So
     // NOTE: GLES 2.0 required `const char**` instead of `const char*const*`,
     // so Qt uses the least common denominator without the middle const;
     // that's the reason the `ptrs` array below is not `const`.
-    std::array<const char *, 3> ptrs = {Functions::getShaderVersion(),
+    std::array<const char *, 3> ptrs = {gl.getShaderVersion(),
                                         "#line 1\n",
                                         source.source.c_str()};
     gl.glShaderSource(shaderId, static_cast<GLsizei>(ptrs.size()), ptrs.data(), nullptr);
@@ -209,7 +223,7 @@ NODISCARD static GLuint compileShader(Functions &gl, const GLenum type, const So
     return shaderId;
 }
 
-GLuint loadShaders(Functions &gl, const Source &vert, const Source &frag)
+NODISCARD static GLuint compileAndLink(Functions &gl, const Source &vert, const Source &frag)
 {
     std::vector<GLuint> shaders{compileShader(gl, GL_VERTEX_SHADER, vert),
                                 compileShader(gl, GL_FRAGMENT_SHADER, frag)};
@@ -226,6 +240,9 @@ GLuint loadShaders(Functions &gl, const Source &vert, const Source &frag)
     }
 
     const GLuint prog = gl.glCreateProgram();
+    if (gl.canCacheProgramBinaries()) {
+        gl.glProgramParameteri(prog, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
     for (const GLuint s : shaders) {
         if (is_valid(s)) {
             gl.glAttachShader(prog, s);
@@ -245,4 +262,112 @@ GLuint loadShaders(Functions &gl, const Source &vert, const Source &frag)
     return prog;
 }
 
+// The cached programs live in files named after a hash of the driver strings
+// and both sources, so a driver update or a changed shader simply misses.
+// Each file holds the binary format followed by the program binary.
+NODISCARD static QString getProgramBinaryPath(Functions &gl,
+                                              const Source &vert,
+                                              const Source &frag)
+{
+    const QString dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (dir.isEmpty())
+        return QString{};
+
+    const auto getString = [&gl](const GLenum name) -> QByteArray {
+        const auto *const str = reinterpret_cast<const char *>(gl.glGetString(name));
+        return QByteArray{(str == nullptr) ? "" : str};
+    };
+
+    QCryptographicHash hash{QCryptographicHash::Sha1};
+    for (const GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+        hash.addData(getString(name));
+        hash.addData("\n", 1);
+    }
+    hash.addData(gl.getShaderVersion());
+    for (const Source *const source : {&vert, &frag}) {
+        hash.addData(source->filename.c_str(), static_cast<int>(source->filename.size()));
+        hash.addData("\n", 1);
+        hash.addData(source->source.c_str(), static_cast<int>(source->source.size()));
+    }
+
+    return dir + "/shaders/" + QString::fromLatin1(hash.result().toHex()) + ".bin";
+}
+
+NODISCARD static GLuint loadProgramBinary(Functions &gl, const QString &path)
+{
+    QFile file{path};
+    if (!file.open(QIODevice::ReadOnly))
+        return 0;
+
+    const QByteArray contents = file.readAll();
+    if (contents.size() <= static_cast<int>(sizeof(GLenum)))
+        return 0;
+
+    GLenum format = 0;
+    std::memcpy(&format, contents.constData(), sizeof(GLenum));
+    const char *const binary = contents.constData() + sizeof(GLenum);
+    const auto length = static_cast<GLsizei>(static_cast<size_t>(contents.size())
+                                             - sizeof(GLenum));
+
+    const GLuint prog = gl.glCreateProgram();
+    gl.glProgramBinary(prog, format, binary, length);
+
+    // The driver is allowed to reject any binary, so this isn't an error.
+    GLint result = GL_FALSE;
+    gl.glGetProgramiv(prog, GL_LINK_STATUS, &result);
+    if (result != GL_TRUE) {
+        gl.glDeleteProgram(prog);
+        return 0;
+    }
+
+    return prog;
+}
+
+static void saveProgramBinary(Functions &gl, const GLuint prog, const QString &path)
+{
+    GLint length = 0;
+    gl.glGetProgramiv(prog, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    QByteArray contents{static_cast<int>(sizeof(GLenum)) + length, '\0'};
+    GLenum format = 0;
+    GLsizei written = 0;
+    gl.glGetProgramBinary(prog, length, &written, &format, contents.data() + sizeof(GLenum));
+    if (written <= 0)
+        return;
+    std::memcpy(contents.data(), &format, sizeof(GLenum));
+    contents.resize(static_cast<int>(sizeof(GLenum)) + written);
+
+    if (!QDir{}.mkpath(QFileInfo{path}.absolutePath()))
+        return;
+
+    QSaveFile file{path};
+    if (!file.open(QIODevice::WriteOnly) || file.write(contents) != contents.size()
+        || !file.commit()) {
+        qWarning() << "Unable to write the shader cache" << path;
+    }
+}
+
+GLuint loadShaders(Functions &gl, const Source &vert, const Source &frag)
+{
+    if (DISABLE_PROGRAM_BINARY_CACHE || !gl.canCacheProgramBinaries())
+        return compileAndLink(gl, vert, frag);
+
+    const QString path = getProgramBinaryPath(gl, vert, frag);
+    if (path.isEmpty())
+        return compileAndLink(gl, vert, frag);
+
+    if (const GLuint prog = loadProgramBinary(gl, path); prog != 0) {
+        if constexpr ((IS_DEBUG_BUILD)) {
+            qDebug() << "Loaded cached program for" << vert.filename.c_str();
+        }
+        return prog;
+    }
+
+    const GLuint prog = compileAndLink(gl, vert, frag);
+    saveProgramBinary(gl, prog, path);
+    return prog;
+}
+
 } // namespace ShaderUtils
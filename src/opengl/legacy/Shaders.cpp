@@ -17,9 +17,11 @@ NODISCARD static std::string readWholeResourceFile(const std::string &fullPath)
     return in.readAll().toUtf8().toStdString();
 }
 
-NODISCARD static ShaderUtils::Source readWholeShader(const std::string &dir, const std::string &name)
+NODISCARD static ShaderUtils::Source readWholeShader(const std::string &root,
+                                                     const std::string &dir,
+                                                     const std::string &name)
 {
-    const auto fullPathName = ":/shaders/legacy/" + dir + "/" + name;
+    const auto fullPathName = ":/shaders/" + root + "/" + dir + "/" + name;
     return ShaderUtils::Source{fullPathName, readWholeResourceFile(fullPathName)};
 }
 
@@ -39,8 +41,9 @@ NODISCARD static std::shared_ptr<T> loadSimpleShaderProgram(Functions &functions
 {
     static_assert(std::is_base_of_v<AbstractShaderProgram, T>);
 
-    const auto getSource = [&dir](const std::string &name) -> ShaderUtils::Source {
-        return ::readWholeShader(dir, name);
+    const std::string root = functions.getShaderRoot();
+    const auto getSource = [&root, &dir](const std::string &name) -> ShaderUtils::Source {
+        return ::readWholeShader(root, dir, name);
     };
 
     const GLuint program = ShaderUtils::loadShaders(functions,
@@ -81,6 +84,34 @@ const std::shared_ptr<UColorTexturedShader> &ShaderPrograms::getTexturedUColorSh
     return getInitialized<UColorTexturedShader>(uTexturedShader, getFunctions(), "tex/ucolor");
 }
 
+const std::shared_ptr<UColorPlainShader> &ShaderPrograms::getInstancedPlainUColorShader()
+{
+    return getInitialized<UColorPlainShader>(instancedUColorShader,
+                                             getFunctions(),
+                                             "instanced/plain/ucolor");
+}
+
+const std::shared_ptr<AColorTexturedShader> &ShaderPrograms::getInstancedTexturedAColorShader()
+{
+    return getInitialized<AColorTexturedShader>(instancedATexturedShader,
+                                                getFunctions(),
+                                                "instanced/tex/acolor");
+}
+
+const std::shared_ptr<UColorTexturedShader> &ShaderPrograms::getInstancedTexturedUColorShader()
+{
+    return getInitialized<UColorTexturedShader>(instancedUTexturedShader,
+                                                getFunctions(),
+                                                "instanced/tex/ucolor");
+}
+
+const std::shared_ptr<UColorTexturedShader> &ShaderPrograms::getInstancedArrayTexturedUColorShader()
+{
+    return getInitialized<UColorTexturedShader>(instancedUArrayTexturedShader,
+                                                getFunctions(),
+                                                "instanced/texarray/ucolor");
+}
+
 const std::shared_ptr<FontShader> &ShaderPrograms::getFontShader()
 {
     return getInitialized<FontShader>(font, getFunctions(), "font");
@@ -118,6 +118,10 @@ struct NODISCARD ShaderPrograms final
     std::shared_ptr<UColorPlainShader> uColorShader;
     std::shared_ptr<AColorTexturedShader> aTexturedShader;
     std::shared_ptr<UColorTexturedShader> uTexturedShader;
+    std::shared_ptr<UColorPlainShader> instancedUColorShader;
+    std::shared_ptr<AColorTexturedShader> instancedATexturedShader;
+    std::shared_ptr<UColorTexturedShader> instancedUTexturedShader;
+    std::shared_ptr<UColorTexturedShader> instancedUArrayTexturedShader;
     std::shared_ptr<FontShader> font;
     std::shared_ptr<PointShader> point;
 
@@ -138,6 +142,10 @@ struct NODISCARD ShaderPrograms final
         uColorShader.reset();
         aTexturedShader.reset();
         uTexturedShader.reset();
+        instancedUColorShader.reset();
+        instancedATexturedShader.reset();
+        instancedUTexturedShader.reset();
+        instancedUArrayTexturedShader.reset();
         font.reset();
         point.reset();
     }
@@ -151,6 +159,12 @@ struct NODISCARD ShaderPrograms final
     NODISCARD const std::shared_ptr<AColorTexturedShader> &getTexturedAColorShader();
     // uniform color + textured (aka "Textured")
     NODISCARD const std::shared_ptr<UColorTexturedShader> &getTexturedUColorShader();
+    // unit quad instances of the above (see InstancedQuadMesh)
+    NODISCARD const std::shared_ptr<UColorPlainShader> &getInstancedPlainUColorShader();
+    NODISCARD const std::shared_ptr<AColorTexturedShader> &getInstancedTexturedAColorShader();
+    NODISCARD const std::shared_ptr<UColorTexturedShader> &getInstancedTexturedUColorShader();
+    // uniform color + GL_TEXTURE_2D_ARRAY
+    NODISCARD const std::shared_ptr<UColorTexturedShader> &getInstancedArrayTexturedUColorShader();
     NODISCARD const std::shared_ptr<FontShader> &getFontShader();
     NODISCARD const std::shared_ptr<PointShader> &getPointShader();
 };
@@ -26,6 +26,7 @@ class NODISCARD SimpleMesh : public IRenderable
     _ProgramType &m_program;
     VBO m_vbo;
     DrawModeEnum m_drawMode = DrawModeEnum::INVALID;
+    GLint m_firstVert = 0;
     GLsizei m_numVerts = 0;
 
 public:
@@ -83,6 +84,16 @@ class NODISCARD SimpleMesh : public IRenderable
 public:
     void unsafe_swapVboId(VBO &vbo) { return m_vbo.unsafe_swapVboId(vbo); }
 
+    // Draws verts that were already uploaded to the loaned VBO; see StreamingVbo.
+    void unsafe_setStreamed(const DrawModeEnum mode, const GLint first, const GLsizei numVerts)
+    {
+        assert(m_vbo);
+        assert(mode != DrawModeEnum::INVALID);
+        m_drawMode = mode;
+        m_firstVert = first;
+        m_numVerts = numVerts;
+    }
+
 public:
     void setDynamic(const DrawModeEnum mode, const std::vector<_VertexType> &verts)
     {
@@ -114,6 +125,7 @@ class NODISCARD SimpleMesh : public IRenderable
         if (m_vbo) {
             auto tmp = m_functions.setVbo(mode, m_vbo.get(), verts, usage);
             m_drawMode = tmp.first;
+            m_firstVert = 0;
             m_numVerts = tmp.second;
         } else {
             // REVISIT: Should this be reported as an error?
@@ -136,6 +148,7 @@ class NODISCARD SimpleMesh : public IRenderable
     void virt_reset() final
     {
         m_drawMode = DrawModeEnum::INVALID;
+        m_firstVert = 0;
         m_numVerts = 0;
         m_vbo.reset();
         assert(isEmpty() && !m_vbo);
@@ -164,7 +177,7 @@ class NODISCARD SimpleMesh : public IRenderable
         m_functions.checkError();
 
         if (const std::optional<GLenum> &optMode = Functions::toGLenum(m_drawMode)) {
-            m_functions.glDrawArrays(optMode.value(), 0, m_numVerts);
+            m_functions.glDrawArrays(optMode.value(), m_firstVert, m_numVerts);
         } else {
             assert(false);
         }
@@ -0,0 +1,79 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "TimerQueries.h"
+
+#include <cassert>
+
+namespace Legacy {
+
+void TimerQueries::begin(Functions &gl, const size_t phase)
+{
+    assert(!m_active.has_value());
+    Frame &frame = m_frames[m_current];
+    if (phase >= frame.queries.size()) {
+        frame.queries.resize(phase + 1, 0);
+        frame.used.resize(phase + 1, false);
+    }
+
+    GLuint &query = frame.queries[phase];
+    if (query == 0) {
+        gl.glGenQueries(1, &query);
+    }
+    gl.glBeginQuery(GL_TIME_ELAPSED, query);
+    frame.used[phase] = true;
+    m_active = phase;
+}
+
+void TimerQueries::end(Functions &gl)
+{
+    assert(m_active.has_value());
+    gl.glEndQuery(GL_TIME_ELAPSED);
+    m_active.reset();
+}
+
+void TimerQueries::endFrame(Functions &gl)
+{
+    assert(!m_active.has_value());
+    m_current = (m_current + 1) % NUM_FRAMES;
+
+    // This is now the oldest frame, and the next one to be reused.
+    Frame &frame = m_frames[m_current];
+    m_resultsMs.assign(frame.queries.size(), std::nullopt);
+    for (size_t phase = 0; phase < frame.queries.size(); ++phase) {
+        if (!frame.used[phase])
+            continue;
+        frame.used[phase] = false;
+
+        const GLuint query = frame.queries[phase];
+        GLuint available = GL_FALSE;
+        gl.glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available == GL_FALSE)
+            continue;
+
+        // 32 bits of nanoseconds is over 4 seconds, which is plenty for a frame.
+        GLuint nanoseconds = 0;
+        gl.glGetQueryObjectuiv(query, GL_QUERY_RESULT, &nanoseconds);
+        m_resultsMs[phase] = static_cast<double>(nanoseconds) * 1e-6;
+    }
+}
+
+void TimerQueries::reset(Functions &gl)
+{
+    if (m_active.has_value()) {
+        end(gl);
+    }
+    for (Frame &frame : m_frames) {
+        for (GLuint &query : frame.queries) {
+            if (query != 0) {
+                gl.glDeleteQueries(1, &query);
+                query = 0;
+            }
+        }
+        frame = Frame{};
+    }
+    m_current = 0;
+    m_resultsMs.clear();
+}
+
+} // namespace Legacy
@@ -0,0 +1,62 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <array>
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+#include "../../global/RuleOf5.h"
+#include "../../global/utils.h"
+#include "Legacy.h"
+
+namespace Legacy {
+
+/// GL_TIME_ELAPSED queries for the phases of a frame.
+///
+/// A frame's results are read NUM_FRAMES frames later, when the GPU has
+/// normally finished with it; a result that still isn't available is dropped
+/// instead of waited for, so timing a frame never stalls the pipeline the way
+/// glFinish() does.
+///
+/// Requires Functions::canTimeQueries().
+class NODISCARD TimerQueries final
+{
+public:
+    static constexpr const size_t NUM_FRAMES = 4;
+
+private:
+    struct NODISCARD Frame final
+    {
+        std::vector<GLuint> queries;
+        std::vector<bool> used;
+    };
+
+    std::array<Frame, NUM_FRAMES> m_frames;
+    size_t m_current = 0;
+    std::optional<size_t> m_active;
+    std::vector<std::optional<double>> m_resultsMs;
+
+public:
+    TimerQueries() = default;
+    DELETE_CTORS_AND_ASSIGN_OPS(TimerQueries);
+    ~TimerQueries() = default;
+
+public:
+    /// Only one phase can be timed at once.
+    void begin(Functions &gl, size_t phase);
+    void end(Functions &gl);
+    /// Call once at the end of each frame.
+    void endFrame(Functions &gl);
+    void reset(Functions &gl);
+
+public:
+    /// Indexed by phase; empty for the phases that weren't timed, or that weren't ready.
+    NODISCARD const std::vector<std::optional<double>> &getResultsMs() const
+    {
+        return m_resultsMs;
+    }
+};
+
+} // namespace Legacy
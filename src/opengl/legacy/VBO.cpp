@@ -3,6 +3,8 @@
 
 #include "VBO.h"
 
+#include <algorithm>
+
 namespace Legacy {
 bool LOG_VBO_ALLOCATIONS = false;
 bool LOG_VBO_STATIC_UPLOADS = false;
@@ -25,6 +27,7 @@ void VBO::reset()
             qInfo() << this << "Freeing VBO" << vbo;
         }
         auto sharedFunctions = std::exchange(m_weakFunctions, {}).lock();
+        deref(sharedFunctions).setBufferBytes(vbo, 0);
         deref(sharedFunctions).glDeleteBuffers(1, &vbo);
     }
     assert(m_weakFunctions.lock() == nullptr);
@@ -37,4 +40,53 @@ GLuint VBO::get()
     return m_vbo;
 }
 
+void StreamingVbo::reset()
+{
+    m_vbo.reset();
+    m_size = 0;
+    m_offset = 0;
+}
+
+size_t StreamingVbo::write(const SharedFunctions &sharedFunctions,
+                           const void *const data,
+                           const size_t numBytes,
+                           const size_t alignment)
+{
+    assert(alignment != 0);
+    Functions &gl = deref(sharedFunctions);
+    if (!m_vbo) {
+        m_vbo.emplace(sharedFunctions);
+        m_size = 0;
+    }
+
+    size_t offset = (m_offset + alignment - 1) / alignment * alignment;
+    gl.glBindBuffer(GL_ARRAY_BUFFER, m_vbo.get());
+    if (offset + numBytes > m_size) {
+        // Orphan the old storage; the draws that still use it keep it alive.
+        if (numBytes > m_size) {
+            m_size = std::max(MIN_SIZE, m_size);
+            while (m_size < numBytes)
+                m_size *= 2;
+            if (LOG_VBO_ALLOCATIONS) {
+                qInfo() << this << "Resizing streaming VBO" << m_vbo.get() << "to" << m_size
+                        << "bytes";
+            }
+        }
+        gl.glBufferData(GL_ARRAY_BUFFER,
+                        static_cast<GLsizeiptr>(m_size),
+                        nullptr,
+                        Legacy::toGLenum(BufferUsageEnum::DYNAMIC_DRAW));
+        gl.setBufferBytes(m_vbo.get(), m_size);
+        offset = 0;
+    }
+    gl.glBufferSubData(GL_ARRAY_BUFFER,
+                       static_cast<GLintptr>(offset),
+                       static_cast<GLsizeiptr>(numBytes),
+                       data);
+    gl.glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    m_offset = offset + numBytes;
+    return offset;
+}
+
 } // namespace Legacy
@@ -2,6 +2,10 @@
 // SPDX-License-Identifier: GPL-2.0-or-later
 // Copyright (C) 2019 The MMapper Authors
 
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
 #include "../../global/utils.h"
 #include "Legacy.h"
 
@@ -37,6 +41,54 @@ class NODISCARD VBO final
 using SharedVbo = std::shared_ptr<VBO>;
 using WeakVbo = std::weak_ptr<VBO>;
 
+/// One VBO shared by every immediate-mode draw (see renderImmediate()).
+///
+/// Each batch is appended after the previous one; once the buffer is full,
+/// it's orphaned and filling starts again from the beginning, so the driver
+/// never has to wait for the GPU to finish with the old contents, and there's
+/// no allocation as long as the batches fit.
+class NODISCARD StreamingVbo final
+{
+public:
+    static constexpr size_t MIN_SIZE = 1u << 20;
+
+private:
+    VBO m_vbo;
+    size_t m_size = 0;
+    size_t m_offset = 0;
+
+public:
+    StreamingVbo() = default;
+    DELETE_CTORS_AND_ASSIGN_OPS(StreamingVbo);
+    ~StreamingVbo() = default;
+
+public:
+    NODISCARD VBO &getVbo() { return m_vbo; }
+    void reset();
+
+public:
+    /// Returns the index of the first vertex of the batch in the VBO.
+    template<typename _VertexType>
+    NODISCARD GLint append(const SharedFunctions &sharedFunctions,
+                           const std::vector<_VertexType> &batch)
+    {
+        constexpr size_t vertSize = sizeof(_VertexType);
+        const size_t offset = write(sharedFunctions,
+                                    batch.data(),
+                                    batch.size() * vertSize,
+                                    vertSize);
+        assert(offset % vertSize == 0);
+        return static_cast<GLint>(offset / vertSize);
+    }
+
+private:
+    /// Returns the offset of the data, which is a multiple of alignment.
+    NODISCARD size_t write(const SharedFunctions &sharedFunctions,
+                           const void *data,
+                           size_t numBytes,
+                           size_t alignment);
+};
+
 class NODISCARD StaticVbos final : private std::vector<SharedVbo>
 {
 private:
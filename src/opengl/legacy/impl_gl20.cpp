@@ -1,10 +1,13 @@
 #include "Legacy.h"
 
+#include <QOpenGLContext>
+
 namespace Legacy {
 
-bool Functions::canRenderQuads()
+bool Functions::canRenderQuads() const
 {
-    return true;
+    // GL_QUADS was removed from the core profile.
+    return m_backend == BackendEnum::GL20;
 }
 
 std::optional<GLenum> Functions::toGLenum(const DrawModeEnum mode)
@@ -25,8 +28,45 @@ std::optional<GLenum> Functions::toGLenum(const DrawModeEnum mode)
     return std::nullopt;
 }
 
-const char *Functions::getShaderVersion()
+void Functions::initializeBackend()
+{
+    const QOpenGLContext &context = deref(QOpenGLContext::currentContext());
+    const QSurfaceFormat format = context.format();
+    const bool isGL33 = format.version() >= qMakePair(3, 3);
+    const bool isCore = isGL33 && format.profile() == QSurfaceFormat::CoreProfile;
+
+    m_backend = isCore ? BackendEnum::GL33_CORE : BackendEnum::GL20;
+    m_canRenderInstanced = isGL33;
+    // The legacy shaders are GLSL 1.10, so they get sampler2DArray from the extension.
+    m_canRenderTextureArrays = isCore
+                               || (isGL33 && context.hasExtension("GL_EXT_texture_array"));
+    m_canDrawWideLines = !isCore || format.testOption(QSurfaceFormat::DeprecatedFunctions);
+    m_canTimeQueries = !context.isOpenGLES()
+                       && (isGL33 || context.hasExtension("GL_ARB_timer_query"));
+    m_canCacheProgramBinaries = [this, &context, &format]() -> bool {
+        const bool hasProgramBinary = context.isOpenGLES()
+                                          ? format.majorVersion() >= 3
+                                          : (format.version() >= qMakePair(4, 1)
+                                             || context.hasExtension("GL_ARB_get_program_binary"));
+        if (!hasProgramBinary)
+            return false;
+        // Some drivers have the entry points but don't support any formats.
+        GLint numFormats = 0;
+        Base::glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+        return numFormats > 0;
+    }();
+
+    if (isCore && m_vao == 0) {
+        Base::glGenVertexArrays(1, &m_vao);
+        Base::glBindVertexArray(m_vao);
+    }
+}
+
+const char *Functions::getShaderVersion() const
 {
+    if (m_backend == BackendEnum::GL33_CORE) {
+        return "#version 330 core\n\n";
+    }
     return "#version 110\n\n";
 }
 
@@ -54,13 +94,18 @@ bool Functions::tryEnableMultisampling(const int requestedSamples)
 
     const bool hasMultisampling = getSampleBuffers() > 1 || getSamples() > 1;
 
+    // GL_POINT_SMOOTH was removed from the core profile.
+    const bool canSmoothPoints = m_backend == BackendEnum::GL20;
+
     if (hasMultisampling && requestedSamples > 0) {
         Base::glEnable(GL_MULTISAMPLE);
 
-        Base::glEnable(GL_POINT_SMOOTH);
+        if (canSmoothPoints) {
+            Base::glEnable(GL_POINT_SMOOTH);
+            Base::glHint(GL_POINT_SMOOTH_HINT, GL_NICEST);
+        }
         Base::glEnable(GL_LINE_SMOOTH);
         Base::glDisable(GL_POLYGON_SMOOTH);
-        Base::glHint(GL_POINT_SMOOTH_HINT, GL_NICEST);
         Base::glHint(GL_LINE_SMOOTH_HINT, GL_NICEST);
 
         return true;
@@ -68,14 +113,18 @@ bool Functions::tryEnableMultisampling(const int requestedSamples)
         // NOTE: Currently we can use OpenGL 2.1 to fake multisampling with point/line/polygon smoothing.
         // TODO: We can use OpenGL 3.x FBOs to do multisampling even if the default framebuffer doesn't support it.
         if (requestedSamples > 0) {
-            Base::glEnable(GL_POINT_SMOOTH);
+            if (canSmoothPoints) {
+                Base::glEnable(GL_POINT_SMOOTH);
+                Base::glHint(GL_POINT_SMOOTH_HINT, GL_NICEST);
+            }
             Base::glEnable(GL_LINE_SMOOTH);
             Base::glDisable(GL_POLYGON_SMOOTH);
-            Base::glHint(GL_POINT_SMOOTH_HINT, GL_NICEST);
             Base::glHint(GL_LINE_SMOOTH_HINT, GL_NICEST);
             return true;
         } else {
-            Base::glDisable(GL_POINT_SMOOTH);
+            if (canSmoothPoints) {
+                Base::glDisable(GL_POINT_SMOOTH);
+            }
             Base::glDisable(GL_LINE_SMOOTH);
             Base::glDisable(GL_POLYGON_SMOOTH);
             return false;
@@ -6,6 +6,7 @@
 #include "CGroup.h"
 
 #include <cassert>
+#include <cstddef>
 #include <memory>
 #include <QByteArray>
 #include <QMessageLogContext>
@@ -22,6 +23,15 @@
 CGroup::CGroup(QObject *const parent)
     : QObject(parent)
     , self{CGroupChar::alloc()}
+    , m_memoryReport{[this](const memory_report::AddFn &add) {
+        QMutexLocker locker(&characterLock);
+        const size_t count = charIndex.size();
+        add("group: characters",
+            MemoryUsage{count * sizeof(CGroupChar)
+                            + static_cast<size_t>(namePositions.size()) * 2 * sizeof(void *)
+                            + static_cast<size_t>(foldedNames.size()) * 2 * sizeof(void *),
+                        count});
+    }}
 {
     const Configuration::GroupManagerSettings &groupManager = getConfig().groupManager;
     self->setName(groupManager.charName);
@@ -102,6 +112,7 @@ void CGroup::resetChars()
     }
     charIndex.clear();
     charIndex.push_back(self);
+    reindex();
 
     characterChanged(true);
 }
@@ -117,6 +128,8 @@ bool CGroup::addChar(const QVariantMap &map)
         return false;
     }
     log(QString("'%1' joined the group.").arg(QString::fromLatin1(newChar->getName())));
+    namePositions.insert(newChar->getName(), charIndex.size());
+    foldedNames.insert(foldName(newChar->getName()));
     charIndex.push_back(newChar);
     characterChanged(true);
     return true;
@@ -130,15 +143,32 @@ void CGroup::removeChar(const QByteArray &name)
         return;
     }
 
-    for (auto it = charIndex.begin(); it != charIndex.end(); ++it) {
-        SharedGroupChar character = *it;
-        if (character->getName() == name) {
-            log(QString("Removing '%1' from the group.")
-                    .arg(QString::fromLatin1(character->getName())));
-            charIndex.erase(it);
-            characterChanged(true);
-            return;
-        }
+    const auto it = namePositions.find(name);
+    if (it == namePositions.end())
+        return;
+
+    log(QString("Removing '%1' from the group.").arg(QString::fromLatin1(name)));
+    charIndex.erase(charIndex.begin() + static_cast<std::ptrdiff_t>(it.value()));
+    // Everyone after the removed character moves up; leaving is rare enough.
+    reindex();
+    characterChanged(true);
+}
+
+QString CGroup::foldName(const QByteArray &name)
+{
+    return QString::fromLatin1(name).toCaseFolded();
+}
+
+void CGroup::reindex()
+{
+    namePositions.clear();
+    foldedNames.clear();
+    for (size_t i = 0; i < charIndex.size(); ++i) {
+        const SharedGroupChar &character = charIndex[i];
+        if (character == self)
+            continue;
+        namePositions.insert(character->getName(), i);
+        foldedNames.insert(foldName(character->getName()));
     }
 }
 
@@ -146,37 +176,31 @@ bool CGroup::isNamePresent(const QByteArray &name) const
 {
     QMutexLocker locker(&characterLock);
 
-    const QString nameStr = name.simplified();
-    for (const auto &character : charIndex) {
-        if (nameStr.compare(character->getName(), Qt::CaseInsensitive) == 0) {
-            return true;
-        }
-    }
-
-    return false;
+    const QString nameStr = foldName(name.simplified());
+    return foldedNames.contains(nameStr) || nameStr == foldName(self->getName());
 }
 
 SharedGroupChar CGroup::getCharByName(const QByteArray &name) const
 {
     QMutexLocker locker(&characterLock);
-    for (const auto &character : charIndex) {
-        if (character->getName() == name) {
-            return character;
-        }
-    }
-    return {};
+    if (self->getName() == name)
+        return self;
+    const auto it = namePositions.find(name);
+    if (it == namePositions.end())
+        return {};
+    return charIndex[it.value()];
 }
 
-void CGroup::updateChar(const QVariantMap &map)
+void CGroup::updateChar(const CharUpdate &update)
 {
-    const auto sharedCh = getCharByName(CGroupChar::getNameFromUpdateChar(map));
+    const auto sharedCh = getCharByName(update.name);
     if (sharedCh == nullptr) {
         return;
     }
 
     CGroupChar &ch = *sharedCh;
     const auto oldRoomId = ch.getRoomId();
-    const bool change = ch.updateFromVariantMap(map);
+    const bool change = ch.applyUpdate(update);
     if (!change) {
         return;
     }
@@ -209,6 +233,12 @@ void CGroup::renameChar(const QVariantMap &map)
         return;
     }
 
+    if (ch != self) {
+        const size_t pos = namePositions.take(ch->getName());
+        foldedNames.remove(foldName(ch->getName()));
+        namePositions.insert(newname.toLatin1(), pos);
+        foldedNames.insert(foldName(newname.toLatin1()));
+    }
     ch->setName(newname.toLatin1());
     characterChanged(false);
 }
@@ -8,13 +8,17 @@
 #include <set>
 #include <vector>
 #include <QByteArray>
+#include <QHash>
 #include <QMutex>
 #include <QObject>
+#include <QSet>
+#include <QString>
 #include <QVariantMap>
 #include <QWidget>
 #include <QtCore>
 #include <queue>
 
+#include "../global/MemoryReport.h"
 #include "../global/RuleOf5.h"
 #include "CGroupChar.h"
 #include "groupselection.h"
@@ -66,18 +70,27 @@ public slots:
     NODISCARD const SharedGroupChar &getSelf() { return self; }
     void renameChar(const QVariantMap &map);
     void resetChars();
-    void updateChar(const QVariantMap &map); // updates given char from the map
+    void updateChar(const CharUpdate &update); // updates given char from the update
     void removeChar(const QByteArray &name);
     bool addChar(const QVariantMap &node);
 
 public:
     NODISCARD SharedGroupChar getCharByName(const QByteArray &name) const;
 
+private:
+    NODISCARD static QString foldName(const QByteArray &name);
+    void reindex();
+
 private:
     mutable QRecursiveMutex characterLock;
     std::set<GroupRecipient *> locks;
     std::queue<std::shared_ptr<GroupAction>> actionSchedule;
     GroupVector charIndex;
+    // Positions in charIndex, and case-folded names, of everyone but self:
+    // Mmapper2Group renames self without telling us.
+    QHash<QByteArray, size_t> namePositions;
+    QSet<QString> foldedNames;
     // deleted in destructor as member of charIndex
     SharedGroupChar self;
+    memory_report::Registration m_memoryReport;
 };
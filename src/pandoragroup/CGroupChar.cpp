@@ -22,46 +22,159 @@ KEY colorKey = "color";
 KEY stateKey = "state";
 KEY prespamKey = "prespam";
 KEY affectsKey = "affects";
+KEY seqKey = "seq";
+KEY deltaKey = "delta";
 
 #undef KEY
 
 CGroupChar::CGroupChar(this_is_private){};
 CGroupChar::~CGroupChar() = default;
 
-const QVariantMap CGroupChar::toVariantMap() const
+CharUpdate CharUpdate::fromVariantMap(const QVariantMap &data)
+{
+    CharUpdate update;
+    const auto root = data.constFind(playerDataKey);
+    if (root == data.cend() || !root->canConvert(QMetaType::QVariantMap)) {
+        qWarning() << "Unable to find" << QuotedQString(playerDataKey) << "in map" << data;
+        return update;
+    }
+
+    const auto toInt = [](const QVariant &value) -> std::optional<int> {
+        if (!value.canConvert(QMetaType::Int))
+            return std::nullopt;
+        return value.toInt();
+    };
+    const auto toUInt = [](const QVariant &value) -> std::optional<uint32_t> {
+        if (!value.canConvert(QMetaType::UInt))
+            return std::nullopt;
+        return value.toUInt();
+    };
+    const auto toLatin1 = [](const QVariant &value) -> std::optional<QByteArray> {
+        if (!value.canConvert(QMetaType::QString))
+            return std::nullopt;
+        return value.toString().toLatin1();
+    };
+
+    const auto decodeScore = [&update, &toInt](const QString &key, const QVariant &value) {
+#define X_DECODE_SCORE(n) \
+    if (key == QLatin1String(#n)) { \
+        update.n = toInt(value); \
+        return true; \
+    }
+        X_FOREACH_CHAR_UPDATE_SCORE(X_DECODE_SCORE)
+#undef X_DECODE_SCORE
+        return false;
+    };
+
+    const QVariantMap &playerData = root->toMap();
+    for (auto it = playerData.cbegin(); it != playerData.cend(); ++it) {
+        const QString &key = it.key();
+        const QVariant &value = it.value();
+        if (decodeScore(key, value))
+            continue;
+
+        if (key == QLatin1String(nameKey)) {
+            update.name = toLatin1(value).value_or(QByteArray{});
+        } else if (key == QLatin1String(labelKey)) {
+            update.label = toLatin1(value);
+        } else if (key == QLatin1String(colorKey)) {
+            if (value.canConvert(QMetaType::QString))
+                update.color = value.toString();
+        } else if (key == QLatin1String(stateKey)) {
+            update.state = toInt(value);
+        } else if (key == QLatin1String(roomKey)) {
+            update.room = toUInt(value);
+        } else if (key == QLatin1String(prespamKey)) {
+            update.prespam = toLatin1(value);
+        } else if (key == QLatin1String(affectsKey)) {
+            update.affects = toUInt(value);
+        } else if (key == QLatin1String(seqKey)) {
+            update.seq = toUInt(value);
+        } else if (key == QLatin1String(deltaKey)) {
+            update.delta = value.toBool();
+        }
+    }
+    return update;
+}
+
+QVariantMap CharUpdate::toVariantMap() const
 {
     QVariantMap playerData;
 
-    playerData[nameKey] = QString::fromLatin1(m_internal.name);
-    playerData[labelKey] = QString::fromLatin1(m_internal.label);
-    playerData[colorKey] = m_internal.color.name();
-    playerData["hp"] = hp;
-    playerData["maxhp"] = maxhp;
-    playerData["mana"] = mana;
-    playerData["maxmana"] = maxmana;
-    playerData["moves"] = moves;
-    playerData["maxmoves"] = maxmoves;
-    playerData[stateKey] = static_cast<int>(position);
-    playerData[roomKey] = roomId.asUint32();
-    playerData[prespamKey] = QString::fromLatin1(prespam.toByteArray());
-    playerData[affectsKey] = affects.asUint32();
+    playerData[nameKey] = QString::fromLatin1(name);
+    if (label)
+        playerData[labelKey] = QString::fromLatin1(*label);
+    if (color)
+        playerData[colorKey] = *color;
+#define X_ENCODE_SCORE(n) \
+    if (n) \
+        playerData[#n] = *n;
+    X_FOREACH_CHAR_UPDATE_SCORE(X_ENCODE_SCORE)
+#undef X_ENCODE_SCORE
+    if (state)
+        playerData[stateKey] = *state;
+    if (room)
+        playerData[roomKey] = *room;
+    if (prespam)
+        playerData[prespamKey] = QString::fromLatin1(*prespam);
+    if (affects)
+        playerData[affectsKey] = *affects;
+    if (seq)
+        playerData[seqKey] = *seq;
+    if (delta)
+        playerData[deltaKey] = true;
 
     QVariantMap root;
     root[playerDataKey] = playerData;
     return root;
 }
 
+CharUpdate CGroupChar::toCharUpdate() const
+{
+    CharUpdate update;
+    update.name = m_internal.name;
+    update.label = m_internal.label;
+    update.color = m_internal.color.name();
+#define X_COPY_SCORE(n) update.n = n;
+    X_FOREACH_CHAR_UPDATE_SCORE(X_COPY_SCORE)
+#undef X_COPY_SCORE
+    update.state = static_cast<int>(position);
+    update.room = roomId.asUint32();
+    update.prespam = prespam.toByteArray();
+    update.affects = affects.asUint32();
+    return update;
+}
+
+const QVariantMap CGroupChar::toVariantMap() const
+{
+    return toCharUpdate().toVariantMap();
+}
+
 bool CGroupChar::updateFromVariantMap(const QVariantMap &data)
 {
     if (!data.contains(playerDataKey) || !data[playerDataKey].canConvert(QMetaType::QVariantMap)) {
         qWarning() << "Unable to find" << QuotedQString(playerDataKey) << "in map" << data;
         return false;
     }
-    const QVariantMap &playerData = data[playerDataKey].toMap();
+    return applyUpdate(CharUpdate::fromVariantMap(data));
+}
+
+bool CGroupChar::applyUpdate(const CharUpdate &update)
+{
+    if (update.seq) {
+        const uint32_t seq = *update.seq;
+        // Full updates always apply; they restart the sequence after a reconnect.
+        if (update.delta && m_hasUpdateSeq && static_cast<int32_t>(seq - m_updateSeq) <= 0) {
+            qWarning() << "Ignoring stale update" << seq << "after" << m_updateSeq;
+            return false;
+        }
+        m_updateSeq = seq;
+        m_hasUpdateSeq = true;
+    }
 
     bool updated = false;
-    if (playerData.contains(roomKey) && playerData[roomKey].canConvert(QMetaType::UInt)) {
-        const uint32_t i = playerData[roomKey].toUInt();
+    if (update.room) {
+        const uint32_t i = *update.room;
 
         // FIXME: Using a room# assumes everyone has _exactly_ the same static map;
         // if anyone in the group modifies their map, they will report a room #
@@ -85,31 +198,24 @@ bool CGroupChar::updateFromVariantMap(const QVariantMap &data)
         }
     }
 
-    const auto tryUpdateString = [&playerData, &updated](const char *const attr, QByteArray &arr) {
-        if (playerData.contains(attr) && playerData[attr].canConvert(QMetaType::QString)) {
-            const auto &s = playerData[attr].toString().toLatin1();
-            if (s != arr) {
-                updated = true;
-                arr = s;
-            }
+    const auto tryUpdateString = [&updated](const std::optional<QByteArray> &s, QByteArray &arr) {
+        if (s && *s != arr) {
+            updated = true;
+            arr = *s;
         }
     };
 
-#define TRY_UPDATE_STRING(s) tryUpdateString(#s, (m_internal.s))
-    TRY_UPDATE_STRING(name);
-    TRY_UPDATE_STRING(label);
-#undef TRY_UPDATE_STRING
+    if (!update.name.isEmpty())
+        tryUpdateString(update.name, m_internal.name);
+    tryUpdateString(update.label, m_internal.label);
 
-    if (playerData.contains(prespamKey) && playerData[prespamKey].canConvert(QMetaType::QString)) {
-        const QByteArray &ba = playerData[prespamKey].toString().toLatin1();
-        if (ba != prespam.toByteArray()) {
-            updated = true;
-            prespam = ba;
-        }
+    if (update.prespam && *update.prespam != prespam.toByteArray()) {
+        updated = true;
+        prespam = *update.prespam;
     }
 
-    if (playerData.contains(colorKey) && playerData[colorKey].canConvert(QMetaType::QString)) {
-        const QString &str = playerData[colorKey].toString();
+    if (update.color) {
+        const QString &str = *update.color;
         auto &color = m_internal.color;
         if (str != color.name()) {
             updated = true;
@@ -119,10 +225,12 @@ bool CGroupChar::updateFromVariantMap(const QVariantMap &data)
         }
     }
 
-    const auto tryUpdateInt = [&playerData, &updated](const char *const attr, int &n) {
-        if (playerData.contains(attr) && playerData[attr].canConvert(QMetaType::Int)) {
-            const auto i = [&playerData, attr]() {
-                auto i = playerData[attr].toInt();
+    const auto tryUpdateInt = [&updated](const char *const attr,
+                                         const std::optional<int> &input,
+                                         int &n) {
+        if (input) {
+            const auto i = [attr, &input]() {
+                auto i = *input;
                 if (i < 0) {
                     qWarning() << "[tryUpdateInt] Input" << attr << "(" << i
                                << ") has been raised to 0.";
@@ -156,8 +264,8 @@ bool CGroupChar::updateFromVariantMap(const QVariantMap &data)
 
 #define UPDATE_AND_BOUNDS_CHECK(n) \
     do { \
-        tryUpdateInt(#n, (n)); \
-        tryUpdateInt(("max" #n), (max##n)); \
+        tryUpdateInt(#n, update.n, (n)); \
+        tryUpdateInt(("max" #n), update.max##n, (max##n)); \
         boundsCheck(#n, (n), ("max" #n), (max##n)); \
     } while (0)
 
@@ -175,8 +283,8 @@ bool CGroupChar::updateFromVariantMap(const QVariantMap &data)
         }
     };
 
-    if (playerData.contains(stateKey) && playerData[stateKey].canConvert(QMetaType::Int)) {
-        const int n = playerData[stateKey].toInt();
+    if (update.state) {
+        const int n = *update.state;
         if (n < static_cast<int>(CharacterPositionEnum::UNDEFINED)
             || n >= static_cast<int>(NUM_CHARACTER_POSITIONS)) {
             qWarning() << "Invalid input state (" << n << ") is changed to UNDEFINED.";
@@ -194,10 +302,8 @@ bool CGroupChar::updateFromVariantMap(const QVariantMap &data)
         }
     };
 
-    if (playerData.contains(affectsKey) && playerData[affectsKey].canConvert(QMetaType::UInt)) {
-        const uint32_t i = playerData[affectsKey].toUInt();
-        setAffects(static_cast<CharacterAffectFlags>(i));
-    }
+    if (update.affects)
+        setAffects(static_cast<CharacterAffectFlags>(*update.affects));
 
     return updated;
 }
@@ -217,3 +323,47 @@ QByteArray CGroupChar::getNameFromUpdateChar(const QVariantMap &data)
 
     return playerData[nameKey].toString().toLatin1();
 }
+
+QVariantMap CharUpdateDeltas::encode(const QVariantMap &update)
+{
+    static constexpr const uint32_t FULL_REFRESH_INTERVAL = 32;
+
+    const QVariantMap &playerData = update[playerDataKey].toMap();
+    ++m_seq;
+
+    const bool full = m_lastPlayerData.isEmpty() || m_seq % FULL_REFRESH_INTERVAL == 0
+                      || playerData[nameKey] != m_lastPlayerData[nameKey];
+    QVariantMap out;
+    if (full) {
+        out = playerData;
+    } else {
+        out[nameKey] = playerData[nameKey];
+        for (auto it = playerData.cbegin(); it != playerData.cend(); ++it) {
+            if (m_lastPlayerData.value(it.key()) != it.value())
+                out.insert(it.key(), it.value());
+        }
+        out[deltaKey] = true;
+    }
+    out[seqKey] = m_seq;
+    m_lastPlayerData = playerData;
+
+    QVariantMap root;
+    root[playerDataKey] = out;
+    return root;
+}
+
+void CharUpdateDeltas::merge(QVariantMap &full, const QVariantMap &update)
+{
+    const QVariantMap &playerData = update[playerDataKey].toMap();
+    if (!playerData.value(deltaKey).toBool() || !full.contains(playerDataKey)) {
+        full = update;
+        return;
+    }
+
+    QVariantMap merged = full[playerDataKey].toMap();
+    for (auto it = playerData.cbegin(); it != playerData.cend(); ++it) {
+        merged.insert(it.key(), it.value());
+    }
+    merged.remove(deltaKey);
+    full[playerDataKey] = merged;
+}
@@ -4,10 +4,13 @@
 // Author: Dmitrijs Barbarins <lachupe@gmail.com> (Azazello)
 // Author: Nils Schimmelmann <nschimme@gmail.com> (Jahara)
 
+#include <cstdint>
 #include <memory>
+#include <optional>
 #include <vector>
 #include <QByteArray>
 #include <QColor>
+#include <QString>
 #include <QVariantMap>
 
 #include "../global/RuleOf5.h"
@@ -22,6 +25,37 @@ using SharedGroupChar = std::shared_ptr<CGroupChar>;
 class NODISCARD GroupVector : public std::vector<SharedGroupChar>
 {};
 
+#define X_FOREACH_CHAR_UPDATE_SCORE(X) \
+    X(hp) \
+    X(maxhp) \
+    X(mana) \
+    X(maxmana) \
+    X(moves) \
+    X(maxmoves)
+
+// A character update decoded once into typed fields, so applying it doesn't look up
+// and convert each field by its string key. Fields a delta leaves out stay unset.
+struct NODISCARD CharUpdate final
+{
+    QByteArray name;
+    std::optional<QByteArray> label;
+    std::optional<QString> color;
+#define X_DECL_SCORE(n) std::optional<int> n;
+    X_FOREACH_CHAR_UPDATE_SCORE(X_DECL_SCORE)
+#undef X_DECL_SCORE
+    std::optional<int> state;
+    std::optional<uint32_t> room;
+    std::optional<QByteArray> prespam;
+    std::optional<uint32_t> affects;
+    std::optional<uint32_t> seq;
+    bool delta = false;
+
+public:
+    // Decodes the "playerData" of a group message in a single pass over its fields.
+    NODISCARD static CharUpdate fromVariantMap(const QVariantMap &data);
+    NODISCARD QVariantMap toVariantMap() const;
+};
+
 class NODISCARD CGroupChar final : public std::enable_shared_from_this<CGroupChar>
 {
 private:
@@ -50,6 +84,9 @@ class NODISCARD CGroupChar final : public std::enable_shared_from_this<CGroupCha
         QColor color;
     };
     Internal m_internal;
+    // Sequence number of the last update applied, to drop stale deltas.
+    uint32_t m_updateSeq = 0;
+    bool m_hasUpdateSeq = false;
 
 public:
     CGroupChar() = delete;
@@ -83,6 +120,9 @@ class NODISCARD CGroupChar final : public std::enable_shared_from_this<CGroupCha
     NODISCARD const QColor &getColor() const { return m_internal.color; }
     NODISCARD const QVariantMap toVariantMap() const;
     bool updateFromVariantMap(const QVariantMap &);
+    NODISCARD CharUpdate toCharUpdate() const;
+    // Returns true if anything changed.
+    bool applyUpdate(const CharUpdate &update);
     void setRoomId(RoomId id) { roomId = id; }
     NODISCARD RoomId getRoomId() const { return roomId; }
     NODISCARD static QByteArray getNameFromUpdateChar(const QVariantMap &);
@@ -97,3 +137,24 @@ class NODISCARD CGroupChar final : public std::enable_shared_from_this<CGroupCha
         maxmoves = _maxmoves;
     }
 };
+
+// Turns successive full character updates into field-level deltas: only the name
+// (so the character can be found) and the fields that changed since the previous
+// update are sent, tagged with a sequence number. Every so often the full update is
+// sent instead, so a peer that missed something catches up.
+//
+// Deltas are only understood since protocol 104; older peers still get full updates.
+class NODISCARD CharUpdateDeltas final
+{
+private:
+    QVariantMap m_lastPlayerData;
+    uint32_t m_seq = 0;
+
+public:
+    void reset() { *this = CharUpdateDeltas{}; }
+    NODISCARD QVariantMap encode(const QVariantMap &update);
+
+public:
+    // Applies a delta (or full) update to the last full update seen from that peer.
+    static void merge(QVariantMap &full, const QVariantMap &update);
+};
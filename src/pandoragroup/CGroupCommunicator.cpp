@@ -5,7 +5,12 @@
 
 #include "CGroupCommunicator.h"
 
+#include <cstdint>
+#include <initializer_list>
 #include <QByteArray>
+#include <QCborArray>
+#include <QCborMap>
+#include <QCborValue>
 #include <QMessageLogContext>
 #include <QObject>
 #include <QString>
@@ -38,7 +43,29 @@ CGroupCommunicator::CGroupCommunicator(const GroupManagerStateEnum mode, Mmapper
 //
 // Low level. Message forming and messaging
 //
-QByteArray CGroupCommunicator::formMessageBlock(const MessagesEnum message, const QVariantMap &data)
+QByteArray CGroupCommunicator::formMessageBlock(const MessagesEnum message,
+                                                const QVariantMap &data,
+                                                const ProtocolVersion version)
+{
+    if (version >= PROTOCOL_VERSION_104)
+        return formCborMessageBlock(message, data);
+    return formXmlMessageBlock(message, data);
+}
+
+// The message is a CBOR array of the message number and the map as-is, behind the
+// self-describe tag so it can't be mistaken for XML.
+QByteArray CGroupCommunicator::formCborMessageBlock(const MessagesEnum message,
+                                                    const QVariantMap &data)
+{
+    const QCborArray datagram{static_cast<int>(message), QCborMap::fromVariantMap(data)};
+    const QByteArray block = QCborValue{QCborKnownTags::Signature, datagram}.toCbor();
+    if (LOG_MESSAGE_INFO)
+        qInfo() << "Outgoing message:" << block.toHex();
+    return block;
+}
+
+QByteArray CGroupCommunicator::formXmlMessageBlock(const MessagesEnum message,
+                                                   const QVariantMap &data)
 {
     QByteArray block;
     QXmlStreamWriter xml(&block);
@@ -124,6 +151,10 @@ QByteArray CGroupCommunicator::formMessageBlock(const MessagesEnum message, cons
     case MessagesEnum::STATE_KICKED:
         xml.writeTextElement("text", data["text"].toString());
         break;
+
+    case MessagesEnum::MAP_DELTA:
+        // Never sent to peers that only speak XML.
+        break;
     }
 
     xml.writeEndElement();
@@ -148,7 +179,7 @@ void CGroupCommunicator::sendMessage(GroupSocket *const socket,
                                      const MessagesEnum message,
                                      const QVariantMap &node)
 {
-    socket->sendData(formMessageBlock(message, node));
+    socket->sendData(formMessageBlock(message, node, socket->getProtocolVersion()));
 }
 
 // the core of the protocol
@@ -157,32 +188,213 @@ void CGroupCommunicator::slot_incomingData(GroupSocket *const socket, const QByt
     if (LOG_MESSAGE_INFO)
         qInfo() << "Incoming message:" << buff;
 
+    MessagesEnum message = MessagesEnum::NONE;
+    QVariantMap data;
+    if (!parseMessageBlock(buff, message, data))
+        return;
+
+    // converting a given node to the text form.
+    slot_retrieveData(socket, message, data);
+}
+
+bool CGroupCommunicator::parseMessageBlock(const QByteArray &buff,
+                                           MessagesEnum &message,
+                                           QVariantMap &data)
+{
+    // Either encoding is accepted at any time, so neither side has to switch on
+    // exactly the same message once 104 has been agreed on.
+    static constexpr const char CBOR_SIGNATURE[] = "\xD9\xD9\xF7";
+    return buff.startsWith(CBOR_SIGNATURE) ? parseCborMessageBlock(buff, message, data)
+                                           : parseXmlMessageBlock(buff, message, data);
+}
+
+namespace { // anonymous
+
+enum class NODISCARD CborTypeEnum : uint8_t { BOOL, BYTES, INTEGER, STRING };
+
+struct NODISCARD CborField final
+{
+    const char *key = nullptr;
+    CborTypeEnum type = CborTypeEnum::STRING;
+};
+
+// Copies the fields that are present; returns false if one has the wrong type.
+NODISCARD bool copyCborFields(const QCborMap &from,
+                              const std::initializer_list<CborField> fields,
+                              QVariantMap &to)
+{
+    for (const CborField &field : fields) {
+        const QString key = QString::fromLatin1(field.key);
+        const QCborValue value = from.value(key);
+        if (value.isUndefined())
+            continue;
+        const bool matches = [&value, &field]() {
+            switch (field.type) {
+            case CborTypeEnum::BOOL:
+                return value.isBool();
+            case CborTypeEnum::BYTES:
+                return value.isByteArray();
+            case CborTypeEnum::INTEGER:
+                return value.isInteger();
+            case CborTypeEnum::STRING:
+                return value.isString();
+            }
+            return false;
+        }();
+        if (!matches)
+            return false;
+        to[key] = value.toVariant();
+    }
+    return true;
+}
+
+// The same as the attributes parseXmlMessageBlock() reads, plus the update's
+// sequence number. A delta may leave any of them out.
+NODISCARD bool copyCborPlayerData(const QCborMap &from, QVariantMap &to)
+{
+    const QCborValue value = from.value(QStringLiteral("playerData"));
+    if (value.isUndefined())
+        return true;
+    if (!value.isMap())
+        return false;
+
+    QVariantMap playerData;
+    if (!copyCborFields(value.toMap(),
+                        {{"hp", CborTypeEnum::INTEGER},
+                         {"maxhp", CborTypeEnum::INTEGER},
+                         {"moves", CborTypeEnum::INTEGER},
+                         {"maxmoves", CborTypeEnum::INTEGER},
+                         {"mana", CborTypeEnum::INTEGER},
+                         {"maxmana", CborTypeEnum::INTEGER},
+                         {"state", CborTypeEnum::INTEGER},
+                         {"name", CborTypeEnum::STRING},
+                         {"label", CborTypeEnum::STRING},
+                         {"color", CborTypeEnum::STRING},
+                         {"room", CborTypeEnum::INTEGER},
+                         {"prespam", CborTypeEnum::STRING},
+                         {"affects", CborTypeEnum::INTEGER},
+                         {"seq", CborTypeEnum::INTEGER},
+                         {"delta", CborTypeEnum::BOOL}},
+                        playerData))
+        return false;
+    to["playerData"] = playerData;
+    return true;
+}
+
+// Only the fields parseXmlMessageBlock() would read for the message are kept.
+NODISCARD bool copyCborMessage(const MessagesEnum message, const QCborMap &from, QVariantMap &to)
+{
+    switch (message) {
+    case MessagesEnum::GTELL:
+        return copyCborFields(from,
+                              {{"from", CborTypeEnum::STRING}, {"text", CborTypeEnum::STRING}},
+                              to);
+
+    case MessagesEnum::REQ_HANDSHAKE:
+        return copyCborFields(from, {{"protocolVersion", CborTypeEnum::INTEGER}}, to);
+
+    case MessagesEnum::UPDATE_CHAR:
+        if (const QCborValue loginData = from.value(QStringLiteral("loginData"));
+            !loginData.isUndefined()) {
+            // Hoisted to the top, like the XML parser does.
+            return loginData.isMap()
+                   && copyCborFields(loginData.toMap(),
+                                     {{"protocolVersion", CborTypeEnum::INTEGER}},
+                                     to)
+                   && copyCborPlayerData(loginData.toMap(), to);
+        }
+        return copyCborPlayerData(from, to);
+
+    case MessagesEnum::REMOVE_CHAR:
+    case MessagesEnum::ADD_CHAR:
+        return copyCborPlayerData(from, to);
+
+    case MessagesEnum::RENAME_CHAR:
+        return copyCborFields(from,
+                              {{"oldname", CborTypeEnum::STRING},
+                               {"newname", CborTypeEnum::STRING}},
+                              to);
+
+    case MessagesEnum::MAP_DELTA:
+        return copyCborFields(from,
+                              {{"from", CborTypeEnum::STRING}, {"delta", CborTypeEnum::BYTES}},
+                              to);
+
+    case MessagesEnum::NONE:
+    case MessagesEnum::ACK:
+    case MessagesEnum::REQ_ACK:
+    case MessagesEnum::REQ_INFO:
+    case MessagesEnum::REQ_LOGIN:
+    case MessagesEnum::PROT_VERSION:
+    case MessagesEnum::STATE_LOGGED:
+    case MessagesEnum::STATE_KICKED:
+        return copyCborFields(from, {{"text", CborTypeEnum::STRING}}, to);
+    }
+    return false;
+}
+
+} // namespace
+
+bool CGroupCommunicator::parseCborMessageBlock(const QByteArray &buff,
+                                               MessagesEnum &message,
+                                               QVariantMap &data)
+{
+    QCborParserError error;
+    const QCborValue value = QCborValue::fromCbor(buff, &error);
+    if (error.error != QCborError::NoError) {
+        qWarning() << "Message cannot be read" << error.errorString() << buff.toHex();
+        return false;
+    }
+    const QCborValue datagram = value.taggedValue();
+    if (!datagram.isArray() || datagram.toArray().size() != 2 || !datagram[0].isInteger()
+        || !datagram[1].isMap()) {
+        qWarning() << "Message is not a [message, data] pair" << buff.toHex();
+        return false;
+    }
+
+    const qint64 number = datagram[0].toInteger();
+    if (number < 0 || number > static_cast<qint64>(MessagesEnum::MAP_DELTA)) {
+        qWarning() << "Message" << number << "is unknown" << buff.toHex();
+        return false;
+    }
+    message = static_cast<MessagesEnum>(number);
+
+    data.clear();
+    if (!copyCborMessage(message, datagram[1].toMap(), data)) {
+        qWarning() << "Message has a field of the wrong type" << buff.toHex();
+        return false;
+    }
+    return true;
+}
+
+bool CGroupCommunicator::parseXmlMessageBlock(const QByteArray &buff,
+                                              MessagesEnum &message,
+                                              QVariantMap &data)
+{
     QXmlStreamReader xml(buff);
     if (xml.readNextStartElement() && xml.error() != QXmlStreamReader::NoError) {
         qWarning() << "Message cannot be read" << buff;
-        return;
+        return false;
     }
 
     if (xml.name() != QLatin1String("datagram")) {
         qWarning() << "Message does not start with element 'datagram'" << buff;
-        return;
+        return false;
     }
     if (xml.attributes().isEmpty() || !xml.attributes().hasAttribute("message")) {
         qWarning() << "'datagram' element did not have a 'message' attribute" << buff;
-        return;
+        return false;
     }
 
     // TODO: need stronger type checking
-    const MessagesEnum message = static_cast<MessagesEnum>(
-        xml.attributes().value("message").toInt());
+    message = static_cast<MessagesEnum>(xml.attributes().value("message").toInt());
 
     if (xml.readNextStartElement() && xml.name() != QLatin1String("data")) {
         qWarning() << "'datagram' element did not have a 'data' child element" << buff;
-        return;
+        return false;
     }
 
     // Deserialize XML
-    QVariantMap data;
     while (xml.readNextStartElement()) {
         switch (message) {
         case MessagesEnum::GTELL:
@@ -245,6 +457,7 @@ void CGroupCommunicator::slot_incomingData(GroupSocket *const socket, const QByt
         case MessagesEnum::PROT_VERSION:
         case MessagesEnum::STATE_LOGGED:
         case MessagesEnum::STATE_KICKED:
+        case MessagesEnum::MAP_DELTA:
             if (xml.name() == QLatin1String("text")) {
                 data["text"] = xml.readElementText();
             }
@@ -252,8 +465,7 @@ void CGroupCommunicator::slot_incomingData(GroupSocket *const socket, const QByt
         }
     }
 
-    // converting a given node to the text form.
-    slot_retrieveData(socket, message, data);
+    return true;
 }
 
 // this function is for sending gtell from a local user
@@ -281,6 +493,14 @@ void CGroupCommunicator::slot_sendSelfRename(const QByteArray &oldName, const QB
     slot_sendCharRename(root);
 }
 
+void CGroupCommunicator::slot_sendMapDelta(const QByteArray &delta)
+{
+    QVariantMap root;
+    root["from"] = QString::fromLatin1(getGroup()->getSelf()->getName());
+    root["delta"] = delta;
+    virt_sendMapDelta(root);
+}
+
 void CGroupCommunicator::slot_relayLog(const QString &str)
 {
     emit sig_sendLog(str);
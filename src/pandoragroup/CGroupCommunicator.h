@@ -26,6 +26,8 @@ class CGroupCommunicator : public QObject
 public:
     explicit CGroupCommunicator(GroupManagerStateEnum mode, Mmapper2Group *parent);
 
+    // Same messages as 103, encoded as CBOR instead of XML.
+    static constexpr const ProtocolVersion PROTOCOL_VERSION_104 = 104;
     static constexpr const ProtocolVersion PROTOCOL_VERSION_103 = 103;
     static constexpr const ProtocolVersion PROTOCOL_VERSION_102 = 102;
 
@@ -44,7 +46,9 @@ class CGroupCommunicator : public QObject
         ADD_CHAR,
         REMOVE_CHAR,
         UPDATE_CHAR,
-        RENAME_CHAR
+        RENAME_CHAR,
+        // Rooms another member changed (see MapStorage::saveDelta()); protocol 104 only.
+        MAP_DELTA
     };
 
     NODISCARD GroupManagerStateEnum getMode() const { return mode; }
@@ -57,15 +61,35 @@ class CGroupCommunicator : public QObject
     void stop() { virt_stop(); }
     NODISCARD bool start() { return virt_start(); }
 
+public:
+    // The encoding depends on the protocol version of the peer it's meant for.
+    NODISCARD static QByteArray formMessageBlock(MessagesEnum message,
+                                                 const QVariantMap &data,
+                                                 ProtocolVersion version);
+    // Accepts either encoding.
+    NODISCARD static bool parseMessageBlock(const QByteArray &buff,
+                                            MessagesEnum &message,
+                                            QVariantMap &data);
+
 protected:
     void sendCharUpdate(GroupSocket *, const QVariantMap &);
     void sendMessage(GroupSocket *, MessagesEnum, const QByteArray & = "");
     void sendMessage(GroupSocket *, MessagesEnum, const QVariantMap &);
 
-    NODISCARD QByteArray formMessageBlock(MessagesEnum message, const QVariantMap &data);
     NODISCARD CGroup *getGroup();
     NODISCARD GroupAuthority *getAuthority();
 
+private:
+    NODISCARD static QByteArray formXmlMessageBlock(MessagesEnum message, const QVariantMap &data);
+    NODISCARD static QByteArray formCborMessageBlock(MessagesEnum message,
+                                                     const QVariantMap &data);
+    NODISCARD static bool parseXmlMessageBlock(const QByteArray &buff,
+                                               MessagesEnum &message,
+                                               QVariantMap &data);
+    NODISCARD static bool parseCborMessageBlock(const QByteArray &buff,
+                                                MessagesEnum &message,
+                                                QVariantMap &data);
+
 private:
     virtual void virt_connectionClosed(GroupSocket *) = 0;
     virtual void virt_kickCharacter(const QByteArray &) = 0;
@@ -73,6 +97,7 @@ class CGroupCommunicator : public QObject
     virtual void virt_sendCharRename(const QVariantMap &map) = 0;
     virtual void virt_sendCharUpdate(const QVariantMap &map) = 0;
     virtual void virt_sendGroupTellMessage(const QVariantMap &map) = 0;
+    virtual void virt_sendMapDelta(const QVariantMap &map) = 0;
 
 public slots:
     void slot_connectionClosed(GroupSocket *sock) { virt_connectionClosed(sock); }
@@ -96,11 +121,13 @@ public slots:
     void slot_sendGroupTell(const QByteArray &);
     void slot_relayLog(const QString &);
     void slot_sendSelfRename(const QByteArray &, const QByteArray &);
+    void slot_sendMapDelta(const QByteArray &);
 
 signals:
     void sig_messageBox(QString message);
     void sig_scheduleAction(std::shared_ptr<GroupAction> action);
     void sig_gTellArrived(QVariantMap node);
+    void sig_mapDeltaArrived(QVariantMap node);
     void sig_sendLog(const QString &);
 
 private:
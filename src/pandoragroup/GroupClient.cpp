@@ -27,7 +27,17 @@ using MessagesEnum = CGroupCommunicator::MessagesEnum;
 GroupClient::GroupClient(Mmapper2Group *parent)
     : CGroupCommunicator(GroupManagerStateEnum::Client, parent)
     , socket(parent->getAuthority(), this)
+    , udp(GroupUdpRoleEnum::CLIENT, this)
 {
+    connect(&udp,
+            &GroupUdpChannel::sig_positionReceived,
+            this,
+            [this](uint32_t /*sessionId*/, const QByteArray &name, const uint32_t roomId) {
+                CharUpdate update;
+                update.name = name;
+                update.room = roomId;
+                emit sig_scheduleAction(std::make_shared<UpdateCharacter>(update));
+            });
     connect(&socket, &GroupSocket::sig_incomingData, this, &GroupClient::slot_incomingData);
     connect(&socket, &GroupSocket::sig_sendLog, this, &GroupClient::slot_relayLog);
     connect(&socket,
@@ -158,6 +168,7 @@ void GroupClient::virt_retrieveData(GroupSocket *const /* socket */,
         } else if (message == MessagesEnum::REQ_LOGIN) {
             assert(QSslSocket::supportsSsl());
             socket.setProtocolVersion(proposedProtocolVersion);
+            charUpdates.reset();
             socket.startClientEncrypted();
         } else if (message == MessagesEnum::ACK) {
             // aha! logged on!
@@ -175,6 +186,7 @@ void GroupClient::virt_retrieveData(GroupSocket *const /* socket */,
             receiveGroupInformation(data);
         } else if (message == MessagesEnum::STATE_LOGGED) {
             socket.setProtocolState(ProtocolStateEnum::Logged);
+            openUdpSession(data);
         } else if (message == MessagesEnum::REQ_ACK) {
             sendMessage(&socket, MessagesEnum::ACK);
         } else {
@@ -194,6 +206,8 @@ void GroupClient::virt_retrieveData(GroupSocket *const /* socket */,
             emit sig_scheduleAction(std::make_shared<RenameCharacter>(data));
         } else if (message == MessagesEnum::GTELL) {
             emit sig_gTellArrived(data);
+        } else if (message == MessagesEnum::MAP_DELTA) {
+            emit sig_mapDeltaArrived(data);
         } else if (message == MessagesEnum::REQ_ACK) {
             sendMessage(&socket, MessagesEnum::ACK);
         } else {
@@ -222,6 +236,8 @@ void GroupClient::sendHandshake(const QVariantMap &data)
         // Ensure we only pick a protocol within the bounds we understand
         if (!QSslSocket::supportsSsl()) {
             return PROTOCOL_VERSION_102;
+        } else if (serverProtocolVersion >= PROTOCOL_VERSION_104) {
+            return PROTOCOL_VERSION_104;
         } else if (serverProtocolVersion >= PROTOCOL_VERSION_103) {
             return PROTOCOL_VERSION_103;
         } else if (serverProtocolVersion <= PROTOCOL_VERSION_102) {
@@ -330,6 +346,7 @@ void GroupClient::slot_connectionEncrypted()
 void GroupClient::tryReconnecting()
 {
     clientConnected = false;
+    closeUdpSession();
 
     if (reconnectAttempts <= 0) {
         emit sig_sendLog("Exhausted reconnect attempts.");
@@ -349,9 +366,55 @@ void GroupClient::virt_sendGroupTellMessage(const QVariantMap &root)
     sendMessage(&socket, MessagesEnum::GTELL, root);
 }
 
+void GroupClient::virt_sendMapDelta(const QVariantMap &map)
+{
+    // The server relays it as-is, so it wouldn't reach anyone over XML either.
+    if (socket.getProtocolVersion() < PROTOCOL_VERSION_104)
+        return;
+    sendMessage(&socket, MessagesEnum::MAP_DELTA, map);
+}
+
 void GroupClient::virt_sendCharUpdate(const QVariantMap &map)
 {
-    CGroupCommunicator::sendCharUpdate(&socket, map);
+    if (socket.getProtocolVersion() < PROTOCOL_VERSION_104) {
+        CGroupCommunicator::sendCharUpdate(&socket, map);
+        return;
+    }
+    CGroupCommunicator::sendCharUpdate(&socket, charUpdates.encode(map));
+
+    if (!udpSession.isValid())
+        return;
+    const CharUpdate update = CharUpdate::fromVariantMap(map);
+    if (update.room.has_value() && update.room != lastUdpRoomId) {
+        lastUdpRoomId = update.room;
+        udp.sendPosition(udpSession.id, update.name, update.room.value());
+    }
+}
+
+void GroupClient::openUdpSession(const QVariantMap &data)
+{
+    if (!getConfig().groupManager.useUdpPositions || !data.contains("udp"))
+        return;
+
+    quint16 port = 0;
+    const GroupUdpSession session = GroupUdpSession::fromVariantMap(data["udp"].toMap(), port);
+    if (!session.isValid())
+        return;
+    if (!udp.bind(0)) {
+        emit sig_sendLog("Failed to open a UDP port; positions will only go over TCP.");
+        return;
+    }
+    udpSession = session;
+    lastUdpRoomId.reset();
+    udp.addPeer(session, socket.getPeerAddress(), port);
+    emit sig_sendLog(QString("Positions will also be sent over UDP to port %1.").arg(port));
+}
+
+void GroupClient::closeUdpSession()
+{
+    udp.close();
+    udpSession = GroupUdpSession{};
+    lastUdpRoomId.reset();
 }
 
 void GroupClient::virt_sendCharRename(const QVariantMap &map)
@@ -362,6 +425,7 @@ void GroupClient::virt_sendCharRename(const QVariantMap &map)
 void GroupClient::virt_stop()
 {
     clientConnected = false;
+    closeUdpSession();
     socket.disconnectFromHost();
     emit sig_scheduleAction(std::make_shared<ResetCharacters>());
     deleteLater();
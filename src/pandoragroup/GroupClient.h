@@ -4,8 +4,11 @@
 // Author: Dmitrijs Barbarins <lachupe@gmail.com> (Azazello)
 // Author: Nils Schimmelmann <nschimme@gmail.com> (Jahara)
 
+#include "CGroupChar.h"
 #include "CGroupCommunicator.h"
 #include "GroupSocket.h"
+#include "GroupUdpChannel.h"
+#include <optional>
 #include <QVariantMap>
 
 class GroupClient final : public CGroupCommunicator
@@ -33,15 +36,22 @@ public slots:
     void virt_sendCharRename(const QVariantMap &map) final;
     void virt_sendCharUpdate(const QVariantMap &map) final;
     void virt_sendGroupTellMessage(const QVariantMap &map) final;
+    void virt_sendMapDelta(const QVariantMap &map) final;
 
 private:
     void sendHandshake(const QVariantMap &data);
     void sendLoginInformation();
     void tryReconnecting();
     void receiveGroupInformation(const QVariantMap &data);
+    void openUdpSession(const QVariantMap &data);
+    void closeUdpSession();
 
     ProtocolVersion proposedProtocolVersion = PROTOCOL_VERSION_102;
     bool clientConnected = false;
     int reconnectAttempts = 3;
     GroupSocket socket;
+    CharUpdateDeltas charUpdates;
+    GroupUdpChannel udp;
+    GroupUdpSession udpSession;
+    std::optional<uint32_t> lastUdpRoomId;
 };
@@ -6,6 +6,9 @@
 #include "GroupServer.h"
 
 #include <algorithm>
+#include <optional>
+#include <utility>
+#include <vector>
 #include <QAbstractSocket>
 #include <QByteArray>
 #include <QHostAddress>
@@ -29,6 +32,11 @@
 
 using MessagesEnum = CGroupCommunicator::MessagesEnum;
 
+// Past this much unsent data, a client only gets the latest update of each character.
+static constexpr const qint64 CONGESTED_BYTES = 64 * 1024;
+// Past this much, the client is too far behind to be worth waiting for.
+static constexpr const qint64 MAX_BACKLOG_BYTES = 4 * 1024 * 1024;
+
 GroupTcpServer::GroupTcpServer(GroupServer *const parent)
     : QTcpServer(parent)
 {}
@@ -63,19 +71,74 @@ void GroupServer::slot_errorInConnection(GroupSocket *const socket, const QStrin
     closeOne(socket);
 }
 
-void GroupServer::sendToAll(const QByteArray &message)
+void GroupServer::sendToAll(const MessagesEnum message, const QVariantMap &data)
+{
+    sendToAllExceptOne(nullptr, message, data);
+}
+
+void GroupServer::sendToAllExceptOne(GroupSocket *const exception,
+                                     const MessagesEnum message,
+                                     const QVariantMap &data)
 {
-    sendToAllExceptOne(nullptr, message);
+    sendToAllExceptOne(exception, message, data, data);
 }
 
-void GroupServer::sendToAllExceptOne(GroupSocket *const exception, const QByteArray &message)
+void GroupServer::sendToAllExceptOne(GroupSocket *const exception,
+                                     const MessagesEnum message,
+                                     const QVariantMap &data,
+                                     const QVariantMap &fullData)
 {
+    // Each encoding is only formed if some client speaks it.
+    std::optional<QByteArray> xml;
+    std::optional<QByteArray> cbor;
+    std::vector<QPointer<GroupSocket>> laggards;
     for (auto &connection : clientsList) {
         if (connection == exception)
             continue;
-        if (connection->getProtocolState() == ProtocolStateEnum::Logged) {
-            connection->sendData(message);
+        if (connection->getProtocolState() != ProtocolStateEnum::Logged)
+            continue;
+        const ProtocolVersion version = connection->getProtocolVersion();
+        const bool isCbor = version >= PROTOCOL_VERSION_104;
+        if (message == MessagesEnum::MAP_DELTA && !isCbor)
+            continue;
+        const bool congested = connection->getBytesToWrite() >= CONGESTED_BYTES;
+        if (message == MessagesEnum::UPDATE_CHAR && congested) {
+            // Sent once the socket drains; older updates of the same character merge into it.
+            const QByteArray name = CGroupChar::getNameFromUpdateChar(data);
+            CharUpdateDeltas::merge(pendingUpdates[connection][name], isCbor ? data : fullData);
+            continue;
         }
+        auto &block = isCbor ? cbor : xml;
+        if (!block.has_value())
+            block = formMessageBlock(message, isCbor ? data : fullData, version);
+        connection->sendData(block.value());
+        if (connection->getBytesToWrite() > MAX_BACKLOG_BYTES)
+            laggards.emplace_back(connection);
+    }
+
+    // Kicking sends more messages and changes clientsList, so it waits for the loop to end.
+    for (const auto &laggard : laggards) {
+        QMetaObject::invokeMethod(
+            this,
+            [this, laggard]() {
+                const auto it = std::find(clientsList.begin(), clientsList.end(), laggard);
+                if (laggard != nullptr && it != clientsList.end())
+                    kickConnection(laggard, "Your connection is too slow to keep up.");
+            },
+            Qt::QueuedConnection);
+    }
+}
+
+void GroupServer::slot_onBytesWritten(GroupSocket *const socket)
+{
+    const auto it = pendingUpdates.find(socket);
+    if (it == pendingUpdates.end() || socket->getBytesToWrite() >= CONGESTED_BYTES)
+        return;
+
+    const auto pending = std::move(it->second);
+    pendingUpdates.erase(it);
+    for (const auto &kv : pending) {
+        sendMessage(socket, MessagesEnum::UPDATE_CHAR, kv.second);
     }
 }
 
@@ -88,6 +151,10 @@ void GroupServer::closeAll()
         }
     }
     clientsList.clear();
+    clientUpdates.clear();
+    pendingUpdates.clear();
+    udp.clearPeers();
+    udpClients.clear();
 }
 
 void GroupServer::closeOne(GroupSocket *const target)
@@ -104,6 +171,15 @@ void GroupServer::closeOne(GroupSocket *const target)
         return;
     }
     clientsList.erase(it);
+    clientUpdates.erase(target);
+    pendingUpdates.erase(target);
+    for (auto udpIt = udpClients.begin(); udpIt != udpClients.end(); ++udpIt) {
+        if (udpIt->second == target) {
+            udp.removePeer(udpIt->first);
+            udpClients.erase(udpIt);
+            break;
+        }
+    }
 }
 
 void GroupServer::connectAll(GroupSocket *const client)
@@ -115,6 +191,7 @@ void GroupServer::connectAll(GroupSocket *const client)
             &GroupServer::slot_connectionEstablished);
     connect(client, &GroupSocket::sig_connectionClosed, this, &GroupServer::slot_connectionClosed);
     connect(client, &GroupSocket::sig_errorInConnection, this, &GroupServer::slot_errorInConnection);
+    connect(client, &GroupSocket::sig_bytesWritten, this, &GroupServer::slot_onBytesWritten);
 }
 
 void GroupServer::disconnectAll(GroupSocket *const client)
@@ -132,6 +209,7 @@ void GroupServer::disconnectAll(GroupSocket *const client)
                &GroupSocket::sig_errorInConnection,
                this,
                &GroupServer::slot_errorInConnection);
+    disconnect(client, &GroupSocket::sig_bytesWritten, this, &GroupServer::slot_onBytesWritten);
 }
 
 //
@@ -141,7 +219,12 @@ void GroupServer::disconnectAll(GroupSocket *const client)
 GroupServer::GroupServer(Mmapper2Group *parent)
     : CGroupCommunicator(GroupManagerStateEnum::Server, parent)
     , server(this)
+    , udp(GroupUdpRoleEnum::HOST, this)
 {
+    connect(&udp,
+            &GroupUdpChannel::sig_positionReceived,
+            this,
+            &GroupServer::slot_onUdpPosition);
     connect(&server, &GroupTcpServer::acceptError, this, [this]() {
         emit sig_sendLog(QString("Server encountered an error: %1").arg(server.errorString()));
     });
@@ -183,7 +266,7 @@ void GroupServer::virt_connectionClosed(GroupSocket *const socket)
 void GroupServer::slot_connectionEstablished(GroupSocket *const socket)
 {
     QVariantMap handshake;
-    handshake["protocolVersion"] = NO_OPEN_SSL ? PROTOCOL_VERSION_102 : PROTOCOL_VERSION_103;
+    handshake["protocolVersion"] = NO_OPEN_SSL ? PROTOCOL_VERSION_102 : PROTOCOL_VERSION_104;
     sendMessage(socket, MessagesEnum::REQ_HANDSHAKE, handshake);
 }
 
@@ -223,7 +306,7 @@ void GroupServer::virt_retrieveData(GroupSocket *const socket,
         } else if (message == MessagesEnum::ACK) {
             socket->setProtocolState(ProtocolStateEnum::Logged);
             emit sig_sendLog(QString("'%1' has successfully logged in.").arg(nameStr));
-            sendMessage(socket, MessagesEnum::STATE_LOGGED);
+            sendStateLogged(socket);
             if (!NO_OPEN_SSL && socket->getProtocolVersion() == PROTOCOL_VERSION_102) {
                 QVariantMap root;
                 root["text"] = QString("WARNING: %1 joined the group with an insecure connection "
@@ -249,7 +332,9 @@ void GroupServer::virt_retrieveData(GroupSocket *const socket,
                 return;
             }
             emit sig_scheduleAction(std::make_shared<UpdateCharacter>(data));
-            slot_relayMessage(socket, MessagesEnum::UPDATE_CHAR, data);
+            QVariantMap &fullData = clientUpdates[socket];
+            CharUpdateDeltas::merge(fullData, data);
+            sendToAllExceptOne(socket, MessagesEnum::UPDATE_CHAR, data, fullData);
 
         } else if (message == MessagesEnum::GTELL) {
             const auto &fromName = data["from"].toString().simplified();
@@ -260,6 +345,15 @@ void GroupServer::virt_retrieveData(GroupSocket *const socket,
             emit sig_gTellArrived(data);
             slot_relayMessage(socket, MessagesEnum::GTELL, data);
 
+        } else if (message == MessagesEnum::MAP_DELTA) {
+            const auto &fromName = data["from"].toString().simplified();
+            if (!isEqualsCaseInsensitive(fromName, nameStr)) {
+                emit sig_sendLog(QString("WARNING: '%1' spoofed as '%2'").arg(nameStr, fromName));
+                return;
+            }
+            emit sig_mapDeltaArrived(data);
+            slot_relayMessage(socket, MessagesEnum::MAP_DELTA, data);
+
         } else if (message == MessagesEnum::REQ_ACK) {
             sendMessage(socket, MessagesEnum::ACK);
 
@@ -299,8 +393,60 @@ void GroupServer::virt_retrieveData(GroupSocket *const socket,
 void GroupServer::virt_sendCharUpdate(const QVariantMap &map)
 {
     if (getConfig().groupManager.shareSelf) {
-        const QByteArray &message = formMessageBlock(MessagesEnum::UPDATE_CHAR, map);
-        sendToAll(message);
+        sendToAllExceptOne(nullptr, MessagesEnum::UPDATE_CHAR, selfUpdates.encode(map), map);
+        const CharUpdate update = CharUpdate::fromVariantMap(map);
+        if (update.room.has_value() && update.room != lastUdpRoomId) {
+            lastUdpRoomId = update.room;
+            sendUdpPositionToAllExceptOne(nullptr, update.name, update.room.value());
+        }
+    }
+}
+
+void GroupServer::sendStateLogged(GroupSocket *const socket)
+{
+    if (!udp.isBound() || socket->getProtocolVersion() < PROTOCOL_VERSION_104) {
+        sendMessage(socket, MessagesEnum::STATE_LOGGED);
+        return;
+    }
+
+    // The client's port is learned from its first datagram.
+    const GroupUdpSession session = GroupUdpSession::generate();
+    udp.addPeer(session, socket->getPeerAddress(), 0);
+    udpClients[session.id] = socket;
+
+    QVariantMap root;
+    root["text"] = "";
+    root["udp"] = session.toVariantMap(udp.getLocalPort());
+    sendMessage(socket, MessagesEnum::STATE_LOGGED, root);
+}
+
+void GroupServer::slot_onUdpPosition(const uint32_t sessionId,
+                                     const QByteArray & /*name*/,
+                                     const uint32_t roomId)
+{
+    const auto it = udpClients.find(sessionId);
+    if (it == udpClients.end() || it->second == nullptr
+        || it->second->getProtocolState() != ProtocolStateEnum::Logged)
+        return;
+
+    // The session identifies the client, so the name it claims isn't needed.
+    GroupSocket *const socket = it->second;
+    CharUpdate update;
+    update.name = socket->getName();
+    update.room = roomId;
+    emit sig_scheduleAction(std::make_shared<UpdateCharacter>(update));
+    sendUdpPositionToAllExceptOne(socket, update.name, roomId);
+}
+
+void GroupServer::sendUdpPositionToAllExceptOne(GroupSocket *const exception,
+                                                const QByteArray &name,
+                                                const uint32_t roomId)
+{
+    for (const auto &[sessionId, client] : udpClients) {
+        if (client == nullptr || client == exception
+            || client->getProtocolState() != ProtocolStateEnum::Logged)
+            continue;
+        udp.sendPosition(sessionId, name, roomId);
     }
 }
 
@@ -323,7 +469,7 @@ void GroupServer::parseHandshake(GroupSocket *const socket, const QVariantMap &d
                        "Please upgrade to the latest MMapper.");
         return;
     }
-    auto supportedProtocolVersion = NO_OPEN_SSL ? PROTOCOL_VERSION_102 : PROTOCOL_VERSION_103;
+    auto supportedProtocolVersion = NO_OPEN_SSL ? PROTOCOL_VERSION_102 : PROTOCOL_VERSION_104;
     if (clientProtocolVersion > supportedProtocolVersion) {
         kickConnection(socket, "Host uses an older version of MMapper and needs to upgrade.");
         return;
@@ -431,6 +577,7 @@ void GroupServer::parseLoginInformation(GroupSocket *socket, const QVariantMap &
     // Strip protocolVersion from original QVariantMap
     QVariantMap charNode;
     charNode["playerData"] = playerData;
+    clientUpdates[socket] = charNode;
     emit sig_scheduleAction(std::make_shared<AddCharacter>(charNode));
     slot_relayMessage(socket, MessagesEnum::ADD_CHAR, charNode);
     sendMessage(socket, MessagesEnum::ACK);
@@ -459,30 +606,31 @@ void GroupServer::sendRemoveUserNotification(GroupSocket *const socket, const QB
     for (const auto &character : *selection) {
         if (character->getName() == name) {
             const QVariantMap &map = character->toVariantMap();
-            const QByteArray &message = formMessageBlock(MessagesEnum::REMOVE_CHAR, map);
-            sendToAllExceptOne(socket, message);
+            sendToAllExceptOne(socket, MessagesEnum::REMOVE_CHAR, map);
         }
     }
 }
 
 void GroupServer::virt_sendGroupTellMessage(const QVariantMap &root)
 {
-    const QByteArray &message = formMessageBlock(MessagesEnum::GTELL, root);
-    sendToAll(message);
+    sendToAll(MessagesEnum::GTELL, root);
+}
+
+void GroupServer::virt_sendMapDelta(const QVariantMap &root)
+{
+    sendToAll(MessagesEnum::MAP_DELTA, root);
 }
 
 void GroupServer::slot_relayMessage(GroupSocket *const socket,
                                     const MessagesEnum message,
                                     const QVariantMap &data)
 {
-    const QByteArray &buffer = formMessageBlock(message, data);
-    sendToAllExceptOne(socket, buffer);
+    sendToAllExceptOne(socket, message, data);
 }
 
 void GroupServer::virt_sendCharRename(const QVariantMap &map)
 {
-    QByteArray message = formMessageBlock(MessagesEnum::RENAME_CHAR, map);
-    sendToAll(message);
+    sendToAll(MessagesEnum::RENAME_CHAR, map);
 }
 
 void GroupServer::virt_stop()
@@ -499,6 +647,7 @@ bool GroupServer::virt_start()
         server.setMaxPendingConnections(0);
         closeAll();
         server.close();
+        udp.close();
     }
     const auto localPort = static_cast<quint16>(getConfig().groupManager.localPort);
     if (portMapper.tryAddPortMapping(localPort)) {
@@ -513,6 +662,12 @@ bool GroupServer::virt_start()
             QString("Failed to start the groupManager server: %1.").arg(server.errorString()));
         return false;
     }
+    if (getConfig().groupManager.useUdpPositions && !NO_OPEN_SSL) {
+        if (udp.bind(localPort))
+            emit sig_sendLog(QString("Listening for positions on UDP port %1").arg(localPort));
+        else
+            emit sig_sendLog("Failed to open the UDP port; positions will only go over TCP.");
+    }
     return true;
 }
 
@@ -4,9 +4,13 @@
 // Author: Dmitrijs Barbarins <lachupe@gmail.com> (Azazello)
 // Author: Nils Schimmelmann <nschimme@gmail.com> (Jahara)
 
+#include "CGroupChar.h"
 #include "CGroupCommunicator.h"
 #include "GroupPortMapper.h"
+#include "GroupUdpChannel.h"
 
+#include <map>
+#include <optional>
 #include <vector>
 #include <QByteArray>
 #include <QPointer>
@@ -50,6 +54,8 @@ protected slots:
     void slot_onRevokeWhitelist(const QByteArray &secret);
     void slot_onIncomingConnection(qintptr socketDescriptor);
     void slot_errorInConnection(GroupSocket *, const QString &);
+    void slot_onBytesWritten(GroupSocket *socket);
+    void slot_onUdpPosition(uint32_t sessionId, const QByteArray &name, uint32_t roomId);
 
 protected:
     void sendRemoveUserNotification(GroupSocket *socket, const QByteArray &name);
@@ -65,16 +71,26 @@ protected slots:
     void virt_sendCharRename(const QVariantMap &map) final;
     void virt_sendCharUpdate(const QVariantMap &map) final;
     void virt_sendGroupTellMessage(const QVariantMap &root) final;
+    void virt_sendMapDelta(const QVariantMap &root) final;
 
 private:
     void parseHandshake(GroupSocket *socket, const QVariantMap &data);
     void parseLoginInformation(GroupSocket *socket, const QVariantMap &data);
     void sendGroupInformation(GroupSocket *socket);
+    void sendStateLogged(GroupSocket *socket);
     void kickConnection(GroupSocket *socket, const QString &message);
 
 private:
-    void sendToAll(const QByteArray &);
-    void sendToAllExceptOne(GroupSocket *exception, const QByteArray &);
+    void sendToAll(MessagesEnum message, const QVariantMap &data);
+    void sendToAllExceptOne(GroupSocket *exception, MessagesEnum message, const QVariantMap &data);
+    // Clients older than protocol 104 are sent 'fullData' instead.
+    void sendToAllExceptOne(GroupSocket *exception,
+                            MessagesEnum message,
+                            const QVariantMap &data,
+                            const QVariantMap &fullData);
+    void sendUdpPositionToAllExceptOne(GroupSocket *exception,
+                                       const QByteArray &name,
+                                       uint32_t roomId);
     void closeAll();
     void closeOne(GroupSocket *target);
     void connectAll(GroupSocket *);
@@ -82,6 +98,15 @@ protected slots:
 
     using ClientList = std::vector<QPointer<GroupSocket>>;
     ClientList clientsList{};
+    // Our own updates as deltas, and each client's updates merged back into full ones.
+    CharUpdateDeltas selfUpdates;
+    std::map<const GroupSocket *, QVariantMap> clientUpdates;
+    // Character updates held back from a client that isn't keeping up, by name.
+    std::map<const GroupSocket *, std::map<QByteArray, QVariantMap>> pendingUpdates;
     GroupTcpServer server;
     GroupPortMapper portMapper;
+    // Clients that took a UDP session, by session id.
+    GroupUdpChannel udp;
+    std::map<uint32_t, QPointer<GroupSocket>> udpClients;
+    std::optional<uint32_t> lastUdpRoomId;
 };
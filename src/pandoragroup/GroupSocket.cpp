@@ -5,7 +5,10 @@
 
 #include "GroupSocket.h"
 
+#include <algorithm>
 #include <cassert>
+#include <string>
+#include <utility>
 #include <QByteArray>
 #include <QHostAddress>
 #include <QMessageLogContext>
@@ -15,11 +18,16 @@
 #include <QTimer>
 
 #include "../configuration/configuration.h"
+#include "../global/EventTrace.h"
+#include "../global/PerfCounters.h"
+#include "../global/TlsSessionCache.h"
 #include "../global/io.h"
 #include "groupauthority.h"
 
 static constexpr const bool DEBUG = false;
 static constexpr const auto THIRTY_SECOND_TIMEOUT = 30000;
+// Messages spanning several reads reserve up to this much; the length prefix is untrusted.
+static constexpr const unsigned int MAX_RESERVE = 1u << 20;
 
 GroupSocket::GroupSocket(GroupAuthority *authority, QObject *parent)
     : QObject(parent)
@@ -47,6 +55,10 @@ GroupSocket::GroupSocket(GroupAuthority *authority, QObject *parent)
     };
     socket.setSslConfiguration(get_ssl_config());
     socket.setPeerVerifyName(GROUP_COMMON_NAME);
+    connect(&socket, &QIODevice::bytesWritten, this, [this]() { emit sig_bytesWritten(this); });
+    connect(&socket, &QSslSocket::encryptedBytesWritten, this, [this]() {
+        emit sig_bytesWritten(this);
+    });
     connect(&socket, &QAbstractSocket::hostFound, this, [this]() {
         emit sig_sendLog("Host found...");
     });
@@ -64,6 +76,8 @@ GroupSocket::GroupSocket(GroupAuthority *authority, QObject *parent)
         timer.stop();
         secret
             = socket.peerCertificate().digest(QCryptographicHash::Algorithm::Sha1).toHex().toLower();
+        if (!sessionPeer.isEmpty())
+            tls_session_cache::remember(socket, sessionPeer);
         emit sig_sendLog("Connection successfully encrypted...");
         emit sig_connectionEncrypted(this);
     });
@@ -97,6 +111,7 @@ void GroupSocket::connectToHost()
     const auto &groupConfig = getConfig().groupManager;
     const auto remoteHost = groupConfig.host;
     const auto remotePort = static_cast<quint16>(groupConfig.remotePort);
+    sessionPeer = tls_session_cache::makePeer(QString::fromUtf8(remoteHost), remotePort);
     sendLog(QString("%1 to remote host %2:%3")
                 .arg(retry ? "Reconnecting" : "Connecting")
                 .arg(remoteHost.simplified().constData())
@@ -104,6 +119,13 @@ void GroupSocket::connectToHost()
     socket.connectToHost(remoteHost, remotePort);
 }
 
+void GroupSocket::startClientEncrypted()
+{
+    if (!sessionPeer.isEmpty())
+        tls_session_cache::prepare(socket, sessionPeer);
+    socket.startClientEncryption();
+}
+
 void GroupSocket::disconnectFromHost()
 {
     timer.stop();
@@ -171,6 +193,8 @@ void GroupSocket::slot_onError(QAbstractSocket::SocketError e)
     if (e != QAbstractSocket::RemoteHostClosedError && e != QAbstractSocket::SocketTimeoutError) {
         qDebug() << "onError" << static_cast<int>(e) << socket.errorString();
         timer.stop();
+        if (e == QAbstractSocket::SslHandshakeFailedError && !sessionPeer.isEmpty())
+            tls_session_cache::forget(sessionPeer);
         emit sig_errorInConnection(this, socket.errorString());
     }
 }
@@ -229,42 +253,62 @@ void GroupSocket::slot_onReadyRead()
     // REVISIT: check return value?
     MAYBE_UNUSED const auto ignored = //
         io::readAllAvailable(socket, ioBuffer, [this](const QByteArray &byteArray) {
-            for (const auto &c : byteArray) {
-                onReadInternal(c);
-            }
+            onReadInternal(byteArray);
         });
 }
 
-void GroupSocket::onReadInternal(const char c)
+void GroupSocket::onReadInternal(const QByteArray &byteArray)
 {
-    switch (state) {
-    case GroupMessageStateEnum::LENGTH:
-        if (c == ' ' && currentMessageLen > 0) {
-            // Terminating space received
-            state = GroupMessageStateEnum::PAYLOAD;
-        } else if (c >= '0' && c <= '9') {
-            // Digit received
-            currentMessageLen *= 10;
-            currentMessageLen += static_cast<unsigned int>(c - '0');
-        } else {
-            // Reset due to garbage
-            currentMessageLen = 0;
+    const char *const data = byteArray.constData();
+    const int size = byteArray.size();
+    int pos = 0;
+    while (pos < size) {
+        switch (state) {
+        case GroupMessageStateEnum::LENGTH: {
+            const char c = data[pos++];
+            if (c == ' ' && currentMessageLen > 0) {
+                // Terminating space received
+                state = GroupMessageStateEnum::PAYLOAD;
+            } else if (c >= '0' && c <= '9') {
+                // Digit received
+                currentMessageLen *= 10;
+                currentMessageLen += static_cast<unsigned int>(c - '0');
+            } else {
+                // Reset due to garbage
+                currentMessageLen = 0;
+            }
+            break;
         }
-        break;
-    case GroupMessageStateEnum::PAYLOAD:
-        buffer.append(c);
-        if (static_cast<unsigned int>(buffer.size()) == currentMessageLen) {
-            // Cut message from buffer
-            if (DEBUG)
-                qDebug() << "Incoming message:" << buffer;
-            emit sig_incomingData(this, buffer);
+        case GroupMessageStateEnum::PAYLOAD: {
+            // Take as much of the payload as this read has.
+            const auto missing = currentMessageLen - static_cast<unsigned int>(buffer.size());
+            const int take = static_cast<int>(
+                std::min(missing, static_cast<unsigned int>(size - pos)));
+            if (buffer.isEmpty() && take == static_cast<int>(missing)) {
+                // The whole message is in this read; slice it out in one copy.
+                buffer = QByteArray(data + pos, take);
+            } else {
+                if (buffer.isEmpty())
+                    buffer.reserve(static_cast<int>(std::min(currentMessageLen, MAX_RESERVE)));
+                buffer.append(data + pos, take);
+            }
+            pos += take;
 
-            // Reset state machine
-            buffer.clear();
-            currentMessageLen = 0;
-            state = GroupMessageStateEnum::LENGTH;
+            if (static_cast<unsigned int>(buffer.size()) == currentMessageLen) {
+                // Cut message from buffer
+                if (DEBUG)
+                    qDebug() << "Incoming message:" << buffer;
+                perf_counters::add(PerfCounterEnum::GROUP_MESSAGES);
+                event_trace::Scope scope{"GroupSocket::message"};
+                emit sig_incomingData(this, std::exchange(buffer, QByteArray{}));
+
+                // Reset state machine
+                currentMessageLen = 0;
+                state = GroupMessageStateEnum::LENGTH;
+            }
+            break;
+        }
         }
-        break;
     }
 }
 
@@ -277,10 +321,12 @@ void GroupSocket::sendData(const QByteArray &data)
         qWarning() << "Socket is not connected";
         return;
     }
+    const std::string len = std::to_string(data.size());
     QByteArray buff;
-    QString len = QString("%1 ").arg(data.size());
-    buff = len.toLatin1();
-    buff += data;
+    buff.reserve(static_cast<int>(len.size()) + 1 + data.size());
+    buff.append(len.data(), static_cast<int>(len.size()));
+    buff.append(' ');
+    buff.append(data);
     if (DEBUG)
         qDebug() << "Sending message:" << buff;
     socket.write(buff);
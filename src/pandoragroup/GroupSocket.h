@@ -6,6 +6,7 @@
 
 #include <QAbstractSocket>
 #include <QByteArray>
+#include <QHostAddress>
 #include <QMap>
 #include <QObject>
 #include <QSslSocket>
@@ -32,10 +33,11 @@ class GroupSocket final : public QObject
     void connectToHost();
     void disconnectFromHost();
     void startServerEncrypted() { socket.startServerEncryption(); }
-    void startClientEncrypted() { socket.startClientEncryption(); }
+    void startClientEncrypted();
 
     NODISCARD QByteArray getSecret() const { return secret; }
     NODISCARD QString getPeerName() const;
+    NODISCARD QHostAddress getPeerAddress() const { return socket.peerAddress(); }
     NODISCARD quint16 getPeerPort() const { return socket.peerPort(); }
 
     NODISCARD QAbstractSocket::SocketError getSocketError() const { return socket.error(); }
@@ -51,6 +53,11 @@ class GroupSocket final : public QObject
     NODISCARD const QByteArray &getName() { return name; }
 
     void sendData(const QByteArray &data);
+    // Bytes written but not yet sent to the peer.
+    NODISCARD qint64 getBytesToWrite() const
+    {
+        return socket.bytesToWrite() + socket.encryptedBytesToWrite();
+    }
 
 protected slots:
     void slot_onError(QAbstractSocket::SocketError socketError);
@@ -65,6 +72,7 @@ protected slots:
     void sig_incomingData(GroupSocket *, QByteArray);
     void sig_connectionEstablished(GroupSocket *);
     void sig_connectionEncrypted(GroupSocket *);
+    void sig_bytesWritten(GroupSocket *);
 
 private:
     void reset();
@@ -74,7 +82,7 @@ protected slots:
     QSslSocket socket;
     QTimer timer;
     GroupAuthority *const authority;
-    void onReadInternal(char c);
+    void onReadInternal(const QByteArray &byteArray);
 
     ProtocolStateEnum protocolState = ProtocolStateEnum::Unconnected;
     ProtocolVersion protocolVersion = 102;
@@ -91,5 +99,7 @@ protected slots:
     QByteArray buffer;
     QByteArray secret;
     QByteArray name;
+    // The remote host for tls_session_cache; empty for sockets the server accepted.
+    QString sessionPeer;
     unsigned int currentMessageLen = 0;
 };
@@ -0,0 +1,240 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "GroupUdpChannel.h"
+
+#include <array>
+#include <QCryptographicHash>
+#include <QMessageAuthenticationCode>
+#include <QNetworkDatagram>
+#include <QRandomGenerator>
+#include <QtEndian>
+
+// magic, session id, sequence number, room id; then the name and the MAC.
+static constexpr const char MAGIC[] = {'M', 'G', 'U', '2'};
+static constexpr const int HEADER_SIZE = 16;
+static constexpr const int MAC_SIZE = 16;
+static constexpr const int MAX_NAME_SIZE = 64;
+static constexpr const int MAX_DATAGRAM_SIZE = HEADER_SIZE + MAX_NAME_SIZE + MAC_SIZE;
+static constexpr const int KEY_SIZE = 32;
+// Well inside the usual NAT mapping timeouts.
+static constexpr const int KEEP_ALIVE_MS = 15000;
+
+static QByteArray computeMac(const QByteArray &payload, const QByteArray &key)
+{
+    return QMessageAuthenticationCode::hash(payload, key, QCryptographicHash::Sha256)
+        .left(MAC_SIZE);
+}
+
+// HKDF-Expand (RFC 5869) of a single block; the session key is already uniformly
+// random, so it serves as the pseudorandom key without an extract step.
+static QByteArray deriveKey(const QByteArray &key, const char *const label)
+{
+    return QMessageAuthenticationCode::hash(QByteArray{label} + '\x01',
+                                            key,
+                                            QCryptographicHash::Sha256);
+}
+
+static bool isEqualConstantTime(const QByteArray &a, const QByteArray &b)
+{
+    if (a.size() != b.size())
+        return false;
+    char diff = 0;
+    for (int i = 0; i < a.size(); ++i) {
+        diff = static_cast<char>(diff | (a.at(i) ^ b.at(i)));
+    }
+    return diff == 0;
+}
+
+static void appendUint32(QByteArray &out, const uint32_t value)
+{
+    std::array<char, 4> bytes{};
+    qToBigEndian(value, bytes.data());
+    out.append(bytes.data(), static_cast<int>(bytes.size()));
+}
+
+static uint32_t readUint32(const QByteArray &in, const int offset)
+{
+    return qFromBigEndian<uint32_t>(in.constData() + offset);
+}
+
+GroupUdpSession GroupUdpSession::generate()
+{
+    auto &rng = *QRandomGenerator::system();
+    GroupUdpSession session;
+    do {
+        session.id = rng.generate();
+    } while (session.id == 0);
+
+    std::array<quint32, KEY_SIZE / 4> words{};
+    rng.fillRange(words.data(), static_cast<qsizetype>(words.size()));
+    session.key = QByteArray(reinterpret_cast<const char *>(words.data()), KEY_SIZE);
+    return session;
+}
+
+QVariantMap GroupUdpSession::toVariantMap(const quint16 port) const
+{
+    QVariantMap map;
+    map["session"] = id;
+    map["key"] = QString::fromLatin1(key.toHex());
+    map["port"] = port;
+    return map;
+}
+
+GroupUdpSession GroupUdpSession::fromVariantMap(const QVariantMap &map, quint16 &port)
+{
+    GroupUdpSession session;
+    if (!map["session"].canConvert(QMetaType::UInt) || !map["port"].canConvert(QMetaType::UInt)
+        || !map["key"].canConvert(QMetaType::QString))
+        return session;
+    const uint32_t p = map["port"].toUInt();
+    if (p == 0 || p > 65535)
+        return session;
+    session.id = map["session"].toUInt();
+    session.key = QByteArray::fromHex(map["key"].toString().toLatin1());
+    port = static_cast<quint16>(p);
+    return session;
+}
+
+GroupUdpChannel::GroupUdpChannel(const GroupUdpRoleEnum role, QObject *const parent)
+    : QObject(parent)
+    , role(role)
+    , socket(this)
+    , keepAliveTimer(this)
+{
+    keepAliveTimer.setInterval(KEEP_ALIVE_MS);
+    connect(&keepAliveTimer, &QTimer::timeout, this, &GroupUdpChannel::slot_onKeepAlive);
+    connect(&socket, &QIODevice::readyRead, this, &GroupUdpChannel::slot_onReadyRead);
+}
+
+GroupUdpChannel::~GroupUdpChannel() = default;
+
+bool GroupUdpChannel::bind(const quint16 port)
+{
+    close();
+    return socket.bind(QHostAddress::Any, port);
+}
+
+void GroupUdpChannel::close()
+{
+    clearPeers();
+    socket.close();
+}
+
+void GroupUdpChannel::addPeer(const GroupUdpSession &session,
+                              const QHostAddress &address,
+                              const quint16 port)
+{
+    Peer &peer = peers[session.id];
+    peer = Peer{};
+    const QByteArray clientToHost = deriveKey(session.key, "mmapper group udp c2s");
+    const QByteArray hostToClient = deriveKey(session.key, "mmapper group udp s2c");
+    const bool isHost = role == GroupUdpRoleEnum::HOST;
+    peer.sendKey = isHost ? hostToClient : clientToHost;
+    peer.receiveKey = isHost ? clientToHost : hostToClient;
+    peer.address = address;
+    peer.port = port;
+
+    // Lets the host learn our port before we have a position to send.
+    if (port != 0)
+        send(peer, session.id, QByteArray{}, 0);
+    if (!keepAliveTimer.isActive())
+        keepAliveTimer.start();
+}
+
+void GroupUdpChannel::removePeer(const uint32_t sessionId)
+{
+    peers.erase(sessionId);
+    if (peers.empty())
+        keepAliveTimer.stop();
+}
+
+void GroupUdpChannel::clearPeers()
+{
+    peers.clear();
+    keepAliveTimer.stop();
+}
+
+void GroupUdpChannel::sendPosition(const uint32_t sessionId,
+                                   const QByteArray &name,
+                                   const uint32_t roomId)
+{
+    const auto it = peers.find(sessionId);
+    if (it == peers.end() || it->second.port == 0 || name.isEmpty()
+        || name.size() > MAX_NAME_SIZE)
+        return;
+    send(it->second, sessionId, name, roomId);
+}
+
+void GroupUdpChannel::send(Peer &peer,
+                           const uint32_t sessionId,
+                           const QByteArray &name,
+                           const uint32_t roomId)
+{
+    QByteArray datagram;
+    datagram.reserve(HEADER_SIZE + name.size() + MAC_SIZE);
+    datagram.append(MAGIC, static_cast<int>(sizeof(MAGIC)));
+    appendUint32(datagram, sessionId);
+    appendUint32(datagram, ++nextSeq);
+    appendUint32(datagram, roomId);
+    datagram.append(name);
+    datagram.append(computeMac(datagram, peer.sendKey));
+    MAYBE_UNUSED const auto ignored = socket.writeDatagram(datagram, peer.address, peer.port);
+}
+
+void GroupUdpChannel::slot_onReadyRead()
+{
+    while (socket.hasPendingDatagrams()) {
+        const QNetworkDatagram datagram = socket.receiveDatagram(MAX_DATAGRAM_SIZE);
+        if (!datagram.isValid())
+            break;
+        receive(datagram.data(),
+                datagram.senderAddress(),
+                static_cast<quint16>(datagram.senderPort()));
+    }
+}
+
+void GroupUdpChannel::receive(const QByteArray &datagram,
+                              const QHostAddress &address,
+                              const quint16 port)
+{
+    if (datagram.size() < HEADER_SIZE + MAC_SIZE || datagram.size() > MAX_DATAGRAM_SIZE
+        || !datagram.startsWith(QByteArray::fromRawData(MAGIC, static_cast<int>(sizeof(MAGIC)))))
+        return;
+
+    const uint32_t sessionId = readUint32(datagram, 4);
+    const auto it = peers.find(sessionId);
+    if (it == peers.end())
+        return;
+    Peer &peer = it->second;
+    if (!address.isEqual(peer.address, QHostAddress::TolerantConversion))
+        return;
+
+    const int payloadSize = datagram.size() - MAC_SIZE;
+    const QByteArray payload = datagram.left(payloadSize);
+    if (!isEqualConstantTime(computeMac(payload, peer.receiveKey), datagram.mid(payloadSize)))
+        return;
+
+    const uint32_t seq = readUint32(datagram, 8);
+    const uint32_t roomId = readUint32(datagram, 12);
+    const QByteArray name = payload.mid(HEADER_SIZE);
+    // Keep-alives have no name, but they're also checked so they can't be replayed.
+    const auto last = peer.lastSeq.find(name);
+    if (last != peer.lastSeq.end() && static_cast<int32_t>(seq - last->second) <= 0)
+        return;
+    peer.lastSeq[name] = seq;
+
+    // The datagram is new and authentic, so this is where the peer can be reached now.
+    peer.port = port;
+    if (name.isEmpty())
+        return;
+    emit sig_positionReceived(sessionId, name, roomId);
+}
+
+void GroupUdpChannel::slot_onKeepAlive()
+{
+    for (auto &[sessionId, peer] : peers) {
+        if (peer.port != 0)
+            send(peer, sessionId, QByteArray{}, 0);
+    }
+}
@@ -0,0 +1,89 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <cstdint>
+#include <map>
+#include <QByteArray>
+#include <QHostAddress>
+#include <QObject>
+#include <QTimer>
+#include <QUdpSocket>
+#include <QVariantMap>
+
+#include "../global/macros.h"
+
+// The key a peer signs its datagrams with. It is handed out by the host over the
+// peer's TLS stream, so it is only as trusted as the secret that stream was
+// authenticated with.
+struct NODISCARD GroupUdpSession final
+{
+    uint32_t id = 0;
+    QByteArray key;
+
+    NODISCARD static GroupUdpSession generate();
+    NODISCARD bool isValid() const { return id != 0 && !key.isEmpty(); }
+
+    NODISCARD QVariantMap toVariantMap(quint16 port) const;
+    // Returns an invalid session if the map doesn't hold one.
+    NODISCARD static GroupUdpSession fromVariantMap(const QVariantMap &map, quint16 &port);
+};
+
+// Which end of the channel this is; each direction is signed with its own key.
+enum class NODISCARD GroupUdpRoleEnum : uint8_t { HOST, CLIENT };
+
+// A side channel that only carries room positions, so a move isn't stuck behind a
+// large message on the TCP stream. Positions are latest-wins: a datagram older than
+// one already received for that character is dropped. Nothing is resent; the TCP
+// stream still carries every update, so a lost datagram only costs latency.
+class GroupUdpChannel final : public QObject
+{
+    Q_OBJECT
+
+private:
+    struct NODISCARD Peer final
+    {
+        // Derived from the session key, one per direction, so a datagram can't be
+        // reflected back to the peer that sent it.
+        QByteArray sendKey;
+        QByteArray receiveKey;
+        QHostAddress address;
+        // Zero until the peer's first datagram shows where it is reachable.
+        quint16 port = 0;
+        std::map<QByteArray, uint32_t> lastSeq;
+    };
+
+    const GroupUdpRoleEnum role;
+    QUdpSocket socket;
+    QTimer keepAliveTimer;
+    std::map<uint32_t, Peer> peers;
+    uint32_t nextSeq = 0;
+
+public:
+    explicit GroupUdpChannel(GroupUdpRoleEnum role, QObject *parent);
+    ~GroupUdpChannel() final;
+
+public:
+    NODISCARD bool bind(quint16 port);
+    void close();
+    NODISCARD bool isBound() const { return socket.state() == QAbstractSocket::BoundState; }
+    NODISCARD quint16 getLocalPort() const { return socket.localPort(); }
+
+public:
+    // Pass port zero when the peer's port is only learned from its datagrams.
+    void addPeer(const GroupUdpSession &session, const QHostAddress &address, quint16 port);
+    void removePeer(uint32_t sessionId);
+    void clearPeers();
+    void sendPosition(uint32_t sessionId, const QByteArray &name, uint32_t roomId);
+
+private:
+    void send(Peer &peer, uint32_t sessionId, const QByteArray &name, uint32_t roomId);
+    void receive(const QByteArray &datagram, const QHostAddress &address, quint16 port);
+
+private slots:
+    void slot_onReadyRead();
+    void slot_onKeepAlive();
+
+signals:
+    void sig_positionReceived(uint32_t sessionId, const QByteArray &name, uint32_t roomId);
+};
@@ -52,13 +52,17 @@ void RemoveCharacter::virt_exec()
  * @param Variant map with which to update the character with
  */
 UpdateCharacter::UpdateCharacter(const QVariantMap &map)
-    : map(map)
+    : update(CharUpdate::fromVariantMap(map))
+{}
+
+UpdateCharacter::UpdateCharacter(CharUpdate update)
+    : update(std::move(update))
 {}
 
 void UpdateCharacter::virt_exec()
 {
     assert(group);
-    group->updateChar(map);
+    group->updateChar(update);
 }
 
 /**
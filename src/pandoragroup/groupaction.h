@@ -8,6 +8,7 @@
 #include <QVariantMap>
 
 #include "../global/macros.h"
+#include "CGroupChar.h"
 
 class CGroup;
 
@@ -58,12 +59,14 @@ class NODISCARD UpdateCharacter final : public GroupAction
 {
 public:
     explicit UpdateCharacter(const QVariantMap &variant);
+    explicit UpdateCharacter(CharUpdate update);
 
 private:
     void virt_exec() final;
 
 private:
-    QVariantMap map;
+    // Decoded on the network thread, so the group thread only applies it.
+    CharUpdate update;
 };
 
 class NODISCARD RenameCharacter final : public GroupAction
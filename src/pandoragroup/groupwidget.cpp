@@ -4,6 +4,9 @@
 
 #include "groupwidget.h"
 
+#include <map>
+#include <tuple>
+#include <utility>
 #include <QAction>
 #include <QHeaderView>
 #include <QMessageLogContext>
@@ -16,6 +19,7 @@
 #include "../expandoracommon/room.h"
 #include "../global/AnsiColor.h"
 #include "../global/roomid.h"
+#include "../global/utils.h"
 #include "../mapdata/mapdata.h"
 #include "../mapdata/roomselection.h"
 #include "CGroup.h"
@@ -47,29 +51,53 @@ GroupStateData::GroupStateData(const QColor &color,
         count++;
 }
 
+namespace { // anonymous
+// The state icons, already inverted and scaled to the row height; painting a row
+// used to decode and scale every icon from its file each time.
+class NODISCARD IconCache final
+{
+private:
+    using Key = std::tuple<QString, int, bool>;
+    std::map<Key, QPixmap> m_pixmaps;
+
+public:
+    NODISCARD const QPixmap &get(const QString &filename, const int size, const bool invert)
+    {
+        Key key{filename, size, invert};
+        auto it = m_pixmaps.find(key);
+        if (it == m_pixmaps.end()) {
+            QImage image{filename};
+            if (invert)
+                image.invertPixels();
+            const QImage scaled = image.scaled(size,
+                                               size,
+                                               Qt::IgnoreAspectRatio,
+                                               Qt::SmoothTransformation);
+            it = m_pixmaps.emplace(std::move(key), QPixmap::fromImage(scaled)).first;
+        }
+        return it->second;
+    }
+};
+
+NODISCARD IconCache &getIconCache()
+{
+    static IconCache cache;
+    return cache;
+}
+} // namespace
+
 void GroupStateData::paint(QPainter *const painter, const QRect &rect)
 {
     painter->fillRect(rect, color);
 
-    painter->save();
-    painter->translate(rect.x(), rect.y());
     height = rect.height();
-    painter->scale(height, height); // Images are squares
-
-    // REVISIT: Build images ahead of time
-
     const bool invert = textColor(color) == Qt::white;
 
-    const auto drawOne = [painter, invert](auto &&filename) -> void {
-        const auto getImage = [invert](auto &filename) {
-            QImage image{filename};
-            if (invert)
-                image.invertPixels();
-            return image;
-        };
-
-        painter->drawImage(QRect{0, 0, 1, 1}, getImage(filename));
-        painter->translate(1, 0);
+    IconCache &cache = getIconCache();
+    int x = rect.x();
+    const auto drawOne = [painter, invert, &cache, &rect, &x, this](auto &&filename) -> void {
+        painter->drawPixmap(x, rect.y(), cache.get(filename, height, invert));
+        x += height; // Images are squares
     };
 
     if (position != CharacterPositionEnum::UNDEFINED)
@@ -79,7 +107,6 @@ void GroupStateData::paint(QPainter *const painter, const QRect &rect)
             drawOne(getIconFilename(affect));
         }
     }
-    painter->restore();
 }
 
 GroupDelegate::GroupDelegate(QObject *parent)
@@ -123,9 +150,128 @@ GroupModel::GroupModel(MapData *const md, Mmapper2Group *const group, QObject *c
 void GroupModel::resetModel()
 {
     beginResetModel();
+    m_rows = takeSnapshots();
     endResetModel();
 }
 
+GroupModel::RowSnapshot GroupModel::RowSnapshot::from(const CGroupChar &character)
+{
+    RowSnapshot row;
+    row.character = &character;
+    row.name = character.getName();
+    row.label = character.getLabel();
+    row.color = character.getColor();
+    row.hp = character.hp;
+    row.maxhp = character.maxhp;
+    row.mana = character.mana;
+    row.maxmana = character.maxmana;
+    row.moves = character.moves;
+    row.maxmoves = character.maxmoves;
+    row.position = character.position;
+    row.affects = character.affects;
+    row.roomId = character.roomId;
+    return row;
+}
+
+std::vector<GroupModel::RowSnapshot> GroupModel::takeSnapshots() const
+{
+    std::vector<RowSnapshot> rows;
+    if (auto group = m_group->getGroup()) {
+        auto selection = group->selectAll();
+        rows.reserve(selection->size());
+        for (const SharedGroupChar &character : *selection)
+            rows.emplace_back(RowSnapshot::from(deref(character)));
+    }
+    return rows;
+}
+
+void GroupModel::emitRowChanged(const int row,
+                                const ColumnTypeEnum first,
+                                const ColumnTypeEnum last)
+{
+    emit dataChanged(index(row, static_cast<int>(first)), index(row, static_cast<int>(last)));
+}
+
+void GroupModel::updateModel()
+{
+    std::vector<RowSnapshot> rows = takeSnapshots();
+    const auto sameMembers = [this, &rows]() -> bool {
+        if (rows.size() != m_rows.size())
+            return false;
+        for (size_t i = 0; i < rows.size(); ++i) {
+            if (rows[i].character != m_rows[i].character)
+                return false;
+        }
+        return true;
+    };
+    if (!sameMembers()) {
+        beginResetModel();
+        m_rows = std::move(rows);
+        endResetModel();
+        return;
+    }
+
+    for (size_t i = 0; i < rows.size(); ++i) {
+        const RowSnapshot &was = m_rows[i];
+        const RowSnapshot &now = rows[i];
+        const int row = static_cast<int>(i);
+
+        // The color is every cell's background.
+        if (now.color != was.color) {
+            emitRowChanged(row, ColumnTypeEnum::NAME, ColumnTypeEnum::ROOM_NAME);
+            continue;
+        }
+
+        // Changed columns, as a bit mask.
+        uint32_t changed = 0;
+        const auto mark = [&changed](const ColumnTypeEnum column) {
+            changed |= 1u << static_cast<uint32_t>(column);
+        };
+        if (now.name != was.name || now.label != was.label)
+            mark(ColumnTypeEnum::NAME);
+        if (now.hp != was.hp || now.maxhp != was.maxhp) {
+            mark(ColumnTypeEnum::HP_PERCENT);
+            mark(ColumnTypeEnum::HP);
+        }
+        if (now.mana != was.mana || now.maxmana != was.maxmana) {
+            mark(ColumnTypeEnum::MANA_PERCENT);
+            mark(ColumnTypeEnum::MANA);
+        }
+        if (now.moves != was.moves || now.maxmoves != was.maxmoves) {
+            mark(ColumnTypeEnum::MOVES_PERCENT);
+            mark(ColumnTypeEnum::MOVES);
+        }
+        if (now.position != was.position || now.affects != was.affects)
+            mark(ColumnTypeEnum::STATE);
+        if (now.roomId != was.roomId)
+            mark(ColumnTypeEnum::ROOM_NAME);
+
+        // One signal per run of adjacent changed columns.
+        for (int col = 0; col < GROUP_COLUMN_COUNT;) {
+            if ((changed & (1u << static_cast<uint32_t>(col))) == 0) {
+                ++col;
+                continue;
+            }
+            int end = col;
+            while (end + 1 < GROUP_COLUMN_COUNT
+                   && (changed & (1u << static_cast<uint32_t>(end + 1))) != 0)
+                ++end;
+            emitRowChanged(row, static_cast<ColumnTypeEnum>(col), static_cast<ColumnTypeEnum>(end));
+            col = end + 1;
+        }
+    }
+    m_rows = std::move(rows);
+}
+
+void GroupModel::setMapLoaded(const bool val)
+{
+    if (m_mapLoaded == val)
+        return;
+    m_mapLoaded = val;
+    for (int row = 0; row < static_cast<int>(m_rows.size()); ++row)
+        emitRowChanged(row, ColumnTypeEnum::ROOM_NAME, ColumnTypeEnum::ROOM_NAME);
+}
+
 int GroupModel::rowCount(const QModelIndex & /* parent */) const
 {
     if (auto group = m_group->getGroup()) {
@@ -426,7 +572,7 @@ GroupWidget::~GroupWidget()
 
 void GroupWidget::slot_updateLabels()
 {
-    m_model.resetModel();
+    m_model.updateModel();
 
     // Hide unnecessary columns like mana if everyone is a zorc/troll
     const auto one_character_had_mana = [this]() -> bool {
@@ -10,6 +10,7 @@
 #include <QWidget>
 #include <QtCore>
 
+#include "../global/roomid.h"
 #include "groupselection.h"
 #include "mmapper2character.h"
 
@@ -76,6 +77,9 @@ class GroupModel final : public QAbstractTableModel
     explicit GroupModel(MapData *md, Mmapper2Group *group, QObject *parent);
 
     void resetModel();
+    // Emits dataChanged for just the cells that changed since the last call,
+    // or resets the model if the group's members changed.
+    void updateModel();
     NODISCARD QVariant dataForCharacter(const SharedGroupChar &character,
                                         ColumnTypeEnum column,
                                         int role) const;
@@ -87,12 +91,37 @@ class GroupModel final : public QAbstractTableModel
     NODISCARD QVariant headerData(int section, Qt::Orientation orientation, int role) const override;
     NODISCARD Qt::ItemFlags flags(const QModelIndex &parent) const override;
 
-    void setMapLoaded(const bool val) { m_mapLoaded = val; }
+    void setMapLoaded(bool val);
+
+private:
+    // What a row displayed when the model was last updated.
+    struct NODISCARD RowSnapshot final
+    {
+        const CGroupChar *character = nullptr;
+        QByteArray name;
+        QByteArray label;
+        QColor color;
+        int hp = 0;
+        int maxhp = 0;
+        int mana = 0;
+        int maxmana = 0;
+        int moves = 0;
+        int maxmoves = 0;
+        CharacterPositionEnum position = CharacterPositionEnum::UNDEFINED;
+        CharacterAffectFlags affects;
+        RoomId roomId = INVALID_ROOMID;
+
+        NODISCARD static RowSnapshot from(const CGroupChar &character);
+    };
+
+    NODISCARD std::vector<RowSnapshot> takeSnapshots() const;
+    void emitRowChanged(int row, ColumnTypeEnum first, ColumnTypeEnum last);
 
 private:
     MapData *m_map = nullptr;
     Mmapper2Group *m_group = nullptr;
     bool m_mapLoaded = false;
+    std::vector<RowSnapshot> m_rows;
 };
 
 class GroupWidget final : public QWidget
@@ -5,7 +5,9 @@
 
 #include "mmapper2group.h"
 
+#include <chrono>
 #include <memory>
+#include <utility>
 #include <QColor>
 #include <QDateTime>
 #include <QMessageLogContext>
@@ -28,6 +30,7 @@
 #include "mmapper2character.h"
 
 static constexpr const bool THREADED = true;
+static constexpr const int REFRESH_INTERVAL_MS = 16; // about one frame
 static constexpr const auto ONE_MINUTE = 60;
 static constexpr const int THIRTY_MINUTES = 30 * ONE_MINUTE;
 static constexpr const int DEFAULT_EXPIRE = THIRTY_MINUTES;
@@ -43,6 +46,8 @@ const Mmapper2Group::AffectTimeout Mmapper2Group::s_affectTimeout
 Mmapper2Group::Mmapper2Group(QObject *const /* parent */)
     : QObject(nullptr)
     , affectTimer{this}
+    , charUpdateTimer{this}
+    , refreshTimer{this}
     , thread(THREADED ? new QThread : nullptr)
 {
     qRegisterMetaType<CharacterPositionEnum>("CharacterPositionEnum");
@@ -60,6 +65,21 @@ Mmapper2Group::Mmapper2Group(QObject *const /* parent */)
     affectTimer.start();
     connect(&affectTimer, &QTimer::timeout, this, &Mmapper2Group::slot_onAffectTimeout);
 
+    charUpdateTimer.setSingleShot(true);
+    connect(&charUpdateTimer, &QTimer::timeout, this, [this]() {
+        QMutexLocker locker(&networkLock);
+        if (std::exchange(charUpdatePending, false))
+            sendLocalCharUpdate();
+    });
+
+    refreshTimer.setInterval(REFRESH_INTERVAL_MS);
+    refreshTimer.setSingleShot(true);
+    connect(&refreshTimer, &QTimer::timeout, this, [this]() {
+        emit sig_updateWidget();
+        if (std::exchange(refreshCanvas, false))
+            emit sig_updateMapCanvas();
+    });
+
     if (thread) {
         connect(thread.get(), &QThread::started, this, [this]() {
             log("Initialized Group Manager service");
@@ -141,9 +161,10 @@ void Mmapper2Group::stop()
 
 void Mmapper2Group::slot_characterChanged(bool updateCanvas)
 {
-    emit sig_updateWidget();
-    if (updateCanvas)
-        emit sig_updateMapCanvas();
+    // Everyone's prompts arrive one by one; show them all in the same frame.
+    refreshCanvas |= updateCanvas;
+    if (!refreshTimer.isActive())
+        refreshTimer.start();
 }
 
 void Mmapper2Group::slot_updateSelf()
@@ -194,13 +215,43 @@ void Mmapper2Group::slot_setCharacterRoomId(RoomId roomId)
 }
 
 void Mmapper2Group::issueLocalCharUpdate()
+{
+    QMutexLocker locker(&networkLock);
+    if (!group)
+        return;
+
+    // Moving and dying can't wait; score changes during combat can.
+    const CGroupChar &self = deref(group->getSelf());
+    const bool critical = self.getRoomId() != lastSentRoomId
+                          || ((self.position == CharacterPositionEnum::DEAD)
+                              != (lastSentPosition == CharacterPositionEnum::DEAD));
+    const auto interval = std::chrono::milliseconds{getConfig().groupManager.updateInterval};
+    const auto elapsed = std::chrono::steady_clock::now() - lastCharUpdate;
+    if (critical || elapsed >= interval) {
+        charUpdatePending = false;
+        sendLocalCharUpdate();
+    } else if (!std::exchange(charUpdatePending, true)) {
+        // The parser calls us from its own thread, so the timer is started from ours.
+        const auto delay = std::chrono::ceil<std::chrono::milliseconds>(interval - elapsed);
+        QMetaObject::invokeMethod(this, [this, delay]() { charUpdateTimer.start(delay); });
+    }
+}
+
+void Mmapper2Group::sendLocalCharUpdate()
 {
     emit sig_updateWidget();
 
     QMutexLocker locker(&networkLock);
-    if (!group || getMode() == GroupManagerStateEnum::Off) {
+    if (!group)
+        return;
+
+    const CGroupChar &self = deref(group->getSelf());
+    lastCharUpdate = std::chrono::steady_clock::now();
+    lastSentRoomId = self.getRoomId();
+    lastSentPosition = self.position;
+
+    if (getMode() == GroupManagerStateEnum::Off)
         return;
-    }
 
     if (network) {
         const QVariantMap &data = group->getSelf()->toVariantMap();
@@ -244,6 +295,19 @@ void Mmapper2Group::slot_gTellArrived(const QVariantMap &node)
     emit sig_displayGroupTellEvent(color, name, text);
 }
 
+void Mmapper2Group::slot_mapDeltaArrived(const QVariantMap &node)
+{
+    if (!getConfig().groupManager.shareMapChanges)
+        return;
+
+    if (!node.contains("from") || !node.contains("delta")
+        || !node["delta"].canConvert(QMetaType::QByteArray)) {
+        qWarning() << "Malformed map delta" << node.keys();
+        return;
+    }
+    emit sig_mapDeltaArrived(node["from"].toString(), node["delta"].toByteArray());
+}
+
 void Mmapper2Group::kickCharacter(const QByteArray &character)
 {
     QMutexLocker locker(&networkLock);
@@ -273,6 +337,15 @@ void Mmapper2Group::sendGroupTell(const QByteArray &tell)
     emit sig_sendGroupTell(tell);
 }
 
+void Mmapper2Group::sendMapDelta(const QByteArray &delta)
+{
+    QMutexLocker locker(&networkLock);
+    if (!network)
+        return;
+
+    emit sig_sendMapDelta(delta);
+}
+
 void Mmapper2Group::parseScoreInformation(const QByteArray &score)
 {
     if (!group)
@@ -653,6 +726,10 @@ void Mmapper2Group::slot_startNetwork()
                 &CGroupCommunicator::sig_gTellArrived,
                 this,
                 &Mmapper2Group::slot_gTellArrived);
+        connect(network.get(),
+                &CGroupCommunicator::sig_mapDeltaArrived,
+                this,
+                &Mmapper2Group::slot_mapDeltaArrived);
         connect(network.get(), &CGroupCommunicator::destroyed, this, [this]() {
             network.release();
             emit sig_networkStatus(false);
@@ -677,6 +754,10 @@ void Mmapper2Group::slot_startNetwork()
                 &Mmapper2Group::sig_sendSelfRename,
                 network.get(),
                 &CGroupCommunicator::slot_sendSelfRename);
+        connect(this,
+                &Mmapper2Group::sig_sendMapDelta,
+                network.get(),
+                &CGroupCommunicator::slot_sendMapDelta);
     }
 
     // REVISIT: What about if the network is already started?
@@ -4,6 +4,7 @@
 // Author: Dmitrijs Barbarins <lachupe@gmail.com> (Azazello)
 // Author: Nils Schimmelmann <nschimme@gmail.com> (Jahara)
 
+#include <chrono>
 #include <memory>
 #include <QArgument>
 #include <QMap>
@@ -63,6 +64,11 @@ class Mmapper2Group final : public QObject
     void sig_sendCharUpdate(const QVariantMap &map);
     // CGroupCommunicator::sendSelfRename
     void sig_sendSelfRename(const QByteArray &, const QByteArray &);
+    // CGroupCommunicator::sendMapDelta
+    void sig_sendMapDelta(const QByteArray &delta);
+
+    // MainWindow::slot_applyMapDelta (via MainWindow)
+    void sig_mapDeltaArrived(const QString &from, const QByteArray &delta);
 
 public:
     explicit Mmapper2Group(QObject *parent);
@@ -78,6 +84,8 @@ class Mmapper2Group final : public QObject
 
 public:
     NODISCARD GroupManagerApi &getGroupManagerApi() { return m_groupManagerApi; }
+    // Sends rooms written by MapStorage::saveDelta() to the group, if it's up.
+    void sendMapDelta(const QByteArray &delta);
 
 private:
     WeakHandleLifetime<Mmapper2Group> m_weakHandleLifetime{*this};
@@ -106,6 +114,7 @@ public slots:
 protected slots:
     // Communicator
     void slot_gTellArrived(const QVariantMap &node);
+    void slot_mapDeltaArrived(const QVariantMap &node);
     void slot_relayMessageBox(const QString &message);
     void slot_sendLog(const QString &);
     void slot_characterChanged(bool updateCanvas);
@@ -125,12 +134,22 @@ protected slots:
 
     std::atomic_int m_calledStopInternal{0};
     QTimer affectTimer;
+    // Our updates are held back to one per updateInterval, and the group's are
+    // shown at most once per frame.
+    QTimer charUpdateTimer;
+    QTimer refreshTimer;
+    std::chrono::steady_clock::time_point lastCharUpdate{};
+    RoomId lastSentRoomId = INVALID_ROOMID;
+    CharacterPositionEnum lastSentPosition = CharacterPositionEnum::UNDEFINED;
+    bool charUpdatePending = false;
+    bool refreshCanvas = false;
     QMap<CharacterAffectEnum, int64_t> affectLastSeen;
     using AffectTimeout = QMap<CharacterAffectEnum, int32_t>;
     static const AffectTimeout s_affectTimeout;
 
     bool init();
     void issueLocalCharUpdate();
+    void sendLocalCharUpdate();
     bool setCharacterPosition(const CharacterPositionEnum pos);
     bool setCharacterScore(const int hp,
                            const int maxhp,
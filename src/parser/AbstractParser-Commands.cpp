@@ -16,6 +16,11 @@
 #include <QMessageLogContext>
 #include <QtCore>
 
+#include "../global/CacheRegistry.h"
+#include "../global/EventTrace.h"
+#include "../global/LatencyTrace.h"
+#include "../global/MemoryReport.h"
+#include "../global/PerfCounters.h"
 #include "../global/StringView.h"
 #include "../global/TextUtils.h"
 #include "../mapdata/DoorFlags.h"
@@ -40,7 +45,12 @@ const Abbrev cmdDoorHelp{"doorhelp", 5};
 const Abbrev cmdGroup{"group", 5};
 const Abbrev cmdGroupTell{"gtell", 2};
 const Abbrev cmdHelp{"help", 2};
+const Abbrev cmdLatency{"latency", 4};
 const Abbrev cmdMark{"mark", 2};
+const Abbrev cmdMccpStats{"mccpstats", 5};
+const Abbrev cmdMemory{"mem", 3};
+const Abbrev cmdPathStats{"pathstats", 5};
+const Abbrev cmdPerf{"perf", 4};
 const Abbrev cmdRemoveDoorNames{"remove-secret-door-names"};
 const Abbrev cmdRoom{"room", 2};
 const Abbrev cmdSearch{"search", 3};
@@ -48,6 +58,7 @@ const Abbrev cmdSet{"set", 2};
 const Abbrev cmdTime{"time", 2};
 const Abbrev cmdVote{"vote", 2};
 const Abbrev cmdTimer{"timer", 5};
+const Abbrev cmdTrace{"trace", 5};
 
 Abbrev getParserCommandName(const DoorFlagEnum x)
 {
@@ -559,7 +570,7 @@ void AbstractParser::parseSearch(StringView view)
 void AbstractParser::parseDirections(StringView view)
 {
     if (view.isEmpty())
-        showSyntax("dirs [-(name|desc|contents|note|exits|flags|all)] pattern");
+        showSyntax("dirs [-(name|desc|contents|note|exits|flags|all)] pattern | -id <room id>");
     else
         doGetDirectionsCommand(view);
 }
@@ -587,10 +598,9 @@ syntax::MatchResult ArgHelpCommand::virt_match(const syntax::ParserInput &input,
     auto &arg = *this;
     if (!input.empty()) {
         const auto &map = arg.m_map;
-        const auto &next = input.front();
-        const auto it = map.find(next);
+        const auto it = map.find(input.front());
         if (it != map.end()) {
-            return syntax::MatchResult::success(1, input, Value(next));
+            return syntax::MatchResult::success(1, input, Value(it->first));
         }
     }
 
@@ -650,6 +660,7 @@ void AbstractParser::initSpecialCommandMap()
 {
     auto &map = m_specialCommandMap;
     map.clear();
+    m_specialCommandTrie.clear();
 
     auto add = [this](Abbrev abb, const ParserCallback &callback, const HelpCallback &help) {
         addSpecialCommand(abb.getCommand(), abb.getMinAbbrev(), callback, help);
@@ -807,6 +818,116 @@ void AbstractParser::initSpecialCommandMap()
             return true;
         },
         makeSimpleHelp("Displays the current MUME time."));
+    add(
+        cmdPathStats,
+        [this](const std::vector<StringView> & /*s*/, StringView rest) {
+            if (rest.isEmpty()) {
+                sendToUser(::toQStringLatin1(m_proxy.getPathStats().toString()));
+                return true;
+            }
+            if (!Abbrev{"reset", 5}.matches(rest.trim()))
+                return false;
+            m_proxy.resetPathStats();
+            sendToUser("Path machine statistics reset.\n");
+            return true;
+        },
+        makeSimpleHelp("Displays path machine statistics; \"reset\" clears them."));
+    add(
+        cmdMccpStats,
+        [this](const std::vector<StringView> & /*s*/, StringView rest) {
+            if (rest.isEmpty()) {
+                sendToUser(::toQStringLatin1(m_proxy.getCompressionStats().toString()));
+                return true;
+            }
+            if (!Abbrev{"reset", 5}.matches(rest.trim()))
+                return false;
+            m_proxy.resetCompressionStats();
+            sendToUser("MCCP statistics reset.\n");
+            return true;
+        },
+        makeSimpleHelp("Displays MUD compression statistics; \"reset\" clears them."));
+    add(
+        cmdLatency,
+        [this](const std::vector<StringView> & /*s*/, StringView rest) {
+            rest.trim();
+            if (rest.isEmpty()) {
+                sendToUser(::toQStringLatin1(latency_trace::getReport()));
+                return true;
+            }
+            if (Abbrev{"on", 2}.matches(rest) || Abbrev{"off", 3}.matches(rest)) {
+                const bool enable = Abbrev{"on", 2}.matches(rest);
+                latency_trace::setEnabled(enable);
+                sendToUser(enable ? "Latency tracing enabled.\n" : "Latency tracing disabled.\n");
+                return true;
+            }
+            if (!Abbrev{"reset", 5}.matches(rest))
+                return false;
+            latency_trace::reset();
+            sendToUser("Latency statistics reset.\n");
+            return true;
+        },
+        makeSimpleHelp("Displays MUD-to-user latency per stage; \"on\", \"off\", or \"reset\"."));
+    add(
+        cmdMemory,
+        [this](const std::vector<StringView> & /*s*/, StringView rest) {
+            if (rest.isEmpty()) {
+                sendToUser(::toQStringLatin1(memory_report::getReport()));
+                return true;
+            }
+            if (!Abbrev{"trim", 4}.matches(rest.trim()))
+                return false;
+            const size_t freed = cache_registry::evictAll();
+            sendToUser(QString("Freed about %1 KiB of caches.\n").arg(freed / 1024));
+            return true;
+        },
+        makeSimpleHelp("Displays approximate memory use per subsystem; \"trim\" drops caches."));
+    add(
+        cmdPerf,
+        [this](const std::vector<StringView> & /*s*/, StringView rest) {
+            if (rest.isEmpty()) {
+                sendToUser(::toQStringLatin1(perf_counters::getReport()));
+                return true;
+            }
+            if (!Abbrev{"reset", 5}.matches(rest.trim()))
+                return false;
+            perf_counters::reset();
+            sendToUser("Performance counters reset.\n");
+            return true;
+        },
+        makeSimpleHelp("Displays performance counters; \"reset\" clears them."));
+    add(
+        cmdTrace,
+        [this](const std::vector<StringView> & /*s*/, StringView rest) {
+            rest.trim();
+            if (rest.isEmpty()) {
+                sendToUser(event_trace::isEnabled() ? "Event tracing is enabled.\n"
+                                                    : "Event tracing is disabled.\n");
+                return true;
+            }
+            if (Abbrev{"on", 2}.matches(rest) || Abbrev{"off", 3}.matches(rest)) {
+                const bool enable = Abbrev{"on", 2}.matches(rest);
+                event_trace::setEnabled(enable);
+                sendToUser(enable ? "Event tracing enabled.\n" : "Event tracing disabled.\n");
+                return true;
+            }
+            if (Abbrev{"dump", 4}.matches(rest)) {
+                const QString fileName = QDir::temp().absoluteFilePath(
+                    QString("mmapper-trace-%1.json")
+                        .arg(QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss")));
+                if (!event_trace::writeJson(::toStdStringUtf8(fileName))) {
+                    sendToUser(QString("Unable to write %1.\n").arg(fileName));
+                    return true;
+                }
+                sendToUser(QString("Trace written to %1.\n").arg(fileName));
+                return true;
+            }
+            if (!Abbrev{"reset", 5}.matches(rest))
+                return false;
+            event_trace::reset();
+            sendToUser("Event trace reset.\n");
+            return true;
+        },
+        makeSimpleHelp("Records a Chrome trace; \"on\", \"off\", \"dump\", or \"reset\"."));
     add(
         cmdVote,
         [this](const std::vector<StringView> & /*s*/, StringView rest) {
@@ -874,10 +995,10 @@ void AbstractParser::addSpecialCommand(const char *const s,
         assert(i >= 0);
         key.resize(static_cast<unsigned int>(i));
         auto it = map.find(key);
-        if (it == map.end())
-
-            map.emplace(key, ParserRecord{fullName, callback, help});
-        else {
+        if (it == map.end()) {
+            it = map.emplace(key, ParserRecord{fullName, callback, help}).first;
+            m_specialCommandTrie.insert(key, it->second);
+        } else {
             qWarning() << ("unable to add " + ::toQStringLatin1(key) + " for " + abb.describe());
         }
     }
@@ -889,15 +1010,12 @@ bool AbstractParser::evalSpecialCommandMap(StringView args)
         return false;
 
     auto first = args.takeFirstWord();
-    auto &map = m_specialCommandMap;
-
-    const std::string key = toLowerLatin1(first.getStdStringView());
-    auto it = map.find(key);
-    if (it == map.end())
+    ParserRecord *const found = m_specialCommandTrie.find(first.getStdStringView());
+    if (found == nullptr)
         return false;
 
     // REVISIT: add # of calls to the record?
-    ParserRecord &rec = it->second;
+    ParserRecord &rec = *found;
     const auto &s = rec.fullCommand;
     const auto matched = std::vector<StringView>{StringView{s}};
     return rec.callback(matched, args);
@@ -375,6 +375,11 @@ void AbstractParser::doConfig(const StringView &cmd)
                         setNamedColor))),
             syn("perf-stats",
                 syn("set", opt("enabled", advanced.printPerfStats, "enable/disable stats"))),
+            syn("adaptive-quality",
+                syn("set",
+                    opt("enabled",
+                        advanced.adaptiveQuality,
+                        "enable/disable lowering the quality while the view moves"))),
             zoomSyntax,
             syn("3d-camera",
                 syn("set",
@@ -34,8 +34,7 @@ syntax::MatchResult ArgPlayer::virt_match(const syntax::ParserInput &input,
     }
 
     // REVISIT: Verify this player exists. Check for spaces?
-    const std::string &name = input.front();
-    return syntax::MatchResult::success(1, input, Value{name});
+    return syntax::MatchResult::success(1, input, Value{std::string{input.front()}});
 }
 
 std::ostream &ArgPlayer::virt_to_stream(std::ostream &os) const
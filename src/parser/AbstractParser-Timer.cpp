@@ -29,7 +29,7 @@ syntax::MatchResult ArgTimerName::virt_match(const syntax::ParserInput &input,
     if (input.empty())
         return syntax::MatchResult::failure(input);
 
-    return syntax::MatchResult::success(1, input, Value{input.front()});
+    return syntax::MatchResult::success(1, input, Value{std::string{input.front()}});
 }
 
 std::ostream &ArgTimerName::virt_to_stream(std::ostream &os) const
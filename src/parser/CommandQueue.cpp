@@ -4,13 +4,80 @@
 
 #include "CommandQueue.h"
 
+#include <cassert>
+#include <utility>
+
 #include "../mapdata/ExitDirection.h"
 
+static constexpr const size_t MIN_CAPACITY = 64;
+
+CommandQueue::Ring::Ring(const size_t capacity)
+    : m_mask{static_cast<uint64_t>(capacity) - 1u}
+    , m_slots{std::make_unique<std::atomic<CommandEnum>[]>(capacity)}
+{
+    assert(capacity != 0 && (capacity & (capacity - 1u)) == 0);
+}
+
+CommandEnum CommandQueue::Ring::read(const uint64_t seq) const
+{
+    // Seqlock-style read: if the writer got to this slot again, the value is
+    // discarded. Copy-on-write means that never happens to a live queue.
+    const CommandEnum cmd = m_slots[seq & m_mask].load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (m_reserved.load(std::memory_order_relaxed) > seq + capacity())
+        return CommandEnum::NONE;
+    return cmd;
+}
+
+void CommandQueue::Ring::write(const uint64_t seq, const CommandEnum cmd)
+{
+    assert(seq == m_reserved.load(std::memory_order_relaxed));
+    m_reserved.store(seq + 1u, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    m_slots[seq & m_mask].store(cmd, std::memory_order_relaxed);
+}
+
+CommandQueue::CommandQueue(const CommandQueue &rhs)
+    : m_ring{rhs.m_ring}
+    , m_begin{rhs.m_begin}
+    , m_end{rhs.m_end}
+    , m_owner{false}
+{}
+
+CommandQueue &CommandQueue::operator=(const CommandQueue &rhs)
+{
+    if (this != &rhs) {
+        m_ring = rhs.m_ring;
+        m_begin = rhs.m_begin;
+        m_end = rhs.m_end;
+        m_owner = false;
+    }
+    return *this;
+}
+
+CommandQueue::CommandQueue(CommandQueue &&rhs) noexcept
+    : m_ring{std::move(rhs.m_ring)}
+    , m_begin{std::exchange(rhs.m_begin, 0)}
+    , m_end{std::exchange(rhs.m_end, 0)}
+    , m_owner{std::exchange(rhs.m_owner, true)}
+{}
+
+CommandQueue &CommandQueue::operator=(CommandQueue &&rhs) noexcept
+{
+    if (this != &rhs) {
+        m_ring = std::move(rhs.m_ring);
+        m_begin = std::exchange(rhs.m_begin, 0);
+        m_end = std::exchange(rhs.m_end, 0);
+        m_owner = std::exchange(rhs.m_owner, true);
+    }
+    return *this;
+}
+
 QByteArray CommandQueue::toByteArray() const
 {
     QByteArray dirs;
-    for (int i = 0; i < base::size(); i++) {
-        const auto cmd = base::at(i);
+    dirs.reserve(size());
+    for (const CommandEnum cmd : *this) {
         // REVISIT: Serialize/deserialize directions more intelligently
         dirs.append(Mmapper2Exit::charForDir(getDirection(cmd)));
     }
@@ -19,9 +86,54 @@ QByteArray CommandQueue::toByteArray() const
 
 CommandQueue &CommandQueue::operator=(const QByteArray &dirs)
 {
-    base::clear();
+    *this = CommandQueue{};
     for (int i = 0; i < dirs.length(); i++) {
-        base::enqueue(static_cast<CommandEnum>(Mmapper2Exit::dirForChar(dirs.at(i))));
+        enqueue(static_cast<CommandEnum>(Mmapper2Exit::dirForChar(dirs.at(i))));
     }
     return *this;
 }
+
+CommandEnum CommandQueue::head() const
+{
+    assert(!isEmpty());
+    return m_ring->read(m_begin);
+}
+
+CommandEnum CommandQueue::dequeue()
+{
+    const CommandEnum cmd = head();
+    ++m_begin;
+    return cmd;
+}
+
+void CommandQueue::enqueue(const CommandEnum cmd)
+{
+    reserveForEnqueue();
+    m_ring->write(m_end++, cmd);
+}
+
+void CommandQueue::reserveForEnqueue()
+{
+    const size_t count = static_cast<size_t>(m_end - m_begin);
+    if (m_owner && m_ring != nullptr && count < m_ring->capacity()) {
+        // Wrapping around overwrites a slot that a copy may still read.
+        const bool wraps = m_end >= static_cast<uint64_t>(m_ring->capacity());
+        if (!wraps || m_ring.use_count() == 1)
+            return;
+    }
+
+    // A copy (or a full or shared ring) moves its elements to a ring of its own.
+    size_t capacity = MIN_CAPACITY;
+    while (capacity <= count)
+        capacity *= 2u;
+
+    auto ring = std::make_shared<Ring>(capacity);
+    uint64_t seq = 0;
+    for (const CommandEnum cmd : *this) {
+        ring->write(seq++, cmd);
+    }
+    m_ring = std::move(ring);
+    m_begin = 0;
+    m_end = seq;
+    m_owner = true;
+}
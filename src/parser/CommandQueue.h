@@ -3,32 +3,108 @@
 // Copyright (C) 2019 The MMapper Authors
 // Author: Nils Schimmelmann <nschimme@gmail.com> (Jahara)
 
-#include <QQueue>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <QByteArray>
 
 #include "CommandId.h"
 
-class NODISCARD CommandQueue : private QQueue<CommandEnum>
+// A queue of commands kept in a shared ring buffer.
+//
+// Copying a queue is O(1): the copy shares the ring, and is still a value. Slots
+// are only ever appended, so the owner can keep enqueueing and dequeueing without
+// disturbing copies, except when a write would wrap around onto a slot; while any
+// copy is alive, the owner moves to a ring of its own first (copy-on-write).
+// Enqueueing on a copy likewise first gives it its own ring.
+//
+// The ring grows when the owning queue fills it, so long speedwalks are never cut
+// short; views of the old ring keep the old ring alive.
+class NODISCARD CommandQueue final
 {
 private:
-    using base = QQueue<CommandEnum>;
+    class NODISCARD Ring final
+    {
+    private:
+        const uint64_t m_mask;
+        std::unique_ptr<std::atomic<CommandEnum>[]> m_slots;
+        // Count of writes started; a slot is overwritten only after this moves past it.
+        std::atomic<uint64_t> m_reserved{0};
+
+    public:
+        explicit Ring(size_t capacity);
+
+    public:
+        NODISCARD size_t capacity() const { return static_cast<size_t>(m_mask + 1); }
+        NODISCARD CommandEnum read(uint64_t seq) const;
+        void write(uint64_t seq, CommandEnum cmd);
+    };
+
+    std::shared_ptr<Ring> m_ring;
+    uint64_t m_begin = 0;
+    uint64_t m_end = 0;
+    // Only the owner writes to the ring; copies only read it until they enqueue.
+    bool m_owner = true;
+
+public:
+    class NODISCARD const_iterator final
+    {
+    private:
+        const Ring *m_ring = nullptr;
+        uint64_t m_seq = 0;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = CommandEnum;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = CommandEnum;
+
+    public:
+        const_iterator() = default;
+        explicit const_iterator(const Ring *const ring, const uint64_t seq)
+            : m_ring{ring}
+            , m_seq{seq}
+        {}
+
+    public:
+        NODISCARD CommandEnum operator*() const { return m_ring->read(m_seq); }
+        const_iterator &operator++()
+        {
+            ++m_seq;
+            return *this;
+        }
+        NODISCARD bool operator==(const const_iterator &rhs) const { return m_seq == rhs.m_seq; }
+        NODISCARD bool operator!=(const const_iterator &rhs) const { return !operator==(rhs); }
+    };
 
 public:
-    using QQueue<CommandEnum>::QQueue;
+    CommandQueue() = default;
+    ~CommandQueue() = default;
+    CommandQueue(const CommandQueue &rhs);
+    CommandQueue &operator=(const CommandQueue &rhs);
+    CommandQueue(CommandQueue &&rhs) noexcept;
+    CommandQueue &operator=(CommandQueue &&rhs) noexcept;
 
 public:
     NODISCARD QByteArray toByteArray() const;
     CommandQueue &operator=(const QByteArray &dirs);
 
 public:
-    using base::begin;
-    using base::end;
-    using base::head;
-    using base::isEmpty;
+    NODISCARD const_iterator begin() const { return const_iterator{m_ring.get(), m_begin}; }
+    NODISCARD const_iterator end() const { return const_iterator{m_ring.get(), m_end}; }
+    NODISCARD CommandEnum head() const;
+    NODISCARD bool isEmpty() const { return m_begin == m_end; }
+    NODISCARD int size() const { return static_cast<int>(m_end - m_begin); }
 
 public:
-    using base::append;
-    using base::clear;
-    using base::dequeue;
-    using base::enqueue;
-    using base::prepend;
+    void append(CommandEnum cmd) { enqueue(cmd); }
+    void clear() { m_begin = m_end; }
+    CommandEnum dequeue();
+    void enqueue(CommandEnum cmd);
+
+private:
+    void reserveForEnqueue();
 };
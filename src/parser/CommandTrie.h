@@ -0,0 +1,73 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "../global/TextUtils.h"
+#include "../global/macros.h"
+
+// Case-insensitive prefix trie over command names, where each node knows which command
+// (if any) the abbreviation spelled by the path to it stands for. A lookup walks the
+// input once and never allocates.
+template<typename T>
+class NODISCARD CommandTrie final
+{
+private:
+    struct NODISCARD Node final
+    {
+        // Few enough per node that a linear scan beats anything fancier.
+        std::vector<std::pair<char, uint32_t>> children;
+        T *value = nullptr;
+    };
+    std::vector<Node> m_nodes{1};
+
+public:
+    void clear() { m_nodes.assign(1, Node{}); }
+
+    // The key is expected to be in lowercase; value must outlive the trie's use.
+    void insert(const std::string_view key, T &value)
+    {
+        uint32_t node = 0;
+        for (const char c : key) {
+            node = getOrAddChild(node, c);
+        }
+        m_nodes[node].value = &value;
+    }
+
+    NODISCARD T *find(const std::string_view input) const
+    {
+        uint32_t node = 0;
+        for (const char c : input) {
+            if (!findChild(node, ::toLowerLatin1(c), node))
+                return nullptr;
+        }
+        return m_nodes[node].value;
+    }
+
+private:
+    NODISCARD bool findChild(const uint32_t node, const char c, uint32_t &child) const
+    {
+        for (const auto &kv : m_nodes[node].children) {
+            if (kv.first == c) {
+                child = kv.second;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    NODISCARD uint32_t getOrAddChild(const uint32_t node, const char c)
+    {
+        uint32_t child = 0;
+        if (findChild(node, c, child))
+            return child;
+        child = static_cast<uint32_t>(m_nodes.size());
+        m_nodes.emplace_back();
+        m_nodes[node].children.emplace_back(c, child);
+        return child;
+    }
+};
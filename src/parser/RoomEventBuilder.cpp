@@ -0,0 +1,66 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "RoomEventBuilder.h"
+
+#include <utility>
+
+#include "../mapdata/mmapper2room.h"
+
+static void appendLatin1(std::string &out, const QString &qs)
+{
+    out.reserve(out.size() + static_cast<size_t>(qs.size()));
+    for (const QChar qc : qs) {
+        out.push_back(qc.toLatin1());
+    }
+}
+
+void RoomEventBuilder::beginRoom()
+{
+    m_name.setEmpty();
+    m_desc.reset();
+    m_contents.reset();
+}
+
+void RoomEventBuilder::setName(const QString &name)
+{
+    m_name.setEmpty();
+    appendLatin1(m_name.text, name);
+}
+
+void RoomEventBuilder::appendDescription(const QString &line)
+{
+    m_desc.present = true;
+    appendLatin1(m_desc.text, line);
+}
+
+void RoomEventBuilder::appendContents(const QString &line)
+{
+    m_contents.present = true;
+    appendLatin1(m_contents.text, line);
+}
+
+void RoomEventBuilder::discardRoomText()
+{
+    m_name.reset();
+    m_desc.reset();
+    m_contents.reset();
+}
+
+SharedParseEvent RoomEventBuilder::build(const CommandEnum move,
+                                         const RoomTerrainEnum terrain,
+                                         const ExitsFlagsType &exitsFlags,
+                                         const PromptFlagsType &promptFlags,
+                                         const ConnectedRoomFlagsType &connectedRoomFlags,
+                                         std::shared_ptr<SlabArena> arena) const
+{
+    return ParseEvent::createEvent(move,
+                                   RoomName::internedFrom(m_name.text),
+                                   RoomDesc::internedFrom(m_desc.text),
+                                   RoomContents::internedFrom(m_contents.text),
+                                   terrain,
+                                   exitsFlags,
+                                   promptFlags,
+                                   connectedRoomFlags,
+                                   std::move(arena));
+}
@@ -0,0 +1,69 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <QString>
+
+#include "../expandoracommon/parseevent.h"
+#include "../global/RuleOf5.h"
+#include "../global/macros.h"
+
+// Collects the room name, description and contents as their lines arrive, in
+// buffers that keep their capacity from room to room. The event is built with
+// the text interned straight from the buffers, so a room that was seen before
+// costs no string allocations.
+class NODISCARD RoomEventBuilder final
+{
+private:
+    // REVISIT: Is there any point to having a distinction between null and empty?
+    struct NODISCARD Field final
+    {
+        std::string text;
+        bool present = false;
+
+        void reset()
+        {
+            text.clear();
+            present = false;
+        }
+        void setEmpty()
+        {
+            text.clear();
+            present = true;
+        }
+    };
+
+    Field m_name;
+    Field m_desc;
+    Field m_contents;
+
+public:
+    RoomEventBuilder() = default;
+    DELETE_CTORS_AND_ASSIGN_OPS(RoomEventBuilder);
+
+public:
+    // 'name' tag will not show up when blinded, so the name starts empty but present.
+    void beginRoom();
+    void beginDescription() { m_desc.setEmpty(); }
+    void setName(const QString &name);
+    void appendDescription(const QString &line);
+    void appendContents(const QString &line);
+    // The room can't be trusted (blindness, fog, darkness...).
+    void discardRoomText();
+
+public:
+    NODISCARD bool hasName() const { return m_name.present; }
+    NODISCARD bool hasDescription() const { return m_desc.present; }
+    NODISCARD std::string_view getName() const { return m_name.text; }
+
+public:
+    NODISCARD SharedParseEvent build(CommandEnum move,
+                                     RoomTerrainEnum terrain,
+                                     const ExitsFlagsType &exitsFlags,
+                                     const PromptFlagsType &promptFlags,
+                                     const ConnectedRoomFlagsType &connectedRoomFlags,
+                                     std::shared_ptr<SlabArena> arena) const;
+};
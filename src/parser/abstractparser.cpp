@@ -10,10 +10,10 @@
 #include <cassert>
 #include <cctype>
 #include <cstdlib>
+#include <cstring>
 #include <iterator>
 #include <memory>
 #include <optional>
-#include <sstream>
 #include <stdexcept>
 #include <string>
 #include <utility>
@@ -142,10 +142,19 @@ AbstractParser::AbstractParser(MapData &md,
             this,
             &AbstractParser::slot_doOfflineCharacterMove);
 
-    // MUME only attempts up to 4 commands per second (i.e. 250ms)
-    m_offlineCommandTimer.setInterval(250);
+    // The interval comes from the config each time the timer is started.
     m_offlineCommandTimer.setSingleShot(true);
 
+    ShortestPathService &shortestPaths = m_mapData.getShortestPathService();
+    connect(&shortestPaths,
+            &ShortestPathService::sig_pathFound,
+            this,
+            &AbstractParser::slot_onShortestPathFound);
+    connect(&shortestPaths,
+            &ShortestPathService::sig_searchFinished,
+            this,
+            &AbstractParser::slot_onShortestPathSearchFinished);
+
     initSpecialCommandMap();
     initActionMap();
 }
@@ -247,7 +256,7 @@ void AbstractParser::parsePrompt(const QString &prompt)
     m_promptFlags.setValid();
 }
 
-void AbstractParser::parseExits(std::ostream &os)
+void AbstractParser::parseExits(QByteArray &out)
 {
     QString str = normalizeStringCopy(m_exits);
     m_connectedRoomFlags.reset();
@@ -335,27 +344,72 @@ void AbstractParser::parseExits(std::ostream &os)
     };
 
     if (str.length() > 5 && str.at(5).toLatin1() != ':') {
-        // Ainur exits
-        static const QRegularExpression rx(
-            R"(^\s*([\^\*~\-={#\[\(\\\/]+)?([A-za-z]+)([\^\*~\-=}#\]\)\\\/]+)?\s+\- (.*)$)");
-        static const QRegularExpression newline(R"(\r?\n)");
-        for (const auto &part : str.split(newline)) {
-            const auto match = rx.match(part);
-            if (match.hasMatch()) {
+        // Ainur exits, one per line; equivalent to matching each line against
+        // ^\s*([\^\*~\-={#\[\(\\\/]+)?([A-za-z]+)([\^\*~\-=}#\]\)\\\/]+)?\s+\- (.*)$
+        const auto isOneOf = [](const char c, const char *const set) {
+            return c != C_NUL && std::strchr(set, c) != nullptr;
+        };
+        const auto isPrefixSign = [&isOneOf](const char c) {
+            return isOneOf(c, "^*~-={#[(\\/");
+        };
+        const auto isSuffixSign = [&isOneOf](const char c) {
+            return isOneOf(c, "^*~-=}#])\\/");
+        };
+        // Note: A-z also spans [ \ ] ^ _ and `.
+        const auto isLetter = [](const char c) { return c >= 'A' && c <= 'z'; };
+        const auto isSpace = [](const char c) {
+            return std::isspace(static_cast<unsigned char>(c)) != 0;
+        };
+
+        for (int lineStart = 0; lineStart < str.length();) {
+            int lineEnd = str.indexOf(C_NEWLINE, lineStart);
+            if (lineEnd < 0)
+                lineEnd = str.length();
+
+            const auto charAt = [&str, lineEnd](const int i) -> char {
+                return i < lineEnd ? str.at(i).toLatin1() : C_NUL;
+            };
+            // True if the rest of the line matches, with the direction starting at pos.
+            const auto matchesFrom = [&](int pos) {
+                if (!isLetter(charAt(pos)))
+                    return false;
+                while (isLetter(charAt(pos)))
+                    ++pos;
+                while (isSuffixSign(charAt(pos)))
+                    ++pos;
+                if (!isSpace(charAt(pos)))
+                    return false;
+                for (; isSpace(charAt(pos)); ++pos) {
+                    if (charAt(pos + 1) == '-' && charAt(pos + 2) == ' ')
+                        return true;
+                }
+                return false;
+            };
+
+            int signsStart = lineStart;
+            while (signsStart < lineEnd && isSpace(charAt(signsStart)))
+                ++signsStart;
+            int signsEnd = signsStart;
+            while (signsEnd < lineEnd && isPrefixSign(charAt(signsEnd)))
+                ++signsEnd;
+            // Like the regex, give signs back to the direction if that's what it takes.
+            while (signsEnd > signsStart && !matchesFrom(signsEnd))
+                --signsEnd;
+
+            if (matchesFrom(signsEnd)) {
                 // Parse exit flag
-                const auto &signs = match.captured(1);
-                for (const QChar qc : signs) {
-                    parse_exit_flag(qc.toLatin1());
+                for (int i = signsStart; i < signsEnd; ++i) {
+                    parse_exit_flag(charAt(i));
                 }
 
                 // Set exit flags to direction
-                const auto &exit = match.captured(2);
-                dir = Mmapper2Exit::dirForChar(exit.at(0).toLower().toLatin1());
+                dir = Mmapper2Exit::dirForChar(toLowerLatin1(charAt(signsEnd)));
                 set_exit_flags();
 
                 // Reset for next exit
                 reset_exit_flags();
             }
+            lineStart = lineEnd + 1;
         }
     } else {
         // Player exits
@@ -447,17 +501,19 @@ void AbstractParser::parseExits(std::ostream &os)
             }
             return "";
         };
-        os << ::toStdStringLatin1(right_trim(m_exits) + cn);
+        out += right_trim(m_exits).toLatin1();
+        out += cn;
 
         if (getConfig().mumeNative.showNotes) {
             const auto &ns = room->getNote();
             if (!ns.isEmpty()) {
-                const QString note = QString("Note: %1\n").arg(ns.toQString());
-                os << ::toStdStringLatin1(note);
+                out += "Note: ";
+                out += ns.toQByteArray();
+                out += "\n";
             }
         }
     } else {
-        os << ::toStdStringLatin1(m_exits);
+        out += m_exits.toLatin1();
     }
 }
 
@@ -490,7 +546,7 @@ Coordinate AbstractParser::getTailPosition() const
     return cl.isEmpty() ? m_mapData.getPosition() : cl.back();
 }
 
-void AbstractParser::emulateExits(std::ostream &os, const CommandEnum move)
+void AbstractParser::emulateExits(QByteArray &out, const CommandEnum move)
 {
     const auto nextCoordinate = [this, &move]() {
         // Use movement direction to find the next coordinate
@@ -508,7 +564,7 @@ void AbstractParser::emulateExits(std::ostream &os, const CommandEnum move)
     }();
     auto rs = RoomSelection(m_mapData);
     if (const Room *const r = rs.getRoom(nextCoordinate))
-        sendRoomExitsInfoToUser(os, r);
+        sendRoomExitsInfoToUser(out, r);
 }
 
 QByteArray AbstractParser::enhanceExits(const Room *sourceRoom)
@@ -731,39 +787,20 @@ NODISCARD static QString compressDirections(QString original)
     return ans;
 }
 
-class ShortestPathEmitter final : public ShortestPathRecipient
+void AbstractParser::slot_onShortestPathFound(const quint64 request,
+                                              const ShortestPathResult &result)
 {
-    AbstractParser &parser;
-
-public:
-    explicit ShortestPathEmitter(AbstractParser &parser)
-        : parser(parser)
-    {}
-    ~ShortestPathEmitter() override;
-
-private:
-    void virt_receiveShortestPath(RoomAdmin * /*admin*/,
-                                  QVector<SPNode> spnodes,
-                                  const int endpoint) final
-    {
-        const SPNode *spnode = &spnodes[endpoint];
-        auto name = spnode->r->getName();
-        parser.sendToUser("Distance " + QString::number(spnode->dist) + ": " + name + "\n");
-        QString dirs;
-        while (spnode->parent >= 0) {
-            if (&spnodes[spnode->parent] == spnode) {
-                parser.sendToUser("ERROR: loop\n");
-                break;
-            }
-            dirs.append(Mmapper2Exit::charForDir(spnode->lastdir));
-            spnode = &spnodes[spnode->parent];
-        }
-        std::reverse(dirs.begin(), dirs.end());
-        parser.sendToUser("dirs: " + compressDirections(dirs) + "\n");
-    }
-};
+    if (request != m_dirsRequest)
+        return;
+    sendToUser("Distance " + QString::number(result.dist) + ": " + result.name + "\n");
+    sendToUser("dirs: " + compressDirections(result.dirs) + "\n");
+}
 
-ShortestPathEmitter::~ShortestPathEmitter() = default;
+void AbstractParser::slot_onShortestPathSearchFinished(const quint64 request, int /*numFound*/)
+{
+    if (request == m_dirsRequest)
+        m_dirsRequest = 0;
+}
 
 void AbstractParser::searchCommand(const RoomFilter &f)
 {
@@ -781,11 +818,21 @@ void AbstractParser::searchCommand(const RoomFilter &f)
 
 void AbstractParser::dirsCommand(const RoomFilter &f)
 {
-    ShortestPathEmitter sp_emitter(*this);
+    auto rs = RoomSelection(m_mapData);
+    if (const Room *const r = rs.getRoom(getTailPosition())) {
+        m_dirsRequest = m_mapData.requestShortestPaths(r->getId(), f, 10);
+    }
+}
 
+void AbstractParser::dirsCommand(const RoomId target)
+{
     auto rs = RoomSelection(m_mapData);
+    if (rs.getRoom(target) == nullptr) {
+        sendToUser("No such room.\n");
+        return;
+    }
     if (const Room *const r = rs.getRoom(getTailPosition())) {
-        m_mapData.shortestPathSearch(r, &sp_emitter, f, 10, 0);
+        m_dirsRequest = m_mapData.requestShortestPath(r->getId(), target);
     }
 }
 
@@ -842,6 +889,18 @@ void AbstractParser::doSearchCommand(StringView view)
 
 void AbstractParser::doGetDirectionsCommand(StringView view)
 {
+    StringView args = view;
+    if (args.takeFirstWord() == std::string_view{"-id"}) {
+        bool ok = false;
+        const uint32_t id = args.trim().toQString().toUInt(&ok);
+        if (!ok) {
+            sendToUser("Invalid room id.\n");
+            return;
+        }
+        dirsCommand(RoomId{id});
+        return;
+    }
+
     if (std::optional<RoomFilter> optFilter = RoomFilter::parseRoomFilter(view.getStdStringView())) {
         dirsCommand(optFilter.value());
     } else {
@@ -1103,8 +1162,33 @@ void AbstractParser::slot_doOfflineCharacterMove()
         return;
     }
 
-    const RAIICallback timerRaii{[this]() { this->m_offlineCommandTimer.start(); }};
+    const int interval = getConfig().parser.offlineMoveInterval;
+    if (interval > 0) {
+        const RAIICallback timerRaii{
+            [this, interval]() { this->m_offlineCommandTimer.start(interval); }};
+        doOfflineCharacterStep();
+        return;
+    }
+
+    // Walk the whole queue now: the user gets one write, and the path is redrawn once.
+    {
+        const RAIIBool batching{m_batchingOfflineMoves};
+        m_batchedGoAhead = false;
+        while (!m_queue.isEmpty()) {
+            doOfflineCharacterStep();
+        }
+    }
 
+    QByteArray output;
+    std::swap(output, m_batchedOutput);
+    if (!output.isEmpty())
+        sendToUser(output, m_batchedGoAhead);
+    pathChanged();
+}
+
+void AbstractParser::doOfflineCharacterStep()
+{
+    assert(!m_queue.isEmpty());
     CommandEnum direction = m_queue.dequeue();
     if (m_mapData.isEmpty()) {
         sendToUser("Alas, you cannot go that way...\n");
@@ -1196,14 +1280,16 @@ void AbstractParser::slot_doOfflineCharacterMove()
         // Create character move event for main move/search algorithm
         auto ev = ParseEvent::createEvent(direction,
                                           otherRoom->getName(),
-                                          otherRoom->getDescription(),
-                                          otherRoom->getContents(),
+                                          otherRoom->readDescription(),
+                                          otherRoom->readContents(),
                                           otherRoom->getTerrainType(),
                                           ExitsFlagsType{},
                                           PromptFlagsType{},
-                                          ConnectedRoomFlagsType{});
-        emit sig_handleParseEvent(SigParseEvent{ev});
-        pathChanged();
+                                          ConnectedRoomFlagsType{},
+                                          m_eventArena);
+        emit sig_handleParseEvent(SigParseEvent{std::move(ev)});
+        if (!m_batchingOfflineMoves)
+            pathChanged();
     };
 
     const Exit &e = getExit(); /* NOTE: getExit() can modify direction */
@@ -1230,7 +1316,7 @@ void AbstractParser::offlineCharacterMove(const CommandEnum direction)
     }
 
     if (!m_offlineCommandTimer.isActive()) {
-        m_offlineCommandTimer.start();
+        m_offlineCommandTimer.start(getConfig().parser.offlineMoveInterval);
     }
 }
 
@@ -1253,7 +1339,7 @@ void AbstractParser::sendRoomInfoToUser(const Room *r)
     sendToUser(roomName);
 
     QByteArray roomDescription;
-    if (const QString &desc = r->getDescription().toQString(); !desc.trimmed().isEmpty()) {
+    if (const QString &desc = r->readDescription().toQString(); !desc.trimmed().isEmpty()) {
         if (!settings.roomDescColor.isEmpty()) {
             roomDescription += ESCAPE + settings.roomDescColor.toLatin1();
         }
@@ -1261,7 +1347,7 @@ void AbstractParser::sendRoomInfoToUser(const Room *r)
         sendToUser(roomDescription + "\n");
     }
 
-    QByteArray dynamicDescription = r->getContents().toQString().trimmed().toLatin1();
+    QByteArray dynamicDescription = r->readContents().toQString().trimmed().toLatin1();
     if (!dynamicDescription.isEmpty()) {
         sendToUser(dynamicDescription + "\n");
     }
@@ -1269,12 +1355,12 @@ void AbstractParser::sendRoomInfoToUser(const Room *r)
 
 void AbstractParser::sendRoomExitsInfoToUser(const Room *const r)
 {
-    std::ostringstream os;
-    sendRoomExitsInfoToUser(os, r);
-    sendToUser(::toQByteArrayLatin1(os.str()));
+    m_exitsOutput.resize(0);
+    sendRoomExitsInfoToUser(m_exitsOutput, r);
+    sendToUser(m_exitsOutput);
 }
 
-void AbstractParser::sendRoomExitsInfoToUser(std::ostream &os, const Room *const r)
+void AbstractParser::sendRoomExitsInfoToUser(QByteArray &out, const Room *const r)
 {
     if (r == nullptr) {
         return;
@@ -1283,7 +1369,8 @@ void AbstractParser::sendRoomExitsInfoToUser(std::ostream &os, const Room *const
                                   ? '*'
                                   : '^';
     uint exitCount = 0;
-    QString etmp = "Exits/emulated:";
+    const int start = out.size();
+    out += "Exits/emulated:";
     for (const ExitDirEnum direction : ALL_EXITS_NESWUD) {
         bool door = false;
         bool exit = false;
@@ -1297,7 +1384,7 @@ void AbstractParser::sendRoomExitsInfoToUser(std::ostream &os, const Room *const
         if (e.isExit()) {
             exitCount++;
             exit = true;
-            etmp += " ";
+            out += " ";
 
             RoomTerrainEnum sourceTerrain = r->getTerrainType();
             if (!e.outIsEmpty()) {
@@ -1309,7 +1396,7 @@ void AbstractParser::sendRoomExitsInfoToUser(std::ostream &os, const Room *const
                     // Sundeath exit flag modifiers
                     if (targetRoom->getSundeathType() == RoomSundeathEnum::SUNDEATH) {
                         directSun = true;
-                        etmp += sunCharacter;
+                        out += sunCharacter;
                     }
 
                     // Terrain type exit modifiers
@@ -1317,12 +1404,12 @@ void AbstractParser::sendRoomExitsInfoToUser(std::ostream &os, const Room *const
                         || targetTerrain == RoomTerrainEnum::UNDERWATER
                         || targetTerrain == RoomTerrainEnum::WATER) {
                         swim = true;
-                        etmp += "~";
+                        out += "~";
 
                     } else if (targetTerrain == RoomTerrainEnum::ROAD
                                && sourceTerrain == RoomTerrainEnum::ROAD) {
                         road = true;
-                        etmp += "=";
+                        out += "=";
                     }
                 }
             }
@@ -1330,57 +1417,58 @@ void AbstractParser::sendRoomExitsInfoToUser(std::ostream &os, const Room *const
             if (!road && e.exitIsRoad()) {
                 if (sourceTerrain == RoomTerrainEnum::ROAD) {
                     road = true;
-                    etmp += "=";
+                    out += "=";
                 } else {
                     trail = true;
-                    etmp += "-";
+                    out += "-";
                 }
             }
 
             if (e.isDoor()) {
                 door = true;
-                etmp += "{";
+                out += "{";
             } else if (e.exitIsClimb()) {
                 climb = true;
-                etmp += "|";
+                out += "|";
             }
 
-            etmp += lowercaseDirection(direction);
+            out += lowercaseDirection(direction);
         }
 
         if (door) {
-            etmp += "}";
+            out += "}";
         } else if (climb) {
-            etmp += "|";
+            out += "|";
         }
         if (swim) {
-            etmp += "~";
+            out += "~";
         } else if (road) {
-            etmp += "=";
+            out += "=";
         } else if (trail) {
-            etmp += "-";
+            out += "-";
         }
         if (directSun) {
-            etmp += sunCharacter;
+            out += sunCharacter;
         }
         if (exit) {
-            etmp += ",";
+            out += ",";
         }
     }
     if (exitCount == 0) {
-        etmp += " none.";
+        out += " none.";
     } else {
-        etmp.replace(etmp.length() - 1, 1, '.');
+        assert(out.size() > start && out.back() == ',');
+        out.back() = '.';
     }
 
-    QByteArray cn = enhanceExits(r);
-    os << ::toStdStringLatin1(etmp.toLatin1() + cn);
+    out += enhanceExits(r);
 
     if (getConfig().mumeNative.showNotes) {
         const auto &ns = r->getNote();
         if (!ns.isEmpty()) {
-            QByteArray note = "Note: " + ns.toQByteArray() + "\n";
-            os << ::toStdStringLatin1(note);
+            out += "Note: ";
+            out += ns.toQByteArray();
+            out += "\n";
         }
     }
 }
@@ -1429,10 +1517,10 @@ void AbstractParser::sendPromptToUser(const RoomLightEnum lightType,
 
 void AbstractParser::sendPromptToUser(const char light, const char terrain)
 {
+    QByteArray prompt;
     if (!m_compactMode) {
-        sendToUser("\n");
+        prompt += "\n";
     }
-    QByteArray prompt;
     prompt += light;
     prompt += terrain;
     prompt += ">";
@@ -1557,10 +1645,10 @@ void AbstractParser::printRoomInfo(const RoomFieldFlags fieldset)
             result += r->getName().toQByteArray() + "\n";
         }
         if (fieldset.contains(RoomFieldEnum::DESC)) {
-            result += r->getDescription().toQByteArray();
+            result += r->readDescription().toQByteArray();
         }
         if (fieldset.contains(RoomFieldEnum::CONTENTS)) {
-            result += r->getContents().toQByteArray();
+            result += r->readContents().toQByteArray();
         }
         if (fieldset.contains(RoomFieldEnum::NOTE)) {
             result += "Note: " + r->getNote().toQByteArray() + "\n";
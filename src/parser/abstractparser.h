@@ -19,11 +19,13 @@
 
 #include "../configuration/configuration.h"
 #include "../expandoracommon/parseevent.h"
+#include "../global/SlabAllocator.h"
 #include "../global/StringView.h"
 #include "../global/TextUtils.h"
 #include "../mapdata/DoorFlags.h"
 #include "../mapdata/ExitFieldVariant.h"
 #include "../mapdata/RoomFieldVariant.h"
+#include "../mapdata/ShortestPathService.h"
 #include "../mapdata/mmapper2room.h"
 #include "../mapdata/roomselection.h"
 #include "../pandoragroup/GroupManagerApi.h"
@@ -35,6 +37,7 @@
 #include "Action.h"
 #include "CommandId.h"
 #include "CommandQueue.h"
+#include "CommandTrie.h"
 #include "ConnectedRoomFlags.h"
 #include "DoorAction.h"
 #include "ExitsFlags.h"
@@ -81,10 +84,12 @@ class AbstractParser : public QObject
         ParserCallback callback;
         HelpCallback help;
     };
-    using ParserRecordMap = std::map<std::string, ParserRecord>;
+    using ParserRecordMap = std::map<std::string, ParserRecord, std::less<>>;
 
 private:
     ParserRecordMap m_specialCommandMap;
+    // Every key in the map, pointing at its record there.
+    CommandTrie<ParserRecord> m_specialCommandTrie;
     const char &prefixChar;
 
 private:
@@ -92,6 +97,8 @@ class AbstractParser : public QObject
 
 protected:
     QString m_exits = nullString;
+    // Reused for the exits sent after each room, so a move doesn't reallocate it.
+    QByteArray m_exitsOutput;
     ExitsFlagsType m_exitsFlags;
     PromptFlagsType m_promptFlags;
     ConnectedRoomFlagsType m_connectedRoomFlags;
@@ -104,9 +111,19 @@ class AbstractParser : public QObject
     bool m_overrideSendPrompt = false;
     CommandQueue m_queue;
     bool m_trollExitMapping = false;
+    // This session's parse events are recycled through it; the path machine
+    // only keeps a few at a time.
+    static constexpr const size_t EVENT_BLOCKS_PER_SLAB = 64;
+    std::shared_ptr<SlabArena> m_eventArena = std::make_shared<SlabArena>(EVENT_BLOCKS_PER_SLAB);
 
 private:
     QTimer m_offlineCommandTimer;
+    // Set while a whole prespammed path is walked at once; see slot_doOfflineCharacterMove().
+    bool m_batchingOfflineMoves = false;
+    bool m_batchedGoAhead = false;
+    QByteArray m_batchedOutput;
+    // Results of any other search are stale.
+    ShortestPathService::RequestId m_dirsRequest = 0;
 
 public:
     explicit AbstractParser(
@@ -155,16 +172,19 @@ public slots:
 
 protected slots:
     void slot_doOfflineCharacterMove();
+    void slot_onShortestPathFound(quint64 request, const ShortestPathResult &result);
+    void slot_onShortestPathSearchFinished(quint64 request, int numFound);
 
 protected:
     void offlineCharacterMove(CommandEnum direction);
     void offlineCharacterMove() { offlineCharacterMove(CommandEnum::UNKNOWN); }
+    void doOfflineCharacterStep();
     void sendRoomInfoToUser(const Room *);
     void sendPromptToUser(const Room &r);
     void sendPromptToUser(char light, char terrain);
     void sendPromptToUser(RoomLightEnum lightType, RoomTerrainEnum terrainType);
 
-    void sendRoomExitsInfoToUser(std::ostream &, const Room *r);
+    void sendRoomExitsInfoToUser(QByteArray &, const Room *r);
     void sendRoomExitsInfoToUser(const Room *r);
     NODISCARD Coordinate getNextPosition() const;
     NODISCARD Coordinate getTailPosition() const;
@@ -180,16 +200,18 @@ protected slots:
     void printRoomInfo(RoomFieldFlags fieldset);
     void printRoomInfo(RoomFieldEnum field);
 
-    void emulateExits(std::ostream &, CommandEnum move);
+    // These append to the output.
+    void emulateExits(QByteArray &, CommandEnum move);
     NODISCARD QByteArray enhanceExits(const Room *);
 
-    void parseExits(std::ostream &);
+    void parseExits(QByteArray &);
     void parsePrompt(const QString &prompt);
     NODISCARD bool parseUserCommands(const QString &command);
     NODISCARD static QString normalizeStringCopy(QString str);
 
     void searchCommand(const RoomFilter &f);
     void dirsCommand(const RoomFilter &f);
+    void dirsCommand(RoomId target);
 
     NODISCARD bool evalActionMap(StringView line);
 
@@ -260,6 +282,11 @@ protected slots:
 protected:
     inline void sendToUser(const QByteArray &arr, const bool goAhead)
     {
+        if (m_batchingOfflineMoves) {
+            m_batchedOutput.append(arr);
+            m_batchedGoAhead = goAhead;
+            return;
+        }
         emit sig_sendToUser(arr, goAhead);
     }
     void pathChanged() { emit sig_showPath(m_queue); }
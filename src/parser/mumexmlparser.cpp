@@ -5,15 +5,20 @@
 
 #include "mumexmlparser.h"
 
+#include <algorithm>
 #include <cctype>
-#include <sstream>
+#include <cstring>
 #include <utility>
 #include <QByteArray>
 #include <QString>
 
 #include "../configuration/configuration.h"
 #include "../expandoracommon/parseevent.h"
+#include "../global/EventTrace.h"
+#include "../global/LatencyTrace.h"
+#include "../global/PerfCounters.h"
 #include "../global/TextUtils.h"
+#include "../global/entities.h"
 #include "../pandoragroup/mmapper2group.h"
 #include "../proxy/GmcpMessage.h"
 #include "../proxy/telnetfilter.h"
@@ -49,6 +54,10 @@ MumeXmlParser::MumeXmlParser(MapData &md,
                              QObject *parent)
     : AbstractParser(md, mc, proxy, group, timers, parent)
 {
+    // With reserved capacity, resize(0) keeps the buffers between lines.
+    m_tempCharacters.reserve(1 << 10);
+    m_tempTag.reserve(1 << 8);
+
     if (XPS_DEBUG_TO_FILE) {
         QString fileName = "xmlparser_debug.dat";
 
@@ -70,6 +79,8 @@ MumeXmlParser::~MumeXmlParser()
 
 void MumeXmlParser::slot_parseNewMudInput(const TelnetData &data)
 {
+    event_trace::Scope scope{"MumeXmlParser::parse"};
+    latency_trace::mark(LatencyStageEnum::XML_PARSER);
     switch (data.type) {
     case TelnetDataEnum::DELAY: // Twiddlers
         if (XPS_DEBUG_TO_FILE) {
@@ -140,37 +151,48 @@ void MumeXmlParser::parse(const TelnetData &data, const bool isGoAhead)
     if (!m_lineFlags.isSnoop())
         m_snoopChar.reset();
 
-    for (const char c : line) {
+    // Tags and text are appended a whole span at a time; a tag can continue on the next line.
+    const char *pos = line.constData();
+    const char *const end = pos + line.size();
+    const auto find = [&pos, end](const char c) -> const char * {
+        return static_cast<const char *>(std::memchr(pos, c, static_cast<size_t>(end - pos)));
+    };
+    while (pos != end) {
         if (m_readingTag) {
-            if (c == '>') {
-                // send tag
-                if (!m_tempTag.isEmpty()) {
-                    MAYBE_UNUSED const auto ignored = //
-                        element(m_tempTag);
-                }
-
-                m_tempTag.clear();
+            const char *const gt = find('>');
+            if (gt == nullptr) {
+                m_tempTag.append(pos, static_cast<int>(end - pos));
+                break;
+            }
+            m_tempTag.append(pos, static_cast<int>(gt - pos));
+            pos = gt + 1;
 
-                m_readingTag = false;
-                continue;
+            // send tag
+            if (!m_tempTag.isEmpty()) {
+                MAYBE_UNUSED const auto ignored = //
+                    element(m_tempTag);
             }
-            m_tempTag.append(c);
+            m_tempTag.resize(0);
+            m_readingTag = false;
 
         } else {
-            if (c == '<') {
-                m_lineToUser.append(characters(m_tempCharacters));
-                m_tempCharacters.clear();
-
-                m_readingTag = true;
-                continue;
+            const char *const lt = find('<');
+            if (lt == nullptr) {
+                m_tempCharacters.append(pos, static_cast<int>(end - pos));
+                break;
             }
-            m_tempCharacters.append(c);
+            m_tempCharacters.append(pos, static_cast<int>(lt - pos));
+            pos = lt + 1;
+
+            m_lineToUser.append(characters(m_tempCharacters));
+            m_tempCharacters.resize(0);
+            m_readingTag = true;
         }
     }
 
     if (!m_readingTag) {
         m_lineToUser.append(characters(m_tempCharacters));
-        m_tempCharacters.clear();
+        m_tempCharacters.resize(0);
     }
     if (!m_lineToUser.isEmpty()) {
         sendToUser(m_lineToUser, isGoAhead);
@@ -191,81 +213,62 @@ void MumeXmlParser::parse(const TelnetData &data, const bool isGoAhead)
     }
 }
 
-bool MumeXmlParser::element(const QByteArray &line)
+auto MumeXmlParser::parseAttributes(const QByteArray &tag) -> XmlAttributes
 {
-    const int length = line.length();
+    // e.g. room terrain="field" or movement dir=north/
+    XmlAttributes attributes;
+    const std::string_view sv = ::toStdStringViewLatin1(tag);
+    const size_t size = sv.size();
+    const auto isSpace = [&sv](const size_t i) {
+        return std::isspace(static_cast<unsigned char>(sv[i])) != 0;
+    };
+    const auto skipSpaces = [&isSpace, size](size_t i) {
+        while (i < size && isSpace(i))
+            ++i;
+        return i;
+    };
 
-    // REVISIT: Merge this logic with the state machine in parse()
-    const auto attributes = [&line]() {
-        std::list<std::pair<std::string, std::string>> attributes;
-
-        std::ostringstream os;
-        std::optional<std::string> key;
-
-        XmlAttributeStateEnum state = XmlAttributeStateEnum::ELEMENT;
-        const auto makeAttribute = [&key, &os, &attributes, &state]() {
-            assert(key.has_value());
-            // REVISIT: Translate XML entities into text
-            attributes.emplace_back(make_pair(key.value(), os.str()));
-            key.reset();
-            os.str(std::string());
-            state = XmlAttributeStateEnum::ATTRIBUTE;
-        };
-        for (const auto &c : line) {
-            switch (state) {
-            case XmlAttributeStateEnum::ELEMENT:
-                if (std::isspace(c))
-                    state = XmlAttributeStateEnum::ATTRIBUTE;
-                else
-                    continue;
-                break;
-            case XmlAttributeStateEnum::ATTRIBUTE:
-                if (std::isspace(c))
-                    continue;
-                else if (c == '=') {
-                    key = os.str();
-                    os.str(std::string());
-                    state = XmlAttributeStateEnum::EQUALS;
-                } else
-                    os << c;
-                break;
-            case XmlAttributeStateEnum::EQUALS:
-                if (std::isspace(c))
-                    continue;
-                else if (c == '\'')
-                    state = XmlAttributeStateEnum::SINGLE_QUOTED_VALUE;
-                else if (c == '"')
-                    state = XmlAttributeStateEnum::DOUBLE_QUOTED_VALUE;
-                else {
-                    os << c;
-                    state = XmlAttributeStateEnum::UNQUOTED_VALUE;
-                }
-                break;
-            case XmlAttributeStateEnum::UNQUOTED_VALUE:
-                // Note: This format is not valid according to the W3C XML standard
-                if (std::isspace(c) || c == '/')
-                    makeAttribute();
-                else
-                    os << c;
-                break;
-            case XmlAttributeStateEnum::SINGLE_QUOTED_VALUE:
-                if (c == '\'')
-                    makeAttribute();
-                else
-                    os << c;
-                break;
-            case XmlAttributeStateEnum::DOUBLE_QUOTED_VALUE:
-                if (c == '"')
-                    makeAttribute();
-                else
-                    os << c;
-                break;
-            }
+    // skip the element name
+    size_t i = 0;
+    while (i < size && !isSpace(i))
+        ++i;
+
+    while ((i = skipSpaces(i)) < size) {
+        const size_t equals = sv.find('=', i);
+        if (equals == std::string_view::npos)
+            break;
+        size_t keyEnd = equals;
+        while (keyEnd > i && isSpace(keyEnd - 1))
+            --keyEnd;
+        const std::string_view key = sv.substr(i, keyEnd - i);
+
+        i = skipSpaces(equals + 1);
+        if (i == size) {
+            attributes.emplace_back(key, std::string_view{});
+            break;
         }
-        if (key.has_value())
-            makeAttribute();
-        return attributes;
-    }();
+
+        // REVISIT: Translate XML entities into text
+        const char quote = sv[i];
+        if (quote == '\'' || quote == '"') {
+            const size_t close = std::min(sv.find(quote, i + 1), size);
+            attributes.emplace_back(key, sv.substr(i + 1, close - i - 1));
+            i = close + 1;
+        } else {
+            // Note: This format is not valid according to the W3C XML standard
+            size_t valueEnd = i;
+            while (valueEnd < size && !isSpace(valueEnd) && sv[valueEnd] != '/')
+                ++valueEnd;
+            attributes.emplace_back(key, sv.substr(i, valueEnd - i));
+            i = valueEnd + 1;
+        }
+    }
+    return attributes;
+}
+
+bool MumeXmlParser::element(const QByteArray &line)
+{
+    const int length = line.length();
 
     switch (m_xmlMode) {
     case XmlModeEnum::NONE:
@@ -277,9 +280,9 @@ bool MumeXmlParser::element(const QByteArray &line)
                     if (m_descriptionReady) {
                         if (!m_exitsReady && getConfig().mumeNative.emulatedExits) {
                             m_exitsReady = true;
-                            std::ostringstream os;
-                            emulateExits(os, m_move);
-                            sendToUser(::toQByteArrayLatin1(snoopToUser(os.str())));
+                            m_exitsOutput.resize(0);
+                            emulateExits(m_exitsOutput, m_move);
+                            sendToUser(snoopToUser(m_exitsOutput));
                         }
                         m_promptFlags.reset(); // Don't trust god prompts
                         if (!m_queue.isEmpty() && m_move != CommandEnum::LOOK) // Remove follows
@@ -322,11 +325,9 @@ bool MumeXmlParser::element(const QByteArray &line)
             case 'r':
                 if (line.startsWith("room")) {
                     m_xmlMode = XmlModeEnum::ROOM;
-                    m_roomName = RoomName{}; // 'name' tag will not show up when blinded
+                    m_roomEvent.beginRoom();
                     m_descriptionReady = false;
                     m_exitsReady = false;
-                    m_roomDesc.reset();
-                    m_roomContents.reset();
                     m_terrain = RoomTerrainEnum::UNDEFINED;
                     m_exits = nullString;
                     m_promptFlags.reset();
@@ -334,7 +335,7 @@ bool MumeXmlParser::element(const QByteArray &line)
                     m_connectedRoomFlags.reset();
                     m_lineFlags.insert(LineFlagEnum::ROOM);
 
-                    for (const auto &pair : attributes) {
+                    for (const auto &pair : parseAttributes(line)) {
                         if (pair.first.empty() || pair.second.empty())
                             continue;
                         switch (pair.first.at(0)) {
@@ -408,6 +409,7 @@ bool MumeXmlParser::element(const QByteArray &line)
                         // We are most likely in a fall room where the prompt is not shown
                         move();
                     }
+                    const auto attributes = parseAttributes(line);
                     if (attributes.empty()) {
                         // movement/
                         m_move = CommandEnum::NONE;
@@ -501,7 +503,7 @@ bool MumeXmlParser::element(const QByteArray &line)
                 if (line.startsWith("description")) {
                     m_xmlMode = XmlModeEnum::DESCRIPTION;
                     // might be empty but valid description
-                    m_roomDesc = RoomDesc{""};
+                    m_roomEvent.beginDescription();
                     m_lineFlags.insert(LineFlagEnum::DESCRIPTION);
                 }
                 break;
@@ -553,9 +555,9 @@ bool MumeXmlParser::element(const QByteArray &line)
             switch (line.at(0)) {
             case '/':
                 if (line.startsWith("/exits")) {
-                    std::ostringstream os;
-                    parseExits(os);
-                    m_lineToUser.append(::toQByteArrayLatin1(snoopToUser(os.str())));
+                    m_exitsOutput.resize(0);
+                    parseExits(m_exitsOutput);
+                    m_lineToUser.append(snoopToUser(m_exitsOutput));
                     m_exitsReady = true;
                     m_lineFlags.remove(LineFlagEnum::EXITS);
                     if (m_lineFlags.contains(LineFlagEnum::ROOM))
@@ -597,9 +599,9 @@ bool MumeXmlParser::element(const QByteArray &line)
                     if (m_descriptionReady) {
                         if (!m_exitsReady && config.mumeNative.emulatedExits) {
                             m_exitsReady = true;
-                            std::ostringstream os;
-                            emulateExits(os, m_move);
-                            sendToUser(::toQByteArrayLatin1(snoopToUser(os.str())));
+                            m_exitsOutput.resize(0);
+                            emulateExits(m_exitsOutput, m_move);
+                            sendToUser(snoopToUser(m_exitsOutput));
                         }
                         move();
                     }
@@ -658,9 +660,7 @@ bool MumeXmlParser::element(const QByteArray &line)
 
 void MumeXmlParser::stripXmlEntities(QByteArray &ch)
 {
-    ch.replace(greaterThanTemplate, greaterThanChar);
-    ch.replace(lessThanTemplate, lessThanChar);
-    ch.replace(ampersandTemplate, ampersand);
+    entities::decodeLatin1InPlace(ch);
 }
 
 QByteArray MumeXmlParser::characters(QByteArray &ch)
@@ -703,9 +703,9 @@ QByteArray MumeXmlParser::characters(QByteArray &ch)
         if (m_stringBuffer.isEmpty()) { // standard end of description parsed
             if (m_descriptionReady && !m_exitsReady && config.mumeNative.emulatedExits) {
                 m_exitsReady = true;
-                std::ostringstream os;
-                emulateExits(os, m_move);
-                sendToUser(::toQByteArrayLatin1(snoopToUser(os.str())));
+                m_exitsOutput.resize(0);
+                emulateExits(m_exitsOutput, m_move);
+                sendToUser(snoopToUser(m_exitsOutput));
             }
         } else {
             m_lineFlags.insert(LineFlagEnum::NONE);
@@ -714,22 +714,20 @@ QByteArray MumeXmlParser::characters(QByteArray &ch)
         break;
 
     case XmlModeEnum::ROOM: // dynamic line
-        if (!m_descriptionReady && m_roomDesc.has_value()) {
-            m_roomContents = RoomContents{m_roomContents.value_or(RoomContents{}).toQString()
-                                          + normalizeStringCopy(m_stringBuffer)};
+        if (!m_descriptionReady && m_roomEvent.hasDescription()) {
+            m_roomEvent.appendContents(normalizeStringCopy(m_stringBuffer));
         }
         toUser.append(ch);
         break;
 
     case XmlModeEnum::NAME:
-        m_roomName = RoomName{normalizeStringCopy(m_stringBuffer)};
+        m_roomEvent.setName(normalizeStringCopy(m_stringBuffer));
         toUser.append(ch);
         break;
 
     case XmlModeEnum::DESCRIPTION: // static line
         if (!m_descriptionReady) {
-            m_roomDesc = RoomDesc{m_roomDesc.value_or(RoomDesc{}).toQString()
-                                  + normalizeStringCopy(m_stringBuffer)};
+            m_roomEvent.appendDescription(normalizeStringCopy(m_stringBuffer));
         }
         if (!m_gratuitous) {
             toUser.append(ch);
@@ -754,7 +752,8 @@ QByteArray MumeXmlParser::characters(QByteArray &ch)
         break;
     }
 
-    if (!getConfig().parser.removeXmlTags) {
+    if (!getConfig().parser.removeXmlTags
+        && (toUser.contains('&') || toUser.contains('>') || toUser.contains('<'))) {
         toUser.replace(ampersand, ampersandTemplate);
         toUser.replace(greaterThanChar, greaterThanTemplate);
         toUser.replace(lessThanChar, lessThanTemplate);
@@ -766,25 +765,21 @@ void MumeXmlParser::move()
 {
     m_descriptionReady = false;
 
-    if (!m_roomName.has_value() || // blindness
-        Patterns::matchNoDescriptionPatterns(
-            m_roomName.value()
-                .toQString())) { // non standard end of description parsed (fog, dark or so ...)
-        m_roomName.reset();
-        m_roomDesc.reset();
-        m_roomContents.reset();
+    // blindness, or a non standard end of description parsed (fog, dark or so ...)
+    if (!m_roomEvent.hasName()
+        || Patterns::matchNoDescriptionPatterns(::toQStringLatin1(m_roomEvent.getName()))) {
+        m_roomEvent.discardRoomText();
     }
 
     const auto emitEvent = [this]() {
-        auto ev = ParseEvent::createEvent(m_move,
-                                          m_roomName.value_or(RoomName{}),
-                                          m_roomDesc.value_or(RoomDesc{}),
-                                          m_roomContents.value_or(RoomContents{}),
-                                          m_terrain,
-                                          m_exitsFlags,
-                                          m_promptFlags,
-                                          m_connectedRoomFlags);
-        emit sig_handleParseEvent(SigParseEvent{ev});
+        auto ev = m_roomEvent.build(m_move,
+                                    m_terrain,
+                                    m_exitsFlags,
+                                    m_promptFlags,
+                                    m_connectedRoomFlags,
+                                    m_eventArena);
+        perf_counters::add(PerfCounterEnum::PARSE_EVENTS);
+        emit sig_handleParseEvent(SigParseEvent{std::move(ev)});
     };
 
     if (m_queue.isEmpty()) {
@@ -811,18 +806,25 @@ void MumeXmlParser::parseMudCommands(const QString &str)
         return;
 }
 
-std::string MumeXmlParser::snoopToUser(const std::string_view str)
+QByteArray MumeXmlParser::snoopToUser(const QByteArray &str)
 {
-    std::ostringstream os;
-    bool snoopPrefix = m_snoopChar.has_value();
+    if (!m_snoopChar.has_value())
+        return str;
+
+    const char snoopChar = m_snoopChar.value();
+    QByteArray result;
+    result.reserve(str.size() + 3 * (str.count('\n') + 1));
+    bool snoopPrefix = true;
     for (const char c : str) {
         if (snoopPrefix) {
-            os << '&' << m_snoopChar.value() << ' ';
+            result += '&';
+            result += snoopChar;
+            result += ' ';
             snoopPrefix = false;
         }
-        os << c;
-        if (c == '\n' && m_snoopChar.has_value())
+        result += c;
+        if (c == '\n')
             snoopPrefix = true;
     }
-    return os.str();
+    return result;
 }
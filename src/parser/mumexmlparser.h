@@ -7,6 +7,8 @@
 
 #include <optional>
 #include <string_view>
+#include <utility>
+#include <vector>
 #include <QByteArray>
 #include <QString>
 #include <QtCore/QFile>
@@ -15,6 +17,7 @@
 
 #include "CommandId.h"
 #include "LineFlags.h"
+#include "RoomEventBuilder.h"
 #include "abstractparser.h"
 
 class GmcpMessage;
@@ -61,26 +64,11 @@ class MumeXmlParser final : public AbstractParser
     bool m_exitsReady = false;
     bool m_descriptionReady = false;
 
-    // REVISIT: Is there any point to having a distinction between null and empty?
-    std::optional<RoomName> m_roomName;
-    std::optional<RoomDesc> m_roomDesc;
-    std::optional<RoomContents> m_roomContents;
+    RoomEventBuilder m_roomEvent;
 
 private:
-    enum class NODISCARD XmlAttributeStateEnum : uint8_t {
-        /// received <room/>
-        ELEMENT,
-        /// received <room terrain/>
-        ATTRIBUTE,
-        /// received <room terrain=/>
-        EQUALS,
-        /// received <room terrain=field/>
-        UNQUOTED_VALUE,
-        /// received <room terrain='field'/>
-        SINGLE_QUOTED_VALUE,
-        /// received <room terrain="field"/>
-        DOUBLE_QUOTED_VALUE
-    };
+    // Views into the tag they were parsed from.
+    using XmlAttributes = std::vector<std::pair<std::string_view, std::string_view>>;
 
 public:
     explicit MumeXmlParser(
@@ -98,8 +86,9 @@ class MumeXmlParser final : public AbstractParser
     void parseMudCommands(const QString &str);
     NODISCARD QByteArray characters(QByteArray &ch);
     NODISCARD bool element(const QByteArray &);
+    NODISCARD static XmlAttributes parseAttributes(const QByteArray &tag);
     void move();
-    NODISCARD std::string snoopToUser(const std::string_view str);
+    NODISCARD QByteArray snoopToUser(const QByteArray &str);
 
 private:
     static void stripXmlEntities(QByteArray &ch);
@@ -13,6 +13,8 @@
 #include <QRegularExpression>
 #include <QtCore>
 
+#include "../global/Charset.h"
+
 namespace ParserUtils {
 static constexpr const size_t IDX_NBSP = 160;
 static constexpr const char LATIN1_UNDEFINED = 'z';
@@ -84,7 +86,9 @@ QString &toAsciiInPlace(QString &str)
 
 std::string &latin1ToAsciiInPlace(std::string &str)
 {
-    for (char &c : str) {
+    const size_t size = str.size();
+    for (size_t i = getAsciiPrefixLength(str); i < size; ++i) {
+        char &c = str[i];
         if (!isAscii(c)) {
             c = latin1ToAscii(c);
         }
@@ -99,10 +103,18 @@ std::string latin1ToAscii(const std::string_view sv)
     return tmp;
 }
 
-void latin1ToAscii(std::ostream &os, const std::string_view sv)
+void latin1ToAscii(std::ostream &os, std::string_view sv)
 {
-    for (const char c : sv) {
-        os << latin1ToAscii(c);
+    while (!sv.empty()) {
+        const size_t ascii = getAsciiPrefixLength(sv);
+        if (ascii != 0) {
+            os.write(sv.data(), static_cast<std::streamsize>(ascii));
+            sv.remove_prefix(ascii);
+        }
+        if (!sv.empty()) {
+            os << latin1ToAscii(sv.front());
+            sv.remove_prefix(1);
+        }
     }
 }
 
@@ -5,39 +5,221 @@
 
 #include "patterns.h"
 
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
 #include <QRegularExpression>
+#include <QSet>
+#include <QStringList>
+#include <QStringView>
 
 #include "../configuration/configuration.h"
 
+namespace { // anonymous
+
+// Trie over UTF-16 code units; with failure links it doubles as an Aho-Corasick automaton.
+class NODISCARD PatternTrie final
+{
+private:
+    struct NODISCARD Node final
+    {
+        std::map<char16_t, size_t> next;
+        size_t fail = 0;
+        // Some pattern ends here (or, after buildFailLinks(), at one of its suffixes).
+        bool terminal = false;
+    };
+    std::vector<Node> m_nodes{1};
+
+public:
+    template<typename It>
+    void insert(It it, const It end)
+    {
+        size_t node = 0;
+        for (; it != end; ++it) {
+            const char16_t c = it->unicode();
+            const auto found = m_nodes[node].next.find(c);
+            if (found != m_nodes[node].next.end()) {
+                node = found->second;
+                continue;
+            }
+            const size_t child = m_nodes.size();
+            m_nodes.emplace_back();
+            m_nodes[node].next.emplace(c, child);
+            node = child;
+        }
+        m_nodes[node].terminal = true;
+    }
+
+    // True if some pattern is a prefix of [it, end).
+    template<typename It>
+    NODISCARD bool matchesPrefix(It it, const It end) const
+    {
+        size_t node = 0;
+        for (;; ++it) {
+            if (m_nodes[node].terminal)
+                return true;
+            if (it == end)
+                return false;
+            const auto found = m_nodes[node].next.find(it->unicode());
+            if (found == m_nodes[node].next.end())
+                return false;
+            node = found->second;
+        }
+    }
+
+    void buildFailLinks()
+    {
+        std::deque<size_t> queue;
+        for (const auto &kv : m_nodes[0].next) {
+            m_nodes[kv.second].fail = 0;
+            queue.emplace_back(kv.second);
+        }
+        while (!queue.empty()) {
+            const size_t node = queue.front();
+            queue.pop_front();
+            for (const auto &kv : m_nodes[node].next) {
+                const size_t child = kv.second;
+                m_nodes[child].fail = transition(m_nodes[node].fail, kv.first);
+                m_nodes[child].terminal |= m_nodes[m_nodes[child].fail].terminal;
+                queue.emplace_back(child);
+            }
+        }
+    }
+
+    // True if any pattern occurs anywhere in str; requires buildFailLinks().
+    NODISCARD bool matchesAnywhere(const QStringView str) const
+    {
+        size_t node = 0;
+        if (m_nodes[node].terminal)
+            return true;
+        for (const QChar qc : str) {
+            node = transition(node, qc.unicode());
+            if (m_nodes[node].terminal)
+                return true;
+        }
+        return false;
+    }
+
+private:
+    NODISCARD size_t transition(size_t node, const char16_t c) const
+    {
+        for (;;) {
+            const auto found = m_nodes[node].next.find(c);
+            if (found != m_nodes[node].next.end())
+                return found->second;
+            if (node == 0)
+                return 0;
+            node = m_nodes[node].fail;
+        }
+    }
+};
+
+// All of the patterns of a list, so a string is checked against all of them at once.
+class NODISCARD CompiledPatterns final
+{
+private:
+    PatternTrie m_prefixes;
+    // Holds the reversed suffixes.
+    PatternTrie m_suffixes;
+    PatternTrie m_substrings;
+    QSet<QString> m_exact;
+    std::vector<QRegularExpression> m_regexes;
+
+public:
+    explicit CompiledPatterns(const QStringList &patterns)
+    {
+        for (const QString &pattern : patterns) {
+            if (pattern.length() < 2 || pattern.at(0) != '#')
+                continue;
+            const QStringView text = QStringView{pattern}.mid(2);
+            switch (pattern.at(1).toLatin1()) {
+            case '!':
+                m_regexes.emplace_back(text.toString());
+                m_regexes.back().optimize();
+                break;
+            case '<':
+                m_prefixes.insert(text.begin(), text.end());
+                break;
+            case '=':
+                m_exact.insert(text.toString());
+                break;
+            case '>':
+                m_suffixes.insert(text.rbegin(), text.rend());
+                break;
+            case '?':
+                m_substrings.insert(text.begin(), text.end());
+                break;
+            default:
+                break;
+            }
+        }
+        m_substrings.buildFailLinks();
+    }
+
+public:
+    NODISCARD bool matches(const QString &str) const
+    {
+        const QStringView sv{str};
+        if (m_exact.contains(str) || m_prefixes.matchesPrefix(sv.begin(), sv.end())
+            || m_suffixes.matchesPrefix(sv.rbegin(), sv.rend()) || m_substrings.matchesAnywhere(sv))
+            return true;
+        for (const QRegularExpression &regex : m_regexes) {
+            if (regex.match(str).hasMatch())
+                return true;
+        }
+        return false;
+    }
+};
+
+// Rebuilt only when the list changes; comparing an unchanged (shared) list is cheap.
+NODISCARD std::shared_ptr<const CompiledPatterns> getCompiledPatterns(const QStringList &patterns)
+{
+    static std::mutex g_mutex;
+    static QStringList g_patterns;
+    static std::shared_ptr<const CompiledPatterns> g_compiled;
+
+    std::lock_guard<std::mutex> lock{g_mutex};
+    if (g_compiled == nullptr || g_patterns != patterns) {
+        g_patterns = patterns;
+        g_compiled = std::make_shared<const CompiledPatterns>(patterns);
+    }
+    return g_compiled;
+}
+
+} // namespace
+
 bool Patterns::matchPattern(const QString &pattern, const QString &str)
 {
     if (pattern.at(0) != '#') {
         return false;
     }
 
+    const QStringView text = QStringView{pattern}.mid(2);
     switch (static_cast<int>((pattern.at(1)).toLatin1())) {
     case 33: // !
-        if (QRegularExpression(pattern.mid(2)).match(str).hasMatch()) {
+        if (QRegularExpression(text.toString()).match(str).hasMatch()) {
             return true;
         }
         break;
     case 60:; // <
-        if (str.startsWith(pattern.mid(2))) {
+        if (str.startsWith(text)) {
             return true;
         }
         break;
     case 61:; // =
-        if (str == (pattern.mid(2))) {
+        if (str == text) {
             return true;
         }
         break;
     case 62:; // >
-        if (str.endsWith(pattern.mid(2))) {
+        if (str.endsWith(text)) {
             return true;
         }
         break;
     case 63:; // ?
-        if (str.contains(pattern.mid(2))) {
+        if (str.contains(text)) {
             return true;
         }
         break;
@@ -48,10 +230,5 @@ bool Patterns::matchPattern(const QString &pattern, const QString &str)
 
 bool Patterns::matchNoDescriptionPatterns(const QString &str)
 {
-    for (const QString &pattern : getConfig().parser.noDescriptionPatternsList) {
-        if (matchPattern(pattern, str)) {
-            return true;
-        }
-    }
-    return false;
+    return getCompiledPatterns(getConfig().parser.noDescriptionPatternsList)->matches(str);
 }
@@ -0,0 +1,115 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "PathStats.h"
+
+#include <cassert>
+#include <initializer_list>
+#include <sstream>
+
+const char *getPathStateName(const PathStateEnum state)
+{
+#define CASE(x) \
+    do { \
+    case PathStateEnum::x: \
+        return #x; \
+    } while (0)
+    switch (state) {
+        CASE(APPROVED);
+        CASE(EXPERIMENTING);
+        CASE(SYNCING);
+    }
+#undef CASE
+    assert(false);
+    return "UNKNOWN";
+}
+
+static constexpr const auto ALL_PATH_STATES = {PathStateEnum::APPROVED,
+                                               PathStateEnum::EXPERIMENTING,
+                                               PathStateEnum::SYNCING};
+
+uint64_t PathStats::Values::getNumEvents() const
+{
+    uint64_t total = 0;
+    for (const auto n : eventsByState) {
+        total += n;
+    }
+    return total;
+}
+
+std::string PathStats::Values::toString() const
+{
+    const auto usec = [](const std::chrono::nanoseconds ns) {
+        return static_cast<double>(ns.count()) / 1000.0;
+    };
+    const uint64_t events = getNumEvents();
+
+    std::ostringstream os;
+    os << "Path machine statistics:\n";
+    os << "  events: " << events << " (";
+    bool first = true;
+    for (const PathStateEnum state : ALL_PATH_STATES) {
+        os << (first ? "" : ", ") << getPathStateName(state) << ": " << eventsByState[state];
+        first = false;
+    }
+    os << ")\n";
+    os << "  forks: " << forks << ", denies: " << denies << "\n";
+    os << "  paths: " << livePaths << " live, " << peakPaths << " peak\n";
+    os << "  lookups: " << lookups << " ("
+       << (events == 0 ? 0.0 : static_cast<double>(lookups) / static_cast<double>(events))
+       << " per event, " << maxLookupsPerEvent << " max)\n";
+    os << "  evaluatePaths: " << evaluations << " calls, " << usec(evaluateTime) << " us total, "
+       << usec(maxEvaluateTime) << " us max\n";
+    os << "  prefetch: " << prefetchedRooms << " rooms, " << prefetchHits << " hits\n";
+    return os.str();
+}
+
+void PathStats::onEvaluated(const std::chrono::nanoseconds elapsed)
+{
+    const auto nanos = static_cast<uint64_t>(elapsed.count());
+    add(m_evaluations);
+    add(m_evaluateNanos, nanos);
+    raise(m_maxEvaluateNanos, nanos);
+}
+
+PathStats::Values PathStats::getValues() const
+{
+    static constexpr const auto relaxed = std::memory_order_relaxed;
+    Values result;
+    for (const PathStateEnum state : ALL_PATH_STATES) {
+        result.eventsByState[state] = m_eventsByState[state].load(relaxed);
+    }
+    result.forks = m_forks.load(relaxed);
+    result.denies = m_denies.load(relaxed);
+    result.lookups = m_lookups.load(relaxed);
+    result.maxLookupsPerEvent = m_maxLookupsPerEvent.load(relaxed);
+    result.livePaths = m_livePaths.load(relaxed);
+    result.peakPaths = m_peakPaths.load(relaxed);
+    result.evaluations = m_evaluations.load(relaxed);
+    result.prefetchedRooms = m_prefetchedRooms.load(relaxed);
+    result.prefetchHits = m_prefetchHits.load(relaxed);
+    result.evaluateTime = std::chrono::nanoseconds{m_evaluateNanos.load(relaxed)};
+    result.maxEvaluateTime = std::chrono::nanoseconds{m_maxEvaluateNanos.load(relaxed)};
+    return result;
+}
+
+void PathStats::reset()
+{
+    // NOTE: Also called from other threads; a concurrent update may survive the reset.
+    static constexpr const auto relaxed = std::memory_order_relaxed;
+    for (auto &counter : m_eventsByState) {
+        counter.store(0, relaxed);
+    }
+    for (Counter *const counter : {&m_forks,
+                                   &m_denies,
+                                   &m_lookups,
+                                   &m_maxLookupsPerEvent,
+                                   &m_peakPaths,
+                                   &m_evaluations,
+                                   &m_prefetchedRooms,
+                                   &m_prefetchHits,
+                                   &m_evaluateNanos,
+                                   &m_maxEvaluateNanos}) {
+        counter->store(0, relaxed);
+    }
+}
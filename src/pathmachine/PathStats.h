@@ -0,0 +1,109 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "../global/EnumIndexedArray.h"
+#include "../global/RuleOf5.h"
+#include "../global/macros.h"
+
+enum class NODISCARD PathStateEnum { APPROVED = 0, EXPERIMENTING = 1, SYNCING = 2 };
+static constexpr const size_t NUM_PATH_STATES = 3;
+DEFINE_ENUM_COUNT(PathStateEnum, NUM_PATH_STATES)
+
+NODISCARD const char *getPathStateName(PathStateEnum state);
+
+/**
+ * Counters describing what the PathMachine has been doing.
+ *
+ * Only the PathMachine's thread updates them, with relaxed atomics, so they
+ * cost next to nothing and can be read from any thread (e.g. the parser's).
+ */
+class NODISCARD PathStats final
+{
+public:
+    using Counter = std::atomic<uint64_t>;
+
+    // A plain copy of the counters at one point in time.
+    struct NODISCARD Values final
+    {
+        EnumIndexedArray<uint64_t, PathStateEnum> eventsByState{};
+        uint64_t forks = 0;
+        uint64_t denies = 0;
+        uint64_t lookups = 0;
+        uint64_t maxLookupsPerEvent = 0;
+        uint64_t livePaths = 0;
+        uint64_t peakPaths = 0;
+        uint64_t evaluations = 0;
+        uint64_t prefetchedRooms = 0;
+        uint64_t prefetchHits = 0;
+        std::chrono::nanoseconds evaluateTime{};
+        std::chrono::nanoseconds maxEvaluateTime{};
+
+        NODISCARD uint64_t getNumEvents() const;
+        NODISCARD std::string toString() const;
+    };
+
+private:
+    EnumIndexedArray<Counter, PathStateEnum> m_eventsByState{};
+    Counter m_forks{0};
+    Counter m_denies{0};
+    Counter m_lookups{0};
+    Counter m_maxLookupsPerEvent{0};
+    Counter m_livePaths{0};
+    Counter m_peakPaths{0};
+    Counter m_evaluations{0};
+    Counter m_prefetchedRooms{0};
+    Counter m_prefetchHits{0};
+    Counter m_evaluateNanos{0};
+    Counter m_maxEvaluateNanos{0};
+    // Not reported; only used to compute m_maxLookupsPerEvent.
+    uint64_t m_eventLookups = 0;
+
+public:
+    PathStats() = default;
+    ~PathStats() = default;
+    DELETE_CTORS_AND_ASSIGN_OPS(PathStats);
+
+private:
+    static void add(Counter &counter, const uint64_t n = 1u)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+    static void raise(Counter &counter, const uint64_t value)
+    {
+        if (value > counter.load(std::memory_order_relaxed))
+            counter.store(value, std::memory_order_relaxed);
+    }
+
+public:
+    void onEvent(const PathStateEnum state)
+    {
+        add(m_eventsByState[state]);
+        m_eventLookups = 0;
+    }
+    void onFork() { add(m_forks); }
+    void onDeny() { add(m_denies); }
+    void onLookup()
+    {
+        add(m_lookups);
+        raise(m_maxLookupsPerEvent, ++m_eventLookups);
+    }
+    void onEvaluated(std::chrono::nanoseconds elapsed);
+    void onPrefetch(const size_t rooms) { add(m_prefetchedRooms, rooms); }
+    void onPrefetchHit() { add(m_prefetchHits); }
+    void setLivePaths(const size_t livePaths)
+    {
+        m_livePaths.store(livePaths, std::memory_order_relaxed);
+        raise(m_peakPaths, livePaths);
+    }
+
+public:
+    NODISCARD Values getValues() const;
+    void reset();
+};
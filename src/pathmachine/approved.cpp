@@ -30,6 +30,14 @@ void Approved::virt_receiveRoom(RoomAdmin *const sender, const Room *const perha
     auto &event = myEvent.deref();
 
     const auto id = perhaps->getId();
+    if (ahead.has_value()) {
+        const Coordinate offset = perhaps->getPosition() - ahead->origin;
+        const Coordinate &dir = ahead->dir;
+        if (offset.x * dir.x + offset.y * dir.y + offset.z * dir.z <= 0) {
+            sender->releaseRoom(*this, id);
+            return;
+        }
+    }
     const auto cmp = [this, &event, &id, &perhaps]() {
         // Cache comparisons because we regularly call releaseMatch() and try the same rooms again
         auto it = compareCache.find(id);
@@ -4,9 +4,11 @@
 // Author: Ulf Hermann <ulfonk_mennhar@gmx.de> (Alve)
 // Author: Marek Krejza <krejza@gmail.com> (Caligor)
 
+#include <optional>
 #include <unordered_map>
 
 #include "../expandoracommon/RoomRecipient.h"
+#include "../expandoracommon/coordinate.h"
 #include "../expandoracommon/parseevent.h"
 #include "../expandoracommon/room.h"
 #include "../global/RuleOf5.h"
@@ -19,10 +21,18 @@ class RoomAdmin;
 class NODISCARD Approved final : public RoomRecipient
 {
 private:
+    // Only rooms past `origin` in direction `dir` may match.
+    struct NODISCARD Ahead final
+    {
+        Coordinate origin;
+        Coordinate dir;
+    };
+
     SigParseEvent myEvent;
     std::unordered_map<RoomId, ComparisonResultEnum> compareCache;
     const Room *matchedRoom = nullptr;
     RoomAdmin *owner = nullptr;
+    std::optional<Ahead> ahead;
     const int matchingTolerance;
     bool moreThanOne = false;
     bool update = false;
@@ -42,4 +52,11 @@ class NODISCARD Approved final : public RoomRecipient
     NODISCARD const Room *oneMatch() const;
     NODISCARD bool needsUpdate() const { return update; }
     void releaseMatch();
+    // Ignores the rooms that aren't further along `dir` than `origin`, such as
+    // the one the move started from and its neighbours.
+    void requireAhead(const Coordinate &origin, const Coordinate &dir)
+    {
+        ahead = Ahead{origin, dir};
+    }
+    void clearRequireAhead() { ahead.reset(); }
 };
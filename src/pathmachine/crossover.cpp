@@ -26,6 +26,6 @@ void Crossover::virt_receiveRoom(RoomAdmin *const admin, const Room *const room)
         admin->releaseRoom(*this, room->getId());
 
     for (auto &shortPath : *shortPaths) {
-        augmentPath(shortPath, admin, room);
+        considerRoom(shortPath, admin, room);
     }
 }
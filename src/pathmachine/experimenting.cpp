@@ -5,9 +5,17 @@
 
 #include "experimenting.h"
 
+#include <algorithm>
+#include <cassert>
+#include <cmath>
 #include <memory>
+#include <utility>
+#include <vector>
 
+#include "../expandoracommon/RoomAdmin.h"
 #include "../expandoracommon/room.h"
+#include "../global/parallel.h"
+#include "../global/utils.h"
 #include "path.h"
 #include "pathparameters.h"
 
@@ -28,15 +36,93 @@ void Experimenting::augmentPath(const std::shared_ptr<Path> &path,
                                 const Room *const room)
 {
     const Coordinate c = path->getRoom()->getPosition() + direction;
-    const auto working = path->fork(room, c, map, params, this, dirCode);
+    addFork(path->fork(room, c, map, params, this, dirCode));
+}
+
+void Experimenting::considerRoom(const std::shared_ptr<Path> &path,
+                                 RoomAdmin *const map,
+                                 const Room *const room,
+                                 const ParseEvent *const mustMatch)
+{
+    if (params.parallelEvaluationThreshold != 0u) {
+        m_candidates.emplace_back(Candidate{path, map, room, mustMatch});
+        return;
+    }
+
+    if (mustMatch != nullptr
+        && Room::compare(room, *mustMatch, params.matchingTolerance)
+               != ComparisonResultEnum::EQUAL) {
+        virt_rejectRoom(map, room);
+        return;
+    }
+    augmentPath(path, map, room);
+}
+
+void Experimenting::scoreCandidate(Candidate &candidate) const
+{
+    // NOTE: Runs on worker threads while evaluateCandidates() holds the map
+    // shared; it must only read the rooms and the event.
+    const Room &from = deref(candidate.path->getRoom());
+    const Room &to = deref(candidate.room);
+    if (candidate.mustMatch != nullptr) {
+        candidate.matches = Room::compare(&to, *candidate.mustMatch, params.matchingTolerance)
+                            == ComparisonResultEnum::EQUAL;
+    }
+    if (candidate.matches) {
+        const Coordinate c = from.getPosition() + direction;
+        candidate.distance = Path::getForkDistance(from, to, c, params, dirCode);
+    }
+}
+
+void Experimenting::evaluateCandidates()
+{
+    if (m_candidates.empty())
+        return;
+
+    auto candidates = std::exchange(m_candidates, {});
+    const auto score = [this, &candidates](const size_t i) { scoreCandidate(candidates[i]); };
+    // Every candidate comes from the same map; holding it keeps edits (and
+    // room updates) out until the scores are in.
+    RoomAdmin &map = deref(candidates.front().map);
+    assert(std::all_of(candidates.begin(), candidates.end(), [&map](const Candidate &c) {
+        return c.map == &map;
+    }));
+    map.readLocked([this, &candidates, &score]() {
+        if (candidates.size() >= params.parallelEvaluationThreshold) {
+            parallelFor(candidates.size(), score);
+        } else {
+            for (size_t i = 0; i < candidates.size(); ++i) {
+                score(i);
+            }
+        }
+    });
+
+    // Forks are created here, in the order the rooms arrived, so the result
+    // is the same as evaluating each room as soon as it was received.
+    for (const Candidate &candidate : candidates) {
+        if (!candidate.matches) {
+            virt_rejectRoom(candidate.map, candidate.room);
+            continue;
+        }
+        addFork(candidate.path->fork(candidate.room,
+                                     candidate.map,
+                                     params,
+                                     this,
+                                     dirCode,
+                                     candidate.distance));
+    }
+}
+
+void Experimenting::addFork(const std::shared_ptr<Path> &working)
+{
     if (best == nullptr) {
         best = working;
-    } else if (working->getProb() > best->getProb()) {
+    } else if (working->getLogProb() > best->getLogProb()) {
         paths->push_back(best);
         second = best;
         best = working;
     } else {
-        if (second == nullptr || working->getProb() > second->getProb()) {
+        if (second == nullptr || working->getLogProb() > second->getLogProb()) {
             second = working;
         }
         paths->push_back(working);
@@ -46,6 +132,8 @@ void Experimenting::augmentPath(const std::shared_ptr<Path> &path,
 
 std::shared_ptr<PathList> Experimenting::evaluate()
 {
+    evaluateCandidates();
+
     for (std::shared_ptr<Path> working = nullptr; !shortPaths->empty();) {
         working = shortPaths->front();
         shortPaths->pop_front();
@@ -55,7 +143,10 @@ std::shared_ptr<PathList> Experimenting::evaluate()
     }
 
     if (best != nullptr) {
-        if (second == nullptr || best->getProb() > second->getProb() * params.acceptBestRelative
+        // The absolute test only makes sense in linear space; once the
+        // probabilities are tiny it simply stops firing, as it always did.
+        if (second == nullptr
+            || best->getLogProb() > second->getLogProb() + std::log(params.acceptBestRelative)
             || best->getProb() > second->getProb() + params.acceptBestAbsolute) {
             for (auto &path : *paths) {
                 path->deny();
@@ -65,14 +156,16 @@ std::shared_ptr<PathList> Experimenting::evaluate()
         } else {
             paths->push_back(best);
 
+            // best > working * maxPaths / numPaths, in log space.
+            const double pruneBelow = best->getLogProb() - std::log(params.maxPaths / numPaths);
             for (std::shared_ptr<Path> working = paths->front(); working != best;) {
                 paths->pop_front();
                 // throw away if the probability is very low or not
                 // distinguishable from best. Don't keep paths with equal
                 // probability at the front, for we need to find a unique
                 // best path eventually.
-                if (best->getProb() > working->getProb() * params.maxPaths / numPaths
-                    || (best->getProb() <= working->getProb()
+                if (working->getLogProb() < pruneBelow
+                    || (best->getLogProb() <= working->getLogProb()
                         && best->getRoom() == working->getRoom())) {
                     working->deny();
                 } else {
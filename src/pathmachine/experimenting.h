@@ -5,6 +5,7 @@
 // Author: Marek Krejza <krejza@gmail.com> (Caligor)
 
 #include <memory>
+#include <vector>
 #include <QtGlobal>
 
 #include "../expandoracommon/RoomRecipient.h"
@@ -14,6 +15,7 @@
 #include "../mapdata/mmapper2exit.h"
 #include "path.h"
 
+class ParseEvent;
 class PathMachine;
 class Room;
 class RoomAdmin;
@@ -22,8 +24,37 @@ struct PathParameters;
 // Base class for Crossover and OneByOne
 class NODISCARD Experimenting : public RoomRecipient
 {
+private:
+    struct NODISCARD Candidate final
+    {
+        std::shared_ptr<Path> path;
+        RoomAdmin *map = nullptr;
+        const Room *room = nullptr;
+        const ParseEvent *mustMatch = nullptr;
+        bool matches = true;
+        double distance = 0.0;
+    };
+    // Rooms waiting to be scored by evaluate(); only used for parallel evaluation.
+    std::vector<Candidate> m_candidates;
+
+    void scoreCandidate(Candidate &candidate) const;
+    void evaluateCandidates();
+    void addFork(const std::shared_ptr<Path> &working);
+
+    // Called for each room that failed the mustMatch test in considerRoom().
+    virtual void virt_rejectRoom(RoomAdmin * /*map*/, const Room * /*room*/) {}
+
 protected:
     void augmentPath(const std::shared_ptr<Path> &path, RoomAdmin *map, const Room *room);
+    // Forks `path` into `room` (only if it matches `mustMatch`, when given).
+    // With parallel evaluation enabled, the room is scored in evaluate()
+    // instead, together with every other candidate received for this event.
+    void considerRoom(const std::shared_ptr<Path> &path,
+                      RoomAdmin *map,
+                      const Room *room,
+                      const ParseEvent *mustMatch = nullptr);
+
+protected:
     const Coordinate direction;
     const ExitDirEnum dirCode;
     const std::shared_ptr<PathList> paths;
@@ -5,35 +5,22 @@
 
 #include "mmapper2pathmachine.h"
 
-#include <cassert>
 #include <QElapsedTimer>
 #include <QString>
 
 #include "../configuration/configuration.h"
 #include "../expandoracommon/parseevent.h"
+#include "../global/EventTrace.h"
+#include "../global/LatencyTrace.h"
+#include "PathStats.h"
 #include "pathmachine.h"
 #include "pathparameters.h"
 
-NODISCARD static const char *stateName(const PathStateEnum state)
-{
-#define CASE(x) \
-    do { \
-    case PathStateEnum::x: \
-        return #x; \
-    } while (0)
-    switch (state) {
-        CASE(APPROVED);
-        CASE(EXPERIMENTING);
-        CASE(SYNCING);
-    }
-#undef CASE
-    assert(false);
-    return "UNKNOWN";
-}
-
 void Mmapper2PathMachine::slot_handleParseEvent(const SigParseEvent &sigParseEvent)
 {
     static constexpr const char *const me = "PathMachine";
+    event_trace::Scope scope{"PathMachine::handleParseEvent"};
+    latency_trace::mark(LatencyStageEnum::PATH_MACHINE);
 
     /*
      * REVISIT: replace PathParameters with Configuration::PathMachineSettings
@@ -49,13 +36,15 @@ void Mmapper2PathMachine::slot_handleParseEvent(const SigParseEvent &sigParseEve
     params.maxPaths = utils::clampNonNegative(settings.maxPaths);
     params.matchingTolerance = utils::clampNonNegative(settings.matchingTolerance);
     params.multipleConnectionsPenalty = settings.multipleConnectionsPenalty;
+    params.parallelEvaluationThreshold = utils::clampNonNegative(
+        settings.parallelEvaluationThreshold);
 
     time.restart();
-    emit sig_log(me, QString("received event, state: %1").arg(stateName(state)));
+    emit sig_log(me, QString("received event, state: %1").arg(getPathStateName(state)));
     PathMachine::handleParseEvent(sigParseEvent);
     emit sig_log(me,
                  QString("done processing event, state: %1, elapsed: %2 ms")
-                     .arg(stateName(state))
+                     .arg(getPathStateName(state))
                      .arg(time.elapsed()));
 }
 
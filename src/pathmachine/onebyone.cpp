@@ -28,14 +28,15 @@ OneByOne::OneByOne(const SigParseEvent &sigParseEvent,
 
 void OneByOne::virt_receiveRoom(RoomAdmin *const admin, const Room *const room)
 {
-    if (Room::compare(room, deref(event), params.matchingTolerance) == ComparisonResultEnum::EQUAL) {
-        augmentPath(shortPaths->back(), admin, room);
-    } else {
-        // needed because the memory address is not unique and
-        // calling admin->release might destroy a room still held by some path
-        handler->hold(room, admin, this);
-        handler->release(room);
-    }
+    considerRoom(shortPaths->back(), admin, room, event.get());
+}
+
+void OneByOne::virt_rejectRoom(RoomAdmin *const admin, const Room *const room)
+{
+    // needed because the memory address is not unique and
+    // calling admin->release might destroy a room still held by some path
+    handler->hold(room, admin, this);
+    handler->release(room);
 }
 
 void OneByOne::addPath(std::shared_ptr<Path> path)
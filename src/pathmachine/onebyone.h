@@ -29,6 +29,7 @@ class NODISCARD OneByOne final : public Experimenting
 
 private:
     void virt_receiveRoom(RoomAdmin *admin, const Room *room) final;
+    void virt_rejectRoom(RoomAdmin *admin, const Room *room) final;
 
 public:
     void addPath(std::shared_ptr<Path> path);
@@ -6,40 +6,62 @@
 #include "path.h"
 
 #include <cassert>
+#include <cmath>
 #include <cstdint>
 #include <memory>
 
 #include "../expandoracommon/coordinate.h"
 #include "../expandoracommon/exit.h"
 #include "../expandoracommon/room.h"
+#include "../global/SlabAllocator.h"
 #include "../global/roomid.h"
 #include "../global/utils.h"
 #include "../mapdata/ExitDirection.h"
+#include "PathStats.h"
 #include "pathparameters.h"
 #include "roomsignalhandler.h"
 
-std::shared_ptr<Path> Path::alloc(const Room *const room,
+std::shared_ptr<Path> Path::alloc(const std::shared_ptr<SlabArena> &arena,
+                                  const Room *const room,
                                   RoomAdmin *const owner,
                                   RoomRecipient *const locker,
                                   RoomSignalHandler *const signaler,
+                                  PathStats *const stats,
                                   std::optional<ExitDirEnum> moved_direction)
 {
+    if (arena != nullptr) {
+        return std::allocate_shared<Path>(SlabAllocator<Path>{arena},
+                                          this_is_private{0},
+                                          arena,
+                                          room,
+                                          owner,
+                                          locker,
+                                          signaler,
+                                          stats,
+                                          std::move(moved_direction));
+    }
     return std::make_shared<Path>(this_is_private{0},
+                                  nullptr,
                                   room,
                                   owner,
                                   locker,
                                   signaler,
+                                  stats,
                                   std::move(moved_direction));
 }
 
 Path::Path(this_is_private,
+           std::shared_ptr<SlabArena> arena,
            const Room *const in_room,
            RoomAdmin *const owner,
            RoomRecipient *const locker,
            RoomSignalHandler *const in_signaler,
+           PathStats *const in_stats,
            std::optional<ExitDirEnum> moved_direction)
-    : m_room(in_room)
+    : m_arena(std::move(arena))
+    , m_room(in_room)
     , m_signaler(in_signaler)
+    , m_stats(in_stats)
     , m_dir(std::move(moved_direction))
 {
     if (m_dir.has_value()) {
@@ -47,28 +69,25 @@ Path::Path(this_is_private,
     }
 }
 
-/**
- * new Path is created,
- * distance between rooms is calculated
- * and probability is updated accordingly
- */
-std::shared_ptr<Path> Path::fork(const Room *const in_room,
-                                 const Coordinate &expectedCoordinate,
-                                 RoomAdmin *const owner,
-                                 const PathParameters &p,
-                                 RoomRecipient *const locker,
-                                 const ExitDirEnum direction)
+Path::~Path()
 {
-    assert(!m_zombie);
+    // Children hold their parent alive, so none can be left in our list.
+    assert(m_firstChild == nullptr);
+    if (m_siblingOf != nullptr) {
+        m_siblingOf->unlinkChild(*this);
+    }
+}
 
-    auto ret = Path::alloc(in_room, owner, locker, m_signaler, direction);
+double Path::getForkDistance(const Room &from,
+                             const Room &to,
+                             const Coordinate &expectedCoordinate,
+                             const PathParameters &p,
+                             const ExitDirEnum direction)
+{
     assert(isClamped(static_cast<uint32_t>(direction), 0u, NUM_EXITS));
 
-    ret->setParent(shared_from_this());
-    insertChild(ret);
-
-    double dist = expectedCoordinate.distance(in_room->getPosition());
-    const auto size = static_cast<uint>(m_room->getExitsList().size());
+    double dist = expectedCoordinate.distance(to.getPosition());
+    const auto size = static_cast<uint>(from.getExitsList().size());
     // NOTE: we can probably assert that size is nonzero (room is not a dummy).
     assert(size == 0u /* dummy */ || size == NUM_EXITS /* valid */);
 
@@ -81,14 +100,14 @@ std::shared_ptr<Path> Path::fork(const Room *const in_room,
         }
     } else {
         if (static_cast<uint>(direction) < size) {
-            const Exit &e = m_room->exit(direction);
-            auto oid = in_room->getId();
+            const Exit &e = from.exit(direction);
+            auto oid = to.getId();
             if (e.containsOut(oid)) {
                 dist = 1.0 / p.correctPositionBonus;
-            } else if (!e.outIsEmpty() || oid == m_room->getId()) {
+            } else if (!e.outIsEmpty() || oid == from.getId()) {
                 dist *= p.multipleConnectionsPenalty;
             } else {
-                const Exit &oe = in_room->exit(opposite(direction));
+                const Exit &oe = to.exit(opposite(direction));
                 if (!oe.inIsEmpty()) {
                     dist *= p.multipleConnectionsPenalty;
                 }
@@ -97,19 +116,58 @@ std::shared_ptr<Path> Path::fork(const Room *const in_room,
         } else if (static_cast<uint>(direction) < NUM_EXITS_INCLUDING_NONE) {
             /* NOTE: This is currently always true unless the data is corrupt. */
             for (uint d = 0; d < size; ++d) {
-                const Exit &e = m_room->exit(static_cast<ExitDirEnum>(d));
-                if (e.containsOut(in_room->getId())) {
+                const Exit &e = from.exit(static_cast<ExitDirEnum>(d));
+                if (e.containsOut(to.getId())) {
                     dist = 1.0 / p.correctPositionBonus;
                     break;
                 }
             }
         }
     }
-    dist /= static_cast<double>(m_signaler->getNumLockers(in_room));
+    return dist;
+}
+
+std::shared_ptr<Path> Path::fork(const Room *const in_room,
+                                 const Coordinate &expectedCoordinate,
+                                 RoomAdmin *const owner,
+                                 const PathParameters &p,
+                                 RoomRecipient *const locker,
+                                 const ExitDirEnum direction)
+{
+    assert(!m_zombie);
+    const double dist
+        = getForkDistance(deref(m_room), deref(in_room), expectedCoordinate, p, direction);
+    return fork(in_room, owner, p, locker, direction, dist);
+}
+
+/**
+ * new Path is created,
+ * and probability is updated according to the precomputed distance
+ */
+std::shared_ptr<Path> Path::fork(const Room *const in_room,
+                                 RoomAdmin *const owner,
+                                 const PathParameters &p,
+                                 RoomRecipient *const locker,
+                                 const ExitDirEnum direction,
+                                 const double forkDistance)
+{
+    assert(!m_zombie);
+
+    auto ret = Path::alloc(m_arena, in_room, owner, locker, m_signaler, m_stats, direction);
+    assert(isClamped(static_cast<uint32_t>(direction), 0u, NUM_EXITS));
+    if (m_stats != nullptr) {
+        m_stats->onFork();
+    }
+
+    ret->setParent(shared_from_this());
+    insertChild(ret);
+
+    // The lock count includes the lock that was just taken by the new path.
+    double dist = forkDistance / static_cast<double>(m_signaler->getNumLockers(in_room));
     if (in_room->isTemporary()) {
         dist *= p.newRoomPenalty;
     }
-    ret->setProb(m_probability / dist);
+    ret->setLogProb(m_logProb - std::log(dist));
 
     return ret;
 }
@@ -117,7 +175,10 @@ std::shared_ptr<Path> Path::fork(const Room *const in_room,
 void Path::setParent(const std::shared_ptr<Path> &p)
 {
     assert(!m_zombie);
-    assert(!p->m_zombie);
+    assert(p == nullptr || !p->m_zombie);
+    if (m_siblingOf != nullptr && m_siblingOf != p.get()) {
+        m_siblingOf->unlinkChild(*this);
+    }
     m_parent = p;
 }
 
@@ -137,10 +198,9 @@ void Path::approve()
         parent->approve();
     }
 
-    for (const std::weak_ptr<Path> &weak_child : m_children) {
-        if (auto child = weak_child.lock()) {
-            child->setParent(nullptr);
-        }
+    while (Path *const child = m_firstChild) {
+        // Unlinks the child; this stays alive through the caller's reference.
+        child->setParent(nullptr);
     }
 
     // was: `delete this`
@@ -154,12 +214,15 @@ void Path::deny()
 {
     assert(!m_zombie);
 
-    if (!m_children.empty()) {
+    if (hasChildren()) {
         return;
     }
     if (m_dir.has_value()) {
         m_signaler->release(m_room);
     }
+    if (m_stats != nullptr) {
+        m_stats->onDeny();
+    }
     if (const auto &parent = getParent()) {
         parent->removeChild(shared_from_this());
         parent->deny();
@@ -173,7 +236,19 @@ void Path::insertChild(const std::shared_ptr<Path> &p)
 {
     assert(!m_zombie);
     assert(!p->m_zombie);
-    m_children.emplace_back(p);
+    assert(p->m_parent.get() == this);
+
+    Path &child = *p;
+    if (child.m_siblingOf == this)
+        return;
+    assert(child.m_siblingOf == nullptr);
+
+    child.m_siblingOf = this;
+    child.m_prevSibling = nullptr;
+    child.m_nextSibling = m_firstChild;
+    if (m_firstChild != nullptr)
+        m_firstChild->m_prevSibling = &child;
+    m_firstChild = &child;
 }
 
 void Path::removeChild(const std::shared_ptr<Path> &p)
@@ -181,15 +256,23 @@ void Path::removeChild(const std::shared_ptr<Path> &p)
     assert(!m_zombie);
     assert(!p->m_zombie);
 
-    const auto end = m_children.end();
-    const auto it = std::remove_if(m_children.begin(), end, [&p](const auto &weak) {
-        if (auto shared = weak.lock()) {
-            return shared == p; // remove p
-        } else {
-            return true; // also remove any expired children
-        }
-    });
-    if (it != end) {
-        m_children.erase(it, end);
+    if (p->m_siblingOf == this) {
+        unlinkChild(*p);
     }
 }
+
+void Path::unlinkChild(Path &child)
+{
+    assert(child.m_siblingOf == this);
+
+    if (child.m_prevSibling != nullptr)
+        child.m_prevSibling->m_nextSibling = child.m_nextSibling;
+    else
+        m_firstChild = child.m_nextSibling;
+    if (child.m_nextSibling != nullptr)
+        child.m_nextSibling->m_prevSibling = child.m_prevSibling;
+
+    child.m_siblingOf = nullptr;
+    child.m_prevSibling = nullptr;
+    child.m_nextSibling = nullptr;
+}
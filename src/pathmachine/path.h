@@ -7,10 +7,10 @@
 
 #include <cassert>
 #include <climits>
-#include <list>
+#include <cmath>
+#include <deque>
 #include <memory>
 #include <optional>
-#include <vector>
 #include <QtGlobal>
 
 #include "../mapdata/ExitDirection.h"
@@ -18,10 +18,12 @@
 #include "pathparameters.h"
 
 class Coordinate;
+class PathStats;
 class Room;
 class RoomAdmin;
 class RoomRecipient;
 class RoomSignalHandler;
+class SlabArena;
 struct PathParameters;
 
 class NODISCARD Path final : public std::enable_shared_from_this<Path>
@@ -33,28 +35,37 @@ class NODISCARD Path final : public std::enable_shared_from_this<Path>
     };
 
 public:
-    static std::shared_ptr<Path> alloc(const Room *room,
+    // Paths (and their forks) are allocated from `arena`, which is usually
+    // owned by the PathMachine; pass nullptr to use the global heap.
+    // Forks and denies are counted in `stats`, if given.
+    static std::shared_ptr<Path> alloc(const std::shared_ptr<SlabArena> &arena,
+                                       const Room *room,
                                        RoomAdmin *owner,
                                        RoomRecipient *locker,
                                        RoomSignalHandler *signaler,
+                                       PathStats *stats,
                                        std::optional<ExitDirEnum> direction);
 
 public:
     explicit Path(this_is_private,
+                  std::shared_ptr<SlabArena> arena,
                   const Room *room,
                   RoomAdmin *owner,
                   RoomRecipient *locker,
                   RoomSignalHandler *signaler,
+                  PathStats *stats,
                   std::optional<ExitDirEnum> direction);
+    ~Path();
     DELETE_CTORS_AND_ASSIGN_OPS(Path);
 
+    // p must already have this as its parent.
     void insertChild(const std::shared_ptr<Path> &p);
     void removeChild(const std::shared_ptr<Path> &p);
     void setParent(const std::shared_ptr<Path> &p);
     NODISCARD bool hasChildren() const
     {
         assert(!m_zombie);
-        return !m_children.empty();
+        return m_firstChild != nullptr;
     }
     NODISCARD const Room *getRoom() const
     {
@@ -69,19 +80,36 @@ class NODISCARD Path final : public std::enable_shared_from_this<Path>
                                          const PathParameters &params,
                                          RoomRecipient *locker,
                                          ExitDirEnum dir);
-    NODISCARD double getProb() const
+    // Same as above, with the distance already computed by getForkDistance().
+    NODISCARD std::shared_ptr<Path> fork(const Room *room,
+                                         RoomAdmin *owner,
+                                         const PathParameters &params,
+                                         RoomRecipient *locker,
+                                         ExitDirEnum dir,
+                                         double forkDistance);
+    // The part of fork()'s scoring that only reads the two rooms, so it may
+    // run on any thread while both rooms are locked.
+    NODISCARD static double getForkDistance(const Room &from,
+                                            const Room &to,
+                                            const Coordinate &expectedCoordinate,
+                                            const PathParameters &params,
+                                            ExitDirEnum dir);
+    // Probabilities are kept as natural logs, since they are the product of
+    // every fork's score and would otherwise under- or overflow on long paths.
+    NODISCARD double getLogProb() const
     {
         assert(!m_zombie);
-        return m_probability;
+        return m_logProb;
     }
+    NODISCARD double getProb() const { return std::exp(getLogProb()); }
     void approve();
 
     // deletes this path and all parents up to the next branch
     void deny();
-    void setProb(double p)
+    void setLogProb(double logProb)
     {
         assert(!m_zombie);
-        m_probability = p;
+        m_logProb = logProb;
     }
 
     NODISCARD const std::shared_ptr<Path> &getParent() const
@@ -91,17 +119,27 @@ class NODISCARD Path final : public std::enable_shared_from_this<Path>
     }
 
 private:
+    void unlinkChild(Path &child);
+
+private:
+    std::shared_ptr<SlabArena> m_arena;
     std::shared_ptr<Path> m_parent;
-    std::vector<std::weak_ptr<Path>> m_children;
-    double m_probability = 1.0;
+    // Intrusive list of children; a child unlinks itself when it dies, so
+    // these never dangle. m_siblingOf is the path whose list this one is in.
+    Path *m_firstChild = nullptr;
+    Path *m_prevSibling = nullptr;
+    Path *m_nextSibling = nullptr;
+    Path *m_siblingOf = nullptr;
+    double m_logProb = 0.0;
     // in fact a path only has one room, one parent and some children (forks).
     const Room *const m_room;
     RoomSignalHandler *const m_signaler;
+    PathStats *const m_stats;
     const std::optional<ExitDirEnum> m_dir;
     bool m_zombie = false;
 };
 
-struct NODISCARD PathList : public std::list<std::shared_ptr<Path>>,
+struct NODISCARD PathList : public std::deque<std::shared_ptr<Path>>,
                             public std::enable_shared_from_this<PathList>
 {
 private:
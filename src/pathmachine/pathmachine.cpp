@@ -7,13 +7,17 @@
 #include "pathmachine.h"
 
 #include <cassert>
+#include <chrono>
 #include <memory>
 #include <set>
 #include <utility>
+#include <QTimer>
 
 #include "../expandoracommon/coordinate.h"
 #include "../expandoracommon/exit.h"
 #include "../expandoracommon/room.h"
+#include "../global/PerfCounters.h"
+#include "../global/SlabAllocator.h"
 #include "../global/roomid.h"
 #include "../global/utils.h"
 #include "../mapdata/ExitDirection.h"
@@ -35,12 +39,20 @@
 
 class RoomRecipient;
 
+// How far ahead of the player the prespammed moves are followed.
+static constexpr const size_t MAX_PREFETCH_STEPS = 16;
+
 PathMachine::PathMachine(MapData *const mapData, QObject *const parent)
     : QObject(parent)
     , m_mapData{deref(mapData)}
     , signaler{this}
     , lastEvent{ParseEvent::createDummyEvent()}
+    , m_pathArena{std::make_shared<SlabArena>()}
     , paths{PathList::alloc()}
+    , m_memoryReport{[this](const memory_report::AddFn &add) {
+        add("pathmachine: paths",
+            MemoryUsage{deref(m_pathArena).getBytesReserved(), getNumPaths()});
+    }}
 {
     connect(&signaler,
             &RoomSignalHandler::sig_scheduleAction,
@@ -51,13 +63,14 @@ PathMachine::PathMachine(MapData *const mapData, QObject *const parent)
 void PathMachine::slot_setCurrentRoom(const RoomId id, bool update)
 {
     Forced forced(lastEvent, update);
-    emit sig_lookingForRooms(forced, id);
+    lookingForRooms(forced, id);
     slot_releaseAllPaths();
     if (const Room *const perhaps = forced.oneMatch()) {
         setMostLikelyRoom(*perhaps);
         emit sig_playerMoved(perhaps->getPosition());
         emit sig_setCharPosition(perhaps->getId());
         state = PathStateEnum::APPROVED;
+        schedulePrefetch();
     } else {
         clearMostLikelyRoom();
         state = PathStateEnum::SYNCING;
@@ -70,17 +83,23 @@ void PathMachine::slot_releaseAllPaths()
         path->deny();
     }
     paths->clear();
+    m_stats.setLivePaths(0);
+    m_expected.clear();
 
     state = PathStateEnum::SYNCING;
 }
 
 void PathMachine::handleParseEvent(const SigParseEvent &sigParseEvent)
 {
+    // Everything this event releases or keeps is passed on to the map at once.
+    RoomSignalHandler::Batch batch{signaler};
+
     if (lastEvent != sigParseEvent.requireValid())
         lastEvent = sigParseEvent;
 
     lastEvent.requireValid();
 
+    m_stats.onEvent(state);
     switch (state) {
     case PathStateEnum::APPROVED:
         approved(sigParseEvent);
@@ -110,7 +129,7 @@ void PathMachine::tryExits(const Room *const room,
         tryExit(possible, recipient, out);
     } else {
         // Only check the current room for LOOK
-        emit sig_lookingForRooms(recipient, room->getId());
+        lookingForRooms(recipient, room->getId());
         if (move >= CommandEnum::FLEE) {
             // Only try all possible exits for commands FLEE, SCOUT, and NONE
             for (const auto &possible : room->getExitsList()) {
@@ -123,7 +142,7 @@ void PathMachine::tryExits(const Room *const room,
 void PathMachine::tryExit(const Exit &possible, RoomRecipient &recipient, const bool out)
 {
     for (auto idx : possible.getRange(out)) {
-        emit sig_lookingForRooms(recipient, idx);
+        lookingForRooms(recipient, idx);
     }
 }
 
@@ -141,18 +160,12 @@ void PathMachine::tryCoordinate(const Room *const room,
         // LOOK, UNKNOWN will have an empty offset
         auto offset = Room::exitDir(getDirection(moveCode));
         const Coordinate c = room->getPosition() + offset;
-        emit sig_lookingForRooms(recipient, c);
+        lookingForRooms(recipient, c);
 
     } else {
-        const Coordinate roomPos = room->getPosition();
-        // REVISIT: Should this enumerate 6 or 7 values?
-        // NOTE: This previously enumerated 8 values instead of 7,
-        // which meant it was asking for exitDir(ExitDirEnum::NONE),
-        // even though both ExitDirEnum::UNKNOWN and ExitDirEnum::NONE
-        // both have Coordinate(0, 0, 0).
-        for (const ExitDirEnum dir : ALL_EXITS7) {
-            emit sig_lookingForRooms(recipient, roomPos + Room::exitDir(dir));
-        }
+        // The room itself and its six neighbours, i.e. pos + exitDir() for each
+        // of ALL_EXITS7 (UNKNOWN being the null offset), in one lookup.
+        lookingForRooms(recipient, room->getPosition(), 1);
     }
 }
 
@@ -164,7 +177,7 @@ void PathMachine::approved(const SigParseEvent &sigParseEvent)
     const Room *perhaps = nullptr;
 
     if (event.getMoveType() == CommandEnum::LOOK) {
-        emit sig_lookingForRooms(appr, getMostLikelyRoomId());
+        lookingForRooms(appr, getMostLikelyRoomId());
 
     } else {
         tryExits(getMostLikelyRoom(), appr, event, true);
@@ -198,17 +211,32 @@ void PathMachine::approved(const SigParseEvent &sigParseEvent)
                     appr.releaseMatch();
                     Coordinate c = getMostLikelyRoomPosition() + eDir;
                     c.z--;
-                    emit sig_lookingForRooms(appr, c);
+                    lookingForRooms(appr, c);
                     perhaps = appr.oneMatch();
 
                     if (perhaps == nullptr) {
                         // try to match by coordinate one step above expected
                         appr.releaseMatch();
                         c.z += 2;
-                        emit sig_lookingForRooms(appr, c);
+                        lookingForRooms(appr, c);
                         perhaps = appr.oneMatch();
                     }
                 }
+
+                if (perhaps == nullptr && cmd < CommandEnum::FLEE && params.nearbyRoomRadius != 0) {
+                    // try to match anywhere near the expected coordinate,
+                    // in case the room was moved a little on the map;
+                    // the room we're leaving and the ones beside or behind it
+                    // don't count, or a move into unmapped space next to
+                    // look-alike rooms would never create a new room
+                    appr.releaseMatch();
+                    appr.requireAhead(getMostLikelyRoomPosition(), eDir);
+                    lookingForRooms(appr,
+                                    getMostLikelyRoomPosition() + eDir,
+                                    static_cast<int>(params.nearbyRoomRadius));
+                    appr.clearRequireAhead();
+                    perhaps = appr.oneMatch();
+                }
             }
         }
     }
@@ -224,7 +252,8 @@ void PathMachine::approved(const SigParseEvent &sigParseEvent)
             return;
         }
 
-        paths->push_front(Path::alloc(pathRoot, nullptr, nullptr, &signaler, std::nullopt));
+        paths->push_front(
+            Path::alloc(m_pathArena, pathRoot, nullptr, nullptr, &signaler, &m_stats, std::nullopt));
         experimenting(sigParseEvent);
 
         return;
@@ -233,6 +262,9 @@ void PathMachine::approved(const SigParseEvent &sigParseEvent)
     // Update the exit from the previous room to the current room
     const CommandEnum move = event.getMoveType();
     if (isDirection7(move)) {
+        if (!m_expected.empty() && m_expected.front() == perhaps->getId())
+            m_stats.onPrefetchHit();
+
         if (const Room *const pRoom = getMostLikelyRoom()) {
             const auto dir = getDirection(move);
             const auto &mostLikelyExit = pRoom->exit(dir);
@@ -282,15 +314,17 @@ void PathMachine::approved(const SigParseEvent &sigParseEvent)
     emit sig_playerMoved(getMostLikelyRoomPosition());
     // GroupManager
     emit sig_setCharPosition(getMostLikelyRoomId());
+
+    schedulePrefetch();
 }
 
 void PathMachine::syncing(const SigParseEvent &sigParseEvent)
 {
     ParseEvent &event = sigParseEvent.deref();
     {
-        Syncing sync(params, paths, &signaler);
+        Syncing sync(params, paths, m_pathArena, &signaler, &m_stats);
         if (event.getNumSkipped() <= params.maxSkipped) {
-            emit sig_lookingForRooms(sync, sigParseEvent);
+            lookingForRooms(sync, sigParseEvent);
         }
         paths = sync.evaluate();
     }
@@ -321,7 +355,7 @@ void PathMachine::experimenting(const SigParseEvent &sigParseEvent)
                 pathEnds.insert(working);
             }
         }
-        emit sig_lookingForRooms(*exp, sigParseEvent);
+        lookingForRooms(*exp, sigParseEvent);
     } else {
         auto pOneByOne = std::make_unique<OneByOne>(sigParseEvent, params, &signaler);
         {
@@ -343,6 +377,7 @@ void PathMachine::experimenting(const SigParseEvent &sigParseEvent)
 
 void PathMachine::evaluatePaths()
 {
+    const auto start = std::chrono::steady_clock::now();
     if (paths->empty()) {
         state = PathStateEnum::SYNCING;
     } else {
@@ -355,12 +390,51 @@ void PathMachine::evaluatePaths()
             state = PathStateEnum::APPROVED;
             paths->front()->approve();
             paths->pop_front();
+            schedulePrefetch();
         } else {
             state = PathStateEnum::EXPERIMENTING;
         }
         emit sig_playerMoved(getMostLikelyRoomPosition());
         emit sig_setCharPosition(getMostLikelyRoomId());
     }
+
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    m_stats.setLivePaths(paths->size());
+    m_stats.onEvaluated(elapsed);
+    perf_counters::set(PerfGaugeEnum::LIVE_PATHS, static_cast<int64_t>(paths->size()));
+    perf_counters::record(PerfHistogramEnum::PATH_EVALUATION, elapsed);
+}
+
+void PathMachine::slot_setPrespam(const CommandQueue &queue)
+{
+    m_prespam = queue;
+    schedulePrefetch();
+}
+
+void PathMachine::schedulePrefetch()
+{
+    if (m_prefetchScheduled)
+        return;
+
+    // Runs after the current event (and any already queued behind it) is handled,
+    // so the prefetch never delays approving the room the player is in now.
+    m_prefetchScheduled = true;
+    QTimer::singleShot(0, this, [this]() {
+        m_prefetchScheduled = false;
+        prefetch();
+    });
+}
+
+void PathMachine::prefetch()
+{
+    m_expected.clear();
+    if (state != PathStateEnum::APPROVED || !hasMostLikelyRoom() || m_prespam.isEmpty())
+        return;
+
+    m_expected = m_mapData.prefetchPath(getMostLikelyRoomPosition(),
+                                        m_prespam,
+                                        MAX_PREFETCH_STEPS);
+    m_stats.onPrefetch(m_expected.size());
 }
 
 void PathMachine::scheduleAction(const std::shared_ptr<MapAction> &action)
@@ -8,11 +8,16 @@
 #include <list>
 #include <memory>
 #include <optional>
+#include <vector>
 #include <QString>
 #include <QtCore>
 
 #include "../expandoracommon/parseevent.h"
 #include "../expandoracommon/room.h"
+#include "../global/MemoryReport.h"
+#include "../global/roomid.h"
+#include "../parser/CommandQueue.h"
+#include "PathStats.h"
 #include "path.h"
 #include "pathparameters.h"
 #include "roomsignalhandler.h"
@@ -25,9 +30,7 @@ class MapData;
 class QEvent;
 class QObject;
 class RoomRecipient;
-struct RoomId;
-
-enum class NODISCARD PathStateEnum { APPROVED = 0, EXPERIMENTING = 1, SYNCING = 2 };
+class SlabArena;
 
 /**
  * the parser determines the relations between incoming move- and room-events
@@ -43,11 +46,14 @@ public slots:
     void slot_releaseAllPaths();
     void slot_setCurrentRoom(RoomId id, bool update);
     void slot_scheduleAction(const std::shared_ptr<MapAction> &action) { scheduleAction(action); }
+    // The moves the player has sent but the mud hasn't answered yet.
+    void slot_setPrespam(const CommandQueue &queue);
 
 signals:
     void sig_lookingForRooms(RoomRecipient &, const SigParseEvent &);
     void sig_lookingForRooms(RoomRecipient &, RoomId);
     void sig_lookingForRooms(RoomRecipient &, const Coordinate &);
+    void sig_lookingForRooms(RoomRecipient &, const Coordinate &, int);
     void sig_playerMoved(const Coordinate &);
     void sig_createRoom(const SigParseEvent &, const Coordinate &);
     void sig_scheduleAction(std::shared_ptr<MapAction>);
@@ -56,12 +62,29 @@ public slots:
 public:
     explicit PathMachine(MapData *mapData, QObject *parent);
 
+public:
+    NODISCARD PathStateEnum getState() const { return state; }
+    // Number of candidate paths currently being tracked.
+    NODISCARD size_t getNumPaths() const { return (paths != nullptr) ? paths->size() : 0u; }
+    // Safe to call from any thread.
+    NODISCARD PathStats::Values getStats() const { return m_stats.getValues(); }
+    void resetStats() { m_stats.reset(); }
+
 protected:
     void handleParseEvent(const SigParseEvent &);
 
 private:
     void scheduleAction(const std::shared_ptr<MapAction> &action);
 
+protected:
+    // Counts the lookup in m_stats; use this instead of emitting sig_lookingForRooms().
+    template<typename... Args>
+    void lookingForRooms(RoomRecipient &recipient, const Args &...args)
+    {
+        m_stats.onLookup();
+        emit sig_lookingForRooms(recipient, args...);
+    }
+
 protected:
     PathParameters params;
     MapData &m_mapData;
@@ -78,13 +101,24 @@ public slots:
     /* REVISIT: pathRoot and mostLikelyRoom should probably be of type RoomId */
     SigParseEvent lastEvent;
     PathStateEnum state = PathStateEnum::SYNCING;
+    // Backing store for every Path this machine creates.
+    std::shared_ptr<SlabArena> m_pathArena;
     std::shared_ptr<PathList> paths;
+    PathStats m_stats;
 
 private:
     std::optional<Coordinate> m_pathRootPos;
     std::optional<Coordinate> m_mostLikelyRoomPos;
+    memory_report::Registration m_memoryReport;
+    CommandQueue m_prespam;
+    // Rooms the prespammed moves lead to from the most likely room, nearest first.
+    std::vector<RoomId> m_expected;
+    bool m_prefetchScheduled = false;
 
 private:
+    // Warms the rooms ahead once the current event has been handled.
+    void schedulePrefetch();
+    void prefetch();
     void clearMostLikelyRoom() { m_mostLikelyRoomPos.reset(); }
     void setMostLikelyRoom(const Room &room) { m_mostLikelyRoomPos = room.getPosition(); }
 
@@ -20,4 +20,11 @@ struct NODISCARD PathParameters final
     double maxPaths = 500.0;
     int matchingTolerance = 5;
     uint maxSkipped = 1;
+    // When nothing matches at the expected coordinate, look this many steps
+    // around it (but only ahead of the room being left) before giving up on
+    // the approved path; 0 disables the search.
+    uint nearbyRoomRadius = 0;
+    // Score candidate rooms on several threads once an event has at least
+    // this many of them; 0 disables batching entirely.
+    uint parallelEvaluationThreshold = 0;
 };
@@ -5,18 +5,75 @@
 
 #include "roomsignalhandler.h"
 
+#include <algorithm>
 #include <cassert>
 #include <memory>
+#include <utility>
 
 #include "../expandoracommon/RoomAdmin.h"
 #include "../expandoracommon/room.h"
 #include "../global/roomid.h"
 #include "../mapfrontend/mapaction.h"
 
+void RoomSignalHandler::changeLock(const Room *const room,
+                                   RoomAdmin *const owner,
+                                   RoomRecipient *const locker,
+                                   const bool keep)
+{
+    if (m_batchDepth > 0) {
+        m_pendingLocks.emplace_back(PendingLockChange{room, owner, {locker, room->getId(), keep}});
+    } else if (keep) {
+        owner->keepRoom(*locker, room->getId());
+    } else {
+        owner->releaseRoom(*locker, room->getId());
+    }
+}
+
+void RoomSignalHandler::flush()
+{
+    // Swapped out, in case the owners call back in; the buffers are kept for the next event.
+    std::vector<std::shared_ptr<MapAction>> actions;
+    std::vector<PendingLockChange> pending;
+    std::vector<RoomLockChange> run;
+    actions.swap(m_pendingActions);
+    pending.swap(m_pendingLocks);
+    run.swap(m_run);
+
+    // The actions go first, as they were scheduled before their rooms were let go.
+    for (auto &action : actions) {
+        emit sig_scheduleAction(std::move(action));
+    }
+
+    for (size_t i = 0; i < pending.size();) {
+        RoomAdmin *const owner = pending[i].owner;
+        run.clear();
+        for (; i < pending.size() && pending[i].owner == owner; ++i) {
+            run.emplace_back(pending[i].change);
+        }
+        owner->applyLockChanges(run);
+    }
+
+    actions.clear();
+    pending.clear();
+    run.clear();
+    if (m_pendingActions.empty())
+        m_pendingActions.swap(actions);
+    if (m_pendingLocks.empty())
+        m_pendingLocks.swap(pending);
+    if (m_run.empty())
+        m_run.swap(run);
+}
+
 void RoomSignalHandler::hold(const Room *const room,
                              RoomAdmin *const owner,
                              RoomRecipient *const locker)
 {
+    // A release that's still pending would undo this hold's lock.
+    const auto isPending = [room](const PendingLockChange &p) { return p.room == room; };
+    if (std::any_of(m_pendingLocks.begin(), m_pendingLocks.end(), isPending)) {
+        flush();
+    }
+
     owners[room] = owner;
     if (lockers[room].empty()) {
         holdCount[room] = 0;
@@ -30,9 +87,9 @@ void RoomSignalHandler::release(const Room *const room)
     assert(holdCount[room]);
     if (--holdCount[room] == 0) {
         if (RoomAdmin *const rcv = owners[room]) {
-            for (auto i = lockers[room].begin(); i != lockers[room].end(); ++i) {
-                if (RoomRecipient *const recipient = *i) {
-                    rcv->releaseRoom(*recipient, room->getId());
+            for (RoomRecipient *const recipient : lockers[room]) {
+                if (recipient != nullptr) {
+                    changeLock(room, rcv, recipient, false);
                 }
             }
         } else {
@@ -51,12 +108,17 @@ void RoomSignalHandler::keep(const Room *const room, const ExitDirEnum dir, cons
 
     RoomAdmin *const rcv = owners[room];
     if (static_cast<uint32_t>(dir) < NUM_EXITS) {
-        emit sig_scheduleAction(std::make_shared<AddExit>(fromId, room->getId(), dir));
+        auto action = std::make_shared<AddExit>(fromId, room->getId(), dir);
+        if (m_batchDepth == 0) {
+            emit sig_scheduleAction(std::move(action));
+        } else {
+            m_pendingActions.emplace_back(std::move(action));
+        }
     }
 
     if (!lockers[room].empty()) {
         if (RoomRecipient *const locker = *(lockers[room].begin())) {
-            rcv->keepRoom(*locker, room->getId());
+            changeLock(room, rcv, locker, true);
             lockers[room].erase(locker);
         } else {
             assert(false);
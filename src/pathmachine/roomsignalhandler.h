@@ -7,17 +7,19 @@
 #include <map>
 #include <memory>
 #include <set>
+#include <vector>
 #include <QObject>
 #include <QString>
 #include <QtCore>
 
+#include "../expandoracommon/RoomAdmin.h"
+#include "../global/RuleOf5.h"
 #include "../global/roomid.h"
 #include "../mapdata/ExitDirection.h"
 #include "../mapdata/mmapper2exit.h"
 
 class MapAction;
 class Room;
-class RoomAdmin;
 class RoomRecipient;
 struct RoomId;
 
@@ -29,6 +31,43 @@ class RoomSignalHandler final : public QObject
     std::map<const Room *, std::set<RoomRecipient *>> lockers{};
     std::map<const Room *, int> holdCount{};
 
+private:
+    struct NODISCARD PendingLockChange final
+    {
+        const Room *room = nullptr;
+        RoomAdmin *owner = nullptr;
+        RoomLockChange change;
+    };
+    // Collected while a Batch is open.
+    std::vector<PendingLockChange> m_pendingLocks;
+    std::vector<std::shared_ptr<MapAction>> m_pendingActions;
+    // Only kept for its capacity.
+    std::vector<RoomLockChange> m_run;
+    int m_batchDepth = 0;
+
+public:
+    // While one is alive, the rooms released or kept, and the exits added by
+    // keep(), are only collected; they're passed on to the owners when the
+    // outermost one ends, each owner's changes in one call.
+    class NODISCARD Batch final
+    {
+    private:
+        RoomSignalHandler &m_self;
+
+    public:
+        explicit Batch(RoomSignalHandler &self)
+            : m_self{self}
+        {
+            ++m_self.m_batchDepth;
+        }
+        ~Batch()
+        {
+            if (--m_self.m_batchDepth == 0)
+                m_self.flush();
+        }
+        DELETE_CTORS_AND_ASSIGN_OPS(Batch);
+    };
+
 public:
     RoomSignalHandler() = delete;
     explicit RoomSignalHandler(QObject *parent)
@@ -50,6 +89,10 @@ class RoomSignalHandler final : public QObject
 
     auto getNumLockers(const Room *room) { return lockers[room].size(); }
 
+private:
+    void changeLock(const Room *room, RoomAdmin *owner, RoomRecipient *locker, bool keep);
+    void flush();
+
 signals:
     void sig_scheduleAction(std::shared_ptr<MapAction>);
 };
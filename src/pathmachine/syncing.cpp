@@ -15,11 +15,15 @@ class Room;
 
 Syncing::Syncing(PathParameters &in_p,
                  std::shared_ptr<PathList> moved_paths,
-                 RoomSignalHandler *in_signaler)
+                 const std::shared_ptr<SlabArena> &in_arena,
+                 RoomSignalHandler *in_signaler,
+                 PathStats *const in_stats)
     : signaler(in_signaler)
+    , stats(in_stats)
     , params(in_p)
     , paths(std::move(moved_paths))
-    , parent(Path::alloc(nullptr, nullptr, this, signaler, std::nullopt))
+    , arena(in_arena)
+    , parent(Path::alloc(arena, nullptr, nullptr, this, signaler, stats, std::nullopt))
 {}
 
 void Syncing::virt_receiveRoom(RoomAdmin *sender, const Room *in_room)
@@ -33,7 +37,7 @@ void Syncing::virt_receiveRoom(RoomAdmin *sender, const Room *in_room)
             parent = nullptr;
         }
     } else {
-        auto p = Path::alloc(in_room, sender, this, signaler, ExitDirEnum::NONE);
+        auto p = Path::alloc(arena, in_room, sender, this, signaler, stats, ExitDirEnum::NONE);
         p->setParent(parent);
         parent->insertChild(p);
         paths->push_back(p);
@@ -4,7 +4,6 @@
 // Author: Ulf Hermann <ulfonk_mennhar@gmx.de> (Alve)
 // Author: Marek Krejza <krejza@gmail.com> (Caligor)
 
-#include <list>
 #include <memory>
 #include <QtGlobal>
 
@@ -12,25 +11,31 @@
 #include "../global/RuleOf5.h"
 #include "path.h"
 
+class PathStats;
 class Room;
 class RoomAdmin;
 class RoomSignalHandler;
+class SlabArena;
 struct PathParameters;
 
 class NODISCARD Syncing final : public RoomRecipient
 {
 private:
     RoomSignalHandler *signaler = nullptr;
+    PathStats *stats = nullptr;
     uint numPaths = 0u;
     PathParameters &params;
     const std::shared_ptr<PathList> paths;
+    const std::shared_ptr<SlabArena> arena;
     // This is not our parent; it's the parent we assign to new objects.
     std::shared_ptr<Path> parent;
 
 public:
     explicit Syncing(PathParameters &p,
                      std::shared_ptr<PathList> paths,
-                     RoomSignalHandler *signaler);
+                     const std::shared_ptr<SlabArena> &arena,
+                     RoomSignalHandler *signaler,
+                     PathStats *stats);
 
 public:
     Syncing() = delete;
@@ -183,6 +183,10 @@ AdvancedGraphicsGroupBox::AdvancedGraphicsGroupBox(QGroupBox &groupBox)
     checkboxDiag->setChecked(MapCanvasConfig::getShowPerfStats());
     vertical->addWidget(checkboxDiag);
 
+    auto *const checkboxAdaptive = new QCheckBox("Adaptive quality while moving");
+    checkboxAdaptive->setChecked(MapCanvasConfig::isAdaptiveQuality());
+    vertical->addWidget(checkboxAdaptive);
+
     auto *const checkbox3d = new QCheckBox("3d Mode");
     const bool is3dAtInit = MapCanvasConfig::isIn3dMode();
     checkbox3d->setChecked(is3dAtInit);
@@ -206,6 +210,11 @@ AdvancedGraphicsGroupBox::AdvancedGraphicsGroupBox(QGroupBox &groupBox)
 
     m_groupBox->setLayout(vertical);
 
+    connect(checkboxAdaptive, &QCheckBox::stateChanged, this, [this, checkboxAdaptive](int) {
+        MapCanvasConfig::setAdaptiveQuality(checkboxAdaptive->isChecked());
+        graphicsSettingsChanged();
+    });
+
     connect(checkbox3d, &QCheckBox::stateChanged, this, [this, checkbox3d, autoTilt](int) {
         const bool is3d = checkbox3d->isChecked();
         MapCanvasConfig::set3dMode(is3d);
@@ -227,14 +236,16 @@ AdvancedGraphicsGroupBox::AdvancedGraphicsGroupBox(QGroupBox &groupBox)
     });
 
     m_connections = MapCanvasConfig::registerChangeCallback(
-        [this, checkboxDiag, checkbox3d, autoTilt]() -> void {
+        [this, checkboxDiag, checkboxAdaptive, checkbox3d, autoTilt]() -> void {
             SignalBlocker sb1{*checkboxDiag};
             SignalBlocker sb2{*checkbox3d};
             SignalBlocker sb3{*autoTilt};
+            SignalBlocker sb4{*checkboxAdaptive};
             for (auto &ssb : m_ssbs) {
                 ssb->forcedUpdate();
             }
             checkboxDiag->setChecked(MapCanvasConfig::getShowPerfStats());
+            checkboxAdaptive->setChecked(MapCanvasConfig::isAdaptiveQuality());
             checkbox3d->setChecked(MapCanvasConfig::isIn3dMode());
             autoTilt->setChecked(MapCanvasConfig::isAutoTilt());
         });
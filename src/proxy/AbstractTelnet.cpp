@@ -6,6 +6,8 @@
 #include "AbstractTelnet.h"
 
 #include <cassert>
+#include <chrono>
+#include <cstring>
 #include <limits>
 #include <sstream>
 #include <QByteArray>
@@ -354,6 +356,17 @@ void AbstractTelnet::sendLineModeEdit()
     s.addSubnegEnd();
 }
 
+void AbstractTelnet::sendCompressBegin()
+{
+    if (debug)
+        qDebug() << "Starting compression";
+
+    // MCCP2 specifies IAC SB COMPRESS2 IAC SE
+    TelnetFormatter s{*this};
+    s.addSubnegBegin(OPT_COMPRESS2);
+    s.addSubnegEnd();
+}
+
 void AbstractTelnet::sendTerminalType(const QByteArray &terminalType)
 {
     if (debug)
@@ -520,7 +533,9 @@ void AbstractTelnet::processTelnetCommand(const AppendBuffer &command)
                 if ((option == OPT_SUPPRESS_GA) || (option == OPT_STATUS)
                     || (option == OPT_TERMINAL_TYPE) || (option == OPT_NAWS)
                     || (option == OPT_CHARSET) || (option == OPT_GMCP) || (option == OPT_LINEMODE)
-                    || (option == OPT_EOR)) {
+                    || (option == OPT_EOR)
+                    // only if we offered to compress
+                    || (option == OPT_COMPRESS2 && !NO_ZLIB && triedToEnable[option])) {
                     sendTelnetOption(TN_WILL, option);
                     myOptionState[option] = true;
                     if (option == OPT_NAWS) {
@@ -533,7 +548,9 @@ void AbstractTelnet::processTelnetCommand(const AppendBuffer &command)
                     } else if (option == OPT_LINEMODE) {
                         sendLineModeEdit();
                     } else if (option == OPT_COMPRESS2 && !NO_ZLIB) {
-                        // REVISIT: Start deflating after sending IAC SB COMPRESS2 IAC SE
+                        // Everything after IAC SB COMPRESS2 IAC SE is compressed
+                        sendCompressBegin();
+                        setCompressEnabled(true);
                     } else if (option == OPT_CHARSET && heAnnouncedState[option]) {
                         sendCharsetRequest();
                     }
@@ -550,6 +567,8 @@ void AbstractTelnet::processTelnetCommand(const AppendBuffer &command)
                 sendTelnetOption(TN_WONT, option);
                 announcedState[option] = true;
             }
+            if (option == OPT_COMPRESS2 && myOptionState[option])
+                setCompressEnabled(false);
             myOptionState[option] = false;
             break;
         }
@@ -735,6 +754,14 @@ void AbstractTelnet::onReadInternal(const QByteArray &data)
     if (data.isEmpty())
         return;
 
+    // Most reads are nothing but text, so they're passed on as they are,
+    // without copying them (see virt_sendToMapper).
+    if (!inflateTelnet && state == TelnetStateEnum::NORMAL
+        && !containsIAC(std::string_view{data.data(), static_cast<size_t>(data.size())})) {
+        sendToMapper(data, false); // without GO-AHEAD
+        return;
+    }
+
     // now we have the data, but we cannot forward it to next stage of processing,
     // because the data contains telnet commands
     // so we parse the text and process all telnet commands:
@@ -751,6 +778,13 @@ void AbstractTelnet::onReadInternal(const QByteArray &data)
             continue;
         }
 
+        // Plaintext doesn't change any of the flags tested below.
+        const int plain = onReadInternalPlain(cleanData, data.data() + pos, data.size() - pos);
+        if (plain != 0) {
+            pos += plain;
+            continue;
+        }
+
         // Process character by character
         const uint8_t c = static_cast<unsigned char>(data.at(pos));
         onReadInternal2(cleanData, c);
@@ -759,6 +793,7 @@ void AbstractTelnet::onReadInternal(const QByteArray &data)
         if (recvdCompress) {
             inflateTelnet = true;
             recvdCompress = false;
+            m_compressionStats.onStreamStarted();
 #ifndef MMAPPER_NO_ZLIB
             int ret = inflateReset(&stream);
             if (ret != Z_OK)
@@ -783,6 +818,21 @@ void AbstractTelnet::onReadInternal(const QByteArray &data)
     }
 }
 
+int AbstractTelnet::onReadInternalPlain(AppendBuffer &cleanData,
+                                        const char *const data,
+                                        const int length)
+{
+    if (state != TelnetStateEnum::NORMAL || length <= 0)
+        return 0;
+
+    const auto *const iac = static_cast<const char *>(
+        std::memchr(data, TN_IAC, static_cast<size_t>(length)));
+    const int plain = (iac == nullptr) ? length : static_cast<int>(iac - data);
+    if (plain > 0)
+        cleanData.QByteArray::append(data, plain);
+    return plain;
+}
+
 /*
  * normal telnet state
  * -------------------
@@ -923,20 +973,30 @@ int AbstractTelnet::onReadInternalInflate(const char *data,
 #ifdef MMAPPER_NO_ZLIB
     abort();
 #else
-    static constexpr const int CHUNK = 1024;
-    char out[CHUNK];
+    static constexpr const size_t MIN_INFLATE_BUFFER = 16 * 1024;
+    static constexpr const size_t MAX_INFLATE_BUFFER = 256 * 1024;
+    if (m_inflateBuffer.size() < MIN_INFLATE_BUFFER)
+        m_inflateBuffer.resize(MIN_INFLATE_BUFFER);
 
     stream.avail_in = static_cast<uInt>(length);
     stream.next_in = reinterpret_cast<const Bytef *>(data);
 
+    uint64_t inflatedBytes = 0;
+    std::chrono::nanoseconds inflateTime{};
+
     /* decompress until deflate stream ends */
+    bool filled = false;
     do {
-        stream.avail_out = CHUNK;
+        char *const out = m_inflateBuffer.data();
+        const int outSize = static_cast<int>(m_inflateBuffer.size());
+        stream.avail_out = static_cast<uInt>(outSize);
         stream.next_out = reinterpret_cast<Bytef *>(out);
+        const auto start = std::chrono::steady_clock::now();
         int ret = inflate(&stream, Z_SYNC_FLUSH);
         assert(ret != Z_STREAM_ERROR); /* state not clobbered */
         if (ret == Z_DATA_ERROR)
             ret = inflateSync(&stream);
+        inflateTime += std::chrono::steady_clock::now() - start;
         switch (ret) {
         case Z_NEED_DICT:
         case Z_DATA_ERROR:
@@ -952,8 +1012,14 @@ int AbstractTelnet::onReadInternalInflate(const char *data,
             break;
         }
 
-        const int outLen = CHUNK - static_cast<int>(stream.avail_out);
+        const int outLen = outSize - static_cast<int>(stream.avail_out);
+        inflatedBytes += static_cast<uint64_t>(outLen);
         for (auto i = 0; i < outLen; i++) {
+            if (const int plain = onReadInternalPlain(cleanData, out + i, outLen - i)) {
+                i += plain - 1;
+                continue;
+            }
+
             // Process character by character
             const uint8_t c = static_cast<unsigned char>(out[i]);
             onReadInternal2(cleanData, c);
@@ -965,7 +1031,15 @@ int AbstractTelnet::onReadInternalInflate(const char *data,
             }
         }
 
-    } while (stream.avail_out == 0);
+        filled = stream.avail_out == 0;
+        if (filled && m_inflateBuffer.size() < MAX_INFLATE_BUFFER)
+            m_inflateBuffer.resize(m_inflateBuffer.size() * 2);
+    } while (filled);
+
+    m_compressionStats.onInflated(static_cast<uint64_t>(length)
+                                      - static_cast<uint64_t>(stream.avail_in),
+                                  inflatedBytes,
+                                  inflateTime);
     return static_cast<int>(stream.avail_in);
 #endif
 }
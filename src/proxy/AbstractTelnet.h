@@ -6,6 +6,7 @@
 
 #include <cassert>
 #include <cstdint>
+#include <vector>
 #include <QByteArray>
 #include <QObject>
 #include <QString>
@@ -16,6 +17,7 @@
 #endif
 
 #include "../global/Array.h"
+#include "CompressionStats.h"
 #include "GmcpMessage.h"
 #include "GmcpModule.h"
 #include "TextCodec.h"
@@ -106,6 +108,11 @@ class AbstractTelnet : public QObject
     NODISCARD QByteArray getTerminalType() const { return termType; }
     /* unused */
     NODISCARD int64_t getSentBytes() const { return sentBytes; }
+    NODISCARD CompressionStats::Values getCompressionStats() const
+    {
+        return m_compressionStats.getValues();
+    }
+    void resetCompressionStats() { m_compressionStats.reset(); }
 
     NODISCARD bool isGmcpModuleEnabled(const GmcpModuleTypeEnum &name)
     {
@@ -123,6 +130,7 @@ class AbstractTelnet : public QObject
     void sendTerminalTypeRequest();
     void sendGmcpMessage(const GmcpMessage &msg);
     void sendLineModeEdit();
+    void sendCompressBegin();
     void requestTelnetOption(unsigned char type, unsigned char subnegBuffer);
 
     /** Prepares data, doubles IACs, sends it using sendRawData. */
@@ -135,10 +143,14 @@ class AbstractTelnet : public QObject
     virtual void virt_receiveGmcpMessage(const GmcpMessage &) {}
     virtual void virt_receiveTerminalType(const QByteArray &) {}
     virtual void virt_receiveWindowSize(int, int) {}
+    // Only called for COMPRESS2 offered by requestTelnetOption(TN_WILL, ...).
+    virtual void virt_setCompressEnabled(bool) {}
     /// Send out the data. Does not double IACs, this must be done
     /// by caller if needed. This function is suitable for sending
     /// telnet sequences.
     virtual void virt_sendRawData(const std::string_view data) = 0;
+    /// The data may only be a view of the socket's read buffer, valid until
+    /// this returns; anything that keeps it must make its own copy.
     virtual void virt_sendToMapper(const QByteArray &, bool goAhead) = 0;
 
 protected:
@@ -147,6 +159,7 @@ class AbstractTelnet : public QObject
     void receiveGmcpMessage(const GmcpMessage &msg) { virt_receiveGmcpMessage(msg); }
     void receiveTerminalType(const QByteArray &ba) { virt_receiveTerminalType(ba); }
     void receiveWindowSize(int x, int y) { virt_receiveWindowSize(x, y); }
+    void setCompressEnabled(bool b) { virt_setCompressEnabled(b); }
 
     /// Send out the data. Does not double IACs, this must be done
     /// by caller if needed. This function is suitable for sending
@@ -196,6 +209,9 @@ class AbstractTelnet : public QObject
 
 private:
     void onReadInternal2(AppendBuffer &, uint8_t);
+    // Appends the plaintext before the next IAC in one go, and returns how many
+    // bytes that was; returns 0 unless in the NORMAL state.
+    NODISCARD int onReadInternalPlain(AppendBuffer &, const char *, int);
 
     /** processes a telnet command (IAC ...) */
     void processTelnetCommand(const AppendBuffer &command);
@@ -236,7 +252,11 @@ class AbstractTelnet : public QObject
 #ifndef MMAPPER_NO_ZLIB
     // REVIST: Refactor this to use PImpl
     z_stream stream;
+    // Inflated data is parsed straight out of this; it's kept between reads
+    // and grows while reads keep filling it.
+    std::vector<char> m_inflateBuffer;
 #endif
+    CompressionStats m_compressionStats;
     bool inflateTelnet = false;
     bool recvdCompress = false;
 };
@@ -0,0 +1,59 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "CompressionStats.h"
+
+#include <initializer_list>
+#include <sstream>
+
+std::string CompressionStats::Values::toString() const
+{
+    const double usec = static_cast<double>(inflateTime.count()) / 1000.0;
+    const double ratio = (compressedBytes == 0) ? 0.0
+                                                : static_cast<double>(inflatedBytes)
+                                                      / static_cast<double>(compressedBytes);
+    const uint64_t saved = (inflatedBytes > compressedBytes) ? (inflatedBytes - compressedBytes)
+                                                              : 0u;
+
+    std::ostringstream os;
+    os << "MCCP statistics:\n";
+    os << "  streams: " << streams << "\n";
+    os << "  compressed in: " << compressedBytes << " bytes, inflated out: " << inflatedBytes
+       << " bytes (" << ratio << ":1, " << saved << " bytes saved)\n";
+    os << "  inflate: " << usec << " us total";
+    if (inflatedBytes != 0) {
+        os << ", " << (usec * 1024.0 / static_cast<double>(inflatedBytes)) << " us per KiB";
+    }
+    os << "\n";
+    return os.str();
+}
+
+void CompressionStats::onInflated(const uint64_t compressedBytes,
+                                  const uint64_t inflatedBytes,
+                                  const std::chrono::nanoseconds elapsed)
+{
+    add(m_compressedBytes, compressedBytes);
+    add(m_inflatedBytes, inflatedBytes);
+    add(m_inflateNanos, static_cast<uint64_t>(elapsed.count()));
+}
+
+CompressionStats::Values CompressionStats::getValues() const
+{
+    static constexpr const auto relaxed = std::memory_order_relaxed;
+    Values result;
+    result.streams = m_streams.load(relaxed);
+    result.compressedBytes = m_compressedBytes.load(relaxed);
+    result.inflatedBytes = m_inflatedBytes.load(relaxed);
+    result.inflateTime = std::chrono::nanoseconds{m_inflateNanos.load(relaxed)};
+    return result;
+}
+
+void CompressionStats::reset()
+{
+    // NOTE: Also called from other threads; a concurrent update may survive the reset.
+    static constexpr const auto relaxed = std::memory_order_relaxed;
+    for (Counter *const counter :
+         {&m_streams, &m_compressedBytes, &m_inflatedBytes, &m_inflateNanos}) {
+        counter->store(0, relaxed);
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "../global/RuleOf5.h"
+#include "../global/macros.h"
+
+/**
+ * Counters describing how much MCCP (COMPRESS2) saves on the MUD connection.
+ *
+ * Like PathStats, only the telnet's thread updates them, with relaxed
+ * atomics, so they can be read from any thread.
+ */
+class NODISCARD CompressionStats final
+{
+public:
+    using Counter = std::atomic<uint64_t>;
+
+    // A plain copy of the counters at one point in time.
+    struct NODISCARD Values final
+    {
+        uint64_t streams = 0;
+        uint64_t compressedBytes = 0;
+        uint64_t inflatedBytes = 0;
+        std::chrono::nanoseconds inflateTime{};
+
+        NODISCARD std::string toString() const;
+    };
+
+private:
+    Counter m_streams{0};
+    Counter m_compressedBytes{0};
+    Counter m_inflatedBytes{0};
+    Counter m_inflateNanos{0};
+
+public:
+    CompressionStats() = default;
+    ~CompressionStats() = default;
+    DELETE_CTORS_AND_ASSIGN_OPS(CompressionStats);
+
+private:
+    static void add(Counter &counter, const uint64_t n)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+public:
+    void onStreamStarted() { add(m_streams, 1u); }
+    void onInflated(uint64_t compressedBytes,
+                    uint64_t inflatedBytes,
+                    std::chrono::nanoseconds elapsed);
+
+public:
+    NODISCARD Values getValues() const;
+    void reset();
+};
@@ -4,7 +4,9 @@
 #include "GmcpMessage.h"
 
 #include <exception>
+#include <mutex>
 #include <sstream>
+#include <unordered_map>
 
 #include "../global/TextUtils.h"
 #include "GmcpModule.h"
@@ -33,17 +35,22 @@ GmcpMessage::GmcpMessage(const GmcpMessageTypeEnum type)
 
 NODISCARD static GmcpMessageTypeEnum toGmcpMessageType(const std::string &str)
 {
-    const auto lower = ::toLowerLatin1(str);
-#define X_CASE(UPPER_CASE, CamelCase, normalized, friendly) \
-    do { \
-        if (lower.compare(normalized) == 0) \
-            return GmcpMessageTypeEnum::UPPER_CASE; \
-    } while (false);
-    X_FOREACH_GMCP_MESSAGE_TYPE(X_CASE)
-#undef X_CASE
-    return GmcpMessageTypeEnum::UNKNOWN;
+    static const std::unordered_map<std::string, GmcpMessageTypeEnum> types{
+#define X_ENTRY(UPPER_CASE, CamelCase, normalized, friendly) \
+    {normalized, GmcpMessageTypeEnum::UPPER_CASE},
+        X_FOREACH_GMCP_MESSAGE_TYPE(X_ENTRY)
+#undef X_ENTRY
+    };
+    const auto it = types.find(::toLowerLatin1(str));
+    return (it == types.end()) ? GmcpMessageTypeEnum::UNKNOWN : it->second;
 }
 
+struct NODISCARD GmcpMessage::LazyDocument final
+{
+    std::once_flag parsed;
+    std::optional<GmcpJsonDocument> document;
+};
+
 GmcpMessage::GmcpMessage()
     : name("")
     , type(GmcpMessageTypeEnum::UNKNOWN)
@@ -57,24 +64,39 @@ GmcpMessage::GmcpMessage(const std::string &package)
 GmcpMessage::GmcpMessage(const std::string &package, const std::string &json)
     : name(package)
     , json(GmcpJson{json})
-    , document(GmcpJsonDocument::fromJson(::toQByteArrayUtf8(json)))
+    , document(std::make_shared<LazyDocument>())
     , type(toGmcpMessageType(package))
 {}
 
 GmcpMessage::GmcpMessage(const GmcpMessageTypeEnum type, const QString &json)
     : name(toGmcpMessageName(type))
     , json(::toStdStringUtf8(json))
-    , document(GmcpJsonDocument::fromJson(json.toUtf8()))
+    , document(std::make_shared<LazyDocument>())
     , type(type)
 {}
 
 GmcpMessage::GmcpMessage(const GmcpMessageTypeEnum type, const std::string &json)
     : name(toGmcpMessageName(type))
     , json(GmcpJson{json})
-    , document(GmcpJsonDocument::fromJson(::toQByteArrayUtf8(json)))
+    , document(std::make_shared<LazyDocument>())
     , type(type)
 {}
 
+const std::optional<GmcpJsonDocument> &GmcpMessage::getJsonDocument() const
+{
+    static const std::optional<GmcpJsonDocument> none;
+    if (!json || document == nullptr)
+        return none;
+
+    // Several consumers (possibly on different threads) see the same message,
+    // but only the first one to look at the document pays for parsing it.
+    LazyDocument &lazy = *document;
+    std::call_once(lazy.parsed, [this, &lazy]() {
+        lazy.document = GmcpJsonDocument::fromJson(json->toQByteArray());
+    });
+    return lazy.document;
+}
+
 QByteArray GmcpMessage::toRawBytes() const
 {
     std::ostringstream oss;
@@ -3,6 +3,7 @@
 // Copyright (C) 2019 The MMapper Authors
 
 #include <cstdint>
+#include <memory>
 #include <optional>
 #include <string>
 #include <QByteArray>
@@ -70,10 +71,14 @@ using GmcpJsonDocument = QJsonDocument;
 
 class GmcpMessage final
 {
+private:
+    struct LazyDocument;
+
 private:
     GmcpMessageName name;
     std::optional<GmcpJson> json;
-    std::optional<GmcpJsonDocument> document;
+    // Parsed on first use, once for this message and all of its copies.
+    std::shared_ptr<LazyDocument> document;
     GmcpMessageTypeEnum type = GmcpMessageTypeEnum::UNKNOWN;
 
 public:
@@ -93,7 +98,7 @@ class GmcpMessage final
 public:
     NODISCARD const GmcpMessageName &getName() const { return name; }
     NODISCARD const std::optional<GmcpJson> &getJson() const { return json; }
-    NODISCARD const std::optional<GmcpJsonDocument> &getJsonDocument() const { return document; }
+    NODISCARD const std::optional<GmcpJsonDocument> &getJsonDocument() const;
 
 public:
     NODISCARD QByteArray toRawBytes() const;
@@ -12,6 +12,9 @@
 
 #include "../configuration/configuration.h"
 #include "../display/MapCanvasConfig.h"
+#include "../global/EventTrace.h"
+#include "../global/LatencyTrace.h"
+#include "../global/PerfCounters.h"
 #include "../global/TextUtils.h"
 #include "../global/Version.h"
 #include "GmcpUtils.h"
@@ -55,6 +58,9 @@ void MudTelnet::slot_onDisconnected()
 
 void MudTelnet::slot_onAnalyzeMudStream(const QByteArray &data)
 {
+    event_trace::Scope scope{"MudTelnet"};
+    latency_trace::mark(LatencyStageEnum::TELNET);
+    perf_counters::add(PerfCounterEnum::MUD_BYTES, static_cast<uint64_t>(data.size()));
     onReadInternal(data);
 }
 
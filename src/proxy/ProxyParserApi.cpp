@@ -73,3 +73,27 @@ bool ProxyParserApi::isGmcpModuleEnabled(const GmcpModuleTypeEnum &module) const
         [&module, &result](Proxy &proxy) { result = proxy.isGmcpModuleEnabled(module); });
     return result;
 }
+
+PathStats::Values ProxyParserApi::getPathStats() const
+{
+    PathStats::Values result;
+    m_proxy.acceptVisitor([&result](Proxy &proxy) { result = proxy.getPathStats(); });
+    return result;
+}
+
+void ProxyParserApi::resetPathStats() const
+{
+    m_proxy.acceptVisitor([](Proxy &proxy) { proxy.resetPathStats(); });
+}
+
+CompressionStats::Values ProxyParserApi::getCompressionStats() const
+{
+    CompressionStats::Values result;
+    m_proxy.acceptVisitor([&result](Proxy &proxy) { result = proxy.getCompressionStats(); });
+    return result;
+}
+
+void ProxyParserApi::resetCompressionStats() const
+{
+    m_proxy.acceptVisitor([](Proxy &proxy) { proxy.resetCompressionStats(); });
+}
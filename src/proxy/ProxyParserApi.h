@@ -6,6 +6,8 @@
 #include <QByteArray>
 
 #include "../global/WeakHandle.h"
+#include "../pathmachine/PathStats.h"
+#include "CompressionStats.h"
 #include "GmcpMessage.h"
 #include "GmcpModule.h"
 
@@ -42,4 +44,12 @@ class NODISCARD ProxyParserApi final
     void gmcpToMud(const GmcpMessage &msg) const;
     void gmcpToUser(const GmcpMessage &msg) const;
     NODISCARD bool isGmcpModuleEnabled(const GmcpModuleTypeEnum &module) const;
+
+public:
+    NODISCARD PathStats::Values getPathStats() const;
+    void resetPathStats() const;
+
+public:
+    NODISCARD CompressionStats::Values getCompressionStats() const;
+    void resetCompressionStats() const;
 };
@@ -0,0 +1,194 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "SessionReplay.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QMetaObject>
+
+#include "../global/EventTrace.h"
+#include "../global/LatencyTrace.h"
+#include "../global/TextUtils.h"
+
+static constexpr const quint32 RECORDING_MAGIC = 0x4D4D5250u; // "MMRP"
+static constexpr const quint32 RECORDING_VERSION = 1;
+static constexpr const QDataStream::Version STREAM_VERSION = QDataStream::Qt_5_0;
+
+NODISCARD static session_replay::Options &getMutableOptions()
+{
+    static session_replay::Options options;
+    return options;
+}
+
+void session_replay::setOptions(const Options &options)
+{
+    getMutableOptions() = options;
+}
+
+const session_replay::Options &session_replay::getOptions()
+{
+    return getMutableOptions();
+}
+
+std::vector<session_replay::Chunk> session_replay::load(const QString &fileName)
+{
+    QFile file{fileName};
+    if (!file.open(QFile::ReadOnly))
+        throw std::runtime_error(::toStdStringUtf8(file.errorString()));
+
+    QDataStream stream{&file};
+    stream.setVersion(STREAM_VERSION);
+    quint32 magic = 0;
+    quint32 version = 0;
+    stream >> magic >> version;
+    if (magic != RECORDING_MAGIC)
+        throw std::runtime_error("not a session recording");
+    if (version != RECORDING_VERSION)
+        throw std::runtime_error("unsupported session recording version");
+
+    std::vector<Chunk> chunks;
+    while (!stream.atEnd()) {
+        qint64 millis = 0;
+        QByteArray data;
+        stream >> millis >> data;
+        // A recording that was cut short still replays up to there.
+        if (stream.status() != QDataStream::Ok)
+            break;
+        chunks.emplace_back(Chunk{millis, std::move(data)});
+    }
+    return chunks;
+}
+
+session_replay::Recorder::Recorder(const QString &fileName)
+    : m_file{fileName}
+{
+    if (!m_file.open(QFile::WriteOnly | QFile::Truncate))
+        throw std::runtime_error(::toStdStringUtf8(m_file.errorString()));
+
+    QDataStream stream{&m_file};
+    stream.setVersion(STREAM_VERSION);
+    stream << RECORDING_MAGIC << RECORDING_VERSION;
+    m_elapsed.start();
+}
+
+session_replay::Recorder::~Recorder() = default;
+
+void session_replay::Recorder::write(const QByteArray &data)
+{
+    if (m_failed)
+        return;
+
+    QDataStream stream{&m_file};
+    stream.setVersion(STREAM_VERSION);
+    stream << static_cast<qint64>(m_elapsed.elapsed()) << data;
+    if (stream.status() != QDataStream::Ok) {
+        qWarning() << "Unable to write the session recording" << m_file.fileName();
+        m_failed = true;
+    }
+}
+
+MumeReplaySocket::MumeReplaySocket(QObject *const parent)
+    : MumeSocket(parent)
+    , m_timer{this}
+{
+    m_timer.setSingleShot(true);
+    connect(&m_timer, &QTimer::timeout, this, &MumeReplaySocket::playDueChunks);
+}
+
+MumeReplaySocket::~MumeReplaySocket() = default;
+
+void MumeReplaySocket::virt_connectToHost()
+{
+    const auto &options = session_replay::getOptions();
+    try {
+        m_chunks = session_replay::load(options.replayFile);
+    } catch (const std::exception &e) {
+        emit sig_socketError(QString("Unable to replay %1: %2.")
+                                 .arg(options.replayFile, QString::fromLatin1(e.what())));
+        return;
+    }
+
+    proxy_log(QString("Replaying %1 reads from %2 at %3x speed.")
+                  .arg(m_chunks.size())
+                  .arg(options.replayFile)
+                  .arg(options.speed));
+    m_next = 0;
+    m_bytes = 0;
+    m_playing = true;
+    m_elapsed.start();
+    // Connecting is asynchronous for a real socket too.
+    QTimer::singleShot(0, this, [this]() {
+        if (!m_playing)
+            return;
+        slot_onConnect();
+        playDueChunks();
+    });
+}
+
+void MumeReplaySocket::virt_disconnectFromHost()
+{
+    if (!m_playing)
+        return;
+    m_playing = false;
+    m_timer.stop();
+    slot_onDisconnect();
+}
+
+QAbstractSocket::SocketState MumeReplaySocket::virt_state()
+{
+    return m_playing ? QAbstractSocket::ConnectedState : QAbstractSocket::UnconnectedState;
+}
+
+void MumeReplaySocket::playDueChunks()
+{
+    if (!m_playing)
+        return;
+    if (m_next == m_chunks.size()) {
+        finish();
+        return;
+    }
+
+    const double speed = session_replay::getOptions().speed;
+    const auto dueIn = [this, speed](const session_replay::Chunk &chunk) -> qint64 {
+        if (speed <= 0.0)
+            return 0;
+        const auto due = static_cast<qint64>(std::llround(static_cast<double>(chunk.millis)
+                                                          / speed));
+        return std::max<qint64>(0, due - m_elapsed.elapsed());
+    };
+
+    // One read per turn of the event loop, like the real socket.
+    const session_replay::Chunk &chunk = m_chunks[m_next];
+    if (const qint64 wait = dueIn(chunk); wait > 0) {
+        m_timer.start(static_cast<int>(std::min<qint64>(wait, 1 << 30)));
+        return;
+    }
+    ++m_next;
+    m_bytes += static_cast<size_t>(chunk.data.size());
+    {
+        event_trace::Scope scope{"MumeSocket::read"};
+        latency_trace::beginChunk();
+        emit sig_processMudStream(chunk.data);
+        latency_trace::endChunk();
+    }
+    // Emitting may have disconnected.
+    if (m_playing)
+        m_timer.start(0);
+}
+
+void MumeReplaySocket::finish()
+{
+    proxy_log(QString("Replayed %1 bytes in %2 ms.").arg(m_bytes).arg(m_elapsed.elapsed()));
+    m_playing = false;
+    slot_onDisconnect();
+    if (session_replay::getOptions().quitWhenDone) {
+        QMetaObject::invokeMethod(QCoreApplication::instance(),
+                                  &QCoreApplication::quit,
+                                  Qt::QueuedConnection);
+    }
+}
@@ -0,0 +1,104 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <QAbstractSocket>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QString>
+#include <QTimer>
+
+#include "../global/RuleOf5.h"
+#include "../global/macros.h"
+#include "mumesocket.h"
+
+/**
+ * Recording and replaying what MUME sent, for realistic and repeatable
+ * workloads: `--record <file>` saves every socket read of the session with
+ * its time, and `--replay <file> [--speed N]` plays them back through the
+ * whole proxy pipeline in place of the connection to MUME.
+ *
+ * The reads are kept raw (telnet, compression, GMCP and XML included), since
+ * the autolog only has the text that was eventually shown to the user.
+ */
+namespace session_replay {
+
+struct NODISCARD Options final
+{
+    QString recordFile;
+    QString replayFile;
+    // Speedup of the replay; 0 replays without any delays.
+    double speed = 1.0;
+    // Quit the application once the replay has finished (for headless runs).
+    bool quitWhenDone = false;
+};
+
+// Must be set before the first session starts.
+void setOptions(const Options &options);
+NODISCARD const Options &getOptions();
+NODISCARD inline bool isReplaying()
+{
+    return !getOptions().replayFile.isEmpty();
+}
+
+struct NODISCARD Chunk final
+{
+    // Since the start of the recording.
+    int64_t millis = 0;
+    QByteArray data;
+};
+
+// Throws on errors.
+NODISCARD std::vector<Chunk> load(const QString &fileName);
+
+class NODISCARD Recorder final
+{
+private:
+    QFile m_file;
+    QElapsedTimer m_elapsed;
+    bool m_failed = false;
+
+public:
+    // Throws if the file can't be written.
+    explicit Recorder(const QString &fileName);
+    ~Recorder();
+    DELETE_CTORS_AND_ASSIGN_OPS(Recorder);
+
+public:
+    void write(const QByteArray &data);
+};
+
+} // namespace session_replay
+
+// Plays a recording back as if MUME was sending it; what's sent to MUME is dropped.
+class MumeReplaySocket final : public MumeSocket
+{
+    Q_OBJECT
+
+private:
+    std::vector<session_replay::Chunk> m_chunks;
+    size_t m_next = 0;
+    size_t m_bytes = 0;
+    QElapsedTimer m_elapsed;
+    QTimer m_timer;
+    bool m_playing = false;
+
+public:
+    explicit MumeReplaySocket(QObject *parent);
+    ~MumeReplaySocket() final;
+
+private:
+    void virt_disconnectFromHost() final;
+    void virt_connectToHost() final;
+    void virt_sendToMud(const QByteArray &) final {}
+    NODISCARD QAbstractSocket::SocketState virt_state() final;
+    void virt_onError(QAbstractSocket::SocketError) final {}
+
+private:
+    void playDueChunks();
+    void finish();
+};
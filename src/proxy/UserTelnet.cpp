@@ -4,10 +4,15 @@
 
 #include "UserTelnet.h"
 
+#include <cassert>
 #include <sstream>
+#include <stdexcept>
 #include <QJsonDocument>
 
+#include "../configuration/configuration.h"
 #include "../global/Charset.h"
+#include "../global/LatencyTrace.h"
+#include "../global/PerfCounters.h"
 #include "../global/TextUtils.h"
 
 // REVISIT: Does this belong somewhere else?
@@ -63,15 +68,10 @@ NODISCARD static QByteArray decodeFromUser(const CharacterEncodingEnum encoding,
     case CharacterEncodingEnum::LATIN1:
         return ba;
     case CharacterEncodingEnum::UTF8: {
-        std::ostringstream oss;
-        for (const QChar qc : QString::fromUtf8(ba)) {
-            const auto codepoint = qc.unicode();
-            if (codepoint < 256) {
-                oss << static_cast<char>(codepoint & 0xFF);
-            } else
-                oss << "?";
-        }
-        return ::toQByteArrayLatin1(oss.str());
+        const auto sv = ::toStdStringViewLatin1(ba);
+        if (isPureAscii(sv))
+            return ba;
+        return ::toQByteArrayLatin1(utf8ToLatin1(sv));
     }
     default:
         break;
@@ -81,10 +81,28 @@ NODISCARD static QByteArray decodeFromUser(const CharacterEncodingEnum encoding,
 
 UserTelnet::UserTelnet(QObject *const parent)
     : AbstractTelnet(TextCodecStrategyEnum::AUTO_SELECT_CODEC, parent, "unknown")
-{}
+{
+#ifndef MMAPPER_NO_ZLIB
+    m_deflateStream.zalloc = Z_NULL;
+    m_deflateStream.zfree = Z_NULL;
+    m_deflateStream.opaque = Z_NULL;
+    if (deflateInit(&m_deflateStream, Z_DEFAULT_COMPRESSION) != Z_OK) {
+        throw std::runtime_error("Unable to initialize zlib");
+    }
+#endif
+}
+
+UserTelnet::~UserTelnet()
+{
+#ifndef MMAPPER_NO_ZLIB
+    deflateEnd(&m_deflateStream);
+#endif
+}
 
 void UserTelnet::slot_onConnected()
 {
+    // The previous client's stream, if any, is gone.
+    stopDeflating(false);
     reset();
     resetGmcpModules();
 
@@ -96,6 +114,9 @@ void UserTelnet::slot_onConnected()
     requestTelnetOption(TN_WILL, OPT_GMCP);
     // Request permission to replace IAC GA with IAC EOR
     requestTelnetOption(TN_WILL, OPT_EOR);
+    // Offer to compress everything we send (MCCP2)
+    if (!NO_ZLIB)
+        requestTelnetOption(TN_WILL, OPT_COMPRESS2);
 }
 
 void UserTelnet::slot_onAnalyzeUserStream(const QByteArray &data)
@@ -215,10 +236,68 @@ void UserTelnet::virt_receiveWindowSize(const int x, const int y)
             telnet sequences. */
 void UserTelnet::virt_sendRawData(const std::string_view data)
 {
+    latency_trace::mark(LatencyStageEnum::USER_SEND);
     sentBytes += data.length();
+    perf_counters::add(PerfCounterEnum::USER_BYTES, data.length());
+    if (m_deflating) {
+        emit sig_sendToSocket(deflateForUser(data, false));
+        return;
+    }
     emit sig_sendToSocket(::toQByteArrayLatin1(data));
 }
 
+void UserTelnet::virt_setCompressEnabled(const bool enabled)
+{
+    if (!enabled) {
+        stopDeflating(true);
+        return;
+    }
+#ifndef MMAPPER_NO_ZLIB
+    if (m_deflating)
+        return;
+    deflateReset(&m_deflateStream);
+    m_deflating = true;
+#endif
+}
+
+void UserTelnet::stopDeflating(const bool finish)
+{
+    if (!m_deflating)
+        return;
+    if (finish) {
+        // Ends the compressed stream; the client expects plain data after it.
+        emit sig_sendToSocket(deflateForUser(std::string_view{}, true));
+    }
+    m_deflating = false;
+}
+
+// Every call is flushed, so the client never waits for the rest of a prompt
+// or a go-ahead that's stuck in the compressor.
+QByteArray UserTelnet::deflateForUser(const std::string_view data, const bool finish)
+{
+#ifdef MMAPPER_NO_ZLIB
+    abort();
+#else
+    QByteArray result;
+    static constexpr const size_t CHUNK = 16 * 1024;
+    if (m_deflateBuffer.size() < CHUNK)
+        m_deflateBuffer.resize(CHUNK);
+
+    m_deflateStream.avail_in = static_cast<uInt>(data.size());
+    m_deflateStream.next_in = reinterpret_cast<const Bytef *>(data.data());
+    do {
+        m_deflateStream.avail_out = static_cast<uInt>(m_deflateBuffer.size());
+        m_deflateStream.next_out = reinterpret_cast<Bytef *>(m_deflateBuffer.data());
+        const int ret = deflate(&m_deflateStream, finish ? Z_FINISH : Z_SYNC_FLUSH);
+        assert(ret != Z_STREAM_ERROR); /* state not clobbered */
+        const auto outLen = m_deflateBuffer.size() - m_deflateStream.avail_out;
+        result.append(m_deflateBuffer.data(), static_cast<int>(outLen));
+    } while (m_deflateStream.avail_out == 0);
+    assert(m_deflateStream.avail_in == 0);
+    return result;
+#endif
+}
+
 bool UserTelnet::virt_isGmcpModuleEnabled(const GmcpModuleTypeEnum &name)
 {
     if (!myOptionState[OPT_GMCP])
@@ -5,6 +5,8 @@
 
 #include "AbstractTelnet.h"
 
+#include <string_view>
+#include <vector>
 #include <QByteArray>
 #include <QObject>
 
@@ -21,9 +23,16 @@ class UserTelnet final : public AbstractTelnet
         GmcpModuleSet modules;
     } gmcp{};
 
+#ifndef MMAPPER_NO_ZLIB
+    // MCCP2 toward the client; only used while m_deflating.
+    z_stream m_deflateStream{};
+    std::vector<char> m_deflateBuffer;
+#endif
+    bool m_deflating = false;
+
 public:
     explicit UserTelnet(QObject *parent);
-    ~UserTelnet() final = default;
+    ~UserTelnet() final;
 
 public slots:
     void slot_onSendToUser(const QByteArray &data, bool goAhead);
@@ -45,9 +54,13 @@ public slots:
     void virt_receiveGmcpMessage(const GmcpMessage &) final;
     void virt_receiveTerminalType(const QByteArray &) final;
     void virt_receiveWindowSize(int, int) final;
+    void virt_setCompressEnabled(bool) final;
     void virt_sendRawData(const std::string_view data) final;
 
 private:
     void receiveGmcpModule(const GmcpModule &, bool);
     void resetGmcpModules();
+    // Doesn't send anything unless `finish` is true.
+    void stopDeflating(bool finish);
+    NODISCARD QByteArray deflateForUser(std::string_view data, bool finish);
 };
@@ -6,12 +6,16 @@
 
 #include "connectionlistener.h"
 
+#include <algorithm>
 #include <memory>
 #include <QTcpSocket>
 #include <QThread>
 
 #include "../configuration/configuration.h"
+#include "../global/EventLoopWatchdog.h"
 #include "../global/TextUtils.h"
+#include "../mapdata/mapdata.h"
+#include "../pathmachine/mmapper2pathmachine.h"
 #include "proxy.h"
 
 ConnectionListenerTcpServer::ConnectionListenerTcpServer(ConnectionListener *const parent)
@@ -30,7 +34,6 @@ ConnectionListener::ConnectionListener(MapData &md,
                                        PrespammedPath &pp,
                                        Mmapper2Group &gm,
                                        MumeClock &mc,
-                                       MapCanvas &mca,
                                        GameObserver &go,
                                        QObject *const parent)
     : QObject(parent)
@@ -39,19 +42,21 @@ ConnectionListener::ConnectionListener(MapData &md,
     , m_prespammedPath{pp}
     , m_groupManager{gm}
     , m_mumeClock{mc}
-    , m_mapCanvas{mca}
     , m_gameOberver{go}
 {}
 
 ConnectionListener::~ConnectionListener()
 {
-    if (m_proxy) {
-        m_proxy.release(); // thread will delete the proxy
-    }
-    if (m_thread) {
-        m_thread->quit();
-        m_thread->wait();
-        m_thread.release(); // finished() and destroyed() signals will destruct the thread
+    for (auto &session : m_sessions) {
+        if (session->proxy) {
+            session->proxy.release(); // thread will delete the proxy
+        }
+        if (session->thread) {
+            session->thread->quit();
+            session->thread->wait();
+            // finished() and destroyed() signals will destruct the thread
+            session->thread.release();
+        }
     }
 }
 
@@ -92,62 +97,26 @@ void ConnectionListener::listen()
 
 void ConnectionListener::slot_onIncomingConnection(qintptr socketDescriptor)
 {
-    if (m_accept) {
+    const int maxSessions = getConfig().connection.proxyMaxSessions;
+    if (static_cast<int>(m_sessions.size()) < maxSessions) {
         log("New connection: accepted.");
-        m_accept = false;
         emit sig_clientSuccessfullyConnected();
-
-        m_proxy = std::make_unique<Proxy>(m_mapData,
-                                          m_pathMachine,
-                                          m_prespammedPath,
-                                          m_groupManager,
-                                          m_mumeClock,
-                                          m_mapCanvas,
-                                          m_gameOberver,
-                                          socketDescriptor,
-                                          *this);
-
-        if (getConfig().connection.proxyThreaded) {
-            m_thread = std::make_unique<QThread>();
-            m_proxy->moveToThread(m_thread.get());
-
-            // Proxy destruction stops the thread which then destroys itself on completion
-            connect(m_proxy.get(), &QObject::destroyed, m_thread.get(), &QThread::quit);
-            connect(m_thread.get(), &QThread::finished, m_thread.get(), &QObject::deleteLater);
-            connect(m_thread.get(), &QObject::destroyed, this, [this]() {
-                m_accept = true;
-                m_proxy.release();
-                m_thread.release();
-            });
-
-            // Make sure if the thread is interrupted that we kill the proxy
-            connect(m_thread.get(), &QThread::finished, m_proxy.get(), &QObject::deleteLater);
-
-            // Start the proxy when the thread starts
-            connect(m_thread.get(), &QThread::started, m_proxy.get(), &Proxy::slot_start);
-            m_thread->start();
-
-        } else {
-            connect(m_proxy.get(), &QObject::destroyed, this, [this]() {
-                m_accept = true;
-                m_proxy.release();
-            });
-            m_proxy->slot_start();
-        }
+        startSession(socketDescriptor);
 
     } else {
         log("New connection: rejected.");
         QTcpSocket tcpSocket;
         if (tcpSocket.setSocketDescriptor(socketDescriptor)) {
-            QByteArray ba("\033[0;1;37;41m"
-                          "You can't connect to MMapper more than once!"
-                          "\033[0m"
-                          "\n"
-                          "\n"
-                          "\033[1;37;41m"
-                          "Please close the existing connection."
-                          "\033[0m"
-                          "\n");
+            QByteArray ba("\033[0;1;37;41m");
+            ba.append(maxSessions == 1 ? "You can't connect to MMapper more than once!"
+                                       : "MMapper already has as many connections as it allows!");
+            ba.append("\033[0m"
+                      "\n"
+                      "\n"
+                      "\033[1;37;41m"
+                      "Please close an existing connection."
+                      "\033[0m"
+                      "\n");
             tcpSocket.write(ba);
             tcpSocket.flush();
             tcpSocket.disconnectFromHost();
@@ -155,3 +124,109 @@ void ConnectionListener::slot_onIncomingConnection(qintptr socketDescriptor)
         }
     }
 }
+
+void ConnectionListener::startSession(const qintptr socketDescriptor)
+{
+    auto session = std::make_unique<Session>();
+    session->id = m_nextSessionId++;
+
+    const bool hasPrimary = std::any_of(m_sessions.begin(),
+                                        m_sessions.end(),
+                                        [](const auto &other) {
+                                            return other->pathMachine.isNull();
+                                        });
+    if (hasPrimary) {
+        session->pathMachine = createSessionPathMachine(session->id);
+    }
+
+    session->proxy = std::make_unique<Proxy>(m_mapData,
+                                             hasPrimary ? *session->pathMachine
+                                                        : m_pathMachine,
+                                             m_prespammedPath,
+                                             m_groupManager,
+                                             m_mumeClock,
+                                             m_gameOberver,
+                                             socketDescriptor,
+                                             *this);
+
+    Proxy *const proxy = session->proxy.get();
+    if (getConfig().connection.proxyThreaded) {
+        session->thread = std::make_unique<QThread>();
+        QThread *const thread = session->thread.get();
+        proxy->moveToThread(thread);
+
+        // Proxy destruction stops the thread which then destroys itself on completion
+        connect(proxy, &QObject::destroyed, thread, &QThread::quit);
+        connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+        connect(thread, &QObject::destroyed, this, [this, proxy]() { endSession(proxy); });
+
+        // Make sure if the thread is interrupted that we kill the proxy
+        connect(thread, &QThread::finished, proxy, &QObject::deleteLater);
+
+        // Start the proxy when the thread starts
+        // (without a context object, this runs on the new thread)
+        connect(thread, &QThread::started, []() {
+            event_loop_watchdog::watchCurrentThread("proxy");
+        });
+        connect(thread, &QThread::started, proxy, &Proxy::slot_start);
+        m_sessions.emplace_back(std::move(session));
+        thread->start();
+
+    } else {
+        connect(proxy, &QObject::destroyed, this, [this, proxy]() { endSession(proxy); });
+        m_sessions.emplace_back(std::move(session));
+        proxy->slot_start();
+    }
+}
+
+void ConnectionListener::endSession(const Proxy *const proxy)
+{
+    const auto it = std::find_if(m_sessions.begin(), m_sessions.end(), [proxy](const auto &s) {
+        return s->proxy.get() == proxy;
+    });
+    if (it == m_sessions.end())
+        return;
+
+    Session &session = **it;
+    // Both have already deleted themselves.
+    session.proxy.release();
+    session.thread.release();
+    if (session.pathMachine != nullptr) {
+        emit sig_removeSessionMarker(session.id);
+        session.pathMachine->deleteLater();
+    }
+    m_sessions.erase(it);
+}
+
+QPointer<Mmapper2PathMachine> ConnectionListener::createSessionPathMachine(const int id)
+{
+    // Mirrors the wiring of the main path machine in MainWindow, except that this one never
+    // creates rooms, and reports its position to a marker of its own.
+    QPointer<Mmapper2PathMachine> pathMachine{new Mmapper2PathMachine(&m_mapData, this)};
+    Mmapper2PathMachine *const pm = pathMachine.data();
+    MapData *const md = &m_mapData;
+    connect(pm,
+            QOverload<RoomRecipient &, const Coordinate &>::of(&PathMachine::sig_lookingForRooms),
+            md,
+            QOverload<RoomRecipient &, const Coordinate &>::of(&MapData::lookingForRooms));
+    connect(pm,
+            QOverload<RoomRecipient &, const Coordinate &, int>::of(
+                &PathMachine::sig_lookingForRooms),
+            md,
+            QOverload<RoomRecipient &, const Coordinate &, int>::of(&MapData::lookingForRooms));
+    connect(pm,
+            QOverload<RoomRecipient &, const SigParseEvent &>::of(
+                &PathMachine::sig_lookingForRooms),
+            md,
+            QOverload<RoomRecipient &, const SigParseEvent &>::of(&MapData::lookingForRooms));
+    connect(pm,
+            QOverload<RoomRecipient &, RoomId>::of(&PathMachine::sig_lookingForRooms),
+            md,
+            QOverload<RoomRecipient &, RoomId>::of(&MapData::lookingForRooms));
+    connect(md, &MapFrontend::sig_clearingMap, pm, &PathMachine::slot_releaseAllPaths);
+    connect(pm, &Mmapper2PathMachine::sig_log, this, &ConnectionListener::sig_log);
+    connect(pm, &PathMachine::sig_playerMoved, this, [this, id](const Coordinate &c) {
+        emit sig_moveSessionMarker(id, c);
+    });
+    return pathMachine;
+}
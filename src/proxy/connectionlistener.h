@@ -15,8 +15,12 @@
 #include <QtCore>
 #include <QtGlobal>
 
+#include "../configuration/configuration.h"
+#include "../expandoracommon/coordinate.h"
+#include "../global/macros.h"
+#include "../mapdata/roomselection.h"
+
 class ConnectionListener;
-class MapCanvas;
 class MapData;
 class Mmapper2Group;
 class Mmapper2PathMachine;
@@ -50,7 +54,6 @@ class ConnectionListener final : public QObject
                                 PrespammedPath &,
                                 Mmapper2Group &,
                                 MumeClock &,
-                                MapCanvas &,
                                 GameObserver &,
                                 QObject *parent);
     ~ConnectionListener() final;
@@ -68,21 +71,43 @@ class ConnectionListener final : public QObject
     void sig_log(const QString &, const QString &);
     void sig_clientSuccessfullyConnected();
 
+    // The sessions' requests for whatever displays the map (none when headless).
+    void sig_mapChanged();
+    void sig_graphicsSettingsChanged();
+    void sig_newRoomSelection(const SigRoomSelection &);
+    void sig_infomarksChanged();
+    void sig_setMode(MapModeEnum);
+    void sig_moveSessionMarker(int session, const Coordinate &coord);
+    void sig_removeSessionMarker(int session);
+
 protected slots:
     void slot_onIncomingConnection(qintptr socketDescriptor);
 
+private:
+    void startSession(qintptr socketDescriptor);
+    void endSession(const Proxy *proxy);
+    NODISCARD QPointer<Mmapper2PathMachine> createSessionPathMachine(int id);
+
 private:
     MapData &m_mapData;
     Mmapper2PathMachine &m_pathMachine;
     PrespammedPath &m_prespammedPath;
     Mmapper2Group &m_groupManager;
     MumeClock &m_mumeClock;
-    MapCanvas &m_mapCanvas;
     GameObserver &m_gameOberver;
     using ServerList = std::vector<QPointer<ConnectionListenerTcpServer>>;
     ServerList m_servers;
-    std::unique_ptr<Proxy> m_proxy;
-    std::unique_ptr<QThread> m_thread;
 
-    bool m_accept = true;
+    // The first session uses m_pathMachine and the canvas' own marker; any further sessions
+    // (see Configuration::ConnectionSettings::proxyMaxSessions) each get their own path machine
+    // on the same MapData, and a marker of their own.
+    struct NODISCARD Session final
+    {
+        int id = 0;
+        std::unique_ptr<Proxy> proxy;
+        std::unique_ptr<QThread> thread;
+        QPointer<Mmapper2PathMachine> pathMachine;
+    };
+    std::vector<std::unique_ptr<Session>> m_sessions;
+    int m_nextSessionId = 0;
 };
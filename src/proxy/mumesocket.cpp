@@ -14,6 +14,9 @@
 #include <QtNetwork>
 
 #include "../configuration/configuration.h"
+#include "../global/EventTrace.h"
+#include "../global/LatencyTrace.h"
+#include "../global/TlsSessionCache.h"
 #include "../global/io.h"
 
 static constexpr int TIMEOUT_MILLIS = 30000;
@@ -107,6 +110,8 @@ MumeSslSocket::~MumeSslSocket()
 void MumeSslSocket::virt_connectToHost()
 {
     const auto &settings = getConfig().connection;
+    m_peer = tls_session_cache::makePeer(settings.remoteServerName, settings.remotePort);
+    tls_session_cache::prepare(m_socket, m_peer);
     m_socket.connectToHostEncrypted(settings.remoteServerName,
                                     settings.remotePort,
                                     QIODevice::ReadWrite);
@@ -124,7 +129,7 @@ void MumeSslSocket::virt_disconnectFromHost()
 void MumeSslSocket::virt_onConnect()
 {
     proxy_log("Negotiating handshake with server ...");
-    m_socket.setSocketOption(QAbstractSocket::LowDelayOption, true);
+    m_socket.setSocketOption(QAbstractSocket::LowDelayOption, getConfig().connection.proxyLowDelay);
     m_socket.setSocketOption(QAbstractSocket::KeepAliveOption, true);
     if (io::tuneKeepAlive(m_socket.socketDescriptor())) {
         proxy_log("Tuned TCP keep alive parameters for socket");
@@ -138,6 +143,8 @@ void MumeSslSocket::virt_onError(QAbstractSocket::SocketError e)
     // MUME disconnecting is not an error. We also handle timeouts separately.
     if (e != QAbstractSocket::RemoteHostClosedError && e != QAbstractSocket::SocketTimeoutError) {
         m_timer.stop();
+        if (e == QAbstractSocket::SslHandshakeFailedError)
+            tls_session_cache::forget(m_peer);
         slot_onError2(e, m_socket.errorString());
     }
 }
@@ -146,6 +153,7 @@ void MumeSslSocket::slot_onEncrypted()
 {
     m_timer.stop();
     proxy_log("Connection now encrypted ...");
+    tls_session_cache::remember(m_socket, m_peer);
     constexpr const bool LOG_CERT_INFO = true;
     if ((LOG_CERT_INFO)) {
         /* TODO: If we save the cert to config file, then we can notify the user if it changes! */
@@ -190,8 +198,12 @@ void MumeSslSocket::slot_onReadyRead()
     // REVISIT: check return value?
     MAYBE_UNUSED const auto ignored = //
         io::readAllAvailable(m_socket, m_buffer, [this](const QByteArray &byteArray) {
-            if (!byteArray.isEmpty())
-                emit sig_processMudStream(byteArray);
+            if (byteArray.isEmpty())
+                return;
+            event_trace::Scope scope{"MumeSocket::read"};
+            latency_trace::beginChunk();
+            emit sig_processMudStream(byteArray);
+            latency_trace::endChunk();
         });
 }
 
@@ -243,7 +255,7 @@ void MumeTcpSocket::virt_connectToHost()
 void MumeTcpSocket::virt_onConnect()
 {
     m_timer.stop();
-    m_socket.setSocketOption(QAbstractSocket::LowDelayOption, true);
+    m_socket.setSocketOption(QAbstractSocket::LowDelayOption, getConfig().connection.proxyLowDelay);
     m_socket.setSocketOption(QAbstractSocket::KeepAliveOption, true);
     if (io::tuneKeepAlive(m_socket.socketDescriptor())) {
         proxy_log("Tuned TCP keep alive parameters for socket");
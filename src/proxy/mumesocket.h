@@ -86,6 +86,8 @@ protected slots:
     io::buffer<(1 << 13)> m_buffer;
     QSslSocket m_socket;
     QTimer m_timer;
+    // See tls_session_cache.
+    QString m_peer;
 };
 
 class MumeTcpSocket final : public MumeSslSocket
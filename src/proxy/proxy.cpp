@@ -18,11 +18,9 @@
 
 #include "../clock/mumeclock.h"
 #include "../configuration/configuration.h"
-#include "../display/mapcanvas.h"
 #include "../display/prespammedpath.h"
 #include "../expandoracommon/parseevent.h"
 #include "../global/io.h"
-#include "../mainwindow/mainwindow.h"
 #include "../mpi/mpifilter.h"
 #include "../mpi/remoteedit.h"
 #include "../pandoragroup/mmapper2group.h"
@@ -31,6 +29,7 @@
 #include "../pathmachine/mmapper2pathmachine.h"
 #include "../roompanel/RoomManager.h"
 #include "MudTelnet.h"
+#include "SessionReplay.h"
 #include "UserTelnet.h"
 #include "connectionlistener.h"
 #include "mumesocket.h"
@@ -53,7 +52,6 @@ Proxy::Proxy(MapData &md,
              PrespammedPath &pp,
              Mmapper2Group &gm,
              MumeClock &mc,
-             MapCanvas &mca,
              GameObserver &go,
              qintptr &socketDescriptor,
              ConnectionListener &listener)
@@ -63,7 +61,6 @@ Proxy::Proxy(MapData &md,
     , m_prespammedPath(pp)
     , m_groupManager(gm)
     , m_mumeClock(mc)
-    , m_mapCanvas(mca)
     , m_gameObserver(go)
     , m_socketDescriptor(socketDescriptor)
     , m_listener(listener)
@@ -91,19 +88,13 @@ Proxy::~Proxy()
 
 void Proxy::slot_start()
 {
-    auto *const mw = dynamic_cast<MainWindow *>(m_listener.parent());
-    if (mw == nullptr) {
-        // dynamic cast can fail
-        assert(false);
-        return;
-    }
-
     m_userSocket = [this]() -> QPointer<QTcpSocket> {
         auto userSock = makeQPointer<QTcpSocket>(this);
         if (!userSock->setSocketDescriptor(m_socketDescriptor)) {
             return {};
         }
-        userSock->setSocketOption(QAbstractSocket::LowDelayOption, true);
+        userSock->setSocketOption(QAbstractSocket::LowDelayOption,
+                                  getConfig().connection.proxyLowDelay);
         userSock->setSocketOption(QAbstractSocket::KeepAliveOption, true);
         return userSock;
     }();
@@ -127,9 +118,13 @@ void Proxy::slot_start()
                                               *m_timers,
                                               this);
 
-    m_mudSocket = (!QSslSocket::supportsSsl() || !getConfig().connection.tlsEncryption)
-                      ? QPointer<MumeSocket>(makeQPointer<MumeTcpSocket>(this))
-                      : QPointer<MumeSocket>(makeQPointer<MumeSslSocket>(this));
+    m_mudSocket = [this]() -> QPointer<MumeSocket> {
+        if (session_replay::isReplaying())
+            return QPointer<MumeSocket>(makeQPointer<MumeReplaySocket>(this));
+        if (!QSslSocket::supportsSsl() || !getConfig().connection.tlsEncryption)
+            return QPointer<MumeSocket>(makeQPointer<MumeTcpSocket>(this));
+        return QPointer<MumeSocket>(makeQPointer<MumeSslSocket>(this));
+    }();
 
     auto *const userSocket = m_userSocket.data();
     auto *const userTelnet = m_userTelnet.data();
@@ -140,7 +135,8 @@ void Proxy::slot_start()
     auto *const mudSocket = m_mudSocket.data();
     auto *const remoteEdit = m_remoteEdit.data();
 
-    connect(this, &Proxy::sig_log, mw, &MainWindow::slot_log);
+    ConnectionListener *const listener = &m_listener;
+    connect(this, &Proxy::sig_log, listener, &ConnectionListener::sig_log);
     connect(this, &Proxy::sig_sendToMud, mudTelnet, &MudTelnet::slot_onSendToMud);
     connect(this, &Proxy::sig_sendToUser, userTelnet, &UserTelnet::slot_onSendToUser);
     connect(this, &Proxy::sig_gmcpToMud, mudTelnet, &MudTelnet::slot_onGmcpToMud);
@@ -205,16 +201,23 @@ void Proxy::slot_start()
             &AbstractParser::sig_showPath,
             &m_prespammedPath,
             &PrespammedPath::slot_setPath);
-    connect(parserXml, &AbstractParser::sig_mapChanged, &m_mapCanvas, &MapCanvas::mapChanged);
+    connect(parserXml,
+            &AbstractParser::sig_showPath,
+            &m_pathMachine,
+            &PathMachine::slot_setPrespam);
+    connect(parserXml,
+            &AbstractParser::sig_mapChanged,
+            listener,
+            &ConnectionListener::sig_mapChanged);
     connect(parserXml,
             &AbstractParser::sig_graphicsSettingsChanged,
-            &m_mapCanvas,
-            &MapCanvas::graphicsSettingsChanged);
-    connect(parserXml, &AbstractParser::sig_log, mw, &MainWindow::slot_log);
+            listener,
+            &ConnectionListener::sig_graphicsSettingsChanged);
+    connect(parserXml, &AbstractParser::sig_log, listener, &ConnectionListener::sig_log);
     connect(parserXml,
             &AbstractParser::sig_newRoomSelection,
-            &m_mapCanvas,
-            &MapCanvas::slot_setRoomSelection);
+            listener,
+            &ConnectionListener::sig_newRoomSelection);
 
     connect(userSocket, &QAbstractSocket::disconnected, parserXml, &AbstractParser::slot_reset);
 
@@ -289,23 +292,38 @@ void Proxy::slot_start()
             &MumeSocket::sig_disconnected,
             m_remoteEdit,
             &RemoteEdit::slot_onDisconnected);
+    if (const QString &recordFile = session_replay::getOptions().recordFile;
+        !recordFile.isEmpty()) {
+        try {
+            m_recorder = std::make_unique<session_replay::Recorder>(recordFile);
+            connect(mudSocket,
+                    &MumeSocket::sig_processMudStream,
+                    this,
+                    [this](const QByteArray &ba) { m_recorder->write(ba); });
+            log(QString("Recording the session to %1.").arg(recordFile));
+        } catch (const std::exception &e) {
+            log(QString("Unable to record the session to %1: %2.")
+                    .arg(recordFile, QString::fromLatin1(e.what())));
+        }
+    }
     connect(mudSocket,
             &MumeSocket::sig_processMudStream,
-            mudTelnet,
-            &MudTelnet::slot_onAnalyzeMudStream);
-    connect(mudSocket, &MumeSocket::sig_log, mw, &MainWindow::slot_log);
+            this,
+            [this, mudTelnet](const QByteArray &ba) {
+                const OutputBatch batch{*this};
+                mudTelnet->slot_onAnalyzeMudStream(ba);
+            });
+    connect(mudSocket, &MumeSocket::sig_log, listener, &ConnectionListener::sig_log);
 
     // connect signals emitted from user commands to change mode;
-    // they are connected here because proxy knows about both the parser
-    // (within which commands are handled) and the mainwindow, where the mode
-    // state is stored.
-    connect(parserXml, &AbstractParser::sig_setMode, mw, &MainWindow::slot_setMode);
+    // the listener's owner (the mainwindow, unless headless) stores the mode.
+    connect(parserXml, &AbstractParser::sig_setMode, listener, &ConnectionListener::sig_setMode);
 
     // emitted after modifying infomarks for _infomark command
     connect(parserXml,
             &AbstractParser::sig_infoMarksChanged,
-            &m_mapCanvas,
-            &MapCanvas::infomarksChanged);
+            listener,
+            &ConnectionListener::sig_infomarksChanged);
 
     connectToMud();
 }
@@ -430,6 +448,7 @@ void Proxy::slot_processUserStream()
     if (m_userSocket == nullptr)
         return;
 
+    const OutputBatch batch{*this};
     // REVISIT: check return value?
     MAYBE_UNUSED const auto ignored = //
         io::readAllAvailable(*m_userSocket, m_buffer, [this](const QByteArray &byteArray) {
@@ -438,6 +457,40 @@ void Proxy::slot_processUserStream()
         });
 }
 
+Proxy::OutputBatch::OutputBatch(Proxy &proxy)
+    : m_proxy{proxy}
+{
+    ++m_proxy.m_outputBatchDepth;
+}
+
+Proxy::OutputBatch::~OutputBatch()
+{
+    assert(m_proxy.m_outputBatchDepth > 0);
+    if (--m_proxy.m_outputBatchDepth == 0)
+        m_proxy.flushOutput();
+}
+
+void Proxy::flushOutput()
+{
+    if (!m_mudOutput.isEmpty()) {
+        if (m_mudSocket != nullptr)
+            m_mudSocket->sendToMud(m_mudOutput);
+        m_mudOutput.clear();
+    }
+    if (!m_userOutput.isEmpty()) {
+        if (m_userSocket != nullptr)
+            m_userSocket->write(m_userOutput);
+        m_userOutput.clear();
+    }
+}
+
+void Proxy::queueOutput(QByteArray &buffer, const QByteArray &ba)
+{
+    buffer.append(ba);
+    if (buffer.size() >= MAX_BATCHED_OUTPUT)
+        flushOutput();
+}
+
 void Proxy::slot_onSendToMudSocket(const QByteArray &ba)
 {
     if (m_mudSocket != nullptr) {
@@ -454,6 +507,8 @@ void Proxy::slot_onSendToMudSocket(const QByteArray &ba)
                            .toLatin1());
 
             m_parserXml->sendPromptToUser();
+        } else if (m_outputBatchDepth > 0) {
+            queueOutput(m_mudOutput, ba);
         } else {
             m_mudSocket->sendToMud(ba);
         }
@@ -465,7 +520,10 @@ void Proxy::slot_onSendToMudSocket(const QByteArray &ba)
 void Proxy::slot_onSendToUserSocket(const QByteArray &ba)
 {
     if (m_userSocket != nullptr) {
-        m_userSocket->write(ba);
+        if (m_outputBatchDepth > 0)
+            queueOutput(m_userOutput, ba);
+        else
+            m_userSocket->write(ba);
     } else {
         qWarning() << "User socket not available";
     }
@@ -495,7 +553,7 @@ void Proxy::connectToMud()
     case ServerStateEnum::OFFLINE:
     case ServerStateEnum::DISCONNECTED:
     case ServerStateEnum::ERROR: {
-        if (getConfig().general.mapMode == MapModeEnum::OFFLINE) {
+        if (getConfig().general.mapMode == MapModeEnum::OFFLINE && !session_replay::isReplaying()) {
             sendToUser(
                 "\n"
                 "\033[37;46m"
@@ -565,3 +623,27 @@ bool Proxy::isGmcpModuleEnabled(const GmcpModuleTypeEnum &module) const
 {
     return m_userTelnet->isGmcpModuleEnabled(module);
 }
+
+PathStats::Values Proxy::getPathStats() const
+{
+    // The counters are atomic, so this is safe even when the proxy is threaded.
+    return m_pathMachine.getStats();
+}
+
+void Proxy::resetPathStats()
+{
+    m_pathMachine.resetStats();
+}
+
+CompressionStats::Values Proxy::getCompressionStats() const
+{
+    if (m_mudTelnet == nullptr)
+        return CompressionStats::Values{};
+    return m_mudTelnet->getCompressionStats();
+}
+
+void Proxy::resetCompressionStats()
+{
+    if (m_mudTelnet != nullptr)
+        m_mudTelnet->resetCompressionStats();
+}
@@ -14,16 +14,18 @@
 #include <QtCore>
 #include <QtGlobal>
 
+#include "../global/RuleOf5.h"
 #include "../global/WeakHandle.h"
 #include "../global/io.h"
 #include "../pandoragroup/GroupManagerApi.h"
+#include "../pathmachine/PathStats.h"
+#include "CompressionStats.h"
 #include "../timers/CTimers.h"
 #include "GmcpMessage.h"
 #include "ProxyParserApi.h"
 #include "observer/gameobserver.h"
 
 class ConnectionListener;
-class MapCanvas;
 class MapData;
 class Mmapper2Group;
 class Mmapper2PathMachine;
@@ -39,6 +41,9 @@ class RoomManager;
 class TelnetFilter;
 class UserTelnet;
 class CTimers;
+namespace session_replay {
+class Recorder;
+} // namespace session_replay
 
 #undef ERROR // Bad dog, Microsoft; bad dog!!!
 
@@ -51,7 +56,6 @@ class Proxy final : public QObject
                    PrespammedPath &,
                    Mmapper2Group &,
                    MumeClock &,
-                   MapCanvas &,
                    GameObserver &,
                    qintptr &,
                    ConnectionListener &);
@@ -92,10 +96,36 @@ public slots:
     void gmcpToUser(const GmcpMessage &msg) { emit sig_gmcpToUser(msg); }
     void gmcpToMud(const GmcpMessage &msg) { emit sig_gmcpToMud(msg); }
     bool isGmcpModuleEnabled(const GmcpModuleTypeEnum &module) const;
+    NODISCARD PathStats::Values getPathStats() const;
+    void resetPathStats();
+    NODISCARD CompressionStats::Values getCompressionStats() const;
+    void resetCompressionStats();
     void log(const QString &msg) { emit sig_log("Proxy", msg); }
 
+private:
+    // Socket writes made while one of these exists are collected and written
+    // at once when the last one goes away, i.e. once the read that caused them
+    // has been completely processed (including its prompt and go-ahead).
+    class NODISCARD OutputBatch final
+    {
+    private:
+        Proxy &m_proxy;
+
+    public:
+        explicit OutputBatch(Proxy &proxy);
+        ~OutputBatch();
+        DELETE_CTORS_AND_ASSIGN_OPS(OutputBatch);
+    };
+    void flushOutput();
+    void queueOutput(QByteArray &buffer, const QByteArray &ba);
+
 private:
     io::buffer<(1 << 13)> m_buffer;
+    // Batched output is written early once it grows this large.
+    static constexpr const int MAX_BATCHED_OUTPUT = 1 << 16;
+    QByteArray m_userOutput;
+    QByteArray m_mudOutput;
+    int m_outputBatchDepth = 0;
     WeakHandleLifetime<Proxy> m_weakHandleLifetime{*this};
     ProxyParserApi m_proxyParserApi{m_weakHandleLifetime.getWeakHandle()};
 
@@ -104,7 +134,6 @@ public slots:
     PrespammedPath &m_prespammedPath;
     Mmapper2Group &m_groupManager;
     MumeClock &m_mumeClock;
-    MapCanvas &m_mapCanvas;
     GameObserver &m_gameObserver;
     const qintptr m_socketDescriptor;
     ConnectionListener &m_listener;
@@ -121,6 +150,7 @@ public slots:
     QPointer<MumeXmlParser> m_parserXml;
     QPointer<MumeSocket> m_mudSocket;
     QPointer<CTimers> m_timers;
+    std::unique_ptr<session_replay::Recorder> m_recorder;
 
     enum class NODISCARD ServerStateEnum {
         INITIALIZED,
@@ -6,9 +6,15 @@
 
 #include "telnetfilter.h"
 
+#include <cassert>
+#include <cstring>
+#include <utility>
 #include <QByteArray>
 #include <QObject>
 
+#include "../global/EventTrace.h"
+#include "../global/LatencyTrace.h"
+
 static constexpr const char ASCII_DEL = '\x08';
 static constexpr const char ASCII_CR = '\r';
 static constexpr const char ASCII_LF = '\n';
@@ -17,14 +23,48 @@ static_assert(ASCII_DEL == 8);
 static_assert(ASCII_LF == 10);
 static_assert(ASCII_CR == 13);
 
+NODISCARD static bool isSpecial(const char c)
+{
+    return c == ASCII_DEL || c == ASCII_CR || c == ASCII_LF;
+}
+
+// Returns the first DEL, CR or LF in [it, end), or end.
+NODISCARD static const char *findSpecial(const char *it, const char *const end)
+{
+    // Skips 8 plain bytes at a time; a word XORed with a byte repeated 8 times
+    // has a zero byte wherever it held that byte.
+    static constexpr const uint64_t ONES = 0x0101010101010101u;
+    static constexpr const uint64_t HIGHS = 0x8080808080808080u;
+    static constexpr const uint64_t DELS = ONES * static_cast<uint8_t>(ASCII_DEL);
+    static constexpr const uint64_t CRS = ONES * static_cast<uint8_t>(ASCII_CR);
+    static constexpr const uint64_t LFS = ONES * static_cast<uint8_t>(ASCII_LF);
+    const auto hasZeroByte = [](const uint64_t v) -> bool {
+        return ((v - ONES) & ~v & HIGHS) != 0;
+    };
+
+    for (; end - it >= 8; it += 8) {
+        uint64_t word = 0;
+        std::memcpy(&word, it, sizeof(word));
+        if (hasZeroByte(word ^ DELS) || hasZeroByte(word ^ CRS) || hasZeroByte(word ^ LFS))
+            break;
+    }
+    for (; it != end; ++it) {
+        if (isSpecial(*it))
+            return it;
+    }
+    return end;
+}
+
 void TelnetFilter::slot_onAnalyzeMudStream(const QByteArray &ba, bool goAhead)
 {
+    event_trace::Scope scope{"TelnetFilter"};
+    latency_trace::mark(LatencyStageEnum::FILTER);
     dispatchTelnetStream(ba, m_mudIncomingBuffer, m_mudIncomingQue, goAhead);
 
     // parse incoming lines in que
-    TelnetData data;
-    while (!m_mudIncomingQue.isEmpty()) {
-        data = m_mudIncomingQue.dequeue();
+    while (!m_mudIncomingQue.empty()) {
+        const TelnetData data = std::move(m_mudIncomingQue.front());
+        m_mudIncomingQue.pop_front();
         emit sig_parseNewMudInput(data);
     }
 }
@@ -34,9 +74,9 @@ void TelnetFilter::slot_onAnalyzeUserStream(const QByteArray &ba, bool goAhead)
     dispatchTelnetStream(ba, m_userIncomingData, m_userIncomingQue, goAhead);
 
     // parse incoming lines in que
-    TelnetData data;
-    while (!m_userIncomingQue.isEmpty()) {
-        data = m_userIncomingQue.dequeue();
+    while (!m_userIncomingQue.empty()) {
+        const TelnetData data = std::move(m_userIncomingQue.front());
+        m_userIncomingQue.pop_front();
         emit sig_parseNewUserInput(data);
     }
 }
@@ -46,14 +86,39 @@ void TelnetFilter::dispatchTelnetStream(const QByteArray &stream,
                                         TelnetIncomingDataQueue &que,
                                         const bool &goAhead)
 {
-    for (const char c : stream) {
+    const auto enqueue = [&buffer, &que](const TelnetDataEnum type) {
+        buffer.type = type;
+        que.emplace_back(std::move(buffer));
+        buffer = TelnetData{};
+    };
+
+    // NOTE: `stream` may only be a view of the socket's buffer, so everything
+    // that's kept is appended to buffer.line; that's the only copy it makes.
+    const char *const end = stream.data() + stream.size();
+    for (const char *it = stream.data(); it != end;) {
+        // Plain text is appended a run at a time, along with the CRLF ending
+        // its line, so most lines are a single slice of the stream.
+        const char *const runEnd = findSpecial(it, end);
+        if (runEnd != it) {
+            if (!buffer.line.isEmpty() && buffer.line.back() == ASCII_LF) {
+                enqueue(TelnetDataEnum::LF);
+            }
+            const bool endsWithCrlf = end - runEnd >= 2 && runEnd[0] == ASCII_CR
+                                      && runEnd[1] == ASCII_LF;
+            const char *const sliceEnd = endsWithCrlf ? (runEnd + 2) : runEnd;
+            buffer.line.append(it, static_cast<int>(sliceEnd - it));
+            it = sliceEnd;
+            if (endsWithCrlf) {
+                enqueue(TelnetDataEnum::CRLF);
+            }
+            continue;
+        }
+
+        const char c = *it++;
         switch (c) {
         case ASCII_DEL:
             buffer.line.append(ASCII_DEL);
-            buffer.type = TelnetDataEnum::DELAY;
-            que.enqueue(buffer);
-            buffer.line.clear();
-            buffer.type = TelnetDataEnum::UNKNOWN;
+            enqueue(TelnetDataEnum::DELAY);
             break;
 
         case ASCII_CR:
@@ -61,52 +126,25 @@ void TelnetFilter::dispatchTelnetStream(const QByteArray &stream,
             break;
 
         case ASCII_LF:
-            if (!buffer.line.isEmpty()) {
-                switch (buffer.line.back()) {
-                case ASCII_CR:
-                    buffer.line.append(ASCII_LF);
-                    buffer.type = TelnetDataEnum::CRLF;
-                    que.enqueue(buffer);
-                    buffer.line.clear();
-                    buffer.type = TelnetDataEnum::UNKNOWN;
-                    break;
-
-                default:
-                    buffer.line.append(ASCII_LF);
-                    break;
-                }
+            if (!buffer.line.isEmpty() && buffer.line.back() == ASCII_CR) {
+                buffer.line.append(ASCII_LF);
+                enqueue(TelnetDataEnum::CRLF);
             } else {
                 buffer.line.append(ASCII_LF);
-                break;
             }
             break;
 
         default:
-            if (!buffer.line.isEmpty() && buffer.line.back() == ASCII_LF) {
-                buffer.type = TelnetDataEnum::LF;
-                que.enqueue(buffer);
-                buffer.line.clear();
-                buffer.type = TelnetDataEnum::UNKNOWN;
-            }
-
-            buffer.line.append(c);
+            assert(false);
             break;
         }
     }
 
     if (!buffer.line.isEmpty() && (goAhead || buffer.type == TelnetDataEnum::UNKNOWN)) {
-        {
-            if (goAhead) {
-                buffer.type = TelnetDataEnum::PROMPT;
-                que.enqueue(buffer);
-                buffer.line.clear();
-                buffer.type = TelnetDataEnum::UNKNOWN;
-            } else if (buffer.line.endsWith(ASCII_LF)) {
-                buffer.type = TelnetDataEnum::LF;
-                que.enqueue(buffer);
-                buffer.line.clear();
-                buffer.type = TelnetDataEnum::UNKNOWN;
-            }
+        if (goAhead) {
+            enqueue(TelnetDataEnum::PROMPT);
+        } else if (buffer.line.endsWith(ASCII_LF)) {
+            enqueue(TelnetDataEnum::LF);
         }
     }
 }
@@ -6,9 +6,9 @@
 // Author: Nils Schimmelmann <nschimme@gmail.com> (Jahara)
 
 #include <cstdint>
+#include <deque>
 #include <QByteArray>
 #include <QObject>
-#include <QQueue>
 #include <QString>
 #include <QtCore>
 
@@ -26,7 +26,7 @@ struct NODISCARD TelnetData final
 class TelnetFilter final : public QObject
 {
     Q_OBJECT
-    using TelnetIncomingDataQueue = QQueue<TelnetData>;
+    using TelnetIncomingDataQueue = std::deque<TelnetData>;
 
 public:
     explicit TelnetFilter(QObject *const parent)
@@ -0,0 +1,9 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+uniform vec4 uColor;
+
+void main()
+{
+    gl_FragColor = uColor;
+}
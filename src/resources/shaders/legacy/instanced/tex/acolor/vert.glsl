@@ -0,0 +1,18 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+uniform mat4 uMVP;
+
+attribute vec2 aCorner;
+attribute vec4 aInstanceColor;
+attribute vec3 aInstanceVert;
+
+varying vec4 vColor;
+varying vec2 vTexCoord;
+
+void main()
+{
+    vColor = aInstanceColor;
+    vTexCoord = aCorner;
+    gl_Position = uMVP * vec4(aInstanceVert + vec3(aCorner, 0.0), 1.0);
+}
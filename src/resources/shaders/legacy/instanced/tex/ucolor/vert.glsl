@@ -0,0 +1,15 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+uniform mat4 uMVP;
+
+attribute vec2 aCorner;
+attribute vec3 aInstanceVert;
+
+varying vec2 vTexCoord;
+
+void main()
+{
+    vTexCoord = aCorner;
+    gl_Position = uMVP * vec4(aInstanceVert + vec3(aCorner, 0.0), 1.0);
+}
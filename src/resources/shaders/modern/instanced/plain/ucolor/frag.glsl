@@ -0,0 +1,11 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+uniform vec4 uColor;
+
+out vec4 vFragmentColor;
+
+void main()
+{
+    vFragmentColor = uColor;
+}
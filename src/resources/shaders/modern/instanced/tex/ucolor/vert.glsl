@@ -0,0 +1,15 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+uniform mat4 uMVP;
+
+in vec2 aCorner;
+in vec3 aInstanceVert;
+
+out vec2 vTexCoord;
+
+void main()
+{
+    vTexCoord = aCorner;
+    gl_Position = uMVP * vec4(aInstanceVert + vec3(aCorner, 0.0), 1.0);
+}
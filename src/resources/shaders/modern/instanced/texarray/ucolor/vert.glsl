@@ -0,0 +1,15 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+uniform mat4 uMVP;
+
+in vec2 aCorner;
+in vec4 aInstanceVert; // w is the texture layer
+
+out vec3 vTexCoord;
+
+void main()
+{
+    vTexCoord = vec3(aCorner, aInstanceVert.w);
+    gl_Position = uMVP * vec4(aInstanceVert.xyz + vec3(aCorner, 0.0), 1.0);
+}
@@ -0,0 +1,18 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+uniform mat4 uMVP;
+
+in vec4 aColor;
+in vec2 aTexCoord;
+in vec3 aVert;
+
+out vec4 vColor;
+out vec2 vTexCoord;
+
+void main()
+{
+    vColor = aColor;
+    vTexCoord = aTexCoord;
+    gl_Position = uMVP * vec4(aVert, 1.0);
+}
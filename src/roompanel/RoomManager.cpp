@@ -23,6 +23,7 @@ RoomManager::~RoomManager() = default;
 void RoomManager::slot_reset()
 {
     m_room.resetMobs();
+    updateWidget();
 }
 
 void RoomManager::updateWidget()
@@ -84,7 +85,7 @@ void RoomManager::parseGmcpRemove(const GmcpMessage &msg)
         return;
     }
     if (m_room.removeMobById(id)) {
-        updateWidget();
+        emit sig_mobRemoved(id);
     }
 }
 
@@ -103,7 +104,11 @@ void RoomManager::parseGmcpSet(const GmcpMessage &msg)
     m_room.resetMobs();
     for (QJsonValueRef value : doc.array()) {
         if (value.isObject()) {
-            addMob(value.toObject());
+            // the whole table is refreshed once, below
+            RoomMobUpdate data;
+            if (toMob(value.toObject(), data)) {
+                m_room.addMob(std::move(data));
+            }
         } else {
             if (m_debug) {
                 qWarning().noquote()
@@ -134,19 +139,30 @@ void RoomManager::parseGmcpUpdate(const GmcpMessage &msg)
 void RoomManager::addMob(const QJsonObject &obj)
 {
     RoomMobUpdate data;
-    if (toMob(obj, data)) {
-        m_room.addMob(std::move(data));
-        updateWidget();
+    if (!toMob(obj, data)) {
+        return;
     }
+    const RoomMob::Id id = data.getId();
+    m_room.addMob(std::move(data));
+    emit sig_mobAdded(id);
 }
 
 void RoomManager::updateMob(const QJsonObject &obj)
 {
     RoomMobUpdate data;
-    if (toMob(obj, data)) {
-        if (m_room.updateMob(std::move(data))) {
-            updateWidget();
-        }
+    if (!toMob(obj, data)) {
+        return;
+    }
+    const RoomMob::Id id = data.getId();
+    const bool added = !m_room.isIdPresent(id);
+    const bool renamed = data.contains(MobFieldEnum::NAME);
+    if (!m_room.updateMob(std::move(data))) {
+        return;
+    }
+    if (added) {
+        emit sig_mobAdded(id);
+    } else {
+        emit sig_mobUpdated(id, renamed);
     }
 }
 
@@ -26,7 +26,11 @@ class RoomManager final : public QObject
     NODISCARD const RoomMobs &getRoom() const { return m_room; }
 
 signals:
-    void sig_updateWidget(); // update RoomWidget
+    void sig_updateWidget(); // reset RoomWidget
+    // Single mobs that changed, so RoomWidget only repaints their rows
+    void sig_mobAdded(RoomMob::Id id);
+    void sig_mobUpdated(RoomMob::Id id, bool renamed);
+    void sig_mobRemoved(RoomMob::Id id);
 
 public slots:
     void slot_reset();
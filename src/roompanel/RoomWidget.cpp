@@ -5,6 +5,7 @@
 
 #include "RoomWidget.h"
 
+#include <algorithm>
 #include <QAction>
 #include <QColor>
 #include <QHeaderView>
@@ -206,6 +207,79 @@ void RoomModel::update()
     endResetModel();
 }
 
+int RoomModel::findRow(const RoomMob::Id id) const
+{
+    const auto it = std::find_if(m_mobVector.begin(),
+                                 m_mobVector.end(),
+                                 [id](const SharedRoomMob &mob) { return mob->getId() == id; });
+    return it == m_mobVector.end() ? -1 : static_cast<int>(it - m_mobVector.begin());
+}
+
+void RoomModel::mobNamesChanged()
+{
+    // fighting and mount hold the ID of another mob, and show its name
+    if (m_mobVector.empty()) {
+        return;
+    }
+    const int lastRow = static_cast<int>(m_mobVector.size()) - 1;
+    emit dataChanged(index(0, static_cast<int>(ColumnTypeEnum::FIGHTING)),
+                     index(lastRow, static_cast<int>(ColumnTypeEnum::MOUNT)));
+}
+
+void RoomModel::addMob(const RoomMob::Id id)
+{
+    SharedRoomMob mob = m_room.getMobById(id);
+    if (!mob) {
+        return;
+    }
+    // An empty table still shows one blank row, and a mob that was replaced moves to the end:
+    // both are simpler to rebuild.
+    if (m_mobVector.empty() || m_mobsById.find(id) != m_mobsById.end()) {
+        update();
+        return;
+    }
+
+    // RoomMobs always shows new mobs last.
+    const int row = static_cast<int>(m_mobVector.size());
+    beginInsertRows(QModelIndex(), row, row);
+    m_mobsById.emplace(id, mob);
+    m_mobVector.push_back(std::move(mob));
+    endInsertRows();
+    mobNamesChanged();
+}
+
+void RoomModel::updateMob(const RoomMob::Id id, const bool renamed)
+{
+    const int row = findRow(id);
+    if (row < 0) {
+        addMob(id);
+        return;
+    }
+    // the fields were already updated in place
+    emit dataChanged(index(row, 0), index(row, ROOM_COLUMN_COUNT - 1));
+    if (renamed) {
+        mobNamesChanged();
+    }
+}
+
+void RoomModel::removeMob(const RoomMob::Id id)
+{
+    const int row = findRow(id);
+    if (row < 0) {
+        return;
+    }
+    if (m_mobVector.size() == 1) {
+        update();
+        return;
+    }
+
+    beginRemoveRows(QModelIndex(), row, row);
+    m_mobVector.erase(m_mobVector.begin() + row);
+    m_mobsById.erase(id);
+    endRemoveRows();
+    mobNamesChanged();
+}
+
 // ------------------------------- RoomWidget ----------------------------------
 RoomWidget::RoomWidget(RoomManager &rm, QWidget *const parent)
     : QWidget{parent}
@@ -228,11 +302,11 @@ RoomWidget::RoomWidget(RoomManager &rm, QWidget *const parent)
     // Minimize row height
     table->verticalHeader()->setDefaultSectionSize(table->verticalHeader()->minimumSectionSize());
 
-    connect(&m_roomManager,
-            &RoomManager::sig_updateWidget,
-            this,
-            &RoomWidget::slot_update,
-            Qt::QueuedConnection);
+    // Direct, so that each change is applied to the model before the next one arrives.
+    connect(&m_roomManager, &RoomManager::sig_updateWidget, this, &RoomWidget::slot_update);
+    connect(&m_roomManager, &RoomManager::sig_mobAdded, this, &RoomWidget::slot_mobAdded);
+    connect(&m_roomManager, &RoomManager::sig_mobUpdated, this, &RoomWidget::slot_mobUpdated);
+    connect(&m_roomManager, &RoomManager::sig_mobRemoved, this, &RoomWidget::slot_mobRemoved);
 
     readSettings();
 }
@@ -247,6 +321,21 @@ void RoomWidget::slot_update()
     m_model.update();
 }
 
+void RoomWidget::slot_mobAdded(const RoomMob::Id id)
+{
+    m_model.addMob(id);
+}
+
+void RoomWidget::slot_mobUpdated(const RoomMob::Id id, const bool renamed)
+{
+    m_model.updateMob(id, renamed);
+}
+
+void RoomWidget::slot_mobRemoved(const RoomMob::Id id)
+{
+    m_model.removeMob(id);
+}
+
 void RoomWidget::readSettings()
 {
     restoreGeometry(getConfig().roomPanel.geometry);
@@ -43,9 +43,16 @@ class RoomModel final : public QAbstractTableModel
     NODISCARD QVariant headerData(int section, Qt::Orientation orientation, int role) const override;
     NODISCARD Qt::ItemFlags flags(const QModelIndex &parent) const override;
 
+    // Rebuilds the whole table.
     void update();
+    // These only touch the rows of the mob, and the columns that may show its name.
+    void addMob(RoomMob::Id id);
+    void updateMob(RoomMob::Id id, bool renamed);
+    void removeMob(RoomMob::Id id);
 
 private:
+    NODISCARD int findRow(RoomMob::Id id) const;
+    void mobNamesChanged();
     NODISCARD SharedRoomMob getMob(const int row) const;
     NODISCARD RoomMob::Field getField(const ColumnTypeEnum column) const;
     NODISCARD const QVariant &getMobField(const int row, const int column) const;
@@ -71,6 +78,9 @@ class RoomWidget final : public QWidget
 
 public slots:
     void slot_update();
+    void slot_mobAdded(RoomMob::Id id);
+    void slot_mobUpdated(RoomMob::Id id, bool renamed);
+    void slot_mobRemoved(RoomMob::Id id);
 
 signals:
 
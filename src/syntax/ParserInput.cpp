@@ -3,30 +3,28 @@
 
 #include "ParserInput.h"
 
-#include <memory>
 #include <sstream>
-#include <vector>
 
 namespace syntax {
 
-ParserInput::ParserInput(std::shared_ptr<const std::vector<std::string>> v)
-    : m_vector(std::move(v))
+ParserInput::ParserInput(const UnquotedTokens &tokens)
+    : m_tokens{&tokens}
     , m_beg{0}
-    , m_end{m_vector->size()}
+    , m_end{tokens.size()}
 {}
 
-const std::string &ParserInput::front() const
+std::string_view ParserInput::front() const
 {
     if (empty())
         throw std::runtime_error("empty");
-    return m_vector->at(m_beg);
+    return (*m_tokens)[m_beg];
 }
 
-const std::string &ParserInput::back() const
+std::string_view ParserInput::back() const
 {
     if (empty())
         throw std::runtime_error("empty");
-    return m_vector->at(m_end - 1);
+    return (*m_tokens)[m_end - 1];
 }
 
 ParserInput ParserInput::subset(const size_t a, const size_t b) const
@@ -68,7 +66,7 @@ ParserInput ParserInput::rmid(size_t n) const
 void ParserInput::concatenate_into(std::ostream &os) const
 {
     bool first = true;
-    for (auto &s : *this) {
+    for (const std::string_view s : *this) {
         if (first)
             first = false;
         else
@@ -91,7 +89,7 @@ std::string ParserInput::concatenate() const
 ParserInput ParserInput::before(const ParserInput &other) const
 {
     assert(other.isSubsetOf(*this));
-    assert(this->m_vector == other.m_vector);
+    assert(this->m_tokens == other.m_tokens);
     assert(m_beg <= other.m_beg);
     assert(other.m_end <= m_end);
     return subset(0, other.m_beg - m_beg);
@@ -99,7 +97,7 @@ ParserInput ParserInput::before(const ParserInput &other) const
 
 bool ParserInput::isSubsetOf(const ParserInput &parent) const
 {
-    return m_vector == parent.m_vector && parent.m_beg <= m_beg && m_end <= parent.m_end;
+    return m_tokens == parent.m_tokens && parent.m_beg <= m_beg && m_end <= parent.m_end;
 }
 
 std::ostream &operator<<(std::ostream &os, const ParserInput &parserInput)
@@ -4,32 +4,34 @@
 
 #include <cassert>
 #include <iostream>
-#include <memory>
-#include <vector>
+#include <string_view>
 
 #include "../global/TextUtils.h"
+#include "../global/unquote.h"
 
 namespace syntax {
+// A range of the tokens of a command line; copying it is cheap, and the tokens
+// must outlive it.
 class ParserInput final
 {
 private:
-    std::shared_ptr<const std::vector<std::string>> m_vector;
+    const UnquotedTokens *m_tokens;
     size_t m_beg;
     size_t m_end;
 
 public:
-    explicit ParserInput(std::shared_ptr<const std::vector<std::string>> v);
+    explicit ParserInput(const UnquotedTokens &tokens);
     DEFAULT_RULE_OF_5(ParserInput);
 
     NODISCARD bool empty() const { return m_beg == m_end; }
     NODISCARD size_t size() const { return m_end - m_beg; }
     NODISCARD size_t length() const { return size(); }
 
-    NODISCARD const std::string &front() const;
-    NODISCARD const std::string &back() const;
+    NODISCARD std::string_view front() const;
+    NODISCARD std::string_view back() const;
 
-    NODISCARD auto begin() const { return m_vector->data() + m_beg; }
-    NODISCARD auto end() const { return m_vector->data() + m_end; }
+    NODISCARD auto begin() const { return m_tokens->data() + m_beg; }
+    NODISCARD auto end() const { return m_tokens->data() + m_end; }
 
     NODISCARD ParserInput subset(size_t a, size_t b) const;
 
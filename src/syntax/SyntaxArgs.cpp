@@ -19,8 +19,8 @@ NODISCARD static Vector toVector(const ParserInput &input)
 {
     std::vector<Value> values;
     values.reserve(input.size());
-    for (const std::string &s : input) {
-        values.emplace_back(s);
+    for (const std::string_view s : input) {
+        values.emplace_back(std::string{s});
     }
     return Vector{std::exchange(values, {})};
 }
@@ -302,7 +302,8 @@ MatchResult ArgFloat::virt_match(const ParserInput &input, IMatchErrorLogger *lo
     if (input.empty())
         return MatchResult::failure(input);
 
-    const std::string &firstWord = input.front();
+    // NOTE: strtof needs the terminating null; this fits in the small string buffer.
+    const std::string firstWord{input.front()};
     using Limits = std::numeric_limits<float>;
     const float minVal = arg.min.value_or(Limits::min());
     const float maxVal = arg.max.value_or(Limits::max());
@@ -452,7 +453,7 @@ MatchResult ArgString::virt_match(const ParserInput &input, IMatchErrorLogger *
     if (input.length() != 1)
         return MatchResult::failure(input);
 
-    return MatchResult::success(1, input, Value{input.front()});
+    return MatchResult::success(1, input, Value{std::string{input.front()}});
 }
 
 std::ostream &ArgString::virt_to_stream(std::ostream &os) const
@@ -460,7 +461,7 @@ std::ostream &ArgString::virt_to_stream(std::ostream &os) const
     return os << "<string>";
 }
 
-NODISCARD static bool compareIgnoreCase(const std::string &a, const std::string &b)
+NODISCARD static bool compareIgnoreCase(const std::string_view a, const std::string_view b)
 {
     const auto size = a.size();
     if (size != b.size())
@@ -403,16 +403,14 @@ std::string processSyntax(const syntax::SharedConstSublist &syntax,
 {
     using namespace syntax;
 
-    const auto str = name + " " + args.toStdString();
-    const auto cmd = StringView{str};
-    auto v = unquote(cmd.getStdStringView(), true, false);
-    if (!v) {
-        throw std::runtime_error("input error: " + v.getUnquoteFailureReason());
+    // The tokens are views into name and args.
+    UnquotedTokens tokens;
+    tokens.push_back(name);
+    if (auto failure = unquoteInto(args.getStdStringView(), true, false, tokens)) {
+        throw std::runtime_error("input error: " + failure.value());
     }
 
-    const auto shared_vec = std::make_shared<const std::vector<std::string>>(v.getVectorOfStrings());
-
-    const ParserInput input(shared_vec);
+    const ParserInput input(tokens);
     std::stringstream ss;
     User u{ss};
     TreeParser parser{syntax, u};
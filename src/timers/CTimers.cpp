@@ -7,7 +7,7 @@
 #include <chrono>
 #include <iomanip>
 #include <iostream>
-#include <optional>
+#include <limits>
 #include <sstream>
 #include <QMutexLocker>
 
@@ -34,6 +34,11 @@ int64_t TTimer::elapsedMs() const
     return nowMs() - start;
 }
 
+int64_t TTimer::deadlineMs() const
+{
+    return start + duration;
+}
+
 CTimers::CTimers(QObject *const parent)
     : QObject(parent)
 {
@@ -69,14 +74,21 @@ bool CTimers::removeCountdown(const std::string &name)
 {
     QMutexLocker locker(&m_lock);
 
-    for (std::list<TTimer>::iterator it = m_countdowns.begin(); it != m_countdowns.end(); ++it) {
-        if (it->getName() == name) {
-            m_countdowns.erase(it);
-            return true;
-        }
-    }
+    const auto it = std::find_if(m_countdowns.begin(),
+                                 m_countdowns.end(),
+                                 [&name](const Countdown &c) { return c.timer.getName() == name; });
+    if (it == m_countdowns.end())
+        return false;
 
-    return false;
+    // Its deadline is skipped when it comes up; the timer isn't re-armed for it.
+    eraseCountdown(it);
+    return true;
+}
+
+void CTimers::eraseCountdown(const CountdownList::iterator it)
+{
+    m_countdownsById.erase(it->id);
+    m_countdowns.erase(it);
 }
 
 bool CTimers::removeTimer(const std::string &name)
@@ -97,59 +109,59 @@ void CTimers::addCountdown(const std::string &name, const std::string &desc, int
 {
     QMutexLocker locker(&m_lock);
 
-    TTimer countdown(name, desc, timeMs);
-    m_countdowns.push_back(std::move(countdown));
+    const uint64_t id = ++m_nextCountdownId;
+    const auto it = m_countdowns.insert(m_countdowns.end(),
+                                        Countdown{id, TTimer(name, desc, timeMs)});
+    m_countdownsById.emplace(id, it);
+
+    // Only re-arm if this is the new earliest deadline.
+    const Deadline deadline{it->timer.deadlineMs(), id};
+    const bool earliest = m_deadlines.empty() || deadline.atMs < m_deadlines.top().atMs;
+    m_deadlines.push(deadline);
+    if (earliest || !m_timer.isActive())
+        armTimer();
+}
+
+void CTimers::armTimer()
+{
+    // Drop the deadlines of countdowns that were removed.
+    while (!m_deadlines.empty() && m_countdownsById.count(m_deadlines.top().id) == 0)
+        m_deadlines.pop();
 
-    // See if we need to restart the timer
-    if (m_timer.isActive()) {
-        std::chrono::milliseconds left = m_timer.remainingTimeAsDuration();
-        if (timeMs < left.count()) {
-            m_timer.stop();
-            m_timer.start(static_cast<int>(timeMs));
-        }
+    if (m_deadlines.empty()) {
+        m_timer.stop();
         return;
     }
 
-    // Start the timer
-    m_timer.start(static_cast<int>(timeMs));
+    const int64_t left = std::clamp<int64_t>(m_deadlines.top().atMs - nowMs(),
+                                             0,
+                                             std::numeric_limits<int>::max());
+    m_timer.start(static_cast<int>(left));
 }
 
 void CTimers::slot_finishCountdownTimer()
 {
     QMutexLocker locker(&m_lock);
 
-    std::optional<int64_t> next;
-
-    // See if we need to restart the timer
-    std::list<TTimer>::iterator it = m_countdowns.begin();
-    while (it != m_countdowns.end()) {
-        const auto diff = it->durationMs() - it->elapsedMs();
-        if (diff <= 0) {
-            std::ostringstream ostr;
-            ostr << "Countdown timer " << it->getName();
-            if (!it->getDescription().empty())
-                ostr << " <" << it->getDescription() << ">";
-            ostr << " finished." << std::endl;
-            emit sig_sendTimersUpdateToUser(ostr.str());
-            it = m_countdowns.erase(it);
-        } else {
-            if (next)
-                next = std::min(diff, next.value());
-            else
-                next = diff;
-            ++it;
-        }
+    // Only the countdowns that are due are visited, earliest first.
+    const int64_t now = nowMs();
+    while (!m_deadlines.empty() && m_deadlines.top().atMs <= now) {
+        const auto found = m_countdownsById.find(m_deadlines.top().id);
+        m_deadlines.pop();
+        if (found == m_countdownsById.end())
+            continue;
+
+        const TTimer &countdown = found->second->timer;
+        std::ostringstream ostr;
+        ostr << "Countdown timer " << countdown.getName();
+        if (!countdown.getDescription().empty())
+            ostr << " <" << countdown.getDescription() << ">";
+        ostr << " finished." << std::endl;
+        emit sig_sendTimersUpdateToUser(ostr.str());
+        eraseCountdown(found->second);
     }
 
-    if (m_countdowns.empty())
-        return;
-
-    if (m_timer.isActive())
-        m_timer.stop();
-
-    // Restart the timer
-    if (next.value_or(0) > 0)
-        m_timer.start(static_cast<int>(next.value()));
+    armTimer();
 }
 
 std::string CTimers::getTimers()
@@ -176,7 +188,8 @@ std::string CTimers::getCountdowns()
 
     std::ostringstream ostr;
     ostr << "Countdowns:" << std::endl;
-    for (const auto &countdown : m_countdowns) {
+    for (const auto &entry : m_countdowns) {
+        const TTimer &countdown = entry.timer;
         const auto elapsed = msToMinSec(countdown.elapsedMs());
         const auto left = msToMinSec(countdown.durationMs() - countdown.elapsedMs());
         ostr << "- " << countdown.getName();
@@ -199,5 +212,8 @@ void CTimers::clear()
     QMutexLocker locker(&m_lock);
 
     m_countdowns.clear();
+    m_countdownsById.clear();
+    m_deadlines = {};
     m_timers.clear();
+    m_timer.stop();
 }
@@ -3,8 +3,12 @@
 // Copyright (C) 2023 The MMapper Authors
 
 #include <cstdint>
+#include <functional>
 #include <list>
+#include <queue>
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include <QMutex>
 #include <QObject>
 #include <QTimer>
@@ -22,6 +26,7 @@ class TTimer final
 public:
     int64_t durationMs() const { return duration; }
     int64_t elapsedMs() const;
+    int64_t deadlineMs() const;
 
 private:
     std::string name;
@@ -35,14 +40,39 @@ class CTimers final : public QObject
     Q_OBJECT
 
 private:
+    struct NODISCARD Countdown final
+    {
+        uint64_t id = 0;
+        TTimer timer;
+    };
+    struct NODISCARD Deadline final
+    {
+        int64_t atMs = 0;
+        uint64_t id = 0;
+
+        NODISCARD bool operator>(const Deadline &rhs) const
+        {
+            return atMs != rhs.atMs ? atMs > rhs.atMs : id > rhs.id;
+        }
+    };
+    using CountdownList = std::list<Countdown>;
+
     QMutex m_lock;
     std::list<TTimer> m_timers;
-    std::list<TTimer> m_countdowns;
+    // In the order they were added, for listing.
+    CountdownList m_countdowns;
+    std::unordered_map<uint64_t, CountdownList::iterator> m_countdownsById;
+    // Earliest first; a removed countdown's deadline stays until it reaches the top.
+    std::priority_queue<Deadline, std::vector<Deadline>, std::greater<>> m_deadlines;
+    uint64_t m_nextCountdownId = 0;
+    // Armed for the earliest deadline only.
     QTimer m_timer;
 
 private:
     std::string getTimers();
     std::string getCountdowns();
+    void eraseCountdown(CountdownList::iterator it);
+    void armTimer();
 
 signals:
     void sig_sendTimersUpdateToUser(const std::string &str);
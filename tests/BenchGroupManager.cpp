@@ -0,0 +1,511 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+// Group manager scale benchmark: starts a GroupServer on localhost and connects
+// N simulated clients to it, each speaking the group protocol over its own
+// GroupSocket. Every client sends prompt-rate character updates and the odd
+// group tell; the other clients time how long the server takes to relay them.
+//
+// Each protocol is run in turn: 102 is plain XML, 103 is XML over TLS and 104 is
+// CBOR over TLS. Server CPU is the time spent on the group manager's thread.
+//
+// usage: BenchGroupManager [--clients N] [--seconds S] [--update-rate U]
+//                          [--gtell-rate G] [--port P] [--protocol V]...
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <QByteArray>
+#include <QColor>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QMetaObject>
+#include <QSslSocket>
+#include <QString>
+#include <QTimer>
+#include <QVariantMap>
+#include <QtGlobal>
+
+#if defined(Q_OS_UNIX)
+#include <time.h>
+#endif
+
+#include "../src/configuration/configuration.h"
+#include "../src/global/utils.h"
+#include "../src/pandoragroup/CGroupChar.h"
+#include "../src/pandoragroup/CGroupCommunicator.h"
+#include "../src/pandoragroup/GroupSocket.h"
+#include "../src/pandoragroup/groupauthority.h"
+#include "../src/pandoragroup/mmapper2group.h"
+
+namespace { // anonymous
+
+using Clock = std::chrono::steady_clock;
+using MessagesEnum = CGroupCommunicator::MessagesEnum;
+
+// Marks labels and tells that carry a send time, as opposed to a real label.
+static constexpr const char TIMESTAMP_PREFIX = 't';
+
+struct NODISCARD Options final
+{
+    int clients = 25;
+    int seconds = 10;
+    // Per client, per second; about one prompt per combat round and then some.
+    double updateRate = 4.0;
+    double gtellRate = 0.2;
+    quint16 port = 14243;
+    std::vector<ProtocolVersion> protocols{CGroupCommunicator::PROTOCOL_VERSION_102,
+                                           CGroupCommunicator::PROTOCOL_VERSION_103,
+                                           CGroupCommunicator::PROTOCOL_VERSION_104};
+};
+
+struct NODISCARD Stats final
+{
+    // Microseconds from a client's send to another client's receipt.
+    std::vector<int64_t> updateLatencies;
+    std::vector<int64_t> gtellLatencies;
+    uint64_t updatesSent = 0;
+    uint64_t gtellsSent = 0;
+    uint64_t bytesToServer = 0;
+    uint64_t bytesFromServer = 0;
+    uint64_t kicked = 0;
+
+    void reset() { *this = Stats{}; }
+};
+
+NODISCARD int64_t nowUs()
+{
+    static const auto start = Clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+}
+
+NODISCARD QString makeTimestamp()
+{
+    return QString::number(nowUs()).prepend(QChar(TIMESTAMP_PREFIX));
+}
+
+void recordLatency(std::vector<int64_t> &latencies, const QString &timestamp)
+{
+    if (!timestamp.startsWith(QChar(TIMESTAMP_PREFIX)))
+        return;
+    bool ok = false;
+    const int64_t sent = timestamp.mid(1).toLongLong(&ok);
+    if (ok)
+        latencies.push_back(nowUs() - sent);
+}
+
+// A group member reduced to its protocol: it logs in, then sends whatever it's told to.
+class NODISCARD SimulatedClient final
+{
+private:
+    GroupSocket m_socket;
+    const ProtocolVersion m_version;
+    Stats &m_stats;
+    SharedGroupChar m_self = CGroupChar::alloc();
+    CharUpdateDeltas m_updates;
+
+public:
+    explicit SimulatedClient(GroupAuthority &authority,
+                             const QByteArray &name,
+                             const ProtocolVersion version,
+                             Stats &stats)
+        : m_socket{&authority, nullptr}
+        , m_version{version}
+        , m_stats{stats}
+    {
+        m_self->setName(name);
+        m_self->setLabel(name);
+        m_self->setColor(QColor(Qt::yellow));
+        m_self->setScore(300, 300, 100, 100, 150, 150);
+        m_self->setRoomId(RoomId{1});
+
+        QObject::connect(&m_socket,
+                         &GroupSocket::sig_incomingData,
+                         &m_socket,
+                         [this](GroupSocket *, const QByteArray &buff) { onMessage(buff); });
+        QObject::connect(&m_socket, &GroupSocket::sig_connectionEncrypted, &m_socket, [this]() {
+            sendLogin();
+        });
+    }
+    DELETE_CTORS_AND_ASSIGN_OPS(SimulatedClient);
+
+public:
+    void connectToHost() { m_socket.connectToHost(); }
+    void disconnectFromHost() { m_socket.disconnectFromHost(); }
+    NODISCARD bool isLogged() const
+    {
+        return m_socket.getProtocolState() == ProtocolStateEnum::Logged;
+    }
+
+    void sendUpdate(const uint64_t tick)
+    {
+        // Mostly score changes, like prompts in a fight; a move now and then.
+        CGroupChar &self = deref(m_self);
+        self.hp = 100 + static_cast<int>(tick % 200);
+        if (tick % 3 == 0)
+            self.moves = 50 + static_cast<int>(tick % 100);
+        if (tick % 20 == 0)
+            self.setRoomId(RoomId{static_cast<uint32_t>(1 + tick % 50)});
+        self.setLabel(makeTimestamp().toLatin1());
+
+        const QVariantMap full = self.toVariantMap();
+        const bool deltas = m_version >= CGroupCommunicator::PROTOCOL_VERSION_104;
+        send(MessagesEnum::UPDATE_CHAR, deltas ? m_updates.encode(full) : full);
+        ++m_stats.updatesSent;
+    }
+
+    void sendGroupTell()
+    {
+        QVariantMap root;
+        root["from"] = QString::fromLatin1(m_self->getName());
+        root["text"] = makeTimestamp();
+        send(MessagesEnum::GTELL, root);
+        ++m_stats.gtellsSent;
+    }
+
+private:
+    void send(const MessagesEnum message, const QVariantMap &data)
+    {
+        const ProtocolVersion version = m_socket.getProtocolVersion();
+        const QByteArray block = CGroupCommunicator::formMessageBlock(message, data, version);
+        m_stats.bytesToServer += static_cast<uint64_t>(block.size());
+        m_socket.sendData(block);
+    }
+
+    void sendLogin()
+    {
+        // Same as GroupClient::sendLoginInformation().
+        QVariantMap loginData = m_self->toVariantMap();
+        if (m_version == CGroupCommunicator::PROTOCOL_VERSION_102)
+            loginData["protocolVersion"] = m_version;
+        QVariantMap root;
+        root["loginData"] = loginData;
+        send(MessagesEnum::UPDATE_CHAR, root);
+    }
+
+    void onMessage(const QByteArray &buff)
+    {
+        m_stats.bytesFromServer += static_cast<uint64_t>(buff.size());
+
+        MessagesEnum message = MessagesEnum::NONE;
+        QVariantMap data;
+        if (!CGroupCommunicator::parseMessageBlock(buff, message, data))
+            return;
+
+        switch (message) {
+        case MessagesEnum::REQ_HANDSHAKE:
+            if (m_version == CGroupCommunicator::PROTOCOL_VERSION_102) {
+                sendLogin();
+            } else {
+                QVariantMap handshake;
+                handshake["protocolVersion"] = m_version;
+                send(MessagesEnum::REQ_HANDSHAKE, handshake);
+            }
+            break;
+        case MessagesEnum::REQ_LOGIN:
+            m_socket.setProtocolVersion(m_version);
+            m_socket.startClientEncrypted();
+            break;
+        case MessagesEnum::ACK:
+            if (m_socket.getProtocolState() == ProtocolStateEnum::AwaitingLogin) {
+                send(MessagesEnum::REQ_INFO, QVariantMap{});
+                m_socket.setProtocolState(ProtocolStateEnum::AwaitingInfo);
+            }
+            break;
+        case MessagesEnum::REQ_ACK:
+            send(MessagesEnum::ACK, QVariantMap{});
+            break;
+        case MessagesEnum::STATE_LOGGED:
+            m_socket.setProtocolState(ProtocolStateEnum::Logged);
+            break;
+        case MessagesEnum::STATE_KICKED:
+            ++m_stats.kicked;
+            break;
+        case MessagesEnum::UPDATE_CHAR:
+            if (isLogged()) {
+                const QVariantMap playerData = data["playerData"].toMap();
+                recordLatency(m_stats.updateLatencies, playerData["label"].toString());
+            }
+            break;
+        case MessagesEnum::GTELL:
+            recordLatency(m_stats.gtellLatencies, data["text"].toString());
+            break;
+        case MessagesEnum::NONE:
+        case MessagesEnum::PROT_VERSION:
+        case MessagesEnum::ADD_CHAR:
+        case MessagesEnum::REMOVE_CHAR:
+        case MessagesEnum::RENAME_CHAR:
+        case MessagesEnum::REQ_INFO:
+            break;
+        }
+    }
+};
+
+NODISCARD bool parseOptions(const QCoreApplication &app, Options &options)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measures a GroupServer under load from simulated clients.");
+    parser.addHelpOption();
+    const QCommandLineOption clientsOpt{"clients", "Number of clients.", "N", "25"};
+    const QCommandLineOption secondsOpt{"seconds", "Seconds of load per protocol.", "S", "10"};
+    const QCommandLineOption updateOpt{"update-rate", "Updates per client per second.", "U", "4"};
+    const QCommandLineOption gtellOpt{"gtell-rate", "Tells per client per second.", "G", "0.2"};
+    const QCommandLineOption portOpt{"port", "Local port for the server.", "P", "14243"};
+    const QCommandLineOption protocolOpt{"protocol",
+                                         "Protocol version to run (102, 103 or 104); repeatable.",
+                                         "V"};
+    parser.addOptions({clientsOpt, secondsOpt, updateOpt, gtellOpt, portOpt, protocolOpt});
+    parser.process(app);
+
+    bool ok = true;
+    const auto toInt = [&ok, &parser](const QCommandLineOption &opt) -> int {
+        bool optOk = false;
+        const int value = parser.value(opt).toInt(&optOk);
+        ok = ok && optOk && value > 0;
+        return value;
+    };
+    const auto toDouble = [&ok, &parser](const QCommandLineOption &opt) -> double {
+        bool optOk = false;
+        const double value = parser.value(opt).toDouble(&optOk);
+        ok = ok && optOk && value >= 0.0;
+        return value;
+    };
+
+    options.clients = toInt(clientsOpt);
+    options.seconds = toInt(secondsOpt);
+    options.updateRate = toDouble(updateOpt);
+    options.gtellRate = toDouble(gtellOpt);
+    const int port = toInt(portOpt);
+    ok = ok && port <= 65535;
+    options.port = static_cast<quint16>(port);
+
+    if (parser.isSet(protocolOpt)) {
+        options.protocols.clear();
+        for (const QString &value : parser.values(protocolOpt)) {
+            const uint version = value.toUInt();
+            ok = ok && version >= CGroupCommunicator::PROTOCOL_VERSION_102
+                 && version <= CGroupCommunicator::PROTOCOL_VERSION_104;
+            options.protocols.push_back(version);
+        }
+    }
+
+    if (!ok)
+        std::cerr << "Invalid option." << std::endl;
+    return ok;
+}
+
+// Thread CPU time of the calling thread; zero where it isn't known.
+NODISCARD std::chrono::nanoseconds getThreadCpuTime()
+{
+#if defined(Q_OS_UNIX)
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0)
+        return std::chrono::seconds{ts.tv_sec} + std::chrono::nanoseconds{ts.tv_nsec};
+#endif
+    return std::chrono::nanoseconds{0};
+}
+
+NODISCARD std::chrono::nanoseconds getServerCpuTime(Mmapper2Group &groupManager)
+{
+    std::chrono::nanoseconds result{0};
+    QMetaObject::invokeMethod(
+        &groupManager,
+        [&result]() { result = getThreadCpuTime(); },
+        Qt::BlockingQueuedConnection);
+    return result;
+}
+
+// Runs the event loop until the condition holds or the time runs out.
+NODISCARD bool waitUntil(const std::function<bool()> &condition, const int timeoutMs)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (!condition()) {
+        if (timer.elapsed() > timeoutMs)
+            return false;
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+    }
+    return true;
+}
+
+void processEventsFor(const int ms)
+{
+    MAYBE_UNUSED const auto ignored = waitUntil([]() { return false; }, ms);
+}
+
+void printLatencies(const char *const name, std::vector<int64_t> &latencies)
+{
+    std::cout << "  " << std::left << std::setw(16) << name << std::right;
+    if (latencies.empty()) {
+        std::cout << "none received\n";
+        return;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    const auto percentile = [&latencies](const double p) -> double {
+        const auto last = static_cast<double>(latencies.size() - 1);
+        return static_cast<double>(latencies[static_cast<size_t>(p * last)]) / 1000.0;
+    };
+    std::cout << std::fixed << std::setprecision(2) << "p50 " << percentile(0.50) << " ms, p90 "
+              << percentile(0.90) << " ms, p99 " << percentile(0.99) << " ms, max "
+              << percentile(1.0) << " ms (" << latencies.size() << " received)\n";
+}
+
+NODISCARD bool run(Mmapper2Group &groupManager,
+                   GroupAuthority &authority,
+                   const Options &options,
+                   const ProtocolVersion version)
+{
+    if (version != CGroupCommunicator::PROTOCOL_VERSION_102 && !QSslSocket::supportsSsl()) {
+        std::cout << "protocol " << version << ": skipped, TLS is not available\n";
+        return true;
+    }
+
+    Stats stats;
+    std::vector<std::unique_ptr<SimulatedClient>> clients;
+    for (int i = 0; i < options.clients; ++i) {
+        const QByteArray name = QString("Sim%1x%2").arg(version).arg(i).toLatin1();
+        clients.emplace_back(std::make_unique<SimulatedClient>(authority, name, version, stats));
+        clients.back()->connectToHost();
+    }
+
+    const auto allLogged = [&clients]() {
+        return std::all_of(clients.begin(), clients.end(), [](const auto &client) {
+            return client->isLogged();
+        });
+    };
+    if (!waitUntil(allLogged, 60000)) {
+        std::cerr << "protocol " << version << ": not every client could log in." << std::endl;
+        return false;
+    }
+    // Let the login traffic settle before measuring.
+    processEventsFor(500);
+    stats.reset();
+
+    // Each client starts at a random point of its period, as real prompts would.
+    using Seconds = std::chrono::duration<double>;
+    const auto period = [](const double rate) {
+        return std::chrono::duration_cast<Clock::duration>(Seconds{rate > 0.0 ? 1.0 / rate : 1e9});
+    };
+    const auto updatePeriod = period(options.updateRate);
+    const auto gtellPeriod = period(options.gtellRate);
+    std::mt19937 rng{static_cast<std::mt19937::result_type>(version)};
+    std::uniform_real_distribution<double> phase{0.0, 1.0};
+
+    const auto start = Clock::now();
+    std::vector<Clock::time_point> nextUpdate;
+    std::vector<Clock::time_point> nextGtell;
+    for (size_t i = 0; i < clients.size(); ++i) {
+        nextUpdate.push_back(
+            start + std::chrono::duration_cast<Clock::duration>(updatePeriod * phase(rng)));
+        nextGtell.push_back(
+            start + std::chrono::duration_cast<Clock::duration>(gtellPeriod * phase(rng)));
+    }
+
+    const auto cpuBefore = getServerCpuTime(groupManager);
+    uint64_t tick = 0;
+    QTimer driver;
+    driver.setInterval(5);
+    QObject::connect(&driver, &QTimer::timeout, [&]() {
+        const auto now = Clock::now();
+        for (size_t i = 0; i < clients.size(); ++i) {
+            for (; nextUpdate[i] <= now; nextUpdate[i] += updatePeriod)
+                clients[i]->sendUpdate(++tick);
+            for (; nextGtell[i] <= now; nextGtell[i] += gtellPeriod)
+                clients[i]->sendGroupTell();
+        }
+    });
+    driver.start();
+    processEventsFor(options.seconds * 1000);
+    driver.stop();
+    // Whatever is still in flight counts as received late.
+    processEventsFor(500);
+    const auto cpuAfter = getServerCpuTime(groupManager);
+
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    const double cpuSeconds = std::chrono::duration<double>(cpuAfter - cpuBefore).count();
+    const auto perSecond = [seconds](const uint64_t n) {
+        return static_cast<double>(n) / seconds / 1024.0;
+    };
+
+    std::cout << "protocol " << version << " with " << clients.size() << " clients, "
+              << std::fixed << std::setprecision(1) << seconds << " s\n"
+              << "  sent            " << stats.updatesSent << " updates, " << stats.gtellsSent
+              << " tells\n";
+    printLatencies("update latency", stats.updateLatencies);
+    printLatencies("gtell latency", stats.gtellLatencies);
+    std::cout << "  server cpu      ";
+    if (cpuAfter.count() != 0)
+        std::cout << std::setprecision(1) << 100.0 * cpuSeconds / seconds << "% of one core\n";
+    else
+        std::cout << "unknown\n";
+    std::cout << "  to server       " << std::setprecision(1) << perSecond(stats.bytesToServer)
+              << " KiB/s\n"
+              << "  from server     " << perSecond(stats.bytesFromServer) << " KiB/s\n";
+    if (stats.kicked != 0)
+        std::cout << "  kicked          " << stats.kicked << "\n";
+
+    for (auto &client : clients) {
+        client->disconnectFromHost();
+    }
+    processEventsFor(1000);
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    setEnteredMain();
+    QCoreApplication app(argc, argv);
+
+    Options options;
+    if (!parseOptions(app, options))
+        return EXIT_FAILURE;
+
+    {
+        auto &conf = setConfig().groupManager;
+        conf.state = GroupManagerStateEnum::Server;
+        conf.localPort = options.port;
+        conf.remotePort = options.port;
+        conf.host = "localhost";
+        conf.charName = "Host";
+        conf.shareSelf = true;
+        conf.rulesWarning = false;
+        conf.requireAuth = false;
+        conf.lockGroup = false;
+    }
+
+    // Released by its thread when it stops, like in MainWindow.
+    auto *const groupManager = new Mmapper2Group(nullptr);
+    groupManager->start();
+    QMetaObject::invokeMethod(
+        groupManager,
+        [groupManager]() { groupManager->slot_startNetwork(); },
+        Qt::BlockingQueuedConnection);
+    if (groupManager->getMode() != GroupManagerStateEnum::Server) {
+        std::cerr << "The server could not be started on port " << options.port << "."
+                  << std::endl;
+        groupManager->stop();
+        return EXIT_FAILURE;
+    }
+
+    // The clients share the server's certificate; the server doesn't require auth.
+    GroupAuthority authority{nullptr};
+    bool ok = true;
+    for (const ProtocolVersion version : options.protocols) {
+        ok = run(*groupManager, authority, options, version) && ok;
+    }
+
+    groupManager->stop();
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,335 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+// Headless map canvas benchmark: loads a map into a MapCanvas that is never
+// shown, then renders scripted camera paths offscreen and reports the time
+// per frame, the map batch rebuilds and the draw calls.
+//
+// usage: BenchMapCanvas [--frames N] [--size WxH] [--scenario S] map.mm2
+//
+// QOpenGLWidget::grabFramebuffer() renders a hidden widget into a framebuffer
+// object on a QOffscreenSurface, so this runs the real initializeGL() and
+// paintGL(). Use QT_QPA_PLATFORM=offscreen where there's no display.
+// The wall time includes reading the frame back; the CPU and GPU times
+// come from the perf stats that paintGL() collects.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QOpenGLContext>
+#include <QSurfaceFormat>
+
+#include "../src/configuration/configuration.h"
+#include "../src/display/MapCanvasConfig.h"
+#include "../src/display/mapcanvas.h"
+#include "../src/display/prespammedpath.h"
+#include "../src/global/utils.h"
+#include "../src/mapdata/mapdata.h"
+#include "../src/mapstorage/mapstorage.h"
+#include "../src/pandoragroup/mmapper2group.h"
+
+namespace { // anonymous
+
+struct NODISCARD Options final
+{
+    QString fileName;
+    QString scenario;
+    uint32_t frames = 300;
+    int width = 1280;
+    int height = 720;
+};
+
+// Sets up the camera for frame i of n.
+struct NODISCARD Scenario final
+{
+    const char *name = nullptr;
+    bool use3d = false;
+    std::function<void(MapCanvas &, uint32_t i, uint32_t n)> setCamera;
+};
+
+struct NODISCARD Summary final
+{
+    std::string name;
+    std::vector<double> wallMs;
+    std::vector<double> cpuMs;
+    std::vector<double> gpuMs;
+    std::vector<double> rebuildMs;
+    double drawCalls = 0.0;
+    double vertices = 0.0;
+    double uploadedKiB = 0.0;
+};
+
+NODISCARD bool parseOptions(const QCoreApplication &app, Options &options)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Renders scripted camera paths over a map offscreen.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("map", "MMapper2 map file (.mm2)");
+    const QCommandLineOption framesOpt{"frames", "Frames per scenario.", "N", "300"};
+    const QCommandLineOption sizeOpt{"size", "Framebuffer size.", "WxH", "1280x720"};
+    const QCommandLineOption scenarioOpt{"scenario",
+                                         "Only this scenario (pan, zoom, layer or tilt).",
+                                         "S"};
+    parser.addOption(framesOpt);
+    parser.addOption(sizeOpt);
+    parser.addOption(scenarioOpt);
+    parser.process(app);
+
+    const QStringList args = parser.positionalArguments();
+    if (args.size() != 1) {
+        parser.showHelp(EXIT_FAILURE);
+        return false;
+    }
+
+    bool ok = false;
+    options.fileName = args.front();
+    options.scenario = parser.value(scenarioOpt);
+    options.frames = parser.value(framesOpt).toUInt(&ok);
+    if (!ok || options.frames == 0) {
+        std::cerr << "Invalid --frames" << std::endl;
+        return false;
+    }
+
+    const QStringList size = parser.value(sizeOpt).split('x');
+    bool okWidth = false;
+    bool okHeight = false;
+    if (size.size() == 2) {
+        options.width = size[0].toInt(&okWidth);
+        options.height = size[1].toInt(&okHeight);
+    }
+    if (!okWidth || !okHeight || options.width <= 0 || options.height <= 0) {
+        std::cerr << "Invalid --size" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Like the application, but without the debug context, which slows the driver down.
+void setSurfaceFormat()
+{
+    QSurfaceFormat fmt;
+    fmt.setRenderableType(QSurfaceFormat::OpenGL);
+    fmt.setOptions(QSurfaceFormat::DeprecatedFunctions);
+    fmt.setSamples(getConfig().canvas.antialiasingSamples);
+    fmt.setDepthBufferSize(24);
+
+    QSurfaceFormat core = fmt;
+    core.setVersion(3, 3);
+    core.setProfile(QSurfaceFormat::CoreProfile);
+    QOpenGLContext context;
+    context.setFormat(core);
+    if (context.create() && context.format().version() >= qMakePair(3, 3)
+        && context.format().profile() == QSurfaceFormat::CoreProfile) {
+        fmt = core;
+    }
+    QSurfaceFormat::setDefaultFormat(fmt);
+}
+
+NODISCARD bool loadMap(MapData &mapData, const QString &fileName)
+{
+    QFile file{fileName};
+    if (!file.open(QFile::ReadOnly)) {
+        std::cerr << "Cannot read " << fileName.toStdString() << ": "
+                  << file.errorString().toStdString() << std::endl;
+        return false;
+    }
+
+    MapStorage storage{mapData, fileName, &file, nullptr};
+    return storage.canLoad() && storage.loadData();
+}
+
+NODISCARD std::vector<Scenario> getScenarios(const Coordinate &center)
+{
+    const glm::vec2 pos = center.to_vec2() + glm::vec2{0.5f, 0.5f};
+    // 0 to 1 over the scenario.
+    const auto fraction = [](const uint32_t i, const uint32_t n) -> float {
+        return static_cast<float>(i) / static_cast<float>(std::max(n, 2u) - 1u);
+    };
+    // 0 to 1 and back to 0 over the scenario.
+    const auto triangle = [fraction](const uint32_t i, const uint32_t n) -> float {
+        return 1.f - std::abs(2.f * fraction(i, n) - 1.f);
+    };
+
+    // Two laps of a circle that's wider than the restricted map radius,
+    // so the batches have to be rebuilt along the way.
+    const auto pan = [pos, fraction](MapCanvas &canvas, const uint32_t i, const uint32_t n) {
+        static constexpr float RADIUS = 120.f;
+        const float angle = fraction(i, n) * 4.f * 3.14159265f;
+        canvas.setZoom(1.f);
+        canvas.slot_setScroll(pos + RADIUS * glm::vec2{std::cos(angle), std::sin(angle)});
+    };
+
+    // From farther out than the color tiles to close in, and back.
+    const auto zoom = [pos, triangle](MapCanvas &canvas, const uint32_t i, const uint32_t n) {
+        canvas.setZoom(0.05f * std::pow(80.f, triangle(i, n)));
+        canvas.slot_setScroll(pos);
+    };
+
+    // Up three layers and back down, one layer every few frames.
+    const auto layer = [pos](MapCanvas &canvas, const uint32_t i, const uint32_t /*n*/) {
+        static constexpr uint32_t FRAMES_PER_LAYER = 5;
+        canvas.setZoom(1.f);
+        canvas.slot_setScroll(pos);
+        if (i % FRAMES_PER_LAYER != 0)
+            return;
+        if ((i / FRAMES_PER_LAYER) % 6 < 3)
+            canvas.slot_layerUp();
+        else
+            canvas.slot_layerDown();
+    };
+
+    // From looking straight down to the steepest tilt, and back.
+    const auto tilt = [pos, triangle](MapCanvas &canvas, const uint32_t i, const uint32_t n) {
+        auto &angle = setConfig().canvas.advanced.verticalAngle;
+        angle.set(static_cast<int>(std::lround(triangle(i, n) * 900.f)));
+        canvas.setZoom(1.f);
+        canvas.slot_setScroll(pos);
+    };
+
+    return std::vector<Scenario>{Scenario{"pan", false, pan},
+                                 Scenario{"zoom", false, zoom},
+                                 Scenario{"layer", false, layer},
+                                 Scenario{"tilt", true, tilt}};
+}
+
+// Renders until the first map batches have been uploaded.
+NODISCARD bool warmUp(MapCanvas &canvas)
+{
+    static constexpr int TIMEOUT_MS = 60000;
+    QElapsedTimer timer;
+    timer.start();
+    while (timer.elapsed() < TIMEOUT_MS) {
+        MAYBE_UNUSED const auto ignored = canvas.grabFramebuffer();
+        QCoreApplication::processEvents();
+        if (const auto &buildMs = canvas.getLastFrameReport().mapBatchBuildMs) {
+            std::cout << "initial map batches: " << buildMs.value() << " ms" << std::endl;
+            return true;
+        }
+    }
+    std::cerr << "Timed out waiting for the map batches" << std::endl;
+    return false;
+}
+
+NODISCARD Summary run(MapCanvas &canvas, const Scenario &scenario, const uint32_t frames)
+{
+    using Clock = std::chrono::steady_clock;
+    MapCanvasConfig::set3dMode(scenario.use3d);
+    MapCanvasConfig::setAutoTilt(false);
+    canvas.slot_layerReset();
+
+    Summary summary;
+    summary.name = scenario.name;
+    for (uint32_t i = 0; i < frames; ++i) {
+        scenario.setCamera(canvas, i, frames);
+
+        const auto start = Clock::now();
+        MAYBE_UNUSED const auto ignored = canvas.grabFramebuffer();
+        const auto wall = std::chrono::duration<double, std::milli>(Clock::now() - start);
+        QCoreApplication::processEvents();
+
+        const MapCanvas::FrameReport &report = canvas.getLastFrameReport();
+        summary.wallMs.emplace_back(wall.count());
+        summary.cpuMs.emplace_back(report.totalMs);
+        if (!report.gpuPhaseMs.empty()
+            && std::all_of(report.gpuPhaseMs.begin(),
+                           report.gpuPhaseMs.end(),
+                           [](const auto &ms) { return ms.has_value(); })) {
+            double gpu = 0.0;
+            for (const auto &ms : report.gpuPhaseMs)
+                gpu += ms.value();
+            summary.gpuMs.emplace_back(gpu);
+        }
+        if (report.mapBatchBuildMs.has_value())
+            summary.rebuildMs.emplace_back(report.mapBatchBuildMs.value());
+        summary.drawCalls += static_cast<double>(report.glStats.drawCalls);
+        summary.vertices += static_cast<double>(report.glStats.vertices);
+        summary.uploadedKiB += static_cast<double>(report.glStats.bytesUploaded) / 1024.0;
+    }
+
+    const auto n = static_cast<double>(frames);
+    summary.drawCalls /= n;
+    summary.vertices /= n;
+    summary.uploadedKiB /= n;
+    return summary;
+}
+
+// "mean / p95" in ms, or "-" if there's nothing to show.
+NODISCARD std::string describe(std::vector<double> v)
+{
+    if (v.empty())
+        return "-";
+    std::sort(v.begin(), v.end());
+    double sum = 0.0;
+    for (const double x : v)
+        sum += x;
+    const auto p95 = v[std::min(v.size() - 1, v.size() * 95 / 100)];
+    return std::to_string(sum / static_cast<double>(v.size())) + " / " + std::to_string(p95);
+}
+
+void report(const std::vector<Summary> &results, const size_t roomsCount, const Options &options)
+{
+    std::cout << "rooms: " << roomsCount << ", " << options.width << "x" << options.height << ", "
+              << options.frames << " frames per scenario\n";
+    for (const Summary &s : results) {
+        std::cout << s.name << ":\n"
+                  << "  wall ms/frame (mean / p95): " << describe(s.wallMs) << "\n"
+                  << "  CPU ms/frame (mean / p95):  " << describe(s.cpuMs) << "\n"
+                  << "  GPU ms/frame (mean / p95):  " << describe(s.gpuMs) << "\n"
+                  << "  batch rebuilds: " << s.rebuildMs.size()
+                  << ", ms (mean / p95): " << describe(s.rebuildMs) << "\n"
+                  << "  per frame: " << s.drawCalls << " draw calls, " << s.vertices
+                  << " vertices, " << s.uploadedKiB << " KiB uploaded\n";
+    }
+    std::cout << std::flush;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    setEnteredMain();
+    // Lets QOpenGLWidget create its context without a top-level window.
+    QApplication::setAttribute(Qt::AA_ShareOpenGLContexts);
+    QApplication app(argc, argv);
+    setSurfaceFormat();
+
+    Options options;
+    if (!parseOptions(app, options))
+        return EXIT_FAILURE;
+
+    MapData mapData{nullptr};
+    if (!loadMap(mapData, options.fileName)) {
+        std::cerr << "Failed to load " << options.fileName.toStdString() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    PrespammedPath prespammedPath{nullptr};
+    Mmapper2Group groupManager{nullptr};
+    MapCanvas canvas{mapData, prespammedPath, groupManager, nullptr};
+    canvas.resize(options.width, options.height);
+    MapCanvasConfig::setShowPerfStats(true);
+    canvas.slot_dataLoaded();
+    canvas.slot_setScroll(mapData.getPosition().to_vec2() + glm::vec2{0.5f, 0.5f});
+
+    if (!warmUp(canvas))
+        return EXIT_FAILURE;
+
+    std::vector<Summary> results;
+    for (const Scenario &scenario : getScenarios(mapData.getPosition())) {
+        if (!options.scenario.isEmpty() && options.scenario != scenario.name)
+            continue;
+        results.emplace_back(run(canvas, scenario, options.frames));
+    }
+    report(results, mapData.getRoomsCount(), options);
+    return EXIT_SUCCESS;
+}
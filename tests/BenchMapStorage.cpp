@@ -0,0 +1,385 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+// Headless map storage benchmark: loads a reference map, optionally makes it
+// bigger, then saves it in every format that can save and loads it back in
+// every format that can load.
+//
+// usage: BenchMapStorage [--scale N] [--runs R] [--format F] [--pandora file.xml]
+//                        [--dir DIR] map.mm2
+//
+// Peak RSS is for the whole process; use --format to get it for a single format.
+// Allocations only count operator new; Qt's containers call malloc() directly.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <optional>
+#include <string>
+#include <vector>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QtGlobal>
+
+#if defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+
+#include "../src/expandoracommon/coordinate.h"
+#include "../src/expandoracommon/exit.h"
+#include "../src/expandoracommon/room.h"
+#include "../src/global/utils.h"
+#include "../src/mapdata/ExitDirection.h"
+#include "../src/mapdata/MapSnapshot.h"
+#include "../src/mapdata/mapdata.h"
+#include "../src/mapstorage/MmpMapStorage.h"
+#include "../src/mapstorage/PandoraMapStorage.h"
+#include "../src/mapstorage/XmlMapStorage.h"
+#include "../src/mapstorage/abstractmapstorage.h"
+#include "../src/mapstorage/jsonmapstorage.h"
+#include "../src/mapstorage/mapstorage.h"
+
+static std::atomic<uint64_t> g_allocations{0};
+
+void *operator new(const std::size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *const ptr = std::malloc(size != 0 ? size : 1))
+        return ptr;
+    throw std::bad_alloc{};
+}
+
+void operator delete(void *const ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *const ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+namespace { // anonymous
+
+struct NODISCARD Options final
+{
+    QString fileName;
+    QString pandoraFileName;
+    QString dir;
+    QString format;
+    uint32_t scale = 1;
+    uint32_t runs = 1;
+};
+
+struct NODISCARD Measurement final
+{
+    QString format;
+    QString operation;
+    std::chrono::nanoseconds best{};
+    uint64_t allocations = 0;
+    // Only for saves.
+    qint64 bytes = 0;
+    // KiB; 0 where it isn't known.
+    long peakRss = 0;
+};
+
+NODISCARD long getPeakRssKiB()
+{
+#if defined(Q_OS_MACOS)
+    struct rusage usage;
+    return (getrusage(RUSAGE_SELF, &usage) == 0) ? usage.ru_maxrss / 1024 : 0;
+#elif defined(Q_OS_UNIX)
+    struct rusage usage;
+    return (getrusage(RUSAGE_SELF, &usage) == 0) ? usage.ru_maxrss : 0;
+#else
+    return 0;
+#endif
+}
+
+NODISCARD qint64 getBytesOnDisk(const QString &path)
+{
+    const QFileInfo info{path};
+    if (!info.isDir())
+        return info.size();
+
+    qint64 total = 0;
+    QDirIterator it{path, QDir::Files, QDirIterator::Subdirectories};
+    while (it.hasNext()) {
+        it.next();
+        total += it.fileInfo().size();
+    }
+    return total;
+}
+
+NODISCARD bool parseOptions(const QCoreApplication &app, Options &options)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Saves and loads a map in every storage format.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("map", "MMapper2 map file (.mm2)");
+    const QCommandLineOption scaleOpt{"scale", "Copies of the map to work with.", "N", "1"};
+    const QCommandLineOption runsOpt{"runs", "Runs per format; the best is shown.", "R", "1"};
+    const QCommandLineOption formatOpt{"format",
+                                       "Only this format (mm2, xml, web, mmp or pandora).",
+                                       "F"};
+    const QCommandLineOption pandoraOpt{"pandora", "Pandora map to load.", "file"};
+    const QCommandLineOption dirOpt{"dir", "Where to save (default: a temporary dir).", "DIR"};
+    parser.addOption(scaleOpt);
+    parser.addOption(runsOpt);
+    parser.addOption(formatOpt);
+    parser.addOption(pandoraOpt);
+    parser.addOption(dirOpt);
+    parser.process(app);
+
+    const QStringList args = parser.positionalArguments();
+    if (args.size() != 1) {
+        parser.showHelp(EXIT_FAILURE);
+        return false;
+    }
+
+    bool ok = true;
+    const auto toU32 = [&ok, &parser](const QCommandLineOption &opt) -> uint32_t {
+        bool optOk = false;
+        const auto value = parser.value(opt).toUInt(&optOk);
+        ok = ok && optOk && value != 0;
+        return value;
+    };
+
+    options.fileName = args.front();
+    options.pandoraFileName = parser.value(pandoraOpt);
+    options.dir = parser.value(dirOpt);
+    options.format = parser.value(formatOpt);
+    options.scale = toU32(scaleOpt);
+    options.runs = toU32(runsOpt);
+    if (!ok)
+        std::cerr << "Invalid numeric option." << std::endl;
+    return ok;
+}
+
+NODISCARD bool loadWith(MapData &mapData, const QString &fileName, const QString &format)
+{
+    QFile file{fileName};
+    if (!file.open(QFile::ReadOnly)) {
+        std::cerr << "Cannot read " << fileName.toStdString() << ": "
+                  << file.errorString().toStdString() << std::endl;
+        return false;
+    }
+
+    const auto storage = [&]() -> std::unique_ptr<AbstractMapStorage> {
+        if (format == "xml")
+            return std::make_unique<XmlMapStorage>(mapData, fileName, &file, nullptr);
+        if (format == "pandora")
+            return std::make_unique<PandoraMapStorage>(mapData, fileName, &file, nullptr);
+        return std::make_unique<MapStorage>(mapData, fileName, &file, nullptr);
+    }();
+    return storage->canLoad() && storage->loadData();
+}
+
+NODISCARD bool saveWith(MapData &mapData, const QString &fileName, const QString &format)
+{
+    if (format == "web") {
+        // The overrides are private; go through the base class like MainWindow.
+        const std::unique_ptr<AbstractMapStorage> storage
+            = std::make_unique<JsonMapStorage>(mapData, fileName, nullptr);
+        return storage->saveData(false);
+    }
+
+    QFile file{fileName};
+    if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+        std::cerr << "Cannot write " << fileName.toStdString() << ": "
+                  << file.errorString().toStdString() << std::endl;
+        return false;
+    }
+
+    const auto storage = [&]() -> std::unique_ptr<AbstractMapStorage> {
+        if (format == "xml")
+            return std::make_unique<XmlMapStorage>(mapData, fileName, &file, nullptr);
+        if (format == "mmp")
+            return std::make_unique<MmpMapStorage>(mapData, fileName, &file, nullptr);
+        return std::make_unique<MapStorage>(mapData, fileName, &file, nullptr);
+    }();
+    const bool ok = storage->canSave() && storage->saveData(false);
+    file.close();
+    return ok;
+}
+
+// Adds (scale - 1) copies of every room, each copy stacked above the previous
+// one, with its exits leading to the rooms of the same copy.
+void scaleMap(MapData &mapData, const uint32_t scale)
+{
+    if (scale <= 1)
+        return;
+
+    const SharedMapSnapshot snapshot = mapData.getSnapshot();
+    std::vector<const Room *> rooms;
+    deref(snapshot).forEachRoom([&rooms](const Room &room) { rooms.emplace_back(&room); });
+
+    const uint32_t idStride = mapData.getMaxId().asUint32() + 1u;
+    const int zStride = mapData.getMax().z - mapData.getMin().z + 1;
+
+    MapFrontendBlocker blocker{mapData};
+    for (uint32_t copy = 1; copy < scale; ++copy) {
+        const auto shift = [idStride, copy](const RoomId id) {
+            return RoomId{id.asUint32() + copy * idStride};
+        };
+        for (const Room *const room : rooms) {
+            ExitsList exits = room->getExitsList();
+            for (const ExitDirEnum dir : ALL_EXITS7) {
+                const Exit &from = room->exit(dir);
+                Exit &to = exits[dir];
+                for (const RoomId id : from.outRange()) {
+                    to.removeOut(id);
+                }
+                for (const RoomId id : from.inRange()) {
+                    to.removeIn(id);
+                }
+                for (const RoomId id : from.outRange()) {
+                    to.addOut(shift(id));
+                }
+                for (const RoomId id : from.inRange()) {
+                    to.addIn(shift(id));
+                }
+            }
+
+            const SharedRoom scaled = room->cloneExact(mapData);
+            scaled->setId(shift(room->getId()));
+            scaled->setPosition(room->getPosition()
+                                + Coordinate{0, 0, static_cast<int>(copy) * zStride});
+            scaled->setExitsList(exits);
+            mapData.insertPredefinedRoom(scaled);
+        }
+    }
+}
+
+NODISCARD std::optional<Measurement> measure(const QString &format,
+                                             const QString &operation,
+                                             const uint32_t runs,
+                                             const std::function<bool()> &run)
+{
+    using Clock = std::chrono::steady_clock;
+
+    Measurement result;
+    result.format = format;
+    result.operation = operation;
+    for (uint32_t i = 0; i < runs; ++i) {
+        const uint64_t allocationsBefore = g_allocations.load();
+        const auto start = Clock::now();
+        if (!run()) {
+            std::cerr << "Failed to " << operation.toStdString() << " " << format.toStdString()
+                      << std::endl;
+            return std::nullopt;
+        }
+        const auto elapsed = Clock::now() - start;
+        result.allocations = g_allocations.load() - allocationsBefore;
+        if (i == 0 || elapsed < result.best)
+            result.best = elapsed;
+    }
+    result.peakRss = getPeakRssKiB();
+    return result;
+}
+
+void report(const std::vector<Measurement> &results, const size_t roomsCount)
+{
+    std::cout << "rooms: " << roomsCount << "\n"
+              << "format   operation   wall (ms)   allocations     bytes written   peak RSS (KiB)"
+              << "\n";
+    for (const Measurement &m : results) {
+        const auto pad = [](std::string s, const size_t width) {
+            s.resize(std::max(s.size(), width), ' ');
+            return s;
+        };
+        std::cout << pad(m.format.toStdString(), 9) << pad(m.operation.toStdString(), 12)
+                  << pad(std::to_string(static_cast<double>(m.best.count()) / 1e6), 12)
+                  << pad(std::to_string(m.allocations), 16)
+                  << pad((m.operation == "save") ? std::to_string(m.bytes) : "-", 16)
+                  << ((m.peakRss != 0) ? std::to_string(m.peakRss) : "-") << "\n";
+    }
+    std::cout << std::flush;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    setEnteredMain();
+    QCoreApplication app(argc, argv);
+
+    Options options;
+    if (!parseOptions(app, options))
+        return EXIT_FAILURE;
+
+    MapData mapData{nullptr};
+    if (!loadWith(mapData, options.fileName, "mm2")) {
+        std::cerr << "Failed to load " << options.fileName.toStdString() << std::endl;
+        return EXIT_FAILURE;
+    }
+    scaleMap(mapData, options.scale);
+    const size_t roomsCount = mapData.getRoomsCount();
+
+    QTemporaryDir tempDir;
+    const QDir dir{options.dir.isEmpty() ? tempDir.path() : options.dir};
+    const auto wanted = [&options](const QString &format) {
+        return options.format.isEmpty() || options.format == format;
+    };
+
+    std::vector<Measurement> results;
+    const auto add = [&results](std::optional<Measurement> m) {
+        if (!m.has_value())
+            return false;
+        results.emplace_back(std::move(m.value()));
+        return true;
+    };
+
+    // Every format that can save, then loaded back where that's possible.
+    for (const QString format : {"mm2", "xml", "web", "mmp"}) {
+        if (!wanted(format))
+            continue;
+        QString path = dir.filePath("bench." + format);
+        // The web export skips the zones its zone-hashes.json says are already
+        // written, so each run gets a fresh directory to time a full export.
+        uint32_t run = 0;
+        if (format == "web") {
+            // Left over from an earlier invocation with the same --dir.
+            for (uint32_t i = 0; i < options.runs; ++i)
+                QDir{dir.filePath(QString("bench-%1.web").arg(i))}.removeRecursively();
+        }
+        if (!add(measure(format, "save", options.runs, [&mapData, &dir, &path, &format, &run]() {
+                if (format == "web")
+                    path = dir.filePath(QString("bench-%1.web").arg(run++));
+                return saveWith(mapData, path, format);
+            })))
+            return EXIT_FAILURE;
+        results.back().bytes = getBytesOnDisk(path);
+
+        if (format != "mm2" && format != "xml")
+            continue;
+        if (!add(measure(format, "load", options.runs, [&path, &format]() {
+                MapData loaded{nullptr};
+                return loadWith(loaded, path, format);
+            })))
+            return EXIT_FAILURE;
+    }
+
+    // Pandora maps can only be loaded.
+    if (!options.pandoraFileName.isEmpty() && wanted("pandora")) {
+        if (!add(measure("pandora", "load", options.runs, [&options]() {
+                MapData loaded{nullptr};
+                return loadWith(loaded, options.pandoraFileName, "pandora");
+            })))
+            return EXIT_FAILURE;
+    }
+
+    report(results, roomsCount);
+    return EXIT_SUCCESS;
+}
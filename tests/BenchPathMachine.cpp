@@ -0,0 +1,312 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+// Headless pathmachine benchmark: loads a map, walks it, and feeds the
+// resulting room events to Mmapper2PathMachine exactly as the parser would.
+//
+// usage: BenchPathMachine [--events N] [--seed S] [--desync-every K] map.mm2
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+#include <utility>
+#include <vector>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+
+#include "../src/configuration/configuration.h"
+#include "../src/expandoracommon/exit.h"
+#include "../src/expandoracommon/parseevent.h"
+#include "../src/expandoracommon/room.h"
+#include "../src/global/utils.h"
+#include "../src/mapdata/ExitDirection.h"
+#include "../src/mapdata/MapSnapshot.h"
+#include "../src/mapdata/mapdata.h"
+#include "../src/mapstorage/mapstorage.h"
+#include "../src/parser/CommandId.h"
+#include "../src/pathmachine/mmapper2pathmachine.h"
+
+static std::atomic<uint64_t> g_allocations{0};
+
+void *operator new(const std::size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *const ptr = std::malloc(size != 0 ? size : 1))
+        return ptr;
+    throw std::bad_alloc{};
+}
+
+void operator delete(void *const ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *const ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+namespace { // anonymous
+
+struct NODISCARD Options final
+{
+    QString fileName;
+    uint64_t numEvents = 100000;
+    uint32_t seed = 1;
+    // Drop all paths every this many events, to exercise syncing; 0 never does.
+    uint64_t desyncEvery = 0;
+};
+
+struct NODISCARD Results final
+{
+    std::vector<std::chrono::nanoseconds> latencies;
+    std::chrono::nanoseconds total{};
+    size_t peakPaths = 0;
+    uint64_t allocations = 0;
+    uint64_t syncingEvents = 0;
+};
+
+NODISCARD SharedParseEvent createMoveEvent(const Room &room, const CommandEnum move)
+{
+    ExitsFlagsType exitFlags;
+    for (const ExitDirEnum dir : ALL_EXITS_NESWUD) {
+        exitFlags.set(dir, room.exit(dir).getExitFlags());
+    }
+    exitFlags.setValid();
+
+    return ParseEvent::createEvent(move,
+                                   room.getName(),
+                                   room.readDescription(),
+                                   room.readContents(),
+                                   room.getTerrainType(),
+                                   exitFlags,
+                                   PromptFlagsType{},
+                                   ConnectedRoomFlagsType{});
+}
+
+// Random walk over the map's unique exits; stands in for a recorded session.
+class NODISCARD Walker final
+{
+private:
+    const MapSnapshot &m_snapshot;
+    std::mt19937 m_rng;
+    std::vector<RoomId> m_roomIds;
+    const Room *m_current = nullptr;
+
+public:
+    explicit Walker(const MapSnapshot &snapshot, const uint32_t seed)
+        : m_snapshot{snapshot}
+        , m_rng{seed}
+    {
+        m_snapshot.forEachRoom([this](const Room &room) { m_roomIds.emplace_back(room.getId()); });
+    }
+
+public:
+    NODISCARD bool empty() const { return m_roomIds.empty(); }
+    NODISCARD const Room &teleport()
+    {
+        std::uniform_int_distribution<size_t> pick{0, m_roomIds.size() - 1};
+        m_current = m_snapshot.getRoom(m_roomIds[pick(m_rng)]);
+        return deref(m_current);
+    }
+
+    // Returns the next event, moving to a random neighbour (or teleporting
+    // when the current room is a dead end).
+    NODISCARD SharedParseEvent step()
+    {
+        std::vector<std::pair<ExitDirEnum, RoomId>> choices;
+        for (const ExitDirEnum dir : ALL_EXITS_NESWUD) {
+            const Exit &e = deref(m_current).exit(dir);
+            if (e.outIsUnique() && m_snapshot.getRoom(e.outFirst()) != nullptr)
+                choices.emplace_back(dir, e.outFirst());
+        }
+
+        if (choices.empty())
+            return createMoveEvent(teleport(), CommandEnum::UNKNOWN);
+
+        std::uniform_int_distribution<size_t> pick{0, choices.size() - 1};
+        const auto &choice = choices[pick(m_rng)];
+        m_current = m_snapshot.getRoom(choice.second);
+        return createMoveEvent(deref(m_current), getCommand(choice.first));
+    }
+};
+
+NODISCARD bool parseOptions(const QCoreApplication &app, Options &options)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replays a walk over a map through the path machine.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("map", "MMapper2 map file (.mm2)");
+    const QCommandLineOption eventsOpt{"events", "Number of events to replay.", "N", "100000"};
+    const QCommandLineOption seedOpt{"seed", "Random seed for the walk.", "S", "1"};
+    const QCommandLineOption desyncOpt{"desync-every",
+                                       "Release all paths every K events (0 = never).",
+                                       "K",
+                                       "0"};
+    parser.addOption(eventsOpt);
+    parser.addOption(seedOpt);
+    parser.addOption(desyncOpt);
+    parser.process(app);
+
+    const QStringList args = parser.positionalArguments();
+    if (args.size() != 1) {
+        parser.showHelp(EXIT_FAILURE);
+        return false;
+    }
+
+    bool ok = true;
+    const auto toU64 = [&ok, &parser](const QCommandLineOption &opt) -> uint64_t {
+        bool optOk = false;
+        const auto value = parser.value(opt).toULongLong(&optOk);
+        ok = ok && optOk;
+        return value;
+    };
+
+    options.fileName = args.front();
+    options.numEvents = toU64(eventsOpt);
+    options.seed = static_cast<uint32_t>(toU64(seedOpt));
+    options.desyncEvery = toU64(desyncOpt);
+    if (!ok)
+        std::cerr << "Invalid numeric option." << std::endl;
+    return ok;
+}
+
+NODISCARD bool loadMap(MapData &mapData, const QString &fileName)
+{
+    QFile file{fileName};
+    if (!file.open(QFile::ReadOnly)) {
+        std::cerr << "Cannot read " << fileName.toStdString() << ": "
+                  << file.errorString().toStdString() << std::endl;
+        return false;
+    }
+
+    MapStorage storage{mapData, fileName, &file, nullptr};
+    return storage.canLoad() && storage.loadData();
+}
+
+void connectPathMachine(Mmapper2PathMachine &pathMachine, MapData &mapData)
+{
+    // Same wiring as MainWindow::wireConnections(), in "play" mode.
+    QObject::connect(&pathMachine,
+                     QOverload<RoomRecipient &, const Coordinate &>::of(
+                         &Mmapper2PathMachine::sig_lookingForRooms),
+                     &mapData,
+                     QOverload<RoomRecipient &, const Coordinate &>::of(&MapData::lookingForRooms));
+    QObject::connect(&pathMachine,
+                     QOverload<RoomRecipient &, const Coordinate &, int>::of(
+                         &Mmapper2PathMachine::sig_lookingForRooms),
+                     &mapData,
+                     QOverload<RoomRecipient &, const Coordinate &, int>::of(
+                         &MapData::lookingForRooms));
+    QObject::connect(&pathMachine,
+                     QOverload<RoomRecipient &, const SigParseEvent &>::of(
+                         &Mmapper2PathMachine::sig_lookingForRooms),
+                     &mapData,
+                     QOverload<RoomRecipient &, const SigParseEvent &>::of(
+                         &MapData::lookingForRooms));
+    QObject::connect(&pathMachine,
+                     QOverload<RoomRecipient &, RoomId>::of(
+                         &Mmapper2PathMachine::sig_lookingForRooms),
+                     &mapData,
+                     QOverload<RoomRecipient &, RoomId>::of(&MapData::lookingForRooms));
+    QObject::connect(&mapData,
+                     &MapFrontend::sig_clearingMap,
+                     &pathMachine,
+                     &PathMachine::slot_releaseAllPaths);
+}
+
+NODISCARD Results replay(Mmapper2PathMachine &pathMachine, Walker &walker, const Options &options)
+{
+    using Clock = std::chrono::steady_clock;
+
+    Results results;
+    results.latencies.reserve(options.numEvents);
+    pathMachine.slot_setCurrentRoom(walker.teleport().getId(), false);
+
+    const uint64_t allocationsBefore = g_allocations.load();
+    for (uint64_t i = 0; i < options.numEvents; ++i) {
+        if (options.desyncEvery != 0 && i != 0 && i % options.desyncEvery == 0)
+            pathMachine.slot_releaseAllPaths();
+        if (pathMachine.getState() == PathStateEnum::SYNCING)
+            ++results.syncingEvents;
+
+        const SigParseEvent event{walker.step()};
+        const auto start = Clock::now();
+        pathMachine.slot_handleParseEvent(event);
+        const auto elapsed = Clock::now() - start;
+
+        results.latencies.emplace_back(elapsed);
+        results.total += elapsed;
+        results.peakPaths = std::max(results.peakPaths, pathMachine.getNumPaths());
+    }
+    // Includes the few allocations needed to build each event.
+    results.allocations = g_allocations.load() - allocationsBefore;
+    return results;
+}
+
+void report(Results &results)
+{
+    auto &latencies = results.latencies;
+    const size_t n = latencies.size();
+    if (n == 0)
+        return;
+
+    std::sort(latencies.begin(), latencies.end());
+    const auto usec = [](const std::chrono::nanoseconds ns) {
+        return static_cast<double>(ns.count()) / 1000.0;
+    };
+    const auto percentile = [&latencies, n](const size_t p) {
+        return latencies[std::min(n - 1, n * p / 100)];
+    };
+    const double seconds = static_cast<double>(results.total.count()) / 1e9;
+
+    std::cout << "events:           " << n << "\n"
+              << "  while syncing:  " << results.syncingEvents << "\n"
+              << "events/sec:       " << (seconds > 0.0 ? static_cast<double>(n) / seconds : 0.0)
+              << "\n"
+              << "latency p50 (us): " << usec(percentile(50)) << "\n"
+              << "latency p99 (us): " << usec(percentile(99)) << "\n"
+              << "latency max (us): " << usec(latencies.back()) << "\n"
+              << "peak paths:       " << results.peakPaths << "\n"
+              << "allocations:      " << results.allocations << " ("
+              << static_cast<double>(results.allocations) / static_cast<double>(n)
+              << " per event)" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    setEnteredMain();
+    QCoreApplication app(argc, argv);
+
+    Options options;
+    if (!parseOptions(app, options))
+        return EXIT_FAILURE;
+
+    MapData mapData{nullptr};
+    if (!loadMap(mapData, options.fileName)) {
+        std::cerr << "Failed to load " << options.fileName.toStdString() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const SharedMapSnapshot snapshot = mapData.getSnapshot();
+    Walker walker{deref(snapshot), options.seed};
+    if (walker.empty()) {
+        std::cerr << "The map has no rooms." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    Mmapper2PathMachine pathMachine{&mapData, nullptr};
+    connectPathMachine(pathMachine, mapData);
+
+    Results results = replay(pathMachine, walker, options);
+    report(results);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,292 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+// Headless proxy benchmark: replays a raw capture of what MUME sent over the
+// socket (telnet negotiation, COMPRESS2, GMCP, MPI and XML mode included)
+// through MudTelnet, TelnetFilter, MpiFilter and MumeXmlParser without any
+// sockets. Each stage is timed on its own, fed with what the previous stage
+// produced, so its throughput and allocations aren't mixed with the others.
+//
+// usage: BenchProxyPipeline [--chunk-size N] [--repeat R] capture.bin
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+#include <QByteArray>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+
+#include "../src/clock/mumeclock.h"
+#include "../src/configuration/configuration.h"
+#include "../src/global/utils.h"
+#include "../src/mapdata/mapdata.h"
+#include "../src/mpi/mpifilter.h"
+#include "../src/observer/gameobserver.h"
+#include "../src/pandoragroup/GroupManagerApi.h"
+#include "../src/parser/mumexmlparser.h"
+#include "../src/proxy/GmcpMessage.h"
+#include "../src/proxy/MudTelnet.h"
+#include "../src/proxy/ProxyParserApi.h"
+#include "../src/proxy/telnetfilter.h"
+#include "../src/timers/CTimers.h"
+
+static std::atomic<uint64_t> g_allocations{0};
+
+void *operator new(const std::size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *const ptr = std::malloc(size != 0 ? size : 1))
+        return ptr;
+    throw std::bad_alloc{};
+}
+
+void operator delete(void *const ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *const ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+namespace { // anonymous
+
+struct NODISCARD Options final
+{
+    QString fileName;
+    // Size of the simulated socket reads.
+    uint64_t chunkSize = 4096;
+    // Times the capture is replayed; each replay uses fresh stages.
+    uint64_t repeat = 10;
+};
+
+struct NODISCARD MudStream final
+{
+    QByteArray data;
+    bool goAhead = false;
+};
+
+struct NODISCARD StageResult final
+{
+    std::chrono::nanoseconds elapsed{};
+    uint64_t bytesIn = 0;
+    uint64_t linesIn = 0;
+    uint64_t allocations = 0;
+};
+
+struct NODISCARD Results final
+{
+    StageResult telnet;
+    StageResult filter;
+    StageResult mpi;
+    StageResult xml;
+    uint64_t gmcpMessages = 0;
+    uint64_t bytesToUser = 0;
+};
+
+NODISCARD bool parseOptions(const QCoreApplication &app, Options &options)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replays a raw MUME capture through the proxy's parsers.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("capture", "Raw bytes received from MUME, e.g. from a "
+                                            "non-TLS session captured with socat or tcpdump");
+    const QCommandLineOption chunkOpt{"chunk-size", "Bytes per simulated read.", "N", "4096"};
+    const QCommandLineOption repeatOpt{"repeat", "Number of times to replay.", "R", "10"};
+    parser.addOption(chunkOpt);
+    parser.addOption(repeatOpt);
+    parser.process(app);
+
+    const QStringList args = parser.positionalArguments();
+    if (args.size() != 1) {
+        parser.showHelp(EXIT_FAILURE);
+        return false;
+    }
+
+    bool ok = true;
+    const auto toU64 = [&ok, &parser](const QCommandLineOption &opt) -> uint64_t {
+        bool optOk = false;
+        const auto value = parser.value(opt).toULongLong(&optOk);
+        ok = ok && optOk;
+        return value;
+    };
+
+    options.fileName = args.front();
+    options.chunkSize = toU64(chunkOpt);
+    options.repeat = toU64(repeatOpt);
+    if (!ok || options.chunkSize == 0)
+        std::cerr << "Invalid numeric option." << std::endl;
+    return ok && options.chunkSize != 0;
+}
+
+// Runs one stage and adds its time and allocations to the result.
+void timeStage(StageResult &result, const std::function<void()> &stage)
+{
+    using Clock = std::chrono::steady_clock;
+    const uint64_t allocationsBefore = g_allocations.load();
+    const auto start = Clock::now();
+    stage();
+    result.elapsed += Clock::now() - start;
+    result.allocations += g_allocations.load() - allocationsBefore;
+}
+
+void replay(const QByteArray &capture, const Options &options, Results &results)
+{
+    // One of everything MumeXmlParser needs; none are connected to a proxy or a group.
+    GameObserver observer;
+    MumeClock clock{observer};
+    CTimers timers{nullptr};
+    MapData mapData{nullptr};
+
+    MudTelnet mudTelnet{nullptr};
+    TelnetFilter telnetFilter{nullptr};
+    MpiFilter mpiFilter{nullptr};
+    MumeXmlParser parser{mapData,
+                         clock,
+                         ProxyParserApi{WeakHandle<Proxy>{}},
+                         GroupManagerApi{WeakHandle<Mmapper2Group>{}},
+                         timers,
+                         nullptr};
+
+    // Outputs are collected up front, so collecting them doesn't allocate during a stage.
+    std::vector<MudStream> streams;
+    std::vector<TelnetData> filtered;
+    std::vector<TelnetData> unfiltered;
+    const auto reserve = static_cast<size_t>(capture.size()) / 16 + 16;
+    streams.reserve(reserve);
+    filtered.reserve(reserve);
+    unfiltered.reserve(reserve);
+
+    QObject::connect(&mudTelnet,
+                     &MudTelnet::sig_analyzeMudStream,
+                     [&streams](const QByteArray &ba, const bool goAhead) {
+                         streams.emplace_back(MudStream{ba, goAhead});
+                     });
+    QObject::connect(&mudTelnet, &MudTelnet::sig_relayGmcp, [&results](const GmcpMessage &) {
+        ++results.gmcpMessages;
+    });
+    QObject::connect(&telnetFilter,
+                     &TelnetFilter::sig_parseNewMudInput,
+                     [&filtered](const TelnetData &data) { filtered.emplace_back(data); });
+    QObject::connect(&mpiFilter,
+                     &MpiFilter::sig_parseNewMudInput,
+                     [&unfiltered](const TelnetData &data) { unfiltered.emplace_back(data); });
+    QObject::connect(&parser,
+                     &MumeXmlParser::sig_sendToUser,
+                     [&results](const QByteArray &ba, bool) {
+                         results.bytesToUser += static_cast<uint64_t>(ba.size());
+                     });
+
+    timeStage(results.telnet, [&]() {
+        const int chunkSize = static_cast<int>(std::min<uint64_t>(options.chunkSize, 1u << 30));
+        for (int pos = 0; pos < capture.size(); pos += chunkSize) {
+            // MumeSocket also passes a view of its read buffer.
+            const int len = std::min(chunkSize, capture.size() - pos);
+            const auto view = QByteArray::fromRawData(capture.constData() + pos, len);
+            mudTelnet.slot_onAnalyzeMudStream(view);
+        }
+    });
+    results.telnet.bytesIn += static_cast<uint64_t>(capture.size());
+
+    timeStage(results.filter, [&]() {
+        for (const MudStream &stream : streams) {
+            telnetFilter.slot_onAnalyzeMudStream(stream.data, stream.goAhead);
+        }
+    });
+
+    timeStage(results.mpi, [&]() {
+        for (const TelnetData &data : filtered) {
+            mpiFilter.slot_analyzeNewMudInput(data);
+        }
+    });
+
+    timeStage(results.xml, [&]() {
+        for (const TelnetData &data : unfiltered) {
+            parser.slot_parseNewMudInput(data);
+        }
+    });
+
+    for (const MudStream &stream : streams) {
+        results.filter.bytesIn += static_cast<uint64_t>(stream.data.size());
+    }
+    results.mpi.linesIn += filtered.size();
+    results.xml.linesIn += unfiltered.size();
+    for (const TelnetData &data : filtered) {
+        results.mpi.bytesIn += static_cast<uint64_t>(data.line.size());
+    }
+    for (const TelnetData &data : unfiltered) {
+        results.xml.bytesIn += static_cast<uint64_t>(data.line.size());
+    }
+    // The filter's output lines are its unit of work, too.
+    results.filter.linesIn += filtered.size();
+}
+
+void report(const Results &results)
+{
+    const auto printStage = [](const char *const name, const StageResult &stage) {
+        const double seconds = static_cast<double>(stage.elapsed.count()) / 1e9;
+        const auto perSecond = [seconds](const double n) {
+            return seconds > 0.0 ? n / seconds : 0.0;
+        };
+        const double lines = static_cast<double>(stage.linesIn);
+        std::cout << std::left << std::setw(16) << name << std::right << std::fixed
+                  << std::setprecision(1) << std::setw(10)
+                  << perSecond(static_cast<double>(stage.bytesIn)) / 1e6 << " MB/s"
+                  << std::setw(14) << perSecond(lines) << " lines/s" << std::setw(12)
+                  << stage.allocations << " allocs";
+        if (stage.linesIn != 0) {
+            std::cout << " (" << std::setprecision(2)
+                      << static_cast<double>(stage.allocations) / lines << " per line)";
+        }
+        std::cout << "\n";
+    };
+
+    printStage("MudTelnet", results.telnet);
+    printStage("TelnetFilter", results.filter);
+    printStage("MpiFilter", results.mpi);
+    printStage("MumeXmlParser", results.xml);
+    std::cout << "gmcp messages:  " << results.gmcpMessages << "\n"
+              << "bytes to user:  " << results.bytesToUser << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    setEnteredMain();
+    QCoreApplication app(argc, argv);
+
+    Options options;
+    if (!parseOptions(app, options))
+        return EXIT_FAILURE;
+
+    QFile file{options.fileName};
+    if (!file.open(QFile::ReadOnly)) {
+        std::cerr << "Cannot read " << options.fileName.toStdString() << ": "
+                  << file.errorString().toStdString() << std::endl;
+        return EXIT_FAILURE;
+    }
+    const QByteArray capture = file.readAll();
+    if (capture.isEmpty()) {
+        std::cerr << "The capture is empty." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    Results results;
+    for (uint64_t i = 0; i < options.repeat; ++i) {
+        replay(capture, options, results);
+    }
+    report(results);
+    return EXIT_SUCCESS;
+}
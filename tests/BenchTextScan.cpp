@@ -0,0 +1,231 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+// Text scan microbenchmark: times each kernel in global/TextScan against the
+// byte-at-a-time loop it replaced, on room descriptions of a realistic length,
+// both pure ASCII and with some Latin-1 mixed in.
+//
+// usage: BenchTextScan [--repeat R]
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+
+#include "../src/global/TextScan.h"
+#include "../src/global/TextUtils.h"
+
+namespace { // anonymous
+
+// Keeps the results alive, so the loops can't be optimized away.
+volatile size_t g_sink = 0;
+
+NODISCARD bool isSpaceByte(const char c)
+{
+    return std::isspace(static_cast<uint8_t>(c) & 0xff);
+}
+
+// The text after s, wrapping around.
+NODISCARD const std::string &nextText(const std::vector<std::string> &texts, const std::string &s)
+{
+    const auto index = static_cast<size_t>(&s - texts.data());
+    return texts[(index + 1) % texts.size()];
+}
+
+NODISCARD std::vector<std::string> makeTexts(const bool latin1)
+{
+    static const std::vector<std::string> words = {"the",
+                                                   "high",
+                                                   "plateau",
+                                                   "north",
+                                                   "shelters",
+                                                   "place",
+                                                   "winds",
+                                                   "river",
+                                                   "flows",
+                                                   "quickly"};
+    static const std::vector<std::string> accented = {"caf\xE9", "M\xFCnster", "\xE0"};
+
+    std::mt19937 rng{42};
+    std::vector<std::string> texts;
+    for (int i = 0; i < 1000; ++i) {
+        std::string text;
+        while (text.size() < 400) {
+            const bool useAccent = latin1 && rng() % 16 == 0;
+            const auto &list = useAccent ? accented : words;
+            text += list[rng() % list.size()];
+            text += (rng() % 12 == 0) ? "\n" : " ";
+        }
+        texts.emplace_back(std::move(text));
+    }
+    return texts;
+}
+
+void timeKernel(const char *const name,
+                const std::vector<std::string> &texts,
+                const uint64_t repeat,
+                const std::function<size_t(const std::string &)> &scalar,
+                const std::function<size_t(const std::string &)> &vector)
+{
+    using Clock = std::chrono::steady_clock;
+    const auto run = [&texts, repeat](const std::function<size_t(const std::string &)> &fn) {
+        size_t sum = 0;
+        uint64_t bytes = 0;
+        const auto start = Clock::now();
+        for (uint64_t r = 0; r < repeat; ++r) {
+            for (const std::string &text : texts) {
+                sum += fn(text);
+                bytes += text.size();
+            }
+        }
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        g_sink = g_sink + sum;
+        return std::make_pair(sum, seconds > 0.0 ? static_cast<double>(bytes) / seconds / 1e6
+                                                 : 0.0);
+    };
+
+    const auto [scalarSum, scalarRate] = run(scalar);
+    const auto [vectorSum, vectorRate] = run(vector);
+    std::cout << std::left << std::setw(24) << name << std::right << std::fixed
+              << std::setprecision(0) << std::setw(10) << scalarRate << " MB/s" << std::setw(10)
+              << vectorRate << " MB/s" << std::setprecision(2) << std::setw(8)
+              << (scalarRate > 0.0 ? vectorRate / scalarRate : 0.0) << "x"
+              << (scalarSum == vectorSum ? "" : "  MISMATCH") << std::endl;
+}
+
+void runAll(const char *const title, const std::vector<std::string> &texts, const uint64_t repeat)
+{
+    std::cout << title << std::endl;
+
+    timeKernel(
+        "asciiPrefixLength",
+        texts,
+        repeat,
+        [](const std::string &s) -> size_t {
+            size_t i = 0;
+            while (i < s.size() && static_cast<uint8_t>(s[i]) < 0x80u)
+                ++i;
+            return i;
+        },
+        [](const std::string &s) -> size_t { return text_scan::asciiPrefixLength(s); });
+
+    // Splits the text into words the way Room::compareStrings() does.
+    timeKernel(
+        "findSpace/findNonSpace",
+        texts,
+        repeat,
+        [](const std::string &s) -> size_t {
+            size_t words = 0;
+            size_t i = 0;
+            while (i < s.size()) {
+                while (i < s.size() && isSpaceByte(s[i]))
+                    ++i;
+                if (i == s.size())
+                    break;
+                while (i < s.size() && !isSpaceByte(s[i]))
+                    ++i;
+                ++words;
+            }
+            return words;
+        },
+        [](const std::string &s) -> size_t {
+            size_t words = 0;
+            std::string_view sv{s};
+            while (true) {
+                sv.remove_prefix(text_scan::findNonSpace(sv));
+                if (sv.empty())
+                    break;
+                sv.remove_prefix(text_scan::findSpace(sv));
+                ++words;
+            }
+            return words;
+        });
+
+    timeKernel(
+        "countNonSpace",
+        texts,
+        repeat,
+        [](const std::string &s) -> size_t {
+            size_t result = 0;
+            for (const char c : s)
+                if (!isSpaceByte(c))
+                    ++result;
+            return result;
+        },
+        [](const std::string &s) -> size_t { return text_scan::countNonSpace(s); });
+
+    // Compares each text with the next one, like two candidate descriptions.
+    timeKernel(
+        "countMismatches",
+        texts,
+        repeat,
+        [&texts](const std::string &s) -> size_t {
+            const std::string &other = nextText(texts, s);
+            const size_t len = std::min(s.size(), other.size());
+            size_t result = 0;
+            for (size_t i = 0; i < len; ++i)
+                if (s[i] != other[i])
+                    ++result;
+            return result;
+        },
+        [&texts](const std::string &s) -> size_t {
+            const std::string &other = nextText(texts, s);
+            return text_scan::countMismatches(s.data(),
+                                              other.data(),
+                                              std::min(s.size(), other.size()));
+        });
+
+    timeKernel(
+        "toLowerLatin1",
+        texts,
+        repeat,
+        [](const std::string &s) -> size_t {
+            std::string copy = s;
+            for (char &c : copy)
+                c = toLowerLatin1(c);
+            return static_cast<uint8_t>(copy.back());
+        },
+        [](const std::string &s) -> size_t {
+            std::string copy = s;
+            text_scan::toLowerLatin1InPlace(copy.data(), copy.size());
+            return static_cast<uint8_t>(copy.back());
+        });
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Times the vectorized text scans against scalar loops.");
+    parser.addHelpOption();
+    const QCommandLineOption repeatOpt{"repeat", "Passes over the texts.", "R", "200"};
+    parser.addOption(repeatOpt);
+    parser.process(app);
+
+    bool ok = false;
+    const uint64_t repeat = parser.value(repeatOpt).toULongLong(&ok);
+    if (!ok || repeat == 0) {
+        std::cerr << "Invalid numeric option." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << std::left << std::setw(24) << "kernel" << std::right << std::setw(15) << "scalar"
+              << std::setw(15) << "vector" << std::endl;
+    runAll("ASCII:", makeTexts(false), repeat);
+    runAll("Latin-1:", makeTexts(true), repeat);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,361 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+// Writes a synthetic map, for running the benchmarks on maps much larger than
+// the real one. Rooms are laid out on a grid, in zones that each have their own
+// terrain, a few names and a few descriptions that most of their rooms share;
+// most neighbours are linked, some through doors, and there are infomarks
+// here and there. The same options always give the same map.
+//
+// usage: GenerateMap [--rooms N] [--seed S] out.mm2|out.xml
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QString>
+
+#include "../src/expandoracommon/coordinate.h"
+#include "../src/expandoracommon/exit.h"
+#include "../src/expandoracommon/room.h"
+#include "../src/global/roomid.h"
+#include "../src/global/utils.h"
+#include "../src/mapdata/DoorFlags.h"
+#include "../src/mapdata/ExitDirection.h"
+#include "../src/mapdata/ExitFlags.h"
+#include "../src/mapdata/infomark.h"
+#include "../src/mapdata/mapdata.h"
+#include "../src/mapdata/mmapper2room.h"
+#include "../src/mapstorage/LoadedRoom.h"
+#include "../src/mapstorage/XmlMapStorage.h"
+#include "../src/mapstorage/abstractmapstorage.h"
+#include "../src/mapstorage/mapstorage.h"
+
+namespace { // anonymous
+
+static constexpr const uint32_t MIN_ROOMS = 10'000;
+static constexpr const uint32_t MAX_ROOMS = 1'000'000;
+// Rooms per z level, before starting the next one.
+static constexpr const uint32_t ROOMS_PER_LEVEL = 250'000;
+static constexpr const int ZONE_WIDTH = 16;
+static constexpr const size_t NAMES_PER_ZONE = 3;
+static constexpr const size_t DESCRIPTIONS_PER_ZONE = 4;
+static constexpr const uint32_t ROOMS_PER_INFOMARK = 200;
+
+struct NODISCARD Options final
+{
+    QString fileName;
+    uint32_t rooms = 30'000;
+    uint32_t seed = 1;
+};
+
+struct NODISCARD Zone final
+{
+    RoomTerrainEnum terrain = RoomTerrainEnum::UNDEFINED;
+    std::vector<RoomName> names;
+    std::vector<RoomDesc> descriptions;
+    QString label;
+};
+
+class NODISCARD Generator final
+{
+private:
+    std::mt19937 m_rng;
+    const uint32_t m_numRooms;
+    const int m_width;
+    const int m_zonesPerRow;
+    std::vector<Zone> m_zones;
+    std::vector<LoadedRoom> m_rooms;
+
+public:
+    explicit Generator(const uint32_t numRooms, const uint32_t seed)
+        : m_rng{seed}
+        , m_numRooms{numRooms}
+        , m_width{static_cast<int>(
+              std::ceil(std::sqrt(static_cast<double>(std::min(numRooms, ROOMS_PER_LEVEL)))))}
+        , m_zonesPerRow{(m_width + ZONE_WIDTH - 1) / ZONE_WIDTH}
+    {}
+
+public:
+    void generate()
+    {
+        const uint32_t numLevels = (m_numRooms + ROOMS_PER_LEVEL - 1) / ROOMS_PER_LEVEL;
+        const int zonesPerLevel = m_zonesPerRow * m_zonesPerRow;
+        m_zones.resize(static_cast<size_t>(zonesPerLevel) * numLevels);
+        for (size_t i = 0; i < m_zones.size(); ++i) {
+            m_zones[i] = createZone(i);
+        }
+
+        m_rooms.resize(m_numRooms);
+        for (uint32_t i = 0; i < m_numRooms; ++i) {
+            createRoom(i);
+        }
+        for (uint32_t i = 0; i < m_numRooms; ++i) {
+            linkNeighbours(i);
+        }
+    }
+
+    void addTo(MapData &mapData)
+    {
+        MapFrontendBlocker blocker{mapData};
+        for (LoadedRoom &room : m_rooms) {
+            mapData.insertPredefinedRoom(::createRoom(mapData, std::move(room)));
+        }
+        m_rooms.clear();
+
+        for (uint32_t i = 0; i < m_numRooms; i += ROOMS_PER_INFOMARK) {
+            const Coordinate pos = getPosition(i);
+            const auto mark = InfoMark::alloc(mapData);
+            mark->setType(InfoMarkTypeEnum::TEXT);
+            mark->setClass(InfoMarkClassEnum::PLACE);
+            mark->setText(InfoMarkText{getZone(i).label});
+            mark->setPosition1(Coordinate{pos.x * INFOMARK_SCALE, pos.y * INFOMARK_SCALE, pos.z});
+            mark->setPosition2(mark->getPosition1());
+            mapData.addMarker(mark);
+        }
+    }
+
+private:
+    NODISCARD size_t random(const size_t n) { return m_rng() % n; }
+    NODISCARD bool chance(const uint32_t percent) { return random(100) < percent; }
+
+    NODISCARD Coordinate getPosition(const uint32_t i) const
+    {
+        const uint32_t level = i / ROOMS_PER_LEVEL;
+        const auto r = static_cast<int>(i % ROOMS_PER_LEVEL);
+        return Coordinate{r % m_width, r / m_width, static_cast<int>(level)};
+    }
+
+    NODISCARD std::optional<uint32_t> getIndex(const Coordinate &pos) const
+    {
+        if (pos.x < 0 || pos.x >= m_width || pos.y < 0 || pos.z < 0)
+            return std::nullopt;
+        const uint64_t i = static_cast<uint64_t>(pos.z) * ROOMS_PER_LEVEL
+                           + static_cast<uint64_t>(pos.y) * static_cast<uint64_t>(m_width)
+                           + static_cast<uint64_t>(pos.x);
+        if (i >= m_numRooms || getPosition(static_cast<uint32_t>(i)) != pos)
+            return std::nullopt;
+        return static_cast<uint32_t>(i);
+    }
+
+    NODISCARD const Zone &getZone(const uint32_t i) const
+    {
+        const Coordinate pos = getPosition(i);
+        const int zone = (pos.z * m_zonesPerRow + pos.y / ZONE_WIDTH) * m_zonesPerRow
+                         + pos.x / ZONE_WIDTH;
+        return m_zones[static_cast<size_t>(zone)];
+    }
+
+    NODISCARD Zone createZone(const size_t i)
+    {
+        static constexpr const RoomTerrainEnum terrains[] = {RoomTerrainEnum::FIELD,
+                                                             RoomTerrainEnum::FOREST,
+                                                             RoomTerrainEnum::HILLS,
+                                                             RoomTerrainEnum::MOUNTAINS,
+                                                             RoomTerrainEnum::CITY,
+                                                             RoomTerrainEnum::INDOORS,
+                                                             RoomTerrainEnum::ROAD,
+                                                             RoomTerrainEnum::BRUSH,
+                                                             RoomTerrainEnum::TUNNEL,
+                                                             RoomTerrainEnum::CAVERN,
+                                                             RoomTerrainEnum::WATER,
+                                                             RoomTerrainEnum::SHALLOW};
+        static constexpr const char *const places[] = {"Meadow", "Wood",   "Downs",  "Peaks",
+                                                       "Town",   "Hall",   "Road",   "Thicket",
+                                                       "Tunnel", "Cavern", "Lake",   "Ford"};
+        static constexpr const char *const adjectives[] = {"Old", "Dark", "Quiet", "Misty",
+                                                           "Grey", "Green", "Deep", "High"};
+        static constexpr const char *const details[]
+            = {"A narrow path winds between the rocks, and the wind carries the smell of rain.",
+               "Tall grass grows on both sides, hiding whatever might be lying in wait.",
+               "The ground here is trampled, as if many travellers have passed this way.",
+               "Somewhere nearby water trickles over stones, the only sound to be heard.",
+               "Old walls, long since fallen, still mark the edges of what was once a yard.",
+               "Roots and fallen branches make it hard to find a way through."};
+
+        const size_t kind = random(std::size(terrains));
+        const QString place = places[kind];
+        const QString adjective = adjectives[random(std::size(adjectives))];
+
+        Zone zone;
+        zone.terrain = terrains[kind];
+        zone.label = QString("%1 %2 %3").arg(adjective, place).arg(i);
+        for (size_t n = 0; n < NAMES_PER_ZONE; ++n) {
+            static constexpr const char *const parts[] = {"", "Edge of the ", "Inside the ",
+                                                          "Near the "};
+            zone.names.emplace_back(QString(parts[n % std::size(parts)])
+                                    + QString("%1 %2").arg(adjective, place));
+        }
+        for (size_t n = 0; n < DESCRIPTIONS_PER_ZONE; ++n) {
+            QString desc = QString("You are in the %1 %2.\n").arg(adjective.toLower(),
+                                                                    place.toLower());
+            for (int line = 0; line < 3; ++line) {
+                desc += details[random(std::size(details))];
+                desc += "\n";
+            }
+            zone.descriptions.emplace_back(desc);
+        }
+        return zone;
+    }
+
+    void createRoom(const uint32_t i)
+    {
+        const Zone &zone = getZone(i);
+        LoadedRoom &room = m_rooms[i];
+        room.id = RoomId{i};
+        room.position = getPosition(i);
+        room.upToDate = true;
+        room.Name = zone.names[random(zone.names.size())];
+        room.Description = zone.descriptions[random(zone.descriptions.size())];
+        // An occasional road breaks up the zone.
+        room.TerrainType = chance(5) ? RoomTerrainEnum::ROAD : zone.terrain;
+        room.LightType = (zone.terrain == RoomTerrainEnum::CAVERN) ? RoomLightEnum::DARK
+                                                                   : RoomLightEnum::LIT;
+        room.PortableType = RoomPortableEnum::PORTABLE;
+        room.RidableType = (zone.terrain == RoomTerrainEnum::INDOORS) ? RoomRidableEnum::NOT_RIDABLE
+                                                                      : RoomRidableEnum::RIDABLE;
+        if (chance(3))
+            room.LoadFlags |= RoomLoadFlagEnum::HERB;
+        if (chance(2))
+            room.MobFlags |= RoomMobFlagEnum::AGGRESSIVE_MOB;
+        if (chance(1))
+            room.Note = RoomNote{"synthetic note"};
+    }
+
+    void link(const uint32_t from, const ExitDirEnum dir, const uint32_t to)
+    {
+        const ExitDirEnum back = opposite(dir);
+        Exit &there = m_rooms[from].exits[dir];
+        Exit &here = m_rooms[to].exits[back];
+
+        ExitFlags exitFlags{ExitFlagEnum::EXIT};
+        if (m_rooms[from].TerrainType == RoomTerrainEnum::ROAD
+            && m_rooms[to].TerrainType == RoomTerrainEnum::ROAD)
+            exitFlags |= ExitFlagEnum::ROAD;
+        if (chance(5)) {
+            static constexpr const char *const doors[] = {"door", "gate", "hatch", "grate"};
+            exitFlags |= ExitFlagEnum::DOOR;
+            const DoorName name{doors[random(std::size(doors))]};
+            DoorFlags doorFlags;
+            if (chance(20))
+                doorFlags |= DoorFlagEnum::HIDDEN;
+            for (Exit *const e : {&there, &here}) {
+                e->setDoorName(name);
+                e->setDoorFlags(doorFlags);
+            }
+        }
+        for (Exit *const e : {&there, &here}) {
+            e->setExitFlags(exitFlags);
+        }
+
+        there.addOut(RoomId{to});
+        here.addIn(RoomId{from});
+        here.addOut(RoomId{from});
+        there.addIn(RoomId{to});
+    }
+
+    void linkNeighbours(const uint32_t i)
+    {
+        const Coordinate pos = getPosition(i);
+        const auto tryLink = [this, i, &pos](const ExitDirEnum dir,
+                                             const Coordinate &offset,
+                                             const uint32_t percent) {
+            if (!chance(percent))
+                return;
+            if (const auto other = getIndex(pos + offset))
+                link(i, dir, other.value());
+        };
+        // Coordinates go up to the north.
+        tryLink(ExitDirEnum::EAST, Coordinate{1, 0, 0}, 75);
+        tryLink(ExitDirEnum::NORTH, Coordinate{0, 1, 0}, 75);
+        tryLink(ExitDirEnum::UP, Coordinate{0, 0, 1}, 1);
+    }
+};
+
+NODISCARD bool parseOptions(const QCoreApplication &app, Options &options)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Writes a synthetic map for benchmarking.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("out", "Map file to write (.mm2 or .xml)");
+    const QCommandLineOption roomsOpt{"rooms", "Number of rooms (10000 to 1000000).", "N", "30000"};
+    const QCommandLineOption seedOpt{"seed", "Random seed.", "S", "1"};
+    parser.addOption(roomsOpt);
+    parser.addOption(seedOpt);
+    parser.process(app);
+
+    const QStringList args = parser.positionalArguments();
+    if (args.size() != 1) {
+        parser.showHelp(EXIT_FAILURE);
+        return false;
+    }
+
+    bool roomsOk = false;
+    bool seedOk = false;
+    options.fileName = args.front();
+    options.rooms = parser.value(roomsOpt).toUInt(&roomsOk);
+    options.seed = parser.value(seedOpt).toUInt(&seedOk);
+    if (!roomsOk || !seedOk || options.rooms < MIN_ROOMS || options.rooms > MAX_ROOMS) {
+        std::cerr << "Invalid numeric option." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+NODISCARD bool saveMap(MapData &mapData, const QString &fileName)
+{
+    QFile file{fileName};
+    if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+        std::cerr << "Cannot write " << fileName.toStdString() << ": "
+                  << file.errorString().toStdString() << std::endl;
+        return false;
+    }
+
+    const auto storage = [&]() -> std::unique_ptr<AbstractMapStorage> {
+        if (fileName.endsWith(".xml", Qt::CaseInsensitive))
+            return std::make_unique<XmlMapStorage>(mapData, fileName, &file, nullptr);
+        return std::make_unique<MapStorage>(mapData, fileName, &file, nullptr);
+    }();
+    const bool ok = storage->saveData(false);
+    file.close();
+    return ok && file.error() == QFile::NoError;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    setEnteredMain();
+    QCoreApplication app(argc, argv);
+
+    Options options;
+    if (!parseOptions(app, options))
+        return EXIT_FAILURE;
+
+    MapData mapData{nullptr};
+    {
+        Generator generator{options.rooms, options.seed};
+        generator.generate();
+        generator.addTo(mapData);
+    }
+
+    if (!saveMap(mapData, options.fileName)) {
+        std::cerr << "Failed to write " << options.fileName.toStdString() << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "Wrote " << mapData.getRoomsCount() << " rooms and "
+              << mapData.getMarkersList().size() << " infomarks to "
+              << options.fileName.toStdString() << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,567 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+// Microbenchmarks for the core data structures, run over a map (e.g. one from
+// GenerateMap) and over MUME output synthesized from its rooms.
+//
+// usage: MMapperBenchmarks [--repeat R] [--filter TEXT] map.mm2
+//
+// Prints JSON on stdout, with the benchmarks always in the same order and the
+// same fields, so two builds can be compared with a plain diff. Each benchmark
+// reports the median and the fastest of its runs, and a checksum of what it
+// computed; the checksum only changes when the results do.
+//
+// GLFont layout isn't included: the font metrics only exist after init(),
+// which needs an OpenGL context; BenchMapCanvas covers text drawing.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include <QByteArray>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QOpenGLTexture>
+
+#include "../src/clock/mumeclock.h"
+#include "../src/configuration/configuration.h"
+#include "../src/display/MapCanvasRoomDrawer.h"
+#include "../src/display/Textures.h"
+#include "../src/expandoracommon/coordinate.h"
+#include "../src/expandoracommon/parseevent.h"
+#include "../src/expandoracommon/room.h"
+#include "../src/global/utils.h"
+#include "../src/mapdata/MapSnapshot.h"
+#include "../src/mapdata/ShortestPathWorkspace.h"
+#include "../src/mapdata/mapdata.h"
+#include "../src/mapdata/roomfilter.h"
+#include "../src/mapdata/shortestpath.h"
+#include "../src/mapfrontend/AbstractRoomVisitor.h"
+#include "../src/mapfrontend/ParseTree.h"
+#include "../src/mapfrontend/map.h"
+#include "../src/mapfrontend/roomcollection.h"
+#include "../src/mapstorage/mapstorage.h"
+#include "../src/observer/gameobserver.h"
+#include "../src/pandoragroup/GroupManagerApi.h"
+#include "../src/parser/mumexmlparser.h"
+#include "../src/proxy/MudTelnet.h"
+#include "../src/proxy/ProxyParserApi.h"
+#include "../src/proxy/telnetfilter.h"
+#include "../src/timers/CTimers.h"
+
+namespace { // anonymous
+
+// Bytes per simulated socket read, as in BenchProxyPipeline.
+static constexpr const int CHUNK_SIZE = 4096;
+static constexpr const uint8_t IAC = 255;
+static constexpr const uint8_t GA = 249;
+
+struct NODISCARD Options final
+{
+    QString fileName;
+    QString filter;
+    uint64_t repeat = 5;
+};
+
+struct NODISCARD Result final
+{
+    std::string name;
+    // Operations per run.
+    uint64_t items = 0;
+    uint64_t checksum = 0;
+    std::vector<double> nsPerItem;
+};
+
+NODISCARD uint64_t mix(const uint64_t checksum, const uint64_t value)
+{
+    return (checksum ^ value) * 0x100000001b3ull;
+}
+
+// A run does the whole benchmark once, and returns how many operations it did.
+using RunFn = std::function<uint64_t(uint64_t &checksum)>;
+
+class NODISCARD Suite final
+{
+private:
+    const Options &m_options;
+    std::vector<Result> m_results;
+
+public:
+    explicit Suite(const Options &options)
+        : m_options{options}
+    {}
+
+public:
+    NODISCARD bool wants(const char *const name) const
+    {
+        return m_options.filter.isEmpty() || QString{name}.contains(m_options.filter);
+    }
+
+    void run(const char *const name, const RunFn &fn)
+    {
+        if (!wants(name))
+            return;
+
+        using Clock = std::chrono::steady_clock;
+        Result result;
+        result.name = name;
+
+        // The first run warms the caches up, and gives the checksum.
+        result.items = fn(result.checksum);
+        for (uint64_t i = 0; i < m_options.repeat; ++i) {
+            uint64_t ignoredChecksum = 0;
+            const auto start = Clock::now();
+            const uint64_t items = fn(ignoredChecksum);
+            const auto ns = std::chrono::duration<double, std::nano>(Clock::now() - start);
+            result.nsPerItem.emplace_back(ns.count()
+                                          / static_cast<double>(std::max<uint64_t>(1, items)));
+        }
+        std::sort(result.nsPerItem.begin(), result.nsPerItem.end());
+        m_results.emplace_back(std::move(result));
+    }
+
+    void report(std::ostream &os) const
+    {
+        os << "{\n  \"benchmarks\": [";
+        bool first = true;
+        for (const Result &r : m_results) {
+            const auto &ns = r.nsPerItem;
+            const double median = ns.empty() ? 0.0 : ns[ns.size() / 2];
+            const double fastest = ns.empty() ? 0.0 : ns.front();
+            os << (first ? "\n" : ",\n") << "    {\"name\": \"" << r.name
+               << "\", \"items\": " << r.items << ", \"runs\": " << ns.size() << std::fixed
+               << std::setprecision(2) << ", \"ns_per_item\": " << median
+               << ", \"min_ns_per_item\": " << fastest << ", \"checksum\": \"" << std::hex
+               << std::setw(16) << std::setfill('0') << r.checksum << std::dec
+               << std::setfill(' ') << "\"}";
+            first = false;
+        }
+        os << "\n  ]\n}" << std::endl;
+    }
+};
+
+NODISCARD bool parseOptions(const QCoreApplication &app, Options &options)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Times the core data structures on a map.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("map", "MMapper2 map file (.mm2)");
+    const QCommandLineOption repeatOpt{"repeat", "Timed runs per benchmark.", "R", "5"};
+    const QCommandLineOption filterOpt{"filter",
+                                       "Only run the benchmarks whose name contains TEXT.",
+                                       "TEXT"};
+    parser.addOption(repeatOpt);
+    parser.addOption(filterOpt);
+    parser.process(app);
+
+    const QStringList args = parser.positionalArguments();
+    if (args.size() != 1) {
+        parser.showHelp(EXIT_FAILURE);
+        return false;
+    }
+
+    bool ok = false;
+    options.fileName = args.front();
+    options.filter = parser.value(filterOpt);
+    options.repeat = parser.value(repeatOpt).toULongLong(&ok);
+    if (!ok || options.repeat == 0) {
+        std::cerr << "Invalid numeric option." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+NODISCARD bool loadMap(MapData &mapData, const QString &fileName)
+{
+    QFile file{fileName};
+    if (!file.open(QFile::ReadOnly)) {
+        std::cerr << "Cannot read " << fileName.toStdString() << ": "
+                  << file.errorString().toStdString() << std::endl;
+        return false;
+    }
+
+    MapStorage storage{mapData, fileName, &file, nullptr};
+    return storage.canLoad() && storage.loadData();
+}
+
+// Mutable copies of the map's rooms, in id order, for the structures that take a Room &.
+struct NODISCARD RoomCopies final
+{
+    RoomModificationTracker tracker;
+    std::vector<SharedRoom> rooms;
+    std::vector<SharedParseEvent> events;
+
+    explicit RoomCopies(const MapSnapshot &snapshot)
+    {
+        snapshot.forEachRoom([this](const Room &room) {
+            rooms.emplace_back(room.clone(tracker));
+            rooms.back()->setPosition(room.getPosition());
+        });
+        for (const SharedRoom &room : rooms)
+            events.emplace_back(Room::getEvent(room.get()));
+    }
+    DELETE_CTORS_AND_ASSIGN_OPS(RoomCopies);
+};
+
+class NODISCARD CountingVisitor final : public AbstractRoomVisitor
+{
+public:
+    uint64_t count = 0;
+
+private:
+    void visit(const Room *) override { ++count; }
+    void visitBatch(const RoomSpan rooms) override { count += rooms.size(); }
+};
+
+class NODISCARD PathCounter final : public ShortestPathRecipient
+{
+public:
+    uint64_t hits = 0;
+    uint64_t steps = 0;
+
+private:
+    void virt_receiveShortestPath(RoomAdmin *,
+                                  const std::vector<SPNode> &spnodes,
+                                  const int endpoint) override
+    {
+        ++hits;
+        for (int i = endpoint; i >= 0 && spnodes[static_cast<size_t>(i)].parent >= 0;
+             i = spnodes[static_cast<size_t>(i)].parent)
+            ++steps;
+    }
+};
+
+// Roughly what MUME sends in XML mode when walking into each room: the room,
+// its exits and a prompt, one line per element.
+NODISCARD std::vector<TelnetData> synthesizeXml(const std::vector<SharedRoom> &rooms)
+{
+    std::vector<TelnetData> lines;
+    const auto addLine = [&lines](QByteArray line, const TelnetDataEnum type) {
+        TelnetData data;
+        data.line = std::move(line);
+        data.type = type;
+        lines.emplace_back(std::move(data));
+    };
+
+    for (const SharedRoom &shared : rooms) {
+        const Room &room = deref(shared);
+        const QByteArray name = room.getName().toQByteArray();
+        const QByteArray desc = room.readDescription().toQByteArray();
+        addLine("<movement dir=north/><room><name>" + name + "</name>\r\n", TelnetDataEnum::CRLF);
+        const QList<QByteArray> descLines = desc.split('\n');
+        for (int i = 0; i < descLines.size(); ++i) {
+            const QByteArray prefix = (i == 0) ? "<description>" : "";
+            const QByteArray suffix = (i + 1 == descLines.size()) ? "</description></room>" : "";
+            addLine(prefix + descLines[i] + suffix + "\r\n", TelnetDataEnum::CRLF);
+        }
+        addLine("<exits>Exits: north, east.\r\n", TelnetDataEnum::CRLF);
+        addLine("</exits>\r\n", TelnetDataEnum::CRLF);
+        addLine("<prompt>*&gt;</prompt>", TelnetDataEnum::PROMPT);
+    }
+    return lines;
+}
+
+// The same lines as a raw stream, with each prompt ended by IAC GA.
+NODISCARD QByteArray synthesizeStream(const std::vector<TelnetData> &lines)
+{
+    QByteArray stream;
+    for (const TelnetData &data : lines) {
+        stream += data.line;
+        if (data.type == TelnetDataEnum::PROMPT) {
+            stream += static_cast<char>(IAC);
+            stream += static_cast<char>(GA);
+        }
+    }
+    return stream;
+}
+
+// Textures that are never uploaded; the batches only use them as keys.
+NODISCARD MapCanvasTextures createPlaceholderTextures()
+{
+    MapCanvasTextures textures;
+    int priority = 0;
+    textures.for_each([&priority](SharedMMTexture &tex) {
+        tex = MMTexture::alloc(
+            QOpenGLTexture::Target::Target2D, [](QOpenGLTexture &) {}, true);
+        tex->setPriority(priority++);
+    });
+    return textures;
+}
+
+void runMapBenchmarks(Suite &suite, const MapSnapshot &snapshot)
+{
+    RoomCopies copies{snapshot};
+    const auto &rooms = copies.rooms;
+    const size_t n = rooms.size();
+
+    std::vector<Coordinate> coords;
+    coords.reserve(n);
+    for (const SharedRoom &room : rooms)
+        coords.emplace_back(room->getPosition());
+
+    // A fixed shuffle, so lookups don't just walk the grid in order.
+    std::vector<size_t> order(n);
+    for (size_t i = 0; i < n; ++i)
+        order[i] = i;
+    std::shuffle(order.begin(), order.end(), std::mt19937{1});
+
+    suite.run("coordinate/arithmetic", [&coords, &order](uint64_t &checksum) -> uint64_t {
+        const Coordinate offset{1, -1, 0};
+        int64_t sum = 0;
+        for (size_t i = 0; i < coords.size(); ++i) {
+            const Coordinate &a = coords[i];
+            const Coordinate &b = coords[order[i]];
+            const Coordinate moved = (a + offset) - b;
+            sum += moved.distance(Coordinate{}) + (a == b ? 1 : 0);
+        }
+        checksum = mix(checksum, static_cast<uint64_t>(sum));
+        return coords.size();
+    });
+
+    suite.run("map/set_nearest", [&rooms, &coords](uint64_t &checksum) -> uint64_t {
+        Map map;
+        for (size_t i = 0; i < rooms.size(); ++i)
+            map.setNearest(coords[i], *rooms[i]);
+        // Every other room lands on a taken spot, so it goes to the nearest free one.
+        for (size_t i = 0; i < rooms.size(); i += 2)
+            map.setNearest(coords[i], *rooms[i]);
+        for (const SharedRoom &room : rooms) {
+            const Coordinate &c = room->getPosition();
+            checksum = mix(checksum, static_cast<uint64_t>(c.x * 31 + c.y * 17 + c.z));
+        }
+        return rooms.size() + (rooms.size() + 1) / 2;
+    });
+
+    {
+        Map map;
+        for (size_t i = 0; i < n; ++i)
+            map.setNearest(coords[i], *rooms[i]);
+        const Coordinate miss{0, 0, 1000};
+
+        suite.run("map/get", [&map, &coords, &order, &miss](uint64_t &checksum) -> uint64_t {
+            uint64_t found = 0;
+            for (const size_t i : order) {
+                found += (map.get(coords[i]) != nullptr) ? 1u : 0u;
+                found += (map.get(coords[i] + miss) != nullptr) ? 1u : 0u;
+            }
+            checksum = mix(checksum, found);
+            return order.size() * 2;
+        });
+    }
+    // The Map above moved some rooms; put them back for the benchmarks below.
+    for (size_t i = 0; i < n; ++i)
+        rooms[i]->setPosition(coords[i]);
+
+    const auto &events = copies.events;
+    suite.run("parsetree/insert", [&events](uint64_t &checksum) -> uint64_t {
+        ParseTree tree;
+        for (const SharedParseEvent &event : events) {
+            MAYBE_UNUSED const auto ignored = tree.insertRoom(*event);
+        }
+        checksum = mix(checksum, tree.getMemoryUsage().count);
+        return events.size();
+    });
+
+    {
+        ParseTree tree;
+        for (size_t i = 0; i < n; ++i)
+            tree.insertRoom(*events[i])->addRoom(rooms[i]);
+
+        suite.run("parsetree/lookup", [&tree, &events, &order](uint64_t &checksum) -> uint64_t {
+            CountingVisitor visitor;
+            for (const size_t i : order)
+                tree.getRooms(visitor, *events[i]);
+            checksum = mix(checksum, visitor.count);
+            return order.size();
+        });
+    }
+
+    const int tolerance = getConfig().pathMachine.matchingTolerance;
+    suite.run("room/compare",
+              [&rooms, &events, &order, tolerance](uint64_t &checksum) -> uint64_t {
+                  uint64_t sum = 0;
+                  for (size_t i = 0; i < rooms.size(); ++i) {
+                      // Against its own event, and against a random room's.
+                      const Room *const room = rooms[i].get();
+                      sum += static_cast<uint64_t>(Room::compare(room, *events[i], tolerance));
+                      sum += static_cast<uint64_t>(
+                          Room::compare(room, *events[order[i]], tolerance));
+                  }
+                  checksum = mix(checksum, sum);
+                  return rooms.size() * 2;
+              });
+}
+
+void runSearchBenchmarks(Suite &suite, const MapSnapshot &snapshot)
+{
+    std::vector<const Room *> rooms;
+    snapshot.forEachRoom([&rooms](const Room &room) { rooms.emplace_back(&room); });
+    if (rooms.empty())
+        return;
+
+    const std::vector<RoomFilter> filters{
+        RoomFilter{"rain", Qt::CaseInsensitive, false, PatternKindsEnum::DESC},
+        RoomFilter{"hall", Qt::CaseInsensitive, false, PatternKindsEnum::NAME},
+        RoomFilter{"^Edge of the .*Wood", Qt::CaseSensitive, true, PatternKindsEnum::NAME},
+        RoomFilter{"herb", Qt::CaseInsensitive, false, PatternKindsEnum::FLAGS}};
+
+    suite.run("roomfilter/filter", [&rooms, &filters](uint64_t &checksum) -> uint64_t {
+        uint64_t matches = 0;
+        for (const RoomFilter &f : filters)
+            for (const Room *const room : rooms)
+                matches += f.filter(room) ? 1u : 0u;
+        checksum = mix(checksum, matches);
+        return rooms.size() * filters.size();
+    });
+
+    static constexpr const size_t NUM_SEARCHES = 32;
+    std::vector<std::pair<const Room *, const Room *>> searches;
+    std::mt19937 rng{2};
+    for (size_t i = 0; i < NUM_SEARCHES; ++i)
+        searches.emplace_back(rooms[rng() % rooms.size()], rooms[rng() % rooms.size()]);
+
+    const auto notCancelled = []() { return false; };
+    ShortestPathWorkspace workspace;
+    suite.run("shortestpath/filter", [&](uint64_t &checksum) -> uint64_t {
+        PathCounter counter;
+        for (const auto &search : searches)
+            shortestPathSearch(snapshot,
+                               workspace,
+                               search.first,
+                               counter,
+                               filters.front(),
+                               10,
+                               notCancelled);
+        checksum = mix(mix(checksum, counter.hits), counter.steps);
+        return searches.size();
+    });
+    suite.run("shortestpath/target", [&](uint64_t &checksum) -> uint64_t {
+        PathCounter counter;
+        for (const auto &search : searches)
+            shortestPathSearch(snapshot,
+                               workspace,
+                               search.first,
+                               search.second,
+                               nullptr,
+                               counter,
+                               notCancelled);
+        checksum = mix(mix(checksum, counter.hits), counter.steps);
+        return searches.size();
+    });
+}
+
+void runProxyBenchmarks(Suite &suite, const MapSnapshot &snapshot)
+{
+    const RoomCopies copies{snapshot};
+    const std::vector<TelnetData> lines = synthesizeXml(copies.rooms);
+    const QByteArray stream = synthesizeStream(lines);
+
+    {
+        MudTelnet mudTelnet{nullptr};
+        uint64_t bytesOut = 0;
+        QObject::connect(&mudTelnet,
+                         &MudTelnet::sig_analyzeMudStream,
+                         [&bytesOut](const QByteArray &ba, bool) {
+                             bytesOut += static_cast<uint64_t>(ba.size());
+                         });
+
+        suite.run("telnet/read", [&](uint64_t &checksum) -> uint64_t {
+            bytesOut = 0;
+            for (int pos = 0; pos < stream.size(); pos += CHUNK_SIZE) {
+                const int len = std::min(CHUNK_SIZE, stream.size() - pos);
+                mudTelnet.slot_onAnalyzeMudStream(
+                    QByteArray::fromRawData(stream.constData() + pos, len));
+            }
+            checksum = mix(checksum, bytesOut);
+            return static_cast<uint64_t>(stream.size());
+        });
+    }
+
+    {
+        // One of everything MumeXmlParser needs; none are connected to a proxy or a group.
+        GameObserver observer;
+        MumeClock clock{observer};
+        CTimers timers{nullptr};
+        MapData mapData{nullptr};
+        MumeXmlParser parser{mapData,
+                             clock,
+                             ProxyParserApi{WeakHandle<Proxy>{}},
+                             GroupManagerApi{WeakHandle<Mmapper2Group>{}},
+                             timers,
+                             nullptr};
+        uint64_t bytesToUser = 0;
+        QObject::connect(&parser,
+                         &MumeXmlParser::sig_sendToUser,
+                         [&bytesToUser](const QByteArray &ba, bool) {
+                             bytesToUser += static_cast<uint64_t>(ba.size());
+                         });
+
+        suite.run("xml/parse", [&](uint64_t &checksum) -> uint64_t {
+            bytesToUser = 0;
+            for (const TelnetData &data : lines)
+                parser.slot_parseNewMudInput(data);
+            checksum = mix(checksum, bytesToUser);
+            return lines.size();
+        });
+    }
+}
+
+void runDisplayBenchmarks(Suite &suite, const MapSnapshot &snapshot)
+{
+    if (!suite.wants("mapcanvas/batches"))
+        return;
+
+    const MapCanvasTextures textures = createPlaceholderTextures();
+    suite.run("mapcanvas/batches", [&snapshot, &textures](uint64_t &checksum) -> uint64_t {
+        const MapBatchesData data = generateMapBatchesData(snapshot,
+                                                           textures,
+                                                           OptBounds{},
+                                                           std::nullopt,
+                                                           FullDetailLayers{});
+        checksum = mix(checksum, data.chunks.size());
+        return snapshot.getRoomsCount();
+    });
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    setEnteredMain();
+    QCoreApplication app(argc, argv);
+
+    Options options;
+    if (!parseOptions(app, options))
+        return EXIT_FAILURE;
+
+    MapData mapData{nullptr};
+    if (!loadMap(mapData, options.fileName)) {
+        std::cerr << "Failed to load " << options.fileName.toStdString() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const SharedMapSnapshot shared = mapData.getSnapshot();
+    const MapSnapshot &snapshot = deref(shared);
+    if (snapshot.getRoomsCount() == 0) {
+        std::cerr << "The map has no rooms." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    Suite suite{options};
+    runMapBenchmarks(suite, snapshot);
+    runSearchBenchmarks(suite, snapshot);
+    runProxyBenchmarks(suite, snapshot);
+    runDisplayBenchmarks(suite, snapshot);
+    suite.report(std::cout);
+    return EXIT_SUCCESS;
+}
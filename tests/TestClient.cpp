@@ -0,0 +1,101 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "TestClient.h"
+
+#include <optional>
+#include <vector>
+#include <QString>
+#include <QtTest/QtTest>
+
+#include "../src/client/ScrollbackIndex.h"
+
+TestClient::TestClient() = default;
+
+TestClient::~TestClient() = default;
+
+using Match = ScrollbackIndex::Match;
+using Matches = std::vector<Match>;
+
+NODISCARD static bool operator==(const Match &lhs, const Match &rhs)
+{
+    return lhs.line == rhs.line && lhs.column == rhs.column;
+}
+
+void TestClient::scrollbackSearchTest()
+{
+    ScrollbackIndex index;
+    index.append("The Troll is here.\nYou hit the ");
+    index.append("troll.\r\nNothing here.\n");
+    // The unfinished line isn't indexed, but it's still searched.
+    index.append("A troll\b\b\b\b\bwolf");
+    QCOMPARE(index.getFirstLine(), ScrollbackIndex::LineNumber{0});
+    QCOMPARE(index.getLastLine(), ScrollbackIndex::LineNumber{3});
+    QCOMPARE(index.getLine(1), QString{"You hit the troll."});
+    QCOMPARE(index.getLine(3), QString{"A wolf"});
+
+    QVERIFY(index.findAll("troll", 10) == (Matches{Match{0, 4}, Match{1, 12}}));
+    QVERIFY(index.findAll("TROLL", 1) == (Matches{Match{0, 4}}));
+    QVERIFY(index.findAll("wolf", 10) == (Matches{Match{3, 2}}));
+    QVERIFY(index.findAll("dragon", 10).empty());
+    QVERIFY(index.findAll("", 10).empty());
+    // Too short to have a trigram, so every line is a candidate.
+    QVERIFY(index.findAll("he", 10)
+            == (Matches{Match{0, 1}, Match{0, 13}, Match{1, 9}, Match{2, 8}}));
+
+    // Forward and backward, wrapping around at either end.
+    QVERIFY(index.findNext("troll", std::nullopt, false) == (Match{0, 4}));
+    QVERIFY(index.findNext("troll", Match{0, 4}, false) == (Match{1, 12}));
+    QVERIFY(index.findNext("troll", Match{1, 12}, false) == (Match{0, 4}));
+    QVERIFY(index.findNext("troll", std::nullopt, true) == (Match{1, 12}));
+    QVERIFY(index.findNext("troll", Match{1, 12}, true) == (Match{0, 4}));
+    QVERIFY(index.findNext("troll", Match{0, 4}, true) == (Match{1, 12}));
+    // From a line without a match.
+    QVERIFY(index.findNext("troll", Match{2, 0}, false) == (Match{0, 4}));
+    QVERIFY(index.findNext("troll", Match{2, 0}, true) == (Match{1, 12}));
+    // Within a line.
+    QVERIFY(index.findNext("he", Match{0, 1}, false) == (Match{0, 13}));
+    QVERIFY(index.findNext("he", Match{0, 13}, true) == (Match{0, 1}));
+    QVERIFY(!index.findNext("dragon", std::nullopt, false).has_value());
+}
+
+void TestClient::scrollbackLimitTest()
+{
+    ScrollbackIndex index;
+    // Including the unfinished line, like the document's block count.
+    index.setMaxLines(3);
+    for (int i = 0; i < 100; ++i) {
+        index.append(QString("line %1 troll\n").arg(i % 10));
+    }
+    QCOMPARE(index.getFirstLine(), ScrollbackIndex::LineNumber{98});
+    QCOMPARE(index.getLastLine(), ScrollbackIndex::LineNumber{100});
+    QCOMPARE(index.getLine(98), QString{"line 8 troll"});
+
+    // Only the lines that are still there can match, under their original numbers.
+    QVERIFY(index.findAll("troll", 10) == (Matches{Match{98, 7}, Match{99, 7}}));
+    QVERIFY(index.findAll("line 7", 10).empty());
+    QVERIFY(index.findAll("line 9", 10) == (Matches{Match{99, 0}}));
+    QVERIFY(index.findNext("troll", std::nullopt, true) == (Match{99, 7}));
+    QVERIFY(index.findNext("troll", Match{99, 7}, false) == (Match{98, 7}));
+
+    // Lowering the limit drops lines right away.
+    index.setMaxLines(2);
+    QCOMPARE(index.getFirstLine(), ScrollbackIndex::LineNumber{99});
+    QVERIFY(index.findAll("troll", 10) == (Matches{Match{99, 7}}));
+
+    // Without a limit, nothing more is dropped, and nothing comes back.
+    index.setMaxLines(0);
+    index.append("a troll\nanother troll\n");
+    QCOMPARE(index.getFirstLine(), ScrollbackIndex::LineNumber{99});
+    QVERIFY(index.findAll("troll", 10)
+            == (Matches{Match{99, 7}, Match{100, 2}, Match{101, 8}}));
+
+    // Clearing keeps counting from where it left off.
+    index.clear();
+    QCOMPARE(index.getFirstLine(), ScrollbackIndex::LineNumber{103});
+    QVERIFY(index.findAll("troll", 10).empty());
+    index.append("troll\n");
+    QVERIFY(index.findAll("troll", 10) == (Matches{Match{103, 0}}));
+}
+
+QTEST_MAIN(TestClient)
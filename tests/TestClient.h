@@ -0,0 +1,17 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <QObject>
+
+class TestClient final : public QObject
+{
+    Q_OBJECT
+public:
+    TestClient();
+    ~TestClient() final;
+
+private Q_SLOTS:
+    void scrollbackSearchTest();
+    void scrollbackLimitTest();
+};
@@ -3,12 +3,26 @@
 
 #include "TestGlobal.h"
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
 #include <QDebug>
 #include <QtTest/QtTest>
 
 #include "../src/global/AnsiColor.h"
+#include "../src/global/CacheRegistry.h"
+#include "../src/global/RoomLockSet.h"
+#include "../src/global/Signal.h"
+#include "../src/global/SlabAllocator.h"
 #include "../src/global/StringView.h"
+#include "../src/global/TextScan.h"
 #include "../src/global/TextUtils.h"
+#include "../src/global/TinyRoomIdSet.h"
 #include "../src/global/string_view_utils.h"
 #include "../src/global/unquote.h"
 
@@ -81,6 +95,77 @@ void TestGlobal::unquoteTest()
     test::test_unquote();
 }
 
+void TestGlobal::unquotedTokensTest()
+{
+    using namespace std::string_view_literals;
+    const auto pointsInto = [](const std::string_view token, const std::string_view input) {
+        return input.data() <= token.data()
+               && token.data() + token.size() <= input.data() + input.size();
+    };
+
+    UnquotedTokens tokens;
+    {
+        // Plain tokens are views of the input; quoted or escaped ones are decoded.
+        const std::string input = R"(say "hello world" ab"cd" \x41 "\x42")";
+        QVERIFY(!unquoteInto(input, false, false, tokens).has_value());
+        QCOMPARE(tokens.size(), size_t{5});
+        QCOMPARE(tokens[0], "say"sv);
+        QCOMPARE(tokens[1], "hello world"sv);
+        QCOMPARE(tokens[2], "abcd"sv);
+        QCOMPARE(tokens[3], R"(\x41)"sv);
+        QCOMPARE(tokens[4], "B"sv);
+        QVERIFY(pointsInto(tokens[0], input));
+        QVERIFY(!pointsInto(tokens[1], input));
+        QVERIFY(!pointsInto(tokens[2], input));
+        QVERIFY(pointsInto(tokens[3], input));
+        QVERIFY(!pointsInto(tokens[4], input));
+        QCOMPARE(tokens.toVectorOfStrings(),
+                 (VectorOfStrings{"say", "hello world", "abcd", R"(\x41)", "B"}));
+    }
+
+    // More than fit inline.
+    tokens.clear();
+    QVERIFY(tokens.empty());
+    {
+        const std::string input = "a b c d e f g h i \"j\" k";
+        QVERIFY(!unquoteInto(input, false, false, tokens).has_value());
+        QCOMPARE(tokens.size(), UnquotedTokens::INLINE_TOKENS + 3);
+        std::string joined;
+        for (const std::string_view token : tokens) {
+            joined += token;
+        }
+        QCOMPARE(joined, std::string{"abcdefghijk"});
+        QVERIFY(pointsInto(tokens[UnquotedTokens::INLINE_TOKENS], input));
+        QVERIFY(!pointsInto(tokens[9], input));
+    }
+
+    // Embedded nulls end a token unless they're allowed.
+    tokens.clear();
+    {
+        const std::string input = R"("a\0b" c)";
+        QVERIFY(!unquoteInto(input, false, false, tokens).has_value());
+        QCOMPARE(tokens.toVectorOfStrings(), (VectorOfStrings{"a", "c"}));
+        tokens.clear();
+        QVERIFY(!unquoteInto(input, false, true, tokens).has_value());
+        QCOMPARE(tokens.toVectorOfStrings(), (VectorOfStrings{std::string{"a\0b"sv}, "c"}));
+    }
+
+    tokens.clear();
+    {
+        const std::string input = R"(open "door)";
+        QVERIFY(unquoteInto(input, false, false, tokens).has_value());
+        tokens.clear();
+        QVERIFY(!unquoteInto(input, true, false, tokens).has_value());
+        QCOMPARE(tokens.toVectorOfStrings(), (VectorOfStrings{"open", "door"}));
+    }
+
+    tokens.clear();
+    QVERIFY(unquoteInto(R"("\q")", false, false, tokens).has_value());
+    QVERIFY(!unquote(R"("\q")", false, false).has_value());
+    QCOMPARE(unquote(R"(x "y z")", false, false).getVectorOfStrings(),
+             (VectorOfStrings{"x", "y z"}));
+}
+
 void TestGlobal::toLowerLatin1Test()
 {
     // Visible Latin-1 characters
@@ -97,6 +182,41 @@ void TestGlobal::toLowerLatin1Test()
     QCOMPARE(toLowerLatin1('A'), 'a');
     QCOMPARE(toLowerLatin1('Z'), 'z');
     QCOMPARE(toLowerLatin1('-'), '-');
+
+    // Long enough for the vectorized path, with and without Latin-1
+    QCOMPARE(toLowerLatin1(std::string_view{"The Quick Brown Fox Jumps Over The Lazy Dog"}),
+             std::string{"the quick brown fox jumps over the lazy dog"});
+    QCOMPARE(toLowerLatin1(std::string_view{"ABCDEFGHIJKLMNOP\xC0\xD7\xDD@[`{"}),
+             std::string{"abcdefghijklmnop\xE0\xD7\xFD@[`{"});
+}
+
+void TestGlobal::textScanTest()
+{
+    using namespace text_scan;
+
+    // Each case crosses at least one 16-byte chunk.
+    const std::string ascii = "   \t\n  A dark forest lies here, and  it is   quiet.\r\n";
+    QCOMPARE(findNonSpace(ascii), size_t{7});
+    QCOMPARE(findSpace(std::string_view{ascii}.substr(7)), size_t{1});
+    QCOMPARE(findSpace("Averyveryverylongwordwithoutspaces"), size_t{34});
+    QCOMPARE(findNonSpace("                    \v\f"), size_t{22});
+    QCOMPARE(countNonSpace(ascii), size_t{33});
+    QCOMPARE(asciiPrefixLength(ascii), ascii.size());
+
+    const std::string latin1 = "Caf\xE9s line the street of M\xFCnster, \xE0 gauche.";
+    QCOMPARE(asciiPrefixLength(latin1), size_t{3});
+    QCOMPARE(asciiPrefixLength(std::string_view{latin1}.substr(4)), size_t{22});
+    QCOMPARE(findSpace(latin1), size_t{5});
+    QCOMPARE(countNonSpace(latin1), size_t{36});
+
+    const std::string a = "The high plateau to the north shelters this place.";
+    std::string b = a;
+    QCOMPARE(countMismatches(a.data(), b.data(), a.size()), size_t{0});
+    b[1] = 'X';
+    b[17] = 'X';
+    b[a.size() - 1] = '!';
+    QCOMPARE(countMismatches(a.data(), b.data(), a.size()), size_t{3});
+    QCOMPARE(countMismatches(a.data(), b.data(), 17), size_t{1});
 }
 
 void TestGlobal::to_numberTest()
@@ -122,4 +242,223 @@ void TestGlobal::to_numberTest()
     QCOMPARE(ok, false);
 }
 
+void TestGlobal::tinyRoomIdSetTest()
+{
+    TinyRoomIdSet set;
+    QVERIFY(set.empty());
+    QVERIFY(set.insert(RoomId{5}));
+    QVERIFY(!set.insert(RoomId{5}));
+    QCOMPARE(set.size(), size_t{1});
+    QCOMPARE(set.first(), RoomId{5});
+
+    // spill past the inline capacity, inserting out of order
+    for (const uint32_t n : {9u, 1u, 7u, 3u}) {
+        QVERIFY(set.insert(RoomId{n}));
+    }
+    QCOMPARE(set.size(), size_t{5});
+    std::vector<RoomId> sorted{set.begin(), set.end()};
+    QVERIFY(std::is_sorted(sorted.begin(), sorted.end()));
+    QVERIFY(set.contains(RoomId{7}));
+    QVERIFY(!set.contains(RoomId{8}));
+
+    const TinyRoomIdSet copy = set;
+    QVERIFY(copy == set);
+    QCOMPARE(set.erase(RoomId{7}), size_t{1});
+    QCOMPARE(set.erase(RoomId{7}), size_t{0});
+    QVERIFY(copy != set);
+
+    TinyRoomIdSet moved = std::move(set);
+    QCOMPARE(moved.size(), size_t{4});
+    moved.clear();
+    QVERIFY(moved.empty());
+}
+
+void TestGlobal::roomLockSetTest()
+{
+    // only the addresses are used
+    char buf[4]{};
+    const auto recipient = [&buf](const int n) {
+        return reinterpret_cast<RoomRecipient *>(&buf[n]);
+    };
+
+    RoomLockSet set;
+    QVERIFY(set.empty());
+    QVERIFY(set.insert(recipient(0)));
+    QVERIFY(!set.insert(recipient(0)));
+    QCOMPARE(set.size(), size_t{1});
+
+    // spill past the inline capacity
+    for (const int n : {1, 2, 3}) {
+        QVERIFY(set.insert(recipient(n)));
+    }
+    QCOMPARE(set.size(), size_t{4});
+    QVERIFY(set.contains(recipient(2)));
+
+    const RoomLockSet copy = set;
+    QCOMPARE(set.erase(recipient(2)), size_t{1});
+    QCOMPARE(set.erase(recipient(2)), size_t{0});
+    QVERIFY(!set.contains(recipient(2)));
+    QVERIFY(copy.contains(recipient(2)));
+
+    RoomLockSet moved = std::move(set);
+    QCOMPARE(moved.size(), size_t{3});
+    for (const int n : {0, 1, 3}) {
+        QCOMPARE(moved.erase(recipient(n)), size_t{1});
+    }
+    QVERIFY(moved.empty());
+}
+
+void TestGlobal::signalTest()
+{
+    int a = 0;
+    int b = 0;
+    Signal<int>::Lifetime second;
+    {
+        Signal<int> sig;
+        Signal<int>::Lifetime first;
+        first = sig.connect([&first, &a](int n) {
+            a += n;
+            // disconnecting itself during the invocation
+            first.reset();
+        });
+        second = sig.connect([&b](int n) { b += n; });
+        QVERIFY(first.isValid());
+
+        sig.invoke(2);
+        QCOMPARE(a, 2);
+        QCOMPARE(b, 2);
+        QVERIFY(!first.isValid());
+
+        {
+            auto reEnabler = sig.disable();
+            sig.invoke(5);
+        }
+        sig.invoke(3);
+        QCOMPARE(a, 2);
+        QCOMPARE(b, 5);
+    }
+    // the lifetime outlives the signal
+    QVERIFY(!second.isValid());
+}
+
+void TestGlobal::cacheRegistryTest()
+{
+    using namespace cache_registry;
+    size_t cheap = 1000;
+    size_t costly = 1000;
+    {
+        const Registration a{"cheap",
+                             CacheCostEnum::LOW,
+                             [&cheap]() { return cheap; },
+                             [&cheap](size_t /*bytes*/) { cheap = 0; }};
+        const Registration b{"costly",
+                             CacheCostEnum::HIGH,
+                             [&costly]() { return costly; },
+                             [&costly](const size_t bytes) { costly -= std::min(bytes, costly); }};
+        QCOMPARE(getTotalBytes(), size_t{2000});
+
+        // unlimited
+        setBudget(0);
+        QCOMPARE(enforceBudget(), size_t{0});
+
+        // the cheap one goes first, and that's enough
+        setBudget(1500);
+        QCOMPARE(enforceBudget(), size_t{1000});
+        QCOMPARE(cheap, size_t{0});
+        QCOMPARE(costly, size_t{1000});
+
+        // only as much as needed of the costly one
+        setBudget(800);
+        QCOMPARE(enforceBudget(), size_t{200});
+        QCOMPARE(costly, size_t{800});
+
+        QCOMPARE(evictAll(), size_t{800});
+        QCOMPARE(getTotalBytes(), size_t{0});
+    }
+    setBudget(0);
+    QCOMPARE(getTotalBytes(), size_t{0});
+}
+
+void TestGlobal::slabArenaTest()
+{
+    static constexpr const size_t ALIGN = alignof(std::max_align_t);
+    SlabArena arena{4};
+    QCOMPARE(arena.getBlocksInUse(), size_t{0});
+    QCOMPARE(arena.getBytesReserved(), size_t{0});
+
+    QVERIFY(SlabArena::canAllocate(1, 1));
+    QVERIFY(!SlabArena::canAllocate(0, 1));
+    QVERIFY(!SlabArena::canAllocate(1, ALIGN * 2));
+
+    // Sizes are rounded up to the alignment, so these share one pool.
+    std::vector<void *> blocks;
+    std::set<void *> unique;
+    for (size_t i = 0; i < 4; ++i) {
+        void *const ptr = arena.allocate(1 + i % 2);
+        QVERIFY(reinterpret_cast<uintptr_t>(ptr) % ALIGN == 0);
+        blocks.emplace_back(ptr);
+        unique.emplace(ptr);
+    }
+    QCOMPARE(unique.size(), size_t{4});
+    QCOMPARE(arena.getBlocksInUse(), size_t{4});
+    QCOMPARE(arena.getBytesReserved(), 4 * ALIGN);
+
+    // The slab is full, so the next block needs another one.
+    void *const fifth = arena.allocate(1);
+    QVERIFY(unique.count(fifth) == 0);
+    QCOMPARE(arena.getBlocksInUse(), size_t{5});
+    QCOMPARE(arena.getBytesReserved(), 8 * ALIGN);
+
+    // Freed blocks are handed out again, most recently freed first.
+    arena.deallocate(blocks[1], 2);
+    arena.deallocate(blocks[2], 1);
+    QCOMPARE(arena.getBlocksInUse(), size_t{3});
+    QCOMPARE(arena.allocate(1), blocks[2]);
+    QCOMPARE(arena.allocate(2), blocks[1]);
+    QCOMPARE(arena.getBytesReserved(), 8 * ALIGN);
+
+    // A bigger size gets its own pool.
+    void *const big = arena.allocate(ALIGN + 1);
+    QVERIFY(unique.count(big) == 0 && big != fifth);
+    QCOMPARE(arena.getBlocksInUse(), size_t{6});
+    QCOMPARE(arena.getBytesReserved(), 8 * ALIGN + 4 * 2 * ALIGN);
+
+    arena.deallocate(big, ALIGN + 1);
+    arena.deallocate(fifth, 1);
+    for (void *const ptr : blocks) {
+        arena.deallocate(ptr, 1);
+    }
+    QCOMPARE(arena.getBlocksInUse(), size_t{0});
+    // Slabs are kept until the arena goes away.
+    QCOMPARE(arena.getBytesReserved(), 8 * ALIGN + 4 * 2 * ALIGN);
+}
+
+void TestGlobal::slabAllocatorTest()
+{
+    auto arena = std::make_shared<SlabArena>();
+    const std::weak_ptr<SlabArena> weakArena = arena;
+
+    // The object and its control block come from a single block.
+    auto value = std::allocate_shared<int>(SlabAllocator<int>{arena}, 42);
+    QCOMPARE(arena->getBlocksInUse(), size_t{1});
+    {
+        // Anything but a single object goes to the heap.
+        SlabAllocator<int> alloc{arena};
+        int *const values = alloc.allocate(8);
+        QCOMPARE(arena->getBlocksInUse(), size_t{1});
+        alloc.deallocate(values, 8);
+    }
+    QVERIFY(SlabAllocator<int>{arena} == SlabAllocator<char>{arena});
+    QVERIFY(SlabAllocator<int>{arena} != SlabAllocator<int>{std::make_shared<SlabArena>()});
+
+    // The object keeps the arena alive after its creator lets go of it.
+    arena.reset();
+    QVERIFY(!weakArena.expired());
+    QCOMPARE(*value, 42);
+    QCOMPARE(weakArena.lock()->getBlocksInUse(), size_t{1});
+
+    value.reset();
+    QVERIFY(weakArena.expired());
+}
+
 QTEST_MAIN(TestGlobal)
@@ -16,6 +16,14 @@ private Q_SLOTS:
     void ansiToRgbTest();
     void stringViewTest();
     void unquoteTest();
+    void unquotedTokensTest();
     void toLowerLatin1Test();
+    void textScanTest();
     void to_numberTest();
+    void tinyRoomIdSetTest();
+    void roomLockSetTest();
+    void signalTest();
+    void cacheRegistryTest();
+    void slabArenaTest();
+    void slabAllocatorTest();
 };
@@ -0,0 +1,273 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include "TestMapFrontend.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <QtTest/QtTest>
+
+#include "../src/expandoracommon/coordinate.h"
+#include "../src/expandoracommon/parseevent.h"
+#include "../src/expandoracommon/room.h"
+#include "../src/mapfrontend/AbstractRoomVisitor.h"
+#include "../src/mapfrontend/MapLock.h"
+#include "../src/mapfrontend/RoomLookupCache.h"
+#include "../src/mapfrontend/map.h"
+
+TestMapFrontend::TestMapFrontend() = default;
+
+TestMapFrontend::~TestMapFrontend() = default;
+
+namespace { // anonymous
+class NODISCARD PositionCollector final : public AbstractRoomVisitor
+{
+public:
+    std::vector<Coordinate> positions;
+
+private:
+    void visit(const Room *const room) final { positions.emplace_back(room->getPosition()); }
+};
+
+NODISCARD std::vector<Coordinate> getAllPositions(const Map &map)
+{
+    PositionCollector collector;
+    map.getRooms(collector);
+    return collector.positions;
+}
+} // namespace
+
+void TestMapFrontend::mapGridTest()
+{
+    // Spread over several 16x16 tiles, including the ones on the negative side of zero,
+    // and listed in the z, y, x order the map visits them in.
+    const std::vector<Coordinate> coords{Coordinate{0, 0, -1},
+                                         Coordinate{3, -20, 0},
+                                         Coordinate{-1, -1, 0},
+                                         Coordinate{0, 0, 0},
+                                         Coordinate{15, 0, 0},
+                                         Coordinate{16, 0, 0},
+                                         Coordinate{-17, 5, 0},
+                                         Coordinate{-16, 5, 0},
+                                         Coordinate{2, 2, 1}};
+
+    RoomModificationTracker tracker;
+    std::vector<SharedRoom> rooms;
+    Map map;
+    QVERIFY(!map.getBounds().has_value());
+    for (const Coordinate &c : coords) {
+        rooms.emplace_back(Room::createPermanentRoom(tracker));
+        map.setNearest(c, *rooms.back());
+        QCOMPARE(rooms.back()->getPosition(), c);
+    }
+    for (size_t i = 0; i < coords.size(); ++i) {
+        QCOMPARE(map.get(coords[i]), rooms[i].get());
+    }
+    QVERIFY(map.get(Coordinate{-1, 0, 0}) == nullptr);
+    QVERIFY(map.get(Coordinate{-16, -1, 0}) == nullptr);
+    QVERIFY(map.get(Coordinate{0, 0, 2}) == nullptr);
+
+    QCOMPARE(getAllPositions(map), coords);
+    {
+        const auto bounds = map.getBounds();
+        QVERIFY(bounds.has_value());
+        QCOMPARE(bounds->min, (Coordinate{-17, -20, -1}));
+        QCOMPARE(bounds->max, (Coordinate{16, 5, 1}));
+    }
+    {
+        // Both corners are inclusive, and the box crosses a tile boundary.
+        PositionCollector collector;
+        map.getRooms(collector, Coordinate{-1, -1, 0}, Coordinate{15, 0, 0});
+        QCOMPARE(collector.positions,
+                 (std::vector<Coordinate>{Coordinate{-1, -1, 0},
+                                          Coordinate{0, 0, 0},
+                                          Coordinate{15, 0, 0}}));
+    }
+
+    // A taken spot sends the room elsewhere.
+    const SharedRoom extra = Room::createPermanentRoom(tracker);
+    map.setNearest(Coordinate{0, 0, 0}, *extra);
+    QVERIFY(extra->getPosition() != (Coordinate{0, 0, 0}));
+    QCOMPARE(map.get(extra->getPosition()), extra.get());
+    QCOMPARE(map.get(Coordinate{0, 0, 0}), rooms[3].get());
+    map.remove(extra->getPosition());
+
+    // The bounds shrink as the outliers go.
+    map.remove(Coordinate{-17, 5, 0});
+    map.remove(Coordinate{3, -20, 0});
+    map.remove(Coordinate{-17, 5, 0});
+    QVERIFY(map.get(Coordinate{-17, 5, 0}) == nullptr);
+    QCOMPARE(map.get(Coordinate{-16, 5, 0}), rooms[7].get());
+    {
+        const auto bounds = map.getBounds();
+        QVERIFY(bounds.has_value());
+        QCOMPARE(bounds->min, (Coordinate{-16, -1, -1}));
+        QCOMPARE(bounds->max, (Coordinate{16, 5, 1}));
+    }
+
+    for (const Coordinate &c : coords) {
+        map.remove(c);
+    }
+    QVERIFY(!map.getBounds().has_value());
+    QVERIFY(getAllPositions(map).empty());
+}
+
+void TestMapFrontend::mapGridNearTest()
+{
+    RoomModificationTracker tracker;
+    std::vector<SharedRoom> rooms;
+    Map map;
+    for (const Coordinate &c : {Coordinate{1, 1, 0},
+                                Coordinate{0, 0, 1},
+                                Coordinate{0, 1, 0},
+                                Coordinate{1, 0, 0},
+                                Coordinate{-1, 0, 0},
+                                Coordinate{0, 0, 0}}) {
+        rooms.emplace_back(Room::createPermanentRoom(tracker));
+        map.setNearest(c, *rooms.back());
+    }
+
+    // Nearest first, then z, y, x; {1, 1, 0} is two steps away.
+    PositionCollector collector;
+    map.getRoomsNear(collector, Coordinate{0, 0, 0}, 1);
+    QCOMPARE(collector.positions,
+             (std::vector<Coordinate>{Coordinate{0, 0, 0},
+                                      Coordinate{-1, 0, 0},
+                                      Coordinate{1, 0, 0},
+                                      Coordinate{0, 1, 0},
+                                      Coordinate{0, 0, 1}}));
+}
+
+void TestMapFrontend::mapLockTest()
+{
+    MapLock lock;
+    QVERIFY(!lock.isLockedByCurrentThread());
+    {
+        SharedMapLocker shared{lock};
+        QVERIFY(lock.isLockedByCurrentThread());
+        QVERIFY(!lock.isLockedExclusivelyByCurrentThread());
+        {
+            // The only reader may upgrade.
+            ExclusiveMapLocker exclusive{lock};
+            QVERIFY(lock.isLockedExclusivelyByCurrentThread());
+            ExclusiveMapLocker again{lock};
+            SharedMapLocker nested{lock};
+        }
+        QVERIFY(!lock.isLockedExclusivelyByCurrentThread());
+        QVERIFY(lock.isLockedByCurrentThread());
+    }
+    QVERIFY(!lock.isLockedByCurrentThread());
+}
+
+void TestMapFrontend::mapLockUpgradeTest()
+{
+    static constexpr const int ROUNDS = 100;
+    for (int round = 0; round < ROUNDS; ++round) {
+        MapLock lock;
+        std::atomic<int> readers{0};
+        std::atomic<int> writers{0};
+        std::atomic<bool> overlapped{false};
+        std::atomic<bool> lostShared{false};
+
+        // Both threads hold the lock shared before either upgrades, so one of
+        // the upgrades has to wait behind the other.
+        const auto upgrade = [&]() {
+            SharedMapLocker shared{lock};
+            ++readers;
+            while (readers.load() < 2) {
+                std::this_thread::yield();
+            }
+            {
+                ExclusiveMapLocker exclusive{lock};
+                if (++writers != 1)
+                    overlapped = true;
+                std::this_thread::yield();
+                --writers;
+            }
+            if (!lock.isLockedByCurrentThread())
+                lostShared = true;
+        };
+
+        std::thread first{upgrade};
+        std::thread second{upgrade};
+        first.join();
+        second.join();
+
+        QVERIFY(!overlapped);
+        QVERIFY(!lostShared);
+        QVERIFY(!lock.isLockedByCurrentThread());
+    }
+}
+
+NODISCARD static SharedParseEvent createNamedEvent(const char *const name)
+{
+    return ParseEvent::createEvent(CommandEnum::UNKNOWN,
+                                   RoomName{name},
+                                   RoomDesc{},
+                                   RoomContents{},
+                                   RoomTerrainEnum::UNDEFINED,
+                                   ExitsFlagsType{},
+                                   PromptFlagsType{},
+                                   ConnectedRoomFlagsType{});
+}
+
+void TestMapFrontend::roomLookupCacheTest()
+{
+    using Fingerprint = RoomLookupCache::Fingerprint;
+    using Ids = std::vector<RoomId>;
+    const Fingerprint keyA{1, 0};
+    const Fingerprint keyB{2, 0};
+    const Fingerprint keyC{3, 0};
+    const SharedParseEvent eventA = createNamedEvent("Riverside");
+    const SharedParseEvent eventB = createNamedEvent("Forest Path");
+    const SharedParseEvent eventC = createNamedEvent("Old Bridge");
+
+    RoomLookupCache cache{2};
+    QVERIFY(!cache.find(keyA, *eventA).has_value());
+    QCOMPARE(cache.getMisses(), uint64_t{1});
+
+    cache.insert(keyA, *eventA, Ids{RoomId{1}});
+    cache.insert(keyB, *eventB, Ids{RoomId{2}, RoomId{3}});
+    QCOMPARE(cache.size(), size_t{2});
+    {
+        // Touching A leaves B as the least recently used.
+        const auto ids = cache.find(keyA, *eventA);
+        QVERIFY(ids.has_value());
+        QCOMPARE(*ids, Ids{RoomId{1}});
+        QCOMPARE(cache.getHits(), uint64_t{1});
+    }
+
+    cache.insert(keyC, *eventC, Ids{});
+    QCOMPARE(cache.size(), size_t{2});
+    QVERIFY(!cache.find(keyB, *eventB).has_value());
+    QVERIFY(cache.find(keyA, *eventA).has_value());
+    {
+        // An empty result is still a hit.
+        const auto ids = cache.find(keyC, *eventC);
+        QVERIFY(ids.has_value());
+        QVERIFY(ids->empty());
+    }
+
+    // The same fingerprint for different text is a miss, not someone else's rooms,
+    // and inserting it replaces the entry.
+    QVERIFY(!cache.find(keyA, *eventB).has_value());
+    cache.insert(keyA, *eventB, Ids{RoomId{4}});
+    QCOMPARE(cache.size(), size_t{2});
+    QVERIFY(!cache.find(keyA, *eventA).has_value());
+    {
+        const auto ids = cache.find(keyA, *eventB);
+        QVERIFY(ids.has_value());
+        QCOMPARE(*ids, Ids{RoomId{4}});
+    }
+    QCOMPARE(cache.getHits(), uint64_t{4});
+    QCOMPARE(cache.getMisses(), uint64_t{4});
+
+    // Which is what MapFrontend does when a room's lookup key changes.
+    cache.clear();
+    QCOMPARE(cache.size(), size_t{0});
+    QVERIFY(!cache.find(keyC, *eventC).has_value());
+}
+
+QTEST_MAIN(TestMapFrontend)
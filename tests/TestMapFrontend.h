@@ -0,0 +1,20 @@
+#pragma once
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright (C) 2019 The MMapper Authors
+
+#include <QObject>
+
+class TestMapFrontend final : public QObject
+{
+    Q_OBJECT
+public:
+    TestMapFrontend();
+    ~TestMapFrontend() final;
+
+private Q_SLOTS:
+    void mapGridTest();
+    void mapGridNearTest();
+    void mapLockTest();
+    void mapLockUpgradeTest();
+    void roomLookupCacheTest();
+};
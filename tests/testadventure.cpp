@@ -168,6 +168,22 @@ void TestAdventure::testKillAndXPParser()
     QCOMPARE(parser.getLastSuccessVal(), TestLines.killPlayer3Success);
 }
 
+void TestAdventure::testClassifyLine()
+{
+    QCOMPARE(classifyLine(""), LineTriggerEnum::NONE);
+    QCOMPARE(classifyLine("You cleave a tree-snake's body extremely hard and shatter it."),
+             LineTriggerEnum::NONE);
+    QCOMPARE(classifyLine("A tree-snake is dead! R.I.P."), LineTriggerEnum::NONE);
+    QCOMPARE(classifyLine("You receive your share of experience."), LineTriggerEnum::KILL);
+    QCOMPARE(classifyLine("You feel more experienced."), LineTriggerEnum::KILL);
+    QCOMPARE(classifyLine("You achieved something new!"), LineTriggerEnum::ACHIEVEMENT);
+    QCOMPARE(classifyLine("You are dead! Sorry..."), LineTriggerEnum::DIED);
+    QCOMPARE(classifyLine("You gain a level!"), LineTriggerEnum::GAINED_LEVEL);
+    QCOMPARE(classifyLine("# Hint:"), LineTriggerEnum::HINT);
+    QCOMPARE(classifyLine("With the task complete, you feel more experienced."),
+             LineTriggerEnum::ACCOMPLISHED_TASK);
+}
+
 void TestAdventure::testE2E()
 {
     GameObserver *observer = new GameObserver();
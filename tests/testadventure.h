@@ -29,6 +29,7 @@ private slots:
     void testAchievementParser();
     void testHintParser();
     void testKillAndXPParser();
+    void testClassifyLine();
 
     void testE2E();
 };
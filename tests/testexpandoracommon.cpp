@@ -3,8 +3,10 @@
 
 #include "testexpandoracommon.h"
 
+#include <utility>
 #include <QtTest/QtTest>
 
+#include "../src/expandoracommon/CoordinateKey.h"
 #include "../src/expandoracommon/RoomAdmin.h"
 #include "../src/expandoracommon/parseevent.h"
 #include "../src/expandoracommon/property.h"
@@ -150,6 +152,21 @@ void TestExpandoraCommon::roomCompareTest_data()
         QTest::newRow("whitespace") << room << event << ComparisonResultEnum::EQUAL;
     }
 
+    // Extra whitespace in static desc
+    {
+        SharedRoom room = create_perfect_room();
+        SharedParseEvent event
+            = ParseEvent::createEvent(CommandEnum::UNKNOWN,
+                                      name,
+                                      RoomDesc(desc.toQString().replace(". ", ".\n  ")),
+                                      contents,
+                                      room->getTerrainType(),
+                                      ExitsFlagsType{},
+                                      PromptFlagsType{},
+                                      ConnectedRoomFlagsType{});
+        QTest::newRow("extra whitespace") << room << event << ComparisonResultEnum::TOLERANCE;
+    }
+
     // Single word change to static desc
     {
         SharedRoom room = create_perfect_room();
@@ -447,4 +464,108 @@ void TestExpandoraCommon::roomCompareTest()
     QCOMPARE(result, comparison);
 }
 
+
+void TestExpandoraCommon::exitsListTest()
+{
+    ExitsList exits;
+    QCOMPARE(exits.storedCount(), size_t{0});
+    QVERIFY(exits[ExitDirEnum::UP].isEmpty());
+    QCOMPARE(exits.storedCount(), size_t{0});
+
+    // Stored in direction order, whatever order they're added in.
+    exits[ExitDirEnum::DOWN].addOut(RoomId{2});
+    exits[ExitDirEnum::NORTH].setExitFlags(ExitFlags{ExitFlagEnum::EXIT});
+    exits[ExitDirEnum::EAST].setDoorName(DoorName{"gate"});
+    QCOMPARE(exits.storedCount(), size_t{3});
+    QVERIFY(std::as_const(exits)[ExitDirEnum::DOWN].containsOut(RoomId{2}));
+    QVERIFY(std::as_const(exits)[ExitDirEnum::NORTH].isExit());
+    QVERIFY(std::as_const(exits)[ExitDirEnum::EAST].getDoorName() == DoorName{"gate"});
+    QVERIFY(std::as_const(exits)[ExitDirEnum::SOUTH].isEmpty());
+
+    // Every direction is visited, stored or not.
+    size_t visited = 0;
+    for (const Exit &e : std::as_const(exits)) {
+        visited += e.isEmpty() ? 0u : 1u;
+    }
+    QCOMPARE(visited, size_t{3});
+
+    // An exit that's been emptied still compares equal to a missing one.
+    ExitsList copy = exits;
+    copy[ExitDirEnum::DOWN].removeOut(RoomId{2});
+    QCOMPARE(copy.storedCount(), size_t{3});
+    ExitsList expected = exits;
+    expected.set(ExitDirEnum::DOWN, Exit{});
+    QCOMPARE(expected.storedCount(), size_t{2});
+    QVERIFY(copy == expected);
+    copy.compact();
+    QCOMPARE(copy.storedCount(), size_t{2});
+    QVERIFY(copy != exits);
+}
+
+void TestExpandoraCommon::coordinateKeyTest()
+{
+    const Coordinate corners[] = {Coordinate{0, 0, 0},
+                                  Coordinate{-1, -1, -1},
+                                  Coordinate{(1 << 23) - 1, -(1 << 23), (1 << 15) - 1},
+                                  Coordinate{-(1 << 23), (1 << 23) - 1, -(1 << 15)}};
+    for (const Coordinate &c : corners) {
+        QVERIFY(CoordinateKey::fits(c));
+        QCOMPARE(CoordinateKey{c}.toCoordinate(), c);
+    }
+    QVERIFY(!CoordinateKey::fits(Coordinate{1 << 23, 0, 0}));
+    QVERIFY(!CoordinateKey::fits(Coordinate{0, 0, -(1 << 15) - 1}));
+
+    // Ordered by z, then y, then x.
+    QVERIFY(CoordinateKey{5, 5, -1} < CoordinateKey{-5, -5, 0});
+    QVERIFY(CoordinateKey{5, -1, 0} < CoordinateKey{-5, 0, 0});
+    QVERIFY(CoordinateKey{-1, 0, 0} < CoordinateKey{0, 0, 0});
+
+    // Z-order keeps the 2x2 block at the origin together, and layers apart.
+    const uint64_t m00 = CoordinateKey{0, 0, 0}.toMorton();
+    QCOMPARE(CoordinateKey{1, 0, 0}.toMorton(), m00 + 1);
+    QCOMPARE(CoordinateKey{0, 1, 0}.toMorton(), m00 + 2);
+    QCOMPARE(CoordinateKey{1, 1, 0}.toMorton(), m00 + 3);
+    QVERIFY(CoordinateKey{-5, 7, 0}.toMorton() < CoordinateKey{-5, 7, 1}.toMorton());
+
+    QCOMPARE(CoordinateHash{}(Coordinate{1, 2, 3}), CoordinateHash{}(Coordinate{1, 2, 3}));
+    QVERIFY(CoordinateHash{}(Coordinate{1, 2, 3}) != CoordinateHash{}(Coordinate{2, 1, 3}));
+}
+
+namespace { // anonymous
+class NODISCARD UpdateRecorder final : public RoomModificationTracker
+{
+public:
+    RoomUpdateFlags flags;
+
+private:
+    void virt_onNotifyModified(Room & /*room*/, const RoomUpdateFlags updateFlags) final
+    {
+        flags |= updateFlags;
+    }
+};
+} // namespace
+
+void TestExpandoraCommon::lookupKeyUpdateTest()
+{
+    // MapFrontend drops its cached ParseTree lookups on NodeLookupKey, so every
+    // change to what the tree is keyed by has to report it.
+    UpdateRecorder tracker;
+    const SharedRoom room = Room::createPermanentRoom(tracker);
+
+    const auto changes = [&tracker](auto &&change) -> RoomUpdateFlags {
+        tracker.flags = RoomUpdateFlags{};
+        change();
+        return tracker.flags;
+    };
+
+    QVERIFY(changes([&room]() { room->setName(RoomName{"Riverside"}); })
+                .contains(RoomUpdateEnum::NodeLookupKey));
+    QVERIFY(changes([&room]() { room->setDescription(RoomDesc{"A river flows by."}); })
+                .contains(RoomUpdateEnum::NodeLookupKey));
+    QVERIFY(changes([&room]() { room->setTerrainType(RoomTerrainEnum::FIELD); })
+                .contains(RoomUpdateEnum::NodeLookupKey));
+    QVERIFY(!changes([&room]() { room->setNote(RoomNote{"Watch out."}); })
+                 .contains(RoomUpdateEnum::NodeLookupKey));
+}
+
 QTEST_MAIN(TestExpandoraCommon)
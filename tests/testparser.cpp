@@ -12,6 +12,7 @@
 #include "../src/expandoracommon/property.h"
 #include "../src/global/TextUtils.h"
 #include "../src/mapdata/mmapper2room.h"
+#include "../src/parser/CommandQueue.h"
 #include "../src/parser/parserutils.h"
 
 TestParser::TestParser() = default;
@@ -72,4 +73,72 @@ void TestParser::createParseEventTest()
              ::toQStringLatin1(std::string(1, static_cast<char>(terrain))));
 }
 
+NODISCARD static CommandEnum getTestCommand(const int i)
+{
+    return static_cast<CommandEnum>(i % 6);
+}
+
+void TestParser::commandQueueTest()
+{
+    CommandQueue queue;
+    QVERIFY(queue.isEmpty());
+
+    // Far more than the ring starts with, so it has to grow.
+    static constexpr const int COUNT = 1000;
+    for (int i = 0; i < COUNT; ++i) {
+        queue.enqueue(getTestCommand(i));
+    }
+    QCOMPARE(queue.size(), COUNT);
+    QCOMPARE(queue.head(), getTestCommand(0));
+    for (int i = 0; i < COUNT; ++i) {
+        QCOMPARE(queue.dequeue(), getTestCommand(i));
+    }
+    QVERIFY(queue.isEmpty());
+
+    queue = QByteArray("nsew");
+    QCOMPARE(queue.size(), 4);
+    QCOMPARE(queue.toByteArray(), QByteArray("nsew"));
+}
+
+void TestParser::commandQueueCopyTest()
+{
+    CommandQueue queue;
+    int next = 0;
+    int head = 0;
+    for (; next < 40; ++next) {
+        queue.enqueue(getTestCommand(next));
+    }
+    for (; head < 30; ++head) {
+        QCOMPARE(queue.dequeue(), getTestCommand(head));
+    }
+
+    const CommandQueue copy = queue;
+    QCOMPARE(copy.size(), 10);
+
+    // Keep the queue short, so it wraps around its ring many times over
+    // without growing it.
+    for (int i = 0; i < 500; ++i) {
+        queue.enqueue(getTestCommand(next++));
+        QCOMPARE(queue.dequeue(), getTestCommand(head++));
+    }
+
+    // The copy is still the queue as it was.
+    QCOMPARE(copy.size(), 10);
+    int expected = 30;
+    for (const CommandEnum cmd : copy) {
+        QCOMPARE(cmd, getTestCommand(expected++));
+    }
+    QCOMPARE(expected, 40);
+
+    // Enqueueing on the copy doesn't change the original.
+    CommandQueue other = copy;
+    other.enqueue(CommandEnum::LOOK);
+    QCOMPARE(other.size(), 11);
+    QCOMPARE(copy.size(), 10);
+    while (!queue.isEmpty()) {
+        QCOMPARE(queue.dequeue(), getTestCommand(head++));
+    }
+    QCOMPARE(head, next);
+}
+
 QTEST_MAIN(TestParser)
@@ -17,4 +17,7 @@ private Q_SLOTS:
     void removeAnsiMarksTest();
     void latinToAsciiTest();
     void createParseEventTest();
+    // CommandQueue
+    void commandQueueTest();
+    void commandQueueCopyTest();
 };